@@ -429,27 +429,37 @@ static int upipe_glxplayer_catch_avcdec(struct uprobe *uprobe,
             if (unlikely(deint == NULL))
                 return UBASE_ERR_ALLOC;
 
-            struct uref *output_flow = uref_dup(flow_def);
-            if (unlikely(output_flow == NULL))
-                return UBASE_ERR_ALLOC;
-            uref_pic_flow_clear_format(output_flow);
-            if (unlikely(!ubase_check(uref_pic_flow_set_macropixel(output_flow, 1)) ||
-                         !ubase_check(uref_pic_flow_set_planes(output_flow, 0)) ||
-                         !ubase_check(uref_pic_flow_add_plane(output_flow, 1, 1, 3,
-                                                  "r8g8b8")))) {
+            /* planar YUV is uploaded as is and converted by the GPU */
+            struct upipe *yuvrgb;
+            if (ubase_check(upipe_gl_texture_check_flow_def(flow_def))) {
+                yuvrgb = deint;
+            } else {
+                struct uref *output_flow = uref_dup(flow_def);
+                if (unlikely(output_flow == NULL))
+                    return UBASE_ERR_ALLOC;
+                uref_pic_flow_clear_format(output_flow);
+                if (unlikely(!ubase_check(uref_pic_flow_set_macropixel(output_flow, 1)) ||
+                             !ubase_check(uref_pic_flow_set_planes(output_flow, 0)) ||
+                             !ubase_check(uref_pic_flow_add_plane(output_flow, 1, 1, 1,
+                                                      "y8")) ||
+                             !ubase_check(uref_pic_flow_add_plane(output_flow, 2, 2, 1,
+                                                      "u8")) ||
+                             !ubase_check(uref_pic_flow_add_plane(output_flow, 2, 2, 1,
+                                                      "v8")))) {
+                    uref_free(output_flow);
+                    return UBASE_ERR_ALLOC;
+                }
+
+                yuvrgb = upipe_flow_alloc_output(deint,
+                        glxplayer->upipe_sws_mgr,
+                        uprobe_pfx_alloc_va(uprobe_use(glxplayer->uprobe_logger),
+                                            glxplayer->loglevel, "yuv"),
+                        output_flow);
+                assert(yuvrgb != NULL);
                 uref_free(output_flow);
-                return UBASE_ERR_ALLOC;
+                upipe_release(deint);
             }
 
-            struct upipe *yuvrgb = upipe_flow_alloc_output(deint,
-                    glxplayer->upipe_sws_mgr,
-                    uprobe_pfx_alloc_va(uprobe_use(glxplayer->uprobe_logger),
-                                        glxplayer->loglevel, "rgb"),
-                    output_flow);
-            assert(yuvrgb != NULL);
-            uref_free(output_flow);
-            upipe_release(deint);
-
             glxplayer->upipe_glx_qsink =
                 upipe_qsink_alloc(glxplayer->upipe_qsink_mgr,
                     uprobe_pfx_alloc(uprobe_use(glxplayer->uprobe_logger),
@@ -38,6 +38,44 @@ extern "C" {
 
 #define UPIPE_ALSINK_SIGNATURE UBASE_FOURCC('a', 'l', 's', 's')
 
+/** @This extends upipe_command with specific commands for alsa sinks. */
+enum upipe_alsink_command {
+    UPIPE_ALSINK_SENTINEL = UPIPE_CONTROL_LOCAL,
+
+    /** returns the direct buffer access mode (bool *) */
+    UPIPE_ALSINK_GET_MMAP,
+    /** sets the direct buffer access mode (bool) */
+    UPIPE_ALSINK_SET_MMAP
+};
+
+/** @This returns whether the device is accessed in mmap mode.
+ *
+ * @param upipe description structure of the pipe
+ * @param direct_p filled in with the direct buffer access mode
+ * @return an error code
+ */
+static inline int upipe_alsink_get_mmap(struct upipe *upipe, bool *direct_p)
+{
+    return upipe_control(upipe, UPIPE_ALSINK_GET_MMAP,
+                         UPIPE_ALSINK_SIGNATURE, direct_p);
+}
+
+/** @This sets whether the device is accessed in mmap mode. In this mode,
+ * sound planes are written straight into the ring buffer of the device
+ * (snd_pcm_mmap_begin/snd_pcm_mmap_commit) instead of going through
+ * snd_pcm_writei/snd_pcm_writen. If the device does not support it, the pipe falls back to
+ * the read/write mode. An opened device is reopened.
+ *
+ * @param upipe description structure of the pipe
+ * @param direct true to use direct buffer access
+ * @return an error code
+ */
+static inline int upipe_alsink_set_mmap(struct upipe *upipe, bool direct)
+{
+    return upipe_control(upipe, UPIPE_ALSINK_SET_MMAP,
+                         UPIPE_ALSINK_SIGNATURE, direct ? 1 : 0);
+}
+
 /** @This returns the management structure for all alsa sinks.
  *
  * @return pointer to manager
@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short Upipe ubuf manager for pictures wrapping avutil frames
+ *
+ * The buffers of this manager keep a reference to an AVFrame, which may live
+ * in hardware memory (VAAPI, CUDA, QSV surfaces). The frame is only
+ * transferred to system memory when a plane is accessed for the first time,
+ * so that hardware-aware consumers may get the surface with
+ * @ref ubuf_av_get_frame and process it without any copy.
+ */
+
+#ifndef _UPIPE_AV_UBUF_AV_H_
+/** @hidden */
+#define _UPIPE_AV_UBUF_AV_H_
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <upipe/ubuf.h>
+
+#include <libavutil/frame.h>
+
+#define UBUF_AV_SIGNATURE UBASE_FOURCC('a','v','f','r')
+/** allocation signature of a picture wrapping an AVFrame */
+#define UBUF_AV_ALLOC_PICTURE UBASE_FOURCC('a','v','p','c')
+
+/** @hidden */
+struct uref;
+
+/** @This extends ubuf_command with specific commands for av manager. */
+enum ubuf_av_command {
+    UBUF_AV_SENTINEL = UBUF_CONTROL_LOCAL,
+
+    /** returns the wrapped frame (AVFrame **) */
+    UBUF_AV_GET_FRAME
+};
+
+/** @This returns the AVFrame wrapped by the ubuf, which may be a hardware
+ * surface. The reference counter is not incremented, so the caller should
+ * use av_frame_ref() to keep it beyond the lifetime of the ubuf.
+ *
+ * @param ubuf pointer to ubuf
+ * @param frame_p filled in with a pointer to the frame
+ * @return an error code
+ */
+static inline int ubuf_av_get_frame(struct ubuf *ubuf, AVFrame **frame_p)
+{
+    return ubuf_control(ubuf, UBUF_AV_GET_FRAME, UBUF_AV_SIGNATURE, frame_p);
+}
+
+/** @This allocates a picture ubuf referencing the given frame. The frame
+ * is not copied.
+ *
+ * @param mgr management structure for this ubuf type
+ * @param frame frame to reference
+ * @return pointer to ubuf or NULL in case of failure
+ */
+static inline struct ubuf *ubuf_pic_av_alloc(struct ubuf_mgr *mgr,
+                                             AVFrame *frame)
+{
+    return ubuf_alloc(mgr, UBUF_AV_ALLOC_PICTURE, frame);
+}
+
+/** @This allocates a new instance of the ubuf manager for pictures wrapping
+ * AVFrames. The planes are described by the picture flow definition, and
+ * must match the system memory layout of the frames (the software format of
+ * hardware frames).
+ *
+ * @param flow_def picture flow definition
+ * @return pointer to manager, or NULL in case of error
+ */
+struct ubuf_mgr *ubuf_av_mgr_alloc(struct uref *flow_def);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
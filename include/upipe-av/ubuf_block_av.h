@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/** @file
+ * @short Upipe ubuf manager for blocks wrapping avutil buffers
+ *
+ * The buffers of this manager keep a reference to the refcounted buffer of
+ * an AVPacket, so that the packets returned by libavformat may be output
+ * without any copy.
+ */
+
+#ifndef _UPIPE_AV_UBUF_BLOCK_AV_H_
+/** @hidden */
+#define _UPIPE_AV_UBUF_BLOCK_AV_H_
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <upipe/ubuf.h>
+#include <upipe/ubuf_block.h>
+
+#include <libavcodec/avcodec.h>
+
+/** allocation signature of a block wrapping an AVPacket */
+#define UBUF_BLOCK_AV_ALLOC_PACKET UBASE_FOURCC('a','v','p','k')
+
+/** @This allocates a block ubuf referencing the data of the given packet.
+ * The packet must be refcounted; its data is not copied, and the packet may
+ * be unreferenced afterwards.
+ *
+ * @param mgr management structure for this ubuf type
+ * @param pkt packet to reference
+ * @return pointer to ubuf or NULL in case of failure
+ */
+static inline struct ubuf *ubuf_block_av_alloc(struct ubuf_mgr *mgr,
+                                               AVPacket *pkt)
+{
+    return ubuf_alloc(mgr, UBUF_BLOCK_AV_ALLOC_PACKET, pkt);
+}
+
+/** @This allocates a new instance of the ubuf manager for blocks wrapping
+ * avutil buffers. Plain block allocations (@ref ubuf_block_alloc) are
+ * also supported, and are backed by av_buffer_alloc().
+ *
+ * @return pointer to manager, or NULL in case of error
+ */
+struct ubuf_mgr *ubuf_block_av_mgr_alloc(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -36,9 +36,202 @@ extern "C" {
 #endif
 
 #include <upipe/upipe.h>
+#include <upipe/uref_attr.h>
 
 #define UPIPE_AVCDEC_SIGNATURE UBASE_FOURCC('a', 'v', 'c', 'd')
 
+UREF_ATTR_STRING(avcdec, mode, "avcdec.mode", avcdec decoding mode)
+
+/** @This extends uprobe_event with specific events for avcodec decode. */
+enum uprobe_avcdec_event {
+    UPROBE_AVCDEC_SENTINEL = UPROBE_LOCAL,
+
+    /** no frame buffer of the pool was available and a new one was
+     * allocated (unsigned int) */
+    UPROBE_AVCDEC_POOL_MISS
+};
+
+/** @This defines the threading modes of the decoder, which may be
+ * combined. */
+enum upipe_avcdec_thread_type {
+    /** decode several frames in parallel (adds latency) */
+    UPIPE_AVCDEC_THREAD_FRAME = 0x1,
+    /** decode several slices of a frame in parallel */
+    UPIPE_AVCDEC_THREAD_SLICE = 0x2
+};
+
+/** @This defines the decoding modes of the decoder. */
+enum upipe_avcdec_mode {
+    /** decode all frames at full resolution */
+    UPIPE_AVCDEC_MODE_FULL = 0,
+    /** skip the non-reference frames */
+    UPIPE_AVCDEC_MODE_NONREF,
+    /** only decode the key frames */
+    UPIPE_AVCDEC_MODE_KEY_ONLY,
+    /** decode at a reduced resolution */
+    UPIPE_AVCDEC_MODE_LOWRES
+};
+
+/** @This returns a string describing the decoding mode.
+ *
+ * @param mode decoding mode
+ * @return a description string
+ */
+static inline const char *upipe_avcdec_mode_str(enum upipe_avcdec_mode mode)
+{
+    switch (mode) {
+        UBASE_CASE_TO_STR(UPIPE_AVCDEC_MODE_FULL);
+        UBASE_CASE_TO_STR(UPIPE_AVCDEC_MODE_NONREF);
+        UBASE_CASE_TO_STR(UPIPE_AVCDEC_MODE_KEY_ONLY);
+        UBASE_CASE_TO_STR(UPIPE_AVCDEC_MODE_LOWRES);
+    }
+    return NULL;
+}
+
+/** @This extends upipe_command with specific commands for avcodec decode. */
+enum upipe_avcdec_command {
+    UPIPE_AVCDEC_SENTINEL = UPIPE_CONTROL_LOCAL,
+
+    /** sets the preview mode (uint64_t, uint64_t, int) */
+    UPIPE_AVCDEC_SET_PREVIEW,
+    /** sets the hardware acceleration (const char *, const char *) */
+    UPIPE_AVCDEC_SET_HW_CONFIG,
+    /** sets the threading mode and number of threads (int, int) */
+    UPIPE_AVCDEC_SET_THREADS,
+    /** sets the depth of the picture pool (int) */
+    UPIPE_AVCDEC_SET_POOL_DEPTH,
+    /** sets the decoding mode (int, unsigned int) */
+    UPIPE_AVCDEC_SET_MODE,
+    /** gets the decoding mode (int *) */
+    UPIPE_AVCDEC_GET_MODE
+};
+
+/** @This sets the decoder in preview mode, for instance to feed thumbnails.
+ * The pictures are decoded at the lowest resolution (lowres) which is not
+ * smaller than the given size, and the loop filter is skipped. If key_only is
+ * true, only key frames are decoded. The resolution is only
+ * changed the next time the codec is opened; the other settings take effect
+ * immediately. A size of 0x0 disables the preview mode.
+ *
+ * @param upipe description structure of the pipe
+ * @param hsize minimum horizontal size of the output pictures
+ * @param vsize minimum vertical size of the output pictures
+ * @param key_only true to only decode key frames
+ * @return an error code
+ */
+static inline int upipe_avcdec_set_preview(struct upipe *upipe,
+                                           uint64_t hsize, uint64_t vsize,
+                                           bool key_only)
+{
+    return upipe_control(upipe, UPIPE_AVCDEC_SET_PREVIEW,
+                         UPIPE_AVCDEC_SIGNATURE, hsize, vsize,
+                         key_only ? 1 : 0);
+}
+
+/** @This enables hardware-accelerated decoding, for instance with VAAPI,
+ * CUDA or QSV. The decoded pictures stay in hardware memory and are wrapped
+ * in ubuf_av buffers, which are only transferred to system memory when a
+ * plane is mapped; the surface may be retrieved with @ref ubuf_av_get_frame.
+ * If the device cannot be opened or the codec doesn't support the device
+ * type, the pipe falls back to software decoding. It only takes effect the
+ * next time the codec is opened. A NULL type disables hardware decoding.
+ *
+ * @param upipe description structure of the pipe
+ * @param hw_type type of hardware device (as in av_hwdevice_find_type_by_name)
+ * @param hw_device name of the device to open, or NULL for the default device
+ * @return an error code
+ */
+static inline int upipe_avcdec_set_hw_config(struct upipe *upipe,
+                                             const char *hw_type,
+                                             const char *hw_device)
+{
+    return upipe_control(upipe, UPIPE_AVCDEC_SET_HW_CONFIG,
+                         UPIPE_AVCDEC_SIGNATURE, hw_type, hw_device);
+}
+
+/** @This sets the threading of the decoder. Frame threading increases the
+ * throughput at the expense of one frame of latency per thread, while slice
+ * threading only works on streams with several slices. It only takes effect
+ * the next time the codec is opened, and overrides the "threads" and
+ * "thread_type" avcodec options.
+ *
+ * @param upipe description structure of the pipe
+ * @param thread_type mask of @ref upipe_avcdec_thread_type, or -1 to keep
+ * the avcodec setting
+ * @param thread_count number of threads, 0 to let avcodec choose according
+ * to the number of CPUs, or -1 to keep the avcodec setting
+ * @return an error code
+ */
+static inline int upipe_avcdec_set_threads(struct upipe *upipe,
+                                           int thread_type, int thread_count)
+{
+    return upipe_control(upipe, UPIPE_AVCDEC_SET_THREADS,
+                         UPIPE_AVCDEC_SIGNATURE, thread_type, thread_count);
+}
+
+/** @This sets the depth of the picture pool of the decoder. Pictures are
+ * allocated from a private ubuf manager which keeps the frame buffers of
+ * released pictures, so that steady-state decoding doesn't allocate buffers.
+ * Each picture is exclusively owned, and therefore writable by downstream
+ * pipes; its frame buffer returns to the pool when the last reference is
+ * released. When all frame buffers of the pool are in use, a new one is
+ * allocated and @ref UPROBE_AVCDEC_POOL_MISS is thrown: the depth should then
+ * be increased to cover the pictures held downstream. By default the depth
+ * is the number of reference frames of the stream plus the number of threads
+ * plus two.
+ * The pool is only used with codecs supporting direct rendering.
+ *
+ * @param upipe description structure of the pipe
+ * @param depth maximum number of pictures in the pool, 0 to disable the pool,
+ * or -1 for the default depth
+ * @return an error code
+ */
+static inline int upipe_avcdec_set_pool_depth(struct upipe *upipe, int depth)
+{
+    return upipe_control(upipe, UPIPE_AVCDEC_SET_POOL_DEPTH,
+                         UPIPE_AVCDEC_SIGNATURE, depth);
+}
+
+/** @This sets the decoding mode, for instance to monitor many channels at a
+ * fraction of the CPU and switch one of them back to full decoding on
+ * demand. All modes but @ref UPIPE_AVCDEC_MODE_FULL also skip the loop
+ * filter. Skipping frames takes effect immediately, without reopening the
+ * codec; the resolution reduction of @ref UPIPE_AVCDEC_MODE_LOWRES is only
+ * changed the next time the codec is opened, as avcodec allocates its
+ * pictures when opening. The mode is reported in the output flow
+ * definition with @ref uref_avcdec_set_mode.
+ *
+ * @param upipe description structure of the pipe
+ * @param mode decoding mode
+ * @param lowres log2 of the resolution reduction in
+ * @ref UPIPE_AVCDEC_MODE_LOWRES, limited to what the codec supports
+ * @return an error code
+ */
+static inline int upipe_avcdec_set_mode(struct upipe *upipe,
+                                        enum upipe_avcdec_mode mode,
+                                        unsigned int lowres)
+{
+    return upipe_control(upipe, UPIPE_AVCDEC_SET_MODE,
+                         UPIPE_AVCDEC_SIGNATURE, (int)mode, lowres);
+}
+
+/** @This returns the current decoding mode.
+ *
+ * @param upipe description structure of the pipe
+ * @param mode_p filled in with the decoding mode
+ * @return an error code
+ */
+static inline int upipe_avcdec_get_mode(struct upipe *upipe,
+                                        enum upipe_avcdec_mode *mode_p)
+{
+    int mode;
+    UBASE_RETURN(upipe_control(upipe, UPIPE_AVCDEC_GET_MODE,
+                               UPIPE_AVCDEC_SIGNATURE, &mode))
+    if (mode_p != NULL)
+        *mode_p = mode;
+    return UBASE_ERR_NONE;
+}
+
 /** @This returns the management structure for all avcodec decode pipes.
  *
  * @return pointer to manager
@@ -38,6 +38,8 @@ extern "C" {
 
 #define UPIPE_AVFSINK_SIGNATURE UBASE_FOURCC('a','v','f','k')
 #define UPIPE_AVFSINK_INPUT_SIGNATURE UBASE_FOURCC('a','v','f','i')
+/** size of the avio buffer for asynchronous writes */
+#define UPIPE_AVFSINK_ASYNC_BUFFER_SIZE (4 * 1024 * 1024)
 
 /** @This extends upipe_command with specific commands for avformat source. */
 enum upipe_avfsink_command {
@@ -53,6 +55,12 @@ enum upipe_avfsink_command {
     UPIPE_AVFSINK_SET_FORMAT,
     /** returns the current duration (uint64_t *) */
     UPIPE_AVFSINK_GET_DURATION,
+    /** sets the number of packets queued for asynchronous writes
+     * (unsigned int) */
+    UPIPE_AVFSINK_SET_ASYNC_DEPTH,
+    /** gets the number of packets queued for asynchronous writes
+     * (unsigned int *) */
+    UPIPE_AVFSINK_GET_ASYNC_DEPTH,
 };
 
 /** @This returns the management structure for all avformat sinks.
@@ -127,6 +135,38 @@ static inline int upipe_avfsink_get_duration(struct upipe *upipe,
                          UPIPE_AVFSINK_SIGNATURE, duration_p);
 }
 
+/** @This returns the number of packets queued for asynchronous writes.
+ *
+ * @param upipe description structure of the pipe
+ * @param depth_p filled in with the number of packets, or 0 for synchronous
+ * writes
+ * @return an error code
+ */
+static inline int upipe_avfsink_get_async_depth(struct upipe *upipe,
+                                                unsigned int *depth_p)
+{
+    return upipe_control(upipe, UPIPE_AVFSINK_GET_ASYNC_DEPTH,
+                         UPIPE_AVFSINK_SIGNATURE, depth_p);
+}
+
+/** @This sets the number of packets queued for asynchronous writes. In this
+ * mode, the header, packets and trailer are written by a dedicated thread,
+ * through an avio buffer of @ref UPIPE_AVFSINK_ASYNC_BUFFER_SIZE octets, so
+ * that slow disks or networks don't stall the event loop. The sources are
+ * blocked when the queue is full. It only takes effect after the next call
+ * to @ref upipe_set_uri, and requires a upump manager.
+ *
+ * @param upipe description structure of the pipe
+ * @param depth number of packets, or 0 for synchronous writes
+ * @return an error code
+ */
+static inline int upipe_avfsink_set_async_depth(struct upipe *upipe,
+                                                unsigned int depth)
+{
+    return upipe_control(upipe, UPIPE_AVFSINK_SET_ASYNC_DEPTH,
+                         UPIPE_AVFSINK_SIGNATURE, depth);
+}
+
 #ifdef __cplusplus
 }
 #endif
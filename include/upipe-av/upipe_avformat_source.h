@@ -47,7 +47,10 @@ enum upipe_avfsrc_command {
      * (uint64_t *) */
     UPIPE_AVFSRC_GET_TIME,
     /** asks to read at the given time (uint64_t) */
-    UPIPE_AVFSRC_SET_TIME
+    UPIPE_AVFSRC_SET_TIME,
+    /** asks to demux the block flow received on the input, in the given
+     * format (const char *) */
+    UPIPE_AVFSRC_OPEN_INPUT
 };
 
 /** @deprecated @This returns the content of an avformat option.
@@ -103,6 +106,23 @@ static inline int upipe_avfsrc_set_time(struct upipe *upipe, uint64_t time)
                          time);
 }
 
+/** @This asks to demux the block flow received on the input of the pipe,
+ * instead of opening an URL, so that the stream may be read by any upipe
+ * source (for instance upipe_http_src with its connection pool). The input
+ * is not seekable, so formats requiring seeks (such as non-faststart MP4)
+ * are not supported. Any currently opened URL is closed.
+ *
+ * @param upipe description structure of the pipe
+ * @param format short name of the avformat input format, or NULL to probe it
+ * @return an error code
+ */
+static inline int upipe_avfsrc_open_input(struct upipe *upipe,
+                                          const char *format)
+{
+    return upipe_control(upipe, UPIPE_AVFSRC_OPEN_INPUT,
+                         UPIPE_AVFSRC_SIGNATURE, format);
+}
+
 /** @This returns the management structure for all avformat sources.
  *
  * @return pointer to manager
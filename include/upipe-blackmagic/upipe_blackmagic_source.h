@@ -52,7 +52,22 @@ enum upipe_bmd_src_command {
     /** returns the pic subpipe (struct upipe **) */
     UPIPE_BMD_SRC_GET_PIC_SUB,
     /** returns the sound subpipe (struct upipe **) */
-    UPIPE_BMD_SRC_GET_SOUND_SUB
+    UPIPE_BMD_SRC_GET_SOUND_SUB,
+    /** returns the capture statistics (struct upipe_bmd_src_stats *) */
+    UPIPE_BMD_SRC_GET_STATS
+};
+
+/** @This is the set of counters of a bmd source, updated by the capture
+ * thread. */
+struct upipe_bmd_src_stats {
+    /** number of video frames received from the card */
+    uint64_t pic;
+    /** number of video frames lost because the queue was full */
+    uint64_t pic_dropped;
+    /** number of audio packets received from the card */
+    uint64_t sound;
+    /** number of audio packets lost because the queue was full */
+    uint64_t sound_dropped;
 };
 
 /** @This returns the management structure for all bmd sources.
@@ -89,6 +104,20 @@ static inline int upipe_bmd_src_get_sound_sub(struct upipe *upipe,
                          UPIPE_BMD_SRC_SIGNATURE, upipe_p);
 }
 
+/** @This returns the capture statistics. Frames are dropped when the pipe
+ * thread does not empty the queue fast enough.
+ *
+ * @param upipe description structure of the super pipe
+ * @param stats_p filled in with the counters
+ * @return an error code
+ */
+static inline int upipe_bmd_src_get_stats(struct upipe *upipe,
+                                          struct upipe_bmd_src_stats *stats_p)
+{
+    return upipe_control(upipe, UPIPE_BMD_SRC_GET_STATS,
+                         UPIPE_BMD_SRC_SIGNATURE, stats_p);
+}
+
 /** @hidden */
 #define ARGS_DECL , struct uprobe *uprobe_pic, struct uprobe *uprobe_sound
 /** @hidden */
@@ -30,10 +30,37 @@ extern "C" {
 #endif
 
 #include <upipe/upipe.h>
+#include <upipe-dvbcsa/upipe_dvbcsa_common.h>
 
 /** @This is the dvbcsa batch decryption pipe signature. */
 #define UPIPE_DVBCSA_BS_DEC_SIGNATURE  UBASE_FOURCC('d','v','b','D')
 
+/** @This enumerates the custom control commands of the dvbcsa batch
+ * decryption pipe. */
+enum upipe_dvbcsa_bs_dec_command {
+    /** sentinel */
+    UPIPE_DVBCSA_BS_DEC_SENTINEL = UPIPE_DVBCSA_CONTROL_LOCAL,
+
+    /** set the number of decryption threads (unsigned int) */
+    UPIPE_DVBCSA_BS_DEC_SET_THREADS,
+};
+
+/** @This sets the number of threads decrypting the batches. With 0 (the
+ * default), the batches are decrypted in the event loop thread. Otherwise
+ * full batches are handed over to a pool of worker threads, and the packets
+ * are output in their original order once decrypted.
+ *
+ * @param upipe description structure of the pipe
+ * @param nb_threads number of worker threads, or 0
+ * @return an error code
+ */
+static inline int upipe_dvbcsa_bs_dec_set_threads(struct upipe *upipe,
+                                                  unsigned int nb_threads)
+{
+    return upipe_control(upipe, UPIPE_DVBCSA_BS_DEC_SET_THREADS,
+                         UPIPE_DVBCSA_BS_DEC_SIGNATURE, nb_threads);
+}
+
 /** @This returns the dvbcsa decrypt pipe management structure.
  *
  * @return a pointer to the manager
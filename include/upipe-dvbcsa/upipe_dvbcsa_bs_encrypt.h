@@ -33,6 +33,9 @@ extern "C" {
 #define UPIPE_DVBCSA_BS_ENC_SIGNATURE   UBASE_FOURCC('d','v','b','E')
 
 /** @This returns the dvbcsa encrypt pipe management structure.
+ * Pipes allocated from the same manager with the same control word share
+ * their bitslice batches, so that packets of several PIDs are scrambled
+ * together. Such pipes must therefore run in the same event loop thread.
  *
  * @return a pointer to the manager
  */
@@ -34,9 +34,88 @@ extern "C" {
 #include <upipe/upipe.h>
 #include <upipe/uref_attr.h>
 #include <stdint.h>
+#include <string.h>
 
-UREF_ATTR_FLOAT_VA(amax, amplitude, "amax.amp[%" PRIu8"]", max amplitude,
-        uint8_t plane, plane)
+UREF_ATTR_FLOAT_VA(amax, plane_amplitude, "amax.amp[%" PRIu8"]",
+        max amplitude, uint8_t plane, plane)
+UREF_ATTR_OPAQUE(amax, levels, "amax.levels", levels of all channels)
+
+/** @This describes the levels of a channel, in the levels attribute. */
+struct uref_amax_level {
+    /** peak amplitude, between 0 and 1 */
+    float peak;
+    /** RMS amplitude, between 0 and 1 */
+    float rms;
+};
+
+/** @This returns the levels of a channel.
+ *
+ * @param uref pointer to the uref
+ * @param level_p filled in with the levels
+ * @param channel channel number
+ * @return an error code
+ */
+static inline int uref_amax_get_level(struct uref *uref,
+                                      struct uref_amax_level *level_p,
+                                      uint8_t channel)
+{
+    const uint8_t *levels;
+    size_t size;
+    UBASE_RETURN(uref_amax_get_levels(uref, &levels, &size))
+    if (unlikely((channel + 1) * sizeof(struct uref_amax_level) > size))
+        return UBASE_ERR_INVALID;
+    memcpy(level_p, levels + channel * sizeof(struct uref_amax_level),
+           sizeof(struct uref_amax_level));
+    return UBASE_ERR_NONE;
+}
+
+/** @This returns the max amplitude of a channel, from the levels attribute
+ * or from the amplitude attribute of the channel.
+ *
+ * @param uref pointer to the uref
+ * @param p filled in with the amplitude
+ * @param channel channel number
+ * @return an error code
+ */
+static inline int uref_amax_get_amplitude(struct uref *uref, double *p,
+                                          uint8_t channel)
+{
+    struct uref_amax_level level;
+    if (ubase_check(uref_amax_get_level(uref, &level, channel))) {
+        *p = level.peak;
+        return UBASE_ERR_NONE;
+    }
+    return uref_amax_get_plane_amplitude(uref, p, channel);
+}
+
+/** @This sets the max amplitude attribute of a channel.
+ *
+ * @param uref pointer to the uref
+ * @param v amplitude
+ * @param channel channel number
+ * @return an error code
+ */
+static inline int uref_amax_set_amplitude(struct uref *uref, double v,
+                                          uint8_t channel)
+{
+    return uref_amax_set_plane_amplitude(uref, v, channel);
+}
+
+/** @This returns the RMS amplitude of a channel.
+ *
+ * @param uref pointer to the uref
+ * @param p filled in with the RMS amplitude
+ * @param channel channel number
+ * @return an error code
+ */
+static inline int uref_amax_get_rms(struct uref *uref, double *p,
+                                    uint8_t channel)
+{
+    struct uref_amax_level level;
+    UBASE_RETURN(uref_amax_get_level(uref, &level, channel))
+    *p = level.rms;
+    return UBASE_ERR_NONE;
+}
 
 #define UPIPE_AUDIO_MAX_SIGNATURE UBASE_FOURCC('a', 'm', 'a', 'x')
 
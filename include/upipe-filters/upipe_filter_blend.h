@@ -33,6 +33,30 @@ extern "C" {
 
 #define UPIPE_FILTER_BLEND_SIGNATURE UBASE_FOURCC('b', 'l', 'e', 'n')
 
+/** @This extends upipe_command with specific commands for blend pipes. */
+enum upipe_filter_blend_command {
+    UPIPE_FILTER_BLEND_SENTINEL = UPIPE_CONTROL_LOCAL,
+
+    /** sets the number of deinterlacing threads (unsigned int) */
+    UPIPE_FILTER_BLEND_SET_THREADS,
+};
+
+/** @This sets the number of threads deinterlacing each picture. With 0 or
+ * 1 (the default), pictures are processed in the thread of the pipe.
+ * Otherwise each plane is split into ranges of lines processed concurrently
+ * by the thread of the pipe and nb_threads - 1 worker threads.
+ *
+ * @param upipe description structure of the pipe
+ * @param nb_threads number of threads
+ * @return an error code
+ */
+static inline int upipe_filter_blend_set_threads(struct upipe *upipe,
+                                                 unsigned int nb_threads)
+{
+    return upipe_control(upipe, UPIPE_FILTER_BLEND_SET_THREADS,
+                         UPIPE_FILTER_BLEND_SIGNATURE, nb_threads);
+}
+
 /** @This returns the management structure for all avformat sources.
  *
  * @return pointer to manager
@@ -39,6 +39,7 @@ extern "C" {
 #include <stdint.h>
 
 UREF_ATTR_FLOAT(ebur128, momentary, "ebur128.momentary", momentary loudness)
+UREF_ATTR_FLOAT(ebur128, shortterm, "ebur128.shortterm", short-term loudness)
 UREF_ATTR_FLOAT(ebur128, lra, "ebur128.lra", loudness range)
 UREF_ATTR_FLOAT(ebur128, global, "ebur128.global", global integrated loudness)
 
@@ -50,6 +51,46 @@ UREF_ATTR_FLOAT(ebur128, global, "ebur128.global", global integrated loudness)
  */
 struct upipe_mgr *upipe_filter_ebur128_mgr_alloc(void);
 
+/** @This extends upipe_command with specific commands for ebur128 pipes. */
+enum upipe_filter_ebur128_command {
+    UPIPE_FILTER_EBUR128_SENTINEL = UPIPE_CONTROL_LOCAL,
+
+    /** gets the gating mode (bool *) */
+    UPIPE_FILTER_EBUR128_GET_GATING,
+    /** sets the gating mode (bool) */
+    UPIPE_FILTER_EBUR128_SET_GATING
+};
+
+/** @This gets the gating mode.
+ *
+ * @param upipe description structure of the pipe
+ * @param gating_p filled in with true if gating is enabled
+ * @return an error code
+ */
+static inline int upipe_filter_ebur128_get_gating(struct upipe *upipe,
+                                                  bool *gating_p)
+{
+    return upipe_control(upipe, UPIPE_FILTER_EBUR128_GET_GATING,
+                         UPIPE_FILTER_EBUR128_SIGNATURE, gating_p);
+}
+
+/** @This sets the gating mode. When gating is enabled (the default), the
+ * gated global loudness and the loudness range are measured, using gating
+ * histograms. When it is disabled, only the momentary and short-term
+ * loudness are measured, which costs neither memory nor time per block.
+ * Changing the mode resets the measurement.
+ *
+ * @param upipe description structure of the pipe
+ * @param gating true to enable gating
+ * @return an error code
+ */
+static inline int upipe_filter_ebur128_set_gating(struct upipe *upipe,
+                                                  bool gating)
+{
+    return upipe_control(upipe, UPIPE_FILTER_EBUR128_SET_GATING,
+                         UPIPE_FILTER_EBUR128_SIGNATURE, gating ? 1 : 0);
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,176 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short Bin pipe decoding once and encoding a ladder of renditions
+ *
+ * The input is decoded once (unless it already is a picture flow), then
+ * each rendition is scaled from the nearest larger rendition instead of the
+ * full resolution picture, and fed to its own encoder. Renditions are
+ * allocated as subpipes with @ref upipe_flow_alloc_sub, with the flow
+ * definition of the encoder (as for @ref upipe_fenc_mgr_alloc) amended with
+ * the picture size.
+ */
+
+#ifndef _UPIPE_FILTERS_UPIPE_FILTER_LADDER_H_
+/** @hidden */
+#define _UPIPE_FILTERS_UPIPE_FILTER_LADDER_H_
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <upipe/upipe.h>
+
+#define UPIPE_FLADDER_SIGNATURE UBASE_FOURCC('f','l','a','d')
+#define UPIPE_FLADDER_SUB_SIGNATURE UBASE_FOURCC('f','l','a','r')
+
+/** maximum number of worker managers */
+#define UPIPE_FLADDER_MAX_WORKERS 16
+
+/** @This returns the management structure for all fladder pipes.
+ *
+ * @return pointer to manager
+ */
+struct upipe_mgr *upipe_fladder_mgr_alloc(void);
+
+/** @This extends upipe_mgr_command with specific commands for fladder. */
+enum upipe_fladder_mgr_command {
+    UPIPE_FLADDER_MGR_SENTINEL = UPIPE_MGR_CONTROL_LOCAL,
+
+/** @hidden */
+#define UPIPE_FLADDER_MGR_GET_SET_MGR(name, NAME)                           \
+    /** returns the current manager for name inner pipes                    \
+     * (struct upipe_mgr **) */                                             \
+    UPIPE_FLADDER_MGR_GET_##NAME##_MGR,                                     \
+    /** sets the manager for name inner pipes (struct upipe_mgr *) */       \
+    UPIPE_FLADDER_MGR_SET_##NAME##_MGR,
+
+    UPIPE_FLADDER_MGR_GET_SET_MGR(fdec, FDEC)
+    UPIPE_FLADDER_MGR_GET_SET_MGR(ffmt, FFMT)
+    UPIPE_FLADDER_MGR_GET_SET_MGR(fenc, FENC)
+#undef UPIPE_FLADDER_MGR_GET_SET_MGR
+
+    /** adds a worker manager for the scalers (struct upipe_mgr *) */
+    UPIPE_FLADDER_MGR_ADD_WORKER
+};
+
+/** @hidden */
+#define UPIPE_FLADDER_MGR_GET_SET_MGR2(name, NAME)                          \
+/** @This returns the current manager for name inner pipes.                 \
+ *                                                                          \
+ * @param mgr pointer to manager                                            \
+ * @param p filled in with the name manager                                 \
+ * @return an error code                                                    \
+ */                                                                         \
+static inline int                                                           \
+    upipe_fladder_mgr_get_##name##_mgr(struct upipe_mgr *mgr,               \
+                                       struct upipe_mgr **p)                \
+{                                                                           \
+    return upipe_mgr_control(mgr, UPIPE_FLADDER_MGR_GET_##NAME##_MGR,       \
+                             UPIPE_FLADDER_SIGNATURE, p);                   \
+}                                                                           \
+/** @This sets the manager for name inner pipes. This may only be called    \
+ * before any pipe has been allocated.                                      \
+ *                                                                          \
+ * @param mgr pointer to manager                                            \
+ * @param m pointer to name manager                                         \
+ * @return an error code                                                    \
+ */                                                                         \
+static inline int                                                           \
+    upipe_fladder_mgr_set_##name##_mgr(struct upipe_mgr *mgr,               \
+                                       struct upipe_mgr *m)                 \
+{                                                                           \
+    return upipe_mgr_control(mgr, UPIPE_FLADDER_MGR_SET_##NAME##_MGR,       \
+                             UPIPE_FLADDER_SIGNATURE, m);                   \
+}
+
+UPIPE_FLADDER_MGR_GET_SET_MGR2(fdec, FDEC)
+UPIPE_FLADDER_MGR_GET_SET_MGR2(ffmt, FFMT)
+UPIPE_FLADDER_MGR_GET_SET_MGR2(fenc, FENC)
+#undef UPIPE_FLADDER_MGR_GET_SET_MGR2
+
+/** @This adds a worker manager (see @ref upipe_wlin_mgr_alloc) to the pool
+ * used to run the scalers. Renditions are assigned to the workers in a
+ * round-robin fashion; without any worker, the scalers run in the thread
+ * of the ladder. The probes given to the renditions must then be usable
+ * from the worker threads, and provide a upump manager there (see
+ * @ref uprobe_pthread_upump_mgr_alloc). This may only be called before any
+ * pipe has been allocated.
+ *
+ * @param mgr pointer to manager
+ * @param wlin_mgr pointer to worker linear manager
+ * @return an error code
+ */
+static inline int upipe_fladder_mgr_add_worker(struct upipe_mgr *mgr,
+                                               struct upipe_mgr *wlin_mgr)
+{
+    return upipe_mgr_control(mgr, UPIPE_FLADDER_MGR_ADD_WORKER,
+                             UPIPE_FLADDER_SIGNATURE, wlin_mgr);
+}
+
+/** @This extends upipe_command with specific commands for fladder. */
+enum upipe_fladder_command {
+    UPIPE_FLADDER_SENTINEL = UPIPE_CONTROL_LOCAL,
+
+    /** returns the GOP length in pictures (unsigned int *) */
+    UPIPE_FLADDER_GET_GOP,
+    /** sets the GOP length in pictures (unsigned int) */
+    UPIPE_FLADDER_SET_GOP
+};
+
+/** @This returns the GOP length imposed to all renditions.
+ *
+ * @param upipe description structure of the pipe
+ * @param gop_p filled in with the GOP length in pictures, or 0
+ * @return an error code
+ */
+static inline int upipe_fladder_get_gop(struct upipe *upipe,
+                                        unsigned int *gop_p)
+{
+    return upipe_control(upipe, UPIPE_FLADDER_GET_GOP,
+                         UPIPE_FLADDER_SIGNATURE, gop_p);
+}
+
+/** @This sets the GOP length imposed to all renditions. Every gop pictures,
+ * the decoded picture is tagged as key and intra, and slice type
+ * enforcement is activated on the encoders, so that all renditions start
+ * their GOPs on the same pictures. For strict alignment, the encoders must
+ * not insert additional key frames (scene cut detection). 0 leaves the GOP
+ * structure to each encoder (default).
+ *
+ * @param upipe description structure of the pipe
+ * @param gop GOP length in pictures, or 0
+ * @return an error code
+ */
+static inline int upipe_fladder_set_gop(struct upipe *upipe, unsigned int gop)
+{
+    return upipe_control(upipe, UPIPE_FLADDER_SET_GOP,
+                         UPIPE_FLADDER_SIGNATURE, gop);
+}
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -22,6 +22,7 @@
 #define _UPIPE_MODULES_UPIPE_ZONEPLATE_H_
 
 #include <upipe/ubase.h>
+#include <upipe/upipe.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -30,6 +31,32 @@ extern "C" {
 /** @This is the signature of a zoneplate source pipe. */
 #define UPIPE_ZONEPLATE_SIGNATURE    UBASE_FOURCC('z','o','n','e')
 
+/** @This extends upipe_command with specific commands for zoneplate
+ * source pipes. */
+enum upipe_zoneplate_command {
+    UPIPE_ZONEPLATE_SENTINEL = UPIPE_CONTROL_LOCAL,
+
+    /** sets the number of prerendered frames (unsigned int) */
+    UPIPE_ZONEPLATE_SET_FRAMES
+};
+
+/** @This sets the number of frames which are rendered once, and then output
+ * in turn as shared buffers. The pattern repeats itself every 256 frames,
+ * so with 256 frames the output is the same as when every frame is
+ * rendered. This allows generating high frame rates and resolutions at
+ * the cost of memory.
+ *
+ * @param upipe description structure of the pipe
+ * @param nb_frames number of frames, or 0 to render every frame (default)
+ * @return an error code
+ */
+static inline int upipe_zoneplate_set_frames(struct upipe *upipe,
+                                             unsigned int nb_frames)
+{
+    return upipe_control(upipe, UPIPE_ZONEPLATE_SET_FRAMES,
+                         UPIPE_ZONEPLATE_SIGNATURE, nb_frames);
+}
+
 /** @This returns the zoneplate source pipe manager.
  *
  * @return a pointer to the zoneplate source pipe manager
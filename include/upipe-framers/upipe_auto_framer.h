@@ -34,6 +34,12 @@ extern "C" {
 #define UPIPE_AUTOF_SIGNATURE UBASE_FOURCC('a','u','t','f')
 
 /** @This returns the management structure for all auto framers.
+ *
+ * The framer is chosen from the input flow definition. If it is only
+ * "block.", the first octets of the stream (up to 4 KiB) are buffered and
+ * matched against the start codes and sync words of the supported
+ * elementary streams before a framer is allocated; idem is used if nothing
+ * matches.
  *
  * @return pointer to manager
  */
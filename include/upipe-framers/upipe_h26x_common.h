@@ -108,6 +108,20 @@ int upipe_h26xf_convert_frame(struct uref *uref,
         enum uref_h26x_encaps encaps_input, enum uref_h26x_encaps encaps_output,
         struct ubuf_mgr *ubuf_mgr, struct ubuf *annexb_header);
 
+/** @This computes in one pass over the NAL offsets the bitmask of the types
+ * of the NAL units of a frame.
+ *
+ * @param uref pointer to uref
+ * @param encaps H26x encapsulation of the frame
+ * @param get_type function returning the type of a NAL unit from its first
+ * octet
+ * @param nal_types_p filled in with the bitmask of NAL unit types
+ * @return an error code
+ */
+int upipe_h26xf_nal_types(struct uref *uref, enum uref_h26x_encaps encaps,
+                          uint8_t (*get_type)(uint8_t),
+                          uint64_t *nal_types_p);
+
 #ifdef __cplusplus
 }
 #endif
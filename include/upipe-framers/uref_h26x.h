@@ -40,6 +40,23 @@ extern "C" {
 
 UREF_ATTR_UNSIGNED_VA(h26x, nal_offset, "h26x.n[%" PRIu64"]", nal offset,
         uint64_t nal, nal)
+UREF_ATTR_UNSIGNED(h26x, nal_types, "h26x.types",
+        bitmask of the types of the NAL units of the access unit)
+
+/** @This checks if an access unit contains a NAL unit of the given type,
+ * using the bitmask set by the framers.
+ *
+ * @param uref uref description structure
+ * @param nal_type NAL unit type
+ * @return an error code, and UBASE_ERR_INVALID if the bitmask is missing or
+ * does not contain the type
+ */
+static inline int uref_h26x_has_nal_type(struct uref *uref, uint8_t nal_type)
+{
+    uint64_t nal_types;
+    UBASE_RETURN(uref_h26x_get_nal_types(uref, &nal_types))
+    return (nal_types >> nal_type) & 1 ? UBASE_ERR_NONE : UBASE_ERR_INVALID;
+}
 
 /** @This iterates over the NALs of an uref. Initialize counter_p at 0, and
  * don't modify the arguments between calls to this function.
@@ -78,6 +78,92 @@ enum upipe_gl_sink_command {
  */
 bool upipe_gl_texture_load_uref(struct uref *uref, unsigned int texture);
 
+/** maximum number of planes of a picture uploaded to GL */
+#define UPIPE_GL_TEXTURE_PLANES 3
+/** number of pixel buffer objects used to stream pictures to GL */
+#define UPIPE_GL_TEXTURE_PBOS 3
+
+/** @This describes the GL objects used to upload pictures to textures
+ * through a ring of pixel buffer objects. Planar YUV pictures are uploaded
+ * as is, one texture per plane, and converted to RGB by a fragment
+ * shader. All functions must be called with the GL context current. */
+struct upipe_gl_texture {
+    /** number of planes of the last uploaded picture, or 0 */
+    unsigned int planes;
+    /** true if the last uploaded picture was YUV */
+    bool yuv;
+    /** true if the last uploaded picture had 10 bits samples */
+    bool high_depth;
+    /** textures, one per plane */
+    unsigned int textures[UPIPE_GL_TEXTURE_PLANES];
+    /** allocated width of the textures */
+    size_t widths[UPIPE_GL_TEXTURE_PLANES];
+    /** allocated height of the textures */
+    size_t heights[UPIPE_GL_TEXTURE_PLANES];
+    /** ring of pixel buffer objects */
+    unsigned int pbos[UPIPE_GL_TEXTURE_PBOS];
+    /** next pixel buffer object to fill */
+    unsigned int pbo;
+    /** YUV to RGB shader program, or 0 if unavailable */
+    unsigned int program;
+    /** YUV to RGB matrix, in row-major order, including the range */
+    float matrix[9];
+    /** offset subtracted from the YUV samples */
+    float offset[3];
+};
+
+/** @This initializes the GL objects used to upload pictures.
+ *
+ * @param texture pointer to the texture structure
+ * @return an error code
+ */
+int upipe_gl_texture_init(struct upipe_gl_texture *texture);
+
+/** @This releases the GL objects used to upload pictures.
+ *
+ * @param texture pointer to the texture structure
+ */
+void upipe_gl_texture_clean(struct upipe_gl_texture *texture);
+
+/** @This updates the YUV to RGB conversion with the colour attributes of
+ * a new flow definition.
+ *
+ * @param texture pointer to the texture structure
+ * @param flow_def flow definition packet, or NULL for the defaults
+ */
+void upipe_gl_texture_set_flow_def(struct upipe_gl_texture *texture,
+                                   struct uref *flow_def);
+
+/** @This checks whether pictures of the given flow definition can be
+ * uploaded (RGB, or planar 8 or 10 bits YUV).
+ *
+ * @param flow_def flow definition packet
+ * @return an error code
+ */
+int upipe_gl_texture_check_flow_def(struct uref *flow_def);
+
+/** @This uploads a uref picture to the textures.
+ *
+ * @param texture pointer to the texture structure
+ * @param uref uref structure describing the picture
+ * @return an error code
+ */
+int upipe_gl_texture_load(struct upipe_gl_texture *texture,
+                          struct uref *uref);
+
+/** @This binds the textures, and the shader program for YUV pictures, for
+ * the following draw calls.
+ *
+ * @param texture pointer to the texture structure
+ */
+void upipe_gl_texture_bind(struct upipe_gl_texture *texture);
+
+/** @This unbinds the shader program bound by @ref upipe_gl_texture_bind.
+ *
+ * @param texture pointer to the texture structure
+ */
+void upipe_gl_texture_unbind(struct upipe_gl_texture *texture);
+
 #ifdef __cplusplus
 }
 #endif
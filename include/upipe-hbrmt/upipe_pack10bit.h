@@ -33,6 +33,32 @@ extern "C" {
 
 #include <upipe/upipe.h>
 
+/** @This extends upipe_command with specific commands for pack10bit
+ * pipes. */
+enum upipe_pack10bit_command {
+    UPIPE_PACK10BIT_SENTINEL = UPIPE_CONTROL_LOCAL,
+
+    /** sets the number of packing threads (unsigned int) */
+    UPIPE_PACK10BIT_SET_THREADS,
+};
+
+/** @This sets the number of threads packing each buffer. With 0 or 1 (the
+ * default), buffers are packed in the thread of the pipe. Otherwise each
+ * buffer is split into ranges of samples packed concurrently by the thread
+ * of the pipe and nb_threads - 1 worker threads, and is output once all
+ * the ranges are done.
+ *
+ * @param upipe description structure of the pipe
+ * @param nb_threads number of threads
+ * @return an error code
+ */
+static inline int upipe_pack10bit_set_threads(struct upipe *upipe,
+                                              unsigned int nb_threads)
+{
+    return upipe_control(upipe, UPIPE_PACK10BIT_SET_THREADS,
+                         UPIPE_PACK10BIT_SIGNATURE, nb_threads);
+}
+
 /** @This returns the management structure for pack10bit pipes.
  *
  * @return pointer to manager
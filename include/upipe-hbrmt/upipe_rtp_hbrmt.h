@@ -0,0 +1,93 @@
+/*
+ * Copyright (C) 2016 Open Broadcast Systems Ltd
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short Upipe module packetizing SDI frames into SMPTE 2022-6 RTP packets
+ */
+
+#ifndef _UPIPE_HBRMT_UPIPE_RTP_HBRMT_H_
+/** @hidden */
+#define _UPIPE_HBRMT_UPIPE_RTP_HBRMT_H_
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <upipe/upipe.h>
+
+#define UPIPE_RTP_HBRMT_SIGNATURE UBASE_FOURCC('r','t','p','h')
+
+/** @This extends upipe_command with specific commands for rtp hbrmt
+ * pipes. */
+enum upipe_rtp_hbrmt_command {
+    UPIPE_RTP_HBRMT_SENTINEL = UPIPE_CONTROL_LOCAL,
+
+    /** sets the video format fields of the HBRMT header (unsigned int,
+     * unsigned int, unsigned int, unsigned int) */
+    UPIPE_RTP_HBRMT_SET_FORMAT,
+};
+
+/** @This converts an enum upipe_rtp_hbrmt_command to a string.
+ *
+ * @param cmd command to convert
+ * @return a string or NULL if invalid
+ */
+static inline const char *upipe_rtp_hbrmt_command_str(int cmd)
+{
+    switch ((enum upipe_rtp_hbrmt_command)cmd) {
+    UBASE_CASE_TO_STR(UPIPE_RTP_HBRMT_SET_FORMAT);
+    case UPIPE_RTP_HBRMT_SENTINEL: break;
+    }
+    return NULL;
+}
+
+/** @This returns the management structure for rtp hbrmt pipes.
+ *
+ * @return pointer to manager
+ */
+struct upipe_mgr *upipe_rtp_hbrmt_mgr_alloc(void);
+
+/** @This sets the codes of the CF, FRAME, FRATE and SAMPLE fields of the
+ * HBRMT header, as defined by SMPTE ST 2022-6 for the transported SDI
+ * format. Until it is called, the video source format fields are absent.
+ *
+ * @param upipe description structure of the pipe
+ * @param clock code of the SDI clock frequency
+ * @param frame code of the frame format
+ * @param frate code of the frame rate
+ * @param sample code of the sample structure
+ * @return an error code
+ */
+static inline int upipe_rtp_hbrmt_set_format(struct upipe *upipe,
+                                             uint8_t clock, uint8_t frame,
+                                             uint8_t frate, uint8_t sample)
+{
+    return upipe_control(upipe, UPIPE_RTP_HBRMT_SET_FORMAT,
+                         UPIPE_RTP_HBRMT_SIGNATURE, (unsigned int)clock,
+                         (unsigned int)frame, (unsigned int)frate,
+                         (unsigned int)sample);
+}
+
+#ifdef __cplusplus
+}
+#endif
+#endif
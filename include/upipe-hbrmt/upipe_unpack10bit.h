@@ -33,6 +33,32 @@ extern "C" {
 
 #include <upipe/upipe.h>
 
+/** @This extends upipe_command with specific commands for unpack10bit
+ * pipes. */
+enum upipe_unpack10bit_command {
+    UPIPE_UNPACK10BIT_SENTINEL = UPIPE_CONTROL_LOCAL,
+
+    /** sets the number of unpacking threads (unsigned int) */
+    UPIPE_UNPACK10BIT_SET_THREADS,
+};
+
+/** @This sets the number of threads unpacking each buffer. With 0 or 1 (the
+ * default), buffers are unpacked in the thread of the pipe. Otherwise each
+ * buffer is split into ranges of samples unpacked concurrently by the thread
+ * of the pipe and nb_threads - 1 worker threads, and is output once all
+ * the ranges are done.
+ *
+ * @param upipe description structure of the pipe
+ * @param nb_threads number of threads
+ * @return an error code
+ */
+static inline int upipe_unpack10bit_set_threads(struct upipe *upipe,
+                                                unsigned int nb_threads)
+{
+    return upipe_control(upipe, UPIPE_UNPACK10BIT_SET_THREADS,
+                         UPIPE_UNPACK10BIT_SIGNATURE, nb_threads);
+}
+
 /** @This returns the management structure for unpack10bit pipes.
  *
  * @return pointer to manager
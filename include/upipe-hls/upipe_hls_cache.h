@@ -0,0 +1,244 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short in-memory cache of HLS media segments
+ * The cache keeps the urefs of downloaded segments, indexed by segment URI
+ * and byte range, so that the playlists of all the variants of a hls pipe may
+ * share them. Segments are evicted in least recently used order once the
+ * total size exceeds the configured limit. The cache is not thread-safe and
+ * must be used from the thread running the hls pipes.
+ */
+
+#ifndef _UPIPE_HLS_UPIPE_HLS_CACHE_H_
+/** @hidden */
+# define _UPIPE_HLS_UPIPE_HLS_CACHE_H_
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <upipe/ubase.h>
+#include <upipe/ulist.h>
+#include <upipe/uref.h>
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/** default maximum size of the cache, in octets */
+#define UPIPE_HLS_CACHE_DEFAULT_SIZE (64 * 1024 * 1024)
+/** default number of segments prefetched after the current one */
+#define UPIPE_HLS_CACHE_DEFAULT_PREFETCH 2
+
+/** @hidden */
+struct upipe_hls_cache;
+/** @hidden */
+struct upipe_hls_cache_entry;
+
+/** @This is a listener notified when a cache entry is updated. */
+struct upipe_hls_cache_listener {
+    /** link in the listeners of the entry */
+    struct uchain uchain;
+    /** listened entry, or NULL */
+    struct upipe_hls_cache_entry *entry;
+    /** called when urefs are appended, or the entry is completed or
+     * aborted */
+    void (*cb)(struct upipe_hls_cache_listener *);
+};
+
+UBASE_FROM_TO(upipe_hls_cache_listener, uchain, uchain, uchain);
+
+/** @This initializes a cache listener.
+ *
+ * @param listener pointer to the listener
+ * @param cb function called when the listened entry is updated
+ */
+static inline void
+    upipe_hls_cache_listener_init(struct upipe_hls_cache_listener *listener,
+                                  void (*cb)(struct upipe_hls_cache_listener *))
+{
+    uchain_init(&listener->uchain);
+    listener->entry = NULL;
+    listener->cb = cb;
+}
+
+/** @This allocates a segment cache.
+ *
+ * @param max_size maximum size of the cached segments, in octets
+ * @param prefetch number of segments to prefetch after the current one
+ * @return pointer to the cache or NULL in case of allocation error
+ */
+struct upipe_hls_cache *upipe_hls_cache_alloc(uint64_t max_size,
+                                              unsigned prefetch);
+
+/** @This increments the reference count of a cache.
+ *
+ * @param cache pointer to the cache
+ * @return the cache
+ */
+struct upipe_hls_cache *upipe_hls_cache_use(struct upipe_hls_cache *cache);
+
+/** @This decrements the reference count of a cache, and frees it when it
+ * reaches 0.
+ *
+ * @param cache pointer to the cache, may be NULL
+ */
+void upipe_hls_cache_release(struct upipe_hls_cache *cache);
+
+/** @This sets the maximum size of the cached segments, evicting segments if
+ * needed.
+ *
+ * @param cache pointer to the cache
+ * @param max_size maximum size in octets
+ */
+void upipe_hls_cache_set_max_size(struct upipe_hls_cache *cache,
+                                  uint64_t max_size);
+
+/** @This returns the number of segments to prefetch after the current one.
+ *
+ * @param cache pointer to the cache
+ * @return the number of segments
+ */
+unsigned upipe_hls_cache_get_prefetch(struct upipe_hls_cache *cache);
+
+/** @This sets the number of segments to prefetch after the current one.
+ *
+ * @param cache pointer to the cache
+ * @param prefetch number of segments, 0 disables prefetching
+ */
+void upipe_hls_cache_set_prefetch(struct upipe_hls_cache *cache,
+                                  unsigned prefetch);
+
+/** @This looks up a segment, either complete or being downloaded, and marks
+ * it as most recently used.
+ *
+ * @param cache pointer to the cache
+ * @param key segment key
+ * @return a new reference to the entry, or NULL if it is not in the cache
+ */
+struct upipe_hls_cache_entry *upipe_hls_cache_find(struct upipe_hls_cache *cache,
+                                                   const char *key);
+
+/** @This adds a new segment being downloaded. The caller must either
+ * complete or abort it.
+ *
+ * @param cache pointer to the cache
+ * @param key segment key
+ * @return a reference to the entry, or NULL in case of allocation error
+ */
+struct upipe_hls_cache_entry *upipe_hls_cache_add(struct upipe_hls_cache *cache,
+                                                  const char *key);
+
+/** @This increments the reference count of an entry, which prevents its
+ * eviction.
+ *
+ * @param entry pointer to the entry
+ * @return the entry
+ */
+struct upipe_hls_cache_entry *
+    upipe_hls_cache_entry_use(struct upipe_hls_cache_entry *entry);
+
+/** @This decrements the reference count of an entry. An entry which is
+ * released by everyone before being completed is dropped.
+ *
+ * @param entry pointer to the entry, may be NULL
+ */
+void upipe_hls_cache_entry_release(struct upipe_hls_cache_entry *entry);
+
+/** @This sets the flow definition of the segment.
+ *
+ * @param entry pointer to the entry
+ * @param flow_def flow definition, belongs to the callee
+ */
+void upipe_hls_cache_entry_set_flow_def(struct upipe_hls_cache_entry *entry,
+                                        struct uref *flow_def);
+
+/** @This returns the flow definition of the segment.
+ *
+ * @param entry pointer to the entry
+ * @return the flow definition, or NULL if it is not known yet
+ */
+struct uref *
+    upipe_hls_cache_entry_get_flow_def(struct upipe_hls_cache_entry *entry);
+
+/** @This appends a buffer to a segment being downloaded.
+ *
+ * @param entry pointer to the entry
+ * @param uref buffer to append, belongs to the callee
+ */
+void upipe_hls_cache_entry_append(struct upipe_hls_cache_entry *entry,
+                                  struct uref *uref);
+
+/** @This marks a segment as completely downloaded.
+ *
+ * @param entry pointer to the entry
+ */
+void upipe_hls_cache_entry_complete(struct upipe_hls_cache_entry *entry);
+
+/** @This marks a segment as failed and removes it from the cache.
+ *
+ * @param entry pointer to the entry
+ */
+void upipe_hls_cache_entry_abort(struct upipe_hls_cache_entry *entry);
+
+/** @This checks whether a segment is completely downloaded.
+ *
+ * @param entry pointer to the entry
+ * @return true if no more urefs will be appended
+ */
+bool upipe_hls_cache_entry_is_complete(struct upipe_hls_cache_entry *entry);
+
+/** @This checks whether a segment download failed.
+ *
+ * @param entry pointer to the entry
+ * @return true if the segment was aborted
+ */
+bool upipe_hls_cache_entry_is_aborted(struct upipe_hls_cache_entry *entry);
+
+/** @This returns the list of urefs of a segment. The list may only grow
+ * while a reference to the entry is held.
+ *
+ * @param entry pointer to the entry
+ * @return pointer to the list of urefs
+ */
+struct uchain *upipe_hls_cache_entry_urefs(struct upipe_hls_cache_entry *entry);
+
+/** @This registers a listener on an entry.
+ *
+ * @param entry pointer to the entry
+ * @param listener pointer to the listener
+ */
+void upipe_hls_cache_entry_listen(struct upipe_hls_cache_entry *entry,
+                                  struct upipe_hls_cache_listener *listener);
+
+/** @This unregisters a listener.
+ *
+ * @param listener pointer to the listener
+ */
+void upipe_hls_cache_entry_unlisten(struct upipe_hls_cache_listener *listener);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* !_UPIPE_HLS_UPIPE_HLS_CACHE_H_ */
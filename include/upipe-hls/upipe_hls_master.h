@@ -33,6 +33,44 @@ extern "C" {
 #define UPIPE_HLS_MASTER_SIGNATURE      UBASE_FOURCC('h','l','s','M')
 #define UPIPE_HLS_MASTER_SUB_SIGNATURE  UBASE_FOURCC('h','l','s','m')
 
+/** @This extends upipe_command with specific commands for hls master pipes.
+ * They are also accepted by hls pipes once the master playlist is known. */
+enum upipe_hls_master_command {
+    UPIPE_HLS_MASTER_SENTINEL = UPIPE_CONTROL_LOCAL,
+
+    /** set the maximum size of the segment cache (uint64_t) */
+    UPIPE_HLS_MASTER_SET_CACHE_SIZE,
+    /** set the number of segments to prefetch (unsigned int) */
+    UPIPE_HLS_MASTER_SET_PREFETCH,
+};
+
+/** @This sets the maximum size of the segment cache shared by the variants.
+ *
+ * @param upipe description structure of the pipe
+ * @param size maximum size in octets
+ * @return an error code
+ */
+static inline int upipe_hls_master_set_cache_size(struct upipe *upipe,
+                                                  uint64_t size)
+{
+    return upipe_control(upipe, UPIPE_HLS_MASTER_SET_CACHE_SIZE,
+                         UPIPE_HLS_MASTER_SIGNATURE, size);
+}
+
+/** @This sets the number of segments downloaded in advance by each
+ * playlist.
+ *
+ * @param upipe description structure of the pipe
+ * @param prefetch number of segments, 0 to disable prefetching
+ * @return an error code
+ */
+static inline int upipe_hls_master_set_prefetch(struct upipe *upipe,
+                                                unsigned int prefetch)
+{
+    return upipe_control(upipe, UPIPE_HLS_MASTER_SET_PREFETCH,
+                         UPIPE_HLS_MASTER_SIGNATURE, prefetch);
+}
+
 /** @This allocates a hls master pipe manager.
  *
  * @return the pipe manager.
@@ -145,6 +145,11 @@ enum uprobe_hls_playlist_event {
     UPROBE_HLS_PLAYLIST_RELOADED,
     /** the item has finished */
     UPROBE_HLS_PLAYLIST_ITEM_END,
+    /** playlist needs a segment cache (struct upipe_hls_cache **) */
+    UPROBE_HLS_PLAYLIST_NEED_CACHE,
+    /** playlist needs a blocking reload, to be answered by the server once
+     * the given partial segment is available (uint64_t, uint64_t) */
+    UPROBE_HLS_PLAYLIST_NEED_BLOCKING_RELOAD,
 };
 
 /** @This converts hls playlist specific event to a string.
@@ -158,6 +163,8 @@ static inline const char *uprobe_hls_playlist_event_str(int event)
     UBASE_CASE_TO_STR(UPROBE_HLS_PLAYLIST_NEED_RELOAD);
     UBASE_CASE_TO_STR(UPROBE_HLS_PLAYLIST_RELOADED);
     UBASE_CASE_TO_STR(UPROBE_HLS_PLAYLIST_ITEM_END);
+    UBASE_CASE_TO_STR(UPROBE_HLS_PLAYLIST_NEED_CACHE);
+    UBASE_CASE_TO_STR(UPROBE_HLS_PLAYLIST_NEED_BLOCKING_RELOAD);
     case UPROBE_HLS_PLAYLIST_SENTINEL: break;
     }
     return NULL;
@@ -38,12 +38,35 @@ extern "C" {
 
 #define UPIPE_AGG_SIGNATURE UBASE_FOURCC('a','g','g','g')
 
+/** @This extends upipe_command with specific commands for agg pipes. */
+enum upipe_agg_command {
+    UPIPE_AGG_SENTINEL = UPIPE_CONTROL_LOCAL,
+
+    /** outputs the current aggregation, even if incomplete (void) */
+    UPIPE_AGG_FLUSH,
+};
+
 /** @This returns the management structure for all agg pipes.
  *
  * @return pointer to manager
  */
 struct upipe_mgr *upipe_agg_mgr_alloc(void);
 
+/** @This outputs the current aggregation immediately, even if it is smaller
+ * than the output size. This is typically called at the end of a burst of
+ * packets, so that a batching sink receives all the datagrams of the burst.
+ *
+ * Aggregations are built without copy, by chaining the block ubufs of the
+ * incoming packets; sinks may send them with @ref uref_block_iovec_read.
+ *
+ * @param upipe description structure of the pipe
+ * @return an error code
+ */
+static inline int upipe_agg_flush(struct upipe *upipe)
+{
+    return upipe_control(upipe, UPIPE_AGG_FLUSH, UPIPE_AGG_SIGNATURE);
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -42,6 +42,52 @@ extern "C" {
 
 #define UPIPE_BUFFER_SIGNATURE UBASE_FOURCC('b','u','f','f')
 
+/** @This is the behaviour of the buffer pipe when the maximum size is
+ * reached. */
+enum upipe_buffer_policy {
+    /** block the input upump (default) */
+    UPIPE_BUFFER_POLICY_BLOCK,
+    /** drop the oldest buffered urefs */
+    UPIPE_BUFFER_POLICY_DROP_OLDEST,
+    /** move the new urefs, with their attributes, to a temporary file
+     * which is read back ahead of the output; to keep the order, the
+     * following urefs also go to the file until it is drained, and the new
+     * urefs are dropped if the file cannot be written */
+    UPIPE_BUFFER_POLICY_SPILL,
+};
+
+/** @This converts @ref upipe_buffer_policy to a string.
+ *
+ * @param policy buffer policy
+ * @return a string or NULL if invalid
+ */
+static inline const char *upipe_buffer_policy_str(
+    enum upipe_buffer_policy policy)
+{
+    switch (policy) {
+    UBASE_CASE_TO_STR(UPIPE_BUFFER_POLICY_BLOCK);
+    UBASE_CASE_TO_STR(UPIPE_BUFFER_POLICY_DROP_OLDEST);
+    UBASE_CASE_TO_STR(UPIPE_BUFFER_POLICY_SPILL);
+    }
+    return NULL;
+}
+
+/** @This is the set of counters of a buffer pipe. */
+struct upipe_buffer_stats {
+    /** octets currently retained in memory */
+    uint64_t size;
+    /** highest number of octets retained in memory */
+    uint64_t high_water;
+    /** octets currently moved to the temporary file */
+    uint64_t spilled_size;
+    /** number of urefs moved to the temporary file */
+    uint64_t spilled;
+    /** number of urefs dropped */
+    uint64_t dropped;
+    /** number of octets dropped */
+    uint64_t dropped_size;
+};
+
 /** @This extends @ref upipe_command with specific buffer commands. */
 enum upipe_buffer_command {
     UPIPE_BUFFER_SENTINEL = UPIPE_CONTROL_LOCAL,
@@ -58,6 +104,13 @@ enum upipe_buffer_command {
     UPIPE_BUFFER_SET_HIGH,
     /** get the high limit in octet (uint64_t *) */
     UPIPE_BUFFER_GET_HIGH,
+    /** set the policy when the maximum size is reached
+     * (enum upipe_buffer_policy) */
+    UPIPE_BUFFER_SET_POLICY,
+    /** set the directory of the temporary file (const char *) */
+    UPIPE_BUFFER_SET_SPILL_PATH,
+    /** get the counters (struct upipe_buffer_stats *) */
+    UPIPE_BUFFER_GET_STATS,
 };
 
 /** @This converts @ref upipe_buffer_command to a string.
@@ -74,6 +127,9 @@ static inline const char *upipe_buffer_command_str(int command)
     UBASE_CASE_TO_STR(UPIPE_BUFFER_GET_LOW);
     UBASE_CASE_TO_STR(UPIPE_BUFFER_SET_HIGH);
     UBASE_CASE_TO_STR(UPIPE_BUFFER_GET_HIGH);
+    UBASE_CASE_TO_STR(UPIPE_BUFFER_SET_POLICY);
+    UBASE_CASE_TO_STR(UPIPE_BUFFER_SET_SPILL_PATH);
+    UBASE_CASE_TO_STR(UPIPE_BUFFER_GET_STATS);
     case UPIPE_BUFFER_SENTINEL: break;
     }
     return NULL;
@@ -157,6 +213,46 @@ static inline int upipe_buffer_get_high_limit(struct upipe *upipe,
                          UPIPE_BUFFER_SIGNATURE, high_limit_p);
 }
 
+/** @This sets the policy when the maximum size is reached.
+ *
+ * @param upipe description structure of the pipe
+ * @param policy policy to apply
+ * @return an error code
+ */
+static inline int upipe_buffer_set_policy(struct upipe *upipe,
+                                          enum upipe_buffer_policy policy)
+{
+    return upipe_control(upipe, UPIPE_BUFFER_SET_POLICY,
+                         UPIPE_BUFFER_SIGNATURE, policy);
+}
+
+/** @This sets the directory where the temporary file is created with
+ * @ref UPIPE_BUFFER_POLICY_SPILL. The default is /tmp.
+ *
+ * @param upipe description structure of the pipe
+ * @param path path of the directory
+ * @return an error code
+ */
+static inline int upipe_buffer_set_spill_path(struct upipe *upipe,
+                                              const char *path)
+{
+    return upipe_control(upipe, UPIPE_BUFFER_SET_SPILL_PATH,
+                         UPIPE_BUFFER_SIGNATURE, path);
+}
+
+/** @This gets the counters of the buffer pipe.
+ *
+ * @param upipe description structure of the pipe
+ * @param stats filled in with the counters
+ * @return an error code
+ */
+static inline int upipe_buffer_get_stats(struct upipe *upipe,
+                                         struct upipe_buffer_stats *stats)
+{
+    return upipe_control(upipe, UPIPE_BUFFER_GET_STATS,
+                         UPIPE_BUFFER_SIGNATURE, stats);
+}
+
 /** @This is the buffer pipe states. */
 enum upipe_buffer_state {
     /** under the low limit */
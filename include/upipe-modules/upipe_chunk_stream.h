@@ -35,6 +35,7 @@ extern "C" {
 #endif
 
 #include <stdint.h>
+#include <stdbool.h>
 #include <upipe/upipe.h>
 
 #define UPIPE_CHUNK_STREAM_SIGNATURE UBASE_FOURCC('c','h','u','n')
@@ -47,6 +48,8 @@ enum upipe_chunk_stream_command {
     UPIPE_CHUNK_STREAM_SET_MTU,
     /** set chunk size (unsigned int*, unsigned int*) */
     UPIPE_CHUNK_STREAM_GET_MTU,
+    /** make chunks contiguous (int) */
+    UPIPE_CHUNK_STREAM_SET_CONTIGUOUS,
 };
 
 /** @This returns the configured mtu of TS packets.
@@ -76,6 +79,22 @@ static inline int upipe_chunk_stream_set_mtu(struct upipe *upipe,
                          UPIPE_CHUNK_STREAM_SIGNATURE, mtu, align);
 }
 
+/** @This sets whether the output chunks must be contiguous. By default,
+ * chunks reference the segments of the input buffers and may be
+ * segmented; when enabled, a chunk is copied to a new buffer only if it
+ * spans several segments.
+ *
+ * @param upipe description structure of the pipe
+ * @param contiguous true if the chunks must be contiguous
+ * @return an error code
+ */
+static inline int upipe_chunk_stream_set_contiguous(struct upipe *upipe,
+                                                    bool contiguous)
+{
+    return upipe_control(upipe, UPIPE_CHUNK_STREAM_SET_CONTIGUOUS,
+                         UPIPE_CHUNK_STREAM_SIGNATURE, contiguous ? 1 : 0);
+}
+
 /** @This returns the management structure for chunk_stream pipes.
  *
  * @return pointer to manager
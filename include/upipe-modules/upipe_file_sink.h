@@ -40,6 +40,8 @@ extern "C" {
 
 #define UPIPE_FSINK_SIGNATURE UBASE_FOURCC('f','s','n','k')
 #define UPIPE_FSINK_EXPECTED_FLOW_DEF "block."
+/** size of a staging buffer for asynchronous writes */
+#define UPIPE_FSINK_ASYNC_BUFFER_SIZE (1024 * 1024)
 
 /** @This defines file opening modes. */
 enum upipe_fsink_mode {
@@ -69,6 +71,12 @@ enum upipe_fsink_command {
     UPIPE_FSINK_SET_SYNC_PERIOD,
     /** gets fdatasync period (uint64_t *) */
     UPIPE_FSINK_GET_SYNC_PERIOD,
+    /** sets the number of staging buffers for asynchronous writes
+     * (unsigned int) */
+    UPIPE_FSINK_SET_ASYNC_DEPTH,
+    /** gets the number of staging buffers for asynchronous writes
+     * (unsigned int *) */
+    UPIPE_FSINK_GET_ASYNC_DEPTH,
 
     /** outer pipes commands begin here */
     UPIPE_FSINK_CONTROL_LOCAL = UPIPE_CONTROL_LOCAL + 0x1000
@@ -162,6 +170,37 @@ static inline int upipe_fsink_set_sync_period(struct upipe *upipe,
                          UPIPE_FSINK_SIGNATURE, sync_period);
 }
 
+/** @This returns the number of staging buffers for asynchronous writes.
+ *
+ * @param upipe description structure of the pipe
+ * @param depth_p filled in with the number of buffers, or 0 for synchronous
+ * writes
+ * @return an error code
+ */
+static inline int upipe_fsink_get_async_depth(struct upipe *upipe,
+                                              unsigned int *depth_p)
+{
+    return upipe_control(upipe, UPIPE_FSINK_GET_ASYNC_DEPTH,
+                         UPIPE_FSINK_SIGNATURE, depth_p);
+}
+
+/** @This sets the number of staging buffers for asynchronous writes. In this
+ * mode, the buffers are copied to a ring of aligned buffers of
+ * @ref UPIPE_FSINK_ASYNC_BUFFER_SIZE octets, which are written by a dedicated
+ * thread, with O_DIRECT if the file supports it. The sources are blocked
+ * when the ring is full. It takes effect on the next opening of a file.
+ *
+ * @param upipe description structure of the pipe
+ * @param depth number of buffers, or 0 for synchronous writes
+ * @return an error code
+ */
+static inline int upipe_fsink_set_async_depth(struct upipe *upipe,
+                                              unsigned int depth)
+{
+    return upipe_control(upipe, UPIPE_FSINK_SET_ASYNC_DEPTH,
+                         UPIPE_FSINK_SIGNATURE, depth);
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -38,6 +38,83 @@ extern "C" {
 
 #define UPIPE_FSRC_SIGNATURE UBASE_FOURCC('f','s','r','c')
 
+/** @This extends upipe_command with specific commands for file source. */
+enum upipe_fsrc_command {
+    UPIPE_FSRC_SENTINEL = UPIPE_CONTROL_LOCAL,
+
+    /** returns true if regular files are mapped in memory (int *) */
+    UPIPE_FSRC_GET_MMAP,
+    /** maps regular files in memory instead of reading them (int) */
+    UPIPE_FSRC_SET_MMAP,
+    /** returns true if regular files are output as file ranges (int *) */
+    UPIPE_FSRC_GET_FILE_UBUF,
+    /** outputs regular files as file ranges instead of reading them (int) */
+    UPIPE_FSRC_SET_FILE_UBUF,
+};
+
+/** @This returns true if regular files are mapped in memory.
+ *
+ * @param upipe description structure of the pipe
+ * @param mmap_p filled in with true if memory mapping is enabled
+ * @return an error code
+ */
+static inline int upipe_fsrc_get_mmap(struct upipe *upipe, bool *mmap_p)
+{
+    int enabled;
+    UBASE_RETURN(upipe_control(upipe, UPIPE_FSRC_GET_MMAP,
+                               UPIPE_FSRC_SIGNATURE, &enabled))
+    if (mmap_p != NULL)
+        *mmap_p = !!enabled;
+    return UBASE_ERR_NONE;
+}
+
+/** @This enables or disables memory mapping of regular files. In this mode,
+ * the output urefs point directly to the mapping, in chunks of the output
+ * size, without copy. It takes effect on the next @ref upipe_set_uri.
+ *
+ * @param upipe description structure of the pipe
+ * @param enabled true to map regular files in memory
+ * @return an error code
+ */
+static inline int upipe_fsrc_set_mmap(struct upipe *upipe, bool enabled)
+{
+    return upipe_control(upipe, UPIPE_FSRC_SET_MMAP, UPIPE_FSRC_SIGNATURE,
+                         enabled ? 1 : 0);
+}
+
+/** @This returns true if regular files are output as file ranges.
+ *
+ * @param upipe description structure of the pipe
+ * @param file_ubuf_p filled in with true if file ranges are enabled
+ * @return an error code
+ */
+static inline int upipe_fsrc_get_file_ubuf(struct upipe *upipe,
+                                           bool *file_ubuf_p)
+{
+    int enabled;
+    UBASE_RETURN(upipe_control(upipe, UPIPE_FSRC_GET_FILE_UBUF,
+                               UPIPE_FSRC_SIGNATURE, &enabled))
+    if (file_ubuf_p != NULL)
+        *file_ubuf_p = !!enabled;
+    return UBASE_ERR_NONE;
+}
+
+/** @This enables or disables the output of regular files as file ranges
+ * (see @ref ubuf_block_file_mgr_alloc), in chunks of the output size. The
+ * payload is not read unless a downstream pipe maps it, so that sinks may
+ * send it with sendfile(). It takes precedence over memory mapping, and
+ * takes effect on the next @ref upipe_set_uri.
+ *
+ * @param upipe description structure of the pipe
+ * @param enabled true to output file ranges
+ * @return an error code
+ */
+static inline int upipe_fsrc_set_file_ubuf(struct upipe *upipe, bool enabled)
+{
+    return upipe_control(upipe, UPIPE_FSRC_SET_FILE_UBUF, UPIPE_FSRC_SIGNATURE,
+                         enabled ? 1 : 0);
+}
+
 /** @This returns the management structure for all file sources.
  *
  * @return pointer to manager
@@ -53,6 +53,35 @@ struct upipe *upipe_grid_alloc_input(struct upipe *upipe,
 int upipe_grid_out_get_input(struct upipe *upipe, struct upipe **input_p);
 int upipe_grid_out_set_input(struct upipe *upipe, struct upipe *input);
 
+/** @This gets the offsets (from the respective borders of the input
+ * pictures) of the cropped rectangle of a grid output.
+ *
+ * @param upipe description structure of the output pipe
+ * @param loffset_p filled in with the offset from the left border
+ * @param roffset_p filled in with the offset from the right border
+ * @param toffset_p filled in with the offset from the top border
+ * @param boffset_p filled in with the offset from the bottom border
+ * @return an error code
+ */
+int upipe_grid_out_get_crop(struct upipe *upipe,
+                            uint64_t *loffset_p, uint64_t *roffset_p,
+                            uint64_t *toffset_p, uint64_t *boffset_p);
+
+/** @This sets the offsets (from the respective borders of the input
+ * pictures) of the cropped rectangle of a grid output. The output pictures
+ * share the buffers of the input pictures, so cropping is free.
+ *
+ * @param upipe description structure of the output pipe
+ * @param loffset offset from the left border
+ * @param roffset offset from the right border
+ * @param toffset offset from the top border
+ * @param boffset offset from the bottom border
+ * @return an error code
+ */
+int upipe_grid_out_set_crop(struct upipe *upipe,
+                            uint64_t loffset, uint64_t roffset,
+                            uint64_t toffset, uint64_t boffset);
+
 /** @This allocates a new grid output.
  *
  * @param upipe description structure of the pipe
@@ -39,12 +39,64 @@ extern "C" {
 
 #define UPIPE_HTONS_SIGNATURE UBASE_FOURCC('h','t','o','n')
 
+/** @This extends upipe_command with specific commands for htons pipes. */
+enum upipe_htons_command {
+    UPIPE_HTONS_SENTINEL = UPIPE_CONTROL_LOCAL,
+
+    /** sets the size of the swapped words (unsigned int) */
+    UPIPE_HTONS_SET_WORD_SIZE,
+    /** returns the size of the swapped words (unsigned int *) */
+    UPIPE_HTONS_GET_WORD_SIZE,
+};
+
+/** @This converts an enum upipe_htons_command to a string.
+ *
+ * @param cmd command to convert
+ * @return a string or NULL if invalid
+ */
+static inline const char *upipe_htons_command_str(int cmd)
+{
+    switch ((enum upipe_htons_command)cmd) {
+    UBASE_CASE_TO_STR(UPIPE_HTONS_SET_WORD_SIZE);
+    UBASE_CASE_TO_STR(UPIPE_HTONS_GET_WORD_SIZE);
+    case UPIPE_HTONS_SENTINEL: break;
+    }
+    return NULL;
+}
+
 /** @This returns the management structure for skip pipes.
  *
  * @return pointer to manager
  */
 struct upipe_mgr *upipe_htons_mgr_alloc(void);
 
+/** @This sets the size of the words to swap to network byte order, so that
+ * the pipe also serves 24-bit and 32-bit PCM. The default is 2.
+ *
+ * @param upipe description structure of the pipe
+ * @param word_size size of a word in octets (2, 3 or 4)
+ * @return an error code
+ */
+static inline int upipe_htons_set_word_size(struct upipe *upipe,
+                                            unsigned int word_size)
+{
+    return upipe_control(upipe, UPIPE_HTONS_SET_WORD_SIZE,
+                         UPIPE_HTONS_SIGNATURE, word_size);
+}
+
+/** @This returns the size of the words swapped to network byte order.
+ *
+ * @param upipe description structure of the pipe
+ * @param word_size_p filled in with the size of a word in octets
+ * @return an error code
+ */
+static inline int upipe_htons_get_word_size(struct upipe *upipe,
+                                            unsigned int *word_size_p)
+{
+    return upipe_control(upipe, UPIPE_HTONS_GET_WORD_SIZE,
+                         UPIPE_HTONS_SIGNATURE, word_size_p);
+}
+
 #ifdef __cplusplus
 }
 #endif
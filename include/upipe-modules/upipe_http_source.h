@@ -98,6 +98,9 @@ enum upipe_http_src_command {
 
     /** set the http proxy to use (const char *) */
     UPIPE_HTTP_SRC_SET_PROXY,
+    /** set the number of parallel ranged requests (unsigned int,
+     * uint64_t) */
+    UPIPE_HTTP_SRC_SET_PARALLEL,
 };
 
 /** @This converts an enum upipe_http_src_command to a string.
@@ -109,6 +112,7 @@ static inline const char *upipe_http_src_command_str(int cmd)
 {
     switch ((enum upipe_http_src_command)cmd) {
     UBASE_CASE_TO_STR(UPIPE_HTTP_SRC_SET_PROXY);
+    UBASE_CASE_TO_STR(UPIPE_HTTP_SRC_SET_PARALLEL);
     case UPIPE_HTTP_SRC_SENTINEL: break;
     }
     return NULL;
@@ -127,6 +131,25 @@ static inline int upipe_http_src_set_proxy(struct upipe *upipe,
                          UPIPE_HTTP_SRC_SIGNATURE, proxy);
 }
 
+/** @This sets the maximum number of concurrent connections used to fetch
+ * a resource. When the server accepts byte ranges, the resource (or the
+ * range set with @ref upipe_src_set_range) is split into consecutive
+ * ranges of at least the given size, which are downloaded in parallel and
+ * output in order. The first range is output as soon as it is received.
+ *
+ * @param upipe description structure of the pipe
+ * @param connections maximum number of connections, 1 to disable
+ * @param size minimum size of a range
+ * @return an error code
+ */
+static inline int upipe_http_src_set_parallel(struct upipe *upipe,
+                                              unsigned int connections,
+                                              uint64_t size)
+{
+    return upipe_control(upipe, UPIPE_HTTP_SRC_SET_PARALLEL,
+                         UPIPE_HTTP_SRC_SIGNATURE, connections, size);
+}
+
 /** @This extends upipe_mgr_command with specific commands for http source. */
 enum upipe_http_src_mgr_command {
     UPIPE_HTTP_SRC_MGR_SENTINEL = UPIPE_MGR_CONTROL_LOCAL,
@@ -140,6 +163,11 @@ enum upipe_http_src_mgr_command {
     UPIPE_HTTP_SRC_MGR_SET_COOKIE,
     /** iterate over cookies */
     UPIPE_HTTP_SRC_MGR_ITERATE_COOKIE,
+
+    /** get the maximum number of idle connections (unsigned int *) */
+    UPIPE_HTTP_SRC_MGR_GET_KEEP_ALIVE,
+    /** set the maximum number of idle connections (unsigned int) */
+    UPIPE_HTTP_SRC_MGR_SET_KEEP_ALIVE,
 };
 
 /** @This sets the proxy url to use by default for the new allocated pipes.
@@ -198,6 +226,36 @@ static inline int upipe_http_src_mgr_iterate_cookie(struct upipe_mgr *mgr,
                              UPIPE_HTTP_SRC_SIGNATURE, domain, path, uchain_p);
 }
 
+/** @This gets the maximum number of idle connections kept open by the
+ * manager for reuse by the next allocated pipes.
+ *
+ * @param mgr pointer to upipe manager
+ * @param max_p filled in with the maximum number of idle connections
+ * @return an error code
+ */
+static inline int upipe_http_src_mgr_get_keep_alive(struct upipe_mgr *mgr,
+                                                    unsigned int *max_p)
+{
+    return upipe_mgr_control(mgr, UPIPE_HTTP_SRC_MGR_GET_KEEP_ALIVE,
+                             UPIPE_HTTP_SRC_SIGNATURE, max_p);
+}
+
+/** @This sets the maximum number of idle connections kept open by the
+ * manager. Connections are indexed by host and port (or proxy), and are
+ * reused when a pipe is opened on the same server. Setting 0 disables
+ * persistent connections.
+ *
+ * @param mgr pointer to upipe manager
+ * @param max maximum number of idle connections
+ * @return an error code
+ */
+static inline int upipe_http_src_mgr_set_keep_alive(struct upipe_mgr *mgr,
+                                                    unsigned int max)
+{
+    return upipe_mgr_control(mgr, UPIPE_HTTP_SRC_MGR_SET_KEEP_ALIVE,
+                             UPIPE_HTTP_SRC_SIGNATURE, max);
+}
+
 /** @This returns the management structure for all http sources.
  *
  * @return pointer to manager
@@ -27,8 +27,52 @@
 extern "C" {
 #endif
 
+#include <upipe/upipe.h>
+
 # define UPIPE_M3U_READER_SIGNATURE UBASE_FOURCC('m','3','u','r')
 
+/** @This extends @ref upipe_command with specific m3u reader commands. */
+enum upipe_m3u_reader_command {
+    UPIPE_M3U_READER_SENTINEL = UPIPE_CONTROL_LOCAL,
+
+    /** enable or disable incremental playlist refresh (int) */
+    UPIPE_M3U_READER_SET_INCREMENTAL,
+};
+
+/** @This converts m3u reader specific command to a string.
+ *
+ * @param cmd @ref upipe_m3u_reader_command to convert
+ * @return the corresponding string or NULL if not a valid
+ * @ref upipe_m3u_reader_command
+ */
+static inline const char *upipe_m3u_reader_command_str(int cmd)
+{
+    switch ((enum upipe_m3u_reader_command)cmd) {
+    UBASE_CASE_TO_STR(UPIPE_M3U_READER_SET_INCREMENTAL);
+    case UPIPE_M3U_READER_SENTINEL: break;
+    }
+    return NULL;
+}
+
+/** @This enables or disables incremental refresh of media playlists.
+ * When enabled, the segments already output by a previous load of a live
+ * playlist are skipped, and only the segments appended since (and the
+ * partial segments of the live edge) are output. The sequence number of the
+ * first output segment is set in the flow definition (see
+ * @ref uref_m3u_playlist_flow_get_append), and a refresh that appends
+ * nothing is signaled with a single item without URI.
+ *
+ * @param upipe description structure of the pipe
+ * @param enable enable or disable
+ * @return an error code
+ */
+static inline int upipe_m3u_reader_set_incremental(struct upipe *upipe,
+                                                   bool enable)
+{
+    return upipe_control(upipe, UPIPE_M3U_READER_SET_INCREMENTAL,
+                         UPIPE_M3U_READER_SIGNATURE, enable ? 1 : 0);
+}
+
 /** @This returns the management structure for m3u reader.
  *
  * @return pointer to manager
@@ -50,6 +50,8 @@ enum upipe_match_attr_command {
     UPIPE_MATCH_ATTR_SET_UINT64_T,
     /** set boundaries (uint64_t, uint64_t) */
     UPIPE_MATCH_ATTR_SET_BOUNDARIES,
+    /** match unsigned attr by type and name (enum udict_type, const char *) */
+    UPIPE_MATCH_ATTR_SET_ATTR,
 };
 
 /** @This sets the match callback to check uint8_t attribute with.
@@ -93,6 +95,25 @@ static inline int
                          UPIPE_MATCH_ATTR_SIGNATURE, min, max);
 }
 
+/** @This sets an unsigned attribute to check against the boundaries,
+ * without a callback. The attribute may be a small unsigned, an unsigned, or
+ * a shorthand of these types; a name matching a shorthand attribute is
+ * resolved once to the shorthand type. urefs without the attribute are
+ * dropped.
+ *
+ * @param upipe description structure of the pipe
+ * @param type UDICT_TYPE_SMALL_UNSIGNED, UDICT_TYPE_UNSIGNED or a shorthand
+ * @param name name of the attribute, ignored for shorthands
+ * @return an error code
+ */
+static inline int upipe_match_attr_set_attr(struct upipe *upipe,
+                                            enum udict_type type,
+                                            const char *name)
+{
+    return upipe_control(upipe, UPIPE_MATCH_ATTR_SET_ATTR,
+                         UPIPE_MATCH_ATTR_SIGNATURE, type, name);
+}
+
 /** @This returns the management structure for all match_attr pipes.
  *
  * @return pointer to manager
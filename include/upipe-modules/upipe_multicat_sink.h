@@ -64,7 +64,15 @@ enum upipe_multicat_sink_command {
     /** sets fsink manager (struct upipe_fsink_mgr *) */
     UPIPE_MULTICAT_SINK_SET_FSINK_MGR,
     /** gets fsink manager (struct upipe_fsink_mgr **) */
-    UPIPE_MULTICAT_SINK_GET_FSINK_MGR
+    UPIPE_MULTICAT_SINK_GET_FSINK_MGR,
+    /** gets preallocated size of the files (uint64_t *) */
+    UPIPE_MULTICAT_SINK_GET_PREALLOC,
+    /** sets preallocated size of the files (uint64_t) */
+    UPIPE_MULTICAT_SINK_SET_PREALLOC,
+    /** gets size of the batched writes (unsigned int *) */
+    UPIPE_MULTICAT_SINK_GET_BATCH,
+    /** sets size of the batched writes (unsigned int) */
+    UPIPE_MULTICAT_SINK_SET_BATCH
 };
 
 /** @This returns the management structure for multicat_sink pipes.
@@ -178,6 +186,65 @@ static inline int
                                 UPIPE_MULTICAT_SINK_SIGNATURE, fsink_mgr);
 }
 
+/** @This returns the preallocated size of the files.
+ *
+ * @param upipe description structure of the pipe
+ * @param prealloc_p filled in with the preallocated size, in octets
+ * @return an error code
+ */
+static inline int
+    upipe_multicat_sink_get_prealloc(struct upipe *upipe,
+                                     uint64_t *prealloc_p)
+{
+    return upipe_control(upipe, UPIPE_MULTICAT_SINK_GET_PREALLOC,
+                                UPIPE_MULTICAT_SINK_SIGNATURE, prealloc_p);
+}
+
+/** @This sets the preallocated size of the files. If not 0, the next file is
+ * opened in a background thread half a rotate interval before it is needed,
+ * and the given size is reserved on disk without changing the file size.
+ * (default 0, files are opened when needed)
+ *
+ * @param upipe description structure of the pipe
+ * @param prealloc preallocated size, in octets
+ * @return an error code
+ */
+static inline int
+    upipe_multicat_sink_set_prealloc(struct upipe *upipe, uint64_t prealloc)
+{
+    return upipe_control(upipe, UPIPE_MULTICAT_SINK_SET_PREALLOC,
+                                UPIPE_MULTICAT_SINK_SIGNATURE, prealloc);
+}
+
+/** @This returns the size of the batched writes.
+ *
+ * @param upipe description structure of the pipe
+ * @param batch_p filled in with the size of the batched writes, in octets
+ * @return an error code
+ */
+static inline int
+    upipe_multicat_sink_get_batch(struct upipe *upipe, unsigned int *batch_p)
+{
+    return upipe_control(upipe, UPIPE_MULTICAT_SINK_GET_BATCH,
+                                UPIPE_MULTICAT_SINK_SIGNATURE, batch_p);
+}
+
+/** @This sets the size of the batched writes. If not 0, incoming buffers
+ * are chained and written together once they reach the given size, or when
+ * the file is rotated. This is meant for small buffers such as aux
+ * timestamps. (default 0, one write per buffer)
+ *
+ * @param upipe description structure of the pipe
+ * @param batch size of the batched writes, in octets
+ * @return an error code
+ */
+static inline int
+    upipe_multicat_sink_set_batch(struct upipe *upipe, unsigned int batch)
+{
+    return upipe_control(upipe, UPIPE_MULTICAT_SINK_SET_BATCH,
+                                UPIPE_MULTICAT_SINK_SIGNATURE, batch);
+}
+
 #ifdef __cplusplus
 }
 #endif
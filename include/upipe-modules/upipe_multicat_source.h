@@ -49,12 +49,52 @@ UREF_ATTR_UNSIGNED(msrc_flow, offset, "msrc.offset", rotate offset)
 #define UPIPE_MSRC_DEF_ROTATE UINT64_C(97200000000)
 #define UPIPE_MSRC_DEF_OFFSET UINT64_C(0)
 
+/** @This extends upipe_command with specific commands for msrc. */
+enum upipe_msrc_command {
+    UPIPE_MSRC_SENTINEL = UPIPE_CONTROL_LOCAL,
+
+    /** returns the stride of the coarse index (unsigned int *) */
+    UPIPE_MSRC_GET_INDEX_STRIDE,
+    /** sets the stride of the coarse index (unsigned int) */
+    UPIPE_MSRC_SET_INDEX_STRIDE,
+};
+
 /** @This returns the management structure for msrc pipes.
  *
  * @return pointer to manager
  */
 struct upipe_mgr *upipe_msrc_mgr_alloc(void);
 
+/** @This returns the stride of the coarse index of the aux files.
+ *
+ * @param upipe description structure of the pipe
+ * @param stride_p filled in with the number of aux entries between two
+ * samples of the index, or 0 if disabled
+ * @return an error code
+ */
+static inline int upipe_msrc_get_index_stride(struct upipe *upipe,
+                                              unsigned int *stride_p)
+{
+    return upipe_control(upipe, UPIPE_MSRC_GET_INDEX_STRIDE,
+                         UPIPE_MSRC_SIGNATURE, stride_p);
+}
+
+/** @This sets the stride of the coarse index of the aux files. If not 0, the
+ * date of one aux entry every stride entries is kept in memory the first time
+ * a segment is seeked into, so that later seeks in the same segment only
+ * read a few entries. (default 0, disabled)
+ *
+ * @param upipe description structure of the pipe
+ * @param stride number of aux entries between two samples of the index
+ * @return an error code
+ */
+static inline int upipe_msrc_set_index_stride(struct upipe *upipe,
+                                              unsigned int stride)
+{
+    return upipe_control(upipe, UPIPE_MSRC_SET_INDEX_STRIDE,
+                         UPIPE_MSRC_SIGNATURE, stride);
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,195 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short Upipe modules measuring the latency of urefs across a pipeline
+ *
+ * The stamp pipe is placed at the ingress of the section to measure. It
+ * records the current date of its uclock in a dedicated uref attribute,
+ * unless an earlier stamp is already present.
+ *
+ * The meter pipe is placed at the egress. For each uref it computes the
+ * time elapsed since the stamp and aggregates it in a log-linear histogram
+ * (1/32 relative precision). Every interval, it throws a
+ * @ref UPROBE_PROBE_LATENCY_REPORT event with the distribution of the
+ * latencies of the window, and starts a new window. A meter pipe handles
+ * exactly one flow, so one meter should be allocated per flow to monitor.
+ *
+ * Both pipes forward the urefs untouched, and share the same uclock
+ * (usually the system clock) for the measure to be meaningful.
+ */
+
+#ifndef _UPIPE_MODULES_UPIPE_PROBE_LATENCY_H_
+/** @hidden */
+#define _UPIPE_MODULES_UPIPE_PROBE_LATENCY_H_
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <upipe/upipe.h>
+#include <upipe/uref_attr.h>
+
+#include <stdint.h>
+
+#define UPIPE_PROBE_LATENCY_STAMP_SIGNATURE UBASE_FOURCC('p','r','l','s')
+#define UPIPE_PROBE_LATENCY_METER_SIGNATURE UBASE_FOURCC('p','r','l','m')
+
+UREF_ATTR_UNSIGNED(probe_latency, ingress, "prl.ingress",
+        ingress date for latency measurement)
+
+/** @This describes the latency distribution of a measurement window. All
+ * durations are in units of the 27 MHz clock. */
+struct upipe_probe_latency_stats {
+    /** duration of the window */
+    uint64_t duration;
+    /** number of measured urefs */
+    uint64_t count;
+    /** number of urefs received without an ingress stamp */
+    uint64_t missing;
+    /** minimum latency */
+    uint64_t min;
+    /** maximum latency */
+    uint64_t max;
+    /** mean latency */
+    uint64_t mean;
+    /** median latency */
+    uint64_t p50;
+    /** 90th percentile */
+    uint64_t p90;
+    /** 99th percentile */
+    uint64_t p99;
+    /** 99.9th percentile */
+    uint64_t p999;
+};
+
+/** @This extends uprobe_event with specific events for latency meter. */
+enum upipe_probe_latency_event {
+    UPROBE_PROBE_LATENCY_SENTINEL = UPROBE_LOCAL,
+
+    /** end of a measurement window
+     * (const struct upipe_probe_latency_stats *) */
+    UPROBE_PROBE_LATENCY_REPORT
+};
+
+/** @This converts @ref upipe_probe_latency_event to a string.
+ *
+ * @param event event to convert
+ * @return a string or NULL if invalid
+ */
+static inline const char *upipe_probe_latency_event_str(int event)
+{
+    switch ((enum upipe_probe_latency_event)event) {
+    UBASE_CASE_TO_STR(UPROBE_PROBE_LATENCY_REPORT);
+    case UPROBE_PROBE_LATENCY_SENTINEL: break;
+    }
+    return NULL;
+}
+
+/** @This extends upipe_command with specific commands for latency meter. */
+enum upipe_probe_latency_command {
+    UPIPE_PROBE_LATENCY_SENTINEL = UPIPE_CONTROL_LOCAL,
+
+    /** sets the report interval (uint64_t) */
+    UPIPE_PROBE_LATENCY_SET_INTERVAL,
+    /** returns the report interval (uint64_t *) */
+    UPIPE_PROBE_LATENCY_GET_INTERVAL,
+    /** returns the statistics of the current window
+     * (struct upipe_probe_latency_stats *) */
+    UPIPE_PROBE_LATENCY_GET_STATS,
+};
+
+/** @This converts @ref upipe_probe_latency_command to a string.
+ *
+ * @param command command to convert
+ * @return a string or NULL if invalid
+ */
+static inline const char *upipe_probe_latency_command_str(int command)
+{
+    switch ((enum upipe_probe_latency_command)command) {
+    UBASE_CASE_TO_STR(UPIPE_PROBE_LATENCY_SET_INTERVAL);
+    UBASE_CASE_TO_STR(UPIPE_PROBE_LATENCY_GET_INTERVAL);
+    UBASE_CASE_TO_STR(UPIPE_PROBE_LATENCY_GET_STATS);
+    case UPIPE_PROBE_LATENCY_SENTINEL: break;
+    }
+    return NULL;
+}
+
+/** @This sets the report interval of a latency meter. An interval of 0
+ * disables the periodic reports.
+ *
+ * @param upipe description structure of the pipe
+ * @param interval report interval in clock ticks
+ * @return an error code
+ */
+static inline int upipe_probe_latency_set_interval(struct upipe *upipe,
+                                                   uint64_t interval)
+{
+    return upipe_control(upipe, UPIPE_PROBE_LATENCY_SET_INTERVAL,
+                         UPIPE_PROBE_LATENCY_METER_SIGNATURE, interval);
+}
+
+/** @This returns the report interval of a latency meter.
+ *
+ * @param upipe description structure of the pipe
+ * @param interval_p filled in with the report interval in clock ticks
+ * @return an error code
+ */
+static inline int upipe_probe_latency_get_interval(struct upipe *upipe,
+                                                   uint64_t *interval_p)
+{
+    return upipe_control(upipe, UPIPE_PROBE_LATENCY_GET_INTERVAL,
+                         UPIPE_PROBE_LATENCY_METER_SIGNATURE, interval_p);
+}
+
+/** @This returns the statistics of the current, unfinished window of a
+ * latency meter.
+ *
+ * @param upipe description structure of the pipe
+ * @param stats filled in with the statistics
+ * @return an error code
+ */
+static inline int upipe_probe_latency_get_stats(struct upipe *upipe,
+        struct upipe_probe_latency_stats *stats)
+{
+    return upipe_control(upipe, UPIPE_PROBE_LATENCY_GET_STATS,
+                         UPIPE_PROBE_LATENCY_METER_SIGNATURE, stats);
+}
+
+/** @This returns the management structure for latency stamp pipes.
+ *
+ * @return pointer to manager
+ */
+struct upipe_mgr *upipe_probe_latency_stamp_mgr_alloc(void);
+
+/** @This returns the management structure for latency meter pipes.
+ *
+ * @return pointer to manager
+ */
+struct upipe_mgr *upipe_probe_latency_meter_mgr_alloc(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -55,12 +55,173 @@ extern "C" {
 
 #define UPIPE_QSINK_SIGNATURE UBASE_FOURCC('q','s','n','k')
 
+/** @This extends upipe_command with specific commands for queue sink. */
+enum upipe_qsink_command {
+    UPIPE_QSINK_SENTINEL = UPIPE_CONTROL_LOCAL,
+
+    /** returns the number of polls of a full queue (unsigned int *) */
+    UPIPE_QSINK_GET_SPIN,
+    /** sets the number of polls of a full queue (unsigned int) */
+    UPIPE_QSINK_SET_SPIN,
+    /** returns the watermarks in urefs (unsigned int *, unsigned int *) */
+    UPIPE_QSINK_GET_WATERMARKS,
+    /** sets the watermarks in urefs (unsigned int, unsigned int) */
+    UPIPE_QSINK_SET_WATERMARKS,
+    /** returns the watermarks in octets (unsigned int *, unsigned int *) */
+    UPIPE_QSINK_GET_BYTE_WATERMARKS,
+    /** sets the watermarks in octets (unsigned int, unsigned int) */
+    UPIPE_QSINK_SET_BYTE_WATERMARKS,
+    /** returns the fill level of the queue (unsigned int *, unsigned int *) */
+    UPIPE_QSINK_GET_FILL
+};
+
+/** @This extends uprobe_event with specific events for queue sink. They are
+ * only thrown once watermarks have been set with
+ * @ref upipe_qsink_set_watermarks or @ref upipe_qsink_set_byte_watermarks. */
+enum uprobe_qsink_event {
+    UPROBE_QSINK_SENTINEL = UPROBE_LOCAL,
+
+    /** the queue reached a high watermark and the sink blocks its sources
+     * (unsigned int, unsigned int) */
+    UPROBE_QSINK_HIGH_WATERMARK,
+    /** the queue drained to the low watermarks and the sink unblocks its
+     * sources (unsigned int, unsigned int) */
+    UPROBE_QSINK_LOW_WATERMARK
+};
+
+/** @This converts @ref uprobe_qsink_event to a string.
+ *
+ * @param event event to convert
+ * @return a string or NULL if invalid
+ */
+static inline const char *uprobe_qsink_event_str(int event)
+{
+    switch ((enum uprobe_qsink_event)event) {
+    UBASE_CASE_TO_STR(UPROBE_QSINK_HIGH_WATERMARK);
+    UBASE_CASE_TO_STR(UPROBE_QSINK_LOW_WATERMARK);
+    case UPROBE_QSINK_SENTINEL: break;
+    }
+    return NULL;
+}
+
 /** @This returns the management structure for all queue sinks.
  *
  * @return pointer to manager
  */
 struct upipe_mgr *upipe_qsink_mgr_alloc(void);
 
+/** @This returns the number of times a full queue is polled before waiting
+ * for it to be writable again.
+ *
+ * @param upipe description structure of the pipe
+ * @param spin_p filled in with the number of polls
+ * @return an error code
+ */
+static inline int upipe_qsink_get_spin(struct upipe *upipe,
+                                       unsigned int *spin_p)
+{
+    return upipe_control(upipe, UPIPE_QSINK_GET_SPIN, UPIPE_QSINK_SIGNATURE,
+                         spin_p);
+}
+
+/** @This sets the number of times a full queue is polled before waiting for
+ * it to be writable again. Polling avoids blocking the sources and waking
+ * up through the event loop when the queue source drains the queue
+ * quickly, at the expense of CPU time. The queue source is only woken up
+ * when the queue goes from empty to non-empty.
+ *
+ * @param upipe description structure of the pipe
+ * @param spin number of polls (default 0)
+ * @return an error code
+ */
+static inline int upipe_qsink_set_spin(struct upipe *upipe, unsigned int spin)
+{
+    return upipe_control(upipe, UPIPE_QSINK_SET_SPIN, UPIPE_QSINK_SIGNATURE,
+                         spin);
+}
+
+/** @This returns the watermarks of the queue, in number of urefs.
+ *
+ * @param upipe description structure of the pipe
+ * @param high_p filled in with the high watermark
+ * @param low_p filled in with the low watermark
+ * @return an error code
+ */
+static inline int upipe_qsink_get_watermarks(struct upipe *upipe,
+                                             unsigned int *high_p,
+                                             unsigned int *low_p)
+{
+    return upipe_control(upipe, UPIPE_QSINK_GET_WATERMARKS,
+                         UPIPE_QSINK_SIGNATURE, high_p, low_p);
+}
+
+/** @This sets the watermarks of the queue, in number of urefs. The sink
+ * stops pushing and blocks its sources when the queue holds high urefs, and
+ * only resumes when it has drained to low urefs, so that the sources are not
+ * woken up for every uref taken by the queue source.
+ *
+ * @param upipe description structure of the pipe
+ * @param high high watermark, at most the length of the queue (default)
+ * @param low low watermark, lower than high (default length - 1)
+ * @return an error code
+ */
+static inline int upipe_qsink_set_watermarks(struct upipe *upipe,
+                                             unsigned int high,
+                                             unsigned int low)
+{
+    return upipe_control(upipe, UPIPE_QSINK_SET_WATERMARKS,
+                         UPIPE_QSINK_SIGNATURE, high, low);
+}
+
+/** @This returns the watermarks of the queue, in octets.
+ *
+ * @param upipe description structure of the pipe
+ * @param high_p filled in with the high watermark
+ * @param low_p filled in with the low watermark
+ * @return an error code
+ */
+static inline int upipe_qsink_get_byte_watermarks(struct upipe *upipe,
+                                                  unsigned int *high_p,
+                                                  unsigned int *low_p)
+{
+    return upipe_control(upipe, UPIPE_QSINK_GET_BYTE_WATERMARKS,
+                         UPIPE_QSINK_SIGNATURE, high_p, low_p);
+}
+
+/** @This sets the watermarks of the queue, in octets of block, picture and
+ * sound buffers. This bounds the memory held by the queue when the size of
+ * the buffers varies, for instance with video frames. The sink blocks when
+ * the buffers in the queue reach high octets, and resumes when they have
+ * drained to low octets. The last uref pushed may exceed the budget.
+ *
+ * @param upipe description structure of the pipe
+ * @param high high watermark, or 0 to disable the budget (default)
+ * @param low low watermark, lower than high
+ * @return an error code
+ */
+static inline int upipe_qsink_set_byte_watermarks(struct upipe *upipe,
+                                                  unsigned int high,
+                                                  unsigned int low)
+{
+    return upipe_control(upipe, UPIPE_QSINK_SET_BYTE_WATERMARKS,
+                         UPIPE_QSINK_SIGNATURE, high, low);
+}
+
+/** @This returns the current fill level of the queue.
+ *
+ * @param upipe description structure of the pipe
+ * @param length_p filled in with the number of urefs in the queue
+ * @param bytes_p filled in with the number of octets in the queue
+ * @return an error code
+ */
+static inline int upipe_qsink_get_fill(struct upipe *upipe,
+                                       unsigned int *length_p,
+                                       unsigned int *bytes_p)
+{
+    return upipe_control(upipe, UPIPE_QSINK_GET_FILL, UPIPE_QSINK_SIGNATURE,
+                         length_p, bytes_p);
+}
+
 /** @hidden */
 #define ARGS_DECL , struct upipe *qsrc
 /** @hidden */
@@ -57,7 +57,12 @@ enum upipe_qsrc_command {
     /** returns the maximum length of the queue (unsigned int *) */
     UPIPE_QSRC_GET_MAX_LENGTH,
     /** returns the current length of the queue (unsigned int *) */
-    UPIPE_QSRC_GET_LENGTH
+    UPIPE_QSRC_GET_LENGTH,
+    /** returns the maximum number of urefs handled per wake-up
+     * (unsigned int *) */
+    UPIPE_QSRC_GET_BATCH,
+    /** sets the maximum number of urefs handled per wake-up (unsigned int) */
+    UPIPE_QSRC_SET_BATCH
 };
 
 /** @This returns the management structure for all queue sources.
@@ -95,6 +100,35 @@ static inline int upipe_qsrc_get_length(struct upipe *upipe,
                          UPIPE_QSRC_SIGNATURE, length_p);
 }
 
+/** @This returns the maximum number of urefs handled per wake-up.
+ *
+ * @param upipe description structure of the pipe
+ * @param batch_p filled in with the maximum number of urefs
+ * @return an error code
+ */
+static inline int upipe_qsrc_get_batch(struct upipe *upipe,
+                                       unsigned int *batch_p)
+{
+    return upipe_control(upipe, UPIPE_QSRC_GET_BATCH,
+                         UPIPE_QSRC_SIGNATURE, batch_p);
+}
+
+/** @This sets the maximum number of urefs handled per wake-up. The queue is
+ * drained until it is empty or this number is reached; a higher value
+ * saves wake-ups at the expense of the latency of the other watchers of
+ * the event loop.
+ *
+ * @param upipe description structure of the pipe
+ * @param batch maximum number of urefs (at least 1, default 32)
+ * @return an error code
+ */
+static inline int upipe_qsrc_set_batch(struct upipe *upipe,
+                                       unsigned int batch)
+{
+    return upipe_control(upipe, UPIPE_QSRC_SET_BATCH,
+                         UPIPE_QSRC_SIGNATURE, batch);
+}
+
 /** @hidden */
 #define ARGS_DECL , unsigned int queue_length
 /** @hidden */
@@ -22,6 +22,10 @@ enum upipe_rate_limit_command {
     UPIPE_RATE_LIMIT_SET_DURATION,
     /** get the window (uint64_t *) in clock tick */
     UPIPE_RATE_LIMIT_GET_DURATION,
+    /** set the token bucket depth (uint64_t) in octets */
+    UPIPE_RATE_LIMIT_SET_BUCKET,
+    /** get the token bucket depth (uint64_t *) in octets */
+    UPIPE_RATE_LIMIT_GET_BUCKET,
 };
 
 /** @This converts @ref upipe_rate_limit_command to a string.
@@ -36,6 +40,8 @@ static inline const char *upipe_rate_limit_command_str(int command)
     UBASE_CASE_TO_STR(UPIPE_RATE_LIMIT_SET_LIMIT);
     UBASE_CASE_TO_STR(UPIPE_RATE_LIMIT_GET_DURATION);
     UBASE_CASE_TO_STR(UPIPE_RATE_LIMIT_SET_DURATION);
+    UBASE_CASE_TO_STR(UPIPE_RATE_LIMIT_SET_BUCKET);
+    UBASE_CASE_TO_STR(UPIPE_RATE_LIMIT_GET_BUCKET);
     case UPIPE_RATE_LIMIT_SENTINEL: break;
     }
     return NULL;
@@ -93,6 +99,35 @@ static inline int upipe_rate_limit_get_duration(struct upipe *upipe,
                          UPIPE_RATE_LIMIT_SIGNATURE, duration_p);
 }
 
+/** @This sets the depth of the token bucket. When it is not 0, the pipe
+ * paces its output with a token bucket filled at the rate limit, instead of
+ * counting the octets sent in the window, and a block is output as soon as
+ * enough tokens are available.
+ *
+ * @param upipe description structure of the pipe
+ * @param bucket depth of the bucket in octets, or 0 to use the window
+ * @return an error code
+ */
+static inline int upipe_rate_limit_set_bucket(struct upipe *upipe,
+                                              uint64_t bucket)
+{
+    return upipe_control(upipe, UPIPE_RATE_LIMIT_SET_BUCKET,
+                         UPIPE_RATE_LIMIT_SIGNATURE, bucket);
+}
+
+/** @This gets the depth of the token bucket.
+ *
+ * @param upipe description structure of the pipe
+ * @param bucket_p filled in with the depth of the bucket in octets
+ * @return an error code
+ */
+static inline int upipe_rate_limit_get_bucket(struct upipe *upipe,
+                                              uint64_t *bucket_p)
+{
+    return upipe_control(upipe, UPIPE_RATE_LIMIT_GET_BUCKET,
+                         UPIPE_RATE_LIMIT_SIGNATURE, bucket_p);
+}
+
 /** @This returns the rate limit pipe manager. */
 struct upipe_mgr *upipe_rate_limit_mgr_alloc(void);
 
@@ -36,12 +36,15 @@ extern "C" {
 
 #include <upipe/upipe.h>
 
+#include <stdbool.h>
+
 #define UPIPE_RTPD_SIGNATURE UBASE_FOURCC('r','t','p','d')
 
 enum upipe_rtpd_command {
     UPIPE_RTPD_SENTINEL = UPIPE_CONTROL_LOCAL,
 
     UPIPE_RTPD_GET_PACKETS_LOST, /* int sig, uint64_t * */
+    UPIPE_RTPD_SET_HEADER_ONLY, /* int sig, bool */
 };
 
 static inline int upipe_rtpd_get_packets_lost(struct upipe *upipe,
@@ -51,6 +54,22 @@ static inline int upipe_rtpd_get_packets_lost(struct upipe *upipe,
             UPIPE_RTPD_SIGNATURE, lost);
 }
 
+/** @This enables or disables the header-only mode. In this mode, the
+ * packets carrying the same RTP timestamp as the previous packet are only
+ * checked for continuity and stripped of their header; they are not dated
+ * and do not throw clock events.
+ *
+ * @param upipe description structure of the pipe
+ * @param header_only true to enable the header-only mode
+ * @return an error code
+ */
+static inline int upipe_rtpd_set_header_only(struct upipe *upipe,
+                                             bool header_only)
+{
+    return upipe_control(upipe, UPIPE_RTPD_SET_HEADER_ONLY,
+            UPIPE_RTPD_SIGNATURE, header_only ? 1 : 0);
+}
+
 
 /** @This returns the management structure for rtpd pipes.
  *
@@ -29,10 +29,69 @@
 extern "C" {
 #endif
 
+#include <upipe/upipe.h>
+
 #define UPIPE_RTP_MPEG4_SIGNATURE UBASE_FOURCC('r','t','p','m')
 
+/** @This extends upipe_command with specific commands for rtp mpeg4 pipes. */
+enum upipe_rtp_mpeg4_command {
+    UPIPE_RTP_MPEG4_SENTINEL = UPIPE_CONTROL_LOCAL,
+
+    /** sets the maximum payload size (unsigned int) */
+    UPIPE_RTP_MPEG4_SET_MTU,
+    /** sets the maximum duration of a packet (uint64_t) */
+    UPIPE_RTP_MPEG4_SET_MAX_DURATION,
+};
+
+/** @This converts an enum upipe_rtp_mpeg4_command to a string.
+ *
+ * @param cmd command to convert
+ * @return a string or NULL if invalid
+ */
+static inline const char *upipe_rtp_mpeg4_command_str(int cmd)
+{
+    switch ((enum upipe_rtp_mpeg4_command)cmd) {
+    UBASE_CASE_TO_STR(UPIPE_RTP_MPEG4_SET_MTU);
+    UBASE_CASE_TO_STR(UPIPE_RTP_MPEG4_SET_MAX_DURATION);
+    case UPIPE_RTP_MPEG4_SENTINEL: break;
+    }
+    return NULL;
+}
+
+/** @This returns the management structure for rtp mpeg4 pipes.
+ *
+ * @return pointer to manager
+ */
 struct upipe_mgr *upipe_rtp_mpeg4_mgr_alloc(void);
 
+/** @This sets the maximum size of the RTP payload, AU headers included,
+ * when several access units are aggregated in a packet (RFC 3640).
+ *
+ * @param upipe description structure of the pipe
+ * @param mtu maximum payload size in octets
+ * @return an error code
+ */
+static inline int upipe_rtp_mpeg4_set_mtu(struct upipe *upipe,
+                                          unsigned int mtu)
+{
+    return upipe_control(upipe, UPIPE_RTP_MPEG4_SET_MTU,
+                         UPIPE_RTP_MPEG4_SIGNATURE, mtu);
+}
+
+/** @This sets the maximum duration of the access units aggregated in a
+ * packet. The default is 0, which outputs one access unit per packet.
+ *
+ * @param upipe description structure of the pipe
+ * @param duration maximum duration in 27 MHz units
+ * @return an error code
+ */
+static inline int upipe_rtp_mpeg4_set_max_duration(struct upipe *upipe,
+                                                   uint64_t duration)
+{
+    return upipe_control(upipe, UPIPE_RTP_MPEG4_SET_MAX_DURATION,
+                         UPIPE_RTP_MPEG4_SIGNATURE, duration);
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -47,7 +47,9 @@ enum upipe_rtpr_command {
     /** returns the current reorder delay being set into urefs (uint64_t **) */
     UPIPE_RTPR_GET_DELAY,
     /** sets the reorder delay to set into urefs (uint64_t *) */
-    UPIPE_RTPR_SET_DELAY
+    UPIPE_RTPR_SET_DELAY,
+    /** sets the bounds of the delay in adaptive mode (uint64_t, uint64_t) */
+    UPIPE_RTPR_SET_DELAY_RANGE
 };
 
 /** @This returns the management structure for rtpr pipes.
@@ -68,7 +70,7 @@ static inline int upipe_rtpr_get_delay(struct upipe *upipe, uint64_t *delay_p)
                          UPIPE_RTPR_SIGNATURE, delay_p);
 }
 
-/** @This sets the delay to set into urefs.
+/** @This sets the delay to set into urefs, and disables the adaptive mode.
  *
  * @param upipe description structure of the pipe
  * @param delay delay to set
@@ -80,6 +82,23 @@ static inline int upipe_rtpr_set_delay(struct upipe *upipe, uint64_t delay)
                          UPIPE_RTPR_SIGNATURE, delay);
 }
 
+/** @This enables the adaptive mode if delay_min is lower than delay_max.
+ * The delay then follows the lateness of the reordered packets, within
+ * the given bounds, and may be read with @ref upipe_rtpr_get_delay.
+ *
+ * @param upipe description structure of the pipe
+ * @param delay_min minimum delay
+ * @param delay_max maximum delay
+ * @return an error code
+ */
+static inline int upipe_rtpr_set_delay_range(struct upipe *upipe,
+                                             uint64_t delay_min,
+                                             uint64_t delay_max)
+{
+    return upipe_control(upipe, UPIPE_RTPR_SET_DELAY_RANGE,
+                         UPIPE_RTPR_SIGNATURE, delay_min, delay_max);
+}
+
 #ifdef __cplusplus
 }
 #endif
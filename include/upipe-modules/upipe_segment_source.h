@@ -31,6 +31,46 @@ extern "C" {
 
 #define UPIPE_SEG_SRC_SIGNATURE UBASE_FOURCC('s','e','g','s')
 
+/** @This extends @ref upipe_command with specific segment source commands. */
+enum upipe_seg_src_command {
+    UPIPE_SEG_SRC_SENTINEL = UPIPE_CONTROL_LOCAL,
+
+    /** open an uri in advance (const char *, uint64_t) */
+    UPIPE_SEG_SRC_PREFETCH,
+};
+
+/** @This converts an enum upipe_seg_src_command to a string.
+ *
+ * @param cmd command to convert
+ * @return a string or NULL if invalid
+ */
+static inline const char *upipe_seg_src_command_str(int cmd)
+{
+    switch ((enum upipe_seg_src_command)cmd) {
+    UBASE_CASE_TO_STR(UPIPE_SEG_SRC_PREFETCH);
+    case UPIPE_SEG_SRC_SENTINEL: break;
+    }
+    return NULL;
+}
+
+/** @This opens the next segment while the current one is playing, and reads
+ * at most the given size from it. The segment is started without delay when
+ * @ref upipe_set_uri is called with the same uri, and the prefetch is
+ * discarded if it is called with another one. The prefetched segment is read
+ * from its start, so its range must not be changed afterwards.
+ *
+ * @param upipe description structure of the pipe
+ * @param uri uri of the next segment, or NULL to cancel
+ * @param size size to read in advance in octets
+ * @return an error code
+ */
+static inline int upipe_seg_src_prefetch(struct upipe *upipe,
+                                         const char *uri, uint64_t size)
+{
+    return upipe_control(upipe, UPIPE_SEG_SRC_PREFETCH,
+                         UPIPE_SEG_SRC_SIGNATURE, uri, size);
+}
+
 enum upipe_seg_src_mgr_command {
     UPIPE_SEG_SRC_MGR_SENTINEL = UPIPE_MGR_CONTROL_LOCAL,
 
@@ -35,6 +35,16 @@ struct upipe_mgr *upipe_seq_src_mgr_alloc(void);
 int upipe_seq_src_mgr_set_source_mgr(struct upipe_mgr *mgr,
                                      struct upipe_mgr *source_mgr);
 
+/** @This sets the size read in advance from the next item, while the
+ * current one is playing, so that the next source is already opened when
+ * the current one ends.
+ *
+ * @param mgr pointer to manager
+ * @param size size in octets, or 0 to disable
+ * @return an error code
+ */
+int upipe_seq_src_mgr_set_prefetch(struct upipe_mgr *mgr, uint64_t size);
+
 #ifdef __cplusplus
 }
 #endif
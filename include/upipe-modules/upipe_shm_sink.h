@@ -0,0 +1,148 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short Upipe sink module for shared memory segments
+ *
+ * The sink creates a segment named after the uri (for instance "/channel1"),
+ * and passes the urefs to an shm source attached to the same segment,
+ * possibly in another process. Blocks allocated with the ubuf manager
+ * provided by the sink are passed by reference; other blocks are copied to
+ * a free slot of the segment.
+ */
+
+#ifndef _UPIPE_MODULES_UPIPE_SHM_SINK_H_
+/** @hidden */
+#define _UPIPE_MODULES_UPIPE_SHM_SINK_H_
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <upipe/upipe.h>
+
+#define UPIPE_SHMSINK_SIGNATURE UBASE_FOURCC('s','h','m','k')
+
+/** @This extends upipe_command with specific commands for shm sink. */
+enum upipe_shmsink_command {
+    UPIPE_SHMSINK_SENTINEL = UPIPE_CONTROL_LOCAL,
+
+    /** returns the geometry of the segment (unsigned int *,
+     * unsigned int *) */
+    UPIPE_SHMSINK_GET_SLOTS,
+    /** sets the geometry of the segment (unsigned int, unsigned int) */
+    UPIPE_SHMSINK_SET_SLOTS,
+    /** returns the period of the checks of the source (uint64_t *) */
+    UPIPE_SHMSINK_GET_PERIOD,
+    /** sets the period of the checks of the source (uint64_t) */
+    UPIPE_SHMSINK_SET_PERIOD,
+};
+
+/** @This converts an enum upipe_shmsink_command to a string.
+ *
+ * @param cmd command to convert
+ * @return a string or NULL if invalid
+ */
+static inline const char *upipe_shmsink_command_str(int cmd)
+{
+    switch ((enum upipe_shmsink_command)cmd) {
+    UBASE_CASE_TO_STR(UPIPE_SHMSINK_GET_SLOTS);
+    UBASE_CASE_TO_STR(UPIPE_SHMSINK_SET_SLOTS);
+    UBASE_CASE_TO_STR(UPIPE_SHMSINK_GET_PERIOD);
+    UBASE_CASE_TO_STR(UPIPE_SHMSINK_SET_PERIOD);
+    case UPIPE_SHMSINK_SENTINEL: break;
+    }
+    return NULL;
+}
+
+/** @This returns the geometry of the segment.
+ *
+ * @param upipe description structure of the pipe
+ * @param nb_slots_p filled in with the number of slots
+ * @param slot_size_p filled in with the size of a slot
+ * @return an error code
+ */
+static inline int upipe_shmsink_get_slots(struct upipe *upipe,
+                                          unsigned int *nb_slots_p,
+                                          unsigned int *slot_size_p)
+{
+    return upipe_control(upipe, UPIPE_SHMSINK_GET_SLOTS,
+                         UPIPE_SHMSINK_SIGNATURE, nb_slots_p, slot_size_p);
+}
+
+/** @This sets the geometry of the segment created by the next call to
+ * @ref upipe_set_uri. The slots hold the payloads of the urefs in flight;
+ * larger blocks are dropped.
+ *
+ * @param upipe description structure of the pipe
+ * @param nb_slots number of slots (default 64)
+ * @param slot_size size of a slot (default 256 KiB)
+ * @return an error code
+ */
+static inline int upipe_shmsink_set_slots(struct upipe *upipe,
+                                          unsigned int nb_slots,
+                                          unsigned int slot_size)
+{
+    return upipe_control(upipe, UPIPE_SHMSINK_SET_SLOTS,
+                         UPIPE_SHMSINK_SIGNATURE, nb_slots, slot_size);
+}
+
+/** @This returns the period of the checks of the source.
+ *
+ * @param upipe description structure of the pipe
+ * @param period_p filled in with the period in 27 MHz ticks
+ * @return an error code
+ */
+static inline int upipe_shmsink_get_period(struct upipe *upipe,
+                                           uint64_t *period_p)
+{
+    return upipe_control(upipe, UPIPE_SHMSINK_GET_PERIOD,
+                         UPIPE_SHMSINK_SIGNATURE, period_p);
+}
+
+/** @This sets the period at which the sink checks whether the source has
+ * crashed, to reclaim its buffers, and retries the urefs held while the
+ * segment is full.
+ *
+ * @param upipe description structure of the pipe
+ * @param period period in 27 MHz ticks (default 1 ms)
+ * @return an error code
+ */
+static inline int upipe_shmsink_set_period(struct upipe *upipe,
+                                           uint64_t period)
+{
+    return upipe_control(upipe, UPIPE_SHMSINK_SET_PERIOD,
+                         UPIPE_SHMSINK_SIGNATURE, period);
+}
+
+/** @This returns the management structure for shm sink pipes.
+ *
+ * @return pointer to manager
+ */
+struct upipe_mgr *upipe_shmsink_mgr_alloc(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short Upipe source module for shared memory segments
+ *
+ * The source attaches to the segment created by an shm sink, named after
+ * the uri, and outputs the urefs it passes. The payloads are not copied:
+ * the ubufs point to the slots of the segment, which are given back to the
+ * sink when they are released.
+ */
+
+#ifndef _UPIPE_MODULES_UPIPE_SHM_SOURCE_H_
+/** @hidden */
+#define _UPIPE_MODULES_UPIPE_SHM_SOURCE_H_
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <upipe/upipe.h>
+
+#define UPIPE_SHMSRC_SIGNATURE UBASE_FOURCC('s','h','m','s')
+
+/** @This extends upipe_command with specific commands for shm source. */
+enum upipe_shmsrc_command {
+    UPIPE_SHMSRC_SENTINEL = UPIPE_CONTROL_LOCAL,
+
+    /** returns the polling period (uint64_t *) */
+    UPIPE_SHMSRC_GET_PERIOD,
+    /** sets the polling period (uint64_t) */
+    UPIPE_SHMSRC_SET_PERIOD,
+};
+
+/** @This converts an enum upipe_shmsrc_command to a string.
+ *
+ * @param cmd command to convert
+ * @return a string or NULL if invalid
+ */
+static inline const char *upipe_shmsrc_command_str(int cmd)
+{
+    switch ((enum upipe_shmsrc_command)cmd) {
+    UBASE_CASE_TO_STR(UPIPE_SHMSRC_GET_PERIOD);
+    UBASE_CASE_TO_STR(UPIPE_SHMSRC_SET_PERIOD);
+    case UPIPE_SHMSRC_SENTINEL: break;
+    }
+    return NULL;
+}
+
+/** @This returns the polling period.
+ *
+ * @param upipe description structure of the pipe
+ * @param period_p filled in with the period in 27 MHz ticks
+ * @return an error code
+ */
+static inline int upipe_shmsrc_get_period(struct upipe *upipe,
+                                          uint64_t *period_p)
+{
+    return upipe_control(upipe, UPIPE_SHMSRC_GET_PERIOD,
+                         UPIPE_SHMSRC_SIGNATURE, period_p);
+}
+
+/** @This sets the period at which the ring of the segment is polled. All
+ * the urefs passed in the meantime are output at once.
+ *
+ * @param upipe description structure of the pipe
+ * @param period period in 27 MHz ticks (default 1 ms)
+ * @return an error code
+ */
+static inline int upipe_shmsrc_set_period(struct upipe *upipe,
+                                          uint64_t period)
+{
+    return upipe_control(upipe, UPIPE_SHMSRC_SET_PERIOD,
+                         UPIPE_SHMSRC_SIGNATURE, period);
+}
+
+/** @This returns the management structure for shm source pipes.
+ *
+ * @return pointer to manager
+ */
+struct upipe_mgr *upipe_shmsrc_mgr_alloc(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -62,6 +62,61 @@ static inline const char *uprobe_stream_switcher_sub_event_str(int event)
     return NULL;
 }
 
+/** @This extends upipe_command with specific commands for stream switcher.
+ */
+enum upipe_stream_switcher_command {
+    UPIPE_STREAM_SWITCHER_SENTINEL = UPIPE_CONTROL_LOCAL,
+
+    /** sets the maximum pre-buffer duration (uint64_t) */
+    UPIPE_STREAM_SWITCHER_SET_PREBUFFER,
+    /** gets the maximum pre-buffer duration (uint64_t *) */
+    UPIPE_STREAM_SWITCHER_GET_PREBUFFER,
+};
+
+/** @This converts @ref upipe_stream_switcher_command to a string.
+ *
+ * @param command command to convert
+ * @return a string or NULL if invalid
+ */
+static inline const char *upipe_stream_switcher_command_str(int command)
+{
+    switch ((enum upipe_stream_switcher_command)command) {
+    UBASE_CASE_TO_STR(UPIPE_STREAM_SWITCHER_SET_PREBUFFER);
+    UBASE_CASE_TO_STR(UPIPE_STREAM_SWITCHER_GET_PREBUFFER);
+    case UPIPE_STREAM_SWITCHER_SENTINEL: break;
+    }
+    return NULL;
+}
+
+/** @This sets the maximum pre-buffer duration. When it is not 0, a new
+ * input may start from a key frame older than the output by up to this
+ * duration, instead of waiting for the next key frame. The timestamps
+ * of the new input are then shifted to follow the output.
+ *
+ * @param upipe description structure of the pipe
+ * @param duration maximum pre-buffer duration in 27 MHz ticks, or 0
+ * @return an error code
+ */
+static inline int upipe_stream_switcher_set_prebuffer(struct upipe *upipe,
+                                                      uint64_t duration)
+{
+    return upipe_control(upipe, UPIPE_STREAM_SWITCHER_SET_PREBUFFER,
+                         UPIPE_STREAM_SWITCHER_SIGNATURE, duration);
+}
+
+/** @This gets the maximum pre-buffer duration.
+ *
+ * @param upipe description structure of the pipe
+ * @param duration_p filled in with the maximum pre-buffer duration
+ * @return an error code
+ */
+static inline int upipe_stream_switcher_get_prebuffer(struct upipe *upipe,
+                                                      uint64_t *duration_p)
+{
+    return upipe_control(upipe, UPIPE_STREAM_SWITCHER_GET_PREBUFFER,
+                         UPIPE_STREAM_SWITCHER_SIGNATURE, duration_p);
+}
+
 /** @This returns the management structure for all stream switchers.
  *
  * @return pointer to manager
@@ -81,7 +81,11 @@ enum upipe_xfer_mgr_command {
     /** freeze the remote event loop (void) */
     UPIPE_XFER_MGR_FREEZE,
     /** thaw the remote event loop (void) */
-    UPIPE_XFER_MGR_THAW
+    UPIPE_XFER_MGR_THAW,
+    /** start a batch of messages (void) */
+    UPIPE_XFER_MGR_BATCH_BEGIN,
+    /** end a batch of messages and push them (void) */
+    UPIPE_XFER_MGR_BATCH_END
 };
 
 /** @This returns a management structure for xfer pipes. You would need one
@@ -89,8 +93,12 @@ enum upipe_xfer_mgr_command {
  * structure can be allocated in any thread, but must be attached in the
  * same thread as the one running the upump manager.
  *
+ * The messages are all preallocated: enough to fill the queue to the remote
+ * event loop and a batch, plus msg_pool_depth for the events sent back by
+ * the remote pipes.
+ *
  * @param queue_length maximum length of the internal queues
- * @param msg_pool_depth maximum number of messages in the pool
+ * @param msg_pool_depth number of messages preallocated for events
  * @param mutex mutual exclusion primitives to access the event loop, or NULL
  * @return pointer to manager
  */
@@ -145,6 +153,34 @@ static inline int upipe_xfer_mgr_thaw(struct upipe_mgr *mgr)
     return upipe_mgr_control(mgr, UPIPE_XFER_MGR_THAW, UPIPE_XFER_SIGNATURE);
 }
 
+/** @This starts a batch of messages. The commands sent to the remote pipes
+ * (attach upump manager, set URI, set output, release) until the end of the
+ * batch are pushed at once, with a single wake-up of the remote event loop.
+ * Batches may be nested, and must be started and ended in the thread
+ * sending the commands.
+ *
+ * @param mgr xfer_mgr structure
+ * @return an error code
+ */
+static inline int upipe_xfer_mgr_batch_begin(struct upipe_mgr *mgr)
+{
+    return upipe_mgr_control(mgr, UPIPE_XFER_MGR_BATCH_BEGIN,
+                             UPIPE_XFER_SIGNATURE);
+}
+
+/** @This ends a batch of messages previously started by @ref
+ * upipe_xfer_mgr_batch_begin, and pushes the pending messages if it is the
+ * outermost batch.
+ *
+ * @param mgr xfer_mgr structure
+ * @return an error code
+ */
+static inline int upipe_xfer_mgr_batch_end(struct upipe_mgr *mgr)
+{
+    return upipe_mgr_control(mgr, UPIPE_XFER_MGR_BATCH_END,
+                             UPIPE_XFER_SIGNATURE);
+}
+
 /** @hidden */
 #define ARGS_DECL , struct upipe *upipe_remote
 /** @hidden */
@@ -36,9 +36,20 @@ extern "C" {
 
 #include <upipe/upipe.h>
 
+#include <stdbool.h>
+
 #define UPIPE_TRICKP_SIGNATURE UBASE_FOURCC('t','r','c','k')
 #define UPIPE_TRICKP_SUB_SIGNATURE UBASE_FOURCC('t','r','c','s')
 
+/** @This extends uprobe_event with specific events for trickp pipes. */
+enum uprobe_trickp_event {
+    UPROBE_TRICKP_SENTINEL = UPROBE_LOCAL,
+
+    /** the source should be seeked to the given position, with
+     * @ref upipe_src_set_position, in index-driven mode (uint64_t) */
+    UPROBE_TRICKP_SEEK
+};
+
 /** @This extends upipe_command with specific commands for trickp pipes. */
 enum upipe_trickp_command {
     UPIPE_TRICKP_SENTINEL = UPIPE_CONTROL_LOCAL,
@@ -46,7 +57,11 @@ enum upipe_trickp_command {
     /** returns the current playing rate (struct urational *) */
     UPIPE_TRICKP_GET_RATE,
     /** sets the playing rate (struct urational) */
-    UPIPE_TRICKP_SET_RATE
+    UPIPE_TRICKP_SET_RATE,
+    /** enables or disables the index-driven mode (int, int) */
+    UPIPE_TRICKP_SET_INDEX_MODE,
+    /** adds a random access point to the index (uint64_t, uint64_t) */
+    UPIPE_TRICKP_ADD_INDEX
 };
 
 /** @This returns the management structure for all trickp pipes.
@@ -68,7 +83,8 @@ static inline int upipe_trickp_get_rate(struct upipe *upipe,
                          UPIPE_TRICKP_SIGNATURE, rate_p);
 }
 
-/** @This sets the playing rate.
+/** @This sets the playing rate. Negative rates (rewind) are only allowed
+ * in index-driven mode, see @ref upipe_trickp_set_index_mode.
  *
  * @param upipe description structure of the pipe
  * @param rate new rate (1/1 = normal play, 0 = pause)
@@ -81,6 +97,46 @@ static inline int upipe_trickp_set_rate(struct upipe *upipe,
                          UPIPE_TRICKP_SIGNATURE, rate);
 }
 
+/** @This enables or disables the index-driven mode, for file and multicat
+ * sources. When it is enabled and the absolute value of the rate is 2 or
+ * more, only the random access pictures are output, and sound and
+ * subpictures are dropped. After each picture, @ref UPROBE_TRICKP_SEEK is
+ * thrown with the position of the indexed picture which should be displayed
+ * next, and the probe is expected to seek the source there, instead of
+ * reading and discarding the pictures in between. The index is filled with
+ * @ref upipe_trickp_add_index, or learnt from the pictures flowing through
+ * the pipe: the RAP system date of the random access pictures is then used
+ * as the position, which is what multicat sources expect.
+ *
+ * @param upipe description structure of the pipe
+ * @param enabled true to enable the index-driven mode
+ * @param learn true to learn the index from the random access pictures
+ * @return an error code
+ */
+static inline int upipe_trickp_set_index_mode(struct upipe *upipe,
+                                              bool enabled, bool learn)
+{
+    return upipe_control(upipe, UPIPE_TRICKP_SET_INDEX_MODE,
+                         UPIPE_TRICKP_SIGNATURE, enabled ? 1 : 0,
+                         learn ? 1 : 0);
+}
+
+/** @This adds a random access point to the index used in index-driven
+ * mode, for instance from an index file built by the framers.
+ *
+ * @param upipe description structure of the pipe
+ * @param date program date of the random access picture
+ * @param position position to pass to @ref upipe_src_set_position to read
+ * from this picture
+ * @return an error code
+ */
+static inline int upipe_trickp_add_index(struct upipe *upipe,
+                                         uint64_t date, uint64_t position)
+{
+    return upipe_control(upipe, UPIPE_TRICKP_ADD_INDEX,
+                         UPIPE_TRICKP_SIGNATURE, date, position);
+}
+
 #ifdef __cplusplus
 }
 #endif
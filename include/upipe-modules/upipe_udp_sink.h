@@ -51,8 +51,21 @@ enum upipe_udpsink_command {
     UPIPE_UDPSINK_SET_FD,
     /** set remote address (const struct sockaddr *, socklen_t) **/
     UPIPE_UDPSINK_SET_PEER,
+    /** get the maximum number of datagrams sent per system call, and the
+     * pacing window (unsigned int *, uint64_t *) **/
+    UPIPE_UDPSINK_GET_BATCH,
+    /** set the maximum number of datagrams sent per system call, and the
+     * pacing window (unsigned int, uint64_t) **/
+    UPIPE_UDPSINK_SET_BATCH,
+    /** get the advance of datagrams sent with SO_TXTIME (uint64_t *) **/
+    UPIPE_UDPSINK_GET_TXTIME,
+    /** set the advance of datagrams sent with SO_TXTIME (uint64_t) **/
+    UPIPE_UDPSINK_SET_TXTIME,
 };
 
+/** maximum number of datagrams sent per system call */
+#define UPIPE_UDPSINK_BATCH_MAX 64
+
 /** @This returns the management structure for all udp sinks.
  *
  * @return pointer to manager
@@ -96,6 +109,73 @@ static inline int upipe_udpsink_set_peer(struct upipe *upipe,
     return upipe_control(upipe, UPIPE_UDPSINK_SET_PEER, UPIPE_UDPSINK_SIGNATURE,
             addr, addrlen);
 }
+
+/** @This returns the maximum number of datagrams sent per system call, and
+ * the pacing window.
+ *
+ * @param upipe description structure of the pipe
+ * @param batch_p filled in with the maximum number of datagrams
+ * @param window_p filled in with the pacing window, in 27 MHz ticks
+ * @return an error code
+ */
+static inline int upipe_udpsink_get_batch(struct upipe *upipe,
+                                          unsigned int *batch_p,
+                                          uint64_t *window_p)
+{
+    return upipe_control(upipe, UPIPE_UDPSINK_GET_BATCH,
+                         UPIPE_UDPSINK_SIGNATURE, batch_p, window_p);
+}
+
+/** @This sets the maximum number of datagrams sent per system call (default
+ * 1), and the pacing window. With more than one, the datagrams due less than
+ * the pacing window after the first one of a batch are sent together with
+ * sendmmsg(), or as a single UDP segmentation offload write if they have the
+ * same size. An incomplete batch is sent at the end of the window.
+ *
+ * @param upipe description structure of the pipe
+ * @param batch maximum number of datagrams, up to
+ * @ref UPIPE_UDPSINK_BATCH_MAX
+ * @param window pacing window, in 27 MHz ticks
+ * @return an error code
+ */
+static inline int upipe_udpsink_set_batch(struct upipe *upipe,
+                                          unsigned int batch, uint64_t window)
+{
+    return upipe_control(upipe, UPIPE_UDPSINK_SET_BATCH,
+                         UPIPE_UDPSINK_SIGNATURE, batch, window);
+}
+
+/** @This returns the advance of the datagrams sent with their transmission
+ * time.
+ *
+ * @param upipe description structure of the pipe
+ * @param lead_p filled in with the advance in 27 MHz ticks, or 0
+ * @return an error code
+ */
+static inline int upipe_udpsink_get_txtime(struct upipe *upipe,
+                                           uint64_t *lead_p)
+{
+    return upipe_control(upipe, UPIPE_UDPSINK_GET_TXTIME,
+                         UPIPE_UDPSINK_SIGNATURE, lead_p);
+}
+
+/** @This hands the datagrams to the kernel up to lead ticks before their
+ * date, with the date converted to CLOCK_TAI as SCM_TXTIME, instead of
+ * waking up with a timer at the date. The socket is set up with SO_TXTIME,
+ * and the actual pacing is done by the ETF qdisc or by the NIC, which must
+ * be configured on the outgoing interface and priority. This requires a
+ * uclock, and CAP_NET_ADMIN for the socket option.
+ *
+ * @param upipe description structure of the pipe
+ * @param lead advance in 27 MHz ticks, or 0 to pace with timers (default)
+ * @return an error code
+ */
+static inline int upipe_udpsink_set_txtime(struct upipe *upipe, uint64_t lead)
+{
+    return upipe_control(upipe, UPIPE_UDPSINK_SET_TXTIME,
+                         UPIPE_UDPSINK_SIGNATURE, lead);
+}
+
 #ifdef __cplusplus
 }
 #endif
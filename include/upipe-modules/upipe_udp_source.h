@@ -47,8 +47,48 @@ enum upipe_udpsrc_command {
     UPIPE_UDPSRC_GET_FD,
     /** set socket fd (int) **/
     UPIPE_UDPSRC_SET_FD,
+    /** get the number of datagrams received per system call
+     * (unsigned int *) **/
+    UPIPE_UDPSRC_GET_BATCH,
+    /** set the number of datagrams received per system call
+     * (unsigned int) **/
+    UPIPE_UDPSRC_SET_BATCH,
+    /** get the source of the reception dates (int *) **/
+    UPIPE_UDPSRC_GET_TIMESTAMP,
+    /** set the source of the reception dates (int) **/
+    UPIPE_UDPSRC_SET_TIMESTAMP,
+    /** get the steering policy of the SO_REUSEPORT group
+     * (int *, unsigned int *) **/
+    UPIPE_UDPSRC_GET_STEERING,
+    /** set the steering policy of the SO_REUSEPORT group
+     * (int, unsigned int) **/
+    UPIPE_UDPSRC_SET_STEERING,
 };
 
+/** @This defines the sources of the reception dates of datagrams. */
+enum upipe_udpsrc_timestamp {
+    /** date of the return of the system call */
+    UPIPE_UDPSRC_TIMESTAMP_NONE,
+    /** software timestamp of the kernel (default) */
+    UPIPE_UDPSRC_TIMESTAMP_SOFTWARE,
+    /** hardware timestamp of the network interface */
+    UPIPE_UDPSRC_TIMESTAMP_HARDWARE,
+};
+
+/** @This defines the policies distributing the datagrams among the sockets
+ * of a SO_REUSEPORT group. */
+enum upipe_udpsrc_steering {
+    /** hash of the addresses and ports, computed by the kernel (default) */
+    UPIPE_UDPSRC_STEERING_NONE,
+    /** source address of the datagram */
+    UPIPE_UDPSRC_STEERING_SOURCE,
+    /** RTP synchronization source identifier (SSRC) of the datagram */
+    UPIPE_UDPSRC_STEERING_SSRC,
+};
+
+/** maximum number of datagrams received per system call */
+#define UPIPE_UDPSRC_BATCH_MAX 64
+
 /** @This extends uprobe_throw with specific events . */
 enum uprobe_udpsrc_event {
     UPROBE_UDPSRC_SENTINEL = UPROBE_LOCAL,
@@ -81,6 +121,102 @@ static inline int upipe_udpsrc_set_fd(struct upipe *upipe, int fd)
                          fd);
 }
 
+/** @This returns the number of datagrams received per system call.
+ *
+ * @param upipe description structure of the pipe
+ * @param batch_p filled in with the number of datagrams
+ * @return an error code
+ */
+static inline int upipe_udpsrc_get_batch(struct upipe *upipe,
+                                         unsigned int *batch_p)
+{
+    return upipe_control(upipe, UPIPE_UDPSRC_GET_BATCH,
+                         UPIPE_UDPSRC_SIGNATURE, batch_p);
+}
+
+/** @This sets the number of datagrams received per system call (default 1).
+ * With more than one, the buffers are allocated in advance and filled with a
+ * single recvmmsg() call.
+ *
+ * @param upipe description structure of the pipe
+ * @param batch number of datagrams, up to @ref UPIPE_UDPSRC_BATCH_MAX
+ * @return an error code
+ */
+static inline int upipe_udpsrc_set_batch(struct upipe *upipe,
+                                         unsigned int batch)
+{
+    return upipe_control(upipe, UPIPE_UDPSRC_SET_BATCH,
+                         UPIPE_UDPSRC_SIGNATURE, batch);
+}
+
+/** @This returns the source of the reception dates of datagrams.
+ *
+ * @param upipe description structure of the pipe
+ * @param timestamp_p filled in with a value of
+ * @ref upipe_udpsrc_timestamp
+ * @return an error code
+ */
+static inline int upipe_udpsrc_get_timestamp(struct upipe *upipe,
+                                             int *timestamp_p)
+{
+    return upipe_control(upipe, UPIPE_UDPSRC_GET_TIMESTAMP,
+                         UPIPE_UDPSRC_SIGNATURE, timestamp_p);
+}
+
+/** @This sets the source of the reception dates of datagrams, in live mode.
+ * Timestamps of the kernel are not affected by the scheduling latency of
+ * the pipe. Hardware timestamps require the network interface to be
+ * configured for receive timestamping (SIOCSHWTSTAMP) and its clock to be
+ * synchronized with the real-time clock; otherwise the software timestamp
+ * or the date of the system call is used.
+ *
+ * @param upipe description structure of the pipe
+ * @param timestamp value of @ref upipe_udpsrc_timestamp
+ * @return an error code
+ */
+static inline int upipe_udpsrc_set_timestamp(struct upipe *upipe,
+                                             int timestamp)
+{
+    return upipe_control(upipe, UPIPE_UDPSRC_SET_TIMESTAMP,
+                         UPIPE_UDPSRC_SIGNATURE, timestamp);
+}
+
+/** @This returns the steering policy of the SO_REUSEPORT group.
+ *
+ * @param upipe description structure of the pipe
+ * @param steering_p filled in with a value of @ref upipe_udpsrc_steering
+ * @param nb_sockets_p filled in with the number of sockets in the group
+ * @return an error code
+ */
+static inline int upipe_udpsrc_get_steering(struct upipe *upipe,
+                                            int *steering_p,
+                                            unsigned int *nb_sockets_p)
+{
+    return upipe_control(upipe, UPIPE_UDPSRC_GET_STEERING,
+                         UPIPE_UDPSRC_SIGNATURE, steering_p, nb_sockets_p);
+}
+
+/** @This sets the steering policy of the SO_REUSEPORT group. Several udp
+ * sources, typically running in different threads, may receive from the
+ * same address and port if their uris have the /reuseport option. The
+ * steering program is attached to the whole group, so all the sources of a
+ * group must use the same policy and number of sockets; the n-th source to
+ * open its socket receives the datagrams whose value modulo the number of
+ * sockets is n.
+ *
+ * @param upipe description structure of the pipe
+ * @param steering value of @ref upipe_udpsrc_steering
+ * @param nb_sockets number of sockets in the group
+ * @return an error code
+ */
+static inline int upipe_udpsrc_set_steering(struct upipe *upipe,
+                                            int steering,
+                                            unsigned int nb_sockets)
+{
+    return upipe_control(upipe, UPIPE_UDPSRC_SET_STEERING,
+                         UPIPE_UDPSRC_SIGNATURE, steering, nb_sockets);
+}
+
 /** @This returns the management structure for all udp socket sources.
  *
  * @return pointer to manager
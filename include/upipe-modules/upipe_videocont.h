@@ -40,6 +40,18 @@ extern "C" {
 #define UPIPE_VIDEOCONT_SIGNATURE UBASE_FOURCC('v','i','d','c')
 #define UPIPE_VIDEOCONT_SUB_SIGNATURE UBASE_FOURCC('v','i','d','i')
 
+/** @This is the set of counters of a videocont pipe. */
+struct upipe_videocont_stats {
+    /** number of output pictures */
+    uint64_t output;
+    /** number of output pictures repeating the previous one */
+    uint64_t repeated;
+    /** number of input pictures discarded without being output */
+    uint64_t dropped;
+    /** number of output pictures without an attached input picture */
+    uint64_t blank;
+};
+
 /** @This extends upipe_command with specific commands for upipe_videocont
  * pipes. */
 enum upipe_videocont_command {
@@ -59,6 +71,8 @@ enum upipe_videocont_command {
     UPIPE_VIDEOCONT_GET_LATENCY,
     /** sets the pts latency (uint64_t) */
     UPIPE_VIDEOCONT_SET_LATENCY,
+    /** returns the counters (struct upipe_videocont_stats *) */
+    UPIPE_VIDEOCONT_GET_STATS,
 };
 
 /** @This extends upipe_command with specific commands for upipe_videocont
@@ -161,6 +175,19 @@ static inline int upipe_videocont_set_latency(struct upipe *upipe,
                          UPIPE_VIDEOCONT_SIGNATURE, latency);
 }
 
+/** @This returns the counters of a videocont pipe, since its allocation.
+ *
+ * @param upipe description structure of the pipe
+ * @param stats filled in with the counters
+ * @return an error code
+ */
+static inline int upipe_videocont_get_stats(struct upipe *upipe,
+        struct upipe_videocont_stats *stats)
+{
+    return upipe_control(upipe, UPIPE_VIDEOCONT_GET_STATS,
+                         UPIPE_VIDEOCONT_SIGNATURE, stats);
+}
+
 /** @This sets a videocont subpipe as its grandpipe input.
  *
  * @param upipe description structure of the (sub)pipe
@@ -66,6 +66,19 @@ extern "C" {
  */
 struct upipe_mgr *upipe_work_mgr_alloc(struct upipe_mgr *xfer_mgr);
 
+/** @This returns the management structure for worker pipes multiplexed
+ * onto a pool of remote threads. Each new worker pipe runs its remote
+ * subpipeline in the thread of the pool which currently has the fewest live
+ * worker pipes, so that the number of threads depends on the number of
+ * cores rather than on the number of worker pipes.
+ *
+ * @param xfer_mgrs array of managers to transfer pipes to the remote threads
+ * @param nb_xfer_mgrs number of managers in the array
+ * @return pointer to manager
+ */
+struct upipe_mgr *upipe_work_pool_mgr_alloc(struct upipe_mgr **xfer_mgrs,
+                                            unsigned int nb_xfer_mgrs);
+
 /** @This extends upipe_mgr_command with specific commands for worker. */
 enum upipe_work_mgr_command {
     UPIPE_WORK_MGR_SENTINEL = UPIPE_MGR_CONTROL_LOCAL,
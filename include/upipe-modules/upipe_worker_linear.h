@@ -71,6 +71,20 @@ upipe_wlin_mgr_alloc(struct upipe_mgr *xfer_mgr)
     return upipe_work_mgr_alloc(xfer_mgr);
 }
 
+/** @This returns the management structure for wlin pipes multiplexed onto
+ * a pool of remote threads.
+ *
+ * @param xfer_mgrs array of managers to transfer pipes to the remote threads
+ * @param nb_xfer_mgrs number of managers in the array
+ * @return pointer to manager
+ */
+static inline struct upipe_mgr *
+upipe_wlin_pool_mgr_alloc(struct upipe_mgr **xfer_mgrs,
+                          unsigned int nb_xfer_mgrs)
+{
+    return upipe_work_pool_mgr_alloc(xfer_mgrs, nb_xfer_mgrs);
+}
+
 /** @hidden */
 #define UPIPE_WLIN_MGR_GET_SET_MGR(name)                                    \
 /** @This returns the current manager for name inner pipes.                 \
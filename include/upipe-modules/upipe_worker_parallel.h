@@ -0,0 +1,198 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/** @file
+ * @short Bin pipe running copies of a stateless pipe in parallel
+ *
+ * The bin allocates a number of lanes, each running its own copy of an inner
+ * pipe, possibly in a worker thread (see @ref upipe_wpar_mgr_add_worker).
+ * Incoming urefs are tagged with a sequence number and dispatched to the
+ * lanes, either in a round-robin fashion or to the least loaded lane, and
+ * the outputs of the lanes are put back in order before being forwarded.
+ *
+ * This is only suitable for pipes that process each uref independently
+ * (conversions, ciphers, fixed scalers), and output one uref for each input.
+ * If an inner pipe drops a uref, the merge gives up waiting for it once the
+ * configured reorder depth is reached.
+ *
+ * The allocator takes the following arguments:
+ * @table 2
+ * @item inner_mgr @item manager of the inner pipes
+ * @item uprobe_remote @item probe hierarchy used by the inner pipes
+ * (belongs to the callee)
+ * @item inner_flow_def @item flow definition given to @ref upipe_flow_alloc
+ * to allocate the inner pipes, or NULL to use @ref upipe_void_alloc
+ * @item nb_lanes @item number of copies of the inner pipe
+ * @item input_queue_length @item number of urefs in the queue to each worker
+ * @item output_queue_length @item number of urefs in the queue from each
+ * worker
+ * @end table
+ *
+ * Control commands which are not handled by the bin are forwarded to all
+ * inner pipes. With workers, this requires the transfer managers to have
+ * been allocated with a mutex (see @ref upipe_bin_freeze).
+ */
+
+#ifndef _UPIPE_MODULES_UPIPE_WORKER_PARALLEL_H_
+/** @hidden */
+#define _UPIPE_MODULES_UPIPE_WORKER_PARALLEL_H_
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <upipe/upipe.h>
+
+#define UPIPE_WPAR_SIGNATURE UBASE_FOURCC('w','p','a','r')
+#define UPIPE_WPAR_LANE_SIGNATURE UBASE_FOURCC('w','p','a','l')
+
+/** maximum number of worker managers */
+#define UPIPE_WPAR_MAX_WORKERS 16
+
+/** @This returns the management structure for all wpar pipes.
+ *
+ * @return pointer to manager
+ */
+struct upipe_mgr *upipe_wpar_mgr_alloc(void);
+
+/** @This extends upipe_mgr_command with specific commands for wpar. */
+enum upipe_wpar_mgr_command {
+    UPIPE_WPAR_MGR_SENTINEL = UPIPE_MGR_CONTROL_LOCAL,
+
+    /** adds a worker manager for the lanes (struct upipe_mgr *) */
+    UPIPE_WPAR_MGR_ADD_WORKER
+};
+
+/** @This adds a worker manager (see @ref upipe_wlin_mgr_alloc) to the pool
+ * used to run the lanes. Lanes are assigned to the workers in a round-robin
+ * fashion, so there should usually be one worker per lane; without any
+ * worker, the lanes run in the thread of the bin. The remote probe given to
+ * the pipes must then be usable from the worker threads, and provide a upump
+ * manager there (see @ref uprobe_pthread_upump_mgr_alloc). This may only be
+ * called before any pipe has been allocated.
+ *
+ * @param mgr pointer to manager
+ * @param wlin_mgr pointer to worker linear manager
+ * @return an error code
+ */
+static inline int upipe_wpar_mgr_add_worker(struct upipe_mgr *mgr,
+                                            struct upipe_mgr *wlin_mgr)
+{
+    return upipe_mgr_control(mgr, UPIPE_WPAR_MGR_ADD_WORKER,
+                             UPIPE_WPAR_SIGNATURE, wlin_mgr);
+}
+
+/** @This defines the policies to dispatch urefs to the lanes. */
+enum upipe_wpar_dispatch {
+    /** each lane in turn */
+    UPIPE_WPAR_DISPATCH_ROUND_ROBIN,
+    /** lane with the fewest urefs in flight (default) */
+    UPIPE_WPAR_DISPATCH_LOAD
+};
+
+/** @This extends upipe_command with specific commands for wpar. */
+enum upipe_wpar_command {
+    UPIPE_WPAR_SENTINEL = UPIPE_CONTROL_LOCAL,
+
+    /** returns the dispatch policy (int *) */
+    UPIPE_WPAR_GET_DISPATCH,
+    /** sets the dispatch policy (int) */
+    UPIPE_WPAR_SET_DISPATCH,
+    /** returns the reorder depth (unsigned int *) */
+    UPIPE_WPAR_GET_REORDER_DEPTH,
+    /** sets the reorder depth (unsigned int) */
+    UPIPE_WPAR_SET_REORDER_DEPTH
+};
+
+/** @This returns the policy used to dispatch urefs to the lanes.
+ *
+ * @param upipe description structure of the pipe
+ * @param dispatch_p filled in with the policy
+ * @return an error code
+ */
+static inline int upipe_wpar_get_dispatch(struct upipe *upipe,
+                                          enum upipe_wpar_dispatch *dispatch_p)
+{
+    int dispatch;
+    UBASE_RETURN(upipe_control(upipe, UPIPE_WPAR_GET_DISPATCH,
+                               UPIPE_WPAR_SIGNATURE, &dispatch))
+    *dispatch_p = dispatch;
+    return UBASE_ERR_NONE;
+}
+
+/** @This sets the policy used to dispatch urefs to the lanes.
+ *
+ * @param upipe description structure of the pipe
+ * @param dispatch policy
+ * @return an error code
+ */
+static inline int upipe_wpar_set_dispatch(struct upipe *upipe,
+                                          enum upipe_wpar_dispatch dispatch)
+{
+    return upipe_control(upipe, UPIPE_WPAR_SET_DISPATCH,
+                         UPIPE_WPAR_SIGNATURE, (int)dispatch);
+}
+
+/** @This returns the maximum number of urefs held back while waiting for a
+ * missing sequence number.
+ *
+ * @param upipe description structure of the pipe
+ * @param depth_p filled in with the reorder depth
+ * @return an error code
+ */
+static inline int upipe_wpar_get_reorder_depth(struct upipe *upipe,
+                                               unsigned int *depth_p)
+{
+    return upipe_control(upipe, UPIPE_WPAR_GET_REORDER_DEPTH,
+                         UPIPE_WPAR_SIGNATURE, depth_p);
+}
+
+/** @This sets the maximum number of urefs held back while waiting for a
+ * missing sequence number. Beyond that, the missing uref is considered lost.
+ * The default is the number of urefs that the queues of all lanes may hold.
+ *
+ * @param upipe description structure of the pipe
+ * @param depth reorder depth
+ * @return an error code
+ */
+static inline int upipe_wpar_set_reorder_depth(struct upipe *upipe,
+                                               unsigned int depth)
+{
+    return upipe_control(upipe, UPIPE_WPAR_SET_REORDER_DEPTH,
+                         UPIPE_WPAR_SIGNATURE, depth);
+}
+
+/** @hidden */
+#define ARGS_DECL , struct upipe_mgr *inner_mgr, struct uprobe *uprobe_remote, struct uref *inner_flow_def, unsigned int nb_lanes, unsigned int input_queue_length, unsigned int output_queue_length
+/** @hidden */
+#define ARGS , inner_mgr, uprobe_remote, inner_flow_def, nb_lanes, input_queue_length, output_queue_length
+UPIPE_HELPER_ALLOC(wpar, UPIPE_WPAR_SIGNATURE)
+#undef ARGS
+#undef ARGS_DECL
+
+#ifdef __cplusplus
+}
+#endif
+#endif
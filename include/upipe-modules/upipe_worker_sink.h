@@ -69,6 +69,20 @@ upipe_wsink_mgr_alloc(struct upipe_mgr *xfer_mgr)
     return upipe_work_mgr_alloc(xfer_mgr);
 }
 
+/** @This returns the management structure for wsink pipes multiplexed onto
+ * a pool of remote threads.
+ *
+ * @param xfer_mgrs array of managers to transfer pipes to the remote threads
+ * @param nb_xfer_mgrs number of managers in the array
+ * @return pointer to manager
+ */
+static inline struct upipe_mgr *
+upipe_wsink_pool_mgr_alloc(struct upipe_mgr **xfer_mgrs,
+                           unsigned int nb_xfer_mgrs)
+{
+    return upipe_work_pool_mgr_alloc(xfer_mgrs, nb_xfer_mgrs);
+}
+
 /** @hidden */
 #define UPIPE_WSINK_MGR_GET_SET_MGR(name)                                   \
 /** @This returns the current manager for name inner pipes.                 \
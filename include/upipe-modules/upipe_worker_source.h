@@ -68,6 +68,20 @@ upipe_wsrc_mgr_alloc(struct upipe_mgr *xfer_mgr)
     return upipe_work_mgr_alloc(xfer_mgr);
 }
 
+/** @This returns the management structure for wsrc pipes multiplexed onto
+ * a pool of remote threads.
+ *
+ * @param xfer_mgrs array of managers to transfer pipes to the remote threads
+ * @param nb_xfer_mgrs number of managers in the array
+ * @return pointer to manager
+ */
+static inline struct upipe_mgr *
+upipe_wsrc_pool_mgr_alloc(struct upipe_mgr **xfer_mgrs,
+                          unsigned int nb_xfer_mgrs)
+{
+    return upipe_work_pool_mgr_alloc(xfer_mgrs, nb_xfer_mgrs);
+}
+
 /** @hidden */
 #define UPIPE_WSRC_MGR_GET_SET_MGR(name)                                    \
 /** @This returns the current manager for name inner pipes.                 \
@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short Upipe netmap sink module
+ * This pipe writes the incoming blocks (typically RTP packets) as UDP
+ * datagrams directly into a netmap TX ring, prepending pre-built Ethernet,
+ * IPv4 and UDP headers. Datagrams are released at the date given by their
+ * cr_sys attribute, and the ring is synchronized with the NIC once per batch.
+ *
+ * The uri is of the form netmap:<ifname>-<ring>/T@<dst>:<port>, for instance
+ * netmap:eth0-1/T@239.1.1.1:5000. The source address and port are those of
+ * the interface and the destination port.
+ */
+
+#ifndef _UPIPE_MODULES_UPIPE_NETMAP_SINK_H_
+/** @hidden */
+#define _UPIPE_MODULES_UPIPE_NETMAP_SINK_H_
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <upipe/upipe.h>
+
+#define UPIPE_NETMAP_SINK_SIGNATURE UBASE_FOURCC('n','t','m','k')
+
+/** @This returns the management structure for netmap_sink pipes.
+ *
+ * @return pointer to manager
+ */
+struct upipe_mgr *upipe_netmap_sink_mgr_alloc(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
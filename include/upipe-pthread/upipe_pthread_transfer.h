@@ -38,6 +38,7 @@ extern "C" {
 #include <upipe/upipe.h>
 #include <upipe/uprobe.h>
 #include <upipe/upump.h>
+#include <upipe-modules/upipe_worker.h>
 
 #include <stdint.h>
 #include <pthread.h>
@@ -45,6 +46,33 @@ extern "C" {
 /** @hidden */
 struct umutex;
 
+/** @This describes the scheduling options applied to the new thread before
+ * it runs its event loop. */
+struct upipe_pthread_options {
+    /** name of the thread (truncated to 15 characters), or NULL */
+    const char *name;
+    /** list of CPUs the thread is allowed to run on, in the format
+     * "0,2-3", or NULL to inherit the affinity of the creating thread */
+    const char *cpus;
+    /** SCHED_FIFO priority of the thread, or 0 to keep the default policy */
+    int rt_priority;
+    /** NUMA node the memory allocations of the thread are bound to, or -1 */
+    int numa_node;
+};
+
+/** @This initializes the thread options with default values.
+ *
+ * @param options pointer to the thread options
+ */
+static inline void
+    upipe_pthread_options_init(struct upipe_pthread_options *options)
+{
+    options->name = NULL;
+    options->cpus = NULL;
+    options->rt_priority = 0;
+    options->numa_node = -1;
+}
+
 /** @This returns a management structure for transfer pipes, using a new
  * pthread. You would need one management structure per target thread.
  *
@@ -67,6 +95,95 @@ struct upipe_mgr *upipe_pthread_xfer_mgr_alloc(uint8_t queue_length,
         uint16_t upump_blocker_pool_depth, struct umutex *mutex,
         pthread_t *pthread_id_p, const pthread_attr_t *restrict attr);
 
+/** @This returns a management structure for transfer pipes, using a new
+ * pthread configured with the given scheduling options.
+ *
+ * The CPU list is checked before the thread is created. The other options
+ * are applied from the new thread, and failures (typically due to missing
+ * privileges for SCHED_FIFO) are only reported as warnings on
+ * uprobe_pthread_upump_mgr.
+ *
+ * @param queue_length maximum length of the internal queue of commands
+ * @param msg_pool_depth maximum number of messages in the pool
+ * @param uprobe_pthread_upump_mgr pointer to optional probe, that will be set
+ * with the created upump_mgr
+ * @param upump_mgr_alloc alloc function provided by the upump manager
+ * @param upump_pool_depth maximum number of upump structures in the pool
+ * @param upump_blocker_pool_depth maximum number of upump_blocker structures in
+ * the pool
+ * @param mutex mutual exclusion pimitives to access the event loop, or NULL
+ * @param pthread_id_p reference to created thread ID (may be NULL)
+ * @param attr pthread attributes
+ * @param options scheduling options of the thread, or NULL
+ * @return pointer to xfer manager
+ */
+struct upipe_mgr *upipe_pthread_xfer_mgr_alloc_opts(uint8_t queue_length,
+        uint16_t msg_pool_depth, struct uprobe *uprobe_pthread_upump_mgr,
+        upump_mgr_alloc upump_mgr_alloc, uint16_t upump_pool_depth,
+        uint16_t upump_blocker_pool_depth, struct umutex *mutex,
+        pthread_t *pthread_id_p, const pthread_attr_t *restrict attr,
+        const struct upipe_pthread_options *options);
+
+/** @This returns a management structure for worker pipes (wsrc, wlin,
+ * wsink), running the remote subpipelines in a new pthread configured with
+ * the given scheduling options.
+ *
+ * @param queue_length maximum length of the internal queue of commands
+ * @param msg_pool_depth maximum number of messages in the pool
+ * @param uprobe_pthread_upump_mgr pointer to optional probe, that will be set
+ * with the created upump_mgr
+ * @param upump_mgr_alloc alloc function provided by the upump manager
+ * @param upump_pool_depth maximum number of upump structures in the pool
+ * @param upump_blocker_pool_depth maximum number of upump_blocker structures in
+ * the pool
+ * @param mutex mutual exclusion pimitives to access the event loop, or NULL
+ * @param options scheduling options of the thread, or NULL
+ * @return pointer to worker manager
+ */
+static inline struct upipe_mgr *upipe_pthread_work_mgr_alloc(
+        uint8_t queue_length, uint16_t msg_pool_depth,
+        struct uprobe *uprobe_pthread_upump_mgr,
+        upump_mgr_alloc upump_mgr_alloc, uint16_t upump_pool_depth,
+        uint16_t upump_blocker_pool_depth, struct umutex *mutex,
+        const struct upipe_pthread_options *options)
+{
+    struct upipe_mgr *xfer_mgr = upipe_pthread_xfer_mgr_alloc_opts(
+            queue_length, msg_pool_depth, uprobe_pthread_upump_mgr,
+            upump_mgr_alloc, upump_pool_depth, upump_blocker_pool_depth,
+            mutex, NULL, NULL, options);
+    if (unlikely(xfer_mgr == NULL))
+        return NULL;
+    struct upipe_mgr *work_mgr = upipe_work_mgr_alloc(xfer_mgr);
+    upipe_mgr_release(xfer_mgr);
+    return work_mgr;
+}
+
+/** @This returns a management structure for worker pipes (wsrc, wlin,
+ * wsink), multiplexing the remote subpipelines onto a pool of new pthreads
+ * configured with the given scheduling options. Each new worker pipe is
+ * assigned to the thread with the fewest live worker pipes.
+ *
+ * @param nb_threads number of threads in the pool, or 0 for one thread per
+ * online CPU
+ * @param queue_length maximum length of the internal queue of commands
+ * @param msg_pool_depth maximum number of messages in the pool
+ * @param uprobe_pthread_upump_mgr pointer to optional probe, that will be set
+ * with the created upump_mgr
+ * @param upump_mgr_alloc alloc function provided by the upump manager
+ * @param upump_pool_depth maximum number of upump structures in the pool
+ * @param upump_blocker_pool_depth maximum number of upump_blocker structures in
+ * the pool
+ * @param mutex mutual exclusion pimitives to access the event loop, or NULL
+ * @param options scheduling options of the threads, or NULL
+ * @return pointer to worker manager
+ */
+struct upipe_mgr *upipe_pthread_work_pool_mgr_alloc(unsigned int nb_threads,
+        uint8_t queue_length, uint16_t msg_pool_depth,
+        struct uprobe *uprobe_pthread_upump_mgr,
+        upump_mgr_alloc upump_mgr_alloc, uint16_t upump_pool_depth,
+        uint16_t upump_blocker_pool_depth, struct umutex *mutex,
+        const struct upipe_pthread_options *options);
+
 #ifdef __cplusplus
 }
 #endif
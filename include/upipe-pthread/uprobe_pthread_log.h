@@ -0,0 +1,149 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short probe logging asynchronously from a dedicated thread
+ *
+ * This probe catches log events and copies them, with their prefixes, into
+ * preallocated records which are passed through a lock-free queue to a
+ * dedicated thread. That thread throws them to the next probe
+ * (typically @ref uprobe_stdio or @ref uprobe_syslog), so that formatting
+ * and writing the messages never blocks the thread of the pipes. When the
+ * queue is full, messages are dropped and counted. Messages are also
+ * rate-limited per site, a site being identified by the pipe, the level and
+ * the text of the message with its digits ignored.
+ */
+
+#ifndef _UPIPE_PTHREAD_UPROBE_PTHREAD_LOG_H_
+/** @hidden */
+#define _UPIPE_PTHREAD_UPROBE_PTHREAD_LOG_H_
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <upipe/uprobe.h>
+#include <upipe/uprobe_helper_uprobe.h>
+#include <upipe/ulifo.h>
+#include <upipe/uqueue.h>
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+/** @hidden */
+struct uprobe_pthread_log_record;
+/** @hidden */
+struct uprobe_pthread_log_site;
+
+/** @This is a super-set of the uprobe structure with additional local
+ * members. */
+struct uprobe_pthread_log {
+    /** queue of records to log */
+    struct uqueue queue;
+    /** LIFO of free records */
+    struct ulifo records;
+    /** extra space for the queue and the LIFO */
+    void *extra;
+    /** array of preallocated records */
+    struct uprobe_pthread_log_record *record_array;
+    /** table of message sites for rate limiting */
+    struct uprobe_pthread_log_site *sites;
+
+    /** maximum number of messages per site and period (0 = unlimited) */
+    unsigned int burst;
+    /** rate limiting period, in 27 MHz ticks */
+    uint64_t period;
+
+    /** number of messages dropped because the queue was full */
+    uint64_t dropped;
+    /** number of messages dropped by rate limiting */
+    uint64_t limited;
+
+    /** logging thread */
+    pthread_t thread;
+    /** set to stop the logging thread */
+    bool stop;
+
+    /** structure exported to modules */
+    struct uprobe uprobe;
+};
+
+UPROBE_HELPER_UPROBE(uprobe_pthread_log, uprobe)
+
+/** @This initializes an already allocated uprobe_pthread_log structure, and
+ * starts the logging thread.
+ *
+ * @param uprobe_pthread_log pointer to the already allocated structure
+ * @param next next probe, receiving the log events in the logging thread
+ * @param length maximum number of pending messages
+ * @return pointer to uprobe, or NULL in case of error
+ */
+struct uprobe *uprobe_pthread_log_init(
+        struct uprobe_pthread_log *uprobe_pthread_log,
+        struct uprobe *next, uint8_t length);
+
+/** @This stops the logging thread after it has logged the pending messages,
+ * and cleans a uprobe_pthread_log structure.
+ *
+ * @param uprobe_pthread_log structure to clean
+ */
+void uprobe_pthread_log_clean(struct uprobe_pthread_log *uprobe_pthread_log);
+
+/** @This allocates a new uprobe_pthread_log structure, and starts the
+ * logging thread.
+ *
+ * @param next next probe, receiving the log events in the logging thread
+ * @param length maximum number of pending messages
+ * @return pointer to uprobe, or NULL in case of error
+ */
+struct uprobe *uprobe_pthread_log_alloc(struct uprobe *next, uint8_t length);
+
+/** @This sets the rate limiting of the messages. At most burst messages
+ * from the same site are logged per period.
+ *
+ * @param uprobe pointer to probe
+ * @param burst maximum number of messages per site and period, or 0 to
+ * disable rate limiting
+ * @param period duration of the period, in 27 MHz ticks
+ */
+void uprobe_pthread_log_set_rate_limit(struct uprobe *uprobe,
+                                       unsigned int burst, uint64_t period);
+
+/** @This returns the number of dropped messages. It may be called from any
+ * thread.
+ *
+ * @param uprobe pointer to probe
+ * @param dropped_p filled in with the number of messages dropped because the
+ * queue was full (may be NULL)
+ * @param limited_p filled in with the number of messages dropped by rate
+ * limiting (may be NULL)
+ */
+void uprobe_pthread_log_get_dropped(struct uprobe *uprobe,
+                                    uint64_t *dropped_p, uint64_t *limited_p);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
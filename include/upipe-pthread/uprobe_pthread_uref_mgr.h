@@ -0,0 +1,143 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/** @file
+ * @short probe catching provide_request events asking for uref or ubuf managers, and providing managers allocated for the calling thread
+ *
+ * Each thread throwing requests gets its own udict, uref and ubuf managers,
+ * kept in thread local storage and allocated on first use with the pool
+ * depths of the probe, or those set for the thread with
+ * @ref uprobe_pthread_uref_mgr_set_depths. Allocations therefore never touch
+ * the pools of other threads. Buffers freed in another thread go back to
+ * their pool through its magazines, in bursts.
+ */
+
+#ifndef _UPIPE_PTHREAD_UPROBE_PTHREAD_UREF_MGR_H_
+/** @hidden */
+#define _UPIPE_PTHREAD_UPROBE_PTHREAD_UREF_MGR_H_
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <upipe/uprobe.h>
+#include <upipe/uprobe_helper_uprobe.h>
+
+#include <stdint.h>
+#include <pthread.h>
+
+/** @hidden */
+struct umem_mgr;
+
+/** @This is a super-set of the uprobe structure with additional local
+ * members. */
+struct uprobe_pthread_uref_mgr {
+    /** pthread key pointing to thread local storage */
+    pthread_key_t key;
+    /** pointer to umem_mgr to use to allocate managers */
+    struct umem_mgr *umem_mgr;
+    /** default depth of the udict pool */
+    uint16_t udict_pool_depth;
+    /** default depth of the uref pool */
+    uint16_t uref_pool_depth;
+    /** default depth of the ubuf pool */
+    uint16_t ubuf_pool_depth;
+    /** default depth of the shared object pool */
+    uint16_t shared_pool_depth;
+
+    /** structure exported to modules */
+    struct uprobe uprobe;
+};
+
+UPROBE_HELPER_UPROBE(uprobe_pthread_uref_mgr, uprobe);
+
+/** @This initializes an already allocated uprobe_pthread_uref_mgr structure.
+ *
+ * @param uprobe_pthread_uref_mgr pointer to the already allocated structure
+ * @param next next probe to test if this one doesn't catch the event
+ * @param umem_mgr memory allocator to use for managers and buffers
+ * @param udict_pool_depth maximum number of udict structures in each pool
+ * @param uref_pool_depth maximum number of uref structures in each pool
+ * @param ubuf_pool_depth maximum number of ubuf structures in each pool
+ * @param shared_pool_depth maximum number of shared structures in each pool
+ * @return pointer to uprobe, or NULL in case of error
+ */
+struct uprobe *uprobe_pthread_uref_mgr_init(
+        struct uprobe_pthread_uref_mgr *uprobe_pthread_uref_mgr,
+        struct uprobe *next, struct umem_mgr *umem_mgr,
+        uint16_t udict_pool_depth, uint16_t uref_pool_depth,
+        uint16_t ubuf_pool_depth, uint16_t shared_pool_depth);
+
+/** @This cleans a uprobe_pthread_uref_mgr structure.
+ *
+ * @param uprobe_pthread_uref_mgr structure to clean
+ */
+void uprobe_pthread_uref_mgr_clean(struct uprobe_pthread_uref_mgr *uprobe_pthread_uref_mgr);
+
+/** @This allocates a new uprobe_pthread_uref_mgr structure.
+ *
+ * @param next next probe to test if this one doesn't catch the event
+ * @param umem_mgr memory allocator to use for managers and buffers
+ * @param udict_pool_depth maximum number of udict structures in each pool
+ * @param uref_pool_depth maximum number of uref structures in each pool
+ * @param ubuf_pool_depth maximum number of ubuf structures in each pool
+ * @param shared_pool_depth maximum number of shared structures in each pool
+ * @return pointer to uprobe, or NULL in case of error
+ */
+struct uprobe *uprobe_pthread_uref_mgr_alloc(struct uprobe *next,
+                                             struct umem_mgr *umem_mgr,
+                                             uint16_t udict_pool_depth,
+                                             uint16_t uref_pool_depth,
+                                             uint16_t ubuf_pool_depth,
+                                             uint16_t shared_pool_depth);
+
+/** @This changes the pool depths used by this probe for the current thread.
+ * The managers already allocated for the thread are released, so that the
+ * next requests get managers with the new depths.
+ *
+ * @param uprobe pointer to probe
+ * @param udict_pool_depth maximum number of udict structures in the pool
+ * @param uref_pool_depth maximum number of uref structures in the pool
+ * @param ubuf_pool_depth maximum number of ubuf structures in each pool
+ * @param shared_pool_depth maximum number of shared structures in each pool
+ * @return an error code
+ */
+int uprobe_pthread_uref_mgr_set_depths(struct uprobe *uprobe,
+                                       uint16_t udict_pool_depth,
+                                       uint16_t uref_pool_depth,
+                                       uint16_t ubuf_pool_depth,
+                                       uint16_t shared_pool_depth);
+
+/** @This releases the managers allocated for the current thread. They are
+ * allocated again on the next requests.
+ *
+ * @param uprobe pointer to probe
+ */
+void uprobe_pthread_uref_mgr_vacuum(struct uprobe *uprobe);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
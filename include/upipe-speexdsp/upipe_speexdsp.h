@@ -44,6 +44,81 @@ extern "C" {
  */
 struct upipe_mgr *upipe_speexdsp_mgr_alloc(void);
 
+/** @This extends upipe_command with specific commands for speexdsp pipes. */
+enum upipe_speexdsp_command {
+    UPIPE_SPEEXDSP_SENTINEL = UPIPE_CONTROL_LOCAL,
+
+    /** returns the size of output chunks (unsigned int *) */
+    UPIPE_SPEEXDSP_GET_CHUNK,
+    /** sets the size of output chunks (unsigned int) */
+    UPIPE_SPEEXDSP_SET_CHUNK,
+    /** returns the current drift rate (struct urational *) */
+    UPIPE_SPEEXDSP_GET_DRIFT_RATE,
+    /** sets the drift rate (struct urational) */
+    UPIPE_SPEEXDSP_SET_DRIFT_RATE
+};
+
+/** @This returns the size of output chunks.
+ *
+ * @param upipe description structure of the pipe
+ * @param chunk_p filled in with the number of samples per chunk, or 0
+ * @return an error code
+ */
+static inline int upipe_speexdsp_get_chunk(struct upipe *upipe,
+                                           unsigned int *chunk_p)
+{
+    return upipe_control(upipe, UPIPE_SPEEXDSP_GET_CHUNK,
+                         UPIPE_SPEEXDSP_SIGNATURE, chunk_p);
+}
+
+/** @This sets the size of output chunks, switching the pipe to streaming
+ * mode. Input samples are then resampled as soon as they arrive and output
+ * in buffers of exactly chunk samples, so that the buffering latency is
+ * bounded by the chunk duration plus the filter delay. The initial filter
+ * delay is skipped. This must be called before the flow definition is set.
+ *
+ * @param upipe description structure of the pipe
+ * @param chunk number of samples per output buffer, or 0 to output one
+ * buffer per input buffer (default)
+ * @return an error code
+ */
+static inline int upipe_speexdsp_set_chunk(struct upipe *upipe,
+                                           unsigned int chunk)
+{
+    return upipe_control(upipe, UPIPE_SPEEXDSP_SET_CHUNK,
+                         UPIPE_SPEEXDSP_SIGNATURE, chunk);
+}
+
+/** @This returns the current drift rate.
+ *
+ * @param upipe description structure of the pipe
+ * @param rate_p filled in with the drift rate
+ * @return an error code
+ */
+static inline int upipe_speexdsp_get_drift_rate(struct upipe *upipe,
+                                                struct urational *rate_p)
+{
+    return upipe_control(upipe, UPIPE_SPEEXDSP_GET_DRIFT_RATE,
+                         UPIPE_SPEEXDSP_SIGNATURE, rate_p);
+}
+
+/** @This sets the drift rate, which has the same meaning as the rate
+ * attribute of urefs (see @ref uref_clock_get_rate): input samples are
+ * consumed rate times faster than the output sample rate. It may be changed
+ * at any time, for instance from a clock error, without resetting the
+ * resampler. Once set, the rate attribute of urefs is ignored.
+ *
+ * @param upipe description structure of the pipe
+ * @param rate drift rate
+ * @return an error code
+ */
+static inline int upipe_speexdsp_set_drift_rate(struct upipe *upipe,
+                                                struct urational rate)
+{
+    return upipe_control(upipe, UPIPE_SPEEXDSP_SET_DRIFT_RATE,
+                         UPIPE_SPEEXDSP_SIGNATURE, rate);
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -45,7 +45,9 @@ enum upipe_sws_command {
     /** set flags (int) */
     UPIPE_SWS_SET_FLAGS,
     /** get flags (int *) */
-    UPIPE_SWS_GET_FLAGS
+    UPIPE_SWS_GET_FLAGS,
+    /** sets the number of scaling threads (unsigned int) */
+    UPIPE_SWS_SET_THREADS
 };
 
 /** @This gets the swscale flags.
@@ -72,6 +74,24 @@ static inline bool upipe_sws_set_flags(struct upipe *upipe, int flags)
                          flags);
 }
 
+/** @This sets the number of threads scaling each picture. With 0 or 1 (the
+ * default), pictures are scaled in the thread of the pipe. Otherwise each
+ * picture is split into horizontal bands, which are scaled concurrently with
+ * separate swscale contexts by the thread of the pipe and nb_threads - 1
+ * worker threads. The fields of interlaced pictures are also scaled
+ * concurrently.
+ *
+ * @param upipe description structure of the pipe
+ * @param nb_threads number of threads
+ * @return an error code
+ */
+static inline int upipe_sws_set_threads(struct upipe *upipe,
+                                        unsigned int nb_threads)
+{
+    return upipe_control(upipe, UPIPE_SWS_SET_THREADS, UPIPE_SWS_SIGNATURE,
+                         nb_threads);
+}
+
 /** @This returns the management structure for sws pipes.
  *
  * @return pointer to manager
@@ -52,7 +52,10 @@ enum upipe_sws_thumbs_command {
     UPIPE_SWS_THUMBS_FLUSH_NEXT
 };
 
-/** @This sets the thumbnail gallery dimensions.
+/** @This sets the thumbnail gallery dimensions. The decoder feeding the
+ * pipe may be put in preview mode (see @ref upipe_avcdec_set_preview) with
+ * the size of a thumbnail, so that it does not output pictures much larger
+ * than needed.
  *
  * @param upipe description structure of the pipe
  * @param size size parameter (0=disabled)
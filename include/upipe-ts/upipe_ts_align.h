@@ -34,6 +34,8 @@ extern "C" {
 #define UPIPE_TS_ALIGN_SIGNATURE UBASE_FOURCC('t','s','a','l')
 
 /** @This returns the management structure for all ts_align pipes.
+ * ts_align pipes also accept @ref upipe_ts_sync_set_batch, which applies when
+ * the input must be synchronized.
  *
  * @return pointer to manager
  */
@@ -29,6 +29,13 @@
  * @item 196 @item TS packet followed by an 8-octet timestamp or checksum
  * @item 204 @item TS packet followed by a 16-octet checksum
  * @end table
+ *
+ * In monitoring mode (see @ref upipe_ts_check_set_monitor), the pipe also
+ * keeps ETR 290 style conformance counters in a compact structure per PID,
+ * updated in constant time for each packet. Every interval of system time
+ * (taken from the dates of the incoming urefs), it throws a
+ * @ref UPROBE_TS_CHECK_REPORT event with the counters of the window, and
+ * starts a new window.
  */
 
 #ifndef _UPIPE_TS_UPIPE_TS_CHECK_H_
@@ -40,8 +47,119 @@ extern "C" {
 
 #include <upipe/upipe.h>
 
+#include <stdint.h>
+
 #define UPIPE_TS_CHECK_SIGNATURE UBASE_FOURCC('t','s','c','k')
 
+/** @This holds the conformance counters of a PID for a window. */
+struct upipe_ts_check_pid_stats {
+    /** PID */
+    uint16_t pid;
+    /** number of packets */
+    uint64_t packets;
+    /** number of continuity counter errors (ETR 290 1.4) */
+    uint64_t cc_errors;
+    /** number of packets with the transport_error_indicator (ETR 290 2.1) */
+    uint64_t transport_errors;
+    /** number of PCRs */
+    uint64_t pcrs;
+    /** number of PCRs more than 100 ms apart, or going backwards (ETR 290
+     * 2.3) */
+    uint64_t pcr_repetition_errors;
+    /** number of PCRs exceeding +/- 500 ns of accuracy (ETR 290 2.4) */
+    uint64_t pcr_accuracy_errors;
+    /** maximum absolute PCR inaccuracy, in 27 MHz ticks */
+    uint64_t pcr_max_inaccuracy;
+};
+
+/** @This holds the conformance counters of a window. */
+struct upipe_ts_check_stats {
+    /** duration of the window */
+    uint64_t duration;
+    /** number of packets */
+    uint64_t packets;
+    /** number of sync byte errors (ETR 290 1.2) */
+    uint64_t sync_errors;
+    /** number of PIDs seen since monitoring was enabled */
+    unsigned int nb_pids;
+    /** counters of the PIDs, in order of appearance */
+    const struct upipe_ts_check_pid_stats *pids;
+};
+
+/** @This extends uprobe_event with specific events for ts_check. */
+enum upipe_ts_check_event {
+    UPROBE_TS_CHECK_SENTINEL = UPROBE_LOCAL,
+
+    /** end of a monitoring window (const struct upipe_ts_check_stats *) */
+    UPROBE_TS_CHECK_REPORT
+};
+
+/** @This converts @ref upipe_ts_check_event to a string.
+ *
+ * @param event event to convert
+ * @return a string or NULL if invalid
+ */
+static inline const char *upipe_ts_check_event_str(int event)
+{
+    switch ((enum upipe_ts_check_event)event) {
+    UBASE_CASE_TO_STR(UPROBE_TS_CHECK_REPORT);
+    case UPROBE_TS_CHECK_SENTINEL: break;
+    }
+    return NULL;
+}
+
+/** @This extends upipe_command with specific commands for ts_check. */
+enum upipe_ts_check_command {
+    UPIPE_TS_CHECK_SENTINEL = UPIPE_CONTROL_LOCAL,
+
+    /** sets the monitoring interval, or 0 to disable (uint64_t) */
+    UPIPE_TS_CHECK_SET_MONITOR,
+    /** returns the monitoring interval (uint64_t *) */
+    UPIPE_TS_CHECK_GET_MONITOR,
+};
+
+/** @This converts @ref upipe_ts_check_command to a string.
+ *
+ * @param command command to convert
+ * @return a string or NULL if invalid
+ */
+static inline const char *upipe_ts_check_command_str(int command)
+{
+    switch ((enum upipe_ts_check_command)command) {
+    UBASE_CASE_TO_STR(UPIPE_TS_CHECK_SET_MONITOR);
+    UBASE_CASE_TO_STR(UPIPE_TS_CHECK_GET_MONITOR);
+    case UPIPE_TS_CHECK_SENTINEL: break;
+    }
+    return NULL;
+}
+
+/** @This enables the monitoring mode and sets the report interval. An
+ * interval of 0 disables the monitoring mode and frees the counters.
+ *
+ * @param upipe description structure of the pipe
+ * @param interval report interval in clock ticks
+ * @return an error code
+ */
+static inline int upipe_ts_check_set_monitor(struct upipe *upipe,
+                                             uint64_t interval)
+{
+    return upipe_control(upipe, UPIPE_TS_CHECK_SET_MONITOR,
+                         UPIPE_TS_CHECK_SIGNATURE, interval);
+}
+
+/** @This returns the report interval of the monitoring mode.
+ *
+ * @param upipe description structure of the pipe
+ * @param interval_p filled in with the report interval in clock ticks, or 0
+ * @return an error code
+ */
+static inline int upipe_ts_check_get_monitor(struct upipe *upipe,
+                                             uint64_t *interval_p)
+{
+    return upipe_control(upipe, UPIPE_TS_CHECK_GET_MONITOR,
+                         UPIPE_TS_CHECK_SIGNATURE, interval_p);
+}
+
 /** @This returns the management structure for all ts_check pipes.
  *
  * @return pointer to manager
@@ -51,7 +51,11 @@ enum upipe_ts_demux_command {
     /** returns the currently detected conformance (int *) */
     UPIPE_TS_DEMUX_GET_CONFORMANCE,
     /** sets the conformance (int) */
-    UPIPE_TS_DEMUX_SET_CONFORMANCE
+    UPIPE_TS_DEMUX_SET_CONFORMANCE,
+    /** returns the fast channel change cache duration (uint64_t *) */
+    UPIPE_TS_DEMUX_GET_FCC,
+    /** sets the fast channel change cache duration (uint64_t) */
+    UPIPE_TS_DEMUX_SET_FCC
 };
 
 /** @This returns the currently detected conformance mode. It cannot return
@@ -83,6 +87,80 @@ static inline int
                          UPIPE_TS_DEMUX_SIGNATURE, conformance);
 }
 
+/** @This returns the duration of the fast channel change cache.
+ *
+ * @param upipe description structure of the pipe
+ * @param duration_p filled in with the duration in 27 MHz ticks
+ * @return an error code
+ */
+static inline int upipe_ts_demux_get_fcc(struct upipe *upipe,
+                                         uint64_t *duration_p)
+{
+    return upipe_control(upipe, UPIPE_TS_DEMUX_GET_FCC,
+                         UPIPE_TS_DEMUX_SIGNATURE, duration_p);
+}
+
+/** @This sets the duration of the fast channel change cache. When it is not
+ * 0, the latest PMT sections and the packets since the last random access
+ * point of every PID are kept, so that a newly selected program starts
+ * without waiting for the next PMT and key frame.
+ *
+ * @param upipe description structure of the pipe
+ * @param duration duration in 27 MHz ticks, or 0 to disable the cache
+ * @return an error code
+ */
+static inline int upipe_ts_demux_set_fcc(struct upipe *upipe,
+                                         uint64_t duration)
+{
+    return upipe_control(upipe, UPIPE_TS_DEMUX_SET_FCC,
+                         UPIPE_TS_DEMUX_SIGNATURE, duration);
+}
+
+/** @This extends upipe_command with specific commands for ts demux program
+ * subpipes. */
+enum upipe_ts_demux_program_command {
+    UPIPE_TS_DEMUX_PROGRAM_SENTINEL = UPIPE_CONTROL_LOCAL,
+
+    /** returns the passthrough mode of new outputs (bool *) */
+    UPIPE_TS_DEMUX_PROGRAM_GET_PASSTHROUGH,
+    /** sets the passthrough mode of new outputs (bool) */
+    UPIPE_TS_DEMUX_PROGRAM_SET_PASSTHROUGH
+};
+
+/** @This returns whether the outputs allocated from a program subpipe
+ * forward TS packets without decapsulation.
+ *
+ * @param upipe description structure of the program subpipe
+ * @param passthrough_p filled in with the passthrough mode
+ * @return an error code
+ */
+static inline int
+    upipe_ts_demux_program_get_passthrough(struct upipe *upipe,
+                                           bool *passthrough_p)
+{
+    return upipe_control(upipe, UPIPE_TS_DEMUX_PROGRAM_GET_PASSTHROUGH,
+                         UPIPE_TS_DEMUX_PROGRAM_SIGNATURE, passthrough_p);
+}
+
+/** @This sets whether the outputs allocated afterwards from a program
+ * subpipe forward TS packets without decapsulation. In passthrough mode,
+ * outputs do not allocate ts_decaps, ts_pesd and framers, and output the
+ * whole TS packets of their PID (flow definition "block.mpegts."), which is
+ * suitable for remultiplexing. The program still tracks the PCR, but the
+ * PSI tables are not rewritten.
+ *
+ * @param upipe description structure of the program subpipe
+ * @param passthrough true to forward TS packets
+ * @return an error code
+ */
+static inline int
+    upipe_ts_demux_program_set_passthrough(struct upipe *upipe,
+                                           bool passthrough)
+{
+    return upipe_control(upipe, UPIPE_TS_DEMUX_PROGRAM_SET_PASSTHROUGH,
+                         UPIPE_TS_DEMUX_PROGRAM_SIGNATURE, passthrough ? 1 : 0);
+}
+
 /** @This returns the management structure for all ts_demux pipes.
  *
  * @return pointer to manager
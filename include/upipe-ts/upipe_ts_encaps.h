@@ -69,6 +69,9 @@ static inline int upipe_ts_encaps_set_tb_size(struct upipe *upipe,
 }
 
 /** @This returns a ubuf containing a TS packet, and the dts_sys of the packet.
+ * The payload is not copied: the returned ubuf is a segmented block made of
+ * the TS header and slices of the incoming PES, so that it can be sent
+ * directly with @ref uref_block_iovec_read.
  *
  * @param upipe description structure of the pipe
  * @param cr_sys_min date at which the packet will be muxed
@@ -31,9 +31,46 @@ extern "C" {
 #endif
 
 #include <upipe/upipe.h>
+#include <upipe/uref_attr.h>
+#include <upipe/uref_clock.h>
+
+#include <string.h>
 
 #define UPIPE_TS_PCR_INTERPOLATOR_SIGNATURE UBASE_FOURCC('t','s','p','i')
 
+/** When an input uref contains several TS packets, the PCRs are read from
+ * the adaptation fields of the packets, and the output uref carries the
+ * interpolated date of its first packet (cr_prog). This attribute then
+ * holds, for each packet of the uref, an int32_t offset in 27 MHz ticks
+ * from that date, in host byte order. */
+UREF_ATTR_OPAQUE(ts_pcr_interpolator, offsets, "t.pcr_offsets",
+                 per-packet clock offsets)
+
+/** @This returns the interpolated date of a packet of a multi-packet uref
+ * output by a ts_pcr_interpolator pipe.
+ *
+ * @param uref pointer to the uref
+ * @param packet index of the packet in the uref
+ * @param date_p filled in with the date of the packet (cr_prog)
+ * @return an error code
+ */
+static inline int uref_ts_pcr_interpolator_get_date(struct uref *uref,
+                                                    unsigned int packet,
+                                                    uint64_t *date_p)
+{
+    const uint8_t *offsets;
+    size_t size;
+    uint64_t date;
+    UBASE_RETURN(uref_ts_pcr_interpolator_get_offsets(uref, &offsets, &size))
+    if (unlikely((packet + 1) * sizeof(int32_t) > size))
+        return UBASE_ERR_INVALID;
+    UBASE_RETURN(uref_clock_get_cr_prog(uref, &date))
+    int32_t offset;
+    memcpy(&offset, offsets + packet * sizeof(int32_t), sizeof(int32_t));
+    *date_p = date + offset;
+    return UBASE_ERR_NONE;
+}
+
 /** @This extends upipe_command with specific commands. */
 enum upipe_ts_pcr_interpolator_sink_command {
     UPIPE_TS_PCR_INTERPOLATOR_SENTINEL = UPIPE_CONTROL_LOCAL,
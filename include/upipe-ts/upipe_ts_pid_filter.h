@@ -68,6 +68,10 @@ static inline int upipe_ts_pidf_del_pid(struct upipe *upipe, uint16_t pid)
 }
 
 /** @This returns the management structure for all ts_pidf pipes.
+ *
+ * Input blocks may contain several TS packets; the packets on enabled PIDs
+ * are then output in a single uref, which references the input buffer
+ * instead of copying it.
  *
  * @return pointer to manager
  */
@@ -45,6 +45,46 @@ enum uprobe_ts_split_event {
     UPROBE_TS_SPLIT_DEL_PID
 };
 
+/** @This extends upipe_command with specific commands for ts split. */
+enum upipe_ts_split_command {
+    UPIPE_TS_SPLIT_SENTINEL = UPIPE_CONTROL_LOCAL,
+
+    /** returns the fast channel change cache duration (uint64_t *) */
+    UPIPE_TS_SPLIT_GET_FCC,
+    /** sets the fast channel change cache duration (uint64_t) */
+    UPIPE_TS_SPLIT_SET_FCC
+};
+
+/** @This returns the duration of the fast channel change cache.
+ *
+ * @param upipe description structure of the pipe
+ * @param duration_p filled in with the duration in 27 MHz ticks
+ * @return an error code
+ */
+static inline int upipe_ts_split_get_fcc(struct upipe *upipe,
+                                         uint64_t *duration_p)
+{
+    return upipe_control(upipe, UPIPE_TS_SPLIT_GET_FCC,
+                         UPIPE_TS_SPLIT_SIGNATURE, duration_p);
+}
+
+/** @This sets the duration of the fast channel change cache. When it is not
+ * 0, the packets of every PID are kept from the last random access point
+ * (or the last unit start on PIDs which do not flag random access points),
+ * for at most this duration, and are replayed to outputs allocated for
+ * that PID before live packets.
+ *
+ * @param upipe description structure of the pipe
+ * @param duration duration in 27 MHz ticks, or 0 to disable the cache
+ * @return an error code
+ */
+static inline int upipe_ts_split_set_fcc(struct upipe *upipe,
+                                         uint64_t duration)
+{
+    return upipe_control(upipe, UPIPE_TS_SPLIT_SET_FCC,
+                         UPIPE_TS_SPLIT_SIGNATURE, duration);
+}
+
 /** @This returns the management structure for all ts_split pipes.
  *
  * @return pointer to manager
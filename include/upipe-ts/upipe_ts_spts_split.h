@@ -0,0 +1,65 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short Upipe module splitting a multi-program TS into single-program TS
+ *
+ * The PAT and the PMTs of the requested programs are parsed once for all
+ * outputs, and TS packets are dispatched by reference to every output
+ * carrying their PID. Each output receives a PAT rewritten to only announce
+ * its program, followed by the PMT, PCR and elementary streams of the
+ * program, unmodified and with their original dates, so that a sink
+ * downstream may pace them.
+ */
+
+#ifndef _UPIPE_TS_UPIPE_TS_SPTS_SPLIT_H_
+/** @hidden */
+#define _UPIPE_TS_UPIPE_TS_SPTS_SPLIT_H_
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <upipe/upipe.h>
+#include <upipe-ts/upipe_ts_split.h>
+
+#define UPIPE_TS_SPTS_SPLIT_SIGNATURE UBASE_FOURCC('t','s','<','s')
+#define UPIPE_TS_SPTS_SPLIT_OUTPUT_SIGNATURE UBASE_FOURCC('t','s','<','p')
+
+/** @This returns the management structure for all ts_spts_split pipes.
+ *
+ * Outputs are allocated with @ref upipe_flow_alloc_sub, with a flow
+ * definition packet giving the program number with @ref uref_flow_set_id.
+ * Like ts_split, the pipe throws the events @ref UPROBE_TS_SPLIT_ADD_PID and
+ * @ref UPROBE_TS_SPLIT_DEL_PID when the set of PIDs it needs changes, so
+ * that a PID filter or a source upstream only lets them through.
+ *
+ * @return pointer to manager
+ */
+struct upipe_mgr *upipe_ts_spts_split_mgr_alloc(void);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
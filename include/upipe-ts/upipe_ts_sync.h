@@ -49,7 +49,12 @@ enum upipe_ts_sync_command {
     /** returns the configured number of packets to synchronize with (int *) */
     UPIPE_TS_SYNC_GET_SYNC,
     /** sets the configured number of packets to synchronize with (int) */
-    UPIPE_TS_SYNC_SET_SYNC
+    UPIPE_TS_SYNC_SET_SYNC,
+    /** returns the maximum number of packets per output uref
+     * (unsigned int *) */
+    UPIPE_TS_SYNC_GET_BATCH,
+    /** sets the maximum number of packets per output uref (unsigned int) */
+    UPIPE_TS_SYNC_SET_BATCH
 };
 
 /** @This returns the management structure for all ts_sync pipes.
@@ -84,6 +89,35 @@ static inline int upipe_ts_sync_set_sync(struct upipe *upipe, int sync)
                          sync);
 }
 
+/** @This returns the maximum number of packets per output uref.
+ *
+ * @param upipe description structure of the pipe
+ * @param batch_p filled in with the number of packets
+ * @return an error code
+ */
+static inline int upipe_ts_sync_get_batch(struct upipe *upipe,
+                                          unsigned int *batch_p)
+{
+    return upipe_control(upipe, UPIPE_TS_SYNC_GET_BATCH,
+                         UPIPE_TS_SYNC_SIGNATURE, batch_p);
+}
+
+/** @This sets the maximum number of packets per output uref. Once
+ * synchronized, all packets of an input uref are then output at once, which
+ * is only suitable for pipes accepting several TS packets per uref, such as
+ * ts_split.
+ *
+ * @param upipe description structure of the pipe
+ * @param batch number of packets (default 1)
+ * @return an error code
+ */
+static inline int upipe_ts_sync_set_batch(struct upipe *upipe,
+                                          unsigned int batch)
+{
+    return upipe_control(upipe, UPIPE_TS_SYNC_SET_BATCH,
+                         UPIPE_TS_SYNC_SIGNATURE, batch);
+}
+
 #ifdef __cplusplus
 }
 #endif
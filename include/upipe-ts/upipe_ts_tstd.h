@@ -21,6 +21,12 @@
 /** @file
  * @short Upipe module tstding that a buffer contains a given number of
  * aligned TS packets
+ *
+ * In monitoring mode (see @ref upipe_ts_tstd_set_monitor), the
+ * underflows and overflows of the buffer model are counted instead of being
+ * logged, and every interval of program time (taken from the DTS of the
+ * incoming urefs) a @ref UPROBE_TS_TSTD_REPORT event is thrown with the
+ * counters of the window.
  */
 
 #ifndef _UPIPE_TS_UPIPE_TS_TSTD_H_
@@ -32,8 +38,106 @@ extern "C" {
 
 #include <upipe/upipe.h>
 
+#include <stdint.h>
+
 #define UPIPE_TS_TSTD_SIGNATURE UBASE_FOURCC('t','s','t','d')
 
+/** @This holds the buffer model counters of a window. */
+struct upipe_ts_tstd_stats {
+    /** duration of the window */
+    uint64_t duration;
+    /** number of urefs */
+    uint64_t urefs;
+    /** number of octets */
+    uint64_t octets;
+    /** number of buffer underflows */
+    uint64_t underflows;
+    /** total size of the underflows, in octets */
+    uint64_t underflow_octets;
+    /** number of buffer overflows */
+    uint64_t overflows;
+    /** total size of the overflows, in octets */
+    uint64_t overflow_octets;
+    /** minimum fullness of the buffer, in octets */
+    uint64_t min_fullness;
+    /** maximum fullness of the buffer, in octets */
+    uint64_t max_fullness;
+};
+
+/** @This extends uprobe_event with specific events for ts_tstd. */
+enum upipe_ts_tstd_event {
+    UPROBE_TS_TSTD_SENTINEL = UPROBE_LOCAL,
+
+    /** end of a monitoring window (const struct upipe_ts_tstd_stats *) */
+    UPROBE_TS_TSTD_REPORT
+};
+
+/** @This converts @ref upipe_ts_tstd_event to a string.
+ *
+ * @param event event to convert
+ * @return a string or NULL if invalid
+ */
+static inline const char *upipe_ts_tstd_event_str(int event)
+{
+    switch ((enum upipe_ts_tstd_event)event) {
+    UBASE_CASE_TO_STR(UPROBE_TS_TSTD_REPORT);
+    case UPROBE_TS_TSTD_SENTINEL: break;
+    }
+    return NULL;
+}
+
+/** @This extends upipe_command with specific commands for ts_tstd. */
+enum upipe_ts_tstd_command {
+    UPIPE_TS_TSTD_SENTINEL = UPIPE_CONTROL_LOCAL,
+
+    /** sets the monitoring interval, or 0 to disable (uint64_t) */
+    UPIPE_TS_TSTD_SET_MONITOR,
+    /** returns the monitoring interval (uint64_t *) */
+    UPIPE_TS_TSTD_GET_MONITOR,
+};
+
+/** @This converts @ref upipe_ts_tstd_command to a string.
+ *
+ * @param command command to convert
+ * @return a string or NULL if invalid
+ */
+static inline const char *upipe_ts_tstd_command_str(int command)
+{
+    switch ((enum upipe_ts_tstd_command)command) {
+    UBASE_CASE_TO_STR(UPIPE_TS_TSTD_SET_MONITOR);
+    UBASE_CASE_TO_STR(UPIPE_TS_TSTD_GET_MONITOR);
+    case UPIPE_TS_TSTD_SENTINEL: break;
+    }
+    return NULL;
+}
+
+/** @This enables the monitoring mode and sets the report interval. An
+ * interval of 0 disables the monitoring mode.
+ *
+ * @param upipe description structure of the pipe
+ * @param interval report interval in clock ticks
+ * @return an error code
+ */
+static inline int upipe_ts_tstd_set_monitor(struct upipe *upipe,
+                                            uint64_t interval)
+{
+    return upipe_control(upipe, UPIPE_TS_TSTD_SET_MONITOR,
+                         UPIPE_TS_TSTD_SIGNATURE, interval);
+}
+
+/** @This returns the report interval of the monitoring mode.
+ *
+ * @param upipe description structure of the pipe
+ * @param interval_p filled in with the report interval in clock ticks, or 0
+ * @return an error code
+ */
+static inline int upipe_ts_tstd_get_monitor(struct upipe *upipe,
+                                            uint64_t *interval_p)
+{
+    return upipe_control(upipe, UPIPE_TS_TSTD_GET_MONITOR,
+                         UPIPE_TS_TSTD_SIGNATURE, interval_p);
+}
+
 /** @This returns the management structure for all ts_tstd pipes.
  *
  * @return pointer to manager
@@ -37,6 +37,30 @@ extern "C" {
 
 #define UPIPE_V210DEC_SIGNATURE UBASE_FOURCC('v','2','1','d')
 
+/** @This extends upipe_command with specific commands for v210dec pipes. */
+enum upipe_v210dec_command {
+    UPIPE_V210DEC_SENTINEL = UPIPE_CONTROL_LOCAL,
+
+    /** sets the number of unpacking threads (unsigned int) */
+    UPIPE_V210DEC_SET_THREADS,
+};
+
+/** @This sets the number of threads unpacking each picture. With 0 or 1
+ * (the default), pictures are unpacked in the thread of the pipe. Otherwise
+ * each picture is split into ranges of lines unpacked concurrently by the
+ * thread of the pipe and nb_threads - 1 worker threads.
+ *
+ * @param upipe description structure of the pipe
+ * @param nb_threads number of threads
+ * @return an error code
+ */
+static inline int upipe_v210dec_set_threads(struct upipe *upipe,
+                                            unsigned int nb_threads)
+{
+    return upipe_control(upipe, UPIPE_V210DEC_SET_THREADS,
+                         UPIPE_V210DEC_SIGNATURE, nb_threads);
+}
+
 /** @This returns the management structure for v210 pipes.
  *
  * @return pointer to manager
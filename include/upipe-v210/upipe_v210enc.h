@@ -37,6 +37,31 @@ extern "C" {
 
 #define UPIPE_V210ENC_SIGNATURE UBASE_FOURCC('v','2','1','e')
 
+/** @This extends upipe_command with specific commands for v210enc pipes. */
+enum upipe_v210enc_command {
+    UPIPE_V210ENC_SENTINEL = UPIPE_CONTROL_LOCAL,
+
+    /** sets the number of packing threads (unsigned int) */
+    UPIPE_V210ENC_SET_THREADS,
+};
+
+/** @This sets the number of threads packing each picture. With 0 or 1 (the
+ * default), pictures are packed in the thread of the pipe. Otherwise each
+ * picture is split into ranges of lines packed concurrently by the thread
+ * of the pipe and nb_threads - 1 worker threads, and is output once all
+ * the lines are packed.
+ *
+ * @param upipe description structure of the pipe
+ * @param nb_threads number of threads
+ * @return an error code
+ */
+static inline int upipe_v210enc_set_threads(struct upipe *upipe,
+                                            unsigned int nb_threads)
+{
+    return upipe_control(upipe, UPIPE_V210ENC_SET_THREADS,
+                         UPIPE_V210ENC_SIGNATURE, nb_threads);
+}
+
 /** @This returns the management structure for v210 pipes.
  *
  * @return pointer to manager
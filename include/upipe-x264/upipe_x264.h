@@ -40,6 +40,15 @@ extern "C" {
 
 #define UPIPE_X264_SIGNATURE UBASE_FOURCC('x','2','6','4')
 
+/** @This extends uprobe_event with specific events for x264. */
+enum uprobe_x264_event {
+    UPROBE_X264_SENTINEL = UPROBE_LOCAL,
+
+    /** the load control changed the speed level, 0 being the configured
+     * parameters (unsigned int) */
+    UPROBE_X264_LOAD_LEVEL
+};
+
 /** @This extends upipe_command with specific commands for x264. */
 enum upipe_x264_command {
     UPIPE_X264_SENTINEL = UPIPE_CONTROL_LOCAL,
@@ -63,7 +72,16 @@ enum upipe_x264_command {
     UPIPE_X264_SET_SC_LATENCY,
 
     /** set slice type enforcement mode (int) */
-    UPIPE_X264_SET_SLICE_TYPE_ENFORCE
+    UPIPE_X264_SET_SLICE_TYPE_ENFORCE,
+
+    /** set the depth of the rate control lookahead (int) */
+    UPIPE_X264_SET_LOOKAHEAD,
+
+    /** set the number of frame threads (int) */
+    UPIPE_X264_SET_THREADS,
+
+    /** set load control mode (int) */
+    UPIPE_X264_SET_LOAD_CONTROL
 };
 
 /** @This reconfigures encoder with updated parameters.
@@ -151,6 +169,55 @@ static inline int upipe_x264_set_slice_type_enforce(struct upipe *upipe,
                          UPIPE_X264_SIGNATURE, enforce ? 1 : 0);
 }
 
+/** @This sets the depth of the rate control lookahead, in frames. Each
+ * frame of lookahead adds one frame of latency. If the encoder is already
+ * opened, it is flushed and reopened on the next picture, and the latency of
+ * the output flow definition is updated accordingly.
+ *
+ * @param upipe description structure of the pipe
+ * @param depth number of frames of lookahead
+ * @return an error code
+ */
+static inline int upipe_x264_set_lookahead(struct upipe *upipe, int depth)
+{
+    return upipe_control(upipe, UPIPE_X264_SET_LOOKAHEAD,
+                         UPIPE_X264_SIGNATURE, depth);
+}
+
+/** @This sets the number of frame threads (0 for automatic). Each frame
+ * thread adds one frame of latency. If the encoder is already opened, it is
+ * flushed and reopened on the next picture, and the latency of the output
+ * flow definition is updated accordingly.
+ *
+ * @param upipe description structure of the pipe
+ * @param threads number of frame threads
+ * @return an error code
+ */
+static inline int upipe_x264_set_threads(struct upipe *upipe, int threads)
+{
+    return upipe_control(upipe, UPIPE_X264_SET_THREADS,
+                         UPIPE_X264_SIGNATURE, threads);
+}
+
+/** @This enables or disables the load control. When enabled, the time spent
+ * encoding is compared to the duration of the frames, and the analysis
+ * parameters (subme, motion estimation, references, trellis, partitions) are
+ * lowered step by step with x264_encoder_reconfig when the encoder cannot
+ * keep up with real time, and restored when it has enough headroom. An
+ * event @ref UPROBE_X264_LOAD_LEVEL is thrown on each step. A uclock is
+ * required.
+ *
+ * @param upipe description structure of the pipe
+ * @param enable true to enable the load control
+ * @return an error code
+ */
+static inline int upipe_x264_set_load_control(struct upipe *upipe,
+                                              bool enable)
+{
+    return upipe_control(upipe, UPIPE_X264_SET_LOAD_CONTROL,
+                         UPIPE_X264_SIGNATURE, enable ? 1 : 0);
+}
+
 /** @This returns the management structure for x264 pipes.
  *
  * @return pointer to manager
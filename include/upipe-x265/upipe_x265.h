@@ -40,6 +40,15 @@ extern "C" {
 
 #define UPIPE_X265_SIGNATURE UBASE_FOURCC('x','2','6','5')
 
+/** @This extends uprobe_event with specific events for x265. */
+enum uprobe_x265_event {
+    UPROBE_X265_SENTINEL = UPROBE_LOCAL,
+
+    /** the load control changed the speed level, 0 being the configured
+     * preset (unsigned int) */
+    UPROBE_X265_LOAD_LEVEL
+};
+
 /** @This extends upipe_command with specific commands for x265. */
 enum upipe_x265_command {
     UPIPE_X265_SENTINEL = UPIPE_CONTROL_LOCAL,
@@ -60,7 +69,22 @@ enum upipe_x265_command {
     UPIPE_X265_SET_SC_LATENCY,
 
     /** set slice type enforcement mode (int) */
-    UPIPE_X265_SET_SLICE_TYPE_ENFORCE
+    UPIPE_X265_SET_SLICE_TYPE_ENFORCE,
+
+    /** set load control mode (int) */
+    UPIPE_X265_SET_LOAD_CONTROL,
+
+    /** set the thread pools (const char *) */
+    UPIPE_X265_SET_POOLS,
+
+    /** restrict the thread pools to the local NUMA node (int) */
+    UPIPE_X265_SET_POOLS_LOCAL,
+
+    /** set the number of frame threads (int) */
+    UPIPE_X265_SET_FRAME_THREADS,
+
+    /** set wavefront parallel processing (int) */
+    UPIPE_X265_SET_WPP
 };
 
 /** @This reconfigures encoder with updated parameters.
@@ -141,6 +165,83 @@ static inline int upipe_x265_set_slice_type_enforce(struct upipe *upipe,
                          UPIPE_X265_SIGNATURE, enforce ? 1 : 0);
 }
 
+/** @This enables or disables the load control. When enabled, the time spent
+ * encoding is compared to the duration of the frames, and the encoder is
+ * switched to the next faster preset with x265_encoder_reconfig when it
+ * cannot keep up with real time, and back to slower presets, up to the
+ * configured one, when it has enough headroom. An event
+ * @ref UPROBE_X265_LOAD_LEVEL is thrown on each step. A uclock is required,
+ * and the load control is inactive in speedcontrol mode.
+ *
+ * @param upipe description structure of the pipe
+ * @param enable true to enable the load control
+ * @return an error code
+ */
+static inline int upipe_x265_set_load_control(struct upipe *upipe,
+                                              bool enable)
+{
+    return upipe_control(upipe, UPIPE_X265_SET_LOAD_CONTROL,
+                         UPIPE_X265_SIGNATURE, enable ? 1 : 0);
+}
+
+/** @This sets the thread pools of the encoder, with the syntax of the x265
+ * "pools" option (for instance "-,+" to use all the CPUs of the second NUMA
+ * node only). The thread pools are created when the encoder is opened, so
+ * this must be called before the first picture.
+ *
+ * @param upipe description structure of the pipe
+ * @param pools x265 pools string, or NULL for the default
+ * @return an error code
+ */
+static inline int upipe_x265_set_pools(struct upipe *upipe, const char *pools)
+{
+    return upipe_control(upipe, UPIPE_X265_SET_POOLS, UPIPE_X265_SIGNATURE,
+                         pools);
+}
+
+/** @This restricts the thread pools of the encoder to the NUMA node of the
+ * thread which opens it, that is the thread running the pipe (typically a
+ * upipe_pthread worker, whose CPU affinity should be set to a single node).
+ * This overrides @ref upipe_x265_set_pools, and must be called before the
+ * first picture.
+ *
+ * @param upipe description structure of the pipe
+ * @param local true to use the local NUMA node only
+ * @return an error code
+ */
+static inline int upipe_x265_set_pools_local(struct upipe *upipe, bool local)
+{
+    return upipe_control(upipe, UPIPE_X265_SET_POOLS_LOCAL,
+                         UPIPE_X265_SIGNATURE, local ? 1 : 0);
+}
+
+/** @This sets the number of frames encoded in parallel (0 for automatic).
+ * This must be called before the first picture.
+ *
+ * @param upipe description structure of the pipe
+ * @param frame_threads number of frame threads
+ * @return an error code
+ */
+static inline int upipe_x265_set_frame_threads(struct upipe *upipe,
+                                               int frame_threads)
+{
+    return upipe_control(upipe, UPIPE_X265_SET_FRAME_THREADS,
+                         UPIPE_X265_SIGNATURE, frame_threads);
+}
+
+/** @This enables or disables wavefront parallel processing. This must be
+ * called before the first picture.
+ *
+ * @param upipe description structure of the pipe
+ * @param wpp true to enable wavefront parallel processing
+ * @return an error code
+ */
+static inline int upipe_x265_set_wpp(struct upipe *upipe, bool wpp)
+{
+    return upipe_control(upipe, UPIPE_X265_SET_WPP, UPIPE_X265_SIGNATURE,
+                         wpp ? 1 : 0);
+}
+
 /** @This returns the management structure for x265 pipes.
  *
  * @return pointer to manager
@@ -49,21 +49,34 @@ extern "C" {
 
 #include <stdatomic.h>
 typedef uint32_t _Atomic uatomic_uint32_t;
+typedef uint64_t _Atomic uatomic_uint64_t;
 typedef void * _Atomic uatomic_ptr_t;
 
 #define uatomic_init atomic_init
+#define uatomic_uint64_init atomic_init
 #define uatomic_ptr_init atomic_init
 #define uatomic_store atomic_store
+#define uatomic_uint64_store atomic_store
 #define uatomic_ptr_store atomic_store
 #define uatomic_load atomic_load
+#define uatomic_uint64_load atomic_load
 #define uatomic_ptr_load atomic_load
+#define uatomic_load_relaxed(a) atomic_load_explicit(a, memory_order_relaxed)
+#define uatomic_uint64_load_relaxed(a) \
+    atomic_load_explicit(a, memory_order_relaxed)
+#define uatomic_ptr_load_relaxed(a) \
+    atomic_load_explicit(a, memory_order_relaxed)
 #define uatomic_clean(a)
+#define uatomic_uint64_clean(a)
 #define uatomic_ptr_clean(a)
 #define uatomic_compare_exchange atomic_compare_exchange_strong
+#define uatomic_uint64_compare_exchange atomic_compare_exchange_strong
 #define uatomic_ptr_compare_exchange atomic_compare_exchange_strong
 
 #define uatomic_fetch_add atomic_fetch_add
+#define uatomic_uint64_fetch_add atomic_fetch_add
 #define uatomic_fetch_sub atomic_fetch_sub
+#define uatomic_uint64_fetch_sub atomic_fetch_sub
 
 #elif defined(UPIPE_HAVE_ATOMIC_OPS)
 
@@ -71,10 +84,14 @@ typedef void * _Atomic uatomic_ptr_t;
  * Preferred method: gcc atomic operations
  */
 
-/** @This defines an atomic 32-bits unsigned integer. ARM platforms do not
- * support larger atomic operations. */
+/** @This defines an atomic 32-bits unsigned integer. */
 typedef uint32_t uatomic_uint32_t;
 
+/** @This defines an atomic 64-bits unsigned integer. Older ARM platforms do
+ * not support larger atomic operations natively, so it should be reserved
+ * to counters that are not on the fast path of every platform. */
+typedef uint64_t uatomic_uint64_t;
+
 /** @This defines an atomic pointer. */
 typedef void * uatomic_ptr_t;
 
@@ -111,6 +128,16 @@ static inline ctype type##_load(atomictype *obj)                            \
     __sync_synchronize();                                                   \
     return *obj;                                                            \
 }                                                                           \
+/** @This returns the value of the uatomic variable, without ordering it    \
+ * with other memory accesses. It is meant for flags polled on fast paths.  \
+ *                                                                          \
+ * @param obj pointer to a uatomic variable                                 \
+ * @return the value                                                        \
+ */                                                                         \
+static inline ctype type##_load_relaxed(atomictype *obj)                    \
+{                                                                           \
+    return *(volatile atomictype *)obj;                                     \
+}                                                                           \
 /** @This atomically replaces the uatomic variable, if it contains an       \
  * expected value, with a desired value.                                    \
  *                                                                          \
@@ -137,6 +164,7 @@ static inline void type##_clean(atomictype *obj)                            \
 {                                                                           \
 }
 UATOMIC_TEMPLATE(uatomic, uint32_t, uatomic_uint32_t)
+UATOMIC_TEMPLATE(uatomic_uint64, uint64_t, uatomic_uint64_t)
 UATOMIC_TEMPLATE(uatomic_ptr, void *, uatomic_ptr_t)
 #undef UATOMIC_TEMPLATE
 
@@ -164,6 +192,30 @@ static inline uint32_t uatomic_fetch_sub(uatomic_uint32_t *obj,
     return __sync_fetch_and_sub(obj, operand);
 }
 
+/** @This increments a 64-bits uatomic variable.
+ *
+ * @param obj pointer to a uatomic variable
+ * @param operand value to add
+ * @return value before the operation
+ */
+static inline uint64_t uatomic_uint64_fetch_add(uatomic_uint64_t *obj,
+                                                uint64_t operand)
+{
+    return __sync_fetch_and_add(obj, operand);
+}
+
+/** @This decrements a 64-bits uatomic variable.
+ *
+ * @param obj pointer to a uatomic variable
+ * @param operand value to subtract
+ * @return value before the operation
+ */
+static inline uint64_t uatomic_uint64_fetch_sub(uatomic_uint64_t *obj,
+                                                uint64_t operand)
+{
+    return __sync_fetch_and_sub(obj, operand);
+}
+
 
 #elif defined(UPIPE_HAVE_SEMAPHORE_H) /* mkdoc:skip */
 
@@ -198,6 +250,10 @@ static inline ctype type##_load(atomictype *obj)                            \
     sem_post(&obj->lock);                                                   \
     return ret;                                                             \
 }                                                                           \
+static inline ctype type##_load_relaxed(atomictype *obj)                    \
+{                                                                           \
+    return type##_load(obj);                                                \
+}                                                                           \
 static inline bool type##_compare_exchange(atomictype *obj,                 \
                                            ctype *expected, ctype desired)  \
 {                                                                           \
@@ -216,6 +272,7 @@ static inline void type##_clean(atomictype *obj)                            \
     sem_destroy(&obj->lock);                                                \
 }
 UATOMIC_TEMPLATE(uatomic, uint32_t, uatomic_uint32_t)
+UATOMIC_TEMPLATE(uatomic_uint64, uint64_t, uatomic_uint64_t)
 UATOMIC_TEMPLATE(uatomic_ptr, void *, uatomic_ptr_t)
 #undef UATOMIC_TEMPLATE
 
@@ -241,6 +298,27 @@ static inline uint32_t uatomic_fetch_sub(uatomic_uint32_t *obj,
     return ret;
 }
 
+static inline uint64_t uatomic_uint64_fetch_add(uatomic_uint64_t *obj,
+                                                uint64_t operand)
+{
+    uint64_t ret;
+    while (sem_wait(&obj->lock) == -1);
+    ret = obj->value;
+    obj->value += operand;
+    sem_post(&obj->lock);
+    return ret;
+}
+
+static inline uint64_t uatomic_uint64_fetch_sub(uatomic_uint64_t *obj,
+                                                uint64_t operand)
+{
+    uint64_t ret;
+    while (sem_wait(&obj->lock) == -1);
+    ret = obj->value;
+    obj->value -= operand;
+    sem_post(&obj->lock);
+    return ret;
+}
 
 
 #else /* mkdoc:skip */
@@ -38,9 +38,12 @@ extern "C" {
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <string.h>
 #include <assert.h>
 
-/** @This is a helper allowing to write bits by bits to a buffer. */
+/** @This is a helper allowing to write bits by bits to a buffer. Bits are
+ * accumulated in a 64-bit cache, which is flushed to the buffer eight octets
+ * at a time. */
 struct ubits {
     /** pointer to buffer */
     uint8_t *buffer;
@@ -48,7 +51,7 @@ struct ubits {
     uint8_t *buffer_end;
 
     /** bits cache */
-    uint32_t bits;
+    uint64_t bits;
     /** number of available bits */
     uint32_t available;
     /** true if the bit stream cache overflows */
@@ -67,7 +70,7 @@ static inline void ubits_init(struct ubits *s,
     s->buffer = buffer;
     s->buffer_end = buffer + buffer_size;
     s->bits = 0;
-    s->available = 32;
+    s->available = 64;
     s->overflow = false;
 }
 
@@ -88,19 +91,65 @@ static inline void ubits_put(struct ubits *s, uint8_t nb, uint32_t value)
         return;
     }
 
-    if (unlikely(s->buffer + 4 > s->buffer_end)) {
+    if (unlikely(s->buffer + 8 > s->buffer_end)) {
         s->overflow = true;
         return;
     }
 
     s->bits <<= s->available;
     s->bits |= value >> (nb - s->available);
-    *s->buffer++ = s->bits >> 24;
-    *s->buffer++ = (s->bits & 0xffffff) >> 16;
-    *s->buffer++ = (s->bits & 0xffff) >> 8;
-    *s->buffer++ = s->bits & 0xff;
+    for (int i = 56; i >= 0; i -= 8)
+        *s->buffer++ = s->bits >> i;
     s->bits = value;
-    s->available += 32 - nb;
+    s->available += 64 - nb;
+}
+
+/** @This puts up to 64 bits into the bitstream.
+ *
+ * @param s helper structure
+ * @param nb number of bits to write
+ * @param value value to write
+ */
+static inline void ubits_put64(struct ubits *s, uint8_t nb, uint64_t value)
+{
+    assert(nb && nb <= 64);
+    assert(nb == 64 || value < (UINT64_C(1) << nb));
+
+    if (nb > 32) {
+        ubits_put(s, nb - 32, value >> 32);
+        nb = 32;
+    }
+    ubits_put(s, nb, value & UINT32_MAX);
+}
+
+/** @This puts a string of octets into the bitstream. When the bitstream is
+ * octet-aligned, the octets are copied directly to the buffer.
+ *
+ * @param s helper structure
+ * @param octets pointer to the octets to write
+ * @param size number of octets to write
+ */
+static inline void ubits_put_octets(struct ubits *s, const uint8_t *octets,
+                                    size_t size)
+{
+    if (s->available % 8) {
+        while (size--)
+            ubits_put(s, 8, *octets++);
+        return;
+    }
+
+    if (unlikely(s->buffer + (64 - s->available) / 8 + size >
+                 s->buffer_end)) {
+        s->overflow = true;
+        return;
+    }
+
+    while (s->available < 64) {
+        *s->buffer++ = s->bits >> (56 - s->available);
+        s->available += 8;
+    }
+    memcpy(s->buffer, octets, size);
+    s->buffer += size;
 }
 
 /** @This cleans up the helper structure for bit-oriented writer.
@@ -114,13 +163,13 @@ static inline int ubits_clean(struct ubits *s, uint8_t **buffer_end_p)
     if (unlikely(s->overflow))
         return UBASE_ERR_NOSPC;
 
-    if (s->available < 32)
+    if (s->available < 64)
         s->bits <<= s->available;
-    while (s->available < 32) {
+    while (s->available < 64) {
         if (unlikely(s->buffer + 1 > s->buffer_end))
             return UBASE_ERR_NOSPC;
 
-        *s->buffer++ = s->bits >> 24;
+        *s->buffer++ = s->bits >> 56;
         s->bits <<= 8;
         s->available += 8;
     }
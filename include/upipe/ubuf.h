@@ -37,6 +37,7 @@ extern "C" {
 
 #include <upipe/ubase.h>
 #include <upipe/urefcount.h>
+#include <upipe/utrace.h>
 
 #include <stdint.h>
 #include <stdbool.h>
@@ -46,6 +47,8 @@ extern "C" {
 /** @hidden */
 struct ubuf_mgr;
 /** @hidden */
+struct upool_stats;
+/** @hidden */
 struct uref;
 
 /** @This is allocated by a manager and eventually points to a buffer
@@ -138,6 +141,17 @@ enum ubuf_mgr_command {
     UBUF_MGR_CHECK,
     /** release all buffers kept in pools (void) */
     UBUF_MGR_VACUUM,
+    /** enable or disable the statistics and reset them (bool) */
+    UBUF_MGR_SET_STATS,
+    /** read the statistics of the pools of ubufs and shared buffers
+     * (struct upool_stats *, struct upool_stats *) */
+    UBUF_MGR_GET_STATS,
+    /** returns the manager which actually allocates the buffers of a
+     * wrapping manager (struct ubuf_mgr **) */
+    UBUF_MGR_UNWRAP,
+    /** allocate structures in advance and keep them in the pools
+     * (unsigned int) */
+    UBUF_MGR_PREFILL,
 
     /** non-standard commands implemented by a ubuf manager can start from
      * there */
@@ -181,6 +195,7 @@ static inline struct ubuf *ubuf_alloc(struct ubuf_mgr *mgr,
     va_start(args, signature);
     ubuf = mgr->ubuf_alloc(mgr, signature, args);
     va_end(args);
+    UTRACE3(ubuf_alloc, mgr, signature, ubuf);
     return ubuf;
 }
 
@@ -240,6 +255,7 @@ static inline void ubuf_free(struct ubuf *ubuf)
 {
     if (ubuf == NULL)
         return;
+    UTRACE2(ubuf_free, ubuf, ubuf->mgr);
     ubuf->mgr->ubuf_free(ubuf);
 }
 
@@ -325,6 +341,68 @@ static inline int ubuf_mgr_vacuum(struct ubuf_mgr *mgr)
     return ubuf_mgr_control(mgr, UBUF_MGR_VACUUM);
 }
 
+/** @This enables or disables the statistics of a ubuf manager. Enabling
+ * them resets the counters.
+ *
+ * @param mgr pointer to ubuf manager
+ * @param enabled true to update the counters
+ * @return an error code
+ */
+static inline int ubuf_mgr_set_stats(struct ubuf_mgr *mgr, bool enabled)
+{
+    return ubuf_mgr_control(mgr, UBUF_MGR_SET_STATS, enabled);
+}
+
+/** @This reads the statistics of the pools of a ubuf manager. It may be
+ * called from any thread.
+ *
+ * @param mgr pointer to ubuf manager
+ * @param ubuf_stats filled in with the counters of the pool of ubuf
+ * structures (may be NULL)
+ * @param shared_stats filled in with the counters of the pool of shared
+ * buffers (may be NULL)
+ * @return an error code
+ */
+static inline int ubuf_mgr_get_stats(struct ubuf_mgr *mgr,
+                                     struct upool_stats *ubuf_stats,
+                                     struct upool_stats *shared_stats)
+{
+    return ubuf_mgr_control(mgr, UBUF_MGR_GET_STATS, ubuf_stats,
+                            shared_stats);
+}
+
+/** @This allocates structures in advance and keeps them in the pools of a
+ * ubuf manager, so that the first buffers allocated by a new pipeline do
+ * not hit the allocator. The data buffers themselves come from the umem
+ * manager, which has its own @ref umem_mgr_prefill.
+ *
+ * @param mgr pointer to ubuf manager
+ * @param count number of structures to allocate in each pool; the pools
+ * are not filled beyond their depth
+ * @return an error code
+ */
+static inline int ubuf_mgr_prefill(struct ubuf_mgr *mgr, unsigned int count)
+{
+    return ubuf_mgr_control(mgr, UBUF_MGR_PREFILL, count);
+}
+
+/** @This returns the manager which actually allocates the buffers, which is
+ * the one referenced by the ubufs. It differs from the given manager if the
+ * latter merely wraps another one, for instance to account allocations.
+ * The reference counter is not incremented.
+ *
+ * @param mgr pointer to ubuf manager
+ * @return pointer to the allocating ubuf manager
+ */
+static inline struct ubuf_mgr *ubuf_mgr_unwrap(struct ubuf_mgr *mgr)
+{
+    struct ubuf_mgr *wrapped;
+    while (mgr != NULL &&
+           ubase_check(ubuf_mgr_control(mgr, UBUF_MGR_UNWRAP, &wrapped)))
+        mgr = wrapped;
+    return mgr;
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -263,7 +263,7 @@ static inline int ubuf_block_unmap(struct ubuf *ubuf, int offset)
 
     struct ubuf_block *block = ubuf_block_from_ubuf(ubuf);
     if (block->map)
-        return ubase_check(ubuf_control(ubuf, UBUF_UNMAP_BLOCK));
+        return ubuf_control(ubuf, UBUF_UNMAP_BLOCK);
     return UBASE_ERR_NONE;
 }
 
@@ -488,11 +488,57 @@ static inline int ubuf_block_resize(struct ubuf *ubuf, int offset, int new_size)
     return UBASE_ERR_NONE;
 }
 
+/** @This removes octets from the beginning of a block ubuf, in place and
+ * without allocating anything. Contrary to @ref ubuf_block_resize, the
+ * segments which become empty are released, including the head segment, so
+ * the ubuf is replaced by its remaining segments.
+ *
+ * @param ubuf_p reference to the pointer to ubuf, changed if the head segment
+ * is released
+ * @param size number of octets to remove
+ * @return an error code
+ */
+static inline int ubuf_block_consume(struct ubuf **ubuf_p, size_t size)
+{
+    struct ubuf *ubuf = *ubuf_p;
+    if (unlikely(ubuf->mgr->signature != UBUF_ALLOC_BLOCK))
+        return UBASE_ERR_INVALID;
+
+    struct ubuf_block *block = ubuf_block_from_ubuf(ubuf);
+    if (unlikely(size > block->total_size))
+        return UBASE_ERR_INVALID;
+    size_t total_size = block->total_size - size;
+    struct ubuf *end_ubuf = block->cached_end_ubuf;
+
+    while (block->next_ubuf != NULL && size >= block->size) {
+        struct ubuf *next = block->next_ubuf;
+        size -= block->size;
+        if (end_ubuf == ubuf)
+            end_ubuf = next;
+        block->next_ubuf = NULL;
+        ubuf_free(ubuf);
+        ubuf = next;
+        block = ubuf_block_from_ubuf(ubuf);
+    }
+
+    block->offset += size;
+    block->size -= size;
+    block->total_size = total_size;
+    block->cached_ubuf = ubuf;
+    block->cached_offset = 0;
+    block->cached_end_ubuf = end_ubuf;
+    *ubuf_p = ubuf;
+    return UBASE_ERR_NONE;
+}
+
 /** @This prepends a block ubuf, if possible. This will only work if
- * prepend has been correctly specified at allocation.
+ * prepend has been correctly specified at allocation, and if the first
+ * segment is not shared, so that the new octets may be written in place
+ * without allocating another segment.
  *
  * Should this fail, @ref ubuf_block_merge may be used to achieve the same
- * goal with an extra buffer copy.
+ * goal with an extra buffer copy, or a header segment may be allocated and
+ * the ubuf appended to it.
  *
  * @param ubuf pointer to ubuf
  * @param prepend number of octets to prepend
@@ -508,11 +554,13 @@ static inline int ubuf_block_prepend(struct ubuf *ubuf, int prepend)
 
     if (prepend > block->offset)
         return UBASE_ERR_INVALID;
+    UBASE_RETURN(ubuf_control(ubuf, UBUF_SINGLE))
 
     block->offset -= prepend;
     block->size += prepend;
     block->total_size += prepend;
-    block->cached_offset += prepend;
+    if (block->cached_ubuf != ubuf)
+        block->cached_offset += prepend;
     return UBASE_ERR_NONE;
 }
 
@@ -917,6 +965,50 @@ static inline int ubuf_block_merge(struct ubuf_mgr *mgr, struct ubuf **ubuf_p,
     return UBASE_ERR_NONE;
 }
 
+/** @This makes part of a (possibly segmented) ubuf contiguous for reading,
+ * and replaces the old ubuf with the new ubuf. Contrary to
+ * @ref ubuf_block_merge, no data is copied if the wanted part already lies in
+ * a single segment: it is then only spliced, so the new ubuf may share its
+ * buffer and must not be written to.
+ *
+ * @param mgr management structure used if the data has to be copied
+ * @param ubuf_p reference to a pointer to ubuf to replace with a non-segmented
+ * block ubuf
+ * @param skip number of octets to skip at the beginning of the buffer
+ * (if < 0, extend buffer upwards)
+ * @param new_size size of the buffer space wanted, in octets, or -1 for the end
+ * of the block
+ * @return an error code
+ */
+static inline int ubuf_block_merge_read(struct ubuf_mgr *mgr,
+                                        struct ubuf **ubuf_p,
+                                        int skip, int new_size)
+{
+    if (unlikely((*ubuf_p)->mgr->signature != UBUF_ALLOC_BLOCK))
+        return UBASE_ERR_INVALID;
+
+    struct ubuf_block *block = ubuf_block_from_ubuf(*ubuf_p);
+    if (skip >= 0 && (size_t)skip < block->total_size) {
+        int offset = skip, size = new_size;
+        struct ubuf *segment = ubuf_block_get(*ubuf_p, &offset, &size);
+        if (segment != NULL && size > 0 &&
+            offset + size <= ubuf_block_from_ubuf(segment)->size) {
+            if (segment == *ubuf_p && !offset && size == block->total_size)
+                /* already contiguous */
+                return UBASE_ERR_NONE;
+
+            struct ubuf *new_ubuf = ubuf_block_splice(*ubuf_p, skip,
+                                                      new_size);
+            if (likely(new_ubuf != NULL)) {
+                ubuf_free(*ubuf_p);
+                *ubuf_p = new_ubuf;
+                return UBASE_ERR_NONE;
+            }
+        }
+    }
+    return ubuf_block_merge(mgr, ubuf_p, skip, new_size);
+}
+
 /** @This allocates a new ubuf and copies data from an opaque pointer to it.
  *
  * @param mgr management structure for this ubuf type
@@ -1080,29 +1172,45 @@ static inline int ubuf_block_find_va(struct ubuf *ubuf, size_t *offset_p,
                                      unsigned int nb_octets, va_list args)
 {
     assert(nb_octets > 0);
-    unsigned int sync = va_arg(args, unsigned int);
+    uint8_t words[nb_octets];
+    for (int i = 0; i < nb_octets; i++)
+        words[i] = va_arg(args, unsigned int);
     if (nb_octets == 1)
-        return ubuf_block_scan(ubuf, offset_p, sync);
+        return ubuf_block_scan(ubuf, offset_p, words[0]);
 
+    const uint8_t *buffer;
+    int size = -1;
     for ( ; ; ) {
-        UBASE_RETURN(ubuf_block_scan(ubuf, offset_p, sync))
-        uint8_t rbuffer[nb_octets - 1];
-        const uint8_t *buffer = ubuf_block_peek(ubuf, *offset_p + 1,
-                                                nb_octets - 1, rbuffer);
-        if (buffer == NULL)
-            return UBASE_ERR_INVALID;
-
-        va_list args_copy;
-        va_copy(args_copy, args);
-        int i;
-        for (i = 0; i < nb_octets - 1; i++) {
-            unsigned int word = va_arg(args_copy, unsigned int);
-            if (buffer[i] != word)
+        UBASE_RETURN(ubuf_block_read(ubuf, *offset_p, &size, &buffer))
+        /* compare candidates in place as long as they fit in the segment */
+        const uint8_t *end = buffer + size;
+        const uint8_t *match = buffer;
+        while ((match = memchr(match, words[0], end - match)) != NULL &&
+               end - match >= nb_octets) {
+            if (!memcmp(match + 1, words + 1, nb_octets - 1))
                 break;
+            match++;
+        }
+        ubuf_block_unmap(ubuf, *offset_p);
+        if (match == NULL) {
+            *offset_p += size;
+            size = -1;
+            continue;
         }
-        va_end(args_copy);
-        ubuf_block_peek_unmap(ubuf, *offset_p + 1, rbuffer, buffer);
-        if (i == nb_octets - 1)
+        *offset_p += match - buffer;
+        size = -1;
+        if (end - match >= nb_octets)
+            return UBASE_ERR_NONE;
+
+        /* the candidate spans several segments */
+        uint8_t rbuffer[nb_octets - 1];
+        const uint8_t *peek = ubuf_block_peek(ubuf, *offset_p + 1,
+                                              nb_octets - 1, rbuffer);
+        if (peek == NULL)
+            return UBASE_ERR_INVALID;
+        bool found = !memcmp(peek, words + 1, nb_octets - 1);
+        ubuf_block_peek_unmap(ubuf, *offset_p + 1, rbuffer, peek);
+        if (found)
             return UBASE_ERR_NONE;
         (*offset_p)++;
     }
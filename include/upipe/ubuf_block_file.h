@@ -0,0 +1,127 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short Upipe ubuf manager for block formats backed by a file range
+ * The buffers of this manager do not hold the payload, but a range of a
+ * file descriptor. Sinks may then transfer it with sendfile() without ever
+ * copying it to user space. The payload is only read from the file if a
+ * pipe maps the buffer. Please note that the file must not be modified while
+ * buffers are in use.
+ */
+
+#ifndef _UPIPE_UBUF_BLOCK_FILE_H_
+/** @hidden */
+#define _UPIPE_UBUF_BLOCK_FILE_H_
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <upipe/ubase.h>
+#include <upipe/ubuf.h>
+#include <upipe/ubuf_block.h>
+
+#include <stdint.h>
+
+/** @This is a simple signature to make sure the ubuf_control internal API
+ * is used properly. */
+#define UBUF_BLOCK_FILE_SIGNATURE UBASE_FOURCC('f','i','l','e')
+/** @This is the signature to use to allocate from a file range. */
+#define UBUF_BLOCK_FILE_ALLOC_RANGE UBASE_FOURCC('f','i','l','r')
+
+/** @This extends ubuf_command with specific commands for block file
+ * manager. */
+enum ubuf_block_file_command {
+    UBUF_BLOCK_FILE_SENTINEL = UBUF_CONTROL_LOCAL,
+
+    /** returns the file range of a segment (int *, uint64_t *) */
+    UBUF_BLOCK_FILE_GET_RANGE
+};
+
+/** @This returns a new ubuf pointing to a range of the file of the manager.
+ *
+ * @param mgr management structure for this ubuf type
+ * @param offset offset of the range in the file, in octets
+ * @param size size of the range, in octets
+ * @return pointer to ubuf or NULL in case of failure
+ */
+static inline struct ubuf *ubuf_block_file_alloc(struct ubuf_mgr *mgr,
+                                                 uint64_t offset, int size)
+{
+    return ubuf_alloc(mgr, UBUF_BLOCK_FILE_ALLOC_RANGE, offset, size);
+}
+
+/** @This returns the file range backing the buffer space at the given
+ * offset. It fails if the segment is not backed by a file, or if it was
+ * mapped for writing.
+ *
+ * The size parameter must be inited with the desired size, or -1 for up to
+ * the end of the buffer. However, if the block is segmented, it may be
+ * decreased during execution.
+ *
+ * @param ubuf pointer to ubuf
+ * @param offset offset of the buffer space wanted in the whole block, in
+ * octets, negative values start from the end
+ * @param size_p pointer to the size of the buffer space wanted, in octets,
+ * or -1 for the end of the block, changed during execution for the actual
+ * size of the range
+ * @param fd_p filled in with the file descriptor (which must not be closed)
+ * @param file_offset_p filled in with the offset of the range in the file
+ * @return an error code
+ */
+static inline int ubuf_block_file_get_range(struct ubuf *ubuf, int offset,
+                                            int *size_p, int *fd_p,
+                                            uint64_t *file_offset_p)
+{
+    if (unlikely(ubuf->mgr->signature != UBUF_ALLOC_BLOCK ||
+                 (ubuf = ubuf_block_get(ubuf, &offset, size_p)) == NULL))
+        return UBASE_ERR_INVALID;
+
+    UBASE_RETURN(ubuf_control(ubuf, UBUF_BLOCK_FILE_GET_RANGE,
+                              UBUF_BLOCK_FILE_SIGNATURE, fd_p, file_offset_p))
+    struct ubuf_block *block = ubuf_block_from_ubuf(ubuf);
+    *file_offset_p += block->offset + offset;
+    if (size_p != NULL && *size_p > block->size - offset)
+        *size_p = block->size - offset;
+    return UBASE_ERR_NONE;
+}
+
+/** @This allocates a new instance of the ubuf manager for block formats
+ * backed by a range of a file.
+ *
+ * @param ubuf_pool_depth maximum number of ubuf structures in the pool
+ * @param shared_pool_depth maximum number of shared structures in the pool
+ * @param fd file descriptor of the file (it is duplicated, so the caller
+ * may close it afterwards)
+ * @return pointer to manager, or NULL in case of error
+ */
+struct ubuf_mgr *ubuf_block_file_mgr_alloc(uint16_t ubuf_pool_depth,
+                                           uint16_t shared_pool_depth,
+                                           int fd);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -42,12 +42,43 @@ extern "C" {
 
 /** @hidden */
 struct umem_mgr;
+/** @hidden */
+struct ubuf_mem_shared;
+
+/** @This is a simple signature to make sure the ubuf_control internal API
+ * is used properly. */
+#define UBUF_BLOCK_MEM_SIGNATURE UBASE_FOURCC('m','e','m','b')
 
 /** @This is the signature to use to allocate from an ubuf_pic plane. */
 #define UBUF_BLOCK_MEM_ALLOC_FROM_PIC UBASE_FOURCC('m','e','m','p')
 /** @This is the signature to use to allocate from an ubuf_sound plane. */
 #define UBUF_BLOCK_MEM_ALLOC_FROM_SOUND UBASE_FOURCC('m','e','m','s')
 
+/** @This extends ubuf_command with specific commands for block mem manager. */
+enum ubuf_block_mem_command {
+    UBUF_BLOCK_MEM_SENTINEL = UBUF_CONTROL_LOCAL,
+
+    /** returns the shared substructure (struct ubuf_mem_shared **,
+     * size_t *, size_t *) */
+    UBUF_BLOCK_MEM_GET_SHARED
+};
+
+/** @This returns the underlying shared buffer of a block that is not
+ * segmented. The reference counter is not incremented.
+ *
+ * @param ubuf pointer to ubuf
+ * @param shared_p filled in with a pointer to the underlying shared buffer
+ * @param offset_p filled in with the offset of the data in the shared buffer
+ * @param size_p filled in with the size of the data
+ * @return an error code
+ */
+static inline int ubuf_block_mem_get_shared(struct ubuf *ubuf,
+        struct ubuf_mem_shared **shared_p, size_t *offset_p, size_t *size_p)
+{
+    return ubuf_control(ubuf, UBUF_BLOCK_MEM_GET_SHARED,
+                        UBUF_BLOCK_MEM_SIGNATURE, shared_p, offset_p, size_p);
+}
+
 /** @This returns a new ubuf from the block mem allocator, using a chroma of
  * a ubuf pic mem.
  *
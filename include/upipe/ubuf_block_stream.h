@@ -57,7 +57,7 @@ struct ubuf_block_stream {
     int size;
 
     /** bits cache */
-    uint32_t bits;
+    uint64_t bits;
     /** number of cached bits */
     uint32_t available;
     /** true if the bit stream cache overflows */
@@ -157,23 +157,34 @@ static inline int ubuf_block_stream_get(struct ubuf_block_stream *s,
 }
 
 /** @This fills the bit stream cache with at least the given number of bits,
- * with a custom function to pop octets.
+ * with a custom function to pop octets. Once a refill is necessary, the
+ * 64-bit cache is filled as much as possible so that the following reads
+ * are served from the cache.
  *
  * @param s helper structure
  * @param get_octet function to get extra octets
- * @param nb number of bits to ensure
+ * @param nb number of bits to ensure (up to 32)
  */
 #define ubuf_block_stream_fill_bits_inner(s, get_octet, nb)                 \
-    while ((s)->available < (nb)) {                                         \
+    do {                                                                    \
+        assert((nb) <= 32);                                                 \
+        if (likely((s)->available >= (nb)))                                \
+            break;                                                          \
         uint8_t octet;                                                      \
-        if (unlikely(!ubase_check(get_octet((s), &octet)))) {               \
-            octet = 0;                                                      \
-            (s)->overflow = true;                                           \
+        while ((s)->available < (nb)) {                                     \
+            if (unlikely(!ubase_check(get_octet((s), &octet)))) {           \
+                octet = 0;                                                  \
+                (s)->overflow = true;                                       \
+            }                                                               \
+            (s)->bits += (uint64_t)octet << (56 - (s)->available);          \
+            (s)->available += 8;                                            \
         }                                                                   \
-        (s)->bits += (uint32_t)octet << (24 - (s)->available);              \
-        (s)->available += 8;                                                \
-        assert((s)->available <= 32);                                       \
-    }
+        while ((s)->available <= 56 && !(s)->overflow &&                    \
+               ubase_check(get_octet((s), &octet))) {                       \
+            (s)->bits += (uint64_t)octet << (56 - (s)->available);          \
+            (s)->available += 8;                                            \
+        }                                                                   \
+    } while (0)
 
 /** @This fills the bit stream cache with at least the given number of bits.
  *
@@ -190,7 +201,7 @@ static inline int ubuf_block_stream_get(struct ubuf_block_stream *s,
  * @return bits from the cache
  */
 #define ubuf_block_stream_show_bits(s, nb)                                  \
-    ((s)->bits >> (32 - (nb)))
+    ((uint32_t)((s)->bits >> (64 - (nb))))
 
 /** @This discards the given number of bits from the cache.
  *
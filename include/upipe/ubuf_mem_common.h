@@ -159,6 +159,17 @@ void ubuf_mem_shared_free_inner(struct upool *upool, void *_shared);
  * Releases all structures kept in pools.
  *
  * @item @code
+ *  void ubuf_foo_mgr_set_stats_pool(struct ubuf_mgr *, bool)
+ * @end code
+ * Enables or disables the statistics of the pools.
+ *
+ * @item @code
+ *  void ubuf_foo_mgr_get_stats_pool(struct ubuf_mgr *, struct upool_stats *,
+ *  struct upool_stats *)
+ * @end code
+ * Reads the statistics of the pools.
+ *
+ * @item @code
  *  void ubuf_foo_mgr_clean_pool(struct ubuf_mgr *)
  * @end code
  * Called before deallocation of the manager.
@@ -253,6 +264,49 @@ static void STRUCTURE##_mgr_vacuum_pool(struct ubuf_mgr *mgr)               \
     upool_vacuum(&mem_mgr->UBUF_POOL);                                      \
     upool_vacuum(&mem_mgr->SHARED_POOL);                                    \
 }                                                                           \
+/** @internal @This allocates structures in advance and keeps them in the  \
+ * pools.                                                                   \
+ *                                                                          \
+ * @param mgr pointer to a ubuf manager                                     \
+ * @param count number of structures to allocate in each pool              \
+ */                                                                         \
+static void STRUCTURE##_mgr_prefill_pool(struct ubuf_mgr *mgr,              \
+                                         unsigned int count)                \
+{                                                                           \
+    struct STRUCTURE##_mgr *mem_mgr = STRUCTURE##_mgr_from_ubuf_mgr(mgr);   \
+    upool_prefill(&mem_mgr->UBUF_POOL, count);                              \
+    upool_prefill(&mem_mgr->SHARED_POOL, count);                            \
+}                                                                           \
+/** @internal @This enables or disables the statistics of the pools.       \
+ *                                                                          \
+ * @param mgr pointer to a ubuf manager                                     \
+ * @param enabled true to update the counters                               \
+ */                                                                         \
+static void STRUCTURE##_mgr_set_stats_pool(struct ubuf_mgr *mgr,            \
+                                           bool enabled)                    \
+{                                                                           \
+    struct STRUCTURE##_mgr *mem_mgr = STRUCTURE##_mgr_from_ubuf_mgr(mgr);   \
+    upool_set_stats(&mem_mgr->UBUF_POOL, enabled);                          \
+    upool_set_stats(&mem_mgr->SHARED_POOL, enabled);                        \
+}                                                                           \
+/** @internal @This reads the statistics of the pools.                      \
+ *                                                                          \
+ * @param mgr pointer to a ubuf manager                                     \
+ * @param ubuf_stats filled in with the counters of the ubuf pool (may be   \
+ * NULL)                                                                    \
+ * @param shared_stats filled in with the counters of the shared pool (may  \
+ * be NULL)                                                                 \
+ */                                                                         \
+static void STRUCTURE##_mgr_get_stats_pool(struct ubuf_mgr *mgr,            \
+                                           struct upool_stats *ubuf_stats,  \
+                                           struct upool_stats *shared_stats)\
+{                                                                           \
+    struct STRUCTURE##_mgr *mem_mgr = STRUCTURE##_mgr_from_ubuf_mgr(mgr);   \
+    if (ubuf_stats != NULL)                                                 \
+        upool_get_stats(&mem_mgr->UBUF_POOL, ubuf_stats);                   \
+    if (shared_stats != NULL)                                               \
+        upool_get_stats(&mem_mgr->SHARED_POOL, shared_stats);               \
+}                                                                           \
 /** @internal @This is called on deallocation of the manager.               \
  *                                                                          \
  * @param mgr pointer to a ubuf manager                                     \
@@ -324,6 +324,37 @@ static inline int ubuf_pic_resize(struct ubuf *ubuf, int hskip, int vskip,
                         new_hsize, new_vsize);
 }
 
+/** @This allocates a new ubuf giving a view of a window of a picture ubuf.
+ * The planes are shared with the original ubuf, and nothing is copied. The
+ * window may extend past the picture if prepend/append were specified at
+ * allocation, but the contents of the margins are undefined.
+ *
+ * @param ubuf pointer to ubuf
+ * @param hskip number of pixels to skip at the beginning of each line (if < 0,
+ * extend the picture leftwards)
+ * @param vskip number of lines to skip at the beginning of the picture (if < 0,
+ * extend the picture upwards)
+ * @param new_hsize horizontal size of the view, in pixels (if set to -1, keep
+ * same line ends)
+ * @param new_vsize vertical size of the view, in lines (if set to -1, keep
+ * same last line)
+ * @return pointer to the new ubuf or NULL in case of error
+ */
+static inline struct ubuf *ubuf_pic_view(struct ubuf *ubuf,
+                                         int hskip, int vskip,
+                                         int new_hsize, int new_vsize)
+{
+    struct ubuf *view = ubuf_dup(ubuf);
+    if (unlikely(view == NULL))
+        return NULL;
+    if (unlikely(!ubase_check(ubuf_pic_resize(view, hskip, vskip,
+                                              new_hsize, new_vsize)))) {
+        ubuf_free(view);
+        return NULL;
+    }
+    return view;
+}
+
 /** @This blits a picture ubuf to another ubuf.
  *
  * @param dest destination ubuf
@@ -48,6 +48,8 @@ extern "C" {
 /** @hidden */
 struct umem_mgr;
 /** @hidden */
+struct upool_stats;
+/** @hidden */
 struct ubuf_mem_shared;
 
 /** @This extends ubuf_command with specific commands for pic mem manager. */
@@ -122,6 +124,33 @@ int ubuf_pic_mem_mgr_add_plane(struct ubuf_mgr *mgr, const char *chroma,
                                uint8_t hsub, uint8_t vsub,
                                uint8_t macropixel_size);
 
+/** @This dedicates a pool of frame buffers to pictures of the given size.
+ * Buffers of released pictures of that size are kept in the pool instead of
+ * being returned to the umem allocator, which avoids allocating large frames
+ * in steady state. It may only be called on initializing the manager, after
+ * the planes are added and before any ubuf is allocated.
+ *
+ * @param mgr pointer to a ubuf_mgr structure
+ * @param hsize horizontal size of the pictures, in pixels
+ * @param vsize vertical size of the pictures, in lines
+ * @param depth maximum number of frame buffers in the pool
+ * @param prefill number of frame buffers to allocate immediately
+ * @return an error code
+ */
+int ubuf_pic_mem_mgr_add_frame_pool(struct ubuf_mgr *mgr,
+                                    int hsize, int vsize,
+                                    uint16_t depth, uint16_t prefill);
+
+/** @This reads the counters of the frame pool. They are only updated while
+ * the statistics of the manager are enabled, see @ref ubuf_mgr_set_stats.
+ *
+ * @param mgr pointer to a ubuf_mgr structure
+ * @param stats filled in with the counters of the frame pool
+ * @return an error code, UBASE_ERR_INVALID if there is no frame pool
+ */
+int ubuf_pic_mem_mgr_get_frame_stats(struct ubuf_mgr *mgr,
+                                     struct upool_stats *stats);
+
 /** @This allocates a new instance of the ubuf manager for picture formats
  * using umem, from a fourcc image format.
  *
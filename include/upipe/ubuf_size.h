@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/** @file
+ * @short Upipe size of the buffer of any ubuf type
+ */
+
+#ifndef _UPIPE_UBUF_SIZE_H_
+/** @hidden */
+#define _UPIPE_UBUF_SIZE_H_
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <upipe/ubase.h>
+#include <upipe/ubuf.h>
+#include <upipe/ubuf_block.h>
+#include <upipe/ubuf_pic.h>
+#include <upipe/ubuf_sound.h>
+
+#include <stdint.h>
+#include <stddef.h>
+
+/** @This returns the number of octets of the buffer of a block, picture or
+ * sound ubuf. For pictures and sounds, this is the total size of the planes.
+ *
+ * @param ubuf pointer to ubuf
+ * @param size_p filled in with the size in octets
+ * @return an error code
+ */
+static inline int ubuf_size(struct ubuf *ubuf, size_t *size_p)
+{
+    size_t size;
+    if (ubase_check(ubuf_block_size(ubuf, &size))) {
+        *size_p = size;
+        return UBASE_ERR_NONE;
+    }
+
+    size_t vsize;
+    if (ubase_check(ubuf_pic_size(ubuf, NULL, &vsize, NULL))) {
+        size_t total = 0;
+        const char *chroma = NULL;
+        while (ubase_check(ubuf_pic_plane_iterate(ubuf, &chroma)) &&
+               chroma != NULL) {
+            size_t stride;
+            uint8_t vsub;
+            if (ubase_check(ubuf_pic_plane_size(ubuf, chroma, &stride,
+                                                NULL, &vsub, NULL)))
+                total += stride * (vsize / vsub);
+        }
+        *size_p = total;
+        return UBASE_ERR_NONE;
+    }
+
+    uint8_t sample_size;
+    if (ubase_check(ubuf_sound_size(ubuf, &size, &sample_size))) {
+        size_t total = 0;
+        const char *channel = NULL;
+        while (ubase_check(ubuf_sound_plane_iterate(ubuf, &channel)) &&
+               channel != NULL)
+            total += size * sample_size;
+        *size_p = total;
+        return UBASE_ERR_NONE;
+    }
+    return UBASE_ERR_INVALID;
+}
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -253,6 +253,29 @@ static inline int ubuf_sound_resize(struct ubuf *ubuf, int offset, int new_size)
     return ubuf_control(ubuf, UBUF_RESIZE_SOUND, offset, new_size);
 }
 
+/** @This allocates a new ubuf giving a view of a range of samples of a
+ * sound ubuf, sharing its planes. This allows to allocate a large buffer
+ * once and to consume it frame by frame without any copy.
+ *
+ * @param ubuf pointer to ubuf
+ * @param offset offset of the view in the whole buffer, in samples,
+ * negative values start from the end
+ * @param new_size size of the view, in samples (if set to -1, keep same end)
+ * @return pointer to the new ubuf or NULL in case of error
+ */
+static inline struct ubuf *ubuf_sound_view(struct ubuf *ubuf,
+                                           int offset, int new_size)
+{
+    struct ubuf *view = ubuf_dup(ubuf);
+    if (unlikely(view == NULL))
+        return NULL;
+    if (unlikely(!ubase_check(ubuf_sound_resize(view, offset, new_size)))) {
+        ubuf_free(view);
+        return NULL;
+    }
+    return view;
+}
+
 /** @This copies a sound ubuf to a newly allocated ubuf, and doesn't deal
  * with the old ubuf or a dictionary.
  *
@@ -44,6 +44,12 @@ extern "C" {
  * is used properly. */
 #define UBUF_SOUND_MEM_SIGNATURE UBASE_FOURCC('m','e','m','s')
 
+/** @This is the signature to use to allocate from planes of another
+ * ubuf_sound. */
+#define UBUF_SOUND_MEM_ALLOC_FROM_SOUND UBASE_FOURCC('m','s','n','d')
+/** @This is the signature to use to allocate from a ubuf_block. */
+#define UBUF_SOUND_MEM_ALLOC_FROM_BLOCK UBASE_FOURCC('m','b','l','k')
+
 /** @hidden */
 struct umem_mgr;
 /** @hidden */
@@ -77,6 +83,43 @@ static inline int ubuf_sound_mem_get_shared(struct ubuf *ubuf,
                         offset_p, size_p);
 }
 
+/** @This returns a new ubuf from the sound mem allocator, whose planes are
+ * planes of a ubuf sound mem, without copying. The new ubuf holds a reference
+ * to the buffer of the original ubuf, so it remains read-only as long as
+ * both exist. The sample size of the manager must be the same as the one of
+ * the original ubuf.
+ *
+ * @param mgr management structure for this ubuf type
+ * @param ubuf_sound ubuf sound mem structure to use
+ * @param channels array of channel types of ubuf_sound (see channel
+ * reference), one for each plane of mgr, in allocation order
+ * @return pointer to ubuf or NULL in case of failure
+ */
+static inline struct ubuf *ubuf_sound_mem_alloc_from_sound(
+        struct ubuf_mgr *mgr, struct ubuf *ubuf_sound,
+        const char *const *channels)
+{
+    return ubuf_alloc(mgr, UBUF_SOUND_MEM_ALLOC_FROM_SOUND, ubuf_sound,
+                      channels);
+}
+
+/** @This returns a new ubuf from the sound mem allocator, whose single plane
+ * is the data of a ubuf block mem, without copying. The block must not be
+ * segmented, and trailing octets that do not make a complete sample are
+ * ignored. The new ubuf holds a reference to the buffer of the block, so it
+ * remains read-only as long as both exist. Alignment of the data is not
+ * checked.
+ *
+ * @param mgr management structure for this ubuf type, with only one plane
+ * @param ubuf_block ubuf block mem structure to use
+ * @return pointer to ubuf or NULL in case of failure
+ */
+static inline struct ubuf *ubuf_sound_mem_alloc_from_block(
+        struct ubuf_mgr *mgr, struct ubuf *ubuf_block)
+{
+    return ubuf_alloc(mgr, UBUF_SOUND_MEM_ALLOC_FROM_BLOCK, ubuf_block);
+}
+
 /** @This allocates a new instance of the ubuf manager for sound formats
  * using umem.
  *
@@ -84,7 +127,8 @@ static inline int ubuf_sound_mem_get_shared(struct ubuf *ubuf,
  * @param shared_pool_depth maximum number of shared structures in the pool
  * @param umem_mgr memory allocator to use for buffers
  * @param sample_size number of octets in a sample for a plane
- * @param align alignment in octets
+ * @param align alignment in octets (if set to 0, planes are aligned on a
+ * cache line)
  * @return pointer to manager, or NULL in case of error
  */
 struct ubuf_mgr *ubuf_sound_mem_mgr_alloc(uint16_t ubuf_pool_depth,
@@ -103,6 +147,21 @@ struct ubuf_mgr *ubuf_sound_mem_mgr_alloc(uint16_t ubuf_pool_depth,
  */
 int ubuf_sound_mem_mgr_add_plane(struct ubuf_mgr *mgr, const char *channel);
 
+/** @This dedicates a pool of buffers to sound ubufs of the given number of
+ * samples. Buffers of released ubufs of that size are kept in the pool
+ * instead of being returned to the umem allocator. It may only be called on
+ * initializing the manager, after the planes are added and before any ubuf
+ * is allocated.
+ *
+ * @param mgr pointer to a ubuf_mgr structure
+ * @param samples number of samples of the ubufs
+ * @param depth maximum number of buffers in the pool
+ * @param prefill number of buffers to allocate immediately
+ * @return an error code
+ */
+int ubuf_sound_mem_mgr_add_frame_pool(struct ubuf_mgr *mgr, size_t samples,
+                                      uint16_t depth, uint16_t prefill);
+
 #ifdef __cplusplus
 }
 #endif
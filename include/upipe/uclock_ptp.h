@@ -0,0 +1,60 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short Upipe implementation of uclock reading a PTP hardware clock
+ */
+
+#ifndef _UPIPE_UCLOCK_PTP_H_
+/** @hidden */
+#define _UPIPE_UCLOCK_PTP_H_
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <upipe/uclock.h>
+
+/** flags for the creation of a PTP uclock structure */
+enum uclock_ptp_flags {
+    /** read the monotonic clock, corrected against the PTP clock once in
+     * a while, instead of reading the PTP clock at each call */
+    UCLOCK_PTP_FLAG_CACHED = 0x1
+};
+
+/** @This allocates a new uclock structure returning the time of a PTP
+ * clock, that is the TAI time since 1970-01-01 00:00:00 TAI.
+ *
+ * @param device path to the PTP hardware clock (/dev/ptpN), or NULL to use
+ * the TAI time of the system, which is usually disciplined by phc2sys
+ * @param flags flags for the creation of a uclock structure
+ * @return pointer to uclock, or NULL in case of error
+ */
+struct uclock *uclock_ptp_alloc(const char *device,
+                                enum uclock_ptp_flags flags);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -39,7 +39,12 @@ extern "C" {
 /** flags for the creation of a uclock structure */
 enum uclock_std_flags {
     /** force using a real-time clock even if a monotonic clock is available */
-    UCLOCK_FLAG_REALTIME = 0x1
+    UCLOCK_FLAG_REALTIME = 0x1,
+    /** read the invariant time-stamp counter of the CPU instead of calling
+     * the system, calibrated against the monotonic clock; it is silently
+     * ignored if the CPU has no invariant TSC or with
+     * @ref UCLOCK_FLAG_REALTIME */
+    UCLOCK_FLAG_TSC = 0x2
 };
 
 /** @This allocates a new uclock structure.
@@ -0,0 +1,151 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short Upipe run-time selection of SIMD kernels
+ *
+ * The instruction set extensions of the CPU are detected once per process.
+ * Pipes describe their implementations of a kernel in a table ordered from
+ * the most to the least preferred, each entry starting with the set of
+ * extensions it requires, and pick the first entry that the CPU supports.
+ * The last entry normally requires nothing. The selection may be restricted
+ * globally with @ref ucpu_set_mask or per pipe with @ref upipe_set_cpu_flags
+ * to compare implementations.
+ */
+
+#ifndef _UPIPE_UCPU_H_
+/** @hidden */
+#define _UPIPE_UCPU_H_
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <upipe/ubase.h>
+
+#include <stdint.h>
+#include <stddef.h>
+
+/** @This defines the instruction set extensions that kernels may require. */
+enum ucpu_flag {
+    /** x86 SSE2 */
+    UCPU_SSE2 = 0x1,
+    /** x86 SSSE3 */
+    UCPU_SSSE3 = 0x2,
+    /** x86 SSE4.1 */
+    UCPU_SSE41 = 0x4,
+    /** x86 AVX */
+    UCPU_AVX = 0x8,
+    /** x86 AVX2 */
+    UCPU_AVX2 = 0x10,
+    /** x86 AVX-512 with the BW and VL extensions */
+    UCPU_AVX512 = 0x20,
+    /** x86 carry-less multiplication */
+    UCPU_PCLMUL = 0x40,
+    /** x86 AES instructions */
+    UCPU_AES = 0x80,
+    /** ARM NEON in little-endian AArch64 */
+    UCPU_NEON = 0x100,
+
+    /** all the extensions */
+    UCPU_ALL = 0xffffffff
+};
+
+/** @This returns the instruction set extensions supported by the CPU,
+ * restricted by the mask set with @ref ucpu_set_mask.
+ *
+ * @return a combination of @ref ucpu_flag
+ */
+uint32_t ucpu_flags(void);
+
+/** @This restricts the instruction set extensions returned by
+ * @ref ucpu_flags, for instance to compare the output or the speed of
+ * several implementations. It only affects the kernels selected
+ * afterwards.
+ *
+ * @param mask combination of @ref ucpu_flag to allow, or @ref UCPU_ALL
+ */
+void ucpu_set_mask(uint32_t mask);
+
+/** @internal @This returns the index of the first entry of a table of
+ * kernels whose required extensions are all available.
+ *
+ * @param table pointer to the first entry, starting with a uint32_t
+ * @param size size of an entry
+ * @param nb number of entries
+ * @param flags available extensions
+ * @return index of the selected entry, or nb if there is none
+ */
+static inline size_t ucpu_select_index(const void *table, size_t size,
+                                       size_t nb, uint32_t flags)
+{
+    for (size_t i = 0; i < nb; i++) {
+        const uint32_t *required =
+            (const uint32_t *)((const uint8_t *)table + i * size);
+        if ((*required & flags) == *required)
+            return i;
+    }
+    return nb;
+}
+
+/** @This returns a pointer to the first entry of a table of kernels whose
+ * required extensions are all available, or NULL if there is none. The
+ * entries must be structures whose first member is a uint32_t combination
+ * of @ref ucpu_flag.
+ *
+ * @param table array of entries, from the most to the least preferred
+ * @param flags available extensions, typically from @ref ucpu_flags
+ * @return pointer to the selected entry, or NULL
+ */
+#define ucpu_select(table, flags)                                           \
+    (ucpu_select_index(table, sizeof((table)[0]), UBASE_ARRAY_SIZE(table),  \
+                       flags) < UBASE_ARRAY_SIZE(table) ?                   \
+     &(table)[ucpu_select_index(table, sizeof((table)[0]),                  \
+                                UBASE_ARRAY_SIZE(table), flags)] : NULL)
+
+/** @This returns the name of an instruction set extension.
+ *
+ * @param flag one of @ref ucpu_flag
+ * @return a string or NULL if invalid
+ */
+static inline const char *ucpu_flag_str(uint32_t flag)
+{
+    switch (flag) {
+        case UCPU_SSE2: return "sse2";
+        case UCPU_SSSE3: return "ssse3";
+        case UCPU_SSE41: return "sse4.1";
+        case UCPU_AVX: return "avx";
+        case UCPU_AVX2: return "avx2";
+        case UCPU_AVX512: return "avx512";
+        case UCPU_PCLMUL: return "pclmul";
+        case UCPU_AES: return "aes";
+        case UCPU_NEON: return "neon";
+        default: return NULL;
+    }
+}
+
+#ifdef __cplusplus
+}
+#endif
+#endif
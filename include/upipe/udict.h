@@ -44,6 +44,9 @@ extern "C" {
 #include <string.h>
 #include <assert.h>
 
+/** @hidden */
+struct upool_stats;
+
 /** @internal @This defines basic attribute types. */
 enum udict_type {
     /** dummy type to mark the end of attributes */
@@ -87,7 +90,8 @@ enum udict_type {
     /** e.events */
     UDICT_TYPE_EVENT_EVENTS,
 
-    /** k.duration */
+    /** k.duration, unused since the duration is stored in the uref; kept
+     * so that the values of the following types do not change */
     UDICT_TYPE_CLOCK_DURATION,
     /** k.rate */
     UDICT_TYPE_CLOCK_RATE,
@@ -191,18 +195,55 @@ struct udict_mgr;
 struct udict {
     /** pointer to the entity responsible for the management */
     struct udict_mgr *mgr;
+    /** generation of the attributes, shared by identical udicts, or 0 if
+     * unknown */
+    uint64_t gen;
 };
 
+/** @internal @This returns a new generation number, different from all
+ * the previous ones in the process.
+ *
+ * @return generation number, never 0
+ */
+uint64_t udict_gen_alloc(void);
+
 /** @This defines standard commands which udict managers may implement. */
 enum udict_mgr_command {
     /** release all buffers kept in pools (void) */
     UDICT_MGR_VACUUM,
+    /** enable or disable the statistics and reset them (bool) */
+    UDICT_MGR_SET_STATS,
+    /** read the statistics (struct udict_stats *, struct upool_stats *) */
+    UDICT_MGR_GET_STATS,
+    /** allocate udicts in advance and keep them in the pool (unsigned int) */
+    UDICT_MGR_PREFILL,
 
     /** non-standard manager commands implemented by a module type can start
      * from there (first arg = signature) */
     UDICT_MGR_CONTROL_LOCAL = 0x8000
 };
 
+/** @This is the set of counters of a udict manager, updated when statistics
+ * are enabled with @ref udict_mgr_set_stats. */
+struct udict_stats {
+    /** number of lookups of attributes, indexed by base type (shorthand
+     * attributes are accounted with their base type) */
+    uint64_t lookups[UDICT_TYPE_SHORTHAND];
+    /** number of lookups of shorthand attributes */
+    uint64_t shorthand_lookups;
+    /** number of lookups of missing attributes */
+    uint64_t misses;
+    /** number of udicts allocated */
+    uint64_t allocs;
+    /** number of udicts released */
+    uint64_t frees;
+    /** sum of the sizes of the attributes of the released udicts, to
+     * compute the average size of a udict */
+    uint64_t total_size;
+    /** number of times the attributes space had to be expanded */
+    uint64_t reallocs;
+};
+
 /** @This stores common management parameters for a udict pool.
  */
 struct udict_mgr {
@@ -229,7 +270,10 @@ struct udict_mgr {
  */
 static inline struct udict *udict_alloc(struct udict_mgr *mgr, size_t size)
 {
-    return mgr->udict_alloc(mgr, size);
+    struct udict *udict = mgr->udict_alloc(mgr, size);
+    if (likely(udict != NULL))
+        udict->gen = 0;
+    return udict;
 }
 
 /** @internal @This sends a control command to the udict.
@@ -246,6 +290,10 @@ static inline int udict_control_va(struct udict *udict,
     if (udict->mgr->udict_mgr_control == NULL)
         return UBASE_ERR_UNHANDLED;
 
+    /* the attributes may change */
+    if (command == UDICT_SET || command == UDICT_DELETE ||
+        command >= UDICT_CONTROL_LOCAL)
+        udict->gen = 0;
     return udict->mgr->udict_control(udict, command, args);
 }
 
@@ -266,7 +314,8 @@ static inline int udict_control(struct udict *udict, int command, ...)
     return err;
 }
 
-/** @This duplicates a given udict.
+/** @This duplicates a given udict. Both udicts share the same generation
+ * until one of them is modified.
  *
  * @param udict pointer to udict
  * @return duplicated udict
@@ -276,6 +325,9 @@ static inline struct udict *udict_dup(struct udict *udict)
     struct udict *dup_udict;
     if (unlikely(!ubase_check(udict_control(udict, UDICT_DUP, &dup_udict))))
         return NULL;
+    if (!udict->gen)
+        udict->gen = udict_gen_alloc();
+    dup_udict->gen = udict->gen;
     return dup_udict;
 }
 
@@ -887,10 +939,14 @@ static inline struct udict *udict_copy(struct udict_mgr *mgr,
         udict_free(new_udict);
         return NULL;
     }
+    new_udict->gen = udict->gen;
     return new_udict;
 }
 
-/** @This compares two udicts.
+/** @This compares two udicts. Udicts sharing a generation are identical
+ * and compared in constant time; otherwise, if the attributes turn out to
+ * be identical, both udicts are given the same generation so that the next
+ * comparison is immediate.
  *
  * @param udict1 first udict
  * @param udict2 second udict
@@ -898,6 +954,9 @@ static inline struct udict *udict_copy(struct udict_mgr *mgr,
  */
 static inline int udict_cmp(struct udict *udict1, struct udict *udict2)
 {
+    if (udict1->gen && udict1->gen == udict2->gen)
+        return 0;
+
     const char *name = NULL;
     enum udict_type type = UDICT_TYPE_END;
     for ( ; ; ) {
@@ -939,6 +998,10 @@ static inline int udict_cmp(struct udict *udict1, struct udict *udict2)
         if (attr1_size != attr2_size || memcmp(attr1, attr2, attr1_size))
             return -1;
     }
+
+    if (!udict1->gen)
+        udict1->gen = udict2->gen ? udict2->gen : udict_gen_alloc();
+    udict2->gen = udict1->gen;
     return 0;
 }
 
@@ -1012,6 +1075,48 @@ static inline int udict_mgr_vacuum(struct udict_mgr *mgr)
     return udict_mgr_control(mgr, UDICT_MGR_VACUUM);
 }
 
+/** @This enables or disables the statistics of a udict manager. Enabling
+ * them resets the counters.
+ *
+ * @param mgr pointer to udict manager
+ * @param enabled true to update the counters
+ * @return an error code
+ */
+static inline int udict_mgr_set_stats(struct udict_mgr *mgr, bool enabled)
+{
+    return udict_mgr_control(mgr, UDICT_MGR_SET_STATS, enabled);
+}
+
+/** @This reads the statistics of a udict manager. It may be called from any
+ * thread.
+ *
+ * @param mgr pointer to udict manager
+ * @param stats filled in with the counters of the manager (may be NULL)
+ * @param pool_stats filled in with the counters of the pool of udict
+ * structures (may be NULL)
+ * @return an error code
+ */
+static inline int udict_mgr_get_stats(struct udict_mgr *mgr,
+                                      struct udict_stats *stats,
+                                      struct upool_stats *pool_stats)
+{
+    return udict_mgr_control(mgr, UDICT_MGR_GET_STATS, stats, pool_stats);
+}
+
+/** @This allocates udicts in advance and keeps them in the pool of a udict
+ * manager, so that the first udicts allocated by a new pipeline do not hit
+ * the allocator.
+ *
+ * @param mgr pointer to udict manager
+ * @param count number of udicts to allocate; the pool is not filled beyond
+ * its depth
+ * @return an error code
+ */
+static inline int udict_mgr_prefill(struct udict_mgr *mgr, unsigned int count)
+{
+    return udict_mgr_control(mgr, UDICT_MGR_PREFILL, count);
+}
+
 #ifdef __cplusplus
 }
 #endif
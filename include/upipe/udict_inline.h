@@ -39,6 +39,39 @@ extern "C" {
 
 #include <upipe/udict.h>
 
+#include <stdint.h>
+
+/** @This is a simple signature to make sure the udict_mgr_control internal
+ * API is used properly. */
+#define UDICT_INLINE_SIGNATURE UBASE_FOURCC('i','n','l','n')
+
+/** @This extends udict_mgr_command with specific commands for the inline
+ * manager. */
+enum udict_inline_mgr_command {
+    UDICT_INLINE_MGR_SENTINEL = UDICT_MGR_CONTROL_LOCAL,
+
+    /** returns the number of lookups of a shorthand attribute
+     * (enum udict_type, uint64_t *) */
+    UDICT_INLINE_MGR_GET_SHORTHAND_STATS
+};
+
+/** @This returns the number of lookups of a shorthand attribute since the
+ * statistics were enabled with @ref udict_mgr_set_stats. The name of the
+ * attribute may be retrieved with @ref udict_name.
+ *
+ * @param mgr pointer to udict manager
+ * @param type shorthand type
+ * @param lookups_p filled in with the number of lookups
+ * @return an error code
+ */
+static inline int udict_inline_mgr_get_shorthand_stats(struct udict_mgr *mgr,
+                                                       enum udict_type type,
+                                                       uint64_t *lookups_p)
+{
+    return udict_mgr_control(mgr, UDICT_INLINE_MGR_GET_SHORTHAND_STATS,
+                             UDICT_INLINE_SIGNATURE, type, lookups_p);
+}
+
 /** @This allocates a new instance of the inline udict manager.
  *
  * @param udict_pool_depth maximum number of udict structures in the pool
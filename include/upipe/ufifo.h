@@ -111,6 +111,71 @@ static inline void *ufifo_pop_internal(struct ufifo *ufifo)
  */
 #define ufifo_pop(ufifo, type) (type)ufifo_pop_internal(ufifo)
 
+/** @This pushes several elements, with one atomic operation to reserve the
+ * slots and one to publish them.
+ *
+ * @param ufifo pointer to a ufifo structure
+ * @param opaques array of opaques to associate with elements (not NULL)
+ * @param n number of elements in the array
+ * @return number of elements actually pushed (the first ones of the array),
+ * less than n if the maximum number of elements was reached
+ */
+static inline unsigned int ufifo_push_batch(struct ufifo *ufifo,
+                                            void **opaques, unsigned int n)
+{
+    unsigned int count = n;
+    uring_index index = uring_lifo_pop_chain(&ufifo->uring,
+                                             &ufifo->lifo_empty, &count);
+    if (!count)
+        return 0;
+
+    /* chain the elements from the newest to the oldest */
+    uring_index first = index, last = URING_INDEX_NULL;
+    for (unsigned int i = 0; i < count; i++) {
+        assert(opaques[i] != NULL);
+        struct uring_elem *elem = uring_elem_from_index(&ufifo->uring, index);
+        uring_index next = elem->next;
+        uring_elem_set(&ufifo->uring, index, opaques[i]);
+        if (last != URING_INDEX_NULL)
+            elem->next = last;
+        last = index;
+        index = next;
+    }
+    uring_fifo_push_chain(&ufifo->uring, &ufifo->fifo_carrier, first, last);
+    return count;
+}
+
+/** @This pops several elements, walking the FIFO only once.
+ *
+ * @param ufifo pointer to a ufifo structure
+ * @param opaques array filled in with the popped opaques, in FIFO order
+ * @param n maximum number of elements to pop
+ * @return number of elements actually popped
+ */
+static inline unsigned int ufifo_pop_batch(struct ufifo *ufifo,
+                                           void **opaques, unsigned int n)
+{
+    uring_index indexes[UINT8_MAX];
+    if (n > UINT8_MAX)
+        n = UINT8_MAX;
+    unsigned int count = uring_fifo_pop_batch(&ufifo->uring,
+                                              &ufifo->fifo_carrier,
+                                              indexes, n);
+    if (!count)
+        return 0;
+
+    for (unsigned int i = 0; i < count; i++) {
+        opaques[i] = uring_elem_get(&ufifo->uring, indexes[i]);
+        uring_elem_set(&ufifo->uring, indexes[i], NULL);
+        if (i + 1 < count)
+            uring_elem_from_index(&ufifo->uring, indexes[i])->next =
+                indexes[i + 1];
+    }
+    uring_lifo_push_chain(&ufifo->uring, &ufifo->lifo_empty,
+                          indexes[0], indexes[count - 1]);
+    return count;
+}
+
 /** @This cleans up the ufifo data structure. Please note that it is the
  * caller's responsibility to empty the FIFO first.
  *
@@ -0,0 +1,190 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short Upipe log-linear histogram of unsigned values
+ *
+ * Values below 64 have their own bucket; above, each power of two is split
+ * in 32 buckets, so that quantiles are reported with a relative precision
+ * of 1/32 over the whole 64-bit range, in the spirit of HDR histograms.
+ * The structure is large (about 15 kB), so it is usually allocated only when
+ * measurements are requested.
+ */
+
+#ifndef _UPIPE_UHIST_H_
+/** @hidden */
+#define _UPIPE_UHIST_H_
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <upipe/ubase.h>
+
+#include <stdint.h>
+#include <string.h>
+
+/** @hidden */
+#define UHIST_LINEAR_SHIFT 6
+/** @hidden */
+#define UHIST_LINEAR (1 << UHIST_LINEAR_SHIFT)
+/** @hidden */
+#define UHIST_SUB_SHIFT 5
+/** @hidden */
+#define UHIST_SUB (1 << UHIST_SUB_SHIFT)
+/** number of buckets of a histogram */
+#define UHIST_SIZE (UHIST_LINEAR + (64 - UHIST_LINEAR_SHIFT) * UHIST_SUB)
+
+/** @This is a log-linear histogram. */
+struct uhist {
+    /** number of values */
+    uint64_t count;
+    /** minimum value */
+    uint64_t min;
+    /** maximum value */
+    uint64_t max;
+    /** sum of the values */
+    uint64_t sum;
+    /** buckets */
+    uint64_t buckets[UHIST_SIZE];
+};
+
+/** @This resets a histogram.
+ *
+ * @param uhist pointer to histogram
+ */
+static inline void uhist_init(struct uhist *uhist)
+{
+    memset(uhist, 0, sizeof(*uhist));
+    uhist->min = UINT64_MAX;
+}
+
+/** @internal @This returns the bucket of a value.
+ *
+ * @param value value to account
+ * @return bucket index
+ */
+static inline unsigned int uhist_bucket(uint64_t value)
+{
+    if (value < UHIST_LINEAR)
+        return value;
+    unsigned int exp = 63 - __builtin_clzll(value);
+    return UHIST_LINEAR + (exp - UHIST_LINEAR_SHIFT) * UHIST_SUB +
+           ((value >> (exp - UHIST_SUB_SHIFT)) & (UHIST_SUB - 1));
+}
+
+/** @internal @This returns the lowest value of a bucket.
+ *
+ * @param bucket bucket index
+ * @return lowest value
+ */
+static inline uint64_t uhist_bucket_value(unsigned int bucket)
+{
+    if (bucket < UHIST_LINEAR)
+        return bucket;
+    bucket -= UHIST_LINEAR;
+    unsigned int exp = bucket / UHIST_SUB + UHIST_LINEAR_SHIFT;
+    return (uint64_t)(UHIST_SUB + bucket % UHIST_SUB) <<
+           (exp - UHIST_SUB_SHIFT);
+}
+
+/** @This accounts a value in a histogram.
+ *
+ * @param uhist pointer to histogram
+ * @param value value to account
+ */
+static inline void uhist_add(struct uhist *uhist, uint64_t value)
+{
+    uhist->count++;
+    uhist->sum += value;
+    if (value < uhist->min)
+        uhist->min = value;
+    if (value > uhist->max)
+        uhist->max = value;
+    uhist->buckets[uhist_bucket(value)]++;
+}
+
+/** @This adds the values of a histogram to another.
+ *
+ * @param uhist pointer to the destination histogram
+ * @param src pointer to the histogram to add
+ */
+static inline void uhist_merge(struct uhist *uhist, const struct uhist *src)
+{
+    uhist->count += src->count;
+    uhist->sum += src->sum;
+    if (src->min < uhist->min)
+        uhist->min = src->min;
+    if (src->max > uhist->max)
+        uhist->max = src->max;
+    for (unsigned int i = 0; i < UHIST_SIZE; i++)
+        uhist->buckets[i] += src->buckets[i];
+}
+
+/** @This returns the mean of the values of a histogram.
+ *
+ * @param uhist pointer to histogram
+ * @return mean value, or 0 if the histogram is empty
+ */
+static inline uint64_t uhist_mean(const struct uhist *uhist)
+{
+    return uhist->count ? uhist->sum / uhist->count : 0;
+}
+
+/** @This returns quantiles of a histogram. The quantile q is the lowest
+ * value of the bucket containing the value of rank ceil(count * q), clamped
+ * to the minimum and maximum values.
+ *
+ * @param uhist pointer to histogram
+ * @param nb number of quantiles
+ * @param permille array of quantiles in thousandths, in increasing order
+ * @param values array filled in with the quantiles (0 if the histogram is
+ * empty)
+ */
+static inline void uhist_quantiles(const struct uhist *uhist,
+                                   unsigned int nb,
+                                   const unsigned int *permille,
+                                   uint64_t *values)
+{
+    unsigned int q = 0;
+    uint64_t cumulated = 0;
+    for (unsigned int i = 0; i < UHIST_SIZE && q < nb && uhist->count; i++) {
+        cumulated += uhist->buckets[i];
+        while (q < nb && cumulated * 1000 >= uhist->count * permille[q]) {
+            uint64_t value = uhist_bucket_value(i);
+            if (value < uhist->min)
+                value = uhist->min;
+            if (value > uhist->max)
+                value = uhist->max;
+            values[q++] = value;
+        }
+    }
+    for ( ; q < nb; q++)
+        values[q] = 0;
+}
+
+#ifdef __cplusplus
+}
+#endif
+#endif
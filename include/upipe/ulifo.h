@@ -111,6 +111,65 @@ static inline void *ulifo_pop_internal(struct ulifo *ulifo)
  */
 #define ulifo_pop(ulifo, type) (type)ulifo_pop_internal(ulifo)
 
+/** @This pushes several elements, with one atomic operation to reserve the
+ * slots and one to publish them. It is equivalent to pushing the elements
+ * one after the other, in the order of the array.
+ *
+ * @param ulifo pointer to a ulifo structure
+ * @param opaques array of opaques to associate with elements (not NULL)
+ * @param n number of elements in the array
+ * @return number of elements actually pushed, less than n if the maximum
+ * number of elements was reached
+ */
+static inline unsigned int ulifo_push_batch(struct ulifo *ulifo,
+                                            void **opaques, unsigned int n)
+{
+    unsigned int count = n;
+    uring_index first = uring_lifo_pop_chain(&ulifo->uring,
+                                             &ulifo->lifo_empty, &count);
+    if (!count)
+        return 0;
+
+    uring_index index = first, last = first;
+    for (unsigned int i = 0; i < count; i++) {
+        assert(opaques[count - 1 - i] != NULL);
+        last = index;
+        uring_elem_set(&ulifo->uring, index, opaques[count - 1 - i]);
+        index = uring_elem_from_index(&ulifo->uring, index)->next;
+    }
+    uring_lifo_push_chain(&ulifo->uring, &ulifo->lifo_carrier, first, last);
+    return count;
+}
+
+/** @This pops several elements, with one atomic operation to take them and
+ * one to release the slots. It is equivalent to popping the elements one
+ * after the other.
+ *
+ * @param ulifo pointer to a ulifo structure
+ * @param opaques array filled in with the popped opaques
+ * @param n maximum number of elements to pop
+ * @return number of elements actually popped
+ */
+static inline unsigned int ulifo_pop_batch(struct ulifo *ulifo,
+                                           void **opaques, unsigned int n)
+{
+    unsigned int count = n;
+    uring_index first = uring_lifo_pop_chain(&ulifo->uring,
+                                             &ulifo->lifo_carrier, &count);
+    if (!count)
+        return 0;
+
+    uring_index index = first, last = first;
+    for (unsigned int i = 0; i < count; i++) {
+        last = index;
+        opaques[i] = uring_elem_get(&ulifo->uring, index);
+        uring_elem_set(&ulifo->uring, index, NULL);
+        index = uring_elem_from_index(&ulifo->uring, index)->next;
+    }
+    uring_lifo_push_chain(&ulifo->uring, &ulifo->lifo_empty, first, last);
+    return count;
+}
+
 /** @This cleans up the ulifo data structure. Please note that it is the
  * caller's responsibility to empty the LIFO first, and to release the
  * extra data passed to @ref ulifo_init.
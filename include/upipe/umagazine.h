@@ -0,0 +1,273 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short Upipe per-thread magazines in front of a @ref ulifo
+ * A magazine is a small stack of elements selected by the calling thread,
+ * which is emptied to or refilled from the shared LIFO in bursts. This
+ * avoids bouncing the shared cache line of the LIFO on every operation when
+ * elements are allocated in one thread and released in another.
+ *
+ * Magazines are owned by the structure embedding them (not by the threads),
+ * so that no element is lost when it is destroyed. Each magazine is
+ * protected by a try-lock; if it is already taken by another thread, the
+ * shared LIFO is used directly.
+ */
+
+#ifndef _UPIPE_UMAGAZINE_H_
+/** @hidden */
+#define _UPIPE_UMAGAZINE_H_
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <upipe/ubase.h>
+#include <upipe/config.h>
+#include <upipe/uatomic.h>
+#include <upipe/ulifo.h>
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+/** number of magazines (power of 2) */
+#define UMAGAZINE_NB 8
+/** maximum number of elements in a magazine */
+#define UMAGAZINE_DEPTH 13
+
+/** @This is the implementation of a magazine, padded to two cache lines.
+ * Magazines are allocated aligned on their size, so that two of them never
+ * share a cache line. */
+struct umagazine_slot {
+    /** try-lock */
+    uatomic_uint32_t lock;
+    /** number of elements */
+    uint32_t count;
+    /** elements */
+    void *elems[UMAGAZINE_DEPTH];
+    /** padding */
+    uint8_t padding[128 - 2 * sizeof(uint32_t) -
+                    UMAGAZINE_DEPTH * sizeof(void *)];
+};
+
+/** @This is the implementation of a set of magazines in front of a ulifo. */
+struct umagazine {
+    /** maximum number of elements in each magazine, or 0 if disabled */
+    uint32_t depth;
+    /** magazines, or NULL if disabled */
+    struct umagazine_slot *slots;
+};
+
+/** @This initializes a set of magazines. The elements kept in the
+ * magazines are taken from the budget of the LIFO, so that the overall
+ * number of retained elements is unchanged.
+ *
+ * @param umagazine pointer to a umagazine structure
+ * @param length maximum number of elements in the LIFO and the magazines
+ * @return maximum number of elements to leave to the LIFO
+ */
+static inline uint16_t umagazine_init(struct umagazine *umagazine,
+                                      uint16_t length)
+{
+#ifdef UPIPE_HAVE_TLS
+    umagazine->depth = length / (2 * UMAGAZINE_NB);
+    if (umagazine->depth > UMAGAZINE_DEPTH)
+        umagazine->depth = UMAGAZINE_DEPTH;
+    if (umagazine->depth < 2)
+        umagazine->depth = 0;
+#else
+    umagazine->depth = 0;
+#endif
+    umagazine->slots = NULL;
+    if (umagazine->depth &&
+        unlikely(posix_memalign((void **)&umagazine->slots,
+                                sizeof(struct umagazine_slot),
+                                sizeof(struct umagazine_slot) *
+                                UMAGAZINE_NB) != 0)) {
+        umagazine->slots = NULL;
+        umagazine->depth = 0;
+    }
+    if (umagazine->slots != NULL) {
+        for (int i = 0; i < UMAGAZINE_NB; i++) {
+            uatomic_init(&umagazine->slots[i].lock, 0);
+            umagazine->slots[i].count = 0;
+        }
+    }
+    return length - umagazine->depth * UMAGAZINE_NB;
+}
+
+#ifdef UPIPE_HAVE_TLS
+/** @internal @This returns the magazine to use for the calling thread, and
+ * locks it.
+ *
+ * @param umagazine pointer to a umagazine structure
+ * @return pointer to the locked magazine, or NULL if it is busy
+ */
+static inline struct umagazine_slot *
+    umagazine_lock(struct umagazine *umagazine)
+{
+    /* the address of a thread-local variable identifies the thread */
+    static __thread uint8_t umagazine_tls;
+    uint64_t hash = (uint64_t)(uintptr_t)&umagazine_tls *
+                    UINT64_C(0x9e3779b97f4a7c15);
+    struct umagazine_slot *slot =
+        &umagazine->slots[(hash >> 59) & (UMAGAZINE_NB - 1)];
+    uint32_t expected = 0;
+    if (unlikely(!uatomic_compare_exchange(&slot->lock, &expected, 1)))
+        return NULL;
+    return slot;
+}
+
+/** @internal @This unlocks a magazine.
+ *
+ * @param slot pointer to the locked magazine
+ */
+static inline void umagazine_unlock(struct umagazine_slot *slot)
+{
+    uatomic_store(&slot->lock, 0);
+}
+#endif
+
+/** @This pushes an element to the magazine of the calling thread, or to the
+ * LIFO.
+ *
+ * @param umagazine pointer to a umagazine structure
+ * @param ulifo pointer to the shared LIFO
+ * @param opaque opaque to associate with element (not NULL)
+ * @return false if the maximum number of elements was reached and the
+ * element couldn't be queued
+ */
+static inline bool umagazine_push(struct umagazine *umagazine,
+                                  struct ulifo *ulifo, void *opaque)
+{
+#ifdef UPIPE_HAVE_TLS
+    struct umagazine_slot *slot;
+    if (likely(umagazine->depth) &&
+        likely((slot = umagazine_lock(umagazine)) != NULL)) {
+        if (unlikely(slot->count >= umagazine->depth)) {
+            /* flush half of the magazine in a burst */
+            while (slot->count > umagazine->depth / 2 &&
+                   ulifo_push(ulifo, slot->elems[slot->count - 1]))
+                slot->count--;
+        }
+        bool ret = slot->count < umagazine->depth;
+        if (likely(ret))
+            slot->elems[slot->count++] = opaque;
+        umagazine_unlock(slot);
+        return ret;
+    }
+#endif
+    return ulifo_push(ulifo, opaque);
+}
+
+/** @internal @This pops an element from the magazine of the calling thread,
+ * or from the LIFO.
+ *
+ * @param umagazine pointer to a umagazine structure
+ * @param ulifo pointer to the shared LIFO
+ * @return pointer to opaque, or NULL if no element is available
+ */
+static inline void *umagazine_pop_internal(struct umagazine *umagazine,
+                                           struct ulifo *ulifo)
+{
+#ifdef UPIPE_HAVE_TLS
+    struct umagazine_slot *slot;
+    if (likely(umagazine->depth) &&
+        likely((slot = umagazine_lock(umagazine)) != NULL)) {
+        if (unlikely(!slot->count)) {
+            /* refill half of the magazine in a burst */
+            void *opaque;
+            while (slot->count < umagazine->depth / 2 &&
+                   (opaque = ulifo_pop(ulifo, void *)) != NULL)
+                slot->elems[slot->count++] = opaque;
+        }
+        void *opaque = NULL;
+        if (likely(slot->count))
+            opaque = slot->elems[--slot->count];
+        umagazine_unlock(slot);
+        return opaque;
+    }
+#endif
+    return ulifo_pop(ulifo, void *);
+}
+
+/** @This pops an element with type checking.
+ *
+ * @param umagazine pointer to a umagazine structure
+ * @param ulifo pointer to the shared LIFO
+ * @param type type of the opaque pointer
+ * @return pointer to opaque, or NULL if no element is available
+ */
+#define umagazine_pop(umagazine, ulifo, type)                               \
+    (type)umagazine_pop_internal(umagazine, ulifo)
+
+/** @This pops an element from any magazine, or from the LIFO, in order to
+ * empty them. It is not meant to be called in the fast path.
+ *
+ * @param umagazine pointer to a umagazine structure
+ * @param ulifo pointer to the shared LIFO
+ * @return pointer to opaque, or NULL if everything is empty
+ */
+static inline void *umagazine_vacuum_pop(struct umagazine *umagazine,
+                                         struct ulifo *ulifo)
+{
+    void *opaque = ulifo_pop(ulifo, void *);
+    if (opaque != NULL || umagazine->slots == NULL)
+        return opaque;
+
+    for (int i = 0; i < UMAGAZINE_NB; i++) {
+        struct umagazine_slot *slot = &umagazine->slots[i];
+        uint32_t expected = 0;
+        if (!uatomic_compare_exchange(&slot->lock, &expected, 1))
+            continue;
+        if (slot->count)
+            opaque = slot->elems[--slot->count];
+        uatomic_store(&slot->lock, 0);
+        if (opaque != NULL)
+            return opaque;
+    }
+    return NULL;
+}
+
+/** @This cleans up the umagazine structure. Please note that it is the
+ * caller's responsibility to empty the magazines first, with
+ * @ref umagazine_vacuum_pop.
+ *
+ * @param umagazine pointer to a umagazine structure
+ */
+static inline void umagazine_clean(struct umagazine *umagazine)
+{
+    if (umagazine->slots == NULL)
+        return;
+    for (int i = 0; i < UMAGAZINE_NB; i++)
+        uatomic_clean(&umagazine->slots[i].lock);
+    free(umagazine->slots);
+    umagazine->slots = NULL;
+}
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -39,6 +39,7 @@ extern "C" {
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stdarg.h>
 #include <assert.h>
 
 /** @hidden */
@@ -80,6 +81,34 @@ static inline size_t umem_size(struct umem *umem)
     return umem->size;
 }
 
+/** @This defines standard commands which umem managers may implement. */
+enum umem_mgr_command {
+    /** enable or disable the statistics and reset them (bool) */
+    UMEM_MGR_SET_STATS,
+    /** read the statistics (struct umem_stats *) */
+    UMEM_MGR_GET_STATS,
+    /** allocate buffers in advance and keep them in the pool
+     * (size_t, unsigned int, bool) */
+    UMEM_MGR_PREFILL,
+
+    /** non-standard manager commands implemented by a module type can start
+     * from there (first arg = signature) */
+    UMEM_MGR_CONTROL_LOCAL = 0x8000
+};
+
+/** @This is the set of counters of a umem manager, updated when statistics
+ * are enabled with @ref umem_mgr_set_stats. */
+struct umem_stats {
+    /** number of buffers allocated */
+    uint64_t allocs;
+    /** number of buffers that had to be moved to a larger buffer to be
+     * resized */
+    uint64_t reallocs;
+    /** number of buffers allocated with malloc() because no pooled buffer
+     * was available */
+    uint64_t fallbacks;
+};
+
 /** @This defines a memory allocator management structure.
  */
 struct umem_mgr {
@@ -95,6 +124,9 @@ struct umem_mgr {
 
     /** function to release all buffers kept in pools */
     void (*umem_mgr_vacuum)(struct umem_mgr *);
+    /** control function for standard or local manager commands - all
+     * parameters belong to the caller (may be NULL) */
+    int (*umem_mgr_control)(struct umem_mgr *, int, va_list);
 };
 
 /** @This allocates a new umem buffer space.
@@ -151,6 +183,82 @@ static inline void umem_mgr_vacuum(struct umem_mgr *mgr)
         mgr->umem_mgr_vacuum(mgr);
 }
 
+/** @internal @This sends a control command to the umem manager.
+ *
+ * @param mgr pointer to umem manager
+ * @param command type of command to process
+ * @param args arguments of the command
+ * @return an error code
+ */
+static inline int umem_mgr_control_va(struct umem_mgr *mgr,
+                                      int command, va_list args)
+{
+    assert(mgr != NULL);
+    if (mgr->umem_mgr_control == NULL)
+        return UBASE_ERR_UNHANDLED;
+
+    return mgr->umem_mgr_control(mgr, command, args);
+}
+
+/** @internal @This sends a control command to the umem manager.
+ *
+ * @param mgr pointer to umem manager
+ * @param command type of command to process, followed by optional arguments
+ * @return an error code
+ */
+static inline int umem_mgr_control(struct umem_mgr *mgr, int command, ...)
+{
+    va_list args;
+    va_start(args, command);
+    int err = umem_mgr_control_va(mgr, command, args);
+    va_end(args);
+    return err;
+}
+
+/** @This enables or disables the statistics of a umem manager. Enabling them
+ * resets the counters.
+ *
+ * @param mgr pointer to umem manager
+ * @param enabled true to update the counters
+ * @return an error code
+ */
+static inline int umem_mgr_set_stats(struct umem_mgr *mgr, bool enabled)
+{
+    return umem_mgr_control(mgr, UMEM_MGR_SET_STATS, enabled);
+}
+
+/** @This reads the statistics of a umem manager. It may be called from any
+ * thread.
+ *
+ * @param mgr pointer to umem manager
+ * @param stats filled in with the counters of the manager
+ * @return an error code
+ */
+static inline int umem_mgr_get_stats(struct umem_mgr *mgr,
+                                     struct umem_stats *stats)
+{
+    return umem_mgr_control(mgr, UMEM_MGR_GET_STATS, stats);
+}
+
+/** @This allocates buffers in advance and keeps them in the pool of a umem
+ * manager, so that the first buffers allocated by a new pipeline do not hit
+ * the allocator. The buffers are written to in order to fault their pages
+ * in.
+ *
+ * @param mgr pointer to umem manager
+ * @param size size of the buffers, which selects the pool to fill
+ * @param count number of buffers to allocate; the pool is not filled beyond
+ * its depth
+ * @param lock true to also lock the pages of the buffers in RAM, with
+ * mlock(2); they stay locked until they are returned to the system
+ * @return an error code
+ */
+static inline int umem_mgr_prefill(struct umem_mgr *mgr, size_t size,
+                                   unsigned int count, bool lock)
+{
+    return umem_mgr_control(mgr, UMEM_MGR_PREFILL, size, count, lock);
+}
+
 /** @This increments the reference count of a umem manager.
  *
  * @param mgr pointer to umem manager
@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short Upipe arena memory allocator
+ * This memory allocator carves small memory blocks one after the other out
+ * of larger chunks. A chunk is released all at once when all the blocks
+ * carved out of it have been freed. When the same manager is given to the
+ * uref, udict and ubuf managers, a small uref, its attributes and its
+ * payload are allocated next to each other with a single call to the
+ * system allocator for many urefs.
+ *
+ * Blocks are carved by one thread at a time; the other threads, and the
+ * blocks larger than the configured threshold, revert to malloc() and
+ * free(). Blocks may be freed from any thread.
+ */
+
+#ifndef _UPIPE_UMEM_ARENA_H_
+/** @hidden */
+#define _UPIPE_UMEM_ARENA_H_
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <upipe/umem.h>
+
+#include <stdint.h>
+
+/** @This allocates a new instance of the umem arena manager.
+ *
+ * @param chunk_size size (in octets) of the chunks allocated from the system
+ * @param max_size size (in octets) above which blocks are directly managed
+ * with malloc() and free(); it is lowered to a quarter of chunk_size if
+ * it is larger
+ * @return pointer to manager, or NULL in case of error
+ */
+struct umem_mgr *umem_arena_mgr_alloc(size_t chunk_size, size_t max_size);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
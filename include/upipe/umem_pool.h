@@ -39,6 +39,47 @@ extern "C" {
 
 #include <upipe/umem.h>
 
+#include <stdint.h>
+
+/** @This is a simple signature to make sure the umem_mgr_control internal
+ * API is used properly. */
+#define UMEM_POOL_SIGNATURE UBASE_FOURCC('p','o','o','l')
+
+/** @This extends umem_mgr_command with specific commands for the pool
+ * manager. */
+enum umem_pool_mgr_command {
+    UMEM_POOL_MGR_SENTINEL = UMEM_MGR_CONTROL_LOCAL,
+
+    /** returns the statistics of a size class (unsigned int, size_t *,
+     * uint64_t *, uint64_t *) */
+    UMEM_POOL_MGR_GET_CLASS_STATS
+};
+
+/** @This returns the statistics of a size class of a umem pool manager,
+ * since they were enabled with @ref umem_mgr_set_stats. Buffers larger than
+ * the last class are only accounted in @ref umem_stats.
+ *
+ * @param mgr pointer to umem manager
+ * @param pool index of the size class, starting from 0 for the smallest
+ * @param size_p filled in with the size of the buffers of the class (may be
+ * NULL)
+ * @param allocs_p filled in with the number of buffers allocated in the
+ * class (may be NULL)
+ * @param fallbacks_p filled in with the number of buffers of the class that
+ * were allocated with malloc() because the pool was empty (may be NULL)
+ * @return an error code, UBASE_ERR_INVALID past the last class
+ */
+static inline int umem_pool_mgr_get_class_stats(struct umem_mgr *mgr,
+                                                unsigned int pool,
+                                                size_t *size_p,
+                                                uint64_t *allocs_p,
+                                                uint64_t *fallbacks_p)
+{
+    return umem_mgr_control(mgr, UMEM_POOL_MGR_GET_CLASS_STATS,
+                            UMEM_POOL_SIGNATURE, pool, size_p, allocs_p,
+                            fallbacks_p);
+}
+
 /** @This allocates a new instance of the umem pool manager allocating buffers
  * from application memory, using pools in power of 2's.
  *
@@ -52,6 +93,30 @@ extern "C" {
  */
 struct umem_mgr *umem_pool_mgr_alloc(size_t pool0_size, size_t nb_pools, ...);
 
+/** @This allocates a new instance of the umem pool manager, carving buffers
+ * of 64 KiB and more out of an arena of huge pages reserved at allocation.
+ * If no huge pages are reserved in the system, transparent huge pages are
+ * requested instead. When the arena is exhausted, buffers are allocated with
+ * malloc().
+ *
+ * @param arena_size size (in octets) of the arena
+ * @param page_size size (in octets) of the huge pages, typically 2 MiB or
+ * 1 GiB (if set to 0, 2 MiB is used)
+ * @param numa_node NUMA node to bind the arena to, or -1 for the default
+ * policy of the calling thread
+ * @param pool0_size size (in octets) of the smallest allocatable buffer; it
+ * must be a power of 2
+ * @param nb_pools number of buffer pools to maintain, with sizes in power of
+ * 2's increments, followed, for each pool, by the maximum number of buffers
+ * to keep in the pool (unsigned int); larger buffers will be directly managed
+ * with malloc() and free()
+ * @return pointer to manager, or NULL in case of error
+ */
+struct umem_mgr *umem_pool_mgr_alloc_arena(size_t arena_size,
+                                           size_t page_size, int numa_node,
+                                           size_t pool0_size,
+                                           size_t nb_pools, ...);
+
 
 /** @This allocates a new instance of the umem pool manager allocating buffers
  * from application memory, using pools in power of 2's, with a simpler API.
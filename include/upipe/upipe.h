@@ -39,6 +39,8 @@ extern "C" {
 #include <upipe/uprobe.h>
 #include <upipe/urequest.h>
 #include <upipe/udict_dump.h>
+#include <upipe/upipe_stats.h>
+#include <upipe/utrace.h>
 
 #include <stdint.h>
 #include <stdarg.h>
@@ -161,6 +163,17 @@ enum upipe_command {
      * position (uint64_t) and length (uint64_t) */
     UPIPE_SRC_GET_RANGE,
 
+    /*
+     * Instrumentation commands
+     */
+    /** returns the counters of an instrumented pipe (struct upipe_stats *) */
+    UPIPE_GET_STATS,
+    /** returns the urefs buffered by the pipe (struct upipe_occupancy *) */
+    UPIPE_GET_OCCUPANCY,
+    /** restricts the instruction set extensions used by the kernels of the
+     * pipe (uint32_t) */
+    UPIPE_SET_CPU_FLAGS,
+
     /** non-standard commands implemented by a module type can start from
      * there (first arg = signature) */
     UPIPE_CONTROL_LOCAL = 0x8000
@@ -179,6 +192,8 @@ struct upipe {
     struct uprobe *uprobe;
     /** pointer to the manager for this pipe type */
     struct upipe_mgr *mgr;
+    /** optional counters, see @ref upipe_stats_enable */
+    struct upipe_stats *stats;
 };
 
 UBASE_FROM_TO(upipe, uchain, uchain, uchain)
@@ -358,6 +373,9 @@ static inline const char *upipe_command_str(struct upipe *upipe, int cmd)
     UBASE_CASE_TO_STR(UPIPE_SRC_SET_POSITION);
     UBASE_CASE_TO_STR(UPIPE_SRC_GET_RANGE);
     UBASE_CASE_TO_STR(UPIPE_SRC_SET_RANGE);
+    UBASE_CASE_TO_STR(UPIPE_GET_STATS);
+    UBASE_CASE_TO_STR(UPIPE_GET_OCCUPANCY);
+    UBASE_CASE_TO_STR(UPIPE_SET_CPU_FLAGS);
     case UPIPE_CONTROL_LOCAL: break;
     }
     return NULL;
@@ -440,6 +458,7 @@ static inline void upipe_init(struct upipe *upipe, struct upipe_mgr *mgr,
     upipe->uprobe = uprobe;
     upipe->refcount = NULL;
     upipe->mgr = mgr;
+    upipe->stats = upipe_stats_alloc_default();
     upipe_mgr_use(mgr);
 }
 
@@ -518,6 +537,7 @@ static inline void upipe_set_opaque(struct upipe *upipe, void *opaque)
 static inline void upipe_push_probe(struct upipe *upipe, struct uprobe *uprobe)
 {
     uprobe->next = upipe->uprobe;
+    uprobe_update_chain(uprobe);
     upipe->uprobe = uprobe;
 }
 
@@ -546,6 +566,8 @@ static inline struct uprobe *upipe_pop_probe(struct upipe *upipe)
 static inline void upipe_clean(struct upipe *upipe)
 {
     assert(upipe != NULL);
+    if (unlikely(upipe->stats != NULL))
+        upipe_stats_disable(upipe);
     uprobe_release(upipe->uprobe);
     upipe_mgr_release(upipe->mgr);
 }
@@ -559,6 +581,7 @@ static inline void upipe_clean(struct upipe *upipe)
  */
 static inline int upipe_throw_va(struct upipe *upipe, int event, va_list args)
 {
+    UTRACE3(upipe_throw, upipe, upipe->mgr->signature, event);
     return uprobe_throw_va(upipe->uprobe, upipe, event, args);
 }
 
@@ -598,6 +621,8 @@ static inline void upipe_log_va(struct upipe *upipe,
                                 enum uprobe_log_level level,
                                 const char *format, ...)
 {
+    if (!uprobe_log_enabled(upipe->uprobe, level))
+        return;
     UBASE_VARARG(upipe_log(upipe, level, string))
 }
 
@@ -617,6 +642,8 @@ static inline void upipe_log_va(struct upipe *upipe,
 UBASE_FMT_PRINTF(2, 3)
 static inline void upipe_err_va(struct upipe *upipe, const char *format, ...)
 {
+    if (!uprobe_log_enabled(upipe->uprobe, UPROBE_LOG_ERROR))
+        return;
     UBASE_VARARG(upipe_err(upipe, string))
 }
 
@@ -636,6 +663,8 @@ static inline void upipe_err_va(struct upipe *upipe, const char *format, ...)
 UBASE_FMT_PRINTF(2, 3)
 static inline void upipe_warn_va(struct upipe *upipe, const char *format, ...)
 {
+    if (!uprobe_log_enabled(upipe->uprobe, UPROBE_LOG_WARNING))
+        return;
     UBASE_VARARG(upipe_warn(upipe, string))
 }
 
@@ -655,6 +684,8 @@ static inline void upipe_warn_va(struct upipe *upipe, const char *format, ...)
 UBASE_FMT_PRINTF(2, 3)
 static inline void upipe_notice_va(struct upipe *upipe, const char *format, ...)
 {
+    if (!uprobe_log_enabled(upipe->uprobe, UPROBE_LOG_NOTICE))
+        return;
     UBASE_VARARG(upipe_notice(upipe, string))
 }
 
@@ -674,6 +705,8 @@ static inline void upipe_notice_va(struct upipe *upipe, const char *format, ...)
 UBASE_FMT_PRINTF(2, 3)
 static inline void upipe_dbg_va(struct upipe *upipe, const char *format, ...)
 {
+    if (!uprobe_log_enabled(upipe->uprobe, UPROBE_LOG_DEBUG))
+        return;
     UBASE_VARARG(upipe_dbg(upipe, string))
 }
 
@@ -695,6 +728,8 @@ UBASE_FMT_PRINTF(2, 3)
 static inline void upipe_verbose_va(struct upipe *upipe,
                                     const char *format, ...)
 {
+    if (!uprobe_log_enabled(upipe->uprobe, UPROBE_LOG_VERBOSE))
+        return;
     UBASE_VARARG(upipe_verbose(upipe, string))
 }
 
@@ -1057,7 +1092,12 @@ static inline void upipe_input(struct upipe *upipe, struct uref *uref,
         return;
     }
     upipe_use(upipe);
-    upipe->mgr->upipe_input(upipe, uref, upump_p);
+    UTRACE3(upipe_input, upipe, upipe->mgr->signature, uref);
+    if (unlikely(upipe->stats != NULL))
+        upipe_stats_input(upipe, uref, upump_p);
+    else
+        upipe->mgr->upipe_input(upipe, uref, upump_p);
+    UTRACE3(upipe_input_return, upipe, upipe->mgr->signature, uref);
     upipe_release(upipe);
 }
 
@@ -1082,7 +1122,10 @@ static inline int upipe_control_nodbg_va(struct upipe *upipe,
 
     int err;
     upipe_use(upipe);
-    err = upipe->mgr->upipe_control(upipe, command, args);
+    if (unlikely(upipe->stats != NULL))
+        err = upipe_stats_control(upipe, command, args);
+    else
+        err = upipe->mgr->upipe_control(upipe, command, args);
     upipe_release(upipe);
     return err;
 }
@@ -1500,6 +1543,47 @@ static inline int upipe_src_set_range(struct upipe *upipe,
     return upipe_control(upipe, UPIPE_SRC_SET_RANGE, offset, length);
 }
 
+/** @This returns the counters of an instrumented pipe.
+ *
+ * @param upipe description structure of the pipe
+ * @param stats filled in with the current values of the counters
+ * @return an error code, UBASE_ERR_UNHANDLED if the pipe is not
+ * instrumented
+ */
+static inline int upipe_get_stats(struct upipe *upipe,
+                                  struct upipe_stats *stats)
+{
+    return upipe_control(upipe, UPIPE_GET_STATS, stats);
+}
+
+/** @This returns the urefs buffered by a pipe, for instance in a queue or
+ * a reorder buffer. This may be implemented by pipes which hold urefs for
+ * a significant time.
+ *
+ * @param upipe description structure of the pipe
+ * @param occupancy filled in with the buffered urefs
+ * @return an error code, UBASE_ERR_UNHANDLED if the pipe doesn't buffer
+ */
+static inline int upipe_get_occupancy(struct upipe *upipe,
+                                      struct upipe_occupancy *occupancy)
+{
+    upipe_occupancy_init(occupancy);
+    return upipe_control(upipe, UPIPE_GET_OCCUPANCY, occupancy);
+}
+
+/** @This restricts the instruction set extensions that a pipe may use, and
+ * selects its kernels again. This is intended to compare the output or the
+ * speed of several implementations on the same machine.
+ *
+ * @param upipe description structure of the pipe
+ * @param flags combination of @ref ucpu_flag to allow, or @ref UCPU_ALL
+ * @return an error code, UBASE_ERR_UNHANDLED if the pipe has no kernels
+ */
+static inline int upipe_set_cpu_flags(struct upipe *upipe, uint32_t flags)
+{
+    return upipe_control(upipe, UPIPE_SET_CPU_FLAGS, flags);
+}
+
 /** @This declares twelve functions to allocate pipes with a certain pipe
  * allocator.
  *
@@ -25,6 +25,12 @@
 
 /** @file
  * @short Upipe pipeline dumping for debug purposes
+ *
+ * Pipelines may be dumped once in dot or JSON format, or periodically with
+ * a live dump (see @ref upipe_dump_live_alloc). Pipes which buffer urefs
+ * (queues, reorder buffers, synchronizers) report their occupancy with
+ * @ref upipe_get_occupancy, which is printed on the pipe and on the edge
+ * leading to it.
  */
 
 #ifndef _UPIPE_UPIPE_DUMP_H_
@@ -37,6 +43,25 @@ extern "C" {
 #include <upipe/ubase.h>
 #include <upipe/upipe.h>
 
+#include <stdio.h>
+
+/** @hidden */
+struct upump_mgr;
+/** @hidden */
+struct uref_mgr;
+/** @hidden */
+struct ubuf_mgr;
+/** @hidden */
+struct upipe_dump_live;
+
+/** @This defines the formats of a dump. */
+enum upipe_dump_format {
+    /** graphviz dot */
+    UPIPE_DUMP_FORMAT_DOT,
+    /** JSON object with the lists of pipes and pools */
+    UPIPE_DUMP_FORMAT_JSON,
+};
+
 /** @This represents a dumping function for pipe labels. */
 typedef char *(upipe_dump_pipe_label)(struct upipe *);
 
@@ -121,6 +146,98 @@ static inline int upipe_dump_open(upipe_dump_pipe_label pipe_label,
     return err;
 }
 
+/** @This dumps a pipeline in JSON format. The object contains an array of
+ * pipes, with their identifier, label, signature, sub, inner and output
+ * relations, counters and occupancy, and an empty array of pools.
+ *
+ * @param pipe_label function to print pipe labels
+ * @param file file pointer to write to
+ * @param ulist list of sources pipes in ulist format
+ * @param args list of sources pipes terminated with NULL
+ */
+void upipe_dump_json_va(upipe_dump_pipe_label pipe_label,
+                        FILE *file, struct uchain *ulist, va_list args);
+
+/** @This dumps a pipeline in JSON format with a variable list of arguments.
+ *
+ * @param pipe_label function to print pipe labels
+ * @param file file pointer to write to
+ * @param ulist list of sources pipes in ulist format, followed by a list of
+ * source pipes terminated by NULL
+ */
+static inline void upipe_dump_json(upipe_dump_pipe_label pipe_label,
+                                   FILE *file, struct uchain *ulist, ...)
+{
+    va_list args;
+    va_start(args, ulist);
+    upipe_dump_json_va(pipe_label, file, ulist, args);
+    va_end(args);
+}
+
+/** @This allocates a live dump, which periodically writes a snapshot of
+ * the pipelines. The snapshot runs in the thread of the upump manager, which
+ * must be the thread running the source pipes.
+ *
+ * @param upump_mgr upump manager of the thread running the pipes, or NULL
+ * to only write snapshots with @ref upipe_dump_live_write
+ * @param period snapshot period in units of UCLOCK_FREQ
+ * @param format format of the snapshot
+ * @param path path of the file to write
+ * @param pipe_label function to print pipe labels (may be NULL)
+ * @param flow_def_label function to print flow_def labels (may be NULL)
+ * @return pointer to the live dump, or NULL in case of error
+ */
+struct upipe_dump_live *upipe_dump_live_alloc(struct upump_mgr *upump_mgr,
+        uint64_t period, enum upipe_dump_format format, const char *path,
+        upipe_dump_pipe_label pipe_label,
+        upipe_dump_flow_def_label flow_def_label);
+
+/** @This adds a source pipe to a live dump. The live dump keeps a
+ * reference on the pipe until it is freed.
+ *
+ * @param live pointer to the live dump
+ * @param source source pipe
+ * @return an error code
+ */
+int upipe_dump_live_add_source(struct upipe_dump_live *live,
+                               struct upipe *source);
+
+/** @This adds the pool of a uref manager to a live dump. The statistics of
+ * the manager are enabled, which resets them.
+ *
+ * @param live pointer to the live dump
+ * @param name name of the pool
+ * @param uref_mgr uref manager
+ * @return an error code
+ */
+int upipe_dump_live_add_uref_mgr(struct upipe_dump_live *live,
+                                 const char *name, struct uref_mgr *uref_mgr);
+
+/** @This adds the pools of a ubuf manager to a live dump. The statistics of
+ * the manager are enabled, which resets them.
+ *
+ * @param live pointer to the live dump
+ * @param name name of the pool
+ * @param ubuf_mgr ubuf manager
+ * @return an error code
+ */
+int upipe_dump_live_add_ubuf_mgr(struct upipe_dump_live *live,
+                                 const char *name, struct ubuf_mgr *ubuf_mgr);
+
+/** @This writes a snapshot of a live dump now. The snapshot is written to a
+ * temporary file, which then replaces the previous snapshot.
+ *
+ * @param live pointer to the live dump
+ * @return an error code
+ */
+int upipe_dump_live_write(struct upipe_dump_live *live);
+
+/** @This frees a live dump, and releases the source pipes and managers.
+ *
+ * @param live pointer to the live dump
+ */
+void upipe_dump_live_free(struct upipe_dump_live *live);
+
 #ifdef __cplusplus
 }
 #endif
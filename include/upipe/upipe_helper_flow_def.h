@@ -39,7 +39,7 @@ extern "C" {
 #include <upipe/uref_attr.h>
 #include <upipe/upipe.h>
 
-/** @This declares six functions dealing with the management of flow definitions
+/** @This declares eight functions dealing with the management of flow definitions
  * in linear pipes.
  *
  * You must add two members to your private upipe structure, for instance:
@@ -74,6 +74,13 @@ extern "C" {
  * Checks a new flow definitions attributes packet against the stored one.
  *
  * @item @code
+ *  bool upipe_foo_check_flow_def_input(struct upipe *upipe,
+ *                                      struct uref *flow_def_input)
+ * @end code
+ * Checks a new input flow definition against the stored one, in constant
+ * time if it was duplicated from the same flow definition.
+ *
+ * @item @code
  *  struct uref *upipe_foo_store_flow_def_attr(struct upipe *upipe,
  *                                             struct uref *flow_def_attr)
  * @end code
@@ -155,6 +162,21 @@ static UBASE_UNUSED bool                                                    \
     return s->FLOW_DEF_ATTR != NULL &&                                      \
            !udict_cmp(s->FLOW_DEF_ATTR->udict, flow_def_attr->udict);       \
 }                                                                           \
+/** @internal @This checks an input flow definition packet against the    \
+ * stored input flow definition.                                            \
+ *                                                                          \
+ * @param upipe description structure of the pipe                           \
+ * @param flow_def_input new input flow definition packet                   \
+ * @return false if the input flow definitions are different                \
+ */                                                                         \
+static UBASE_UNUSED bool                                                    \
+    STRUCTURE##_check_flow_def_input(struct upipe *upipe,                   \
+                                     struct uref *flow_def_input)           \
+{                                                                           \
+    struct STRUCTURE *s = STRUCTURE##_from_upipe(upipe);                    \
+    return s->FLOW_DEF_INPUT != NULL &&                                     \
+           !udict_cmp(s->FLOW_DEF_INPUT->udict, flow_def_input->udict);     \
+}                                                                           \
 /** @internal @This stores a flow def attributes uref, and returns the new  \
  * flow definition.                                                         \
  *                                                                          \
@@ -248,8 +248,11 @@ static UBASE_UNUSED void STRUCTURE##_output(struct upipe *upipe,            \
             }                                                               \
                                                                             \
             case UPIPE_HELPER_OUTPUT_VALID:                                 \
-                if (uref != NULL)                                           \
+                if (uref != NULL) {                                         \
+                    if (unlikely(upipe->stats != NULL))                     \
+                        upipe_stats_output(upipe, uref);                    \
                     upipe_input(s->OUTPUT, uref, upump_p);                  \
+                }                                                           \
                 return;                                                     \
                                                                             \
             case UPIPE_HELPER_OUTPUT_INVALID:                               \
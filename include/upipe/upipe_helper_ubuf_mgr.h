@@ -64,6 +64,10 @@ typedef int (*upipe_helper_ubuf_mgr_register)(struct upipe *, struct urequest *)
  * and provide two functions which will be called 1/ when the ubuf manager is
  * provided, 2/ and 3/ when a request needs to be registered/unregistered.
  *
+ * If the pipe is instrumented (see @ref upipe_stats_enable), the ubuf
+ * manager is wrapped to account the allocations, so ubufs allocated from
+ * it reference @ref ubuf_mgr_unwrap of the manager.
+ *
  * Supposing the name of your structure is upipe_foo, it declares:
  * @list
  * @item @code
@@ -133,7 +137,8 @@ static int STRUCTURE##_provide_ubuf_mgr(struct urequest *urequest,          \
     struct STRUCTURE *s = STRUCTURE##_from_upipe(upipe);                    \
     struct ubuf_mgr *ubuf_mgr = va_arg(args, struct ubuf_mgr *);            \
     struct uref *flow_format = va_arg(args, struct uref *);                 \
-    if (ubuf_mgr == s->UBUF_MGR && s->FLOW_FORMAT != NULL &&                \
+    if (ubuf_mgr == ubuf_mgr_unwrap(s->UBUF_MGR) &&                        \
+        s->FLOW_FORMAT != NULL &&                                           \
         s->FLOW_FORMAT->udict != NULL && flow_format->udict != NULL &&      \
         !udict_cmp(s->FLOW_FORMAT->udict, flow_format->udict)) {            \
         ubuf_mgr_release(ubuf_mgr);                                         \
@@ -141,6 +146,9 @@ static int STRUCTURE##_provide_ubuf_mgr(struct urequest *urequest,          \
         return UBASE_ERR_NONE;                                              \
     }                                                                       \
     ubuf_mgr_release(s->UBUF_MGR);                                          \
+    /* attribute the allocations to instrumented pipes */                   \
+    if (unlikely(upipe->stats != NULL))                                     \
+        ubuf_mgr = upipe_stats_wrap_ubuf_mgr(upipe, ubuf_mgr);              \
     s->UBUF_MGR = ubuf_mgr;                                                 \
     upipe_dbg_va(upipe, "provided ubuf_mgr %p", s->UBUF_MGR);               \
     uref_free(s->FLOW_FORMAT);                                              \
@@ -141,7 +141,9 @@ static void STRUCTURE##_append_uref_stream(struct upipe *upipe,             \
     ulist_add(&STRUCTURE->UREFS, uref_to_uchain(uref));                     \
 }                                                                           \
 /** @internal @This consumes the given number of octets from the uref       \
- * stream, and rotates the buffers accordingly.                             \
+ * stream, and rotates the buffers accordingly. The octets are removed in   \
+ * place and the segments are handed over from uref to uref, so that      \
+ * nothing is allocated.                                                    \
  *                                                                          \
  * @param upipe description structure of the pipe                           \
  * @param consumed number of octets consumed from the uref stream           \
@@ -152,18 +154,22 @@ static UBASE_UNUSED void                                                    \
     struct STRUCTURE *STRUCTURE = STRUCTURE##_from_upipe(upipe);            \
     assert(STRUCTURE->NEXT_UREF != NULL);                                   \
     assert(STRUCTURE->NEXT_UREF->ubuf != NULL);                             \
-    struct ubuf *ubuf = ubuf_block_splice(STRUCTURE->NEXT_UREF->ubuf,       \
-                                          consumed, -1);                    \
+    if (unlikely(!ubase_check(uref_block_consume(STRUCTURE->NEXT_UREF,      \
+                                                 consumed)))) {             \
+        upipe_throw_fatal(upipe, UBASE_ERR_INVALID);                        \
+        return;                                                             \
+    }                                                                       \
     while (consumed >= STRUCTURE->NEXT_UREF_SIZE) {                         \
         struct uchain *uchain = ulist_pop(&STRUCTURE->UREFS);               \
         if (uchain == NULL) {                                               \
             uref_free(STRUCTURE->NEXT_UREF);                                \
             STRUCTURE->NEXT_UREF = NULL;                                    \
-            ubuf_free(ubuf);                                                \
             return;                                                         \
         }                                                                   \
+        struct ubuf *ubuf = uref_detach_ubuf(STRUCTURE->NEXT_UREF);         \
         uref_free(STRUCTURE->NEXT_UREF);                                    \
         STRUCTURE->NEXT_UREF = uref_from_uchain(uchain);                    \
+        uref_attach_ubuf(STRUCTURE->NEXT_UREF, ubuf);                       \
         consumed -= STRUCTURE->NEXT_UREF_SIZE;                              \
         uint64_t size = 0;                                                  \
         uref_attr_get_priv(STRUCTURE->NEXT_UREF, &size);                    \
@@ -173,7 +179,6 @@ static UBASE_UNUSED void                                                    \
             cb(upipe);                                                      \
     }                                                                       \
     STRUCTURE->NEXT_UREF_SIZE -= consumed;                                  \
-    uref_attach_ubuf(STRUCTURE->NEXT_UREF, ubuf);                           \
 }                                                                           \
 /** @internal @This extracts the given number of octets from the uref       \
  * stream, and rotates the buffers accordingly.                             \
@@ -187,10 +192,24 @@ static struct uref *STRUCTURE##_extract_uref_stream(struct upipe *upipe,    \
 {                                                                           \
     struct STRUCTURE *STRUCTURE = STRUCTURE##_from_upipe(upipe);            \
     assert(STRUCTURE->NEXT_UREF != NULL);                                   \
-    struct uref *uref = uref_dup(STRUCTURE->NEXT_UREF);                     \
-    if (unlikely(uref == NULL))                                             \
+    assert(STRUCTURE->NEXT_UREF->ubuf != NULL);                             \
+    struct uref *uref;                                                      \
+    if (extracted == STRUCTURE->NEXT_UREF_SIZE &&                           \
+        ulist_empty(&STRUCTURE->UREFS)) {                                   \
+        /* the whole stream is extracted */                                 \
+        uref = STRUCTURE->NEXT_UREF;                                        \
+        STRUCTURE->NEXT_UREF = NULL;                                        \
+        return uref;                                                        \
+    }                                                                       \
+    struct ubuf *ubuf = ubuf_block_splice(STRUCTURE->NEXT_UREF->ubuf, 0,    \
+                                          extracted);                       \
+    if (unlikely(ubuf == NULL))                                             \
+        return NULL;                                                        \
+    uref = uref_fork(STRUCTURE->NEXT_UREF, ubuf);                           \
+    if (unlikely(uref == NULL)) {                                           \
+        ubuf_free(ubuf);                                                    \
         return NULL;                                                        \
-    uref_block_truncate(uref, extracted);                                   \
+    }                                                                       \
     STRUCTURE##_consume_uref_stream(upipe, extracted);                      \
     return uref;                                                            \
 }                                                                           \
@@ -0,0 +1,214 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/** @file
+ * @short Upipe optional instrumentation of pipes
+ *
+ * When counters are attached to a pipe, either explicitly with
+ * @ref upipe_stats_enable or for all new pipes after
+ * @ref upipe_stats_set_global, @ref upipe_input and @ref upipe_control
+ * account the number of urefs and octets received, the time spent in the
+ * pipe and the longest input call, and the output helper accounts the urefs
+ * sent downstream. Pipes without counters only pay a test of a pointer.
+ *
+ * The ubuf manager received by an instrumented pipe through
+ * @ref #UPIPE_HELPER_UBUF_MGR is wrapped so that the buffers it allocates
+ * are attributed to the pipe. The buffers held in internal queues are
+ * reported separately by @ref upipe_get_occupancy.
+ *
+ * The counters are only written by the thread running the pipe, with
+ * relaxed atomic operations, so that another thread may read them with
+ * @ref upipe_stats_read without locking.
+ */
+
+#ifndef _UPIPE_UPIPE_STATS_H_
+/** @hidden */
+#define _UPIPE_UPIPE_STATS_H_
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <upipe/ubase.h>
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdarg.h>
+
+/** @hidden */
+struct upipe;
+/** @hidden */
+struct uref;
+/** @hidden */
+struct upump;
+/** @hidden */
+struct ubuf_mgr;
+
+/** @This is the set of counters of an instrumented pipe. Durations are in
+ * units of UCLOCK_FREQ. */
+struct upipe_stats {
+    /** number of urefs received */
+    uint64_t urefs_in;
+    /** number of octets received */
+    uint64_t bytes_in;
+    /** number of urefs output */
+    uint64_t urefs_out;
+    /** number of octets output */
+    uint64_t bytes_out;
+    /** time spent in input calls */
+    uint64_t input_time;
+    /** longest input call */
+    uint64_t input_max;
+    /** number of control commands */
+    uint64_t controls;
+    /** time spent in control commands, including nested calls */
+    uint64_t control_time;
+    /** number of ubufs allocated from the ubuf manager of the pipe */
+    uint64_t ubufs_alloc;
+    /** number of octets allocated from the ubuf manager of the pipe */
+    uint64_t ubuf_bytes_alloc;
+};
+
+/** @This describes the urefs buffered by a pipe, as returned by
+ * @ref upipe_get_occupancy. Fields which the pipe cannot evaluate are set to
+ * UINT64_MAX. Durations are in units of UCLOCK_FREQ. */
+struct upipe_occupancy {
+    /** number of buffered urefs */
+    uint64_t urefs;
+    /** maximum number of buffered urefs, or 0 if unbounded */
+    uint64_t max_urefs;
+    /** number of buffered octets */
+    uint64_t bytes;
+    /** duration of the buffered urefs */
+    uint64_t duration;
+};
+
+/** @This initializes an occupancy structure with unknown values.
+ *
+ * @param occupancy pointer to the structure
+ */
+static inline void upipe_occupancy_init(struct upipe_occupancy *occupancy)
+{
+    occupancy->urefs = UINT64_MAX;
+    occupancy->max_urefs = UINT64_MAX;
+    occupancy->bytes = UINT64_MAX;
+    occupancy->duration = UINT64_MAX;
+}
+
+/** @This reads the counters of a pipe. It may be called from any thread.
+ *
+ * @param stats pointer to the counters of the pipe
+ * @param copy filled in with the current values
+ */
+static inline void upipe_stats_read(struct upipe_stats *stats,
+                                    struct upipe_stats *copy)
+{
+    copy->urefs_in = __atomic_load_n(&stats->urefs_in, __ATOMIC_RELAXED);
+    copy->bytes_in = __atomic_load_n(&stats->bytes_in, __ATOMIC_RELAXED);
+    copy->urefs_out = __atomic_load_n(&stats->urefs_out, __ATOMIC_RELAXED);
+    copy->bytes_out = __atomic_load_n(&stats->bytes_out, __ATOMIC_RELAXED);
+    copy->input_time = __atomic_load_n(&stats->input_time, __ATOMIC_RELAXED);
+    copy->input_max = __atomic_load_n(&stats->input_max, __ATOMIC_RELAXED);
+    copy->controls = __atomic_load_n(&stats->controls, __ATOMIC_RELAXED);
+    copy->control_time = __atomic_load_n(&stats->control_time,
+                                         __ATOMIC_RELAXED);
+    copy->ubufs_alloc = __atomic_load_n(&stats->ubufs_alloc,
+                                        __ATOMIC_RELAXED);
+    copy->ubuf_bytes_alloc = __atomic_load_n(&stats->ubuf_bytes_alloc,
+                                             __ATOMIC_RELAXED);
+}
+
+/** @This enables or disables the instrumentation of the pipes allocated
+ * from now on. It should be called before the pipelines are built.
+ *
+ * @param enabled true to attach counters to all new pipes
+ */
+void upipe_stats_set_global(bool enabled);
+
+/** @This attaches counters to a pipe, if it doesn't have them already. It
+ * must be called from the thread running the pipe.
+ *
+ * @param upipe description structure of the pipe
+ * @return an error code
+ */
+int upipe_stats_enable(struct upipe *upipe);
+
+/** @This detaches and frees the counters of a pipe. It must be called from
+ * the thread running the pipe.
+ *
+ * @param upipe description structure of the pipe
+ */
+void upipe_stats_disable(struct upipe *upipe);
+
+/** @internal @This allocates counters for a new pipe if the instrumentation
+ * is enabled globally.
+ *
+ * @return pointer to counters, or NULL
+ */
+struct upipe_stats *upipe_stats_alloc_default(void);
+
+/** @internal @This sends a uref to an instrumented pipe.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref uref structure to send
+ * @param upump_p reference to the pump that generated the buffer
+ */
+void upipe_stats_input(struct upipe *upipe, struct uref *uref,
+                       struct upump **upump_p);
+
+/** @internal @This sends a control command to an instrumented pipe, and
+ * handles @ref UPIPE_GET_STATS.
+ *
+ * @param upipe description structure of the pipe
+ * @param command control command to send
+ * @param args optional read or write parameters
+ * @return an error code
+ */
+int upipe_stats_control(struct upipe *upipe, int command, va_list args);
+
+/** @internal @This accounts a uref output by an instrumented pipe.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref uref structure output
+ */
+void upipe_stats_output(struct upipe *upipe, struct uref *uref);
+
+/** @internal @This wraps the ubuf manager of an instrumented pipe so that
+ * the buffers it allocates are accounted in the counters of the pipe. The
+ * wrapper keeps the counters alive, so it may outlive the pipe or be passed
+ * to other threads.
+ *
+ * @param upipe description structure of the pipe
+ * @param ubuf_mgr ubuf manager to wrap (belongs to the callee)
+ * @return pointer to the wrapping manager, or ubuf_mgr if the pipe is not
+ * instrumented or in case of allocation error
+ */
+struct ubuf_mgr *upipe_stats_wrap_ubuf_mgr(struct upipe *upipe,
+                                           struct ubuf_mgr *ubuf_mgr);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
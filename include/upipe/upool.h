@@ -24,7 +24,7 @@
  */
 
 /** @file
- * @short Upipe pool of buffers, based on @ref ulifo
+ * @short Upipe pool of buffers, based on @ref ulifo and @ref umagazine
  */
 
 #ifndef _UPIPE_UPOOL_H_
@@ -36,7 +36,12 @@ extern "C" {
 
 #include <upipe/ubase.h>
 #include <upipe/urefcount.h>
+#include <upipe/uatomic.h>
 #include <upipe/ulifo.h>
+#include <upipe/umagazine.h>
+
+#include <stdint.h>
+#include <stdbool.h>
 
 /** @hidden */
 struct upool;
@@ -46,16 +51,54 @@ typedef void *(*upool_alloc_cb)(struct upool *);
 /** @This is a call-back to release unused elements */
 typedef void (*upool_free_cb)(struct upool *, void *);
 
+/** @This is the set of counters of a upool, updated when statistics are
+ * enabled with @ref upool_set_stats. */
+struct upool_stats {
+    /** number of elements taken from the pool */
+    uint64_t hits;
+    /** number of elements allocated because the pool was empty */
+    uint64_t misses;
+    /** highest number of elements in use at the same time */
+    uint64_t high_water;
+    /** number of calls to @ref upool_vacuum */
+    uint64_t vacuums;
+    /** number of elements currently in use, among those allocated since
+     * the counters were enabled */
+    uint64_t in_use;
+};
+
+/** @internal @This is the set of atomic counters backing @ref upool_stats. */
+struct upool_counters {
+    /** number of elements taken from the pool */
+    uatomic_uint64_t hits;
+    /** number of elements allocated because the pool was empty */
+    uatomic_uint64_t misses;
+    /** highest number of elements in use at the same time */
+    uatomic_uint64_t high_water;
+    /** number of calls to @ref upool_vacuum */
+    uatomic_uint64_t vacuums;
+    /** number of elements currently in use, wrapping below zero when
+     * elements allocated before the counters were enabled are released */
+    uatomic_uint64_t in_use;
+};
+
 /** @This is the implementation of a pool of buffers. */
 struct upool {
     /** pointer to refcount management structure */
     struct urefcount *refcount;
     /** lifo */
     struct ulifo lifo;
+    /** per-thread magazines in front of the lifo */
+    struct umagazine magazine;
     /** call-back to allocate new elements */
     upool_alloc_cb alloc_cb;
     /** call-back to release unused elements */
     upool_free_cb free_cb;
+
+    /** true if the counters below are updated */
+    uatomic_uint32_t stats;
+    /** counters */
+    struct upool_counters counters;
 };
 
 /** @This returns the required size of extra data space for upool.
@@ -78,9 +121,66 @@ static inline void upool_init(struct upool *upool, struct urefcount *refcount,
                               upool_alloc_cb alloc_cb, upool_free_cb free_cb)
 {
     upool->refcount = refcount;
-    ulifo_init(&upool->lifo, length, extra);
+    ulifo_init(&upool->lifo, umagazine_init(&upool->magazine, length), extra);
     upool->alloc_cb = alloc_cb;
     upool->free_cb = free_cb;
+    uatomic_init(&upool->stats, false);
+    uatomic_uint64_init(&upool->counters.hits, 0);
+    uatomic_uint64_init(&upool->counters.misses, 0);
+    uatomic_uint64_init(&upool->counters.high_water, 0);
+    uatomic_uint64_init(&upool->counters.vacuums, 0);
+    uatomic_uint64_init(&upool->counters.in_use, 0);
+}
+
+/** @This enables or disables the counters of a upool. Enabling them resets
+ * the counters, and only the elements allocated from then on are accounted
+ * in the high-water mark.
+ *
+ * @param upool pointer to a upool structure
+ * @param enabled true to update the counters
+ */
+static inline void upool_set_stats(struct upool *upool, bool enabled)
+{
+    if (enabled) {
+        uatomic_uint64_store(&upool->counters.in_use, 0);
+        uatomic_uint64_store(&upool->counters.hits, 0);
+        uatomic_uint64_store(&upool->counters.misses, 0);
+        uatomic_uint64_store(&upool->counters.high_water, 0);
+        uatomic_uint64_store(&upool->counters.vacuums, 0);
+    }
+    uatomic_store(&upool->stats, enabled);
+}
+
+/** @This reads the counters of a upool. It may be called from any thread.
+ *
+ * @param upool pointer to a upool structure
+ * @param stats filled in with the current values
+ */
+static inline void upool_get_stats(struct upool *upool,
+                                   struct upool_stats *stats)
+{
+    stats->hits = uatomic_uint64_load(&upool->counters.hits);
+    stats->misses = uatomic_uint64_load(&upool->counters.misses);
+    stats->high_water = uatomic_uint64_load(&upool->counters.high_water);
+    stats->vacuums = uatomic_uint64_load(&upool->counters.vacuums);
+    int64_t in_use = uatomic_uint64_load(&upool->counters.in_use);
+    stats->in_use = in_use > 0 ? in_use : 0;
+}
+
+/** @internal @This accounts an allocation in the counters of a upool.
+ *
+ * @param upool pointer to a upool structure
+ * @param hit true if the element was taken from the pool
+ */
+static inline void upool_stats_alloc(struct upool *upool, bool hit)
+{
+    uatomic_uint64_fetch_add(hit ? &upool->counters.hits :
+                                   &upool->counters.misses, 1);
+    int64_t in_use = uatomic_uint64_fetch_add(&upool->counters.in_use, 1) + 1;
+    uint64_t high = uatomic_uint64_load(&upool->counters.high_water);
+    while (in_use > 0 && (uint64_t)in_use > high &&
+           !uatomic_uint64_compare_exchange(&upool->counters.high_water,
+                                            &high, in_use));
 }
 
 /** @This increments the reference count of a upool.
@@ -113,11 +213,15 @@ static inline void upool_release(struct upool *upool)
  */
 static inline void *upool_alloc_internal(struct upool *upool)
 {
-    void *obj = ulifo_pop(&upool->lifo, void *);
+    void *obj = umagazine_pop(&upool->magazine, &upool->lifo, void *);
+    bool hit = obj != NULL;
     if (unlikely(obj == NULL))
         obj = upool->alloc_cb(upool);
-    if (obj != NULL)
+    if (obj != NULL) {
         upool_use(upool);
+        if (unlikely(uatomic_load_relaxed(&upool->stats)))
+            upool_stats_alloc(upool, hit);
+    }
     return obj;
 }
 
@@ -136,11 +240,39 @@ static inline void *upool_alloc_internal(struct upool *upool)
  */
 static inline void upool_free(struct upool *upool, void *obj)
 {
-    if (unlikely(!ulifo_push(&upool->lifo, obj)))
+    if (unlikely(uatomic_load_relaxed(&upool->stats)))
+        uatomic_uint64_fetch_sub(&upool->counters.in_use, 1);
+    if (unlikely(!umagazine_push(&upool->magazine, &upool->lifo, obj)))
         upool->free_cb(upool, obj);
     upool_release(upool);
 }
 
+/** @This allocates elements in advance and keeps them in the shared LIFO,
+ * so that the first allocations after start-up do not hit the allocator.
+ * The per-thread magazines are bypassed so that the elements are available
+ * to every thread.
+ *
+ * @param upool pointer to a upool structure
+ * @param count number of elements to allocate
+ * @return number of elements actually added to the pool, which is lower
+ * than count if the pool is full or in case of allocation error
+ */
+static inline unsigned int upool_prefill(struct upool *upool,
+                                         unsigned int count)
+{
+    unsigned int i;
+    for (i = 0; i < count; i++) {
+        void *obj = upool->alloc_cb(upool);
+        if (unlikely(obj == NULL))
+            break;
+        if (unlikely(!ulifo_push(&upool->lifo, obj))) {
+            upool->free_cb(upool, obj);
+            break;
+        }
+    }
+    return i;
+}
+
 /** @This empties a upool.
  *
  * @param upool pointer to a upool structure
@@ -148,7 +280,10 @@ static inline void upool_free(struct upool *upool, void *obj)
 static inline void upool_vacuum(struct upool *upool)
 {
     void *obj;
-    while ((obj = ulifo_pop(&upool->lifo, void *)) != NULL) {
+    if (unlikely(uatomic_load_relaxed(&upool->stats)))
+        uatomic_uint64_fetch_add(&upool->counters.vacuums, 1);
+    while ((obj = umagazine_vacuum_pop(&upool->magazine,
+                                       &upool->lifo)) != NULL) {
         upool->free_cb(upool, obj);
         upool_release(upool);
     }
@@ -161,7 +296,14 @@ static inline void upool_vacuum(struct upool *upool)
 static inline void upool_clean(struct upool *upool)
 {
     upool_vacuum(upool);
+    umagazine_clean(&upool->magazine);
     ulifo_clean(&upool->lifo);
+    uatomic_clean(&upool->stats);
+    uatomic_uint64_clean(&upool->counters.hits);
+    uatomic_uint64_clean(&upool->counters.misses);
+    uatomic_uint64_clean(&upool->counters.high_water);
+    uatomic_uint64_clean(&upool->counters.vacuums);
+    uatomic_uint64_clean(&upool->counters.in_use);
 }
 
 #ifdef __cplusplus
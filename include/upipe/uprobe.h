@@ -39,6 +39,7 @@ extern "C" {
 #include <upipe/uref_flow.h>
 #include <upipe/ulog.h>
 
+#include <stdint.h>
 #include <stdbool.h>
 #include <stdarg.h>
 #include <assert.h>
@@ -147,6 +148,21 @@ static inline const char *uprobe_event_str(int event)
     return NULL;
 }
 
+/** @This returns the bit representing an event in an event mask. All local
+ * events share the same bit.
+ *
+ * @param event event type
+ * @return event mask
+ */
+#define UPROBE_EVENT_MASK(event)                                            \
+    (UINT64_C(1) << ((unsigned)(event) < 63 ? (unsigned)(event) : 63))
+
+/** event mask matching all events */
+#define UPROBE_EVENT_MASK_ALL UINT64_MAX
+
+/** log level above all levels, meaning no log event is printed */
+#define UPROBE_LOG_NONE (UPROBE_LOG_ERROR + 1)
+
 /** @This is the call-back type for uprobe events. */
 typedef int (*uprobe_throw_func)(struct uprobe *, struct upipe *, int, va_list);
 
@@ -159,6 +175,21 @@ struct uprobe {
     uprobe_throw_func uprobe_throw;
     /** pointer to next probe, to be used by the uprobe_throw function */
     struct uprobe *next;
+
+    /** mask of events handled by the uprobe_throw function, the others
+     * are directly thrown to the next probe */
+    uint64_t event_mask;
+    /** minimum level of log events printed, or passed through if
+     * log_filter is true */
+    int log_level;
+    /** true if log events are only filtered and passed to the next probe */
+    bool log_filter;
+
+    /** cached mask of events handled by this probe or the next ones */
+    uint64_t chain_mask;
+    /** cached minimum level of log events printed by this probe or the next
+     * ones */
+    int chain_log_level;
 };
 
 /** @This increments the reference count of a uprobe.
@@ -225,6 +256,98 @@ static inline void uprobe_init(struct uprobe *uprobe,
     uprobe->refcount = NULL;
     uprobe->uprobe_throw = uprobe_throw;
     uprobe->next = next;
+    /* by default, the probe may handle and print anything */
+    uprobe->event_mask = UPROBE_EVENT_MASK_ALL;
+    uprobe->log_level = UPROBE_LOG_VERBOSE;
+    uprobe->log_filter = false;
+    uprobe->chain_mask = UPROBE_EVENT_MASK_ALL;
+    uprobe->chain_log_level = UPROBE_LOG_VERBOSE;
+}
+
+/** @internal @This updates the cached masks of a probe after its own
+ * masks or its next probe was changed. Please note that the probes already
+ * chained on top of this probe are not updated.
+ *
+ * @param uprobe pointer to probe
+ */
+static inline void uprobe_update_chain(struct uprobe *uprobe)
+{
+    uint64_t next_mask = 0;
+    int next_log_level = UPROBE_LOG_NONE;
+    if (uprobe->next != NULL) {
+        next_mask = uprobe->next->chain_mask;
+        if (uprobe->next->chain_mask & UPROBE_EVENT_MASK(UPROBE_LOG))
+            next_log_level = uprobe->next->chain_log_level;
+    }
+
+    uprobe->chain_mask = uprobe->event_mask | next_mask;
+    if (!(uprobe->event_mask & UPROBE_EVENT_MASK(UPROBE_LOG)))
+        uprobe->chain_log_level = next_log_level;
+    else if (!uprobe->log_filter)
+        uprobe->chain_log_level = uprobe->log_level;
+    else
+        uprobe->chain_log_level = uprobe->log_level > next_log_level ?
+                                  uprobe->log_level : next_log_level;
+}
+
+/** @This declares the events handled by the uprobe_throw function of a
+ * probe. The other events are directly thrown to the next probe, so the
+ * function must not do anything else with them than
+ * @ref uprobe_throw_next. It is typically called by the initializer of
+ * the probe, before other probes are chained on top of it.
+ *
+ * @param uprobe pointer to probe
+ * @param event_mask mask of handled events, built with
+ * @ref UPROBE_EVENT_MASK
+ */
+static inline void uprobe_set_event_mask(struct uprobe *uprobe,
+                                         uint64_t event_mask)
+{
+    uprobe->event_mask = event_mask;
+    uprobe_update_chain(uprobe);
+}
+
+/** @This declares the minimum level of the log events printed by a probe
+ * which doesn't pass log events to the next probe. It is typically called
+ * by the initializer of the probe, before other probes are chained on top
+ * of it.
+ *
+ * @param uprobe pointer to probe
+ * @param log_level minimum level of printed log events
+ */
+static inline void uprobe_set_log_level(struct uprobe *uprobe, int log_level)
+{
+    uprobe->log_level = log_level;
+    uprobe->log_filter = false;
+    uprobe_update_chain(uprobe);
+}
+
+/** @This declares the minimum level of the log events passed by a probe
+ * to the next probe. It is typically called by the initializer of the
+ * probe, before other probes are chained on top of it.
+ *
+ * @param uprobe pointer to probe
+ * @param log_level minimum level of log events passed to the next probe
+ */
+static inline void uprobe_set_log_filter(struct uprobe *uprobe, int log_level)
+{
+    uprobe->log_level = log_level;
+    uprobe->log_filter = true;
+    uprobe_update_chain(uprobe);
+}
+
+/** @This checks if a log event may be printed by a probe hierarchy, so
+ * that messages may not be formatted needlessly.
+ *
+ * @param uprobe pointer to probe hierarchy
+ * @param level level of importance of the message
+ * @return false if the message would not be printed
+ */
+static inline bool uprobe_log_enabled(struct uprobe *uprobe, int level)
+{
+    return uprobe != NULL &&
+           (uprobe->chain_mask & UPROBE_EVENT_MASK(UPROBE_LOG)) &&
+           level >= uprobe->chain_log_level;
 }
 
 /** @This cleans up a uprobe structure. It is typically called by the
@@ -260,8 +383,15 @@ struct uprobe *uprobe_alloc(uprobe_throw_func func, struct uprobe *next);
 static inline int uprobe_throw_va(struct uprobe *uprobe, struct upipe *upipe,
                                   int event, va_list args)
 {
-    if (unlikely(uprobe == NULL))
+    uint64_t mask = UPROBE_EVENT_MASK(event);
+    if (unlikely(uprobe == NULL) || !(uprobe->chain_mask & mask))
         return UBASE_ERR_UNHANDLED;
+    /* skip the probes which would only pass the event to the next one */
+    while (!(uprobe->event_mask & mask)) {
+        uprobe = uprobe->next;
+        if (unlikely(uprobe == NULL))
+            return UBASE_ERR_UNHANDLED;
+    }
     return uprobe->uprobe_throw(uprobe, upipe, event, args);
 }
 
@@ -307,6 +437,8 @@ static inline int uprobe_throw_next(struct uprobe *uprobe, struct upipe *upipe,
 static inline void uprobe_log(struct uprobe *uprobe, struct upipe *upipe,
                               enum uprobe_log_level level, const char *msg)
 {
+    if (!uprobe_log_enabled(uprobe, level))
+        return;
     struct ulog ulog;
     ulog_init(&ulog, level, msg);
     uprobe_throw(uprobe, upipe, UPROBE_LOG, &ulog);
@@ -324,6 +456,8 @@ static inline void uprobe_log_va(struct uprobe *uprobe, struct upipe *upipe,
                                 enum uprobe_log_level level,
                                 const char *format, ...)
 {
+    if (!uprobe_log_enabled(uprobe, level))
+        return;
     UBASE_VARARG(uprobe_log(uprobe, upipe, level, string))
 }
 
@@ -347,6 +481,8 @@ UBASE_FMT_PRINTF(3, 4)
 static inline void uprobe_err_va(struct uprobe *uprobe, struct upipe *upipe,
                                  const char *format, ...)
 {
+    if (!uprobe_log_enabled(uprobe, UPROBE_LOG_ERROR))
+        return;
     UBASE_VARARG(uprobe_err(uprobe, upipe, string))
 }
 
@@ -370,6 +506,8 @@ UBASE_FMT_PRINTF(3, 4)
 static inline void uprobe_warn_va(struct uprobe *uprobe, struct upipe *upipe,
                                   const char *format, ...)
 {
+    if (!uprobe_log_enabled(uprobe, UPROBE_LOG_WARNING))
+        return;
     UBASE_VARARG(uprobe_warn(uprobe, upipe, string))
 }
 
@@ -393,6 +531,8 @@ UBASE_FMT_PRINTF(3, 4)
 static inline void uprobe_notice_va(struct uprobe *uprobe, struct upipe *upipe,
                                     const char *format, ...)
 {
+    if (!uprobe_log_enabled(uprobe, UPROBE_LOG_NOTICE))
+        return;
     UBASE_VARARG(uprobe_notice(uprobe, upipe, string))
 }
 
@@ -416,6 +556,8 @@ UBASE_FMT_PRINTF(3, 4)
 static inline void uprobe_dbg_va(struct uprobe *uprobe, struct upipe *upipe,
                                  const char *format, ...)
 {
+    if (!uprobe_log_enabled(uprobe, UPROBE_LOG_DEBUG))
+        return;
     UBASE_VARARG(uprobe_dbg(uprobe, upipe, string))
 }
 
@@ -440,6 +582,8 @@ UBASE_FMT_PRINTF(3, 4)
 static inline void uprobe_verbose_va(struct uprobe *uprobe, struct upipe *upipe,
                                  const char *format, ...)
 {
+    if (!uprobe_log_enabled(uprobe, UPROBE_LOG_VERBOSE))
+        return;
     UBASE_VARARG(uprobe_verbose(uprobe, upipe, string))
 }
 
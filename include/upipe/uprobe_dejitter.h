@@ -39,6 +39,9 @@ extern "C" {
 
 #include <stdint.h>
 
+/** @hidden */
+struct uprobe_dejitter_hists;
+
 /** @This is a super-set of the uprobe structure with additional local
  * members. */
 struct uprobe_dejitter {
@@ -67,12 +70,49 @@ struct uprobe_dejitter {
     /** cr_sys of the last debug print */
     uint64_t last_print;
 
+    /** duration of a statistics window, or 0 if disabled */
+    uint64_t stats_window;
+    /** rolling histograms, allocated when statistics are enabled */
+    struct uprobe_dejitter_hists *hists;
+
     /** structure exported to modules */
     struct uprobe uprobe;
 };
 
 UPROBE_HELPER_UPROBE(uprobe_dejitter, uprobe)
 
+/** @This describes the distribution of a measure, in 27 MHz units. */
+struct uprobe_dejitter_quantiles {
+    /** minimum value */
+    uint64_t min;
+    /** median */
+    uint64_t p50;
+    /** 90th percentile */
+    uint64_t p90;
+    /** 99th percentile */
+    uint64_t p99;
+    /** 99.9th percentile */
+    uint64_t p999;
+    /** maximum value */
+    uint64_t max;
+};
+
+/** @This groups the clock recovery statistics over the last one to two
+ * windows. */
+struct uprobe_dejitter_stats {
+    /** duration covered by the statistics */
+    uint64_t duration;
+    /** number of clock references accounted for */
+    uint64_t count;
+    /** absolute difference between a clock reference and the filtered
+     * offset, ie. the input jitter */
+    struct uprobe_dejitter_quantiles jitter;
+    /** absolute phase error of the PLL, ie. the offset drift */
+    struct uprobe_dejitter_quantiles error;
+    /** average absolute deviation after each clock reference */
+    struct uprobe_dejitter_quantiles deviation;
+};
+
 /** @This initializes an already allocated uprobe_dejitter structure.
  *
  * @param uprobe_pfx pointer to the already allocated structure
@@ -110,6 +150,25 @@ struct uprobe *uprobe_dejitter_alloc(struct uprobe *next, bool enabled,
 void uprobe_dejitter_set(struct uprobe *uprobe, bool enabled,
                          uint64_t deviation);
 
+/** @This enables or disables the clock recovery statistics. The histograms
+ * are kept over two rolling windows of the given duration, so that a query
+ * always covers between one and two windows.
+ *
+ * @param uprobe pointer to probe
+ * @param window duration of a window in 27 MHz units, or 0 to disable
+ * @return an error code
+ */
+int uprobe_dejitter_set_stats(struct uprobe *uprobe, uint64_t window);
+
+/** @This returns the clock recovery statistics.
+ *
+ * @param uprobe pointer to probe
+ * @param stats filled in with the statistics
+ * @return an error code, UBASE_ERR_INVALID if statistics are disabled
+ */
+int uprobe_dejitter_get_stats(struct uprobe *uprobe,
+                              struct uprobe_dejitter_stats *stats);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,73 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short Upipe timer wheel on top of another upump manager
+ *
+ * This manager keeps its timers in a hierarchical wheel of coarse slots,
+ * driven by a single periodic timer of the underlying manager, so that
+ * thousands of timers cost one wakeup per slot, and starting or stopping a
+ * timer is O(1). Timers expire at the end of their slot, so they may fire
+ * up to one granularity late. The other types of pumps are allocated from
+ * the underlying manager.
+ */
+
+#ifndef _UPIPE_UPUMP_WHEEL_H_
+/** @hidden */
+#define _UPIPE_UPUMP_WHEEL_H_
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <upipe/upump.h>
+
+#include <stdint.h>
+
+#define UPUMP_WHEEL_SIGNATURE UBASE_FOURCC('w','h','e','l')
+
+/** @hidden */
+struct uclock;
+
+/** @This allocates and initializes a upump_mgr structure whose timers are
+ * kept in a timer wheel.
+ *
+ * @param base underlying upump manager, which runs the event loop
+ * @param uclock clock giving the current date
+ * @param granularity duration of a slot, in 27 MHz ticks
+ * @param upump_pool_depth maximum number of upump structures in the pool
+ * @param upump_blocker_pool_depth maximum number of upump_blocker structures
+ * in the pool
+ * @return pointer to the wrapped upump_mgr structure
+ */
+struct upump_mgr *upump_wheel_mgr_alloc(struct upump_mgr *base,
+                                        struct uclock *uclock,
+                                        uint64_t granularity,
+                                        uint16_t upump_pool_depth,
+                                        uint16_t upump_blocker_pool_depth);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -40,10 +40,16 @@ extern "C" {
 #include <upipe/ufifo.h>
 #include <upipe/ueventfd.h>
 #include <upipe/upump.h>
+#include <upipe/utrace.h>
 
 #include <stdint.h>
 #include <assert.h>
 
+#if defined(UPIPE_HAVE_FUTEX) && defined(UPIPE_HAVE_ATOMIC_OPS)
+/** @hidden futexes need plain 32-bit atomic words */
+#define UQUEUE_HAVE_FUTEX
+#endif
+
 /** @This is the implementation of a queue. */
 struct uqueue {
     /** FIFO */
@@ -56,6 +62,19 @@ struct uqueue {
     struct ueventfd event_push;
     /** ueventfd triggered when data can be popped */
     struct ueventfd event_pop;
+
+    /** true if waiters are woken up with futexes instead of ueventfds */
+    bool futex;
+    /** incremented when data can be pushed, in futex mode */
+    uatomic_uint32_t push_seq;
+    /** incremented when data can be popped, in futex mode */
+    uatomic_uint32_t pop_seq;
+    /** number of threads sleeping on the futexes */
+    uatomic_uint32_t waiters;
+    /** current number of spins before sleeping in @ref uqueue_wait_push */
+    uint32_t push_spin;
+    /** current number of spins before sleeping in @ref uqueue_wait_pop */
+    uint32_t pop_spin;
 };
 
 /** @This returns the required size of extra data space for uqueue.
@@ -86,7 +105,150 @@ static inline bool uqueue_init(struct uqueue *uqueue, uint8_t length,
     ufifo_init(&uqueue->fifo, length, extra);
     uatomic_init(&uqueue->counter, 0);
     uqueue->length = length;
+    uqueue->futex = false;
+    return true;
+}
+
+/** @This initializes a uqueue whose waiters are woken up with futexes
+ * instead of ueventfds, for hand-offs between threads that both run upipe
+ * code. Pushing and popping then never issue a system call unless the other
+ * side sleeps in @ref uqueue_wait_push or @ref uqueue_wait_pop, and the
+ * watchers of @ref uqueue_upump_alloc_push and @ref uqueue_upump_alloc_pop
+ * are idlers polling the queue, which is intended for event loops running
+ * on dedicated cores, for instance in busy-poll mode.
+ *
+ * @param uqueue pointer to a uqueue structure
+ * @param length maximum number of elements in the queue
+ * @param extra mandatory extra space allocated by the caller, with the size
+ * returned by @ref #ufifo_sizeof
+ * @return false in case of failure, or if futexes are not supported
+ */
+static inline bool uqueue_init_futex(struct uqueue *uqueue, uint8_t length,
+                                     void *extra)
+{
+#ifdef UQUEUE_HAVE_FUTEX
+    ufifo_init(&uqueue->fifo, length, extra);
+    uatomic_init(&uqueue->counter, 0);
+    uqueue->length = length;
+    uqueue->futex = true;
+    uatomic_init(&uqueue->push_seq, 0);
+    uatomic_init(&uqueue->pop_seq, 0);
+    uatomic_init(&uqueue->waiters, 0);
+    uqueue->push_spin = 0;
+    uqueue->pop_spin = 0;
     return true;
+#else
+    return false;
+#endif
+}
+
+/** @internal @This wakes up all the threads sleeping on a futex word.
+ *
+ * @param seq pointer to the futex word
+ */
+void uqueue_futex_wake_all(uatomic_uint32_t *seq);
+
+/** @internal @This sleeps on a futex word, unless it has changed.
+ *
+ * @param seq pointer to the futex word
+ * @param value expected value of the futex word
+ * @param timeout maximum time to sleep (in 27 MHz ticks), or UINT64_MAX
+ */
+void uqueue_futex_sleep(uatomic_uint32_t *seq, uint32_t value,
+                        uint64_t timeout);
+
+/** @internal @This signals a condition to the threads sleeping on a futex
+ * of the queue.
+ *
+ * @param uqueue pointer to a uqueue structure
+ * @param seq pointer to the futex word
+ */
+static inline void uqueue_futex_wake(struct uqueue *uqueue,
+                                     uatomic_uint32_t *seq)
+{
+    uatomic_fetch_add(seq, 1);
+    if (unlikely(uatomic_load(&uqueue->waiters)))
+        uqueue_futex_wake_all(seq);
+}
+
+/** @internal @This waits for a condition on the queue, first spinning an
+ * adaptive number of times, then sleeping on a futex. The number of spins
+ * is doubled when spinning was enough, and halved otherwise.
+ *
+ * @param uqueue pointer to a uqueue structure
+ * @param seq pointer to the futex word
+ * @param spin_p pointer to the current number of spins
+ * @param pop true to wait for data to pop, false to wait for room to push
+ * @param max_spin maximum number of spins
+ * @param timeout maximum time to sleep (in 27 MHz ticks), or UINT64_MAX
+ * @return true if the condition is met
+ */
+static inline bool uqueue_futex_wait(struct uqueue *uqueue,
+                                     uatomic_uint32_t *seq,
+                                     uint32_t *spin_p, bool pop,
+                                     uint32_t max_spin, uint64_t timeout)
+{
+#define UQUEUE_READY()                                                      \
+    (pop ? uatomic_load(&uqueue->counter) > 0 :                             \
+           uatomic_load(&uqueue->counter) < uqueue->length)
+    if (UQUEUE_READY())
+        return true;
+
+    uint32_t spin = *spin_p;
+    if (spin > max_spin)
+        spin = max_spin;
+    for (uint32_t i = 0; i < spin; i++) {
+#if defined(__i386__) || defined(__x86_64__)
+        __builtin_ia32_pause();
+#endif
+        if (UQUEUE_READY()) {
+            *spin_p = spin < max_spin / 2 ? spin * 2 + 1 : max_spin;
+            return true;
+        }
+    }
+    *spin_p = spin / 2;
+
+    uatomic_fetch_add(&uqueue->waiters, 1);
+    uint32_t value = uatomic_load(seq);
+    if (!UQUEUE_READY() && timeout)
+        uqueue_futex_sleep(seq, value, timeout);
+    uatomic_fetch_sub(&uqueue->waiters, 1);
+    return UQUEUE_READY();
+#undef UQUEUE_READY
+}
+
+/** @This waits until data can be popped from a queue initialized with
+ * @ref uqueue_init_futex. It may return early, so the caller must be
+ * prepared to find the queue empty.
+ *
+ * @param uqueue pointer to a uqueue structure
+ * @param max_spin maximum number of spins before sleeping
+ * @param timeout maximum time to sleep (in 27 MHz ticks), or UINT64_MAX
+ * @return true if the queue is not empty
+ */
+static inline bool uqueue_wait_pop(struct uqueue *uqueue, uint32_t max_spin,
+                                   uint64_t timeout)
+{
+    assert(uqueue->futex);
+    return uqueue_futex_wait(uqueue, &uqueue->pop_seq, &uqueue->pop_spin,
+                             true, max_spin, timeout);
+}
+
+/** @This waits until data can be pushed into a queue initialized with
+ * @ref uqueue_init_futex. It may return early, so the caller must be
+ * prepared to find the queue full.
+ *
+ * @param uqueue pointer to a uqueue structure
+ * @param max_spin maximum number of spins before sleeping
+ * @param timeout maximum time to sleep (in 27 MHz ticks), or UINT64_MAX
+ * @return true if the queue is not full
+ */
+static inline bool uqueue_wait_push(struct uqueue *uqueue, uint32_t max_spin,
+                                    uint64_t timeout)
+{
+    assert(uqueue->futex);
+    return uqueue_futex_wait(uqueue, &uqueue->push_seq, &uqueue->push_spin,
+                             false, max_spin, timeout);
 }
 
 /** @This allocates a watcher triggering when data is ready to be pushed.
@@ -104,6 +266,8 @@ static inline struct upump *uqueue_upump_alloc_push(struct uqueue *uqueue,
                                                     upump_cb cb, void *opaque,
                                                     struct urefcount *refcount)
 {
+    if (uqueue->futex)
+        return upump_alloc_idler(upump_mgr, cb, opaque, refcount);
     return ueventfd_upump_alloc(&uqueue->event_push, upump_mgr, cb, opaque,
                                 refcount);
 }
@@ -123,10 +287,36 @@ static inline struct upump *uqueue_upump_alloc_pop(struct uqueue *uqueue,
                                                    upump_cb cb, void *opaque,
                                                    struct urefcount *refcount)
 {
+    if (uqueue->futex)
+        return upump_alloc_idler(upump_mgr, cb, opaque, refcount);
     return ueventfd_upump_alloc(&uqueue->event_pop, upump_mgr, cb, opaque,
                                 refcount);
 }
 
+/** @internal @This signals that data can be pushed.
+ *
+ * @param uqueue pointer to a uqueue structure
+ */
+static inline void uqueue_signal_push(struct uqueue *uqueue)
+{
+    if (uqueue->futex)
+        uqueue_futex_wake(uqueue, &uqueue->push_seq);
+    else
+        ueventfd_write(&uqueue->event_push);
+}
+
+/** @internal @This signals that data can be popped.
+ *
+ * @param uqueue pointer to a uqueue structure
+ */
+static inline void uqueue_signal_pop(struct uqueue *uqueue)
+{
+    if (uqueue->futex)
+        uqueue_futex_wake(uqueue, &uqueue->pop_seq);
+    else
+        ueventfd_write(&uqueue->event_pop);
+}
+
 /** @This pushes an element into the queue.
  *
  * @param uqueue pointer to a uqueue structure
@@ -136,19 +326,27 @@ static inline struct upump *uqueue_upump_alloc_pop(struct uqueue *uqueue,
 static inline bool uqueue_push(struct uqueue *uqueue, void *element)
 {
     if (unlikely(!ufifo_push(&uqueue->fifo, element))) {
+        if (uqueue->futex) {
+            UTRACE3(uqueue_push, uqueue, element, false);
+            return false;
+        }
+
         /* signal that we are full */
         ueventfd_read(&uqueue->event_push);
 
         /* double-check */
-        if (likely(!ufifo_push(&uqueue->fifo, element)))
+        if (likely(!ufifo_push(&uqueue->fifo, element))) {
+            UTRACE3(uqueue_push, uqueue, element, false);
             return false;
+        }
 
         /* signal that we're alright again */
         ueventfd_write(&uqueue->event_push);
     }
 
     if (unlikely(uatomic_fetch_add(&uqueue->counter, 1) == 0))
-        ueventfd_write(&uqueue->event_pop);
+        uqueue_signal_pop(uqueue);
+    UTRACE3(uqueue_push, uqueue, element, true);
     return true;
 }
 
@@ -161,6 +359,9 @@ static inline void *uqueue_pop_internal(struct uqueue *uqueue)
 {
     void *element = ufifo_pop(&uqueue->fifo, void *);
     if (unlikely(element == NULL)) {
+        if (uqueue->futex)
+            return NULL;
+
         /* signal that we starve */
         ueventfd_read(&uqueue->event_pop);
 
@@ -174,7 +375,8 @@ static inline void *uqueue_pop_internal(struct uqueue *uqueue)
     }
 
     if (unlikely(uatomic_fetch_sub(&uqueue->counter, 1) == uqueue->length))
-        ueventfd_write(&uqueue->event_push);
+        uqueue_signal_push(uqueue);
+    UTRACE2(uqueue_pop, uqueue, element);
     return element;
 }
 
@@ -186,6 +388,74 @@ static inline void *uqueue_pop_internal(struct uqueue *uqueue)
  */
 #define uqueue_pop(uqueue, type) (type)uqueue_pop_internal(uqueue)
 
+/** @This pushes several elements into the queue, triggering at most one
+ * wake-up of the popping side.
+ *
+ * @param uqueue pointer to a uqueue structure
+ * @param elements array of pointers to elements to push
+ * @param n number of elements in the array
+ * @return number of elements actually pushed (the first ones of the array),
+ * less than n if the queue is full
+ */
+static inline unsigned int uqueue_push_batch(struct uqueue *uqueue,
+                                             void **elements, unsigned int n)
+{
+    unsigned int count = ufifo_push_batch(&uqueue->fifo, elements, n);
+    if (unlikely(count < n) && !uqueue->futex) {
+        /* signal that we are full */
+        ueventfd_read(&uqueue->event_push);
+
+        /* double-check */
+        unsigned int more = ufifo_push_batch(&uqueue->fifo,
+                                             elements + count, n - count);
+        if (more) {
+            count += more;
+            /* signal that we're alright again */
+            ueventfd_write(&uqueue->event_push);
+        }
+    }
+
+    if (count && unlikely(uatomic_fetch_add(&uqueue->counter, count) == 0))
+        uqueue_signal_pop(uqueue);
+    UTRACE3(uqueue_push_batch, uqueue, elements, count);
+    return count;
+}
+
+/** @This pops several elements from the queue, triggering at most one
+ * wake-up of the pushing side.
+ *
+ * @param uqueue pointer to a uqueue structure
+ * @param elements array filled in with pointers to popped elements
+ * @param n maximum number of elements to pop
+ * @return number of elements actually popped
+ */
+static inline unsigned int uqueue_pop_batch(struct uqueue *uqueue,
+                                            void **elements, unsigned int n)
+{
+    unsigned int count = ufifo_pop_batch(&uqueue->fifo, elements, n);
+    if (unlikely(!count)) {
+        if (uqueue->futex)
+            return 0;
+
+        /* signal that we starve */
+        ueventfd_read(&uqueue->event_pop);
+
+        /* double-check */
+        count = ufifo_pop_batch(&uqueue->fifo, elements, n);
+        if (likely(!count))
+            return 0;
+
+        /* signal that we're alright again */
+        ueventfd_write(&uqueue->event_pop);
+    }
+
+    if (unlikely(uatomic_fetch_sub(&uqueue->counter, count) ==
+                 uqueue->length))
+        uqueue_signal_push(uqueue);
+    UTRACE3(uqueue_pop_batch, uqueue, elements, count);
+    return count;
+}
+
 /** @This returns the number of elements in the queue.
  *
  * @param uqueue pointer to a uqueue structure
@@ -204,8 +474,14 @@ static inline void uqueue_clean(struct uqueue *uqueue)
 {
     uatomic_clean(&uqueue->counter);
     ufifo_clean(&uqueue->fifo);
-    ueventfd_clean(&uqueue->event_push);
-    ueventfd_clean(&uqueue->event_pop);
+    if (!uqueue->futex) {
+        ueventfd_clean(&uqueue->event_push);
+        ueventfd_clean(&uqueue->event_pop);
+    } else {
+        uatomic_clean(&uqueue->push_seq);
+        uatomic_clean(&uqueue->pop_seq);
+        uatomic_clean(&uqueue->waiters);
+    }
 }
 
 #ifdef __cplusplus
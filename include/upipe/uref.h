@@ -127,6 +127,9 @@ struct uref {
     uint64_t cr_dts_delay;
     /** duration between RAP and CR */
     uint64_t rap_cr_delay;
+    /** duration of the contents, kept out of the udict as it is read by
+     * most pipes */
+    uint64_t duration;
     /** private for local pipe user */
     uint64_t priv;
 };
@@ -137,6 +140,12 @@ UBASE_FROM_TO(uref, uchain, uchain, uchain)
 enum uref_mgr_command {
     /** release all buffers kept in pools (void) */
     UREF_MGR_VACUUM,
+    /** enable or disable the statistics and reset them (bool) */
+    UREF_MGR_SET_STATS,
+    /** read the statistics of the pool of urefs (struct upool_stats *) */
+    UREF_MGR_GET_STATS,
+    /** allocate urefs in advance and keep them in the pool (unsigned int) */
+    UREF_MGR_PREFILL,
 
     /** non-standard manager commands implemented by a module type can start
      * from there (first arg = signature) */
@@ -192,6 +201,7 @@ static inline void uref_init(struct uref *uref)
     uref->dts_pts_delay = UINT64_MAX;
     uref->cr_dts_delay = UINT64_MAX;
     uref->rap_cr_delay = UINT64_MAX;
+    uref->duration = UINT64_MAX;
     uref->priv = UINT64_MAX;
 }
 
@@ -283,6 +293,7 @@ static inline struct uref *uref_dup_inner(struct uref *uref)
     new_uref->dts_pts_delay = uref->dts_pts_delay;
     new_uref->cr_dts_delay = uref->cr_dts_delay;
     new_uref->rap_cr_delay = uref->rap_cr_delay;
+    new_uref->duration = uref->duration;
     new_uref->priv = uref->priv;
 
     return new_uref;
@@ -421,6 +432,45 @@ static inline int uref_mgr_vacuum(struct uref_mgr *mgr)
     return uref_mgr_control(mgr, UREF_MGR_VACUUM);
 }
 
+/** @This enables or disables the statistics of a uref manager. Enabling
+ * them resets the counters.
+ *
+ * @param mgr pointer to uref manager
+ * @param enabled true to update the counters
+ * @return an error code
+ */
+static inline int uref_mgr_set_stats(struct uref_mgr *mgr, bool enabled)
+{
+    return uref_mgr_control(mgr, UREF_MGR_SET_STATS, enabled);
+}
+
+/** @This reads the statistics of the pool of urefs of a uref manager. It may
+ * be called from any thread.
+ *
+ * @param mgr pointer to uref manager
+ * @param pool_stats filled in with the counters of the pool
+ * @return an error code
+ */
+static inline int uref_mgr_get_stats(struct uref_mgr *mgr,
+                                     struct upool_stats *pool_stats)
+{
+    return uref_mgr_control(mgr, UREF_MGR_GET_STATS, pool_stats);
+}
+
+/** @This allocates urefs in advance and keeps them in the pool of a uref
+ * manager, so that the first urefs allocated by a new pipeline do not hit
+ * the allocator. The udict manager is prefilled as well.
+ *
+ * @param mgr pointer to uref manager
+ * @param count number of urefs to allocate; the pool is not filled beyond
+ * its depth
+ * @return an error code
+ */
+static inline int uref_mgr_prefill(struct uref_mgr *mgr, unsigned int count)
+{
+    return uref_mgr_control(mgr, UREF_MGR_PREFILL, count);
+}
+
 #ifdef __cplusplus
 }
 #endif
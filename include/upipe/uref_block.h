@@ -157,6 +157,14 @@ static inline int uref_block_resize(struct uref *uref, int skip, int new_size)
     return ubuf_block_resize(uref->ubuf, skip, new_size);
 }
 
+/** @see ubuf_block_consume */
+static inline int uref_block_consume(struct uref *uref, size_t size)
+{
+    if (uref->ubuf == NULL)
+        return UBASE_ERR_INVALID;
+    return ubuf_block_consume(&uref->ubuf, size);
+}
+
 /** @see ubuf_block_prepend */
 static inline int uref_block_prepend(struct uref *uref, int prepend)
 {
@@ -286,6 +294,16 @@ static inline int uref_block_merge(struct uref *uref, struct ubuf_mgr *ubuf_mgr,
     return ubuf_block_merge(ubuf_mgr, &uref->ubuf, skip, new_size);
 }
 
+/** @see ubuf_block_merge_read */
+static inline int uref_block_merge_read(struct uref *uref,
+                                        struct ubuf_mgr *ubuf_mgr,
+                                        int skip, int new_size)
+{
+    if (uref->ubuf == NULL)
+        return UBASE_ERR_INVALID;
+    return ubuf_block_merge_read(ubuf_mgr, &uref->ubuf, skip, new_size);
+}
+
 /** @see ubuf_block_compare */
 static inline int uref_block_compare(struct uref *uref, int offset,
                                      struct uref *uref_small)
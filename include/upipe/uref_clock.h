@@ -47,7 +47,7 @@ UREF_ATTR_UNSIGNED_UREF(clock, cr_dts_delay, cr_dts_delay,
         delay between CR and DTS)
 UREF_ATTR_UNSIGNED_UREF(clock, rap_cr_delay, rap_cr_delay,
         delay between RAP and CR)
-UREF_ATTR_UNSIGNED_SH(clock, duration, UDICT_TYPE_CLOCK_DURATION, duration)
+UREF_ATTR_UNSIGNED_FIXED(clock, duration, duration, duration)
 UREF_ATTR_SMALL_UNSIGNED(clock, index_rap, "k.index_rap",
                     frame offset from last random access point)
 UREF_ATTR_RATIONAL_SH(clock, rate, UDICT_TYPE_CLOCK_RATE, playing rate)
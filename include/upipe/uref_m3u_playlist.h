@@ -37,6 +37,14 @@ UREF_ATTR_UNSIGNED(m3u_playlist, byte_range_len, "m3u.playlist.byte_range_len",
                       length of the sub range)
 UREF_ATTR_UNSIGNED(m3u_playlist, byte_range_off, "m3u.playlist.byte_range_off",
                    offset of the sub range)
+UREF_ATTR_VOID(m3u_playlist, part, "m3u.playlist.part",
+               partial segment)
+UREF_ATTR_UNSIGNED(m3u_playlist, part_index, "m3u.playlist.part_index",
+                   index of the partial segment in its parent segment)
+UREF_ATTR_VOID(m3u_playlist, part_independent, "m3u.playlist.part_independent",
+               partial segment starting with an independent frame)
+UREF_ATTR_VOID(m3u_playlist, preload_hint, "m3u.playlist.preload_hint",
+               partial segment not yet available)
 
 UREF_ATTR_STRING(m3u_playlist_key, method, "m3u.playlist.key.method",
                  key method);
@@ -58,6 +66,10 @@ static inline int uref_m3u_playlist_delete(struct uref *uref)
         uref_m3u_playlist_delete_seq_duration,
         uref_m3u_playlist_delete_byte_range_len,
         uref_m3u_playlist_delete_byte_range_off,
+        uref_m3u_playlist_delete_part,
+        uref_m3u_playlist_delete_part_index,
+        uref_m3u_playlist_delete_part_independent,
+        uref_m3u_playlist_delete_preload_hint,
         uref_m3u_playlist_key_delete,
     };
     return uref_attr_delete_list(uref, list, UBASE_ARRAY_SIZE(list));
@@ -80,6 +92,10 @@ static inline int uref_m3u_playlist_copy(struct uref *uref,
         uref_m3u_playlist_copy_seq_duration,
         uref_m3u_playlist_copy_byte_range_len,
         uref_m3u_playlist_copy_byte_range_off,
+        uref_m3u_playlist_copy_part,
+        uref_m3u_playlist_copy_part_index,
+        uref_m3u_playlist_copy_part_independent,
+        uref_m3u_playlist_copy_preload_hint,
         uref_m3u_playlist_key_copy,
     };
     return uref_attr_copy_list(uref, uref_src, list, UBASE_ARRAY_SIZE(list));
@@ -40,6 +40,18 @@ UREF_ATTR_UNSIGNED(m3u_playlist_flow, media_sequence,
                    media sequence)
 UREF_ATTR_VOID(m3u_playlist_flow, endlist, "m3u.playlist.endlist",
                endlist)
+UREF_ATTR_UNSIGNED(m3u_playlist_flow, part_target,
+                   "m3u.playlist.part_target",
+                   partial segment target duration)
+UREF_ATTR_UNSIGNED(m3u_playlist_flow, part_hold_back,
+                   "m3u.playlist.part_hold_back",
+                   minimum distance from the live edge for partial segments)
+UREF_ATTR_VOID(m3u_playlist_flow, can_block_reload,
+               "m3u.playlist.can_block_reload",
+               server supports blocking playlist reload)
+UREF_ATTR_UNSIGNED(m3u_playlist_flow, append,
+                   "m3u.playlist.append",
+                   first sequence of an incremental refresh)
 
 static inline int uref_m3u_playlist_flow_delete(struct uref *uref)
 {
@@ -48,6 +60,10 @@ static inline int uref_m3u_playlist_flow_delete(struct uref *uref)
         uref_m3u_playlist_flow_delete_target_duration,
         uref_m3u_playlist_flow_delete_media_sequence,
         uref_m3u_playlist_flow_delete_endlist,
+        uref_m3u_playlist_flow_delete_part_target,
+        uref_m3u_playlist_flow_delete_part_hold_back,
+        uref_m3u_playlist_flow_delete_can_block_reload,
+        uref_m3u_playlist_flow_delete_append,
     };
 
     return uref_attr_delete_list(uref, list, UBASE_ARRAY_SIZE(list));
@@ -61,6 +77,10 @@ static inline int uref_m3u_playlist_flow_copy(struct uref *uref,
         uref_m3u_playlist_flow_copy_target_duration,
         uref_m3u_playlist_flow_copy_media_sequence,
         uref_m3u_playlist_flow_copy_endlist,
+        uref_m3u_playlist_flow_copy_part_target,
+        uref_m3u_playlist_flow_copy_part_hold_back,
+        uref_m3u_playlist_flow_copy_can_block_reload,
+        uref_m3u_playlist_flow_copy_append,
     };
 
     return uref_attr_copy_list(uref, uref_src, list, UBASE_ARRAY_SIZE(list));
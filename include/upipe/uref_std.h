@@ -36,6 +36,9 @@ extern "C" {
 
 #include <upipe/uref.h>
 
+/** @hidden */
+struct umem_mgr;
+
 /** @This allocates a new instance of the standard uref manager
  *
  * @param uref_pool_depth maximum number of uref structures in the pool
@@ -47,6 +50,23 @@ struct uref_mgr *uref_std_mgr_alloc(uint16_t uref_pool_depth,
                                     struct udict_mgr *udict_mgr,
                                     int control_attr_size);
 
+/** @This allocates a new instance of the standard uref manager, allocating
+ * the uref structures with a umem manager. Used with an arena manager (see
+ * @ref umem_arena_mgr_alloc) shared with the udict and ubuf managers, a
+ * small uref is allocated next to its attributes and payload.
+ *
+ * @param uref_pool_depth maximum number of uref structures in the pool
+ * @param udict_mgr udict manager to use to allocate udict structures
+ * @param control_attr_size extra attributes space for control packets
+ * @param umem_mgr memory allocator to use for uref structures, or NULL to
+ * use malloc()
+ * @return pointer to manager, or NULL in case of error
+ */
+struct uref_mgr *uref_std_mgr_alloc_umem(uint16_t uref_pool_depth,
+                                         struct udict_mgr *udict_mgr,
+                                         int control_attr_size,
+                                         struct umem_mgr *umem_mgr);
+
 #ifdef __cplusplus
 }
 #endif
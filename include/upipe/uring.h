@@ -232,6 +232,72 @@ static inline void uring_lifo_push(struct uring *uring, uring_lifo *lifo_p,
     } while (unlikely(!uatomic_compare_exchange(lifo_p, &old_lifo, new_lifo)));
 }
 
+/** @This pops a chain of up to n elements from a LIFO, with a single
+ * atomic operation. The elements of the chain are linked by their next index,
+ * starting from the returned index.
+ *
+ * @param uring pointer to uring structure
+ * @param lifo_p pointer to the LIFO descriptor
+ * @param n_p reference to the maximum number of elements to pop, overwritten
+ * with the number of elements actually popped
+ * @return index of the first popped element, or URING_INDEX_NULL
+ */
+static inline uring_index uring_lifo_pop_chain(struct uring *uring,
+                                               uring_lifo *lifo_p,
+                                               unsigned int *n_p)
+{
+    uring_lifo_val old_lifo = uatomic_load(lifo_p);
+    uring_lifo_val new_lifo;
+    uring_index first;
+    unsigned int count;
+
+    do {
+        if (old_lifo == URING_LIFO_NULL || !*n_p) {
+            *n_p = 0;
+            return URING_INDEX_NULL;
+        }
+
+        first = uring_lifo_to_index(uring, old_lifo);
+        uring_index index = first;
+        struct uring_elem *elem;
+        count = 0;
+        for ( ; ; ) {
+            elem = uring_elem_from_index(uring, index);
+            count++;
+            if (count >= *n_p || count >= uring->length ||
+                elem->next == URING_INDEX_NULL)
+                break;
+            index = elem->next;
+        }
+        new_lifo = uring_lifo_from_index(uring, elem->next);
+    } while (unlikely(!uatomic_compare_exchange(lifo_p, &old_lifo, new_lifo)));
+
+    *n_p = count;
+    return first;
+}
+
+/** @This pushes a chain of elements into a LIFO, with a single atomic
+ * operation. The elements must already be linked by their next index, from
+ * first to last; first becomes the top of the LIFO.
+ *
+ * @param uring pointer to uring structure
+ * @param lifo_p pointer to the LIFO descriptor
+ * @param first index of the first element of the chain
+ * @param last index of the last element of the chain
+ */
+static inline void uring_lifo_push_chain(struct uring *uring,
+                                         uring_lifo *lifo_p,
+                                         uring_index first, uring_index last)
+{
+    struct uring_elem *elem = uring_elem_from_index(uring, last);
+    uring_lifo_val new_lifo = uring_lifo_from_index(uring, first);
+    uring_lifo_val old_lifo = uatomic_load(lifo_p);
+
+    do {
+        elem->next = uring_lifo_to_index(uring, old_lifo);
+    } while (unlikely(!uatomic_compare_exchange(lifo_p, &old_lifo, new_lifo)));
+}
+
 /** @This defines a multiplexed structure from two element indexes
  * (head and tail) and associated tags. The bit-field definition is:
  * @table 2
@@ -415,6 +481,98 @@ static inline void uring_fifo_push(struct uring *uring, uring_fifo *fifo_p,
     } while (unlikely(!uatomic_compare_exchange(fifo_p, &old_fifo, new_fifo)));
 }
 
+/** @This pops up to n elements from the head of a FIFO, with a single
+ * successful atomic operation and a single walk through the FIFO.
+ *
+ * @param uring pointer to uring structure
+ * @param fifo_p pointer to the FIFO descriptor
+ * @param indexes array filled in with the indexes of the popped elements, in
+ * FIFO order
+ * @param n maximum number of elements to pop
+ * @return number of popped elements
+ */
+static inline unsigned int uring_fifo_pop_batch(struct uring *uring,
+                                                uring_fifo *fifo_p,
+                                                uring_index *indexes,
+                                                unsigned int n)
+{
+    uring_fifo_val old_fifo = uatomic_load(fifo_p);
+    uring_index chain[UINT8_MAX];
+
+    for ( ; ; ) {
+        if (old_fifo == URING_FIFO_NULL || !n)
+            return 0;
+
+        uring_index tail = uring_fifo_get_tail(uring, old_fifo);
+        uring_index head = uring_fifo_get_head(uring, old_fifo);
+
+        /* walk from the tail to the head */
+        unsigned int length = 0;
+        uring_index index = tail;
+        while (index != URING_INDEX_NULL && length < uring->length &&
+               length < UINT8_MAX) {
+            chain[length++] = index;
+            if (index == head)
+                break;
+            index = uring_elem_from_index(uring, index)->next;
+        }
+        if (unlikely(!length || chain[length - 1] != head)) {
+            /* The list was modified by another thread. */
+            old_fifo = uatomic_load(fifo_p);
+            continue;
+        }
+
+        unsigned int count = n < length ? n : length;
+        for ( ; ; ) {
+            uring_fifo_val new_fifo = URING_FIFO_NULL;
+            if (count < length) {
+                new_fifo = old_fifo;
+                uring_fifo_set_head(uring, &new_fifo,
+                                    chain[length - count - 1]);
+            }
+            if (likely(uatomic_compare_exchange(fifo_p, &old_fifo,
+                                                new_fifo))) {
+                for (unsigned int i = 0; i < count; i++)
+                    indexes[i] = chain[length - 1 - i];
+                return count;
+            }
+
+            /* Check if only the tail was changed (and then try again),
+             * or if we need to restart everything. */
+            if (count == length ||
+                unlikely(head != uring_fifo_get_head(uring, old_fifo)))
+                break;
+        }
+    }
+}
+
+/** @This pushes a chain of elements into the tail of a FIFO, with a single
+ * atomic operation. The elements must already be linked by their next index,
+ * from last (the new tail) to first; the next index of first is overwritten.
+ *
+ * @param uring pointer to uring structure
+ * @param fifo_p pointer to the FIFO descriptor
+ * @param first index of the first (oldest) element of the chain
+ * @param last index of the last (newest) element of the chain
+ */
+static inline void uring_fifo_push_chain(struct uring *uring,
+                                         uring_fifo *fifo_p,
+                                         uring_index first, uring_index last)
+{
+    struct uring_elem *elem = uring_elem_from_index(uring, first);
+    uring_fifo_val old_fifo = uatomic_load(fifo_p);
+    uring_fifo_val new_fifo;
+
+    do {
+        new_fifo = old_fifo;
+        uring_index tail = uring_fifo_get_tail(uring, old_fifo);
+        elem->next = tail;
+        if (tail == URING_INDEX_NULL)
+            uring_fifo_set_head(uring, &new_fifo, first);
+        uring_fifo_set_tail(uring, &new_fifo, last);
+    } while (unlikely(!uatomic_compare_exchange(fifo_p, &old_fifo, new_fifo)));
+}
+
 /** @This initializes a FIFO.
  *
  * @param uring pointer to uring structure
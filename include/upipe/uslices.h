@@ -0,0 +1,234 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short Upipe fork/join execution of picture slices by worker threads
+ *
+ * A uslices structure splits a job into slices (typically ranges of lines
+ * of a picture) which are processed concurrently by a set of worker threads
+ * and by the calling thread. @ref uslices_run only returns once all slices
+ * are processed, so the caller may use the result immediately, as if the
+ * job had been run in a single thread.
+ */
+
+#ifndef _UPIPE_USLICES_H_
+/** @hidden */
+#define _UPIPE_USLICES_H_
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <upipe/ubase.h>
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+/** @This is the prototype of a function processing a slice.
+ *
+ * @param opaque opaque given to @ref uslices_run
+ * @param slice index of the slice to process
+ * @param nb_slices total number of slices
+ */
+typedef void (*uslices_cb)(void *opaque, unsigned int slice,
+                           unsigned int nb_slices);
+
+/** @This is the private structure of a set of worker threads. */
+struct uslices {
+    /** mutex protecting the fields below */
+    pthread_mutex_t mutex;
+    /** condition signalled to the threads when a job is started */
+    pthread_cond_t cond;
+    /** condition signalled by the threads when all slices are done */
+    pthread_cond_t done;
+    /** function processing a slice of the current job */
+    uslices_cb cb;
+    /** opaque of the current job */
+    void *opaque;
+    /** number of slices of the current job */
+    unsigned int nb_slices;
+    /** next slice to process */
+    unsigned int next;
+    /** number of slices not processed yet */
+    unsigned int remaining;
+    /** true if the threads must exit */
+    bool exit;
+
+    /** number of worker threads */
+    unsigned int nb_threads;
+    /** worker threads */
+    pthread_t threads[];
+};
+
+/** @internal @This processes slices until there is none left. It must be
+ * called with the mutex locked.
+ *
+ * @param uslices pointer to uslices structure
+ */
+static inline void uslices_process(struct uslices *uslices)
+{
+    while (uslices->next < uslices->nb_slices) {
+        uslices_cb cb = uslices->cb;
+        void *opaque = uslices->opaque;
+        unsigned int nb_slices = uslices->nb_slices;
+        unsigned int slice = uslices->next++;
+        pthread_mutex_unlock(&uslices->mutex);
+
+        cb(opaque, slice, nb_slices);
+
+        pthread_mutex_lock(&uslices->mutex);
+        if (!--uslices->remaining)
+            pthread_cond_signal(&uslices->done);
+    }
+}
+
+/** @internal @This is the main loop of a worker thread.
+ *
+ * @param arg pointer to uslices structure
+ * @return NULL
+ */
+static inline void *uslices_thread(void *arg)
+{
+    struct uslices *uslices = (struct uslices *)arg;
+
+    pthread_mutex_lock(&uslices->mutex);
+    while (!uslices->exit) {
+        if (uslices->next >= uslices->nb_slices) {
+            pthread_cond_wait(&uslices->cond, &uslices->mutex);
+            continue;
+        }
+        uslices_process(uslices);
+    }
+    pthread_mutex_unlock(&uslices->mutex);
+    return NULL;
+}
+
+/** @This frees a set of worker threads. It must not be called while a job
+ * is running.
+ *
+ * @param uslices pointer to uslices structure, or NULL
+ */
+static inline void uslices_free(struct uslices *uslices)
+{
+    if (uslices == NULL)
+        return;
+
+    pthread_mutex_lock(&uslices->mutex);
+    uslices->exit = true;
+    pthread_cond_broadcast(&uslices->cond);
+    pthread_mutex_unlock(&uslices->mutex);
+    for (unsigned int i = 0; i < uslices->nb_threads; i++)
+        pthread_join(uslices->threads[i], NULL);
+
+    pthread_cond_destroy(&uslices->done);
+    pthread_cond_destroy(&uslices->cond);
+    pthread_mutex_destroy(&uslices->mutex);
+    free(uslices);
+}
+
+/** @This allocates a set of worker threads.
+ *
+ * @param nb_threads number of worker threads, in addition to the thread
+ * calling @ref uslices_run
+ * @return pointer to uslices structure, or NULL in case of error
+ */
+static inline struct uslices *uslices_alloc(unsigned int nb_threads)
+{
+    struct uslices *uslices = (struct uslices *)
+        malloc(sizeof (struct uslices) + nb_threads * sizeof (pthread_t));
+    if (unlikely(uslices == NULL))
+        return NULL;
+
+    pthread_mutex_init(&uslices->mutex, NULL);
+    pthread_cond_init(&uslices->cond, NULL);
+    pthread_cond_init(&uslices->done, NULL);
+    uslices->cb = NULL;
+    uslices->opaque = NULL;
+    uslices->nb_slices = 0;
+    uslices->next = 0;
+    uslices->remaining = 0;
+    uslices->exit = false;
+    uslices->nb_threads = 0;
+
+    for (unsigned int i = 0; i < nb_threads; i++) {
+        if (unlikely(pthread_create(&uslices->threads[i], NULL,
+                                    uslices_thread, uslices))) {
+            uslices_free(uslices);
+            return NULL;
+        }
+        uslices->nb_threads++;
+    }
+    return uslices;
+}
+
+/** @This returns the number of slices a job should be split into to use
+ * all the threads.
+ *
+ * @param uslices pointer to uslices structure, or NULL
+ * @return number of threads, including the calling thread
+ */
+static inline unsigned int uslices_get_threads(struct uslices *uslices)
+{
+    return uslices != NULL ? uslices->nb_threads + 1 : 1;
+}
+
+/** @This processes all the slices of a job, and waits for their
+ * completion. The calling thread also processes slices. If uslices is NULL,
+ * the slices are processed in order by the calling thread.
+ *
+ * @param uslices pointer to uslices structure, or NULL
+ * @param cb function processing a slice
+ * @param opaque opaque passed to cb
+ * @param nb_slices number of slices
+ */
+static inline void uslices_run(struct uslices *uslices, uslices_cb cb,
+                               void *opaque, unsigned int nb_slices)
+{
+    if (uslices == NULL || uslices->nb_threads == 0 || nb_slices <= 1) {
+        for (unsigned int i = 0; i < nb_slices; i++)
+            cb(opaque, i, nb_slices);
+        return;
+    }
+
+    pthread_mutex_lock(&uslices->mutex);
+    uslices->cb = cb;
+    uslices->opaque = opaque;
+    uslices->nb_slices = nb_slices;
+    uslices->next = 0;
+    uslices->remaining = nb_slices;
+    pthread_cond_broadcast(&uslices->cond);
+
+    uslices_process(uslices);
+    while (uslices->remaining)
+        pthread_cond_wait(&uslices->done, &uslices->mutex);
+    uslices->nb_slices = 0;
+    uslices->next = 0;
+    pthread_mutex_unlock(&uslices->mutex);
+}
+
+#ifdef __cplusplus
+}
+#endif
+#endif
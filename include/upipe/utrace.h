@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/** @file
+ * @short Upipe static tracepoints
+ *
+ * When upipe is configured with --enable-usdt, the tracepoints of the hot
+ * paths are USDT probes of the "upipe" provider (see sys/sdt.h from
+ * systemtap), which cost a single nop when no tracer is attached. They may be
+ * attached with bpftrace, for instance:
+ * @code
+ * bpftrace -p <pid> -e 'usdt:*:upipe:upipe_input { @[arg1] = count(); }'
+ * @end code
+ *
+ * Otherwise, and by default, they compile to nothing. As most of the
+ * tracepoints are in inline functions, they are found in every binary
+ * calling them, and not only in libupipe.
+ *
+ * The tracepoints and their arguments are:
+ * @list
+ * @item upipe_input, upipe_input_return: pipe, signature of its manager, uref
+ * @item upipe_throw: pipe, signature of its manager, event
+ * @item upump_dispatch, upump_dispatch_return: pump, callback
+ * @item uqueue_push: queue, element, true if it was pushed
+ * @item uqueue_pop: queue, element
+ * @item uqueue_push_batch, uqueue_pop_batch: queue, array of elements,
+ * number of elements pushed or popped
+ * @item ubuf_alloc: manager, allocation signature, ubuf (NULL on failure)
+ * @item ubuf_free: ubuf, manager
+ * @end list
+ */
+
+#ifndef _UPIPE_UTRACE_H_
+/** @hidden */
+#define _UPIPE_UTRACE_H_
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <upipe/config.h>
+
+#ifdef UPIPE_HAVE_USDT
+#include <sys/sdt.h>
+
+/** @This defines a tracepoint without argument. */
+#define UTRACE(name) DTRACE_PROBE(upipe, name)
+/** @This defines a tracepoint with one argument. */
+#define UTRACE1(name, a) DTRACE_PROBE1(upipe, name, a)
+/** @This defines a tracepoint with two arguments. */
+#define UTRACE2(name, a, b) DTRACE_PROBE2(upipe, name, a, b)
+/** @This defines a tracepoint with three arguments. */
+#define UTRACE3(name, a, b, c) DTRACE_PROBE3(upipe, name, a, b, c)
+
+#else /* mkdoc:skip */
+#define UTRACE(name) do { } while (0)
+#define UTRACE1(name, a) do { } while (0)
+#define UTRACE2(name, a, b) do { } while (0)
+#define UTRACE3(name, a, b, c) do { } while (0)
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+#endif
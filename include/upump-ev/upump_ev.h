@@ -41,6 +41,19 @@ extern "C" {
 
 #define UPUMP_EV_SIGNATURE UBASE_FOURCC('e','v',' ',' ')
 
+/** @This extends upump_mgr_command with specific commands for pools of
+ * ev loops. */
+enum upump_ev_pool_mgr_command {
+    UPUMP_EV_POOL_MGR_SENTINEL = UPUMP_MGR_CONTROL_LOCAL,
+
+    /** the next pump allocated by the calling thread will go to the least
+     * loaded loop (void) */
+    UPUMP_EV_POOL_MGR_REBALANCE,
+    /** sets the time the loops spin without blocking after the last event
+     * (uint64_t) */
+    UPUMP_EV_MGR_SET_BUSY_POLL
+};
+
 /** @This allocates and initializes a upump_mgr structure bound to a given
  * ev loop.
  *
@@ -76,6 +89,61 @@ struct upump_mgr *upump_ev_mgr_alloc_default(uint16_t upump_pool_depth,
 struct upump_mgr *upump_ev_mgr_alloc_loop(uint16_t upump_pool_depth,
                                           uint16_t upump_blocker_pool_depth);
 
+/** @This allocates and initializes a pool of ev loops, each running in its
+ * own thread until the manager is released.
+ *
+ * Pumps allocated from the callbacks of a loop of the pool stay in that loop,
+ * so that all the pumps of a pipe run in the same thread. Pumps allocated from
+ * another thread go to the least loaded loop at the time of the first
+ * allocation, and then to the same loop until
+ * @ref upump_ev_pool_mgr_rebalance is called, so that a pipeline built from
+ * the main thread is not split. Pumps may be started and stopped from any
+ * thread.
+ *
+ * @param nb_loops number of ev loops and threads
+ * @param upump_pool_depth maximum number of upump structures in the pool of
+ * each loop
+ * @param upump_blocker_pool_depth maximum number of upump_blocker structures in
+ * the pool of each loop
+ * @return pointer to the wrapped upump_mgr structure
+ */
+struct upump_mgr *upump_ev_pool_mgr_alloc(unsigned int nb_loops,
+                                          uint16_t upump_pool_depth,
+                                          uint16_t upump_blocker_pool_depth);
+
+/** @This makes the next pump allocated by the calling thread go to the least
+ * loaded loop of the pool. It has no effect in the threads of the pool.
+ *
+ * @param mgr pointer to a upump_mgr allocated by
+ * @ref upump_ev_pool_mgr_alloc
+ * @return an error code
+ */
+static inline int upump_ev_pool_mgr_rebalance(struct upump_mgr *mgr)
+{
+    return upump_mgr_control(mgr, UPUMP_EV_POOL_MGR_REBALANCE,
+                             UPUMP_EV_SIGNATURE);
+}
+
+/** @This sets the busy-poll mode of an ev loop, or of all the loops of a
+ * pool. After each event, the loop is polled without blocking until nothing
+ * has been dispatched for the given time, and only then blocks in the
+ * kernel, which removes the wake-up latency at the expense of a busy core.
+ * It is typically combined with the /busypoll option of udp sockets, and
+ * with loops pinned to isolated cores. In this mode, ev_break() only leaves
+ * the current iteration.
+ *
+ * @param mgr pointer to a upump_mgr allocated by this module
+ * @param busy_poll time to spin after the last event (in 27 MHz ticks), or
+ * 0 to always block (default)
+ * @return an error code
+ */
+static inline int upump_ev_mgr_set_busy_poll(struct upump_mgr *mgr,
+                                             uint64_t busy_poll)
+{
+    return upump_mgr_control(mgr, UPUMP_EV_MGR_SET_BUSY_POLL,
+                             UPUMP_EV_SIGNATURE, busy_poll);
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,122 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short Upipe event loop using the io_uring interface of Linux
+ *
+ * File descriptors are watched with one-shot polls, and timers and idlers
+ * are handled in user space, so that all the submissions of an iteration
+ * of the loop are done with a single system call.
+ *
+ * In addition to the standard types, a pump may receive directly into a
+ * buffer provided by the pipe (typically mapped from a block ubuf), which
+ * saves the readiness notification and the system call per packet.
+ */
+
+#ifndef _UPUMP_URING_UPUMP_URING_H_
+/** @hidden */
+#define _UPUMP_URING_UPUMP_URING_H_
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <upipe/upump.h>
+
+#include <sys/socket.h>
+
+#define UPUMP_URING_SIGNATURE UBASE_FOURCC('u','r','n','g')
+
+/** @This extends upump_type with specific types for io_uring. */
+enum upump_uring_type {
+    UPUMP_URING_TYPE_SENTINEL = UPUMP_TYPE_LOCAL,
+
+    /** event triggers when a message was received by the kernel into the
+     * buffers described by a msghdr (argument = int, struct msghdr *) */
+    UPUMP_URING_TYPE_RECVMSG
+};
+
+/** @This extends upump_command with specific commands for io_uring. */
+enum upump_uring_command {
+    UPUMP_URING_SENTINEL = UPUMP_CONTROL_LOCAL,
+
+    /** returns the result of the last operation, as returned by the
+     * equivalent system call or -errno (int *) */
+    UPUMP_URING_GET_RESULT
+};
+
+/** @This allocates and initializes a pump receiving messages from a socket
+ * directly into the buffers described by a msghdr structure. The structure
+ * and the buffers belong to the caller and must remain valid until the pump
+ * is freed, as a reception may be in progress even when the pump is stopped.
+ * They may be modified from the callback, before the next reception, which is
+ * submitted when the callback returns. The result of the reception is
+ * retrieved with @ref upump_uring_get_result.
+ *
+ * @param mgr management structure for this event loop
+ * @param cb function to call when the pump triggers
+ * @param opaque pointer to the module's internal structure
+ * @param refcount pointer to urefcount structure to increment during callback,
+ * or NULL
+ * @param fd file descriptor of the socket
+ * @param msg description of the buffers to receive into
+ * @return pointer to allocated pump, or NULL in case of failure
+ */
+static inline struct upump *upump_uring_alloc_recvmsg(struct upump_mgr *mgr,
+        upump_cb cb, void *opaque, struct urefcount *refcount,
+        int fd, struct msghdr *msg)
+{
+    return upump_alloc(mgr, cb, opaque, refcount, UPUMP_URING_TYPE_RECVMSG,
+                       UPUMP_URING_SIGNATURE, fd, msg);
+}
+
+/** @This returns the result of the last operation of a pump.
+ *
+ * @param upump description structure of the pump
+ * @param result_p filled in with the result of the system call equivalent
+ * to the operation, or -errno
+ * @return an error code
+ */
+static inline int upump_uring_get_result(struct upump *upump, int *result_p)
+{
+    return upump_control(upump, UPUMP_URING_GET_RESULT, UPUMP_URING_SIGNATURE,
+                         result_p);
+}
+
+/** @This allocates and initializes a upump_mgr structure bound to a new
+ * io_uring instance.
+ *
+ * @param upump_pool_depth maximum number of upump structures in the pool
+ * @param upump_blocker_pool_depth maximum number of upump_blocker structures in
+ * the pool
+ * @return pointer to the wrapped upump_mgr structure, or NULL if io_uring is
+ * not available
+ */
+struct upump_mgr *upump_uring_mgr_alloc(uint16_t upump_pool_depth,
+                                        uint16_t upump_blocker_pool_depth);
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -122,10 +122,16 @@ struct upipe_alsink {
 
     /** delay applied to system clock ref when uclock is provided */
     uint64_t latency;
+    /** latency reported to upstream pipes */
+    uint64_t sink_latency;
     /** device name */
     char *uri;
     /** ALSA handle */
     snd_pcm_t *handle;
+    /** true if direct buffer access was requested */
+    bool mmap;
+    /** true if the device was opened with direct buffer access */
+    bool direct;
     /** temporary uref storage */
     struct uchain urefs;
     /** nb urefs in storage */
@@ -281,9 +287,12 @@ static struct upipe *upipe_alsink_alloc(struct upipe_mgr *mgr,
     upipe_alsink_init_input(upipe);
     upipe_alsink_init_uclock(upipe);
     upipe_alsink->latency = 0;
+    upipe_alsink->sink_latency = 0;
     upipe_alsink->rate = 0;
     upipe_alsink->uri = strdup(DEFAULT_DEVICE);
     upipe_alsink->handle = NULL;
+    upipe_alsink->mmap = false;
+    upipe_alsink->direct = false;
     upipe_alsink->max_urefs = BUFFER_UREFS;
     ulist_init(&upipe_alsink->urequests);
     upipe_throw_ready(upipe);
@@ -299,6 +308,7 @@ static struct upipe *upipe_alsink_alloc(struct upipe_mgr *mgr,
 static int upipe_alsink_update_latency(struct upipe *upipe, uint64_t latency)
 {
     struct upipe_alsink *upipe_alsink = upipe_alsink_from_upipe(upipe);
+    upipe_alsink->sink_latency = latency;
     struct uchain *uchain, *uchain_tmp;
     ulist_delete_foreach (&upipe_alsink->urequests, uchain, uchain_tmp) {
         struct upipe_alsink_request *proxy =
@@ -343,7 +353,16 @@ static bool upipe_alsink_open(struct upipe *upipe)
         goto open_error;
     }
 
-    if (snd_pcm_hw_params_set_access(upipe_alsink->handle, hwparams,
+    upipe_alsink->direct = upipe_alsink->mmap &&
+        snd_pcm_hw_params_set_access(upipe_alsink->handle, hwparams,
+                                     upipe_alsink->planes == 1 ?
+                                     SND_PCM_ACCESS_MMAP_INTERLEAVED :
+                                     SND_PCM_ACCESS_MMAP_NONINTERLEAVED) >= 0;
+    if (upipe_alsink->mmap && !upipe_alsink->direct)
+        upipe_warn_va(upipe, "device %s doesn't support mmap mode", uri);
+
+    if (!upipe_alsink->direct &&
+        snd_pcm_hw_params_set_access(upipe_alsink->handle, hwparams,
                                      upipe_alsink->planes == 1 ?
                                      SND_PCM_ACCESS_RW_INTERLEAVED :
                                      SND_PCM_ACCESS_RW_NONINTERLEAVED) < 0) {
@@ -439,7 +458,8 @@ static bool upipe_alsink_open(struct upipe *upipe)
 
     if (!upipe_alsink_check_input(upipe))
         upipe_use(upipe);
-    upipe_notice_va(upipe, "opened device %s", uri);
+    upipe_notice_va(upipe, "opened device %s%s", uri,
+                    upipe_alsink->direct ? " (mmap)" : "");
     return true;
 
 open_error:
@@ -490,6 +510,92 @@ static bool upipe_alsink_recover(struct upipe *upipe, int err)
     return true;
 }
 
+/** @internal @This is called to output raw data straight into the ring
+ * buffer of the device, in mmap mode.
+ *
+ * @param upipe description structure of the pipe
+ * @param buffers pointer to array of buffers, or NULL to output silence
+ * @param buffer_frames number of frames in buffer
+ * @return the number of frames effectively written, or -1 in case of error
+ */
+static snd_pcm_sframes_t upipe_alsink_mmap_frames(struct upipe *upipe,
+        const void **buffers, snd_pcm_uframes_t buffer_frames)
+{
+    struct upipe_alsink *upipe_alsink = upipe_alsink_from_upipe(upipe);
+    snd_pcm_t *handle = upipe_alsink->handle;
+    unsigned int channels = upipe_alsink->channels;
+    unsigned int width = snd_pcm_format_physical_width(upipe_alsink->format);
+
+    /* describe the source buffers the same way ALSA describes its ring */
+    snd_pcm_channel_area_t src_areas[channels];
+    if (buffers != NULL) {
+        unsigned int i;
+        for (i = 0; i < channels; i++) {
+            if (upipe_alsink->planes == 1) {
+                src_areas[i].addr = (void *)buffers[0];
+                src_areas[i].first = i * width;
+                src_areas[i].step = channels * width;
+            } else {
+                src_areas[i].addr = (void *)buffers[i];
+                src_areas[i].first = 0;
+                src_areas[i].step = width;
+            }
+        }
+    }
+
+    snd_pcm_sframes_t avail;
+    while ((avail = snd_pcm_avail_update(handle)) < 0)
+        if (unlikely(!upipe_alsink_recover(upipe, avail)))
+            return -1;
+    if (avail == 0) {
+        upipe_warn_va(upipe, "ALSA FIFO full, skipping tick");
+        return 0;
+    }
+    if (buffer_frames > (snd_pcm_uframes_t)avail)
+        buffer_frames = avail;
+
+    snd_pcm_uframes_t done = 0;
+    while (done < buffer_frames) {
+        const snd_pcm_channel_area_t *areas;
+        snd_pcm_uframes_t offset;
+        snd_pcm_uframes_t frames = buffer_frames - done;
+        int err = snd_pcm_mmap_begin(handle, &areas, &offset, &frames);
+        if (err < 0) {
+            if (unlikely(!upipe_alsink_recover(upipe, err)))
+                return -1;
+            break;
+        }
+        if (frames == 0)
+            break;
+
+        if (buffers != NULL)
+            snd_pcm_areas_copy(areas, offset, src_areas, done, channels,
+                               frames, upipe_alsink->format);
+        else
+            snd_pcm_areas_silence(areas, offset, channels, frames,
+                                  upipe_alsink->format);
+
+        snd_pcm_sframes_t committed = snd_pcm_mmap_commit(handle, offset,
+                                                          frames);
+        if (committed < 0) {
+            if (unlikely(!upipe_alsink_recover(upipe, committed)))
+                return -1;
+            break;
+        }
+        done += committed;
+        if ((snd_pcm_uframes_t)committed != frames)
+            break;
+    }
+
+    /* the start threshold only applies to snd_pcm_write* */
+    if (done > 0 && snd_pcm_state(handle) == SND_PCM_STATE_PREPARED) {
+        int err = snd_pcm_start(handle);
+        if (err < 0 && unlikely(!upipe_alsink_recover(upipe, err)))
+            return -1;
+    }
+    return done;
+}
+
 /** @internal @This is called to output raw data to alsa.
  *
  * @param upipe description structure of the pipe
@@ -501,6 +607,9 @@ static snd_pcm_sframes_t upipe_alsink_output_frames(struct upipe *upipe,
         const void **buffers, snd_pcm_uframes_t buffer_frames)
 {
     struct upipe_alsink *upipe_alsink = upipe_alsink_from_upipe(upipe);
+    if (upipe_alsink->direct)
+        return upipe_alsink_mmap_frames(upipe, buffers, buffer_frames);
+
     snd_pcm_sframes_t frames;
     for ( ; ; ) {
         if (upipe_alsink->planes == 1)
@@ -554,6 +663,10 @@ static snd_pcm_sframes_t upipe_alsink_silence(struct upipe *upipe,
                                               snd_pcm_uframes_t silence_frames)
 {
     struct upipe_alsink *upipe_alsink = upipe_alsink_from_upipe(upipe);
+    if (upipe_alsink->direct)
+        /* clear the ring buffer in place */
+        return upipe_alsink_mmap_frames(upipe, NULL, silence_frames);
+
     if (upipe_alsink->planes == 1) {
         uint8_t buffer[snd_pcm_frames_to_bytes(upipe_alsink->handle,
                                                silence_frames)];
@@ -637,8 +750,17 @@ static void upipe_alsink_timer(struct upump *upump)
                 return;
 
         /* This is slightly off if we're just starting the stream. */
-        next_pts = uclock_now(upipe_alsink->uclock) +
-                   (uint64_t)delay * UCLOCK_FREQ / upipe_alsink->rate;
+        uint64_t delay_duration = delay > 0 ?
+            (uint64_t)delay * UCLOCK_FREQ / upipe_alsink->rate : 0;
+        next_pts = uclock_now(upipe_alsink->uclock) + delay_duration;
+
+        /* report the actual depth of the device buffer, with a one period
+         * hysteresis */
+        if (delay_duration > upipe_alsink->sink_latency +
+                             upipe_alsink->period_duration ||
+            delay_duration + upipe_alsink->period_duration <
+                upipe_alsink->sink_latency)
+            upipe_alsink_update_latency(upipe, delay_duration);
     }
 
     lldiv_t d = lldiv(upipe_alsink->period_duration * upipe_alsink->rate +
@@ -831,6 +953,24 @@ static int upipe_alsink_set_uri(struct upipe *upipe, const char *uri)
     return UBASE_ERR_NONE;
 }
 
+/** @internal @This sets the direct buffer access mode. The device is
+ * reopened on the next buffer.
+ *
+ * @param upipe description structure of the pipe
+ * @param direct true to use direct buffer access
+ * @return an error code
+ */
+static int _upipe_alsink_set_mmap(struct upipe *upipe, bool direct)
+{
+    struct upipe_alsink *upipe_alsink = upipe_alsink_from_upipe(upipe);
+    if (upipe_alsink->mmap == direct)
+        return UBASE_ERR_NONE;
+
+    upipe_alsink_close(upipe);
+    upipe_alsink->mmap = direct;
+    return UBASE_ERR_NONE;
+}
+
 /** @internal @This flushes all currently held buffers, and unblocks the
  * sources.
  *
@@ -868,8 +1008,7 @@ static int upipe_alsink_register_request(struct upipe *upipe,
               upipe_alsink_request_to_uchain(proxy));
 
     return urequest_provide_sink_latency(proxy->upstream,
-            upipe_alsink->handle != NULL ?
-            upipe_alsink->period_duration * BUFFER_PERIODS : 0);
+            upipe_alsink->handle != NULL ? upipe_alsink->sink_latency : 0);
 }
 
 /** @internal @This unregisters a urequest.
@@ -937,6 +1076,19 @@ static int upipe_alsink_control(struct upipe *upipe, int command, va_list args)
         }
         case UPIPE_FLUSH:
             return upipe_alsink_flush(upipe);
+
+        case UPIPE_ALSINK_GET_MMAP: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_ALSINK_SIGNATURE)
+            struct upipe_alsink *upipe_alsink = upipe_alsink_from_upipe(upipe);
+            bool *direct_p = va_arg(args, bool *);
+            *direct_p = upipe_alsink->mmap;
+            return UBASE_ERR_NONE;
+        }
+        case UPIPE_ALSINK_SET_MMAP: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_ALSINK_SIGNATURE)
+            bool direct = !!va_arg(args, int);
+            return _upipe_alsink_set_mmap(upipe, direct);
+        }
         default:
             return UBASE_ERR_UNHANDLED;
     }
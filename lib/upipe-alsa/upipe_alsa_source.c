@@ -129,6 +129,10 @@ struct upipe_alsource {
     char *uri;
     /** ALSA handle */
     snd_pcm_t *handle;
+    /** true if direct buffer access was requested */
+    bool mmap;
+    /** true if the device was opened with direct buffer access */
+    bool direct;
     /** poll fd **/
     struct pollfd pfd;
 
@@ -193,11 +197,69 @@ static struct upipe *upipe_alsource_alloc(struct upipe_mgr *mgr,
     upipe_alsource->uri = strdup(DEFAULT_DEVICE);
     upipe_alsource->pfd.fd = -1;
     upipe_alsource->handle = NULL;
+    upipe_alsource->mmap = false;
+    upipe_alsource->direct = false;
 
     upipe_throw_ready(upipe);
     return upipe;
 }
 
+/** @internal @This reads a period straight from the ring buffer of the
+ * device, in mmap mode.
+ *
+ * @param upipe description structure of the pipe
+ * @param buffer interleaved buffer to fill in
+ * @param buffer_frames number of frames to read
+ * @return the number of frames read, or a negative ALSA error code
+ */
+static snd_pcm_sframes_t upipe_alsource_mmap_read(struct upipe *upipe,
+        void *buffer, snd_pcm_uframes_t buffer_frames)
+{
+    struct upipe_alsource *upipe_alsource = upipe_alsource_from_upipe(upipe);
+    snd_pcm_t *handle = upipe_alsource->handle;
+    unsigned int channels = upipe_alsource->channels;
+    unsigned int width = snd_pcm_format_physical_width(upipe_alsource->format);
+
+    snd_pcm_sframes_t avail = snd_pcm_avail_update(handle);
+    if (avail < 0)
+        return avail;
+    /* like snd_pcm_readi in non-blocking mode */
+    if ((snd_pcm_uframes_t)avail < buffer_frames)
+        return -EAGAIN;
+
+    snd_pcm_channel_area_t dst_areas[channels];
+    unsigned int i;
+    for (i = 0; i < channels; i++) {
+        dst_areas[i].addr = buffer;
+        dst_areas[i].first = i * width;
+        dst_areas[i].step = channels * width;
+    }
+
+    snd_pcm_uframes_t done = 0;
+    while (done < buffer_frames) {
+        const snd_pcm_channel_area_t *areas;
+        snd_pcm_uframes_t offset;
+        snd_pcm_uframes_t frames = buffer_frames - done;
+        int err = snd_pcm_mmap_begin(handle, &areas, &offset, &frames);
+        if (err < 0)
+            return err;
+        if (frames == 0)
+            break;
+
+        snd_pcm_areas_copy(dst_areas, done, areas, offset, channels, frames,
+                           upipe_alsource->format);
+
+        snd_pcm_sframes_t committed = snd_pcm_mmap_commit(handle, offset,
+                                                          frames);
+        if (committed < 0)
+            return committed;
+        done += committed;
+        if ((snd_pcm_uframes_t)committed != frames)
+            break;
+    }
+    return done;
+}
+
 static void upipe_alsource_worker(struct upump *upump)
 {
     struct upipe *upipe = upump_get_opaque(upump, struct upipe *);
@@ -212,7 +274,9 @@ static void upipe_alsource_worker(struct upump *upump)
                             upipe_alsource->period_samples);
 
     uref_sound_plane_write_float(uref, "lr", 0, -1, &pcm);
-    int err = snd_pcm_readi(upipe_alsource->handle, pcm, upipe_alsource->period_samples);
+    int err = upipe_alsource->direct ?
+        upipe_alsource_mmap_read(upipe, pcm, upipe_alsource->period_samples) :
+        snd_pcm_readi(upipe_alsource->handle, pcm, upipe_alsource->period_samples);
     uref_sound_plane_unmap(uref, "lr", 0, -1);
 
     if (err < 0){
@@ -280,7 +344,14 @@ static bool upipe_alsource_open(struct upipe *upipe)
         goto open_error;
     }
 
-    if (snd_pcm_hw_params_set_access(upipe_alsource->handle, hwparams,
+    upipe_alsource->direct = upipe_alsource->mmap &&
+        snd_pcm_hw_params_set_access(upipe_alsource->handle, hwparams,
+                                     SND_PCM_ACCESS_MMAP_INTERLEAVED) >= 0;
+    if (upipe_alsource->mmap && !upipe_alsource->direct)
+        upipe_warn_va(upipe, "device %s doesn't support mmap mode", uri);
+
+    if (!upipe_alsource->direct &&
+        snd_pcm_hw_params_set_access(upipe_alsource->handle, hwparams,
                                      SND_PCM_ACCESS_RW_INTERLEAVED) < 0) {
         upipe_err_va(upipe, "can't set interleaved mode (%s)", uri);
         goto open_error;
@@ -360,7 +431,8 @@ static bool upipe_alsource_open(struct upipe *upipe)
 
     snd_pcm_start(upipe_alsource->handle);
 
-    upipe_notice_va(upipe, "opened device %s", uri);
+    upipe_notice_va(upipe, "opened device %s%s", uri,
+                    upipe_alsource->direct ? " (mmap)" : "");
     return true;
 
 open_error:
@@ -449,6 +521,28 @@ static int upipe_alsource_set_uri(struct upipe *upipe, const char *uri)
     return UBASE_ERR_NONE;
 }
 
+/** @internal @This sets the direct buffer access mode, and reopens the
+ * device if needed.
+ *
+ * @param upipe description structure of the pipe
+ * @param direct true to use direct buffer access
+ * @return an error code
+ */
+static int _upipe_alsource_set_mmap(struct upipe *upipe, bool direct)
+{
+    struct upipe_alsource *upipe_alsource = upipe_alsource_from_upipe(upipe);
+    if (upipe_alsource->mmap == direct)
+        return UBASE_ERR_NONE;
+
+    upipe_alsource->mmap = direct;
+    if (upipe_alsource->handle == NULL)
+        return UBASE_ERR_NONE;
+
+    upipe_alsource_close(upipe);
+    upipe_alsource_open(upipe);
+    return UBASE_ERR_NONE;
+}
+
 /** @internal @This receives a provided ubuf manager.
  *
  * @param upipe description structure of the pipe
@@ -535,6 +629,20 @@ static int _upipe_alsource_control(struct upipe *upipe, int command, va_list arg
             const char *uri = va_arg(args, const char *);
             return upipe_alsource_set_uri(upipe, uri);
         }
+
+        case UPIPE_ALSOURCE_GET_MMAP: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_ALSOURCE_SIGNATURE)
+            struct upipe_alsource *upipe_alsource =
+                upipe_alsource_from_upipe(upipe);
+            bool *direct_p = va_arg(args, bool *);
+            *direct_p = upipe_alsource->mmap;
+            return UBASE_ERR_NONE;
+        }
+        case UPIPE_ALSOURCE_SET_MMAP: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_ALSOURCE_SIGNATURE)
+            bool direct = !!va_arg(args, int);
+            return _upipe_alsource_set_mmap(upipe, direct);
+        }
         default:
             return UBASE_ERR_UNHANDLED;
     }
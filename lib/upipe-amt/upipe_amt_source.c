@@ -69,6 +69,8 @@
 
 /** default size of buffers when unspecified */
 #define UBUF_DEFAULT_SIZE       4096
+/** maximum number of datagrams read in one wake-up */
+#define UPIPE_AMTSRC_BATCH      32
 
 /** @hidden */
 static int upipe_amtsrc_check(struct upipe *upipe, struct uref *flow_format);
@@ -186,40 +188,14 @@ static struct upipe *upipe_amtsrc_alloc(struct upipe_mgr *mgr,
     return upipe;
 }
 
-/** @internal @This reads data from the source and outputs it.
- * It is called either when the idler triggers (permanent storage mode) or
- * when data is available on the udp socket descriptor (live stream mode).
+/** @internal @This reads one datagram from the AMT channel and outputs it.
  *
- * @param upump description structure of the read watcher
+ * @param upipe description structure of the pipe
+ * @return false if the pipe must stop reading
  */
-static void upipe_amtsrc_worker(struct upump *upump)
+static bool upipe_amtsrc_read(struct upipe *upipe)
 {
-    struct upipe *upipe = upump_get_opaque(upump, struct upipe *);
     struct upipe_amtsrc *upipe_amtsrc = upipe_amtsrc_from_upipe(upipe);
-    amt_read_event_t ars[1];
-    ars[0].handle = upipe_amtsrc->handle;
-    ars[0].rstate = AMT_READ_NONE;
-
-    /* Implementation note: libamt is synchronous, so we have to poll for
-     * input. The timeout is set as low as possible to 1 ms. */
-    if (unlikely(amt_poll(ars, 1, 1) < 0)) {
-        upipe_err_va(upipe, "poll error from %s", upipe_amtsrc->uri);
-        upipe_amtsrc_set_upump(upipe, NULL);
-        upipe_throw_source_end(upipe);
-        return;
-    }
-
-    if (unlikely((ars[0].rstate & AMT_READ_CLOSE) ||
-                 (ars[0].rstate & AMT_READ_ERR))) {
-        upipe_err_va(upipe, "end of %s", upipe_amtsrc->uri);
-        upipe_amtsrc_set_upump(upipe, NULL);
-        upipe_throw_source_end(upipe);
-        return;
-    }
-
-    if (!(ars[0].rstate & AMT_READ_IN))
-        return;
-
     uint64_t systime = 0; /* to keep gcc quiet */
     if (unlikely(upipe_amtsrc->uclock != NULL))
         systime = uclock_now(upipe_amtsrc->uclock);
@@ -229,7 +205,7 @@ static void upipe_amtsrc_worker(struct upump *upump)
                                          upipe_amtsrc->output_size);
     if (unlikely(uref == NULL)) {
         upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
-        return;
+        return false;
     }
 
     uint8_t *buffer;
@@ -238,7 +214,7 @@ static void upipe_amtsrc_worker(struct upump *upump)
                                                &buffer)))) {
         uref_free(uref);
         upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
-        return;
+        return false;
     }
     assert(output_size == upipe_amtsrc->output_size);
 
@@ -251,13 +227,57 @@ static void upipe_amtsrc_worker(struct upump *upump)
         upipe_err_va(upipe, "read error from %s", upipe_amtsrc->uri);
         upipe_amtsrc_set_upump(upipe, NULL);
         upipe_throw_source_end(upipe);
-        return;
+        return false;
     }
     if (unlikely(upipe_amtsrc->uclock != NULL))
         uref_clock_set_cr_sys(uref, systime);
     if (unlikely(ret != upipe_amtsrc->output_size))
         uref_block_resize(uref, 0, ret);
     upipe_amtsrc_output(upipe, uref, &upipe_amtsrc->upump);
+    /* the pump may have been released or blocked downstream */
+    return upipe_amtsrc->upump != NULL;
+}
+
+/** @internal @This reads data from the source and outputs it.
+ * It is called when the idler triggers, and drains up to
+ * @ref UPIPE_AMTSRC_BATCH datagrams from the channel.
+ *
+ * @param upump description structure of the read watcher
+ */
+static void upipe_amtsrc_worker(struct upump *upump)
+{
+    struct upipe *upipe = upump_get_opaque(upump, struct upipe *);
+    struct upipe_amtsrc *upipe_amtsrc = upipe_amtsrc_from_upipe(upipe);
+
+    /* Implementation note: libamt is synchronous, so we have to poll for
+     * input. The timeout of the first poll is set as low as possible to
+     * 1 ms, then the datagrams already queued on the tunnel are read
+     * without waiting, so that a wake-up is not paid for each datagram. */
+    upipe_use(upipe);
+    for (unsigned int i = 0; i < UPIPE_AMTSRC_BATCH; i++) {
+        amt_read_event_t ars[1];
+        ars[0].handle = upipe_amtsrc->handle;
+        ars[0].rstate = AMT_READ_NONE;
+
+        if (unlikely(amt_poll(ars, 1, i ? 0 : 1) < 0)) {
+            upipe_err_va(upipe, "poll error from %s", upipe_amtsrc->uri);
+            upipe_amtsrc_set_upump(upipe, NULL);
+            upipe_throw_source_end(upipe);
+            break;
+        }
+
+        if (unlikely((ars[0].rstate & AMT_READ_CLOSE) ||
+                     (ars[0].rstate & AMT_READ_ERR))) {
+            upipe_err_va(upipe, "end of %s", upipe_amtsrc->uri);
+            upipe_amtsrc_set_upump(upipe, NULL);
+            upipe_throw_source_end(upipe);
+            break;
+        }
+
+        if (!(ars[0].rstate & AMT_READ_IN) || !upipe_amtsrc_read(upipe))
+            break;
+    }
+    upipe_release(upipe);
 }
 
 /** @internal @This checks if the pump may be allocated.
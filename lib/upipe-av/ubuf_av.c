@@ -0,0 +1,464 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short Upipe ubuf manager for pictures wrapping avutil frames
+ */
+
+#include <upipe/ubase.h>
+#include <upipe/urefcount.h>
+#include <upipe/ubuf.h>
+#include <upipe/ubuf_pic.h>
+#include <upipe/ubuf_pic_common.h>
+#include <upipe/uref.h>
+#include <upipe/uref_flow.h>
+#include <upipe/uref_pic_flow.h>
+#include <upipe-av/ubuf_av.h>
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdarg.h>
+#include <string.h>
+#include <assert.h>
+
+#include <libavutil/frame.h>
+#include <libavutil/hwcontext.h>
+
+/** @This is a super-set of the @ref ubuf (and @ref ubuf_pic_common)
+ * structure with private fields pointing to the frames. */
+struct ubuf_av {
+    /** wrapped frame, possibly in hardware memory */
+    AVFrame *frame;
+    /** frame in system memory, or NULL if not transferred yet */
+    AVFrame *sw_frame;
+
+    /** common picture structure */
+    struct ubuf_pic_common ubuf_pic_common;
+};
+
+UBASE_FROM_TO(ubuf_av, ubuf, ubuf, ubuf_pic_common.ubuf)
+
+/** @This is a super-set of the ubuf_mgr structure with additional local
+ * members. */
+struct ubuf_av_mgr {
+    /** refcount management structure */
+    struct urefcount urefcount;
+
+    /** common picture management structure */
+    struct ubuf_pic_common_mgr common_mgr;
+};
+
+UBASE_FROM_TO(ubuf_av_mgr, ubuf_mgr, ubuf_mgr, common_mgr.mgr)
+UBASE_FROM_TO(ubuf_av_mgr, urefcount, urefcount, urefcount)
+
+/** @internal @This allocates the data structure.
+ *
+ * @param mgr common management structure
+ * @return pointer to ubuf_av or NULL in case of allocation error
+ */
+static struct ubuf_av *ubuf_av_alloc_inner(struct ubuf_mgr *mgr)
+{
+    struct ubuf_av *ubuf_av = malloc(sizeof(struct ubuf_av) +
+                                     ubuf_pic_common_sizeof(mgr));
+    if (unlikely(ubuf_av == NULL))
+        return NULL;
+    struct ubuf *ubuf = ubuf_av_to_ubuf(ubuf_av);
+    ubuf->mgr = mgr;
+    uchain_init(&ubuf->uchain);
+    ubuf_av->frame = NULL;
+    ubuf_av->sw_frame = NULL;
+    ubuf_mgr_use(mgr);
+    return ubuf_av;
+}
+
+/** @This allocates a ubuf referencing an AVFrame.
+ *
+ * @param mgr common management structure
+ * @param signature must be UBUF_AV_ALLOC_PICTURE
+ * @param args optional arguments (1st = AVFrame *)
+ * @return pointer to ubuf or NULL in case of allocation error
+ */
+static struct ubuf *ubuf_av_alloc(struct ubuf_mgr *mgr,
+                                  uint32_t signature, va_list args)
+{
+    if (unlikely(signature != UBUF_AV_ALLOC_PICTURE))
+        return NULL;
+
+    AVFrame *frame = va_arg(args, AVFrame *);
+    struct ubuf_pic_common_mgr *common_mgr =
+        ubuf_pic_common_mgr_from_ubuf_mgr(mgr);
+    if (unlikely(frame == NULL || frame->width % common_mgr->macropixel))
+        return NULL;
+
+    struct ubuf_av *ubuf_av = ubuf_av_alloc_inner(mgr);
+    if (unlikely(ubuf_av == NULL))
+        return NULL;
+
+    struct ubuf *ubuf = ubuf_av_to_ubuf(ubuf_av);
+    ubuf_av->frame = av_frame_clone(frame);
+    if (unlikely(ubuf_av->frame == NULL)) {
+        ubuf_free(ubuf);
+        return NULL;
+    }
+
+    ubuf_pic_common_init(ubuf, 0, 0, frame->width / common_mgr->macropixel,
+                         0, 0, frame->height);
+    for (uint8_t plane = 0; plane < common_mgr->nb_planes; plane++)
+        ubuf_pic_common_plane_init(ubuf, plane, NULL, 0);
+    return ubuf;
+}
+
+/** @internal @This initializes the planes from a frame in system memory.
+ *
+ * @param ubuf pointer to ubuf
+ */
+static void ubuf_av_init_planes(struct ubuf *ubuf)
+{
+    struct ubuf_av *ubuf_av = ubuf_av_from_ubuf(ubuf);
+    struct ubuf_pic_common_mgr *common_mgr =
+        ubuf_pic_common_mgr_from_ubuf_mgr(ubuf->mgr);
+    for (uint8_t plane = 0; plane < common_mgr->nb_planes; plane++)
+        ubuf_pic_common_plane_init(ubuf, plane, ubuf_av->sw_frame->data[plane],
+                                   ubuf_av->sw_frame->linesize[plane]);
+}
+
+/** @internal @This transfers the frame to system memory if it has not been
+ * done yet. Software frames are merely referenced.
+ *
+ * @param ubuf pointer to ubuf
+ * @return an error code
+ */
+static int ubuf_av_download(struct ubuf *ubuf)
+{
+    struct ubuf_av *ubuf_av = ubuf_av_from_ubuf(ubuf);
+    if (likely(ubuf_av->sw_frame != NULL))
+        return UBASE_ERR_NONE;
+
+    AVFrame *frame = ubuf_av->frame;
+    AVFrame *sw_frame;
+    if (frame->hw_frames_ctx == NULL) {
+        sw_frame = av_frame_clone(frame);
+        if (unlikely(sw_frame == NULL))
+            return UBASE_ERR_ALLOC;
+    } else {
+        AVHWFramesContext *frames_ctx =
+            (AVHWFramesContext *)frame->hw_frames_ctx->data;
+        sw_frame = av_frame_alloc();
+        if (unlikely(sw_frame == NULL))
+            return UBASE_ERR_ALLOC;
+        sw_frame->format = frames_ctx->sw_format;
+        if (unlikely(av_hwframe_transfer_data(sw_frame, frame, 0) < 0)) {
+            av_frame_free(&sw_frame);
+            return UBASE_ERR_EXTERNAL;
+        }
+    }
+
+    ubuf_av->sw_frame = sw_frame;
+    ubuf_av_init_planes(ubuf);
+    return UBASE_ERR_NONE;
+}
+
+/** @This asks for the creation of a new reference to the same frame.
+ *
+ * @param ubuf pointer to ubuf
+ * @param new_ubuf_p reference written with a pointer to the newly allocated
+ * ubuf
+ * @return an error code
+ */
+static int ubuf_av_dup(struct ubuf *ubuf, struct ubuf **new_ubuf_p)
+{
+    assert(new_ubuf_p != NULL);
+    struct ubuf_av *ubuf_av = ubuf_av_from_ubuf(ubuf);
+    struct ubuf_av *new_av = ubuf_av_alloc_inner(ubuf->mgr);
+    if (unlikely(new_av == NULL))
+        return UBASE_ERR_ALLOC;
+
+    struct ubuf *new_ubuf = ubuf_av_to_ubuf(new_av);
+    new_av->frame = av_frame_clone(ubuf_av->frame);
+    if (unlikely(new_av->frame == NULL)) {
+        ubuf_free(new_ubuf);
+        return UBASE_ERR_ALLOC;
+    }
+    /* the transferred frame is shared, which makes it read-only */
+    if (ubuf_av->sw_frame != NULL &&
+        unlikely((new_av->sw_frame = av_frame_clone(ubuf_av->sw_frame)) ==
+                 NULL)) {
+        ubuf_free(new_ubuf);
+        return UBASE_ERR_ALLOC;
+    }
+
+    if (unlikely(!ubase_check(ubuf_pic_common_dup(ubuf, new_ubuf)))) {
+        ubuf_free(new_ubuf);
+        return UBASE_ERR_INVALID;
+    }
+    struct ubuf_pic_common_mgr *common_mgr =
+        ubuf_pic_common_mgr_from_ubuf_mgr(ubuf->mgr);
+    for (uint8_t plane = 0; plane < common_mgr->nb_planes; plane++) {
+        if (unlikely(!ubase_check(ubuf_pic_common_plane_dup(ubuf, new_ubuf,
+                                                            plane)))) {
+            ubuf_free(new_ubuf);
+            return UBASE_ERR_INVALID;
+        }
+    }
+    *new_ubuf_p = new_ubuf;
+    return UBASE_ERR_NONE;
+}
+
+/** @This handles control commands.
+ *
+ * @param ubuf pointer to ubuf
+ * @param command type of command to process
+ * @param args arguments of the command
+ * @return an error code
+ */
+static int ubuf_av_control(struct ubuf *ubuf, int command, va_list args)
+{
+    switch (command) {
+        case UBUF_DUP: {
+            struct ubuf **new_ubuf_p = va_arg(args, struct ubuf **);
+            return ubuf_av_dup(ubuf, new_ubuf_p);
+        }
+        case UBUF_SIZE_PICTURE: {
+            size_t *hsize_p = va_arg(args, size_t *);
+            size_t *vsize_p = va_arg(args, size_t *);
+            uint8_t *macropixel_p = va_arg(args, uint8_t *);
+            return ubuf_pic_common_size(ubuf, hsize_p, vsize_p, macropixel_p);
+        }
+        case UBUF_ITERATE_PICTURE_PLANE: {
+            const char **chroma_p = va_arg(args, const char **);
+            return ubuf_pic_common_plane_iterate(ubuf, chroma_p);
+        }
+        case UBUF_SIZE_PICTURE_PLANE: {
+            const char *chroma = va_arg(args, const char *);
+            size_t *stride_p = va_arg(args, size_t *);
+            uint8_t *hsub_p = va_arg(args, uint8_t *);
+            uint8_t *vsub_p = va_arg(args, uint8_t *);
+            uint8_t *macropixel_size_p = va_arg(args, uint8_t *);
+            /* the stride is only known once in system memory */
+            UBASE_RETURN(ubuf_av_download(ubuf))
+            return ubuf_pic_common_plane_size(ubuf, chroma, stride_p,
+                                              hsub_p, vsub_p,
+                                              macropixel_size_p);
+        }
+        case UBUF_READ_PICTURE_PLANE: {
+            const char *chroma = va_arg(args, const char *);
+            int hoffset = va_arg(args, int);
+            int voffset = va_arg(args, int);
+            int hsize = va_arg(args, int);
+            int vsize = va_arg(args, int);
+            uint8_t **buffer_p = va_arg(args, uint8_t **);
+            UBASE_RETURN(ubuf_av_download(ubuf))
+            return ubuf_pic_common_plane_map(ubuf, chroma, hoffset, voffset,
+                                             hsize, vsize, buffer_p);
+        }
+        case UBUF_WRITE_PICTURE_PLANE: {
+            const char *chroma = va_arg(args, const char *);
+            int hoffset = va_arg(args, int);
+            int voffset = va_arg(args, int);
+            int hsize = va_arg(args, int);
+            int vsize = va_arg(args, int);
+            uint8_t **buffer_p = va_arg(args, uint8_t **);
+            UBASE_RETURN(ubuf_av_download(ubuf))
+            struct ubuf_av *ubuf_av = ubuf_av_from_ubuf(ubuf);
+            if (!av_frame_is_writable(ubuf_av->sw_frame))
+                return UBASE_ERR_BUSY;
+            return ubuf_pic_common_plane_map(ubuf, chroma, hoffset, voffset,
+                                             hsize, vsize, buffer_p);
+        }
+        case UBUF_UNMAP_PICTURE_PLANE:
+            /* we don't actually care about the parameters */
+            return UBASE_ERR_NONE;
+        case UBUF_RESIZE_PICTURE: {
+            int hskip = va_arg(args, int);
+            int vskip = va_arg(args, int);
+            int new_hsize = va_arg(args, int);
+            int new_vsize = va_arg(args, int);
+            return ubuf_pic_common_resize(ubuf, hskip, vskip,
+                                          new_hsize, new_vsize);
+        }
+
+        case UBUF_AV_GET_FRAME: {
+            UBASE_SIGNATURE_CHECK(args, UBUF_AV_SIGNATURE)
+            AVFrame **frame_p = va_arg(args, AVFrame **);
+            *frame_p = ubuf_av_from_ubuf(ubuf)->frame;
+            return UBASE_ERR_NONE;
+        }
+        default:
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** @This frees a ubuf.
+ *
+ * @param ubuf pointer to a ubuf structure
+ */
+static void ubuf_av_free(struct ubuf *ubuf)
+{
+    struct ubuf_mgr *mgr = ubuf->mgr;
+    struct ubuf_pic_common_mgr *common_mgr =
+        ubuf_pic_common_mgr_from_ubuf_mgr(mgr);
+    struct ubuf_av *ubuf_av = ubuf_av_from_ubuf(ubuf);
+
+    ubuf_pic_common_clean(ubuf);
+    for (uint8_t plane = 0; plane < common_mgr->nb_planes; plane++)
+        ubuf_pic_common_plane_clean(ubuf, plane);
+
+    av_frame_free(&ubuf_av->sw_frame);
+    av_frame_free(&ubuf_av->frame);
+    free(ubuf_av);
+    ubuf_mgr_release(mgr);
+}
+
+/** @This checks if the given flow format can be allocated with the manager.
+ *
+ * @param mgr pointer to ubuf manager
+ * @param flow_format flow format to check
+ * @return an error code
+ */
+static int ubuf_av_mgr_check(struct ubuf_mgr *mgr, struct uref *flow_format)
+{
+    const char *def;
+    UBASE_RETURN(uref_flow_get_def(flow_format, &def))
+    if (ubase_ncmp(def, "pic."))
+        return UBASE_ERR_INVALID;
+
+    uint8_t macropixel;
+    uint8_t planes;
+    UBASE_RETURN(uref_pic_flow_get_macropixel(flow_format, &macropixel))
+    UBASE_RETURN(uref_pic_flow_get_planes(flow_format, &planes))
+
+    struct ubuf_pic_common_mgr *common_mgr =
+        ubuf_pic_common_mgr_from_ubuf_mgr(mgr);
+    if (common_mgr->macropixel != macropixel ||
+        common_mgr->nb_planes != planes)
+        return UBASE_ERR_INVALID;
+
+    for (uint8_t i = 0; i < planes; i++) {
+        struct ubuf_pic_common_mgr_plane *plane = common_mgr->planes[i];
+        const char *chroma;
+        uint8_t hsub, vsub, macropixel_size;
+        UBASE_RETURN(uref_pic_flow_get_chroma(flow_format, &chroma, i))
+        UBASE_RETURN(uref_pic_flow_get_hsubsampling(flow_format, &hsub, i))
+        UBASE_RETURN(uref_pic_flow_get_vsubsampling(flow_format, &vsub, i))
+        UBASE_RETURN(uref_pic_flow_get_macropixel_size(flow_format,
+                                                       &macropixel_size, i))
+
+        if (strcmp(plane->chroma, chroma) ||
+            plane->hsub != hsub || plane->vsub != vsub ||
+            plane->macropixel_size != macropixel_size)
+            return UBASE_ERR_INVALID;
+    }
+    return UBASE_ERR_NONE;
+}
+
+/** @This handles manager control commands.
+ *
+ * @param mgr pointer to ubuf manager
+ * @param command type of command to process
+ * @param args arguments of the command
+ * @return an error code
+ */
+static int ubuf_av_mgr_control(struct ubuf_mgr *mgr,
+                               int command, va_list args)
+{
+    switch (command) {
+        case UBUF_MGR_CHECK: {
+            struct uref *flow_format = va_arg(args, struct uref *);
+            return ubuf_av_mgr_check(mgr, flow_format);
+        }
+        case UBUF_MGR_VACUUM:
+            /* no pool */
+            return UBASE_ERR_NONE;
+        default:
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** @This frees a ubuf manager.
+ *
+ * @param urefcount pointer to urefcount
+ */
+static void ubuf_av_mgr_free(struct urefcount *urefcount)
+{
+    struct ubuf_av_mgr *av_mgr = ubuf_av_mgr_from_urefcount(urefcount);
+    struct ubuf_mgr *mgr = ubuf_av_mgr_to_ubuf_mgr(av_mgr);
+    ubuf_pic_common_mgr_clean(mgr);
+
+    urefcount_clean(urefcount);
+    free(av_mgr);
+}
+
+/** @This allocates a new instance of the ubuf manager for pictures wrapping
+ * AVFrames.
+ *
+ * @param flow_def picture flow definition
+ * @return pointer to manager, or NULL in case of error
+ */
+struct ubuf_mgr *ubuf_av_mgr_alloc(struct uref *flow_def)
+{
+    assert(flow_def != NULL);
+    uint8_t macropixel;
+    uint8_t planes;
+    if (unlikely(!ubase_check(uref_pic_flow_get_macropixel(flow_def,
+                                                           &macropixel)) ||
+                 !ubase_check(uref_pic_flow_get_planes(flow_def, &planes))))
+        return NULL;
+
+    struct ubuf_av_mgr *av_mgr = malloc(sizeof(struct ubuf_av_mgr));
+    if (unlikely(av_mgr == NULL))
+        return NULL;
+
+    struct ubuf_mgr *mgr = ubuf_av_mgr_to_ubuf_mgr(av_mgr);
+    ubuf_pic_common_mgr_init(mgr, macropixel);
+
+    urefcount_init(ubuf_av_mgr_to_urefcount(av_mgr), ubuf_av_mgr_free);
+    av_mgr->common_mgr.mgr.refcount = ubuf_av_mgr_to_urefcount(av_mgr);
+
+    mgr->signature = UBUF_AV_SIGNATURE;
+    mgr->ubuf_alloc = ubuf_av_alloc;
+    mgr->ubuf_control = ubuf_av_control;
+    mgr->ubuf_free = ubuf_av_free;
+    mgr->ubuf_mgr_control = ubuf_av_mgr_control;
+
+    for (uint8_t i = 0; i < planes; i++) {
+        const char *chroma;
+        uint8_t hsub, vsub, macropixel_size;
+        if (unlikely(!ubase_check(uref_pic_flow_get_chroma(flow_def,
+                                                           &chroma, i)) ||
+                     !ubase_check(uref_pic_flow_get_hsubsampling(flow_def,
+                                                                 &hsub, i)) ||
+                     !ubase_check(uref_pic_flow_get_vsubsampling(flow_def,
+                                                                 &vsub, i)) ||
+                     !ubase_check(uref_pic_flow_get_macropixel_size(flow_def,
+                                                    &macropixel_size, i)) ||
+                     !ubase_check(ubuf_pic_common_mgr_add_plane(mgr, chroma,
+                                                    hsub, vsub,
+                                                    macropixel_size)))) {
+            ubuf_mgr_release(mgr);
+            return NULL;
+        }
+    }
+    return mgr;
+}
@@ -0,0 +1,284 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/** @file
+ * @short Upipe ubuf manager for blocks wrapping avutil buffers
+ */
+
+#include <upipe/ubase.h>
+#include <upipe/urefcount.h>
+#include <upipe/ubuf.h>
+#include <upipe/ubuf_block.h>
+#include <upipe/ubuf_block_common.h>
+#include <upipe/uref.h>
+#include <upipe/uref_flow.h>
+#include <upipe-av/ubuf_block_av.h>
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdarg.h>
+#include <assert.h>
+
+#include <libavutil/buffer.h>
+#include <libavcodec/avcodec.h>
+
+/** @This is a super-set of the @ref ubuf (and @ref ubuf_block)
+ * structure with a private field pointing to the avutil buffer. */
+struct ubuf_block_av {
+    /** referenced buffer */
+    AVBufferRef *buf;
+
+    /** common block structure */
+    struct ubuf_block ubuf_block;
+};
+
+UBASE_FROM_TO(ubuf_block_av, ubuf, ubuf, ubuf_block.ubuf)
+
+/** @This is a super-set of the ubuf_mgr structure with additional local
+ * members. */
+struct ubuf_block_av_mgr {
+    /** refcount management structure */
+    struct urefcount urefcount;
+
+    /** common management structure */
+    struct ubuf_mgr mgr;
+};
+
+UBASE_FROM_TO(ubuf_block_av_mgr, ubuf_mgr, ubuf_mgr, mgr)
+UBASE_FROM_TO(ubuf_block_av_mgr, urefcount, urefcount, urefcount)
+
+/** @internal @This allocates the data structure.
+ *
+ * @param mgr common management structure
+ * @param buf buffer reference, which is stolen
+ * @return pointer to ubuf_block_av or NULL in case of allocation error
+ */
+static struct ubuf_block_av *ubuf_block_av_alloc_inner(struct ubuf_mgr *mgr,
+                                                       AVBufferRef *buf)
+{
+    struct ubuf_block_av *block_av = malloc(sizeof(struct ubuf_block_av));
+    if (unlikely(block_av == NULL)) {
+        av_buffer_unref(&buf);
+        return NULL;
+    }
+    struct ubuf *ubuf = ubuf_block_av_to_ubuf(block_av);
+    ubuf->mgr = mgr;
+    ubuf_block_common_init(ubuf, false);
+    block_av->buf = buf;
+    ubuf_mgr_use(mgr);
+    return block_av;
+}
+
+/** @This allocates a ubuf, either referencing a packet or a new buffer.
+ *
+ * @param mgr common management structure
+ * @param signature UBUF_ALLOC_BLOCK or UBUF_BLOCK_AV_ALLOC_PACKET
+ * @param args optional arguments (1st = size or AVPacket *)
+ * @return pointer to ubuf or NULL in case of allocation error
+ */
+static struct ubuf *_ubuf_block_av_alloc(struct ubuf_mgr *mgr,
+                                         uint32_t signature, va_list args)
+{
+    AVBufferRef *buf;
+    size_t offset = 0, size;
+    switch (signature) {
+        case UBUF_ALLOC_BLOCK: {
+            int alloc_size = va_arg(args, int);
+            if (unlikely(alloc_size < 0))
+                return NULL;
+            buf = av_buffer_alloc(alloc_size + AV_INPUT_BUFFER_PADDING_SIZE);
+            if (unlikely(buf == NULL))
+                return NULL;
+            size = alloc_size;
+            break;
+        }
+        case UBUF_BLOCK_AV_ALLOC_PACKET: {
+            AVPacket *pkt = va_arg(args, AVPacket *);
+            if (unlikely(pkt == NULL || pkt->buf == NULL ||
+                         pkt->data < pkt->buf->data))
+                return NULL;
+            buf = av_buffer_ref(pkt->buf);
+            if (unlikely(buf == NULL))
+                return NULL;
+            offset = pkt->data - buf->data;
+            size = pkt->size;
+            break;
+        }
+        default:
+            return NULL;
+    }
+
+    struct ubuf_block_av *block_av = ubuf_block_av_alloc_inner(mgr, buf);
+    if (unlikely(block_av == NULL))
+        return NULL;
+
+    struct ubuf *ubuf = ubuf_block_av_to_ubuf(block_av);
+    ubuf_block_common_set(ubuf, offset, size);
+    ubuf_block_common_set_buffer(ubuf, block_av->buf->data);
+    return ubuf;
+}
+
+/** @This asks for the creation of a new reference to the same buffer space.
+ *
+ * @param ubuf pointer to ubuf
+ * @param new_ubuf_p reference written with a pointer to the newly allocated
+ * ubuf
+ * @param splice true if offset and size are to be applied
+ * @param offset offset in the buffer
+ * @param size final size of the buffer
+ * @return an error code
+ */
+static int ubuf_block_av_dup(struct ubuf *ubuf, struct ubuf **new_ubuf_p,
+                             bool splice, int offset, int size)
+{
+    assert(new_ubuf_p != NULL);
+    struct ubuf_block_av *block_av = ubuf_block_av_from_ubuf(ubuf);
+    AVBufferRef *buf = av_buffer_ref(block_av->buf);
+    if (unlikely(buf == NULL))
+        return UBASE_ERR_ALLOC;
+
+    struct ubuf_block_av *new_block = ubuf_block_av_alloc_inner(ubuf->mgr,
+                                                                buf);
+    if (unlikely(new_block == NULL))
+        return UBASE_ERR_ALLOC;
+
+    struct ubuf *new_ubuf = ubuf_block_av_to_ubuf(new_block);
+    int err = splice ? ubuf_block_common_splice(ubuf, new_ubuf, offset, size) :
+                       ubuf_block_common_dup(ubuf, new_ubuf);
+    if (unlikely(!ubase_check(err))) {
+        ubuf_free(new_ubuf);
+        return UBASE_ERR_INVALID;
+    }
+    *new_ubuf_p = new_ubuf;
+    return UBASE_ERR_NONE;
+}
+
+/** @This handles control commands.
+ *
+ * @param ubuf pointer to ubuf
+ * @param command type of command to process
+ * @param args arguments of the command
+ * @return an error code
+ */
+static int ubuf_block_av_control(struct ubuf *ubuf, int command, va_list args)
+{
+    switch (command) {
+        case UBUF_DUP: {
+            struct ubuf **new_ubuf_p = va_arg(args, struct ubuf **);
+            return ubuf_block_av_dup(ubuf, new_ubuf_p, false, 0, 0);
+        }
+        case UBUF_SINGLE: {
+            struct ubuf_block_av *block_av = ubuf_block_av_from_ubuf(ubuf);
+            return av_buffer_is_writable(block_av->buf) ?
+                   UBASE_ERR_NONE : UBASE_ERR_BUSY;
+        }
+        case UBUF_SPLICE_BLOCK: {
+            struct ubuf **new_ubuf_p = va_arg(args, struct ubuf **);
+            int offset = va_arg(args, int);
+            int size = va_arg(args, int);
+            return ubuf_block_av_dup(ubuf, new_ubuf_p, true, offset, size);
+        }
+        default:
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** @This frees a ubuf.
+ *
+ * @param ubuf pointer to a ubuf structure
+ */
+static void ubuf_block_av_free(struct ubuf *ubuf)
+{
+    struct ubuf_mgr *mgr = ubuf->mgr;
+    struct ubuf_block_av *block_av = ubuf_block_av_from_ubuf(ubuf);
+
+    ubuf_block_common_clean(ubuf);
+    av_buffer_unref(&block_av->buf);
+    free(block_av);
+    ubuf_mgr_release(mgr);
+}
+
+/** @This handles manager control commands.
+ *
+ * @param mgr pointer to ubuf manager
+ * @param command type of command to process
+ * @param args arguments of the command
+ * @return an error code
+ */
+static int ubuf_block_av_mgr_control(struct ubuf_mgr *mgr,
+                                     int command, va_list args)
+{
+    switch (command) {
+        case UBUF_MGR_CHECK: {
+            struct uref *flow_format = va_arg(args, struct uref *);
+            const char *def;
+            UBASE_RETURN(uref_flow_get_def(flow_format, &def))
+            return ubase_ncmp(def, "block.") ? UBASE_ERR_INVALID :
+                                               UBASE_ERR_NONE;
+        }
+        case UBUF_MGR_VACUUM:
+            /* no pool */
+            return UBASE_ERR_NONE;
+        default:
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** @This frees a ubuf manager.
+ *
+ * @param urefcount pointer to urefcount
+ */
+static void ubuf_block_av_mgr_free(struct urefcount *urefcount)
+{
+    struct ubuf_block_av_mgr *block_av_mgr =
+        ubuf_block_av_mgr_from_urefcount(urefcount);
+    urefcount_clean(urefcount);
+    free(block_av_mgr);
+}
+
+/** @This allocates a new instance of the ubuf manager for blocks wrapping
+ * avutil buffers.
+ *
+ * @return pointer to manager, or NULL in case of error
+ */
+struct ubuf_mgr *ubuf_block_av_mgr_alloc(void)
+{
+    struct ubuf_block_av_mgr *block_av_mgr =
+        malloc(sizeof(struct ubuf_block_av_mgr));
+    if (unlikely(block_av_mgr == NULL))
+        return NULL;
+
+    urefcount_init(ubuf_block_av_mgr_to_urefcount(block_av_mgr),
+                   ubuf_block_av_mgr_free);
+    block_av_mgr->mgr.refcount =
+        ubuf_block_av_mgr_to_urefcount(block_av_mgr);
+    block_av_mgr->mgr.signature = UBUF_ALLOC_BLOCK;
+    block_av_mgr->mgr.ubuf_alloc = _ubuf_block_av_alloc;
+    block_av_mgr->mgr.ubuf_control = ubuf_block_av_control;
+    block_av_mgr->mgr.ubuf_free = ubuf_block_av_free;
+    block_av_mgr->mgr.ubuf_mgr_control = ubuf_block_av_mgr_control;
+    return ubuf_block_av_mgr_to_ubuf_mgr(block_av_mgr);
+}
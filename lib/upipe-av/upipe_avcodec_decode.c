@@ -32,6 +32,11 @@
 #include <upipe/uprobe.h>
 #include <upipe/uclock.h>
 #include <upipe/ubuf.h>
+#include <upipe/ubuf_mem.h>
+#include <upipe/ubuf_pic_mem.h>
+#include <upipe/umem.h>
+#include <upipe/umem_alloc.h>
+#include <upipe/upool.h>
 #include <upipe/uref.h>
 #include <upipe/uref_attr.h>
 #include <upipe/uref_pic.h>
@@ -71,11 +76,23 @@
 #include <libavutil/opt.h>
 #include <upipe-av/upipe_av_pixfmt.h>
 #include <upipe-av/upipe_av_samplefmt.h>
+#include <upipe-av/ubuf_av.h>
 #include "upipe_av_internal.h"
 
+#if LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(58, 18, 100)
+/** hardware decoding through a device context is available */
+#define UPIPE_AVCDEC_HW
+#include <libavutil/hwcontext.h>
+#endif
+
 #include <bitstream/dvb/sub.h>
 
 #define EXPECTED_FLOW_DEF "block."
+/** maximum depth of the picture pool */
+#define UPIPE_AVCDEC_POOL_MAX 32
+/** pictures added to the default pool depth, for the picture being output
+ * and the one being decoded */
+#define UPIPE_AVCDEC_POOL_EXTRA 2
 
 /** @hidden */
 static int upipe_avcdec_check(struct upipe *upipe, struct uref *flow_format);
@@ -168,6 +185,49 @@ struct upipe_avcdec {
     AVFrame *frame;
     /** true if the context will be closed */
     bool close;
+    /** minimum horizontal size in preview mode, or 0 */
+    uint64_t preview_hsize;
+    /** minimum vertical size in preview mode, or 0 */
+    uint64_t preview_vsize;
+    /** true if only key frames are decoded in preview mode */
+    bool preview_key_only;
+    /** decoding mode */
+    enum upipe_avcdec_mode mode;
+    /** log2 of the resolution reduction in lowres mode */
+    unsigned int mode_lowres;
+    /** true if lowres was set by the preview or decoding mode */
+    bool lowres_set;
+    /** type of hardware device, or NULL for software decoding */
+    char *hw_type;
+    /** name of the hardware device, or NULL for the default device */
+    char *hw_device;
+    /** hardware device context */
+    AVBufferRef *hw_device_ctx;
+    /** pixel format of hardware frames, or AV_PIX_FMT_NONE */
+    enum AVPixelFormat hw_pix_fmt;
+    /** ubuf manager wrapping hardware frames */
+    struct ubuf_mgr *hw_ubuf_mgr;
+    /** requested threading mode, or -1 */
+    int thread_type;
+    /** requested number of threads, or -1 */
+    int thread_count;
+
+    /** requested depth of the picture pool, or -1 for the default */
+    int pool_depth;
+    /** memory allocator of the picture pool */
+    struct umem_mgr *pool_umem_mgr;
+    /** ubuf manager recycling the frame buffers of the pool */
+    struct ubuf_mgr *pool_mgr;
+    /** ubuf manager the pool was built for */
+    struct ubuf_mgr *pool_src_mgr;
+    /** depth of the pool */
+    unsigned int pool_cur_depth;
+    /** number of frame buffers allocated by the pool */
+    uint64_t pool_misses;
+    /** horizontal size of the pictures of the pool */
+    int pool_hsize;
+    /** vertical size of the pictures of the pool */
+    int pool_vsize;
 
     /** public upipe structure */
     struct upipe upipe;
@@ -209,6 +269,257 @@ static int upipe_avcdec_check(struct upipe *upipe, struct uref *flow_format)
 
 static void upipe_av_uref_pic_free(void *opaque, uint8_t *data);
 
+/** @internal @This sets the frame rate, latency and aspect ratio attributes
+ * of a picture flow definition.
+ *
+ * @param upipe description structure of the pipe
+ * @param flow_def_attr flow definition attributes to fill in
+ * @param frame frame being decoded
+ */
+static void upipe_avcdec_set_pic_attr(struct upipe *upipe,
+                                      struct uref *flow_def_attr,
+                                      AVFrame *frame)
+{
+    struct upipe_avcdec *upipe_avcdec = upipe_avcdec_from_upipe(upipe);
+    AVCodecContext *context = upipe_avcdec->context;
+    struct urational fps;
+    if (!ubase_check(uref_pic_flow_get_fps(upipe_avcdec->flow_def_input, &fps))) {
+        fps.num = context->framerate.num;
+        fps.den = context->framerate.den;
+    }
+    if (fps.num && fps.den) {
+        urational_simplify(&fps);
+        UBASE_FATAL(upipe, uref_pic_flow_set_fps(flow_def_attr, fps))
+
+        uint64_t latency = upipe_avcdec->input_latency +
+                           context->delay * UCLOCK_FREQ * fps.den / fps.num;
+        if (context->active_thread_type == FF_THREAD_FRAME &&
+            context->thread_count != -1)
+            latency += context->thread_count * UCLOCK_FREQ * fps.den / fps.num;
+        UBASE_FATAL(upipe, uref_clock_set_latency(flow_def_attr, latency))
+    }
+    /* set aspect-ratio */
+    if (frame->sample_aspect_ratio.num) {
+        struct urational sar;
+        sar.num = frame->sample_aspect_ratio.num;
+        sar.den = frame->sample_aspect_ratio.den;
+        urational_simplify(&sar);
+        UBASE_FATAL(upipe, uref_pic_flow_set_sar(flow_def_attr, sar))
+    } else if (context->sample_aspect_ratio.num) {
+        struct urational sar = {
+            .num = context->sample_aspect_ratio.num,
+            .den = context->sample_aspect_ratio.den
+        };
+        urational_simplify(&sar);
+        UBASE_FATAL(upipe, uref_pic_flow_set_sar(flow_def_attr, sar))
+    }
+    if (upipe_avcdec->mode != UPIPE_AVCDEC_MODE_FULL)
+        UBASE_FATAL(upipe, uref_avcdec_set_mode(flow_def_attr,
+                    upipe_avcdec_mode_str(upipe_avcdec->mode)))
+}
+
+#ifdef UPIPE_AVCDEC_HW
+/** @internal @This frees the uref attached to a hardware frame.
+ *
+ * @param opaque pointer to uref
+ * @param data unused
+ */
+static void upipe_av_uref_hw_free(void *opaque, uint8_t *data)
+{
+    uref_free(opaque);
+}
+
+/** @internal @This is called by avcodec when allocating a new hardware
+ * picture. The surface is allocated by avcodec from the frames context, and
+ * the uref is only carried along to keep the input attributes.
+ *
+ * @param context current avcodec context
+ * @param frame avframe handler entering avcodec black magic box
+ * @param flags avcodec flags
+ * @return 0 on success, or a negative error code
+ */
+static int upipe_avcdec_get_buffer_hw(struct AVCodecContext *context,
+                                      AVFrame *frame, int flags)
+{
+    struct upipe *upipe = context->opaque;
+    struct upipe_avcdec *upipe_avcdec = upipe_avcdec_from_upipe(upipe);
+
+    int err = avcodec_default_get_buffer2(context, frame, flags);
+    if (unlikely(err < 0))
+        return err;
+
+    struct uref *uref = uref_dup(upipe_avcdec->uref);
+    if (unlikely(uref == NULL)) {
+        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+        return AVERROR(ENOMEM);
+    }
+    av_buffer_unref(&frame->opaque_ref);
+    frame->opaque_ref = av_buffer_create((uint8_t *)uref, sizeof(*uref),
+                                         upipe_av_uref_hw_free, uref, 0);
+    if (unlikely(frame->opaque_ref == NULL)) {
+        uref_free(uref);
+        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+        return AVERROR(ENOMEM);
+    }
+    frame->opaque = uref;
+    return 0;
+}
+
+/** @internal @This is called by avcodec to select the output pixel format.
+ * It selects the hardware format if it is offered.
+ *
+ * @param context current avcodec context
+ * @param pix_fmts formats supported by the codec, terminated by
+ * AV_PIX_FMT_NONE
+ * @return selected pixel format
+ */
+static enum AVPixelFormat upipe_avcdec_get_format(
+        struct AVCodecContext *context, const enum AVPixelFormat *pix_fmts)
+{
+    struct upipe *upipe = context->opaque;
+    struct upipe_avcdec *upipe_avcdec = upipe_avcdec_from_upipe(upipe);
+
+    for (const enum AVPixelFormat *p = pix_fmts; *p != AV_PIX_FMT_NONE; p++)
+        if (*p == upipe_avcdec->hw_pix_fmt)
+            return *p;
+
+    upipe_warn(upipe, "hardware format not offered, decoding in software");
+    return avcodec_default_get_format(context, pix_fmts);
+}
+#endif
+
+/** @internal @This releases the picture pool. Pictures still in use keep
+ * their manager alive until they are freed.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_avcdec_flush_pool(struct upipe *upipe)
+{
+    struct upipe_avcdec *upipe_avcdec = upipe_avcdec_from_upipe(upipe);
+    ubuf_mgr_release(upipe_avcdec->pool_mgr);
+    ubuf_mgr_release(upipe_avcdec->pool_src_mgr);
+    upipe_avcdec->pool_mgr = NULL;
+    upipe_avcdec->pool_src_mgr = NULL;
+}
+
+/** @internal @This returns the depth of the picture pool.
+ *
+ * @param upipe description structure of the pipe
+ * @return depth of the pool
+ */
+static unsigned int upipe_avcdec_pool_depth(struct upipe *upipe)
+{
+    struct upipe_avcdec *upipe_avcdec = upipe_avcdec_from_upipe(upipe);
+    AVCodecContext *context = upipe_avcdec->context;
+    /* the pool needs avcodec to decode into our buffers */
+    if (!(context->codec->capabilities & AV_CODEC_CAP_DR1))
+        return 0;
+
+    unsigned int depth;
+    if (upipe_avcdec->pool_depth >= 0)
+        depth = upipe_avcdec->pool_depth;
+    else
+        depth = (context->refs > 0 ? context->refs : 1) +
+                (context->thread_count > 1 ? context->thread_count : 1) +
+                UPIPE_AVCDEC_POOL_EXTRA;
+    return depth < UPIPE_AVCDEC_POOL_MAX ? depth : UPIPE_AVCDEC_POOL_MAX;
+}
+
+/** @internal @This creates the picture pool, that is a ubuf manager built
+ * from the provided flow format with a frame pool dedicated to pictures of
+ * the given size. On failure the pipe falls back to the ubuf manager
+ * provided downstream.
+ *
+ * @param upipe description structure of the pipe
+ * @param hsize horizontal size of the pictures
+ * @param vsize vertical size of the pictures
+ * @param depth depth of the pool
+ */
+static void upipe_avcdec_init_pool(struct upipe *upipe,
+                                   int hsize, int vsize, unsigned int depth)
+{
+    struct upipe_avcdec *upipe_avcdec = upipe_avcdec_from_upipe(upipe);
+    if (upipe_avcdec->pool_umem_mgr == NULL) {
+        upipe_avcdec->pool_umem_mgr = umem_alloc_mgr_alloc();
+        if (unlikely(upipe_avcdec->pool_umem_mgr == NULL))
+            return;
+    }
+
+    struct ubuf_mgr *mgr =
+        ubuf_mem_mgr_alloc_from_flow_def(depth, depth,
+                                         upipe_avcdec->pool_umem_mgr,
+                                         upipe_avcdec->flow_def_provided);
+    if (unlikely(mgr == NULL))
+        return;
+    if (unlikely(!ubase_check(ubuf_pic_mem_mgr_add_frame_pool(mgr,
+                        hsize, vsize, depth, 0)))) {
+        upipe_warn(upipe, "unable to create the picture pool");
+        ubuf_mgr_release(mgr);
+        return;
+    }
+    ubuf_mgr_set_stats(mgr, true);
+
+    upipe_avcdec->pool_mgr = mgr;
+    upipe_avcdec->pool_src_mgr = ubuf_mgr_use(upipe_avcdec->ubuf_mgr);
+    upipe_avcdec->pool_cur_depth = depth;
+    upipe_avcdec->pool_misses = 0;
+    upipe_avcdec->pool_hsize = hsize;
+    upipe_avcdec->pool_vsize = vsize;
+}
+
+/** @internal @This allocates a picture for avcodec, recycling the frame
+ * buffers of the pool if possible. The picture is exclusively owned by the
+ * caller; its frame buffer returns to the pool when it is freed.
+ *
+ * @param upipe description structure of the pipe
+ * @param hsize horizontal size of the picture
+ * @param vsize vertical size of the picture
+ * @return pointer to ubuf, or NULL in case of allocation error
+ */
+static struct ubuf *upipe_avcdec_alloc_pic(struct upipe *upipe,
+                                           int hsize, int vsize)
+{
+    struct upipe_avcdec *upipe_avcdec = upipe_avcdec_from_upipe(upipe);
+    unsigned int depth = upipe_avcdec_pool_depth(upipe);
+
+    if (upipe_avcdec->pool_mgr != NULL &&
+        (upipe_avcdec->pool_src_mgr != upipe_avcdec->ubuf_mgr ||
+         upipe_avcdec->pool_cur_depth != depth ||
+         upipe_avcdec->pool_hsize != hsize ||
+         upipe_avcdec->pool_vsize != vsize))
+        upipe_avcdec_flush_pool(upipe);
+    if (upipe_avcdec->pool_mgr == NULL && depth)
+        upipe_avcdec_init_pool(upipe, hsize, vsize, depth);
+
+    if (upipe_avcdec->pool_mgr == NULL) {
+        struct ubuf *ubuf = ubuf_pic_alloc(upipe_avcdec->ubuf_mgr,
+                                           hsize, vsize);
+        if (likely(ubuf != NULL))
+            ubuf_pic_clear(ubuf, 0, 0, -1, -1, 0);
+        return ubuf;
+    }
+
+    struct ubuf *ubuf = ubuf_pic_alloc(upipe_avcdec->pool_mgr, hsize, vsize);
+    if (unlikely(ubuf == NULL))
+        return NULL;
+
+    /* the pool starts empty, so the first misses fill it and every later
+     * miss means that all the frame buffers were in use */
+    struct upool_stats stats;
+    if (ubase_check(ubuf_pic_mem_mgr_get_frame_stats(upipe_avcdec->pool_mgr,
+                                                     &stats)) &&
+        stats.misses > upipe_avcdec->pool_misses) {
+        upipe_avcdec->pool_misses = stats.misses;
+        ubuf_pic_clear(ubuf, 0, 0, -1, -1, 0);
+        if (stats.misses > depth) {
+            upipe_verbose_va(upipe, "picture pool exhausted (%u)", depth);
+            upipe_throw(upipe, UPROBE_AVCDEC_POOL_MISS,
+                        UPIPE_AVCDEC_SIGNATURE, depth);
+        }
+    }
+    return ubuf;
+}
+
 /* Documentation from libavcodec.h (get_buffer) :
  * The function will set AVFrame.data[], AVFrame.linesize[].
  * AVFrame.extended_data[] must also be set, but it should be the same as
@@ -250,6 +561,12 @@ static int upipe_avcdec_get_buffer_pic(struct AVCodecContext *context,
         return -1;
     }
 
+#ifdef UPIPE_AVCDEC_HW
+    if (upipe_avcdec->hw_pix_fmt != AV_PIX_FMT_NONE &&
+        frame->format == upipe_avcdec->hw_pix_fmt)
+        return upipe_avcdec_get_buffer_hw(context, frame, flags);
+#endif
+
     struct uref *uref = uref_dup(upipe_avcdec->uref);
     frame->opaque = uref;
 
@@ -299,37 +616,7 @@ static int upipe_avcdec_get_buffer_pic(struct AVCodecContext *context,
     UBASE_FATAL(upipe, uref_pic_flow_set_vsize(flow_def_attr, context->height))
     UBASE_FATAL(upipe, uref_pic_flow_set_hsize_visible(flow_def_attr, context->width))
     UBASE_FATAL(upipe, uref_pic_flow_set_vsize_visible(flow_def_attr, context->height))
-    struct urational fps;
-    if (!ubase_check(uref_pic_flow_get_fps(upipe_avcdec->flow_def_input, &fps))) {
-        fps.num = context->framerate.num;
-        fps.den = context->framerate.den;
-    }
-    if (fps.num && fps.den) {
-        urational_simplify(&fps);
-        UBASE_FATAL(upipe, uref_pic_flow_set_fps(flow_def_attr, fps))
-
-        uint64_t latency = upipe_avcdec->input_latency +
-                           context->delay * UCLOCK_FREQ * fps.den / fps.num;
-        if (context->active_thread_type == FF_THREAD_FRAME &&
-            context->thread_count != -1)
-            latency += context->thread_count * UCLOCK_FREQ * fps.den / fps.num;
-        UBASE_FATAL(upipe, uref_clock_set_latency(flow_def_attr, latency))
-    }
-    /* set aspect-ratio */
-    if (frame->sample_aspect_ratio.num) {
-        struct urational sar;
-        sar.num = frame->sample_aspect_ratio.num;
-        sar.den = frame->sample_aspect_ratio.den;
-        urational_simplify(&sar);
-        UBASE_FATAL(upipe, uref_pic_flow_set_sar(flow_def_attr, sar))
-    } else if (context->sample_aspect_ratio.num) {
-        struct urational sar = {
-            .num = context->sample_aspect_ratio.num,
-            .den = context->sample_aspect_ratio.den
-        };
-        urational_simplify(&sar);
-        UBASE_FATAL(upipe, uref_pic_flow_set_sar(flow_def_attr, sar))
-    }
+    upipe_avcdec_set_pic_attr(upipe, flow_def_attr, frame);
 
     if (unlikely(upipe_avcdec->ubuf_mgr != NULL &&
                  udict_cmp(upipe_avcdec->flow_def_format->udict,
@@ -351,12 +638,11 @@ static int upipe_avcdec_get_buffer_pic(struct AVCodecContext *context,
     flow_def_attr = uref_dup(upipe_avcdec->flow_def_provided);
 
     /* Allocate a ubuf */
-    struct ubuf *ubuf = ubuf_pic_alloc(upipe_avcdec->ubuf_mgr,
-                                       width_aligned, height_aligned);
+    struct ubuf *ubuf = upipe_avcdec_alloc_pic(upipe, width_aligned,
+                                               height_aligned);
     if (unlikely(ubuf == NULL))
         goto error;
 
-    ubuf_pic_clear(ubuf, 0, 0, -1, -1, 0);
     uref_attach_ubuf(uref, ubuf);
 
     /* Chain the new flow def attributes to the uref so we can apply them
@@ -384,7 +670,7 @@ static int upipe_avcdec_get_buffer_pic(struct AVCodecContext *context,
         uint8_t vsub = 1;
         if (unlikely(!ubase_check(uref_pic_flow_get_chroma(flow_def_attr, &chroma, plane)) ||
                      !ubase_check(ubuf_pic_plane_write(ubuf, chroma, 0, 0, -1, -1,
-                                           &frame->data[plane])) ||
+                                                       &frame->data[plane])) ||
                      !ubase_check(ubuf_pic_plane_size(ubuf, chroma, &stride, NULL, &vsub,
                                           NULL)))) {
             // XXX: missing unmap and release av_buffer for previous planes
@@ -577,6 +863,136 @@ static void upipe_avcdec_abort_av_deal(struct upipe *upipe)
     }
 }
 
+/** @internal @This applies the preview settings and the decoding mode to
+ * the avcodec context.
+ *
+ * @param upipe description structure of the pipe
+ * @param open true if the codec is about to be opened
+ */
+static void upipe_avcdec_apply_preview(struct upipe *upipe, bool open)
+{
+    struct upipe_avcdec *upipe_avcdec = upipe_avcdec_from_upipe(upipe);
+    AVCodecContext *context = upipe_avcdec->context;
+    bool preview = upipe_avcdec->preview_hsize || upipe_avcdec->preview_vsize;
+    enum upipe_avcdec_mode mode = upipe_avcdec->mode;
+    if (open && !preview && mode == UPIPE_AVCDEC_MODE_FULL &&
+        !upipe_avcdec->lowres_set)
+        /* keep the options which may have been set */
+        return;
+
+    context->skip_loop_filter = preview || mode != UPIPE_AVCDEC_MODE_FULL ?
+                                AVDISCARD_ALL : AVDISCARD_DEFAULT;
+    if (mode == UPIPE_AVCDEC_MODE_KEY_ONLY ||
+        (preview && upipe_avcdec->preview_key_only))
+        context->skip_frame = AVDISCARD_NONKEY;
+    else if (mode == UPIPE_AVCDEC_MODE_NONREF)
+        context->skip_frame = AVDISCARD_NONREF;
+    else
+        context->skip_frame = AVDISCARD_DEFAULT;
+    if (!open)
+        return;
+
+    /* reset the reduction of a previous opening */
+    if (upipe_avcdec->lowres_set)
+        context->lowres = 0;
+    upipe_avcdec->lowres_set = false;
+
+    int max_lowres = av_codec_get_max_lowres(context->codec);
+    if (mode == UPIPE_AVCDEC_MODE_LOWRES) {
+        int lowres = (int)upipe_avcdec->mode_lowres < max_lowres ?
+                     (int)upipe_avcdec->mode_lowres : max_lowres;
+        if (lowres)
+            upipe_dbg_va(upipe, "decoding at 1/%d", 1 << lowres);
+        context->lowres = lowres;
+        upipe_avcdec->lowres_set = true;
+        return;
+    }
+    if (!preview)
+        return;
+
+    /* the largest reduction which keeps the requested size */
+    uint64_t hsize, vsize;
+    if (!ubase_check(uref_pic_flow_get_hsize(upipe_avcdec->flow_def_input,
+                                             &hsize)) ||
+        !ubase_check(uref_pic_flow_get_vsize(upipe_avcdec->flow_def_input,
+                                             &vsize))) {
+        upipe_dbg(upipe, "unknown picture size, decoding at full resolution");
+        return;
+    }
+    upipe_avcdec->lowres_set = true;
+    int lowres = 0;
+    while (lowres < max_lowres &&
+           (hsize >> (lowres + 1)) >= upipe_avcdec->preview_hsize &&
+           (vsize >> (lowres + 1)) >= upipe_avcdec->preview_vsize)
+        lowres++;
+    if (lowres)
+        upipe_dbg_va(upipe, "decoding %"PRIu64"x%"PRIu64" pictures at 1/%d",
+                     hsize, vsize, 1 << lowres);
+    context->lowres = lowres;
+}
+
+/** @internal @This sets up hardware decoding before opening the codec. On
+ * failure the codec is opened for software decoding.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_avcdec_apply_hw_config(struct upipe *upipe)
+{
+    struct upipe_avcdec *upipe_avcdec = upipe_avcdec_from_upipe(upipe);
+    upipe_avcdec->hw_pix_fmt = AV_PIX_FMT_NONE;
+    if (upipe_avcdec->hw_type == NULL)
+        return;
+
+#ifdef UPIPE_AVCDEC_HW
+    AVCodecContext *context = upipe_avcdec->context;
+    enum AVHWDeviceType type =
+        av_hwdevice_find_type_by_name(upipe_avcdec->hw_type);
+    if (type == AV_HWDEVICE_TYPE_NONE) {
+        upipe_warn_va(upipe, "unknown hardware device type %s",
+                      upipe_avcdec->hw_type);
+        return;
+    }
+
+    enum AVPixelFormat hw_pix_fmt = AV_PIX_FMT_NONE;
+    for (int i = 0; hw_pix_fmt == AV_PIX_FMT_NONE; i++) {
+        const AVCodecHWConfig *config =
+            avcodec_get_hw_config(context->codec, i);
+        if (config == NULL) {
+            upipe_warn_va(upipe, "codec %s doesn't support %s decoding",
+                          context->codec->name, upipe_avcdec->hw_type);
+            return;
+        }
+        if (config->methods & AV_CODEC_HW_CONFIG_METHOD_HW_DEVICE_CTX &&
+            config->device_type == type)
+            hw_pix_fmt = config->pix_fmt;
+    }
+
+    if (upipe_avcdec->hw_device_ctx == NULL) {
+        int err = av_hwdevice_ctx_create(&upipe_avcdec->hw_device_ctx, type,
+                                         upipe_avcdec->hw_device, NULL, 0);
+        if (unlikely(err < 0)) {
+            upipe_av_strerror(err, buf);
+            upipe_warn_va(upipe, "could not open %s device (%s)",
+                          upipe_avcdec->hw_type, buf);
+            return;
+        }
+    }
+
+    av_buffer_unref(&context->hw_device_ctx);
+    context->hw_device_ctx = av_buffer_ref(upipe_avcdec->hw_device_ctx);
+    if (unlikely(context->hw_device_ctx == NULL)) {
+        upipe_warn(upipe, "could not reference hardware device");
+        return;
+    }
+    context->get_format = upipe_avcdec_get_format;
+    upipe_avcdec->hw_pix_fmt = hw_pix_fmt;
+    upipe_notice_va(upipe, "using %s hardware decoding",
+                    upipe_avcdec->hw_type);
+#else
+    upipe_warn(upipe, "hardware decoding is not supported by libavcodec");
+#endif
+}
+
 /** @internal @This actually calls avcodec_open(). It may only be called by
  * one thread at a time.
  *
@@ -603,6 +1019,8 @@ static bool upipe_avcdec_do_av_deal(struct upipe *upipe)
             break;
         case AVMEDIA_TYPE_VIDEO:
             context->get_buffer2 = upipe_avcdec_get_buffer_pic;
+            upipe_avcdec_apply_preview(upipe, true);
+            upipe_avcdec_apply_hw_config(upipe);
 
 #if LIBAVCODEC_VERSION_INT < AV_VERSION_INT(55, 48, 102)
             /* otherwise we need specific prepend/append/align */
@@ -621,6 +1039,15 @@ static bool upipe_avcdec_do_av_deal(struct upipe *upipe)
             return false;
     }
 
+    if (upipe_avcdec->thread_type >= 0)
+        context->thread_type =
+            (upipe_avcdec->thread_type & UPIPE_AVCDEC_THREAD_FRAME ?
+             FF_THREAD_FRAME : 0) |
+            (upipe_avcdec->thread_type & UPIPE_AVCDEC_THREAD_SLICE ?
+             FF_THREAD_SLICE : 0);
+    if (upipe_avcdec->thread_count >= 0)
+        context->thread_count = upipe_avcdec->thread_count;
+
     /* open new context */
     int err;
     if (unlikely((err = avcodec_open2(context, context->codec, NULL)) < 0)) {
@@ -1000,6 +1427,143 @@ alloc_error:
     return;
 }
 
+/** @internal @This sets the picture attributes and outputs a decoded
+ * picture.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref uref carrying the picture
+ * @param flow_def_attr flow definition attributes of the picture (not
+ * released)
+ * @param upump_p reference to upump structure
+ */
+static void upipe_avcdec_output_pic_attrs(struct upipe *upipe,
+                                          struct uref *uref,
+                                          struct uref *flow_def_attr,
+                                          struct upump **upump_p)
+{
+    struct upipe_avcdec *upipe_avcdec = upipe_avcdec_from_upipe(upipe);
+    AVCodecContext *context = upipe_avcdec->context;
+    AVFrame *frame = upipe_avcdec->frame;
+    AVFrameSideData *side_data;
+
+    UBASE_FATAL(upipe, uref_pic_set_tf(uref))
+    UBASE_FATAL(upipe, uref_pic_set_bf(uref))
+    if (!frame->interlaced_frame)
+        UBASE_FATAL(upipe, uref_pic_set_progressive(uref))
+    else if (frame->top_field_first)
+        UBASE_FATAL(upipe, uref_pic_set_tff(uref))
+
+    if (context->time_base.den)
+        UBASE_FATAL(upipe, uref_clock_set_duration(uref,
+                (uint64_t)(2 + frame->repeat_pict) * context->ticks_per_frame *
+                UCLOCK_FREQ * context->time_base.num /
+                (2 * context->time_base.den)))
+
+    if (frame->key_frame)
+        uref_pic_set_key(uref);
+
+    side_data = av_frame_get_side_data(frame, AV_FRAME_DATA_AFD);
+    if (side_data && side_data->size == 1)
+        uref_pic_set_afd(uref, side_data->data[0]);
+
+    side_data = av_frame_get_side_data(frame, AV_FRAME_DATA_A53_CC);
+    if (side_data)
+        uref_pic_set_cea_708(uref, side_data->data, side_data->size);
+
+    /* various time-related attributes */
+    upipe_avcdec_set_time_attributes(upipe, uref);
+
+    uref_h26x_delete_nal_offsets(uref);
+
+    /* Find out if flow def attributes have changed. */
+    if (!upipe_avcdec_check_flow_def_attr(upipe, flow_def_attr)) {
+        /* Make a copy as flow_def_attr is still used by the caller. */
+        flow_def_attr = uref_dup(flow_def_attr);
+        if (unlikely(flow_def_attr == NULL)) {
+            uref_free(uref);
+            upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+            return;
+        }
+        struct uref *flow_def =
+            upipe_avcdec_store_flow_def_attr(upipe, flow_def_attr);
+        if (flow_def != NULL) {
+            uref_block_flow_clear_format(flow_def);
+            uref_flow_delete_headers(flow_def);
+            upipe_avcdec_store_flow_def(upipe, flow_def);
+        }
+    }
+
+    upipe_avcdec_output(upipe, uref, upump_p);
+}
+
+#ifdef UPIPE_AVCDEC_HW
+/** @internal @This outputs video frames decoded in hardware memory, without
+ * copying them.
+ *
+ * @param upipe description structure of the pipe
+ * @param upump_p reference to upump structure
+ */
+static void upipe_avcdec_output_pic_hw(struct upipe *upipe,
+                                       struct upump **upump_p)
+{
+    struct upipe_avcdec *upipe_avcdec = upipe_avcdec_from_upipe(upipe);
+    AVFrame *frame = upipe_avcdec->frame;
+    AVHWFramesContext *frames_ctx =
+        (AVHWFramesContext *)frame->hw_frames_ctx->data;
+
+    struct uref *flow_def_attr = upipe_avcdec_alloc_flow_def_attr(upipe);
+    if (unlikely(flow_def_attr == NULL)) {
+        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+        return;
+    }
+    if (unlikely(!ubase_check(upipe_av_pixfmt_to_flow_def(
+                        frames_ctx->sw_format, flow_def_attr)))) {
+        uref_free(flow_def_attr);
+        upipe_err_va(upipe, "unhandled hardware pixel format %d",
+                     frames_ctx->sw_format);
+        upipe_throw_fatal(upipe, UBASE_ERR_INVALID);
+        return;
+    }
+    UBASE_FATAL(upipe, uref_pic_flow_set_hsize(flow_def_attr, frame->width))
+    UBASE_FATAL(upipe, uref_pic_flow_set_vsize(flow_def_attr, frame->height))
+    UBASE_FATAL(upipe, uref_pic_flow_set_hsize_visible(flow_def_attr,
+                                                       frame->width))
+    UBASE_FATAL(upipe, uref_pic_flow_set_vsize_visible(flow_def_attr,
+                                                       frame->height))
+    upipe_avcdec_set_pic_attr(upipe, flow_def_attr, frame);
+
+    if (upipe_avcdec->hw_ubuf_mgr != NULL &&
+        !ubase_check(ubuf_mgr_check(upipe_avcdec->hw_ubuf_mgr,
+                                    flow_def_attr))) {
+        ubuf_mgr_release(upipe_avcdec->hw_ubuf_mgr);
+        upipe_avcdec->hw_ubuf_mgr = NULL;
+    }
+    if (upipe_avcdec->hw_ubuf_mgr == NULL) {
+        upipe_avcdec->hw_ubuf_mgr = ubuf_av_mgr_alloc(flow_def_attr);
+        if (unlikely(upipe_avcdec->hw_ubuf_mgr == NULL)) {
+            uref_free(flow_def_attr);
+            upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+            return;
+        }
+    }
+
+    struct ubuf *ubuf = ubuf_pic_av_alloc(upipe_avcdec->hw_ubuf_mgr, frame);
+    struct uref *uref = uref_dup(frame->opaque);
+    if (unlikely(ubuf == NULL || uref == NULL)) {
+        if (ubuf != NULL)
+            ubuf_free(ubuf);
+        uref_free(uref);
+        uref_free(flow_def_attr);
+        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+        return;
+    }
+    uref_attach_ubuf(uref, ubuf);
+
+    upipe_avcdec_output_pic_attrs(upipe, uref, flow_def_attr, upump_p);
+    uref_free(flow_def_attr);
+}
+#endif
+
 /** @internal @This outputs video frames.
  *
  * @param upipe description structure of the pipe
@@ -1010,7 +1574,12 @@ static void upipe_avcdec_output_pic(struct upipe *upipe, struct upump **upump_p)
     struct upipe_avcdec *upipe_avcdec = upipe_avcdec_from_upipe(upipe);
     AVCodecContext *context = upipe_avcdec->context;
     AVFrame *frame = upipe_avcdec->frame;
-    AVFrameSideData *side_data;
+#ifdef UPIPE_AVCDEC_HW
+    if (frame->hw_frames_ctx != NULL) {
+        upipe_avcdec_output_pic_hw(upipe, upump_p);
+        return;
+    }
+#endif
     struct uref *uref = frame->opaque;
     struct uref *flow_def_attr = uref_from_uchain(uref->uchain.next);
 
@@ -1070,54 +1639,7 @@ static void upipe_avcdec_output_pic(struct upipe *upipe, struct upump **upump_p)
         }
     }
 
-    UBASE_FATAL(upipe, uref_pic_set_tf(uref))
-    UBASE_FATAL(upipe, uref_pic_set_bf(uref))
-    if (!frame->interlaced_frame)
-        UBASE_FATAL(upipe, uref_pic_set_progressive(uref))
-    else if (frame->top_field_first)
-        UBASE_FATAL(upipe, uref_pic_set_tff(uref))
-
-    if (context->time_base.den)
-        UBASE_FATAL(upipe, uref_clock_set_duration(uref,
-                (uint64_t)(2 + frame->repeat_pict) * context->ticks_per_frame *
-                UCLOCK_FREQ * context->time_base.num /
-                (2 * context->time_base.den)))
-
-    if (frame->key_frame)
-        uref_pic_set_key(uref);
-
-    side_data = av_frame_get_side_data(frame, AV_FRAME_DATA_AFD);
-    if (side_data && side_data->size == 1)
-        uref_pic_set_afd(uref, side_data->data[0]);
-
-    side_data = av_frame_get_side_data(frame, AV_FRAME_DATA_A53_CC);
-    if (side_data)
-        uref_pic_set_cea_708(uref, side_data->data, side_data->size);
-
-    /* various time-related attributes */
-    upipe_avcdec_set_time_attributes(upipe, uref);
-
-    uref_h26x_delete_nal_offsets(uref);
-
-    /* Find out if flow def attributes have changed. */
-    if (!upipe_avcdec_check_flow_def_attr(upipe, flow_def_attr)) {
-        /* Make a copy as flow_def_attr is still used by _release. */
-        flow_def_attr = uref_dup(flow_def_attr);
-        if (unlikely(flow_def_attr == NULL)) {
-            uref_free(uref);
-            upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
-            return;
-        }
-        struct uref *flow_def =
-            upipe_avcdec_store_flow_def_attr(upipe, flow_def_attr);
-        if (flow_def != NULL) {
-            uref_block_flow_clear_format(flow_def);
-            uref_flow_delete_headers(flow_def);
-            upipe_avcdec_store_flow_def(upipe, flow_def);
-        }
-    }
-
-    upipe_avcdec_output(upipe, uref, upump_p);
+    upipe_avcdec_output_pic_attrs(upipe, uref, flow_def_attr, upump_p);
 }
 
 /** @internal @This outputs audio buffers.
@@ -1534,6 +2056,83 @@ static int upipe_avcdec_set_option(struct upipe *upipe,
     return UBASE_ERR_NONE;
 }
 
+/** @internal @This sets the preview mode.
+ *
+ * @param upipe description structure of the pipe
+ * @param hsize minimum horizontal size of the output pictures
+ * @param vsize minimum vertical size of the output pictures
+ * @param key_only true to only decode key frames
+ * @return an error code
+ */
+static int _upipe_avcdec_set_preview(struct upipe *upipe,
+                                     uint64_t hsize, uint64_t vsize,
+                                     bool key_only)
+{
+    struct upipe_avcdec *upipe_avcdec = upipe_avcdec_from_upipe(upipe);
+    upipe_avcdec->preview_hsize = hsize;
+    upipe_avcdec->preview_vsize = vsize;
+    upipe_avcdec->preview_key_only = key_only;
+    if (upipe_avcdec->context != NULL)
+        upipe_avcdec_apply_preview(upipe, false);
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This sets the decoding mode.
+ *
+ * @param upipe description structure of the pipe
+ * @param mode decoding mode
+ * @param lowres log2 of the resolution reduction in lowres mode
+ * @return an error code
+ */
+static int _upipe_avcdec_set_mode(struct upipe *upipe,
+                                  enum upipe_avcdec_mode mode,
+                                  unsigned int lowres)
+{
+    struct upipe_avcdec *upipe_avcdec = upipe_avcdec_from_upipe(upipe);
+    const char *str = upipe_avcdec_mode_str(mode);
+    if (unlikely(str == NULL))
+        return UBASE_ERR_INVALID;
+    if (mode == upipe_avcdec->mode && lowres == upipe_avcdec->mode_lowres)
+        return UBASE_ERR_NONE;
+
+    upipe_dbg_va(upipe, "switching to %s", str);
+    upipe_avcdec->mode = mode;
+    upipe_avcdec->mode_lowres = lowres;
+    if (upipe_avcdec->context != NULL)
+        upipe_avcdec_apply_preview(upipe, false);
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This sets the hardware acceleration.
+ *
+ * @param upipe description structure of the pipe
+ * @param hw_type type of hardware device, or NULL
+ * @param hw_device name of the device, or NULL for the default device
+ * @return an error code
+ */
+static int _upipe_avcdec_set_hw_config(struct upipe *upipe,
+                                       const char *hw_type,
+                                       const char *hw_device)
+{
+    struct upipe_avcdec *upipe_avcdec = upipe_avcdec_from_upipe(upipe);
+    free(upipe_avcdec->hw_type);
+    free(upipe_avcdec->hw_device);
+    upipe_avcdec->hw_type = upipe_avcdec->hw_device = NULL;
+    av_buffer_unref(&upipe_avcdec->hw_device_ctx);
+    if (hw_type == NULL)
+        return UBASE_ERR_NONE;
+
+    upipe_avcdec->hw_type = strdup(hw_type);
+    if (unlikely(upipe_avcdec->hw_type == NULL))
+        return UBASE_ERR_ALLOC;
+    if (hw_device != NULL) {
+        upipe_avcdec->hw_device = strdup(hw_device);
+        if (unlikely(upipe_avcdec->hw_device == NULL))
+            return UBASE_ERR_ALLOC;
+    }
+    return UBASE_ERR_NONE;
+}
+
 /** @internal @This processes control commands on a file source pipe, and
  * checks the status of the pipe afterwards.
  *
@@ -1579,6 +2178,46 @@ static int upipe_avcdec_control(struct upipe *upipe, int command, va_list args)
             return upipe_avcdec_set_option(upipe, option, content);
         }
 
+        case UPIPE_AVCDEC_SET_PREVIEW: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_AVCDEC_SIGNATURE)
+            uint64_t hsize = va_arg(args, uint64_t);
+            uint64_t vsize = va_arg(args, uint64_t);
+            bool key_only = !!va_arg(args, int);
+            return _upipe_avcdec_set_preview(upipe, hsize, vsize, key_only);
+        }
+        case UPIPE_AVCDEC_SET_THREADS: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_AVCDEC_SIGNATURE)
+            struct upipe_avcdec *upipe_avcdec = upipe_avcdec_from_upipe(upipe);
+            upipe_avcdec->thread_type = va_arg(args, int);
+            upipe_avcdec->thread_count = va_arg(args, int);
+            return UBASE_ERR_NONE;
+        }
+        case UPIPE_AVCDEC_SET_POOL_DEPTH: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_AVCDEC_SIGNATURE)
+            struct upipe_avcdec *upipe_avcdec = upipe_avcdec_from_upipe(upipe);
+            upipe_avcdec->pool_depth = va_arg(args, int);
+            return UBASE_ERR_NONE;
+        }
+        case UPIPE_AVCDEC_SET_MODE: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_AVCDEC_SIGNATURE)
+            enum upipe_avcdec_mode mode = va_arg(args, int);
+            unsigned int lowres = va_arg(args, unsigned int);
+            return _upipe_avcdec_set_mode(upipe, mode, lowres);
+        }
+        case UPIPE_AVCDEC_GET_MODE: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_AVCDEC_SIGNATURE)
+            struct upipe_avcdec *upipe_avcdec = upipe_avcdec_from_upipe(upipe);
+            int *mode_p = va_arg(args, int *);
+            *mode_p = upipe_avcdec->mode;
+            return UBASE_ERR_NONE;
+        }
+        case UPIPE_AVCDEC_SET_HW_CONFIG: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_AVCDEC_SIGNATURE)
+            const char *hw_type = va_arg(args, const char *);
+            const char *hw_device = va_arg(args, const char *);
+            return _upipe_avcdec_set_hw_config(upipe, hw_type, hw_device);
+        }
+
         default:
             return UBASE_ERR_UNHANDLED;
     }
@@ -1594,9 +2233,17 @@ static void upipe_avcdec_free(struct upipe *upipe)
 
     if (upipe_avcdec->context != NULL) {
         free(upipe_avcdec->context->extradata);
+        av_buffer_unref(&upipe_avcdec->context->hw_device_ctx);
         av_free(upipe_avcdec->context);
     }
     av_frame_free(&upipe_avcdec->frame);
+    av_buffer_unref(&upipe_avcdec->hw_device_ctx);
+    free(upipe_avcdec->hw_type);
+    free(upipe_avcdec->hw_device);
+    if (upipe_avcdec->hw_ubuf_mgr != NULL)
+        ubuf_mgr_release(upipe_avcdec->hw_ubuf_mgr);
+    upipe_avcdec_flush_pool(upipe);
+    umem_mgr_release(upipe_avcdec->pool_umem_mgr);
 
     upipe_throw_dead(upipe);
     uref_free(upipe_avcdec->uref);
@@ -1649,6 +2296,22 @@ static struct upipe *upipe_avcdec_alloc(struct upipe_mgr *mgr,
     upipe_avcdec->frame = frame;
     upipe_avcdec->counter = 0;
     upipe_avcdec->close = false;
+    upipe_avcdec->preview_hsize = upipe_avcdec->preview_vsize = 0;
+    upipe_avcdec->preview_key_only = false;
+    upipe_avcdec->mode = UPIPE_AVCDEC_MODE_FULL;
+    upipe_avcdec->mode_lowres = 0;
+    upipe_avcdec->lowres_set = false;
+    upipe_avcdec->hw_type = upipe_avcdec->hw_device = NULL;
+    upipe_avcdec->hw_device_ctx = NULL;
+    upipe_avcdec->hw_pix_fmt = AV_PIX_FMT_NONE;
+    upipe_avcdec->hw_ubuf_mgr = NULL;
+    upipe_avcdec->thread_type = upipe_avcdec->thread_count = -1;
+    upipe_avcdec->pool_depth = -1;
+    upipe_avcdec->pool_umem_mgr = NULL;
+    upipe_avcdec->pool_mgr = upipe_avcdec->pool_src_mgr = NULL;
+    upipe_avcdec->pool_cur_depth = 0;
+    upipe_avcdec->pool_misses = 0;
+    upipe_avcdec->pool_hsize = upipe_avcdec->pool_vsize = 0;
     upipe_avcdec->pix_fmt = AV_PIX_FMT_NONE;
     upipe_avcdec->sample_fmt = AV_SAMPLE_FMT_NONE;
     upipe_avcdec->channels = 0;
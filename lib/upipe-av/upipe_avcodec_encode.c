@@ -74,8 +74,15 @@
 #include <libavutil/opt.h>
 #include <upipe-av/upipe_av_pixfmt.h>
 #include <upipe-av/upipe_av_samplefmt.h>
+#include <upipe-av/ubuf_av.h>
 #include "upipe_av_internal.h"
 
+#if LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(58, 18, 100)
+/** hardware frames may be encoded through a frames context */
+#define UPIPE_AVCENC_HW
+#include <libavutil/hwcontext.h>
+#endif
+
 #define PREFIX_FLOW "block."
 
 UREF_ATTR_INT(avcenc, priv, "x.avcenc_priv", avcenc private pts)
@@ -177,6 +184,8 @@ struct upipe_avcenc {
     AVCodecContext *context;
     /** avcodec frame */
     AVFrame *frame;
+    /** true if the encoder is fed with hardware frames */
+    bool hw;
     /** true if the context will be closed */
     bool close;
 
@@ -622,6 +631,75 @@ static bool upipe_avcenc_encode_frame(struct upipe *upipe,
     return true;
 }
 
+/** @internal @This returns the first hardware pixel format supported by a
+ * codec.
+ *
+ * @param codec avcodec description structure
+ * @return a hardware pixel format, or AV_PIX_FMT_NONE
+ */
+static enum AVPixelFormat upipe_avcenc_hw_pix_fmt(const AVCodec *codec)
+{
+#ifdef UPIPE_AVCENC_HW
+    for (const enum AVPixelFormat *p = codec->pix_fmts;
+         p != NULL && *p != AV_PIX_FMT_NONE; p++) {
+        const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(*p);
+        if (desc != NULL && desc->flags & AV_PIX_FMT_FLAG_HWACCEL)
+            return *p;
+    }
+#endif
+    return AV_PIX_FMT_NONE;
+}
+
+/** @internal @This sets up the encoder for hardware frames if the first
+ * picture is a hardware surface (allocated by a hardware decoder) in a format
+ * supported by the encoder. Otherwise the pictures are read from system
+ * memory, which transfers hardware surfaces.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref first picture
+ */
+static void upipe_avcenc_setup_hw(struct upipe *upipe, struct uref *uref)
+{
+    struct upipe_avcenc *upipe_avcenc = upipe_avcenc_from_upipe(upipe);
+    upipe_avcenc->hw = false;
+
+#ifdef UPIPE_AVCENC_HW
+    AVCodecContext *context = upipe_avcenc->context;
+    AVFrame *frame;
+    if (uref->ubuf == NULL ||
+        !ubase_check(ubuf_av_get_frame(uref->ubuf, &frame)) ||
+        frame->hw_frames_ctx == NULL) {
+        if (upipe_avcenc_hw_pix_fmt(context->codec) == context->pix_fmt)
+            upipe_warn_va(upipe, "encoder %s requires hardware frames",
+                          context->codec->name);
+        return;
+    }
+
+    AVHWFramesContext *frames_ctx =
+        (AVHWFramesContext *)frame->hw_frames_ctx->data;
+    const enum AVPixelFormat *p = context->codec->pix_fmts;
+    while (p != NULL && *p != AV_PIX_FMT_NONE && *p != frames_ctx->format)
+        p++;
+    if (p == NULL || *p == AV_PIX_FMT_NONE) {
+        upipe_warn_va(upipe, "encoder %s doesn't support %s frames, "
+                      "transferring to system memory", context->codec->name,
+                      av_get_pix_fmt_name(frames_ctx->format));
+        return;
+    }
+
+    av_buffer_unref(&context->hw_frames_ctx);
+    context->hw_frames_ctx = av_buffer_ref(frame->hw_frames_ctx);
+    if (unlikely(context->hw_frames_ctx == NULL)) {
+        upipe_warn(upipe, "could not reference hardware frames");
+        return;
+    }
+    context->pix_fmt = frames_ctx->format;
+    upipe_avcenc->hw = true;
+    upipe_notice_va(upipe, "encoding %s frames",
+                    av_get_pix_fmt_name(frames_ctx->format));
+#endif
+}
+
 /** @internal @This encodes video frames.
  *
  * @param upipe description structure of the pipe
@@ -644,9 +722,21 @@ static void upipe_avcenc_encode_video(struct upipe *upipe,
         return;
     }
 
+    AVFrame *hw_frame;
+    if (upipe_avcenc->hw) {
+        /* reference the hardware surface */
+        if (unlikely(!ubase_check(ubuf_av_get_frame(uref->ubuf,
+                                                    &hw_frame)) ||
+                     av_frame_ref(frame, hw_frame) < 0)) {
+            upipe_warn(upipe, "invalid hardware buffer received");
+            uref_free(uref);
+            return;
+        }
+    }
+
     int i;
-    for (i = 0; i < UPIPE_AV_MAX_PLANES && upipe_avcenc->chroma_map[i] != NULL;
-         i++) {
+    for (i = 0; !upipe_avcenc->hw && i < UPIPE_AV_MAX_PLANES &&
+                upipe_avcenc->chroma_map[i] != NULL; i++) {
         const uint8_t *data;
         size_t stride;
         if (unlikely(!ubase_check(uref_pic_plane_read(uref, upipe_avcenc->chroma_map[i],
@@ -669,6 +759,8 @@ static void upipe_avcenc_encode_video(struct upipe *upipe,
     upipe_verbose_va(upipe, "input pts %"PRId64, upipe_avcenc->avcpts);
     frame->pts = upipe_avcenc->avcpts++;
     if (unlikely(!ubase_check(uref_avcenc_set_priv(uref, frame->pts)))) {
+        if (upipe_avcenc->hw)
+            av_frame_unref(frame);
         uref_free(uref);
         upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
         return;
@@ -716,6 +808,8 @@ static void upipe_avcenc_encode_video(struct upipe *upipe,
     /* store uref in mapping list */
     ulist_add(&upipe_avcenc->urefs_in_use, uref_to_uchain(uref));
     upipe_avcenc_encode_frame(upipe, frame, upump_p);
+    if (upipe_avcenc->hw)
+        av_frame_unref(frame);
 }
 
 /** @internal @This encodes audio frames.
@@ -853,6 +947,9 @@ static bool upipe_avcenc_handle(struct upipe *upipe, struct uref *uref,
         if (upipe_avcenc->upump_av_deal != NULL)
             return false;
 
+        if (context->codec->type == AVMEDIA_TYPE_VIDEO)
+            upipe_avcenc_setup_hw(upipe, uref);
+
         upipe_avcenc_open(upipe);
     }
 
@@ -1103,6 +1200,12 @@ static int upipe_avcenc_set_flow_def(struct upipe *upipe, struct uref *flow_def)
     } else if (!ubase_ncmp(def, "pic.")) {
         context->pix_fmt = upipe_av_pixfmt_from_flow_def(flow_def,
                     codec->pix_fmts, upipe_avcenc->chroma_map);
+        if (context->pix_fmt == AV_PIX_FMT_NONE) {
+            /* hardware-only encoders are fed with hardware surfaces,
+             * checked on the first picture */
+            context->pix_fmt = upipe_avcenc_hw_pix_fmt(codec);
+            upipe_avcenc->chroma_map[0] = NULL;
+        }
         if (context->pix_fmt == AV_PIX_FMT_NONE) {
             upipe_err_va(upipe, "unsupported pixel format");
             uref_dump(flow_def, upipe->uprobe);
@@ -1254,7 +1357,8 @@ static int _upipe_avcenc_provide_flow_format(struct upipe *upipe,
         const char *chroma_map[UPIPE_AV_MAX_PLANES];
         enum AVPixelFormat pix_fmt = upipe_av_pixfmt_from_flow_def(flow_format,
                     codec->pix_fmts, chroma_map);
-        if (pix_fmt == AV_PIX_FMT_NONE) {
+        if (pix_fmt == AV_PIX_FMT_NONE &&
+            upipe_avcenc_hw_pix_fmt(codec) == AV_PIX_FMT_NONE) {
             uref_pic_flow_clear_format(flow_format);
             if (unlikely(!ubase_check(upipe_av_pixfmt_to_flow_def(
                                 codec->pix_fmts[0], flow_format))))
@@ -1459,8 +1563,12 @@ static void upipe_avcenc_free(struct upipe *upipe)
 {
     struct upipe_avcenc *upipe_avcenc = upipe_avcenc_from_upipe(upipe);
 
-    if (upipe_avcenc->context != NULL)
+    if (upipe_avcenc->context != NULL) {
+#ifdef UPIPE_AVCENC_HW
+        av_buffer_unref(&upipe_avcenc->context->hw_frames_ctx);
+#endif
         av_free(upipe_avcenc->context);
+    }
     av_frame_free(&upipe_avcenc->frame);
 
     /* free remaining urefs (should not be any) */
@@ -1534,6 +1642,7 @@ static struct upipe *upipe_avcenc_alloc(struct upipe_mgr *mgr,
     }
 
     upipe_avcenc->frame = frame;
+    upipe_avcenc->hw = false;
     upipe_avcenc->context->codec = codec;
     upipe_avcenc->context->opaque = upipe;
 
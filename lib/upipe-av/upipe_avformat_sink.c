@@ -39,10 +39,15 @@
 #include <upipe/uref_pic_flow.h>
 #include <upipe/uref_sound_flow.h>
 #include <upipe/uref_clock.h>
+#include <upipe/ueventfd.h>
+#include <upipe/upump.h>
+#include <upipe/upump_blocker.h>
 #include <upipe/upipe.h>
 #include <upipe/upipe_helper_upipe.h>
 #include <upipe/upipe_helper_urefcount.h>
 #include <upipe/upipe_helper_void.h>
+#include <upipe/upipe_helper_upump_mgr.h>
+#include <upipe/upipe_helper_upump.h>
 #include <upipe/upipe_helper_flow_def_check.h>
 #include <upipe/upipe_helper_subpipe.h>
 #include <upipe-framers/uref_mpga_flow.h>
@@ -59,12 +64,52 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
+#include <pthread.h>
 #include <sys/ioctl.h>
 #include <errno.h>
 #include <assert.h>
 
 #include <libavutil/dict.h>
 #include <libavformat/avformat.h>
+#include <libavformat/avio.h>
+
+/** @internal @This is the asynchronous writer of an avformat sink pipe. The
+ * packets from tail to head are owned by the writer thread, which also
+ * writes the header and the trailer. */
+struct upipe_avfsink_writer {
+    /** avformat context, only accessed by the writer thread once started */
+    AVFormatContext *context;
+    /** avio context opened from the URI, written through context->pb */
+    AVIOContext *pb;
+    /** avformat options for the header */
+    AVDictionary *options;
+    /** writer thread */
+    pthread_t thread;
+    /** mutex protecting the fields below */
+    pthread_mutex_t mutex;
+    /** condition signalled to the writer thread */
+    pthread_cond_t cond;
+    /** number of packets waiting to be written */
+    unsigned int pending;
+    /** index of the next packet to write */
+    unsigned int tail;
+    /** true if the thread must exit once all packets are written */
+    bool exit;
+    /** first avformat error, or 0 */
+    int error;
+
+    /** index of the next packet to queue */
+    unsigned int head;
+    /** true if the error has already been reported */
+    bool error_reported;
+    /** event signalled by the writer thread when a packet is written */
+    struct ueventfd event;
+
+    /** number of packets */
+    unsigned int nb;
+    /** ring of packets */
+    AVPacket packets[];
+};
 
 /** @internal @This is the private context of an avformat source pipe. */
 struct upipe_avfsink {
@@ -94,6 +139,17 @@ struct upipe_avfsink {
     /** highest DTS */
     uint64_t highest_next_dts;
 
+    /** upump manager */
+    struct upump_mgr *upump_mgr;
+    /** watcher of the asynchronous writer */
+    struct upump *upump;
+    /** number of packets queued for asynchronous writes */
+    unsigned int async_depth;
+    /** asynchronous writer, or NULL */
+    struct upipe_avfsink_writer *writer;
+    /** list of blockers */
+    struct uchain blockers;
+
     /** manager to create subs */
     struct upipe_mgr sub_mgr;
 
@@ -104,6 +160,8 @@ struct upipe_avfsink {
 UPIPE_HELPER_UPIPE(upipe_avfsink, upipe, UPIPE_AVFSINK_SIGNATURE)
 UPIPE_HELPER_UREFCOUNT(upipe_avfsink, urefcount, upipe_avfsink_free)
 UPIPE_HELPER_VOID(upipe_avfsink)
+UPIPE_HELPER_UPUMP_MGR(upipe_avfsink, upump_mgr)
+UPIPE_HELPER_UPUMP(upipe_avfsink, upump, upump_mgr)
 
 /** @internal @This is the private context of an output of an avformat source
  * pipe. */
@@ -523,10 +581,369 @@ static struct upipe *upipe_avfsink_alloc(struct upipe_mgr *mgr,
     upipe_avfsink->ts_offset = 0;
     upipe_avfsink->first_dts = 0;
     upipe_avfsink->highest_next_dts = 0;
+    upipe_avfsink_init_upump_mgr(upipe);
+    upipe_avfsink_init_upump(upipe);
+    upipe_avfsink->async_depth = 0;
+    upipe_avfsink->writer = NULL;
+    ulist_init(&upipe_avfsink->blockers);
     upipe_throw_ready(upipe);
     return upipe;
 }
 
+/** @internal @This is called when the source pump is released by its owner.
+ *
+ * @param blocker description structure of the blocker
+ */
+static void upipe_avfsink_block_cb(struct upump_blocker *blocker)
+{
+    ulist_delete(upump_blocker_to_uchain(blocker));
+    upump_blocker_free(blocker);
+}
+
+/** @internal @This blocks the given source pump until the writer thread
+ * has room for more packets.
+ *
+ * @param upipe description structure of the pipe
+ * @param upump_p reference to source pump to block
+ */
+static void upipe_avfsink_block(struct upipe *upipe, struct upump **upump_p)
+{
+    struct upipe_avfsink *upipe_avfsink = upipe_avfsink_from_upipe(upipe);
+    if (upump_p == NULL || *upump_p == NULL ||
+        upump_blocker_find(&upipe_avfsink->blockers, *upump_p) != NULL)
+        return;
+    struct upump_blocker *blocker =
+        upump_blocker_alloc(*upump_p, upipe_avfsink_block_cb, upipe,
+                            upipe->refcount);
+    if (likely(blocker != NULL))
+        ulist_add(&upipe_avfsink->blockers, upump_blocker_to_uchain(blocker));
+}
+
+/** @internal @This unblocks all source pumps.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_avfsink_unblock(struct upipe *upipe)
+{
+    struct upipe_avfsink *upipe_avfsink = upipe_avfsink_from_upipe(upipe);
+    struct uchain *uchain, *uchain_tmp;
+    ulist_delete_foreach (&upipe_avfsink->blockers, uchain, uchain_tmp) {
+        ulist_delete(uchain);
+        upump_blocker_free(upump_blocker_from_uchain(uchain));
+    }
+}
+
+/** @internal @This is called by avformat to write the avio buffer.
+ *
+ * @param opaque pointer to the avio context opened from the URI
+ * @param buf buffer to write
+ * @param size size of the buffer
+ * @return number of octets written, or an avformat error code
+ */
+static int upipe_avfsink_writer_write(void *opaque, uint8_t *buf, int size)
+{
+    AVIOContext *pb = opaque;
+    avio_write(pb, buf, size);
+    return pb->error < 0 ? pb->error : size;
+}
+
+/** @internal @This is called by avformat to seek in the output.
+ *
+ * @param opaque pointer to the avio context opened from the URI
+ * @param offset offset to seek to
+ * @param whence seek mode
+ * @return new offset, size of the output, or an avformat error code
+ */
+static int64_t upipe_avfsink_writer_seek(void *opaque, int64_t offset,
+                                         int whence)
+{
+    AVIOContext *pb = opaque;
+    if (whence & AVSEEK_SIZE)
+        return avio_size(pb);
+    return avio_seek(pb, offset, whence);
+}
+
+/** @internal @This opens the URI and writes the header, in the writer thread.
+ * The avio context of the URI is wrapped in a large avio buffer, so that it
+ * gets few large direct writes.
+ *
+ * @param writer pointer to the asynchronous writer
+ * @return 0, or an avformat error code
+ */
+static int upipe_avfsink_writer_open(struct upipe_avfsink_writer *writer)
+{
+    AVFormatContext *context = writer->context;
+    if (!(context->oformat->flags & AVFMT_NOFILE)) {
+        AVDictionary *options = NULL;
+        av_dict_copy(&options, writer->options, 0);
+        int error = avio_open2(&writer->pb, context->filename,
+                               AVIO_FLAG_WRITE | AVIO_FLAG_DIRECT, NULL,
+                               &options);
+        av_dict_free(&options);
+        if (error < 0)
+            return error;
+
+        unsigned char *buffer = av_malloc(UPIPE_AVFSINK_ASYNC_BUFFER_SIZE);
+        if (buffer != NULL)
+            context->pb = avio_alloc_context(buffer,
+                    UPIPE_AVFSINK_ASYNC_BUFFER_SIZE, 1, writer->pb, NULL,
+                    upipe_avfsink_writer_write, upipe_avfsink_writer_seek);
+        if (context->pb == NULL) {
+            av_free(buffer);
+            context->pb = writer->pb;
+            writer->pb = NULL;
+        }
+    }
+
+    int error = avformat_write_header(context, &writer->options);
+    return error < 0 ? error : 0;
+}
+
+/** @internal @This writes the trailer and closes the URI, in the writer
+ * thread.
+ *
+ * @param writer pointer to the asynchronous writer
+ * @param opened true if the header has been written
+ */
+static void upipe_avfsink_writer_finish(struct upipe_avfsink_writer *writer,
+                                        bool opened)
+{
+    AVFormatContext *context = writer->context;
+    if (opened)
+        av_write_trailer(context);
+    if (context->oformat->flags & AVFMT_NOFILE)
+        return;
+
+    if (writer->pb != NULL) {
+        if (context->pb != NULL) {
+            avio_flush(context->pb);
+            av_freep(&context->pb->buffer);
+            av_freep(&context->pb);
+        }
+        avio_closep(&writer->pb);
+    } else
+        avio_closep(&context->pb);
+}
+
+/** @internal @This is the main loop of the writer thread.
+ *
+ * @param arg pointer to the asynchronous writer
+ * @return NULL
+ */
+static void *upipe_avfsink_writer_thread(void *arg)
+{
+    struct upipe_avfsink_writer *writer = arg;
+    int err = upipe_avfsink_writer_open(writer);
+    bool opened = !err;
+
+    pthread_mutex_lock(&writer->mutex);
+    writer->error = err;
+    ueventfd_write(&writer->event);
+    for ( ; ; ) {
+        while (!writer->pending && !writer->exit)
+            pthread_cond_wait(&writer->cond, &writer->mutex);
+
+        if (writer->pending) {
+            AVPacket *pkt = &writer->packets[writer->tail];
+            bool failed = writer->error != 0;
+            pthread_mutex_unlock(&writer->mutex);
+
+            err = failed ? 0 : av_write_frame(writer->context, pkt);
+            free(pkt->data);
+            pkt->data = NULL;
+
+            pthread_mutex_lock(&writer->mutex);
+            if (unlikely(err < 0 && !writer->error))
+                writer->error = err;
+            writer->tail = (writer->tail + 1) % writer->nb;
+            writer->pending--;
+            ueventfd_write(&writer->event);
+            continue;
+        }
+        if (writer->exit)
+            break;
+    }
+    pthread_mutex_unlock(&writer->mutex);
+
+    upipe_avfsink_writer_finish(writer, opened);
+    return NULL;
+}
+
+/** @internal @This starts the asynchronous writer, which writes the header.
+ * On failure, the pipe falls back to synchronous writes.
+ *
+ * @param upipe description structure of the pipe
+ * @return false if the pipe must write synchronously
+ */
+static bool upipe_avfsink_writer_start(struct upipe *upipe)
+{
+    struct upipe_avfsink *upipe_avfsink = upipe_avfsink_from_upipe(upipe);
+    unsigned int nb = upipe_avfsink->async_depth;
+    if (!nb)
+        return false;
+    if (unlikely(!ubase_check(upipe_avfsink_check_upump_mgr(upipe)))) {
+        upipe_warn(upipe, "no upump manager, writing synchronously");
+        return false;
+    }
+
+    struct upipe_avfsink_writer *writer =
+        malloc(sizeof(struct upipe_avfsink_writer) + nb * sizeof(AVPacket));
+    if (unlikely(writer == NULL)) {
+        upipe_warn(upipe, "unable to allocate asynchronous writer");
+        return false;
+    }
+    if (unlikely(!ueventfd_init(&writer->event, false))) {
+        free(writer);
+        upipe_warn(upipe, "unable to allocate asynchronous writer");
+        return false;
+    }
+    writer->context = upipe_avfsink->context;
+    writer->pb = NULL;
+    writer->options = NULL;
+    av_dict_copy(&writer->options, upipe_avfsink->options, 0);
+    writer->nb = nb;
+    writer->pending = writer->tail = writer->head = 0;
+    writer->exit = false;
+    writer->error = 0;
+    writer->error_reported = false;
+
+    pthread_mutex_init(&writer->mutex, NULL);
+    pthread_cond_init(&writer->cond, NULL);
+    if (unlikely(pthread_create(&writer->thread, NULL,
+                                upipe_avfsink_writer_thread, writer))) {
+        pthread_cond_destroy(&writer->cond);
+        pthread_mutex_destroy(&writer->mutex);
+        ueventfd_clean(&writer->event);
+        av_dict_free(&writer->options);
+        free(writer);
+        upipe_warn(upipe, "unable to create writer thread");
+        return false;
+    }
+    upipe_avfsink->writer = writer;
+    upipe_dbg_va(upipe, "writing asynchronously with %u packets", nb);
+    return true;
+}
+
+/** @internal @This checks whether a packet may be queued.
+ *
+ * @param writer pointer to the asynchronous writer
+ * @param error_p filled in with the first avformat error, or 0
+ * @return true if all packets are waiting to be written
+ */
+static bool upipe_avfsink_writer_full(struct upipe_avfsink_writer *writer,
+                                      int *error_p)
+{
+    pthread_mutex_lock(&writer->mutex);
+    bool full = writer->pending == writer->nb;
+    *error_p = writer->error;
+    pthread_mutex_unlock(&writer->mutex);
+    return full;
+}
+
+/** @internal @This hands a packet over to the writer thread. The writer
+ * must not be full.
+ *
+ * @param writer pointer to the asynchronous writer
+ * @param pkt packet to write, whose data is freed by the writer thread
+ */
+static void upipe_avfsink_writer_push(struct upipe_avfsink_writer *writer,
+                                      AVPacket *pkt)
+{
+    writer->packets[writer->head] = *pkt;
+    writer->head = (writer->head + 1) % writer->nb;
+    pthread_mutex_lock(&writer->mutex);
+    writer->pending++;
+    pthread_cond_signal(&writer->cond);
+    pthread_mutex_unlock(&writer->mutex);
+}
+
+/** @internal @This writes the remaining packets and the trailer, and stops
+ * the asynchronous writer. This blocks until all data is written.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_avfsink_writer_close(struct upipe *upipe)
+{
+    struct upipe_avfsink *upipe_avfsink = upipe_avfsink_from_upipe(upipe);
+    struct upipe_avfsink_writer *writer = upipe_avfsink->writer;
+    if (writer == NULL)
+        return;
+
+    upipe_dbg(upipe, "writing trailer");
+    pthread_mutex_lock(&writer->mutex);
+    writer->exit = true;
+    pthread_cond_signal(&writer->cond);
+    pthread_mutex_unlock(&writer->mutex);
+    pthread_join(writer->thread, NULL);
+
+    if (unlikely(writer->error && !writer->error_reported)) {
+        upipe_av_strerror(writer->error, buf);
+        upipe_warn_va(upipe, "write error to %s (%s)", upipe_avfsink->uri,
+                      buf);
+    }
+    pthread_cond_destroy(&writer->cond);
+    pthread_mutex_destroy(&writer->mutex);
+    ueventfd_clean(&writer->event);
+    av_dict_free(&writer->options);
+    free(writer);
+    upipe_avfsink->writer = NULL;
+    upipe_avfsink_set_upump(upipe, NULL);
+    upipe_avfsink_unblock(upipe);
+}
+
+/** @internal @This is called when the writer thread has written a packet,
+ * while the sources are blocked.
+ *
+ * @param upump description structure of the watcher
+ */
+static void upipe_avfsink_writer_watcher(struct upump *upump)
+{
+    struct upipe *upipe = upump_get_opaque(upump, struct upipe *);
+    struct upipe_avfsink *upipe_avfsink = upipe_avfsink_from_upipe(upipe);
+    struct upipe_avfsink_writer *writer = upipe_avfsink->writer;
+    ueventfd_read(&writer->event);
+    int error;
+    if (upipe_avfsink_writer_full(writer, &error))
+        return;
+
+    upipe_avfsink_set_upump(upipe, NULL);
+    upipe_avfsink_mux(upipe, NULL);
+    if (upipe_avfsink->upump == NULL)
+        upipe_avfsink_unblock(upipe);
+}
+
+/** @internal @This waits for the writer thread to have room for a packet.
+ *
+ * @param upipe description structure of the pipe
+ * @param upump_p reference to pump that generated the last buffer
+ */
+static void upipe_avfsink_writer_wait(struct upipe *upipe,
+                                      struct upump **upump_p)
+{
+    struct upipe_avfsink *upipe_avfsink = upipe_avfsink_from_upipe(upipe);
+    upipe_avfsink_block(upipe, upump_p);
+    if (upipe_avfsink->upump != NULL)
+        return;
+    if (unlikely(!ubase_check(upipe_avfsink_check_upump_mgr(upipe)))) {
+        upipe_err(upipe, "can't get upump_mgr");
+        upipe_throw_fatal(upipe, UBASE_ERR_UPUMP);
+        return;
+    }
+
+    struct upump *watcher =
+        ueventfd_upump_alloc(&upipe_avfsink->writer->event,
+                             upipe_avfsink->upump_mgr,
+                             upipe_avfsink_writer_watcher, upipe,
+                             upipe->refcount);
+    if (unlikely(watcher == NULL)) {
+        upipe_err(upipe, "can't create watcher");
+        upipe_throw_fatal(upipe, UBASE_ERR_UPUMP);
+        return;
+    }
+    upipe_avfsink_set_upump(upipe, watcher);
+    upump_start(watcher);
+}
+
 /** @internal @This finds the input with the lowest DTS.
  *
  * @param upipe description structure of the pipe
@@ -572,6 +989,10 @@ static void upipe_avfsink_mux(struct upipe *upipe, struct upump **upump_p)
                 upipe_avfsink->ts_offset = input->next_dts;
             }
             upipe_avfsink->first_dts = input->next_dts;
+            if (upipe_avfsink_writer_start(upipe)) {
+                upipe_avfsink->opened = true;
+                continue;
+            }
             if (!(upipe_avfsink->context->oformat->flags & AVFMT_NOFILE)) {
                 AVDictionary *options = NULL;
                 av_dict_copy(&options, upipe_avfsink->options, 0);
@@ -612,6 +1033,22 @@ static void upipe_avfsink_mux(struct upipe *upipe, struct upump **upump_p)
             upipe_avfsink->opened = true;
         }
 
+        if (upipe_avfsink->writer != NULL) {
+            struct upipe_avfsink_writer *writer = upipe_avfsink->writer;
+            int error;
+            if (upipe_avfsink_writer_full(writer, &error)) {
+                upipe_avfsink_writer_wait(upipe, upump_p);
+                return;
+            }
+            if (unlikely(error && !writer->error_reported)) {
+                upipe_av_strerror(error, buf);
+                upipe_warn_va(upipe, "write error to %s (%s)",
+                              upipe_avfsink->uri, buf);
+                writer->error_reported = true;
+                upipe_throw_error(upipe, UBASE_ERR_EXTERNAL);
+            }
+        }
+
         AVStream *stream = upipe_avfsink->context->streams[input->id];
         struct uchain *uchain = ulist_pop(&input->urefs);
         struct uref *uref = uref_from_uchain(uchain);
@@ -675,6 +1112,11 @@ static void upipe_avfsink_mux(struct upipe *upipe, struct upump **upump_p)
 
         upipe_release(upipe_avfsink_sub_to_upipe(input));
 
+        if (upipe_avfsink->writer != NULL) {
+            upipe_avfsink_writer_push(upipe_avfsink->writer, &avpkt);
+            continue;
+        }
+
         int error = av_write_frame(upipe_avfsink->context, &avpkt);
         free(avpkt.data);
         if (unlikely(error < 0)) {
@@ -865,7 +1307,9 @@ static int upipe_avfsink_set_uri(struct upipe *upipe, const char *uri)
     if (unlikely(upipe_avfsink->context != NULL)) {
         if (likely(upipe_avfsink->uri != NULL))
             upipe_notice_va(upipe, "closing URI %s", upipe_avfsink->uri);
-        if (upipe_avfsink->opened) {
+        if (upipe_avfsink->writer != NULL)
+            upipe_avfsink_writer_close(upipe);
+        else if (upipe_avfsink->opened) {
             upipe_dbg(upipe, "writing trailer");
             av_write_trailer(upipe_avfsink->context);
             if (!(upipe_avfsink->context->oformat->flags & AVFMT_NOFILE))
@@ -914,6 +1358,10 @@ static int upipe_avfsink_control(struct upipe *upipe, int command, va_list args)
         case UPIPE_REGISTER_REQUEST:
         case UPIPE_UNREGISTER_REQUEST:
             return upipe_control_provide_request(upipe, command, args);
+        case UPIPE_ATTACH_UPUMP_MGR:
+            upipe_avfsink_set_upump(upipe, NULL);
+            upipe_avfsink_unblock(upipe);
+            return upipe_avfsink_attach_upump_mgr(upipe);
 
         case UPIPE_SET_FLOW_DEF: {
             struct uref *flow_def = va_arg(args, struct uref *);
@@ -954,6 +1402,21 @@ static int upipe_avfsink_control(struct upipe *upipe, int command, va_list args)
             uint64_t *duration_p = va_arg(args, uint64_t *);
             return _upipe_avfsink_get_duration(upipe, duration_p);
         }
+        case UPIPE_AVFSINK_SET_ASYNC_DEPTH: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_AVFSINK_SIGNATURE)
+            struct upipe_avfsink *upipe_avfsink =
+                upipe_avfsink_from_upipe(upipe);
+            upipe_avfsink->async_depth = va_arg(args, unsigned int);
+            return UBASE_ERR_NONE;
+        }
+        case UPIPE_AVFSINK_GET_ASYNC_DEPTH: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_AVFSINK_SIGNATURE)
+            struct upipe_avfsink *upipe_avfsink =
+                upipe_avfsink_from_upipe(upipe);
+            unsigned int *depth_p = va_arg(args, unsigned int *);
+            *depth_p = upipe_avfsink->async_depth;
+            return UBASE_ERR_NONE;
+        }
 
         case UPIPE_GET_URI: {
             const char **uri_p = va_arg(args, const char **);
@@ -985,6 +1448,9 @@ static void upipe_avfsink_free(struct upipe *upipe)
 
     av_dict_free(&upipe_avfsink->options);
 
+    upipe_avfsink_unblock(upipe);
+    upipe_avfsink_clean_upump(upipe);
+    upipe_avfsink_clean_upump_mgr(upipe);
     upipe_avfsink_clean_urefcount(upipe);
     upipe_avfsink_free_void(upipe);
 }
@@ -43,6 +43,7 @@
 #include <upipe/uref_dump.h>
 #include <upipe/upump.h>
 #include <upipe/ubuf.h>
+#include <upipe/ubuf_block.h>
 #include <upipe/upipe.h>
 #include <upipe/upipe_helper_upipe.h>
 #include <upipe/upipe_helper_urefcount.h>
@@ -53,6 +54,7 @@
 #include <upipe/upipe_helper_upump.h>
 #include <upipe/upipe_helper_uclock.h>
 #include <upipe/upipe_helper_output.h>
+#include <upipe/upipe_helper_input.h>
 #include <upipe/upipe_helper_ubuf_mgr.h>
 #include <upipe/upipe_helper_uprobe.h>
 #include <upipe/upipe_helper_inner.h>
@@ -60,6 +62,7 @@
 #include <upipe/upipe_helper_subpipe.h>
 #include <upipe-modules/upipe_idem.h>
 #include <upipe-av/uref_av_flow.h>
+#include <upipe-av/ubuf_block_av.h>
 #include <upipe-av/upipe_avformat_source.h>
 
 #include "upipe_av_internal.h"
@@ -79,11 +82,20 @@
 
 #include <libavutil/dict.h>
 #include <libavformat/avformat.h>
+#include <libavformat/avio.h>
 
 /** lowest possible timestamp (just an arbitrarily high time) */
 #define AV_CLOCK_MIN UINT32_MAX
 /** offset between DTS and (artificial) clock references */
 #define PCR_OFFSET (UCLOCK_FREQ * 3)
+/** size of the buffer of the avio context reading from the input */
+#define IO_BUFFER_SIZE 32768
+/** amount of input data to buffer before probing the stream */
+#define IO_PREBUFFER (4 * 1024 * 1024)
+/** minimum amount of input data to buffer before reading a packet */
+#define IO_LOW_WATERMARK (512 * 1024)
+/** amount of input data above which the input is blocked */
+#define IO_HIGH_WATERMARK (8 * 1024 * 1024)
 
 /** @internal @This is the private context of an avfsrc manager. */
 struct upipe_avfsrc_mgr {
@@ -140,6 +152,28 @@ struct upipe_avfsrc {
     /** list of subs */
     struct uchain subs;
 
+    /** temporary uref storage */
+    struct uchain urefs;
+    /** nb urefs in storage */
+    unsigned int nb_urefs;
+    /** max urefs in storage */
+    unsigned int max_urefs;
+    /** list of blockers */
+    struct uchain blockers;
+
+    /** avio context reading from the input, or NULL when reading an URL */
+    AVIOContext *io;
+    /** input format to use with the avio context, or NULL to probe it */
+    AVInputFormat *io_format;
+    /** input data not yet read by avformat */
+    struct ubuf *io_ubuf;
+    /** size of the input data not yet read by avformat */
+    size_t io_size;
+    /** true if the input has ended */
+    bool io_end;
+    /** ubuf manager wrapping avformat packets */
+    struct ubuf_mgr *pkt_ubuf_mgr;
+
     /** URL */
     char *url;
 
@@ -174,6 +208,15 @@ UPIPE_HELPER_UPUMP(upipe_avfsrc, upump, upump_mgr)
 
 UBASE_FROM_TO(upipe_avfsrc, urefcount, urefcount_real, urefcount_real)
 
+/** @hidden */
+static bool upipe_avfsrc_handle(struct upipe *upipe, struct uref *uref,
+                                struct upump **upump_p);
+
+UPIPE_HELPER_INPUT(upipe_avfsrc, urefs, nb_urefs, max_urefs, blockers,
+                   upipe_avfsrc_handle)
+
+/** @hidden */
+static int upipe_avfsrc_check(struct upipe *upipe);
 /** @hidden */
 static int upipe_avfsrc_sub_check(struct upipe *upipe, struct uref *flow_format);
 /** @hidden */
@@ -479,6 +522,7 @@ static struct upipe *upipe_avfsrc_alloc(struct upipe_mgr *mgr,
     upipe_avfsrc_init_upump_mgr(upipe);
     upipe_avfsrc_init_upump(upipe);
     upipe_avfsrc_init_uclock(upipe);
+    upipe_avfsrc_init_input(upipe);
     upipe_avfsrc->timestamp_offset = 0;
     upipe_avfsrc->timestamp_highest = AV_CLOCK_MIN;
     upipe_avfsrc->systime_rap = UINT64_MAX;
@@ -489,6 +533,12 @@ static struct upipe *upipe_avfsrc_alloc(struct upipe_mgr *mgr,
     upipe_avfsrc->options = NULL;
     upipe_avfsrc->context = NULL;
     upipe_avfsrc->probed = false;
+    upipe_avfsrc->io = NULL;
+    upipe_avfsrc->io_format = NULL;
+    upipe_avfsrc->io_ubuf = NULL;
+    upipe_avfsrc->io_size = 0;
+    upipe_avfsrc->io_end = false;
+    upipe_avfsrc->pkt_ubuf_mgr = NULL;
     upipe_throw_ready(upipe);
     return upipe;
 }
@@ -508,6 +558,83 @@ static void upipe_avfsrc_abort_av_deal(struct upipe *upipe)
     }
 }
 
+/** @internal @This returns true if enough input data has been buffered to
+ * let avformat read from it without running dry. It always returns true
+ * when reading from an URL.
+ *
+ * @param upipe description structure of the pipe
+ * @return true if avformat may read
+ */
+static bool upipe_avfsrc_io_ready(struct upipe *upipe)
+{
+    struct upipe_avfsrc *upipe_avfsrc = upipe_avfsrc_from_upipe(upipe);
+    if (upipe_avfsrc->io == NULL || upipe_avfsrc->io_end)
+        return true;
+    return upipe_avfsrc->io_size >=
+        (upipe_avfsrc->probed ? IO_LOW_WATERMARK : IO_PREBUFFER);
+}
+
+/** @internal @This releases the input buffers and the avio context, once the
+ * avformat context has been closed.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_avfsrc_clean_io(struct upipe *upipe)
+{
+    struct upipe_avfsrc *upipe_avfsrc = upipe_avfsrc_from_upipe(upipe);
+    if (upipe_avfsrc->io != NULL) {
+        /* avformat doesn't free custom avio contexts */
+        av_freep(&upipe_avfsrc->io->buffer);
+        av_freep(&upipe_avfsrc->io);
+    }
+    if (upipe_avfsrc->io_ubuf != NULL)
+        ubuf_free(upipe_avfsrc->io_ubuf);
+    upipe_avfsrc->io_format = NULL;
+    upipe_avfsrc->io_ubuf = NULL;
+    upipe_avfsrc->io_size = 0;
+    upipe_avfsrc->io_end = false;
+    if (upipe_avfsrc_flush_input(upipe))
+        upipe_release(upipe);
+}
+
+/** @internal @This is called by avformat to read data from the input.
+ *
+ * @param opaque description structure of the pipe
+ * @param buf buffer to fill in
+ * @param size size of the buffer
+ * @return number of octets read, or an avformat error code
+ */
+static int upipe_avfsrc_io_read(void *opaque, uint8_t *buf, int size)
+{
+    struct upipe *upipe = (struct upipe *)opaque;
+    struct upipe_avfsrc *upipe_avfsrc = upipe_avfsrc_from_upipe(upipe);
+    if (upipe_avfsrc->io_ubuf == NULL)
+        return upipe_avfsrc->io_end ? AVERROR_EOF : AVERROR(EAGAIN);
+
+    if (size > upipe_avfsrc->io_size)
+        size = upipe_avfsrc->io_size;
+    if (unlikely(!ubase_check(ubuf_block_extract(upipe_avfsrc->io_ubuf,
+                                                 0, size, buf))))
+        return AVERROR(EIO);
+    if (size == upipe_avfsrc->io_size) {
+        ubuf_free(upipe_avfsrc->io_ubuf);
+        upipe_avfsrc->io_ubuf = NULL;
+    } else
+        ubuf_block_resize(upipe_avfsrc->io_ubuf, size, -1);
+    upipe_avfsrc->io_size -= size;
+
+    /* take held input now that there is room for it */
+    bool was_buffered = !upipe_avfsrc_check_input(upipe);
+    upipe_avfsrc_output_input(upipe);
+    upipe_avfsrc_unblock_input(upipe);
+    if (was_buffered && upipe_avfsrc_check_input(upipe)) {
+        /* All urefs have been taken, release again the pipe that has been
+         * used in @ref upipe_avfsrc_input. */
+        upipe_release(upipe);
+    }
+    return size;
+}
+
 /** @internal @This finds the given id in the list of output subpipes.
  *
  * @param upipe description structure of the pipe
@@ -527,62 +654,92 @@ static struct upipe_avfsrc_sub *upipe_avfsrc_find_output(struct upipe *upipe,
     return NULL;
 }
 
-/** @internal @This reads data from the source and outputs it.
- * It is called either when the idler triggers (permanent storage mode) or
- * when data is available on the file descriptor (live stream mode).
+/** @internal @This allocates a uref holding the data of a packet. Reference
+ * counted packets are wrapped without copy; other packets are copied to a
+ * buffer from the ubuf manager of the output.
  *
- * @param upump description structure of the read watcher
+ * @param upipe description structure of the pipe
+ * @param output output subpipe
+ * @param pkt packet read by avformat
+ * @return pointer to uref, or NULL in case of error
  */
-static void upipe_avfsrc_worker(struct upump *upump)
+static struct uref *upipe_avfsrc_alloc_packet(struct upipe *upipe,
+                                              struct upipe_avfsrc_sub *output,
+                                              AVPacket *pkt)
+{
+    struct upipe_avfsrc *upipe_avfsrc = upipe_avfsrc_from_upipe(upipe);
+
+    if (pkt->buf != NULL) {
+        if (unlikely(upipe_avfsrc->pkt_ubuf_mgr == NULL))
+            upipe_avfsrc->pkt_ubuf_mgr = ubuf_block_av_mgr_alloc();
+        struct ubuf *ubuf = NULL;
+        if (likely(upipe_avfsrc->pkt_ubuf_mgr != NULL))
+            ubuf = ubuf_block_av_alloc(upipe_avfsrc->pkt_ubuf_mgr, pkt);
+        if (likely(ubuf != NULL)) {
+            struct uref *uref = uref_alloc(upipe_avfsrc->uref_mgr);
+            if (unlikely(uref == NULL)) {
+                ubuf_free(ubuf);
+                return NULL;
+            }
+            uref_attach_ubuf(uref, ubuf);
+            return uref;
+        }
+    }
+
+    struct uref *uref = uref_block_alloc(upipe_avfsrc->uref_mgr,
+                                         output->ubuf_mgr, pkt->size);
+    if (unlikely(uref == NULL))
+        return NULL;
+
+    uint8_t *buffer;
+    int read_size = -1;
+    if (unlikely(!ubase_check(uref_block_write(uref, 0, &read_size,
+                                               &buffer)))) {
+        uref_free(uref);
+        return NULL;
+    }
+    assert(read_size == pkt->size);
+    memcpy(buffer, pkt->data, pkt->size);
+    uref_block_unmap(uref, 0);
+    return uref;
+}
+
+/** @internal @This reads a packet from the source and outputs it.
+ *
+ * @param upipe description structure of the pipe
+ * @return 0, or an avformat error code
+ */
+static int upipe_avfsrc_read(struct upipe *upipe)
 {
-    struct upipe *upipe = upump_get_opaque(upump, struct upipe *);
     struct upipe_avfsrc *upipe_avfsrc = upipe_avfsrc_from_upipe(upipe);
     AVPacket pkt;
 
     int error = av_read_frame(upipe_avfsrc->context, &pkt);
-    if (unlikely(error < 0)) {
-        upipe_av_strerror(error, buf);
-        upipe_err_va(upipe, "read error from %s (%s)", upipe_avfsrc->url, buf);
-        upipe_avfsrc_set_upump(upipe, NULL);
-        upipe_throw_source_end(upipe);
-        return;
-    }
+    if (unlikely(error < 0))
+        return error;
 
     struct upipe_avfsrc_sub *output =
         upipe_avfsrc_find_output(upipe, pkt.stream_index);
     if (output == NULL) {
         av_packet_unref(&pkt);
-        return;
+        return 0;
     }
     if (unlikely(output->ubuf_mgr == NULL)) {
         if (unlikely(!upipe_avfsrc_sub_demand_ubuf_mgr(upipe_avfsrc_sub_to_upipe(output), uref_dup(output->flow_def)))) {
             av_packet_unref(&pkt);
-            return;
+            return 0;
         }
     }
 
-    struct uref *uref = uref_block_alloc(upipe_avfsrc->uref_mgr,
-                                         output->ubuf_mgr, pkt.size);
-    if (unlikely(uref == NULL)) {
-        av_packet_unref(&pkt);
-        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
-        return;
-    }
-
     AVStream *stream = upipe_avfsrc->context->streams[pkt.stream_index];
     uint64_t systime = upipe_avfsrc->uclock != NULL ?
                        uclock_now(upipe_avfsrc->uclock) : UINT64_MAX;
-    uint8_t *buffer;
-    int read_size = -1;
-    if (unlikely(!ubase_check(uref_block_write(uref, 0, &read_size, &buffer)))) {
-        uref_free(uref);
+    struct uref *uref = upipe_avfsrc_alloc_packet(upipe, output, &pkt);
+    if (unlikely(uref == NULL)) {
         av_packet_unref(&pkt);
         upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
-        return;
+        return 0;
     }
-    assert(read_size == pkt.size);
-    memcpy(buffer, pkt.data, pkt.size);
-    uref_block_unmap(uref, 0);
 
     bool ts = false;
     if (upipe_avfsrc->uclock != NULL)
@@ -633,6 +790,38 @@ static void upipe_avfsrc_worker(struct upump *upump)
     av_packet_unref(&pkt);
 
     upipe_input(output->last_inner, uref, &upipe_avfsrc->upump);
+    return 0;
+}
+
+/** @internal @This reads data from the source and outputs it.
+ * It is called either when the idler triggers (permanent storage mode) or
+ * when data is available on the file descriptor (live stream mode).
+ *
+ * @param upump description structure of the read watcher
+ */
+static void upipe_avfsrc_worker(struct upump *upump)
+{
+    struct upipe *upipe = upump_get_opaque(upump, struct upipe *);
+    struct upipe_avfsrc *upipe_avfsrc = upipe_avfsrc_from_upipe(upipe);
+
+    if (unlikely(!upipe_avfsrc_io_ready(upipe))) {
+        /* wait for more input, see @ref upipe_avfsrc_handle */
+        upipe_avfsrc_set_upump(upipe, NULL);
+        return;
+    }
+
+    int error = upipe_avfsrc_read(upipe);
+    if (unlikely(error == AVERROR(EAGAIN) && upipe_avfsrc->io != NULL)) {
+        upipe_warn(upipe, "input underrun");
+        upipe_avfsrc_set_upump(upipe, NULL);
+        return;
+    }
+    if (unlikely(error < 0)) {
+        upipe_av_strerror(error, buf);
+        upipe_err_va(upipe, "read error from %s (%s)", upipe_avfsrc->url, buf);
+        upipe_avfsrc_set_upump(upipe, NULL);
+        upipe_throw_source_end(upipe);
+    }
 }
 
 /** @internal @This starts the worker.
@@ -821,17 +1010,33 @@ static void upipe_avfsrc_probe(struct upump *upump)
 {
     struct upipe *upipe = upump_get_opaque(upump, struct upipe *);
     struct upipe_avfsrc *upipe_avfsrc = upipe_avfsrc_from_upipe(upipe);
-    AVFormatContext *context = upipe_avfsrc->context;
 
     if (unlikely(!upipe_av_deal_grab()))
         return;
 
-    AVDictionary *options[context->nb_streams];
-    for (unsigned i = 0; i < context->nb_streams; i++) {
-        options[i] = NULL;
-        av_dict_copy(&options[i], upipe_avfsrc->options, 0);
+    int error = 0;
+    if (upipe_avfsrc->io != NULL && upipe_avfsrc->context->iformat == NULL) {
+        /* the input has been prebuffered, it can now be opened */
+        AVDictionary *options = NULL;
+        av_dict_copy(&options, upipe_avfsrc->options, 0);
+        error = avformat_open_input(&upipe_avfsrc->context, "",
+                                    upipe_avfsrc->io_format, &options);
+        av_dict_free(&options);
+        if (likely(error >= 0))
+            upipe_avfsrc->context->flags |= AVFMT_FLAG_KEEP_SIDE_DATA;
+    }
+
+    AVFormatContext *context = upipe_avfsrc->context;
+    if (likely(error >= 0)) {
+        AVDictionary *options[context->nb_streams];
+        for (unsigned i = 0; i < context->nb_streams; i++) {
+            options[i] = NULL;
+            av_dict_copy(&options[i], upipe_avfsrc->options, 0);
+        }
+        error = avformat_find_stream_info(context, options);
+        for (unsigned i = 0; i < context->nb_streams; i++)
+            av_dict_free(&options[i]);
     }
-    int error = avformat_find_stream_info(context, options);
 
     upipe_av_deal_yield(upump);
     upump_free(upipe_avfsrc->upump_av_deal);
@@ -845,6 +1050,7 @@ static void upipe_avfsrc_probe(struct upump *upump)
             upipe_notice_va(upipe, "closing URL %s", upipe_avfsrc->url);
         avformat_close_input(&upipe_avfsrc->context);
         upipe_avfsrc->context = NULL;
+        upipe_avfsrc_clean_io(upipe);
         ubase_clean_str(&upipe_avfsrc->url);
         return;
     }
@@ -1006,6 +1212,28 @@ static int upipe_avfsrc_get_uri(struct upipe *upipe, const char **url_p)
     return UBASE_ERR_NONE;
 }
 
+/** @internal @This sends the initial void flow definition.
+ *
+ * @param upipe description structure of the pipe
+ * @return an error code
+ */
+static int upipe_avfsrc_init_flow_def(struct upipe *upipe)
+{
+    struct upipe_avfsrc *upipe_avfsrc = upipe_avfsrc_from_upipe(upipe);
+
+    if (unlikely(!upipe_avfsrc_demand_uref_mgr(upipe)))
+        return UBASE_ERR_ALLOC;
+    upipe_avfsrc_check_upump_mgr(upipe);
+
+    struct uref *flow_def = uref_alloc_control(upipe_avfsrc->uref_mgr);
+    uref_flow_set_def(flow_def, "void.");
+    upipe_avfsrc_store_flow_def(upipe, flow_def);
+    /* Force sending flow def */
+    struct uref *uref = uref_alloc(upipe_avfsrc->uref_mgr);
+    upipe_avfsrc_output(upipe, uref, NULL);
+    return UBASE_ERR_NONE;
+}
+
 /** @internal @This asks to open the given URL.
  *
  * @param upipe description structure of the pipe
@@ -1025,21 +1253,13 @@ static int upipe_avfsrc_set_uri(struct upipe *upipe, const char *url)
         upipe_avfsrc_abort_av_deal(upipe);
         upipe_avfsrc_throw_sub_subs(upipe, UPROBE_SOURCE_END);
     }
+    upipe_avfsrc_clean_io(upipe);
     ubase_clean_str(&upipe_avfsrc->url);
 
     if (unlikely(url == NULL))
         return UBASE_ERR_NONE;
 
-    if (unlikely(!upipe_avfsrc_demand_uref_mgr(upipe)))
-        return UBASE_ERR_ALLOC;
-    upipe_avfsrc_check_upump_mgr(upipe);
-
-    struct uref *flow_def = uref_alloc_control(upipe_avfsrc->uref_mgr);
-    uref_flow_set_def(flow_def, "void.");
-    upipe_avfsrc_store_flow_def(upipe, flow_def);
-    /* Force sending flow def */
-    struct uref *uref = uref_alloc(upipe_avfsrc->uref_mgr);
-    upipe_avfsrc_output(upipe, uref, NULL);
+    UBASE_RETURN(upipe_avfsrc_init_flow_def(upipe))
 
     AVDictionary *options = NULL;
     av_dict_copy(&options, upipe_avfsrc->options, 0);
@@ -1061,6 +1281,134 @@ static int upipe_avfsrc_set_uri(struct upipe *upipe, const char *url)
     return UBASE_ERR_NONE;
 }
 
+/** @internal @This asks to demux the block flow received on the input.
+ *
+ * @param upipe description structure of the pipe
+ * @param format short name of the input format, or NULL to probe it
+ * @return an error code
+ */
+static int _upipe_avfsrc_open_input(struct upipe *upipe, const char *format)
+{
+    struct upipe_avfsrc *upipe_avfsrc = upipe_avfsrc_from_upipe(upipe);
+    AVInputFormat *io_format = NULL;
+    if (format != NULL) {
+        io_format = av_find_input_format(format);
+        if (unlikely(io_format == NULL)) {
+            upipe_err_va(upipe, "unknown input format %s", format);
+            return UBASE_ERR_INVALID;
+        }
+    }
+
+    UBASE_RETURN(upipe_avfsrc_set_uri(upipe, NULL))
+    UBASE_RETURN(upipe_avfsrc_init_flow_def(upipe))
+
+    upipe_avfsrc->context = avformat_alloc_context();
+    unsigned char *buffer = av_malloc(IO_BUFFER_SIZE);
+    if (buffer != NULL)
+        upipe_avfsrc->io = avio_alloc_context(buffer, IO_BUFFER_SIZE, 0,
+                                              upipe, upipe_avfsrc_io_read,
+                                              NULL, NULL);
+    if (unlikely(upipe_avfsrc->context == NULL || upipe_avfsrc->io == NULL)) {
+        if (upipe_avfsrc->io == NULL)
+            av_free(buffer);
+        avformat_free_context(upipe_avfsrc->context);
+        upipe_avfsrc->context = NULL;
+        upipe_avfsrc_clean_io(upipe);
+        return UBASE_ERR_ALLOC;
+    }
+
+    /* avformat_open_input() is deferred until the input is prebuffered */
+    upipe_avfsrc->io->seekable = 0;
+    upipe_avfsrc->io_format = io_format;
+    upipe_avfsrc->context->pb = upipe_avfsrc->io;
+    upipe_avfsrc->context->flags |= AVFMT_FLAG_CUSTOM_IO;
+    upipe_avfsrc->timestamp_offset = 0;
+    upipe_avfsrc->url = strdup(format != NULL ? format : "input");
+    upipe_avfsrc->probed = false;
+    upipe_notice_va(upipe, "opening input (%s)", upipe_avfsrc->url);
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This appends an input buffer to the data to be read by
+ * avformat, without copy.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref uref structure
+ * @param upump_p reference to pump that generated the buffer
+ * @return false if the input must be held
+ */
+static bool upipe_avfsrc_handle(struct upipe *upipe, struct uref *uref,
+                                struct upump **upump_p)
+{
+    struct upipe_avfsrc *upipe_avfsrc = upipe_avfsrc_from_upipe(upipe);
+    if (unlikely(upipe_avfsrc->io == NULL || upipe_avfsrc->io_end)) {
+        upipe_warn(upipe, "received input without opened input");
+        uref_free(uref);
+        return true;
+    }
+    if (upipe_avfsrc->io_size >= IO_HIGH_WATERMARK)
+        return false;
+
+    size_t size;
+    if (unlikely(uref->ubuf == NULL ||
+                 !ubase_check(uref_block_size(uref, &size)) || !size)) {
+        uref_free(uref);
+        return true;
+    }
+
+    struct ubuf *ubuf = uref_detach_ubuf(uref);
+    uref_free(uref);
+    if (upipe_avfsrc->io_ubuf == NULL)
+        upipe_avfsrc->io_ubuf = ubuf;
+    else if (unlikely(!ubase_check(ubuf_block_append(upipe_avfsrc->io_ubuf,
+                                                     ubuf)))) {
+        ubuf_free(ubuf);
+        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+        return true;
+    }
+    upipe_avfsrc->io_size += size;
+
+    if (upipe_avfsrc->upump == NULL && upipe_avfsrc_io_ready(upipe))
+        upipe_avfsrc_check(upipe);
+    return true;
+}
+
+/** @internal @This receives data to demux.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref uref structure
+ * @param upump_p reference to pump that generated the buffer
+ */
+static void upipe_avfsrc_input(struct upipe *upipe, struct uref *uref,
+                               struct upump **upump_p)
+{
+    if (!upipe_avfsrc_check_input(upipe)) {
+        upipe_avfsrc_hold_input(upipe, uref);
+        upipe_avfsrc_block_input(upipe, upump_p);
+    } else if (!upipe_avfsrc_handle(upipe, uref, upump_p)) {
+        upipe_avfsrc_hold_input(upipe, uref);
+        upipe_avfsrc_block_input(upipe, upump_p);
+        /* Increment upipe refcount to avoid disappearing before all packets
+         * have been read. */
+        upipe_use(upipe);
+    }
+}
+
+/** @internal @This sets the input flow definition.
+ *
+ * @param upipe description structure of the pipe
+ * @param flow_def flow definition packet
+ * @return an error code
+ */
+static int upipe_avfsrc_set_flow_def(struct upipe *upipe,
+                                     struct uref *flow_def)
+{
+    if (flow_def == NULL)
+        return UBASE_ERR_INVALID;
+    UBASE_RETURN(uref_flow_match_def(flow_def, "block."))
+    return UBASE_ERR_NONE;
+}
+
 /** @internal @This returns the time of the currently opened URL.
  *
  * @param upipe description structure of the pipe
@@ -1113,6 +1461,10 @@ static int _upipe_avfsrc_control(struct upipe *upipe,
             upipe_avfsrc_require_uclock(upipe);
             return UBASE_ERR_NONE;
 
+        case UPIPE_SET_FLOW_DEF: {
+            struct uref *flow_def = va_arg(args, struct uref *);
+            return upipe_avfsrc_set_flow_def(upipe, flow_def);
+        }
         case UPIPE_GET_FLOW_DEF:
         case UPIPE_GET_OUTPUT:
         case UPIPE_SET_OUTPUT:
@@ -1151,26 +1503,27 @@ static int _upipe_avfsrc_control(struct upipe *upipe,
             uint64_t time = va_arg(args, uint64_t);
             return _upipe_avfsrc_set_time(upipe, time);
         }
+        case UPIPE_AVFSRC_OPEN_INPUT: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_AVFSRC_SIGNATURE)
+            const char *format = va_arg(args, const char *);
+            return _upipe_avfsrc_open_input(upipe, format);
+        }
         default:
             return UBASE_ERR_UNHANDLED;
     }
 }
 
-/** @internal @This processes control commands on an avformat source pipe, and
- * checks the status of the pipe afterwards.
+/** @internal @This checks the status of the pipe, and starts probing or
+ * reading when possible.
  *
  * @param upipe description structure of the pipe
- * @param command type of command to process
- * @param args arguments of the command
  * @return an error code
  */
-static int upipe_avfsrc_control(struct upipe *upipe, int command, va_list args)
+static int upipe_avfsrc_check(struct upipe *upipe)
 {
-    UBASE_RETURN(_upipe_avfsrc_control(upipe, command, args));
-
     struct upipe_avfsrc *upipe_avfsrc = upipe_avfsrc_from_upipe(upipe);
     if (upipe_avfsrc->upump_mgr != NULL && upipe_avfsrc->url != NULL &&
-        upipe_avfsrc->upump == NULL) {
+        upipe_avfsrc->upump == NULL && upipe_avfsrc_io_ready(upipe)) {
         if (unlikely(upipe_avfsrc->probed))
             return upipe_avfsrc_start(upipe) ?
                    UBASE_ERR_NONE : UBASE_ERR_EXTERNAL;
@@ -1193,6 +1546,20 @@ static int upipe_avfsrc_control(struct upipe *upipe, int command, va_list args)
     return UBASE_ERR_NONE;
 }
 
+/** @internal @This processes control commands on an avformat source pipe, and
+ * checks the status of the pipe afterwards.
+ *
+ * @param upipe description structure of the pipe
+ * @param command type of command to process
+ * @param args arguments of the command
+ * @return an error code
+ */
+static int upipe_avfsrc_control(struct upipe *upipe, int command, va_list args)
+{
+    UBASE_RETURN(_upipe_avfsrc_control(upipe, command, args));
+    return upipe_avfsrc_check(upipe);
+}
+
 /** @This frees a upipe.
  *
  * @param urefcount_real pointer to urefcount_real structure
@@ -1215,11 +1582,14 @@ static void upipe_avfsrc_free(struct urefcount *urefcount_real)
 
         avformat_close_input(&upipe_avfsrc->context);
     }
+    upipe_avfsrc_clean_io(upipe);
     upipe_throw_dead(upipe);
 
     av_dict_free(&upipe_avfsrc->options);
     free(upipe_avfsrc->url);
+    ubuf_mgr_release(upipe_avfsrc->pkt_ubuf_mgr);
 
+    upipe_avfsrc_clean_input(upipe);
     upipe_avfsrc_clean_uclock(upipe);
     upipe_avfsrc_clean_upump(upipe);
     upipe_avfsrc_clean_upump_mgr(upipe);
@@ -1237,6 +1607,12 @@ static void upipe_avfsrc_free(struct urefcount *urefcount_real)
 static void upipe_avfsrc_no_input(struct upipe *upipe)
 {
     struct upipe_avfsrc *upipe_avfsrc = upipe_avfsrc_from_upipe(upipe);
+    if (upipe_avfsrc->io != NULL && upipe_avfsrc->probed &&
+        upipe_avfsrc->context != NULL) {
+        /* demux the remaining input */
+        upipe_avfsrc->io_end = true;
+        while (upipe_avfsrc_read(upipe) >= 0);
+    }
     upipe_avfsrc_throw_sub_subs(upipe, UPROBE_SOURCE_END);
     upipe_split_throw_update(upipe);
     urefcount_release(upipe_avfsrc_to_urefcount_real(upipe_avfsrc));
@@ -1315,7 +1691,7 @@ struct upipe_mgr *upipe_avfsrc_mgr_alloc(void)
     avfsrc_mgr->mgr.refcount = upipe_avfsrc_mgr_to_urefcount(avfsrc_mgr);
     avfsrc_mgr->mgr.signature = UPIPE_AVFSRC_SIGNATURE;
     avfsrc_mgr->mgr.upipe_alloc = upipe_avfsrc_alloc;
-    avfsrc_mgr->mgr.upipe_input = NULL;
+    avfsrc_mgr->mgr.upipe_input = upipe_avfsrc_input;
     avfsrc_mgr->mgr.upipe_control = upipe_avfsrc_control;
     avfsrc_mgr->mgr.upipe_mgr_control = upipe_avfsrc_mgr_control;
     return upipe_avfsrc_mgr_to_upipe_mgr(avfsrc_mgr);
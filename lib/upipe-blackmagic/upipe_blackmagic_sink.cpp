@@ -31,6 +31,8 @@
 #include <upipe/uatomic.h>
 #include <upipe/ulist.h>
 #include <upipe/uqueue.h>
+#include <upipe/umem.h>
+#include <upipe/ubuf_mem.h>
 #include <upipe/uprobe.h>
 #include <upipe/uclock.h>
 #include <upipe/uref.h>
@@ -56,6 +58,8 @@
 
 #include <arpa/inet.h>
 #include <assert.h>
+#include <sys/mman.h>
+#include <unistd.h>
 
 #include <libzvbi.h>
 
@@ -74,6 +78,11 @@ extern "C" {
 
 #define DECKLINK_CHANNELS 16
 
+/** number of pinned frame buffers kept for reuse */
+#define FRAME_POOL_DEPTH 16
+/** depth of the ubuf pools of the managers provided upstream */
+#define UBUF_POOL_DEPTH 16
+
 static const unsigned max_samples = (uint64_t)48000 * 1001 / 24000;
 static const size_t audio_buf_size = max_samples * DECKLINK_CHANNELS * sizeof(int32_t);
 
@@ -164,6 +173,229 @@ public:
     uint64_t pts;
 };
 
+/** @internal @This allocates page-aligned and locked frame buffers, which
+ * the card can read directly by DMA, and keeps the released ones for reuse,
+ * since pinning memory is expensive. */
+class upipe_bmd_sink_allocator : public IDeckLinkMemoryAllocator
+{
+public:
+    upipe_bmd_sink_allocator(void) : nb_buffers(0) {
+        uatomic_store(&refcount, 1);
+        pthread_mutex_init(&lock, NULL);
+        page_size = sysconf(_SC_PAGESIZE);
+    }
+
+    virtual ~upipe_bmd_sink_allocator(void) {
+        Decommit();
+        pthread_mutex_destroy(&lock);
+        uatomic_clean(&refcount);
+    }
+
+    /* the capacity of a buffer is stored in the page preceding it */
+    size_t GetCapacity(void *buffer) {
+        return *(size_t *)((uint8_t *)buffer - page_size);
+    }
+
+    virtual HRESULT AllocateBuffer(uint32_t bufferSize, void **allocatedBuffer) {
+        pthread_mutex_lock(&lock);
+        for (unsigned i = 0; i < nb_buffers; i++) {
+            if (GetCapacity(buffers[i]) >= bufferSize) {
+                *allocatedBuffer = buffers[i];
+                buffers[i] = buffers[--nb_buffers];
+                pthread_mutex_unlock(&lock);
+                return S_OK;
+            }
+        }
+        pthread_mutex_unlock(&lock);
+
+        void *base;
+        if (posix_memalign(&base, page_size, page_size + bufferSize))
+            return E_OUTOFMEMORY;
+        /* failing to pin only costs a bounce buffer in the driver */
+        mlock(base, page_size + bufferSize);
+        *(size_t *)base = bufferSize;
+        *allocatedBuffer = (uint8_t *)base + page_size;
+        return S_OK;
+    }
+
+    virtual HRESULT ReleaseBuffer(void *buffer) {
+        pthread_mutex_lock(&lock);
+        if (nb_buffers < FRAME_POOL_DEPTH) {
+            buffers[nb_buffers++] = buffer;
+            buffer = NULL;
+        }
+        pthread_mutex_unlock(&lock);
+
+        if (buffer != NULL)
+            Free(buffer);
+        return S_OK;
+    }
+
+    virtual HRESULT Commit(void) {
+        return S_OK;
+    }
+
+    virtual HRESULT Decommit(void) {
+        pthread_mutex_lock(&lock);
+        while (nb_buffers)
+            Free(buffers[--nb_buffers]);
+        pthread_mutex_unlock(&lock);
+        return S_OK;
+    }
+
+    virtual ULONG STDMETHODCALLTYPE AddRef(void) {
+        return uatomic_fetch_add(&refcount, 1) + 1;
+    }
+
+    virtual ULONG STDMETHODCALLTYPE Release(void) {
+        uint32_t new_ref = uatomic_fetch_sub(&refcount, 1) - 1;
+        if (new_ref == 0)
+            delete this;
+        return new_ref;
+    }
+
+    virtual HRESULT STDMETHODCALLTYPE QueryInterface(REFIID iid, LPVOID *ppv) {
+        return E_NOINTERFACE;
+    }
+
+private:
+    void Free(void *buffer) {
+        uint8_t *base = (uint8_t *)buffer - page_size;
+        munlock(base, page_size + GetCapacity(buffer));
+        free(base);
+    }
+
+    uatomic_uint32_t refcount;
+    pthread_mutex_t lock;
+    size_t page_size;
+
+    void *buffers[FRAME_POOL_DEPTH];
+    unsigned nb_buffers;
+};
+
+/** @internal @This is a umem manager allocating from the pinned frame
+ * buffers, so that upstream pipes render directly into them. */
+struct upipe_bmd_sink_umem_mgr {
+    /** refcount management structure */
+    struct urefcount urefcount;
+    /** common management structure */
+    struct umem_mgr mgr;
+    /** allocator of pinned buffers */
+    upipe_bmd_sink_allocator *allocator;
+};
+
+UBASE_FROM_TO(upipe_bmd_sink_umem_mgr, umem_mgr, umem_mgr, mgr)
+UBASE_FROM_TO(upipe_bmd_sink_umem_mgr, urefcount, urefcount, urefcount)
+
+/** @internal @This allocates a pinned buffer.
+ *
+ * @param mgr management structure
+ * @param umem caller-allocated structure
+ * @param size requested size of the umem
+ * @return false if the memory couldn't be allocated
+ */
+static bool upipe_bmd_sink_umem_alloc(struct umem_mgr *mgr, struct umem *umem,
+                                      size_t size)
+{
+    struct upipe_bmd_sink_umem_mgr *umem_mgr =
+        upipe_bmd_sink_umem_mgr_from_umem_mgr(mgr);
+    void *buffer;
+    if (unlikely(size > UINT32_MAX ||
+                 umem_mgr->allocator->AllocateBuffer(size, &buffer) != S_OK))
+        return false;
+
+    umem->buffer = (uint8_t *)buffer;
+    umem->size = size;
+    umem->real_size = umem_mgr->allocator->GetCapacity(buffer);
+    umem->mgr = mgr;
+    return true;
+}
+
+/** @internal @This resizes a pinned buffer.
+ *
+ * @param umem caller-allocated structure
+ * @param new_size new requested size of the umem
+ * @return false if the memory couldn't be allocated
+ */
+static bool upipe_bmd_sink_umem_realloc(struct umem *umem, size_t new_size)
+{
+    if (new_size <= umem->real_size) {
+        umem->size = new_size;
+        return true;
+    }
+
+    struct umem new_umem;
+    if (unlikely(!upipe_bmd_sink_umem_alloc(umem->mgr, &new_umem, new_size)))
+        return false;
+    memcpy(new_umem.buffer, umem->buffer, umem->size);
+    umem_free(umem);
+    *umem = new_umem;
+    return true;
+}
+
+/** @internal @This releases a pinned buffer.
+ *
+ * @param umem caller-allocated structure
+ */
+static void upipe_bmd_sink_umem_free(struct umem *umem)
+{
+    struct upipe_bmd_sink_umem_mgr *umem_mgr =
+        upipe_bmd_sink_umem_mgr_from_umem_mgr(umem->mgr);
+    umem_mgr->allocator->ReleaseBuffer(umem->buffer);
+    umem->buffer = NULL;
+    umem->mgr = NULL;
+}
+
+/** @internal @This releases the pinned buffers kept for reuse.
+ *
+ * @param mgr management structure
+ */
+static void upipe_bmd_sink_umem_mgr_vacuum(struct umem_mgr *mgr)
+{
+    struct upipe_bmd_sink_umem_mgr *umem_mgr =
+        upipe_bmd_sink_umem_mgr_from_umem_mgr(mgr);
+    umem_mgr->allocator->Decommit();
+}
+
+/** @internal @This frees the pinned umem manager.
+ *
+ * @param urefcount pointer to urefcount
+ */
+static void upipe_bmd_sink_umem_mgr_free(struct urefcount *urefcount)
+{
+    struct upipe_bmd_sink_umem_mgr *umem_mgr =
+        upipe_bmd_sink_umem_mgr_from_urefcount(urefcount);
+    umem_mgr->allocator->Release();
+    urefcount_clean(urefcount);
+    free(umem_mgr);
+}
+
+/** @internal @This allocates a umem manager on top of a pinned allocator.
+ *
+ * @param allocator allocator of pinned buffers
+ * @return pointer to manager, or NULL in case of error
+ */
+static struct umem_mgr *
+    upipe_bmd_sink_umem_mgr_alloc(upipe_bmd_sink_allocator *allocator)
+{
+    struct upipe_bmd_sink_umem_mgr *umem_mgr =
+        (struct upipe_bmd_sink_umem_mgr *)malloc(sizeof(*umem_mgr));
+    if (unlikely(umem_mgr == NULL))
+        return NULL;
+
+    allocator->AddRef();
+    umem_mgr->allocator = allocator;
+    urefcount_init(upipe_bmd_sink_umem_mgr_to_urefcount(umem_mgr),
+                   upipe_bmd_sink_umem_mgr_free);
+    umem_mgr->mgr.refcount = upipe_bmd_sink_umem_mgr_to_urefcount(umem_mgr);
+    umem_mgr->mgr.umem_alloc = upipe_bmd_sink_umem_alloc;
+    umem_mgr->mgr.umem_realloc = upipe_bmd_sink_umem_realloc;
+    umem_mgr->mgr.umem_free = upipe_bmd_sink_umem_free;
+    umem_mgr->mgr.umem_mgr_vacuum = upipe_bmd_sink_umem_mgr_vacuum;
+    umem_mgr->mgr.umem_mgr_control = NULL;
+    return upipe_bmd_sink_umem_mgr_to_umem_mgr(umem_mgr);
+}
+
 static float dur_to_time(int64_t dur)
 {
     return (float)dur / UCLOCK_FREQ;
@@ -309,6 +541,9 @@ struct upipe_bmd_sink {
 
     /** last frame output */
     upipe_bmd_sink_frame *video_frame;
+
+    /** umem manager of pinned frame buffers, provided upstream */
+    struct umem_mgr *umem_mgr;
 };
 
 UPIPE_HELPER_UPIPE(upipe_bmd_sink, upipe, UPIPE_BMD_SINK_SIGNATURE);
@@ -1195,6 +1430,41 @@ static int upipe_bmd_sink_sub_set_flow_def(struct upipe *upipe,
     return UBASE_ERR_NONE;
 }
 
+/** @internal @This provides the pic subpipe with a ubuf manager allocating
+ * pinned frame buffers, so that the pictures are scheduled without a copy.
+ * Other subpipes forward the request.
+ *
+ * @param upipe description structure of the subpipe
+ * @param request ubuf manager request
+ * @return an error code
+ */
+static int upipe_bmd_sink_sub_provide_ubuf_mgr(struct upipe *upipe,
+                                               struct urequest *request)
+{
+    struct upipe_bmd_sink *upipe_bmd_sink =
+        upipe_bmd_sink_from_sub_mgr(upipe->mgr);
+    struct upipe_bmd_sink_sub *upipe_bmd_sink_sub =
+        upipe_bmd_sink_sub_from_upipe(upipe);
+
+    if (upipe_bmd_sink_sub != &upipe_bmd_sink->pic_subpipe ||
+        upipe_bmd_sink->umem_mgr == NULL)
+        return upipe_throw_provide_request(upipe, request);
+
+    struct uref *flow_format = uref_dup(request->uref);
+    UBASE_ALLOC_RETURN(flow_format);
+    struct ubuf_mgr *ubuf_mgr =
+        ubuf_mem_mgr_alloc_from_flow_def(UBUF_POOL_DEPTH, UBUF_POOL_DEPTH,
+                                         upipe_bmd_sink->umem_mgr,
+                                         flow_format);
+    if (unlikely(ubuf_mgr == NULL)) {
+        uref_free(flow_format);
+        return upipe_throw_provide_request(upipe, request);
+    }
+
+    upipe_dbg(upipe, "providing pinned frame buffers");
+    return urequest_provide_ubuf_mgr(request, ubuf_mgr, flow_format);
+}
+
 /** @internal @This processes control commands on an output subpipe of an
  * bmd_sink pipe.
  *
@@ -1214,6 +1484,8 @@ static int upipe_bmd_sink_sub_control(struct upipe *upipe,
         }
         case UPIPE_REGISTER_REQUEST: {
             struct urequest *request = va_arg(args, struct urequest *);
+            if (request->type == UREQUEST_UBUF_MGR)
+                return upipe_bmd_sink_sub_provide_ubuf_mgr(upipe, request);
             return upipe_throw_provide_request(upipe, request);
         }
         case UPIPE_UNREGISTER_REQUEST:
@@ -1528,6 +1800,7 @@ static int upipe_bmd_sink_open_card(struct upipe *upipe)
 
     int err = UBASE_ERR_NONE;
     HRESULT result = E_NOINTERFACE;
+    upipe_bmd_sink_allocator *allocator;
 
     assert(!upipe_bmd_sink->deckLink);
 
@@ -1573,6 +1846,13 @@ static int upipe_bmd_sink_open_card(struct upipe *upipe)
                 upipe_bmd_sink->cb) != S_OK)
         upipe_err(upipe, "Could not set callback");
 
+    allocator = new upipe_bmd_sink_allocator();
+    if (upipe_bmd_sink->deckLinkOutput->SetVideoOutputFrameMemoryAllocator(
+                allocator) != S_OK)
+        upipe_err(upipe, "Could not set frame allocator");
+    upipe_bmd_sink->umem_mgr = upipe_bmd_sink_umem_mgr_alloc(allocator);
+    allocator->Release();
+
     upipe_bmd_sink->deckLink = deckLink;
 
 end:
@@ -1822,6 +2102,8 @@ static void upipe_bmd_sink_free(struct upipe *upipe)
         upipe_bmd_sink->deckLink->Release();
     }
 
+    umem_mgr_release(upipe_bmd_sink->umem_mgr);
+
     pthread_mutex_destroy(&upipe_bmd_sink->lock);
 
     if (upipe_bmd_sink->cb)
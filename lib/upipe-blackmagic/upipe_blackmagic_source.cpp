@@ -289,6 +289,19 @@ struct upipe_bmd_src {
     /** true if we have thrown the sync_acquired event */
     bool acquired;
 
+    /** number of video frames received - for use by the private thread */
+    uatomic_uint32_t pic_count;
+    /** number of video frames lost on queue overflow */
+    uatomic_uint32_t pic_dropped;
+    /** number of audio packets received - for use by the private thread */
+    uatomic_uint32_t sound_count;
+    /** number of audio packets lost on queue overflow */
+    uatomic_uint32_t sound_dropped;
+    /** number of lost video frames already reported */
+    uint32_t pic_dropped_reported;
+    /** number of lost audio packets already reported */
+    uint32_t sound_dropped_reported;
+
     /** public upipe structure */
     struct upipe upipe;
 
@@ -388,8 +401,10 @@ static int upipe_bmd_src_build_video(struct upipe *upipe,
 
     uref_attr_set_priv(flow_def, UPIPE_BMD_SRC_PIC);
 
-    if (unlikely(!uqueue_push(&upipe_bmd_src->uqueue, flow_def)))
+    if (unlikely(!uqueue_push(&upipe_bmd_src->uqueue, flow_def))) {
+        uatomic_fetch_add(&upipe_bmd_src->pic_dropped, 1);
         uref_free(flow_def);
+    }
     return UBASE_ERR_NONE;
 }
 
@@ -423,8 +438,10 @@ static int upipe_bmd_src_build_audio(struct upipe *upipe,
 
     uref_attr_set_priv(flow_def, UPIPE_BMD_SRC_SOUND);
 
-    if (unlikely(!uqueue_push(&upipe_bmd_src->uqueue, flow_def)))
+    if (unlikely(!uqueue_push(&upipe_bmd_src->uqueue, flow_def))) {
+        uatomic_fetch_add(&upipe_bmd_src->sound_dropped, 1);
         uref_free(flow_def);
+    }
     return UBASE_ERR_NONE;
 }
 
@@ -480,6 +497,7 @@ HRESULT DeckLinkCaptureDelegate::VideoInputFrameArrived(
         cr_sys = uclock_now(upipe_bmd_src->uclock);
 
     if (VideoFrame) {
+        uatomic_fetch_add(&upipe_bmd_src->pic_count, 1);
         struct ubuf *ubuf =
             ubuf_pic_bmd_alloc(upipe_bmd_src->pic_subpipe.ubuf_mgr, VideoFrame);
         if (likely(ubuf != NULL)) {
@@ -502,12 +520,15 @@ HRESULT DeckLinkCaptureDelegate::VideoInputFrameArrived(
             else if (upipe_bmd_src->tff)
                 uref_pic_set_tff(uref);
 
-            if (!uqueue_push(&upipe_bmd_src->uqueue, uref))
+            if (!uqueue_push(&upipe_bmd_src->uqueue, uref)) {
+                uatomic_fetch_add(&upipe_bmd_src->pic_dropped, 1);
                 uref_free(uref);
+            }
         }
     }
 
     if (AudioPacket) {
+        uatomic_fetch_add(&upipe_bmd_src->sound_count, 1);
         struct ubuf *ubuf =
             ubuf_sound_bmd_alloc(upipe_bmd_src->sound_subpipe.ubuf_mgr,
                                  AudioPacket);
@@ -525,8 +546,10 @@ HRESULT DeckLinkCaptureDelegate::VideoInputFrameArrived(
             uref_clock_set_duration(uref, AudioPacket->GetSampleFrameCount() *
                                           UCLOCK_FREQ / BMD_SAMPLERATE);
 
-            if (!uqueue_push(&upipe_bmd_src->uqueue, uref))
+            if (!uqueue_push(&upipe_bmd_src->uqueue, uref)) {
+                uatomic_fetch_add(&upipe_bmd_src->sound_dropped, 1);
                 uref_free(uref);
+            }
         }
     }
     return S_OK;
@@ -667,6 +690,12 @@ static struct upipe *_upipe_bmd_src_alloc(struct upipe_mgr *mgr,
     upipe_bmd_src->fps.num = 25;
     upipe_bmd_src->fps.den = 1;
     upipe_bmd_src->tff = true;
+    uatomic_init(&upipe_bmd_src->pic_count, 0);
+    uatomic_init(&upipe_bmd_src->pic_dropped, 0);
+    uatomic_init(&upipe_bmd_src->sound_count, 0);
+    uatomic_init(&upipe_bmd_src->sound_dropped, 0);
+    upipe_bmd_src->pic_dropped_reported = 0;
+    upipe_bmd_src->sound_dropped_reported = 0;
 
     upipe_throw_ready(upipe);
     return upipe;
@@ -772,6 +801,19 @@ static void upipe_bmd_src_work(struct upipe *upipe, struct upump *upump)
         upipe_throw_clock_ts(subpipe, uref);
         upipe_bmd_src_output_output(subpipe, uref, &upipe_bmd_src->upump);
     }
+
+    /* the capture thread cannot throw events, report its losses here */
+    uint32_t pic_dropped = uatomic_load(&upipe_bmd_src->pic_dropped);
+    uint32_t sound_dropped = uatomic_load(&upipe_bmd_src->sound_dropped);
+    if (unlikely(pic_dropped != upipe_bmd_src->pic_dropped_reported ||
+                 sound_dropped != upipe_bmd_src->sound_dropped_reported)) {
+        upipe_warn_va(upipe, "queue overflow, dropped %" PRIu32 " frames "
+                      "and %" PRIu32 " audio packets",
+                      pic_dropped - upipe_bmd_src->pic_dropped_reported,
+                      sound_dropped - upipe_bmd_src->sound_dropped_reported);
+        upipe_bmd_src->pic_dropped_reported = pic_dropped;
+        upipe_bmd_src->sound_dropped_reported = sound_dropped;
+    }
 }
 
 /** @internal @This reads data from the source and outputs it.
@@ -785,6 +827,24 @@ static void upipe_bmd_src_worker(struct upump *upump)
     upipe_bmd_src_work(upipe, upump);
 }
 
+/** @internal @This returns the capture statistics.
+ *
+ * @param upipe description structure of the pipe
+ * @param stats_p filled in with the counters
+ * @return an error code
+ */
+static int _upipe_bmd_src_get_stats(struct upipe *upipe,
+                                    struct upipe_bmd_src_stats *stats_p)
+{
+    struct upipe_bmd_src *upipe_bmd_src = upipe_bmd_src_from_upipe(upipe);
+    assert(stats_p != NULL);
+    stats_p->pic = uatomic_load(&upipe_bmd_src->pic_count);
+    stats_p->pic_dropped = uatomic_load(&upipe_bmd_src->pic_dropped);
+    stats_p->sound = uatomic_load(&upipe_bmd_src->sound_count);
+    stats_p->sound_dropped = uatomic_load(&upipe_bmd_src->sound_dropped);
+    return UBASE_ERR_NONE;
+}
+
 /** @internal @This returns a pointer to the current pseudo-output.
  *
  * @param upipe description structure of the pipe
@@ -1280,6 +1340,12 @@ static int _upipe_bmd_src_control(struct upipe *upipe,
                         upipe_bmd_src_from_upipe(upipe)));
             return UBASE_ERR_NONE;
         }
+        case UPIPE_BMD_SRC_GET_STATS: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_BMD_SRC_SIGNATURE)
+            struct upipe_bmd_src_stats *stats_p =
+                va_arg(args, struct upipe_bmd_src_stats *);
+            return _upipe_bmd_src_get_stats(upipe, stats_p);
+        }
         default:
             return UBASE_ERR_UNHANDLED;
     }
@@ -1336,6 +1402,10 @@ static void upipe_bmd_src_free(struct upipe *upipe)
         upipe_bmd_src->deckLink->Release();
     upipe_bmd_src_work(upipe, NULL);
     uqueue_clean(&upipe_bmd_src->uqueue);
+    uatomic_clean(&upipe_bmd_src->pic_count);
+    uatomic_clean(&upipe_bmd_src->pic_dropped);
+    uatomic_clean(&upipe_bmd_src->sound_count);
+    uatomic_clean(&upipe_bmd_src->sound_dropped);
 
     ubuf_mgr_release(upipe_bmd_src->pic_subpipe.ubuf_mgr);
     ubuf_mgr_release(upipe_bmd_src->sound_subpipe.ubuf_mgr);
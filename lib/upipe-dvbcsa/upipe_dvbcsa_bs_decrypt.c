@@ -29,6 +29,7 @@
 #include <upipe/upipe.h>
 #include <upipe/upump.h>
 #include <upipe/uclock.h>
+#include <upipe/ueventfd.h>
 #include <upipe/uref_block.h>
 #include <upipe/uref_clock.h>
 
@@ -44,6 +45,9 @@
 #include <bitstream/mpeg/ts.h>
 #include <dvbcsa/dvbcsa.h>
 
+#include <stdlib.h>
+#include <pthread.h>
+
 #include "common.h"
 
 /** expected input flow format */
@@ -53,6 +57,63 @@
 
 /** @hidden */
 static void upipe_dvbcsa_bs_dec_worker(struct upump *upump);
+/** @hidden */
+static void upipe_dvbcsa_bs_dec_watcher(struct upump *upump);
+
+/** @This enumerates the states of a batch handed over to the threads. */
+enum upipe_dvbcsa_bs_dec_job_state {
+    /** waiting for a thread */
+    UPIPE_DVBCSA_BS_DEC_JOB_QUEUED,
+    /** being decrypted by a thread */
+    UPIPE_DVBCSA_BS_DEC_JOB_RUNNING,
+    /** decrypted */
+    UPIPE_DVBCSA_BS_DEC_JOB_DONE,
+};
+
+/** @This is a batch handed over to the decryption threads. */
+struct upipe_dvbcsa_bs_dec_job {
+    /** link into the list of jobs */
+    struct uchain uchain;
+    /** state, protected by the pool mutex */
+    enum upipe_dvbcsa_bs_dec_job_state state;
+    /** dvbcsa key */
+    dvbcsa_bs_key_t *key;
+    /** batch items */
+    struct dvbcsa_bs_batch_s *batch;
+    /** mapped urefs */
+    struct uref **mapped;
+    /** number of batch items */
+    unsigned nb;
+};
+
+/** @hidden */
+UBASE_FROM_TO(upipe_dvbcsa_bs_dec_job, uchain, uchain, uchain);
+
+/** @This is the pool of decryption threads. The jobs are queued and removed
+ * by the event loop, in the order of the input packets. */
+struct upipe_dvbcsa_bs_dec_pool {
+    /** mutex protecting the fields below */
+    pthread_mutex_t mutex;
+    /** condition signalled to the threads when a job is queued */
+    pthread_cond_t cond;
+    /** condition signalled by the threads when no job is left */
+    pthread_cond_t idle;
+    /** list of jobs, in input order */
+    struct uchain jobs;
+    /** number of jobs not decrypted yet */
+    unsigned int nb_busy;
+    /** true if the threads must exit */
+    bool exit;
+
+    /** event signalled by the threads when a job is decrypted */
+    struct ueventfd event;
+    /** list of unused jobs, only accessed by the event loop */
+    struct uchain free_jobs;
+    /** number of threads */
+    unsigned int nb_threads;
+    /** threads */
+    pthread_t threads[];
+};
 
 /** @This is the private structure of dvbcsa decryption pipe. */
 struct upipe_dvbcsa_bs_dec {
@@ -76,6 +137,10 @@ struct upipe_dvbcsa_bs_dec {
     struct upump_mgr *upump_mgr;
     /** upump */
     struct upump *upump;
+    /** watcher of the decryption threads */
+    struct upump *event_upump;
+    /** pool of decryption threads, or NULL */
+    struct upipe_dvbcsa_bs_dec_pool *pool;
     /** list of retained urefs */
     struct uchain urefs;
     /** number of retained urefs */
@@ -117,9 +182,142 @@ UPIPE_HELPER_UCLOCK(upipe_dvbcsa_bs_dec, uclock, uclock_request,
                     upipe_dvbcsa_bs_dec_unregister_output_request);
 UPIPE_HELPER_UPUMP_MGR(upipe_dvbcsa_bs_dec, upump_mgr);
 UPIPE_HELPER_UPUMP(upipe_dvbcsa_bs_dec, upump, upump_mgr);
+UPIPE_HELPER_UPUMP(upipe_dvbcsa_bs_dec, event_upump, upump_mgr);
 UPIPE_HELPER_INPUT(upipe_dvbcsa_bs_dec, urefs, nb_urefs, max_urefs, blockers,
                    NULL);
 
+/** @internal @This is the main loop of a decryption thread.
+ *
+ * @param arg pointer to the pool of decryption threads
+ * @return NULL
+ */
+static void *upipe_dvbcsa_bs_dec_thread(void *arg)
+{
+    struct upipe_dvbcsa_bs_dec_pool *pool = arg;
+
+    pthread_mutex_lock(&pool->mutex);
+    for ( ; ; ) {
+        struct upipe_dvbcsa_bs_dec_job *job = NULL;
+        struct uchain *uchain;
+        ulist_foreach(&pool->jobs, uchain) {
+            struct upipe_dvbcsa_bs_dec_job *item =
+                upipe_dvbcsa_bs_dec_job_from_uchain(uchain);
+            if (item->state == UPIPE_DVBCSA_BS_DEC_JOB_QUEUED) {
+                job = item;
+                break;
+            }
+        }
+
+        if (job == NULL) {
+            if (pool->exit)
+                break;
+            pthread_cond_wait(&pool->cond, &pool->mutex);
+            continue;
+        }
+
+        job->state = UPIPE_DVBCSA_BS_DEC_JOB_RUNNING;
+        pthread_mutex_unlock(&pool->mutex);
+
+        dvbcsa_bs_decrypt(job->key, job->batch, 184);
+
+        pthread_mutex_lock(&pool->mutex);
+        job->state = UPIPE_DVBCSA_BS_DEC_JOB_DONE;
+        if (!--pool->nb_busy)
+            pthread_cond_broadcast(&pool->idle);
+        ueventfd_write(&pool->event);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+    return NULL;
+}
+
+/** @internal @This frees a job.
+ *
+ * @param job job to free
+ */
+static void upipe_dvbcsa_bs_dec_job_free(struct upipe_dvbcsa_bs_dec_job *job)
+{
+    free(job->batch);
+    free(job->mapped);
+    free(job);
+}
+
+/** @internal @This stops the decryption threads. The jobs must all have
+ * been collected.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_dvbcsa_bs_dec_stop_pool(struct upipe *upipe)
+{
+    struct upipe_dvbcsa_bs_dec *upipe_dvbcsa_bs_dec =
+        upipe_dvbcsa_bs_dec_from_upipe(upipe);
+    struct upipe_dvbcsa_bs_dec_pool *pool = upipe_dvbcsa_bs_dec->pool;
+    if (pool == NULL)
+        return;
+
+    upipe_dvbcsa_bs_dec_set_event_upump(upipe, NULL);
+    upipe_dvbcsa_bs_dec->pool = NULL;
+
+    pthread_mutex_lock(&pool->mutex);
+    pool->exit = true;
+    pthread_cond_broadcast(&pool->cond);
+    pthread_mutex_unlock(&pool->mutex);
+    for (unsigned int i = 0; i < pool->nb_threads; i++)
+        pthread_join(pool->threads[i], NULL);
+
+    struct uchain *uchain;
+    while ((uchain = ulist_pop(&pool->free_jobs)))
+        upipe_dvbcsa_bs_dec_job_free(
+            upipe_dvbcsa_bs_dec_job_from_uchain(uchain));
+    ueventfd_clean(&pool->event);
+    pthread_cond_destroy(&pool->idle);
+    pthread_cond_destroy(&pool->cond);
+    pthread_mutex_destroy(&pool->mutex);
+    free(pool);
+}
+
+/** @internal @This starts the decryption threads.
+ *
+ * @param upipe description structure of the pipe
+ * @param nb_threads number of threads
+ * @return an error code
+ */
+static int upipe_dvbcsa_bs_dec_start_pool(struct upipe *upipe,
+                                          unsigned int nb_threads)
+{
+    struct upipe_dvbcsa_bs_dec *upipe_dvbcsa_bs_dec =
+        upipe_dvbcsa_bs_dec_from_upipe(upipe);
+    struct upipe_dvbcsa_bs_dec_pool *pool =
+        malloc(sizeof (struct upipe_dvbcsa_bs_dec_pool) +
+               nb_threads * sizeof (pthread_t));
+    UBASE_ALLOC_RETURN(pool);
+    if (unlikely(!ueventfd_init(&pool->event, false))) {
+        free(pool);
+        return UBASE_ERR_EXTERNAL;
+    }
+
+    pthread_mutex_init(&pool->mutex, NULL);
+    pthread_cond_init(&pool->cond, NULL);
+    pthread_cond_init(&pool->idle, NULL);
+    ulist_init(&pool->jobs);
+    ulist_init(&pool->free_jobs);
+    pool->nb_busy = 0;
+    pool->exit = false;
+    pool->nb_threads = 0;
+    upipe_dvbcsa_bs_dec->pool = pool;
+
+    for (unsigned int i = 0; i < nb_threads; i++) {
+        if (unlikely(pthread_create(&pool->threads[i], NULL,
+                                    upipe_dvbcsa_bs_dec_thread, pool))) {
+            upipe_err(upipe, "unable to create decryption thread");
+            upipe_dvbcsa_bs_dec_stop_pool(upipe);
+            return UBASE_ERR_EXTERNAL;
+        }
+        pool->nb_threads++;
+    }
+    upipe_dbg_va(upipe, "decrypting with %u threads", nb_threads);
+    return UBASE_ERR_NONE;
+}
+
 /** @internal @This frees a dvbcsa decription pipe.
  *
  * @param upipe description structure of the pipe
@@ -135,10 +333,12 @@ static void upipe_dvbcsa_bs_dec_free(struct upipe *upipe)
 
     for (unsigned i = 0; i < upipe_dvbcsa_bs_dec->current; i++)
         uref_block_unmap(upipe_dvbcsa_bs_dec->mapped[i], 0);
+    upipe_dvbcsa_bs_dec_stop_pool(upipe);
     dvbcsa_bs_key_free(upipe_dvbcsa_bs_dec->key);
     free(upipe_dvbcsa_bs_dec->mapped);
     free(upipe_dvbcsa_bs_dec->batch);
     upipe_dvbcsa_common_clean(common);
+    upipe_dvbcsa_bs_dec_clean_event_upump(upipe);
     upipe_dvbcsa_bs_dec_clean_upump(upipe);
     upipe_dvbcsa_bs_dec_clean_upump_mgr(upipe);
     upipe_dvbcsa_bs_dec_clean_uclock(upipe);
@@ -176,8 +376,10 @@ static struct upipe *upipe_dvbcsa_bs_dec_alloc(struct upipe_mgr *mgr,
     upipe_dvbcsa_bs_dec_init_uclock(upipe);
     upipe_dvbcsa_bs_dec_init_upump_mgr(upipe);
     upipe_dvbcsa_bs_dec_init_upump(upipe);
+    upipe_dvbcsa_bs_dec_init_event_upump(upipe);
     upipe_dvbcsa_common_init(common);
     upipe_dvbcsa_bs_dec->key = NULL;
+    upipe_dvbcsa_bs_dec->pool = NULL;
     unsigned bs_size = dvbcsa_bs_batch_size();
     upipe_dvbcsa_bs_dec->batch_size = bs_size;
     upipe_dvbcsa_bs_dec->batch = malloc((bs_size + 1) *
@@ -218,48 +420,190 @@ static int upipe_dvbcsa_bs_dec_set_flow_def_real(struct upipe *upipe,
     return UBASE_ERR_NONE;
 }
 
-/** @internal @This flushes the retained urefs.
+/** @internal @This decrypts the current batch, or hands it over to the
+ * decryption threads.
  *
  * @param upipe description structure of the pipe
  */
-static void upipe_dvbcsa_bs_dec_flush(struct upipe *upipe,
-                                      struct upump **upump_p)
+static void upipe_dvbcsa_bs_dec_decrypt(struct upipe *upipe)
 {
     struct upipe_dvbcsa_bs_dec *upipe_dvbcsa_bs_dec =
         upipe_dvbcsa_bs_dec_from_upipe(upipe);
+    struct upipe_dvbcsa_bs_dec_pool *pool = upipe_dvbcsa_bs_dec->pool;
+    unsigned current = upipe_dvbcsa_bs_dec->current;
+    if (!current)
+        return;
 
-    upipe_dvbcsa_bs_dec_set_upump(upipe, NULL);
+    upipe_dvbcsa_bs_dec->current = 0;
+    upipe_dvbcsa_bs_dec->batch[current].data = NULL;
+    upipe_dvbcsa_bs_dec->batch[current].len = 0;
+
+    if (pool != NULL && upipe_dvbcsa_bs_dec->event_upump != NULL) {
+        struct upipe_dvbcsa_bs_dec_job *job;
+        struct uchain *uchain = ulist_pop(&pool->free_jobs);
+        if (uchain != NULL)
+            job = upipe_dvbcsa_bs_dec_job_from_uchain(uchain);
+        else {
+            unsigned bs_size = upipe_dvbcsa_bs_dec->batch_size;
+            job = malloc(sizeof (struct upipe_dvbcsa_bs_dec_job));
+            if (likely(job != NULL)) {
+                job->batch = malloc((bs_size + 1) *
+                                    sizeof (struct dvbcsa_bs_batch_s));
+                job->mapped = malloc(bs_size * sizeof (struct uref *));
+                if (unlikely(!job->batch || !job->mapped)) {
+                    upipe_dvbcsa_bs_dec_job_free(job);
+                    job = NULL;
+                }
+            }
+        }
 
-    /* descramble remaining packets */
-    unsigned current = upipe_dvbcsa_bs_dec->current;
-    if (current) {
-        upipe_dvbcsa_bs_dec->current = 0;
-        upipe_dvbcsa_bs_dec->batch[current].data = NULL;
-        upipe_dvbcsa_bs_dec->batch[current].len = 0;
-        uint64_t before = uclock_now(upipe_dvbcsa_bs_dec->uclock);
-        dvbcsa_bs_decrypt(upipe_dvbcsa_bs_dec->key,
-                          upipe_dvbcsa_bs_dec->batch, 184);
-        uint64_t after = uclock_now(upipe_dvbcsa_bs_dec->uclock);
-        if ((after - before) > DVBCSA_LATENCY)
-            upipe_warn_va(upipe, "dvbcsa latency too high %"PRIu64 "ms",
-                          (after - before) / (UCLOCK_FREQ / 1000));
-        for (unsigned i = 0; i < current; i++)
-            uref_block_unmap(upipe_dvbcsa_bs_dec->mapped[i], 0);
+        if (likely(job != NULL)) {
+            /* swap the batch with the one of the job */
+            struct dvbcsa_bs_batch_s *batch = job->batch;
+            struct uref **mapped = job->mapped;
+            job->batch = upipe_dvbcsa_bs_dec->batch;
+            job->mapped = upipe_dvbcsa_bs_dec->mapped;
+            job->nb = current;
+            job->key = upipe_dvbcsa_bs_dec->key;
+            job->state = UPIPE_DVBCSA_BS_DEC_JOB_QUEUED;
+            upipe_dvbcsa_bs_dec->batch = batch;
+            upipe_dvbcsa_bs_dec->mapped = mapped;
+
+            pthread_mutex_lock(&pool->mutex);
+            ulist_add(&pool->jobs, &job->uchain);
+            pool->nb_busy++;
+            pthread_cond_signal(&pool->cond);
+            pthread_mutex_unlock(&pool->mutex);
+            return;
+        }
+        upipe_warn(upipe, "unable to allocate job, decrypting in place");
     }
 
-    /* output */
-    struct uref *uref;
-    while ((uref = upipe_dvbcsa_bs_dec_pop_input(upipe)))
+    uint64_t before = uclock_now(upipe_dvbcsa_bs_dec->uclock);
+    dvbcsa_bs_decrypt(upipe_dvbcsa_bs_dec->key,
+                      upipe_dvbcsa_bs_dec->batch, 184);
+    uint64_t after = uclock_now(upipe_dvbcsa_bs_dec->uclock);
+    if ((after - before) > DVBCSA_LATENCY)
+        upipe_warn_va(upipe, "dvbcsa latency too high %"PRIu64 "ms",
+                      (after - before) / (UCLOCK_FREQ / 1000));
+    for (unsigned i = 0; i < current; i++)
+        uref_block_unmap(upipe_dvbcsa_bs_dec->mapped[i], 0);
+}
+
+/** @internal @This collects the decrypted jobs, in input order.
+ *
+ * @param upipe description structure of the pipe
+ * @param wait true to wait for all jobs to be decrypted
+ */
+static void upipe_dvbcsa_bs_dec_collect(struct upipe *upipe, bool wait)
+{
+    struct upipe_dvbcsa_bs_dec *upipe_dvbcsa_bs_dec =
+        upipe_dvbcsa_bs_dec_from_upipe(upipe);
+    struct upipe_dvbcsa_bs_dec_pool *pool = upipe_dvbcsa_bs_dec->pool;
+    if (pool == NULL)
+        return;
+
+    struct uchain done;
+    ulist_init(&done);
+    pthread_mutex_lock(&pool->mutex);
+    while (wait && pool->nb_busy)
+        pthread_cond_wait(&pool->idle, &pool->mutex);
+    struct uchain *uchain;
+    while ((uchain = ulist_peek(&pool->jobs))) {
+        struct upipe_dvbcsa_bs_dec_job *job =
+            upipe_dvbcsa_bs_dec_job_from_uchain(uchain);
+        if (job->state != UPIPE_DVBCSA_BS_DEC_JOB_DONE)
+            break;
+        ulist_pop(&pool->jobs);
+        ulist_add(&done, uchain);
+    }
+    pthread_mutex_unlock(&pool->mutex);
+
+    while ((uchain = ulist_pop(&done))) {
+        struct upipe_dvbcsa_bs_dec_job *job =
+            upipe_dvbcsa_bs_dec_job_from_uchain(uchain);
+        for (unsigned i = 0; i < job->nb; i++)
+            uref_block_unmap(job->mapped[i], 0);
+        ulist_add(&pool->free_jobs, uchain);
+    }
+}
+
+/** @internal @This outputs the retained urefs up to the first packet that
+ * is not decrypted yet.
+ *
+ * @param upipe description structure of the pipe
+ * @param upump_p reference to pump that generated the buffer
+ */
+static void upipe_dvbcsa_bs_dec_forward(struct upipe *upipe,
+                                        struct upump **upump_p)
+{
+    struct upipe_dvbcsa_bs_dec *upipe_dvbcsa_bs_dec =
+        upipe_dvbcsa_bs_dec_from_upipe(upipe);
+    struct upipe_dvbcsa_bs_dec_pool *pool = upipe_dvbcsa_bs_dec->pool;
+    if (upipe_dvbcsa_bs_dec_check_input(upipe))
+        return;
+
+    /* first packet still mapped */
+    struct uref *pending = NULL;
+    if (pool != NULL) {
+        pthread_mutex_lock(&pool->mutex);
+        struct uchain *uchain = ulist_peek(&pool->jobs);
+        if (uchain != NULL)
+            pending = upipe_dvbcsa_bs_dec_job_from_uchain(uchain)->mapped[0];
+        pthread_mutex_unlock(&pool->mutex);
+    }
+    if (pending == NULL && upipe_dvbcsa_bs_dec->current)
+        pending = upipe_dvbcsa_bs_dec->mapped[0];
+
+    struct uchain *uchain;
+    while ((uchain = ulist_peek(&upipe_dvbcsa_bs_dec->urefs))) {
+        struct uref *uref = uref_from_uchain(uchain);
+        if (uref == pending)
+            return;
+
+        uref = upipe_dvbcsa_bs_dec_pop_input(upipe);
         if (unlikely(ubase_check(uref_flow_get_def(uref, NULL))))
             /* handle flow format */
             upipe_dvbcsa_bs_dec_set_flow_def_real(upipe, uref);
         else
             upipe_dvbcsa_bs_dec_output(upipe, uref, upump_p);
+    }
 
     /* no more buffered urefs */
     upipe_release(upipe);
 }
 
+/** @internal @This flushes the retained urefs.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_dvbcsa_bs_dec_flush(struct upipe *upipe,
+                                      struct upump **upump_p)
+{
+    upipe_dvbcsa_bs_dec_set_upump(upipe, NULL);
+
+    /* descramble remaining packets */
+    upipe_dvbcsa_bs_dec_decrypt(upipe);
+    upipe_dvbcsa_bs_dec_collect(upipe, false);
+
+    /* output */
+    upipe_dvbcsa_bs_dec_forward(upipe, upump_p);
+}
+
+/** @internal @This decrypts and outputs all the retained urefs, waiting for
+ * the decryption threads if needed.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_dvbcsa_bs_dec_drain(struct upipe *upipe,
+                                      struct upump **upump_p)
+{
+    upipe_dvbcsa_bs_dec_set_upump(upipe, NULL);
+    upipe_dvbcsa_bs_dec_decrypt(upipe);
+    upipe_dvbcsa_bs_dec_collect(upipe, true);
+    upipe_dvbcsa_bs_dec_forward(upipe, upump_p);
+}
+
 /** @internal @This is called when the upump triggers.
  *
  * @param upump timer
@@ -270,6 +614,22 @@ static void upipe_dvbcsa_bs_dec_worker(struct upump *upump)
     return upipe_dvbcsa_bs_dec_flush(upipe, &upump);
 }
 
+/** @internal @This is called when the decryption threads have decrypted
+ * a batch.
+ *
+ * @param upump description structure of the watcher
+ */
+static void upipe_dvbcsa_bs_dec_watcher(struct upump *upump)
+{
+    struct upipe *upipe = upump_get_opaque(upump, struct upipe *);
+    struct upipe_dvbcsa_bs_dec *upipe_dvbcsa_bs_dec =
+        upipe_dvbcsa_bs_dec_from_upipe(upipe);
+
+    ueventfd_read(&upipe_dvbcsa_bs_dec->pool->event);
+    upipe_dvbcsa_bs_dec_collect(upipe, false);
+    upipe_dvbcsa_bs_dec_forward(upipe, &upump);
+}
+
 /** @internal @This handles the input buffers.
  *
  * @param upipe description structure of the pipe
@@ -298,7 +658,7 @@ static void upipe_dvbcsa_bs_dec_input(struct upipe *upipe,
     /* output if no dvbcsa key set */
     if (unlikely(!upipe_dvbcsa_bs_dec->key)) {
         if (unlikely(!first))
-            upipe_dvbcsa_bs_dec_flush(upipe, upump_p);
+            upipe_dvbcsa_bs_dec_drain(upipe, upump_p);
         upipe_dvbcsa_bs_dec_output(upipe, uref, upump_p);
         return;
     }
@@ -364,6 +724,7 @@ static void upipe_dvbcsa_bs_dec_input(struct upipe *upipe,
     }
 
     unsigned current = upipe_dvbcsa_bs_dec->current;
+    bool start = !current && !upipe_dvbcsa_bs_dec->upump;
     upipe_dvbcsa_bs_dec->batch[current].data = ts + ts_header_size;
     upipe_dvbcsa_bs_dec->batch[current].len = size - ts_header_size;
     upipe_dvbcsa_bs_dec->mapped[current] = uref;
@@ -372,12 +733,12 @@ static void upipe_dvbcsa_bs_dec_input(struct upipe *upipe,
 
     /* hold uref */
     upipe_dvbcsa_bs_dec_hold_input(upipe, uref);
-    if (unlikely(first)) {
+    if (unlikely(first))
         /* make sure to send all buffered urefs */
         upipe_use(upipe);
+    if (unlikely(start))
         upipe_dvbcsa_bs_dec_wait_upump(upipe, common->latency,
                                        upipe_dvbcsa_bs_dec_worker);
-    }
 
     /* descramble if we have enough buffered scrambled TS packets */
     if (upipe_dvbcsa_bs_dec->current >= upipe_dvbcsa_bs_dec->batch_size)
@@ -401,6 +762,17 @@ static int upipe_dvbcsa_bs_dec_check(struct upipe *upipe, struct uref *flow_def)
     if (unlikely(!upipe_dvbcsa_bs_dec->upump_mgr))
         return UBASE_ERR_NONE;
 
+    struct upipe_dvbcsa_bs_dec_pool *pool = upipe_dvbcsa_bs_dec->pool;
+    if (pool != NULL && upipe_dvbcsa_bs_dec->event_upump == NULL) {
+        struct upump *upump =
+            ueventfd_upump_alloc(&pool->event, upipe_dvbcsa_bs_dec->upump_mgr,
+                                 upipe_dvbcsa_bs_dec_watcher, upipe,
+                                 upipe->refcount);
+        UBASE_ALLOC_RETURN(upump);
+        upipe_dvbcsa_bs_dec_set_event_upump(upipe, upump);
+        upump_start(upump);
+    }
+
     return UBASE_ERR_NONE;
 }
 
@@ -431,6 +803,8 @@ static int upipe_dvbcsa_bs_dec_set_key(struct upipe *upipe, const char *key)
     struct upipe_dvbcsa_bs_dec *upipe_dvbcsa_bs_dec =
         upipe_dvbcsa_bs_dec_from_upipe(upipe);
 
+    /* decrypt the retained packets with the previous key */
+    upipe_dvbcsa_bs_dec_drain(upipe, NULL);
     dvbcsa_bs_key_free(upipe_dvbcsa_bs_dec->key);
     upipe_dvbcsa_bs_dec->key = NULL;
 
@@ -448,6 +822,28 @@ static int upipe_dvbcsa_bs_dec_set_key(struct upipe *upipe, const char *key)
     return UBASE_ERR_NONE;
 }
 
+/** @internal @This sets the number of decryption threads.
+ *
+ * @param upipe description structure of the pipe
+ * @param nb_threads number of threads, or 0 to decrypt in the pipe thread
+ * @return an error code
+ */
+static int upipe_dvbcsa_bs_dec_set_nb_threads(struct upipe *upipe,
+                                              unsigned int nb_threads)
+{
+    struct upipe_dvbcsa_bs_dec *upipe_dvbcsa_bs_dec =
+        upipe_dvbcsa_bs_dec_from_upipe(upipe);
+    struct upipe_dvbcsa_bs_dec_pool *pool = upipe_dvbcsa_bs_dec->pool;
+    if ((pool != NULL ? pool->nb_threads : 0) == nb_threads)
+        return UBASE_ERR_NONE;
+
+    upipe_dvbcsa_bs_dec_drain(upipe, NULL);
+    upipe_dvbcsa_bs_dec_stop_pool(upipe);
+    if (!nb_threads)
+        return UBASE_ERR_NONE;
+    return upipe_dvbcsa_bs_dec_start_pool(upipe, nb_threads);
+}
+
 /** @internal @This handles the pipe control commands.
  *
  * @param upipe description structure of the pipe
@@ -468,6 +864,7 @@ static int upipe_dvbcsa_bs_dec_control_real(struct upipe *upipe,
 
     switch (command) {
         case UPIPE_ATTACH_UPUMP_MGR:
+            upipe_dvbcsa_bs_dec_set_event_upump(upipe, NULL);
             return upipe_dvbcsa_bs_dec_attach_upump_mgr(upipe);
 
         case UPIPE_SET_FLOW_DEF: {
@@ -480,6 +877,11 @@ static int upipe_dvbcsa_bs_dec_control_real(struct upipe *upipe,
             const char *key = va_arg(args, const char *);
             return upipe_dvbcsa_bs_dec_set_key(upipe, key);
         }
+        case UPIPE_DVBCSA_BS_DEC_SET_THREADS: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_DVBCSA_BS_DEC_SIGNATURE);
+            unsigned int nb_threads = va_arg(args, unsigned int);
+            return upipe_dvbcsa_bs_dec_set_nb_threads(upipe, nb_threads);
+        }
         case UPIPE_DVBCSA_ADD_PID:
         case UPIPE_DVBCSA_DEL_PID:
         case UPIPE_DVBCSA_SET_MAX_LATENCY:
@@ -43,6 +43,9 @@
 
 #include <bitstream/mpeg/ts.h>
 
+#include <stdlib.h>
+#include <string.h>
+
 #include "common.h"
 
 /** expected input flow format */
@@ -52,6 +55,47 @@
 /** Approximation worst dvbcsa encrypt latency on normal hardware (20ms) */
 #define DVBCSA_LATENCY  (UCLOCK_FREQ / 50)
 
+/** @internal @This is the management structure of dvbcsa encryption pipes. */
+struct upipe_dvbcsa_bs_enc_mgr {
+    /** refcount management structure */
+    struct urefcount urefcount;
+    /** list of shared batches */
+    struct uchain batches;
+    /** public upipe_mgr structure */
+    struct upipe_mgr mgr;
+};
+
+/** @hidden */
+UBASE_FROM_TO(upipe_dvbcsa_bs_enc_mgr, upipe_mgr, upipe_mgr, mgr);
+/** @hidden */
+UBASE_FROM_TO(upipe_dvbcsa_bs_enc_mgr, urefcount, urefcount, urefcount);
+
+/** @internal @This is a batch shared by the encryption pipes of a manager
+ * using the same control word. */
+struct upipe_dvbcsa_bs_enc_batch {
+    /** link into the list of shared batches */
+    struct uchain uchain;
+    /** number of users */
+    unsigned int refcount;
+    /** list of pipes using the batch */
+    struct uchain pipes;
+    /** control word */
+    dvbcsa_cw_t cw;
+    /** encryption key */
+    dvbcsa_bs_key_t *key;
+    /** maximum number of packets per batch */
+    unsigned size;
+    /** batch items */
+    struct dvbcsa_bs_batch_s *items;
+    /** batch current item */
+    unsigned current;
+    /** mapped list */
+    struct uref **mapped;
+};
+
+/** @hidden */
+UBASE_FROM_TO(upipe_dvbcsa_bs_enc_batch, uchain, uchain, uchain);
+
 /** @internal @This is the private structure of dvbcsa encryption pipe. */
 struct upipe_dvbcsa_bs_enc {
     /** public pipe structure */
@@ -82,22 +126,18 @@ struct upipe_dvbcsa_bs_enc {
     struct upump_mgr *upump_mgr;
     /** timer */
     struct upump *upump;
-    /** encryption batch size */
-    unsigned batch_size;
-    /** encryption key */
-    dvbcsa_bs_key_t *key;
-    /** batch list */
-    struct dvbcsa_bs_batch_s *batch;
-    /** batch current item */
-    unsigned current;
-    /** mapped list */
-    struct uref **mapped;
+    /** shared batch, or NULL if no key is set */
+    struct upipe_dvbcsa_bs_enc_batch *batch;
+    /** link into the list of pipes using the batch */
+    struct uchain uchain;
     /** common dvbcsa structure */
     struct upipe_dvbcsa_common common;
 };
 
 /** @hidden */
 UBASE_FROM_TO(upipe_dvbcsa_bs_enc, upipe_dvbcsa_common, common, common);
+/** @hidden */
+UBASE_FROM_TO(upipe_dvbcsa_bs_enc, uchain, uchain, uchain);
 
 /** @hidden */
 static int upipe_dvbcsa_bs_enc_check(struct upipe *upipe,
@@ -118,6 +158,71 @@ UPIPE_HELPER_UCLOCK(upipe_dvbcsa_bs_enc, uclock, uclock_request,
 UPIPE_HELPER_UPUMP_MGR(upipe_dvbcsa_bs_enc, upump_mgr);
 UPIPE_HELPER_UPUMP(upipe_dvbcsa_bs_enc, upump, upump_mgr);
 
+/** @internal @This returns the shared batch for a control word, and allocates
+ * it if needed.
+ *
+ * @param mgr pointer to the dvbcsa encryption pipe manager
+ * @param cw control word
+ * @return a pointer to the shared batch, or NULL in case of allocation error
+ */
+static struct upipe_dvbcsa_bs_enc_batch *
+upipe_dvbcsa_bs_enc_batch_get(struct upipe_mgr *mgr, const dvbcsa_cw_t cw)
+{
+    struct upipe_dvbcsa_bs_enc_mgr *bs_enc_mgr =
+        upipe_dvbcsa_bs_enc_mgr_from_upipe_mgr(mgr);
+    struct upipe_dvbcsa_bs_enc_batch *batch;
+    struct uchain *uchain;
+    ulist_foreach(&bs_enc_mgr->batches, uchain) {
+        batch = upipe_dvbcsa_bs_enc_batch_from_uchain(uchain);
+        if (!memcmp(batch->cw, cw, sizeof (dvbcsa_cw_t))) {
+            batch->refcount++;
+            return batch;
+        }
+    }
+
+    batch = malloc(sizeof (*batch));
+    if (unlikely(!batch))
+        return NULL;
+    unsigned bs_size = dvbcsa_bs_batch_size();
+    batch->size = bs_size;
+    batch->items = malloc((bs_size + 1) * sizeof (struct dvbcsa_bs_batch_s));
+    batch->mapped = malloc(bs_size * sizeof (struct uref *));
+    batch->key = dvbcsa_bs_key_alloc();
+    if (unlikely(!batch->items || !batch->mapped || !batch->key)) {
+        dvbcsa_bs_key_free(batch->key);
+        free(batch->mapped);
+        free(batch->items);
+        free(batch);
+        return NULL;
+    }
+    memcpy(batch->cw, cw, sizeof (dvbcsa_cw_t));
+    dvbcsa_bs_key_set(batch->cw, batch->key);
+    batch->current = 0;
+    batch->refcount = 1;
+    ulist_init(&batch->pipes);
+    ulist_add(&bs_enc_mgr->batches, &batch->uchain);
+    return batch;
+}
+
+/** @internal @This releases a shared batch, and frees it when it is not used
+ * anymore.
+ *
+ * @param batch pointer to the shared batch
+ */
+static void upipe_dvbcsa_bs_enc_batch_release(
+    struct upipe_dvbcsa_bs_enc_batch *batch)
+{
+    if (--batch->refcount)
+        return;
+
+    assert(!batch->current);
+    ulist_delete(&batch->uchain);
+    dvbcsa_bs_key_free(batch->key);
+    free(batch->mapped);
+    free(batch->items);
+    free(batch);
+}
+
 /** @internal @This frees a dvbcsa encryption pipe.
  *
  * @param upipe description structure of the pipe
@@ -131,11 +236,10 @@ static void upipe_dvbcsa_bs_enc_free(struct upipe *upipe)
 
     upipe_throw_dead(upipe);
 
-    for (unsigned i = 0; i < upipe_dvbcsa_bs_enc->current; i++)
-        uref_block_unmap(upipe_dvbcsa_bs_enc->mapped[i], 0);
-    dvbcsa_bs_key_free(upipe_dvbcsa_bs_enc->key);
-    free(upipe_dvbcsa_bs_enc->mapped);
-    free(upipe_dvbcsa_bs_enc->batch);
+    if (upipe_dvbcsa_bs_enc->batch) {
+        ulist_delete(&upipe_dvbcsa_bs_enc->uchain);
+        upipe_dvbcsa_bs_enc_batch_release(upipe_dvbcsa_bs_enc->batch);
+    }
     upipe_dvbcsa_common_clean(common);
     upipe_dvbcsa_bs_enc_clean_upump(upipe);
     upipe_dvbcsa_bs_enc_clean_upump_mgr(upipe);
@@ -173,23 +277,11 @@ static struct upipe *upipe_dvbcsa_bs_enc_alloc(struct upipe_mgr *mgr,
     upipe_dvbcsa_bs_enc_init_upump_mgr(upipe);
     upipe_dvbcsa_bs_enc_init_upump(upipe);
     upipe_dvbcsa_common_init(common);
-    upipe_dvbcsa_bs_enc->key = NULL;
-    unsigned bs_size = dvbcsa_bs_batch_size();
-    upipe_dvbcsa_bs_enc->batch_size = bs_size;
-    upipe_dvbcsa_bs_enc->batch = malloc((bs_size + 1) *
-                                        sizeof (struct dvbcsa_bs_batch_s));
-    upipe_dvbcsa_bs_enc->mapped = malloc(bs_size * sizeof (struct uref *));
-    upipe_dvbcsa_bs_enc->current = 0;
+    upipe_dvbcsa_bs_enc->batch = NULL;
+    uchain_init(&upipe_dvbcsa_bs_enc->uchain);
 
     upipe_throw_ready(upipe);
 
-    if (unlikely(!upipe_dvbcsa_bs_enc->batch ||
-                 !upipe_dvbcsa_bs_enc->mapped)) {
-        upipe_err(upipe, "allocation failed");
-        upipe_release(upipe);
-        return NULL;
-    }
-
     return upipe;
 }
 
@@ -213,48 +305,77 @@ static int upipe_dvbcsa_bs_enc_set_flow_def_real(struct upipe *upipe,
     return UBASE_ERR_NONE;
 }
 
-/** @internal @This flushes the retained urefs.
+/** @internal @This outputs the retained urefs.
  *
  * @param upipe description structure of the pipe
+ * @param upump_p reference to the pump that generated the buffer
+ */
+static void upipe_dvbcsa_bs_enc_output_retained(struct upipe *upipe,
+                                                struct upump **upump_p)
+{
+    if (upipe_dvbcsa_bs_enc_check_input(upipe))
+        return;
+
+    upipe_dvbcsa_bs_enc_set_upump(upipe, NULL);
+
+    struct uref *uref;
+    while ((uref = upipe_dvbcsa_bs_enc_pop_input(upipe))) {
+        if (unlikely(ubase_check(uref_flow_get_def(uref, NULL))))
+            /* handle flow format */
+            upipe_dvbcsa_bs_enc_set_flow_def_real(upipe, uref);
+        else
+            upipe_dvbcsa_bs_enc_output(upipe, uref, upump_p);
+    }
+
+    /* all buffered urefs has been sent */
+    upipe_release(upipe);
+}
+
+/** @internal @This scrambles the shared batch, and flushes the retained urefs
+ * of all the pipes using it.
+ *
+ * @param upipe description structure of the pipe
+ * @param upump_p reference to the pump that generated the buffer
  */
 static void upipe_dvbcsa_bs_enc_flush(struct upipe *upipe,
                                       struct upump **upump_p)
 {
     struct upipe_dvbcsa_bs_enc *upipe_dvbcsa_bs_enc =
         upipe_dvbcsa_bs_enc_from_upipe(upipe);
+    struct upipe_dvbcsa_bs_enc_batch *batch = upipe_dvbcsa_bs_enc->batch;
 
-    upipe_dvbcsa_bs_enc_set_upump(upipe, NULL);
+    if (!batch) {
+        upipe_dvbcsa_bs_enc_output_retained(upipe, upump_p);
+        return;
+    }
 
     /* scramble remaining packets */
-    unsigned current = upipe_dvbcsa_bs_enc->current;
-    if (upipe_dvbcsa_bs_enc->current) {
-        upipe_dvbcsa_bs_enc->current = 0;
-        upipe_dvbcsa_bs_enc->batch[current].data = NULL;
-        upipe_dvbcsa_bs_enc->batch[current].len = 0;
+    unsigned current = batch->current;
+    if (current) {
+        batch->current = 0;
+        batch->items[current].data = NULL;
+        batch->items[current].len = 0;
 
         uint64_t before = uclock_now(upipe_dvbcsa_bs_enc->uclock);
-        dvbcsa_bs_encrypt(upipe_dvbcsa_bs_enc->key,
-                          upipe_dvbcsa_bs_enc->batch, 184);
+        dvbcsa_bs_encrypt(batch->key, batch->items, 184);
         uint64_t after = uclock_now(upipe_dvbcsa_bs_enc->uclock);
         if ((after - before) > DVBCSA_LATENCY)
             upipe_warn_va(upipe, "dvbcsa latency too high %"PRIu64 "ms",
-                          (after - before) / 1000);
+                          (after - before) / (UCLOCK_FREQ / 1000));
         for (unsigned i = 0; i < current; i++)
-            uref_block_unmap(upipe_dvbcsa_bs_enc->mapped[i], 0);
+            uref_block_unmap(batch->mapped[i], 0);
     }
 
-    /* output */
-    struct uref *uref;
-    while ((uref = upipe_dvbcsa_bs_enc_pop_input(upipe))) {
-        if (unlikely(ubase_check(uref_flow_get_def(uref, NULL))))
-            /* handle flow format */
-            upipe_dvbcsa_bs_enc_set_flow_def_real(upipe, uref);
-        else
-            upipe_dvbcsa_bs_enc_output(upipe, uref, upump_p);
+    /* output, the pipes may be released meanwhile */
+    batch->refcount++;
+    struct uchain *uchain, *uchain_tmp;
+    ulist_delete_foreach(&batch->pipes, uchain, uchain_tmp) {
+        struct upipe_dvbcsa_bs_enc *pipe =
+            upipe_dvbcsa_bs_enc_from_uchain(uchain);
+        upipe_dvbcsa_bs_enc_output_retained(
+            upipe_dvbcsa_bs_enc_to_upipe(pipe), upump_p);
     }
-
-    /* all buffered urefs has been sent */
-    upipe_release(upipe);
+    upipe_dvbcsa_bs_enc_batch_release(batch);
 }
 
 /** @internal @This is called when maximum latency is reached to flush all
@@ -309,8 +430,9 @@ static void upipe_dvbcsa_bs_enc_input(struct upipe *upipe,
     uint16_t pid = ts_get_pid(ts_header);
     uref_block_peek_unmap(uref, 0, buf, ts_header);
 
+    struct upipe_dvbcsa_bs_enc_batch *batch = upipe_dvbcsa_bs_enc->batch;
     bool scramble =
-        upipe_dvbcsa_bs_enc->key != NULL &&
+        batch != NULL &&
         has_payload && !scrambling &&
         upipe_dvbcsa_common_check_pid(common, pid);
     if (!scramble) {
@@ -363,24 +485,25 @@ static void upipe_dvbcsa_bs_enc_input(struct upipe *upipe,
         return;
     }
 
-    uint8_t current = upipe_dvbcsa_bs_enc->current;
+    unsigned current = batch->current;
     ts_set_scrambling(ts, 0x2);
-    upipe_dvbcsa_bs_enc->batch[current].data = ts + ts_header_size;
-    upipe_dvbcsa_bs_enc->batch[current].len = size - ts_header_size;
-    upipe_dvbcsa_bs_enc->mapped[current] = uref;
-    upipe_dvbcsa_bs_enc->current++;
+    batch->items[current].data = ts + ts_header_size;
+    batch->items[current].len = size - ts_header_size;
+    batch->mapped[current] = uref;
+    batch->current++;
 
     /* hold uref */
     upipe_dvbcsa_bs_enc_hold_input(upipe, uref);
-    if (unlikely(first)) {
+    if (unlikely(first))
         /* make sure to send all buffered urefs */
         upipe_use(upipe);
+    if (!current)
+        /* the first pipe filling the batch bounds its latency */
         upipe_dvbcsa_bs_enc_wait_upump(upipe, common->latency,
                                        upipe_dvbcsa_bs_enc_worker);
-    }
 
     /* scramble if we have enough packets */
-    if (upipe_dvbcsa_bs_enc->current >= upipe_dvbcsa_bs_enc->batch_size)
+    if (batch->current >= batch->size)
         upipe_dvbcsa_bs_enc_flush(upipe, upump_p);
 }
 
@@ -431,9 +554,16 @@ static int upipe_dvbcsa_bs_enc_set_key(struct upipe *upipe,
 {
     struct upipe_dvbcsa_bs_enc *upipe_dvbcsa_bs_enc =
         upipe_dvbcsa_bs_enc_from_upipe(upipe);
-
-    dvbcsa_bs_key_free(upipe_dvbcsa_bs_enc->key);
-    upipe_dvbcsa_bs_enc->key = NULL;
+    struct upipe_dvbcsa_bs_enc_batch *batch = upipe_dvbcsa_bs_enc->batch;
+
+    if (batch) {
+        /* scramble the retained packets with the previous key */
+        if (!upipe_dvbcsa_bs_enc_check_input(upipe))
+            upipe_dvbcsa_bs_enc_flush(upipe, NULL);
+        ulist_delete(&upipe_dvbcsa_bs_enc->uchain);
+        upipe_dvbcsa_bs_enc->batch = NULL;
+        upipe_dvbcsa_bs_enc_batch_release(batch);
+    }
     if (!key)
         return UBASE_ERR_NONE;
 
@@ -442,9 +572,10 @@ static int upipe_dvbcsa_bs_enc_set_key(struct upipe *upipe,
         return UBASE_ERR_INVALID;
 
     upipe_notice(upipe, "key changed");
-    upipe_dvbcsa_bs_enc->key = dvbcsa_bs_key_alloc();
-    UBASE_ALLOC_RETURN(upipe_dvbcsa_bs_enc->key);
-    dvbcsa_bs_key_set(cw.value, upipe_dvbcsa_bs_enc->key);
+    batch = upipe_dvbcsa_bs_enc_batch_get(upipe->mgr, cw.value);
+    UBASE_ALLOC_RETURN(batch);
+    upipe_dvbcsa_bs_enc->batch = batch;
+    ulist_add(&batch->pipes, &upipe_dvbcsa_bs_enc->uchain);
     return UBASE_ERR_NONE;
 
 }
@@ -503,15 +634,38 @@ static int upipe_dvbcsa_bs_enc_control(struct upipe *upipe,
     return upipe_dvbcsa_bs_enc_check(upipe, NULL);
 }
 
-static struct upipe_mgr upipe_dvbcsa_bs_enc_mgr = {
-    .signature = UPIPE_DVBCSA_BS_ENC_SIGNATURE,
-    .refcount = NULL,
-    .upipe_alloc = upipe_dvbcsa_bs_enc_alloc,
-    .upipe_input = upipe_dvbcsa_bs_enc_input,
-    .upipe_control = upipe_dvbcsa_bs_enc_control,
-};
+/** @internal @This frees a dvbcsa encryption pipe manager.
+ *
+ * @param urefcount pointer to urefcount structure
+ */
+static void upipe_dvbcsa_bs_enc_mgr_free(struct urefcount *urefcount)
+{
+    struct upipe_dvbcsa_bs_enc_mgr *bs_enc_mgr =
+        upipe_dvbcsa_bs_enc_mgr_from_urefcount(urefcount);
+    assert(ulist_empty(&bs_enc_mgr->batches));
+    urefcount_clean(urefcount);
+    free(bs_enc_mgr);
+}
 
+/** @This returns a dvbcsa encrypt pipe management structure.
+ *
+ * @return a pointer to the manager
+ */
 struct upipe_mgr *upipe_dvbcsa_bs_enc_mgr_alloc(void)
 {
-    return &upipe_dvbcsa_bs_enc_mgr;
+    struct upipe_dvbcsa_bs_enc_mgr *bs_enc_mgr =
+        malloc(sizeof (struct upipe_dvbcsa_bs_enc_mgr));
+    if (unlikely(!bs_enc_mgr))
+        return NULL;
+
+    memset(bs_enc_mgr, 0, sizeof (*bs_enc_mgr));
+    ulist_init(&bs_enc_mgr->batches);
+    urefcount_init(upipe_dvbcsa_bs_enc_mgr_to_urefcount(bs_enc_mgr),
+                   upipe_dvbcsa_bs_enc_mgr_free);
+    bs_enc_mgr->mgr.refcount = upipe_dvbcsa_bs_enc_mgr_to_urefcount(bs_enc_mgr);
+    bs_enc_mgr->mgr.signature = UPIPE_DVBCSA_BS_ENC_SIGNATURE;
+    bs_enc_mgr->mgr.upipe_alloc = upipe_dvbcsa_bs_enc_alloc;
+    bs_enc_mgr->mgr.upipe_input = upipe_dvbcsa_bs_enc_input;
+    bs_enc_mgr->mgr.upipe_control = upipe_dvbcsa_bs_enc_control;
+    return upipe_dvbcsa_bs_enc_mgr_to_upipe_mgr(bs_enc_mgr);
 }
@@ -101,6 +101,15 @@ struct upipe_dveo_asi_sink {
     /** first timestamp */
     bool first_timestamp;
 
+    /** true if packets are aggregated up to the driver buffer size */
+    bool aggregate;
+    /** driver buffer size */
+    size_t bufsize;
+    /** list of packets waiting to be written */
+    struct uchain aggregate_urefs;
+    /** size of the packets waiting to be written */
+    size_t aggregate_size;
+
     /** public upipe structure */
     struct upipe upipe;
 };
@@ -202,6 +211,10 @@ static struct upipe *upipe_dveo_asi_sink_alloc(struct upipe_mgr *mgr,
     upipe_dveo_asi_sink->fd = -1;
     upipe_dveo_asi_sink->card_idx = 0;
     upipe_dveo_asi_sink->first_timestamp = true;
+    upipe_dveo_asi_sink->aggregate = false;
+    upipe_dveo_asi_sink->bufsize = 0;
+    ulist_init(&upipe_dveo_asi_sink->aggregate_urefs);
+    upipe_dveo_asi_sink->aggregate_size = 0;
     upipe_dveo_asi_sink->uclock.refcount = &upipe_dveo_asi_sink->urefcount;
     upipe_dveo_asi_sink->uclock.uclock_now = upipe_dveo_asi_sink_now;
     upipe_dveo_asi_sink->last_val = 0;
@@ -316,6 +329,113 @@ static bool upipe_dveo_asi_sink_write(struct upipe *upipe, struct uref *uref,
     return true;
 }
 
+/** @internal @This drops the packets waiting to be written.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_dveo_asi_sink_flush_aggregate(struct upipe *upipe)
+{
+    struct upipe_dveo_asi_sink *upipe_dveo_asi_sink = upipe_dveo_asi_sink_from_upipe(upipe);
+    struct uchain *uchain, *uchain_tmp;
+    ulist_delete_foreach(&upipe_dveo_asi_sink->aggregate_urefs, uchain,
+                         uchain_tmp) {
+        ulist_delete(uchain);
+        uref_free(uref_from_uchain(uchain));
+    }
+    upipe_dveo_asi_sink->aggregate_size = 0;
+}
+
+/** @internal @This writes the aggregated packets, with their timestamp
+ * headers, in as few system calls as possible.
+ *
+ * @param upipe description structure of the pipe
+ * @return false if the device would block
+ */
+static bool upipe_dveo_asi_sink_write_aggregate(struct upipe *upipe)
+{
+    struct upipe_dveo_asi_sink *upipe_dveo_asi_sink = upipe_dveo_asi_sink_from_upipe(upipe);
+    struct uchain *uchain, *uchain_tmp;
+
+    while (!ulist_empty(&upipe_dveo_asi_sink->aggregate_urefs)) {
+        int iovec_count = 0;
+        ulist_delete_foreach(&upipe_dveo_asi_sink->aggregate_urefs, uchain,
+                             uchain_tmp) {
+            struct uref *uref = uref_from_uchain(uchain);
+            int count = uref_block_iovec_count(uref, 0, -1);
+            if (unlikely(count == -1)) {
+                upipe_warn(upipe, "cannot read ubuf buffer");
+                size_t size = 0;
+                uref_block_size(uref, &size);
+                upipe_dveo_asi_sink->aggregate_size -= size;
+                ulist_delete(uchain);
+                uref_free(uref);
+                continue;
+            }
+            iovec_count += count;
+        }
+        if (unlikely(iovec_count == 0))
+            break;
+
+        struct iovec iovecs[iovec_count];
+        int i = 0;
+        ulist_foreach(&upipe_dveo_asi_sink->aggregate_urefs, uchain) {
+            struct uref *uref = uref_from_uchain(uchain);
+            uref_block_iovec_read(uref, 0, -1, iovecs + i);
+            i += uref_block_iovec_count(uref, 0, -1);
+        }
+
+        ssize_t ret = writev(upipe_dveo_asi_sink->fd, iovecs, iovec_count);
+
+        i = 0;
+        ulist_foreach(&upipe_dveo_asi_sink->aggregate_urefs, uchain) {
+            struct uref *uref = uref_from_uchain(uchain);
+            uref_block_iovec_unmap(uref, 0, -1, iovecs + i);
+            i += uref_block_iovec_count(uref, 0, -1);
+        }
+
+        if (unlikely(ret == -1)) {
+            switch (errno) {
+                case EINTR:
+                    continue;
+                case EAGAIN:
+#if EAGAIN != EWOULDBLOCK
+                case EWOULDBLOCK:
+#endif
+                    upipe_dveo_asi_sink_poll(upipe);
+                    return false;
+                default:
+                    break;
+            }
+            upipe_warn_va(upipe, "write error to device %d (%m)", upipe_dveo_asi_sink->card_idx);
+            upipe_dveo_asi_sink_flush_aggregate(upipe);
+            upipe_dveo_asi_sink->first_timestamp = true;
+            upipe_dveo_asi_sink_set_upump(upipe, NULL);
+            upipe_throw_sink_end(upipe);
+            break;
+        }
+
+        upipe_dveo_asi_sink->aggregate_size -= ret;
+        ulist_delete_foreach(&upipe_dveo_asi_sink->aggregate_urefs, uchain,
+                             uchain_tmp) {
+            struct uref *uref = uref_from_uchain(uchain);
+            size_t size = 0;
+            uref_block_size(uref, &size);
+            if ((size_t)ret < size) {
+                if (ret)
+                    uref_block_resize(uref, ret, -1);
+                break;
+            }
+            ret -= size;
+            ulist_delete(uchain);
+            uref_free(uref);
+        }
+
+        upipe_dveo_asi_sink_stats(upipe);
+    }
+
+    return true;
+}
+
 static bool upipe_dveo_asi_sink_add_header(struct upipe *upipe, struct uref *uref,
     uint64_t pts)
 {
@@ -398,6 +518,14 @@ static bool upipe_dveo_asi_sink_output(struct upipe *upipe, struct uref *uref,
         return true;
     }
 
+    /* make room for this packet, or write what was aggregated before
+     * leaving the aggregation mode */
+    if (!ulist_empty(&upipe_dveo_asi_sink->aggregate_urefs) &&
+        (!upipe_dveo_asi_sink->aggregate ||
+         upipe_dveo_asi_sink->aggregate_size >= upipe_dveo_asi_sink->bufsize) &&
+        !upipe_dveo_asi_sink_write_aggregate(upipe))
+        return false; /* would block */
+
     uint64_t cr_sys = 0;
     if (unlikely(!ubase_check(uref_clock_get_cr_sys(uref, &cr_sys))) || cr_sys == -1) {
         upipe_warn(upipe, "received non-dated buffer");
@@ -432,6 +560,19 @@ static bool upipe_dveo_asi_sink_output(struct upipe *upipe, struct uref *uref,
         return true; /* invalid uref, discarded */
     }
 
+    if (upipe_dveo_asi_sink->aggregate) {
+        /* each packet keeps its own timestamp header, so a full driver
+         * buffer can be written at once */
+        size_t size = 0;
+        uref_block_size(uref, &size);
+        ulist_add(&upipe_dveo_asi_sink->aggregate_urefs,
+                  uref_to_uchain(uref));
+        upipe_dveo_asi_sink->aggregate_size += size;
+        if (upipe_dveo_asi_sink->aggregate_size >= upipe_dveo_asi_sink->bufsize)
+            upipe_dveo_asi_sink_write_aggregate(upipe);
+        return true;
+    }
+
     if (!upipe_dveo_asi_sink_write(upipe, uref, &reset_first_timestamp))
         return false; /* would block */
 
@@ -491,6 +632,7 @@ static void upipe_dveo_asi_sink_close(struct upipe *upipe)
         upipe_notice_va(upipe, "closing card %i", upipe_dveo_asi_sink->card_idx);
         ubase_clean_fd(&upipe_dveo_asi_sink->fd);
     }
+    upipe_dveo_asi_sink_flush_aggregate(upipe);
     upipe_dveo_asi_sink_set_upump(upipe, NULL);
 }
 
@@ -649,6 +791,7 @@ static int upipe_dveo_asi_sink_open(struct upipe *upipe)
     }
 
     upipe_dveo_asi_sink->fd = fd;
+    upipe_dveo_asi_sink->bufsize = bufsize;
 
     upipe_notice_va(upipe, "opening file %s", path);
     return UBASE_ERR_NONE;
@@ -672,6 +815,11 @@ static int upipe_dveo_asi_sink_set_option(struct upipe *upipe,
     if (k == NULL || v == NULL)
         return UBASE_ERR_INVALID;
 
+    if (!strcmp(k, "aggregate")) {
+        upipe_dveo_asi_sink->aggregate = strcmp(v, "0");
+        return UBASE_ERR_NONE;
+    }
+
     if (unlikely(upipe_dveo_asi_sink->fd != -1))
         upipe_dveo_asi_sink_close(upipe);
 
@@ -737,6 +885,7 @@ static void upipe_dveo_asi_sink_free(struct upipe *upipe)
     }
     upipe_throw_dead(upipe);
 
+    upipe_dveo_asi_sink_flush_aggregate(upipe);
     upipe_dveo_asi_sink_clean_upump(upipe);
     upipe_dveo_asi_sink_clean_upump_mgr(upipe);
     upipe_dveo_asi_sink_clean_input(upipe);
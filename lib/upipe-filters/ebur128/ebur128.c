@@ -35,9 +35,9 @@ struct ebur128_state_internal {
   size_t audio_data_frames;
   /** Current index for audio_data. */
   size_t audio_data_index;
-  /** How many frames are needed for a gating block. Will correspond to 400ms
-   *  of audio at initialization, and 100ms after the first block (75% overlap
-   *  as specified in the 2011 revision of BS1770). */
+  /** How many frames are needed to complete the current 100ms segment. A
+   *  gating block is made of the last 4 segments (75% overlap as specified in
+   *  the 2011 revision of BS1770). */
   unsigned long needed_frames;
   /** The channel map. Has as many elements as there are channels. */
   int* channel_map;
@@ -47,8 +47,19 @@ struct ebur128_state_internal {
   double b[5];
   /** BS.1770 filter coefficients (denominator). */
   double a[5];
-  /** BS.1770 filter state. */
-  double v[5][5];
+  /** BS.1770 filter state, stored as v[k * channels + c] so that the state
+   *  of adjacent channels can be loaded in a single vector. */
+  double* v;
+  /** Weight of each channel in the sum of energies. */
+  double* channel_weight;
+  /** Energy of each channel, filled in by the filter. */
+  double* channel_energy;
+  /** Weighted energies of the 100ms segments of audio_data. */
+  double* segment_energy;
+  /** Weighted energy of the current, incomplete segment. */
+  double partial_energy;
+  /** Number of complete segments, saturated at 4 (one gating block). */
+  unsigned int complete_segments;
   /** Linked list of block energies. */
   struct ebur128_double_queue block_list;
   /** Linked list of 3s-block energies, used to calculate LRA. */
@@ -81,8 +92,6 @@ static double histogram_energies[1000];
 static double histogram_energy_boundaries[1001];
 
 static void ebur128_init_filter(ebur128_state* st) {
-  int i, j;
-
   double f0 = 1681.974450955533;
   double G  =    3.999843853973347;
   double Q  =    0.7071752369554196;
@@ -127,13 +136,59 @@ static void ebur128_init_filter(ebur128_state* st) {
   st->d->a[3] = pa[1] * ra[2] + pa[2] * ra[1];
   st->d->a[4] = pa[2] * ra[2];
 
-  for (i = 0; i < 5; ++i) {
-    for (j = 0; j < 5; ++j) {
-      st->d->v[i][j] = 0.0;
-    }
+  memset(st->d->v, 0, 5 * st->channels * sizeof(double));
+}
+
+static void ebur128_update_channel_weight(ebur128_state* st,
+                                          unsigned int channel_number) {
+  switch (st->d->channel_map[channel_number]) {
+    case EBUR128_UNUSED:         st->d->channel_weight[channel_number] = 0.0;
+                                 break;
+    case EBUR128_LEFT_SURROUND:
+    case EBUR128_RIGHT_SURROUND: st->d->channel_weight[channel_number] = 1.41;
+                                 break;
+    case EBUR128_DUAL_MONO:      st->d->channel_weight[channel_number] = 2.0;
+                                 break;
+    default:                     st->d->channel_weight[channel_number] = 1.0;
+                                 break;
   }
 }
 
+static int ebur128_init_channel_data(ebur128_state* st) {
+  st->d->v = (double*) calloc(5 * st->channels, sizeof(double));
+  st->d->channel_weight = (double*) malloc(st->channels * sizeof(double));
+  st->d->channel_energy = (double*) malloc(st->channels * sizeof(double));
+  if (!st->d->v || !st->d->channel_weight || !st->d->channel_energy) {
+    free(st->d->v);              st->d->v = NULL;
+    free(st->d->channel_weight); st->d->channel_weight = NULL;
+    free(st->d->channel_energy); st->d->channel_energy = NULL;
+    return EBUR128_ERROR_NOMEM;
+  }
+  return EBUR128_SUCCESS;
+}
+
+static void ebur128_destroy_channel_data(ebur128_state* st) {
+  free(st->d->v);              st->d->v = NULL;
+  free(st->d->channel_weight); st->d->channel_weight = NULL;
+  free(st->d->channel_energy); st->d->channel_energy = NULL;
+}
+
+static int ebur128_init_audio_data(ebur128_state* st) {
+  size_t segments = st->d->audio_data_frames / st->d->samples_in_100ms;
+  st->d->audio_data = (double*) calloc(st->d->audio_data_frames *
+                                       st->channels,
+                                       sizeof(double));
+  st->d->segment_energy = (double*) calloc(segments, sizeof(double));
+  if (!st->d->audio_data || !st->d->segment_energy) {
+    free(st->d->audio_data);     st->d->audio_data = NULL;
+    free(st->d->segment_energy); st->d->segment_energy = NULL;
+    return EBUR128_ERROR_NOMEM;
+  }
+  st->d->partial_energy = 0.0;
+  st->d->complete_segments = 0;
+  return EBUR128_SUCCESS;
+}
+
 static int ebur128_init_channel_map(ebur128_state* st) {
   size_t i;
   st->d->channel_map = (int*) malloc(st->channels * sizeof(int));
@@ -162,6 +217,9 @@ static int ebur128_init_channel_map(ebur128_state* st) {
       }
     }
   }
+  for (i = 0; i < st->channels; ++i) {
+    ebur128_update_channel_weight(st, i);
+  }
   return EBUR128_SUCCESS;
 }
 
@@ -243,8 +301,10 @@ ebur128_state* ebur128_init(unsigned int channels,
           malloc(sizeof(struct ebur128_state_internal));
   CHECK_ERROR(!st->d, 0, free_state)
   st->channels = channels;
-  errcode = ebur128_init_channel_map(st);
+  errcode = ebur128_init_channel_data(st);
   CHECK_ERROR(errcode, 0, free_internal)
+  errcode = ebur128_init_channel_map(st);
+  CHECK_ERROR(errcode, 0, free_channel_data)
 
   st->d->sample_peak = (double*) malloc(channels * sizeof(double));
   CHECK_ERROR(!st->d->sample_peak, 0, free_channel_map)
@@ -267,13 +327,8 @@ ebur128_state* ebur128_init(unsigned int channels,
   } else {
     goto free_true_peak;
   }
-  st->d->audio_data = (double*) malloc(st->d->audio_data_frames *
-                                       st->channels *
-                                       sizeof(double));
-  CHECK_ERROR(!st->d->audio_data, 0, free_true_peak)
-  memset(st->d->audio_data, 0, st->d->audio_data_frames *
-                                       st->channels *
-                                       sizeof(double));
+  errcode = ebur128_init_audio_data(st);
+  CHECK_ERROR(errcode, 0, free_true_peak)
   ebur128_init_filter(st);
 
   if (st->d->use_histogram) {
@@ -303,8 +358,8 @@ ebur128_state* ebur128_init(unsigned int channels,
   CHECK_ERROR(result, 0, free_short_term_block_energy_histogram)
 #endif
 
-  /* the first block needs 400ms of audio data */
-  st->d->needed_frames = st->d->samples_in_100ms * 4;
+  /* audio data is processed in segments of 100ms */
+  st->d->needed_frames = st->d->samples_in_100ms;
   /* start at the beginning of the buffer */
   st->d->audio_data_index = 0;
 
@@ -331,12 +386,15 @@ free_block_energy_histogram:
   free(st->d->block_energy_histogram);
 free_audio_data:
   free(st->d->audio_data);
+  free(st->d->segment_energy);
 free_true_peak:
   free(st->d->true_peak);
 free_sample_peak:
   free(st->d->sample_peak);
 free_channel_map:
   free(st->d->channel_map);
+free_channel_data:
+  ebur128_destroy_channel_data(st);
 free_internal:
   free(st->d);
 free_state:
@@ -350,6 +408,8 @@ void ebur128_destroy(ebur128_state** st) {
   free((*st)->d->block_energy_histogram);
   free((*st)->d->short_term_block_energy_histogram);
   free((*st)->d->audio_data);
+  free((*st)->d->segment_energy);
+  ebur128_destroy_channel_data(*st);
   free((*st)->d->channel_map);
   free((*st)->d->sample_peak);
   free((*st)->d->true_peak);
@@ -420,10 +480,157 @@ static void ebur128_check_true_peak(ebur128_state* st, size_t frames) {
 #define TURN_ON_FTZ
 #define TURN_OFF_FTZ
 #define FLUSH_MANUALLY \
-    st->d->v[ci][4] = fabs(st->d->v[ci][4]) < DBL_MIN ? 0.0 : st->d->v[ci][4]; \
-    st->d->v[ci][3] = fabs(st->d->v[ci][3]) < DBL_MIN ? 0.0 : st->d->v[ci][3]; \
-    st->d->v[ci][2] = fabs(st->d->v[ci][2]) < DBL_MIN ? 0.0 : st->d->v[ci][2]; \
-    st->d->v[ci][1] = fabs(st->d->v[ci][1]) < DBL_MIN ? 0.0 : st->d->v[ci][1];
+    for (i = st->channels; i < 5 * st->channels; ++i) { \
+      st->d->v[i] = fabs(st->d->v[i]) < DBL_MIN ? 0.0 : st->d->v[i]; \
+    }
+#endif
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+/* The K-weighting filter is recursive in time, so the vector kernels process
+ * several adjacent channels of each interleaved frame at once, each lane
+ * having its own filter state. The operations are done in the same order as
+ * the scalar filter, so that the results are identical. */
+#define EBUR128_FILTER_KERNEL(isa, attr, width, vec, type, load, set1,         \
+                              loadu, storeu, add, sub, mul, div)               \
+attr                                                                           \
+static size_t ebur128_filter_##isa##_##type(ebur128_state* st,                 \
+                                            const type* src, size_t frames,    \
+                                            double scaling_factor,             \
+                                            double* audio_data, size_t c) {    \
+  const size_t channels = st->channels;                                        \
+  double* v = st->d->v;                                                        \
+  vec scale = set1(scaling_factor);                                            \
+  vec a1 = set1(st->d->a[1]), a2 = set1(st->d->a[2]);                          \
+  vec a3 = set1(st->d->a[3]), a4 = set1(st->d->a[4]);                          \
+  vec b0 = set1(st->d->b[0]), b1 = set1(st->d->b[1]);                          \
+  vec b2 = set1(st->d->b[2]), b3 = set1(st->d->b[3]);                          \
+  vec b4 = set1(st->d->b[4]);                                                  \
+  size_t i;                                                                    \
+  for (; c + width <= channels; c += width) {                                  \
+    vec v1 = loadu(v + 1 * channels + c), v2 = loadu(v + 2 * channels + c);    \
+    vec v3 = loadu(v + 3 * channels + c), v4 = loadu(v + 4 * channels + c);    \
+    vec energy = set1(0.0);                                                    \
+    for (i = 0; i < frames; ++i) {                                             \
+      vec v0 = div(load(src + i * channels + c), scale);                       \
+      vec y;                                                                   \
+      v0 = sub(v0, mul(a1, v1));                                               \
+      v0 = sub(v0, mul(a2, v2));                                               \
+      v0 = sub(v0, mul(a3, v3));                                               \
+      v0 = sub(v0, mul(a4, v4));                                               \
+      y = mul(b0, v0);                                                         \
+      y = add(y, mul(b1, v1));                                                 \
+      y = add(y, mul(b2, v2));                                                 \
+      y = add(y, mul(b3, v3));                                                 \
+      y = add(y, mul(b4, v4));                                                 \
+      storeu(audio_data + i * channels + c, y);                                \
+      energy = add(energy, mul(y, y));                                         \
+      v4 = v3;                                                                 \
+      v3 = v2;                                                                 \
+      v2 = v1;                                                                 \
+      v1 = v0;                                                                 \
+    }                                                                          \
+    storeu(v + 1 * channels + c, v1);                                          \
+    storeu(v + 2 * channels + c, v2);                                          \
+    storeu(v + 3 * channels + c, v3);                                          \
+    storeu(v + 4 * channels + c, v4);                                          \
+    storeu(st->d->channel_energy + c, energy);                                 \
+  }                                                                            \
+  return c;                                                                    \
+}
+
+#if defined(__x86_64__)
+static inline __m128d ebur128_load_sse2_short(const short* p) {
+  int32_t x;
+  __m128i v;
+  memcpy(&x, p, sizeof(x));
+  v = _mm_cvtsi32_si128(x);
+  return _mm_cvtepi32_pd(_mm_unpacklo_epi16(v, _mm_srai_epi16(v, 15)));
+}
+static inline __m128d ebur128_load_sse2_int(const int* p) {
+  return _mm_cvtepi32_pd(_mm_loadl_epi64((const __m128i*) p));
+}
+static inline __m128d ebur128_load_sse2_float(const float* p) {
+  return _mm_cvtps_pd(_mm_castsi128_ps(_mm_loadl_epi64((const __m128i*) p)));
+}
+static inline __m128d ebur128_load_sse2_double(const double* p) {
+  return _mm_loadu_pd(p);
+}
+
+__attribute__((target("avx2")))
+static inline __m256d ebur128_load_avx2_short(const short* p) {
+  return _mm256_cvtepi32_pd(
+      _mm_cvtepi16_epi32(_mm_loadl_epi64((const __m128i*) p)));
+}
+__attribute__((target("avx2")))
+static inline __m256d ebur128_load_avx2_int(const int* p) {
+  return _mm256_cvtepi32_pd(_mm_loadu_si128((const __m128i*) p));
+}
+__attribute__((target("avx2")))
+static inline __m256d ebur128_load_avx2_float(const float* p) {
+  return _mm256_cvtps_pd(_mm_loadu_ps(p));
+}
+__attribute__((target("avx2")))
+static inline __m256d ebur128_load_avx2_double(const double* p) {
+  return _mm256_loadu_pd(p);
+}
+
+#define EBUR128_FILTER_SSE2(type)                                              \
+EBUR128_FILTER_KERNEL(sse2, , 2, __m128d, type, ebur128_load_sse2_##type,      \
+                      _mm_set1_pd, _mm_loadu_pd, _mm_storeu_pd,                \
+                      _mm_add_pd, _mm_sub_pd, _mm_mul_pd, _mm_div_pd)
+#define EBUR128_FILTER_AVX2(type)                                              \
+EBUR128_FILTER_KERNEL(avx2, __attribute__((target("avx2"))), 4, __m256d, type, \
+                      ebur128_load_avx2_##type,                                \
+                      _mm256_set1_pd, _mm256_loadu_pd, _mm256_storeu_pd,       \
+                      _mm256_add_pd, _mm256_sub_pd, _mm256_mul_pd,             \
+                      _mm256_div_pd)
+EBUR128_FILTER_SSE2(short)
+EBUR128_FILTER_SSE2(int)
+EBUR128_FILTER_SSE2(float)
+EBUR128_FILTER_SSE2(double)
+EBUR128_FILTER_AVX2(short)
+EBUR128_FILTER_AVX2(int)
+EBUR128_FILTER_AVX2(float)
+EBUR128_FILTER_AVX2(double)
+#define EBUR128_FILTER_SIMD(type, st, src, frames, scaling_factor, audio_data) \
+  c = 0;                                                                       \
+  if (__builtin_cpu_supports("avx2"))                                          \
+    c = ebur128_filter_avx2_##type(st, src, frames, scaling_factor,            \
+                                   audio_data, c);                             \
+  c = ebur128_filter_sse2_##type(st, src, frames, scaling_factor,              \
+                                 audio_data, c);
+
+#elif defined(__aarch64__) && !defined(__AARCH64EB__)
+#define EBUR128_LOAD_NEON(type)                                                \
+static inline float64x2_t ebur128_load_neon_##type(const type* p) {           \
+  return vsetq_lane_f64((double) p[1], vdupq_n_f64((double) p[0]), 1);         \
+}
+EBUR128_LOAD_NEON(short)
+EBUR128_LOAD_NEON(int)
+EBUR128_LOAD_NEON(float)
+EBUR128_LOAD_NEON(double)
+
+#define EBUR128_FILTER_NEON(type)                                              \
+EBUR128_FILTER_KERNEL(neon, , 2, float64x2_t, type, ebur128_load_neon_##type,  \
+                      vdupq_n_f64, vld1q_f64, vst1q_f64,                       \
+                      vaddq_f64, vsubq_f64, vmulq_f64, vdivq_f64)
+EBUR128_FILTER_NEON(short)
+EBUR128_FILTER_NEON(int)
+EBUR128_FILTER_NEON(float)
+EBUR128_FILTER_NEON(double)
+#define EBUR128_FILTER_SIMD(type, st, src, frames, scaling_factor, audio_data) \
+  c = ebur128_filter_neon_##type(st, src, frames, scaling_factor,              \
+                                 audio_data, 0);
+
+#else
+#define EBUR128_FILTER_SIMD(type, st, src, frames, scaling_factor, audio_data) \
+  c = 0;
 #endif
 
 #define EBUR128_FILTER(type, min_scale, max_scale)                             \
@@ -432,6 +639,8 @@ static void ebur128_filter_##type(ebur128_state* st, const type* src,          \
   static double scaling_factor = -((double) min_scale) > (double) max_scale ?  \
                                  -((double) min_scale) : (double) max_scale;   \
   double* audio_data = st->d->audio_data + st->d->audio_data_index;            \
+  const size_t channels = st->channels;                                        \
+  double* v = st->d->v;                                                        \
   size_t i, c;                                                                 \
                                                                                \
   TURN_ON_FTZ                                                                  \
@@ -459,29 +668,35 @@ static void ebur128_filter_##type(ebur128_state* st, const type* src,          \
     }                                                                          \
     ebur128_check_true_peak(st, frames);                                       \
   }                                                                            \
-  for (c = 0; c < st->channels; ++c) {                                         \
-    int ci = st->d->channel_map[c] - 1;                                        \
-    if (ci < 0) continue;                                                      \
-    else if (ci > 4) ci = 0; /* dual mono */                                   \
+  EBUR128_FILTER_SIMD(type, st, src, frames, scaling_factor, audio_data)       \
+  for (; c < channels; ++c) {                                                  \
+    double energy = 0.0;                                                       \
     for (i = 0; i < frames; ++i) {                                             \
-      st->d->v[ci][0] = (double) (src[i * st->channels + c] / scaling_factor)  \
-                   - st->d->a[1] * st->d->v[ci][1]                             \
-                   - st->d->a[2] * st->d->v[ci][2]                             \
-                   - st->d->a[3] * st->d->v[ci][3]                             \
-                   - st->d->a[4] * st->d->v[ci][4];                            \
-      audio_data[i * st->channels + c] =                                       \
-                     st->d->b[0] * st->d->v[ci][0]                             \
-                   + st->d->b[1] * st->d->v[ci][1]                             \
-                   + st->d->b[2] * st->d->v[ci][2]                             \
-                   + st->d->b[3] * st->d->v[ci][3]                             \
-                   + st->d->b[4] * st->d->v[ci][4];                            \
-      st->d->v[ci][4] = st->d->v[ci][3];                                       \
-      st->d->v[ci][3] = st->d->v[ci][2];                                       \
-      st->d->v[ci][2] = st->d->v[ci][1];                                       \
-      st->d->v[ci][1] = st->d->v[ci][0];                                       \
+      double y;                                                                \
+      v[c] = (double) (src[i * channels + c] / scaling_factor)                 \
+                   - st->d->a[1] * v[1 * channels + c]                         \
+                   - st->d->a[2] * v[2 * channels + c]                         \
+                   - st->d->a[3] * v[3 * channels + c]                         \
+                   - st->d->a[4] * v[4 * channels + c];                        \
+      y =            st->d->b[0] * v[c]                                        \
+                   + st->d->b[1] * v[1 * channels + c]                         \
+                   + st->d->b[2] * v[2 * channels + c]                         \
+                   + st->d->b[3] * v[3 * channels + c]                         \
+                   + st->d->b[4] * v[4 * channels + c];                        \
+      audio_data[i * channels + c] = y;                                        \
+      energy += y * y;                                                         \
+      v[4 * channels + c] = v[3 * channels + c];                               \
+      v[3 * channels + c] = v[2 * channels + c];                               \
+      v[2 * channels + c] = v[1 * channels + c];                               \
+      v[1 * channels + c] = v[c];                                              \
     }                                                                          \
-    FLUSH_MANUALLY                                                             \
+    st->d->channel_energy[c] = energy;                                         \
   }                                                                            \
+  for (c = 0; c < channels; ++c) {                                             \
+    st->d->partial_energy += st->d->channel_weight[c] *                        \
+                             st->d->channel_energy[c];                         \
+  }                                                                            \
+  FLUSH_MANUALLY                                                               \
   TURN_OFF_FTZ                                                                 \
 }
 EBUR128_FILTER(short, SHRT_MIN, SHRT_MAX)
@@ -510,41 +725,46 @@ static size_t find_histogram_index(double energy) {
   return index_min;
 }
 
-static int ebur128_calc_gating_block(ebur128_state* st, size_t frames_per_block,
-                                     double* optional_output) {
+/* Returns the weighted energy of the given frames of audio_data. */
+static double ebur128_energy_in_frames(ebur128_state* st, size_t first_frame,
+                                       size_t frames) {
   size_t i, c;
   double sum = 0.0;
-  double channel_sum;
   for (c = 0; c < st->channels; ++c) {
-    if (st->d->channel_map[c] == EBUR128_UNUSED) continue;
-    channel_sum = 0.0;
-    if (st->d->audio_data_index < frames_per_block * st->channels) {
-      for (i = 0; i < st->d->audio_data_index / st->channels; ++i) {
-        channel_sum += st->d->audio_data[i * st->channels + c] *
-                       st->d->audio_data[i * st->channels + c];
-      }
-      for (i = st->d->audio_data_frames -
-              (frames_per_block -
-               st->d->audio_data_index / st->channels);
-           i < st->d->audio_data_frames; ++i) {
-        channel_sum += st->d->audio_data[i * st->channels + c] *
-                       st->d->audio_data[i * st->channels + c];
-      }
-    } else {
-      for (i = st->d->audio_data_index / st->channels - frames_per_block;
-           i < st->d->audio_data_index / st->channels;
-           ++i) {
-        channel_sum += st->d->audio_data[i * st->channels + c] *
-                       st->d->audio_data[i * st->channels + c];
-      }
-    }
-    if (st->d->channel_map[c] == EBUR128_LEFT_SURROUND ||
-        st->d->channel_map[c] == EBUR128_RIGHT_SURROUND) {
-      channel_sum *= 1.41;
-    } else if (st->d->channel_map[c] == EBUR128_DUAL_MONO) {
-      channel_sum *= 2.0;
+    double channel_sum = 0.0;
+    if (st->d->channel_weight[c] == 0.0) continue;
+    for (i = first_frame; i < first_frame + frames; ++i) {
+      channel_sum += st->d->audio_data[i * st->channels + c] *
+                     st->d->audio_data[i * st->channels + c];
     }
-    sum += channel_sum;
+    sum += st->d->channel_weight[c] * channel_sum;
+  }
+  return sum;
+}
+
+/* The energy of a block is computed from the energies of the 100ms segments
+ * it spans, which are accumulated by the filter. Only the part of the oldest
+ * segment that is still in the block needs to be summed again, when the block
+ * does not end on a segment boundary. */
+static int ebur128_calc_gating_block(ebur128_state* st, size_t frames_per_block,
+                                     double* optional_output) {
+  size_t segment_frames = st->d->samples_in_100ms;
+  size_t segments = st->d->audio_data_frames / segment_frames;
+  size_t block_segments = frames_per_block / segment_frames;
+  size_t frame = st->d->audio_data_index / st->channels;
+  size_t current = frame / segment_frames;
+  size_t done = frame % segment_frames;
+  size_t oldest = (current + segments - block_segments) % segments;
+  size_t i;
+  double sum = st->d->partial_energy;
+  for (i = 1; i < block_segments; ++i) {
+    sum += st->d->segment_energy[(current + segments - i) % segments];
+  }
+  if (done) {
+    sum += ebur128_energy_in_frames(st, oldest * segment_frames + done,
+                                    segment_frames - done);
+  } else {
+    sum += st->d->segment_energy[oldest];
   }
   sum /= (double) frames_per_block;
   if (optional_output) {
@@ -578,6 +798,7 @@ int ebur128_set_channel(ebur128_state* st,
     return 1;
   }
   st->d->channel_map[channel_number] = value;
+  ebur128_update_channel_weight(st, channel_number);
   return 0;
 }
 
@@ -591,11 +812,14 @@ int ebur128_change_parameters(ebur128_state* st,
   }
   free(st->d->audio_data);
   st->d->audio_data = NULL;
+  free(st->d->segment_energy);
+  st->d->segment_energy = NULL;
 
   if (channels != st->channels) {
     unsigned int i;
 
     free(st->d->channel_map); st->d->channel_map = NULL;
+    ebur128_destroy_channel_data(st);
     free(st->d->sample_peak); st->d->sample_peak = NULL;
     free(st->d->true_peak);   st->d->true_peak = NULL;
     st->channels = channels;
@@ -605,6 +829,8 @@ int ebur128_change_parameters(ebur128_state* st,
     ebur128_init_resampler(st);
 #endif
 
+    errcode = ebur128_init_channel_data(st);
+    CHECK_ERROR(errcode, EBUR128_ERROR_NOMEM, exit)
     errcode = ebur128_init_channel_map(st);
     CHECK_ERROR(errcode, EBUR128_ERROR_NOMEM, exit)
 
@@ -619,6 +845,7 @@ int ebur128_change_parameters(ebur128_state* st,
   }
   if (samplerate != st->samplerate) {
     st->samplerate = samplerate;
+    st->d->samples_in_100ms = (st->samplerate + 5) / 10;
     ebur128_init_filter(st);
   }
   if ((st->mode & EBUR128_MODE_S) == EBUR128_MODE_S) {
@@ -628,13 +855,11 @@ int ebur128_change_parameters(ebur128_state* st,
   } else {
     return 1;
   }
-  st->d->audio_data = (double*) malloc(st->d->audio_data_frames *
-                                       st->channels *
-                                       sizeof(double));
-  CHECK_ERROR(!st->d->audio_data, EBUR128_ERROR_NOMEM, exit)
+  errcode = ebur128_init_audio_data(st);
+  CHECK_ERROR(errcode, EBUR128_ERROR_NOMEM, exit)
 
-  /* the first block needs 400ms of audio data */
-  st->d->needed_frames = st->d->samples_in_100ms * 4;
+  /* audio data is processed in segments of 100ms */
+  st->d->needed_frames = st->d->samples_in_100ms;
   /* start at the beginning of the buffer */
   st->d->audio_data_index = 0;
   /* reset short term frame counter */
@@ -658,8 +883,16 @@ int ebur128_add_frames_##type(ebur128_state* st,                               \
       src_index += st->d->needed_frames * st->channels;                        \
       frames -= st->d->needed_frames;                                          \
       st->d->audio_data_index += st->d->needed_frames * st->channels;          \
+      /* store the energy of the completed segment */                          \
+      st->d->segment_energy[(st->d->audio_data_index / st->channels - 1) /     \
+                            st->d->samples_in_100ms] = st->d->partial_energy;  \
+      st->d->partial_energy = 0.0;                                             \
+      if (st->d->complete_segments < 4) {                                      \
+        ++st->d->complete_segments;                                            \
+      }                                                                        \
       /* calculate the new gating block */                                     \
-      if ((st->mode & EBUR128_MODE_I) == EBUR128_MODE_I) {                     \
+      if ((st->mode & EBUR128_MODE_I) == EBUR128_MODE_I &&                     \
+          st->d->complete_segments == 4) {                                     \
         if (ebur128_calc_gating_block(st, st->d->samples_in_100ms * 4, NULL)) {\
           return EBUR128_ERROR_NOMEM;                                          \
         }                                                                      \
@@ -685,7 +918,6 @@ int ebur128_add_frames_##type(ebur128_state* st,                               \
           st->d->short_term_frame_counter = st->d->samples_in_100ms * 20;      \
         }                                                                      \
       }                                                                        \
-      /* 100ms are needed for all blocks besides the first one */              \
       st->d->needed_frames = st->d->samples_in_100ms;                          \
       /* reset audio_data_index when buffer full */                            \
       if (st->d->audio_data_index == st->d->audio_data_frames * st->channels) {\
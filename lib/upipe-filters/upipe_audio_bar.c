@@ -56,6 +56,8 @@
 #define OUTPUT_FLOW_DEF "pic."
 /** default alpha channel */
 #define DEFAULT_ALPHA 0x60
+/** number of pictures kept to be updated */
+#define UPIPE_AUDIOBAR_PICS 2
 
 /** @hidden */
 static bool upipe_audiobar_handle(struct upipe *upipe, struct uref *uref,
@@ -67,6 +69,14 @@ static int upipe_audiobar_check_flow_format(struct upipe *upipe,
 static int upipe_audiobar_check_ubuf_mgr(struct upipe *upipe,
                                          struct uref *flow_format);
 
+/** @internal @This describes a picture kept to be updated. */
+struct upipe_audiobar_pic {
+    /** picture buffer, or NULL */
+    struct ubuf *ubuf;
+    /** top of the bright part of the bar drawn for each channel */
+    int hmax[255];
+};
+
 /** @internal @This is the private context of a audiobar pipe */
 struct upipe_audiobar {
     /** refcount management structure */
@@ -100,6 +110,10 @@ struct upipe_audiobar {
     double peak[255];
     /* peak date */
     uint64_t peak_date[255];
+    /** pictures kept to be updated */
+    struct upipe_audiobar_pic pics[UPIPE_AUDIOBAR_PICS];
+    /** index of the last output picture */
+    unsigned int last_pic;
 
     /** temporary uref storage (used during urequest) */
     struct uchain urefs;
@@ -175,11 +189,29 @@ static struct upipe *upipe_audiobar_alloc(struct upipe_mgr *mgr,
         upipe_audiobar->peak[i] = 0.;
         upipe_audiobar->peak_date[i] = 0;
     }
+    for (int i = 0; i < UPIPE_AUDIOBAR_PICS; i++)
+        upipe_audiobar->pics[i].ubuf = NULL;
+    upipe_audiobar->last_pic = 0;
 
     upipe_throw_ready(upipe);
     return upipe;
 }
 
+/** @internal @This releases the pictures kept to be updated.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_audiobar_flush_pics(struct upipe *upipe)
+{
+    struct upipe_audiobar *upipe_audiobar = upipe_audiobar_from_upipe(upipe);
+    for (int i = 0; i < UPIPE_AUDIOBAR_PICS; i++) {
+        if (upipe_audiobar->pics[i].ubuf != NULL) {
+            ubuf_free(upipe_audiobar->pics[i].ubuf);
+            upipe_audiobar->pics[i].ubuf = NULL;
+        }
+    }
+}
+
 /** @internal @This converts dB to IEC 268-18 scale.
  *
  * @param dB amplitude in decibels
@@ -229,6 +261,38 @@ static void copy_color(uint8_t **dst, size_t *strides,
            color[3], w / hsubs[3]); // a8
 }
 
+/** planes of the output pictures */
+static const char *upipe_audiobar_chroma[4] = { "y8", "u8", "v8", "a8" };
+
+/** @internal @This maps the planes of a picture for writing.
+ *
+ * @param ubuf picture buffer
+ * @param dst filled in with the array of destination chromas
+ * @param strides filled in with the array of strides for each chroma
+ * @param hsubs filled in with the array of hsubs of each chroma
+ * @param vsubs filled in with the array of vsubs of each chroma
+ * @return an error code, in particular if the picture is shared
+ */
+static int upipe_audiobar_map(struct ubuf *ubuf, uint8_t **dst,
+                              size_t *strides, uint8_t *hsubs, uint8_t *vsubs)
+{
+    for (int i = 0; i < 4; i++) {
+        int err = ubuf_pic_plane_size(ubuf, upipe_audiobar_chroma[i],
+                                      &strides[i], &hsubs[i], &vsubs[i],
+                                      NULL);
+        if (ubase_check(err))
+            err = ubuf_pic_plane_write(ubuf, upipe_audiobar_chroma[i],
+                                       0, 0, -1, -1, &dst[i]);
+        if (unlikely(!ubase_check(err))) {
+            while (--i >= 0)
+                ubuf_pic_plane_unmap(ubuf, upipe_audiobar_chroma[i],
+                                     0, 0, -1, -1);
+            return err;
+        }
+    }
+    return UBASE_ERR_NONE;
+}
+
 /** @internal @This handles data.
  *
  * @param upipe description structure of the pipe
@@ -258,6 +322,7 @@ static bool upipe_audiobar_handle(struct upipe *upipe, struct uref *uref,
 
         upipe_audiobar->hsize = upipe_audiobar->vsize =
             upipe_audiobar->sep_width = upipe_audiobar->pad_width = UINT64_MAX;
+        upipe_audiobar_flush_pics(upipe);
         upipe_audiobar_require_flow_format(upipe, uref);
         return true;
     }
@@ -268,42 +333,13 @@ static bool upipe_audiobar_handle(struct upipe *upipe, struct uref *uref,
     if (unlikely(upipe_audiobar->hsize == UINT64_MAX))
         return false;
 
-    struct ubuf *ubuf = ubuf_pic_alloc(upipe_audiobar->ubuf_mgr,
-                                       upipe_audiobar->hsize,
-                                       upipe_audiobar->vsize);
-    uref_attach_ubuf(uref, ubuf);
-
-    uint8_t *dst[4];
-    size_t strides[4];
-    uint8_t hsubs[4];
-    uint8_t vsubs[4];
-    static const char *chroma[4] = { "y8", "u8", "v8", "a8" };
-    for (int i = 0; i < 4; i++) {
-        if (unlikely(!ubase_check(uref_pic_plane_write(uref, chroma[i],
-                            0, 0, -1, -1, &dst[i])) ||
-                     !ubase_check(uref_pic_plane_size(uref, chroma[i],
-                             &strides[i], &hsubs[i], &vsubs[i], NULL)))) {
-             upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
-             uref_free(uref);
-             return true;
-        }
-    }
-
-    uint8_t alpha = upipe_audiobar->alpha;
     uint64_t h = upipe_audiobar->vsize;
-    const int hred = h - (iec_scale(-8.) * h);
-    const int hyellow = h - (iec_scale(-18.) * h);
-    uint8_t transparent[4] = { 0x10, 0x80, 0x80, 0 };
-    uint8_t black[4] = { 0x10, 0x80, 0x80, alpha };
-    uint8_t red[2][4] = { { 76, 85, 0xff, alpha }, { 37, 106, 191, alpha } };
-    uint8_t green[2][4] = { { 150, 44, 21, alpha }, { 74, 85, 74, alpha } };
-    uint8_t yellow[2][4] = { { 226, 1, 148, alpha }, { 112, 64, 138, alpha } };
-
     uint64_t pts = 0;
     if (unlikely(!ubase_check(uref_clock_get_pts_prog(uref, &pts)))) {
         upipe_warn(upipe, "unable to read pts");
     }
 
+    int hmax[255];
     for (uint8_t chan = 0; chan < upipe_audiobar->channels; chan++) {
         double amplitude = 0.;
         if (unlikely(!ubase_check(uref_amax_get_amplitude(uref, &amplitude,
@@ -325,9 +361,73 @@ static bool upipe_audiobar_handle(struct upipe *upipe, struct uref *uref,
 
         scale = iec_scale(scale);
 
-        const int hmax = h - scale * h;
+        hmax[chan] = h - scale * h;
+    }
+
+    /* the last picture may be output again if no bar moved */
+    struct upipe_audiobar_pic *pic =
+        &upipe_audiobar->pics[upipe_audiobar->last_pic];
+    if (pic->ubuf != NULL &&
+        !memcmp(pic->hmax, hmax, upipe_audiobar->channels * sizeof (int)))
+        goto output;
+
+    /* otherwise update a picture which is not used downstream anymore, or
+     * draw a new one */
+    uint8_t *dst[4];
+    size_t strides[4];
+    uint8_t hsubs[4];
+    uint8_t vsubs[4];
+    bool full = true;
+    for (int i = 0; i < UPIPE_AUDIOBAR_PICS; i++) {
+        unsigned int index = (upipe_audiobar->last_pic + i) %
+                             UPIPE_AUDIOBAR_PICS;
+        pic = &upipe_audiobar->pics[index];
+        if (pic->ubuf != NULL &&
+            ubase_check(upipe_audiobar_map(pic->ubuf, dst, strides,
+                                           hsubs, vsubs))) {
+            upipe_audiobar->last_pic = index;
+            full = false;
+            break;
+        }
+    }
+    if (full) {
+        upipe_audiobar->last_pic = (upipe_audiobar->last_pic + 1) %
+                                   UPIPE_AUDIOBAR_PICS;
+        pic = &upipe_audiobar->pics[upipe_audiobar->last_pic];
+        if (pic->ubuf != NULL)
+            ubuf_free(pic->ubuf);
+        pic->ubuf = ubuf_pic_alloc(upipe_audiobar->ubuf_mgr,
+                                   upipe_audiobar->hsize,
+                                   upipe_audiobar->vsize);
+        if (unlikely(pic->ubuf == NULL ||
+                     !ubase_check(upipe_audiobar_map(pic->ubuf, dst, strides,
+                                                     hsubs, vsubs)))) {
+            if (pic->ubuf != NULL) {
+                ubuf_free(pic->ubuf);
+                pic->ubuf = NULL;
+            }
+            upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+            uref_free(uref);
+            return true;
+        }
+    }
+
+    uint8_t alpha = upipe_audiobar->alpha;
+    const int hred = h - (iec_scale(-8.) * h);
+    const int hyellow = h - (iec_scale(-18.) * h);
+    uint8_t transparent[4] = { 0x10, 0x80, 0x80, 0 };
+    uint8_t black[4] = { 0x10, 0x80, 0x80, alpha };
+    uint8_t red[2][4] = { { 76, 85, 0xff, alpha }, { 37, 106, 191, alpha } };
+    uint8_t green[2][4] = { { 150, 44, 21, alpha }, { 74, 85, 74, alpha } };
+    uint8_t yellow[2][4] = { { 226, 1, 148, alpha }, { 112, 64, 138, alpha } };
+
+    for (uint8_t chan = 0; chan < upipe_audiobar->channels; chan++) {
+        if (!full && pic->hmax[chan] == hmax[chan])
+            continue;
+        pic->hmax[chan] = hmax[chan];
+
         for (int row = 0; row < h; row++) {
-            bool bright = row > hmax;
+            bool bright = row > hmax[chan];
 
             const uint8_t *color = row < hred ? red[!bright] :
                                    row < hyellow ? yellow[!bright] :
@@ -341,8 +441,15 @@ static bool upipe_audiobar_handle(struct upipe *upipe, struct uref *uref,
                            chan * upipe_audiobar->chan_width -
                            upipe_audiobar->sep_width / 2,
                            upipe_audiobar->sep_width);
+            /* the bar overlapped the separation with the next channel */
+            if (!full && chan < upipe_audiobar->channels - 1 &&
+                upipe_audiobar->sep_width)
+                copy_color(dst, strides, hsubs, vsubs, black, row,
+                           (chan + 1) * upipe_audiobar->chan_width -
+                           upipe_audiobar->sep_width / 2,
+                           upipe_audiobar->sep_width);
 
-            if (chan == upipe_audiobar->channels - 1 &&
+            if (full && chan == upipe_audiobar->channels - 1 &&
                 upipe_audiobar->pad_width)
                 copy_color(dst, strides, hsubs, vsubs, transparent, row,
                            (chan + 1) * upipe_audiobar->chan_width,
@@ -358,7 +465,18 @@ static bool upipe_audiobar_handle(struct upipe *upipe, struct uref *uref,
     }
 
     for (int i = 0; i < 4; i++)
-        ubuf_pic_plane_unmap(ubuf, chroma[i], 0, 0, -1, -1);
+        ubuf_pic_plane_unmap(pic->ubuf, upipe_audiobar_chroma[i],
+                             0, 0, -1, -1);
+
+output:
+    ;
+    struct ubuf *ubuf = ubuf_dup(pic->ubuf);
+    if (unlikely(ubuf == NULL)) {
+        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+        uref_free(uref);
+        return true;
+    }
+    uref_attach_ubuf(uref, ubuf);
     upipe_audiobar_output(upipe, uref, upump_p);
     return true;
 }
@@ -414,6 +532,7 @@ static int upipe_audiobar_check_ubuf_mgr(struct upipe *upipe,
         return UBASE_ERR_NONE;
 
     upipe_audiobar_store_flow_def(upipe, flow_format);
+    upipe_audiobar_flush_pics(upipe);
     UBASE_RETURN(uref_pic_flow_get_hsize(flow_format, &upipe_audiobar->hsize))
     UBASE_RETURN(uref_pic_flow_get_vsize(flow_format, &upipe_audiobar->vsize))
     upipe_audiobar->chan_width =
@@ -490,6 +609,8 @@ static int _upipe_audiobar_get_alpha(struct upipe *upipe, uint8_t *alpha_p)
 static int _upipe_audiobar_set_alpha(struct upipe *upipe, uint8_t alpha)
 {
     struct upipe_audiobar *upipe_audiobar = upipe_audiobar_from_upipe(upipe);
+    if (alpha != upipe_audiobar->alpha)
+        upipe_audiobar_flush_pics(upipe);
     upipe_audiobar->alpha = alpha;
     return UBASE_ERR_NONE;
 }
@@ -552,6 +673,7 @@ static void upipe_audiobar_free(struct upipe *upipe)
     upipe_throw_dead(upipe);
 
     struct upipe_audiobar *upipe_audiobar = upipe_audiobar_from_upipe(upipe);
+    upipe_audiobar_flush_pics(upipe);
     uref_free(upipe_audiobar->flow_def_config);
     upipe_audiobar_clean_flow_format(upipe);
     upipe_audiobar_clean_ubuf_mgr(upipe);
@@ -58,6 +58,9 @@
 /** @hidden */
 static bool upipe_agraph_handle(struct upipe *upipe, struct uref *uref,
                                 struct upump **upump_p);
+/** number of pictures kept to be updated */
+#define UPIPE_AGRAPH_PICS 2
+
 /** @hidden */
 static int upipe_agraph_check_flow_format(struct upipe *upipe,
                                           struct uref *flow_format);
@@ -65,6 +68,14 @@ static int upipe_agraph_check_flow_format(struct upipe *upipe,
 static int upipe_agraph_check_ubuf_mgr(struct upipe *upipe,
                                        struct uref *flow_format);
 
+/** @internal @This describes a picture kept to be updated. */
+struct upipe_agraph_pic {
+    /** picture buffer, or NULL */
+    struct ubuf *ubuf;
+    /** top of the bar drawn for each channel and history column */
+    int *hmax;
+};
+
 /** @internal @This is the private context of a agraph pipe */
 struct upipe_agraph {
     /** refcount management structure */
@@ -98,6 +109,12 @@ struct upipe_agraph {
     uint64_t peak_date[255];
     /** previous values */
     double *prev[255];
+    /** top of the bars to draw for each channel and history column */
+    int *hmax;
+    /** pictures kept to be updated */
+    struct upipe_agraph_pic pics[UPIPE_AGRAPH_PICS];
+    /** index of the last output picture */
+    unsigned int last_pic;
 
     /** temporary uref storage (used during urequest) */
     struct uchain urefs;
@@ -175,11 +192,41 @@ static struct upipe *upipe_agraph_alloc(struct upipe_mgr *mgr,
         upipe_agraph->peak_date[i] = 0;
         upipe_agraph->prev[i] = NULL;
     }
+    upipe_agraph->hmax = NULL;
+    for (int i = 0; i < UPIPE_AGRAPH_PICS; i++) {
+        upipe_agraph->pics[i].ubuf = NULL;
+        upipe_agraph->pics[i].hmax = NULL;
+    }
+    upipe_agraph->last_pic = 0;
 
     upipe_throw_ready(upipe);
     return upipe;
 }
 
+/** @internal @This releases the pictures kept to be updated, and the
+ * history of the channels.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_agraph_flush_pics(struct upipe *upipe)
+{
+    struct upipe_agraph *upipe_agraph = upipe_agraph_from_upipe(upipe);
+    for (int i = 0; i < UPIPE_AGRAPH_PICS; i++) {
+        if (upipe_agraph->pics[i].ubuf != NULL) {
+            ubuf_free(upipe_agraph->pics[i].ubuf);
+            upipe_agraph->pics[i].ubuf = NULL;
+        }
+        free(upipe_agraph->pics[i].hmax);
+        upipe_agraph->pics[i].hmax = NULL;
+    }
+    for (int i = 0; i < 255; i++) {
+        free(upipe_agraph->prev[i]);
+        upipe_agraph->prev[i] = NULL;
+    }
+    free(upipe_agraph->hmax);
+    upipe_agraph->hmax = NULL;
+}
+
 /** @internal @This converts dB to IEC 268-18 scale.
  *
  * @param dB amplitude in decibels
@@ -227,6 +274,38 @@ static void copy_color(uint8_t **dst, size_t *strides,
            color[2], w / hsubs[2]); // v8
 }
 
+/** planes of the output pictures */
+static const char *upipe_agraph_chroma[3] = { "y8", "u8", "v8" };
+
+/** @internal @This maps the planes of a picture for writing.
+ *
+ * @param ubuf picture buffer
+ * @param dst filled in with the array of destination chromas
+ * @param strides filled in with the array of strides for each chroma
+ * @param hsubs filled in with the array of hsubs of each chroma
+ * @param vsubs filled in with the array of vsubs of each chroma
+ * @return an error code, in particular if the picture is shared
+ */
+static int upipe_agraph_map(struct ubuf *ubuf, uint8_t **dst,
+                            size_t *strides, uint8_t *hsubs, uint8_t *vsubs)
+{
+    for (int i = 0; i < 3; i++) {
+        int err = ubuf_pic_plane_size(ubuf, upipe_agraph_chroma[i],
+                                      &strides[i], &hsubs[i], &vsubs[i],
+                                      NULL);
+        if (ubase_check(err))
+            err = ubuf_pic_plane_write(ubuf, upipe_agraph_chroma[i],
+                                       0, 0, -1, -1, &dst[i]);
+        if (unlikely(!ubase_check(err))) {
+            while (--i >= 0)
+                ubuf_pic_plane_unmap(ubuf, upipe_agraph_chroma[i],
+                                     0, 0, -1, -1);
+            return err;
+        }
+    }
+    return UBASE_ERR_NONE;
+}
+
 /** @internal @This handles data.
  *
  * @param upipe description structure of the pipe
@@ -255,6 +334,7 @@ static bool upipe_agraph_handle(struct upipe *upipe, struct uref *uref,
 
         upipe_agraph->hsize = upipe_agraph->vsize =
             upipe_agraph->sep_width = upipe_agraph->pad_width = UINT64_MAX;
+        upipe_agraph_flush_pics(upipe);
         upipe_agraph_require_flow_format(upipe, uref);
         return true;
     }
@@ -265,41 +345,22 @@ static bool upipe_agraph_handle(struct upipe *upipe, struct uref *uref,
     if (unlikely(upipe_agraph->hsize == UINT64_MAX))
         return false;
 
-    struct ubuf *ubuf = ubuf_pic_alloc(upipe_agraph->ubuf_mgr,
-                                       upipe_agraph->hsize,
-                                       upipe_agraph->vsize);
-    uref_attach_ubuf(uref, ubuf);
-
-    uint8_t *dst[4];
-    size_t strides[4];
-    uint8_t hsubs[4];
-    uint8_t vsubs[4];
-    static const char *chroma[3] = { "y8", "u8", "v8" };
-    for (int i = 0; i < 3; i++) {
-        if (unlikely(!ubase_check(uref_pic_plane_write(uref, chroma[i],
-                            0, 0, -1, -1, &dst[i])) ||
-                     !ubase_check(uref_pic_plane_size(uref, chroma[i],
-                             &strides[i], &hsubs[i], &vsubs[i], NULL)))) {
-             upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
-             uref_free(uref);
-             return true;
-        }
-    }
-
     uint64_t h = upipe_agraph->vsize;
-    const int hred = h - (iec_scale(-8.) * h);
-    const int hyellow = h - (iec_scale(-18.) * h);
-    uint8_t transparent[3] = { 0x10, 0x80, 0x80 };
-    uint8_t black[3] = { 0x10, 0x80, 0x80 };
-    uint8_t red[2][3] = { { 76, 85, 0xff }, { 37, 106, 191 } };
-    uint8_t green[2][3] = { { 150, 44, 21 }, { 74, 85, 74 } };
-    uint8_t yellow[2][3] = { { 226, 1, 148 }, { 112, 64, 138 } };
-
     uint64_t pts = 0;
     if (unlikely(!ubase_check(uref_clock_get_pts_prog(uref, &pts)))) {
         upipe_warn(upipe, "unable to read pts");
     }
 
+    size_t nb_hmax = upipe_agraph->channels * upipe_agraph->chan_hist;
+    if (unlikely(upipe_agraph->hmax == NULL)) {
+        upipe_agraph->hmax = malloc(nb_hmax * sizeof(int));
+        if (unlikely(upipe_agraph->hmax == NULL)) {
+            upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+            uref_free(uref);
+            return true;
+        }
+    }
+
     for (uint8_t chan = 0; chan < upipe_agraph->channels; chan++) {
         double amplitude = 0.;
         if (unlikely(!ubase_check(uref_amax_get_amplitude(uref, &amplitude,
@@ -338,18 +399,84 @@ static bool upipe_agraph_handle(struct upipe *upipe, struct uref *uref,
 
         upipe_agraph->prev[chan][upipe_agraph->chan_hist - 1] = scale;
 
+        int *hmax = &upipe_agraph->hmax[chan * upipe_agraph->chan_hist];
+        for (uint64_t i = 0; i < upipe_agraph->chan_hist; i++)
+            hmax[i] = h - upipe_agraph->prev[chan][i] * h;
+    }
+
+    /* the last picture may be output again if the graph did not move */
+    struct upipe_agraph_pic *pic = &upipe_agraph->pics[upipe_agraph->last_pic];
+    if (pic->ubuf != NULL &&
+        !memcmp(pic->hmax, upipe_agraph->hmax, nb_hmax * sizeof(int)))
+        goto output;
+
+    /* otherwise update a picture which is not used downstream anymore, or
+     * draw a new one */
+    uint8_t *dst[4];
+    size_t strides[4];
+    uint8_t hsubs[4];
+    uint8_t vsubs[4];
+    bool full = true;
+    for (int i = 0; i < UPIPE_AGRAPH_PICS; i++) {
+        unsigned int index = (upipe_agraph->last_pic + i) % UPIPE_AGRAPH_PICS;
+        pic = &upipe_agraph->pics[index];
+        if (pic->ubuf != NULL &&
+            ubase_check(upipe_agraph_map(pic->ubuf, dst, strides,
+                                         hsubs, vsubs))) {
+            upipe_agraph->last_pic = index;
+            full = false;
+            break;
+        }
+    }
+    if (full) {
+        upipe_agraph->last_pic = (upipe_agraph->last_pic + 1) %
+                                 UPIPE_AGRAPH_PICS;
+        pic = &upipe_agraph->pics[upipe_agraph->last_pic];
+        if (pic->ubuf != NULL)
+            ubuf_free(pic->ubuf);
+        if (pic->hmax == NULL)
+            pic->hmax = malloc(nb_hmax * sizeof(int));
+        pic->ubuf = ubuf_pic_alloc(upipe_agraph->ubuf_mgr,
+                                   upipe_agraph->hsize,
+                                   upipe_agraph->vsize);
+        if (unlikely(pic->hmax == NULL || pic->ubuf == NULL ||
+                     !ubase_check(upipe_agraph_map(pic->ubuf, dst, strides,
+                                                   hsubs, vsubs)))) {
+            if (pic->ubuf != NULL) {
+                ubuf_free(pic->ubuf);
+                pic->ubuf = NULL;
+            }
+            upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+            uref_free(uref);
+            return true;
+        }
+    }
+
+    const int hred = h - (iec_scale(-8.) * h);
+    const int hyellow = h - (iec_scale(-18.) * h);
+    uint8_t transparent[3] = { 0x10, 0x80, 0x80 };
+    uint8_t black[3] = { 0x10, 0x80, 0x80 };
+    uint8_t red[2][3] = { { 76, 85, 0xff }, { 37, 106, 191 } };
+    uint8_t green[2][3] = { { 150, 44, 21 }, { 74, 85, 74 } };
+    uint8_t yellow[2][3] = { { 226, 1, 148 }, { 112, 64, 138 } };
+
+    for (uint8_t chan = 0; chan < upipe_agraph->channels; chan++) {
+        const int *hmax = &upipe_agraph->hmax[chan * upipe_agraph->chan_hist];
+        int *pic_hmax = &pic->hmax[chan * upipe_agraph->chan_hist];
         for (uint64_t i = 0; i < upipe_agraph->chan_hist; i++) {
-            scale = upipe_agraph->prev[chan][i];
-            const int hmax = h - scale * h;
+            if (!full && pic_hmax[i] == hmax[i])
+                continue;
+            pic_hmax[i] = hmax[i];
+
             for (int row = 0; row < h; row++) {
                 bool bright = (i == upipe_agraph->chan_hist - 1);
 
-                const uint8_t *color = row < hmax ? black :
+                const uint8_t *color = row < hmax[i] ? black :
                                        row < hred ? red[!bright] :
                                        row < hyellow ? yellow[!bright] :
                                        green[!bright];
 
-                if (!i && upipe_agraph->sep_width)
+                if (full && !i && upipe_agraph->sep_width)
                     copy_color(dst, strides, hsubs, vsubs, black, row,
                                chan * upipe_agraph->chan_width,
                                upipe_agraph->sep_width);
@@ -358,7 +485,7 @@ static bool upipe_agraph_handle(struct upipe *upipe, struct uref *uref,
                            chan * upipe_agraph->chan_width + 2 * i,
                            2);
 
-                if (chan == upipe_agraph->channels - 1 &&
+                if (full && chan == upipe_agraph->channels - 1 &&
                     upipe_agraph->pad_width)
                     copy_color(dst, strides, hsubs, vsubs, transparent, row,
                                (chan + 1) * upipe_agraph->chan_width,
@@ -375,7 +502,17 @@ static bool upipe_agraph_handle(struct upipe *upipe, struct uref *uref,
     }
 
     for (int i = 0; i < 3; i++)
-        ubuf_pic_plane_unmap(ubuf, chroma[i], 0, 0, -1, -1);
+        ubuf_pic_plane_unmap(pic->ubuf, upipe_agraph_chroma[i], 0, 0, -1, -1);
+
+output:
+    ;
+    struct ubuf *ubuf = ubuf_dup(pic->ubuf);
+    if (unlikely(ubuf == NULL)) {
+        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+        uref_free(uref);
+        return true;
+    }
+    uref_attach_ubuf(uref, ubuf);
     upipe_agraph_output(upipe, uref, upump_p);
     return true;
 }
@@ -451,10 +588,7 @@ static int upipe_agraph_check_ubuf_mgr(struct upipe *upipe,
             upipe_agraph->chan_width, upipe_agraph->sep_width,
             upipe_agraph->pad_width);
 
-    for (int i = 0; i < 255; i++) {
-        free(upipe_agraph->prev[i]);
-        upipe_agraph->prev[i] = NULL;
-    }
+    upipe_agraph_flush_pics(upipe);
 
     bool was_buffered = !upipe_agraph_check_input(upipe);
     upipe_agraph_output_input(upipe);
@@ -537,8 +671,7 @@ static void upipe_agraph_free(struct upipe *upipe)
     upipe_throw_dead(upipe);
 
     struct upipe_agraph *upipe_agraph = upipe_agraph_from_upipe(upipe);
-    for (int i = 0; i < 255; i++)
-        free(upipe_agraph->prev[i]);
+    upipe_agraph_flush_pics(upipe);
     uref_free(upipe_agraph->flow_def_config);
     upipe_agraph_clean_flow_format(upipe);
     upipe_agraph_clean_ubuf_mgr(upipe);
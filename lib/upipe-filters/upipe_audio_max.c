@@ -30,6 +30,7 @@
 #include <upipe/uref_sound_flow.h>
 #include <upipe/uref_sound.h>
 #include <upipe/upipe.h>
+#include <upipe/ucpu.h>
 #include <upipe/upipe_helper_upipe.h>
 #include <upipe/upipe_helper_urefcount.h>
 #include <upipe/upipe_helper_void.h>
@@ -40,16 +41,51 @@
 #include <strings.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <math.h>
 
-typedef double (*upipe_amax_process)(struct upipe *, struct uref *,
-                                     const char *, size_t);
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+/** number of vectors accumulated in single precision before being added to
+ * the double precision sums */
+#define UPIPE_AMAX_BLOCK 1024
+
+/** @internal @This accumulates the levels of a channel. */
+struct upipe_amax_acc {
+    /** peak absolute value of the samples */
+    double peak;
+    /** sum of the squares of the samples */
+    double sum;
+};
+
+/** @internal @This accumulates the levels of interleaved samples.
+ *
+ * @param buf buffer of samples
+ * @param values number of values in the buffer (samples * channels)
+ * @param channels number of interleaved channels
+ * @param acc array of accumulators, one per channel
+ */
+typedef void (*upipe_amax_process)(const void *buf, size_t values,
+                                   uint8_t channels,
+                                   struct upipe_amax_acc *acc);
 
 /** @internal upipe_amax private structure */
 struct upipe_amax {
     /** refcount management structure */
     struct urefcount urefcount;
 
+    /** function accumulating the levels of samples */
     upipe_amax_process process;
+    /** maximum value of a sample */
+    double sample_max;
+    /** number of channels */
+    uint8_t channels;
+    /** true if the channels are interleaved in a single plane */
+    bool interleaved;
 
     /** output */
     struct upipe *output;
@@ -94,39 +130,383 @@ static struct upipe *upipe_amax_alloc(struct upipe_mgr *mgr,
     return upipe;
 }
 
-#define UPIPE_AMAX_TEMPLATE(type, type_max)                                 \
-/** @internal @This processes input of format type.                         \
+/** @internal @This reduces the lanes of vector accumulators to the
+ * accumulators of the channels.
+ *
+ * @param peak peak of each lane
+ * @param sum sum of the squares of each lane
+ * @param lanes number of lanes, multiple of the number of channels
+ * @param channels number of interleaved channels
+ * @param acc array of accumulators, one per channel
+ */
+static inline void upipe_amax_reduce(const double *peak, const double *sum,
+                                     unsigned int lanes, uint8_t channels,
+                                     struct upipe_amax_acc *acc)
+{
+    for (unsigned int i = 0; i < lanes; i++) {
+        struct upipe_amax_acc *a = &acc[i % channels];
+        if (peak[i] > a->peak)
+            a->peak = peak[i];
+        a->sum += sum[i];
+    }
+}
+
+#if defined(__x86_64__)
+/** @internal @This accumulates the levels of 16-bit samples with SSE2.
+ *
+ * @param buf buffer of samples
+ * @param values number of values in the buffer
+ * @param channels number of interleaved channels, dividing 8
+ * @param acc array of accumulators, one per channel
+ * @return number of values processed
+ */
+static size_t upipe_amax_int16_t_sse2(const int16_t *buf, size_t values,
+                                      uint8_t channels,
+                                      struct upipe_amax_acc *acc)
+{
+    __m128i max = _mm_setzero_si128(), min = _mm_setzero_si128();
+    double sums[8] = { 0. };
+    size_t i = 0;
+    while (i + 8 <= values) {
+        __m128 s0 = _mm_setzero_ps(), s1 = _mm_setzero_ps();
+        for (unsigned int n = 0; n < UPIPE_AMAX_BLOCK && i + 8 <= values;
+             n++, i += 8) {
+            __m128i v = _mm_loadu_si128((const __m128i *)(buf + i));
+            max = _mm_max_epi16(max, v);
+            min = _mm_min_epi16(min, v);
+            __m128i sign = _mm_srai_epi16(v, 15);
+            __m128 lo = _mm_cvtepi32_ps(_mm_unpacklo_epi16(v, sign));
+            __m128 hi = _mm_cvtepi32_ps(_mm_unpackhi_epi16(v, sign));
+            s0 = _mm_add_ps(s0, _mm_mul_ps(lo, lo));
+            s1 = _mm_add_ps(s1, _mm_mul_ps(hi, hi));
+        }
+        float s[8];
+        _mm_storeu_ps(s, s0);
+        _mm_storeu_ps(s + 4, s1);
+        for (int l = 0; l < 8; l++)
+            sums[l] += s[l];
+    }
+
+    int16_t mx[8], mn[8];
+    _mm_storeu_si128((__m128i *)mx, max);
+    _mm_storeu_si128((__m128i *)mn, min);
+    double peaks[8];
+    for (int l = 0; l < 8; l++)
+        peaks[l] = mx[l] > -mn[l] ? mx[l] : -mn[l];
+    upipe_amax_reduce(peaks, sums, 8, channels, acc);
+    return i;
+}
+
+/** @internal @This accumulates the levels of 16-bit samples with AVX2.
+ *
+ * @param buf buffer of samples
+ * @param values number of values in the buffer
+ * @param channels number of interleaved channels, dividing 16
+ * @param acc array of accumulators, one per channel
+ * @return number of values processed
+ */
+__attribute__((target("avx2")))
+static size_t upipe_amax_int16_t_avx2(const int16_t *buf, size_t values,
+                                      uint8_t channels,
+                                      struct upipe_amax_acc *acc)
+{
+    __m256i max = _mm256_setzero_si256(), min = _mm256_setzero_si256();
+    double sums[16] = { 0. };
+    size_t i = 0;
+    while (i + 16 <= values) {
+        __m256 s0 = _mm256_setzero_ps(), s1 = _mm256_setzero_ps();
+        for (unsigned int n = 0; n < UPIPE_AMAX_BLOCK && i + 16 <= values;
+             n++, i += 16) {
+            __m256i v = _mm256_loadu_si256((const __m256i *)(buf + i));
+            max = _mm256_max_epi16(max, v);
+            min = _mm256_min_epi16(min, v);
+            __m256 lo = _mm256_cvtepi32_ps(
+                    _mm256_cvtepi16_epi32(_mm256_castsi256_si128(v)));
+            __m256 hi = _mm256_cvtepi32_ps(
+                    _mm256_cvtepi16_epi32(_mm256_extracti128_si256(v, 1)));
+            s0 = _mm256_add_ps(s0, _mm256_mul_ps(lo, lo));
+            s1 = _mm256_add_ps(s1, _mm256_mul_ps(hi, hi));
+        }
+        float s[16];
+        _mm256_storeu_ps(s, s0);
+        _mm256_storeu_ps(s + 8, s1);
+        for (int l = 0; l < 16; l++)
+            sums[l] += s[l];
+    }
+
+    int16_t mx[16], mn[16];
+    _mm256_storeu_si256((__m256i *)mx, max);
+    _mm256_storeu_si256((__m256i *)mn, min);
+    double peaks[16];
+    for (int l = 0; l < 16; l++)
+        peaks[l] = mx[l] > -mn[l] ? mx[l] : -mn[l];
+    upipe_amax_reduce(peaks, sums, 16, channels, acc);
+    return i;
+}
+
+/** @internal @This accumulates the levels of float samples with SSE.
+ *
+ * @param buf buffer of samples
+ * @param values number of values in the buffer
+ * @param channels number of interleaved channels, dividing 4
+ * @param acc array of accumulators, one per channel
+ * @return number of values processed
+ */
+static size_t upipe_amax_float_sse(const float *buf, size_t values,
+                                   uint8_t channels,
+                                   struct upipe_amax_acc *acc)
+{
+    const __m128 abs = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+    __m128 max = _mm_setzero_ps();
+    double sums[4] = { 0. };
+    size_t i = 0;
+    while (i + 4 <= values) {
+        __m128 s0 = _mm_setzero_ps();
+        for (unsigned int n = 0; n < UPIPE_AMAX_BLOCK && i + 4 <= values;
+             n++, i += 4) {
+            __m128 v = _mm_loadu_ps(buf + i);
+            max = _mm_max_ps(max, _mm_and_ps(v, abs));
+            s0 = _mm_add_ps(s0, _mm_mul_ps(v, v));
+        }
+        float s[4];
+        _mm_storeu_ps(s, s0);
+        for (int l = 0; l < 4; l++)
+            sums[l] += s[l];
+    }
+
+    float mx[4];
+    _mm_storeu_ps(mx, max);
+    double peaks[4];
+    for (int l = 0; l < 4; l++)
+        peaks[l] = mx[l];
+    upipe_amax_reduce(peaks, sums, 4, channels, acc);
+    return i;
+}
+
+/** @internal @This accumulates the levels of float samples with AVX2.
+ *
+ * @param buf buffer of samples
+ * @param values number of values in the buffer
+ * @param channels number of interleaved channels, dividing 8
+ * @param acc array of accumulators, one per channel
+ * @return number of values processed
+ */
+__attribute__((target("avx2")))
+static size_t upipe_amax_float_avx2(const float *buf, size_t values,
+                                    uint8_t channels,
+                                    struct upipe_amax_acc *acc)
+{
+    const __m256 abs = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+    __m256 max = _mm256_setzero_ps();
+    double sums[8] = { 0. };
+    size_t i = 0;
+    while (i + 8 <= values) {
+        __m256 s0 = _mm256_setzero_ps();
+        for (unsigned int n = 0; n < UPIPE_AMAX_BLOCK && i + 8 <= values;
+             n++, i += 8) {
+            __m256 v = _mm256_loadu_ps(buf + i);
+            max = _mm256_max_ps(max, _mm256_and_ps(v, abs));
+            s0 = _mm256_add_ps(s0, _mm256_mul_ps(v, v));
+        }
+        float s[8];
+        _mm256_storeu_ps(s, s0);
+        for (int l = 0; l < 8; l++)
+            sums[l] += s[l];
+    }
+
+    float mx[8];
+    _mm256_storeu_ps(mx, max);
+    double peaks[8];
+    for (int l = 0; l < 8; l++)
+        peaks[l] = mx[l];
+    upipe_amax_reduce(peaks, sums, 8, channels, acc);
+    return i;
+}
+#endif
+
+#if defined(__aarch64__)
+/** @internal @This accumulates the levels of 16-bit samples with NEON.
+ *
+ * @param buf buffer of samples
+ * @param values number of values in the buffer
+ * @param channels number of interleaved channels, dividing 8
+ * @param acc array of accumulators, one per channel
+ * @return number of values processed
+ */
+static size_t upipe_amax_int16_t_neon(const int16_t *buf, size_t values,
+                                      uint8_t channels,
+                                      struct upipe_amax_acc *acc)
+{
+    int16x8_t max = vdupq_n_s16(0), min = vdupq_n_s16(0);
+    double sums[8] = { 0. };
+    size_t i = 0;
+    while (i + 8 <= values) {
+        float32x4_t s0 = vdupq_n_f32(0.), s1 = vdupq_n_f32(0.);
+        for (unsigned int n = 0; n < UPIPE_AMAX_BLOCK && i + 8 <= values;
+             n++, i += 8) {
+            int16x8_t v = vld1q_s16(buf + i);
+            max = vmaxq_s16(max, v);
+            min = vminq_s16(min, v);
+            float32x4_t lo = vcvtq_f32_s32(vmovl_s16(vget_low_s16(v)));
+            float32x4_t hi = vcvtq_f32_s32(vmovl_s16(vget_high_s16(v)));
+            s0 = vmlaq_f32(s0, lo, lo);
+            s1 = vmlaq_f32(s1, hi, hi);
+        }
+        float s[8];
+        vst1q_f32(s, s0);
+        vst1q_f32(s + 4, s1);
+        for (int l = 0; l < 8; l++)
+            sums[l] += s[l];
+    }
+
+    int16_t mx[8], mn[8];
+    vst1q_s16(mx, max);
+    vst1q_s16(mn, min);
+    double peaks[8];
+    for (int l = 0; l < 8; l++)
+        peaks[l] = mx[l] > -mn[l] ? mx[l] : -mn[l];
+    upipe_amax_reduce(peaks, sums, 8, channels, acc);
+    return i;
+}
+
+/** @internal @This accumulates the levels of float samples with NEON.
+ *
+ * @param buf buffer of samples
+ * @param values number of values in the buffer
+ * @param channels number of interleaved channels, dividing 4
+ * @param acc array of accumulators, one per channel
+ * @return number of values processed
+ */
+static size_t upipe_amax_float_neon(const float *buf, size_t values,
+                                    uint8_t channels,
+                                    struct upipe_amax_acc *acc)
+{
+    float32x4_t max = vdupq_n_f32(0.);
+    double sums[4] = { 0. };
+    size_t i = 0;
+    while (i + 4 <= values) {
+        float32x4_t s0 = vdupq_n_f32(0.);
+        for (unsigned int n = 0; n < UPIPE_AMAX_BLOCK && i + 4 <= values;
+             n++, i += 4) {
+            float32x4_t v = vld1q_f32(buf + i);
+            max = vmaxq_f32(max, vabsq_f32(v));
+            s0 = vmlaq_f32(s0, v, v);
+        }
+        float s[4];
+        vst1q_f32(s, s0);
+        for (int l = 0; l < 4; l++)
+            sums[l] += s[l];
+    }
+
+    float mx[4];
+    vst1q_f32(mx, max);
+    double peaks[4];
+    for (int l = 0; l < 4; l++)
+        peaks[l] = mx[l];
+    upipe_amax_reduce(peaks, sums, 4, channels, acc);
+    return i;
+}
+#endif
+
+/** @internal @This accumulates the levels of 16-bit samples, with the
+ * vector kernels when the channels fit in the vectors.
+ *
+ * @param buf buffer of samples
+ * @param values number of values in the buffer
+ * @param channels number of interleaved channels
+ * @param acc array of accumulators, one per channel
+ * @return number of values processed
+ */
+static size_t upipe_amax_simd_int16_t(const int16_t *buf, size_t values,
+                                      uint8_t channels,
+                                      struct upipe_amax_acc *acc)
+{
+#if defined(__x86_64__)
+    if (!(16 % channels) && (ucpu_flags() & UCPU_AVX2))
+        return upipe_amax_int16_t_avx2(buf, values, channels, acc);
+    if (!(8 % channels))
+        return upipe_amax_int16_t_sse2(buf, values, channels, acc);
+#endif
+#if defined(__aarch64__)
+    if (!(8 % channels))
+        return upipe_amax_int16_t_neon(buf, values, channels, acc);
+#endif
+    return 0;
+}
+
+/** @internal @This accumulates the levels of float samples, with the
+ * vector kernels when the channels fit in the vectors.
+ *
+ * @param buf buffer of samples
+ * @param values number of values in the buffer
+ * @param channels number of interleaved channels
+ * @param acc array of accumulators, one per channel
+ * @return number of values processed
+ */
+static size_t upipe_amax_simd_float(const float *buf, size_t values,
+                                    uint8_t channels,
+                                    struct upipe_amax_acc *acc)
+{
+#if defined(__x86_64__)
+    if (!(8 % channels) && (ucpu_flags() & UCPU_AVX2))
+        return upipe_amax_float_avx2(buf, values, channels, acc);
+    if (!(4 % channels))
+        return upipe_amax_float_sse(buf, values, channels, acc);
+#endif
+#if defined(__aarch64__)
+    if (!(4 % channels))
+        return upipe_amax_float_neon(buf, values, channels, acc);
+#endif
+    return 0;
+}
+
+/** @internal @This does not accumulate any value with vector kernels.
+ *
+ * @param buf buffer of samples
+ * @param values number of values in the buffer
+ * @param channels number of interleaved channels
+ * @param acc array of accumulators, one per channel
+ * @return 0
+ */
+#define UPIPE_AMAX_NO_SIMD(type)                                            \
+static inline size_t upipe_amax_simd_##type(const type *buf, size_t values, \
+                                             uint8_t channels,              \
+                                             struct upipe_amax_acc *acc)    \
+{                                                                           \
+    return 0;                                                               \
+}
+UPIPE_AMAX_NO_SIMD(uint8_t)
+UPIPE_AMAX_NO_SIMD(int32_t)
+UPIPE_AMAX_NO_SIMD(double)
+#undef UPIPE_AMAX_NO_SIMD
+
+#define UPIPE_AMAX_TEMPLATE(type)                                           \
+/** @internal @This accumulates the levels of samples of format type.       \
  *                                                                          \
- * @param upipe description structure of the pipe                           \
- * @param uref uref structure                                               \
- * @param channel channel name                                              \
- * @param samples number of samples                                         \
+ * @param buf buffer of samples                                             \
+ * @param values number of values in the buffer (samples * channels)        \
+ * @param channels number of interleaved channels                           \
+ * @param acc array of accumulators, one per channel                        \
  */                                                                         \
-static double upipe_amax_process_##type(struct upipe *upipe,                \
-        struct uref *uref, const char *channel, size_t samples)             \
+static void upipe_amax_process_##type(const void *buf, size_t values,       \
+                                      uint8_t channels,                     \
+                                      struct upipe_amax_acc *acc)           \
 {                                                                           \
-    const type *buf = NULL;                                                 \
-    if (unlikely(!ubase_check(uref_sound_plane_read_##type(uref,            \
-            channel, 0, -1, &buf)))) {                                      \
-        upipe_warn(upipe, "error mapping sound buffer");                    \
-        return 0.;                                                          \
-    }                                                                       \
-    type max = 0;                                                           \
-    for (size_t i = 0; i < samples; i++) {                                  \
-        type c = buf[i];                                                    \
-        if (c > max)                                                        \
-            max = c;                                                        \
-        else if (-c > max)                                                  \
-            max = -c;                                                       \
+    const type *samples = buf;                                              \
+    size_t i = upipe_amax_simd_##type(samples, values, channels, acc);      \
+    for (uint8_t c = 0; i < values; i++, c = (c + 1) % channels) {          \
+        double v = samples[i];                                              \
+        double a = v < 0 ? -v : v;                                          \
+        if (a > acc[c].peak)                                                \
+            acc[c].peak = a;                                                \
+        acc[c].sum += v * v;                                                \
     }                                                                       \
-    uref_sound_plane_unmap(uref, channel, 0, -1);                           \
-    return (max * 1.0f) / type_max;                                         \
 }
-UPIPE_AMAX_TEMPLATE(uint8_t, UINT8_MAX)
-UPIPE_AMAX_TEMPLATE(int16_t, INT16_MAX)
-UPIPE_AMAX_TEMPLATE(int32_t, INT32_MAX)
-UPIPE_AMAX_TEMPLATE(float, 1.)
-UPIPE_AMAX_TEMPLATE(double, 1.)
+UPIPE_AMAX_TEMPLATE(uint8_t)
+UPIPE_AMAX_TEMPLATE(int16_t)
+UPIPE_AMAX_TEMPLATE(int32_t)
+UPIPE_AMAX_TEMPLATE(float)
+UPIPE_AMAX_TEMPLATE(double)
 #undef UPIPE_AMAX_TEMPLATE
 
 /** @internal @This handles input.
@@ -151,12 +531,37 @@ static void upipe_amax_input(struct upipe *upipe, struct uref *uref,
         uref_free(uref);
         return;
     }
+
+    uint8_t channels = upipe_amax->channels;
+    struct upipe_amax_acc acc[channels];
+    memset(acc, 0, sizeof(acc));
+
     const char *channel = NULL;
     uint8_t j = 0;
-    while (ubase_check(uref_sound_plane_iterate(uref, &channel)) && channel) {
-        double maxf = upipe_amax->process(upipe, uref, channel, samples);
-        uref_amax_set_amplitude(uref, maxf, j++);
+    while (ubase_check(uref_sound_plane_iterate(uref, &channel)) && channel &&
+           j < channels) {
+        const uint8_t *buf;
+        if (unlikely(!ubase_check(uref_sound_plane_read_uint8_t(uref,
+                            channel, 0, -1, &buf)))) {
+            upipe_warn(upipe, "error mapping sound buffer");
+        } else if (upipe_amax->interleaved) {
+            upipe_amax->process(buf, samples * channels, channels, acc);
+            uref_sound_plane_unmap(uref, channel, 0, -1);
+            break;
+        } else {
+            upipe_amax->process(buf, samples, 1, &acc[j]);
+            uref_sound_plane_unmap(uref, channel, 0, -1);
+        }
+        j++;
+    }
+
+    struct uref_amax_level levels[channels];
+    for (uint8_t c = 0; c < channels; c++) {
+        levels[c].peak = acc[c].peak / upipe_amax->sample_max;
+        levels[c].rms = samples ?
+            sqrt(acc[c].sum / samples) / upipe_amax->sample_max : 0.;
     }
+    uref_amax_set_levels(uref, (const uint8_t *)levels, sizeof(levels));
 
     upipe_amax_output(upipe, uref, upump_p);
 }
@@ -176,25 +581,34 @@ static int upipe_amax_set_flow_def(struct upipe *upipe, struct uref *flow)
     const char *def;
     UBASE_RETURN(uref_flow_get_def(flow, &def))
     upipe_amax_process process = NULL;
-    if (!ubase_ncmp(def, "sound.u8."))
+    double sample_max;
+    if (!ubase_ncmp(def, "sound.u8.")) {
         process = upipe_amax_process_uint8_t;
-    else if (!ubase_ncmp(def, "sound.s16."))
+        sample_max = UINT8_MAX;
+    } else if (!ubase_ncmp(def, "sound.s16.")) {
         process = upipe_amax_process_int16_t;
-    else if (!ubase_ncmp(def, "sound.s32."))
+        sample_max = INT16_MAX;
+    } else if (!ubase_ncmp(def, "sound.s32.")) {
         process = upipe_amax_process_int32_t;
-    else if (!ubase_ncmp(def, "sound.f32."))
+        sample_max = INT32_MAX;
+    } else if (!ubase_ncmp(def, "sound.f32.")) {
         process = upipe_amax_process_float;
-    else if (!ubase_ncmp(def, "sound.f64."))
+        sample_max = 1.;
+    } else if (!ubase_ncmp(def, "sound.f64.")) {
         process = upipe_amax_process_double;
-    else
+        sample_max = 1.;
+    } else
         return UBASE_ERR_INVALID;
     uint8_t channels, planes;
     if (unlikely(!ubase_check(uref_sound_flow_get_channels(flow, &channels))
               || !ubase_check(uref_sound_flow_get_planes(flow, &planes))
-              || planes != channels))
+              || !channels || (planes != channels && planes != 1)))
         return UBASE_ERR_INVALID;
 
     upipe_amax->process = process;
+    upipe_amax->sample_max = sample_max;
+    upipe_amax->channels = channels;
+    upipe_amax->interleaved = planes != channels;
 
     struct uref *flow_dup;
     if (unlikely((flow_dup = uref_dup(flow)) == NULL)) {
@@ -206,7 +620,8 @@ static int upipe_amax_set_flow_def(struct upipe *upipe, struct uref *flow)
     return UBASE_ERR_NONE;
 }
 
-/** @internal @This provides a flow format suggestion.
+/** @internal @This provides a flow format suggestion. Planar formats are
+ * preferred, but interleaved formats are also accepted by set_flow_def.
  *
  * @param upipe description structure of the pipe
  * @param request description structure of the request
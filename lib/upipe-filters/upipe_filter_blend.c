@@ -44,13 +44,35 @@
 #include <upipe/upipe_helper_ubuf_mgr.h>
 #include <upipe/upipe_helper_output.h>
 #include <upipe/upipe_helper_input.h>
+#include <upipe/uslices.h>
+#include <upipe/ucpu.h>
 #include <upipe-filters/upipe_filter_blend.h>
 
 #include <stdlib.h>
+#include <string.h>
 #include <strings.h>
 #include <stdint.h>
 #include <stdio.h>
 
+#if defined(__i686__) || defined(__x86_64__)
+#include <immintrin.h>
+#define UPIPE_FILTER_BLEND_X86
+#elif defined(__aarch64__) && !defined(__AARCH64EB__)
+#include <arm_neon.h>
+#define UPIPE_FILTER_BLEND_NEON
+#endif
+
+/** @internal @This is the prototype of a function computing the per-pixel
+ * mean of two lines.
+ *
+ * @param dest dest line
+ * @param s1 first source line
+ * @param s2 second source line
+ * @param bytes length in bytes
+ */
+typedef void (*upipe_filter_blend_merge)(void *dest, const void *s1,
+                                         const void *s2, size_t bytes);
+
 /** @hidden */
 static bool upipe_filter_blend_handle(struct upipe *upipe, struct uref *uref,
                                       struct upump **upump_p);
@@ -88,6 +110,15 @@ struct upipe_filter_blend {
     /** list of blockers (used during udeal) */
     struct uchain blockers;
 
+    /** merging function for 8-bit planes */
+    upipe_filter_blend_merge merge8bit;
+    /** merging function for 16-bit planes */
+    upipe_filter_blend_merge merge16bit;
+    /** instruction set extensions allowed for the kernels */
+    uint32_t cpu_flags;
+    /** worker threads processing ranges of lines, or NULL */
+    struct uslices *uslices;
+
     /** public structure */
     struct upipe upipe;
 };
@@ -102,31 +133,6 @@ UPIPE_HELPER_UBUF_MGR(upipe_filter_blend, ubuf_mgr, flow_format,
                       upipe_filter_blend_unregister_output_request)
 UPIPE_HELPER_INPUT(upipe_filter_blend, urefs, nb_urefs, max_urefs, blockers, upipe_filter_blend_handle)
 
-/** @internal @This allocates a filter pipe.
- *
- * @param mgr common management structure
- * @param uprobe structure used to raise events
- * @param signature signature of the pipe allocator
- * @param args optional arguments
- * @return pointer to upipe or NULL in case of allocation error
- */
-static struct upipe *upipe_filter_blend_alloc(struct upipe_mgr *mgr,
-                                              struct uprobe *uprobe,
-                                              uint32_t signature, va_list args)
-{
-    struct upipe *upipe = upipe_filter_blend_alloc_void(mgr, uprobe, signature,
-                                                        args);
-    if (unlikely(upipe == NULL))
-        return NULL;
-
-    upipe_filter_blend_init_urefcount(upipe);
-    upipe_filter_blend_init_ubuf_mgr(upipe);
-    upipe_filter_blend_init_output(upipe);
-    upipe_filter_blend_init_input(upipe);
-    upipe_throw_ready(upipe);
-    return upipe;
-}
-
 /** @internal @This computes the per-pixel mean of two lines
  * Code from VLC.
  * - modules/video_filter/deinterlace/merge.c
@@ -168,40 +174,277 @@ static void upipe_filter_merge8bit( void *_dest, const void *_s1,
         *dest++ = ( *s1++ + *s2++ ) >> 1;
 }
 
-/** @internal @This processes a picture plane
+#ifdef UPIPE_FILTER_BLEND_X86
+/** @internal @This computes the per-pixel mean of two lines of 8-bit
+ * samples with SSE2. pavgb rounds up, so the carry is removed to truncate
+ * like the C version.
+ *
+ * @param _dest dest line
+ * @param _s1 first source line
+ * @param _s2 second source line
+ * @param bytes length in bytes
+ */
+__attribute__((target("sse2")))
+static void upipe_filter_merge8bit_sse2(void *_dest, const void *_s1,
+                                        const void *_s2, size_t bytes)
+{
+    uint8_t *dest = _dest;
+    const uint8_t *s1 = _s1;
+    const uint8_t *s2 = _s2;
+    const __m128i one = _mm_set1_epi8(1);
+
+    for ( ; bytes >= 16; bytes -= 16, dest += 16, s1 += 16, s2 += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i *)s1);
+        __m128i b = _mm_loadu_si128((const __m128i *)s2);
+        __m128i c = _mm_and_si128(_mm_xor_si128(a, b), one);
+        _mm_storeu_si128((__m128i *)dest, _mm_sub_epi8(_mm_avg_epu8(a, b), c));
+    }
+    upipe_filter_merge8bit(dest, s1, s2, bytes);
+}
+
+/** @internal @This computes the per-pixel mean of two lines of 16-bit
+ * samples with SSE2.
+ *
+ * @param _dest dest line
+ * @param _s1 first source line
+ * @param _s2 second source line
+ * @param bytes length in bytes
+ */
+__attribute__((target("sse2")))
+static void upipe_filter_merge16bit_sse2(void *_dest, const void *_s1,
+                                         const void *_s2, size_t bytes)
+{
+    uint8_t *dest = _dest;
+    const uint8_t *s1 = _s1;
+    const uint8_t *s2 = _s2;
+    const __m128i one = _mm_set1_epi16(1);
+
+    for ( ; bytes >= 16; bytes -= 16, dest += 16, s1 += 16, s2 += 16) {
+        __m128i a = _mm_loadu_si128((const __m128i *)s1);
+        __m128i b = _mm_loadu_si128((const __m128i *)s2);
+        __m128i c = _mm_and_si128(_mm_xor_si128(a, b), one);
+        _mm_storeu_si128((__m128i *)dest,
+                         _mm_sub_epi16(_mm_avg_epu16(a, b), c));
+    }
+    upipe_filter_merge16bit(dest, s1, s2, bytes);
+}
+
+/** @internal @This computes the per-pixel mean of two lines of 8-bit
+ * samples with AVX2.
+ *
+ * @param _dest dest line
+ * @param _s1 first source line
+ * @param _s2 second source line
+ * @param bytes length in bytes
+ */
+__attribute__((target("avx2")))
+static void upipe_filter_merge8bit_avx2(void *_dest, const void *_s1,
+                                        const void *_s2, size_t bytes)
+{
+    uint8_t *dest = _dest;
+    const uint8_t *s1 = _s1;
+    const uint8_t *s2 = _s2;
+    const __m256i one = _mm256_set1_epi8(1);
+
+    for ( ; bytes >= 32; bytes -= 32, dest += 32, s1 += 32, s2 += 32) {
+        __m256i a = _mm256_loadu_si256((const __m256i *)s1);
+        __m256i b = _mm256_loadu_si256((const __m256i *)s2);
+        __m256i c = _mm256_and_si256(_mm256_xor_si256(a, b), one);
+        _mm256_storeu_si256((__m256i *)dest,
+                            _mm256_sub_epi8(_mm256_avg_epu8(a, b), c));
+    }
+    upipe_filter_merge8bit(dest, s1, s2, bytes);
+}
+
+/** @internal @This computes the per-pixel mean of two lines of 16-bit
+ * samples with AVX2.
+ *
+ * @param _dest dest line
+ * @param _s1 first source line
+ * @param _s2 second source line
+ * @param bytes length in bytes
+ */
+__attribute__((target("avx2")))
+static void upipe_filter_merge16bit_avx2(void *_dest, const void *_s1,
+                                         const void *_s2, size_t bytes)
+{
+    uint8_t *dest = _dest;
+    const uint8_t *s1 = _s1;
+    const uint8_t *s2 = _s2;
+    const __m256i one = _mm256_set1_epi16(1);
+
+    for ( ; bytes >= 32; bytes -= 32, dest += 32, s1 += 32, s2 += 32) {
+        __m256i a = _mm256_loadu_si256((const __m256i *)s1);
+        __m256i b = _mm256_loadu_si256((const __m256i *)s2);
+        __m256i c = _mm256_and_si256(_mm256_xor_si256(a, b), one);
+        _mm256_storeu_si256((__m256i *)dest,
+                            _mm256_sub_epi16(_mm256_avg_epu16(a, b), c));
+    }
+    upipe_filter_merge16bit(dest, s1, s2, bytes);
+}
+#endif
+
+#ifdef UPIPE_FILTER_BLEND_NEON
+/** @internal @This computes the per-pixel mean of two lines of 8-bit
+ * samples with NEON.
+ *
+ * @param _dest dest line
+ * @param _s1 first source line
+ * @param _s2 second source line
+ * @param bytes length in bytes
+ */
+static void upipe_filter_merge8bit_neon(void *_dest, const void *_s1,
+                                        const void *_s2, size_t bytes)
+{
+    uint8_t *dest = _dest;
+    const uint8_t *s1 = _s1;
+    const uint8_t *s2 = _s2;
+
+    for ( ; bytes >= 16; bytes -= 16, dest += 16, s1 += 16, s2 += 16)
+        vst1q_u8(dest, vhaddq_u8(vld1q_u8(s1), vld1q_u8(s2)));
+    upipe_filter_merge8bit(dest, s1, s2, bytes);
+}
+
+/** @internal @This computes the per-pixel mean of two lines of 16-bit
+ * samples with NEON.
+ *
+ * @param _dest dest line
+ * @param _s1 first source line
+ * @param _s2 second source line
+ * @param bytes length in bytes
+ */
+static void upipe_filter_merge16bit_neon(void *_dest, const void *_s1,
+                                         const void *_s2, size_t bytes)
+{
+    uint16_t *dest = _dest;
+    const uint16_t *s1 = _s1;
+    const uint16_t *s2 = _s2;
+
+    for ( ; bytes >= 16; bytes -= 16, dest += 8, s1 += 8, s2 += 8)
+        vst1q_u16(dest, vhaddq_u16(vld1q_u16(s1), vld1q_u16(s2)));
+    upipe_filter_merge16bit(dest, s1, s2, bytes);
+}
+#endif
+
+/** @internal @This describes a picture plane being processed. */
+struct upipe_filter_blend_frame {
+    /** merging function */
+    upipe_filter_blend_merge merge;
+    /** input buffer */
+    const uint8_t *in;
+    /** output buffer */
+    uint8_t *out;
+    /** stride length of input buffer */
+    size_t stride_in;
+    /** stride length of output buffer */
+    size_t stride_out;
+    /** plane height */
+    size_t height;
+};
+
+/** @internal @This processes a range of lines of a picture plane
  * Adapted from VLC.
  * - modules/video_filter/deinterlace/algo_basic.c
  *
- * @param in input buffer
- * @param out output buffer
- * @param stride_in stride length of input buffer
- * @param stride_out stride length of output buffer
- * @param height picture height
+ * @param opaque pointer to the description of the plane
+ * @param slice index of the range of lines
+ * @param nb_slices number of ranges of lines
  */
-static void upipe_filter_blend_plane(const uint8_t *in, uint8_t *out,
-                                     size_t stride_in, size_t stride_out,
-                                     size_t height, uint8_t macropixel_size)
+static void upipe_filter_blend_plane(void *opaque, unsigned int slice,
+                                     unsigned int nb_slices)
 {
-    uint8_t *out_end = out + stride_out * height;
+    const struct upipe_filter_blend_frame *frame = opaque;
+    size_t stride_in = frame->stride_in;
+    size_t stride_out = frame->stride_out;
+    size_t bytes = (stride_in < stride_out) ? stride_in : stride_out;
+    size_t h = frame->height * slice / nb_slices;
+    size_t h_end = frame->height * (slice + 1) / nb_slices;
+    const uint8_t *in = frame->in + (h ? h - 1 : 0) * stride_in;
+    uint8_t *out = frame->out + h * stride_out;
 
     // Copy first line
-    memcpy(out, in, stride_in);
-    out += stride_out;
+    if (h == 0 && h < h_end) {
+        memcpy(out, in, bytes);
+        out += stride_out;
+        h++;
+    }
 
     // Compute mean value for remaining lines
-    while (out < out_end) {
-        if (macropixel_size == 2)
-            upipe_filter_merge16bit(out, in, in+stride_in,
-                    (stride_in < stride_out) ? stride_in : stride_out);
-        else
-            upipe_filter_merge8bit(out, in, in+stride_in,
-                    (stride_in < stride_out) ? stride_in : stride_out);
-
+    for ( ; h < h_end; h++) {
+        frame->merge(out, in, in + stride_in, bytes);
         out += stride_out;
         in += stride_in;
     }
 }
 
+/** @internal @This describes an implementation of the merging kernels. */
+struct upipe_filter_blend_kernel {
+    /** required instruction set extensions */
+    uint32_t cpu_flags;
+    /** merging function for 8-bit planes */
+    upipe_filter_blend_merge merge8bit;
+    /** merging function for 16-bit planes */
+    upipe_filter_blend_merge merge16bit;
+};
+
+/** @internal @This lists the kernels, from the most to the least preferred */
+static const struct upipe_filter_blend_kernel upipe_filter_blend_kernels[] = {
+#ifdef UPIPE_FILTER_BLEND_X86
+    { UCPU_AVX2, upipe_filter_merge8bit_avx2, upipe_filter_merge16bit_avx2 },
+    { UCPU_SSE2, upipe_filter_merge8bit_sse2, upipe_filter_merge16bit_sse2 },
+#endif
+#ifdef UPIPE_FILTER_BLEND_NEON
+    { UCPU_NEON, upipe_filter_merge8bit_neon, upipe_filter_merge16bit_neon },
+#endif
+    { 0, upipe_filter_merge8bit, upipe_filter_merge16bit },
+};
+
+/** @internal @This selects the merging functions.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_filter_blend_setup_asm(struct upipe *upipe)
+{
+    struct upipe_filter_blend *upipe_filter_blend =
+        upipe_filter_blend_from_upipe(upipe);
+    const struct upipe_filter_blend_kernel *kernel =
+        ucpu_select(upipe_filter_blend_kernels,
+                    ucpu_flags() & upipe_filter_blend->cpu_flags);
+    upipe_filter_blend->merge8bit = kernel->merge8bit;
+    upipe_filter_blend->merge16bit = kernel->merge16bit;
+}
+
+/** @internal @This allocates a filter pipe.
+ *
+ * @param mgr common management structure
+ * @param uprobe structure used to raise events
+ * @param signature signature of the pipe allocator
+ * @param args optional arguments
+ * @return pointer to upipe or NULL in case of allocation error
+ */
+static struct upipe *upipe_filter_blend_alloc(struct upipe_mgr *mgr,
+                                              struct uprobe *uprobe,
+                                              uint32_t signature, va_list args)
+{
+    struct upipe *upipe = upipe_filter_blend_alloc_void(mgr, uprobe, signature,
+                                                        args);
+    if (unlikely(upipe == NULL))
+        return NULL;
+
+    upipe_filter_blend_init_urefcount(upipe);
+    upipe_filter_blend_init_ubuf_mgr(upipe);
+    upipe_filter_blend_init_output(upipe);
+    upipe_filter_blend_init_input(upipe);
+
+    struct upipe_filter_blend *upipe_filter_blend =
+        upipe_filter_blend_from_upipe(upipe);
+    upipe_filter_blend->cpu_flags = UCPU_ALL;
+    upipe_filter_blend_setup_asm(upipe);
+    upipe_filter_blend->uslices = NULL;
+    upipe_throw_ready(upipe);
+    return upipe;
+}
+
 /** @internal @This handles input.
  *
  * @param upipe description structure of the pipe
@@ -257,8 +500,17 @@ static bool upipe_filter_blend_handle(struct upipe *upipe, struct uref *uref,
         uref_pic_plane_read(uref, chroma, 0, 0, -1, -1, &in);
         ubuf_pic_plane_write(ubuf_deint, chroma, 0, 0, -1, -1, &out);
 
-        // process plane
-        upipe_filter_blend_plane(in, out, stride_in, stride_out, (size_t) height/vsub, macropixel_size);
+        // process plane, possibly in several threads
+        struct upipe_filter_blend_frame frame;
+        frame.merge = macropixel_size == 2 ? upipe_filter_blend->merge16bit :
+                                             upipe_filter_blend->merge8bit;
+        frame.in = in;
+        frame.out = out;
+        frame.stride_in = stride_in;
+        frame.stride_out = stride_out;
+        frame.height = height / vsub;
+        uslices_run(upipe_filter_blend->uslices, upipe_filter_blend_plane,
+                    &frame, uslices_get_threads(upipe_filter_blend->uslices));
 
         // unmap all
         uref_pic_plane_unmap(uref, chroma, 0, 0, -1, -1);
@@ -352,6 +604,32 @@ static int upipe_filter_blend_set_flow_def(struct upipe *upipe,
     return UBASE_ERR_NONE;
 }
 
+/** @internal @This sets the number of threads processing the pictures.
+ *
+ * @param upipe description structure of the pipe
+ * @param nb_threads number of threads, or 0
+ * @return an error code
+ */
+static int upipe_filter_blend_set_nb_threads(struct upipe *upipe,
+                                             unsigned int nb_threads)
+{
+    struct upipe_filter_blend *upipe_filter_blend =
+        upipe_filter_blend_from_upipe(upipe);
+    uslices_free(upipe_filter_blend->uslices);
+    upipe_filter_blend->uslices = NULL;
+    if (nb_threads <= 1)
+        return UBASE_ERR_NONE;
+
+    /* the thread of the pipe processes a range of lines too */
+    upipe_filter_blend->uslices = uslices_alloc(nb_threads - 1);
+    if (unlikely(upipe_filter_blend->uslices == NULL)) {
+        upipe_err(upipe, "unable to create deinterlacing threads");
+        return UBASE_ERR_EXTERNAL;
+    }
+    upipe_dbg_va(upipe, "deinterlacing with %u threads", nb_threads);
+    return UBASE_ERR_NONE;
+}
+
 /** @internal @This processes control commands on the pipe.
  *
  * @param upipe description structure of the pipe
@@ -385,6 +663,18 @@ static int upipe_filter_blend_control(struct upipe *upipe,
         case UPIPE_GET_OUTPUT:
         case UPIPE_SET_OUTPUT:
             return upipe_filter_blend_control_output(upipe, command, args);
+        case UPIPE_SET_CPU_FLAGS: {
+            struct upipe_filter_blend *upipe_filter_blend =
+                upipe_filter_blend_from_upipe(upipe);
+            upipe_filter_blend->cpu_flags = va_arg(args, uint32_t);
+            upipe_filter_blend_setup_asm(upipe);
+            return UBASE_ERR_NONE;
+        }
+        case UPIPE_FILTER_BLEND_SET_THREADS: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_FILTER_BLEND_SIGNATURE)
+            unsigned int nb_threads = va_arg(args, unsigned int);
+            return upipe_filter_blend_set_nb_threads(upipe, nb_threads);
+        }
         default:
             return UBASE_ERR_UNHANDLED;
     }
@@ -396,8 +686,11 @@ static int upipe_filter_blend_control(struct upipe *upipe,
  */
 static void upipe_filter_blend_free(struct upipe *upipe)
 {
+    struct upipe_filter_blend *upipe_filter_blend =
+        upipe_filter_blend_from_upipe(upipe);
     upipe_throw_dead(upipe);
 
+    uslices_free(upipe_filter_blend->uslices);
     upipe_filter_blend_clean_input(upipe);
     upipe_filter_blend_clean_ubuf_mgr(upipe);
     upipe_filter_blend_clean_output(upipe);
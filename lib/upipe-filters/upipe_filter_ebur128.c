@@ -72,6 +72,10 @@ struct upipe_filter_ebur128 {
 
     /** ebur128 state */
     ebur128_state *st;
+    /** true if gated loudness and loudness range are measured */
+    bool gating;
+    /** sample rate */
+    uint64_t rate;
     /** number of channels */
     uint8_t channels;
     /** number of planes */
@@ -111,6 +115,7 @@ static struct upipe *upipe_filter_ebur128_alloc(struct upipe_mgr *mgr,
     struct upipe_filter_ebur128 *upipe_filter_ebur128 =
                                  upipe_filter_ebur128_from_upipe(upipe);
     upipe_filter_ebur128->st = NULL;
+    upipe_filter_ebur128->gating = true;
 
     upipe_filter_ebur128_init_urefcount(upipe);
     upipe_filter_ebur128_init_output(upipe);
@@ -118,6 +123,20 @@ static struct upipe *upipe_filter_ebur128_alloc(struct upipe_mgr *mgr,
     return upipe;
 }
 
+/** @internal @This returns the ebur128 mode to use.
+ *
+ * @param upipe description structure of the pipe
+ * @return ebur128 mode
+ */
+static int upipe_filter_ebur128_mode(struct upipe *upipe)
+{
+    struct upipe_filter_ebur128 *upipe_filter_ebur128 =
+                                 upipe_filter_ebur128_from_upipe(upipe);
+    if (upipe_filter_ebur128->gating)
+        return EBUR128_MODE_LRA | EBUR128_MODE_I | EBUR128_MODE_HISTOGRAM;
+    return EBUR128_MODE_S;
+}
+
 /** @internal @This handles input.
  *
  * @param upipe description structure of the pipe
@@ -129,7 +148,7 @@ static void upipe_filter_ebur128_input(struct upipe *upipe, struct uref *uref,
 {
     struct upipe_filter_ebur128 *upipe_filter_ebur128 =
                                  upipe_filter_ebur128_from_upipe(upipe);
-    double loud = 0, lra = 0, global = 0;
+    double loud = 0, shortterm = 0, lra = 0, global = 0;
 
     if (unlikely(upipe_filter_ebur128->output_flow == NULL)) {
         upipe_err_va(upipe, "invalid input");
@@ -168,6 +187,7 @@ static void upipe_filter_ebur128_input(struct upipe *upipe, struct uref *uref,
                                                samples, sample_size,
                                                upipe_filter_ebur128->planes))) {
             upipe_warn(upipe, "error mapping sound buffer");
+            free(buf);
             uref_free(uref);
             return;
         }
@@ -209,14 +229,19 @@ static void upipe_filter_ebur128_input(struct upipe *upipe, struct uref *uref,
         free(buf);
 
     ebur128_loudness_momentary(upipe_filter_ebur128->st, &loud);
-    ebur128_loudness_range(upipe_filter_ebur128->st, &lra);
-    ebur128_loudness_global(upipe_filter_ebur128->st, &global);
-
+    ebur128_loudness_shortterm(upipe_filter_ebur128->st, &shortterm);
     uref_ebur128_set_momentary(uref, loud);
-    uref_ebur128_set_lra(uref, lra);
-    uref_ebur128_set_global(uref, global);
+    uref_ebur128_set_shortterm(uref, shortterm);
+
+    if (upipe_filter_ebur128->gating) {
+        ebur128_loudness_range(upipe_filter_ebur128->st, &lra);
+        ebur128_loudness_global(upipe_filter_ebur128->st, &global);
+        uref_ebur128_set_lra(uref, lra);
+        uref_ebur128_set_global(uref, global);
+    }
 
-    upipe_verbose_va(upipe, "loud %f lra %f global %f", loud, lra, global);
+    upipe_verbose_va(upipe, "loud %f short-term %f lra %f global %f",
+                     loud, shortterm, lra, global);
 
     upipe_filter_ebur128_output(upipe, uref, upump_p);
 }
@@ -263,6 +288,7 @@ static int upipe_filter_ebur128_set_flow_def(struct upipe *upipe,
         return UBASE_ERR_ALLOC;
     }
     upipe_filter_ebur128->fmt = fmt;
+    upipe_filter_ebur128->rate = rate;
 
     if (unlikely(upipe_filter_ebur128->st)) {
         //ebur128_destroy(&upipe_filter_ebur128->st);
@@ -271,13 +297,41 @@ static int upipe_filter_ebur128_set_flow_def(struct upipe *upipe,
     } else {
         upipe_filter_ebur128->st =
             ebur128_init(upipe_filter_ebur128->channels, rate,
-            EBUR128_MODE_LRA | EBUR128_MODE_I | EBUR128_MODE_HISTOGRAM);
+                         upipe_filter_ebur128_mode(upipe));
     }
 
     upipe_filter_ebur128_store_flow_def(upipe, flow_dup);
     return UBASE_ERR_NONE;
 }
 
+/** @internal @This sets the gating mode.
+ *
+ * @param upipe description structure of the pipe
+ * @param gating true to enable gating
+ * @return an error code
+ */
+static int _upipe_filter_ebur128_set_gating(struct upipe *upipe, bool gating)
+{
+    struct upipe_filter_ebur128 *upipe_filter_ebur128 =
+                                 upipe_filter_ebur128_from_upipe(upipe);
+    if (gating == upipe_filter_ebur128->gating)
+        return UBASE_ERR_NONE;
+    upipe_filter_ebur128->gating = gating;
+
+    if (upipe_filter_ebur128->st != NULL) {
+        ebur128_destroy(&upipe_filter_ebur128->st);
+        upipe_filter_ebur128->st =
+            ebur128_init(upipe_filter_ebur128->channels,
+                         upipe_filter_ebur128->rate,
+                         upipe_filter_ebur128_mode(upipe));
+        if (unlikely(upipe_filter_ebur128->st == NULL)) {
+            upipe_filter_ebur128_store_flow_def(upipe, NULL);
+            return UBASE_ERR_ALLOC;
+        }
+    }
+    return UBASE_ERR_NONE;
+}
+
 /** @internal @This provides a flow format suggestion.
  *
  * @param upipe description structure of the pipe
@@ -327,6 +381,18 @@ static int upipe_filter_ebur128_control(struct upipe *upipe,
         case UPIPE_GET_OUTPUT:
         case UPIPE_SET_OUTPUT:
             return upipe_filter_ebur128_control_output(upipe, command, args);
+
+        case UPIPE_FILTER_EBUR128_GET_GATING: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_FILTER_EBUR128_SIGNATURE)
+            bool *gating_p = va_arg(args, bool *);
+            *gating_p = upipe_filter_ebur128_from_upipe(upipe)->gating;
+            return UBASE_ERR_NONE;
+        }
+        case UPIPE_FILTER_EBUR128_SET_GATING: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_FILTER_EBUR128_SIGNATURE)
+            bool gating = va_arg(args, int);
+            return _upipe_filter_ebur128_set_gating(upipe, gating);
+        }
         default:
             return UBASE_ERR_UNHANDLED;
     }
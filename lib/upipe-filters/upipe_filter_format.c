@@ -276,6 +276,72 @@ static void upipe_ffmt_input(struct upipe *upipe, struct uref *uref,
     }
 }
 
+/** @internal @This checks whether two picture flow definitions describe
+ * the same planes, possibly in a different order. As planes are accessed
+ * by chroma, buffers may then be passed through with the new flow
+ * definition.
+ *
+ * @param flow_def1 first flow definition
+ * @param flow_def2 second flow definition
+ * @return true if the planes are the same
+ */
+static bool upipe_ffmt_pic_same_planes(struct uref *flow_def1,
+                                       struct uref *flow_def2)
+{
+    uint8_t planes;
+    if (uref_flow_cmp_def(flow_def1, flow_def2) != 0 ||
+        uref_pic_flow_cmp_macropixel(flow_def1, flow_def2) != 0 ||
+        uref_pic_flow_cmp_planes(flow_def1, flow_def2) != 0 ||
+        !ubase_check(uref_pic_flow_get_planes(flow_def1, &planes)))
+        return false;
+
+    for (uint8_t plane = 0; plane < planes; plane++) {
+        const char *chroma;
+        uint8_t hsub, vsub, mpixel_size;
+        if (!ubase_check(uref_pic_flow_get_chroma(flow_def1, &chroma,
+                                                  plane)) ||
+            !ubase_check(uref_pic_flow_get_hsubsampling(flow_def1, &hsub,
+                                                        plane)) ||
+            !ubase_check(uref_pic_flow_get_vsubsampling(flow_def1, &vsub,
+                                                        plane)) ||
+            !ubase_check(uref_pic_flow_get_macropixel_size(flow_def1,
+                    &mpixel_size, plane)) ||
+            !ubase_check(uref_pic_flow_check_chroma(flow_def2, hsub, vsub,
+                                                    mpixel_size, chroma)))
+            return false;
+    }
+    return true;
+}
+
+/** @internal @This checks whether two sound flow definitions describe the
+ * same planes, possibly in a different order. As planes are accessed by
+ * channel, buffers may then be passed through with the new flow
+ * definition.
+ *
+ * @param flow_def1 first flow definition
+ * @param flow_def2 second flow definition
+ * @return true if the planes are the same
+ */
+static bool upipe_ffmt_sound_same_planes(struct uref *flow_def1,
+                                         struct uref *flow_def2)
+{
+    uint8_t planes;
+    if (uref_flow_cmp_def(flow_def1, flow_def2) != 0 ||
+        uref_sound_flow_cmp_sample_size(flow_def1, flow_def2) != 0 ||
+        uref_sound_flow_cmp_planes(flow_def1, flow_def2) != 0 ||
+        !ubase_check(uref_sound_flow_get_planes(flow_def1, &planes)))
+        return false;
+
+    for (uint8_t plane = 0; plane < planes; plane++) {
+        const char *channel;
+        if (!ubase_check(uref_sound_flow_get_channel(flow_def1, &channel,
+                                                     plane)) ||
+            !ubase_check(uref_sound_flow_check_channel(flow_def2, channel)))
+            return false;
+    }
+    return true;
+}
+
 /** @internal @This receives the result of a flow format request.
  *
  * @param upipe description structure of the pipe
@@ -307,9 +373,13 @@ static int upipe_ffmt_check_flow_format(struct upipe *upipe,
                 ubase_check(uref_pic_flow_get_sar(flow_def, &input_sar))) {
                 struct urational sar_factor =
                     urational_divide(&input_sar, &sar);
-                hsize = (hsize * sar_factor.num / sar_factor.den / 2) * 2;
-                uref_pic_flow_set_hsize(flow_def_dup, hsize);
-                uref_pic_flow_set_hsize_visible(flow_def_dup, hsize);
+                urational_simplify(&sar_factor);
+                /* same aspect ratio: no need to rescale */
+                if (sar_factor.num != sar_factor.den) {
+                    hsize = (hsize * sar_factor.num / sar_factor.den / 2) * 2;
+                    uref_pic_flow_set_hsize(flow_def_dup, hsize);
+                    uref_pic_flow_set_hsize_visible(flow_def_dup, hsize);
+                }
             }
             uref_pic_flow_set_sar(flow_def, sar);
         } else if (ubase_check(uref_pic_flow_get_dar(
@@ -328,7 +398,8 @@ static int upipe_ffmt_check_flow_format(struct upipe *upipe,
 
         bool need_deint = !ubase_check(uref_pic_get_progressive(flow_def)) &&
                           ubase_check(uref_pic_get_progressive(flow_def_dup));
-        bool need_sws = !uref_pic_flow_compare_format(flow_def, flow_def_dup) ||
+        /* only the metadata differ if the planes are only reordered */
+        bool need_sws = !upipe_ffmt_pic_same_planes(flow_def, flow_def_dup) ||
                         uref_pic_flow_cmp_hsize(flow_def, flow_def_dup) ||
                         uref_pic_flow_cmp_vsize(flow_def, flow_def_dup);
 
@@ -377,7 +448,7 @@ static int upipe_ffmt_check_flow_format(struct upipe *upipe,
         }
 
     } else { /* sound. */
-        if (!uref_sound_flow_compare_format(flow_def, flow_def_dup) ||
+        if (!upipe_ffmt_sound_same_planes(flow_def, flow_def_dup) ||
             uref_sound_flow_cmp_rate(flow_def, flow_def_dup)) {
             struct upipe *input = upipe_flow_alloc(ffmt_mgr->swr_mgr,
                     uprobe_pfx_alloc(uprobe_use(&upipe_ffmt->last_inner_probe),
@@ -0,0 +1,818 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short Bin pipe decoding once and encoding a ladder of renditions
+ */
+
+#include <upipe/ubase.h>
+#include <upipe/ulist.h>
+#include <upipe/uprobe.h>
+#include <upipe/uprobe_prefix.h>
+#include <upipe/uref.h>
+#include <upipe/uref_flow.h>
+#include <upipe/uref_pic.h>
+#include <upipe/uref_pic_flow.h>
+#include <upipe/upipe.h>
+#include <upipe/upipe_helper_upipe.h>
+#include <upipe/upipe_helper_void.h>
+#include <upipe/upipe_helper_flow.h>
+#include <upipe/upipe_helper_urefcount.h>
+#include <upipe/upipe_helper_inner.h>
+#include <upipe/upipe_helper_uprobe.h>
+#include <upipe/upipe_helper_bin_input.h>
+#include <upipe/upipe_helper_bin_output.h>
+#include <upipe/upipe_helper_subpipe.h>
+#include <upipe-modules/upipe_dup.h>
+#include <upipe-modules/upipe_probe_uref.h>
+#include <upipe-modules/upipe_worker_linear.h>
+#include <upipe-framers/uref_h264.h>
+#include <upipe-framers/uref_h265.h>
+#include <upipe-filters/upipe_filter_ladder.h>
+#include <upipe-x264/upipe_x264.h>
+#include <upipe-x265/upipe_x265.h>
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdarg.h>
+#include <string.h>
+#include <assert.h>
+
+/** length of the queues between the ladder and the workers */
+#define UPIPE_FLADDER_QUEUE_LENGTH 4
+/** intra slice type, as defined by ITU-T H.264 and H.265 */
+#define UPIPE_FLADDER_SLICE_TYPE_I 2
+
+/** @internal @This is the private context of a fladder manager. */
+struct upipe_fladder_mgr {
+    /** refcount management structure */
+    struct urefcount urefcount;
+
+    /** pointer to filter decode manager */
+    struct upipe_mgr *fdec_mgr;
+    /** pointer to filter format manager */
+    struct upipe_mgr *ffmt_mgr;
+    /** pointer to filter encode manager */
+    struct upipe_mgr *fenc_mgr;
+    /** pointer to dup manager */
+    struct upipe_mgr *dup_mgr;
+    /** pointer to probe_uref manager */
+    struct upipe_mgr *probe_uref_mgr;
+
+    /** worker managers for the scalers */
+    struct upipe_mgr *worker_mgrs[UPIPE_FLADDER_MAX_WORKERS];
+    /** number of worker managers */
+    unsigned int nb_workers;
+    /** next worker manager to use */
+    unsigned int next_worker;
+
+    /** public upipe_mgr structure */
+    struct upipe_mgr mgr;
+};
+
+UBASE_FROM_TO(upipe_fladder_mgr, upipe_mgr, upipe_mgr, mgr)
+UBASE_FROM_TO(upipe_fladder_mgr, urefcount, urefcount, urefcount)
+
+/** @hidden */
+static int upipe_fladder_catch_tag(struct uprobe *uprobe, struct upipe *inner,
+                                   int event, va_list args);
+
+/** @internal @This is the private context of a fladder pipe. */
+struct upipe_fladder {
+    /** real refcount management structure */
+    struct urefcount urefcount_real;
+    /** refcount management structure exported to the public structure */
+    struct urefcount urefcount;
+
+    /** proxy probe */
+    struct uprobe proxy_probe;
+    /** probe for the GOP tagger */
+    struct uprobe tag_probe;
+
+    /** list of input bin requests */
+    struct uchain input_request_list;
+    /** first inner pipe of the bin (fdec or tagger) */
+    struct upipe *first_inner;
+    /** true if the input is decoded */
+    bool decode;
+    /** GOP tagger */
+    struct upipe *tagger;
+    /** dup pipe feeding the largest renditions */
+    struct upipe *dup;
+
+    /** GOP length in pictures, or 0 */
+    unsigned int gop;
+    /** number of pictures since the last GOP boundary */
+    unsigned int gop_count;
+
+    /** list of renditions */
+    struct uchain subs;
+    /** manager to create renditions */
+    struct upipe_mgr sub_mgr;
+
+    /** public upipe structure */
+    struct upipe upipe;
+};
+
+UPIPE_HELPER_UPIPE(upipe_fladder, upipe, UPIPE_FLADDER_SIGNATURE)
+UPIPE_HELPER_VOID(upipe_fladder)
+UPIPE_HELPER_UREFCOUNT(upipe_fladder, urefcount, upipe_fladder_no_ref)
+UPIPE_HELPER_INNER(upipe_fladder, first_inner)
+UPIPE_HELPER_BIN_INPUT(upipe_fladder, first_inner, input_request_list)
+UPIPE_HELPER_UPROBE(upipe_fladder, urefcount_real, proxy_probe, NULL)
+UPIPE_HELPER_UPROBE(upipe_fladder, urefcount_real, tag_probe,
+                    upipe_fladder_catch_tag)
+
+UBASE_FROM_TO(upipe_fladder, urefcount, urefcount_real, urefcount_real)
+
+/** @hidden */
+static void upipe_fladder_free(struct urefcount *urefcount_real);
+
+/** @internal @This is the private context of a rendition of a fladder
+ * pipe. */
+struct upipe_fladder_sub {
+    /** real refcount management structure */
+    struct urefcount urefcount_real;
+    /** refcount management structure exported to the public structure */
+    struct urefcount urefcount;
+    /** structure for double-linked lists */
+    struct uchain uchain;
+
+    /** proxy probe */
+    struct uprobe proxy_probe;
+    /** probe for the last inner pipe */
+    struct uprobe last_inner_probe;
+
+    /** horizontal size of the rendition */
+    uint64_t hsize;
+    /** vertical size of the rendition */
+    uint64_t vsize;
+
+    /** rendition this one is scaled from, or NULL for the decoded picture */
+    struct upipe_fladder_sub *parent;
+    /** output of the dup pipe of the parent */
+    struct upipe *feed;
+    /** scaler (ffmt, possibly in a worker) */
+    struct upipe *scaler;
+    /** dup pipe feeding the encoder and the smaller renditions */
+    struct upipe *dup;
+    /** output of the dup pipe feeding the encoder */
+    struct upipe *enc_feed;
+
+    /** list of output bin requests */
+    struct uchain output_request_list;
+    /** last inner pipe of the bin (fenc) */
+    struct upipe *last_inner;
+    /** output */
+    struct upipe *output;
+
+    /** public upipe structure */
+    struct upipe upipe;
+};
+
+UPIPE_HELPER_UPIPE(upipe_fladder_sub, upipe, UPIPE_FLADDER_SUB_SIGNATURE)
+UPIPE_HELPER_FLOW(upipe_fladder_sub, "block.")
+UPIPE_HELPER_UREFCOUNT(upipe_fladder_sub, urefcount, upipe_fladder_sub_no_ref)
+UPIPE_HELPER_INNER(upipe_fladder_sub, last_inner)
+UPIPE_HELPER_UPROBE(upipe_fladder_sub, urefcount_real, proxy_probe, NULL)
+UPIPE_HELPER_UPROBE(upipe_fladder_sub, urefcount_real, last_inner_probe, NULL)
+UPIPE_HELPER_BIN_OUTPUT(upipe_fladder_sub, last_inner, output,
+                        output_request_list)
+
+UPIPE_HELPER_SUBPIPE(upipe_fladder, upipe_fladder_sub, sub, sub_mgr, subs,
+                     uchain)
+
+UBASE_FROM_TO(upipe_fladder_sub, urefcount, urefcount_real, urefcount_real)
+
+/** @hidden */
+static void upipe_fladder_sub_free(struct urefcount *urefcount_real);
+
+/** @internal @This returns the largest rendition strictly larger than the
+ * given size, from which it may be scaled down.
+ *
+ * @param upipe description structure of the pipe
+ * @param hsize horizontal size
+ * @param vsize vertical size
+ * @param exclude rendition to ignore, or NULL
+ * @return pointer to the parent rendition, or NULL for the decoded picture
+ */
+static struct upipe_fladder_sub *
+    upipe_fladder_find_parent(struct upipe *upipe,
+                              uint64_t hsize, uint64_t vsize,
+                              struct upipe_fladder_sub *exclude)
+{
+    struct upipe_fladder *upipe_fladder = upipe_fladder_from_upipe(upipe);
+    struct upipe_fladder_sub *parent = NULL;
+    struct uchain *uchain;
+    ulist_foreach (&upipe_fladder->subs, uchain) {
+        struct upipe_fladder_sub *sub = upipe_fladder_sub_from_uchain(uchain);
+        if (sub == exclude || sub->dup == NULL ||
+            sub->hsize < hsize || sub->vsize < vsize ||
+            sub->hsize * sub->vsize <= hsize * vsize)
+            continue;
+        if (parent == NULL ||
+            sub->hsize * sub->vsize < parent->hsize * parent->vsize)
+            parent = sub;
+    }
+    return parent;
+}
+
+/** @internal @This connects a rendition to the output of its parent.
+ *
+ * @param upipe description structure of the pipe
+ * @param sub rendition to connect
+ * @param parent parent rendition, or NULL for the decoded picture
+ */
+static void upipe_fladder_attach(struct upipe *upipe,
+                                 struct upipe_fladder_sub *sub,
+                                 struct upipe_fladder_sub *parent)
+{
+    struct upipe_fladder *upipe_fladder = upipe_fladder_from_upipe(upipe);
+    struct upipe *dup = parent != NULL ? parent->dup : upipe_fladder->dup;
+    struct upipe *feed = NULL;
+    if (dup != NULL) {
+        feed = upipe_void_alloc_sub(dup,
+                uprobe_pfx_alloc(
+                    uprobe_use(upipe_fladder_sub_to_proxy_probe(sub)),
+                    UPROBE_LOG_VERBOSE, "feed"));
+        if (unlikely(feed == NULL))
+            upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+        else
+            upipe_set_output(feed, sub->scaler);
+    }
+    upipe_release(sub->feed);
+    sub->feed = feed;
+    sub->parent = parent;
+}
+
+/** @internal @This connects every rendition to the nearest larger one.
+ *
+ * @param upipe description structure of the pipe
+ * @param exclude rendition being removed, or NULL
+ */
+static void upipe_fladder_rebalance(struct upipe *upipe,
+                                    struct upipe_fladder_sub *exclude)
+{
+    struct upipe_fladder *upipe_fladder = upipe_fladder_from_upipe(upipe);
+    struct uchain *uchain;
+    ulist_foreach (&upipe_fladder->subs, uchain) {
+        struct upipe_fladder_sub *sub = upipe_fladder_sub_from_uchain(uchain);
+        if (sub == exclude || sub->dup == NULL)
+            continue;
+        struct upipe_fladder_sub *parent =
+            upipe_fladder_find_parent(upipe, sub->hsize, sub->vsize, exclude);
+        if (sub->feed == NULL || parent != sub->parent) {
+            upipe_verbose_va(upipe, "scaling %"PRIu64"x%"PRIu64" from "
+                             "%"PRIu64"x%"PRIu64, sub->hsize, sub->vsize,
+                             parent != NULL ? parent->hsize : 0,
+                             parent != NULL ? parent->vsize : 0);
+            upipe_fladder_attach(upipe, sub, parent);
+        }
+    }
+}
+
+/** @internal @This activates or deactivates slice type enforcement on the
+ * encoder of a rendition.
+ *
+ * @param upipe description structure of the rendition
+ * @param enforce true to enforce the slice types set by the ladder
+ */
+static void upipe_fladder_sub_enforce(struct upipe *upipe, bool enforce)
+{
+    struct upipe_fladder_sub *sub = upipe_fladder_sub_from_upipe(upipe);
+    if (sub->last_inner == NULL)
+        return;
+    /* only one of them applies, depending on the encoder */
+    if (!ubase_check(upipe_x264_set_slice_type_enforce(sub->last_inner,
+                                                       enforce)))
+        upipe_x265_set_slice_type_enforce(sub->last_inner, enforce);
+}
+
+/** @internal @This allocates a rendition of a fladder pipe.
+ *
+ * @param mgr common management structure
+ * @param uprobe structure used to raise events
+ * @param signature signature of the pipe allocator
+ * @param args optional arguments
+ * @return pointer to upipe or NULL in case of allocation error
+ */
+static struct upipe *upipe_fladder_sub_alloc(struct upipe_mgr *mgr,
+                                             struct uprobe *uprobe,
+                                             uint32_t signature, va_list args)
+{
+    struct upipe_fladder *upipe_fladder = upipe_fladder_from_sub_mgr(mgr);
+    struct upipe *super = upipe_fladder_to_upipe(upipe_fladder);
+    struct upipe_fladder_mgr *fladder_mgr =
+        upipe_fladder_mgr_from_upipe_mgr(super->mgr);
+    struct uref *flow_def;
+    struct upipe *upipe = upipe_fladder_sub_alloc_flow(mgr, uprobe, signature,
+                                                       args, &flow_def);
+    if (unlikely(upipe == NULL))
+        return NULL;
+
+    struct upipe_fladder_sub *sub = upipe_fladder_sub_from_upipe(upipe);
+    upipe_fladder_sub_init_urefcount(upipe);
+    urefcount_init(upipe_fladder_sub_to_urefcount_real(sub),
+                   upipe_fladder_sub_free);
+    upipe_fladder_sub_init_proxy_probe(upipe);
+    upipe_fladder_sub_init_last_inner_probe(upipe);
+    upipe_fladder_sub_init_bin_output(upipe);
+    sub->hsize = sub->vsize = 0;
+    sub->parent = NULL;
+    sub->feed = NULL;
+    sub->scaler = NULL;
+    sub->dup = NULL;
+    sub->enc_feed = NULL;
+    upipe_fladder_sub_init_sub(upipe);
+    upipe_throw_ready(upipe);
+
+    struct uref *flow_def_scaler;
+    if (unlikely(fladder_mgr->ffmt_mgr == NULL ||
+                 fladder_mgr->fenc_mgr == NULL ||
+                 !ubase_check(uref_pic_flow_get_hsize(flow_def,
+                                                      &sub->hsize)) ||
+                 !ubase_check(uref_pic_flow_get_vsize(flow_def,
+                                                      &sub->vsize)) ||
+                 (flow_def_scaler =
+                    uref_sibling_alloc_control(flow_def)) == NULL)) {
+        uref_free(flow_def);
+        upipe_release(upipe);
+        return NULL;
+    }
+
+    if (unlikely(!ubase_check(uref_flow_set_def(flow_def_scaler, "pic.")) ||
+                 !ubase_check(uref_pic_flow_set_hsize(flow_def_scaler,
+                                                      sub->hsize)) ||
+                 !ubase_check(uref_pic_flow_set_vsize(flow_def_scaler,
+                                                      sub->vsize)))) {
+        uref_free(flow_def_scaler);
+        uref_free(flow_def);
+        upipe_release(upipe);
+        return NULL;
+    }
+
+    struct upipe *ffmt;
+    if (fladder_mgr->nb_workers) {
+        struct upipe_mgr *worker_mgr =
+            fladder_mgr->worker_mgrs[fladder_mgr->next_worker];
+        fladder_mgr->next_worker =
+            (fladder_mgr->next_worker + 1) % fladder_mgr->nb_workers;
+        ffmt = upipe_flow_alloc(fladder_mgr->ffmt_mgr,
+                uprobe_pfx_alloc(uprobe_use(upipe->uprobe),
+                                 UPROBE_LOG_VERBOSE, "ffmt"),
+                flow_def_scaler);
+        if (likely(ffmt != NULL))
+            sub->scaler = upipe_wlin_alloc(worker_mgr,
+                    uprobe_pfx_alloc(uprobe_use(&sub->proxy_probe),
+                                     UPROBE_LOG_VERBOSE, "worker"),
+                    ffmt,
+                    uprobe_pfx_alloc(uprobe_use(upipe->uprobe),
+                                     UPROBE_LOG_VERBOSE, "worker_x"),
+                    UPIPE_FLADDER_QUEUE_LENGTH, UPIPE_FLADDER_QUEUE_LENGTH);
+    } else
+        sub->scaler = upipe_flow_alloc(fladder_mgr->ffmt_mgr,
+                uprobe_pfx_alloc(uprobe_use(&sub->proxy_probe),
+                                 UPROBE_LOG_VERBOSE, "ffmt"),
+                flow_def_scaler);
+    uref_free(flow_def_scaler);
+
+    if (sub->scaler != NULL &&
+        (sub->dup = upipe_void_alloc_output(sub->scaler,
+                fladder_mgr->dup_mgr,
+                uprobe_pfx_alloc(uprobe_use(&sub->proxy_probe),
+                                 UPROBE_LOG_VERBOSE, "dup"))) != NULL) {
+        sub->enc_feed = upipe_void_alloc_sub(sub->dup,
+                uprobe_pfx_alloc(uprobe_use(&sub->proxy_probe),
+                                 UPROBE_LOG_VERBOSE, "enc_feed"));
+        if (sub->enc_feed != NULL)
+            upipe_fladder_sub_store_bin_output(upipe,
+                    upipe_flow_alloc_output(sub->enc_feed,
+                        fladder_mgr->fenc_mgr,
+                        uprobe_pfx_alloc(uprobe_use(&sub->last_inner_probe),
+                                         UPROBE_LOG_VERBOSE, "fenc"),
+                        flow_def));
+    }
+    uref_free(flow_def);
+
+    if (unlikely(sub->last_inner == NULL)) {
+        upipe_err(upipe, "unable to allocate inner pipes");
+        upipe_release(upipe);
+        return NULL;
+    }
+
+    if (upipe_fladder->gop)
+        upipe_fladder_sub_enforce(upipe, true);
+    upipe_fladder_rebalance(super, NULL);
+    return upipe;
+}
+
+/** @internal @This processes control commands on a rendition.
+ *
+ * @param upipe description structure of the pipe
+ * @param command type of command to process
+ * @param args arguments of the command
+ * @return an error code
+ */
+static int upipe_fladder_sub_control(struct upipe *upipe,
+                                     int command, va_list args)
+{
+    UBASE_HANDLED_RETURN(upipe_fladder_sub_control_super(upipe, command, args));
+    return upipe_fladder_sub_control_bin_output(upipe, command, args);
+}
+
+/** @This frees a rendition.
+ *
+ * @param urefcount_real pointer to urefcount_real structure
+ */
+static void upipe_fladder_sub_free(struct urefcount *urefcount_real)
+{
+    struct upipe_fladder_sub *sub =
+        upipe_fladder_sub_from_urefcount_real(urefcount_real);
+    struct upipe *upipe = upipe_fladder_sub_to_upipe(sub);
+    upipe_throw_dead(upipe);
+    upipe_fladder_sub_clean_sub(upipe);
+    upipe_fladder_sub_clean_last_inner_probe(upipe);
+    upipe_fladder_sub_clean_proxy_probe(upipe);
+    urefcount_clean(urefcount_real);
+    upipe_fladder_sub_clean_urefcount(upipe);
+    upipe_fladder_sub_free_flow(upipe);
+}
+
+/** @This is called when there is no external reference to the rendition
+ * anymore. The smaller renditions scaled from it are reconnected to its
+ * parent.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_fladder_sub_no_ref(struct upipe *upipe)
+{
+    struct upipe_fladder_sub *sub = upipe_fladder_sub_from_upipe(upipe);
+    struct upipe_fladder *upipe_fladder =
+        upipe_fladder_from_sub_mgr(upipe->mgr);
+    upipe_fladder_rebalance(upipe_fladder_to_upipe(upipe_fladder), sub);
+
+    upipe_release(sub->feed);
+    sub->feed = NULL;
+    upipe_release(sub->enc_feed);
+    sub->enc_feed = NULL;
+    upipe_release(sub->dup);
+    sub->dup = NULL;
+    upipe_release(sub->scaler);
+    sub->scaler = NULL;
+    upipe_fladder_sub_clean_bin_output(upipe);
+    urefcount_release(upipe_fladder_sub_to_urefcount_real(sub));
+}
+
+/** @internal @This initializes the manager of renditions.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_fladder_init_sub_mgr(struct upipe *upipe)
+{
+    struct upipe_fladder *upipe_fladder = upipe_fladder_from_upipe(upipe);
+    struct upipe_mgr *sub_mgr = &upipe_fladder->sub_mgr;
+    sub_mgr->refcount = upipe_fladder_to_urefcount_real(upipe_fladder);
+    sub_mgr->signature = UPIPE_FLADDER_SUB_SIGNATURE;
+    sub_mgr->upipe_alloc = upipe_fladder_sub_alloc;
+    sub_mgr->upipe_input = NULL;
+    sub_mgr->upipe_control = upipe_fladder_sub_control;
+    sub_mgr->upipe_mgr_control = NULL;
+}
+
+/** @internal @This tags the decoded pictures on GOP boundaries, so that all
+ * renditions start their GOPs on the same pictures.
+ *
+ * @param uprobe pointer to the tag probe
+ * @param inner pointer to the tagger pipe
+ * @param event event triggered by the inner pipe
+ * @param args arguments of the event
+ * @return an error code
+ */
+static int upipe_fladder_catch_tag(struct uprobe *uprobe, struct upipe *inner,
+                                   int event, va_list args)
+{
+    struct upipe_fladder *upipe_fladder =
+        upipe_fladder_from_tag_probe(uprobe);
+    struct upipe *upipe = upipe_fladder_to_upipe(upipe_fladder);
+    if (event != UPROBE_PROBE_UREF ||
+        ubase_get_signature(args) != UPIPE_PROBE_UREF_SIGNATURE)
+        return upipe_throw_proxy(upipe, inner, event, args);
+
+    UBASE_SIGNATURE_CHECK(args, UPIPE_PROBE_UREF_SIGNATURE)
+    struct uref *uref = va_arg(args, struct uref *);
+    if (!upipe_fladder->gop)
+        return UBASE_ERR_NONE;
+
+    if (!upipe_fladder->gop_count) {
+        uref_pic_set_key(uref);
+        uref_h264_set_type(uref, UPIPE_FLADDER_SLICE_TYPE_I);
+        uref_h265_set_type(uref, UPIPE_FLADDER_SLICE_TYPE_I);
+    } else {
+        uref_pic_delete_key(uref);
+        uref_h264_delete_type(uref);
+        uref_h265_delete_type(uref);
+    }
+    upipe_fladder->gop_count =
+        (upipe_fladder->gop_count + 1) % upipe_fladder->gop;
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This allocates a fladder pipe.
+ *
+ * @param mgr common management structure
+ * @param uprobe structure used to raise events
+ * @param signature signature of the pipe allocator
+ * @param args optional arguments
+ * @return pointer to upipe or NULL in case of allocation error
+ */
+static struct upipe *upipe_fladder_alloc(struct upipe_mgr *mgr,
+                                         struct uprobe *uprobe,
+                                         uint32_t signature, va_list args)
+{
+    struct upipe_fladder_mgr *fladder_mgr =
+        upipe_fladder_mgr_from_upipe_mgr(mgr);
+    struct upipe *upipe = upipe_fladder_alloc_void(mgr, uprobe, signature,
+                                                   args);
+    if (unlikely(upipe == NULL))
+        return NULL;
+    struct upipe_fladder *upipe_fladder = upipe_fladder_from_upipe(upipe);
+    upipe_fladder_init_urefcount(upipe);
+    urefcount_init(upipe_fladder_to_urefcount_real(upipe_fladder),
+                   upipe_fladder_free);
+    upipe_fladder_init_proxy_probe(upipe);
+    upipe_fladder_init_tag_probe(upipe);
+    upipe_fladder_init_bin_input(upipe);
+    upipe_fladder_init_sub_mgr(upipe);
+    upipe_fladder_init_sub_subs(upipe);
+    upipe_fladder->decode = false;
+    upipe_fladder->tagger = NULL;
+    upipe_fladder->dup = NULL;
+    upipe_fladder->gop = 0;
+    upipe_fladder->gop_count = 0;
+    upipe_throw_ready(upipe);
+
+    upipe_fladder->tagger = upipe_void_alloc(fladder_mgr->probe_uref_mgr,
+            uprobe_pfx_alloc(uprobe_use(&upipe_fladder->tag_probe),
+                             UPROBE_LOG_VERBOSE, "tag"));
+    if (likely(upipe_fladder->tagger != NULL))
+        upipe_fladder->dup = upipe_void_alloc_output(upipe_fladder->tagger,
+                fladder_mgr->dup_mgr,
+                uprobe_pfx_alloc(uprobe_use(&upipe_fladder->proxy_probe),
+                                 UPROBE_LOG_VERBOSE, "dup"));
+    if (unlikely(upipe_fladder->dup == NULL)) {
+        upipe_release(upipe);
+        return NULL;
+    }
+    upipe_fladder_store_bin_input(upipe, upipe_use(upipe_fladder->tagger));
+    return upipe;
+}
+
+/** @internal @This sets the input flow definition, and allocates a decoder
+ * if it is not a picture flow.
+ *
+ * @param upipe description structure of the pipe
+ * @param flow_def flow definition packet
+ * @return an error code
+ */
+static int upipe_fladder_set_flow_def(struct upipe *upipe,
+                                      struct uref *flow_def)
+{
+    struct upipe_fladder_mgr *fladder_mgr =
+        upipe_fladder_mgr_from_upipe_mgr(upipe->mgr);
+    struct upipe_fladder *upipe_fladder = upipe_fladder_from_upipe(upipe);
+    const char *def;
+    if (flow_def == NULL || !ubase_check(uref_flow_get_def(flow_def, &def)))
+        return UBASE_ERR_INVALID;
+
+    bool decode = ubase_ncmp(def, "pic.");
+    if (decode && !upipe_fladder->decode) {
+        if (fladder_mgr->fdec_mgr == NULL)
+            return UBASE_ERR_INVALID;
+        struct upipe *fdec = upipe_void_alloc(fladder_mgr->fdec_mgr,
+                uprobe_pfx_alloc(uprobe_use(&upipe_fladder->proxy_probe),
+                                 UPROBE_LOG_VERBOSE, "fdec"));
+        UBASE_ALLOC_RETURN(fdec)
+        upipe_set_output(fdec, upipe_fladder->tagger);
+        upipe_fladder_store_bin_input(upipe, fdec);
+    } else if (!decode && upipe_fladder->decode)
+        upipe_fladder_store_bin_input(upipe, upipe_use(upipe_fladder->tagger));
+    upipe_fladder->decode = decode;
+
+    return upipe_set_flow_def(upipe_fladder->first_inner, flow_def);
+}
+
+/** @internal @This sets the GOP length imposed to all renditions.
+ *
+ * @param upipe description structure of the pipe
+ * @param gop GOP length in pictures, or 0
+ * @return an error code
+ */
+static int _upipe_fladder_set_gop(struct upipe *upipe, unsigned int gop)
+{
+    struct upipe_fladder *upipe_fladder = upipe_fladder_from_upipe(upipe);
+    if (gop != upipe_fladder->gop) {
+        struct uchain *uchain;
+        ulist_foreach (&upipe_fladder->subs, uchain) {
+            struct upipe_fladder_sub *sub =
+                upipe_fladder_sub_from_uchain(uchain);
+            upipe_fladder_sub_enforce(upipe_fladder_sub_to_upipe(sub), !!gop);
+        }
+    }
+    upipe_fladder->gop = gop;
+    upipe_fladder->gop_count = 0;
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This processes control commands on a fladder pipe.
+ *
+ * @param upipe description structure of the pipe
+ * @param command type of command to process
+ * @param args arguments of the command
+ * @return an error code
+ */
+static int upipe_fladder_control(struct upipe *upipe,
+                                 int command, va_list args)
+{
+    struct upipe_fladder *upipe_fladder = upipe_fladder_from_upipe(upipe);
+    UBASE_HANDLED_RETURN(upipe_fladder_control_subs(upipe, command, args));
+
+    switch (command) {
+        case UPIPE_SET_FLOW_DEF: {
+            struct uref *flow_def = va_arg(args, struct uref *);
+            return upipe_fladder_set_flow_def(upipe, flow_def);
+        }
+        case UPIPE_FLADDER_GET_GOP: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_FLADDER_SIGNATURE)
+            unsigned int *gop_p = va_arg(args, unsigned int *);
+            *gop_p = upipe_fladder->gop;
+            return UBASE_ERR_NONE;
+        }
+        case UPIPE_FLADDER_SET_GOP: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_FLADDER_SIGNATURE)
+            unsigned int gop = va_arg(args, unsigned int);
+            return _upipe_fladder_set_gop(upipe, gop);
+        }
+    }
+
+    return upipe_fladder_control_bin_input(upipe, command, args);
+}
+
+/** @This frees a upipe.
+ *
+ * @param urefcount_real pointer to urefcount_real structure
+ */
+static void upipe_fladder_free(struct urefcount *urefcount_real)
+{
+    struct upipe_fladder *upipe_fladder =
+        upipe_fladder_from_urefcount_real(urefcount_real);
+    struct upipe *upipe = upipe_fladder_to_upipe(upipe_fladder);
+    upipe_throw_dead(upipe);
+    upipe_fladder_clean_sub_subs(upipe);
+    upipe_fladder_clean_tag_probe(upipe);
+    upipe_fladder_clean_proxy_probe(upipe);
+    urefcount_clean(urefcount_real);
+    upipe_fladder_clean_urefcount(upipe);
+    upipe_fladder_free_void(upipe);
+}
+
+/** @This is called when there is no external reference to the pipe anymore.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_fladder_no_ref(struct upipe *upipe)
+{
+    struct upipe_fladder *upipe_fladder = upipe_fladder_from_upipe(upipe);
+    upipe_fladder_clean_bin_input(upipe);
+    upipe_release(upipe_fladder->tagger);
+    upipe_fladder->tagger = NULL;
+    upipe_release(upipe_fladder->dup);
+    upipe_fladder->dup = NULL;
+    urefcount_release(upipe_fladder_to_urefcount_real(upipe_fladder));
+}
+
+/** @This frees a upipe manager.
+ *
+ * @param urefcount pointer to urefcount structure
+ */
+static void upipe_fladder_mgr_free(struct urefcount *urefcount)
+{
+    struct upipe_fladder_mgr *fladder_mgr =
+        upipe_fladder_mgr_from_urefcount(urefcount);
+    for (unsigned int i = 0; i < fladder_mgr->nb_workers; i++)
+        upipe_mgr_release(fladder_mgr->worker_mgrs[i]);
+    upipe_mgr_release(fladder_mgr->probe_uref_mgr);
+    upipe_mgr_release(fladder_mgr->dup_mgr);
+    upipe_mgr_release(fladder_mgr->fenc_mgr);
+    upipe_mgr_release(fladder_mgr->ffmt_mgr);
+    upipe_mgr_release(fladder_mgr->fdec_mgr);
+
+    urefcount_clean(urefcount);
+    free(fladder_mgr);
+}
+
+/** @This processes control commands on a fladder manager.
+ *
+ * @param mgr pointer to manager
+ * @param command type of command to process
+ * @param args arguments of the command
+ * @return an error code
+ */
+static int upipe_fladder_mgr_control(struct upipe_mgr *mgr,
+                                     int command, va_list args)
+{
+    struct upipe_fladder_mgr *fladder_mgr =
+        upipe_fladder_mgr_from_upipe_mgr(mgr);
+
+    switch (command) {
+#define GET_SET_MGR(name, NAME)                                             \
+        case UPIPE_FLADDER_MGR_GET_##NAME##_MGR: {                          \
+            UBASE_SIGNATURE_CHECK(args, UPIPE_FLADDER_SIGNATURE)            \
+            struct upipe_mgr **p = va_arg(args, struct upipe_mgr **);       \
+            *p = fladder_mgr->name##_mgr;                                   \
+            return UBASE_ERR_NONE;                                          \
+        }                                                                   \
+        case UPIPE_FLADDER_MGR_SET_##NAME##_MGR: {                          \
+            UBASE_SIGNATURE_CHECK(args, UPIPE_FLADDER_SIGNATURE)            \
+            if (!urefcount_single(&fladder_mgr->urefcount))                 \
+                return UBASE_ERR_BUSY;                                      \
+            struct upipe_mgr *m = va_arg(args, struct upipe_mgr *);         \
+            upipe_mgr_release(fladder_mgr->name##_mgr);                     \
+            fladder_mgr->name##_mgr = upipe_mgr_use(m);                     \
+            return UBASE_ERR_NONE;                                          \
+        }
+
+        GET_SET_MGR(fdec, FDEC)
+        GET_SET_MGR(ffmt, FFMT)
+        GET_SET_MGR(fenc, FENC)
+#undef GET_SET_MGR
+
+        case UPIPE_FLADDER_MGR_ADD_WORKER: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_FLADDER_SIGNATURE)
+            if (!urefcount_single(&fladder_mgr->urefcount))
+                return UBASE_ERR_BUSY;
+            struct upipe_mgr *m = va_arg(args, struct upipe_mgr *);
+            if (m == NULL ||
+                fladder_mgr->nb_workers >= UPIPE_FLADDER_MAX_WORKERS)
+                return UBASE_ERR_INVALID;
+            fladder_mgr->worker_mgrs[fladder_mgr->nb_workers++] =
+                upipe_mgr_use(m);
+            return UBASE_ERR_NONE;
+        }
+
+        default:
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** @This returns the management structure for all fladder pipes.
+ *
+ * @return pointer to manager
+ */
+struct upipe_mgr *upipe_fladder_mgr_alloc(void)
+{
+    struct upipe_fladder_mgr *fladder_mgr =
+        malloc(sizeof(struct upipe_fladder_mgr));
+    if (unlikely(fladder_mgr == NULL))
+        return NULL;
+
+    memset(fladder_mgr, 0, sizeof(*fladder_mgr));
+    fladder_mgr->fdec_mgr = NULL;
+    fladder_mgr->ffmt_mgr = NULL;
+    fladder_mgr->fenc_mgr = NULL;
+    fladder_mgr->dup_mgr = upipe_dup_mgr_alloc();
+    fladder_mgr->probe_uref_mgr = upipe_probe_uref_mgr_alloc();
+    fladder_mgr->nb_workers = 0;
+    fladder_mgr->next_worker = 0;
+
+    urefcount_init(upipe_fladder_mgr_to_urefcount(fladder_mgr),
+                   upipe_fladder_mgr_free);
+    fladder_mgr->mgr.refcount = upipe_fladder_mgr_to_urefcount(fladder_mgr);
+    fladder_mgr->mgr.signature = UPIPE_FLADDER_SIGNATURE;
+    fladder_mgr->mgr.upipe_alloc = upipe_fladder_alloc;
+    fladder_mgr->mgr.upipe_input = upipe_fladder_bin_input;
+    fladder_mgr->mgr.upipe_control = upipe_fladder_control;
+    fladder_mgr->mgr.upipe_mgr_control = upipe_fladder_mgr_control;
+    return upipe_fladder_mgr_to_upipe_mgr(fladder_mgr);
+}
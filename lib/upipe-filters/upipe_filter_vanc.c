@@ -64,6 +64,18 @@
 #include <bitstream/dvb/vbi.h>
 #include <bitstream/dvb/telx.h>
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+/** number of words checked at once for the ancillary data flag */
+#define UPIPE_VANC_VECTOR 16
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define UPIPE_VANC_VECTOR 8
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define UPIPE_VANC_VECTOR 8
+#endif
+
 /** from my dice */
 #define MAX_SCTE104_SIZE 4096
 /** 34 telx frames of 46 octets */
@@ -782,6 +794,135 @@ static void upipe_vanc_process_cea708(struct upipe *upipe, struct uref *uref,
         *upipe_vanc->cea708_w++ = r[j] & 0xff;
 }
 
+#ifdef UPIPE_VANC_VECTOR
+/** @internal @This looks for an ancillary data flag starting at one of the
+ * next UPIPE_VANC_VECTOR words. Up to UPIPE_VANC_VECTOR + 2 words are read.
+ *
+ * @param r pointer to the words
+ * @return position of the flag, or UPIPE_VANC_VECTOR if there is none
+ */
+static inline unsigned int upipe_vanc_adf_vector(const uint16_t *r)
+{
+#if defined(__AVX2__)
+    __m256i m = _mm256_and_si256(
+        _mm256_cmpeq_epi16(_mm256_loadu_si256((const __m256i *)r),
+                           _mm256_set1_epi16(S291_ADF1)),
+        _mm256_and_si256(
+            _mm256_cmpeq_epi16(_mm256_loadu_si256((const __m256i *)(r + 1)),
+                               _mm256_set1_epi16(S291_ADF2)),
+            _mm256_cmpeq_epi16(_mm256_loadu_si256((const __m256i *)(r + 2)),
+                               _mm256_set1_epi16(S291_ADF3))));
+    uint32_t mask = _mm256_movemask_epi8(m);
+#elif defined(__SSE2__)
+    __m128i m = _mm_and_si128(
+        _mm_cmpeq_epi16(_mm_loadu_si128((const __m128i *)r),
+                        _mm_set1_epi16(S291_ADF1)),
+        _mm_and_si128(
+            _mm_cmpeq_epi16(_mm_loadu_si128((const __m128i *)(r + 1)),
+                            _mm_set1_epi16(S291_ADF2)),
+            _mm_cmpeq_epi16(_mm_loadu_si128((const __m128i *)(r + 2)),
+                            _mm_set1_epi16(S291_ADF3))));
+    uint32_t mask = _mm_movemask_epi8(m);
+#else
+    static const uint16_t bits[8] = { 1, 4, 16, 64, 256, 1024, 4096, 16384 };
+    uint16x8_t m = vandq_u16(vceqq_u16(vld1q_u16(r), vdupq_n_u16(S291_ADF1)),
+                   vandq_u16(vceqq_u16(vld1q_u16(r + 1),
+                                       vdupq_n_u16(S291_ADF2)),
+                             vceqq_u16(vld1q_u16(r + 2),
+                                       vdupq_n_u16(S291_ADF3))));
+    uint32_t mask = vaddvq_u16(vandq_u16(m, vld1q_u16(bits)));
+#endif
+    /* two mask bits per word */
+    return mask ? __builtin_ctz(mask) / 2 : UPIPE_VANC_VECTOR;
+}
+#endif
+
+/** @internal @This returns the position of the first ancillary data flag.
+ *
+ * @param r pointer to the words
+ * @param size number of candidate positions, r[size + 1] must be readable
+ * @return position of the flag, or size if there is none
+ */
+static size_t upipe_vanc_find_adf(const uint16_t *r, size_t size)
+{
+    size_t i = 0;
+#ifdef UPIPE_VANC_VECTOR
+    for ( ; i + UPIPE_VANC_VECTOR <= size; i += UPIPE_VANC_VECTOR) {
+        unsigned int pos = upipe_vanc_adf_vector(r + i);
+        if (pos < UPIPE_VANC_VECTOR)
+            return i + pos;
+    }
+#endif
+    for ( ; i < size; i++)
+        if (r[i] == S291_ADF1 && r[i + 1] == S291_ADF2 &&
+            r[i + 2] == S291_ADF3)
+            return i;
+    return size;
+}
+
+/** @internal @This checks the parity bits of a header word (DID, SDID or
+ * DC): b8 is the even parity of b0-b7, and b9 is the inverse of b8.
+ *
+ * @param w word to check
+ * @return true if the parity bits are valid
+ */
+static inline bool upipe_vanc_check_parity(uint16_t w)
+{
+    uint16_t b8 = __builtin_parity(w & 0xff);
+    return (w >> 8) == (b8 | ((b8 ^ 1) << 1));
+}
+
+/** @internal @This checks the checksum of an ancillary data packet, which
+ * is the sum of the 9 LSBs of the words from DID to the last UDW, with b9
+ * the inverse of b8.
+ *
+ * @param r pointer to the ancillary data flag
+ * @param dc data count of the packet
+ * @return true if the checksum is valid
+ */
+static bool upipe_vanc_check_cs(const uint16_t *r, uint8_t dc)
+{
+    const uint16_t *w = r + S291_HEADER_SIZE - 3;
+    size_t size = 3 + dc;
+    size_t i = 0;
+    /* sums are computed modulo 2^16, which preserves them modulo 2^9 */
+    uint16_t sum = 0;
+#if defined(__AVX2__)
+    __m256i acc = _mm256_setzero_si256();
+    for ( ; i + 16 <= size; i += 16)
+        acc = _mm256_add_epi16(acc, _mm256_and_si256(
+                    _mm256_loadu_si256((const __m256i *)(w + i)),
+                    _mm256_set1_epi16(0x1ff)));
+    __m128i acc128 = _mm_add_epi16(_mm256_castsi256_si128(acc),
+                                   _mm256_extracti128_si256(acc, 1));
+    acc128 = _mm_add_epi16(acc128, _mm_srli_si128(acc128, 8));
+    acc128 = _mm_add_epi16(acc128, _mm_srli_si128(acc128, 4));
+    acc128 = _mm_add_epi16(acc128, _mm_srli_si128(acc128, 2));
+    sum = _mm_cvtsi128_si32(acc128);
+#elif defined(__SSE2__)
+    __m128i acc = _mm_setzero_si128();
+    for ( ; i + 8 <= size; i += 8)
+        acc = _mm_add_epi16(acc, _mm_and_si128(
+                    _mm_loadu_si128((const __m128i *)(w + i)),
+                    _mm_set1_epi16(0x1ff)));
+    acc = _mm_add_epi16(acc, _mm_srli_si128(acc, 8));
+    acc = _mm_add_epi16(acc, _mm_srli_si128(acc, 4));
+    acc = _mm_add_epi16(acc, _mm_srli_si128(acc, 2));
+    sum = _mm_cvtsi128_si32(acc);
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    uint16x8_t acc = vdupq_n_u16(0);
+    for ( ; i + 8 <= size; i += 8)
+        acc = vaddq_u16(acc, vandq_u16(vld1q_u16(w + i), vdupq_n_u16(0x1ff)));
+    sum = vaddvq_u16(acc);
+#endif
+    for ( ; i < size; i++)
+        sum += w[i] & 0x1ff;
+
+    sum &= 0x1ff;
+    sum |= (~sum & 0x100) << 1;
+    return w[size] == sum;
+}
+
 /** @internal @This processes a vanc line.
  *
  * @param upipe description structure of the pipe
@@ -795,9 +936,19 @@ static void upipe_vanc_process_line(struct upipe *upipe, struct uref *uref,
                                     const uint16_t *r, size_t hsize)
 {
     while (hsize > S291_HEADER_SIZE + S291_FOOTER_SIZE) {
-        if (r[0] != S291_ADF1 || r[1] != S291_ADF2 || r[2] != S291_ADF3) {
-            r++;
-            hsize--;
+        /* most lines are empty, skip to the next flag at once */
+        size_t skip = upipe_vanc_find_adf(r,
+                hsize - S291_HEADER_SIZE - S291_FOOTER_SIZE);
+        r += skip;
+        hsize -= skip;
+        if (hsize <= S291_HEADER_SIZE + S291_FOOTER_SIZE)
+            break;
+
+        if (!upipe_vanc_check_parity(r[3]) || !upipe_vanc_check_parity(r[4]) ||
+            !upipe_vanc_check_parity(r[5])) {
+            upipe_verbose(upipe, "invalid ancillary header parity");
+            r += 3;
+            hsize -= 3;
             continue;
         }
 
@@ -810,7 +961,7 @@ static void upipe_vanc_process_line(struct upipe *upipe, struct uref *uref,
             break;
         }
 
-        if (!s291_check_cs(r)) {
+        if (!upipe_vanc_check_cs(r, dc)) {
             upipe_warn_va(upipe, "invalid CRC for 0x%"PRIx8"/0x%"PRIx8,
                           did, sdid);
             r += 3;
@@ -69,6 +69,11 @@
 
 #define EXPECTED_FLOW_DEF "block."
 
+/** maximum number of FCI in a NACK packet, to fit in a 1500 octets MTU */
+#define RTPFB_NACK_MAX_FCI 256
+/** maximum number of buffered sequence numbers */
+#define RTPFB_WINDOW_MAX 32768
+
 /** upipe_rtpfb structure */
 struct upipe_rtpfb {
     /** real refcount management structure */
@@ -94,9 +99,17 @@ struct upipe_rtpfb {
     struct upump *upump_timer_lost;
     struct uclock *uclock;
     struct urequest uclock_request;
-    struct uchain queue;
     struct uprobe *uprobe;
 
+    /** buffered packets, indexed by sequence number */
+    struct uref *packets[65536];
+    /** bitmap of the buffered sequence numbers */
+    uint64_t present[65536 / 64];
+    /** oldest buffered sequence number, or UINT32_MAX if empty */
+    uint32_t first_seqnum;
+    /** newest buffered sequence number */
+    uint32_t last_seqnum;
+
     /** expected sequence number */
     unsigned expected_seqnum;
 
@@ -386,19 +399,108 @@ static void upipe_rtpfb_send_rr(struct upipe *upipe, uint64_t cr)
     upipe_rtpfb_output_output(upipe_rtpfb->rtpfb_output, pkt, NULL);
 }
 
+/** @internal @This checks if a sequence number is buffered.
+ *
+ * @param upipe_rtpfb private structure of the pipe
+ * @param seqnum sequence number
+ * @return true if the packet is buffered
+ */
+static inline bool upipe_rtpfb_is_present(struct upipe_rtpfb *upipe_rtpfb,
+                                          uint16_t seqnum)
+{
+    return upipe_rtpfb->present[seqnum / 64] & (UINT64_C(1) << (seqnum % 64));
+}
+
+/** @internal @This returns the next missing sequence number.
+ *
+ * @param upipe_rtpfb private structure of the pipe
+ * @param seqnum first sequence number to check
+ * @param end sequence number to stop at (excluded)
+ * @return the first missing sequence number, or end
+ */
+static uint16_t upipe_rtpfb_next_missing(struct upipe_rtpfb *upipe_rtpfb,
+                                         uint16_t seqnum, uint16_t end)
+{
+    while (seqnum != end) {
+        uint64_t missing = ~upipe_rtpfb->present[seqnum / 64] >> (seqnum % 64);
+        unsigned skip = missing ? __builtin_ctzll(missing) : 64 - seqnum % 64;
+        if ((uint16_t)(end - seqnum) <= skip)
+            return end;
+        seqnum += skip;
+        if (missing)
+            break;
+    }
+    return seqnum;
+}
+
+/** @internal @This stores a packet in the buffer.
+ *
+ * @param upipe_rtpfb private structure of the pipe
+ * @param uref packet to store
+ * @param seqnum sequence number of the packet
+ */
+static void upipe_rtpfb_store(struct upipe_rtpfb *upipe_rtpfb,
+                              struct uref *uref, uint16_t seqnum)
+{
+    upipe_rtpfb->packets[seqnum] = uref;
+    upipe_rtpfb->present[seqnum / 64] |= UINT64_C(1) << (seqnum % 64);
+    upipe_rtpfb->buffered++;
+    upipe_rtpfb->last_nack[seqnum] = 0;
+}
+
+/** @internal @This outputs the oldest buffered packet.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_rtpfb_output_first(struct upipe *upipe)
+{
+    struct upipe_rtpfb *upipe_rtpfb = upipe_rtpfb_from_upipe(upipe);
+    uint16_t seqnum = upipe_rtpfb->first_seqnum;
+    struct uref *uref = upipe_rtpfb->packets[seqnum];
+
+    upipe_rtpfb->packets[seqnum] = NULL;
+    upipe_rtpfb->present[seqnum / 64] &= ~(UINT64_C(1) << (seqnum % 64));
+
+    uint16_t end = upipe_rtpfb->last_seqnum + 1;
+    uint16_t next = seqnum + 1;
+    while (next != end && !upipe_rtpfb_is_present(upipe_rtpfb, next))
+        next++;
+    upipe_rtpfb->first_seqnum = next == end ? UINT32_MAX : next;
+
+    if (likely(upipe_rtpfb->last_output_seqnum != UINT_MAX)) {
+        uint16_t diff = seqnum - upipe_rtpfb->last_output_seqnum - 1;
+        if (diff) {
+            upipe_rtpfb->loss += diff;
+            upipe_err_va(upipe, "PKT LOSS: %u -> %hu DIFF %hu",
+                    upipe_rtpfb->last_output_seqnum, seqnum, diff);
+        }
+    }
+
+    upipe_rtpfb->last_output_seqnum = seqnum;
+
+    upipe_rtpfb_output(upipe, uref, NULL); // XXX: use timer upump ?
+    if (--upipe_rtpfb->buffered == 0) {
+        upipe_warn_va(upipe, "Exhausted buffer");
+        upipe_rtpfb->expected_seqnum = UINT_MAX;
+    }
+}
+
 /** @internal @This sends a retransmission request for a number of seqnums.
  *
  * @param upipe description structure of the pipe
- * @param lost_seqnum First sequence number missing
- * @param seqnum First sequence number NOT missing
+ * @param pids first missing sequence number of each FCI
+ * @param blps bitmask of following lost packets of each FCI
+ * @param nb_fci number of FCI
  * @param ssrc TODO
  */
-static void upipe_rtpfb_lost(struct upipe *upipe, uint16_t lost_seqnum, uint16_t seqnum, uint8_t *ssrc)
+static void upipe_rtpfb_lost(struct upipe *upipe, const uint16_t *pids,
+                             const uint16_t *blps, unsigned nb_fci,
+                             uint8_t *ssrc)
 {
     struct upipe_rtpfb *upipe_rtpfb = upipe_rtpfb_from_upipe(upipe);
 
-    /* Send a single NACK packet, with a single FCI */
-    int s = RTCP_FB_HEADER_SIZE + 1 * RTCP_FB_FCI_GENERIC_NACK_SIZE;
+    /* Send a single NACK packet, with one FCI per group of 17 packets */
+    int s = RTCP_FB_HEADER_SIZE + nb_fci * RTCP_FB_FCI_GENERIC_NACK_SIZE;
 
     /* Allocate NACK packet */
     struct uref *pkt = uref_block_alloc(upipe_rtpfb->uref_mgr,
@@ -422,25 +524,17 @@ static void upipe_rtpfb_lost(struct upipe *upipe, uint16_t lost_seqnum, uint16_t
     rtcp_fb_set_ssrc_pkt_sender(buf, ssrc_sender);
     rtcp_fb_set_ssrc_media_src(buf, ssrc);
 
-    uint8_t *fci = &buf[RTCP_FB_HEADER_SIZE];
-    rtcp_fb_nack_set_packet_id(fci, lost_seqnum);
-
-    uint16_t pkts = seqnum - 1 - lost_seqnum;
-    // TODO : add several FCI if more than 17 packets are missing
-    if (pkts > 16)
-        pkts = 16;
-
-    uint16_t bits = 0;
-    for (size_t i = 0; i < pkts; i++)
-        bits |= 1 << i;
-
-    rtcp_fb_nack_set_bitmask_lost(fci, bits);
-    upipe_rtpfb->nacks += pkts + 1;
+    for (unsigned i = 0; i < nb_fci; i++) {
+        uint8_t *fci = &buf[RTCP_FB_HEADER_SIZE +
+                            i * RTCP_FB_FCI_GENERIC_NACK_SIZE];
+        rtcp_fb_nack_set_packet_id(fci, pids[i]);
+        rtcp_fb_nack_set_bitmask_lost(fci, blps[i]);
+        upipe_rtpfb->nacks += 1 + __builtin_popcount(blps[i]);
+        upipe_verbose_va(upipe, "NACKing %hu (+0x%hx)", pids[i], blps[i]);
+    }
 
     rtcp_set_length(buf, s / 4 - 1);
 
-    upipe_verbose_va(upipe, "NACKing %hu (+0x%hx)", lost_seqnum, bits);
-
     uref_block_unmap(pkt, 0);
 
     // XXX : date NACK packet?
@@ -456,7 +550,8 @@ static void upipe_rtpfb_timer_lost(struct upump *upump)
     struct upipe *upipe = upump_get_opaque(upump, struct upipe *);
     struct upipe_rtpfb *upipe_rtpfb = upipe_rtpfb_from_upipe(upipe);
 
-    uint64_t expected_seq = UINT64_MAX;
+    if (upipe_rtpfb->first_seqnum == UINT32_MAX)
+        return;
 
     uint64_t now = uclock_now(upipe_rtpfb->uclock);
 
@@ -468,55 +563,56 @@ static void upipe_rtpfb_timer_lost(struct upump *upump)
      * XXX: use cr_sys, because pkts/s also accounts for
      * the retransmitted packets */
 
-    struct uchain *uchain;
+    uint8_t ssrc[4] = {0,}; // TODO
+    uint16_t pids[RTPFB_NACK_MAX_FCI];
+    uint16_t blps[RTPFB_NACK_MAX_FCI];
+    unsigned nb_fci = 0;
     int holes = 0;
-    ulist_foreach(&upipe_rtpfb->queue, uchain) {
-        struct uref *uref = uref_from_uchain(uchain);
-        uint64_t seqnum = 0;
-        uref_attr_get_priv(uref, &seqnum);
-
-        if (likely(expected_seq != UINT64_MAX) && seqnum != expected_seq) {
-            /* hole found */
-            uint8_t ssrc[4] = {0,}; // TODO
-            upipe_dbg_va(upipe, "Found hole from %"PRIu64" (incl) to %"PRIu64" (excl)",
-                expected_seq, seqnum);
-
-            for (uint16_t seq = expected_seq; seq != seqnum; seq++) {
-                /* if packet was lost, we should have detected it already */
-                if (upipe_rtpfb->last_nack[seq] == 0) {
-                    upipe_err_va(upipe, "packet %hu missing but was not marked as lost!", seq);
-                    continue;
-                }
 
-                /* if we sent a NACK not too long ago, do not repeat it */
-                /* since NACKs are sent in a batch, break loop if the first packet is too early */
-                if (upipe_rtpfb->last_nack[seq] > next_nack) {
-                    if (0) upipe_err_va(upipe, "Cancelling NACK due to RTT (seq %hu diff %"PRId64"",
-                        seq, next_nack - upipe_rtpfb->last_nack[seq]
-                    );
-                    goto next;
-                }
-            }
+    uint16_t end = upipe_rtpfb->last_seqnum;
+    uint16_t seq = upipe_rtpfb->first_seqnum;
+    while ((seq = upipe_rtpfb_next_missing(upipe_rtpfb, seq, end)) != end) {
+        /* if packet was lost, we should have detected it already */
+        if (upipe_rtpfb->last_nack[seq] == 0) {
+            upipe_err_va(upipe, "packet %hu missing but was not marked as lost!", seq);
+            seq++;
+            continue;
+        }
 
-            /* update NACK request time */
-            for (uint16_t seq = expected_seq; seq != seqnum; seq++) {
-                upipe_rtpfb->last_nack[seq] = now;
-            }
+        /* if we sent a NACK not too long ago, do not repeat it */
+        if (upipe_rtpfb->last_nack[seq] > next_nack) {
+            seq++;
+            continue;
+        }
 
-            /* TODO:
-                - check the following packets to fill in bitmask
-                - send request in a single batch (multiple FCI)
-             */
-            upipe_rtpfb_lost(upipe, expected_seq, seqnum, ssrc);
-            holes++;
+        /* update NACK request time */
+        upipe_rtpfb->last_nack[seq] = now;
+        holes++;
+
+        /* merge in the bitmask of the previous FCI if possible */
+        if (nb_fci) {
+            uint16_t offset = seq - pids[nb_fci - 1] - 1;
+            if (offset < 16) {
+                blps[nb_fci - 1] |= 1 << offset;
+                seq++;
+                continue;
+            }
         }
 
-next:
-        expected_seq = (seqnum + 1) & UINT16_MAX;
+        if (nb_fci == RTPFB_NACK_MAX_FCI) {
+            upipe_rtpfb_lost(upipe, pids, blps, nb_fci, ssrc);
+            nb_fci = 0;
+        }
+        pids[nb_fci] = seq;
+        blps[nb_fci] = 0;
+        nb_fci++;
+        seq++;
     }
 
+    if (nb_fci)
+        upipe_rtpfb_lost(upipe, pids, blps, nb_fci, ssrc);
+
     if (holes) { /* debug stats */
-        uint64_t now = uclock_now(upipe_rtpfb->uclock);
         static uint64_t old;
         if (likely(old != 0))
             upipe_dbg_va(upipe, "%d holes after %"PRIu64" ms",
@@ -534,13 +630,8 @@ static void upipe_rtpfb_timer(struct upump *upump)
 
     uint64_t now = uclock_now(upipe_rtpfb->uclock);
 
-    struct uchain *uchain, *uchain_tmp;
-    ulist_delete_foreach(&upipe_rtpfb->queue, uchain, uchain_tmp) {
-        struct uref *uref = uref_from_uchain(uchain);
-        uint64_t seqnum = 0;
-        if (!ubase_check(uref_attr_get_priv(uref, &seqnum))) {
-            upipe_err_va(upipe, "Could not read seqnum from uref");
-        }
+    while (upipe_rtpfb->first_seqnum != UINT32_MAX) {
+        struct uref *uref = upipe_rtpfb->packets[upipe_rtpfb->first_seqnum];
 
         uint64_t cr_sys = 0;
         if (unlikely(!ubase_check(uref_clock_get_cr_sys(uref, &cr_sys))))
@@ -549,24 +640,9 @@ static void upipe_rtpfb_timer(struct upump *upump)
         if (now - cr_sys <= upipe_rtpfb->latency * UCLOCK_FREQ / 1000)
             break;
 
-        upipe_verbose_va(upipe, "Output seq %"PRIu64" after %"PRIu64" clocks", seqnum, now - cr_sys);
-        if (likely(upipe_rtpfb->last_output_seqnum != UINT_MAX)) {
-            uint16_t diff = seqnum - upipe_rtpfb->last_output_seqnum - 1;
-            if (diff) {
-                upipe_rtpfb->loss += diff;
-                upipe_err_va(upipe, "PKT LOSS: %u -> %"PRIu64" DIFF %hu",
-                        upipe_rtpfb->last_output_seqnum, seqnum, diff);
-            }
-        }
-
-        upipe_rtpfb->last_output_seqnum = seqnum;
-
-        ulist_delete(uchain);
-        upipe_rtpfb_output(upipe, uref, NULL); // XXX: use timer upump ?
-        if (--upipe_rtpfb->buffered == 0) {
-            upipe_warn_va(upipe, "Exhausted buffer");
-            upipe_rtpfb->expected_seqnum = UINT_MAX;
-        }
+        upipe_verbose_va(upipe, "Output seq %u after %"PRIu64" clocks",
+                upipe_rtpfb->first_seqnum, now - cr_sys);
+        upipe_rtpfb_output_first(upipe);
     }
 }
 
@@ -601,7 +677,10 @@ static struct upipe *upipe_rtpfb_alloc(struct upipe_mgr *mgr,
     upipe_rtpfb_init_upump_mgr(upipe);
     upipe_rtpfb_check_upump_mgr(upipe);
     upipe_rtpfb_init_uclock(upipe);
-    ulist_init(&upipe_rtpfb->queue);
+    memset(upipe_rtpfb->packets, 0, sizeof(upipe_rtpfb->packets));
+    memset(upipe_rtpfb->present, 0, sizeof(upipe_rtpfb->present));
+    upipe_rtpfb->first_seqnum = UINT32_MAX;
+    upipe_rtpfb->last_seqnum = UINT32_MAX;
     memset(upipe_rtpfb->last_nack, 0, sizeof(upipe_rtpfb->last_nack));
     upipe_rtpfb->rtt = UCLOCK_FREQ / 100; /* will be updated later */
     upipe_rtpfb_require_uclock(upipe);
@@ -635,40 +714,29 @@ static struct upipe *upipe_rtpfb_alloc(struct upipe_mgr *mgr,
 }
 
 /* returns true if uref was inserted in the queue */
-static bool upipe_rtpfb_insert_inner(struct upipe *upipe, struct uref *uref,
-        const uint16_t seqnum, struct uref *next)
+static bool upipe_rtpfb_insert(struct upipe *upipe, struct uref *uref, const uint16_t seqnum)
 {
     struct upipe_rtpfb *upipe_rtpfb = upipe_rtpfb_from_upipe(upipe);
-    uint64_t next_seqnum = 0;
-    uref_attr_get_priv(next, &next_seqnum);
 
-    uint16_t diff = seqnum - next_seqnum;
-    if (!diff) {
-        upipe_dbg_va(upipe, "dropping duplicate %hu", seqnum);
-        upipe_rtpfb->dups++;
-        uref_free(uref);
-        return true;
-    }
-
-    /* browse the list until we find a seqnum bigger than ours */
-    if (diff < 0x8000) // seqnum > next_seqnum
+    /* if the packet is before the buffer we're too late */
+    if (upipe_rtpfb->first_seqnum == UINT32_MAX ||
+        (uint16_t)(upipe_rtpfb->last_seqnum - seqnum) >
+            (uint16_t)(upipe_rtpfb->last_seqnum - upipe_rtpfb->first_seqnum))
         return false;
 
-    /* if there's no previous packet we're too late */
-    struct uchain *uchain = uref_to_uchain(next);
-    if (unlikely(ulist_is_first(&upipe_rtpfb->queue, uchain))) {
-        upipe_err_va(upipe,
-                "LATE packet drop: Expected %u, got %hu, didn't insert after %"PRIu64,
-                upipe_rtpfb->expected_seqnum, seqnum, next_seqnum);
+    if (upipe_rtpfb_is_present(upipe_rtpfb, seqnum)) {
+        upipe_dbg_va(upipe, "dropping duplicate %hu", seqnum);
+        upipe_rtpfb->dups++;
         uref_free(uref);
         return true;
     }
 
     /* Read previous packet seq & cr_sys */
-    uint64_t prev_seqnum = 0, cr_sys = 0;
-
-    struct uref *prev = uref_from_uchain(uchain->prev);
-    uref_attr_get_priv(prev, &prev_seqnum);
+    uint16_t prev_seqnum = seqnum - 1;
+    while (!upipe_rtpfb_is_present(upipe_rtpfb, prev_seqnum))
+        prev_seqnum--;
+    struct uref *prev = upipe_rtpfb->packets[prev_seqnum];
+    uint64_t cr_sys = 0;
 
     /* overwrite this uref' cr_sys with previous one's
      * so it get scheduled at the right time */
@@ -678,32 +746,14 @@ static bool upipe_rtpfb_insert_inner(struct upipe *upipe, struct uref *uref,
         upipe_err_va(upipe, "Couldn't read cr_sys in %s() - %zu buffered",
                 __func__, upipe_rtpfb->buffered);
 
-    upipe_rtpfb->buffered++;
-    ulist_insert(uchain->prev, uchain, uref_to_uchain(uref));
+    upipe_rtpfb_store(upipe_rtpfb, uref, seqnum);
     upipe_rtpfb->repaired++;
-    upipe_rtpfb->last_nack[seqnum] = 0;
 
-    upipe_dbg_va(upipe, "Repaired %"PRIu64" > %hu > %"PRIu64" -diff %d",
-            prev_seqnum, seqnum, next_seqnum, -diff);
+    upipe_dbg_va(upipe, "Repaired %hu > %hu", prev_seqnum, seqnum);
 
     return true;
 }
 
-static bool upipe_rtpfb_insert(struct upipe *upipe, struct uref *uref, const uint16_t seqnum)
-{
-    struct upipe_rtpfb *upipe_rtpfb = upipe_rtpfb_from_upipe(upipe);
-
-    struct uchain *uchain, *uchain_tmp;
-    ulist_delete_foreach(&upipe_rtpfb->queue, uchain, uchain_tmp) {
-        struct uref *next = uref_from_uchain(uchain);
-        if (upipe_rtpfb_insert_inner(upipe, uref, seqnum, next))
-            return true;
-    }
-
-    /* Could not insert packet */
-    return false;
-}
-
 static void upipe_rtpfb_handle_sr(struct upipe *upipe, struct uref *uref)
 {
     struct upipe_rtpfb *upipe_rtpfb = upipe_rtpfb_from_upipe(upipe);
@@ -824,9 +874,19 @@ static void upipe_rtpfb_input(struct upipe *upipe, struct uref *uref,
 
     if (diff < 0x8000) { // seqnum > last seq, insert at the end
         /* packet is from the future */
-        upipe_rtpfb->buffered++;
-        ulist_add(&upipe_rtpfb->queue, uref_to_uchain(uref));
-        upipe_rtpfb->last_nack[seqnum] = 0;
+        while (upipe_rtpfb->first_seqnum != UINT32_MAX &&
+               (uint16_t)(seqnum - upipe_rtpfb->first_seqnum) >=
+                   RTPFB_WINDOW_MAX) {
+            upipe_warn(upipe, "buffer full, output packet early");
+            upipe_rtpfb_output_first(upipe);
+        }
+        if (upipe_rtpfb->first_seqnum == UINT32_MAX) {
+            upipe_rtpfb->first_seqnum = seqnum;
+            /* the buffer may have been flushed */
+            diff = 0;
+        }
+        upipe_rtpfb_store(upipe_rtpfb, uref, seqnum);
+        upipe_rtpfb->last_seqnum = seqnum;
 
         if (diff != 0) {
             /* wait a bit to send a NACK, in case of reordering */
@@ -844,12 +904,9 @@ static void upipe_rtpfb_input(struct upipe *upipe, struct uref *uref,
     if (upipe_rtpfb_insert(upipe, uref, seqnum))
         return;
 
-    uint64_t first_seq = 0, last_seq = 0;
-    uref_attr_get_priv(uref_from_uchain(upipe_rtpfb->queue.next), &first_seq);
-    uref_attr_get_priv(uref_from_uchain(upipe_rtpfb->queue.prev), &last_seq);
     // XXX : when much too late, it could mean RTP source restart
-    upipe_err_va(upipe, "LATE packet %hu, dropped (buffered %"PRIu64" -> %"PRIu64")",
-            seqnum, first_seq, last_seq);
+    upipe_err_va(upipe, "LATE packet %hu, dropped (buffered %u -> %u)",
+            seqnum, upipe_rtpfb->first_seqnum, upipe_rtpfb->last_seqnum);
     uref_free(uref);
 }
 
@@ -1003,12 +1060,8 @@ static void upipe_rtpfb_free(struct urefcount *urefcount_real)
     upipe_rtpfb_clean_uclock(upipe);
     uprobe_release(upipe_rtpfb->uprobe);
 
-    struct uchain *uchain, *uchain_tmp;
-    ulist_delete_foreach(&upipe_rtpfb->queue, uchain, uchain_tmp) {
-        struct uref *uref = uref_from_uchain(uchain);
-        ulist_delete(uchain);
-        uref_free(uref);
-    }
+    for (unsigned i = 0; i < 65536; i++)
+        uref_free(upipe_rtpfb->packets[i]);
 
     upipe_rtpfb_free_void(upipe);
 }
@@ -75,6 +75,13 @@ struct upipe_zp {
 
     int frame_counter;
     uint64_t pts, interval;
+
+    /** precomputed lines of the luma plane */
+    struct zoneplate *zoneplate;
+    /** prerendered frames, or NULL */
+    struct ubuf **frames;
+    /** number of prerendered frames */
+    unsigned int nb_frames;
 };
 
 /** @hidden */
@@ -98,6 +105,23 @@ UPIPE_HELPER_UCLOCK(upipe_zp, uclock, uclock_request, upipe_zp_check,
 UPIPE_HELPER_UPUMP_MGR(upipe_zp, upump_mgr)
 UPIPE_HELPER_UPUMP(upipe_zp, upump, upump_mgr)
 
+/** @internal @This releases the prerendered frames.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_zp_flush_frames(struct upipe *upipe)
+{
+    struct upipe_zp *upipe_zp = upipe_zp_from_upipe(upipe);
+    unsigned int i;
+
+    for (i = 0; i < upipe_zp->nb_frames; i++)
+        if (upipe_zp->frames[i] != NULL)
+            ubuf_free(upipe_zp->frames[i]);
+    free(upipe_zp->frames);
+    upipe_zp->frames = NULL;
+    upipe_zp->nb_frames = 0;
+}
+
 /** @internal @This frees a zoneplate source pipe.
  *
  * @param upipe description structure of the pipe
@@ -108,6 +132,9 @@ static void upipe_zp_free(struct upipe *upipe)
 
     upipe_throw_dead(upipe);
 
+    upipe_zp_flush_frames(upipe);
+    zoneplate_free(upipe_zp->zoneplate);
+
     upipe_zp_clean_urefcount(upipe);
     upipe_zp_clean_uref_mgr(upipe);
     upipe_zp_clean_uclock(upipe);
@@ -161,43 +188,86 @@ static struct upipe *upipe_zp_alloc(struct upipe_mgr *mgr,
     upipe_zp_store_flow_def(upipe, flow_def);
 
     upipe_zp->pts = UINT64_MAX;
+    upipe_zp->zoneplate = NULL;
+    upipe_zp->frames = NULL;
+    upipe_zp->nb_frames = 0;
 
     upipe_throw_ready(upipe);
     return upipe;
 }
 
-static int draw_zoneplate(struct upipe *upipe, struct uref *uref, int frame)
+/** @internal @This draws a frame of the pattern. The lines of the luma
+ * plane are copied from a table computed on the first call.
+ *
+ * @param upipe description structure of the pipe
+ * @param ubuf picture to draw in
+ * @param frame frame number
+ * @return an error code
+ */
+static int draw_zoneplate(struct upipe *upipe, struct ubuf *ubuf, int frame)
 {
+    struct upipe_zp *upipe_zp = upipe_zp_from_upipe(upipe);
     const char *chroma = NULL;
-    while (ubase_check(uref_pic_plane_iterate(uref, &chroma)) &&
+    while (ubase_check(ubuf_pic_plane_iterate(ubuf, &chroma)) &&
             chroma != NULL) {
-        if (!strncmp(chroma, "y8", 2)) {
+        int bytes = !strncmp(chroma, "y8", 2) ? 1 :
+                    !strncmp(chroma, "y10", 3) ? 2 : 0;
+        if (bytes) {
             uint8_t *buf;
             size_t stride, width, height;
-            UBASE_RETURN(uref_pic_size(uref, &width, &height, NULL));
-            UBASE_RETURN(uref_pic_plane_size(uref, chroma, &stride, NULL, NULL, NULL));
-            UBASE_RETURN(uref_pic_plane_write(uref, chroma, 0, 0, -1, -1, &buf));
-            gst_video_test_src_zoneplate_8bit(buf, width, height, stride, frame);
-            UBASE_RETURN(uref_pic_plane_unmap(uref, chroma, 0, 0, -1, -1));
-        }
-
-        else if (!strncmp(chroma, "y10", 3)) {
-            uint8_t *buf;
-            size_t stride, width, height;
-            UBASE_RETURN(uref_pic_size(uref, &width, &height, NULL));
-            UBASE_RETURN(uref_pic_plane_size(uref, chroma, &stride, NULL, NULL, NULL));
-            UBASE_RETURN(uref_pic_plane_write(uref, chroma, 0, 0, -1, -1, &buf));
-            gst_video_test_src_zoneplate_10bit((uint16_t*)buf, width, height, stride, frame);
-            UBASE_RETURN(uref_pic_plane_unmap(uref, chroma, 0, 0, -1, -1));
+            UBASE_RETURN(ubuf_pic_size(ubuf, &width, &height, NULL));
+            UBASE_RETURN(ubuf_pic_plane_size(ubuf, chroma, &stride, NULL, NULL, NULL));
+            if (unlikely(upipe_zp->zoneplate == NULL)) {
+                upipe_zp->zoneplate = zoneplate_alloc(width, height, bytes);
+                UBASE_ALLOC_RETURN(upipe_zp->zoneplate);
+            }
+            UBASE_RETURN(ubuf_pic_plane_write(ubuf, chroma, 0, 0, -1, -1, &buf));
+            zoneplate_draw(upipe_zp->zoneplate, buf, stride, frame);
+            UBASE_RETURN(ubuf_pic_plane_unmap(ubuf, chroma, 0, 0, -1, -1));
         }
 
         else {
-            UBASE_RETURN(uref_pic_plane_clear(uref, chroma, 0, 0, -1, -1, 1));
+            UBASE_RETURN(ubuf_pic_plane_clear(ubuf, chroma, 0, 0, -1, -1, 1));
         }
     }
     return UBASE_ERR_NONE;
 }
 
+/** @internal @This returns the picture of the next frame.
+ *
+ * @param upipe description structure of the pipe
+ * @param hsize horizontal size of the picture
+ * @param vsize vertical size of the picture
+ * @return pointer to ubuf, or NULL in case of allocation error
+ */
+static struct ubuf *upipe_zp_next_frame(struct upipe *upipe,
+                                        uint64_t hsize, uint64_t vsize)
+{
+    struct upipe_zp *upipe_zp = upipe_zp_from_upipe(upipe);
+    int frame = upipe_zp->frame_counter++;
+    struct ubuf **frame_p = NULL;
+
+    if (upipe_zp->nb_frames) {
+        frame_p = &upipe_zp->frames[frame % upipe_zp->nb_frames];
+        /* frames rendered for a previous ubuf manager are dropped */
+        if (*frame_p != NULL &&
+            (*frame_p)->mgr != ubuf_mgr_unwrap(upipe_zp->ubuf_mgr)) {
+            ubuf_free(*frame_p);
+            *frame_p = NULL;
+        }
+        if (*frame_p != NULL)
+            return ubuf_dup(*frame_p);
+    }
+
+    struct ubuf *ubuf = ubuf_pic_alloc(upipe_zp->ubuf_mgr, hsize, vsize);
+    if (unlikely(ubuf == NULL))
+        return NULL;
+    draw_zoneplate(upipe, ubuf, frame);
+    if (frame_p != NULL)
+        *frame_p = ubuf_dup(ubuf);
+    return ubuf;
+}
+
 /** @internal @This creates blank data and outputs it.
  *
  * @param upump description structure of the timer
@@ -212,13 +282,18 @@ static void upipe_zp_worker(struct upump *upump)
     ubase_assert(uref_pic_flow_get_hsize(upipe_zp->flow_def, &hsize));
     ubase_assert(uref_pic_flow_get_vsize(upipe_zp->flow_def, &vsize));
 
-    struct uref *uref = uref_pic_alloc(upipe_zp->uref_mgr, upipe_zp->ubuf_mgr, hsize, vsize);
-    if (unlikely(!uref)) {
+    struct uref *uref = uref_alloc(upipe_zp->uref_mgr);
+    struct ubuf *ubuf = upipe_zp_next_frame(upipe, hsize, vsize);
+    if (unlikely(!uref || !ubuf)) {
+        if (uref)
+            uref_free(uref);
+        if (ubuf)
+            ubuf_free(ubuf);
         upipe_err(upipe, "failed to allocate picture");
         upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
         return;
     }
-    draw_zoneplate(upipe, uref, upipe_zp->frame_counter++);
+    uref_attach_ubuf(uref, ubuf);
 
     if (unlikely(upipe_zp->pts == UINT64_MAX)) {
         upipe_zp->pts = uclock_now(upipe_zp->uclock);
@@ -295,6 +370,26 @@ static int upipe_zp_check(struct upipe *upipe, struct uref *flow_format)
     return UBASE_ERR_NONE;
 }
 
+/** @internal @This sets the number of prerendered frames.
+ *
+ * @param upipe description structure of the pipe
+ * @param nb_frames number of frames, or 0 to render every frame
+ * @return an error code
+ */
+static int _upipe_zp_set_frames(struct upipe *upipe, unsigned int nb_frames)
+{
+    struct upipe_zp *upipe_zp = upipe_zp_from_upipe(upipe);
+
+    upipe_zp_flush_frames(upipe);
+    if (!nb_frames)
+        return UBASE_ERR_NONE;
+
+    upipe_zp->frames = calloc(nb_frames, sizeof (struct ubuf *));
+    UBASE_ALLOC_RETURN(upipe_zp->frames);
+    upipe_zp->nb_frames = nb_frames;
+    return UBASE_ERR_NONE;
+}
+
 /** @internal @This handles the pipe control commands.
  *
  * @param upipe description structure of the pipe
@@ -306,6 +401,13 @@ static int upipe_zp_control_real(struct upipe *upipe,
                                    int command, va_list args)
 {
     UBASE_HANDLED_RETURN(upipe_zp_control_output(upipe, command, args));
+    switch (command) {
+        case UPIPE_ZONEPLATE_SET_FRAMES: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_ZONEPLATE_SIGNATURE)
+            unsigned int nb_frames = va_arg(args, unsigned int);
+            return _upipe_zp_set_frames(upipe, nb_frames);
+        }
+    }
     return UBASE_ERR_UNHANDLED;
 }
 
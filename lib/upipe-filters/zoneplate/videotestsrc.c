@@ -19,6 +19,7 @@
 
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "videotestsrc.h"
 
@@ -235,3 +236,90 @@ gst_video_test_src_zoneplate_10bit (uint16_t *data,
     }
   }
 }
+
+/* With the coefficients above, the phase of a pixel is the sum of a term
+ * depending on its column, a term depending on its line and the frame
+ * number, so a line is fully determined by its phase modulo 256. */
+#if V_POINTER_KX || V_POINTER_KY || V_POINTER_KXT || V_POINTER_KYT || \
+    V_POINTER_KXY || V_POINTER_KT2 || V_POINTER_KT != 1
+#error the zoneplate tables do not support these coefficients
+#endif
+
+/** precomputed zoneplate lines */
+struct zoneplate {
+  /** picture width */
+  int w;
+  /** picture height */
+  int h;
+  /** size of a sample in octets */
+  int bytes;
+  /** phase of each line */
+  uint8_t *yphase;
+  /** lines for each of the 256 phases */
+  uint8_t *lines;
+};
+
+struct zoneplate *
+zoneplate_alloc (int w, int h, int bytes)
+{
+  struct zoneplate *zp = malloc (sizeof (struct zoneplate));
+  if (zp == NULL)
+    return NULL;
+  zp->w = w;
+  zp->h = h;
+  zp->bytes = bytes;
+  zp->yphase = malloc (h);
+  zp->lines = malloc ((size_t)256 * w * bytes);
+  uint8_t *xphase = malloc (w);
+  if (zp->yphase == NULL || zp->lines == NULL || xphase == NULL) {
+    free (xphase);
+    zoneplate_free (zp);
+    return NULL;
+  }
+
+  int xreset = -(w / 2) - V_POINTER_XOFFSET;
+  int yreset = -(h / 2) - V_POINTER_YOFFSET;
+  int scale_kx2 = 0xffff / w;
+  int i, j, x, y;
+
+  for (i = 0, x = xreset; i < w; i++, x++)
+    xphase[i] = V_POINTER_K0 + ((V_POINTER_KX2 * x * x * scale_kx2) >> 16);
+  for (j = 0, y = yreset; j < h; j++, y++)
+    zp->yphase[j] = (V_POINTER_KY2 * y * y) / h;
+
+  for (j = 0; j < 256; j++) {
+    if (bytes == 1) {
+      uint8_t *line = zp->lines + (size_t)j * w;
+      for (i = 0; i < w; i++)
+        line[i] = sine_table[(xphase[i] + j) & 0xff];
+    } else {
+      uint16_t *line = (uint16_t *)zp->lines + (size_t)j * w;
+      for (i = 0; i < w; i++)
+        line[i] = sine_table[(xphase[i] + j) & 0xff] << 2;
+    }
+  }
+  free (xphase);
+  return zp;
+}
+
+void
+zoneplate_free (struct zoneplate *zp)
+{
+  if (zp == NULL)
+    return;
+  free (zp->yphase);
+  free (zp->lines);
+  free (zp);
+}
+
+void
+zoneplate_draw (const struct zoneplate *zp, uint8_t *data, size_t stride,
+        int t)
+{
+  size_t line_size = (size_t)zp->w * zp->bytes;
+  int j;
+
+  for (j = 0; j < zp->h; j++)
+    memcpy (data + j * stride,
+        zp->lines + ((zp->yphase[j] + t) & 0xff) * line_size, line_size);
+}
@@ -5,3 +5,19 @@ gst_video_test_src_zoneplate_8bit (uint8_t *data,
 void
 gst_video_test_src_zoneplate_10bit (uint16_t *data,
         int w, int h, size_t stride, int t);
+
+struct zoneplate;
+
+/* precomputes the lines of a zoneplate of w x h samples of 1 (8 bits) or
+ * 2 (10 bits) octets */
+struct zoneplate *
+zoneplate_alloc (int w, int h, int bytes);
+
+void
+zoneplate_free (struct zoneplate *zp);
+
+/* draws frame t, identical to gst_video_test_src_zoneplate_8bit or
+ * gst_video_test_src_zoneplate_10bit */
+void
+zoneplate_draw (const struct zoneplate *zp, uint8_t *data, size_t stride,
+        int t);
@@ -228,15 +228,12 @@ static bool upipe_a52f_check_frame(struct upipe *upipe, bool *ready_p)
 /** @internal @This parses A/52 Annex E header.
  *
  * @param upipe description structure of the pipe
+ * @param header syncinfo and bsi octets of the frame
  * @return false in case the header is inconsistent
  */
-static bool upipe_a52f_parse_a52e(struct upipe *upipe)
+static bool upipe_a52f_parse_a52e(struct upipe *upipe, const uint8_t *header)
 {
     struct upipe_a52f *upipe_a52f = upipe_a52f_from_upipe(upipe);
-    uint8_t header[A52_SYNCINFO_SIZE];
-    if (unlikely(!ubase_check(uref_block_extract(upipe_a52f->next_uref, 0,
-                                                 A52_SYNCINFO_SIZE, header))))
-        return true; /* not enough data */
 
     if (likely(a52e_sync_compare_formats(header, upipe_a52f->sync_header))) {
         /* identical sync */
@@ -314,15 +311,12 @@ static bool upipe_a52f_parse_a52e(struct upipe *upipe)
 /** @internal @This parses A/52 header.
  *
  * @param upipe description structure of the pipe
+ * @param header syncinfo and bsi octets of the frame
  * @return false in case the header is inconsistent
  */
-static bool upipe_a52f_parse_a52(struct upipe *upipe)
+static bool upipe_a52f_parse_a52(struct upipe *upipe, const uint8_t *header)
 {
     struct upipe_a52f *upipe_a52f = upipe_a52f_from_upipe(upipe);
-    uint8_t header[A52_SYNCINFO_SIZE];
-    if (unlikely(!ubase_check(uref_block_extract(upipe_a52f->next_uref, 0,
-                                                 A52_SYNCINFO_SIZE, header))))
-        return true; /* not enough data */
 
     ssize_t next_frame_size = a52_get_frame_size(a52_get_fscod(header),
                                                  a52_get_frmsizecod(header));
@@ -395,10 +389,10 @@ static bool upipe_a52f_parse_header(struct upipe *upipe)
 
     switch (a52_get_bsid(header)) {
         case A52_BSID_ANNEX_E:
-            return upipe_a52f_parse_a52e(upipe);
+            return upipe_a52f_parse_a52e(upipe, header);
         case A52_BSID:
         default:
-            return upipe_a52f_parse_a52(upipe);
+            return upipe_a52f_parse_a52(upipe, header);
     }
 
     return false; /* never reached */
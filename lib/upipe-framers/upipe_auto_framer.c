@@ -28,6 +28,7 @@
 #include <upipe/uprobe_prefix.h>
 #include <upipe/uref.h>
 #include <upipe/uref_flow.h>
+#include <upipe/uref_block.h>
 #include <upipe/upipe.h>
 #include <upipe/upipe_helper_upipe.h>
 #include <upipe/upipe_helper_void.h>
@@ -47,13 +48,21 @@
 #include <upipe-framers/upipe_dvbsub_framer.h>
 #include <upipe-framers/upipe_opus_framer.h>
 #include <upipe-framers/upipe_s302_framer.h>
+#include <upipe-framers/uref_mpga_flow.h>
 
 #include <stdlib.h>
 #include <stdbool.h>
 #include <stdarg.h>
 #include <string.h>
+#include <stddef.h>
 #include <assert.h>
 
+/** maximum number of octets buffered to probe an ambiguous elementary
+ * stream */
+#define UPIPE_AUTOF_PROBE_SIZE 4096
+/** maximum size of a stream signature */
+#define UPIPE_AUTOF_SIGNATURE_SIZE 5
+
 /** @internal @This is the private context of an autof manager. */
 struct upipe_autof_mgr {
     /** refcount management structure */
@@ -89,6 +98,75 @@ struct upipe_autof_mgr {
 UBASE_FROM_TO(upipe_autof_mgr, upipe_mgr, upipe_mgr, mgr)
 UBASE_FROM_TO(upipe_autof_mgr, urefcount, urefcount, urefcount)
 
+/** @internal @This describes the first octets of an elementary stream. */
+struct upipe_autof_signature {
+    /** offset of the framer manager in the autof manager */
+    size_t mgr_offset;
+    /** flow definition given to the framer */
+    const char *def;
+    /** true if the stream is AAC in LOAS encapsulation */
+    bool loas;
+    /** size of the signature */
+    uint8_t size;
+    /** wanted values */
+    uint8_t filter[UPIPE_AUTOF_SIGNATURE_SIZE];
+    /** mask of the bits to check */
+    uint8_t mask[UPIPE_AUTOF_SIGNATURE_SIZE];
+};
+
+/** @hidden */
+#define UPIPE_AUTOF_STREAM(name, def, loas, size, filter, mask)             \
+    { offsetof(struct upipe_autof_mgr, name##_mgr), def, loas, size,        \
+      filter, mask }
+/** @hidden */
+#define UPIPE_AUTOF_OCTETS(...) { __VA_ARGS__ }
+
+/** @internal @This is the table of stream signatures, in order of
+ * precedence. */
+static const struct upipe_autof_signature upipe_autof_signatures[] = {
+    /* MPEG-1/2 video sequence header */
+    UPIPE_AUTOF_STREAM(mpgvf, "block.mpeg2video.pic.", false, 4,
+                       UPIPE_AUTOF_OCTETS(0x00, 0x00, 0x01, 0xb3),
+                       UPIPE_AUTOF_OCTETS(0xff, 0xff, 0xff, 0xff)),
+    /* H.264 SPS and AUD */
+    UPIPE_AUTOF_STREAM(h264f, "block.h264.pic.", false, 4,
+                       UPIPE_AUTOF_OCTETS(0x00, 0x00, 0x01, 0x07),
+                       UPIPE_AUTOF_OCTETS(0xff, 0xff, 0xff, 0x9f)),
+    UPIPE_AUTOF_STREAM(h264f, "block.h264.pic.", false, 4,
+                       UPIPE_AUTOF_OCTETS(0x00, 0x00, 0x01, 0x09),
+                       UPIPE_AUTOF_OCTETS(0xff, 0xff, 0xff, 0x9f)),
+    /* H.265 VPS and AUD */
+    UPIPE_AUTOF_STREAM(h265f, "block.hevc.pic.", false, 5,
+                       UPIPE_AUTOF_OCTETS(0x00, 0x00, 0x01, 0x40, 0x01),
+                       UPIPE_AUTOF_OCTETS(0xff, 0xff, 0xff, 0xff, 0xff)),
+    UPIPE_AUTOF_STREAM(h265f, "block.hevc.pic.", false, 5,
+                       UPIPE_AUTOF_OCTETS(0x00, 0x00, 0x01, 0x46, 0x01),
+                       UPIPE_AUTOF_OCTETS(0xff, 0xff, 0xff, 0xff, 0xff)),
+    /* ADTS, which would otherwise look like MPEG audio layer 0 */
+    UPIPE_AUTOF_STREAM(mpgaf, "block.aac.sound.", false, 2,
+                       UPIPE_AUTOF_OCTETS(0xff, 0xf0),
+                       UPIPE_AUTOF_OCTETS(0xff, 0xf6)),
+    /* MPEG audio */
+    UPIPE_AUTOF_STREAM(mpgaf, "block.mp2.sound.", false, 2,
+                       UPIPE_AUTOF_OCTETS(0xff, 0xe0),
+                       UPIPE_AUTOF_OCTETS(0xff, 0xe0)),
+    /* LOAS */
+    UPIPE_AUTOF_STREAM(mpgaf, "block.aac_latm.sound.", true, 2,
+                       UPIPE_AUTOF_OCTETS(0x56, 0xe0),
+                       UPIPE_AUTOF_OCTETS(0xff, 0xe0)),
+    /* A/52 and enhanced A/52 */
+    UPIPE_AUTOF_STREAM(a52f, "block.ac3.sound.", false, 2,
+                       UPIPE_AUTOF_OCTETS(0x0b, 0x77),
+                       UPIPE_AUTOF_OCTETS(0xff, 0xff)),
+    /* Opus control header */
+    UPIPE_AUTOF_STREAM(opusf, "block.opus.sound.", false, 2,
+                       UPIPE_AUTOF_OCTETS(0x7f, 0xe0),
+                       UPIPE_AUTOF_OCTETS(0xff, 0xe0)),
+};
+
+#undef UPIPE_AUTOF_OCTETS
+#undef UPIPE_AUTOF_STREAM
+
 /** @internal @This is the private context of an autof pipe. */
 struct upipe_autof {
     /** real refcount management structure */
@@ -99,6 +177,19 @@ struct upipe_autof {
     /** input flow def */
     struct uref *flow_def;
 
+    /** true while probing an ambiguous elementary stream */
+    bool probing;
+    /** urefs retained while probing */
+    struct uchain urefs;
+    /** first octets of the elementary stream */
+    uint8_t probe[UPIPE_AUTOF_PROBE_SIZE];
+    /** number of octets in the probe buffer */
+    size_t probe_size;
+    /** next offset to check in the probe buffer */
+    size_t probe_offset;
+    /** signature found by the probe, or NULL */
+    const struct upipe_autof_signature *signature;
+
     /** probe for the last inner pipe */
     struct uprobe last_inner_probe;
 
@@ -155,6 +246,11 @@ static struct upipe *upipe_autof_alloc(struct upipe_mgr *mgr,
     upipe_autof_init_bin_input(upipe);
     upipe_autof_init_bin_output(upipe);
     upipe_autof->flow_def = NULL;
+    upipe_autof->probing = false;
+    ulist_init(&upipe_autof->urefs);
+    upipe_autof->probe_size = 0;
+    upipe_autof->probe_offset = 0;
+    upipe_autof->signature = NULL;
     upipe_throw_ready(upipe);
     return upipe;
 }
@@ -247,7 +343,206 @@ static struct upipe *upipe_autof_alloc_framer(struct upipe *upipe,
                 UPROBE_LOG_VERBOSE, "idem"));
 }
 
-/** @internal @This sets the input flow definition.
+/** @internal @This returns the flow definition to give to the framer,
+ * completed with the result of the probe if any.
+ *
+ * @param upipe description structure of the pipe
+ * @param flow_def input flow definition packet
+ * @return pointer to the flow definition, or NULL in case of error
+ */
+static struct uref *upipe_autof_inner_flow_def(struct upipe *upipe,
+                                               struct uref *flow_def)
+{
+    struct upipe_autof *upipe_autof = upipe_autof_from_upipe(upipe);
+    const struct upipe_autof_signature *signature = upipe_autof->signature;
+    struct uref *inner_flow_def = uref_dup(flow_def);
+    if (unlikely(inner_flow_def == NULL) || signature == NULL)
+        return inner_flow_def;
+
+    if (unlikely(!ubase_check(uref_flow_set_def(inner_flow_def,
+                                                signature->def)) ||
+                 (signature->loas &&
+                  !ubase_check(uref_mpga_flow_set_encaps(inner_flow_def,
+                          UREF_MPGA_ENCAPS_LOAS))))) {
+        uref_free(inner_flow_def);
+        return NULL;
+    }
+    return inner_flow_def;
+}
+
+/** @internal @This allocates the framer and sets its flow definition.
+ *
+ * @param upipe description structure of the pipe
+ * @param def flow definition string used to choose the framer
+ * @return an error code
+ */
+static int upipe_autof_spawn(struct upipe *upipe, const char *def)
+{
+    struct upipe_autof *upipe_autof = upipe_autof_from_upipe(upipe);
+    struct upipe *inner = upipe_autof_alloc_framer(upipe, def);
+    if (unlikely(inner == NULL)) {
+        upipe_err_va(upipe, "couldn't allocate framer");
+        return UBASE_ERR_ALLOC;
+    }
+
+    struct uref *flow_def = upipe_autof_inner_flow_def(upipe,
+                                                       upipe_autof->flow_def);
+    if (unlikely(flow_def == NULL)) {
+        upipe_release(inner);
+        return UBASE_ERR_ALLOC;
+    }
+    int err = upipe_set_flow_def(inner, flow_def);
+    uref_free(flow_def);
+    if (unlikely(!ubase_check(err))) {
+        upipe_err_va(upipe, "couldn't set inner flow def");
+        upipe_release(inner);
+        return UBASE_ERR_UNHANDLED;
+    }
+
+    upipe_autof_store_bin_input(upipe, upipe_use(inner));
+    upipe_autof_store_bin_output(upipe, inner);
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This frees the urefs retained while probing.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_autof_clean_probe(struct upipe *upipe)
+{
+    struct upipe_autof *upipe_autof = upipe_autof_from_upipe(upipe);
+    struct uchain *uchain, *uchain_tmp;
+    ulist_delete_foreach(&upipe_autof->urefs, uchain, uchain_tmp) {
+        ulist_delete(uchain);
+        uref_free(uref_from_uchain(uchain));
+    }
+    upipe_autof->probing = false;
+    upipe_autof->probe_size = 0;
+    upipe_autof->probe_offset = 0;
+}
+
+/** @internal @This looks for a known signature in the probe buffer,
+ * starting from the first offset which was not checked yet.
+ *
+ * @param upipe description structure of the pipe
+ * @param last true if the probe buffer will not grow anymore
+ * @return pointer to the signature, or NULL if none was found
+ */
+static const struct upipe_autof_signature *
+    upipe_autof_scan(struct upipe *upipe, bool last)
+{
+    struct upipe_autof_mgr *autof_mgr =
+        upipe_autof_mgr_from_upipe_mgr(upipe->mgr);
+    struct upipe_autof *upipe_autof = upipe_autof_from_upipe(upipe);
+    const uint8_t *probe = upipe_autof->probe;
+    size_t probe_size = upipe_autof->probe_size;
+    size_t offset = upipe_autof->probe_offset;
+
+    /* offsets near the end are only checked when all signatures fit,
+     * unless the buffer is final */
+    for ( ; offset < probe_size &&
+            (last || offset + UPIPE_AUTOF_SIGNATURE_SIZE <= probe_size);
+          offset++) {
+        /* all signatures begin with 0x00, 0x0b, 0x56, 0x7f or 0xff */
+        if (probe[offset] != 0x00 && probe[offset] != 0x0b &&
+            probe[offset] != 0x56 && probe[offset] != 0x7f &&
+            probe[offset] != 0xff)
+            continue;
+
+        for (unsigned i = 0; i < UBASE_ARRAY_SIZE(upipe_autof_signatures); i++) {
+            const struct upipe_autof_signature *signature =
+                &upipe_autof_signatures[i];
+            if (offset + signature->size > probe_size)
+                continue;
+            struct upipe_mgr *framer_mgr = *(struct upipe_mgr **)
+                ((uint8_t *)autof_mgr + signature->mgr_offset);
+            if (framer_mgr == NULL)
+                continue;
+
+            unsigned j;
+            for (j = 0; j < signature->size; j++)
+                if ((probe[offset + j] & signature->mask[j]) !=
+                    signature->filter[j])
+                    break;
+            if (j == signature->size) {
+                upipe_autof->probe_offset = offset;
+                return signature;
+            }
+        }
+    }
+    upipe_autof->probe_offset = offset;
+    return NULL;
+}
+
+/** @internal @This ends the probe, allocates the framer and outputs the
+ * retained urefs.
+ *
+ * @param upipe description structure of the pipe
+ * @param signature signature found by the probe, or NULL
+ * @param upump_p reference to pump that generated the buffer
+ */
+static void upipe_autof_end_probe(struct upipe *upipe,
+                                  const struct upipe_autof_signature *signature,
+                                  struct upump **upump_p)
+{
+    struct upipe_autof *upipe_autof = upipe_autof_from_upipe(upipe);
+    upipe_autof->probing = false;
+    upipe_autof->signature = signature;
+    if (signature != NULL)
+        upipe_dbg_va(upipe, "probed %s at offset %zu", signature->def,
+                     upipe_autof->probe_offset);
+
+    if (unlikely(!ubase_check(upipe_autof_spawn(upipe,
+                        signature != NULL ? signature->def : "block.")))) {
+        upipe_autof_clean_probe(upipe);
+        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+        return;
+    }
+
+    struct uchain *uchain;
+    while ((uchain = ulist_pop(&upipe_autof->urefs)) != NULL)
+        upipe_autof_bin_input(upipe, uref_from_uchain(uchain), upump_p);
+    upipe_autof_clean_probe(upipe);
+}
+
+/** @internal @This receives data.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref uref structure
+ * @param upump_p reference to pump that generated the buffer
+ */
+static void upipe_autof_input(struct upipe *upipe, struct uref *uref,
+                              struct upump **upump_p)
+{
+    struct upipe_autof *upipe_autof = upipe_autof_from_upipe(upipe);
+    if (likely(!upipe_autof->probing)) {
+        upipe_autof_bin_input(upipe, uref, upump_p);
+        return;
+    }
+
+    size_t size = 0;
+    uref_block_size(uref, &size);
+    size_t extract = UPIPE_AUTOF_PROBE_SIZE - upipe_autof->probe_size;
+    if (extract > size)
+        extract = size;
+    if (extract && unlikely(!ubase_check(uref_block_extract(uref, 0, extract,
+                    upipe_autof->probe + upipe_autof->probe_size)))) {
+        upipe_warn(upipe, "couldn't read probed buffer");
+        extract = 0;
+    }
+    upipe_autof->probe_size += extract;
+    ulist_add(&upipe_autof->urefs, uref_to_uchain(uref));
+
+    bool last = upipe_autof->probe_size >= UPIPE_AUTOF_PROBE_SIZE;
+    const struct upipe_autof_signature *signature =
+        upipe_autof_scan(upipe, last);
+    if (signature != NULL || last)
+        upipe_autof_end_probe(upipe, signature, upump_p);
+}
+
+/** @internal @This sets the input flow definition. A flow definition
+ * without elementary stream type ("block.") triggers a probe of the first
+ * octets of the stream before a framer is allocated.
  *
  * @param upipe description structure of the pipe
  * @param flow_def flow definition packet
@@ -266,30 +561,35 @@ static int upipe_autof_set_flow_def(struct upipe *upipe, struct uref *flow_def)
         !uref_flow_cmp_def(upipe_autof->flow_def, flow_def)) {
         uref_free(upipe_autof->flow_def);
         upipe_autof->flow_def = uref_dup(flow_def);
-        return upipe_set_flow_def(upipe_autof->first_inner, flow_def);
+        if (unlikely(upipe_autof->flow_def == NULL))
+            return UBASE_ERR_ALLOC;
+        struct uref *inner_flow_def =
+            upipe_autof_inner_flow_def(upipe, flow_def);
+        if (unlikely(inner_flow_def == NULL))
+            return UBASE_ERR_ALLOC;
+        int err = upipe_set_flow_def(upipe_autof->first_inner,
+                                     inner_flow_def);
+        uref_free(inner_flow_def);
+        return err;
     }
 
     if (upipe_autof->flow_def != NULL)
         upipe_dbg_va(upipe, "respawning framer %s", def);
     uref_free(upipe_autof->flow_def);
     upipe_autof->flow_def = uref_dup(flow_def);
+    if (unlikely(upipe_autof->flow_def == NULL))
+        return UBASE_ERR_ALLOC;
     upipe_autof_store_bin_input(upipe, NULL);
     upipe_autof_store_bin_output(upipe, NULL);
+    upipe_autof_clean_probe(upipe);
+    upipe_autof->signature = NULL;
 
-    struct upipe *inner = upipe_autof_alloc_framer(upipe, def);
-    if (unlikely(inner == NULL)) {
-        upipe_err_va(upipe, "couldn't allocate framer");
-        return UBASE_ERR_ALLOC;
+    if (!strcmp(def, "block.") &&
+        !ubase_check(uref_flow_get_global(flow_def))) {
+        upipe_autof->probing = true;
+        return UBASE_ERR_NONE;
     }
-    if (unlikely(!ubase_check(upipe_set_flow_def(inner, flow_def)))) {
-        upipe_err_va(upipe, "couldn't set inner flow def");
-        upipe_release(inner);
-        return UBASE_ERR_UNHANDLED;
-    }
-
-    upipe_autof_store_bin_input(upipe, upipe_use(inner));
-    upipe_autof_store_bin_output(upipe, inner);
-    return UBASE_ERR_NONE;
+    return upipe_autof_spawn(upipe, def);
 }
 
 /** @internal @This processes control commands on a autof pipe.
@@ -328,6 +628,7 @@ static void upipe_autof_free(struct urefcount *urefcount_real)
     struct upipe *upipe = upipe_autof_to_upipe(upipe_autof);
     upipe_throw_dead(upipe);
     uref_free(upipe_autof->flow_def);
+    upipe_autof_clean_probe(upipe);
     upipe_autof_clean_last_inner_probe(upipe);
     urefcount_clean(urefcount_real);
     upipe_autof_clean_urefcount(upipe);
@@ -443,7 +744,7 @@ struct upipe_mgr *upipe_autof_mgr_alloc(void)
     autof_mgr->mgr.refcount = upipe_autof_mgr_to_urefcount(autof_mgr);
     autof_mgr->mgr.signature = UPIPE_AUTOF_SIGNATURE;
     autof_mgr->mgr.upipe_alloc = upipe_autof_alloc;
-    autof_mgr->mgr.upipe_input = upipe_autof_bin_input;
+    autof_mgr->mgr.upipe_input = upipe_autof_input;
     autof_mgr->mgr.upipe_control = upipe_autof_control;
     autof_mgr->mgr.upipe_mgr_control = upipe_autof_mgr_control;
     return upipe_autof_mgr_to_upipe_mgr(autof_mgr);
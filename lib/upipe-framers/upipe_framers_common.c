@@ -28,6 +28,44 @@
 
 #include <upipe-framers/upipe_framers_common.h>
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+/** size of the vectors used to skip octets without start codes */
+#define UPIPE_FRAMERS_SCAN_VECTOR 32
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define UPIPE_FRAMERS_SCAN_VECTOR 16
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define UPIPE_FRAMERS_SCAN_VECTOR 16
+#endif
+
+#ifdef UPIPE_FRAMERS_SCAN_VECTOR
+/** @internal @This returns the position of the first null octet in a vector
+ * of @ref UPIPE_FRAMERS_SCAN_VECTOR octets.
+ *
+ * @param p pointer to the vector (not necessarily aligned)
+ * @return position of the first null octet, or UPIPE_FRAMERS_SCAN_VECTOR
+ * if there is none (the position may be underestimated, for instance 0
+ * when the platform can only tell whether there is a null octet)
+ */
+static inline unsigned int upipe_framers_scan_zero(const uint8_t *p)
+{
+#if defined(__AVX2__)
+    __m256i v = _mm256_loadu_si256((const __m256i *)p);
+    uint32_t mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(v,
+                                            _mm256_setzero_si256()));
+    return mask ? __builtin_ctz(mask) : UPIPE_FRAMERS_SCAN_VECTOR;
+#elif defined(__SSE2__)
+    __m128i v = _mm_loadu_si128((const __m128i *)p);
+    uint32_t mask = _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_setzero_si128()));
+    return mask ? __builtin_ctz(mask) : UPIPE_FRAMERS_SCAN_VECTOR;
+#else
+    return vminvq_u8(vld1q_u8(p)) ? UPIPE_FRAMERS_SCAN_VECTOR : 0;
+#endif
+}
+#endif
+
 /** @This scans for an MPEG-style 3-octet start code in a linear buffer.
  *
  * @param p linear buffer
@@ -49,6 +87,18 @@ const uint8_t *upipe_framers_mpeg_scan(const uint8_t *restrict p,
     }
 
     while (p < end) {
+#ifdef UPIPE_FRAMERS_SCAN_VECTOR
+        /* A start code ending at p + k needs null octets at p + k - 2 and
+         * p + k - 1, so none can end before the second octet following the
+         * first null octet of [p - 1, p - 1 + VECTOR[. */
+        if (p[-1] > 1 && end - p >= UPIPE_FRAMERS_SCAN_VECTOR - 1) {
+            unsigned int zero = upipe_framers_scan_zero(p - 1);
+            if (zero) {
+                p += zero + 2;
+                continue;
+            }
+        }
+#endif
         if      (p[-1] > 1      ) p += 3;
         else if (p[-2]          ) p += 2;
         else if (p[-3]|(p[-1]-1)) p++;
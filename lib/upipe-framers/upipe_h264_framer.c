@@ -804,20 +804,14 @@ static bool upipe_h264f_activate_sps(struct upipe *upipe, uint32_t sps_id)
         bool timing_present = !!ubuf_block_stream_show_bits(s, 1);
         ubuf_block_stream_skip_bits(s, 1);
         if (timing_present) {
-            upipe_h26xf_stream_fill_bits(s, 24);
-            uint32_t num_units_in_ticks =
-                ubuf_block_stream_show_bits(s, 24) << 8;
-            ubuf_block_stream_skip_bits(s, 24);
-
-            upipe_h26xf_stream_fill_bits(s, 24);
-            num_units_in_ticks |= ubuf_block_stream_show_bits(s, 8);
-            ubuf_block_stream_skip_bits(s, 8);
-            uint32_t time_scale = ubuf_block_stream_show_bits(s, 16) << 16;
-            ubuf_block_stream_skip_bits(s, 16);
+            upipe_h26xf_stream_fill_bits(s, 32);
+            uint32_t num_units_in_ticks = ubuf_block_stream_show_bits(s, 32);
+            ubuf_block_stream_skip_bits(s, 32);
+            upipe_h26xf_stream_fill_bits(s, 32);
+            uint32_t time_scale = ubuf_block_stream_show_bits(s, 32);
+            ubuf_block_stream_skip_bits(s, 32);
 
-            upipe_h26xf_stream_fill_bits(s, 17);
-            time_scale |= ubuf_block_stream_show_bits(s, 16);
-            ubuf_block_stream_skip_bits(s, 16);
+            upipe_h26xf_stream_fill_bits(s, 1);
 
             bool fixed_frame_rate = ubuf_block_stream_show_bits(s, 1);
             ubuf_block_stream_skip_bits(s, 1);
@@ -1054,6 +1048,15 @@ static bool upipe_h264f_activate_sps(struct upipe *upipe, uint32_t sps_id)
     upipe_h264f->active_sps = sps_id;
     ubuf_block_stream_clean(s);
 
+    if (upipe_h264f->flow_def_requested != NULL &&
+        !ubase_check(uref_flow_get_global(upipe_h264f->flow_def_requested)) &&
+        upipe_h264f_check_flow_def_attr(upipe, flow_def)) {
+        /* same parameters and no global headers to rebuild, keep the
+         * negotiated flow definition */
+        uref_free(flow_def);
+        return true;
+    }
+
     upipe_h264f_store_flow_def(upipe, NULL);
     uref_free(upipe_h264f->flow_def_requested);
     upipe_h264f->flow_def_requested = NULL;
@@ -1925,38 +1928,6 @@ static int upipe_h264f_prepare_au(struct upipe *upipe, struct uref *uref)
     return UBASE_ERR_NONE;
 }
 
-/** @internal @This finds a NAL in an annex B uref.
- *
- * @param upipe description structure of the pipe
- * @param uref pointer to uref
- * @param nal_type type of NAL
- * @return offset of the NAL, or -1 if not found
- */
-static int64_t upipe_h264f_find_annexb_nal(struct upipe *upipe,
-                                           struct uref *uref, uint8_t nal_type)
-{
-    uint64_t nal_units = 0;
-    uint64_t nal_offset = 0;
-    uint64_t nal_size = 0;
-    while (ubase_check(uref_h26x_iterate_nal(uref, &nal_units,
-                                             &nal_offset, &nal_size, 0))) {
-        uint8_t startcode[5];
-
-        if (!ubase_check(uref_block_extract(uref, nal_offset, 5, startcode)))
-            return -1;
-
-        uint8_t nal;
-        if (startcode[2] == 1)
-            nal = h264nalst_get_type(startcode[3]);
-        else
-            nal = h264nalst_get_type(startcode[4]);
-        if (nal == nal_type)
-            return nal_offset;
-    }
-
-    return -1;
-}
-
 /** @internal @This outputs an access unit.
  *
  * @param upipe description structure of the pipe
@@ -1977,13 +1948,22 @@ static void upipe_h264f_output_au(struct upipe *upipe, struct uref *uref,
         return;
     }
 
+    /* index the NAL types once for us and for the downstream pipes */
+    uint64_t nal_types = 0;
+    bool indexed = ubase_check(upipe_h26xf_nal_types(uref,
+                upipe_h264f->encaps_output, h264nalst_get_type, &nal_types));
+    if (unlikely(!indexed))
+        upipe_warn(upipe, "unable to index NAL units");
+
     if (upipe_h264f->encaps_output != UREF_H26X_ENCAPS_ANNEXB) {
+        if (indexed)
+            uref_h26x_set_nal_types(uref, nal_types);
         upipe_h264f_output(upipe, uref, upump_p);
         return;
     }
 
     if (ubase_check(uref_pic_get_key(uref)) &&
-        upipe_h264f_find_annexb_nal(upipe, uref, H264NAL_TYPE_SPS) == -1) {
+        !(nal_types & (UINT64_C(1) << H264NAL_TYPE_SPS))) {
         upipe_verbose(upipe, "prepending SPS and PPS on keyframe");
 
         struct ubuf *ubuf = ubuf_dup(upipe_h264f->annexb_header);
@@ -2014,9 +1994,11 @@ static void upipe_h264f_output_au(struct upipe *upipe, struct uref *uref,
         err = uref_h26x_prepend_nal(uref, ubuf);
         if (unlikely(!ubase_check(err)))
             upipe_throw_error(upipe, err);
+        nal_types |= (UINT64_C(1) << H264NAL_TYPE_SPS) |
+                     (UINT64_C(1) << H264NAL_TYPE_PPS);
     }
 
-    if (upipe_h264f_find_annexb_nal(upipe, uref, H264NAL_TYPE_AUD) == -1) {
+    if (!(nal_types & (UINT64_C(1) << H264NAL_TYPE_AUD))) {
         upipe_verbose(upipe, "prepending AUD");
         struct ubuf *ubuf = ubuf_dup(upipe_h264f->annexb_aud);
         if (unlikely(ubuf == NULL)) {
@@ -2027,8 +2009,11 @@ static void upipe_h264f_output_au(struct upipe *upipe, struct uref *uref,
         int err = uref_h26x_prepend_nal(uref, ubuf);
         if (unlikely(!ubase_check(err)))
             upipe_throw_error(upipe, err);
+        nal_types |= UINT64_C(1) << H264NAL_TYPE_AUD;
     }
 
+    if (indexed)
+        uref_h26x_set_nal_types(uref, nal_types);
     upipe_h264f_output(upipe, uref, upump_p);
 }
 
@@ -2661,6 +2646,11 @@ static bool upipe_h264f_handle(struct upipe *upipe, struct uref *uref,
     struct upipe_h264f *upipe_h264f = upipe_h264f_from_upipe(upipe);
     const char *def;
     if (unlikely(ubase_check(uref_flow_get_def(uref, &def)))) {
+        if (upipe_h264f_check_flow_def_input(upipe, uref)) {
+            /* same flow definition, keep the current state */
+            uref_free(uref);
+            return true;
+        }
         upipe_h264f->input_latency = 0;
         uref_clock_get_latency(uref, &upipe_h264f->input_latency);
         upipe_h264f->encaps_input = uref_h26x_flow_infer_encaps(uref);
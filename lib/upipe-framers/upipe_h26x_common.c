@@ -106,20 +106,9 @@ uint32_t upipe_h26xf_stream_ue(struct ubuf_block_stream *s)
         ubuf_block_stream_skip_bits(s, 1);
     }
 
-    if (likely(i <= 24)) {
-        upipe_h26xf_stream_fill_bits(s, i);
-        uint32_t result = ubuf_block_stream_show_bits(s, i);
-        ubuf_block_stream_skip_bits(s, i);
-        return result - 1;
-    }
-
-    upipe_h26xf_stream_fill_bits(s, 8);
-    uint32_t result = ubuf_block_stream_show_bits(s, 8);
-    ubuf_block_stream_skip_bits(s, 8);
-    i -= 8;
-    result <<= i;
+    /* the 64-bit cache holds the whole code */
     upipe_h26xf_stream_fill_bits(s, i);
-    result += ubuf_block_stream_show_bits(s, i);
+    uint32_t result = ubuf_block_stream_show_bits(s, i);
     ubuf_block_stream_skip_bits(s, i);
     return result - 1;
 }
@@ -315,3 +304,60 @@ int upipe_h26xf_convert_frame(struct uref *uref,
 
     return UBASE_ERR_NONE;
 }
+
+/** @This computes in one pass over the NAL offsets the bitmask of the types
+ * of the NAL units of a frame.
+ *
+ * @param uref pointer to uref
+ * @param encaps H26x encapsulation of the frame
+ * @param get_type function returning the type of a NAL unit from its first
+ * octet
+ * @param nal_types_p filled in with the bitmask of NAL unit types
+ * @return an error code
+ */
+int upipe_h26xf_nal_types(struct uref *uref, enum uref_h26x_encaps encaps,
+                          uint8_t (*get_type)(uint8_t),
+                          uint64_t *nal_types_p)
+{
+    unsigned int encaps_size;
+    switch (encaps) {
+        case UREF_H26X_ENCAPS_NALU:
+        case UREF_H26X_ENCAPS_ANNEXB:
+            encaps_size = 0;
+            break;
+        case UREF_H26X_ENCAPS_LENGTH1:
+            encaps_size = 1;
+            break;
+        case UREF_H26X_ENCAPS_LENGTH2:
+            encaps_size = 2;
+            break;
+        default:
+        case UREF_H26X_ENCAPS_LENGTH4:
+            encaps_size = 4;
+            break;
+    }
+
+    uint64_t nal_types = 0;
+    uint64_t nal_units = 0;
+    uint64_t nal_offset = 0;
+    uint64_t nal_size = 0;
+    while (ubase_check(uref_h26x_iterate_nal(uref, &nal_units,
+                                             &nal_offset, &nal_size, 0))) {
+        uint8_t header[5];
+        uint64_t header_size = encaps == UREF_H26X_ENCAPS_ANNEXB ? 5 :
+                               encaps_size + 1;
+        if (header_size > nal_size)
+            header_size = nal_size;
+        UBASE_RETURN(uref_block_extract(uref, nal_offset, header_size, header))
+
+        unsigned int offset = encaps_size;
+        if (encaps == UREF_H26X_ENCAPS_ANNEXB)
+            offset = header_size > 3 && header[2] == 1 ? 3 : 4;
+        if (unlikely(offset >= header_size))
+            return UBASE_ERR_INVALID;
+        nal_types |= UINT64_C(1) << get_type(header[offset]);
+    }
+
+    *nal_types_p = nal_types;
+    return UBASE_ERR_NONE;
+}
@@ -679,6 +679,15 @@ static bool upipe_mpgvf_parse_sequence(struct upipe *upipe)
                     matrix_coefficients_str))
     }
 
+    if (upipe_mpgvf->flow_def_requested != NULL &&
+        !ubase_check(uref_flow_get_global(upipe_mpgvf->flow_def_requested)) &&
+        upipe_mpgvf_check_flow_def_attr(upipe, flow_def)) {
+        /* same parameters and no global headers to rebuild, keep the
+         * negotiated flow definition */
+        uref_free(flow_def);
+        return true;
+    }
+
     upipe_mpgvf_store_flow_def(upipe, NULL);
     uref_free(upipe_mpgvf->flow_def_requested);
     upipe_mpgvf->flow_def_requested = NULL;
@@ -1486,6 +1495,11 @@ static bool upipe_mpgvf_handle(struct upipe *upipe, struct uref *uref,
     struct upipe_mpgvf *upipe_mpgvf = upipe_mpgvf_from_upipe(upipe);
     const char *def;
     if (unlikely(ubase_check(uref_flow_get_def(uref, &def)))) {
+        if (upipe_mpgvf_check_flow_def_input(upipe, uref)) {
+            /* same flow definition, keep the current state */
+            uref_free(uref);
+            return true;
+        }
         upipe_mpgvf->input_latency = 0;
         uref_clock_get_latency(uref, &upipe_mpgvf->input_latency);
         upipe_mpgvf->complete_input = ubase_check(uref_flow_get_complete(uref));
@@ -187,7 +187,7 @@ static bool upipe_opusf_scan(struct upipe *upipe, size_t *dropped_p)
 
         if ((header & 0xe0) == 0xe0)
             return true;
-        (*dropped_p) += 2;
+        (*dropped_p)++;
     }
     return false;
 }
@@ -218,7 +218,7 @@ static bool upipe_opusf_check_frame(struct upipe *upipe, bool *ready_p)
         }
         return true;
     }
-    if (header[0] != 0x70 && (header[1] & 0xe0) != 0xe0) {
+    if (header[0] != 0x7f || (header[1] & 0xe0) != 0xe0) {
         return false;
     }
 
@@ -250,6 +250,10 @@ static bool upipe_opusf_parse_header(struct upipe *upipe)
     /* frame size */
     upipe_opusf->next_frame_size = frame_size;
 
+    if (likely(upipe_opusf->acquired && upipe_opusf->flow_def_attr != NULL))
+        /* the flow definition only changes on resync */
+        return true;
+
     uint64_t octetrate = frame_size * 50; // FIXME inaccurate
     upipe_opusf->samplerate = 48000;
 
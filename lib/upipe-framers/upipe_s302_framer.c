@@ -81,6 +81,8 @@ struct upipe_s302f {
     struct urational fps;
     /** currently detected octet rate */
     uint64_t octetrate;
+    /** currently detected number of channels */
+    uint8_t num_channels;
 
     /** next uref to be processed */
     struct uref *next_uref;
@@ -127,6 +129,7 @@ static struct upipe *upipe_s302f_alloc(struct upipe_mgr *mgr,
     upipe_s302f_init_output(upipe);
     upipe_s302f_init_flow_def(upipe);
     upipe_s302f->octetrate = 0;
+    upipe_s302f->num_channels = 0;
     upipe_s302f->next_uref = NULL;
     upipe_s302f->next_uref_size = 0;
     uref_init(&upipe_s302f->au_uref_s);
@@ -134,6 +137,39 @@ static struct upipe *upipe_s302f_alloc(struct upipe_mgr *mgr,
     return upipe;
 }
 
+/** @internal @This builds the flow definition attributes from the detected
+ * parameters.
+ *
+ * @param upipe description structure of the pipe
+ * @return false in case of allocation error
+ */
+static bool upipe_s302f_build_flow_def(struct upipe *upipe)
+{
+    struct upipe_s302f *upipe_s302f = upipe_s302f_from_upipe(upipe);
+    struct uref *flow_def = upipe_s302f_alloc_flow_def_attr(upipe);
+    if (unlikely(flow_def == NULL)) {
+        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+        return false;
+    }
+
+    UBASE_FATAL(upipe, uref_flow_set_complete(flow_def))
+    UBASE_FATAL(upipe, uref_flow_set_def(flow_def, "block.s302m.sound."))
+    UBASE_FATAL(upipe, uref_block_flow_set_octetrate(flow_def,
+                            upipe_s302f->octetrate))
+    UBASE_FATAL(upipe, uref_sound_flow_set_rate(flow_def,
+                            S302_FREQUENCY))
+    UBASE_FATAL(upipe, uref_sound_flow_set_channels(flow_def,
+                            upipe_s302f->num_channels))
+
+    flow_def = upipe_s302f_store_flow_def_attr(upipe, flow_def);
+    if (unlikely(flow_def == NULL)) {
+        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+        return false;
+    }
+    upipe_s302f_store_flow_def(upipe, flow_def);
+    return true;
+}
+
 /** @internal @This works on a s302 frame and outputs it.
  *
  * @param upipe description structure of the pipe
@@ -177,34 +213,22 @@ static void upipe_s302f_work(struct upipe *upipe, struct upump **upump_p)
     octetrate = (uint64_t)S302_FREQUENCY * audio_packet_size / num_samples;
 
     /* Avoid jitter on NTSC patterns */
+    bool changed = upipe_s302f->flow_def_attr == NULL ||
+                   upipe_s302f->num_channels != num_channels;
     if ((octetrate > upipe_s302f->octetrate + 500) ||
         (octetrate < upipe_s302f->octetrate - 500)) {
         upipe_s302f->octetrate = octetrate;
+        changed = true;
     }
 
-    struct uref *flow_def = upipe_s302f_alloc_flow_def_attr(upipe);
-    if (unlikely(flow_def == NULL)) {
-        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
-        uref_free(upipe_s302f->next_uref);
-        goto upipe_s302f_work_err;
-    }
-
-    UBASE_FATAL(upipe, uref_flow_set_complete(flow_def))
-    UBASE_FATAL(upipe, uref_flow_set_def(flow_def, "block.s302m.sound."))
-    UBASE_FATAL(upipe, uref_block_flow_set_octetrate(flow_def,
-                            upipe_s302f->octetrate))
-    UBASE_FATAL(upipe, uref_sound_flow_set_rate(flow_def,
-                            S302_FREQUENCY))
-    UBASE_FATAL(upipe, uref_sound_flow_set_channels(flow_def,
-                            num_channels))
-
-    flow_def = upipe_s302f_store_flow_def_attr(upipe, flow_def);
-    if (unlikely(flow_def == NULL)) {
-        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
-        uref_free(upipe_s302f->next_uref);
-        goto upipe_s302f_work_err;
+    /* only rebuild the flow definition when the parameters change */
+    if (unlikely(changed)) {
+        upipe_s302f->num_channels = num_channels;
+        if (unlikely(!upipe_s302f_build_flow_def(upipe))) {
+            uref_free(upipe_s302f->next_uref);
+            goto upipe_s302f_work_err;
+        }
     }
-    upipe_s302f_store_flow_def(upipe, flow_def);
     upipe_s302f_sync_acquired(upipe);
 
     uint64_t duration = num_samples * UCLOCK_FREQ / S302_FREQUENCY;
@@ -48,6 +48,27 @@
 
 #include <bitstream/smpte/337.h>
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+/** number of stereo samples checked at once for the s337m sync word */
+#define UPIPE_S337F_SYNC_VECTOR 4
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define UPIPE_S337F_SYNC_VECTOR 2
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define UPIPE_S337F_SYNC_VECTOR 2
+#endif
+
+/** Pa preamble in 20-bit mode, left-justified in s32 */
+#define UPIPE_S337F_PA20 UINT32_C(0x6f872000)
+/** Pb preamble in 20-bit mode, left-justified in s32 */
+#define UPIPE_S337F_PB20 UINT32_C(0x54e1f000)
+/** Pa preamble in 24-bit mode, left-justified in s32 */
+#define UPIPE_S337F_PA24 UINT32_C(0x96f87200)
+/** Pb preamble in 24-bit mode, left-justified in s32 */
+#define UPIPE_S337F_PB24 UINT32_C(0xa54e1f00)
+
 /** upipe_s337f structure */
 struct upipe_s337f {
     /** refcount management structure */
@@ -108,26 +129,95 @@ static struct upipe *upipe_s337f_alloc(struct upipe_mgr *mgr,
     return upipe;
 }
 
+#ifdef UPIPE_S337F_SYNC_VECTOR
+/** @internal @This returns the position of the first stereo sample holding
+ * the s337m sync word in a vector of @ref UPIPE_S337F_SYNC_VECTOR
+ * interleaved stereo samples.
+ *
+ * @param p pointer to the vector (not necessarily aligned)
+ * @return position of the sync word, or UPIPE_S337F_SYNC_VECTOR if there
+ * is none
+ */
+static inline unsigned int upipe_s337f_sync_vector(const int32_t *p)
+{
+#if defined(__AVX2__)
+    __m256i v = _mm256_loadu_si256((const __m256i *)p);
+    __m256i m20 = _mm256_cmpeq_epi32(v, _mm256_set_epi32(
+                UPIPE_S337F_PB20, UPIPE_S337F_PA20,
+                UPIPE_S337F_PB20, UPIPE_S337F_PA20,
+                UPIPE_S337F_PB20, UPIPE_S337F_PA20,
+                UPIPE_S337F_PB20, UPIPE_S337F_PA20));
+    __m256i m24 = _mm256_cmpeq_epi32(v, _mm256_set_epi32(
+                UPIPE_S337F_PB24, UPIPE_S337F_PA24,
+                UPIPE_S337F_PB24, UPIPE_S337F_PA24,
+                UPIPE_S337F_PB24, UPIPE_S337F_PA24,
+                UPIPE_S337F_PB24, UPIPE_S337F_PA24));
+    uint32_t mask20 = _mm256_movemask_ps(_mm256_castsi256_ps(m20));
+    uint32_t mask24 = _mm256_movemask_ps(_mm256_castsi256_ps(m24));
+#elif defined(__SSE2__)
+    __m128i v = _mm_loadu_si128((const __m128i *)p);
+    __m128i m20 = _mm_cmpeq_epi32(v, _mm_set_epi32(
+                UPIPE_S337F_PB20, UPIPE_S337F_PA20,
+                UPIPE_S337F_PB20, UPIPE_S337F_PA20));
+    __m128i m24 = _mm_cmpeq_epi32(v, _mm_set_epi32(
+                UPIPE_S337F_PB24, UPIPE_S337F_PA24,
+                UPIPE_S337F_PB24, UPIPE_S337F_PA24));
+    uint32_t mask20 = _mm_movemask_ps(_mm_castsi128_ps(m20));
+    uint32_t mask24 = _mm_movemask_ps(_mm_castsi128_ps(m24));
+#else
+    static const uint32_t p20[4] = {
+        UPIPE_S337F_PA20, UPIPE_S337F_PB20, UPIPE_S337F_PA20, UPIPE_S337F_PB20
+    };
+    static const uint32_t p24[4] = {
+        UPIPE_S337F_PA24, UPIPE_S337F_PB24, UPIPE_S337F_PA24, UPIPE_S337F_PB24
+    };
+    static const uint32_t bits[4] = { 1, 2, 4, 8 };
+    uint32x4_t v = vld1q_u32((const uint32_t *)p);
+    uint32_t mask20 = vaddvq_u32(vandq_u32(vceqq_u32(v, vld1q_u32(p20)),
+                                           vld1q_u32(bits)));
+    uint32_t mask24 = vaddvq_u32(vandq_u32(vceqq_u32(v, vld1q_u32(p24)),
+                                           vld1q_u32(bits)));
+#endif
+    /* a sample matches if both Pa (even bit) and Pb (odd bit) match */
+    uint32_t mask = ((mask20 & (mask20 >> 1)) | (mask24 & (mask24 >> 1))) &
+                    0x55;
+    return mask ? __builtin_ctz(mask) / 2 : UPIPE_S337F_SYNC_VECTOR;
+}
+#endif
+
 /** @internal @This finds the position of the s337m sync word in the frame
  */
 static ssize_t upipe_s337f_sync(struct upipe *upipe, struct uref *uref)
 {
-    struct upipe_s337f *upipe_s337f = upipe_s337f_from_upipe(upipe);
-
     size_t size = 0;
     if (!ubase_check(uref_sound_size(uref, &size, NULL))) {
         return -1;
     }
 
     const int32_t *in;
-    uref_sound_read_int32_t(uref, 0, -1, &in, 1);
+    if (!ubase_check(uref_sound_read_int32_t(uref, 0, -1, &in, 1)))
+        return -1;
 
-    for (size_t i = 0; i < size; i++)
-        if ((in[2*i+0] == (0x6f872 << 12) && in[2*i+1] == (0x54e1f << 12)) ||
-                ((in[2*i+0] == (0x96f872 << 8) && in[2*i+1] == (0xa54e1f << 8)))) {
+    size_t i = 0;
+#ifdef UPIPE_S337F_SYNC_VECTOR
+    for ( ; i + UPIPE_S337F_SYNC_VECTOR <= size;
+          i += UPIPE_S337F_SYNC_VECTOR) {
+        unsigned int pos = upipe_s337f_sync_vector(&in[2*i]);
+        if (pos < UPIPE_S337F_SYNC_VECTOR) {
+            uref_sound_unmap(uref, 0, -1, 1);
+            return i + pos;
+        }
+    }
+#endif
+
+    for ( ; i < size; i++) {
+        uint32_t a = in[2*i+0], b = in[2*i+1];
+        if ((a == UPIPE_S337F_PA20 && b == UPIPE_S337F_PB20) ||
+            (a == UPIPE_S337F_PA24 && b == UPIPE_S337F_PB24)) {
             uref_sound_unmap(uref, 0, -1, 1);
             return i;
         }
+    }
 
     uref_sound_unmap(uref, 0, -1, 1);
 
@@ -286,7 +376,7 @@ static int upipe_s337f_handle(struct upipe *upipe, struct uref *uref, ssize_t sy
     uref_sound_unmap(uref, 0, sync_pos, 1);
 
     /* header */
-    int bits = (out32[0] == 0x6f872 << 12) ? 20 : 24;
+    int bits = ((uint32_t)out32[0] == UPIPE_S337F_PA20) ? 20 : 24;
 
     uint32_t hdr[2]; /* Pc + Pd */
     hdr[0] = out32[2] >> 16;
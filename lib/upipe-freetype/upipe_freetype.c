@@ -47,6 +47,27 @@
 #include <ft2build.h>
 #include FT_FREETYPE_H
 
+/** number of cached glyphs, one per character code */
+#define UPIPE_FREETYPE_GLYPHS 256
+
+/** @internal @This is a glyph rendered with the current face and size */
+struct upipe_freetype_glyph {
+    /** true if the glyph was loaded */
+    bool loaded;
+    /** horizontal offset of the bitmap from the pen position */
+    FT_Int left;
+    /** vertical offset of the bitmap from the pen position */
+    FT_Int top;
+    /** width of the bitmap */
+    unsigned int width;
+    /** height of the bitmap */
+    unsigned int rows;
+    /** packed bitmap, or NULL */
+    uint8_t *buffer;
+    /** advance of the pen in 26.6 coordinates */
+    FT_Vector advance;
+};
+
 /** upipe_freetype structure */
 struct upipe_freetype {
     /** refcount management structure exported to the public structure */
@@ -79,6 +100,13 @@ struct upipe_freetype {
     /** font handle */
     FT_Face face;
 
+    /** glyphs rendered with the current face */
+    struct upipe_freetype_glyph glyphs[UPIPE_FREETYPE_GLYPHS];
+    /** last rendered text */
+    char *text;
+    /** subpicture rendered for the last text */
+    struct ubuf *ubuf;
+
     /** public upipe structure */
     struct upipe upipe;
 };
@@ -100,6 +128,77 @@ static int upipe_freetype_check(struct upipe *upipe, struct uref *uref)
     return UBASE_ERR_NONE;
 }
 
+/** @internal @This flushes the glyph and text caches, which is needed
+ * whenever the face changes.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_freetype_flush_cache(struct upipe *upipe)
+{
+    struct upipe_freetype *upipe_freetype = upipe_freetype_from_upipe(upipe);
+
+    for (int i = 0; i < UPIPE_FREETYPE_GLYPHS; i++) {
+        free(upipe_freetype->glyphs[i].buffer);
+        upipe_freetype->glyphs[i].buffer = NULL;
+        upipe_freetype->glyphs[i].loaded = false;
+    }
+
+    free(upipe_freetype->text);
+    upipe_freetype->text = NULL;
+    if (upipe_freetype->ubuf != NULL) {
+        ubuf_free(upipe_freetype->ubuf);
+        upipe_freetype->ubuf = NULL;
+    }
+}
+
+/** @internal @This returns a glyph from the cache, rendering it the first
+ * time it is used. The glyph is rendered at the origin, so it applies to any
+ * whole pixel pen position.
+ *
+ * @param upipe description structure of the pipe
+ * @param c character code
+ * @return pointer to the glyph
+ */
+static const struct upipe_freetype_glyph *
+    upipe_freetype_get_glyph(struct upipe *upipe, unsigned char c)
+{
+    struct upipe_freetype *upipe_freetype = upipe_freetype_from_upipe(upipe);
+    struct upipe_freetype_glyph *glyph = &upipe_freetype->glyphs[c];
+    if (glyph->loaded)
+        return glyph;
+
+    glyph->loaded = true;
+    glyph->left = glyph->top = 0;
+    glyph->width = glyph->rows = 0;
+    glyph->buffer = NULL;
+    glyph->advance.x = glyph->advance.y = 0;
+
+    FT_Set_Transform(upipe_freetype->face, NULL, NULL);
+    /* load glyph image into the slot(erase previous one) */
+    if (FT_Load_Char(upipe_freetype->face, c, FT_LOAD_RENDER))
+        return glyph;                 /* ignore errors */
+
+    FT_GlyphSlot slot = upipe_freetype->face->glyph;
+    FT_Bitmap *bitmap = &slot->bitmap;
+    glyph->advance = slot->advance;
+    if (!bitmap->width || !bitmap->rows)
+        return glyph;
+
+    glyph->buffer = malloc(bitmap->width * bitmap->rows);
+    if (unlikely(glyph->buffer == NULL)) {
+        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+        return glyph;
+    }
+    for (unsigned int j = 0; j < bitmap->rows; j++)
+        memcpy(&glyph->buffer[j * bitmap->width],
+               &bitmap->buffer[j * bitmap->pitch], bitmap->width);
+    glyph->left = slot->bitmap_left;
+    glyph->top = slot->bitmap_top;
+    glyph->width = bitmap->width;
+    glyph->rows = bitmap->rows;
+    return glyph;
+}
+
 /** @internal @This frees all resources allocated.
  *
  * @param upipe description structure of the pipe
@@ -110,6 +209,7 @@ static void upipe_freetype_free(struct upipe *upipe)
 
     upipe_throw_dead(upipe);
 
+    upipe_freetype_flush_cache(upipe);
     if (upipe_freetype->face)
         FT_Done_Face(upipe_freetype->face);
 
@@ -151,6 +251,12 @@ static struct upipe *upipe_freetype_alloc(struct upipe_mgr *mgr,
     }
 
     upipe_freetype->face = NULL;
+    for (int i = 0; i < UPIPE_FREETYPE_GLYPHS; i++) {
+        upipe_freetype->glyphs[i].loaded = false;
+        upipe_freetype->glyphs[i].buffer = NULL;
+    }
+    upipe_freetype->text = NULL;
+    upipe_freetype->ubuf = NULL;
 
     upipe_freetype_init_urefcount(upipe);
     upipe_freetype_init_output(upipe);
@@ -197,6 +303,32 @@ static void upipe_freetype_input(struct upipe *upipe, struct uref *uref, struct
         upipe_freetype_store_flow_def(upipe, flow_def);
     }
 
+    if (unlikely(upipe_freetype->face == NULL)) {
+        upipe_warn(upipe, "no font set");
+        uref_free(uref);
+        return;
+    }
+
+    const char *text;
+    int r = uref_attr_get_string(uref, &text, UDICT_TYPE_STRING, "text");
+    if (!ubase_check(r)) {
+        uref_dump(uref, upipe->uprobe);
+        text = "fail";
+    }
+
+    /* unchanged text, reuse the previous subpicture */
+    if (upipe_freetype->text != NULL && !strcmp(upipe_freetype->text, text)) {
+        struct ubuf *ubuf = ubuf_dup(upipe_freetype->ubuf);
+        if (unlikely(ubuf == NULL)) {
+            upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+            uref_free(uref);
+            return;
+        }
+        uref_attach_ubuf(uref, ubuf);
+        upipe_freetype_output(upipe, uref, upump_p);
+        return;
+    }
+
     struct ubuf *ubuf = ubuf_pic_alloc(upipe_freetype->ubuf_mgr, h, v);
     if (!ubuf) {
         upipe_err(upipe, "Could not allocate pic");
@@ -236,30 +368,19 @@ static void upipe_freetype_input(struct upipe *upipe, struct uref *uref, struct
     pen.x = 0;
     pen.y = v*8;
 
-    FT_GlyphSlot slot = upipe_freetype->face->glyph;
-    const char *text;
-    int r = uref_attr_get_string(uref, &text, UDICT_TYPE_STRING, "text");
-    if (!ubase_check(r)) {
-        uref_dump(uref, upipe->uprobe);
-        text = "fail";
-    }
     for (int i = 0; i < strlen(text); i++) {
-        FT_Set_Transform(upipe_freetype->face, NULL, &pen);
-
-        /* load glyph image into the slot(erase previous one) */
-        if (FT_Load_Char(upipe_freetype->face, text[i], FT_LOAD_RENDER))
-            continue;                 /* ignore errors */
+        const struct upipe_freetype_glyph *glyph =
+            upipe_freetype_get_glyph(upipe, text[i]);
 
         /* now, draw to our target surface(convert position) */
-        FT_Bitmap *bitmap = &slot->bitmap;
-        FT_Int x = slot->bitmap_left;
-        FT_Int y = v - slot->bitmap_top;
-        FT_Int x_max = x + bitmap->width;
+        FT_Int x = pen.x / 64 + glyph->left;
+        FT_Int y = v - (pen.y / 64 + glyph->top);
+        FT_Int x_max = x + glyph->width;
         if (x_max > h) {
             upipe_err_va(upipe, "clipping x, %"PRIu64" < %d", h, x_max);
             x_max = h;
         }
-        FT_Int y_max = y + bitmap->rows;
+        FT_Int y_max = y + glyph->rows;
         if (y_max > v) {
             upipe_err_va(upipe, "clipping y, %"PRIu64" < %d", v, y_max);
             y_max = v;
@@ -267,13 +388,13 @@ static void upipe_freetype_input(struct upipe *upipe, struct uref *uref, struct
 
         for (FT_Int i = (x < 0 ? 0 : x); i < x_max; i++)
             for (FT_Int j = (y < 0 ? 0 : y); j < y_max; j++) {
-                dst[j*stride_y + i] |= bitmap->buffer[(j - y) * bitmap->width + (i - x)];
-                dsta[j*stride_a + i] |= bitmap->buffer[(j - y) * bitmap->width + (i - x)];
+                dst[j*stride_y + i] |= glyph->buffer[(j - y) * glyph->width + (i - x)];
+                dsta[j*stride_a + i] |= glyph->buffer[(j - y) * glyph->width + (i - x)];
             }
 
         /* increment pen position */
-        pen.x += slot->advance.x;
-        pen.y += slot->advance.y;
+        pen.x += glyph->advance.x;
+        pen.y += glyph->advance.y;
     }
 
     unsigned text_w = pen.x / 64;
@@ -289,6 +410,16 @@ static void upipe_freetype_input(struct upipe *upipe, struct uref *uref, struct
     ubuf_pic_plane_unmap(ubuf, "y8", 0, 0, -1, -1);
     ubuf_pic_plane_unmap(ubuf, "a8", 0, 0, -1, -1);
 
+    free(upipe_freetype->text);
+    if (upipe_freetype->ubuf != NULL)
+        ubuf_free(upipe_freetype->ubuf);
+    upipe_freetype->text = strdup(text);
+    upipe_freetype->ubuf = upipe_freetype->text != NULL ? ubuf_dup(ubuf) : NULL;
+    if (upipe_freetype->ubuf == NULL) {
+        free(upipe_freetype->text);
+        upipe_freetype->text = NULL;
+    }
+
     uref_attach_ubuf(uref, ubuf);
 
     upipe_freetype_output(upipe, uref, upump_p);
@@ -309,6 +440,7 @@ static int upipe_freetype_set_option(struct upipe *upipe,
     if (strcmp(option, "font"))
         return UBASE_ERR_INVALID;
 
+    upipe_freetype_flush_cache(upipe);
     if (upipe_freetype->face)
         FT_Done_Face(upipe_freetype->face);
 
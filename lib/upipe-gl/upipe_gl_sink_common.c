@@ -28,8 +28,14 @@
  */
 
 #include <upipe/uref_pic.h>
+#include <upipe/uref_pic_flow.h>
 #include <upipe-gl/upipe_gl_sink_common.h>
+
+#include <string.h>
+
+#define GL_GLEXT_PROTOTYPES
 #include <GL/gl.h>
+#include <GL/glext.h>
 
 /** @This loads a uref picture into the specified texture
  * @param uref uref structure describing the picture
@@ -55,3 +61,385 @@ bool upipe_gl_texture_load_uref(struct uref *uref, GLuint texture)
 
     return true;
 }
+
+/** vertex shader passing the texture coordinates */
+static const char *upipe_gl_texture_vertex =
+    "#version 110\n"
+    "void main() {\n"
+    "    gl_TexCoord[0] = gl_MultiTexCoord0;\n"
+    "    gl_Position = ftransform();\n"
+    "}\n";
+
+/** fragment shader converting planar YUV to RGB */
+static const char *upipe_gl_texture_fragment =
+    "#version 110\n"
+    "uniform sampler2D y, u, v;\n"
+    "uniform mat3 matrix;\n"
+    "uniform vec3 offset;\n"
+    "uniform float scale;\n"
+    "void main() {\n"
+    "    vec2 pos = gl_TexCoord[0].st;\n"
+    "    vec3 yuv = vec3(texture2D(y, pos).r, texture2D(u, pos).r,\n"
+    "                    texture2D(v, pos).r) * scale - offset;\n"
+    "    gl_FragColor = vec4(matrix * yuv, 1.0);\n"
+    "}\n";
+
+/** @internal @This compiles a shader.
+ *
+ * @param type type of shader
+ * @param source source code of the shader
+ * @return shader, or 0 in case of error
+ */
+static GLuint upipe_gl_texture_compile(GLenum type, const char *source)
+{
+    GLuint shader = glCreateShader(type);
+    if (unlikely(!shader))
+        return 0;
+    glShaderSource(shader, 1, &source, NULL);
+    glCompileShader(shader);
+    GLint status = GL_FALSE;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+    if (unlikely(status != GL_TRUE)) {
+        glDeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+/** @internal @This builds the YUV to RGB shader program.
+ *
+ * @return program, or 0 in case of error
+ */
+static GLuint upipe_gl_texture_link(void)
+{
+    GLuint vertex = upipe_gl_texture_compile(GL_VERTEX_SHADER,
+                                             upipe_gl_texture_vertex);
+    GLuint fragment = upipe_gl_texture_compile(GL_FRAGMENT_SHADER,
+                                               upipe_gl_texture_fragment);
+    GLuint program = 0;
+    if (likely(vertex && fragment))
+        program = glCreateProgram();
+    if (likely(program)) {
+        glAttachShader(program, vertex);
+        glAttachShader(program, fragment);
+        glLinkProgram(program);
+        GLint status = GL_FALSE;
+        glGetProgramiv(program, GL_LINK_STATUS, &status);
+        if (unlikely(status != GL_TRUE)) {
+            glDeleteProgram(program);
+            program = 0;
+        }
+    }
+    /* shaders are only flagged for deletion while attached */
+    if (vertex)
+        glDeleteShader(vertex);
+    if (fragment)
+        glDeleteShader(fragment);
+    if (unlikely(!program))
+        return 0;
+
+    static const char *samplers[UPIPE_GL_TEXTURE_PLANES] = { "y", "u", "v" };
+    glUseProgram(program);
+    for (int i = 0; i < UPIPE_GL_TEXTURE_PLANES; i++)
+        glUniform1i(glGetUniformLocation(program, samplers[i]), i);
+    glUseProgram(0);
+    return program;
+}
+
+/** @This initializes the GL objects used to upload pictures.
+ *
+ * @param texture pointer to the texture structure
+ * @return an error code
+ */
+int upipe_gl_texture_init(struct upipe_gl_texture *texture)
+{
+    texture->planes = 0;
+    texture->yuv = false;
+    texture->high_depth = false;
+    texture->pbo = 0;
+    glGenTextures(UPIPE_GL_TEXTURE_PLANES, texture->textures);
+    for (int i = 0; i < UPIPE_GL_TEXTURE_PLANES; i++) {
+        texture->widths[i] = texture->heights[i] = 0;
+        glBindTexture(GL_TEXTURE_2D, texture->textures[i]);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glGenBuffers(UPIPE_GL_TEXTURE_PBOS, texture->pbos);
+    texture->program = upipe_gl_texture_link();
+    return glGetError() == GL_NO_ERROR ? UBASE_ERR_NONE : UBASE_ERR_EXTERNAL;
+}
+
+/** @This releases the GL objects used to upload pictures.
+ *
+ * @param texture pointer to the texture structure
+ */
+void upipe_gl_texture_clean(struct upipe_gl_texture *texture)
+{
+    if (texture->program)
+        glDeleteProgram(texture->program);
+    glDeleteBuffers(UPIPE_GL_TEXTURE_PBOS, texture->pbos);
+    glDeleteTextures(UPIPE_GL_TEXTURE_PLANES, texture->textures);
+}
+
+/** @This updates the YUV to RGB conversion with the colour attributes of
+ * a new flow definition.
+ *
+ * @param texture pointer to the texture structure
+ * @param flow_def flow definition packet, or NULL for the defaults
+ */
+void upipe_gl_texture_set_flow_def(struct upipe_gl_texture *texture,
+                                   struct uref *flow_def)
+{
+    const char *matrix = NULL;
+    uint64_t vsize = 0;
+    bool full_range = false;
+    if (flow_def != NULL) {
+        uref_pic_flow_get_matrix_coefficients(flow_def, &matrix);
+        uref_pic_flow_get_vsize(flow_def, &vsize);
+        full_range = ubase_check(uref_pic_flow_get_full_range(flow_def));
+    }
+    if (matrix == NULL)
+        matrix = vsize > 576 ? "bt709" : "smpte170m";
+
+    float kr = 0.299, kb = 0.114;
+    if (!strcmp(matrix, "bt709")) {
+        kr = 0.2126;
+        kb = 0.0722;
+    } else if (!strcmp(matrix, "smpte240m")) {
+        kr = 0.212;
+        kb = 0.087;
+    } else if (!strncmp(matrix, "bt2020", 6)) {
+        kr = 0.2627;
+        kb = 0.0593;
+    }
+    float kg = 1. - kr - kb;
+    float ys = full_range ? 1. : 255. / 219.;
+    float cs = full_range ? 1. : 255. / 224.;
+    float m[9] = {
+        ys, 0., 2. * (1. - kr) * cs,
+        ys, -2. * kb * (1. - kb) / kg * cs, -2. * kr * (1. - kr) / kg * cs,
+        ys, 2. * (1. - kb) * cs, 0.
+    };
+    memcpy(texture->matrix, m, sizeof(m));
+    texture->offset[0] = full_range ? 0. : 16. / 255.;
+    texture->offset[1] = texture->offset[2] = 128. / 255.;
+}
+
+/** @internal @This checks planar YUV chromas with the usual subsamplings.
+ *
+ * @param flow_def flow definition packet
+ * @param chromas chromas of the Y, U and V planes
+ * @param size size of a sample in octets
+ * @return an error code
+ */
+static int upipe_gl_texture_check_yuv(struct uref *flow_def,
+                                      const char *chromas[3], uint8_t size)
+{
+    static const uint8_t subs[3][2] = { { 1, 1 }, { 2, 1 }, { 2, 2 } };
+    UBASE_RETURN(uref_pic_flow_check_chroma(flow_def, 1, 1, size, chromas[0]))
+    for (int i = 0; i < 3; i++)
+        if (ubase_check(uref_pic_flow_check_chroma(flow_def,
+                        subs[i][0], subs[i][1], size, chromas[1])) &&
+            ubase_check(uref_pic_flow_check_chroma(flow_def,
+                        subs[i][0], subs[i][1], size, chromas[2])))
+            return UBASE_ERR_NONE;
+    return UBASE_ERR_INVALID;
+}
+
+/** planes of 8 bits YUV pictures */
+static const char *upipe_gl_texture_yuv8[3] = { "y8", "u8", "v8" };
+/** planes of 10 bits YUV pictures */
+static const char *upipe_gl_texture_yuv10[3] = { "y10l", "u10l", "v10l" };
+
+/** @This checks whether pictures of the given flow definition can be
+ * uploaded (RGB, or planar 8 or 10 bits YUV).
+ *
+ * @param flow_def flow definition packet
+ * @return an error code
+ */
+int upipe_gl_texture_check_flow_def(struct uref *flow_def)
+{
+    uint8_t macropixel, planes;
+    UBASE_RETURN(uref_pic_flow_get_macropixel(flow_def, &macropixel))
+    UBASE_RETURN(uref_pic_flow_get_planes(flow_def, &planes))
+    if (macropixel != 1)
+        return UBASE_ERR_INVALID;
+    if (planes == 1 &&
+        (ubase_check(uref_pic_flow_check_chroma(flow_def, 1, 1, 2,
+                                                "r5g6b5")) ||
+         ubase_check(uref_pic_flow_check_chroma(flow_def, 1, 1, 3,
+                                                "r8g8b8"))))
+        return UBASE_ERR_NONE;
+    if (planes == 3 &&
+        (ubase_check(upipe_gl_texture_check_yuv(flow_def,
+                                                upipe_gl_texture_yuv8, 1)) ||
+         ubase_check(upipe_gl_texture_check_yuv(flow_def,
+                                                upipe_gl_texture_yuv10, 2))))
+        return UBASE_ERR_NONE;
+    return UBASE_ERR_INVALID;
+}
+
+/** @This uploads a uref picture to the textures. The planes are copied to
+ * the next pixel buffer object of the ring, so that the transfer to the
+ * textures is performed asynchronously by the GL implementation while the
+ * previous picture is still being rendered.
+ *
+ * @param texture pointer to the texture structure
+ * @param uref uref structure describing the picture
+ * @return an error code
+ */
+int upipe_gl_texture_load(struct upipe_gl_texture *texture,
+                          struct uref *uref)
+{
+    const char *rgb[1];
+    const char **chromas;
+    unsigned int planes = 3;
+    bool yuv = true;
+    GLenum format = GL_LUMINANCE, internal = GL_LUMINANCE;
+    GLenum type = GL_UNSIGNED_BYTE;
+    uint8_t size = 1;
+    size_t stride;
+    if (ubase_check(uref_pic_plane_size(uref, "y8", &stride,
+                                        NULL, NULL, NULL))) {
+        chromas = upipe_gl_texture_yuv8;
+    } else if (ubase_check(uref_pic_plane_size(uref, "y10l", &stride,
+                                               NULL, NULL, NULL))) {
+        chromas = upipe_gl_texture_yuv10;
+        internal = GL_LUMINANCE16;
+        type = GL_UNSIGNED_SHORT;
+        size = 2;
+    } else {
+        chromas = rgb;
+        planes = 1;
+        yuv = false;
+        format = internal = GL_RGB;
+        size = 3;
+        rgb[0] = "r8g8b8";
+        if (!ubase_check(uref_pic_plane_size(uref, rgb[0], &stride,
+                                             NULL, NULL, NULL))) {
+            rgb[0] = "r5g6b5";
+            type = GL_UNSIGNED_SHORT_5_6_5;
+            size = 2;
+        }
+    }
+    if (yuv && !texture->program)
+        return UBASE_ERR_INVALID;
+
+    size_t hsize, vsize;
+    UBASE_RETURN(uref_pic_size(uref, &hsize, &vsize, NULL))
+
+    const uint8_t *data[UPIPE_GL_TEXTURE_PLANES];
+    size_t strides[UPIPE_GL_TEXTURE_PLANES];
+    size_t widths[UPIPE_GL_TEXTURE_PLANES];
+    size_t heights[UPIPE_GL_TEXTURE_PLANES];
+    size_t offsets[UPIPE_GL_TEXTURE_PLANES];
+    size_t total = 0;
+    for (unsigned int i = 0; i < planes; i++) {
+        uint8_t hsub, vsub;
+        int err = uref_pic_plane_size(uref, chromas[i], &strides[i],
+                                      &hsub, &vsub, NULL);
+        if (ubase_check(err))
+            err = uref_pic_plane_read(uref, chromas[i], 0, 0, -1, -1,
+                                      &data[i]);
+        if (unlikely(!ubase_check(err))) {
+            while (i-- > 0)
+                uref_pic_plane_unmap(uref, chromas[i], 0, 0, -1, -1);
+            return err;
+        }
+        widths[i] = hsize / hsub;
+        heights[i] = vsize / vsub;
+        offsets[i] = total;
+        total += strides[i] * heights[i];
+    }
+
+    /* orphan the previous storage of the buffer so that mapping does not
+     * wait for a pending transfer */
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, texture->pbos[texture->pbo]);
+    texture->pbo = (texture->pbo + 1) % UPIPE_GL_TEXTURE_PBOS;
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, total, NULL, GL_STREAM_DRAW);
+    uint8_t *pbo = glMapBuffer(GL_PIXEL_UNPACK_BUFFER, GL_WRITE_ONLY);
+    if (likely(pbo != NULL)) {
+        for (unsigned int i = 0; i < planes; i++)
+            memcpy(pbo + offsets[i], data[i], strides[i] * heights[i]);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+    } else {
+        /* fall back to a synchronous upload from the picture */
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+#ifdef UPIPE_WORDS_BIGENDIAN
+    /* 10 bits samples are little-endian */
+    glPixelStorei(GL_UNPACK_SWAP_BYTES, internal == GL_LUMINANCE16);
+#endif
+    for (unsigned int i = 0; i < planes; i++) {
+        const void *pixels = pbo != NULL ?
+            (const void *)(uintptr_t)offsets[i] : data[i];
+        glBindTexture(GL_TEXTURE_2D, texture->textures[i]);
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, strides[i] / size);
+        if (texture->planes != planes || texture->yuv != yuv ||
+            texture->high_depth != (internal == GL_LUMINANCE16) ||
+            texture->widths[i] != widths[i] ||
+            texture->heights[i] != heights[i]) {
+            glTexImage2D(GL_TEXTURE_2D, 0, internal, widths[i], heights[i],
+                         0, format, type, pixels);
+            texture->widths[i] = widths[i];
+            texture->heights[i] = heights[i];
+        } else
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, widths[i], heights[i],
+                            format, type, pixels);
+        uref_pic_plane_unmap(uref, chromas[i], 0, 0, -1, -1);
+    }
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+#ifdef UPIPE_WORDS_BIGENDIAN
+    glPixelStorei(GL_UNPACK_SWAP_BYTES, GL_FALSE);
+#endif
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glBindTexture(GL_TEXTURE_2D, texture->textures[0]);
+    texture->planes = planes;
+    texture->yuv = yuv;
+    texture->high_depth = internal == GL_LUMINANCE16;
+    return UBASE_ERR_NONE;
+}
+
+/** @This binds the textures, and the shader program for YUV pictures, for
+ * the following draw calls.
+ *
+ * @param texture pointer to the texture structure
+ */
+void upipe_gl_texture_bind(struct upipe_gl_texture *texture)
+{
+    if (!texture->yuv) {
+        glBindTexture(GL_TEXTURE_2D, texture->textures[0]);
+        return;
+    }
+
+    for (unsigned int i = 0; i < texture->planes; i++) {
+        glActiveTexture(GL_TEXTURE0 + i);
+        glBindTexture(GL_TEXTURE_2D, texture->textures[i]);
+    }
+    glActiveTexture(GL_TEXTURE0);
+
+    glUseProgram(texture->program);
+    glUniformMatrix3fv(glGetUniformLocation(texture->program, "matrix"),
+                       1, GL_TRUE, texture->matrix);
+    glUniform3fv(glGetUniformLocation(texture->program, "offset"),
+                 1, texture->offset);
+    /* 10 bits samples are normalized against 16 bits, and their levels are
+     * four times the 8 bits ones */
+    glUniform1f(glGetUniformLocation(texture->program, "scale"),
+                texture->high_depth ? 65535. / 1020. : 1.);
+}
+
+/** @This unbinds the shader program bound by @ref upipe_gl_texture_bind.
+ *
+ * @param texture pointer to the texture structure
+ */
+void upipe_gl_texture_unbind(struct upipe_gl_texture *texture)
+{
+    if (texture->yuv)
+        glUseProgram(0);
+}
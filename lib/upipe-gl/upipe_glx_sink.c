@@ -489,12 +489,8 @@ static int upipe_glx_sink_set_flow_def(struct upipe *upipe,
         return UBASE_ERR_INVALID;
     UBASE_RETURN(uref_flow_match_def(flow_def, "pic."))
 
-    /* for the moment we only support rgb24 */
-    uint8_t macropixel;
-    if (!ubase_check(uref_pic_flow_get_macropixel(flow_def, &macropixel)) ||
-        macropixel != 1 ||
-        (!ubase_check(uref_pic_flow_check_chroma(flow_def, 1, 1, 2, "r5g6b5")) &&
-         !ubase_check(uref_pic_flow_check_chroma(flow_def, 1, 1, 3, "r8g8b8")))) {
+    /* RGB or planar YUV */
+    if (!ubase_check(upipe_gl_texture_check_flow_def(flow_def))) {
         upipe_err(upipe, "incompatible flow definition");
         uref_dump(flow_def, upipe->uprobe);
         return UBASE_ERR_INVALID;
@@ -517,6 +513,15 @@ static int upipe_glx_sink_provide_flow_format(struct upipe *upipe,
 {
     struct uref *flow_format = uref_dup(request->uref);
     UBASE_ALLOC_RETURN(flow_format);
+    uint8_t planes;
+    if (ubase_check(uref_pic_flow_get_planes(flow_format, &planes)) &&
+        planes > 1 &&
+        ubase_check(upipe_gl_texture_check_flow_def(flow_format))) {
+        /* planar YUV is converted by the GPU */
+        uref_pic_set_progressive(flow_format);
+        return urequest_provide_flow_format(request, flow_format);
+    }
+
     bool rgb565 = ubase_check(uref_pic_flow_check_chroma(flow_format, 1, 1, 2, "r5g6b5"));
 
     uref_pic_flow_clear_format(flow_format);
@@ -50,8 +50,8 @@
 
 /** @This is the private structure for gl sink renderer probe. */
 struct uprobe_gl_sink {
-    /** texture */
-    GLuint texture;
+    /** textures the pictures are uploaded to */
+    struct upipe_gl_texture texture;
     /** SAR */
     struct urational sar;
 
@@ -95,6 +95,9 @@ static void uprobe_gl_sink_new_flow(struct uprobe *uprobe,
     if (unlikely(!uprobe_gl_sink->sar.num || !uprobe_gl_sink->sar.den)) {
         uprobe_gl_sink->sar.num = uprobe_gl_sink->sar.den = 1;
     }
+
+    /* get colour attributes */
+    upipe_gl_texture_set_flow_def(&uprobe_gl_sink->texture, uref);
 }
 
 /** @internal @This does the actual rendering upon receiving a pic
@@ -112,7 +115,7 @@ static int uprobe_gl_sink_render(struct uprobe *uprobe,
 
     /* load image to texture */
 
-    if (!upipe_gl_texture_load_uref(uref, uprobe_gl_sink->texture)) {
+    if (!ubase_check(upipe_gl_texture_load(&uprobe_gl_sink->texture, uref))) {
         upipe_err(upipe, "Could not map picture plane");
         return UBASE_ERR_EXTERNAL;
     }
@@ -124,7 +127,7 @@ static int uprobe_gl_sink_render(struct uprobe *uprobe,
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     glEnable(GL_TEXTURE_2D);
     glTexEnvf(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_DECAL);
-    glBindTexture(GL_TEXTURE_2D, uprobe_gl_sink->texture);
+    upipe_gl_texture_bind(&uprobe_gl_sink->texture);
     glLoadIdentity();
     glTranslatef(0, 0, -10);
 
@@ -144,6 +147,7 @@ static int uprobe_gl_sink_render(struct uprobe *uprobe,
     int ret = uprobe_throw(uprobe->next, upipe, UPROBE_GL_SINK_RENDER,
                            UPIPE_GL_SINK_SIGNATURE, uref);
 
+    upipe_gl_texture_unbind(&uprobe_gl_sink->texture);
     glDisable(GL_TEXTURE_2D);
     /* End */
 
@@ -169,13 +173,11 @@ static void uprobe_gl_sink_init2(struct uprobe *uprobe,
 
     glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
 
-    glGenTextures(1, &uprobe_gl_sink->texture);
-    glBindTexture(GL_TEXTURE_2D, uprobe_gl_sink->texture);
-
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    if (unlikely(!ubase_check(upipe_gl_texture_init(
+                        &uprobe_gl_sink->texture))))
+        upipe_warn(upipe, "unable to set up GL textures");
+    else if (unlikely(!uprobe_gl_sink->texture.program))
+        upipe_warn(upipe, "unable to build YUV shader, only RGB is supported");
 }
 
 /** @internal @This catches events thrown by pipes.
@@ -237,6 +239,8 @@ uprobe_gl_sink_init(struct uprobe_gl_sink *uprobe_gl_sink,
     struct uprobe *uprobe = uprobe_gl_sink_to_uprobe(uprobe_gl_sink);
 
     uprobe_gl_sink->sar.num = uprobe_gl_sink->sar.den = 1;
+    memset(&uprobe_gl_sink->texture, 0, sizeof(uprobe_gl_sink->texture));
+    upipe_gl_texture_set_flow_def(&uprobe_gl_sink->texture, NULL);
 
     uprobe_init(uprobe, uprobe_gl_sink_throw, next);
     return uprobe;
@@ -248,7 +252,7 @@ uprobe_gl_sink_init(struct uprobe_gl_sink *uprobe_gl_sink,
  */
 static void uprobe_gl_sink_clean(struct uprobe_gl_sink *uprobe_gl_sink)
 {
-    glDeleteTextures(1, &uprobe_gl_sink->texture);
+    upipe_gl_texture_clean(&uprobe_gl_sink->texture);
     struct uprobe *uprobe = &uprobe_gl_sink->uprobe;
     uprobe_clean(uprobe);
 }
@@ -37,3 +37,78 @@ void upipe_sdi_unpack_c(const uint8_t *src, uint16_t *y, int64_t size)
         y[i+3] = ((d & 0x03) << 8) | e;                 //4455555555
     }
 }
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+
+/** word permutation giving each lane 10 consecutive packed octets */
+static const uint16_t upipe_sdi_unpack_avx512_perm[32] = {
+     0,  1,  2,  3,  4,  0,  0,  0,  5,  6,  7,  8,  9,  0,  0,  0,
+    10, 11, 12, 13, 14,  0,  0,  0, 15, 16, 17, 18, 19,  0,  0,  0,
+};
+
+__attribute__((target("avx512f,avx512bw,avx512vl")))
+void upipe_sdi_unpack_10_avx512(const uint8_t *src, uint16_t *y, int64_t size)
+{
+    /* each sample is in the big endian word starting at its first octet */
+    const __m512i shuf = _mm512_broadcast_i32x4(_mm_setr_epi8(
+            1, 0, 2, 1, 3, 2, 4, 3, 6, 5, 7, 6, 8, 7, 9, 8));
+    const __m512i shift = _mm512_broadcast_i32x4(_mm_setr_epi16(
+            6, 4, 2, 0, 6, 4, 2, 0));
+    const __m512i perm = _mm512_loadu_si512(upipe_sdi_unpack_avx512_perm);
+    const __m512i mask = _mm512_set1_epi16(0x3ff);
+
+    for ( ; size >= 40; size -= 40) {
+        __m512i in = _mm512_maskz_loadu_epi8(0xffffffffffULL, src);
+        __m512i words = _mm512_shuffle_epi8(
+                _mm512_permutexvar_epi16(perm, in), shuf);
+        _mm512_storeu_si512(y, _mm512_and_si512(
+                    _mm512_srlv_epi16(words, shift), mask));
+        src += 40;
+        y += 32;
+    }
+
+    if (size > 0)
+        upipe_sdi_unpack_c(src, y, size);
+}
+#endif
+
+#if defined(__aarch64__) && !defined(__AARCH64EB__)
+#include <arm_neon.h>
+
+/** byte lookups building the big endian word starting at the first octet
+ * of each sample, for the octets 0-9 and 10-19 (loaded from 4) */
+static const uint8_t upipe_sdi_unpack_neon_tbl[2][16] = {
+    { 1, 0, 2, 1, 3, 2, 4, 3, 6, 5, 7, 6, 8, 7, 9, 8 },
+    { 7, 6, 8, 7, 9, 8, 10, 9, 12, 11, 13, 12, 14, 13, 15, 14 },
+};
+
+/** right shifts aligning the samples in their words */
+static const int16_t upipe_sdi_unpack_neon_shift[8] = {
+    -6, -4, -2, 0, -6, -4, -2, 0
+};
+
+void upipe_sdi_unpack_10_neon(const uint8_t *src, uint16_t *y, int64_t size)
+{
+    const uint8x16_t tbl0 = vld1q_u8(upipe_sdi_unpack_neon_tbl[0]);
+    const uint8x16_t tbl1 = vld1q_u8(upipe_sdi_unpack_neon_tbl[1]);
+    const int16x8_t shift = vld1q_s16(upipe_sdi_unpack_neon_shift);
+    const uint16x8_t mask = vdupq_n_u16(0x3ff);
+
+    for ( ; size >= 20; size -= 20) {
+        /* the two loads overlap so that nothing is read past the 20
+         * packed octets */
+        uint8x16_t in0 = vld1q_u8(src);
+        uint8x16_t in1 = vld1q_u8(src + 4);
+        uint16x8_t y0 = vreinterpretq_u16_u8(vqtbl1q_u8(in0, tbl0));
+        uint16x8_t y1 = vreinterpretq_u16_u8(vqtbl1q_u8(in1, tbl1));
+        vst1q_u16(y, vandq_u16(vshlq_u16(y0, shift), mask));
+        vst1q_u16(y + 8, vandq_u16(vshlq_u16(y1, shift), mask));
+        src += 20;
+        y += 16;
+    }
+
+    if (size > 0)
+        upipe_sdi_unpack_c(src, y, size);
+}
+#endif
@@ -1,3 +1,12 @@
 void upipe_sdi_unpack_c(const uint8_t *src, uint16_t *y, int64_t size);
 void upipe_sdi_unpack_10_ssse3(const uint8_t *src, uint16_t *y, int64_t size);
 void upipe_sdi_unpack_10_avx2 (const uint8_t *src, uint16_t *y, int64_t size);
+
+/* process 40 (AVX-512) or 20 (NEON) octets per iteration, no alignment
+ * required, nothing read past the end of the input */
+#if defined(__x86_64__)
+void upipe_sdi_unpack_10_avx512(const uint8_t *src, uint16_t *y, int64_t size);
+#endif
+#if defined(__aarch64__) && !defined(__AARCH64EB__)
+void upipe_sdi_unpack_10_neon(const uint8_t *src, uint16_t *y, int64_t size);
+#endif
@@ -39,3 +39,95 @@ void upipe_sdi_pack_c(uint8_t *dst, const uint8_t *y, int64_t size)
         // check buffer end?
     }
 }
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+
+/** word permutation gathering the 40 packed octets of the 4 lanes */
+static const uint16_t upipe_sdi_pack_avx512_perm[32] = {
+     0,  1,  2,  3,  4,  8,  9, 10, 11, 12, 16, 17, 18, 19, 20, 24,
+    25, 26, 27, 28,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,
+};
+
+__attribute__((target("avx512f,avx512bw,avx512vl")))
+void upipe_sdi_pack_10_avx512(uint8_t *dst, const uint8_t *y, int64_t size)
+{
+    /* big endian order of the 40-bit groups of each quadword */
+    const __m512i shuf = _mm512_broadcast_i32x4(_mm_setr_epi8(
+            4, 3, 2, 1, 0, 12, 11, 10, 9, 8, -1, -1, -1, -1, -1, -1));
+    const __m512i perm = _mm512_loadu_si512(upipe_sdi_pack_avx512_perm);
+    const __m512i mask = _mm512_set1_epi16(0x3ff);
+    const __m512i mul = _mm512_set1_epi32(0x00010400);
+    const __m512i low = _mm512_set1_epi64(0xffffffff);
+
+    for ( ; size >= 32; size -= 32) {
+        __m512i in = _mm512_and_si512(_mm512_loadu_si512(y), mask);
+        /* a << 10 | b in each doubleword */
+        __m512i ab = _mm512_madd_epi16(in, mul);
+        /* a << 30 | b << 20 | c << 10 | d in each quadword */
+        __m512i abcd = _mm512_or_si512(
+                _mm512_slli_epi64(_mm512_and_si512(ab, low), 20),
+                _mm512_srli_epi64(ab, 32));
+        __m512i out = _mm512_permutexvar_epi16(perm,
+                _mm512_shuffle_epi8(abcd, shuf));
+        _mm512_mask_storeu_epi8(dst, 0xffffffffffULL, out);
+        y += 64;
+        dst += 40;
+    }
+
+    if (size > 0)
+        upipe_sdi_pack_c(dst, y, size);
+}
+#endif
+
+#if defined(__aarch64__) && !defined(__AARCH64EB__)
+#include <arm_neon.h>
+
+/** byte lookups storing the 40-bit groups of two vectors in big endian
+ * order, as octets 0-15 and 4-19 */
+static const uint8_t upipe_sdi_pack_neon_tbl[2][16] = {
+    { 4, 3, 2, 1, 0, 12, 11, 10, 9, 8, 20, 19, 18, 17, 16, 28 },
+    { 0, 12, 11, 10, 9, 8, 20, 19, 18, 17, 16, 28, 27, 26, 25, 24 },
+};
+
+/** @internal @This packs 8 samples into two 40-bit groups.
+ *
+ * @param y pointer to the samples
+ * @return a << 30 | b << 20 | c << 10 | d in each quadword
+ */
+static inline uint8x16_t upipe_sdi_pack_neon_groups(const uint8_t *y)
+{
+    uint16x8_t in = vandq_u16(vld1q_u16((const uint16_t *)y),
+                              vdupq_n_u16(0x3ff));
+    uint32x4_t in32 = vreinterpretq_u32_u16(in);
+    uint32x4_t ab = vorrq_u32(
+            vshlq_n_u32(vandq_u32(in32, vdupq_n_u32(0xffff)), 10),
+            vshrq_n_u32(in32, 16));
+    uint64x2_t ab64 = vreinterpretq_u64_u32(ab);
+    uint64x2_t abcd = vorrq_u64(
+            vshlq_n_u64(vandq_u64(ab64, vdupq_n_u64(0xffffffff)), 20),
+            vshrq_n_u64(ab64, 32));
+    return vreinterpretq_u8_u64(abcd);
+}
+
+void upipe_sdi_pack_10_neon(uint8_t *dst, const uint8_t *y, int64_t size)
+{
+    const uint8x16_t tbl0 = vld1q_u8(upipe_sdi_pack_neon_tbl[0]);
+    const uint8x16_t tbl1 = vld1q_u8(upipe_sdi_pack_neon_tbl[1]);
+
+    for ( ; size >= 16; size -= 16) {
+        uint8x16x2_t groups;
+        groups.val[0] = upipe_sdi_pack_neon_groups(y);
+        groups.val[1] = upipe_sdi_pack_neon_groups(y + 16);
+        /* the two stores overlap so that nothing is written past the
+         * 20 packed octets */
+        vst1q_u8(dst, vqtbl2q_u8(groups, tbl0));
+        vst1q_u8(dst + 4, vqtbl2q_u8(groups, tbl1));
+        y += 32;
+        dst += 20;
+    }
+
+    if (size > 0)
+        upipe_sdi_pack_c(dst, y, size);
+}
+#endif
@@ -2,3 +2,12 @@ void upipe_sdi_pack_c(uint8_t *dst, const uint8_t *y, int64_t size);
 void upipe_sdi_pack_10_ssse3(uint8_t *dst, const uint8_t *y, int64_t size);
 void upipe_sdi_pack_10_avx  (uint8_t *dst, const uint8_t *y, int64_t size);
 void upipe_sdi_pack_10_avx2 (uint8_t *dst, const uint8_t *y, int64_t size);
+
+/* process 32 (AVX-512) or 16 (NEON) samples per iteration, no alignment
+ * required, nothing written past the end of the output */
+#if defined(__x86_64__)
+void upipe_sdi_pack_10_avx512(uint8_t *dst, const uint8_t *y, int64_t size);
+#endif
+#if defined(__aarch64__) && !defined(__AARCH64EB__)
+void upipe_sdi_pack_10_neon(uint8_t *dst, const uint8_t *y, int64_t size);
+#endif
@@ -38,12 +38,20 @@
 #include <upipe/upipe_helper_ubuf_mgr.h>
 #include <upipe/upipe_helper_output.h>
 #include <upipe/upipe_helper_input.h>
+#include <upipe/uslices.h>
+#include <upipe/ucpu.h>
 
 #include <upipe-hbrmt/upipe_pack10bit.h>
 
 #include "sdienc.h"
 
 #define UBUF_ALIGN 32 /* 256-bits simd (avx2) */
+/** ranges of samples packed by threads are multiples of this, so that they
+ * start on aligned input (2 octets per sample) and output (10 bits) */
+#define UPIPE_PACK10BIT_SLICE_SAMPLES 128
+/** samples packed in C at the end of a range, because the simd functions
+ * write up to 6 octets past the end of their output */
+#define UPIPE_PACK10BIT_SLICE_TAIL 16
 
 /** upipe_pack10bit structure with pack10bit parameters */
 struct upipe_pack10bit {
@@ -77,6 +85,11 @@ struct upipe_pack10bit {
 
     /** packing */
     void (*pack)(uint8_t *dst, const uint8_t *y, int64_t size);
+    /** instruction set extensions allowed for the kernels */
+    uint32_t cpu_flags;
+
+    /** worker threads packing ranges of samples, or NULL */
+    struct uslices *uslices;
 
     /** public upipe structure */
     struct upipe upipe;
@@ -98,6 +111,51 @@ UPIPE_HELPER_UBUF_MGR(upipe_pack10bit, ubuf_mgr, flow_format, ubuf_mgr_request,
                       upipe_pack10bit_unregister_output_request)
 UPIPE_HELPER_INPUT(upipe_pack10bit, urefs, nb_urefs, max_urefs, blockers, upipe_pack10bit_handle)
 
+/** @internal @This describes a buffer being packed. */
+struct upipe_pack10bit_frame {
+    /** pointer to the pipe */
+    struct upipe_pack10bit *upipe_pack10bit;
+    /** output buffer */
+    uint8_t *dst;
+    /** input buffer */
+    const uint8_t *src;
+    /** number of samples */
+    int pixels;
+};
+
+/** @internal @This packs a range of samples of a buffer.
+ *
+ * @param opaque pointer to the description of the buffer
+ * @param slice index of the range of samples
+ * @param nb_slices number of ranges of samples
+ */
+static void upipe_pack10bit_pack_slice(void *opaque, unsigned int slice,
+                                       unsigned int nb_slices)
+{
+    const struct upipe_pack10bit_frame *frame = opaque;
+    const struct upipe_pack10bit *upipe_pack10bit = frame->upipe_pack10bit;
+    int units = frame->pixels / UPIPE_PACK10BIT_SLICE_SAMPLES;
+    int start = (int64_t)units * slice / nb_slices *
+                UPIPE_PACK10BIT_SLICE_SAMPLES;
+    int end = (int64_t)units * (slice + 1) / nb_slices *
+              UPIPE_PACK10BIT_SLICE_SAMPLES;
+    uint8_t *dst = frame->dst + start * 10 / 8;
+    const uint8_t *src = frame->src + start * 2;
+
+    if (slice == nb_slices - 1) {
+        upipe_pack10bit->pack(dst, src, frame->pixels - start);
+        return;
+    }
+    if (end == start)
+        return;
+
+    /* do not overwrite the beginning of the next range */
+    int size = end - start - UPIPE_PACK10BIT_SLICE_TAIL;
+    upipe_pack10bit->pack(dst, src, size);
+    upipe_sdi_pack_c(dst + size * 10 / 8, src + size * 2,
+                     UPIPE_PACK10BIT_SLICE_TAIL);
+}
+
 /** @internal @This handles data.
  *
  * @param upipe description structure of the pipe
@@ -144,9 +202,13 @@ static bool upipe_pack10bit_handle(struct upipe *upipe, struct uref *uref,
         return true;
     }
 
-    int pixels = buf_size / 2;
-
-    upipe_pack10bit->pack(buffer, src, pixels);
+    struct upipe_pack10bit_frame frame;
+    frame.upipe_pack10bit = upipe_pack10bit;
+    frame.dst = buffer;
+    frame.src = src;
+    frame.pixels = buf_size / 2;
+    uslices_run(upipe_pack10bit->uslices, upipe_pack10bit_pack_slice, &frame,
+                uslices_get_threads(upipe_pack10bit->uslices));
 
     uref_block_unmap(uref, 0);
     ubuf_block_unmap(ubuf_dst, 0);
@@ -269,6 +331,70 @@ static int upipe_pack10bit_set_flow_def(struct upipe *upipe, struct uref *flow_d
     return UBASE_ERR_NONE;
 }
 
+/** @internal @This sets the number of threads packing the buffers.
+ *
+ * @param upipe description structure of the pipe
+ * @param nb_threads number of threads, or 0
+ * @return an error code
+ */
+static int upipe_pack10bit_set_nb_threads(struct upipe *upipe,
+                                          unsigned int nb_threads)
+{
+    struct upipe_pack10bit *upipe_pack10bit = upipe_pack10bit_from_upipe(upipe);
+    uslices_free(upipe_pack10bit->uslices);
+    upipe_pack10bit->uslices = NULL;
+    if (nb_threads <= 1)
+        return UBASE_ERR_NONE;
+
+    /* the thread of the pipe processes a range of samples too */
+    upipe_pack10bit->uslices = uslices_alloc(nb_threads - 1);
+    if (unlikely(upipe_pack10bit->uslices == NULL)) {
+        upipe_err(upipe, "unable to create packing threads");
+        return UBASE_ERR_EXTERNAL;
+    }
+    upipe_dbg_va(upipe, "packing with %u threads", nb_threads);
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This describes an implementation of the packing kernel. */
+struct upipe_pack10bit_kernel {
+    /** required instruction set extensions */
+    uint32_t cpu_flags;
+    /** packing function */
+    void (*pack)(uint8_t *dst, const uint8_t *y, int64_t size);
+};
+
+/** @internal @This lists the kernels, from the most to the least preferred */
+static const struct upipe_pack10bit_kernel upipe_pack10bit_kernels[] = {
+#if defined(__x86_64__)
+    { UCPU_AVX512, upipe_sdi_pack_10_avx512 },
+#endif
+#if defined(__aarch64__) && !defined(__AARCH64EB__)
+    { UCPU_NEON, upipe_sdi_pack_10_neon },
+#endif
+#if defined(HAVE_X86ASM)
+#if defined(__i686__) || defined(__x86_64__)
+    { UCPU_AVX2, upipe_sdi_pack_10_avx2 },
+    { UCPU_AVX, upipe_sdi_pack_10_avx },
+    { UCPU_SSSE3, upipe_sdi_pack_10_ssse3 },
+#endif
+#endif
+    { 0, upipe_sdi_pack_c },
+};
+
+/** @internal @This selects the packing function.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_pack10bit_setup_asm(struct upipe *upipe)
+{
+    struct upipe_pack10bit *upipe_pack10bit = upipe_pack10bit_from_upipe(upipe);
+    const struct upipe_pack10bit_kernel *kernel =
+        ucpu_select(upipe_pack10bit_kernels,
+                    ucpu_flags() & upipe_pack10bit->cpu_flags);
+    upipe_pack10bit->pack = kernel->pack;
+}
+
 /** @internal @This processes control commands on a file source pipe, and
  * checks the status of the pipe afterwards.
  *
@@ -306,6 +432,16 @@ static int upipe_pack10bit_control(struct upipe *upipe, int command, va_list arg
             struct uref *flow = va_arg(args, struct uref *);
             return upipe_pack10bit_set_flow_def(upipe, flow);
         }
+        case UPIPE_SET_CPU_FLAGS: {
+            upipe_pack10bit->cpu_flags = va_arg(args, uint32_t);
+            upipe_pack10bit_setup_asm(upipe);
+            return UBASE_ERR_NONE;
+        }
+        case UPIPE_PACK10BIT_SET_THREADS: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_PACK10BIT_SIGNATURE)
+            unsigned int nb_threads = va_arg(args, unsigned int);
+            return upipe_pack10bit_set_nb_threads(upipe, nb_threads);
+        }
         default:
             return UBASE_ERR_UNHANDLED;
     }
@@ -329,20 +465,10 @@ static struct upipe *upipe_pack10bit_alloc(struct upipe_mgr *mgr,
 
     struct upipe_pack10bit *upipe_pack10bit = upipe_pack10bit_from_upipe(upipe);
 
-    upipe_pack10bit->pack = upipe_sdi_pack_c;
-
-#if defined(HAVE_X86ASM)
-#if defined(__i686__) || defined(__x86_64__)
-    if (__builtin_cpu_supports("ssse3"))
-        upipe_pack10bit->pack = upipe_sdi_pack_10_ssse3;
-
-    if (__builtin_cpu_supports("avx"))
-        upipe_pack10bit->pack = upipe_sdi_pack_10_avx;
+    upipe_pack10bit->cpu_flags = UCPU_ALL;
+    upipe_pack10bit_setup_asm(upipe);
 
-    if (__builtin_cpu_supports("avx2"))
-        upipe_pack10bit->pack = upipe_sdi_pack_10_avx2;
-#endif
-#endif
+    upipe_pack10bit->uslices = NULL;
 
     upipe_pack10bit_init_urefcount(upipe);
     upipe_pack10bit_init_ubuf_mgr(upipe);
@@ -359,7 +485,9 @@ static struct upipe *upipe_pack10bit_alloc(struct upipe_mgr *mgr,
  */
 static void upipe_pack10bit_free(struct upipe *upipe)
 {
+    struct upipe_pack10bit *upipe_pack10bit = upipe_pack10bit_from_upipe(upipe);
     upipe_throw_dead(upipe);
+    uslices_free(upipe_pack10bit->uslices);
     upipe_pack10bit_clean_input(upipe);
     upipe_pack10bit_clean_output(upipe);
     upipe_pack10bit_clean_ubuf_mgr(upipe);
@@ -0,0 +1,416 @@
+/*
+ * Copyright (C) 2016 Open Broadcast Systems Ltd
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short Upipe module packetizing SDI frames into SMPTE 2022-6 RTP packets
+ *
+ * Each packed SDI frame is cut into fixed-size datagrams sharing the
+ * payload of the frame, so that no octet of the frame is copied. The
+ * packets are dated evenly over the duration of the frame, so that a
+ * batching sink (such as upipe_udpsink with a batch size) can send them
+ * at the pace of the SDI link.
+ */
+
+#include <upipe/ubase.h>
+#include <upipe/uprobe.h>
+#include <upipe/uclock.h>
+#include <upipe/uref_clock.h>
+#include <upipe/uref.h>
+#include <upipe/ubuf.h>
+#include <upipe/ubuf_block.h>
+#include <upipe/uref_block.h>
+#include <upipe/uref_pic_flow.h>
+#include <upipe/uref_flow.h>
+#include <upipe/upipe.h>
+#include <upipe/upipe_helper_upipe.h>
+#include <upipe/upipe_helper_urefcount.h>
+#include <upipe/upipe_helper_void.h>
+#include <upipe/upipe_helper_output.h>
+#include <upipe-hbrmt/upipe_rtp_hbrmt.h>
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <bitstream/ietf/rtp.h>
+
+#define EXPECTED_FLOW_DEF "block."
+#define OUT_FLOW "block.rtp."
+
+/** RTP payload type of HBRMT, as commonly used for SMPTE 2022-6 */
+#define RTP_TYPE_HBRMT          98
+/** size of the HBRMT payload header */
+#define HBRMT_HEADER_SIZE       8
+/** size of the SDI payload of each datagram */
+#define HBRMT_DATA_SIZE         1376
+
+/** upipe_rtp_hbrmt structure */
+struct upipe_rtp_hbrmt {
+    /** refcount management structure */
+    struct urefcount urefcount;
+
+    /** output pipe */
+    struct upipe *output;
+    /** flow_definition packet */
+    struct uref *flow_def;
+    /** output state */
+    enum upipe_helper_output_state output_state;
+    /** list of output requests */
+    struct uchain request_list;
+
+    /** frame duration deduced from the flow definition, or 0 */
+    uint64_t frame_duration;
+    /** zero-filled payload padding the last datagram of a frame */
+    struct ubuf *padding;
+
+    /** rtp sequence number */
+    uint16_t seqnum;
+    /** HBRMT frame counter */
+    uint8_t frame_count;
+    /** true if the video source format fields are set */
+    bool format;
+    /** CF field */
+    uint8_t clock;
+    /** FRAME field */
+    uint8_t frame;
+    /** FRATE field */
+    uint8_t frate;
+    /** SAMPLE field */
+    uint8_t sample;
+
+    /** public upipe structure */
+    struct upipe upipe;
+};
+
+UPIPE_HELPER_UPIPE(upipe_rtp_hbrmt, upipe, UPIPE_RTP_HBRMT_SIGNATURE);
+UPIPE_HELPER_UREFCOUNT(upipe_rtp_hbrmt, urefcount, upipe_rtp_hbrmt_free)
+UPIPE_HELPER_VOID(upipe_rtp_hbrmt);
+UPIPE_HELPER_OUTPUT(upipe_rtp_hbrmt, output, flow_def, output_state, request_list);
+
+/** @internal @This writes the RTP and HBRMT headers of a datagram.
+ *
+ * @param upipe description structure of the pipe
+ * @param buf pointer to the headers
+ * @param ts RTP timestamp of the frame
+ * @param last true if the datagram is the last of the frame
+ */
+static void upipe_rtp_hbrmt_write_header(struct upipe *upipe, uint8_t *buf,
+                                         uint32_t ts, bool last)
+{
+    struct upipe_rtp_hbrmt *upipe_rtp_hbrmt = upipe_rtp_hbrmt_from_upipe(upipe);
+
+    memset(buf, 0, RTP_HEADER_SIZE + HBRMT_HEADER_SIZE);
+    rtp_set_hdr(buf);
+    rtp_set_type(buf, RTP_TYPE_HBRMT);
+    rtp_set_seqnum(buf, upipe_rtp_hbrmt->seqnum++);
+    rtp_set_timestamp(buf, ts);
+    if (last)
+        rtp_set_marker(buf);
+
+    /* Ext, F, VSID | FRCount | R, S, FEC, CF | RESERVE | MAP, FRAME,
+     * FRATE, SAMPLE | FMT-RESERVE; no extension, no scrambling, no FEC,
+     * direct sample structure */
+    uint8_t *hbrmt = buf + RTP_HEADER_SIZE;
+    hbrmt[1] = upipe_rtp_hbrmt->frame_count;
+    if (!upipe_rtp_hbrmt->format)
+        return;
+
+    hbrmt[0] = 0x08;
+    hbrmt[2] = (upipe_rtp_hbrmt->clock >> 3) & 0x1;
+    hbrmt[3] = (upipe_rtp_hbrmt->clock & 0x7) << 5;
+    hbrmt[4] = upipe_rtp_hbrmt->frame >> 4;
+    hbrmt[5] = (upipe_rtp_hbrmt->frame << 4) | (upipe_rtp_hbrmt->frate >> 4);
+    hbrmt[6] = (upipe_rtp_hbrmt->frate << 4) | (upipe_rtp_hbrmt->sample & 0xf);
+}
+
+/** @internal @This handles data.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref uref structure
+ * @param upump_p reference to pump that generated the buffer
+ */
+static void upipe_rtp_hbrmt_input(struct upipe *upipe, struct uref *uref,
+                                  struct upump **upump_p)
+{
+    struct upipe_rtp_hbrmt *upipe_rtp_hbrmt = upipe_rtp_hbrmt_from_upipe(upipe);
+
+    size_t size;
+    if (unlikely(!ubase_check(uref_block_size(uref, &size)) || !size)) {
+        upipe_warn(upipe, "received empty frame");
+        uref_free(uref);
+        return;
+    }
+
+    /* timestamp (program clock ref, fallback to system clock ref),
+     * shared by all the datagrams of the frame */
+    uint64_t cr = 0;
+    if (unlikely(!ubase_check(uref_clock_get_cr_prog(uref, &cr))))
+        uref_clock_get_cr_sys(uref, &cr);
+    uint32_t ts = cr;
+
+    uint64_t cr_sys;
+    bool has_cr_sys = ubase_check(uref_clock_get_cr_sys(uref, &cr_sys));
+    uint64_t duration;
+    if (!ubase_check(uref_clock_get_duration(uref, &duration)))
+        duration = upipe_rtp_hbrmt->frame_duration;
+
+    unsigned int nb_packets = (size + HBRMT_DATA_SIZE - 1) / HBRMT_DATA_SIZE;
+    for (unsigned int i = 0; i < nb_packets; i++) {
+        size_t offset = i * HBRMT_DATA_SIZE;
+        size_t data_size = size - offset;
+        if (data_size > HBRMT_DATA_SIZE)
+            data_size = HBRMT_DATA_SIZE;
+
+        struct ubuf *header = ubuf_block_alloc(uref->ubuf->mgr,
+                RTP_HEADER_SIZE + HBRMT_HEADER_SIZE);
+        if (unlikely(header == NULL)) {
+            upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+            break;
+        }
+        uint8_t *buf;
+        int header_size = -1;
+        ubuf_block_write(header, 0, &header_size, &buf);
+        upipe_rtp_hbrmt_write_header(upipe, buf, ts, i == nb_packets - 1);
+        ubuf_block_unmap(header, 0);
+
+        /* reference the SDI data of the frame rather than copying it */
+        struct ubuf *payload = ubuf_block_splice(uref->ubuf, offset,
+                                                 data_size);
+        if (unlikely(payload == NULL ||
+                     !ubase_check(ubuf_block_append(header, payload)))) {
+            if (payload != NULL)
+                ubuf_free(payload);
+            ubuf_free(header);
+            upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+            break;
+        }
+
+        if (data_size < HBRMT_DATA_SIZE) {
+            if (upipe_rtp_hbrmt->padding == NULL) {
+                upipe_rtp_hbrmt->padding = ubuf_block_alloc(uref->ubuf->mgr,
+                                                            HBRMT_DATA_SIZE);
+                uint8_t *zero;
+                int zero_size = -1;
+                if (upipe_rtp_hbrmt->padding != NULL &&
+                    ubase_check(ubuf_block_write(upipe_rtp_hbrmt->padding, 0,
+                                                 &zero_size, &zero))) {
+                    memset(zero, 0, zero_size);
+                    ubuf_block_unmap(upipe_rtp_hbrmt->padding, 0);
+                }
+            }
+            struct ubuf *padding = upipe_rtp_hbrmt->padding != NULL ?
+                ubuf_block_splice(upipe_rtp_hbrmt->padding, 0,
+                                  HBRMT_DATA_SIZE - data_size) : NULL;
+            if (unlikely(padding == NULL ||
+                         !ubase_check(ubuf_block_append(header, padding)))) {
+                if (padding != NULL)
+                    ubuf_free(padding);
+                ubuf_free(header);
+                upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+                break;
+            }
+        }
+
+        struct uref *packet = uref_fork(uref, header);
+        if (unlikely(packet == NULL)) {
+            ubuf_free(header);
+            upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+            break;
+        }
+        /* spread the datagrams over the duration of the frame */
+        if (has_cr_sys)
+            uref_clock_set_cr_sys(packet,
+                                  cr_sys + duration * i / nb_packets);
+        uref_clock_set_duration(packet, duration / nb_packets);
+        upipe_rtp_hbrmt_output(upipe, packet, upump_p);
+    }
+
+    upipe_rtp_hbrmt->frame_count++;
+    uref_free(uref);
+}
+
+/** @internal @This sets the input flow definition.
+ *
+ * @param upipe description structure of the pipe
+ * @param flow_def flow definition packet
+ * @return an error code
+ */
+static int upipe_rtp_hbrmt_set_flow_def(struct upipe *upipe,
+                                        struct uref *flow_def)
+{
+    struct upipe_rtp_hbrmt *upipe_rtp_hbrmt = upipe_rtp_hbrmt_from_upipe(upipe);
+    if (flow_def == NULL)
+        return UBASE_ERR_INVALID;
+    const char *def;
+    UBASE_RETURN(uref_flow_get_def(flow_def, &def))
+    if (ubase_ncmp(def, EXPECTED_FLOW_DEF))
+        return UBASE_ERR_INVALID;
+
+    struct urational fps;
+    upipe_rtp_hbrmt->frame_duration = 0;
+    if (ubase_check(uref_pic_flow_get_fps(flow_def, &fps)) && fps.num)
+        upipe_rtp_hbrmt->frame_duration = UCLOCK_FREQ * fps.den / fps.num;
+
+    struct uref *flow_def_dup;
+    if ((flow_def_dup = uref_dup(flow_def)) == NULL)
+        return UBASE_ERR_ALLOC;
+    if (!ubase_check(uref_flow_set_def_va(flow_def_dup, OUT_FLOW"%s",
+                              def + strlen(EXPECTED_FLOW_DEF)))) {
+        uref_free(flow_def_dup);
+        return UBASE_ERR_ALLOC;
+    }
+
+    upipe_rtp_hbrmt_store_flow_def(upipe, flow_def_dup);
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This sets the video source format fields.
+ *
+ * @param upipe description structure of the pipe
+ * @param clock code of the SDI clock frequency
+ * @param frame code of the frame format
+ * @param frate code of the frame rate
+ * @param sample code of the sample structure
+ * @return an error code
+ */
+static int _upipe_rtp_hbrmt_set_format(struct upipe *upipe, uint8_t clock,
+                                       uint8_t frame, uint8_t frate,
+                                       uint8_t sample)
+{
+    struct upipe_rtp_hbrmt *upipe_rtp_hbrmt = upipe_rtp_hbrmt_from_upipe(upipe);
+    if (clock > 0xf || sample > 0xf)
+        return UBASE_ERR_INVALID;
+
+    upipe_rtp_hbrmt->format = true;
+    upipe_rtp_hbrmt->clock = clock;
+    upipe_rtp_hbrmt->frame = frame;
+    upipe_rtp_hbrmt->frate = frate;
+    upipe_rtp_hbrmt->sample = sample;
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This processes control commands on a rtp_hbrmt pipe.
+ *
+ * @param upipe description structure of the pipe
+ * @param command type of command to process
+ * @param args arguments of the command
+ * @return an error code
+ */
+static int upipe_rtp_hbrmt_control(struct upipe *upipe,
+                                   int command, va_list args)
+{
+    UBASE_HANDLED_RETURN(
+        upipe_rtp_hbrmt_control_output(upipe, command, args));
+    switch (command) {
+        case UPIPE_SET_FLOW_DEF: {
+            struct uref *flow_def = va_arg(args, struct uref *);
+            return upipe_rtp_hbrmt_set_flow_def(upipe, flow_def);
+        }
+
+        case UPIPE_RTP_HBRMT_SET_FORMAT: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_RTP_HBRMT_SIGNATURE)
+            unsigned int clock = va_arg(args, unsigned int);
+            unsigned int frame = va_arg(args, unsigned int);
+            unsigned int frate = va_arg(args, unsigned int);
+            unsigned int sample = va_arg(args, unsigned int);
+            return _upipe_rtp_hbrmt_set_format(upipe, clock, frame, frate,
+                                               sample);
+        }
+
+        default:
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** @internal @This allocates a rtp_hbrmt pipe.
+ *
+ * @param mgr common management structure
+ * @param uprobe structure used to raise events
+ * @param signature signature of the pipe allocator
+ * @param args optional arguments
+ * @return pointer to upipe or NULL in case of allocation error
+ */
+static struct upipe *upipe_rtp_hbrmt_alloc(struct upipe_mgr *mgr,
+                                           struct uprobe *uprobe,
+                                           uint32_t signature, va_list args)
+{
+    struct upipe *upipe = upipe_rtp_hbrmt_alloc_void(mgr, uprobe, signature,
+                                                     args);
+    if (unlikely(upipe == NULL))
+        return NULL;
+
+    struct upipe_rtp_hbrmt *upipe_rtp_hbrmt = upipe_rtp_hbrmt_from_upipe(upipe);
+    upipe_rtp_hbrmt_init_urefcount(upipe);
+    upipe_rtp_hbrmt_init_output(upipe);
+
+    upipe_rtp_hbrmt->frame_duration = 0;
+    upipe_rtp_hbrmt->padding = NULL;
+    upipe_rtp_hbrmt->seqnum = 0;
+    upipe_rtp_hbrmt->frame_count = 0;
+    upipe_rtp_hbrmt->format = false;
+    upipe_rtp_hbrmt->clock = 0;
+    upipe_rtp_hbrmt->frame = 0;
+    upipe_rtp_hbrmt->frate = 0;
+    upipe_rtp_hbrmt->sample = 0;
+
+    upipe_throw_ready(upipe);
+    return upipe;
+}
+
+/** @internal @This frees all resources allocated.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_rtp_hbrmt_free(struct upipe *upipe)
+{
+    struct upipe_rtp_hbrmt *upipe_rtp_hbrmt = upipe_rtp_hbrmt_from_upipe(upipe);
+    upipe_throw_dead(upipe);
+
+    if (upipe_rtp_hbrmt->padding != NULL)
+        ubuf_free(upipe_rtp_hbrmt->padding);
+    upipe_rtp_hbrmt_clean_output(upipe);
+    upipe_rtp_hbrmt_clean_urefcount(upipe);
+    upipe_rtp_hbrmt_free_void(upipe);
+}
+
+static struct upipe_mgr upipe_rtp_hbrmt_mgr = {
+    .refcount = NULL,
+    .signature = UPIPE_RTP_HBRMT_SIGNATURE,
+
+    .upipe_alloc = upipe_rtp_hbrmt_alloc,
+    .upipe_input = upipe_rtp_hbrmt_input,
+    .upipe_control = upipe_rtp_hbrmt_control,
+    .upipe_command_str = upipe_rtp_hbrmt_command_str,
+
+    .upipe_mgr_control = NULL
+};
+
+/** @This returns the management structure for rtp_hbrmt pipes.
+ *
+ * @return pointer to manager
+ */
+struct upipe_mgr *upipe_rtp_hbrmt_mgr_alloc(void)
+{
+    return &upipe_rtp_hbrmt_mgr;
+}
@@ -38,12 +38,17 @@
 #include <upipe/upipe_helper_ubuf_mgr.h>
 #include <upipe/upipe_helper_output.h>
 #include <upipe/upipe_helper_input.h>
+#include <upipe/uslices.h>
+#include <upipe/ucpu.h>
 
 #include <upipe-hbrmt/upipe_unpack10bit.h>
 
 #include "sdidec.h"
 
 #define UBUF_ALIGN 32 /* 256-bits simd (avx2) */
+/** ranges of octets unpacked by threads are multiples of this, so that they
+ * start on aligned output (128 samples) and end on a whole simd iteration */
+#define UPIPE_UNPACK10BIT_SLICE_SIZE 160
 
 /** upipe_unpack10bit structure with unpack10bit parameters */
 struct upipe_unpack10bit {
@@ -77,6 +82,11 @@ struct upipe_unpack10bit {
 
     /** unpacking */
     void (*unpack)(const uint8_t *src, uint16_t *y, int64_t size);
+    /** instruction set extensions allowed for the kernels */
+    uint32_t cpu_flags;
+
+    /** worker threads unpacking ranges of samples, or NULL */
+    struct uslices *uslices;
 
     /** public upipe structure */
     struct upipe upipe;
@@ -98,6 +108,44 @@ UPIPE_HELPER_UBUF_MGR(upipe_unpack10bit, ubuf_mgr, flow_format, ubuf_mgr_request
                       upipe_unpack10bit_unregister_output_request)
 UPIPE_HELPER_INPUT(upipe_unpack10bit, urefs, nb_urefs, max_urefs, blockers, upipe_unpack10bit_handle)
 
+/** @internal @This describes a buffer being unpacked. */
+struct upipe_unpack10bit_frame {
+    /** pointer to the pipe */
+    struct upipe_unpack10bit *upipe_unpack10bit;
+    /** input buffer */
+    const uint8_t *input;
+    /** output buffer */
+    uint16_t *out;
+    /** size of the input buffer in octets */
+    int input_size;
+};
+
+/** @internal @This unpacks a range of samples of a buffer.
+ *
+ * @param opaque pointer to the description of the buffer
+ * @param slice index of the range of samples
+ * @param nb_slices number of ranges of samples
+ */
+static void upipe_unpack10bit_unpack_slice(void *opaque, unsigned int slice,
+                                           unsigned int nb_slices)
+{
+    const struct upipe_unpack10bit_frame *frame = opaque;
+    const struct upipe_unpack10bit *upipe_unpack10bit =
+        frame->upipe_unpack10bit;
+    int units = frame->input_size / UPIPE_UNPACK10BIT_SLICE_SIZE;
+    int start = (int64_t)units * slice / nb_slices *
+                UPIPE_UNPACK10BIT_SLICE_SIZE;
+    int end = (int64_t)units * (slice + 1) / nb_slices *
+              UPIPE_UNPACK10BIT_SLICE_SIZE;
+    if (slice == nb_slices - 1)
+        end = frame->input_size;
+    if (end == start)
+        return;
+
+    upipe_unpack10bit->unpack(frame->input + start,
+                              frame->out + start * 8 / 10, end - start);
+}
+
 /** @internal @This handles data.
  *
  * @param upipe description structure of the pipe
@@ -146,7 +194,13 @@ static bool upipe_unpack10bit_handle(struct upipe *upipe, struct uref *uref,
         return true;
     }
 
-    upipe_unpack10bit->unpack(input, (uint16_t *)out, input_size);
+    struct upipe_unpack10bit_frame frame;
+    frame.upipe_unpack10bit = upipe_unpack10bit;
+    frame.input = input;
+    frame.out = (uint16_t *)out;
+    frame.input_size = input_size;
+    uslices_run(upipe_unpack10bit->uslices, upipe_unpack10bit_unpack_slice,
+                &frame, uslices_get_threads(upipe_unpack10bit->uslices));
 
     ubuf_block_unmap(ubuf_out, 0);
     uref_block_unmap(uref, 0);
@@ -272,6 +326,69 @@ static int upipe_unpack10bit_set_flow_def(struct upipe *upipe, struct uref *flow
     return UBASE_ERR_NONE;
 }
 
+/** @internal @This sets the number of threads unpacking the buffers.
+ *
+ * @param upipe description structure of the pipe
+ * @param nb_threads number of threads, or 0
+ * @return an error code
+ */
+static int upipe_unpack10bit_set_nb_threads(struct upipe *upipe,
+                                            unsigned int nb_threads)
+{
+    struct upipe_unpack10bit *upipe_unpack10bit = upipe_unpack10bit_from_upipe(upipe);
+    uslices_free(upipe_unpack10bit->uslices);
+    upipe_unpack10bit->uslices = NULL;
+    if (nb_threads <= 1)
+        return UBASE_ERR_NONE;
+
+    /* the thread of the pipe processes a range of samples too */
+    upipe_unpack10bit->uslices = uslices_alloc(nb_threads - 1);
+    if (unlikely(upipe_unpack10bit->uslices == NULL)) {
+        upipe_err(upipe, "unable to create unpacking threads");
+        return UBASE_ERR_EXTERNAL;
+    }
+    upipe_dbg_va(upipe, "unpacking with %u threads", nb_threads);
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This describes an implementation of the unpacking kernel. */
+struct upipe_unpack10bit_kernel {
+    /** required instruction set extensions */
+    uint32_t cpu_flags;
+    /** unpacking function */
+    void (*unpack)(const uint8_t *src, uint16_t *y, int64_t size);
+};
+
+/** @internal @This lists the kernels, from the most to the least preferred */
+static const struct upipe_unpack10bit_kernel upipe_unpack10bit_kernels[] = {
+#if defined(__x86_64__)
+    { UCPU_AVX512, upipe_sdi_unpack_10_avx512 },
+#endif
+#if defined(__aarch64__) && !defined(__AARCH64EB__)
+    { UCPU_NEON, upipe_sdi_unpack_10_neon },
+#endif
+#if defined(HAVE_X86ASM)
+#if defined(__i686__) || defined(__x86_64__)
+    { UCPU_AVX2, upipe_sdi_unpack_10_avx2 },
+    { UCPU_SSSE3, upipe_sdi_unpack_10_ssse3 },
+#endif
+#endif
+    { 0, upipe_sdi_unpack_c },
+};
+
+/** @internal @This selects the unpacking function.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_unpack10bit_setup_asm(struct upipe *upipe)
+{
+    struct upipe_unpack10bit *upipe_unpack10bit = upipe_unpack10bit_from_upipe(upipe);
+    const struct upipe_unpack10bit_kernel *kernel =
+        ucpu_select(upipe_unpack10bit_kernels,
+                    ucpu_flags() & upipe_unpack10bit->cpu_flags);
+    upipe_unpack10bit->unpack = kernel->unpack;
+}
+
 /** @internal @This processes control commands on a file source pipe, and
  * checks the status of the pipe afterwards.
  *
@@ -307,6 +424,17 @@ static int upipe_unpack10bit_control(struct upipe *upipe, int command, va_list a
             struct uref *flow = va_arg(args, struct uref *);
             return upipe_unpack10bit_set_flow_def(upipe, flow);
         }
+        case UPIPE_SET_CPU_FLAGS: {
+            struct upipe_unpack10bit *upipe_unpack10bit = upipe_unpack10bit_from_upipe(upipe);
+            upipe_unpack10bit->cpu_flags = va_arg(args, uint32_t);
+            upipe_unpack10bit_setup_asm(upipe);
+            return UBASE_ERR_NONE;
+        }
+        case UPIPE_UNPACK10BIT_SET_THREADS: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_UNPACK10BIT_SIGNATURE)
+            unsigned int nb_threads = va_arg(args, unsigned int);
+            return upipe_unpack10bit_set_nb_threads(upipe, nb_threads);
+        }
         default:
             return UBASE_ERR_UNHANDLED;
     }
@@ -330,16 +458,10 @@ static struct upipe *upipe_unpack10bit_alloc(struct upipe_mgr *mgr,
 
     struct upipe_unpack10bit *upipe_unpack10bit = upipe_unpack10bit_from_upipe(upipe);
 
-    upipe_unpack10bit->unpack = upipe_sdi_unpack_c;
-#if defined(HAVE_X86ASM)
-#if defined(__i686__) || defined(__x86_64__)
-    if (__builtin_cpu_supports("ssse3"))
-        upipe_unpack10bit->unpack = upipe_sdi_unpack_10_ssse3;
+    upipe_unpack10bit->cpu_flags = UCPU_ALL;
+    upipe_unpack10bit_setup_asm(upipe);
 
-    if (__builtin_cpu_supports("avx2"))
-        upipe_unpack10bit->unpack = upipe_sdi_unpack_10_avx2;
-#endif
-#endif
+    upipe_unpack10bit->uslices = NULL;
 
     upipe_unpack10bit_init_urefcount(upipe);
     upipe_unpack10bit_init_ubuf_mgr(upipe);
@@ -356,7 +478,9 @@ static struct upipe *upipe_unpack10bit_alloc(struct upipe_mgr *mgr,
  */
 static void upipe_unpack10bit_free(struct upipe *upipe)
 {
+    struct upipe_unpack10bit *upipe_unpack10bit = upipe_unpack10bit_from_upipe(upipe);
     upipe_throw_dead(upipe);
+    uslices_free(upipe_unpack10bit->uslices);
     upipe_unpack10bit_clean_input(upipe);
     upipe_unpack10bit_clean_output(upipe);
     upipe_unpack10bit_clean_ubuf_mgr(upipe);
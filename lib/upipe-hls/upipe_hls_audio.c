@@ -120,7 +120,16 @@ static int upipe_hls_audio_check_source_mgr(struct upipe *upipe)
     return UBASE_ERR_NONE;
 }
 
-static int upipe_hls_audio_reload(struct upipe *upipe)
+/** @internal @This reloads the playlist. For a blocking reload, the server
+ * answers once the given partial segment is available.
+ *
+ * @param upipe description structure of the pipe
+ * @param msn media sequence number to wait for, or UINT64_MAX
+ * @param part partial segment to wait for
+ * @return an error code
+ */
+static int upipe_hls_audio_reload(struct upipe *upipe,
+                                  uint64_t msn, uint64_t part)
 {
     struct upipe_hls_audio *upipe_hls_audio =
         upipe_hls_audio_from_upipe(upipe);
@@ -140,7 +149,15 @@ static int upipe_hls_audio_reload(struct upipe *upipe)
         return ret;
     }
 
-    upipe_dbg_va(upipe, "reloading %s", upipe_hls_audio->uri);
+    const char *uri = upipe_hls_audio->uri;
+    char blocking_uri[(uri != NULL ? strlen(uri) : 0) + 64];
+    if (msn != UINT64_MAX && uri != NULL) {
+        snprintf(blocking_uri, sizeof (blocking_uri),
+                 "%s%c_HLS_msn=%"PRIu64"&_HLS_part=%"PRIu64,
+                 uri, strchr(uri, '?') != NULL ? '&' : '?', msn, part);
+        uri = blocking_uri;
+    }
+    upipe_dbg_va(upipe, "reloading %s", uri);
 
     struct upipe *inner = upipe_void_alloc(
         upipe_hls_audio->source_mgr,
@@ -154,7 +171,7 @@ static int upipe_hls_audio_reload(struct upipe *upipe)
         return UBASE_ERR_INVALID;
     }
 
-    ret = upipe_set_uri(inner, upipe_hls_audio->uri);
+    ret = upipe_set_uri(inner, uri);
     if (unlikely(!ubase_check(ret))) {
         upipe_release(inner);
         return ret;
@@ -233,7 +250,13 @@ static int probe_playlist(struct uprobe *uprobe, struct upipe *inner,
         case UPIPE_HLS_PLAYLIST_SIGNATURE:
             switch (event) {
             case UPROBE_HLS_PLAYLIST_NEED_RELOAD:
-                return upipe_hls_audio_reload(upipe);
+                return upipe_hls_audio_reload(upipe, UINT64_MAX, 0);
+            case UPROBE_HLS_PLAYLIST_NEED_BLOCKING_RELOAD: {
+                UBASE_SIGNATURE_CHECK(args, UPIPE_HLS_PLAYLIST_SIGNATURE);
+                uint64_t msn = va_arg(args, uint64_t);
+                uint64_t part = va_arg(args, uint64_t);
+                return upipe_hls_audio_reload(upipe, msn, part);
+            }
             }
         }
     }
@@ -260,6 +283,9 @@ static int probe_src(struct uprobe *uprobe, struct upipe *inner,
                              UPROBE_LOG_VERBOSE, "m3u"));
         upipe_mgr_release(upipe_m3u_reader_mgr);
         UBASE_ALLOC_RETURN(output);
+        if (unlikely(!ubase_check(upipe_m3u_reader_set_incremental(
+                        output, true))))
+            upipe_warn(upipe, "fail to enable incremental playlist refresh");
 
         /* playlist pipe
         */
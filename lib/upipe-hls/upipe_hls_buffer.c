@@ -60,6 +60,10 @@ struct upipe_hls_buffer {
     struct uchain blockers;
     struct uchain buffer;
     uint64_t max_duration;
+    /** octets retained in the buffer */
+    uint64_t size;
+    /** maximum octets retained in the buffer, or 0 for no limit */
+    uint64_t max_size;
     struct ueventfd ueventfd;
 };
 
@@ -98,6 +102,8 @@ static struct upipe *upipe_hls_buffer_alloc(struct upipe_mgr *mgr,
     ulist_init(&upipe_hls_buffer->buffer);
     ueventfd_init(&upipe_hls_buffer->ueventfd, false);
     upipe_hls_buffer->max_duration = DEFAULT_MAX_DURATION;
+    upipe_hls_buffer->size = 0;
+    upipe_hls_buffer->max_size = 0;
 
     upipe_throw_ready(upipe);
 
@@ -149,6 +155,12 @@ static void upipe_hls_buffer_worker(struct upump *upump)
     struct uref *uref = uref_from_uchain(uchain);
     ueventfd_write(&upipe_hls_buffer->ueventfd);
 
+    size_t size;
+    if (ubase_check(uref_block_size(uref, &size))) {
+        assert(upipe_hls_buffer->size >= size);
+        upipe_hls_buffer->size -= size;
+    }
+
     const char *flow_def;
     if (unlikely(ubase_check(uref_flow_get_def(uref, &flow_def))))
         upipe_hls_buffer_store_flow_def(upipe, uref);
@@ -163,9 +175,18 @@ static bool upipe_hls_buffer_process(struct upipe *upipe,
     struct upipe_hls_buffer *upipe_hls_buffer =
         upipe_hls_buffer_from_upipe(upipe);
 
+    size_t size = 0;
+    uref_block_size(uref, &size);
+    /* keep at least one uref so that the output is never starved */
+    if (upipe_hls_buffer->max_size &&
+        upipe_hls_buffer->size + size > upipe_hls_buffer->max_size &&
+        !ulist_empty(&upipe_hls_buffer->buffer))
+        return false;
+
     uint64_t pts;
     if (unlikely(!ubase_check(uref_clock_get_pts_prog(uref, &pts)))) {
         upipe_warn(upipe, "non dated uref");
+        upipe_hls_buffer->size += size;
         ulist_add(&upipe_hls_buffer->buffer, uref_to_uchain(uref));
         return true;
     }
@@ -189,6 +210,7 @@ static bool upipe_hls_buffer_process(struct upipe *upipe,
         break;
     }
 
+    upipe_hls_buffer->size += size;
     ulist_add(&upipe_hls_buffer->buffer, uref_to_uchain(uref));
     return true;
 }
@@ -208,6 +230,50 @@ static void upipe_hls_buffer_input(struct upipe *upipe,
     ueventfd_write(&upipe_hls_buffer->ueventfd);
 }
 
+static int _upipe_hls_buffer_set_max_size(struct upipe *upipe,
+                                          uint64_t max_size)
+{
+    struct upipe_hls_buffer *upipe_hls_buffer =
+        upipe_hls_buffer_from_upipe(upipe);
+    upipe_hls_buffer->max_size = max_size;
+    /* the held urefs may fit now */
+    ueventfd_write(&upipe_hls_buffer->ueventfd);
+    return UBASE_ERR_NONE;
+}
+
+static int _upipe_hls_buffer_get_duration(struct upipe *upipe,
+                                          uint64_t *duration_p)
+{
+    struct upipe_hls_buffer *upipe_hls_buffer =
+        upipe_hls_buffer_from_upipe(upipe);
+    uint64_t first = UINT64_MAX, last = 0;
+    struct uchain *uchain;
+    ulist_foreach(&upipe_hls_buffer->buffer, uchain) {
+        uint64_t pts;
+        if (!ubase_check(uref_clock_get_pts_prog(uref_from_uchain(uchain),
+                                                 &pts)))
+            continue;
+        if (pts < first)
+            first = pts;
+        if (pts > last)
+            last = pts;
+    }
+    *duration_p = first < last ? last - first : 0;
+    return UBASE_ERR_NONE;
+}
+
+static int upipe_hls_buffer_get_occupancy(struct upipe *upipe,
+                                          struct upipe_occupancy *occupancy)
+{
+    struct upipe_hls_buffer *upipe_hls_buffer =
+        upipe_hls_buffer_from_upipe(upipe);
+    occupancy->urefs = ulist_depth(&upipe_hls_buffer->buffer) +
+                       upipe_hls_buffer->nb_urefs;
+    occupancy->max_urefs = 0;
+    occupancy->bytes = upipe_hls_buffer->size;
+    return _upipe_hls_buffer_get_duration(upipe, &occupancy->duration);
+}
+
 static int _upipe_hls_buffer_control(struct upipe *upipe,
                                      int command,
                                      va_list args)
@@ -223,6 +289,22 @@ static int _upipe_hls_buffer_control(struct upipe *upipe,
         struct uref *flow_def = va_arg(args, struct uref *);
         return upipe_hls_buffer_set_flow_def(upipe, flow_def);
     }
+    case UPIPE_GET_OCCUPANCY: {
+        struct upipe_occupancy *occupancy =
+            va_arg(args, struct upipe_occupancy *);
+        return upipe_hls_buffer_get_occupancy(upipe, occupancy);
+    }
+
+    case UPIPE_HLS_BUFFER_SET_MAX_SIZE: {
+        UBASE_SIGNATURE_CHECK(args, UPIPE_HLS_BUFFER_SIGNATURE);
+        uint64_t max_size = va_arg(args, uint64_t);
+        return _upipe_hls_buffer_set_max_size(upipe, max_size);
+    }
+    case UPIPE_HLS_BUFFER_GET_DURATION: {
+        UBASE_SIGNATURE_CHECK(args, UPIPE_HLS_BUFFER_SIGNATURE);
+        uint64_t *duration_p = va_arg(args, uint64_t *);
+        return _upipe_hls_buffer_get_duration(upipe, duration_p);
+    }
     }
     return UBASE_ERR_UNHANDLED;
 }
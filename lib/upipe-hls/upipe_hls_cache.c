@@ -0,0 +1,440 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short in-memory cache of HLS media segments
+ */
+
+#include <upipe-hls/upipe_hls_cache.h>
+
+#include <upipe/urefcount.h>
+#include <upipe/uref_block.h>
+#include <upipe/uref.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+/** @internal @This is a segment of the cache. */
+struct upipe_hls_cache_entry {
+    /** link in the LRU list of the cache */
+    struct uchain uchain;
+    /** cache the entry belongs to */
+    struct upipe_hls_cache *cache;
+    /** number of references */
+    unsigned refcount;
+    /** segment key */
+    char *key;
+    /** flow definition of the segment */
+    struct uref *flow_def;
+    /** list of urefs */
+    struct uchain urefs;
+    /** size of the urefs in octets */
+    uint64_t size;
+    /** no more urefs will be appended */
+    bool complete;
+    /** the download failed, the entry is no longer in the cache */
+    bool aborted;
+    /** list of listeners */
+    struct uchain listeners;
+};
+
+UBASE_FROM_TO(upipe_hls_cache_entry, uchain, uchain, uchain);
+
+/** @internal @This is the private context of a segment cache. */
+struct upipe_hls_cache {
+    /** refcount management structure */
+    struct urefcount urefcount;
+    /** entries, from least to most recently used */
+    struct uchain lru;
+    /** total size of the entries in octets */
+    uint64_t size;
+    /** maximum size in octets */
+    uint64_t max_size;
+    /** number of segments to prefetch */
+    unsigned prefetch;
+};
+
+UBASE_FROM_TO(upipe_hls_cache, urefcount, urefcount, urefcount);
+
+/** @internal @This frees an entry.
+ *
+ * @param entry pointer to the entry
+ */
+static void upipe_hls_cache_entry_free(struct upipe_hls_cache_entry *entry)
+{
+    struct uchain *uchain, *uchain_tmp;
+    ulist_delete_foreach(&entry->urefs, uchain, uchain_tmp) {
+        ulist_delete(uchain);
+        uref_free(uref_from_uchain(uchain));
+    }
+    uref_free(entry->flow_def);
+    free(entry->key);
+    free(entry);
+}
+
+/** @internal @This removes an entry from the cache.
+ *
+ * @param entry pointer to the entry
+ */
+static void upipe_hls_cache_remove(struct upipe_hls_cache_entry *entry)
+{
+    ulist_delete(upipe_hls_cache_entry_to_uchain(entry));
+    entry->cache->size -= entry->size;
+}
+
+/** @internal @This evicts the least recently used entries which are not
+ * referenced, until the size of the cache gets below the limit.
+ *
+ * @param cache pointer to the cache
+ */
+static void upipe_hls_cache_evict(struct upipe_hls_cache *cache)
+{
+    struct uchain *uchain, *uchain_tmp;
+    ulist_delete_foreach(&cache->lru, uchain, uchain_tmp) {
+        if (cache->size <= cache->max_size)
+            break;
+        struct upipe_hls_cache_entry *entry =
+            upipe_hls_cache_entry_from_uchain(uchain);
+        if (entry->refcount || !entry->complete)
+            continue;
+        upipe_hls_cache_remove(entry);
+        upipe_hls_cache_entry_free(entry);
+    }
+}
+
+/** @internal @This notifies the listeners of an entry.
+ *
+ * @param entry pointer to the entry
+ */
+static void upipe_hls_cache_entry_notify(struct upipe_hls_cache_entry *entry)
+{
+    struct uchain *uchain, *uchain_tmp;
+    ulist_delete_foreach(&entry->listeners, uchain, uchain_tmp) {
+        struct upipe_hls_cache_listener *listener =
+            upipe_hls_cache_listener_from_uchain(uchain);
+        listener->cb(listener);
+    }
+}
+
+/** @internal @This frees a cache.
+ *
+ * @param urefcount pointer to the urefcount structure
+ */
+static void upipe_hls_cache_free(struct urefcount *urefcount)
+{
+    struct upipe_hls_cache *cache = upipe_hls_cache_from_urefcount(urefcount);
+    struct uchain *uchain;
+    while ((uchain = ulist_pop(&cache->lru)) != NULL)
+        upipe_hls_cache_entry_free(upipe_hls_cache_entry_from_uchain(uchain));
+    urefcount_clean(urefcount);
+    free(cache);
+}
+
+/** @This allocates a segment cache.
+ *
+ * @param max_size maximum size of the cached segments, in octets
+ * @param prefetch number of segments to prefetch after the current one
+ * @return pointer to the cache or NULL in case of allocation error
+ */
+struct upipe_hls_cache *upipe_hls_cache_alloc(uint64_t max_size,
+                                              unsigned prefetch)
+{
+    struct upipe_hls_cache *cache = malloc(sizeof (*cache));
+    if (unlikely(cache == NULL))
+        return NULL;
+    urefcount_init(upipe_hls_cache_to_urefcount(cache), upipe_hls_cache_free);
+    ulist_init(&cache->lru);
+    cache->size = 0;
+    cache->max_size = max_size;
+    cache->prefetch = prefetch;
+    return cache;
+}
+
+/** @This increments the reference count of a cache.
+ *
+ * @param cache pointer to the cache
+ * @return the cache
+ */
+struct upipe_hls_cache *upipe_hls_cache_use(struct upipe_hls_cache *cache)
+{
+    if (cache != NULL)
+        urefcount_use(upipe_hls_cache_to_urefcount(cache));
+    return cache;
+}
+
+/** @This decrements the reference count of a cache, and frees it when it
+ * reaches 0.
+ *
+ * @param cache pointer to the cache, may be NULL
+ */
+void upipe_hls_cache_release(struct upipe_hls_cache *cache)
+{
+    if (cache != NULL)
+        urefcount_release(upipe_hls_cache_to_urefcount(cache));
+}
+
+/** @This sets the maximum size of the cached segments, evicting segments if
+ * needed.
+ *
+ * @param cache pointer to the cache
+ * @param max_size maximum size in octets
+ */
+void upipe_hls_cache_set_max_size(struct upipe_hls_cache *cache,
+                                  uint64_t max_size)
+{
+    cache->max_size = max_size;
+    upipe_hls_cache_evict(cache);
+}
+
+/** @This returns the number of segments to prefetch after the current one.
+ *
+ * @param cache pointer to the cache
+ * @return the number of segments
+ */
+unsigned upipe_hls_cache_get_prefetch(struct upipe_hls_cache *cache)
+{
+    return cache->prefetch;
+}
+
+/** @This sets the number of segments to prefetch after the current one.
+ *
+ * @param cache pointer to the cache
+ * @param prefetch number of segments, 0 disables prefetching
+ */
+void upipe_hls_cache_set_prefetch(struct upipe_hls_cache *cache,
+                                  unsigned prefetch)
+{
+    cache->prefetch = prefetch;
+}
+
+/** @This looks up a segment, either complete or being downloaded, and marks
+ * it as most recently used.
+ *
+ * @param cache pointer to the cache
+ * @param key segment key
+ * @return a new reference to the entry, or NULL if it is not in the cache
+ */
+struct upipe_hls_cache_entry *upipe_hls_cache_find(struct upipe_hls_cache *cache,
+                                                   const char *key)
+{
+    struct uchain *uchain;
+    ulist_foreach_reverse(&cache->lru, uchain) {
+        struct upipe_hls_cache_entry *entry =
+            upipe_hls_cache_entry_from_uchain(uchain);
+        if (strcmp(entry->key, key))
+            continue;
+        ulist_delete(uchain);
+        ulist_add(&cache->lru, uchain);
+        return upipe_hls_cache_entry_use(entry);
+    }
+    return NULL;
+}
+
+/** @This adds a new segment being downloaded. The caller must either
+ * complete or abort it.
+ *
+ * @param cache pointer to the cache
+ * @param key segment key
+ * @return a reference to the entry, or NULL in case of allocation error
+ */
+struct upipe_hls_cache_entry *upipe_hls_cache_add(struct upipe_hls_cache *cache,
+                                                  const char *key)
+{
+    struct upipe_hls_cache_entry *entry = malloc(sizeof (*entry));
+    if (unlikely(entry == NULL))
+        return NULL;
+    entry->key = strdup(key);
+    if (unlikely(entry->key == NULL)) {
+        free(entry);
+        return NULL;
+    }
+    uchain_init(upipe_hls_cache_entry_to_uchain(entry));
+    entry->cache = cache;
+    entry->refcount = 1;
+    entry->flow_def = NULL;
+    ulist_init(&entry->urefs);
+    entry->size = 0;
+    entry->complete = false;
+    entry->aborted = false;
+    ulist_init(&entry->listeners);
+    ulist_add(&cache->lru, upipe_hls_cache_entry_to_uchain(entry));
+    return entry;
+}
+
+/** @This increments the reference count of an entry, which prevents its
+ * eviction.
+ *
+ * @param entry pointer to the entry
+ * @return the entry
+ */
+struct upipe_hls_cache_entry *
+    upipe_hls_cache_entry_use(struct upipe_hls_cache_entry *entry)
+{
+    entry->refcount++;
+    return entry;
+}
+
+/** @This decrements the reference count of an entry. An entry which is
+ * released by everyone before being completed is dropped.
+ *
+ * @param entry pointer to the entry, may be NULL
+ */
+void upipe_hls_cache_entry_release(struct upipe_hls_cache_entry *entry)
+{
+    if (entry == NULL || --entry->refcount)
+        return;
+
+    if (!entry->aborted) {
+        if (entry->complete) {
+            upipe_hls_cache_evict(entry->cache);
+            return;
+        }
+        upipe_hls_cache_remove(entry);
+    }
+    upipe_hls_cache_entry_free(entry);
+}
+
+/** @This sets the flow definition of the segment.
+ *
+ * @param entry pointer to the entry
+ * @param flow_def flow definition, belongs to the callee
+ */
+void upipe_hls_cache_entry_set_flow_def(struct upipe_hls_cache_entry *entry,
+                                        struct uref *flow_def)
+{
+    uref_free(entry->flow_def);
+    entry->flow_def = flow_def;
+}
+
+/** @This returns the flow definition of the segment.
+ *
+ * @param entry pointer to the entry
+ * @return the flow definition, or NULL if it is not known yet
+ */
+struct uref *
+    upipe_hls_cache_entry_get_flow_def(struct upipe_hls_cache_entry *entry)
+{
+    return entry->flow_def;
+}
+
+/** @This appends a buffer to a segment being downloaded.
+ *
+ * @param entry pointer to the entry
+ * @param uref buffer to append, belongs to the callee
+ */
+void upipe_hls_cache_entry_append(struct upipe_hls_cache_entry *entry,
+                                  struct uref *uref)
+{
+    size_t size = 0;
+    uref_block_size(uref, &size);
+    ulist_add(&entry->urefs, uref_to_uchain(uref));
+    entry->size += size;
+    if (!entry->aborted) {
+        entry->cache->size += size;
+        upipe_hls_cache_evict(entry->cache);
+    }
+    upipe_hls_cache_entry_notify(entry);
+}
+
+/** @This marks a segment as completely downloaded.
+ *
+ * @param entry pointer to the entry
+ */
+void upipe_hls_cache_entry_complete(struct upipe_hls_cache_entry *entry)
+{
+    entry->complete = true;
+    upipe_hls_cache_entry_notify(entry);
+}
+
+/** @This marks a segment as failed and removes it from the cache.
+ *
+ * @param entry pointer to the entry
+ */
+void upipe_hls_cache_entry_abort(struct upipe_hls_cache_entry *entry)
+{
+    if (entry->aborted)
+        return;
+    upipe_hls_cache_remove(entry);
+    entry->aborted = true;
+    entry->complete = true;
+    upipe_hls_cache_entry_notify(entry);
+}
+
+/** @This checks whether a segment is completely downloaded.
+ *
+ * @param entry pointer to the entry
+ * @return true if no more urefs will be appended
+ */
+bool upipe_hls_cache_entry_is_complete(struct upipe_hls_cache_entry *entry)
+{
+    return entry->complete;
+}
+
+/** @This checks whether a segment download failed.
+ *
+ * @param entry pointer to the entry
+ * @return true if the segment was aborted
+ */
+bool upipe_hls_cache_entry_is_aborted(struct upipe_hls_cache_entry *entry)
+{
+    return entry->aborted;
+}
+
+/** @This returns the list of urefs of a segment. The list may only grow
+ * while a reference to the entry is held.
+ *
+ * @param entry pointer to the entry
+ * @return pointer to the list of urefs
+ */
+struct uchain *upipe_hls_cache_entry_urefs(struct upipe_hls_cache_entry *entry)
+{
+    return &entry->urefs;
+}
+
+/** @This registers a listener on an entry.
+ *
+ * @param entry pointer to the entry
+ * @param listener pointer to the listener
+ */
+void upipe_hls_cache_entry_listen(struct upipe_hls_cache_entry *entry,
+                                  struct upipe_hls_cache_listener *listener)
+{
+    upipe_hls_cache_entry_unlisten(listener);
+    listener->entry = entry;
+    ulist_add(&entry->listeners,
+              upipe_hls_cache_listener_to_uchain(listener));
+}
+
+/** @This unregisters a listener.
+ *
+ * @param listener pointer to the listener
+ */
+void upipe_hls_cache_entry_unlisten(struct upipe_hls_cache_listener *listener)
+{
+    if (listener->entry == NULL)
+        return;
+    ulist_delete(upipe_hls_cache_listener_to_uchain(listener));
+    listener->entry = NULL;
+}
@@ -23,6 +23,8 @@
 
 #include <upipe-hls/upipe_hls_master.h>
 #include <upipe-hls/upipe_hls_variant.h>
+#include <upipe-hls/upipe_hls_playlist.h>
+#include <upipe-hls/upipe_hls_cache.h>
 
 #include <upipe-hls/uref_hls.h>
 
@@ -67,6 +69,11 @@ struct upipe_hls_master_sub {
     struct uref *flow_def;
 };
 
+/** @hidden */
+static int upipe_hls_master_sub_catch(struct uprobe *uprobe,
+                                      struct upipe *inner,
+                                      int event, va_list args);
+
 UPIPE_HELPER_UPIPE(upipe_hls_master_sub, upipe, UPIPE_HLS_MASTER_SUB_SIGNATURE);
 UPIPE_HELPER_UREFCOUNT(upipe_hls_master_sub, urefcount,
                        upipe_hls_master_sub_no_ref);
@@ -74,7 +81,7 @@ UPIPE_HELPER_UREFCOUNT_REAL(upipe_hls_master_sub, urefcount_real,
                             upipe_hls_master_sub_free);
 UPIPE_HELPER_FLOW(upipe_hls_master_sub, NULL);
 UPIPE_HELPER_UPROBE(upipe_hls_master_sub, urefcount_real,
-                    last_inner_probe, NULL);
+                    last_inner_probe, upipe_hls_master_sub_catch);
 UPIPE_HELPER_INNER(upipe_hls_master_sub, last_inner);
 UPIPE_HELPER_BIN_OUTPUT(upipe_hls_master_sub, last_inner, output, requests);
 
@@ -96,6 +103,8 @@ struct upipe_hls_master {
     struct uchain subs;
     /** variant id */
     uint64_t id;
+    /** segment cache shared by the variants */
+    struct upipe_hls_cache *cache;
 };
 
 UPIPE_HELPER_UPIPE(upipe_hls_master, upipe, UPIPE_HLS_MASTER_SIGNATURE)
@@ -104,6 +113,38 @@ UPIPE_HELPER_VOID(upipe_hls_master)
 UPIPE_HELPER_SUBPIPE(upipe_hls_master, upipe_hls_master_sub,
                      pipe, sub_mgr, subs, uchain);
 
+/** @internal @This catches the events of the inner variant pipe, and
+ * provides the segment cache of the master pipe to the playlists.
+ *
+ * @param uprobe structure used to raise events
+ * @param inner pointer to inner pipe
+ * @param event event thrown
+ * @param args optional arguments
+ * @return an error code
+ */
+static int upipe_hls_master_sub_catch(struct uprobe *uprobe,
+                                      struct upipe *inner,
+                                      int event, va_list args)
+{
+    struct upipe_hls_master_sub *upipe_hls_master_sub =
+        upipe_hls_master_sub_from_last_inner_probe(uprobe);
+    struct upipe *upipe = upipe_hls_master_sub_to_upipe(upipe_hls_master_sub);
+
+    if (event == UPROBE_HLS_PLAYLIST_NEED_CACHE &&
+        ubase_get_signature(args) == UPIPE_HLS_PLAYLIST_SIGNATURE) {
+        UBASE_SIGNATURE_CHECK(args, UPIPE_HLS_PLAYLIST_SIGNATURE);
+        struct upipe_hls_cache **cache_p =
+            va_arg(args, struct upipe_hls_cache **);
+        struct upipe_hls_master *upipe_hls_master =
+            upipe_hls_master_from_sub_mgr(upipe->mgr);
+        if (unlikely(upipe_hls_master->cache == NULL))
+            return UBASE_ERR_UNHANDLED;
+        *cache_p = upipe_hls_cache_use(upipe_hls_master->cache);
+        return UBASE_ERR_NONE;
+    }
+    return upipe_throw_proxy(upipe, inner, event, args);
+}
+
 /** @internal @This allocates a sub master pipe.
  *
  * @param mgr management structure for this pipe type
@@ -247,9 +288,15 @@ static struct upipe *upipe_hls_master_alloc(struct upipe_mgr *mgr,
     ulist_init(&upipe_hls_master->items);
     ulist_init(&upipe_hls_master->renditions);
     upipe_hls_master->id = 0;
+    upipe_hls_master->cache =
+        upipe_hls_cache_alloc(UPIPE_HLS_CACHE_DEFAULT_SIZE,
+                              UPIPE_HLS_CACHE_DEFAULT_PREFETCH);
 
     upipe_throw_ready(upipe);
 
+    if (unlikely(upipe_hls_master->cache == NULL))
+        upipe_warn(upipe, "unable to allocate segment cache");
+
     return upipe;
 }
 
@@ -282,6 +329,7 @@ static void upipe_hls_master_free(struct upipe *upipe)
     upipe_throw_dead(upipe);
 
     uref_free(upipe_hls_master->flow_def);
+    upipe_hls_cache_release(upipe_hls_master->cache);
     upipe_hls_master_flush(upipe);
     upipe_hls_master_clean_sub_pipes(upipe);
     upipe_hls_master_clean_urefcount(upipe);
@@ -445,6 +493,9 @@ static int upipe_hls_master_control(struct upipe *upipe,
                                     int command,
                                     va_list args)
 {
+    struct upipe_hls_master *upipe_hls_master =
+        upipe_hls_master_from_upipe(upipe);
+
     UBASE_HANDLED_RETURN(upipe_hls_master_control_pipes(upipe, command, args));
 
     switch (command) {
@@ -461,6 +512,24 @@ static int upipe_hls_master_control(struct upipe *upipe,
         struct uref **uref_p = va_arg(args, struct uref **);
         return upipe_hls_master_split_iterate(upipe, uref_p);
     }
+
+    case UPIPE_HLS_MASTER_SET_CACHE_SIZE: {
+        UBASE_SIGNATURE_CHECK(args, UPIPE_HLS_MASTER_SIGNATURE);
+        uint64_t size = va_arg(args, uint64_t);
+        if (unlikely(upipe_hls_master->cache == NULL))
+            return UBASE_ERR_INVALID;
+        upipe_hls_cache_set_max_size(upipe_hls_master->cache, size);
+        return UBASE_ERR_NONE;
+    }
+
+    case UPIPE_HLS_MASTER_SET_PREFETCH: {
+        UBASE_SIGNATURE_CHECK(args, UPIPE_HLS_MASTER_SIGNATURE);
+        unsigned int prefetch = va_arg(args, unsigned int);
+        if (unlikely(upipe_hls_master->cache == NULL))
+            return UBASE_ERR_INVALID;
+        upipe_hls_cache_set_prefetch(upipe_hls_master->cache, prefetch);
+        return UBASE_ERR_NONE;
+    }
     }
     return UBASE_ERR_UNHANDLED;
 }
@@ -26,6 +26,7 @@
  */
 
 #include <upipe-hls/upipe_hls_playlist.h>
+#include <upipe-hls/upipe_hls_cache.h>
 
 #include <upipe-modules/uref_aes_flow.h>
 #include <upipe-modules/upipe_probe_uref.h>
@@ -56,6 +57,7 @@
 #include <upipe/uref_uri.h>
 
 #include <upipe/uclock.h>
+#include <upipe/urefcount.h>
 
 #include <stdlib.h>
 #include <limits.h>
@@ -63,6 +65,8 @@
 
 /** @showvalue */
 #define EXPECTED_FLOW_DEF "block.m3u.playlist."
+/** maximum number of cached urefs output per pump iteration */
+#define REPLAY_BURST 16
 
 static int upipe_hls_playlist_throw_need_reload(struct upipe *upipe)
 {
@@ -85,6 +89,24 @@ static int upipe_hls_playlist_throw_item_end(struct upipe *upipe)
                        UPIPE_HLS_PLAYLIST_SIGNATURE);
 }
 
+static int upipe_hls_playlist_throw_need_blocking_reload(struct upipe *upipe,
+                                                        uint64_t msn,
+                                                        uint64_t part)
+{
+    upipe_dbg_va(upipe, "throw need blocking reload %"PRIu64".%"PRIu64,
+                 msn, part);
+    return upipe_throw(upipe, UPROBE_HLS_PLAYLIST_NEED_BLOCKING_RELOAD,
+                       UPIPE_HLS_PLAYLIST_SIGNATURE, msn, part);
+}
+
+static int upipe_hls_playlist_throw_need_cache(struct upipe *upipe,
+                                               struct upipe_hls_cache **cache_p)
+{
+    upipe_dbg(upipe, "throw need cache");
+    return upipe_throw(upipe, UPROBE_HLS_PLAYLIST_NEED_CACHE,
+                       UPIPE_HLS_PLAYLIST_SIGNATURE, cache_p);
+}
+
 /** @internal @This is the private context of a m3u playlist pipe. */
 struct upipe_hls_playlist {
     /** for urefcount helper */
@@ -126,11 +148,38 @@ struct upipe_hls_playlist {
     struct upump_mgr *upump_mgr;
     /** timer */
     struct upump *upump;
+    /** pump outputting the cached urefs */
+    struct upump *upump_replay;
+
+    /** shared segment cache, or NULL */
+    struct upipe_hls_cache *cache;
+    /** the segment cache was asked for */
+    bool cache_asked;
+    /** list of segment downloads */
+    struct uchain fetches;
+    /** cache entry being played */
+    struct upipe_hls_cache_entry *entry;
+    /** last uref of the entry already output */
+    struct uchain *entry_pos;
+    /** the flow definition of the entry was output */
+    bool entry_flow_def;
+    /** listener of the cache entry being played */
+    struct upipe_hls_cache_listener listener;
 
     /** current index in the playlist */
     uint64_t index;
+    /** current partial segment in the current index, or UINT64_MAX when
+     * playing full segments */
+    uint64_t part;
+    /** the current partial segment is not published yet */
+    bool wait_part;
+    /** partial segment to wait for in the next blocking reload */
+    uint64_t reload_msn;
+    uint64_t reload_part;
     /** reloading */
     bool reloading;
+    /** the reload appends to the current items */
+    bool append;
     /** output size for src */
     unsigned int output_size;
     /** current item */
@@ -169,6 +218,34 @@ UPIPE_HELPER_UPROBE(upipe_hls_playlist, urefcount_real, probe_setflowdef, NULL);
 UPIPE_HELPER_BIN_OUTPUT(upipe_hls_playlist, setflowdef, output, requests);
 UPIPE_HELPER_UPUMP_MGR(upipe_hls_playlist, upump_mgr);
 UPIPE_HELPER_UPUMP(upipe_hls_playlist, upump, upump_mgr);
+UPIPE_HELPER_UPUMP(upipe_hls_playlist, upump_replay, upump_mgr);
+
+UBASE_FROM_TO(upipe_hls_playlist, upipe_hls_cache_listener, listener, listener);
+
+/** @internal @This is the context of a segment download to the cache. */
+struct upipe_hls_playlist_fetch {
+    /** link in the list of downloads */
+    struct uchain uchain;
+    /** refcount management structure, for the probe */
+    struct urefcount urefcount;
+    /** probe catching the events of the inner pipes */
+    struct uprobe probe;
+    /** playlist pipe, or NULL once the download is over */
+    struct upipe *upipe;
+    /** source pipe */
+    struct upipe *src;
+    /** segment cache */
+    struct upipe_hls_cache *cache;
+    /** cache entry being filled */
+    struct upipe_hls_cache_entry *entry;
+};
+
+UBASE_FROM_TO(upipe_hls_playlist_fetch, uchain, uchain, uchain);
+UBASE_FROM_TO(upipe_hls_playlist_fetch, urefcount, urefcount, urefcount);
+UBASE_FROM_TO(upipe_hls_playlist_fetch, uprobe, probe, probe);
+
+/** @hidden */
+static void upipe_hls_playlist_prefetch(struct upipe *upipe);
 
 /** @internal @This catches the inner key source pipe event.
  *
@@ -265,6 +342,210 @@ static int probe_src(struct uprobe *uprobe, struct upipe *inner,
     return upipe_throw_proxy(upipe, inner, event, args);
 }
 
+/** @internal @This stops playing the current cache entry.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_hls_playlist_stop_read(struct upipe *upipe)
+{
+    struct upipe_hls_playlist *upipe_hls_playlist =
+        upipe_hls_playlist_from_upipe(upipe);
+
+    upipe_hls_playlist_set_upump_replay(upipe, NULL);
+    if (upipe_hls_playlist->entry == NULL)
+        return;
+    upipe_hls_cache_entry_unlisten(&upipe_hls_playlist->listener);
+    upipe_hls_cache_entry_release(upipe_hls_playlist->entry);
+    upipe_hls_playlist->entry = NULL;
+    upipe_hls_playlist->entry_pos = NULL;
+}
+
+/** @internal @This outputs the urefs of the current cache entry, and ends
+ * the item once the entry is complete.
+ *
+ * @param upump description structure of the pump
+ */
+static void upipe_hls_playlist_replay_cb(struct upump *upump)
+{
+    struct upipe *upipe = upump_get_opaque(upump, struct upipe *);
+    struct upipe_hls_playlist *upipe_hls_playlist =
+        upipe_hls_playlist_from_upipe(upipe);
+    struct upipe_hls_cache_entry *entry = upipe_hls_playlist->entry;
+
+    if (unlikely(entry == NULL)) {
+        upipe_hls_playlist_set_upump_replay(upipe, NULL);
+        return;
+    }
+
+    if (!upipe_hls_playlist->entry_flow_def) {
+        struct uref *flow_def = upipe_hls_cache_entry_get_flow_def(entry);
+        if (flow_def != NULL) {
+            upipe_set_flow_def(upipe_hls_playlist->setflowdef, flow_def);
+            upipe_hls_playlist->entry_flow_def = true;
+        }
+    }
+
+    struct uchain *urefs = upipe_hls_cache_entry_urefs(entry);
+    for (unsigned i = 0; i < REPLAY_BURST &&
+         upipe_hls_playlist->entry_flow_def &&
+         !ulist_is_last(urefs, upipe_hls_playlist->entry_pos); i++) {
+        upipe_hls_playlist->entry_pos = upipe_hls_playlist->entry_pos->next;
+        struct uref *uref =
+            uref_dup(uref_from_uchain(upipe_hls_playlist->entry_pos));
+        if (unlikely(uref == NULL)) {
+            upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+            return;
+        }
+        upipe_input(upipe_hls_playlist->setflowdef, uref,
+                    &upipe_hls_playlist->upump_replay);
+        if (unlikely(upipe_hls_playlist->entry != entry))
+            /* the item was changed by the pipeline */
+            return;
+    }
+
+    if (!ulist_is_last(urefs, upipe_hls_playlist->entry_pos) &&
+        upipe_hls_playlist->entry_flow_def)
+        return;
+
+    if (!upipe_hls_cache_entry_is_complete(entry)) {
+        /* wait for the download */
+        upipe_hls_playlist_set_upump_replay(upipe, NULL);
+        return;
+    }
+
+    if (upipe_hls_cache_entry_is_aborted(entry))
+        upipe_warn(upipe, "segment download failed");
+    upipe_hls_playlist_stop_read(upipe);
+    upipe_notice(upipe, "stopped");
+    upipe_hls_playlist->playing = false;
+    upipe_hls_playlist_throw_item_end(upipe);
+}
+
+/** @internal @This starts the pump outputting the current cache entry.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_hls_playlist_wake(struct upipe *upipe)
+{
+    struct upipe_hls_playlist *upipe_hls_playlist =
+        upipe_hls_playlist_from_upipe(upipe);
+
+    if (upipe_hls_playlist->upump_replay != NULL)
+        return;
+
+    struct upump *upump =
+        upump_alloc_idler(upipe_hls_playlist->upump_mgr,
+                          upipe_hls_playlist_replay_cb, upipe,
+                          upipe->refcount);
+    if (unlikely(upump == NULL)) {
+        upipe_throw_fatal(upipe, UBASE_ERR_UPUMP);
+        return;
+    }
+    upipe_hls_playlist_set_upump_replay(upipe, upump);
+    upump_start(upump);
+}
+
+/** @internal @This is called when the cache entry being played is updated.
+ *
+ * @param listener listener of the cache entry
+ */
+static void upipe_hls_playlist_listener_cb(
+        struct upipe_hls_cache_listener *listener)
+{
+    struct upipe_hls_playlist *upipe_hls_playlist =
+        upipe_hls_playlist_from_listener(listener);
+    upipe_hls_playlist_wake(upipe_hls_playlist_to_upipe(upipe_hls_playlist));
+}
+
+/** @internal @This frees a segment download once its inner pipes are dead.
+ *
+ * @param urefcount pointer to the urefcount structure of the download
+ */
+static void upipe_hls_playlist_fetch_free(struct urefcount *urefcount)
+{
+    struct upipe_hls_playlist_fetch *fetch =
+        upipe_hls_playlist_fetch_from_urefcount(urefcount);
+    upipe_hls_cache_entry_release(fetch->entry);
+    upipe_hls_cache_release(fetch->cache);
+    uprobe_clean(upipe_hls_playlist_fetch_to_probe(fetch));
+    urefcount_clean(urefcount);
+    free(fetch);
+}
+
+/** @internal @This stops a segment download, which must already be removed
+ * from the list of downloads.
+ *
+ * @param fetch segment download
+ */
+static void upipe_hls_playlist_fetch_stop(
+        struct upipe_hls_playlist_fetch *fetch)
+{
+    fetch->upipe = NULL;
+    upipe_release(fetch->src);
+    fetch->src = NULL;
+    urefcount_release(upipe_hls_playlist_fetch_to_urefcount(fetch));
+}
+
+/** @internal @This catches the events of the inner pipes of a segment
+ * download.
+ *
+ * @param uprobe structure used to raise events
+ * @param inner the inner pipe
+ * @param event event thrown
+ * @param args optional arguments
+ * @return an error code
+ */
+static int upipe_hls_playlist_fetch_catch(struct uprobe *uprobe,
+                                          struct upipe *inner,
+                                          int event, va_list args)
+{
+    struct upipe_hls_playlist_fetch *fetch =
+        upipe_hls_playlist_fetch_from_probe(uprobe);
+    struct upipe *upipe = fetch->upipe;
+
+    if (upipe == NULL)
+        return UBASE_ERR_UNHANDLED;
+
+    switch (event) {
+    case UPROBE_PROBE_UREF: {
+        if (ubase_get_signature(args) != UPIPE_PROBE_UREF_SIGNATURE)
+            break;
+        UBASE_SIGNATURE_CHECK(args, UPIPE_PROBE_UREF_SIGNATURE);
+        struct uref *uref = va_arg(args, struct uref *);
+        va_arg(args, struct upump **);
+        bool *drop = va_arg(args, bool *);
+        *drop = true;
+
+        uref = uref_dup(uref);
+        UBASE_ALLOC_RETURN(uref);
+        upipe_hls_cache_entry_append(fetch->entry, uref);
+        return UBASE_ERR_NONE;
+    }
+    case UPROBE_NEW_FLOW_DEF: {
+        struct uref *flow_def = va_arg(args, struct uref *);
+        struct uref *flow_def_dup = uref_dup(flow_def);
+        UBASE_ALLOC_RETURN(flow_def_dup);
+        upipe_hls_cache_entry_set_flow_def(fetch->entry, flow_def_dup);
+        return UBASE_ERR_NONE;
+    }
+    case UPROBE_NEED_OUTPUT:
+        return UBASE_ERR_INVALID;
+    case UPROBE_SOURCE_END:
+        upipe_verbose(upipe, "segment downloaded");
+        upipe_hls_cache_entry_complete(fetch->entry);
+        ulist_delete(upipe_hls_playlist_fetch_to_uchain(fetch));
+        upipe_hls_playlist_fetch_stop(fetch);
+        upipe_hls_playlist_prefetch(upipe);
+        return UBASE_ERR_NONE;
+    case UPROBE_FATAL:
+        upipe_hls_cache_entry_abort(fetch->entry);
+        ulist_delete(upipe_hls_playlist_fetch_to_uchain(fetch));
+        upipe_hls_playlist_fetch_stop(fetch);
+        break;
+    }
+    return upipe_throw_proxy(upipe, inner, event, args);
+}
+
 /** @internal @This allocates a m3u playlist pipe.
  *
  * @param mgr pointer to upipe manager
@@ -294,15 +575,29 @@ static struct upipe *upipe_hls_playlist_alloc(struct upipe_mgr *mgr,
     upipe_hls_playlist_init_bin_output(upipe);
     upipe_hls_playlist_init_upump_mgr(upipe);
     upipe_hls_playlist_init_upump(upipe);
+    upipe_hls_playlist_init_upump_replay(upipe);
 
     struct upipe_hls_playlist *upipe_hls_playlist =
         upipe_hls_playlist_from_upipe(upipe);
     ulist_init(&upipe_hls_playlist->items);
+    upipe_hls_playlist->cache = NULL;
+    upipe_hls_playlist->cache_asked = false;
+    ulist_init(&upipe_hls_playlist->fetches);
+    upipe_hls_playlist->entry = NULL;
+    upipe_hls_playlist->entry_pos = NULL;
+    upipe_hls_playlist->entry_flow_def = false;
+    upipe_hls_cache_listener_init(&upipe_hls_playlist->listener,
+                                  upipe_hls_playlist_listener_cb);
     upipe_hls_playlist->input_flow_def = NULL;
     upipe_hls_playlist->flow_def = NULL;
     upipe_hls_playlist->source_mgr = NULL;
     upipe_hls_playlist->index = (uint64_t)-1;
+    upipe_hls_playlist->part = UINT64_MAX;
+    upipe_hls_playlist->wait_part = false;
+    upipe_hls_playlist->reload_msn = 0;
+    upipe_hls_playlist->reload_part = 0;
     upipe_hls_playlist->reloading = false;
+    upipe_hls_playlist->append = false;
     upipe_hls_playlist->output_size = 0;
     upipe_hls_playlist->item = NULL;
     upipe_hls_playlist->key.uri = NULL;
@@ -365,6 +660,8 @@ static void upipe_hls_playlist_free(struct upipe *upipe)
     free(upipe_hls_playlist->key.method);
     uref_free(upipe_hls_playlist->flow_def);
     uref_free(upipe_hls_playlist->input_flow_def);
+    upipe_hls_cache_release(upipe_hls_playlist->cache);
+    upipe_hls_playlist_clean_upump_replay(upipe);
     upipe_hls_playlist_clean_upump(upipe);
     upipe_hls_playlist_clean_upump_mgr(upipe);
     upipe_hls_playlist_clean_bin_output(upipe);
@@ -387,6 +684,11 @@ static void upipe_hls_playlist_no_ref(struct upipe *upipe)
     struct upipe_hls_playlist *upipe_hls_playlist =
         upipe_hls_playlist_from_upipe(upipe);
 
+    upipe_hls_playlist_stop_read(upipe);
+    struct uchain *uchain;
+    while ((uchain = ulist_pop(&upipe_hls_playlist->fetches)) != NULL)
+        upipe_hls_playlist_fetch_stop(
+            upipe_hls_playlist_fetch_from_uchain(uchain));
     upipe_hls_playlist_clean_upipe_key(upipe);
     upipe_hls_playlist_clean_setflowdef(upipe);
     upipe_hls_playlist_clean_src(upipe);
@@ -394,6 +696,26 @@ static void upipe_hls_playlist_no_ref(struct upipe *upipe)
     upipe_hls_playlist_release_urefcount_real(upipe);
 }
 
+/** @internal @This applies the playlist settings to a new source pipe.
+ *
+ * @param upipe description structure of the pipe
+ * @param src the new source pipe
+ * @return an error code
+ */
+static int upipe_hls_playlist_setup_src(struct upipe *upipe,
+                                        struct upipe *src)
+{
+    struct upipe_hls_playlist *upipe_hls_playlist =
+        upipe_hls_playlist_from_upipe(upipe);
+
+    if (upipe_hls_playlist->attach_uclock)
+        UBASE_RETURN(upipe_attach_uclock(src));
+    if (upipe_hls_playlist->output_size)
+        UBASE_RETURN(upipe_set_output_size(src,
+                                           upipe_hls_playlist->output_size));
+    return UBASE_ERR_NONE;
+}
+
 /** @internal @This sets the inner source pipe of the playlist.
  *
  * @param upipe description structure of the pipe
@@ -403,24 +725,11 @@ static void upipe_hls_playlist_no_ref(struct upipe *upipe)
 static int upipe_hls_playlist_set_src(struct upipe *upipe,
                                       struct upipe *src)
 {
-    struct upipe_hls_playlist *upipe_hls_playlist =
-        upipe_hls_playlist_from_upipe(upipe);
-    int ret;
-
     if (src) {
-        if (upipe_hls_playlist->attach_uclock) {
-            ret = upipe_attach_uclock(src);
-            if (unlikely(!ubase_check(ret))) {
-                upipe_release(src);
-                return ret;
-            }
-        }
-        if (upipe_hls_playlist->output_size) {
-            ret = upipe_set_output_size(src, upipe_hls_playlist->output_size);
-            if (unlikely(!ubase_check(ret))) {
-                upipe_release(src);
-                return ret;
-            }
+        int ret = upipe_hls_playlist_setup_src(upipe, src);
+        if (unlikely(!ubase_check(ret))) {
+            upipe_release(src);
+            return ret;
         }
     }
     upipe_hls_playlist_store_src(upipe, src);
@@ -565,29 +874,245 @@ static int upipe_hls_playlist_update_flow_def(struct upipe *upipe)
                                      upipe_hls_playlist->flow_def);
 }
 
+/** @internal @This checks if the segment cache is set and asks for it if
+ * not.
+ *
+ * @param upipe description structure of the pipe
+ * @return true if the segments are played through the cache
+ */
+static bool upipe_hls_playlist_check_cache(struct upipe *upipe)
+{
+    struct upipe_hls_playlist *upipe_hls_playlist =
+        upipe_hls_playlist_from_upipe(upipe);
+
+    if (upipe_hls_playlist->cache == NULL &&
+        !upipe_hls_playlist->cache_asked) {
+        upipe_hls_playlist->cache_asked = true;
+        upipe_hls_playlist_throw_need_cache(upipe, &upipe_hls_playlist->cache);
+    }
+    upipe_hls_playlist_check_upump_mgr(upipe);
+    return upipe_hls_playlist->cache != NULL &&
+           upipe_hls_playlist->upump_mgr != NULL;
+}
+
+/** @internal @This resolves the URI of an item.
+ *
+ * @param upipe description structure of the pipe
+ * @param item playlist item
+ * @param uri_p filled with an allocated URI string, to be freed by the caller
+ * @return an error code
+ */
+static int upipe_hls_playlist_item_uri(struct upipe *upipe,
+                                       struct uref *item,
+                                       char **uri_p)
+{
+    struct upipe_hls_playlist *upipe_hls_playlist =
+        upipe_hls_playlist_from_upipe(upipe);
+    struct uref *input_flow_def = upipe_hls_playlist->input_flow_def;
+    int ret;
+
+    if (unlikely(input_flow_def == NULL) || unlikely(item == NULL))
+        return UBASE_ERR_INVALID;
+
+    const char *m3u_uri;
+    UBASE_RETURN(uref_m3u_get_uri(item, &m3u_uri));
+
+    struct uuri uuri;
+    if (ubase_check(uuri_from_str(&uuri, m3u_uri)))
+        /* this is a valid URI, we can directly play it */
+        return uuri_to_str(&uuri, uri_p);
+
+    UBASE_RETURN(uref_uri_get(input_flow_def, &uuri));
+    uuri.query = ustring_null();
+    uuri.fragment = ustring_null();
+    if (strlen(m3u_uri) && *m3u_uri == '/') {
+        /* use the item absolute path with the input scheme */
+        uuri.path = ustring_from_str(m3u_uri);
+        return uuri_to_str(&uuri, uri_p);
+    }
+
+    /* use the item relative path with the input path as root path */
+    char tmp[uuri.path.len + 1];
+    ustring_cpy(uuri.path, tmp, sizeof (tmp));
+    const char *root = dirname(tmp);
+    char new_path[strlen(root) + 1 + strlen(m3u_uri) + 1];
+    ret = snprintf(new_path, sizeof (new_path), "%s/%s", root, m3u_uri);
+    if (ret < 0 || (unsigned)ret >= sizeof (new_path))
+        return UBASE_ERR_NOSPC;
+    uuri.path = ustring_from_str(new_path);
+    return uuri_to_str(&uuri, uri_p);
+}
+
+/** @internal @This starts the inner pipes of a segment download.
+ *
+ * @param upipe description structure of the pipe
+ * @param fetch segment download
+ * @param item item to download
+ * @param uri the URI of the item
+ * @return an error code
+ */
+static int upipe_hls_playlist_fetch_start(struct upipe *upipe,
+                                          struct upipe_hls_playlist_fetch *fetch,
+                                          struct uref *item,
+                                          const char *uri)
+{
+    struct upipe_hls_playlist *upipe_hls_playlist =
+        upipe_hls_playlist_from_upipe(upipe);
+
+    fetch->src = upipe_void_alloc(
+        upipe_hls_playlist->source_mgr,
+        uprobe_pfx_alloc(
+            uprobe_use(upipe_hls_playlist_fetch_to_probe(fetch)),
+            UPROBE_LOG_VERBOSE, "fetch src"));
+    UBASE_ALLOC_RETURN(fetch->src);
+    UBASE_RETURN(upipe_hls_playlist_setup_src(upipe, fetch->src));
+
+    struct upipe_mgr *upipe_probe_uref_mgr = upipe_probe_uref_mgr_alloc();
+    UBASE_ALLOC_RETURN(upipe_probe_uref_mgr);
+    struct upipe *output = upipe_void_alloc_output(
+        fetch->src, upipe_probe_uref_mgr,
+        uprobe_pfx_alloc(
+            uprobe_use(upipe_hls_playlist_fetch_to_probe(fetch)),
+            UPROBE_LOG_VERBOSE, "fetch"));
+    upipe_mgr_release(upipe_probe_uref_mgr);
+    UBASE_ALLOC_RETURN(output);
+    upipe_release(output);
+
+    UBASE_RETURN(upipe_set_uri(fetch->src, uri));
+    if (unlikely(fetch->src == NULL))
+        return UBASE_ERR_INVALID;
+
+    uint64_t range_off = 0;
+    uref_m3u_playlist_get_byte_range_off(item, &range_off);
+    uint64_t range_len = (uint64_t)-1;
+    uref_m3u_playlist_get_byte_range_len(item, &range_len);
+    return upipe_src_set_range(fetch->src, range_off, range_len);
+}
+
+/** @internal @This downloads an item to the cache, unless it is already
+ * cached or being downloaded.
+ *
+ * @param upipe description structure of the pipe
+ * @param item item to download
+ * @param uri the URI of the item
+ * @param entry_p filled with a reference to the cache entry, may be NULL
+ * @return an error code
+ */
+static int upipe_hls_playlist_fetch(struct upipe *upipe,
+                                    struct uref *item,
+                                    const char *uri,
+                                    struct upipe_hls_cache_entry **entry_p)
+{
+    struct upipe_hls_playlist *upipe_hls_playlist =
+        upipe_hls_playlist_from_upipe(upipe);
+
+    /* the same URI may be split into several byte ranges */
+    uint64_t range_off = 0;
+    uref_m3u_playlist_get_byte_range_off(item, &range_off);
+    uint64_t range_len = (uint64_t)-1;
+    uref_m3u_playlist_get_byte_range_len(item, &range_len);
+    char key[strlen(uri) + 2 * 21 + 3];
+    snprintf(key, sizeof (key), "%s@%"PRIu64"+%"PRIu64,
+             uri, range_off, range_len);
+
+    struct upipe_hls_cache_entry *entry =
+        upipe_hls_cache_find(upipe_hls_playlist->cache, key);
+    if (entry != NULL) {
+        if (entry_p != NULL)
+            *entry_p = entry;
+        else
+            upipe_hls_cache_entry_release(entry);
+        return UBASE_ERR_NONE;
+    }
+
+    UBASE_RETURN(upipe_hls_playlist_check_source_mgr(upipe));
+    struct upipe_hls_playlist_fetch *fetch = malloc(sizeof (*fetch));
+    UBASE_ALLOC_RETURN(fetch);
+    fetch->entry = upipe_hls_cache_add(upipe_hls_playlist->cache, key);
+    if (unlikely(fetch->entry == NULL)) {
+        free(fetch);
+        return UBASE_ERR_ALLOC;
+    }
+    uchain_init(upipe_hls_playlist_fetch_to_uchain(fetch));
+    urefcount_init(upipe_hls_playlist_fetch_to_urefcount(fetch),
+                   upipe_hls_playlist_fetch_free);
+    uprobe_init(upipe_hls_playlist_fetch_to_probe(fetch),
+                upipe_hls_playlist_fetch_catch, NULL);
+    fetch->probe.refcount = upipe_hls_playlist_fetch_to_urefcount(fetch);
+    fetch->upipe = upipe;
+    fetch->src = NULL;
+    fetch->cache = upipe_hls_cache_use(upipe_hls_playlist->cache);
+    ulist_add(&upipe_hls_playlist->fetches,
+              upipe_hls_playlist_fetch_to_uchain(fetch));
+
+    upipe_verbose_va(upipe, "fetch %s", key);
+    entry = upipe_hls_cache_entry_use(fetch->entry);
+    /* the download may end while it is being started */
+    urefcount_use(upipe_hls_playlist_fetch_to_urefcount(fetch));
+    int ret = upipe_hls_playlist_fetch_start(upipe, fetch, item, uri);
+    if (unlikely(!ubase_check(ret)) && fetch->upipe != NULL) {
+        upipe_hls_cache_entry_abort(fetch->entry);
+        ulist_delete(upipe_hls_playlist_fetch_to_uchain(fetch));
+        upipe_hls_playlist_fetch_stop(fetch);
+    }
+    urefcount_release(upipe_hls_playlist_fetch_to_urefcount(fetch));
+
+    if (unlikely(!ubase_check(ret)) || entry_p == NULL)
+        upipe_hls_cache_entry_release(entry);
+    else
+        *entry_p = entry;
+    return ret;
+}
+
+/** @internal @This plays an URI through the segment cache.
+ *
+ * @param upipe description structure of the pipe
+ * @param item item to play
+ * @param uri the URI of the item to play
+ * @return an error code
+ */
+static int upipe_hls_playlist_play_cache(struct upipe *upipe,
+                                         struct uref *item,
+                                         const char *uri)
+{
+    struct upipe_hls_playlist *upipe_hls_playlist =
+        upipe_hls_playlist_from_upipe(upipe);
+
+    struct upipe_hls_cache_entry *entry;
+    UBASE_RETURN(upipe_hls_playlist_fetch(upipe, item, uri, &entry));
+
+    upipe_hls_playlist_stop_read(upipe);
+    upipe_hls_playlist->entry = entry;
+    upipe_hls_playlist->entry_pos = upipe_hls_cache_entry_urefs(entry);
+    upipe_hls_playlist->entry_flow_def = false;
+    upipe_hls_cache_entry_listen(entry, &upipe_hls_playlist->listener);
+    upipe_hls_playlist_wake(upipe);
+
+    upipe_notice_va(upipe, "playing%s",
+                    upipe_hls_cache_entry_is_complete(entry) ?
+                    " from cache" : "");
+    upipe_hls_playlist->playing = true;
+    upipe_hls_playlist_prefetch(upipe);
+    return UBASE_ERR_NONE;
+}
+
 /** @internal @This plays an URI.
  *
  * @param upipe description structure of the pipe
  * @param item item to play
- * @param uuri the URI of the item to play
+ * @param uri the URI of the item to play
  * @return an error code
  */
 static int upipe_hls_playlist_play_uri(struct upipe *upipe,
                                        struct uref *item,
-                                       struct uuri *uuri)
+                                       const char *uri)
 {
     struct upipe_hls_playlist *upipe_hls_playlist =
         upipe_hls_playlist_from_upipe(upipe);
     struct uref *input_flow_def = upipe_hls_playlist->input_flow_def;
 
-    size_t len;
-    UBASE_RETURN(uuri_len(uuri, &len));
-    char uri[len + 1];
-    UBASE_RETURN(uuri_to_buffer(uuri, uri, sizeof (uri)));
-
     upipe_notice_va(upipe, "play next item sequence %"PRIu64" %s",
                     upipe_hls_playlist->index, uri);
-
     struct uref *flow_def = upipe_hls_playlist->flow_def;
     if (ubase_check(uref_flow_match_def(flow_def, "block.aes."))) {
         const uint8_t *iv;
@@ -606,6 +1131,9 @@ static int upipe_hls_playlist_play_uri(struct upipe *upipe,
     }
     UBASE_RETURN(upipe_hls_playlist_update_flow_def(upipe));
 
+    if (upipe_hls_playlist_check_cache(upipe))
+        return upipe_hls_playlist_play_cache(upipe, item, uri);
+
     UBASE_RETURN(upipe_hls_playlist_check_source_mgr(upipe));
     struct upipe *inner = upipe_void_alloc(
         upipe_hls_playlist->source_mgr,
@@ -639,43 +1167,61 @@ static int upipe_hls_playlist_play_item(struct upipe *upipe,
 {
     struct upipe_hls_playlist *upipe_hls_playlist =
         upipe_hls_playlist_from_upipe(upipe);
-    struct uref *input_flow_def = upipe_hls_playlist->input_flow_def;
-    int ret;
-
-    if (unlikely(input_flow_def == NULL) || unlikely(item == NULL))
-        return UBASE_ERR_INVALID;
 
     upipe_verbose_va(upipe, "play item sequence %"PRIu64,
                      upipe_hls_playlist->index);
-    uref_dump(item, upipe->uprobe);
+    if (likely(item != NULL))
+        uref_dump(item, upipe->uprobe);
+
+    char *uri;
+    UBASE_RETURN(upipe_hls_playlist_item_uri(upipe, item, &uri));
+    int ret = upipe_hls_playlist_play_uri(upipe, item, uri);
+    free(uri);
+    return ret;
+}
 
-    const char *m3u_uri;
-    UBASE_RETURN(uref_m3u_get_uri(item, &m3u_uri));
+/** @internal @This finds a full or partial segment by its sequence number.
+ *
+ * @param upipe description structure of the pipe
+ * @param index the sequence number
+ * @param part the partial segment index, or UINT64_MAX for the full segment
+ * @param item_p pointer filled with the item
+ * @return an error code
+ */
+static int upipe_hls_playlist_find(struct upipe *upipe,
+                                   uint64_t index, uint64_t part,
+                                   struct uref **item_p)
+{
+    struct upipe_hls_playlist *upipe_hls_playlist =
+        upipe_hls_playlist_from_upipe(upipe);
+    struct uref *input_flow_def = upipe_hls_playlist->input_flow_def;
 
-    struct uuri uuri;
-    if (ubase_check(uuri_from_str(&uuri, m3u_uri)))
-        /* this is a valid URI, we can directly play it */
-        return upipe_hls_playlist_play_uri(upipe, item, &uuri);
+    uint64_t seq = 0;
+    uref_m3u_playlist_flow_get_media_sequence(input_flow_def, &seq);
+    if (index < seq)
+        return UBASE_ERR_INVALID;
 
-    UBASE_RETURN(uref_uri_get(input_flow_def, &uuri));
-    uuri.query = ustring_null();
-    uuri.fragment = ustring_null();
-    if (strlen(m3u_uri) && *m3u_uri == '/') {
-        /* use the item absolute path with the input scheme */
-        uuri.path = ustring_from_str(m3u_uri);
-        return upipe_hls_playlist_play_uri(upipe, item, &uuri);
-    }
+    struct uchain *uchain;
+    ulist_foreach(&upipe_hls_playlist->items, uchain) {
+        struct uref *uref = uref_from_uchain(uchain);
+        uint64_t part_index;
 
-    /* use the item relative path with the input path as root path */
-    char tmp[uuri.path.len + 1];
-    ustring_cpy(uuri.path, tmp, sizeof (tmp));
-    const char *root = dirname(tmp);
-    char new_path[strlen(root) + 1 + strlen(m3u_uri) + 1];
-    ret = snprintf(new_path, sizeof (new_path), "%s/%s", root, m3u_uri);
-    if (ret < 0 || (unsigned)ret >= sizeof (new_path))
-        return UBASE_ERR_NOSPC;
-    uuri.path = ustring_from_str(new_path);
-    return upipe_hls_playlist_play_uri(upipe, item, &uuri);
+        if (!ubase_check(uref_m3u_playlist_get_part(uref))) {
+            if (seq++ == index && part == UINT64_MAX) {
+                *item_p = uref;
+                return UBASE_ERR_NONE;
+            }
+        }
+        else if (seq == index && part != UINT64_MAX &&
+                 ubase_check(uref_m3u_playlist_get_part_index(
+                         uref, &part_index)) && part_index == part) {
+            *item_p = uref;
+            return UBASE_ERR_NONE;
+        }
+        if (seq > index)
+            break;
+    }
+    return UBASE_ERR_INVALID;
 }
 
 /** @internal @This gets a media sequence by its sequence number.
@@ -683,34 +1229,135 @@ static int upipe_hls_playlist_play_item(struct upipe *upipe,
  * @param upipe description structure of the pipe
  * @param index the sequence number
  * @param item_p pointer filled with the media sequence
- * @param key_p pointer filled with the key if any
  * @return an error code
  */
 static int upipe_hls_playlist_get_item_at(struct upipe *upipe,
                                           uint64_t index,
                                           struct uref **item_p)
+{
+    int ret = upipe_hls_playlist_find(upipe, index, UINT64_MAX, item_p);
+    if (!ubase_check(ret))
+        upipe_notice(upipe, "nothing to play");
+    return ret;
+}
+
+/** @internal @This returns the number of full segments in the playlist.
+ *
+ * @param upipe description structure of the pipe
+ * @return the number of full segments
+ */
+static uint64_t upipe_hls_playlist_nb_segments(struct upipe *upipe)
+{
+    struct upipe_hls_playlist *upipe_hls_playlist =
+        upipe_hls_playlist_from_upipe(upipe);
+    uint64_t nb = 0;
+    struct uchain *uchain;
+    ulist_foreach(&upipe_hls_playlist->items, uchain)
+        if (!ubase_check(uref_m3u_playlist_get_part(uref_from_uchain(uchain))))
+            nb++;
+    return nb;
+}
+
+/** @internal @This selects the partial segment to start playing a live
+ * low-latency playlist from, that is the last independent partial segment
+ * at least the part hold back away from the live edge.
+ *
+ * @param upipe description structure of the pipe
+ * @return true if a partial segment was selected
+ */
+static bool upipe_hls_playlist_find_live_part(struct upipe *upipe)
 {
     struct upipe_hls_playlist *upipe_hls_playlist =
         upipe_hls_playlist_from_upipe(upipe);
     struct uref *input_flow_def = upipe_hls_playlist->input_flow_def;
 
-    uint64_t media_sequence = 0;
-    uref_m3u_playlist_flow_get_media_sequence(input_flow_def, &media_sequence);
-    if (index < media_sequence)
-        return UBASE_ERR_INVALID;
-    index -= media_sequence;
+    uint64_t part_target;
+    if (ubase_check(uref_m3u_playlist_flow_get_endlist(input_flow_def)) ||
+        !ubase_check(uref_m3u_playlist_flow_get_part_target(input_flow_def,
+                                                            &part_target)))
+        return false;
+    uint64_t hold_back = 3 * part_target;
+    uref_m3u_playlist_flow_get_part_hold_back(input_flow_def, &hold_back);
 
+    uint64_t total = 0;
     struct uchain *uchain;
     ulist_foreach(&upipe_hls_playlist->items, uchain) {
-        struct uref *uref = uref_from_uchain(uchain);
+        struct uref *item = uref_from_uchain(uchain);
+        uint64_t duration;
+        if (ubase_check(uref_m3u_playlist_get_part(item)) &&
+            !ubase_check(uref_m3u_playlist_get_preload_hint(item)) &&
+            ubase_check(uref_m3u_playlist_get_seq_duration(item, &duration)))
+            total += duration;
+    }
 
-        if (index-- == 0) {
-            *item_p = uref;
-            return UBASE_ERR_NONE;
+    uint64_t seq = 0;
+    uref_m3u_playlist_flow_get_media_sequence(input_flow_def, &seq);
+    bool found = false;
+    ulist_foreach(&upipe_hls_playlist->items, uchain) {
+        struct uref *item = uref_from_uchain(uchain);
+        if (!ubase_check(uref_m3u_playlist_get_part(item))) {
+            seq++;
+            continue;
+        }
+        uint64_t duration, part_index;
+        if (ubase_check(uref_m3u_playlist_get_preload_hint(item)) ||
+            !ubase_check(uref_m3u_playlist_get_seq_duration(item, &duration)))
+            continue;
+        if (total >= hold_back &&
+            ubase_check(uref_m3u_playlist_get_part_independent(item)) &&
+            ubase_check(uref_m3u_playlist_get_part_index(item, &part_index))) {
+            upipe_hls_playlist->index = seq;
+            upipe_hls_playlist->part = part_index;
+            found = true;
+        }
+        total -= duration;
+    }
+
+    if (found)
+        upipe_notice_va(upipe, "start at live edge, sequence %"PRIu64
+                        " part %"PRIu64, upipe_hls_playlist->index,
+                        upipe_hls_playlist->part);
+    return found;
+}
+
+/** @internal @This downloads the items following the current one to the
+ * segment cache.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_hls_playlist_prefetch(struct upipe *upipe)
+{
+    struct upipe_hls_playlist *upipe_hls_playlist =
+        upipe_hls_playlist_from_upipe(upipe);
+    struct uref *input_flow_def = upipe_hls_playlist->input_flow_def;
+
+    if (upipe_hls_playlist->cache == NULL || input_flow_def == NULL ||
+        upipe_hls_playlist->index == (uint64_t)-1 ||
+        upipe_hls_playlist->reloading)
+        return;
+
+    unsigned prefetch = upipe_hls_cache_get_prefetch(upipe_hls_playlist->cache);
+    uint64_t media_sequence = 0;
+    uref_m3u_playlist_flow_get_media_sequence(input_flow_def, &media_sequence);
+    uint64_t end = media_sequence + upipe_hls_playlist_nb_segments(upipe);
+
+    for (uint64_t index = upipe_hls_playlist->index + 1;
+         index <= upipe_hls_playlist->index + prefetch && index < end &&
+         ulist_depth(&upipe_hls_playlist->fetches) <= prefetch; index++) {
+        struct uref *item;
+        char *uri;
+        if (index < media_sequence ||
+            !ubase_check(upipe_hls_playlist_get_item_at(upipe, index, &item)) ||
+            !ubase_check(upipe_hls_playlist_item_uri(upipe, item, &uri)))
+            continue;
+
+        int ret = upipe_hls_playlist_fetch(upipe, item, uri, NULL);
+        free(uri);
+        if (unlikely(!ubase_check(ret))) {
+            upipe_warn_va(upipe, "fail to prefetch sequence %"PRIu64, index);
+            break;
         }
     }
-    upipe_notice(upipe, "nothing to play");
-    return UBASE_ERR_INVALID;
 }
 
 /** @internal @This plays the next item in the playlist.
@@ -736,19 +1383,47 @@ static int _upipe_hls_playlist_play(struct upipe *upipe)
     uref_m3u_playlist_flow_get_media_sequence(
         input_flow_def, &media_sequence);
 
-    if (upipe_hls_playlist->index == (uint64_t)-1)
-        upipe_hls_playlist->index = media_sequence;
+    if (upipe_hls_playlist->index == (uint64_t)-1) {
+        if (!upipe_hls_playlist_find_live_part(upipe))
+            upipe_hls_playlist->index = media_sequence;
+    }
     else if (media_sequence > upipe_hls_playlist->index) {
         upipe_warn_va(upipe, "media sequence %"PRIu64" is gone, "
                       "playing sequence %"PRIu64,
                       upipe_hls_playlist->index,
                       media_sequence);
         upipe_hls_playlist->index = media_sequence;
+        upipe_hls_playlist->part = UINT64_MAX;
     }
 
     struct uref *item = NULL;
-    UBASE_RETURN(upipe_hls_playlist_get_item_at(
-            upipe, upipe_hls_playlist->index, &item));
+    upipe_hls_playlist->wait_part = false;
+    if (upipe_hls_playlist->part != UINT64_MAX) {
+        if (!ubase_check(upipe_hls_playlist_find(
+                    upipe, upipe_hls_playlist->index,
+                    upipe_hls_playlist->part, &item))) {
+            if (upipe_hls_playlist->part != 0 ||
+                !ubase_check(upipe_hls_playlist_find(
+                        upipe, upipe_hls_playlist->index, UINT64_MAX,
+                        &item))) {
+                /* wait for the partial segment to be published */
+                upipe_dbg_va(upipe, "wait for sequence %"PRIu64
+                             " part %"PRIu64, upipe_hls_playlist->index,
+                             upipe_hls_playlist->part);
+                upipe_hls_playlist->wait_part = true;
+                return UBASE_ERR_NONE;
+            }
+            /* this segment is only available as a whole */
+            upipe_hls_playlist->part = UINT64_MAX;
+        }
+    }
+    else if (!ubase_check(upipe_hls_playlist_find(
+                upipe, upipe_hls_playlist->index, UINT64_MAX, &item))) {
+        /* the live edge may only be available as partial segments */
+        UBASE_RETURN(upipe_hls_playlist_find(
+                upipe, upipe_hls_playlist->index, 0, &item));
+        upipe_hls_playlist->part = 0;
+    }
 
     const char *method;
     if (ubase_check(uref_m3u_playlist_key_get_method(item, &method))) {
@@ -791,6 +1466,23 @@ static int _upipe_hls_playlist_next(struct upipe *upipe)
 
     if (upipe_hls_playlist->index == (uint64_t)-1)
         upipe_hls_playlist->index = media_sequence;
+    else if (upipe_hls_playlist->part != UINT64_MAX &&
+             media_sequence <= upipe_hls_playlist->index) {
+        struct uref *item;
+        upipe_hls_playlist->part++;
+        if (!ubase_check(upipe_hls_playlist_find(
+                    upipe, upipe_hls_playlist->index,
+                    upipe_hls_playlist->part, &item)) &&
+            ubase_check(upipe_hls_playlist_find(
+                    upipe, upipe_hls_playlist->index, UINT64_MAX, &item))) {
+            /* the parent segment is complete */
+            upipe_hls_playlist->index++;
+            upipe_hls_playlist->part = 0;
+        }
+        upipe_dbg_va(upipe, "next item %"PRIu64" part %"PRIu64,
+                     upipe_hls_playlist->index, upipe_hls_playlist->part);
+        return UBASE_ERR_NONE;
+    }
     else if (media_sequence > upipe_hls_playlist->index + 1) {
         upipe_warn_va(upipe, "media sequence %"PRIu64" is gone, "
                       "playing sequence %"PRIu64,
@@ -800,10 +1492,99 @@ static int _upipe_hls_playlist_next(struct upipe *upipe)
     }
     else
         upipe_hls_playlist->index++;
+    upipe_hls_playlist->part = UINT64_MAX;
     upipe_dbg_va(upipe, "next item %"PRIu64, upipe_hls_playlist->index);
     return UBASE_ERR_NONE;
 }
 
+static void upipe_hls_playlist_need_reload_cb(struct upump *upump)
+{
+        struct upipe *upipe = upump_get_opaque(upump, struct upipe *);
+        upipe_hls_playlist_throw_need_reload(upipe);
+}
+
+/** @internal @This throws a blocking reload for the partial segment
+ * following the last published one, or falls back to polling the playlist
+ * every part target if the event is not handled.
+ *
+ * @param upump description structure of the timer
+ */
+static void upipe_hls_playlist_need_blocking_reload_cb(struct upump *upump)
+{
+    struct upipe *upipe = upump_get_opaque(upump, struct upipe *);
+    struct upipe_hls_playlist *upipe_hls_playlist =
+        upipe_hls_playlist_from_upipe(upipe);
+
+    if (ubase_check(upipe_hls_playlist_throw_need_blocking_reload(
+                upipe, upipe_hls_playlist->reload_msn,
+                upipe_hls_playlist->reload_part)))
+        return;
+
+    uint64_t part_target = UCLOCK_FREQ;
+    uref_m3u_playlist_flow_get_part_target(upipe_hls_playlist->input_flow_def,
+                                           &part_target);
+    upipe_dbg(upipe, "blocking reload not handled");
+    upipe_hls_playlist_wait_upump(upipe, part_target,
+                                  upipe_hls_playlist_need_reload_cb);
+}
+
+/** @internal @This checks whether the playlist should be reloaded with
+ * blocking requests.
+ *
+ * @param upipe description structure of the pipe
+ * @return true if the server supports blocking reloads of this playlist
+ */
+static bool upipe_hls_playlist_can_block(struct upipe *upipe)
+{
+    struct upipe_hls_playlist *upipe_hls_playlist =
+        upipe_hls_playlist_from_upipe(upipe);
+    struct uref *input_flow_def = upipe_hls_playlist->input_flow_def;
+
+    return input_flow_def != NULL &&
+        !ubase_check(uref_m3u_playlist_flow_get_endlist(input_flow_def)) &&
+        ubase_check(uref_m3u_playlist_flow_get_can_block_reload(
+                input_flow_def)) &&
+        ubase_check(uref_m3u_playlist_flow_get_part_target(input_flow_def,
+                                                           NULL));
+}
+
+/** @internal @This schedules a blocking reload of a low-latency playlist,
+ * asking for the partial segment following the last published one.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_hls_playlist_block_reload(struct upipe *upipe)
+{
+    struct upipe_hls_playlist *upipe_hls_playlist =
+        upipe_hls_playlist_from_upipe(upipe);
+
+    if (!upipe_hls_playlist_can_block(upipe))
+        return;
+
+    uint64_t msn = 0;
+    uint64_t part = 0;
+    uref_m3u_playlist_flow_get_media_sequence(
+        upipe_hls_playlist->input_flow_def, &msn);
+    struct uchain *uchain;
+    ulist_foreach(&upipe_hls_playlist->items, uchain) {
+        struct uref *item = uref_from_uchain(uchain);
+        uint64_t part_index;
+        if (!ubase_check(uref_m3u_playlist_get_part(item))) {
+            msn++;
+            part = 0;
+        }
+        else if (!ubase_check(uref_m3u_playlist_get_preload_hint(item)) &&
+                 ubase_check(uref_m3u_playlist_get_part_index(item,
+                                                              &part_index)))
+            part = part_index + 1;
+    }
+
+    upipe_hls_playlist->reload_msn = msn;
+    upipe_hls_playlist->reload_part = part;
+    upipe_hls_playlist_wait_upump(upipe, 0,
+                                  upipe_hls_playlist_need_blocking_reload_cb);
+}
+
 /** @internal @This is called when there is input data.
  *
  * @param upipe description structure of the pipe
@@ -819,18 +1600,87 @@ static void upipe_hls_playlist_input(struct upipe *upipe,
 
     if (unlikely(!upipe_hls_playlist->reloading)) {
         upipe_dbg(upipe, "playlist start");
-        upipe_hls_playlist_flush(upipe);
+        if (!upipe_hls_playlist->append)
+            upipe_hls_playlist_flush(upipe);
+        upipe_hls_playlist->append = false;
         upipe_hls_playlist->reloading = true;
     }
 
-    ulist_add(&upipe_hls_playlist->items, uref_to_uchain(uref));
-    if (ubase_check(uref_block_get_end(uref))) {
+    bool end = ubase_check(uref_block_get_end(uref));
+    if (ubase_check(uref_m3u_get_uri(uref, NULL)))
+        ulist_add(&upipe_hls_playlist->items, uref_to_uchain(uref));
+    else
+        /* incremental refresh appending nothing */
+        uref_free(uref);
+    if (end) {
         upipe_dbg(upipe, "playlist end");
         upipe_hls_playlist->reloading = false;
         upipe_hls_playlist_throw_reloaded(upipe);
+        if (upipe_hls_playlist->wait_part && !upipe_hls_playlist->playing) {
+            int ret = _upipe_hls_playlist_play(upipe);
+            if (unlikely(!ubase_check(ret)))
+                upipe_throw_error(upipe, ret);
+        }
+        upipe_hls_playlist_prefetch(upipe);
+        upipe_hls_playlist_block_reload(upipe);
     }
 }
 
+/** @internal @This prepares the items for an incremental refresh, by
+ * dropping the segments that expired from the playlist and the partial
+ * segments of the live edge, which are sent again.
+ *
+ * @param upipe description structure of the pipe
+ * @param flow_def new input flow definition
+ * @return an error code
+ */
+static int upipe_hls_playlist_trim(struct upipe *upipe, struct uref *flow_def)
+{
+    struct upipe_hls_playlist *upipe_hls_playlist =
+        upipe_hls_playlist_from_upipe(upipe);
+    struct uref *input_flow_def = upipe_hls_playlist->input_flow_def;
+
+    uint64_t append;
+    if (input_flow_def == NULL ||
+        !ubase_check(uref_m3u_playlist_flow_get_append(flow_def, &append)))
+        return UBASE_ERR_INVALID;
+
+    uint64_t old_media_sequence = 0, media_sequence = 0;
+    uref_m3u_playlist_flow_get_media_sequence(input_flow_def,
+                                              &old_media_sequence);
+    uref_m3u_playlist_flow_get_media_sequence(flow_def, &media_sequence);
+    uint64_t end = old_media_sequence + upipe_hls_playlist_nb_segments(upipe);
+    if (append != (media_sequence > end ? media_sequence : end) ||
+        media_sequence < old_media_sequence) {
+        upipe_warn_va(upipe, "cannot append sequence %"PRIu64" to %"PRIu64,
+                      append, end);
+        return UBASE_ERR_INVALID;
+    }
+
+    uint64_t seq = old_media_sequence;
+    struct uchain *uchain, *uchain_tmp;
+    ulist_delete_foreach(&upipe_hls_playlist->items, uchain, uchain_tmp) {
+        if (seq >= media_sequence)
+            break;
+        struct uref *item = uref_from_uchain(uchain);
+        if (!ubase_check(uref_m3u_playlist_get_part(item)))
+            seq++;
+        ulist_delete(uchain);
+        uref_free(item);
+    }
+
+    ulist_delete_foreach_reverse(&upipe_hls_playlist->items, uchain,
+                                 uchain_tmp) {
+        struct uref *item = uref_from_uchain(uchain);
+        if (!ubase_check(uref_m3u_playlist_get_part(item)))
+            break;
+        ulist_delete(uchain);
+        uref_free(item);
+    }
+    upipe_verbose_va(upipe, "append from sequence %"PRIu64, append);
+    return UBASE_ERR_NONE;
+}
+
 /** @internal @This stores a new input flow definition.
  *
  * @param upipe description structure of the pipe
@@ -846,12 +1696,6 @@ static void upipe_hls_playlist_store_input_flow_def(struct upipe *upipe,
     upipe_hls_playlist->input_flow_def = flow_def;
 }
 
-static void upipe_hls_playlist_need_reload_cb(struct upump *upump)
-{
-        struct upipe *upipe = upump_get_opaque(upump, struct upipe *);
-        upipe_hls_playlist_throw_need_reload(upipe);
-}
-
 /** @internal @This sets a new flow definition.
  *
  * @param upipe description structure of the pipe
@@ -901,7 +1745,14 @@ static int upipe_hls_playlist_set_flow_def(struct upipe *upipe,
             media_sequence = 0;
 
         uint64_t target_duration;
-        if (ubase_check(uref_m3u_playlist_flow_get_target_duration(
+        if (ubase_check(uref_m3u_playlist_flow_get_can_block_reload(
+                    flow_def_dup)) &&
+            ubase_check(uref_m3u_playlist_flow_get_part_target(
+                    flow_def_dup, NULL))) {
+            /* blocking reload is scheduled once the playlist is received */
+            upipe_hls_playlist_set_upump(upipe, NULL);
+        }
+        else if (ubase_check(uref_m3u_playlist_flow_get_target_duration(
                     flow_def_dup, &target_duration))) {
             if (old_media_sequence == media_sequence) {
                 upipe_dbg(upipe, "playlist media sequence has not changed");
@@ -919,6 +1770,9 @@ static int upipe_hls_playlist_set_flow_def(struct upipe *upipe,
             upipe_hls_playlist_set_upump(upipe, NULL);
         }
     }
+    upipe_hls_playlist->append =
+        !upipe_hls_playlist->reloading &&
+        ubase_check(upipe_hls_playlist_trim(upipe, flow_def_dup));
     upipe_hls_playlist_store_input_flow_def(upipe, flow_def_dup);
     return UBASE_ERR_NONE;
 }
@@ -951,6 +1805,8 @@ static int _upipe_hls_playlist_set_index(struct upipe *upipe,
     struct upipe_hls_playlist *upipe_hls_playlist =
         upipe_hls_playlist_from_upipe(upipe);
     upipe_hls_playlist->index = index;
+    upipe_hls_playlist->part = UINT64_MAX;
+    upipe_hls_playlist->wait_part = false;
     return UBASE_ERR_NONE;
 }
 
@@ -988,6 +1844,8 @@ static int _upipe_hls_playlist_seek(struct upipe *upipe,
     struct uchain *uchain;
     ulist_foreach(&upipe_hls_playlist->items, uchain) {
         struct uref *item = uref_from_uchain(uchain);
+        if (ubase_check(uref_m3u_playlist_get_part(item)))
+            continue;
         uint64_t seq_duration;
         UBASE_RETURN(uref_m3u_playlist_get_seq_duration(item, &seq_duration));
         if (at < seq_duration) {
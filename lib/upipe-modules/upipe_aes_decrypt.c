@@ -30,13 +30,36 @@
 #include <upipe/upipe_helper_urefcount.h>
 #include <upipe/upipe_helper_upipe.h>
 #include <upipe/upipe.h>
+#include <upipe/ucpu.h>
 #include <upipe-modules/uref_aes_flow.h>
 #include <upipe/uref_block_flow.h>
 #include <upipe/uref_block.h>
 #include <upipe/urefcount.h>
 
+#if defined(__i686__) || defined(__x86_64__)
+#include <immintrin.h>
+#define UPIPE_AES_DECRYPT_X86
+#elif defined(__aarch64__) && defined(__linux__)
+#include <arm_neon.h>
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#define UPIPE_AES_DECRYPT_ARM
+#endif
+
 #define EXPECTED_FLOW_DEF       "block.aes."
 
+/** @internal @This is the type of the functions decrypting AES-128 CBC
+ * blocks in place.
+ *
+ * @param round_keys the generated round keys
+ * @param iv the initialization vector, replaced with the last encrypted block
+ * @param buffer the blocks to decrypt in place
+ * @param size size of the buffer, multiple of 16 octets
+ */
+typedef void (*aes_cbc_decrypt_func)(uint8_t round_keys[11][4][4],
+                                     uint8_t iv[16],
+                                     uint8_t *buffer, size_t size);
+
 /** @internal @This is the private context of an aes pipe. */
 struct upipe_aes_decrypt {
     /** pipe public structure */
@@ -80,6 +103,8 @@ struct upipe_aes_decrypt {
     uint8_t round_keys[11][4][4];
     /** store initialization vector */
     uint8_t iv[16];
+    /** implementation of the CBC decryption */
+    aes_cbc_decrypt_func cbc_decrypt;
 };
 
 static int upipe_aes_decrypt_check(struct upipe *upipe, struct uref *uref);
@@ -369,18 +394,145 @@ static inline void aes_xor_iv(uint8_t state[4][4],
             state[i][j] ^= iv[i * 4 + j];
 }
 
-/** @internal @This decrypts an AES block.
+/** @internal @This decrypts AES blocks in CBC mode.
+ *
+ * @param round_keys the generated round keys
+ * @param iv the initialization vector, replaced with the last encrypted block
+ * @param buffer the blocks to decrypt in place
+ * @param size size of the buffer, multiple of 16 octets
+ */
+static void aes_cbc_decrypt_c(uint8_t round_keys[11][4][4],
+                              uint8_t iv[16],
+                              uint8_t *buffer, size_t size)
+{
+    for ( ; size >= 16; buffer += 16, size -= 16) {
+        uint8_t next_iv[16];
+        memcpy(next_iv, buffer, sizeof (next_iv));
+        aes_inv_cipher((uint8_t (*)[])buffer, round_keys);
+        aes_xor_iv((uint8_t (*)[])buffer, iv);
+        memcpy(iv, next_iv, sizeof (next_iv));
+    }
+}
+
+#ifdef UPIPE_AES_DECRYPT_X86
+/** @internal @This decrypts AES blocks in CBC mode with the AES-NI
+ * instructions. As CBC decryption does not depend on the previous output,
+ * four blocks are decrypted at once to hide the latency of the instructions.
+ *
+ * @param round_keys the generated round keys
+ * @param iv the initialization vector, replaced with the last encrypted block
+ * @param buffer the blocks to decrypt in place
+ * @param size size of the buffer, multiple of 16 octets
+ */
+__attribute__((target("aes,sse2")))
+static void aes_cbc_decrypt_aesni(uint8_t round_keys[11][4][4],
+                                  uint8_t iv[16],
+                                  uint8_t *buffer, size_t size)
+{
+    /* equivalent inverse cipher round keys */
+    __m128i k[11];
+    k[0] = _mm_loadu_si128((const __m128i *)round_keys[10]);
+    for (unsigned i = 1; i < 10; i++)
+        k[i] = _mm_aesimc_si128(
+            _mm_loadu_si128((const __m128i *)round_keys[10 - i]));
+    k[10] = _mm_loadu_si128((const __m128i *)round_keys[0]);
+
+    __m128i prev = _mm_loadu_si128((const __m128i *)iv);
+    while (size >= 64) {
+        __m128i c0 = _mm_loadu_si128((const __m128i *)buffer);
+        __m128i c1 = _mm_loadu_si128((const __m128i *)(buffer + 16));
+        __m128i c2 = _mm_loadu_si128((const __m128i *)(buffer + 32));
+        __m128i c3 = _mm_loadu_si128((const __m128i *)(buffer + 48));
+        __m128i x0 = _mm_xor_si128(c0, k[0]);
+        __m128i x1 = _mm_xor_si128(c1, k[0]);
+        __m128i x2 = _mm_xor_si128(c2, k[0]);
+        __m128i x3 = _mm_xor_si128(c3, k[0]);
+        for (unsigned i = 1; i < 10; i++) {
+            x0 = _mm_aesdec_si128(x0, k[i]);
+            x1 = _mm_aesdec_si128(x1, k[i]);
+            x2 = _mm_aesdec_si128(x2, k[i]);
+            x3 = _mm_aesdec_si128(x3, k[i]);
+        }
+        x0 = _mm_aesdeclast_si128(x0, k[10]);
+        x1 = _mm_aesdeclast_si128(x1, k[10]);
+        x2 = _mm_aesdeclast_si128(x2, k[10]);
+        x3 = _mm_aesdeclast_si128(x3, k[10]);
+        _mm_storeu_si128((__m128i *)buffer, _mm_xor_si128(x0, prev));
+        _mm_storeu_si128((__m128i *)(buffer + 16), _mm_xor_si128(x1, c0));
+        _mm_storeu_si128((__m128i *)(buffer + 32), _mm_xor_si128(x2, c1));
+        _mm_storeu_si128((__m128i *)(buffer + 48), _mm_xor_si128(x3, c2));
+        prev = c3;
+        buffer += 64;
+        size -= 64;
+    }
+
+    while (size >= 16) {
+        __m128i c = _mm_loadu_si128((const __m128i *)buffer);
+        __m128i x = _mm_xor_si128(c, k[0]);
+        for (unsigned i = 1; i < 10; i++)
+            x = _mm_aesdec_si128(x, k[i]);
+        x = _mm_aesdeclast_si128(x, k[10]);
+        _mm_storeu_si128((__m128i *)buffer, _mm_xor_si128(x, prev));
+        prev = c;
+        buffer += 16;
+        size -= 16;
+    }
+    _mm_storeu_si128((__m128i *)iv, prev);
+}
+#endif
+
+#ifdef UPIPE_AES_DECRYPT_ARM
+/** @internal @This decrypts AES blocks in CBC mode with the ARMv8
+ * cryptographic extension.
  *
- * @param buffer the block to decrypt inplace
  * @param round_keys the generated round keys
- * @param iv the initialization vector
+ * @param iv the initialization vector, replaced with the last encrypted block
+ * @param buffer the blocks to decrypt in place
+ * @param size size of the buffer, multiple of 16 octets
+ */
+__attribute__((target("+crypto")))
+static void aes_cbc_decrypt_arm(uint8_t round_keys[11][4][4],
+                                uint8_t iv[16],
+                                uint8_t *buffer, size_t size)
+{
+    /* equivalent inverse cipher round keys */
+    uint8x16_t k[11];
+    k[0] = vld1q_u8(&round_keys[10][0][0]);
+    for (unsigned i = 1; i < 10; i++)
+        k[i] = vaesimcq_u8(vld1q_u8(&round_keys[10 - i][0][0]));
+    k[10] = vld1q_u8(&round_keys[0][0][0]);
+
+    uint8x16_t prev = vld1q_u8(iv);
+    while (size >= 16) {
+        uint8x16_t c = vld1q_u8(buffer);
+        uint8x16_t x = c;
+        for (unsigned i = 0; i < 9; i++)
+            x = vaesimcq_u8(vaesdq_u8(x, k[i]));
+        x = veorq_u8(vaesdq_u8(x, k[9]), k[10]);
+        vst1q_u8(buffer, veorq_u8(x, prev));
+        prev = c;
+        buffer += 16;
+        size -= 16;
+    }
+    vst1q_u8(iv, prev);
+}
+#endif
+
+/** @internal @This returns the fastest CBC decryption for this CPU.
+ *
+ * @return a pointer to the decryption function
  */
-static inline void aes_cbc_decrypt(uint8_t buffer[16],
-                                   uint8_t round_keys[11][4][4],
-                                   const uint8_t iv[16])
+static aes_cbc_decrypt_func aes_cbc_decrypt_select(void)
 {
-    aes_inv_cipher((uint8_t (*)[])buffer, round_keys);
-    aes_xor_iv((uint8_t (*)[])buffer, iv);
+#ifdef UPIPE_AES_DECRYPT_X86
+    if ((ucpu_flags() & (UCPU_AES | UCPU_SSE2)) == (UCPU_AES | UCPU_SSE2))
+        return aes_cbc_decrypt_aesni;
+#endif
+#ifdef UPIPE_AES_DECRYPT_ARM
+    if (getauxval(AT_HWCAP) & HWCAP_AES)
+        return aes_cbc_decrypt_arm;
+#endif
+    return aes_cbc_decrypt_c;
 }
 
 /** @internal @This allocates an aes decryption pipe.
@@ -411,6 +563,7 @@ static struct upipe *upipe_aes_decrypt_alloc(struct upipe_mgr *mgr,
     upipe_aes_decrypt_init_uref_stream(upipe);
     upipe_aes_decrypt->input_flow_def = NULL;
     upipe_aes_decrypt->restart = true;
+    upipe_aes_decrypt->cbc_decrypt = aes_cbc_decrypt_select();
 
     upipe_throw_ready(upipe);
 
@@ -472,6 +625,66 @@ static int upipe_aes_decrypt_restart(struct upipe *upipe)
     }
 
     aes_key_expansion(key, upipe_aes_decrypt->round_keys);
+    memcpy(upipe_aes_decrypt->iv, iv, sizeof (upipe_aes_decrypt->iv));
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This checks that none of the segments of a block ubuf is
+ * shared, so that it can be decrypted in place.
+ *
+ * @param ubuf pointer to the block ubuf
+ * @return true if all segments are writable
+ */
+static bool upipe_aes_decrypt_writable(struct ubuf *ubuf)
+{
+    for ( ; ubuf != NULL; ubuf = ubuf_block_from_ubuf(ubuf)->next_ubuf)
+        if (!ubase_check(ubuf_control(ubuf, UBUF_SINGLE)))
+            return false;
+    return true;
+}
+
+/** @internal @This decrypts the blocks of a uref in place. The whole blocks
+ * of each segment are decrypted at once, and the blocks spanning two
+ * segments are decrypted in a temporary buffer.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref uref to decrypt, with writable segments
+ * @param size size of the uref, multiple of 16 octets
+ * @return an error code
+ */
+static int upipe_aes_decrypt_blocks(struct upipe *upipe, struct uref *uref,
+                                    int size)
+{
+    struct upipe_aes_decrypt *upipe_aes_decrypt =
+        upipe_aes_decrypt_from_upipe(upipe);
+    int offset = 0;
+
+    while (offset < size) {
+        int wsize = size - offset;
+        uint8_t *wbuf;
+        UBASE_RETURN(uref_block_write(uref, offset, &wsize, &wbuf));
+        int aligned = wsize & ~15;
+        upipe_aes_decrypt->cbc_decrypt(upipe_aes_decrypt->round_keys,
+                                       upipe_aes_decrypt->iv, wbuf, aligned);
+        UBASE_RETURN(uref_block_unmap(uref, offset));
+        offset += aligned;
+        if (aligned == wsize)
+            continue;
+
+        /* block spanning segments */
+        uint8_t block[16];
+        UBASE_RETURN(uref_block_extract(uref, offset, sizeof (block), block));
+        upipe_aes_decrypt->cbc_decrypt(upipe_aes_decrypt->round_keys,
+                                       upipe_aes_decrypt->iv,
+                                       block, sizeof (block));
+        for (int done = 0; done < (int)sizeof (block); done += wsize) {
+            wsize = (int)sizeof (block) - done;
+            UBASE_RETURN(uref_block_write(uref, offset + done, &wsize, &wbuf));
+            memcpy(wbuf, block + done, wsize);
+            UBASE_RETURN(uref_block_unmap(uref, offset + done));
+        }
+        offset += sizeof (block);
+    }
     return UBASE_ERR_NONE;
 }
 
@@ -496,48 +709,34 @@ static void upipe_aes_decrypt_worker(struct upipe *upipe,
 
     size_t block_size;
     ubase_assert(uref_block_size(upipe_aes_decrypt->next_uref, &block_size));
-    for (size_t size = block_size; size >= 16; size -= 16) {
-        int ret;
-
-        struct uref *uref = upipe_aes_decrypt_extract_uref_stream(upipe, 16);
-        if (unlikely(!uref)) {
-            upipe_throw_fatal(upipe, UBASE_ERR_INVALID);
-            return;
-        }
-
-        uint8_t iv[16];
-        ret = uref_block_extract(uref, 0, 16, iv);
-        if (unlikely(!ubase_check(ret))) {
-            uref_free(uref);
-            upipe_throw_fatal(upipe, UBASE_ERR_INVALID);
-            return;
-        }
+    /* decrypt all the complete blocks at once */
+    size_t size = block_size & ~(size_t)15;
+    if (!size)
+        return;
+
+    struct uref *uref = upipe_aes_decrypt_extract_uref_stream(upipe, size);
+    if (unlikely(!uref)) {
+        upipe_throw_fatal(upipe, UBASE_ERR_INVALID);
+        return;
+    }
 
-        struct ubuf *ubuf =
-            ubuf_block_alloc(upipe_aes_decrypt->ubuf_mgr, 16);
+    if (!upipe_aes_decrypt_writable(uref->ubuf)) {
+        struct ubuf *ubuf = ubuf_block_copy(upipe_aes_decrypt->ubuf_mgr,
+                                            uref->ubuf, 0, -1);
         if (unlikely(!ubuf)) {
             uref_free(uref);
             upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
             return;
         }
         uref_attach_ubuf(uref, ubuf);
+    }
 
-        int wsize = 16;
-        uint8_t *wbuf;
-        ret = uref_block_write(uref, 0, &wsize, &wbuf);
-        if (unlikely(!ubase_check(ret)) || wsize != 16) {
-            uref_free(uref);
-            upipe_throw_fatal(upipe, UBASE_ERR_INVALID);
-            return;
-        }
-        memcpy(wbuf, iv, wsize);
-        aes_cbc_decrypt(wbuf,
-                        upipe_aes_decrypt->round_keys,
-                        upipe_aes_decrypt->iv);
-        ubase_assert(uref_block_unmap(uref, 0));
-        memcpy(upipe_aes_decrypt->iv, iv, sizeof (upipe_aes_decrypt->iv));
-        upipe_aes_decrypt_output(upipe, uref, upump_p);
+    if (unlikely(!ubase_check(upipe_aes_decrypt_blocks(upipe, uref, size)))) {
+        uref_free(uref);
+        upipe_throw_fatal(upipe, UBASE_ERR_INVALID);
+        return;
     }
+    upipe_aes_decrypt_output(upipe, uref, upump_p);
 }
 
 /** @internal @This outputs the last block.
@@ -702,7 +901,7 @@ static int upipe_aes_decrypt_control(struct upipe *upipe,
     case UPIPE_GET_OUTPUT:
     case UPIPE_SET_OUTPUT:
     case UPIPE_GET_FLOW_DEF:
-        return upipe_aes_decrypt_control(upipe, command, args);
+        return upipe_aes_decrypt_control_output(upipe, command, args);
     case UPIPE_SET_FLOW_DEF: {
         struct uref *flow_def = va_arg(args, struct uref *);
         return upipe_aes_decrypt_set_flow_def(upipe, flow_def);
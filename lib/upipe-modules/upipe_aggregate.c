@@ -117,6 +117,22 @@ static struct upipe *upipe_agg_alloc(struct upipe_mgr *mgr,
     return upipe;
 }
 
+/** @internal @This outputs the current aggregation, if any.
+ *
+ * @param upipe description structure of the pipe
+ * @param upump_p reference to pump that generated the buffer
+ */
+static void upipe_agg_output_aggregated(struct upipe *upipe,
+                                        struct upump **upump_p)
+{
+    struct upipe_agg *upipe_agg = upipe_agg_from_upipe(upipe);
+    struct uref *aggregated = upipe_agg->aggregated;
+    upipe_agg->aggregated = NULL;
+    upipe_agg->size = 0;
+    if (aggregated != NULL)
+        upipe_agg_output(upipe, aggregated, upump_p);
+}
+
 /** @internal @This receives data.
  *
  * @param upipe description structure of the pipe
@@ -165,11 +181,8 @@ static void upipe_agg_input(struct upipe *upipe, struct uref *uref,
     /* anticipate next packet size and flush now if necessary */
     if (upipe_agg->input_size)
         size = upipe_agg->input_size;
-    if (unlikely(upipe_agg->size + size > output_size)) {
-        upipe_agg_output(upipe, upipe_agg->aggregated, upump_p);
-        upipe_agg->aggregated = NULL;
-        upipe_agg->size = 0;
-    }
+    if (unlikely(upipe_agg->size + size > output_size))
+        upipe_agg_output_aggregated(upipe, upump_p);
 }
 
 /** @internal @This sets the input flow definition.
@@ -223,6 +236,10 @@ static int upipe_agg_control(struct upipe *upipe, int command, va_list args)
             struct uref *flow_def = va_arg(args, struct uref *);
             return upipe_agg_set_flow_def(upipe, flow_def);
         }
+        case UPIPE_AGG_FLUSH:
+            UBASE_SIGNATURE_CHECK(args, UPIPE_AGG_SIGNATURE)
+            upipe_agg_output_aggregated(upipe, NULL);
+            return UBASE_ERR_NONE;
         default:
             return UBASE_ERR_UNHANDLED;
     }
@@ -236,9 +253,7 @@ static void upipe_agg_free(struct upipe *upipe)
 {
     struct upipe_agg *upipe_agg = upipe_agg_from_upipe(upipe);
 
-    if (unlikely(upipe_agg->aggregated)) {
-        upipe_agg_output(upipe, upipe_agg->aggregated, NULL);
-    }
+    upipe_agg_output_aggregated(upipe, NULL);
     upipe_throw_dead(upipe);
     upipe_agg_clean_output(upipe);
     upipe_agg_clean_output_size(upipe);
@@ -268,17 +268,23 @@ static int upipe_ablk_set_flow_def(struct upipe *upipe,
         return UBASE_ERR_ALLOC;
     }
 
+    /* the blank sound is shared by all the outputs, keep it as long as
+     * the format does not change */
+    bool same_format = upipe_ablk->flow_def != NULL &&
+        uref_sound_flow_compare_format(upipe_ablk->flow_def, flow_def_dup) &&
+        !uref_sound_flow_cmp_samples(upipe_ablk->flow_def, flow_def_dup);
     upipe_ablk_store_flow_def(upipe, flow_def_dup);
 
-    if (upipe_ablk->ubuf) {
-        ubuf_free(upipe_ablk->ubuf);
-        upipe_ablk->ubuf = NULL;
-    }
-
     if (upipe_ablk->ubuf_mgr &&
         !ubase_check(ubuf_mgr_check(upipe_ablk->ubuf_mgr, flow_def_dup))) {
         ubuf_mgr_release(upipe_ablk->ubuf_mgr);
         upipe_ablk->ubuf_mgr = NULL;
+        same_format = false;
+    }
+
+    if (upipe_ablk->ubuf && !same_format) {
+        ubuf_free(upipe_ablk->ubuf);
+        upipe_ablk->ubuf = NULL;
     }
 
     return UBASE_ERR_NONE;
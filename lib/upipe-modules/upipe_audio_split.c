@@ -33,6 +33,7 @@
 #include <upipe/uprobe.h>
 #include <upipe/uref.h>
 #include <upipe/ubuf.h>
+#include <upipe/ubuf_sound_mem.h>
 #include <upipe/upipe.h>
 #include <upipe/uref_sound.h>
 #include <upipe/uref_sound_flow.h>
@@ -68,6 +69,8 @@ struct upipe_audio_split {
     uint8_t channel_sample_size;
     /** number of channels */
     uint8_t channels;
+    /** number of planes (1 or channels) */
+    uint8_t planes;
 
     /** manager to create output subpipes */
     struct upipe_mgr sub_mgr;
@@ -185,6 +188,48 @@ static struct upipe *upipe_audio_split_sub_alloc(struct upipe_mgr *mgr,
     return upipe;
 }
 
+/** @internal @This outputs a planar selection of planar input channels,
+ * referencing the input planes instead of copying them.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref uref structure
+ * @param upump_p reference to pump that generated the buffer
+ * @return an error code
+ */
+static int upipe_audio_split_sub_share(struct upipe *upipe,
+                                       struct uref *uref,
+                                       struct upump **upump_p)
+{
+    struct upipe_audio_split_sub *sub = upipe_audio_split_sub_from_upipe(upipe);
+    struct upipe_audio_split *split = upipe_audio_split_from_sub_mgr(upipe->mgr);
+
+    /* input planes of the selected channels, in order */
+    const char *channels[sub->planes];
+    uint8_t plane = 0, in_idx = 0;
+    const char *channel = NULL;
+    while (plane < sub->planes &&
+           ubase_check(uref_sound_plane_iterate(uref, &channel)) && channel) {
+        if (in_idx < split->channels && (sub->bitfield & (UINT64_C(1) << in_idx)))
+            channels[plane++] = channel;
+        in_idx++;
+    }
+    if (unlikely(plane < sub->planes))
+        return UBASE_ERR_INVALID;
+
+    struct ubuf *ubuf = ubuf_sound_mem_alloc_from_sound(sub->ubuf_mgr,
+                                                        uref->ubuf, channels);
+    if (ubuf == NULL)
+        return UBASE_ERR_UNHANDLED;
+
+    struct uref *output = uref_fork(uref, ubuf);
+    if (unlikely(output == NULL)) {
+        ubuf_free(ubuf);
+        return UBASE_ERR_ALLOC;
+    }
+    upipe_audio_split_sub_output(upipe, output, upump_p);
+    return UBASE_ERR_NONE;
+}
+
 /** @internal @This processes data.
  *
  * @param upipe description structure of the pipe
@@ -200,15 +245,30 @@ static void upipe_audio_split_sub_process(struct upipe *upipe,
     if (unlikely(sub->ubuf_mgr == NULL))
         return;
 
+    /* planar to planar: share input planes */
+    if (split->planes > 1 && sub->planes == sub->channels) {
+        int err = upipe_audio_split_sub_share(upipe, uref, upump_p);
+        if (ubase_check(err))
+            return;
+        if (err != UBASE_ERR_UNHANDLED) {
+            upipe_throw_error(upipe, err);
+            return;
+        }
+        /* not a ubuf_sound_mem, fall back to copy */
+    }
+
     size_t samples;
-    const uint8_t *in_buf;
+    const uint8_t *in_bufs[split->planes];
     if (unlikely(!ubase_check(uref_sound_size(uref, &samples, NULL)) ||
                  !ubase_check(uref_sound_read_uint8_t(uref, 0, -1,
-                                                      &in_buf, 1)))) {
+                                                      in_bufs,
+                                                      split->planes)))) {
         upipe_warn(upipe, "invalid sound uref");
-        uref_free(uref);
         return;
     }
+    /* stride between two samples of a channel in the input */
+    size_t in_stride = split->planes > 1 ? split->channel_sample_size :
+                                           split->sample_size;
 
     struct ubuf *ubuf = ubuf_sound_alloc(sub->ubuf_mgr, samples);
     if (unlikely(ubuf == NULL)) {
@@ -223,7 +283,8 @@ static void upipe_audio_split_sub_process(struct upipe *upipe,
         uint8_t out_idx = 0;
 
         do {
-            while (in_idx < split->channels && !(sub->bitfield & (1 << in_idx)))
+            while (in_idx < split->channels &&
+                   !(sub->bitfield & (UINT64_C(1) << in_idx)))
                 in_idx++;
 
             if (unlikely(in_idx == split->channels)) {
@@ -238,15 +299,21 @@ static void upipe_audio_split_sub_process(struct upipe *upipe,
                 break;
             }
 
-            const uint8_t *in = in_buf + in_idx * split->channel_sample_size;
+            const uint8_t *in = split->planes > 1 ? in_bufs[in_idx] :
+                in_bufs[0] + in_idx * split->channel_sample_size;
             uint8_t *out = out_buf + out_idx * split->channel_sample_size;
-            int i, j;
-            for (i = 0; i < samples; i++) {
-                for (j = 0; j < split->channel_sample_size; j++) {
-                    out[j] = in[j];
+            if (in_stride == split->channel_sample_size &&
+                sub->sample_size == split->channel_sample_size) {
+                memcpy(out, in, samples * split->channel_sample_size);
+            } else {
+                int i, j;
+                for (i = 0; i < samples; i++) {
+                    for (j = 0; j < split->channel_sample_size; j++) {
+                        out[j] = in[j];
+                    }
+                    in += in_stride;
+                    out += sub->sample_size;
                 }
-                in += split->sample_size;
-                out += sub->sample_size;
             }
             ubuf_sound_plane_unmap(ubuf, channel, 0, -1);
 
@@ -267,7 +334,7 @@ static void upipe_audio_split_sub_process(struct upipe *upipe,
     upipe_audio_split_sub_output(upipe, output, upump_p);
 
 upipe_audio_split_sub_process_err:
-    uref_sound_unmap(uref, 0, -1, 1);
+    uref_sound_unmap(uref, 0, -1, split->planes);
 }
 
 /** @internal @This receives the result of ubuf manager requests.
@@ -321,7 +388,7 @@ static void upipe_audio_split_sub_build_flow_def(struct upipe *upipe)
         UBASE_ERROR(upipe, uref_sound_flow_set_rate(flow_def, rate))
     }
 
-    sub->sample_size = split->sample_size / split->channels;
+    sub->sample_size = split->channel_sample_size;
     if (sub->planes == 1)
         sub->sample_size *= sub->channels;
     UBASE_ERROR(upipe, uref_sound_flow_set_sample_size(flow_def,
@@ -453,14 +520,18 @@ static int upipe_audio_split_set_flow_def(struct upipe *upipe,
 
     struct upipe_audio_split *split = upipe_audio_split_from_upipe(upipe);
     UBASE_RETURN(uref_flow_match_def(flow_def, "sound."))
-    UBASE_RETURN(uref_sound_flow_match_planes(flow_def, 1, 1))
     UBASE_RETURN(uref_sound_flow_get_sample_size(flow_def,
                                                  &split->sample_size));
     UBASE_RETURN(uref_sound_flow_get_channels(flow_def, &split->channels));
+    UBASE_RETURN(uref_sound_flow_get_planes(flow_def, &split->planes));
     if (unlikely(!split->channels || split->channels > 64))
         return UBASE_ERR_INVALID;
+    /* either interleaved or one plane per channel */
+    if (unlikely(split->planes != 1 && split->planes != split->channels))
+        return UBASE_ERR_INVALID;
 
-    split->channel_sample_size = split->sample_size / split->channels;
+    split->channel_sample_size = split->planes > 1 ? split->sample_size :
+                                 split->sample_size / split->channels;
     if (unlikely(!split->channel_sample_size))
         return UBASE_ERR_INVALID;
 
@@ -39,6 +39,7 @@
 #include <upipe/uref_sound.h>
 #include <upipe/uref_sound_flow.h>
 #include <upipe/upipe.h>
+#include <upipe/ucpu.h>
 #include <upipe/upipe_helper_upipe.h>
 #include <upipe/upipe_helper_urefcount.h>
 #include <upipe/upipe_helper_void.h>
@@ -55,12 +56,21 @@
 #include <string.h>
 #include <assert.h>
 
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+#if defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
 /** only accept sound in 32 bit floating-point */
 #define EXPECTED_FLOW_DEF "sound.f32."
 /** by default cross-blend for 200 ms */
 #define CROSSBLEND_PERIOD (UCLOCK_FREQ / 5)
 /** define to get timing verbosity */
 #undef VERBOSE_TIMING
+/** size of the input ring buffers, in fractions of a second (500 ms) */
+#define RING_SECOND_FRACTION 2
 
 /** @hidden */
 static int upipe_audiocont_check(struct upipe *upipe, struct uref *flow_format);
@@ -90,6 +100,8 @@ struct upipe_audiocont {
 
     /** number of planes */
     uint8_t planes;
+    /** number of floats per sample in a plane */
+    uint8_t plane_floats;
     /** samplerate */
     uint64_t samplerate;
     /** crossblend period */
@@ -136,8 +148,21 @@ struct upipe_audiocont_sub {
     /** structure for double-linked lists */
     struct uchain uchain;
 
-    /** temporary uref storage */
-    struct uchain urefs;
+    /** ring buffer of planar samples, one area of ring_size samples
+     * per plane */
+    float *ring;
+    /** capacity of the ring buffer, in samples */
+    size_t ring_size;
+    /** index of the first buffered sample */
+    size_t ring_start;
+    /** number of buffered samples */
+    size_t ring_count;
+    /** date of reference of the buffered samples */
+    uint64_t ring_pts;
+    /** number of samples between ring_pts and the first buffered sample */
+    uint64_t ring_offset;
+    /** last input uref (without ubuf), carrying the attributes */
+    struct uref *attr;
 
     /** input flow definition packet */
     struct uref *flow_def;
@@ -153,10 +178,227 @@ UPIPE_HELPER_VOID(upipe_audiocont_sub)
 UPIPE_HELPER_SUBPIPE(upipe_audiocont, upipe_audiocont_sub, sub, sub_mgr,
                      subs, uchain)
 
+/** @internal @This mixes samples into a buffer with a linear gain ramp.
+ *
+ * @param out buffer to mix into
+ * @param in samples to mix
+ * @param samples number of samples
+ * @param floats number of floats per sample
+ * @param gain gain of the first sample
+ * @param step gain increment between samples
+ */
+static void upipe_audiocont_ramp_c(float *out, const float *in,
+                                   size_t samples, unsigned int floats,
+                                   float gain, float step)
+{
+    for (size_t i = 0; i < samples; i++) {
+        float g = gain + step * i;
+        for (unsigned int j = 0; j < floats; j++)
+            *out++ += *in++ * g;
+    }
+}
+
+/** @hidden */
+#define UPIPE_AUDIOCONT_RAMP(name, target, width, vec, set1, loadu, storeu,  \
+                             add, mul)                                      \
+/** @internal @This mixes samples into a buffer with a linear gain ramp,    \
+ * using vectors of width floats. Vectors span several samples when the     \
+ * number of floats per sample divides the width, and samples span several  \
+ * vectors otherwise.                                                       \
+ *                                                                          \
+ * @param out buffer to mix into                                            \
+ * @param in samples to mix                                                 \
+ * @param samples number of samples                                         \
+ * @param floats number of floats per sample                                \
+ * @param gain gain of the first sample                                     \
+ * @param step gain increment between samples                               \
+ * @return number of samples processed                                      \
+ */                                                                         \
+target                                                                      \
+static size_t upipe_audiocont_ramp_##name(float *out, const float *in,      \
+                                          size_t samples,                   \
+                                          unsigned int floats,              \
+                                          float gain, float step)           \
+{                                                                           \
+    vec g0 = set1(gain);                                                    \
+    vec st = set1(step);                                                    \
+    if (floats < width) {                                                   \
+        if (width % floats)                                                 \
+            return 0;                                                       \
+        unsigned int per_vec = width / floats;                              \
+        float lanes[width];                                                 \
+        for (unsigned int l = 0; l < width; l++)                            \
+            lanes[l] = l / floats;                                          \
+        vec idx = loadu(lanes);                                             \
+        vec inc = set1(per_vec);                                            \
+        size_t vecs = samples / per_vec;                                    \
+        for (size_t i = 0; i < vecs; i++) {                                 \
+            vec g = add(g0, mul(st, idx));                                  \
+            storeu(out, add(loadu(out), mul(loadu(in), g)));                \
+            idx = add(idx, inc);                                            \
+            out += width;                                                   \
+            in += width;                                                    \
+        }                                                                   \
+        return vecs * per_vec;                                              \
+    }                                                                       \
+                                                                            \
+    unsigned int vecs = floats / width;                                     \
+    unsigned int rest = floats % width;                                     \
+    for (size_t i = 0; i < samples; i++) {                                  \
+        float gs = gain + step * i;                                         \
+        vec g = set1(gs);                                                   \
+        for (unsigned int v = 0; v < vecs; v++) {                           \
+            storeu(out, add(loadu(out), mul(loadu(in), g)));                \
+            out += width;                                                   \
+            in += width;                                                    \
+        }                                                                   \
+        for (unsigned int j = 0; j < rest; j++)                             \
+            *out++ += *in++ * gs;                                           \
+    }                                                                       \
+    return samples;                                                         \
+}
+
+#if defined(__x86_64__)
+UPIPE_AUDIOCONT_RAMP(sse, , 4, __m128, _mm_set1_ps, _mm_loadu_ps,
+                     _mm_storeu_ps, _mm_add_ps, _mm_mul_ps)
+UPIPE_AUDIOCONT_RAMP(avx2, __attribute__((target("avx2"))), 8, __m256,
+                     _mm256_set1_ps, _mm256_loadu_ps, _mm256_storeu_ps,
+                     _mm256_add_ps, _mm256_mul_ps)
+#endif
+
+#if defined(__aarch64__)
+UPIPE_AUDIOCONT_RAMP(neon, , 4, float32x4_t, vdupq_n_f32, vld1q_f32,
+                     vst1q_f32, vaddq_f32, vmulq_f32)
+#endif
+
+#undef UPIPE_AUDIOCONT_RAMP
+
+/** @internal @This mixes samples into a buffer with a linear gain ramp,
+ * using the best available kernel.
+ *
+ * @param out buffer to mix into
+ * @param in samples to mix
+ * @param samples number of samples
+ * @param floats number of floats per sample
+ * @param gain gain of the first sample
+ * @param step gain increment between samples
+ */
+static void upipe_audiocont_ramp(float *out, const float *in,
+                                 size_t samples, unsigned int floats,
+                                 float gain, float step)
+{
+    size_t done = 0;
+#if defined(__x86_64__)
+    if ((floats >= 8 || !(8 % floats)) && (ucpu_flags() & UCPU_AVX2))
+        done = upipe_audiocont_ramp_avx2(out, in, samples, floats,
+                                         gain, step);
+    else
+        done = upipe_audiocont_ramp_sse(out, in, samples, floats,
+                                        gain, step);
+#endif
+#if defined(__aarch64__)
+    done = upipe_audiocont_ramp_neon(out, in, samples, floats, gain, step);
+#endif
+    upipe_audiocont_ramp_c(out + done * floats, in + done * floats,
+                           samples - done, floats, gain + step * done, step);
+}
+
 /** @hidden */
 static int upipe_audiocont_switch_input(struct upipe *upipe,
                                         struct upipe *input);
 
+/** @internal @This returns the ring buffer area of a plane.
+ *
+ * @param upipe description structure of the subpipe
+ * @param plane index of the plane
+ * @return pointer to the first float of the plane area
+ */
+static float *upipe_audiocont_sub_ring_plane(struct upipe *upipe,
+                                             uint8_t plane)
+{
+    struct upipe_audiocont_sub *sub = upipe_audiocont_sub_from_upipe(upipe);
+    struct upipe_audiocont *upipe_audiocont =
+                            upipe_audiocont_from_sub_mgr(upipe->mgr);
+    return sub->ring + plane * sub->ring_size * upipe_audiocont->plane_floats;
+}
+
+/** @internal @This returns the date of the first buffered sample.
+ *
+ * @param upipe description structure of the subpipe
+ * @return PTS of the first buffered sample
+ */
+static uint64_t upipe_audiocont_sub_ring_pts(struct upipe *upipe)
+{
+    struct upipe_audiocont_sub *sub = upipe_audiocont_sub_from_upipe(upipe);
+    struct upipe_audiocont *upipe_audiocont =
+                            upipe_audiocont_from_sub_mgr(upipe->mgr);
+    return sub->ring_pts +
+           sub->ring_offset * UCLOCK_FREQ / upipe_audiocont->samplerate;
+}
+
+/** @internal @This drops samples from the head of the ring buffer.
+ *
+ * @param upipe description structure of the subpipe
+ * @param samples number of samples to drop
+ */
+static void upipe_audiocont_sub_skip(struct upipe *upipe, size_t samples)
+{
+    struct upipe_audiocont_sub *sub = upipe_audiocont_sub_from_upipe(upipe);
+    struct upipe_audiocont *upipe_audiocont =
+                            upipe_audiocont_from_sub_mgr(upipe->mgr);
+    uint64_t samplerate = upipe_audiocont->samplerate;
+
+    assert(samples <= sub->ring_count);
+    sub->ring_count -= samples;
+    sub->ring_start = sub->ring_count ?
+                      (sub->ring_start + samples) % sub->ring_size : 0;
+
+    /* a second worth of samples lasts exactly UCLOCK_FREQ */
+    sub->ring_offset += samples;
+    sub->ring_pts += sub->ring_offset / samplerate * UCLOCK_FREQ;
+    sub->ring_offset %= samplerate;
+}
+
+/** @internal @This grows the ring buffer.
+ *
+ * @param upipe description structure of the subpipe
+ * @param samples minimum number of samples the ring buffer must hold
+ * @return an error code
+ */
+static int upipe_audiocont_sub_grow(struct upipe *upipe, size_t samples)
+{
+    struct upipe_audiocont_sub *sub = upipe_audiocont_sub_from_upipe(upipe);
+    struct upipe_audiocont *upipe_audiocont =
+                            upipe_audiocont_from_sub_mgr(upipe->mgr);
+    size_t floats = upipe_audiocont->plane_floats;
+
+    size_t ring_size = sub->ring_size ? sub->ring_size : 1;
+    while (ring_size < samples)
+        ring_size *= 2;
+    float *ring = malloc(upipe_audiocont->planes * ring_size * floats *
+                         sizeof(float));
+    UBASE_ALLOC_RETURN(ring)
+
+    size_t first = sub->ring_size - sub->ring_start;
+    if (first > sub->ring_count)
+        first = sub->ring_count;
+    for (uint8_t plane = 0; plane < upipe_audiocont->planes; plane++) {
+        const float *old = upipe_audiocont_sub_ring_plane(upipe, plane);
+        float *copy = ring + plane * ring_size * floats;
+        memcpy(copy, old + sub->ring_start * floats,
+               first * floats * sizeof(float));
+        memcpy(copy + first * floats, old,
+               (sub->ring_count - first) * floats * sizeof(float));
+    }
+
+    upipe_dbg_va(upipe, "growing ring buffer to %zu samples", ring_size);
+    free(sub->ring);
+    sub->ring = ring;
+    sub->ring_size = ring_size;
+    sub->ring_start = 0;
+    return UBASE_ERR_NONE;
+}
+
 /** @internal @This allocates an input subpipe of a audiocont pipe.
  *
  * @param mgr common management structure
@@ -176,9 +418,27 @@ static struct upipe *upipe_audiocont_sub_alloc(struct upipe_mgr *mgr,
 
     struct upipe_audiocont_sub *upipe_audiocont_sub =
         upipe_audiocont_sub_from_upipe(upipe);
+    struct upipe_audiocont *upipe_audiocont =
+                            upipe_audiocont_from_sub_mgr(mgr);
+
+    /* preallocate the ring buffer */
+    upipe_audiocont_sub->ring_size = upipe_audiocont->samplerate /
+                                     RING_SECOND_FRACTION;
+    upipe_audiocont_sub->ring = malloc(upipe_audiocont->planes *
+            upipe_audiocont_sub->ring_size * upipe_audiocont->plane_floats *
+            sizeof(float));
+    if (unlikely(upipe_audiocont_sub->ring == NULL)) {
+        upipe_audiocont_sub_free_void(upipe);
+        return NULL;
+    }
+    upipe_audiocont_sub->ring_start = 0;
+    upipe_audiocont_sub->ring_count = 0;
+    upipe_audiocont_sub->ring_pts = 0;
+    upipe_audiocont_sub->ring_offset = 0;
+    upipe_audiocont_sub->attr = NULL;
+
     upipe_audiocont_sub_init_urefcount(upipe);
     upipe_audiocont_sub_init_sub(upipe);
-    ulist_init(&upipe_audiocont_sub->urefs);
     upipe_audiocont_sub->flow_def = NULL;
 
     upipe_throw_ready(upipe);
@@ -196,6 +456,10 @@ static void upipe_audiocont_sub_input(struct upipe *upipe, struct uref *uref,
 {
     struct upipe_audiocont_sub *upipe_audiocont_sub =
                                 upipe_audiocont_sub_from_upipe(upipe);
+    struct upipe_audiocont *upipe_audiocont =
+                            upipe_audiocont_from_sub_mgr(upipe->mgr);
+    uint8_t planes = upipe_audiocont->planes;
+    size_t floats = upipe_audiocont->plane_floats;
 
     uint64_t pts;
     if (unlikely(!ubase_check(uref_clock_get_pts_sys(uref, &pts)))) {
@@ -210,7 +474,63 @@ static void upipe_audiocont_sub_input(struct upipe *upipe, struct uref *uref,
         return;
     }
 
-    ulist_add(&upipe_audiocont_sub->urefs, uref_to_uchain(uref));
+    size_t size;
+    const float *in_buffers[planes];
+    if (unlikely(!ubase_check(uref_sound_size(uref, &size, NULL)) ||
+                 !ubase_check(uref_sound_read_float(uref, 0, -1, in_buffers,
+                                                    planes)))) {
+        upipe_warn(upipe, "invalid input buffer");
+        uref_free(uref);
+        return;
+    }
+
+    /* restart the ring buffer on discontinuities */
+    if (upipe_audiocont_sub->ring_count) {
+        uint64_t end = upipe_audiocont_sub_ring_pts(upipe) +
+                       upipe_audiocont_sub->ring_count * UCLOCK_FREQ /
+                       upipe_audiocont->samplerate;
+        if (pts > end + duration || pts + duration < end) {
+            upipe_warn_va(upipe, "discontinuity (%"PRId64"), flushing",
+                          (int64_t)(pts - end));
+            upipe_audiocont_sub_skip(upipe, upipe_audiocont_sub->ring_count);
+        }
+    }
+    if (!upipe_audiocont_sub->ring_count) {
+        upipe_audiocont_sub->ring_pts = pts;
+        upipe_audiocont_sub->ring_offset = 0;
+    }
+
+    if (unlikely(upipe_audiocont_sub->ring_count + size >
+                     upipe_audiocont_sub->ring_size &&
+                 !ubase_check(upipe_audiocont_sub_grow(upipe,
+                         upipe_audiocont_sub->ring_count + size)))) {
+        uref_sound_unmap(uref, 0, -1, planes);
+        uref_free(uref);
+        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+        return;
+    }
+
+    /* append samples to the ring buffer */
+    size_t tail = (upipe_audiocont_sub->ring_start +
+                    upipe_audiocont_sub->ring_count) %
+                   upipe_audiocont_sub->ring_size;
+    size_t first = upipe_audiocont_sub->ring_size - tail;
+    if (first > size)
+        first = size;
+    for (uint8_t plane = 0; plane < planes; plane++) {
+        float *ring = upipe_audiocont_sub_ring_plane(upipe, plane);
+        memcpy(ring + tail * floats, in_buffers[plane],
+               first * floats * sizeof(float));
+        memcpy(ring, in_buffers[plane] + first * floats,
+               (size - first) * floats * sizeof(float));
+    }
+    upipe_audiocont_sub->ring_count += size;
+    uref_sound_unmap(uref, 0, -1, planes);
+
+    /* keep the attributes of the last packet */
+    ubuf_free(uref_detach_ubuf(uref));
+    uref_free(upipe_audiocont_sub->attr);
+    upipe_audiocont_sub->attr = uref;
 }
 
 /** @internal @This sets the input flow definition.
@@ -357,12 +677,8 @@ static void upipe_audiocont_sub_free(struct upipe *upipe)
     struct upipe_audiocont *upipe_audiocont =
                             upipe_audiocont_from_sub_mgr(upipe->mgr);
 
-    struct uchain *uchain, *uchain_tmp;
-    ulist_delete_foreach (&upipe_audiocont_sub->urefs, uchain, uchain_tmp) {
-        struct uref *uref = uref_from_uchain(uchain);
-        ulist_delete(uchain);
-        uref_free(uref);
-    }
+    free(upipe_audiocont_sub->ring);
+    uref_free(upipe_audiocont_sub->attr);
     if (upipe == upipe_audiocont->input_cur) {
         upipe_audiocont_switch_input(upipe_audiocont_to_upipe(upipe_audiocont),
                                      NULL);
@@ -379,12 +695,11 @@ static void upipe_audiocont_sub_free(struct upipe *upipe)
     upipe_audiocont_sub_free_void(upipe);
 }
 
-/** @internal @This consumes samples from the uref stream.
+/** @internal @This drops the samples that are too old from the ring buffer.
  *
  * @param upipe description structure of the pipe
  * @param next_pts PTS of the first extracted sample
  * @param next_duration duration of the forthcoming ubuf
- * @return an error code
  */
 static void upipe_audiocont_sub_consume(struct upipe *upipe,
         uint64_t next_pts, uint64_t next_duration)
@@ -392,32 +707,28 @@ static void upipe_audiocont_sub_consume(struct upipe *upipe,
     struct upipe_audiocont_sub *sub = upipe_audiocont_sub_from_upipe(upipe);
     struct upipe_audiocont *upipe_audiocont =
                             upipe_audiocont_from_sub_mgr(upipe->mgr);
-    struct uchain *uchain, *uchain_tmp;
-    ulist_delete_foreach(&sub->urefs, uchain, uchain_tmp) {
-        uint64_t pts = 0;
-        uint64_t duration = 0;
-        size_t size = 0;
-        struct uref *uref_uchain = uref_from_uchain(uchain);
-        uref_clock_get_pts_sys(uref_uchain, &pts);
-        uref_clock_get_duration(uref_uchain, &duration);
-        uref_sound_size(uref_uchain, &size, NULL);
-
-        /* next_duration acts as a tolerance */
-        if (pts + upipe_audiocont->latency + duration
-                                           + next_duration >= next_pts)
-            break;
-
-        /* packet too old */
+
+    /* next_duration acts as a tolerance */
+    uint64_t tolerance = upipe_audiocont->latency + next_duration;
+    if (!sub->ring_count || next_pts <= tolerance)
+        return;
+    uint64_t limit = next_pts - tolerance;
+    uint64_t pts = upipe_audiocont_sub_ring_pts(upipe);
+    if (pts >= limit)
+        return;
+
+    /* samples too old */
+    uint64_t old = (limit - pts) * upipe_audiocont->samplerate / UCLOCK_FREQ;
+    if (old > sub->ring_count)
+        old = sub->ring_count;
 #ifdef VERBOSE_TIMING
-        upipe_verbose_va(upipe, "deleted %p (%"PRIu64") next %"PRIu64"",
-                         uref_uchain, pts, next_pts);
+    upipe_verbose_va(upipe, "deleted %"PRIu64" samples (%"PRIu64") next %"PRIu64"",
+                     old, pts, next_pts);
 #endif
-        ulist_delete(uchain);
-        uref_free(uref_uchain);
-    }
+    upipe_audiocont_sub_skip(upipe, old);
 }
 
-/** @internal @This extracts from the uref stream to an allocated ubuf.
+/** @internal @This extracts from the ring buffer to an allocated ubuf.
  *
  * @param upipe description structure of the pipe
  * @param ubuf allocated ubuf
@@ -434,10 +745,29 @@ static int upipe_audiocont_sub_extract(struct upipe *upipe, struct ubuf *ubuf,
     struct upipe_audiocont_sub *sub = upipe_audiocont_sub_from_upipe(upipe);
     struct upipe_audiocont *upipe_audiocont =
                             upipe_audiocont_from_sub_mgr(upipe->mgr);
+    float step = upipe_audiocont->crossblend_step;
+    size_t floats = upipe_audiocont->plane_floats;
+
+    if (previous && initial_crossblend >= 1.)
+        return UBASE_ERR_NONE;
+
+    if (unlikely(!sub->ring_count)) {
+        upipe_verbose_va(upipe, "no input samples found (%"PRIu64")",
+                         next_pts);
+        return UBASE_ERR_NONE;
+    }
+    uint64_t pts = upipe_audiocont_sub_ring_pts(upipe);
+    if (pts + upipe_audiocont->latency > next_pts + next_duration) {
+        /* NOTE : next_duration is needed here because packets
+         * in the future are not mangled */
+        upipe_verbose_va(upipe,
+            "input samples in the future %"PRIu64" > %"PRIu64,
+            pts + upipe_audiocont->latency, next_pts);
+        return UBASE_ERR_NONE;
+    }
 
     size_t ref_size;
-    uint8_t sample_size;
-    UBASE_RETURN(ubuf_sound_size(ubuf, &ref_size, &sample_size))
+    UBASE_RETURN(ubuf_sound_size(ubuf, &ref_size, NULL))
 
     /* We assume the ubuf is allocated by us and therefore can be writtent and
      * is contiguous. */
@@ -446,85 +776,47 @@ static int upipe_audiocont_sub_extract(struct upipe *upipe, struct ubuf *ubuf,
     UBASE_RETURN(ubuf_sound_write_float(ubuf, 0, -1, ref_buffers,
                                         upipe_audiocont->planes))
 
-    /* copy input sound buffer to output stream */
+    size_t extracted = ref_size < sub->ring_count ? ref_size : sub->ring_count;
+    upipe_verbose_va(upipe, "ext %zu buffered %zu ref %zu",
+                     extracted, sub->ring_count, ref_size);
+
+    /* copy ring buffer to output stream, in at most two segments */
     size_t offset = 0;
-    while (offset < ref_size) {
-        if (previous && initial_crossblend == 1.)
-            break;
-
-        struct uchain *uchain = ulist_peek(&sub->urefs);
-        if (unlikely(!uchain)) {
-            upipe_verbose_va(upipe, "no input samples found (%"PRIu64")",
-                             next_pts);
-            break;
-        }
-        struct uref *input_uref = uref_from_uchain(uchain);
-        size_t size;
-        uint64_t pts = 0;
-        uref_clock_get_pts_sys(input_uref, &pts);
-        if (pts + upipe_audiocont->latency > next_pts + next_duration) {
-            /* NOTE : next_duration is needed here because packets
-             * in the future are not mangled */
-            upipe_verbose_va(upipe,
-                "input samples in the future %"PRIu64" > %"PRIu64,
-                pts + upipe_audiocont->latency, next_pts);
-            break;
-        }
-        uref_sound_size(input_uref, &size, NULL);
-
-        size_t extracted = ((ref_size - offset) < size) ?
-                           (ref_size - offset) : size;
-        upipe_verbose_va(upipe, "%p off %zu ext %zu size %zu ref %zu",
-                         input_uref, offset, extracted, size, ref_size);
-        const float *in_buffers[planes];
-        if (unlikely(!ubase_check(uref_sound_read_float(input_uref, 0,
-                                       extracted, in_buffers, planes)))) {
-            upipe_warn(upipe, "invalid input buffer");
-            uref_free(uref_from_uchain(ulist_pop(&sub->urefs)));
-            continue;
+    while (offset < extracted) {
+        size_t start = sub->ring_start;
+        size_t length = sub->ring_size - start;
+        if (length > extracted - offset)
+            length = extracted - offset;
+
+        /* number of crossblended samples */
+        float crossblend = initial_crossblend + step * offset;
+        size_t ramp = 0;
+        if (crossblend < 1.) {
+            float remaining = (1. - crossblend) / step;
+            ramp = !(step > 0.) || remaining >= length ?
+                   length : (size_t)remaining + 1;
         }
-        uint8_t plane;
-        for (plane = 0;
-             (plane < planes) && ref_buffers[plane] && in_buffers[plane];
+
+        for (uint8_t plane = 0; plane < planes && ref_buffers[plane];
              plane++) {
-            float *ref_buffer = ref_buffers[plane] +
-                                offset * sample_size / sizeof(float);
-            const float *in_buffer = in_buffers[plane];
-            size_t extracted_plane = extracted;
-            float crossblend = initial_crossblend;
-
-            while (extracted_plane) {
-                if (crossblend >= 1.) {
-                    if (!previous)
-                        memcpy(ref_buffer, in_buffer,
-                               extracted_plane * sample_size);
-                    break;
-                }
-
-                float real_crossblend = previous ?
-                                        (1. - crossblend) : crossblend;
-                for (int i = 0; i < sample_size / sizeof(float); i++)
-                    ref_buffer[i] += in_buffer[i] * real_crossblend;
-
-                ref_buffer += sample_size / sizeof(float);
-                in_buffer += sample_size / sizeof(float);
-                extracted_plane--;
-                crossblend += upipe_audiocont->crossblend_step;
+            float *ref_buffer = ref_buffers[plane] + offset * floats;
+            const float *in_buffer =
+                upipe_audiocont_sub_ring_plane(upipe, plane) + start * floats;
+            if (ramp) {
+                if (previous)
+                    upipe_audiocont_ramp(ref_buffer, in_buffer, ramp, floats,
+                                         1. - crossblend, -step);
+                else
+                    upipe_audiocont_ramp(ref_buffer, in_buffer, ramp, floats,
+                                         crossblend, step);
             }
+            if (!previous && length > ramp)
+                memcpy(ref_buffer + ramp * floats, in_buffer + ramp * floats,
+                       (length - ramp) * floats * sizeof(float));
         }
 
-        uref_sound_unmap(input_uref, 0, extracted, planes);
-
-        offset += extracted;
-        initial_crossblend += upipe_audiocont->crossblend_step * extracted;
-        if (extracted == size) {
-            /* input buffer entirely copied */
-            uref_free(uref_from_uchain(ulist_pop(&sub->urefs)));
-        } else {
-            /* resize input buffer (drop copied segment) */
-            uref_sound_consume(input_uref, extracted,
-                               upipe_audiocont->samplerate);
-        }
+        upipe_audiocont_sub_skip(upipe, length);
+        offset += length;
     }
 
     ubuf_sound_unmap(ubuf, 0, -1, planes);
@@ -540,16 +832,12 @@ static int upipe_audiocont_sub_extract(struct upipe *upipe, struct ubuf *ubuf,
 static int upipe_audiocont_sub_import_attr(struct upipe *upipe, struct uref *uref)
 {
     struct upipe_audiocont_sub *sub = upipe_audiocont_sub_from_upipe(upipe);
-    struct upipe_audiocont *upipe_audiocont =
-                            upipe_audiocont_from_sub_mgr(upipe->mgr);
 
-    struct uchain *uchain = ulist_peek(&sub->urefs);
-    if (unlikely(!uchain)) {
+    if (unlikely(sub->attr == NULL)) {
         upipe_verbose(upipe, "no input samples found");
         return UBASE_ERR_INVALID;
     }
-    struct uref *input_uref = uref_from_uchain(uchain);
-    uref_attr_import(uref, input_uref);
+    uref_attr_import(uref, sub->attr);
     uref_clock_delete_rate(uref);
     return UBASE_ERR_NONE;
 }
@@ -589,9 +877,14 @@ static struct upipe *upipe_audiocont_alloc(struct upipe_mgr *mgr,
         return NULL;
 
     struct upipe_audiocont *upipe_audiocont = upipe_audiocont_from_upipe(upipe);
+    uint8_t sample_size;
     if (unlikely(!ubase_check(uref_sound_flow_get_planes(flow_def,
                         &upipe_audiocont->planes)) ||
                  !upipe_audiocont->planes ||
+                 !ubase_check(uref_sound_flow_get_sample_size(flow_def,
+                         &sample_size)) ||
+                 !(upipe_audiocont->plane_floats =
+                       sample_size / sizeof(float)) ||
                  !ubase_check(uref_sound_flow_get_rate(flow_def,
                          &upipe_audiocont->samplerate)) ||
                  !upipe_audiocont->samplerate)) {
@@ -700,7 +993,7 @@ static void upipe_audiocont_input(struct upipe *upipe, struct uref *uref,
         return;
     }
 
-    /* clean old urefs first */
+    /* clean old samples first */
     struct uchain *uchain_sub;
     ulist_foreach(&upipe_audiocont->subs, uchain_sub) {
         struct upipe_audiocont_sub *sub =
@@ -726,11 +1019,11 @@ static void upipe_audiocont_input(struct upipe *upipe, struct uref *uref,
     const char *channel = NULL;
     while (ubase_check(uref_sound_plane_iterate(uref, &channel)) && channel) {
         float *buf;
-        uref_sound_plane_write_float(uref, channel, 0, -1, &buf);
-        for (int i = 0; i < ref_size; i++)
-            for (int j = 0; j < sample_size / sizeof(float); j++)
-                *buf++ = 0.;
-        uref_sound_plane_unmap(uref, channel, 0, -1);
+        if (ubase_check(uref_sound_plane_write_float(uref, channel, 0, -1,
+                                                     &buf))) {
+            memset(buf, 0, ref_size * sample_size);
+            uref_sound_plane_unmap(uref, channel, 0, -1);
+        }
     }
 
     /* check if the previous stream is needed */
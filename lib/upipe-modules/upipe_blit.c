@@ -48,9 +48,464 @@
 #include <string.h>
 #include <assert.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define UPIPE_BLIT_SSE2
+#elif defined(__aarch64__) && !defined(__AARCH64EB__)
+#include <arm_neon.h>
+#define UPIPE_BLIT_NEON
+#endif
+
 /** we only accept pictures */
 #define EXPECTED_FLOW_DEF "pic."
 
+/** maximum number of rectangles recomposited by a prepare */
+#define UPIPE_BLIT_MAX_DIRTY 16
+/** number of samples of the per-line alpha buffer */
+#define UPIPE_BLIT_CHUNK 256
+
+/** @internal @This describes a rectangle of the output picture. */
+struct upipe_blit_rect {
+    /** horizontal offset */
+    uint64_t hoffset;
+    /** vertical offset */
+    uint64_t voffset;
+    /** horizontal size, or 0 for an empty rectangle */
+    uint64_t hsize;
+    /** vertical size, or 0 for an empty rectangle */
+    uint64_t vsize;
+};
+
+#ifdef UPIPE_BLIT_SSE2
+/** @internal @This blends 8 16-bit samples, with 8-bit alphas.
+ *
+ * @param d destination samples
+ * @param s source samples
+ * @param a alpha values
+ * @return (d * (255 - a) + s * a) / 255, for samples up to 255
+ */
+static inline __m128i upipe_blit_blend_8_sse2(__m128i d, __m128i s, __m128i a)
+{
+    __m128i x = _mm_add_epi16(
+        _mm_mullo_epi16(d, _mm_sub_epi16(_mm_set1_epi16(0xff), a)),
+        _mm_mullo_epi16(s, a));
+    /* exact division by 255 for x <= 65025 */
+    x = _mm_add_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)),
+                      _mm_set1_epi16(1));
+    return _mm_srli_epi16(x, 8);
+}
+
+/** @internal @This divides 4 32-bit integers by 255.
+ *
+ * @param x integers to divide
+ * @return x / 255
+ */
+static inline __m128i upipe_blit_div255_sse2(__m128i x)
+{
+    const __m128i m = _mm_set1_epi32(0x80808081);
+    __m128i even = _mm_srli_epi64(_mm_mul_epu32(x, m), 39);
+    __m128i odd = _mm_srli_epi64(_mm_mul_epu32(_mm_srli_epi64(x, 32), m), 39);
+    return _mm_or_si128(even, _mm_slli_epi64(odd, 32));
+}
+
+/** @internal @This multiplies 8 unsigned 16-bit integers.
+ *
+ * @param a first operands
+ * @param b second operands
+ * @param hi_p filled in with the products of the last 4 operands
+ * @return the products of the first 4 operands
+ */
+static inline __m128i upipe_blit_mul_16_sse2(__m128i a, __m128i b,
+                                             __m128i *hi_p)
+{
+    __m128i lo = _mm_mullo_epi16(a, b);
+    __m128i hi = _mm_mulhi_epu16(a, b);
+    *hi_p = _mm_unpackhi_epi16(lo, hi);
+    return _mm_unpacklo_epi16(lo, hi);
+}
+#endif
+
+#ifdef UPIPE_BLIT_NEON
+/** @internal @This divides 4 32-bit integers by 255.
+ *
+ * @param x integers to divide
+ * @return x / 255
+ */
+static inline uint32x4_t upipe_blit_div255_neon(uint32x4_t x)
+{
+    const uint32x4_t m = vdupq_n_u32(0x80808081);
+    uint64x2_t lo = vmull_u32(vget_low_u32(x), vget_low_u32(m));
+    uint64x2_t hi = vmull_high_u32(x, m);
+    return vcombine_u32(vmovn_u64(vshrq_n_u64(lo, 39)),
+                        vmovn_u64(vshrq_n_u64(hi, 39)));
+}
+#endif
+
+/** @internal @This blends a line of 8-bit samples with per-sample alphas.
+ *
+ * @param dest destination samples
+ * @param src source samples
+ * @param a alpha values
+ * @param n number of samples
+ */
+static void upipe_blit_blend_8(uint8_t *dest, const uint8_t *src,
+                               const uint8_t *a, int n)
+{
+    int j = 0;
+#ifdef UPIPE_BLIT_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    for ( ; j + 16 <= n; j += 16) {
+        __m128i d = _mm_loadu_si128((const __m128i *)(dest + j));
+        __m128i s = _mm_loadu_si128((const __m128i *)(src + j));
+        __m128i av = _mm_loadu_si128((const __m128i *)(a + j));
+        __m128i lo = upipe_blit_blend_8_sse2(_mm_unpacklo_epi8(d, zero),
+                                             _mm_unpacklo_epi8(s, zero),
+                                             _mm_unpacklo_epi8(av, zero));
+        __m128i hi = upipe_blit_blend_8_sse2(_mm_unpackhi_epi8(d, zero),
+                                             _mm_unpackhi_epi8(s, zero),
+                                             _mm_unpackhi_epi8(av, zero));
+        _mm_storeu_si128((__m128i *)(dest + j), _mm_packus_epi16(lo, hi));
+    }
+#endif
+#ifdef UPIPE_BLIT_NEON
+    const uint16x8_t one = vdupq_n_u16(1);
+    for ( ; j + 16 <= n; j += 16) {
+        uint8x16_t d = vld1q_u8(dest + j);
+        uint8x16_t s = vld1q_u8(src + j);
+        uint8x16_t av = vld1q_u8(a + j);
+        uint8x16_t na = vmvnq_u8(av);
+        uint16x8_t lo = vmlal_u8(vmull_u8(vget_low_u8(d), vget_low_u8(na)),
+                                 vget_low_u8(s), vget_low_u8(av));
+        uint16x8_t hi = vmlal_high_u8(vmull_high_u8(d, na), s, av);
+        lo = vaddq_u16(vaddq_u16(lo, vshrq_n_u16(lo, 8)), one);
+        hi = vaddq_u16(vaddq_u16(hi, vshrq_n_u16(hi, 8)), one);
+        vst1q_u8(dest + j, vcombine_u8(vshrn_n_u16(lo, 8),
+                                       vshrn_n_u16(hi, 8)));
+    }
+#endif
+    for ( ; j < n; j++)
+        dest[j] = (dest[j] * (0xff - a[j]) + src[j] * a[j]) / 0xff;
+}
+
+/** @internal @This copies the 8-bit samples whose alpha is above a threshold.
+ *
+ * @param dest destination samples
+ * @param src source samples
+ * @param a alpha values
+ * @param threshold alpha threshold, lower than 255
+ * @param n number of samples
+ */
+static void upipe_blit_select_8(uint8_t *dest, const uint8_t *src,
+                                const uint8_t *a, uint8_t threshold, int n)
+{
+    int j = 0;
+#ifdef UPIPE_BLIT_SSE2
+    const __m128i th = _mm_set1_epi8((char)(threshold + 1));
+    for ( ; j + 16 <= n; j += 16) {
+        __m128i d = _mm_loadu_si128((const __m128i *)(dest + j));
+        __m128i s = _mm_loadu_si128((const __m128i *)(src + j));
+        __m128i av = _mm_loadu_si128((const __m128i *)(a + j));
+        __m128i m = _mm_cmpeq_epi8(_mm_max_epu8(av, th), av);
+        _mm_storeu_si128((__m128i *)(dest + j),
+                         _mm_or_si128(_mm_and_si128(m, s),
+                                      _mm_andnot_si128(m, d)));
+    }
+#endif
+#ifdef UPIPE_BLIT_NEON
+    const uint8x16_t th = vdupq_n_u8(threshold);
+    for ( ; j + 16 <= n; j += 16) {
+        uint8x16_t m = vcgtq_u8(vld1q_u8(a + j), th);
+        vst1q_u8(dest + j, vbslq_u8(m, vld1q_u8(src + j),
+                                    vld1q_u8(dest + j)));
+    }
+#endif
+    for ( ; j < n; j++)
+        if (a[j] > threshold)
+            dest[j] = src[j];
+}
+
+/** @internal @This blends a line of 16-bit samples with per-sample alphas.
+ *
+ * @param dest destination samples
+ * @param src source samples
+ * @param a alpha values
+ * @param n number of samples
+ */
+static void upipe_blit_blend_16(uint16_t *dest, const uint16_t *src,
+                                const uint8_t *a, int n)
+{
+    int j = 0;
+#ifdef UPIPE_BLIT_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i bias = _mm_set1_epi32(0x8000);
+    for ( ; j + 8 <= n; j += 8) {
+        __m128i d = _mm_loadu_si128((const __m128i *)(dest + j));
+        __m128i s = _mm_loadu_si128((const __m128i *)(src + j));
+        __m128i av = _mm_unpacklo_epi8(
+            _mm_loadl_epi64((const __m128i *)(a + j)), zero);
+        __m128i na = _mm_sub_epi16(_mm_set1_epi16(0xff), av);
+        __m128i dh, sh;
+        __m128i dl = upipe_blit_mul_16_sse2(d, na, &dh);
+        __m128i sl = upipe_blit_mul_16_sse2(s, av, &sh);
+        __m128i lo = upipe_blit_div255_sse2(_mm_add_epi32(dl, sl));
+        __m128i hi = upipe_blit_div255_sse2(_mm_add_epi32(dh, sh));
+        /* unsigned saturation is SSE4.1, so pack with a bias */
+        __m128i r = _mm_packs_epi32(_mm_sub_epi32(lo, bias),
+                                    _mm_sub_epi32(hi, bias));
+        _mm_storeu_si128((__m128i *)(dest + j),
+                         _mm_xor_si128(r, _mm_set1_epi16((short)0x8000)));
+    }
+#endif
+#ifdef UPIPE_BLIT_NEON
+    for ( ; j + 8 <= n; j += 8) {
+        uint16x8_t d = vld1q_u16(dest + j);
+        uint16x8_t s = vld1q_u16(src + j);
+        uint16x8_t av = vmovl_u8(vld1_u8(a + j));
+        uint16x8_t na = vsubq_u16(vdupq_n_u16(0xff), av);
+        uint32x4_t lo = vmlal_u16(vmull_u16(vget_low_u16(d), vget_low_u16(na)),
+                                  vget_low_u16(s), vget_low_u16(av));
+        uint32x4_t hi = vmlal_high_u16(vmull_high_u16(d, na), s, av);
+        vst1q_u16(dest + j,
+                  vcombine_u16(vmovn_u32(upipe_blit_div255_neon(lo)),
+                               vmovn_u32(upipe_blit_div255_neon(hi))));
+    }
+#endif
+    for ( ; j < n; j++)
+        dest[j] = ((uint32_t)dest[j] * (0xff - a[j]) +
+                   (uint32_t)src[j] * a[j]) / 0xff;
+}
+
+/** @internal @This copies the 16-bit samples whose alpha is above a
+ * threshold.
+ *
+ * @param dest destination samples
+ * @param src source samples
+ * @param a alpha values
+ * @param threshold alpha threshold, lower than 255
+ * @param n number of samples
+ */
+static void upipe_blit_select_16(uint16_t *dest, const uint16_t *src,
+                                 const uint8_t *a, uint8_t threshold, int n)
+{
+    int j = 0;
+#ifdef UPIPE_BLIT_SSE2
+    const __m128i th = _mm_set1_epi8((char)(threshold + 1));
+    for ( ; j + 8 <= n; j += 8) {
+        __m128i d = _mm_loadu_si128((const __m128i *)(dest + j));
+        __m128i s = _mm_loadu_si128((const __m128i *)(src + j));
+        __m128i av = _mm_loadl_epi64((const __m128i *)(a + j));
+        __m128i m = _mm_cmpeq_epi8(_mm_max_epu8(av, th), av);
+        m = _mm_unpacklo_epi8(m, m);
+        _mm_storeu_si128((__m128i *)(dest + j),
+                         _mm_or_si128(_mm_and_si128(m, s),
+                                      _mm_andnot_si128(m, d)));
+    }
+#endif
+#ifdef UPIPE_BLIT_NEON
+    const uint8x8_t th = vdup_n_u8(threshold);
+    for ( ; j + 8 <= n; j += 8) {
+        uint8x8_t m = vcgt_u8(vld1_u8(a + j), th);
+        uint16x8_t m16 = vreinterpretq_u16_s16(
+            vmovl_s8(vreinterpret_s8_u8(m)));
+        vst1q_u16(dest + j, vbslq_u16(m16, vld1q_u16(src + j),
+                                      vld1q_u16(dest + j)));
+    }
+#endif
+    for ( ; j < n; j++)
+        if (a[j] > threshold)
+            dest[j] = src[j];
+}
+
+/** @internal @This blends a line of a subpicture onto a line of a picture,
+ * with the same methods as @ref ubuf_pic_blit_alpha.
+ *
+ * @param dest destination line
+ * @param src source line
+ * @param alpha_line line of the alpha plane of the source, or NULL
+ * @param hsub horizontal subsampling of the plane
+ * @param samples number of samples of the line
+ * @param wide true if samples are 16 bits
+ * @param alpha alpha multiplier
+ * @param threshold alpha blending method
+ */
+static void upipe_blit_line(uint8_t *dest, const uint8_t *src,
+                            const uint8_t *alpha_line, uint8_t hsub,
+                            int samples, bool wide,
+                            uint8_t alpha, uint8_t threshold)
+{
+    uint8_t buffer[UPIPE_BLIT_CHUNK];
+    if (alpha_line == NULL)
+        memset(buffer, alpha, sizeof (buffer));
+
+    for (int j = 0; j < samples; j += UPIPE_BLIT_CHUNK) {
+        int n = samples - j;
+        if (n > UPIPE_BLIT_CHUNK)
+            n = UPIPE_BLIT_CHUNK;
+
+        const uint8_t *a = buffer;
+        if (alpha_line != NULL && hsub == 1 && alpha == 0xff)
+            a = alpha_line + j;
+        else if (alpha_line != NULL) {
+            for (int k = 0; k < n; k++) {
+                uint8_t v = alpha_line[(j + k) * hsub];
+                buffer[k] = alpha == 0xff ? v :
+                            (uint16_t)v * (uint16_t)alpha / 0xff;
+            }
+        }
+
+        if (wide) {
+            uint16_t *d = (uint16_t *)dest + j;
+            const uint16_t *s = (const uint16_t *)src + j;
+            if (alpha_line != NULL && threshold != 0xff)
+                upipe_blit_select_16(d, s, a, threshold, n);
+            else
+                upipe_blit_blend_16(d, s, a, n);
+        } else {
+            if (alpha_line != NULL && threshold != 0xff)
+                upipe_blit_select_8(dest + j, src + j, a, threshold, n);
+            else
+                upipe_blit_blend_8(dest + j, src + j, a, n);
+        }
+    }
+}
+
+/** @internal @This blits a rectangle of a subpicture onto a picture, with
+ * the same methods as @ref ubuf_pic_blit, but blending 16-bit samples
+ * as such.
+ *
+ * @param dest destination ubuf
+ * @param src source ubuf
+ * @param dest_hoffset number of pixels to seek at the beginning of each line
+ * of dest
+ * @param dest_voffset number of lines to seek at the beginning of dest
+ * @param src_hoffset number of pixels to skip at the beginning of each line
+ * of src
+ * @param src_voffset number of lines to skip at the beginning of src
+ * @param extract_hsize horizontal size to copy
+ * @param extract_vsize vertical size to copy
+ * @param alpha alpha multiplier
+ * @param threshold alpha blending method
+ * @return an error code
+ */
+static int upipe_blit_ubuf(struct ubuf *dest, struct ubuf *src,
+                           int dest_hoffset, int dest_voffset,
+                           int src_hoffset, int src_voffset,
+                           int extract_hsize, int extract_vsize,
+                           uint8_t alpha, uint8_t threshold)
+{
+    const uint8_t *alpha_plane;
+    size_t alpha_stride = 0;
+    if (!ubase_check(ubuf_pic_plane_read(src, "a8", src_hoffset, src_voffset,
+                                         extract_hsize, extract_vsize,
+                                         &alpha_plane)))
+        alpha_plane = NULL;
+    else if (unlikely(!ubase_check(ubuf_pic_plane_size(src, "a8",
+                        &alpha_stride, NULL, NULL, NULL)))) {
+        ubuf_pic_plane_unmap(src, "a8", src_hoffset, src_voffset,
+                             extract_hsize, extract_vsize);
+        return UBASE_ERR_INVALID;
+    }
+
+    int err = UBASE_ERR_NONE;
+    uint8_t src_macropixel, dest_macropixel;
+    if (alpha_plane == NULL && alpha < threshold)
+        goto end; /* nothing to do */
+
+    if (unlikely(!ubase_check(err = ubuf_pic_size(src, NULL, NULL,
+                                                  &src_macropixel)) ||
+                 !ubase_check(err = ubuf_pic_size(dest, NULL, NULL,
+                                                  &dest_macropixel))))
+        goto end;
+    if (unlikely(dest_macropixel != src_macropixel)) {
+        err = UBASE_ERR_INVALID;
+        goto end;
+    }
+
+    const char *chroma = NULL;
+    while (ubase_check(ubuf_pic_plane_iterate(dest, &chroma)) &&
+           chroma != NULL) {
+        size_t src_stride, dest_stride;
+        uint8_t src_hsub, src_vsub, src_macropixel_size;
+        uint8_t dest_hsub, dest_vsub, dest_macropixel_size;
+        if (unlikely(!ubase_check(err = ubuf_pic_plane_size(src, chroma,
+                            &src_stride, &src_hsub, &src_vsub,
+                            &src_macropixel_size)) ||
+                     !ubase_check(err = ubuf_pic_plane_size(dest, chroma,
+                            &dest_stride, &dest_hsub, &dest_vsub,
+                            &dest_macropixel_size))))
+            goto end;
+        if (unlikely(src_hsub != dest_hsub || src_vsub != dest_vsub ||
+                     src_macropixel_size != dest_macropixel_size)) {
+            err = UBASE_ERR_INVALID;
+            goto end;
+        }
+
+        uint8_t *dest_buffer;
+        const uint8_t *src_buffer;
+        if (unlikely(!ubase_check(err = ubuf_pic_plane_write(dest, chroma,
+                            dest_hoffset, dest_voffset,
+                            extract_hsize, extract_vsize, &dest_buffer))))
+            goto end;
+        if (unlikely(!ubase_check(err = ubuf_pic_plane_read(src, chroma,
+                            src_hoffset, src_voffset,
+                            extract_hsize, extract_vsize, &src_buffer)))) {
+            ubuf_pic_plane_unmap(dest, chroma, dest_hoffset, dest_voffset,
+                                 extract_hsize, extract_vsize);
+            goto end;
+        }
+
+        int plane_hsize = extract_hsize / src_hsub / src_macropixel *
+                          src_macropixel_size;
+        int plane_vsize = extract_vsize / src_vsub;
+        /* planar formats with more than 8 bits per sample */
+        bool wide = src_macropixel == 1 && src_macropixel_size == 2;
+        bool copy = (alpha_plane == NULL && alpha == 0xff) || threshold == 0;
+
+        for (int i = 0; i < plane_vsize; i++) {
+            if (copy)
+                memcpy(dest_buffer, src_buffer, plane_hsize);
+            else
+                upipe_blit_line(dest_buffer, src_buffer,
+                                alpha_plane == NULL ? NULL :
+                                alpha_plane + alpha_stride * (i * src_vsub),
+                                src_hsub, wide ? plane_hsize / 2 : plane_hsize,
+                                wide, alpha, threshold);
+            dest_buffer += dest_stride;
+            src_buffer += src_stride;
+        }
+
+        ubuf_pic_plane_unmap(dest, chroma, dest_hoffset, dest_voffset,
+                             extract_hsize, extract_vsize);
+        ubuf_pic_plane_unmap(src, chroma, src_hoffset, src_voffset,
+                             extract_hsize, extract_vsize);
+    }
+
+end:
+    if (alpha_plane != NULL)
+        ubuf_pic_plane_unmap(src, "a8", src_hoffset, src_voffset,
+                             extract_hsize, extract_vsize);
+    return err;
+}
+
+/** @internal @This checks whether all the planes of a picture may be
+ * written.
+ *
+ * @param ubuf pointer to ubuf
+ * @return true if the picture is writable
+ */
+static bool upipe_blit_writable(struct ubuf *ubuf)
+{
+    const char *chroma = NULL;
+    while (ubase_check(ubuf_pic_plane_iterate(ubuf, &chroma)) &&
+           chroma != NULL) {
+        if (!ubase_check(ubuf_pic_plane_write(ubuf, chroma, 0, 0, -1, -1,
+                                              NULL)) ||
+            !ubase_check(ubuf_pic_plane_unmap(ubuf, chroma, 0, 0, -1, -1)))
+            return false;
+    }
+    return true;
+}
+
 /** @internal @This is the private context of a blit pipe */
 struct upipe_blit {
     /** refcount management structure */
@@ -85,6 +540,15 @@ struct upipe_blit {
 
     /** last received uref */
     struct uref *uref;
+    /** true if the background changed since the last prepare */
+    bool background_changed;
+    /** last composited picture, kept while the background does not change */
+    struct ubuf *composite;
+    /** rectangles of the composited picture to recomposite */
+    struct upipe_blit_rect dirty[UPIPE_BLIT_MAX_DIRTY];
+    /** number of rectangles to recomposite, UPIPE_BLIT_MAX_DIRTY + 1 to
+     * recomposite the whole picture */
+    unsigned int nb_dirty;
 
     /** public upipe structure */
     struct upipe upipe;
@@ -97,6 +561,32 @@ UPIPE_HELPER_OUTPUT(upipe_blit, output, flow_def, output_state, request_list)
 
 static void upipe_blit_sort(struct upipe *upipe);
 
+/** @internal @This adds a rectangle to recomposite in the next picture.
+ *
+ * @param upipe description structure of the pipe
+ * @param rect rectangle of the output picture
+ */
+static void upipe_blit_add_dirty(struct upipe *upipe,
+                                 const struct upipe_blit_rect *rect)
+{
+    struct upipe_blit *upipe_blit = upipe_blit_from_upipe(upipe);
+    if (!rect->hsize || !rect->vsize)
+        return;
+    for (unsigned int i = 0; i < upipe_blit->nb_dirty &&
+                             i < UPIPE_BLIT_MAX_DIRTY; i++) {
+        const struct upipe_blit_rect *d = &upipe_blit->dirty[i];
+        if (rect->hoffset >= d->hoffset && rect->voffset >= d->voffset &&
+            rect->hoffset + rect->hsize <= d->hoffset + d->hsize &&
+            rect->voffset + rect->vsize <= d->voffset + d->vsize)
+            return; /* already covered */
+    }
+    if (upipe_blit->nb_dirty >= UPIPE_BLIT_MAX_DIRTY) {
+        upipe_blit->nb_dirty = UPIPE_BLIT_MAX_DIRTY + 1;
+        return;
+    }
+    upipe_blit->dirty[upipe_blit->nb_dirty++] = *rect;
+}
+
 /** @internal @This is the private context of an input of a blit pipe. */
 struct upipe_blit_sub {
     /** refcount management structure */
@@ -130,6 +620,10 @@ struct upipe_blit_sub {
 
     /** last received ubuf */
     struct ubuf *ubuf;
+    /** true if the subpicture changed since the last prepare */
+    bool dirty;
+    /** rectangle covered in the last composited picture */
+    struct upipe_blit_rect rect;
 
     /** computed horizontal size */
     uint64_t hsize;
@@ -179,6 +673,9 @@ static struct upipe *upipe_blit_sub_alloc(struct upipe_mgr *mgr,
     sub->loffset = sub->roffset = sub->toffset = sub->boffset = 0;
     sub->loffset_r = sub->roffset_r = sub->toffset_r = sub->boffset_r = 0;
     sub->ubuf = NULL;
+    sub->dirty = false;
+    sub->rect.hoffset = sub->rect.voffset = 0;
+    sub->rect.hsize = sub->rect.vsize = 0;
     sub->hsize = sub->vsize = sub->hposition = sub->vposition = UINT64_MAX;
     ulist_init(&sub->flow_format_requests);
 
@@ -189,20 +686,41 @@ static struct upipe *upipe_blit_sub_alloc(struct upipe_mgr *mgr,
     return upipe;
 }
 
-/** @internal @This blits the subpicture into the input uref.
+/** @internal @This blits the part of the subpicture which is inside a
+ * rectangle into the output picture.
 *
 * @param upipe description structure of the pipe
-* @param uref uref structure
+* @param ubuf output picture
+* @param rect rectangle to recomposite, or NULL for the whole subpicture
 */
-static void upipe_blit_sub_work(struct upipe *upipe, struct uref *uref)
+static void upipe_blit_sub_work(struct upipe *upipe, struct ubuf *ubuf,
+                                const struct upipe_blit_rect *rect)
 {
     struct upipe_blit_sub *sub = upipe_blit_sub_from_upipe(upipe);
     if (unlikely(sub->ubuf == NULL))
         return;
 
-    int err = uref_pic_blit(uref, sub->ubuf, sub->hposition, sub->vposition,
-                            0, 0, sub->hsize, sub->vsize, sub->alpha,
-                            sub->alpha_threshold);
+    uint64_t hstart = sub->hposition, vstart = sub->vposition;
+    uint64_t hend = sub->hposition + sub->hsize;
+    uint64_t vend = sub->vposition + sub->vsize;
+    if (rect != NULL) {
+        if (hstart < rect->hoffset)
+            hstart = rect->hoffset;
+        if (vstart < rect->voffset)
+            vstart = rect->voffset;
+        if (hend > rect->hoffset + rect->hsize)
+            hend = rect->hoffset + rect->hsize;
+        if (vend > rect->voffset + rect->vsize)
+            vend = rect->voffset + rect->vsize;
+        if (hstart >= hend || vstart >= vend)
+            return;
+    }
+
+    int err = upipe_blit_ubuf(ubuf, sub->ubuf, hstart, vstart,
+                              hstart - sub->hposition,
+                              vstart - sub->vposition,
+                              hend - hstart, vend - vstart,
+                              sub->alpha, sub->alpha_threshold);
     if (unlikely(!ubase_check(err))) {
         upipe_warn(upipe, "unable to blit picture");
         upipe_throw_error(upipe, err);
@@ -244,6 +762,7 @@ static void upipe_blit_sub_input(struct upipe *upipe, struct uref *uref,
 
     ubuf_free(sub->ubuf);
     sub->ubuf = uref_detach_ubuf(uref);
+    sub->dirty = true;
     uref_free(uref);
 }
 
@@ -478,6 +997,7 @@ static int upipe_blit_sub_set_flow_def(struct upipe *upipe,
 
     ubuf_free(sub->ubuf);
     sub->ubuf = NULL;
+    sub->dirty = true;
 
     return UBASE_ERR_NONE;
 }
@@ -549,6 +1069,7 @@ static int _upipe_blit_sub_set_alpha(struct upipe *upipe, uint8_t alpha)
 {
     struct upipe_blit_sub *sub = upipe_blit_sub_from_upipe(upipe);
     sub->alpha = alpha;
+    sub->dirty = true;
     return UBASE_ERR_NONE;
 }
 
@@ -578,6 +1099,7 @@ static int _upipe_blit_sub_set_alpha_threshold(struct upipe *upipe,
 {
     struct upipe_blit_sub *sub = upipe_blit_sub_from_upipe(upipe);
     sub->alpha_threshold = threshold;
+    sub->dirty = true;
     return UBASE_ERR_NONE;
 }
 
@@ -604,6 +1126,7 @@ static int _upipe_blit_sub_set_z_index(struct upipe *upipe, int z_index)
 {
     struct upipe_blit_sub *sub = upipe_blit_sub_from_upipe(upipe);
     sub->z_index = z_index;
+    sub->dirty = true;
 
     struct upipe_blit *upipe_blit = upipe_blit_from_sub_mgr(upipe->mgr);
     upipe_blit_sort(upipe_blit_to_upipe(upipe_blit));
@@ -726,7 +1249,9 @@ static int upipe_blit_sub_compare(struct uchain **uchain1,
 static void upipe_blit_sub_free(struct upipe *upipe)
 {
     struct upipe_blit_sub *sub = upipe_blit_sub_from_upipe(upipe);
+    struct upipe_blit *upipe_blit = upipe_blit_from_sub_mgr(upipe->mgr);
     upipe_throw_dead(upipe);
+    upipe_blit_add_dirty(upipe_blit_to_upipe(upipe_blit), &sub->rect);
     ubuf_free(sub->ubuf);
     upipe_blit_sub_clean_sub(upipe);
     upipe_blit_sub_clean_urefcount(upipe);
@@ -773,6 +1298,9 @@ static struct upipe *upipe_blit_alloc(struct upipe_mgr *mgr,
     upipe_blit_init_sub_subs(upipe);
     upipe_blit->hsize = upipe_blit->vsize = UINT64_MAX;
     upipe_blit->uref = NULL;
+    upipe_blit->background_changed = false;
+    upipe_blit->composite = NULL;
+    upipe_blit->nb_dirty = 0;
 
     upipe_throw_ready(upipe);
     return upipe;
@@ -808,6 +1336,7 @@ static void upipe_blit_input(struct upipe *upipe, struct uref *uref,
 
     uref_free(upipe_blit->uref);
     upipe_blit->uref = uref;
+    upipe_blit->background_changed = true;
 }
 
 /** @internal @This sets the input flow definition.
@@ -856,6 +1385,8 @@ static int upipe_blit_set_flow_def(struct upipe *upipe, struct uref *flow_def)
     upipe_blit->hsize = hsize;
     upipe_blit->vsize = vsize;
     upipe_blit->sar = sar;
+    ubuf_free(upipe_blit->composite);
+    upipe_blit->composite = NULL;
 
     struct uchain *uchain;
     ulist_foreach (&upipe_blit->subs, uchain) {
@@ -865,7 +1396,62 @@ static int upipe_blit_set_flow_def(struct upipe *upipe, struct uref *flow_def)
     return UBASE_ERR_NONE;
 }
 
+/** @internal @This recomposites a rectangle of the last composited picture,
+ * from the background and the subpictures which intersect it.
+ *
+ * @param upipe description structure of the pipe
+ * @param rect rectangle to recomposite
+ */
+static void upipe_blit_recomposite(struct upipe *upipe,
+                                   const struct upipe_blit_rect *rect)
+{
+    struct upipe_blit *upipe_blit = upipe_blit_from_upipe(upipe);
+
+    /* Round the rectangle to whole macropixels and chroma lines */
+    uint64_t hround = upipe_blit->hsub * upipe_blit->macropixel;
+    uint64_t vround = upipe_blit->vsub;
+    uint64_t hstart = rect->hoffset - rect->hoffset % hround;
+    uint64_t vstart = rect->voffset - rect->voffset % vround;
+    uint64_t hend = rect->hoffset + rect->hsize;
+    uint64_t vend = rect->voffset + rect->vsize;
+    hend += (hround - hend % hround) % hround;
+    vend += (vround - vend % vround) % vround;
+    if (hend > upipe_blit->hsize)
+        hend = upipe_blit->hsize;
+    if (vend > upipe_blit->vsize)
+        vend = upipe_blit->vsize;
+    if (hstart >= hend || vstart >= vend)
+        return;
+
+    struct upipe_blit_rect r;
+    r.hoffset = hstart;
+    r.voffset = vstart;
+    r.hsize = hend - hstart;
+    r.vsize = vend - vstart;
+
+    /* Restore the background */
+    int err = upipe_blit_ubuf(upipe_blit->composite, upipe_blit->uref->ubuf,
+                              r.hoffset, r.voffset, r.hoffset, r.voffset,
+                              r.hsize, r.vsize, 0xff, 0);
+    if (unlikely(!ubase_check(err))) {
+        upipe_warn(upipe, "unable to restore background");
+        upipe_throw_error(upipe, err);
+        return;
+    }
+
+    struct uchain *uchain;
+    ulist_foreach (&upipe_blit->subs, uchain) {
+        struct upipe_blit_sub *sub = upipe_blit_sub_from_uchain(uchain);
+        upipe_blit_sub_work(upipe_blit_sub_to_upipe(sub),
+                            upipe_blit->composite, &r);
+    }
+}
+
 /** @internal @This prepares the next picture to output.
+ *
+ * As long as the background does not change, the composited picture is
+ * kept, and only the rectangles covered by subpictures that changed since
+ * the last call are recomposited.
  *
  * @param upipe description structure of the pipe
  * @param upump_p reference to pump that generated the buffer
@@ -877,51 +1463,91 @@ static int _upipe_blit_prepare(struct upipe *upipe, struct upump **upump_p)
     if (unlikely(upipe_blit->uref == NULL))
         return UBASE_ERR_INVALID;
     struct uref *uref = uref_dup(upipe_blit->uref);
+    UBASE_ALLOC_RETURN(uref);
 
+    /* Collect the rectangles of changed subpictures, before and after */
     struct uchain *uchain;
     bool subpic = false;
     ulist_foreach (&upipe_blit->subs, uchain) {
         struct upipe_blit_sub *sub = upipe_blit_sub_from_uchain(uchain);
-        if (likely(sub->ubuf != NULL)) {
-            subpic = true;
-            break;
+        if (sub->dirty) {
+            upipe_blit_add_dirty(upipe, &sub->rect);
+            sub->rect.hsize = sub->rect.vsize = 0;
+            if (sub->ubuf != NULL) {
+                sub->rect.hoffset = sub->hposition;
+                sub->rect.voffset = sub->vposition;
+                sub->rect.hsize = sub->hsize;
+                sub->rect.vsize = sub->vsize;
+            }
+            upipe_blit_add_dirty(upipe, &sub->rect);
+            sub->dirty = false;
         }
+        if (likely(sub->ubuf != NULL))
+            subpic = true;
     }
 
+    bool background_changed = upipe_blit->background_changed;
+    unsigned int nb_dirty = upipe_blit->nb_dirty;
+    upipe_blit->background_changed = false;
+    upipe_blit->nb_dirty = 0;
+
     /* Avoid copying the picture if there is nothing to blit */
     if (!subpic) {
+        ubuf_free(upipe_blit->composite);
+        upipe_blit->composite = NULL;
         upipe_blit_output(upipe, uref, upump_p);
         return UBASE_ERR_NONE;
     }
 
-    /* Check if we can write on the planes */
-    bool writable = true;
-    const char *chroma = NULL;
-    while (ubase_check(uref_pic_plane_iterate(uref, &chroma)) &&
-           chroma != NULL) {
-        if (!ubase_check(uref_pic_plane_write(uref, chroma, 0, 0, -1, -1,
-                                              NULL)) ||
-            !ubase_check(uref_pic_plane_unmap(uref, chroma, 0, 0, -1, -1))) {
-            writable = false;
-            break;
+    if (!background_changed && upipe_blit->composite != NULL &&
+        nb_dirty <= UPIPE_BLIT_MAX_DIRTY) {
+        if (nb_dirty && !upipe_blit_writable(upipe_blit->composite)) {
+            struct ubuf *ubuf = ubuf_pic_copy(upipe_blit->composite->mgr,
+                                              upipe_blit->composite,
+                                              0, 0, -1, -1);
+            if (unlikely(ubuf == NULL)) {
+                uref_free(uref);
+                return UBASE_ERR_ALLOC;
+            }
+            ubuf_free(upipe_blit->composite);
+            upipe_blit->composite = ubuf;
+        }
+
+        for (unsigned int i = 0; i < nb_dirty; i++)
+            upipe_blit_recomposite(upipe, &upipe_blit->dirty[i]);
+
+        struct ubuf *ubuf = ubuf_dup(upipe_blit->composite);
+        if (unlikely(ubuf == NULL)) {
+            uref_free(uref);
+            return UBASE_ERR_ALLOC;
         }
+        uref_attach_ubuf(uref, ubuf);
+        upipe_blit_output(upipe, uref, upump_p);
+        return UBASE_ERR_NONE;
     }
 
-    if (!writable) {
+    /* Check if we can write on the planes */
+    if (!upipe_blit_writable(uref->ubuf)) {
         struct ubuf *ubuf = ubuf_pic_copy(uref->ubuf->mgr, uref->ubuf,
                                           0, 0, -1, -1);
         if (unlikely(ubuf == NULL)) {
             uref_free(uref);
-            return UBASE_ERR_ALLOC;;
+            return UBASE_ERR_ALLOC;
         }
         uref_attach_ubuf(uref, ubuf);
     }
 
     ulist_foreach (&upipe_blit->subs, uchain) {
         struct upipe_blit_sub *sub = upipe_blit_sub_from_uchain(uchain);
-        upipe_blit_sub_work(upipe_blit_sub_to_upipe(sub), uref);
+        upipe_blit_sub_work(upipe_blit_sub_to_upipe(sub), uref->ubuf, NULL);
     }
 
+    /* Keep the composited picture if the background looks static */
+    ubuf_free(upipe_blit->composite);
+    upipe_blit->composite = NULL;
+    if (!background_changed)
+        upipe_blit->composite = ubuf_dup(uref->ubuf);
+
     upipe_blit_output(upipe, uref, upump_p);
     return UBASE_ERR_NONE;
 }
@@ -966,6 +1592,7 @@ static void upipe_blit_free(struct upipe *upipe)
     struct upipe_blit *upipe_blit = upipe_blit_from_upipe(upipe);
     uref_free(upipe_blit->uref);
     upipe_blit_clean_sub_subs(upipe);
+    ubuf_free(upipe_blit->composite);
     upipe_blit_clean_output(upipe);
     upipe_blit_clean_urefcount(upipe);
     upipe_blit_free_void(upipe);
@@ -38,6 +38,7 @@
 #include <upipe/ubuf_block.h>
 #include <upipe/uref_block_flow.h>
 #include <upipe/ubuf_sound.h>
+#include <upipe/ubuf_sound_mem.h>
 #include <upipe/uref_sound_flow.h>
 #include <upipe/upipe_helper_upipe.h>
 #include <upipe/upipe_helper_urefcount.h>
@@ -148,6 +149,33 @@ static struct upipe *upipe_block_to_sound_alloc(struct upipe_mgr *mgr,
     return upipe;
 }
 
+/** @internal @This exposes the block buffer of a uref as a sound buffer,
+ * without copying. This is only possible if the block is not segmented and
+ * correctly aligned for the sample format.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref uref structure
+ * @return pointer to sound ubuf, or NULL if a copy is required
+ */
+static struct ubuf *upipe_block_to_sound_share(struct upipe *upipe,
+                                               struct uref *uref)
+{
+    struct upipe_block_to_sound *upipe_block_to_sound = upipe_block_to_sound_from_upipe(upipe);
+
+    const uint8_t *r;
+    int end = -1;
+    if (unlikely(!ubase_check(uref_block_read(uref, 0, &end, &r))))
+        return NULL;
+    uref_block_unmap(uref, 0);
+
+    if ((uintptr_t)r % sizeof(int32_t))
+        return NULL;
+
+    /* fails if the block is segmented or not from a block mem manager */
+    return ubuf_sound_mem_alloc_from_block(upipe_block_to_sound->ubuf_mgr,
+                                           uref->ubuf);
+}
+
 /** @internal @This converts block urefs to sound urefs.
  *
  * @param upipe description structure of the pipe
@@ -171,6 +199,13 @@ static void upipe_block_to_sound_input(struct upipe *upipe, struct uref *uref, s
     int samples = block_size / upipe_block_to_sound->sample_size;
     block_size = samples * upipe_block_to_sound->sample_size;
 
+    struct ubuf *ubuf_shared = upipe_block_to_sound_share(upipe, uref);
+    if (likely(ubuf_shared != NULL)) {
+        uref_attach_ubuf(uref, ubuf_shared);
+        upipe_block_to_sound_output(upipe, uref, upump_p);
+        return;
+    }
+
     /* alloc sound ubuf */
     struct ubuf *ubuf_block_to_sound = ubuf_sound_alloc(upipe_block_to_sound->ubuf_mgr,
                                                         samples);
@@ -28,11 +28,15 @@
  *
  * The buffer pipe directly forwards the input uref if it can. When the output
  * upump is blocked by the output pipe, the buffer pipe still accepts the input
- * uref until the maximum size is reached.
+ * uref until the maximum size is reached. Then, depending on the policy, the
+ * input upump is blocked, the oldest urefs are dropped, or the content of
+ * the new urefs is moved to a temporary file and read back on output.
  */
 
 
 #include <upipe/uclock.h>
+#include <upipe/udict.h>
+#include <upipe/ubuf_block.h>
 #include <upipe/uref_clock.h>
 #include <upipe/uref_block.h>
 #include <upipe/uref_block_flow.h>
@@ -45,6 +49,21 @@
 #include <upipe/upipe_helper_output.h>
 #include <upipe-modules/upipe_buffer.h>
 
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+
+/** default directory of the temporary file */
+#define SPILL_DEFAULT_PATH "/tmp"
+/** size by which the temporary file is preallocated */
+#define SPILL_PREALLOC (64 * 1024 * 1024)
+/** octets written to or read from the temporary file at once */
+#define SPILL_CHUNK (1024 * 1024)
+/** maximum octets kept in memory when the temporary file cannot be written */
+#define SPILL_WBUF_MAX (4 * SPILL_CHUNK)
+
 /** @internal @This throws an update event.
  *
  * @param upipe description structure of the pipe
@@ -60,6 +79,35 @@ static inline int upipe_buffer_throw_update(struct upipe *upipe,
                        old_state, new_state);
 }
 
+/** @internal @This is the header of a uref in the temporary file. It is
+ * followed by the attributes and the payload. */
+struct upipe_buffer_record {
+    /** size of the record, including the header */
+    uint64_t size;
+    /** size of the attributes */
+    uint64_t attr_size;
+    /** size of the payload */
+    uint64_t block_size;
+    /** void flags */
+    uint64_t flags;
+    /** date in system time */
+    uint64_t date_sys;
+    /** date in program time */
+    uint64_t date_prog;
+    /** original date */
+    uint64_t date_orig;
+    /** duration between DTS and PTS */
+    uint64_t dts_pts_delay;
+    /** duration between CR and DTS */
+    uint64_t cr_dts_delay;
+    /** duration between RAP and CR */
+    uint64_t rap_cr_delay;
+    /** duration of the contents */
+    uint64_t duration;
+    /** private for local pipe user */
+    uint64_t priv;
+};
+
 /** @internal @This is the private context of a buffer pipe. */
 struct upipe_buffer {
     /** upipe structure for helper */
@@ -100,6 +148,37 @@ struct upipe_buffer {
     uint64_t last_dts;
     /** buffer state */
     enum upipe_buffer_state state;
+    /** policy when the maximum size is reached */
+    enum upipe_buffer_policy policy;
+    /** directory of the temporary file, or NULL */
+    char *spill_path;
+    /** file descriptor of the temporary file, or -1 */
+    int spill_fd;
+    /** end of the records in the temporary file, including the ones not
+     * written yet */
+    uint64_t spill_write;
+    /** offset of the first record in the temporary file */
+    uint64_t spill_read;
+    /** preallocated size of the temporary file */
+    uint64_t spill_alloc;
+    /** number of urefs in the temporary file */
+    uint64_t spill_count;
+    /** records not written to the temporary file yet */
+    uint8_t *spill_wbuf;
+    /** size of the records not written yet */
+    size_t spill_wbuf_len;
+    /** allocated size of the write buffer */
+    size_t spill_wbuf_size;
+    /** buffer for the records read from the temporary file */
+    uint8_t *spill_rbuf;
+    /** allocated size of the read buffer */
+    size_t spill_rbuf_size;
+    /** uref manager to page the urefs back in */
+    struct uref_mgr *spill_uref_mgr;
+    /** ubuf manager to page the payloads back in */
+    struct ubuf_mgr *spill_ubuf_mgr;
+    /** counters */
+    struct upipe_buffer_stats stats;
 };
 
 /** @hidden */
@@ -146,6 +225,18 @@ static struct upipe *upipe_buffer_alloc(struct upipe_mgr *mgr,
     upipe_buffer->high_limit = 0;
     upipe_buffer->last_dts = 0;
     upipe_buffer->state = UPIPE_BUFFER_LOW;
+    upipe_buffer->policy = UPIPE_BUFFER_POLICY_BLOCK;
+    upipe_buffer->spill_path = NULL;
+    upipe_buffer->spill_fd = -1;
+    upipe_buffer->spill_write = upipe_buffer->spill_read = 0;
+    upipe_buffer->spill_alloc = 0;
+    upipe_buffer->spill_count = 0;
+    upipe_buffer->spill_wbuf = upipe_buffer->spill_rbuf = NULL;
+    upipe_buffer->spill_wbuf_len = upipe_buffer->spill_wbuf_size = 0;
+    upipe_buffer->spill_rbuf_size = 0;
+    upipe_buffer->spill_uref_mgr = NULL;
+    upipe_buffer->spill_ubuf_mgr = NULL;
+    memset(&upipe_buffer->stats, 0, sizeof(upipe_buffer->stats));
 
     upipe_throw_ready(upipe);
 
@@ -166,6 +257,14 @@ static void upipe_buffer_free(struct upipe *upipe)
     while ((uchain = ulist_pop(&upipe_buffer->buffered)) != NULL)
         uref_free(uref_from_uchain(uchain));
 
+    uref_mgr_release(upipe_buffer->spill_uref_mgr);
+    ubuf_mgr_release(upipe_buffer->spill_ubuf_mgr);
+    free(upipe_buffer->spill_wbuf);
+    free(upipe_buffer->spill_rbuf);
+    if (upipe_buffer->spill_fd != -1)
+        close(upipe_buffer->spill_fd);
+    free(upipe_buffer->spill_path);
+
     upipe_buffer_clean_output(upipe);
     upipe_buffer_clean_input(upipe);
     upipe_buffer_clean_upump(upipe);
@@ -233,6 +332,370 @@ static void upipe_buffer_update(struct upipe *upipe)
                          duration / (UCLOCK_FREQ / 1000));
 }
 
+/** @internal @This opens the temporary file. It is unlinked right away so
+ * that it is removed when the pipe is released.
+ *
+ * @param upipe description structure of the pipe
+ * @return an error code
+ */
+static int upipe_buffer_spill_open(struct upipe *upipe)
+{
+    struct upipe_buffer *upipe_buffer = upipe_buffer_from_upipe(upipe);
+    const char *path = upipe_buffer->spill_path != NULL ?
+                       upipe_buffer->spill_path : SPILL_DEFAULT_PATH;
+    char name[strlen(path) + sizeof("/upipe_buffer.XXXXXX")];
+    sprintf(name, "%s/upipe_buffer.XXXXXX", path);
+
+    int fd = mkstemp(name);
+    if (unlikely(fd == -1)) {
+        upipe_err_va(upipe, "unable to create %s (%m)", name);
+        return UBASE_ERR_EXTERNAL;
+    }
+    unlink(name);
+
+    upipe_buffer->spill_fd = fd;
+    upipe_buffer->spill_write = upipe_buffer->spill_read = 0;
+    upipe_buffer->spill_alloc = 0;
+    upipe_dbg_va(upipe, "spilling to %s", path);
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This writes the pending records to the temporary file,
+ * preallocating it by large steps to avoid fragmentation.
+ *
+ * @param upipe description structure of the pipe
+ * @return an error code
+ */
+static int upipe_buffer_spill_flush(struct upipe *upipe)
+{
+    struct upipe_buffer *upipe_buffer = upipe_buffer_from_upipe(upipe);
+    if (!upipe_buffer->spill_wbuf_len)
+        return UBASE_ERR_NONE;
+
+    if (upipe_buffer->spill_write > upipe_buffer->spill_alloc) {
+        uint64_t alloc = (upipe_buffer->spill_write + SPILL_PREALLOC - 1) /
+                         SPILL_PREALLOC * SPILL_PREALLOC;
+        /* not fatal, the file is then extended by the writes */
+        if (likely(!posix_fallocate(upipe_buffer->spill_fd,
+                                    upipe_buffer->spill_alloc,
+                                    alloc - upipe_buffer->spill_alloc)))
+            upipe_buffer->spill_alloc = alloc;
+    }
+
+    uint64_t offset = upipe_buffer->spill_write - upipe_buffer->spill_wbuf_len;
+    size_t written = 0;
+    while (written < upipe_buffer->spill_wbuf_len) {
+        ssize_t ret = pwrite(upipe_buffer->spill_fd,
+                             upipe_buffer->spill_wbuf + written,
+                             upipe_buffer->spill_wbuf_len - written,
+                             offset + written);
+        if (unlikely(ret == -1 && errno == EINTR))
+            continue;
+        if (unlikely(ret <= 0)) {
+            upipe_warn_va(upipe, "unable to spill (%m)");
+            /* keep the records not written in memory */
+            memmove(upipe_buffer->spill_wbuf,
+                    upipe_buffer->spill_wbuf + written,
+                    upipe_buffer->spill_wbuf_len - written);
+            upipe_buffer->spill_wbuf_len -= written;
+            return UBASE_ERR_EXTERNAL;
+        }
+        written += ret;
+    }
+    upipe_buffer->spill_wbuf_len = 0;
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This moves a uref, with its attributes and payload, to the
+ * temporary file.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref uref to spill
+ * @param block_size size of the uref
+ * @return an error code, UBASE_ERR_BUSY if the records which could not be
+ * written already use @ref SPILL_WBUF_MAX octets
+ */
+static int upipe_buffer_spill(struct upipe *upipe, struct uref *uref,
+                              size_t block_size)
+{
+    struct upipe_buffer *upipe_buffer = upipe_buffer_from_upipe(upipe);
+    if (upipe_buffer->spill_fd == -1)
+        UBASE_RETURN(upipe_buffer_spill_open(upipe))
+
+    /* attributes are serialized as type, name if not a shorthand, size and
+     * value */
+    size_t attr_size = 0;
+    const char *name = NULL;
+    enum udict_type type = UDICT_TYPE_END;
+    while (uref->udict != NULL &&
+           ubase_check(udict_iterate(uref->udict, &name, &type)) &&
+           type != UDICT_TYPE_END) {
+        size_t size;
+        const uint8_t *value;
+        UBASE_RETURN(udict_get(uref->udict, name, type, &size, &value))
+        attr_size += 1 + sizeof(uint32_t) + size;
+        if (type < UDICT_TYPE_SHORTHAND)
+            attr_size += sizeof(uint16_t) + strlen(name) + 1;
+    }
+
+    size_t record_size = sizeof(struct upipe_buffer_record) + attr_size +
+                         block_size;
+    size_t len = upipe_buffer->spill_wbuf_len;
+    if (len && len + record_size > SPILL_WBUF_MAX) {
+        /* the last writes failed, retry before keeping more in memory */
+        if (!ubase_check(upipe_buffer_spill_flush(upipe)))
+            return UBASE_ERR_BUSY;
+        len = upipe_buffer->spill_wbuf_len;
+    }
+    if (len + record_size > upipe_buffer->spill_wbuf_size) {
+        size_t wbuf_size = len + record_size > SPILL_CHUNK ?
+                           len + record_size : SPILL_CHUNK;
+        uint8_t *wbuf = realloc(upipe_buffer->spill_wbuf, wbuf_size);
+        UBASE_ALLOC_RETURN(wbuf)
+        upipe_buffer->spill_wbuf = wbuf;
+        upipe_buffer->spill_wbuf_size = wbuf_size;
+    }
+    uint8_t *p = upipe_buffer->spill_wbuf + len;
+
+    struct upipe_buffer_record record = {
+        .size = record_size,
+        .attr_size = attr_size,
+        .block_size = block_size,
+        .flags = uref->flags,
+        .date_sys = uref->date_sys,
+        .date_prog = uref->date_prog,
+        .date_orig = uref->date_orig,
+        .dts_pts_delay = uref->dts_pts_delay,
+        .cr_dts_delay = uref->cr_dts_delay,
+        .rap_cr_delay = uref->rap_cr_delay,
+        .duration = uref->duration,
+        .priv = uref->priv
+    };
+    memcpy(p, &record, sizeof(record));
+    p += sizeof(record);
+
+    name = NULL;
+    type = UDICT_TYPE_END;
+    while (uref->udict != NULL &&
+           ubase_check(udict_iterate(uref->udict, &name, &type)) &&
+           type != UDICT_TYPE_END) {
+        size_t size;
+        const uint8_t *value;
+        udict_get(uref->udict, name, type, &size, &value);
+        *p++ = type;
+        if (type < UDICT_TYPE_SHORTHAND) {
+            uint16_t name_len = strlen(name) + 1;
+            memcpy(p, &name_len, sizeof(name_len));
+            p += sizeof(name_len);
+            memcpy(p, name, name_len);
+            p += name_len;
+        }
+        uint32_t value_size = size;
+        memcpy(p, &value_size, sizeof(value_size));
+        p += sizeof(value_size);
+        memcpy(p, value, size);
+        p += size;
+    }
+    UBASE_RETURN(uref_block_extract(uref, 0, block_size, p))
+
+    if (upipe_buffer->spill_uref_mgr == NULL)
+        upipe_buffer->spill_uref_mgr = uref_mgr_use(uref->mgr);
+    if (upipe_buffer->spill_ubuf_mgr == NULL)
+        upipe_buffer->spill_ubuf_mgr = ubuf_mgr_use(uref->ubuf->mgr);
+    upipe_buffer->spill_wbuf_len += record_size;
+    upipe_buffer->spill_write += record_size;
+    upipe_buffer->spill_count++;
+    upipe_buffer->stats.spilled_size += block_size;
+    upipe_buffer->stats.spilled++;
+    uref_free(uref);
+
+    if (upipe_buffer->spill_wbuf_len >= SPILL_CHUNK)
+        upipe_buffer_spill_flush(upipe);
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This rebuilds a uref from a record of the temporary file and
+ * appends it to the buffered urefs.
+ *
+ * @param upipe description structure of the pipe
+ * @param record header of the record
+ * @param p attributes and payload of the record
+ * @return an error code
+ */
+static int upipe_buffer_unspill(struct upipe *upipe,
+                                const struct upipe_buffer_record *record,
+                                const uint8_t *p)
+{
+    struct upipe_buffer *upipe_buffer = upipe_buffer_from_upipe(upipe);
+    struct uref *uref = uref_alloc(upipe_buffer->spill_uref_mgr);
+    UBASE_ALLOC_RETURN(uref)
+    uref->flags = record->flags;
+    uref->date_sys = record->date_sys;
+    uref->date_prog = record->date_prog;
+    uref->date_orig = record->date_orig;
+    uref->dts_pts_delay = record->dts_pts_delay;
+    uref->cr_dts_delay = record->cr_dts_delay;
+    uref->rap_cr_delay = record->rap_cr_delay;
+    uref->duration = record->duration;
+    uref->priv = record->priv;
+
+    const uint8_t *end = p + record->attr_size;
+    if (p < end && uref->udict == NULL) {
+        uref->udict = udict_alloc(upipe_buffer->spill_uref_mgr->udict_mgr,
+                                  record->attr_size);
+        if (unlikely(uref->udict == NULL)) {
+            uref_free(uref);
+            return UBASE_ERR_ALLOC;
+        }
+    }
+    while (p < end) {
+        enum udict_type type = *p++;
+        const char *name = NULL;
+        if (type < UDICT_TYPE_SHORTHAND) {
+            uint16_t name_len;
+            memcpy(&name_len, p, sizeof(name_len));
+            p += sizeof(name_len);
+            name = (const char *)p;
+            p += name_len;
+        }
+        uint32_t size;
+        memcpy(&size, p, sizeof(size));
+        p += sizeof(size);
+        uint8_t *value;
+        if (unlikely(!ubase_check(udict_set(uref->udict, name, type, size,
+                                            &value)))) {
+            uref_free(uref);
+            return UBASE_ERR_ALLOC;
+        }
+        memcpy(value, p, size);
+        p += size;
+    }
+
+    struct ubuf *ubuf = ubuf_block_alloc(upipe_buffer->spill_ubuf_mgr,
+                                         record->block_size);
+    if (unlikely(ubuf == NULL)) {
+        uref_free(uref);
+        return UBASE_ERR_ALLOC;
+    }
+    uref_attach_ubuf(uref, ubuf);
+    uint8_t *buffer;
+    int size = -1;
+    if (likely(ubase_check(uref_block_write(uref, 0, &size, &buffer)))) {
+        memcpy(buffer, p, size);
+        uref_block_unmap(uref, 0);
+    }
+
+    ulist_add(&upipe_buffer->buffered, uref_to_uchain(uref));
+    upipe_buffer->size += record->block_size;
+    if (upipe_buffer->size > upipe_buffer->stats.high_water)
+        upipe_buffer->stats.high_water = upipe_buffer->size;
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This rebuilds the complete records of a buffer.
+ *
+ * @param upipe description structure of the pipe
+ * @param buffer records
+ * @param len size of the buffer
+ * @return number of octets used
+ */
+static size_t upipe_buffer_unspill_records(struct upipe *upipe,
+                                           const uint8_t *buffer, size_t len)
+{
+    struct upipe_buffer *upipe_buffer = upipe_buffer_from_upipe(upipe);
+    size_t done = 0;
+    while (len - done >= sizeof(struct upipe_buffer_record)) {
+        struct upipe_buffer_record record;
+        memcpy(&record, buffer + done, sizeof(record));
+        if (record.size > len - done)
+            break;
+        if (unlikely(!ubase_check(upipe_buffer_unspill(upipe, &record,
+                            buffer + done + sizeof(record))))) {
+            upipe_warn(upipe, "unable to read back a buffer, dropping");
+            upipe_buffer->stats.dropped++;
+            upipe_buffer->stats.dropped_size += record.block_size;
+        }
+        assert(upipe_buffer->stats.spilled_size >= record.block_size);
+        upipe_buffer->stats.spilled_size -= record.block_size;
+        upipe_buffer->spill_count--;
+        done += record.size;
+    }
+    return done;
+}
+
+/** @internal @This reads the next chunk of records back from the temporary
+ * file, and asks the kernel to read the following one ahead.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_buffer_page_in(struct upipe *upipe)
+{
+    struct upipe_buffer *upipe_buffer = upipe_buffer_from_upipe(upipe);
+    uint64_t written = upipe_buffer->spill_write -
+                       upipe_buffer->spill_wbuf_len;
+
+    if (upipe_buffer->spill_read == written) {
+        /* the remaining records were not written yet */
+        upipe_buffer->spill_read += upipe_buffer_unspill_records(upipe,
+                upipe_buffer->spill_wbuf, upipe_buffer->spill_wbuf_len);
+        upipe_buffer->spill_wbuf_len = 0;
+    } else {
+        size_t len = SPILL_CHUNK;
+        if (upipe_buffer->max_size / 2 < len && upipe_buffer->max_size / 2)
+            len = upipe_buffer->max_size / 2;
+        if (written - upipe_buffer->spill_read < len)
+            len = written - upipe_buffer->spill_read;
+
+        for ( ; ; ) {
+            if (len > upipe_buffer->spill_rbuf_size) {
+                uint8_t *rbuf = realloc(upipe_buffer->spill_rbuf, len);
+                if (unlikely(rbuf == NULL)) {
+                    upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+                    return;
+                }
+                upipe_buffer->spill_rbuf = rbuf;
+                upipe_buffer->spill_rbuf_size = len;
+            }
+            size_t got = 0;
+            while (got < len) {
+                ssize_t ret = pread(upipe_buffer->spill_fd,
+                                    upipe_buffer->spill_rbuf + got, len - got,
+                                    upipe_buffer->spill_read + got);
+                if (unlikely(ret == -1 && errno == EINTR))
+                    continue;
+                if (unlikely(ret <= 0)) {
+                    upipe_warn_va(upipe, "unable to read back (%m)");
+                    return;
+                }
+                got += ret;
+            }
+
+            size_t done = upipe_buffer_unspill_records(upipe,
+                    upipe_buffer->spill_rbuf, len);
+            if (done) {
+                upipe_buffer->spill_read += done;
+                break;
+            }
+            /* the first record is larger than the chunk, or was not
+             * entirely written */
+            struct upipe_buffer_record record;
+            memcpy(&record, upipe_buffer->spill_rbuf, sizeof(record));
+            len = record.size;
+            if (upipe_buffer->spill_read + len > written &&
+                !ubase_check(upipe_buffer_spill_flush(upipe)))
+                return;
+            written = upipe_buffer->spill_write - upipe_buffer->spill_wbuf_len;
+        }
+    }
+
+    if (upipe_buffer->spill_read == upipe_buffer->spill_write) {
+        /* reuse the preallocated file from the start */
+        upipe_buffer->spill_read = upipe_buffer->spill_write = 0;
+    } else if (upipe_buffer->spill_read < written)
+        posix_fadvise(upipe_buffer->spill_fd, upipe_buffer->spill_read,
+                      SPILL_CHUNK, POSIX_FADV_WILLNEED);
+}
+
 /** @internal @This is called when output pipe need some data.
  *
  * @param upump description structure of the output watcher
@@ -242,6 +705,10 @@ static void upipe_buffer_worker(struct upump *upump)
     struct upipe *upipe = upump_get_opaque(upump, struct upipe *);
     struct upipe_buffer *upipe_buffer = upipe_buffer_from_upipe(upipe);
 
+    if (upipe_buffer->spill_count &&
+        upipe_buffer->size <= upipe_buffer->max_size / 2)
+        upipe_buffer_page_in(upipe);
+
     struct uchain *uchain = ulist_pop(&upipe_buffer->buffered);
     if (!uchain)
         return;
@@ -311,8 +778,38 @@ static bool upipe_buffer_process(struct upipe *upipe,
         return true;
     }
 
-    if (block_size + upipe_buffer->size > upipe_buffer->max_size)
-        return false;
+    /* once urefs are in the temporary file, the next ones follow them to
+     * keep the order, whatever the buffered size, until the file is drained;
+     * the worker reads it back by chunks of half max_size as soon as half
+     * of the memory is free, so the memory use stays bounded by max_size,
+     * or by the size of a single uref if it is larger */
+    bool spill = upipe_buffer->spill_count > 0;
+    if (!spill && block_size + upipe_buffer->size > upipe_buffer->max_size) {
+        switch (upipe_buffer->policy) {
+            case UPIPE_BUFFER_POLICY_BLOCK:
+                return false;
+
+            case UPIPE_BUFFER_POLICY_DROP_OLDEST: {
+                struct uchain *uchain;
+                while (block_size + upipe_buffer->size >
+                           upipe_buffer->max_size &&
+                       (uchain = ulist_pop(&upipe_buffer->buffered)) != NULL) {
+                    struct uref *oldest = uref_from_uchain(uchain);
+                    size_t oldest_size = 0;
+                    uref_block_size(oldest, &oldest_size);
+                    upipe_buffer->size -= oldest_size;
+                    upipe_buffer->stats.dropped++;
+                    upipe_buffer->stats.dropped_size += oldest_size;
+                    uref_free(oldest);
+                }
+                break;
+            }
+
+            case UPIPE_BUFFER_POLICY_SPILL:
+                spill = true;
+                break;
+        }
+    }
 
     ret = upipe_buffer_upump_check(upipe);
     if (!ubase_check(ret)) {
@@ -331,7 +828,27 @@ static bool upipe_buffer_process(struct upipe *upipe,
     else
         upipe_warn(upipe, "uref has no DTS");
 
+    if (spill) {
+        ret = upipe_buffer_spill(upipe, uref, block_size);
+        if (ret == UBASE_ERR_BUSY) {
+            /* the new uref cannot go ahead of the spilled ones */
+            upipe_warn(upipe, "temporary file not writable, dropping");
+            upipe_buffer->stats.dropped++;
+            upipe_buffer->stats.dropped_size += block_size;
+            uref_free(uref);
+            upipe_buffer_update(upipe);
+            return true;
+        }
+        /* fall back to blocking if the file cannot be opened */
+        if (!ubase_check(ret))
+            return false;
+        upipe_buffer_update(upipe);
+        return true;
+    }
+
     upipe_buffer->size += block_size;
+    if (upipe_buffer->size > upipe_buffer->stats.high_water)
+        upipe_buffer->stats.high_water = upipe_buffer->size;
     ulist_add(&upipe_buffer->buffered, uref_to_uchain(uref));
     upipe_buffer_update(upipe);
     return true;
@@ -462,6 +979,83 @@ static int _upipe_buffer_set_high(struct upipe *upipe, uint64_t high_limit)
     return UBASE_ERR_NONE;
 }
 
+/** @internal @This sets the policy when the maximum size is reached.
+ *
+ * @param upipe description structure of the pipe
+ * @param policy policy to apply
+ * @return an error code
+ */
+static int _upipe_buffer_set_policy(struct upipe *upipe,
+                                    enum upipe_buffer_policy policy)
+{
+    struct upipe_buffer *upipe_buffer = upipe_buffer_from_upipe(upipe);
+    if (unlikely(upipe_buffer_policy_str(policy) == NULL))
+        return UBASE_ERR_INVALID;
+    upipe_buffer->policy = policy;
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This sets the directory of the temporary file. It is used
+ * the next time the file is created.
+ *
+ * @param upipe description structure of the pipe
+ * @param path path of the directory
+ * @return an error code
+ */
+static int _upipe_buffer_set_spill_path(struct upipe *upipe, const char *path)
+{
+    struct upipe_buffer *upipe_buffer = upipe_buffer_from_upipe(upipe);
+    char *spill_path = NULL;
+    if (path != NULL) {
+        spill_path = strdup(path);
+        UBASE_ALLOC_RETURN(spill_path)
+    }
+    free(upipe_buffer->spill_path);
+    upipe_buffer->spill_path = spill_path;
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This gets the counters of the buffer pipe.
+ *
+ * @param upipe description structure of the pipe
+ * @param stats filled in with the counters
+ * @return an error code
+ */
+static int _upipe_buffer_get_stats(struct upipe *upipe,
+                                   struct upipe_buffer_stats *stats)
+{
+    struct upipe_buffer *upipe_buffer = upipe_buffer_from_upipe(upipe);
+    *stats = upipe_buffer->stats;
+    stats->size = upipe_buffer->size;
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This returns the urefs buffered by the pipe, including the
+ * ones held by the input helper while the output is blocked.
+ *
+ * @param upipe description structure of the pipe
+ * @param occupancy filled in with the occupancy
+ * @return an error code
+ */
+static int upipe_buffer_get_occupancy(struct upipe *upipe,
+                                      struct upipe_occupancy *occupancy)
+{
+    struct upipe_buffer *upipe_buffer = upipe_buffer_from_upipe(upipe);
+    occupancy->urefs = ulist_depth(&upipe_buffer->buffered) +
+                       upipe_buffer->nb_urefs + upipe_buffer->spill_count;
+    occupancy->max_urefs = 0;
+    occupancy->bytes = upipe_buffer->size + upipe_buffer->stats.spilled_size;
+
+    struct uchain *uchain;
+    ulist_foreach(&upipe_buffer->urefs, uchain) {
+        size_t block_size;
+        if (ubase_check(uref_block_size(uref_from_uchain(uchain),
+                                        &block_size)))
+            occupancy->bytes += block_size;
+    }
+    return UBASE_ERR_NONE;
+}
+
 /** @internal @This dispatches the control commands.
  *
  * @param upipe description structure of the pipe
@@ -483,6 +1077,11 @@ static int upipe_buffer_control(struct upipe *upipe,
         struct uref *flow_def = va_arg(args, struct uref *);
         return upipe_buffer_set_flow_def(upipe, flow_def);
     }
+    case UPIPE_GET_OCCUPANCY: {
+        struct upipe_occupancy *occupancy =
+            va_arg(args, struct upipe_occupancy *);
+        return upipe_buffer_get_occupancy(upipe, occupancy);
+    }
 
     case UPIPE_BUFFER_GET_MAX_SIZE: {
         UBASE_SIGNATURE_CHECK(args, UPIPE_BUFFER_SIGNATURE)
@@ -514,6 +1113,22 @@ static int upipe_buffer_control(struct upipe *upipe,
         uint64_t high_limit = va_arg(args, uint64_t);
         return _upipe_buffer_set_high(upipe, high_limit);
     }
+    case UPIPE_BUFFER_SET_POLICY: {
+        UBASE_SIGNATURE_CHECK(args, UPIPE_BUFFER_SIGNATURE)
+        enum upipe_buffer_policy policy = va_arg(args, int);
+        return _upipe_buffer_set_policy(upipe, policy);
+    }
+    case UPIPE_BUFFER_SET_SPILL_PATH: {
+        UBASE_SIGNATURE_CHECK(args, UPIPE_BUFFER_SIGNATURE)
+        const char *path = va_arg(args, const char *);
+        return _upipe_buffer_set_spill_path(upipe, path);
+    }
+    case UPIPE_BUFFER_GET_STATS: {
+        UBASE_SIGNATURE_CHECK(args, UPIPE_BUFFER_SIGNATURE)
+        struct upipe_buffer_stats *stats =
+            va_arg(args, struct upipe_buffer_stats *);
+        return _upipe_buffer_get_stats(upipe, stats);
+    }
     }
     return UBASE_ERR_UNHANDLED;
 }
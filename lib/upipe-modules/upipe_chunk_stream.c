@@ -80,6 +80,8 @@ struct upipe_chunk_stream {
     unsigned int align;
     /** aligned block size */
     unsigned int size;
+    /** true if the output chunks must be contiguous */
+    bool contiguous;
 
     /** next uref to be processed */
     struct uref *next_uref;
@@ -98,6 +100,30 @@ UPIPE_HELPER_VOID(upipe_chunk_stream);
 UPIPE_HELPER_OUTPUT(upipe_chunk_stream, output, flow_def, output_state, request_list);
 UPIPE_HELPER_UREF_STREAM(upipe_chunk_stream, next_uref, next_uref_size, urefs, NULL)
 
+/** @internal @This outputs a chunk. Chunks are spliced from the input
+ * buffers, and only copied if they must be contiguous and span several
+ * segments.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref chunk
+ * @param upump_p reference to pump that generated the buffer
+ */
+static void upipe_chunk_stream_output_chunk(struct upipe *upipe,
+                                            struct uref *uref,
+                                            struct upump **upump_p)
+{
+    struct upipe_chunk_stream *upipe_chunk_stream =
+                       upipe_chunk_stream_from_upipe(upipe);
+    if (upipe_chunk_stream->contiguous && uref->ubuf != NULL &&
+        unlikely(!ubase_check(uref_block_merge_read(uref, uref->ubuf->mgr,
+                                                    0, -1)))) {
+        uref_free(uref);
+        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+        return;
+    }
+    upipe_chunk_stream_output(upipe, uref, upump_p);
+}
+
 /** @internal @This handles data.
  *
  * @param upipe description structure of the pipe
@@ -123,7 +149,7 @@ static void upipe_chunk_stream_input(struct upipe *upipe,
             upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
             return;
         }
-        upipe_chunk_stream_output(upipe, uref, upump_p);
+        upipe_chunk_stream_output_chunk(upipe, uref, upump_p);
     }
 }
 
@@ -172,7 +198,7 @@ static void upipe_chunk_stream_flush(struct upipe *upipe)
             return;
         }
 
-        upipe_chunk_stream_output(upipe, uref, NULL);
+        upipe_chunk_stream_output_chunk(upipe, uref, NULL);
     }
     upipe_chunk_stream_clean_uref_stream(upipe);
     upipe_chunk_stream_init_uref_stream(upipe);
@@ -251,6 +277,13 @@ static int upipe_chunk_stream_control(struct upipe *upipe,
             unsigned int align = va_arg(args, unsigned int);
             return _upipe_chunk_stream_set_mtu(upipe, mtu, align);
         }
+        case UPIPE_CHUNK_STREAM_SET_CONTIGUOUS: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_CHUNK_STREAM_SIGNATURE)
+            struct upipe_chunk_stream *upipe_chunk_stream =
+                               upipe_chunk_stream_from_upipe(upipe);
+            upipe_chunk_stream->contiguous = !!va_arg(args, int);
+            return UBASE_ERR_NONE;
+        }
 
         default:
             return UBASE_ERR_UNHANDLED;
@@ -274,7 +307,10 @@ static struct upipe *upipe_chunk_stream_alloc(struct upipe_mgr *mgr,
     if (unlikely(upipe == NULL))
         return NULL;
 
+    struct upipe_chunk_stream *upipe_chunk_stream =
+                       upipe_chunk_stream_from_upipe(upipe);
     _upipe_chunk_stream_set_mtu(upipe, DEFAULT_MTU, DEFAULT_ALIGN);
+    upipe_chunk_stream->contiguous = false;
     upipe_chunk_stream_init_urefcount(upipe);
     upipe_chunk_stream_init_output(upipe);
     upipe_chunk_stream_init_uref_stream(upipe);
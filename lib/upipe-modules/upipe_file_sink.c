@@ -29,8 +29,11 @@
  * @short Upipe sink module for files
  */
 
+#define _GNU_SOURCE
+
 #include <upipe/ubase.h>
 #include <upipe/ulist.h>
+#include <upipe/ueventfd.h>
 #include <upipe/uprobe.h>
 #include <upipe/uclock.h>
 #include <upipe/uref.h>
@@ -39,6 +42,7 @@
 #include <upipe/upump.h>
 #include <upipe/upump_blocker.h>
 #include <upipe/ubuf.h>
+#include <upipe/ubuf_block_file.h>
 #include <upipe/upipe.h>
 #include <upipe/upipe_helper_upipe.h>
 #include <upipe/upipe_helper_urefcount.h>
@@ -59,18 +63,75 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#include <poll.h>
+#include <pthread.h>
 #include <errno.h>
 #include <assert.h>
 
 #ifndef O_CLOEXEC
 #   define O_CLOEXEC 0
 #endif
+#ifndef O_DIRECT
+#   define O_DIRECT 0
+#endif
+
+/** alignment of the staging buffers and of direct writes */
+#define ASYNC_ALIGN 4096
+
+/** @internal @This is a staging buffer of the asynchronous writer. */
+struct upipe_fsink_buffer {
+    /** aligned buffer */
+    uint8_t *data;
+    /** number of octets in the buffer */
+    size_t size;
+};
+
+/** @internal @This is the asynchronous writer of a file sink pipe. The
+ * buffers from tail to head are owned by the writer thread, and the buffer
+ * at head is filled by the event loop. */
+struct upipe_fsink_writer {
+    /** file descriptor */
+    int fd;
+    /** true if O_DIRECT is set on the file descriptor */
+    bool direct;
+    /** writer thread */
+    pthread_t thread;
+    /** mutex protecting the fields below */
+    pthread_mutex_t mutex;
+    /** condition signalled to the writer thread */
+    pthread_cond_t cond;
+    /** number of buffers waiting to be written */
+    unsigned int pending;
+    /** index of the next buffer to write */
+    unsigned int tail;
+    /** true if the file descriptor must be synced */
+    bool sync;
+    /** true if the thread must exit once all buffers are written */
+    bool exit;
+    /** errno of the first write error, or 0 */
+    int error;
+
+    /** index of the buffer being filled by the event loop */
+    unsigned int head;
+    /** event signalled by the writer thread when a buffer is written */
+    struct ueventfd event;
+
+    /** number of buffers */
+    unsigned int nb;
+    /** ring of buffers */
+    struct upipe_fsink_buffer buffers[];
+};
 
 /** @hidden */
 static void upipe_fsink_watcher(struct upump *upump);
 /** @hidden */
 static bool upipe_fsink_output(struct upipe *upipe, struct uref *uref,
                                struct upump **upump_p);
+/** @hidden */
+static void upipe_fsink_writer_watcher(struct upump *upump);
+/** @hidden */
+static void upipe_fsink_poll(struct upipe *upipe);
 
 /** @internal @This is the private context of a file sink pipe. */
 struct upipe_fsink {
@@ -93,10 +154,16 @@ struct upipe_fsink {
     uint64_t latency;
     /** file descriptor */
     int fd;
+    /** true if file ranges may be written with sendfile() */
+    bool sendfile;
     /** file path */
     char *path;
     /** sync period */
     uint64_t sync_period;
+    /** number of staging buffers for asynchronous writes */
+    unsigned int async_depth;
+    /** asynchronous writer, or NULL */
+    struct upipe_fsink_writer *writer;
 
     /** temporary uref storage */
     struct uchain urefs;
@@ -145,12 +212,343 @@ static struct upipe *upipe_fsink_alloc(struct upipe_mgr *mgr,
     upipe_fsink_init_uclock(upipe);
     upipe_fsink->latency = 0;
     upipe_fsink->fd = -1;
+    upipe_fsink->sendfile = true;
     upipe_fsink->path = NULL;
     upipe_fsink->sync_period = 0;
+    upipe_fsink->async_depth = 0;
+    upipe_fsink->writer = NULL;
     upipe_throw_ready(upipe);
     return upipe;
 }
 
+/** @internal @This writes a buffer to the file, in the writer thread.
+ *
+ * @param writer pointer to the asynchronous writer
+ * @param data buffer to write
+ * @param size size of the buffer
+ * @return 0, or errno in case of error
+ */
+static int upipe_fsink_writer_write(struct upipe_fsink_writer *writer,
+                                    const uint8_t *data, size_t size)
+{
+    if (writer->direct && size % ASYNC_ALIGN) {
+        /* the tail of the file can't be written directly */
+        size_t aligned = size - size % ASYNC_ALIGN;
+        int err = upipe_fsink_writer_write(writer, data, aligned);
+        if (unlikely(err))
+            return err;
+        data += aligned;
+        size -= aligned;
+        int flags = fcntl(writer->fd, F_GETFL);
+        if (unlikely(flags == -1 ||
+                     fcntl(writer->fd, F_SETFL, flags & ~O_DIRECT) == -1))
+            return errno;
+        writer->direct = false;
+    }
+
+    while (size) {
+        ssize_t ret = write(writer->fd, data, size);
+        if (unlikely(ret == -1)) {
+            switch (errno) {
+                case EINTR:
+                    continue;
+                case EAGAIN:
+#if EAGAIN != EWOULDBLOCK
+                case EWOULDBLOCK:
+#endif
+                {
+                    struct pollfd pollfd;
+                    pollfd.fd = writer->fd;
+                    pollfd.events = POLLOUT;
+                    poll(&pollfd, 1, -1);
+                    continue;
+                }
+                default:
+                    return errno;
+            }
+        }
+        data += ret;
+        size -= ret;
+    }
+    return 0;
+}
+
+/** @internal @This is the main loop of the writer thread.
+ *
+ * @param arg pointer to the asynchronous writer
+ * @return NULL
+ */
+static void *upipe_fsink_writer_thread(void *arg)
+{
+    struct upipe_fsink_writer *writer = arg;
+
+    pthread_mutex_lock(&writer->mutex);
+    for ( ; ; ) {
+        while (!writer->pending && !writer->sync && !writer->exit)
+            pthread_cond_wait(&writer->cond, &writer->mutex);
+
+        if (writer->pending) {
+            struct upipe_fsink_buffer *buffer =
+                &writer->buffers[writer->tail];
+            bool failed = writer->error != 0;
+            pthread_mutex_unlock(&writer->mutex);
+
+            int err = failed ? 0 :
+                upipe_fsink_writer_write(writer, buffer->data, buffer->size);
+            buffer->size = 0;
+
+            pthread_mutex_lock(&writer->mutex);
+            if (unlikely(err && !writer->error))
+                writer->error = err;
+            writer->tail = (writer->tail + 1) % writer->nb;
+            writer->pending--;
+            ueventfd_write(&writer->event);
+            continue;
+        }
+
+        if (writer->sync) {
+            writer->sync = false;
+            pthread_mutex_unlock(&writer->mutex);
+#if defined(_POSIX_SYNCHRONIZED_IO) && _POSIX_SYNCHRONIZED_IO > 0
+            fdatasync(writer->fd);
+#else
+            fsync(writer->fd);
+#endif
+            pthread_mutex_lock(&writer->mutex);
+            continue;
+        }
+
+        break;
+    }
+    pthread_mutex_unlock(&writer->mutex);
+    return NULL;
+}
+
+/** @internal @This frees the staging buffers of an asynchronous writer.
+ *
+ * @param writer pointer to the asynchronous writer
+ */
+static void upipe_fsink_writer_free(struct upipe_fsink_writer *writer)
+{
+    for (unsigned int i = 0; i < writer->nb; i++)
+        free(writer->buffers[i].data);
+    free(writer);
+}
+
+/** @internal @This starts the asynchronous writer on the opened file, if
+ * asynchronous writes are enabled. The writes are synchronous in case of
+ * failure.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_fsink_writer_open(struct upipe *upipe)
+{
+    struct upipe_fsink *upipe_fsink = upipe_fsink_from_upipe(upipe);
+    if (!upipe_fsink->async_depth)
+        return;
+
+    unsigned int nb = upipe_fsink->async_depth;
+    struct upipe_fsink_writer *writer =
+        malloc(sizeof(struct upipe_fsink_writer) +
+               nb * sizeof(struct upipe_fsink_buffer));
+    if (unlikely(writer == NULL)) {
+        upipe_warn(upipe, "unable to allocate asynchronous writer");
+        return;
+    }
+    writer->nb = nb;
+    for (unsigned int i = 0; i < nb; i++)
+        writer->buffers[i].size = 0;
+    for (unsigned int i = 0; i < nb; i++) {
+        if (unlikely(posix_memalign((void **)&writer->buffers[i].data,
+                                    ASYNC_ALIGN,
+                                    UPIPE_FSINK_ASYNC_BUFFER_SIZE))) {
+            writer->nb = i;
+            upipe_fsink_writer_free(writer);
+            upipe_warn(upipe, "unable to allocate staging buffers");
+            return;
+        }
+    }
+    if (unlikely(!ueventfd_init(&writer->event, false))) {
+        upipe_fsink_writer_free(writer);
+        upipe_warn(upipe, "unable to allocate event");
+        return;
+    }
+
+    writer->fd = upipe_fsink->fd;
+    writer->pending = writer->tail = writer->head = 0;
+    writer->sync = writer->exit = false;
+    writer->error = 0;
+
+    /* direct writes need an aligned offset, and are not supported by all
+     * file systems */
+    writer->direct = false;
+    off_t offset = lseek(writer->fd, 0, SEEK_CUR);
+    int flags = fcntl(writer->fd, F_GETFL);
+    if (O_DIRECT && offset != (off_t)-1 && !(offset % ASYNC_ALIGN) &&
+        flags != -1 &&
+        fcntl(writer->fd, F_SETFL, flags | O_DIRECT) != -1)
+        writer->direct = true;
+    else
+        upipe_dbg(upipe, "not using direct writes");
+
+    pthread_mutex_init(&writer->mutex, NULL);
+    pthread_cond_init(&writer->cond, NULL);
+    if (unlikely(pthread_create(&writer->thread, NULL,
+                                upipe_fsink_writer_thread, writer))) {
+        pthread_cond_destroy(&writer->cond);
+        pthread_mutex_destroy(&writer->mutex);
+        ueventfd_clean(&writer->event);
+        if (writer->direct)
+            fcntl(writer->fd, F_SETFL, flags);
+        upipe_fsink_writer_free(writer);
+        upipe_warn(upipe, "unable to create writer thread");
+        return;
+    }
+    upipe_fsink->writer = writer;
+    upipe_dbg_va(upipe, "writing asynchronously with %u buffers", nb);
+}
+
+/** @internal @This hands the buffer being filled over to the writer thread.
+ *
+ * @param writer pointer to the asynchronous writer
+ */
+static void upipe_fsink_writer_submit(struct upipe_fsink_writer *writer)
+{
+    pthread_mutex_lock(&writer->mutex);
+    writer->pending++;
+    pthread_cond_signal(&writer->cond);
+    pthread_mutex_unlock(&writer->mutex);
+    writer->head = (writer->head + 1) % writer->nb;
+}
+
+/** @internal @This checks whether the event loop may fill a buffer.
+ *
+ * @param writer pointer to the asynchronous writer
+ * @param error_p filled in with the errno of the first write error, or 0
+ * @return true if all buffers are waiting to be written
+ */
+static bool upipe_fsink_writer_full(struct upipe_fsink_writer *writer,
+                                    int *error_p)
+{
+    pthread_mutex_lock(&writer->mutex);
+    bool full = writer->pending == writer->nb;
+    *error_p = writer->error;
+    pthread_mutex_unlock(&writer->mutex);
+    return full;
+}
+
+/** @internal @This asks the writer thread to sync the file, after having
+ * written the partially filled buffer.
+ *
+ * @param writer pointer to the asynchronous writer
+ */
+static void upipe_fsink_writer_sync(struct upipe_fsink_writer *writer)
+{
+    pthread_mutex_lock(&writer->mutex);
+    /* the pending buffers are written before the sync */
+    bool partial = writer->pending < writer->nb &&
+                   writer->buffers[writer->head].size;
+    if (partial)
+        writer->pending++;
+    writer->sync = true;
+    pthread_cond_signal(&writer->cond);
+    pthread_mutex_unlock(&writer->mutex);
+    if (partial)
+        writer->head = (writer->head + 1) % writer->nb;
+}
+
+/** @internal @This writes the remaining buffers and stops the asynchronous
+ * writer. This blocks until all data is written.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_fsink_writer_close(struct upipe *upipe)
+{
+    struct upipe_fsink *upipe_fsink = upipe_fsink_from_upipe(upipe);
+    struct upipe_fsink_writer *writer = upipe_fsink->writer;
+    if (writer == NULL)
+        return;
+
+    pthread_mutex_lock(&writer->mutex);
+    if (writer->pending < writer->nb && writer->buffers[writer->head].size)
+        writer->pending++;
+    writer->exit = true;
+    pthread_cond_signal(&writer->cond);
+    pthread_mutex_unlock(&writer->mutex);
+    pthread_join(writer->thread, NULL);
+
+    if (unlikely(writer->error)) {
+        errno = writer->error;
+        upipe_warn_va(upipe, "write error to %s (%m)", upipe_fsink->path);
+    }
+    if (writer->direct) {
+        int flags = fcntl(writer->fd, F_GETFL);
+        if (flags != -1)
+            fcntl(writer->fd, F_SETFL, flags & ~O_DIRECT);
+    }
+    pthread_cond_destroy(&writer->cond);
+    pthread_mutex_destroy(&writer->mutex);
+    ueventfd_clean(&writer->event);
+    upipe_fsink_writer_free(writer);
+    upipe_fsink->writer = NULL;
+}
+
+/** @internal @This copies data to the staging buffers of the asynchronous
+ * writer.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref uref structure
+ * @return true if the uref was processed
+ */
+static bool upipe_fsink_output_async(struct upipe *upipe, struct uref *uref)
+{
+    struct upipe_fsink *upipe_fsink = upipe_fsink_from_upipe(upipe);
+    struct upipe_fsink_writer *writer = upipe_fsink->writer;
+
+    size_t size;
+    if (unlikely(!ubase_check(uref_block_size(uref, &size)))) {
+        uref_free(uref);
+        upipe_warn(upipe, "cannot read ubuf buffer");
+        return true;
+    }
+
+    while (size) {
+        int error;
+        if (unlikely(upipe_fsink_writer_full(writer, &error))) {
+            upipe_fsink_poll(upipe);
+            return false;
+        }
+        if (unlikely(error)) {
+            uref_free(uref);
+            errno = error;
+            upipe_warn_va(upipe, "write error to %s (%m)", upipe_fsink->path);
+            upipe_fsink_set_upump(upipe, NULL);
+            upipe_fsink_set_upump_sync(upipe, NULL);
+            upipe_throw_sink_end(upipe);
+            return true;
+        }
+
+        struct upipe_fsink_buffer *buffer = &writer->buffers[writer->head];
+        size_t chunk = UPIPE_FSINK_ASYNC_BUFFER_SIZE - buffer->size;
+        if (chunk > size)
+            chunk = size;
+        if (unlikely(!ubase_check(uref_block_extract(uref, 0, chunk,
+                                    buffer->data + buffer->size)))) {
+            uref_free(uref);
+            upipe_warn(upipe, "cannot read ubuf buffer");
+            return true;
+        }
+        buffer->size += chunk;
+        size -= chunk;
+        if (buffer->size == UPIPE_FSINK_ASYNC_BUFFER_SIZE)
+            upipe_fsink_writer_submit(writer);
+        if (size)
+            uref_block_resize(uref, chunk, -1);
+    }
+    uref_free(uref);
+    return true;
+}
+
 /** @This starts the watcher waiting for the sink to unblock.
  *
  * @param upipe description structure of the pipe
@@ -163,8 +561,14 @@ static void upipe_fsink_poll(struct upipe *upipe)
         upipe_throw_fatal(upipe, UBASE_ERR_UPUMP);
         return;
     }
-    struct upump *watcher = upump_alloc_fd_write(upipe_fsink->upump_mgr,
-            upipe_fsink_watcher, upipe, upipe->refcount, upipe_fsink->fd);
+    struct upump *watcher;
+    if (upipe_fsink->writer != NULL)
+        watcher = ueventfd_upump_alloc(&upipe_fsink->writer->event,
+                upipe_fsink->upump_mgr, upipe_fsink_writer_watcher, upipe,
+                upipe->refcount);
+    else
+        watcher = upump_alloc_fd_write(upipe_fsink->upump_mgr,
+                upipe_fsink_watcher, upipe, upipe->refcount, upipe_fsink->fd);
     if (unlikely(watcher == NULL)) {
         upipe_err(upipe, "can't create watcher");
         upipe_throw_fatal(upipe, UBASE_ERR_UPUMP);
@@ -218,28 +622,53 @@ static bool upipe_fsink_output(struct upipe *upipe, struct uref *uref,
     }
 
 write_buffer:
+    if (upipe_fsink->writer != NULL)
+        return upipe_fsink_output_async(upipe, uref);
+
     for ( ; ; ) {
-        int iovec_count = uref_block_iovec_count(uref, 0, -1);
-        if (unlikely(iovec_count == -1)) {
-            uref_free(uref);
-            upipe_warn(upipe, "cannot read ubuf buffer");
-            break;
-        }
-        if (unlikely(iovec_count == 0)) {
-            uref_free(uref);
-            break;
-        }
+        ssize_t ret;
+        int range_size = -1, range_fd;
+        uint64_t range_offset;
+        if (upipe_fsink->sendfile && uref->ubuf != NULL &&
+            ubase_check(ubuf_block_file_get_range(uref->ubuf, 0, &range_size,
+                                                  &range_fd, &range_offset))) {
+            /* the payload is copied by the kernel from the source file */
+            off_t offset = range_offset;
+            ret = sendfile(upipe_fsink->fd, range_fd, &offset, range_size);
+            if (unlikely(ret == -1 && (errno == EINVAL || errno == ENOSYS))) {
+                upipe_dbg_va(upipe, "falling back to writes to %s (%m)",
+                             upipe_fsink->path);
+                upipe_fsink->sendfile = false;
+                continue;
+            }
+            if (unlikely(!ret && range_size)) {
+                /* the source file was truncated */
+                errno = EIO;
+                ret = -1;
+            }
+        } else {
+            int iovec_count = uref_block_iovec_count(uref, 0, -1);
+            if (unlikely(iovec_count == -1)) {
+                uref_free(uref);
+                upipe_warn(upipe, "cannot read ubuf buffer");
+                break;
+            }
+            if (unlikely(iovec_count == 0)) {
+                uref_free(uref);
+                break;
+            }
 
-        struct iovec iovecs[iovec_count];
-        if (unlikely(!ubase_check(uref_block_iovec_read(uref, 0, -1,
-                                                        iovecs)))) {
-            uref_free(uref);
-            upipe_warn(upipe, "cannot read ubuf buffer");
-            break;
-        }
+            struct iovec iovecs[iovec_count];
+            if (unlikely(!ubase_check(uref_block_iovec_read(uref, 0, -1,
+                                                            iovecs)))) {
+                uref_free(uref);
+                upipe_warn(upipe, "cannot read ubuf buffer");
+                break;
+            }
 
-        ssize_t ret = writev(upipe_fsink->fd, iovecs, iovec_count);
-        uref_block_iovec_unmap(uref, 0, -1, iovecs);
+            ret = writev(upipe_fsink->fd, iovecs, iovec_count);
+            uref_block_iovec_unmap(uref, 0, -1, iovecs);
+        }
 
         if (unlikely(ret == -1)) {
             switch (errno) {
@@ -297,6 +726,19 @@ static void upipe_fsink_watcher(struct upump *upump)
     }
 }
 
+/** @internal @This is called when the writer thread has written a buffer.
+ * Unblock the sink and unqueue all queued buffers.
+ *
+ * @param upump description structure of the watcher
+ */
+static void upipe_fsink_writer_watcher(struct upump *upump)
+{
+    struct upipe *upipe = upump_get_opaque(upump, struct upipe *);
+    struct upipe_fsink *upipe_fsink = upipe_fsink_from_upipe(upipe);
+    ueventfd_read(&upipe_fsink->writer->event);
+    upipe_fsink_watcher(upump);
+}
+
 /** @internal @This is called when the file descriptor needs to be sync'ed.
  *
  * @param upump description structure of the timer
@@ -305,7 +747,9 @@ static void upipe_fsink_sync(struct upump *upump)
 {
     struct upipe *upipe = upump_get_opaque(upump, struct upipe *);
     struct upipe_fsink *upipe_fsink = upipe_fsink_from_upipe(upipe);
-    if (likely(upipe_fsink->fd != -1))
+    if (upipe_fsink->writer != NULL)
+        upipe_fsink_writer_sync(upipe_fsink->writer);
+    else if (likely(upipe_fsink->fd != -1))
 #if defined(_POSIX_SYNCHRONIZED_IO) && _POSIX_SYNCHRONIZED_IO > 0
         fdatasync(upipe_fsink->fd);
 #else
@@ -394,13 +838,14 @@ static int _upipe_fsink_set_path(struct upipe *upipe, const char *path,
 {
     struct upipe_fsink *upipe_fsink = upipe_fsink_from_upipe(upipe);
 
+    upipe_fsink_set_upump(upipe, NULL);
+    upipe_fsink_writer_close(upipe);
     if (unlikely(upipe_fsink->fd != -1)) {
         if (likely(upipe_fsink->path != NULL))
             upipe_notice_va(upipe, "closing file %s", upipe_fsink->path);
         ubase_clean_fd(&upipe_fsink->fd);
     }
     ubase_clean_str(&upipe_fsink->path);
-    upipe_fsink_set_upump(upipe, NULL);
     upipe_fsink_set_upump_sync(upipe, NULL);
     if (!upipe_fsink_check_input(upipe))
         /* Release the pipe used in @ref upipe_fsink_input. */
@@ -433,6 +878,7 @@ static int _upipe_fsink_set_path(struct upipe *upipe, const char *path,
             upipe_err_va(upipe, "invalid mode %d", mode);
             return UBASE_ERR_INVALID;
     }
+    upipe_fsink->sendfile = true;
     upipe_fsink->fd = open(path, O_WRONLY | O_NONBLOCK | O_CLOEXEC | flags,
                            S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
     if (unlikely(upipe_fsink->fd == -1)) {
@@ -463,6 +909,7 @@ static int _upipe_fsink_set_path(struct upipe *upipe, const char *path,
         upipe_use(upipe);
     upipe_notice_va(upipe, "opening file %s in %s mode",
                     upipe_fsink->path, mode_desc);
+    upipe_fsink_writer_open(upipe);
     return UBASE_ERR_NONE;
 }
 
@@ -478,13 +925,14 @@ static int _upipe_fsink_set_fd(struct upipe *upipe, int fd,
 {
     struct upipe_fsink *upipe_fsink = upipe_fsink_from_upipe(upipe);
 
+    upipe_fsink_set_upump(upipe, NULL);
+    upipe_fsink_writer_close(upipe);
     if (unlikely(upipe_fsink->fd != -1)) {
         if (likely(upipe_fsink->path != NULL))
             upipe_notice_va(upipe, "closing file %s", upipe_fsink->path);
         ubase_clean_fd(&upipe_fsink->fd);
     }
     ubase_clean_str(&upipe_fsink->path);
-    upipe_fsink_set_upump(upipe, NULL);
     upipe_fsink_set_upump_sync(upipe, NULL);
     if (!upipe_fsink_check_input(upipe))
         /* Release the pipe used in @ref upipe_fsink_input. */
@@ -513,6 +961,7 @@ static int _upipe_fsink_set_fd(struct upipe *upipe, int fd,
             return UBASE_ERR_INVALID;
     }
     upipe_fsink->fd = fd;
+    upipe_fsink->sendfile = true;
     switch (mode) {
         /* O_APPEND seeks on each write, so use this instead */
         case UPIPE_FSINK_APPEND:
@@ -529,8 +978,9 @@ static int _upipe_fsink_set_fd(struct upipe *upipe, int fd,
     if (!upipe_fsink_check_input(upipe))
         /* Use again the pipe that we previously released. */
         upipe_use(upipe);
-    upipe_notice_va(upipe, "opening file %s in %s mode",
-                    upipe_fsink->path, mode_desc);
+    upipe_notice_va(upipe, "opening file descriptor %d in %s mode",
+                    upipe_fsink->fd, mode_desc);
+    upipe_fsink_writer_open(upipe);
     return UBASE_ERR_NONE;
 }
 
@@ -646,6 +1096,19 @@ static int  _upipe_fsink_control(struct upipe *upipe, int command, va_list args)
             uint64_t *p = va_arg(args, uint64_t *);
             return _upipe_fsink_get_sync_period(upipe, p);
         }
+        case UPIPE_FSINK_SET_ASYNC_DEPTH: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_FSINK_SIGNATURE)
+            struct upipe_fsink *upipe_fsink = upipe_fsink_from_upipe(upipe);
+            upipe_fsink->async_depth = va_arg(args, unsigned int);
+            return UBASE_ERR_NONE;
+        }
+        case UPIPE_FSINK_GET_ASYNC_DEPTH: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_FSINK_SIGNATURE)
+            struct upipe_fsink *upipe_fsink = upipe_fsink_from_upipe(upipe);
+            unsigned int *p = va_arg(args, unsigned int *);
+            *p = upipe_fsink->async_depth;
+            return UBASE_ERR_NONE;
+        }
         default:
             return UBASE_ERR_UNHANDLED;
     }
@@ -695,6 +1158,8 @@ static int upipe_fsink_control(struct upipe *upipe, int command, va_list args)
 static void upipe_fsink_free(struct upipe *upipe)
 {
     struct upipe_fsink *upipe_fsink = upipe_fsink_from_upipe(upipe);
+    upipe_fsink_set_upump(upipe, NULL);
+    upipe_fsink_writer_close(upipe);
     if (likely(upipe_fsink->fd != -1)) {
         if (likely(upipe_fsink->path != NULL)) {
             upipe_notice_va(upipe, "closing file %s", upipe_fsink->path);
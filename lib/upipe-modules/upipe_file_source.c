@@ -39,6 +39,11 @@
 #include <upipe/uref_clock.h>
 #include <upipe/upump.h>
 #include <upipe/ubuf.h>
+#include <upipe/ubuf_block.h>
+#include <upipe/ubuf_block_common.h>
+#include <upipe/ubuf_block_file.h>
+#include <upipe/upool.h>
+#include <upipe/uatomic.h>
 #include <upipe/upipe.h>
 #include <upipe/upipe_helper_upipe.h>
 #include <upipe/upipe_helper_urefcount.h>
@@ -62,6 +67,7 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <sys/ioctl.h>
+#include <sys/mman.h>
 #include <errno.h>
 #include <assert.h>
 
@@ -71,10 +77,59 @@
 
 /** default size of buffers when unspecified */
 #define UBUF_DEFAULT_SIZE       32768
+/** depth of the pools of ubufs and chunks pointing to a mapping */
+#define MAP_POOL_DEPTH          64
 
 /** @hidden */
 static int upipe_fsrc_check(struct upipe *upipe, struct uref *flow_format);
 
+/** @internal @This is a chunk of a mapped file, referenced by one or several
+ * ubufs. */
+struct upipe_fsrc_chunk {
+    /** number of ubufs pointing to the chunk */
+    uatomic_uint32_t refcount;
+};
+
+/** @internal @This is a file mapped in memory, acting as ubuf manager for
+ * its chunks. It is unmapped when the pipe and all ubufs are released. */
+struct upipe_fsrc_map {
+    /** refcount management structure */
+    struct urefcount urefcount;
+
+    /** start of the mapping */
+    uint8_t *base;
+    /** size of the mapping */
+    uint64_t size;
+
+    /** ubuf pool */
+    struct upool ubuf_pool;
+    /** chunk pool */
+    struct upool chunk_pool;
+
+    /** common management structure */
+    struct ubuf_mgr mgr;
+
+    /** extra space for the upools */
+    uint8_t extra[];
+};
+
+UBASE_FROM_TO(upipe_fsrc_map, ubuf_mgr, ubuf_mgr, mgr)
+UBASE_FROM_TO(upipe_fsrc_map, urefcount, urefcount, urefcount)
+UBASE_FROM_TO(upipe_fsrc_map, upool, ubuf_pool, ubuf_pool)
+UBASE_FROM_TO(upipe_fsrc_map, upool, chunk_pool, chunk_pool)
+
+/** @internal @This is a super-set of the @ref ubuf (and @ref ubuf_block)
+ * structure pointing to a chunk of a mapped file. */
+struct upipe_fsrc_ubuf {
+    /** pointer to the chunk */
+    struct upipe_fsrc_chunk *chunk;
+
+    /** block structure */
+    struct ubuf_block ubuf_block;
+};
+
+UBASE_FROM_TO(upipe_fsrc_ubuf, ubuf, ubuf, ubuf_block.ubuf)
+
 /** @internal @This is the private context of a file source pipe. */
 struct upipe_fsrc {
     /** refcount management structure */
@@ -122,6 +177,18 @@ struct upipe_fsrc {
     int fd;
     /** length to read */
     uint64_t length;
+    /** true if regular files are mapped in memory */
+    bool mmap;
+    /** mapping of the file, or NULL */
+    struct upipe_fsrc_map *map;
+    /** true if regular files are output as file ranges */
+    bool file_ubuf;
+    /** ubuf manager of file ranges, or NULL */
+    struct ubuf_mgr *file_mgr;
+    /** size of the file output as file ranges */
+    uint64_t file_size;
+    /** reading position in the mapping or the file ranges */
+    uint64_t position;
 
     /** public upipe structure */
     struct upipe upipe;
@@ -177,6 +244,12 @@ static struct upipe *upipe_fsrc_alloc(struct upipe_mgr *mgr,
     upipe_fsrc->uri = NULL;
     upipe_fsrc->fd = -1;
     upipe_fsrc->length = (uint64_t)-1;
+    upipe_fsrc->mmap = false;
+    upipe_fsrc->map = NULL;
+    upipe_fsrc->file_ubuf = false;
+    upipe_fsrc->file_mgr = NULL;
+    upipe_fsrc->file_size = 0;
+    upipe_fsrc->position = 0;
     upipe_fsrc->safe = false;
     upipe_throw_ready(upipe);
     return upipe;
@@ -190,6 +263,277 @@ static void upipe_fsrc_set_upump_safe(struct upipe *upipe,
     upipe_fsrc_set_upump(upipe, upump);
 }
 
+/** @This unmaps a file.
+ *
+ * @param urefcount pointer to urefcount
+ */
+static void upipe_fsrc_map_free(struct urefcount *urefcount)
+{
+    struct upipe_fsrc_map *map = upipe_fsrc_map_from_urefcount(urefcount);
+    munmap(map->base, map->size);
+    upool_clean(&map->ubuf_pool);
+    upool_clean(&map->chunk_pool);
+    urefcount_clean(urefcount);
+    free(map);
+}
+
+/** @internal @This releases a chunk, once it isn't used by any ubuf anymore.
+ *
+ * @param map pointer to the mapping
+ * @param chunk pointer to the chunk
+ */
+static void upipe_fsrc_chunk_release(struct upipe_fsrc_map *map,
+                                     struct upipe_fsrc_chunk *chunk)
+{
+    if (uatomic_fetch_sub(&chunk->refcount, 1) == 1)
+        upool_free(&map->chunk_pool, chunk);
+}
+
+/** @internal @This allocates a ubuf structure from the pool.
+ *
+ * @param map pointer to the mapping
+ * @param chunk pointer to the chunk, whose reference is taken over
+ * @return pointer to ubuf or NULL in case of allocation error
+ */
+static struct ubuf *upipe_fsrc_ubuf_alloc(struct upipe_fsrc_map *map,
+                                          struct upipe_fsrc_chunk *chunk)
+{
+    struct upipe_fsrc_ubuf *fsrc_ubuf =
+        upool_alloc(&map->ubuf_pool, struct upipe_fsrc_ubuf *);
+    if (unlikely(fsrc_ubuf == NULL))
+        return NULL;
+    fsrc_ubuf->chunk = chunk;
+    struct ubuf *ubuf = upipe_fsrc_ubuf_to_ubuf(fsrc_ubuf);
+    ubuf_block_common_init(ubuf, false);
+    ubuf_block_common_set_buffer(ubuf, map->base);
+    return ubuf;
+}
+
+/** @This refuses to allocate arbitrary ubufs.
+ *
+ * @param mgr common management structure
+ * @param signature signature of the allocator
+ * @param args optional arguments
+ * @return NULL
+ */
+static struct ubuf *upipe_fsrc_map_alloc(struct ubuf_mgr *mgr,
+                                         uint32_t signature, va_list args)
+{
+    return NULL;
+}
+
+/** @This creates a new reference to the same chunk, with another offset
+ * and size.
+ *
+ * @param ubuf pointer to ubuf
+ * @param new_ubuf_p reference written with a pointer to the newly allocated
+ * ubuf
+ * @param offset offset in the buffer, or -1 to duplicate the ubuf
+ * @param size final size of the buffer
+ * @return an error code
+ */
+static int upipe_fsrc_ubuf_splice(struct ubuf *ubuf, struct ubuf **new_ubuf_p,
+                                  int offset, int size)
+{
+    assert(new_ubuf_p != NULL);
+    struct upipe_fsrc_map *map = upipe_fsrc_map_from_ubuf_mgr(ubuf->mgr);
+    struct upipe_fsrc_ubuf *fsrc_ubuf = upipe_fsrc_ubuf_from_ubuf(ubuf);
+    uatomic_fetch_add(&fsrc_ubuf->chunk->refcount, 1);
+    struct ubuf *new_ubuf = upipe_fsrc_ubuf_alloc(map, fsrc_ubuf->chunk);
+    if (unlikely(new_ubuf == NULL)) {
+        upipe_fsrc_chunk_release(map, fsrc_ubuf->chunk);
+        return UBASE_ERR_ALLOC;
+    }
+
+    int err = offset < 0 ? ubuf_block_common_dup(ubuf, new_ubuf) :
+              ubuf_block_common_splice(ubuf, new_ubuf, offset, size);
+    if (unlikely(!ubase_check(err))) {
+        ubuf_free(new_ubuf);
+        return UBASE_ERR_INVALID;
+    }
+    *new_ubuf_p = new_ubuf;
+    return UBASE_ERR_NONE;
+}
+
+/** @This handles control commands.
+ *
+ * @param ubuf pointer to ubuf
+ * @param command type of command to process
+ * @param args arguments of the command
+ * @return an error code
+ */
+static int upipe_fsrc_ubuf_control(struct ubuf *ubuf, int command,
+                                   va_list args)
+{
+    switch (command) {
+        case UBUF_DUP: {
+            struct ubuf **new_ubuf_p = va_arg(args, struct ubuf **);
+            return upipe_fsrc_ubuf_splice(ubuf, new_ubuf_p, -1, 0);
+        }
+        case UBUF_SINGLE: {
+            /* the mapping is private, so writes are copied on demand */
+            struct upipe_fsrc_ubuf *fsrc_ubuf = upipe_fsrc_ubuf_from_ubuf(ubuf);
+            return uatomic_load(&fsrc_ubuf->chunk->refcount) == 1 ?
+                   UBASE_ERR_NONE : UBASE_ERR_BUSY;
+        }
+        case UBUF_SPLICE_BLOCK: {
+            struct ubuf **new_ubuf_p = va_arg(args, struct ubuf **);
+            int offset = va_arg(args, int);
+            int size = va_arg(args, int);
+            return upipe_fsrc_ubuf_splice(ubuf, new_ubuf_p, offset, size);
+        }
+        default:
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** @This releases a ubuf, and the chunk if it was the last reference.
+ *
+ * @param ubuf pointer to a ubuf structure
+ */
+static void upipe_fsrc_ubuf_free(struct ubuf *ubuf)
+{
+    struct upipe_fsrc_map *map = upipe_fsrc_map_from_ubuf_mgr(ubuf->mgr);
+    struct upipe_fsrc_ubuf *fsrc_ubuf = upipe_fsrc_ubuf_from_ubuf(ubuf);
+    ubuf_block_common_clean(ubuf);
+    upipe_fsrc_chunk_release(map, fsrc_ubuf->chunk);
+    /* may unmap the file */
+    upool_free(&map->ubuf_pool, fsrc_ubuf);
+}
+
+/** @internal @This allocates the data structure.
+ *
+ * @param upool pointer to upool
+ * @return pointer to upipe_fsrc_ubuf or NULL in case of allocation error
+ */
+static void *upipe_fsrc_ubuf_alloc_inner(struct upool *upool)
+{
+    struct upipe_fsrc_map *map = upipe_fsrc_map_from_ubuf_pool(upool);
+    struct upipe_fsrc_ubuf *fsrc_ubuf = malloc(sizeof(struct upipe_fsrc_ubuf));
+    if (unlikely(fsrc_ubuf == NULL))
+        return NULL;
+    upipe_fsrc_ubuf_to_ubuf(fsrc_ubuf)->mgr = upipe_fsrc_map_to_ubuf_mgr(map);
+    return fsrc_ubuf;
+}
+
+/** @internal @This frees a upipe_fsrc_ubuf.
+ *
+ * @param upool pointer to upool
+ * @param fsrc_ubuf pointer to a upipe_fsrc_ubuf structure to free
+ */
+static void upipe_fsrc_ubuf_free_inner(struct upool *upool, void *fsrc_ubuf)
+{
+    free(fsrc_ubuf);
+}
+
+/** @internal @This allocates a chunk.
+ *
+ * @param upool pointer to upool
+ * @return pointer to upipe_fsrc_chunk or NULL in case of allocation error
+ */
+static void *upipe_fsrc_chunk_alloc_inner(struct upool *upool)
+{
+    struct upipe_fsrc_chunk *chunk = malloc(sizeof(struct upipe_fsrc_chunk));
+    if (unlikely(chunk == NULL))
+        return NULL;
+    uatomic_init(&chunk->refcount, 0);
+    return chunk;
+}
+
+/** @internal @This frees a chunk.
+ *
+ * @param upool pointer to upool
+ * @param chunk pointer to a upipe_fsrc_chunk structure to free
+ */
+static void upipe_fsrc_chunk_free_inner(struct upool *upool, void *chunk)
+{
+    uatomic_clean(&((struct upipe_fsrc_chunk *)chunk)->refcount);
+    free(chunk);
+}
+
+/** @This handles manager control commands.
+ *
+ * @param mgr pointer to ubuf manager
+ * @param command type of command to process
+ * @param args arguments of the command
+ * @return an error code
+ */
+static int upipe_fsrc_map_control(struct ubuf_mgr *mgr,
+                                  int command, va_list args)
+{
+    struct upipe_fsrc_map *map = upipe_fsrc_map_from_ubuf_mgr(mgr);
+    switch (command) {
+        case UBUF_MGR_VACUUM:
+            upool_vacuum(&map->ubuf_pool);
+            upool_vacuum(&map->chunk_pool);
+            return UBASE_ERR_NONE;
+        default:
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** @internal @This maps a regular file in memory.
+ *
+ * @param upipe description structure of the pipe
+ * @param fd file descriptor
+ * @param size size of the file
+ * @return pointer to the mapping, or NULL in case of error
+ */
+static struct upipe_fsrc_map *upipe_fsrc_map_open(struct upipe *upipe,
+                                                  int fd, uint64_t size)
+{
+    if (unlikely(!size || size != (size_t)size))
+        return NULL;
+
+    void *base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    if (unlikely(base == MAP_FAILED)) {
+        upipe_warn_va(upipe, "unable to map file (%m)");
+        return NULL;
+    }
+    if (unlikely(madvise(base, size, MADV_SEQUENTIAL) == -1))
+        upipe_dbg_va(upipe, "unable to advise sequential access (%m)");
+
+    struct upipe_fsrc_map *map =
+        malloc(sizeof(struct upipe_fsrc_map) + 2 * upool_sizeof(MAP_POOL_DEPTH));
+    if (unlikely(map == NULL)) {
+        munmap(base, size);
+        return NULL;
+    }
+
+    urefcount_init(upipe_fsrc_map_to_urefcount(map), upipe_fsrc_map_free);
+    map->base = base;
+    map->size = size;
+    map->mgr.refcount = upipe_fsrc_map_to_urefcount(map);
+    map->mgr.signature = UBUF_ALLOC_BLOCK;
+    map->mgr.ubuf_alloc = upipe_fsrc_map_alloc;
+    map->mgr.ubuf_control = upipe_fsrc_ubuf_control;
+    map->mgr.ubuf_free = upipe_fsrc_ubuf_free;
+    map->mgr.ubuf_mgr_control = upipe_fsrc_map_control;
+    upool_init(&map->ubuf_pool, map->mgr.refcount, MAP_POOL_DEPTH,
+               map->extra, upipe_fsrc_ubuf_alloc_inner,
+               upipe_fsrc_ubuf_free_inner);
+    upool_init(&map->chunk_pool, map->mgr.refcount, MAP_POOL_DEPTH,
+               map->extra + upool_sizeof(MAP_POOL_DEPTH),
+               upipe_fsrc_chunk_alloc_inner, upipe_fsrc_chunk_free_inner);
+    return map;
+}
+
+/** @internal @This releases the mapping of the file or the manager of file
+ * ranges, which stay valid until all ubufs are released.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_fsrc_map_close(struct upipe *upipe)
+{
+    struct upipe_fsrc *upipe_fsrc = upipe_fsrc_from_upipe(upipe);
+    if (upipe_fsrc->map != NULL)
+        urefcount_release(upipe_fsrc_map_to_urefcount(upipe_fsrc->map));
+    upipe_fsrc->map = NULL;
+    ubuf_mgr_release(upipe_fsrc->file_mgr);
+    upipe_fsrc->file_mgr = NULL;
+    upipe_fsrc->position = 0;
+}
+
 /** @internal @This returns the path of the currently opened file.
  *
  * @param upipe description structure of the pipe
@@ -205,6 +549,78 @@ static int upipe_fsrc_get_uri(struct upipe *upipe, const char **path_p)
     return uref_uri_get_path(upipe_fsrc->uri, path_p);
 }
 
+/** @internal @This outputs the next chunk of a mapped file, or the next
+ * file range, without copy.
+ *
+ * @param upipe description structure of the pipe
+ * @param systime date of the reception
+ */
+static void upipe_fsrc_worker_map(struct upipe *upipe, uint64_t systime)
+{
+    struct upipe_fsrc *upipe_fsrc = upipe_fsrc_from_upipe(upipe);
+    struct upipe_fsrc_map *map = upipe_fsrc->map;
+    uint64_t file_size = map != NULL ? map->size : upipe_fsrc->file_size;
+    uint64_t size = file_size - upipe_fsrc->position;
+    if (size > upipe_fsrc->output_size)
+        size = upipe_fsrc->output_size;
+    if (size > upipe_fsrc->length)
+        size = upipe_fsrc->length;
+
+    struct ubuf *ubuf;
+    if (map == NULL) {
+        ubuf = ubuf_block_file_alloc(upipe_fsrc->file_mgr,
+                                     upipe_fsrc->position, size);
+        if (unlikely(ubuf == NULL)) {
+            upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+            return;
+        }
+    } else {
+        struct upipe_fsrc_chunk *chunk =
+            upool_alloc(&map->chunk_pool, struct upipe_fsrc_chunk *);
+        if (unlikely(chunk == NULL)) {
+            upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+            return;
+        }
+        uatomic_store(&chunk->refcount, 1);
+
+        ubuf = upipe_fsrc_ubuf_alloc(map, chunk);
+        if (unlikely(ubuf == NULL)) {
+            upipe_fsrc_chunk_release(map, chunk);
+            upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+            return;
+        }
+        ubuf_block_common_set(ubuf, upipe_fsrc->position, size);
+    }
+
+    struct uref *uref = uref_alloc(upipe_fsrc->uref_mgr);
+    if (unlikely(uref == NULL)) {
+        ubuf_free(ubuf);
+        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+        return;
+    }
+    uref_attach_ubuf(uref, ubuf);
+
+    upipe_fsrc->position += size;
+    if (upipe_fsrc->length != (uint64_t)-1)
+        upipe_fsrc->length -= size;
+    bool end = upipe_fsrc->position >= file_size;
+    if (upipe_fsrc->uclock != NULL)
+        uref_clock_set_cr_sys(uref, systime);
+    if (unlikely(end))
+        uref_block_set_end(uref);
+    upipe_fsrc->safe = true;
+    upipe_fsrc_output(upipe, uref, &upipe_fsrc->upump);
+    if (likely(upipe_fsrc->safe) && unlikely(end)) {
+        const char *path = "(none)";
+        upipe_fsrc_get_uri(upipe, &path);
+        upipe_notice_va(upipe, "end of file %s", path);
+        upipe_fsrc_set_upump_safe(upipe, NULL);
+        upipe_fsrc_map_close(upipe);
+        ubase_clean_fd(&upipe_fsrc->fd);
+        upipe_throw_source_end(upipe);
+    }
+}
+
 /** @internal @This reads data from the source and outputs it.
  * It is called either when the idler triggers (permanent storage mode) or
  * when data is available on the file descriptor (live stream mode).
@@ -225,11 +641,17 @@ static void upipe_fsrc_worker(struct upump *upump)
             path = "(none)";
         upipe_notice_va(upipe, "end of range %s", path);
         upipe_fsrc_set_upump_safe(upipe, NULL);
+        upipe_fsrc_map_close(upipe);
         ubase_clean_fd(&upipe_fsrc->fd);
         upipe_throw_source_end(upipe);
         return;
     }
 
+    if (upipe_fsrc->map != NULL || upipe_fsrc->file_mgr != NULL) {
+        upipe_fsrc_worker_map(upipe, systime);
+        return;
+    }
+
     if (upipe_fsrc->length != (uint64_t)-1 &&
         upipe_fsrc->length < upipe_fsrc->output_size &&
         unlikely(upipe_fsrc_set_output_size(upipe, upipe_fsrc->length))) {
@@ -412,6 +834,19 @@ static int upipe_fsrc_open(struct upipe *upipe)
 
     upipe_fsrc->fd = fd;
     upipe_fsrc->regular_file = !!S_ISREG(st.st_mode);
+    if (upipe_fsrc->file_ubuf && upipe_fsrc->regular_file && st.st_size) {
+        upipe_fsrc->file_mgr = ubuf_block_file_mgr_alloc(MAP_POOL_DEPTH,
+                                                         MAP_POOL_DEPTH, fd);
+        upipe_fsrc->file_size = st.st_size;
+        if (unlikely(upipe_fsrc->file_mgr == NULL))
+            upipe_warn_va(upipe, "reading file %s without file ranges", path);
+    }
+    if (upipe_fsrc->file_mgr == NULL && upipe_fsrc->mmap &&
+        upipe_fsrc->regular_file) {
+        upipe_fsrc->map = upipe_fsrc_map_open(upipe, fd, st.st_size);
+        if (unlikely(upipe_fsrc->map == NULL))
+            upipe_warn_va(upipe, "reading file %s without mapping", path);
+    }
     upipe_notice_va(upipe, "opening file %s", path);
     upipe_fsrc_build_flow_def(upipe);
     return UBASE_ERR_NONE;
@@ -428,6 +863,7 @@ static void upipe_fsrc_close(struct upipe *upipe)
         upipe_notice_va(upipe, "closing file %s", path);
         ubase_clean_fd(&upipe_fsrc->fd);
     }
+    upipe_fsrc_map_close(upipe);
     upipe_fsrc->length = (uint64_t)-1;
     upipe_fsrc_set_upump_safe(upipe, NULL);
     uref_free(upipe_fsrc->uri);
@@ -514,6 +950,10 @@ static int _upipe_fsrc_get_position(struct upipe *upipe,
     assert(position_p != NULL);
     if (unlikely(upipe_fsrc->fd == -1))
         return UBASE_ERR_UNHANDLED;
+    if (upipe_fsrc->map != NULL || upipe_fsrc->file_mgr != NULL) {
+        *position_p = upipe_fsrc->position;
+        return UBASE_ERR_NONE;
+    }
     off_t position = lseek(upipe_fsrc->fd, 0, SEEK_CUR);
     if (unlikely(position == (off_t)-1))
         return UBASE_ERR_EXTERNAL;
@@ -532,6 +972,14 @@ static int _upipe_fsrc_set_position(struct upipe *upipe, uint64_t position)
     struct upipe_fsrc *upipe_fsrc = upipe_fsrc_from_upipe(upipe);
     if (unlikely(upipe_fsrc->fd == -1))
         return UBASE_ERR_UNHANDLED;
+    if (upipe_fsrc->map != NULL || upipe_fsrc->file_mgr != NULL) {
+        if (unlikely(position > (upipe_fsrc->map != NULL ?
+                                 upipe_fsrc->map->size :
+                                 upipe_fsrc->file_size)))
+            return UBASE_ERR_INVALID;
+        upipe_fsrc->position = position;
+        return UBASE_ERR_NONE;
+    }
     return lseek(upipe_fsrc->fd, position, SEEK_SET) != (off_t)-1 ?
         UBASE_ERR_NONE : UBASE_ERR_EXTERNAL;
 }
@@ -597,6 +1045,8 @@ static int _upipe_fsrc_get_range(struct upipe *upipe,
  */
 static int _upipe_fsrc_control(struct upipe *upipe, int command, va_list args)
 {
+    struct upipe_fsrc *upipe_fsrc = upipe_fsrc_from_upipe(upipe);
+
     switch (command) {
         case UPIPE_ATTACH_UPUMP_MGR:
             upipe_fsrc_set_upump_safe(upipe, NULL);
@@ -651,6 +1101,29 @@ static int _upipe_fsrc_control(struct upipe *upipe, int command, va_list args)
             return _upipe_fsrc_get_range(upipe, offset_p, length_p);
         }
 
+        case UPIPE_FSRC_GET_MMAP: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_FSRC_SIGNATURE)
+            int *mmap_p = va_arg(args, int *);
+            *mmap_p = upipe_fsrc->mmap ? 1 : 0;
+            return UBASE_ERR_NONE;
+        }
+        case UPIPE_FSRC_SET_MMAP: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_FSRC_SIGNATURE)
+            upipe_fsrc->mmap = !!va_arg(args, int);
+            return UBASE_ERR_NONE;
+        }
+        case UPIPE_FSRC_GET_FILE_UBUF: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_FSRC_SIGNATURE)
+            int *file_ubuf_p = va_arg(args, int *);
+            *file_ubuf_p = upipe_fsrc->file_ubuf ? 1 : 0;
+            return UBASE_ERR_NONE;
+        }
+        case UPIPE_FSRC_SET_FILE_UBUF: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_FSRC_SIGNATURE)
+            upipe_fsrc->file_ubuf = !!va_arg(args, int);
+            return UBASE_ERR_NONE;
+        }
+
         default:
             return UBASE_ERR_UNHANDLED;
     }
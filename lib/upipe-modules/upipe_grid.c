@@ -84,6 +84,16 @@ UPIPE_HELPER_UREFCOUNT(upipe_grid, urefcount, upipe_grid_no_ref);
 UPIPE_HELPER_UREFCOUNT_REAL(upipe_grid, urefcount_real, upipe_grid_free);
 UPIPE_HELPER_VOID(upipe_grid);
 
+/** @internal @This enumerates the types of grid input flows. */
+enum upipe_grid_in_type {
+    /** no flow def applied yet */
+    UPIPE_GRID_IN_TYPE_NONE,
+    /** picture flow */
+    UPIPE_GRID_IN_TYPE_PIC,
+    /** sound flow */
+    UPIPE_GRID_IN_TYPE_SOUND,
+};
+
 /** @internal @This is the private structure for grid input sub pipe. */
 struct upipe_grid_in {
     /** pipe public structure */
@@ -98,6 +108,12 @@ struct upipe_grid_in {
     struct uref *flow_def;
     /** flow def attr */
     struct uref *flow_attr;
+    /** type of the applied flow def */
+    enum upipe_grid_in_type type;
+    /** highest pts the list of urefs was updated for */
+    uint64_t last_pts;
+    /** true if urefs were queued since the last update */
+    bool updated;
     /** proxy probe */
     struct uprobe proxy;
 };
@@ -118,6 +134,12 @@ enum upipe_grid_out_command {
     UPIPE_GRID_OUT_GET_INPUT,
     /** set the grid output input pipe (struct upipe *) */
     UPIPE_GRID_OUT_SET_INPUT,
+    /** get the grid output crop offsets (uint64_t *, uint64_t *,
+     * uint64_t *, uint64_t *) */
+    UPIPE_GRID_OUT_GET_CROP,
+    /** set the grid output crop offsets (uint64_t, uint64_t, uint64_t,
+     * uint64_t) */
+    UPIPE_GRID_OUT_SET_CROP,
 };
 
 /** @internal @This enumatates the grid output inner pipe events. */
@@ -155,6 +177,14 @@ struct upipe_grid_out {
     struct upipe *input;
     /** true if flow def is up to date */
     bool flow_def_uptodate;
+    /** crop offset from the left border */
+    uint64_t loffset;
+    /** crop offset from the right border */
+    uint64_t roffset;
+    /** crop offset from the top border */
+    uint64_t toffset;
+    /** crop offset from the bottom border */
+    uint64_t boffset;
     /** uchain for super pipe list */
     struct uchain uchain;
 };
@@ -221,6 +251,9 @@ static struct upipe *upipe_grid_in_alloc(struct upipe_mgr *mgr,
     struct upipe_grid_in *upipe_grid_in =
         upipe_grid_in_from_upipe(upipe);
     ulist_init(&upipe_grid_in->urefs);
+    upipe_grid_in->type = UPIPE_GRID_IN_TYPE_NONE;
+    upipe_grid_in->last_pts = 0;
+    upipe_grid_in->updated = true;
 
     upipe_throw_ready(upipe);
 
@@ -278,6 +311,7 @@ static void upipe_grid_in_input(struct upipe *upipe,
     struct upipe_grid_in *upipe_grid_in =
         upipe_grid_in_from_upipe(upipe);
 
+    upipe_grid_in->updated = true;
     if (unlikely(ubase_check(uref_flow_get_def(uref, NULL)))) {
         ulist_add(&upipe_grid_in->urefs, uref_to_uchain(uref));
         return;
@@ -331,6 +365,12 @@ static void upipe_grid_in_set_flow_def_real(struct upipe *upipe,
         upipe_grid_in_from_upipe(upipe);
     struct upipe_grid *upipe_grid = upipe_grid_from_in_mgr(upipe->mgr);
     struct upipe *super = upipe_grid_to_upipe(upipe_grid);
+    if (ubase_check(uref_flow_match_def(flow_def, UREF_PIC_FLOW_DEF)))
+        upipe_grid_in->type = UPIPE_GRID_IN_TYPE_PIC;
+    else if (ubase_check(uref_flow_match_def(flow_def, UREF_SOUND_FLOW_DEF)))
+        upipe_grid_in->type = UPIPE_GRID_IN_TYPE_SOUND;
+    else
+        upipe_grid_in->type = UPIPE_GRID_IN_TYPE_NONE;
     upipe_grid_in_store_flow_def_input(upipe, flow_def);
     upipe_throw_new_flow_def(upipe, flow_def);
 }
@@ -381,6 +421,14 @@ static void upipe_grid_in_update_pts(struct upipe *upipe, uint64_t next_pts)
 {
     struct upipe_grid_in *upipe_grid_in = upipe_grid_in_from_upipe(upipe);
 
+    /* every output throws the same pts for a tick, and dropping is monotonic
+     * in pts, so the list only needs to be walked again if it changed */
+    if (!upipe_grid_in->updated && next_pts <= upipe_grid_in->last_pts)
+        return;
+    upipe_grid_in->updated = false;
+    if (next_pts > upipe_grid_in->last_pts)
+        upipe_grid_in->last_pts = next_pts;
+
     /* iterarte through the input buffers */
     struct uchain *uchain, *uchain_tmp;
     ulist_delete_foreach(&upipe_grid_in->urefs, uchain, uchain_tmp) {
@@ -486,6 +534,8 @@ static struct upipe *upipe_grid_out_alloc(struct upipe_mgr *mgr,
     upipe_grid_out->flow_def_uptodate = false;
     upipe_grid_out->flow_def_input = false;
     upipe_grid_out->input = NULL;
+    upipe_grid_out->loffset = upipe_grid_out->roffset = 0;
+    upipe_grid_out->toffset = upipe_grid_out->boffset = 0;
 
     upipe_throw_ready(upipe);
 
@@ -533,6 +583,7 @@ static int upipe_grid_out_switch_format(struct upipe *upipe,
                                         struct uref *out_flow,
                                         struct uref *in_flow)
 {
+    struct upipe_grid_out *upipe_grid_out = upipe_grid_out_from_upipe(upipe);
     uint64_t hsize, vsize;
     struct urational sar;
 
@@ -541,11 +592,15 @@ static int upipe_grid_out_switch_format(struct upipe *upipe,
         uref_pic_flow_copy_format(out_flow, in_flow);
         uref_pic_flow_copy_fps(out_flow, in_flow);
         if (likely(ubase_check(uref_pic_flow_get_hsize(in_flow, &hsize)))) {
+            if (hsize > upipe_grid_out->loffset + upipe_grid_out->roffset)
+                hsize -= upipe_grid_out->loffset + upipe_grid_out->roffset;
             uref_pic_flow_set_hsize(out_flow, hsize);
         } else {
             uref_pic_flow_delete_hsize(out_flow);
         }
         if (likely(ubase_check(uref_pic_flow_get_vsize(in_flow, &vsize)))) {
+            if (vsize > upipe_grid_out->toffset + upipe_grid_out->boffset)
+                vsize -= upipe_grid_out->toffset + upipe_grid_out->boffset;
             uref_pic_flow_set_vsize(out_flow, vsize);
         } else {
             uref_pic_flow_delete_vsize(out_flow);
@@ -614,10 +669,32 @@ static int upipe_grid_out_extract_pic(struct upipe *upipe,
 
     struct uref *input_ref =
         uref_from_uchain(ulist_peek(&upipe_grid_in->urefs));
-    struct ubuf *ubuf = ubuf_dup(input_ref->ubuf);
-    if (unlikely(!ubuf)) {
-        upipe_err(upipe, "fail to duplicate ubuf");
-        return UBASE_ERR_ALLOC;
+    struct ubuf *ubuf;
+    if (upipe_grid_out->loffset || upipe_grid_out->roffset ||
+        upipe_grid_out->toffset || upipe_grid_out->boffset) {
+        size_t hsize, vsize;
+        UBASE_RETURN(ubuf_pic_size(input_ref->ubuf, &hsize, &vsize, NULL));
+        if (unlikely(hsize <= upipe_grid_out->loffset +
+                              upipe_grid_out->roffset ||
+                     vsize <= upipe_grid_out->toffset +
+                              upipe_grid_out->boffset)) {
+            upipe_warn(upipe, "crop larger than input picture");
+            return UBASE_ERR_INVALID;
+        }
+        ubuf = ubuf_pic_view(input_ref->ubuf,
+                upipe_grid_out->loffset, upipe_grid_out->toffset,
+                hsize - upipe_grid_out->loffset - upipe_grid_out->roffset,
+                vsize - upipe_grid_out->toffset - upipe_grid_out->boffset);
+        if (unlikely(!ubuf)) {
+            upipe_err(upipe, "fail to crop ubuf");
+            return UBASE_ERR_INVALID;
+        }
+    } else {
+        ubuf = ubuf_dup(input_ref->ubuf);
+        if (unlikely(!ubuf)) {
+            upipe_err(upipe, "fail to duplicate ubuf");
+            return UBASE_ERR_ALLOC;
+        }
     }
 
     uint64_t ref_pts = 0;
@@ -720,15 +797,17 @@ static int upipe_grid_out_extract_input(struct upipe *upipe,
 
     struct upipe_grid_in *upipe_grid_in =
         upipe_grid_in_from_upipe(upipe_grid_out->input);
-    struct uref *input_flow_def = upipe_grid_in->flow_def;
-    if (unlikely(!input_flow_def))
+    if (unlikely(!upipe_grid_in->flow_def))
         return UBASE_ERR_INVALID;
 
-    if (ubase_check(uref_flow_match_def(input_flow_def, UREF_PIC_FLOW_DEF)))
-        return upipe_grid_out_extract_pic(upipe, uref, urefs);
-    else if (ubase_check(uref_flow_match_def(input_flow_def,
-                                             UREF_SOUND_FLOW_DEF)))
-        return upipe_grid_out_extract_sound(upipe, uref, urefs);
+    switch (upipe_grid_in->type) {
+        case UPIPE_GRID_IN_TYPE_PIC:
+            return upipe_grid_out_extract_pic(upipe, uref, urefs);
+        case UPIPE_GRID_IN_TYPE_SOUND:
+            return upipe_grid_out_extract_sound(upipe, uref, urefs);
+        case UPIPE_GRID_IN_TYPE_NONE:
+            break;
+    }
     return UBASE_ERR_UNHANDLED;
 }
 
@@ -875,6 +954,58 @@ static int upipe_grid_out_get_input_real(struct upipe *upipe,
     return UBASE_ERR_NONE;
 }
 
+/** @internal @This sets the grid output crop offsets.
+ *
+ * @param upipe description structure of the pipe
+ * @param loffset offset from the left border
+ * @param roffset offset from the right border
+ * @param toffset offset from the top border
+ * @param boffset offset from the bottom border
+ * @return an error code
+ */
+static int upipe_grid_out_set_crop_real(struct upipe *upipe,
+                                        uint64_t loffset, uint64_t roffset,
+                                        uint64_t toffset, uint64_t boffset)
+{
+    struct upipe_grid_out *upipe_grid_out =
+        upipe_grid_out_from_upipe(upipe);
+
+    upipe_grid_out->loffset = loffset;
+    upipe_grid_out->roffset = roffset;
+    upipe_grid_out->toffset = toffset;
+    upipe_grid_out->boffset = boffset;
+    upipe_grid_out->flow_def_uptodate = false;
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This gets the grid output crop offsets.
+ *
+ * @param upipe description structure of the pipe
+ * @param loffset_p filled in with the offset from the left border
+ * @param roffset_p filled in with the offset from the right border
+ * @param toffset_p filled in with the offset from the top border
+ * @param boffset_p filled in with the offset from the bottom border
+ * @return an error code
+ */
+static int upipe_grid_out_get_crop_real(struct upipe *upipe,
+                                        uint64_t *loffset_p,
+                                        uint64_t *roffset_p,
+                                        uint64_t *toffset_p,
+                                        uint64_t *boffset_p)
+{
+    struct upipe_grid_out *upipe_grid_out =
+        upipe_grid_out_from_upipe(upipe);
+    if (loffset_p)
+        *loffset_p = upipe_grid_out->loffset;
+    if (roffset_p)
+        *roffset_p = upipe_grid_out->roffset;
+    if (toffset_p)
+        *toffset_p = upipe_grid_out->toffset;
+    if (boffset_p)
+        *boffset_p = upipe_grid_out->boffset;
+    return UBASE_ERR_NONE;
+}
+
 /** @internal @This handles an input changed.
  *
  * @param upipe output pipe description
@@ -929,6 +1060,42 @@ int upipe_grid_out_get_input(struct upipe *upipe, struct upipe **input_p)
                          UPIPE_GRID_OUT_SIGNATURE, input_p);
 }
 
+/** @This exports the crop getter of a grid output pipe.
+ *
+ * @param upipe description structure of the pipe
+ * @param loffset_p filled in with the offset from the left border
+ * @param roffset_p filled in with the offset from the right border
+ * @param toffset_p filled in with the offset from the top border
+ * @param boffset_p filled in with the offset from the bottom border
+ * @return an error code
+ */
+int upipe_grid_out_get_crop(struct upipe *upipe,
+                            uint64_t *loffset_p, uint64_t *roffset_p,
+                            uint64_t *toffset_p, uint64_t *boffset_p)
+{
+    return upipe_control(upipe, UPIPE_GRID_OUT_GET_CROP,
+                         UPIPE_GRID_OUT_SIGNATURE,
+                         loffset_p, roffset_p, toffset_p, boffset_p);
+}
+
+/** @This exports the crop setter of a grid output pipe.
+ *
+ * @param upipe description structure of the pipe
+ * @param loffset offset from the left border
+ * @param roffset offset from the right border
+ * @param toffset offset from the top border
+ * @param boffset offset from the bottom border
+ * @return an error code
+ */
+int upipe_grid_out_set_crop(struct upipe *upipe,
+                            uint64_t loffset, uint64_t roffset,
+                            uint64_t toffset, uint64_t boffset)
+{
+    return upipe_control(upipe, UPIPE_GRID_OUT_SET_CROP,
+                         UPIPE_GRID_OUT_SIGNATURE,
+                         loffset, roffset, toffset, boffset);
+}
+
 /** @internal @This handles control commands of the grid outputs.
  *
  * @param upipe description structure of the pipe
@@ -957,6 +1124,24 @@ static int upipe_grid_out_control(struct upipe *upipe,
             struct upipe **input_p = va_arg(args, struct upipe **);
             return upipe_grid_out_get_input_real(upipe, input_p);
         }
+        case UPIPE_GRID_OUT_SET_CROP: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_GRID_OUT_SIGNATURE);
+            uint64_t loffset = va_arg(args, uint64_t);
+            uint64_t roffset = va_arg(args, uint64_t);
+            uint64_t toffset = va_arg(args, uint64_t);
+            uint64_t boffset = va_arg(args, uint64_t);
+            return upipe_grid_out_set_crop_real(upipe, loffset, roffset,
+                                                toffset, boffset);
+        }
+        case UPIPE_GRID_OUT_GET_CROP: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_GRID_OUT_SIGNATURE);
+            uint64_t *loffset_p = va_arg(args, uint64_t *);
+            uint64_t *roffset_p = va_arg(args, uint64_t *);
+            uint64_t *toffset_p = va_arg(args, uint64_t *);
+            uint64_t *boffset_p = va_arg(args, uint64_t *);
+            return upipe_grid_out_get_crop_real(upipe, loffset_p, roffset_p,
+                                                toffset_p, boffset_p);
+        }
     }
 
     return UBASE_ERR_UNHANDLED;
@@ -986,6 +1171,8 @@ static const char *upipe_grid_out_command_str(int command)
     switch ((enum upipe_grid_out_command)command) {
         UBASE_CASE_TO_STR(UPIPE_GRID_OUT_SET_INPUT);
         UBASE_CASE_TO_STR(UPIPE_GRID_OUT_GET_INPUT);
+        UBASE_CASE_TO_STR(UPIPE_GRID_OUT_GET_CROP);
+        UBASE_CASE_TO_STR(UPIPE_GRID_OUT_SET_CROP);
         case UPIPE_GRID_OUT_SENTINEL: break;
     }
     return NULL;
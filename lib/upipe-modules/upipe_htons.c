@@ -50,7 +50,19 @@
 #include <assert.h>
 #include <arpa/inet.h>
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSSE3__)
+#include <tmmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
 #define EXPECTED_FLOW_DEF "block."
+/** default size of the swapped words */
+#define DEFAULT_WORD_SIZE 2
+/** maximum size of the swapped words */
+#define MAX_WORD_SIZE 4
 
 /** upipe_htons structure */
 struct upipe_htons {
@@ -66,6 +78,9 @@ struct upipe_htons {
     /** list of output requests */
     struct uchain request_list;
 
+    /** size of the swapped words */
+    unsigned int word_size;
+
     /** public upipe structure */
     struct upipe upipe;
 };
@@ -75,6 +90,128 @@ UPIPE_HELPER_UREFCOUNT(upipe_htons, urefcount, upipe_htons_free)
 UPIPE_HELPER_VOID(upipe_htons);
 UPIPE_HELPER_OUTPUT(upipe_htons, output, flow_def, output_state, request_list);
 
+/** @internal @This swaps the octets of whole words in a buffer.
+ *
+ * @param buf pointer to the buffer
+ * @param size size of the buffer, multiple of word_size
+ * @param word_size size of a word in octets
+ */
+static void upipe_htons_swap(uint8_t *buf, size_t size,
+                             unsigned int word_size)
+{
+    size_t i = 0;
+
+    switch (word_size) {
+        case 2:
+#if defined(__AVX2__)
+            for (; i + 32 <= size; i += 32) {
+                __m256i v = _mm256_loadu_si256((__m256i *)(buf + i));
+                v = _mm256_shuffle_epi8(v, _mm256_setr_epi8(
+                    1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14,
+                    1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14));
+                _mm256_storeu_si256((__m256i *)(buf + i), v);
+            }
+#elif defined(__SSSE3__)
+            for (; i + 16 <= size; i += 16) {
+                __m128i v = _mm_loadu_si128((__m128i *)(buf + i));
+                v = _mm_shuffle_epi8(v, _mm_setr_epi8(
+                    1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14));
+                _mm_storeu_si128((__m128i *)(buf + i), v);
+            }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+            for (; i + 16 <= size; i += 16)
+                vst1q_u8(buf + i, vrev16q_u8(vld1q_u8(buf + i)));
+#endif
+            for (; i < size; i += 2) {
+                uint8_t t = buf[i];
+                buf[i] = buf[i + 1];
+                buf[i + 1] = t;
+            }
+            break;
+
+        case 3:
+#if defined(__SSSE3__)
+            /* 4 words per vector, the last 4 octets are stored unchanged */
+            for (; i + 16 <= size; i += 12) {
+                __m128i v = _mm_loadu_si128((__m128i *)(buf + i));
+                v = _mm_shuffle_epi8(v, _mm_setr_epi8(
+                    2, 1, 0, 5, 4, 3, 8, 7, 6, 11, 10, 9, 12, 13, 14, 15));
+                _mm_storeu_si128((__m128i *)(buf + i), v);
+            }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+            for (; i + 48 <= size; i += 48) {
+                uint8x16x3_t v = vld3q_u8(buf + i);
+                uint8x16_t t = v.val[0];
+                v.val[0] = v.val[2];
+                v.val[2] = t;
+                vst3q_u8(buf + i, v);
+            }
+#endif
+            for (; i < size; i += 3) {
+                uint8_t t = buf[i];
+                buf[i] = buf[i + 2];
+                buf[i + 2] = t;
+            }
+            break;
+
+        case 4:
+#if defined(__AVX2__)
+            for (; i + 32 <= size; i += 32) {
+                __m256i v = _mm256_loadu_si256((__m256i *)(buf + i));
+                v = _mm256_shuffle_epi8(v, _mm256_setr_epi8(
+                    3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+                    3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12));
+                _mm256_storeu_si256((__m256i *)(buf + i), v);
+            }
+#elif defined(__SSSE3__)
+            for (; i + 16 <= size; i += 16) {
+                __m128i v = _mm_loadu_si128((__m128i *)(buf + i));
+                v = _mm_shuffle_epi8(v, _mm_setr_epi8(
+                    3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12));
+                _mm_storeu_si128((__m128i *)(buf + i), v);
+            }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+            for (; i + 16 <= size; i += 16)
+                vst1q_u8(buf + i, vrev32q_u8(vld1q_u8(buf + i)));
+#endif
+            for (; i < size; i += 4) {
+                uint8_t t = buf[i];
+                buf[i] = buf[i + 3];
+                buf[i + 3] = t;
+                t = buf[i + 1];
+                buf[i + 1] = buf[i + 2];
+                buf[i + 2] = t;
+            }
+            break;
+    }
+}
+
+/** @internal @This swaps the octets of a word spanning several segments.
+ *
+ * @param uref uref structure
+ * @param offset offset of the word in the block
+ * @param word_size size of a word in octets
+ * @return an error code
+ */
+static int upipe_htons_swap_split(struct uref *uref, int offset,
+                                  unsigned int word_size)
+{
+    uint8_t word[MAX_WORD_SIZE];
+    UBASE_RETURN(uref_block_extract(uref, offset, word_size, word))
+
+    int pos = 0;
+    while (pos < word_size) {
+        int bufsize = word_size - pos;
+        uint8_t *buf;
+        UBASE_RETURN(uref_block_write(uref, offset + pos, &bufsize, &buf))
+        for (int i = 0; i < bufsize; i++)
+            buf[i] = word[word_size - 1 - pos - i];
+        uref_block_unmap(uref, offset + pos);
+        pos += bufsize;
+    }
+    return UBASE_ERR_NONE;
+}
+
 /** @internal @This handles input.
  *
  * @param upipe description structure of the pipe
@@ -84,10 +221,14 @@ UPIPE_HELPER_OUTPUT(upipe_htons, output, flow_def, output_state, request_list);
 static void upipe_htons_input(struct upipe *upipe, struct uref *uref,
                               struct upump **upump_p)
 {
+    struct upipe_htons *upipe_htons = upipe_htons_from_upipe(upipe);
+    unsigned int word_size = upipe_htons->word_size;
     struct ubuf *ubuf;
     size_t size = 0;
     int bufsize = -1, offset = 0;
     uint8_t *buf = NULL;
+    /* offset of a word split across segments, and its missing octets */
+    int split = -1, missing = 0;
 
 #ifdef UPIPE_WORDS_BIGENDIAN
     upipe_htons_output(upipe, uref, upump_p);
@@ -100,10 +241,9 @@ static void upipe_htons_input(struct upipe *upipe, struct uref *uref,
         uref_free(uref);
         return;
     }
-    /* copy ubuf if shared or not 16b-unaligned or segmented */
+    /* copy ubuf if shared */
     bufsize = -1;
-    if (!ubase_check(uref_block_write(uref, 0, &bufsize, &buf)) ||
-        ((uintptr_t)buf & 1) || bufsize != size) {
+    if (!ubase_check(uref_block_write(uref, 0, &bufsize, &buf))) {
         ubuf = ubuf_block_copy(uref->ubuf->mgr, uref->ubuf, 0, size);
         if (unlikely(!ubuf)) {
             upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
@@ -116,7 +256,7 @@ static void upipe_htons_input(struct upipe *upipe, struct uref *uref,
     }
 
     /* process ubuf chunks */
-    while (size > 0) {
+    while (offset < size) {
         bufsize = -1;
         if (unlikely(!ubase_check(uref_block_write(uref, offset, &bufsize,
                                   &buf)))) {
@@ -125,15 +265,30 @@ static void upipe_htons_input(struct upipe *upipe, struct uref *uref,
             return;
         }
 
-        for (int i = 0; i < bufsize - 1; i += 2) {
-            uint8_t t = buf[i];
-            buf[i] = buf[i + 1];
-            buf[i + 1] = t;
+        /* the first octets may end a word started in previous segments */
+        int skip = 0;
+        if (split != -1) {
+            skip = missing < bufsize ? missing : bufsize;
+            missing -= skip;
         }
-
+        int whole = (bufsize - skip) / word_size * word_size;
+        upipe_htons_swap(buf + skip, whole, word_size);
         uref_block_unmap(uref, offset);
+
+        if (split != -1 && !missing) {
+            if (unlikely(!ubase_check(upipe_htons_swap_split(uref, split,
+                                                             word_size)))) {
+                upipe_warn(upipe, "unexpected buffer error");
+                uref_free(uref);
+                return;
+            }
+            split = -1;
+        }
+        if (skip + whole < bufsize) {
+            split = offset + skip + whole;
+            missing = word_size - (bufsize - skip - whole);
+        }
         offset += bufsize;
-        size -= bufsize;
     }
 
     upipe_htons_output(upipe, uref, upump_p);
@@ -172,6 +327,20 @@ static int upipe_htons_control(struct upipe *upipe, int command, va_list args)
             struct uref *flow_def = va_arg(args, struct uref *);
             return upipe_htons_set_flow_def(upipe, flow_def);
         }
+        case UPIPE_HTONS_SET_WORD_SIZE: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_HTONS_SIGNATURE)
+            unsigned int word_size = va_arg(args, unsigned int);
+            if (word_size < 2 || word_size > MAX_WORD_SIZE)
+                return UBASE_ERR_INVALID;
+            upipe_htons_from_upipe(upipe)->word_size = word_size;
+            return UBASE_ERR_NONE;
+        }
+        case UPIPE_HTONS_GET_WORD_SIZE: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_HTONS_SIGNATURE)
+            unsigned int *word_size_p = va_arg(args, unsigned int *);
+            *word_size_p = upipe_htons_from_upipe(upipe)->word_size;
+            return UBASE_ERR_NONE;
+        }
 
         default:
             return UBASE_ERR_UNHANDLED;
@@ -196,6 +365,7 @@ static struct upipe *upipe_htons_alloc(struct upipe_mgr *mgr,
 
     upipe_htons_init_urefcount(upipe);
     upipe_htons_init_output(upipe);
+    upipe_htons_from_upipe(upipe)->word_size = DEFAULT_WORD_SIZE;
 
     upipe_throw_ready(upipe);
     return upipe;
@@ -221,6 +391,7 @@ static struct upipe_mgr upipe_htons_mgr = {
     .upipe_alloc = upipe_htons_alloc,
     .upipe_input = upipe_htons_input,
     .upipe_control = upipe_htons_control,
+    .upipe_command_str = upipe_htons_command_str,
 
     .upipe_mgr_control = NULL
 };
@@ -76,6 +76,10 @@
 #define MAX_URL_SIZE            2048
 #define HTTP_VERSION            "HTTP/1.1"
 #define USER_AGENT              "upipe_http_src"
+/** default maximum number of idle connections kept by the manager */
+#define KEEP_ALIVE_DEFAULT      8
+/** default minimum size of a range fetched in parallel */
+#define PART_SIZE_DEFAULT       (1024 * 1024)
 
 struct http_range {
     uint64_t offset;
@@ -93,9 +97,59 @@ struct upipe_http_src_cookie {
 
 UBASE_FROM_TO(upipe_http_src_cookie, uchain, uchain, uchain)
 
+/** @This is an idle connection kept by the manager. */
+struct upipe_http_src_conn {
+    /** structure for double-linked lists */
+    struct uchain uchain;
+    /** host and port of the server */
+    char *key;
+    /** socket descriptor */
+    int fd;
+};
+
+UBASE_FROM_TO(upipe_http_src_conn, uchain, uchain, uchain)
+
+/** @hidden */
+static int upipe_http_src_mgr_take_conn(struct upipe_mgr *mgr,
+                                        const char *key);
+/** @hidden */
+static void upipe_http_src_mgr_release_conn(struct upipe_mgr *mgr,
+                                            const char *key, int fd);
+
 /** @hidden */
 static int upipe_http_src_check(struct upipe *upipe, struct uref *flow_format);
 
+/** @This is an additional connection fetching a byte range of the resource
+ * in parallel with the main connection. */
+struct upipe_http_src_part {
+    /** structure for double-linked lists */
+    struct uchain uchain;
+    /** pointer to the http source pipe */
+    struct upipe *upipe;
+    /** requested range */
+    struct http_range range;
+    /** socket descriptor */
+    int fd;
+    /** the connection was taken from the manager pool */
+    bool reused;
+    /** a response was started on the connection */
+    bool received;
+    /** the response is complete */
+    bool complete;
+    /** the range could not be fetched */
+    bool failed;
+    /** read watcher */
+    struct upump *upump;
+    /** write watcher */
+    struct upump *upump_write;
+    /** http parser */
+    http_parser parser;
+    /** list of received urefs waiting for the previous ranges */
+    struct uchain urefs;
+};
+
+UBASE_FROM_TO(upipe_http_src_part, uchain, uchain, uchain)
+
 struct header {
     const char *value;
     size_t len;
@@ -146,6 +200,12 @@ struct upipe_http_src {
 
     /** socket descriptor */
     int fd;
+    /** host and port of the connection, for the manager pool */
+    char *conn_key;
+    /** the connection was taken from the manager pool */
+    bool reused;
+    /** a response was started on the connection */
+    bool received;
     /** a request is pending */
     bool request_pending;
     /** http url */
@@ -162,11 +222,26 @@ struct upipe_http_src {
     struct http_range range;
     uint64_t position;
 
+    /** maximum number of parallel connections */
+    unsigned int parallel;
+    /** minimum size of a range fetched in parallel */
+    uint64_t part_size;
+    /** range requested on the main connection */
+    struct http_range req_range;
+    /** total size of the resource, from the Content-Range header */
+    uint64_t total_size;
+    /** the main connection is complete and waits for the parallel ranges */
+    bool main_done;
+    /** list of ranges fetched in parallel, in order */
+    struct uchain parts;
+
     /** http parser*/
     http_parser parser;
 
     /** http parser settings */
     http_parser_settings parser_settings;
+    /** http parser settings for the parallel ranges */
+    http_parser_settings part_settings;
 
     /** public upipe structure */
     struct upipe upipe;
@@ -205,6 +280,15 @@ static int upipe_http_src_body_cb(http_parser *parser,
                                   size_t len);
 static int upipe_http_src_message_complete(http_parser *parser);
 static int upipe_http_src_status_cb(http_parser *parser);
+static int upipe_http_src_headers_complete(http_parser *parser);
+static int upipe_http_src_part_status_cb(http_parser *parser);
+static int upipe_http_src_part_body_cb(http_parser *parser,
+                                       const char *at,
+                                       size_t len);
+static int upipe_http_src_part_message_complete(http_parser *parser);
+static int upipe_http_src_connect(struct upipe *upipe);
+static void upipe_http_src_split(struct upipe *upipe);
+static void upipe_http_src_flush_parts(struct upipe *upipe);
 
 /** @internal @This allocates a http source pipe.
  *
@@ -232,10 +316,19 @@ static struct upipe *upipe_http_src_alloc(struct upipe_mgr *mgr,
 
     struct upipe_http_src *upipe_http_src = upipe_http_src_from_upipe(upipe);
     upipe_http_src->fd = -1;
+    upipe_http_src->conn_key = NULL;
+    upipe_http_src->reused = false;
+    upipe_http_src->received = false;
     upipe_http_src->request_pending = false;
     upipe_http_src->url = NULL;
     upipe_http_src->range = HTTP_RANGE(0, -1);
     upipe_http_src->position = 0;
+    upipe_http_src->parallel = 1;
+    upipe_http_src->part_size = PART_SIZE_DEFAULT;
+    upipe_http_src->req_range = HTTP_RANGE(0, -1);
+    upipe_http_src->total_size = UINT64_MAX;
+    upipe_http_src->main_done = false;
+    ulist_init(&upipe_http_src->parts);
     upipe_http_src->location = NULL;
     upipe_http_src->header_field = HEADER(NULL, 0);
     upipe_http_src->proxy = NULL;
@@ -246,11 +339,21 @@ static struct upipe *upipe_http_src_alloc(struct upipe_mgr *mgr,
     settings->on_url = NULL;
     settings->on_header_field = upipe_http_src_header_field;
     settings->on_header_value = upipe_http_src_header_value;
-    settings->on_headers_complete = NULL;
+    settings->on_headers_complete = upipe_http_src_headers_complete;
     settings->on_body = upipe_http_src_body_cb;
     settings->on_message_complete = upipe_http_src_message_complete;
     settings->on_status_complete = upipe_http_src_status_cb;
 
+    settings = &upipe_http_src->part_settings;
+    settings->on_message_begin = NULL;
+    settings->on_url = NULL;
+    settings->on_header_field = NULL;
+    settings->on_header_value = NULL;
+    settings->on_headers_complete = NULL;
+    settings->on_body = upipe_http_src_part_body_cb;
+    settings->on_message_complete = upipe_http_src_part_message_complete;
+    settings->on_status_complete = upipe_http_src_part_status_cb;
+
     upipe_throw_ready(upipe);
 
     const char *proxy;
@@ -265,6 +368,23 @@ static struct upipe *upipe_http_src_alloc(struct upipe_mgr *mgr,
     return upipe;
 }
 
+/** @internal @This frees a range fetched in parallel.
+ *
+ * @param part range description
+ */
+static void upipe_http_src_part_free(struct upipe_http_src_part *part)
+{
+    struct uchain *uchain;
+    while ((uchain = ulist_pop(&part->urefs)) != NULL)
+        uref_free(uref_from_uchain(uchain));
+    if (part->upump != NULL)
+        upump_free(part->upump);
+    if (part->upump_write != NULL)
+        upump_free(part->upump_write);
+    ubase_clean_fd(&part->fd);
+    free(part);
+}
+
 /** @This closes a connection.
  *
  * @param upipe description structure of the pipe
@@ -276,7 +396,14 @@ static void upipe_http_src_close(struct upipe *upipe)
 
     if (likely(upipe_http_src->url != NULL))
         upipe_notice_va(upipe, "closing %s", upipe_http_src->url);
+    struct uchain *uchain, *uchain_tmp;
+    ulist_delete_foreach(&upipe_http_src->parts, uchain, uchain_tmp) {
+        ulist_delete(uchain);
+        upipe_http_src_part_free(upipe_http_src_part_from_uchain(uchain));
+    }
+    upipe_http_src->main_done = false;
     ubase_clean_fd(&upipe_http_src->fd);
+    ubase_clean_str(&upipe_http_src->conn_key);
     ubase_clean_str(&upipe_http_src->url);
     upipe_http_src_set_upump(upipe, NULL);
     upipe_http_src->request_pending = false;
@@ -298,6 +425,7 @@ static void upipe_http_src_free(struct upipe *upipe)
     upipe_throw_dead(upipe);
 
     free(upipe_http_src->proxy);
+    free(upipe_http_src->conn_key);
     free(upipe_http_src->url);
     free(upipe_http_src->location);
     upipe_http_src_clean_output_size(upipe);
@@ -368,6 +496,32 @@ static int upipe_http_src_header_value(http_parser *parser,
         snprintf(content_type, len + 1, "%s", at);
         uref_http_set_content_type(flow_def, content_type);
     }
+    else if (!strncasecmp("Content-Range", field.value, field.len)) {
+        /* bytes first-last/total */
+        char content_range[len + 1];
+        memcpy(content_range, at, len);
+        content_range[len] = '\0';
+        const char *total = strchr(content_range, '/');
+        if (total != NULL && total[1] >= '0' && total[1] <= '9')
+            upipe_http_src->total_size = strtoull(total + 1, NULL, 10);
+    }
+    return 0;
+}
+
+/** @internal @This is called by http_parser when the headers of the
+ * response are parsed, and starts the parallel ranges if the server
+ * accepted the range request.
+ *
+ * @param parser http parser structure
+ * @return 0
+ */
+static int upipe_http_src_headers_complete(http_parser *parser)
+{
+    struct upipe_http_src *upipe_http_src = upipe_http_src_from_parser(parser);
+    struct upipe *upipe = upipe_http_src_to_upipe(upipe_http_src);
+
+    if (parser->status_code == 206 && upipe_http_src->parallel > 1)
+        upipe_http_src_split(upipe);
     return 0;
 }
 
@@ -393,8 +547,15 @@ static int upipe_http_src_status_cb(http_parser *parser)
     return 0;
 }
 
-static int upipe_http_src_output_data(struct upipe *upipe,
-                                      const char *at, size_t len)
+/** @internal @This allocates a block containing received data.
+ *
+ * @param upipe description structure of the pipe
+ * @param at data buffer, or NULL for the end of the stream
+ * @param len data length
+ * @return pointer to uref or NULL in case of allocation error
+ */
+static struct uref *upipe_http_src_alloc_data(struct upipe *upipe,
+                                              const char *at, size_t len)
 {
     struct upipe_http_src *upipe_http_src = upipe_http_src_from_upipe(upipe);
     struct uref *uref;
@@ -415,7 +576,7 @@ static int upipe_http_src_output_data(struct upipe *upipe,
                             upipe_http_src->ubuf_mgr, len);
     if (unlikely(!uref)) {
         upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
-        return 0;
+        return NULL;
     }
     size = -1;
     uref_block_write(uref, 0, &size, &buf);
@@ -428,6 +589,17 @@ static int upipe_http_src_output_data(struct upipe *upipe,
         uref_clock_set_cr_sys(uref, systime);
     if (len == 0)
         uref_block_set_end(uref);
+    return uref;
+}
+
+static int upipe_http_src_output_data(struct upipe *upipe,
+                                      const char *at, size_t len)
+{
+    struct upipe_http_src *upipe_http_src = upipe_http_src_from_upipe(upipe);
+    struct uref *uref = upipe_http_src_alloc_data(upipe, at, len);
+    if (unlikely(uref == NULL))
+        return 0;
+
     upipe_http_src->position += len;
     upipe_http_src_output(upipe, uref, &upipe_http_src->upump);
 
@@ -451,6 +623,25 @@ static int upipe_http_src_message_complete(http_parser *parser)
 
     upipe_dbg_va(upipe, "message complete %i", status_code);
 
+    if ((status_code == 200 || status_code == 206) &&
+        !ulist_empty(&upipe_http_src->parts)) {
+        /* the end of the stream is output after the parallel ranges */
+        if (http_should_keep_alive(parser) && upipe_http_src->fd != -1 &&
+            upipe_http_src->conn_key != NULL) {
+            upipe_http_src_mgr_release_conn(upipe->mgr,
+                                            upipe_http_src->conn_key,
+                                            upipe_http_src->fd);
+            upipe_http_src->fd = -1;
+        }
+        ubase_clean_fd(&upipe_http_src->fd);
+        upipe_http_src_set_upump(upipe, NULL);
+        upipe_http_src_set_upump_write(upipe, NULL);
+        upipe_http_src->main_done = true;
+        free(location);
+        upipe_http_src_flush_parts(upipe);
+        return 0;
+    }
+
     switch (status_code) {
     /* success */
     case 200:
@@ -459,6 +650,13 @@ static int upipe_http_src_message_complete(http_parser *parser)
         upipe_http_src_output_data(upipe, NULL, 0);
         break;
     }
+    if (http_should_keep_alive(parser) && upipe_http_src->fd != -1 &&
+        upipe_http_src->conn_key != NULL) {
+        /* give the connection back to the manager for the next request */
+        upipe_http_src_mgr_release_conn(upipe->mgr, upipe_http_src->conn_key,
+                                        upipe_http_src->fd);
+        upipe_http_src->fd = -1;
+    }
     upipe_http_src_close(upipe);
     upipe_throw_source_end(upipe);
 
@@ -587,6 +785,22 @@ static void upipe_http_src_worker(struct upump *upump)
         upipe_http_src_set_upump(upipe, NULL);
         upipe_throw_source_end(upipe);
     }
+    else if (unlikely(len == 0 && upipe_http_src->reused &&
+                      !upipe_http_src->received)) {
+        /* the server closed the idle connection before our request */
+        upipe_dbg(upipe, "persistent connection closed, reconnecting");
+        uref_free(uref);
+        upipe_http_src_set_upump(upipe, NULL);
+        upipe_http_src_set_upump_write(upipe, NULL);
+        ubase_clean_fd(&upipe_http_src->fd);
+        if (!ubase_check(upipe_http_src_connect(upipe))) {
+            upipe_http_src_output_data(upipe, NULL, 0);
+            upipe_throw_source_end(upipe);
+            return;
+        }
+        upipe_http_src->request_pending = true;
+        upipe_http_src_check(upipe, NULL);
+    }
     else if (unlikely(len == 0)) {
         upipe_dbg(upipe, "connection closed");
         uref_free(uref);
@@ -597,6 +811,7 @@ static void upipe_http_src_worker(struct upump *upump)
     else {
         if (unlikely(len != upipe_http_src->output_size))
             uref_block_resize(uref, 0, len);
+        upipe_http_src->received = true;
         upipe_http_src_process(upipe, uref);
     }
 }
@@ -623,12 +838,16 @@ static int request_add(char **req_p, size_t *len, const char *fmt, ...)
     return 0;
 }
 
-/** @internal @This builds and sends a GET request
+/** @internal @This builds and sends a GET request for a range of the
+ * resource.
  *
  * @param upipe description structure of the pipe
+ * @param fd socket descriptor
+ * @param range byte range to request
  * @return an error code
  */
-static int upipe_http_src_send_request(struct upipe *upipe)
+static int upipe_http_src_send_range(struct upipe *upipe, int fd,
+                                     struct http_range range)
 {
     struct upipe_http_src *upipe_http_src = upipe_http_src_from_upipe(upipe);
     struct uref *flow_def = upipe_http_src->flow_def;
@@ -675,27 +894,22 @@ static int upipe_http_src_send_request(struct upipe *upipe)
         request_add(&req, &req_len, "Host: %s\r\n", host);
     }
 
+    /* Connection */
+    if (upipe_http_src->conn_key != NULL)
+        request_add(&req, &req_len, "Connection: keep-alive\r\n");
+    else
+        request_add(&req, &req_len, "Connection: close\r\n");
+
     /* Range */
-    upipe_http_src->position = 0;
-    if (upipe_http_src->range.offset ||
-        upipe_http_src->range.length != (uint64_t)-1) {
-
-        if (upipe_http_src->range.offset) {
-            upipe_verbose_va(upipe, "range offset: %"PRIu64,
-                             upipe_http_src->range.offset);
-            request_add(&req, &req_len, "Range: bytes=%"PRIu64"-",
-                        upipe_http_src->range.offset);
-            upipe_http_src->position = upipe_http_src->range.offset;
-        }
-        else
-            request_add(&req, &req_len, "Range: bytes=0-");
+    if (range.offset || (range.length && range.length != (uint64_t)-1)) {
+        upipe_verbose_va(upipe, "range offset: %"PRIu64, range.offset);
+        request_add(&req, &req_len, "Range: bytes=%"PRIu64"-", range.offset);
 
-        if (upipe_http_src->range.length != (uint64_t)-1) {
-            upipe_verbose_va(upipe, "range length: %"PRIu64,
-                             upipe_http_src->range.length);
+        /* the last byte position is inclusive */
+        if (range.length && range.length != (uint64_t)-1) {
+            upipe_verbose_va(upipe, "range length: %"PRIu64, range.length);
             request_add(&req, &req_len, "%"PRIu64,
-                        upipe_http_src->range.offset +
-                        upipe_http_src->range.length);
+                        range.offset + range.length - 1);
         }
 
         request_add(&req, &req_len, "\r\n");
@@ -734,8 +948,7 @@ static int upipe_http_src_send_request(struct upipe *upipe)
         return UBASE_ERR_ALLOC;
     }
 
-    ret = send(upipe_http_src->fd, req_buffer,
-               sizeof (req_buffer) - req_len, 0);
+    ret = send(fd, req_buffer, sizeof (req_buffer) - req_len, 0);
     if (ret < 0) {
         switch(errno) {
             case EINTR:
@@ -758,6 +971,51 @@ static int upipe_http_src_send_request(struct upipe *upipe)
     return UBASE_ERR_NONE;
 }
 
+/** @internal @This returns the size of the ranges to fetch in parallel.
+ *
+ * @param upipe description structure of the pipe
+ * @param length total length to split
+ * @param max maximum number of ranges
+ * @return the size of each range
+ */
+static uint64_t upipe_http_src_part_length(struct upipe *upipe,
+                                           uint64_t length, unsigned int max)
+{
+    struct upipe_http_src *upipe_http_src = upipe_http_src_from_upipe(upipe);
+    uint64_t nb = length / upipe_http_src->part_size;
+    if (nb > max)
+        nb = max;
+    if (nb <= 1)
+        return length;
+    return (length + nb - 1) / nb;
+}
+
+/** @internal @This builds and sends the GET request of the main
+ * connection. In parallel mode, only the first range is requested, and the
+ * others are requested when the server accepts it.
+ *
+ * @param upipe description structure of the pipe
+ * @return an error code
+ */
+static int upipe_http_src_send_request(struct upipe *upipe)
+{
+    struct upipe_http_src *upipe_http_src = upipe_http_src_from_upipe(upipe);
+    struct http_range range = upipe_http_src->range;
+
+    if (upipe_http_src->parallel > 1) {
+        if (range.length && range.length != (uint64_t)-1)
+            range.length = upipe_http_src_part_length(upipe, range.length,
+                    upipe_http_src->parallel);
+        else
+            range.length = upipe_http_src->part_size;
+    }
+
+    upipe_http_src->req_range = range;
+    upipe_http_src->total_size = UINT64_MAX;
+    upipe_http_src->position = range.offset;
+    return upipe_http_src_send_range(upipe, upipe_http_src->fd, range);
+}
+
 static void upipe_http_src_worker_write(struct upump *upump)
 {
     struct upipe *upipe = upump_get_opaque(upump, struct upipe *);
@@ -863,13 +1121,14 @@ static int upipe_http_src_get_uri(struct upipe *upipe, const char **url_p)
     return UBASE_ERR_NONE;
 }
 
-/** @internal @This asks to open the given http (real code here).
+/** @internal @This opens a socket to the server of the current url, or to
+ * the proxy.
  *
  * @param upipe description structure of the pipe
- * @param url relative or absolute url of the http
+ * @param fd_p filled in with the socket descriptor
  * @return an error code
  */
-static int upipe_http_src_open_url(struct upipe *upipe)
+static int upipe_http_src_open_socket(struct upipe *upipe, int *fd_p)
 {
     struct upipe_http_src *upipe_http_src = upipe_http_src_from_upipe(upipe);
     struct uref *flow_def = upipe_http_src->flow_def;
@@ -877,12 +1136,6 @@ static int upipe_http_src_open_url(struct upipe *upipe)
     struct addrinfo hints;
     int ret, fd = -1;
 
-    if (unlikely(flow_def == NULL))
-        return UBASE_ERR_INVALID;
-
-    /* init parser */
-    http_parser_init(&upipe_http_src->parser, HTTP_RESPONSE);
-
     /* get socket information */
     memset(&hints, 0, sizeof(struct addrinfo));
     hints.ai_family = PF_UNSPEC;
@@ -941,10 +1194,452 @@ static int upipe_http_src_open_url(struct upipe *upipe)
         return UBASE_ERR_EXTERNAL;
     }
 
-    upipe_http_src->fd = fd;
+    *fd_p = fd;
     return UBASE_ERR_NONE;
 }
 
+/** @internal @This connects to the server of the current url, or to the
+ * proxy.
+ *
+ * @param upipe description structure of the pipe
+ * @return an error code
+ */
+static int upipe_http_src_connect(struct upipe *upipe)
+{
+    struct upipe_http_src *upipe_http_src = upipe_http_src_from_upipe(upipe);
+
+    UBASE_RETURN(upipe_http_src_open_socket(upipe, &upipe_http_src->fd));
+    upipe_http_src->reused = false;
+    upipe_http_src->received = false;
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This asks to open the given http (real code here).
+ *
+ * @param upipe description structure of the pipe
+ * @param url relative or absolute url of the http
+ * @return an error code
+ */
+static int upipe_http_src_open_url(struct upipe *upipe)
+{
+    struct upipe_http_src *upipe_http_src = upipe_http_src_from_upipe(upipe);
+    struct uref *flow_def = upipe_http_src->flow_def;
+
+    if (unlikely(flow_def == NULL))
+        return UBASE_ERR_INVALID;
+
+    /* init parser */
+    http_parser_init(&upipe_http_src->parser, HTTP_RESPONSE);
+
+    /* look for an idle connection to the same server */
+    ubase_clean_str(&upipe_http_src->conn_key);
+    const char *host = NULL, *service = NULL;
+    if (upipe_http_src->proxy)
+        host = upipe_http_src->proxy;
+    else if (!ubase_check(uref_uri_get_host(flow_def, &host)))
+        host = NULL;
+    else if (!ubase_check(uref_uri_get_port(flow_def, &service)) &&
+             !ubase_check(uref_uri_get_scheme(flow_def, &service)))
+        service = NULL;
+
+    if (host != NULL && (upipe_http_src->conn_key =
+            malloc(strlen(host) + (service ? strlen(service) : 0) + 2))) {
+        sprintf(upipe_http_src->conn_key, "%s:%s", host,
+                service ? service : "");
+
+        int fd = upipe_http_src_mgr_take_conn(upipe->mgr,
+                                              upipe_http_src->conn_key);
+        if (fd != -1) {
+            upipe_dbg_va(upipe, "reusing connection to %s",
+                         upipe_http_src->conn_key);
+            upipe_http_src->fd = fd;
+            upipe_http_src->reused = true;
+            upipe_http_src->received = false;
+            return UBASE_ERR_NONE;
+        }
+    }
+
+    return upipe_http_src_connect(upipe);
+}
+
+/** @internal @This retrieves the range description from its parser.
+ *
+ * @param parser http parser structure
+ * @return pointer to the range description
+ */
+static inline struct upipe_http_src_part *
+    upipe_http_src_part_from_parser(http_parser *parser)
+{
+    return container_of(parser, struct upipe_http_src_part, parser);
+}
+
+/** @internal @This outputs the end of the stream and closes the pipe, once
+ * all ranges are received.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_http_src_finish(struct upipe *upipe)
+{
+    upipe_http_src_output_data(upipe, NULL, 0);
+    upipe_http_src_close(upipe);
+    upipe_throw_source_end(upipe);
+}
+
+/** @internal @This outputs the data of the parallel ranges which are next in
+ * the stream, and frees the complete ranges.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_http_src_flush_parts(struct upipe *upipe)
+{
+    struct upipe_http_src *upipe_http_src = upipe_http_src_from_upipe(upipe);
+    struct uchain *uchain;
+
+    while (upipe_http_src->main_done &&
+           (uchain = ulist_peek(&upipe_http_src->parts)) != NULL) {
+        struct upipe_http_src_part *part =
+            upipe_http_src_part_from_uchain(uchain);
+        struct uchain *uchain_uref;
+
+        while ((uchain_uref = ulist_pop(&part->urefs)) != NULL) {
+            struct uref *uref = uref_from_uchain(uchain_uref);
+            size_t size = 0;
+            uref_block_size(uref, &size);
+            upipe_http_src->position += size;
+            upipe_http_src_output(upipe, uref, &upipe_http_src->upump);
+
+            /* the pipe may have been closed by the output */
+            if (!upipe_http_src->main_done ||
+                ulist_peek(&upipe_http_src->parts) != uchain)
+                return;
+        }
+
+        if (part->failed) {
+            upipe_warn_va(upipe, "range %"PRIu64" is truncated",
+                          part->range.offset);
+            upipe_http_src_finish(upipe);
+            return;
+        }
+        if (!part->complete)
+            return;
+
+        ulist_delete(uchain);
+        upipe_http_src_part_free(part);
+    }
+
+    if (upipe_http_src->main_done)
+        upipe_http_src_finish(upipe);
+}
+
+/** @internal @This stops the fetch of a range after an error. The data
+ * received so far is kept, and the stream ends after it.
+ *
+ * @param part range description
+ */
+static void upipe_http_src_part_fail(struct upipe_http_src_part *part)
+{
+    if (part->upump != NULL)
+        upump_stop(part->upump);
+    if (part->upump_write != NULL)
+        upump_stop(part->upump_write);
+    ubase_clean_fd(&part->fd);
+    part->failed = true;
+    part->complete = true;
+}
+
+/** @internal @This checks the status code of the response to a range
+ * request.
+ *
+ * @param parser http parser structure
+ * @return 0 if the server returned the range
+ */
+static int upipe_http_src_part_status_cb(http_parser *parser)
+{
+    struct upipe_http_src_part *part = upipe_http_src_part_from_parser(parser);
+    struct upipe *upipe = part->upipe;
+
+    if (parser->status_code != 206) {
+        upipe_err_va(upipe, "range %"PRIu64" reply http code %i",
+                     part->range.offset, parser->status_code);
+        return -1;
+    }
+    return 0;
+}
+
+/** @internal @This is called by http_parser when receiving fragments of
+ * body of a range.
+ *
+ * @param parser http parser structure
+ * @param at data buffer
+ * @param len data length
+ * @return 0
+ */
+static int upipe_http_src_part_body_cb(http_parser *parser,
+                                       const char *at, size_t len)
+{
+    struct upipe_http_src_part *part = upipe_http_src_part_from_parser(parser);
+    struct upipe *upipe = part->upipe;
+
+    upipe_verbose_va(upipe, "received %zu bytes of range %"PRIu64,
+                     len, part->range.offset);
+
+    /* the data is output by upipe_http_src_flush_parts in order */
+    struct uref *uref = upipe_http_src_alloc_data(upipe, at, len);
+    if (unlikely(uref == NULL))
+        return -1;
+    ulist_add(&part->urefs, uref_to_uchain(uref));
+    return 0;
+}
+
+/** @internal @This is called by http_parser when the response to a range
+ * request is completed.
+ *
+ * @param parser http parser structure
+ * @return 0
+ */
+static int upipe_http_src_part_message_complete(http_parser *parser)
+{
+    struct upipe_http_src_part *part = upipe_http_src_part_from_parser(parser);
+    struct upipe *upipe = part->upipe;
+    struct upipe_http_src *upipe_http_src = upipe_http_src_from_upipe(upipe);
+
+    upipe_dbg_va(upipe, "range %"PRIu64" complete", part->range.offset);
+
+    if (part->upump != NULL)
+        upump_stop(part->upump);
+    if (http_should_keep_alive(parser) && part->fd != -1 &&
+        upipe_http_src->conn_key != NULL) {
+        upipe_http_src_mgr_release_conn(upipe->mgr, upipe_http_src->conn_key,
+                                        part->fd);
+        part->fd = -1;
+    }
+    ubase_clean_fd(&part->fd);
+    part->complete = true;
+    return 0;
+}
+
+/** @hidden */
+static int upipe_http_src_part_check(struct upipe_http_src_part *part);
+
+/** @internal @This reads the response to a range request.
+ *
+ * @param upump description structure of the read watcher
+ */
+static void upipe_http_src_part_worker(struct upump *upump)
+{
+    struct upipe_http_src_part *part =
+        upump_get_opaque(upump, struct upipe_http_src_part *);
+    struct upipe *upipe = part->upipe;
+    struct upipe_http_src *upipe_http_src = upipe_http_src_from_upipe(upipe);
+
+    struct uref *uref = uref_block_alloc(upipe_http_src->uref_mgr,
+                                         upipe_http_src->ubuf_mgr,
+                                         upipe_http_src->output_size);
+    if (unlikely(uref == NULL)) {
+        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+        return;
+    }
+
+    uint8_t *buffer;
+    int output_size = -1;
+    if (unlikely(!ubase_check(uref_block_write(
+                    uref, 0, &output_size, &buffer)))) {
+        uref_free(uref);
+        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+        return;
+    }
+
+    ssize_t len = recv(part->fd, buffer, output_size, 0);
+    if (unlikely(len <= 0))
+        uref_block_unmap(uref, 0);
+    if (unlikely(len == -1)) {
+        uref_free(uref);
+        switch (errno) {
+            case EINTR:
+            case EAGAIN:
+#if EAGAIN != EWOULDBLOCK
+            case EWOULDBLOCK:
+#endif
+                /* not an issue, try again later */
+                return;
+
+            default:
+                break;
+        }
+        upipe_err_va(upipe, "read error on range %"PRIu64" (%s)",
+                     part->range.offset, strerror(errno));
+        upipe_http_src_part_fail(part);
+    }
+    else if (unlikely(len == 0 && part->reused && !part->received)) {
+        /* the server closed the idle connection before our request */
+        upipe_dbg(upipe, "persistent connection closed, reconnecting");
+        uref_free(uref);
+        upump_free(part->upump);
+        part->upump = NULL;
+        if (part->upump_write != NULL)
+            upump_free(part->upump_write);
+        part->upump_write = NULL;
+        ubase_clean_fd(&part->fd);
+        part->reused = false;
+        if (!ubase_check(upipe_http_src_open_socket(upipe, &part->fd)) ||
+            !ubase_check(upipe_http_src_part_check(part)))
+            upipe_http_src_part_fail(part);
+        return;
+    }
+    else if (unlikely(len == 0)) {
+        upipe_err_va(upipe, "connection closed on range %"PRIu64,
+                     part->range.offset);
+        uref_free(uref);
+        upipe_http_src_part_fail(part);
+    }
+    else {
+        part->received = true;
+        size_t parsed_len = http_parser_execute(&part->parser,
+                &upipe_http_src->part_settings, (const char *)buffer, len);
+        uref_block_unmap(uref, 0);
+        uref_free(uref);
+        if (parsed_len != len && !part->complete) {
+            upipe_err_va(upipe, "http request execution failed on range %"
+                         PRIu64, part->range.offset);
+            upipe_http_src_part_fail(part);
+        }
+    }
+
+    upipe_http_src_flush_parts(upipe);
+}
+
+/** @internal @This sends the request of a range.
+ *
+ * @param upump description structure of the write watcher
+ */
+static void upipe_http_src_part_worker_write(struct upump *upump)
+{
+    struct upipe_http_src_part *part =
+        upump_get_opaque(upump, struct upipe_http_src_part *);
+    struct upipe *upipe = part->upipe;
+
+    if (unlikely(!ubase_check(upipe_http_src_send_range(upipe, part->fd,
+                                                        part->range)))) {
+        upipe_err(upipe, "fail to send range request");
+        return;
+    }
+    upump_free(part->upump_write);
+    part->upump_write = NULL;
+}
+
+/** @internal @This allocates the watchers of a range.
+ *
+ * @param part range description
+ * @return an error code
+ */
+static int upipe_http_src_part_check(struct upipe_http_src_part *part)
+{
+    struct upipe *upipe = part->upipe;
+    struct upipe_http_src *upipe_http_src = upipe_http_src_from_upipe(upipe);
+
+    http_parser_init(&part->parser, HTTP_RESPONSE);
+    part->received = false;
+    part->upump = upump_alloc_fd_read(upipe_http_src->upump_mgr,
+                                      upipe_http_src_part_worker, part,
+                                      upipe->refcount, part->fd);
+    part->upump_write = upump_alloc_fd_write(upipe_http_src->upump_mgr,
+                                             upipe_http_src_part_worker_write,
+                                             part, upipe->refcount, part->fd);
+    if (unlikely(part->upump == NULL || part->upump_write == NULL)) {
+        upipe_throw_fatal(upipe, UBASE_ERR_UPUMP);
+        return UBASE_ERR_UPUMP;
+    }
+    upump_start(part->upump);
+    upump_start(part->upump_write);
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This starts fetching a range on an additional connection.
+ *
+ * @param upipe description structure of the pipe
+ * @param range byte range to fetch
+ * @return an error code
+ */
+static int upipe_http_src_part_start(struct upipe *upipe,
+                                     struct http_range range)
+{
+    struct upipe_http_src *upipe_http_src = upipe_http_src_from_upipe(upipe);
+    struct upipe_http_src_part *part = malloc(sizeof (*part));
+    if (unlikely(part == NULL)) {
+        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+        return UBASE_ERR_ALLOC;
+    }
+    uchain_init(&part->uchain);
+    part->upipe = upipe;
+    part->range = range;
+    part->fd = -1;
+    part->reused = false;
+    part->received = false;
+    part->complete = false;
+    part->failed = false;
+    part->upump = NULL;
+    part->upump_write = NULL;
+    ulist_init(&part->urefs);
+    ulist_add(&upipe_http_src->parts, upipe_http_src_part_to_uchain(part));
+
+    if (upipe_http_src->conn_key != NULL) {
+        part->fd = upipe_http_src_mgr_take_conn(upipe->mgr,
+                                                upipe_http_src->conn_key);
+        part->reused = part->fd != -1;
+    }
+    if (part->fd == -1) {
+        int ret = upipe_http_src_open_socket(upipe, &part->fd);
+        if (unlikely(!ubase_check(ret))) {
+            upipe_http_src_part_fail(part);
+            return ret;
+        }
+    }
+
+    upipe_dbg_va(upipe, "fetching range %"PRIu64" in parallel",
+                 range.offset);
+    int ret = upipe_http_src_part_check(part);
+    if (unlikely(!ubase_check(ret)))
+        upipe_http_src_part_fail(part);
+    return ret;
+}
+
+/** @internal @This requests the rest of the resource on parallel
+ * connections, once the server accepted the range of the main connection.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_http_src_split(struct upipe *upipe)
+{
+    struct upipe_http_src *upipe_http_src = upipe_http_src_from_upipe(upipe);
+    struct http_range range = upipe_http_src->range;
+    struct http_range req_range = upipe_http_src->req_range;
+    uint64_t start = req_range.offset + req_range.length;
+    uint64_t end = UINT64_MAX;
+
+    if (!ulist_empty(&upipe_http_src->parts))
+        return;
+    if (range.length && range.length != (uint64_t)-1)
+        end = range.offset + range.length;
+    else if (upipe_http_src->total_size != UINT64_MAX)
+        end = upipe_http_src->total_size;
+    if (start >= end)
+        return;
+
+    /* without the total size, the rest is fetched on a single connection */
+    uint64_t length = end == UINT64_MAX ? (uint64_t)-1 :
+        upipe_http_src_part_length(upipe, end - start,
+                                   upipe_http_src->parallel - 1);
+    while (start < end) {
+        if (length != (uint64_t)-1 && length > end - start)
+            length = end - start;
+        if (!ubase_check(upipe_http_src_part_start(upipe,
+                        HTTP_RANGE(start, length))) ||
+            length == (uint64_t)-1)
+            break;
+        start += length;
+    }
+}
+
 /** @internal @This asks to open the given http.
  *
  * @param upipe description structure of the pipe
@@ -1023,6 +1718,26 @@ static int _upipe_http_src_set_range(struct upipe *upipe,
     return UBASE_ERR_NONE;
 }
 
+/** @internal @This sets the number of parallel ranged requests.
+ *
+ * @param upipe description structure of the pipe
+ * @param connections maximum number of connections, 1 to disable
+ * @param size minimum size of a range
+ * @return an error code
+ */
+static int _upipe_http_src_set_parallel(struct upipe *upipe,
+                                        unsigned int connections,
+                                        uint64_t size)
+{
+    struct upipe_http_src *upipe_http_src = upipe_http_src_from_upipe(upipe);
+
+    if (unlikely(!connections || !size))
+        return UBASE_ERR_INVALID;
+    upipe_http_src->parallel = connections;
+    upipe_http_src->part_size = size;
+    return UBASE_ERR_NONE;
+}
+
 static int _upipe_http_src_set_proxy(struct upipe *upipe, const char *proxy)
 {
     struct upipe_http_src *upipe_http_src = upipe_http_src_from_upipe(upipe);
@@ -1097,6 +1812,12 @@ static int _upipe_http_src_control(struct upipe *upipe,
             const char *proxy = va_arg(args, const char *);
             return _upipe_http_src_set_proxy(upipe, proxy);
         }
+        case UPIPE_HTTP_SRC_SET_PARALLEL: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_HTTP_SRC_SIGNATURE)
+            unsigned int connections = va_arg(args, unsigned int);
+            uint64_t size = va_arg(args, uint64_t);
+            return _upipe_http_src_set_parallel(upipe, connections, size);
+        }
 
         default:
             return UBASE_ERR_UNHANDLED;
@@ -1128,11 +1849,122 @@ struct upipe_http_src_mgr {
     struct uchain cookies;
     /** proxy url */
     char *proxy;
+    /** list of idle connections, most recent last */
+    struct uchain conns;
+    /** number of idle connections */
+    unsigned int nb_conns;
+    /** maximum number of idle connections */
+    unsigned int max_conns;
 };
 
 UBASE_FROM_TO(upipe_http_src_mgr, upipe_mgr, upipe_mgr, upipe_mgr)
 UBASE_FROM_TO(upipe_http_src_mgr, urefcount, urefcount, urefcount);
 
+/** @internal @This deletes an idle connection.
+ *
+ * @param conn idle connection
+ */
+static void upipe_http_src_conn_free(struct upipe_http_src_conn *conn)
+{
+    ulist_delete(upipe_http_src_conn_to_uchain(conn));
+    ubase_clean_fd(&conn->fd);
+    free(conn->key);
+    free(conn);
+}
+
+/** @internal @This takes an idle connection to the given server from the
+ * manager.
+ *
+ * @param mgr pointer to upipe manager
+ * @param key host and port of the server
+ * @return the socket descriptor, or -1 if no connection is available
+ */
+static int upipe_http_src_mgr_take_conn(struct upipe_mgr *mgr,
+                                        const char *key)
+{
+    struct upipe_http_src_mgr *upipe_http_src_mgr =
+        upipe_http_src_mgr_from_upipe_mgr(mgr);
+    struct uchain *uchain, *uchain_tmp;
+
+    ulist_delete_foreach_reverse(&upipe_http_src_mgr->conns, uchain,
+                                 uchain_tmp) {
+        struct upipe_http_src_conn *conn =
+            upipe_http_src_conn_from_uchain(uchain);
+        if (strcmp(conn->key, key))
+            continue;
+
+        /* the connection must be idle and still open */
+        char c;
+        ssize_t ret = recv(conn->fd, &c, 1, MSG_PEEK | MSG_DONTWAIT);
+        bool alive = ret < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+        upipe_http_src_mgr->nb_conns--;
+        if (!alive) {
+            upipe_http_src_conn_free(conn);
+            continue;
+        }
+
+        int fd = conn->fd;
+        conn->fd = -1;
+        upipe_http_src_conn_free(conn);
+        return fd;
+    }
+    return -1;
+}
+
+/** @internal @This gives an idle connection back to the manager.
+ *
+ * @param mgr pointer to upipe manager
+ * @param key host and port of the server
+ * @param fd socket descriptor, owned by the manager afterwards
+ */
+static void upipe_http_src_mgr_release_conn(struct upipe_mgr *mgr,
+                                            const char *key, int fd)
+{
+    struct upipe_http_src_mgr *upipe_http_src_mgr =
+        upipe_http_src_mgr_from_upipe_mgr(mgr);
+
+    struct upipe_http_src_conn *conn = malloc(sizeof (*conn));
+    if (unlikely(conn == NULL ||
+                 upipe_http_src_mgr->max_conns == 0 ||
+                 (conn->key = strdup(key)) == NULL)) {
+        free(conn);
+        close(fd);
+        return;
+    }
+    conn->fd = fd;
+
+    /* evict the oldest connection */
+    if (upipe_http_src_mgr->nb_conns >= upipe_http_src_mgr->max_conns) {
+        struct uchain *uchain = ulist_peek(&upipe_http_src_mgr->conns);
+        upipe_http_src_conn_free(upipe_http_src_conn_from_uchain(uchain));
+        upipe_http_src_mgr->nb_conns--;
+    }
+
+    ulist_add(&upipe_http_src_mgr->conns, upipe_http_src_conn_to_uchain(conn));
+    upipe_http_src_mgr->nb_conns++;
+}
+
+/** @internal @This sets the maximum number of idle connections.
+ *
+ * @param mgr pointer to upipe manager
+ * @param max maximum number of idle connections
+ * @return an error code
+ */
+static int _upipe_http_src_mgr_set_keep_alive(struct upipe_mgr *mgr,
+                                              unsigned int max)
+{
+    struct upipe_http_src_mgr *upipe_http_src_mgr =
+        upipe_http_src_mgr_from_upipe_mgr(mgr);
+
+    upipe_http_src_mgr->max_conns = max;
+    while (upipe_http_src_mgr->nb_conns > max) {
+        struct uchain *uchain = ulist_peek(&upipe_http_src_mgr->conns);
+        upipe_http_src_conn_free(upipe_http_src_conn_from_uchain(uchain));
+        upipe_http_src_mgr->nb_conns--;
+    }
+    return UBASE_ERR_NONE;
+}
+
 static int _upipe_http_src_mgr_set_cookie(struct upipe_mgr *upipe_mgr,
                                           const char *cookie_string)
 {
@@ -1268,6 +2100,20 @@ static int upipe_http_src_mgr_control(struct upipe_mgr *upipe_mgr,
         const char *proxy = va_arg(args, const char *);
         return _upipe_http_src_mgr_set_proxy(upipe_mgr, proxy);
     }
+
+    case UPIPE_HTTP_SRC_MGR_GET_KEEP_ALIVE: {
+        UBASE_SIGNATURE_CHECK(args, UPIPE_HTTP_SRC_SIGNATURE)
+        unsigned int *max_p = va_arg(args, unsigned int *);
+        struct upipe_http_src_mgr *upipe_http_src_mgr =
+            upipe_http_src_mgr_from_upipe_mgr(upipe_mgr);
+        *max_p = upipe_http_src_mgr->max_conns;
+        return UBASE_ERR_NONE;
+    }
+    case UPIPE_HTTP_SRC_MGR_SET_KEEP_ALIVE: {
+        UBASE_SIGNATURE_CHECK(args, UPIPE_HTTP_SRC_SIGNATURE)
+        unsigned int max = va_arg(args, unsigned int);
+        return _upipe_http_src_mgr_set_keep_alive(upipe_mgr, max);
+    }
     }
     return UBASE_ERR_UNHANDLED;
 }
@@ -1285,6 +2131,8 @@ static void upipe_http_src_mgr_free(struct urefcount *urefcount)
         free(cookie->value);
         free(cookie);
     }
+    ulist_delete_foreach(&upipe_http_src_mgr->conns, uchain, uchain_tmp)
+        upipe_http_src_conn_free(upipe_http_src_conn_from_uchain(uchain));
     free(upipe_http_src_mgr->proxy);
     urefcount_clean(urefcount);
     free(upipe_http_src_mgr);
@@ -1311,6 +2159,7 @@ struct upipe_mgr *upipe_http_src_mgr_alloc(void)
     *upipe_mgr = (struct upipe_mgr) {
         .signature = UPIPE_HTTP_SRC_SIGNATURE,
         .upipe_event_str = uprobe_http_src_event_str,
+        .upipe_command_str = upipe_http_src_command_str,
         .upipe_alloc = upipe_http_src_alloc,
         .upipe_control = upipe_http_src_control,
         .upipe_mgr_control = upipe_http_src_mgr_control,
@@ -1318,6 +2167,9 @@ struct upipe_mgr *upipe_http_src_mgr_alloc(void)
     upipe_mgr->refcount = urefcount;
     ulist_init(&upipe_http_src_mgr->cookies);
     upipe_http_src_mgr->proxy = NULL;
+    ulist_init(&upipe_http_src_mgr->conns);
+    upipe_http_src_mgr->nb_conns = 0;
+    upipe_http_src_mgr->max_conns = KEEP_ALIVE_DEFAULT;
 
     return upipe_http_src_mgr_to_upipe_mgr(upipe_http_src_mgr);
 }
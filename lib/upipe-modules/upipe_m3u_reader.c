@@ -154,6 +154,18 @@ struct upipe_m3u_reader {
     struct uref *key;
     /** list of items */
     struct uchain items;
+    /** number of partial segments of the current segment */
+    uint64_t part_index;
+    /** number of segments parsed in the current playlist */
+    uint64_t nb_segments;
+    /** an error occurred while parsing the current playlist */
+    bool error;
+    /** incremental refresh is enabled */
+    bool incremental;
+    /** media sequence of the previous playlist */
+    uint64_t known_start;
+    /** sequence following the last segment already output, or UINT64_MAX */
+    uint64_t known_end;
 
     /** public upipe structure */
     struct upipe upipe;
@@ -199,6 +211,12 @@ static struct upipe *upipe_m3u_reader_alloc(struct upipe_mgr *mgr,
     upipe_m3u_reader->flow_def = NULL;
     upipe_m3u_reader->item = NULL;
     upipe_m3u_reader->key = NULL;
+    upipe_m3u_reader->part_index = 0;
+    upipe_m3u_reader->nb_segments = 0;
+    upipe_m3u_reader->error = false;
+    upipe_m3u_reader->incremental = false;
+    upipe_m3u_reader->known_start = 0;
+    upipe_m3u_reader->known_end = UINT64_MAX;
     upipe_m3u_reader->restart = false;
     upipe_throw_ready(upipe);
 
@@ -217,6 +235,9 @@ static void upipe_m3u_reader_flush(struct upipe *upipe)
     uref_free(upipe_m3u_reader->current_flow_def);
     uref_free(upipe_m3u_reader->item);
     upipe_m3u_reader->item = NULL;
+    upipe_m3u_reader->part_index = 0;
+    upipe_m3u_reader->nb_segments = 0;
+    upipe_m3u_reader->error = false;
 
     struct uchain *uchain;
     while ((uchain = ulist_pop(&upipe_m3u_reader->items)) != NULL)
@@ -274,6 +295,30 @@ static int upipe_m3u_reader_get_item(struct upipe *upipe,
     return UBASE_ERR_NONE;
 }
 
+/** @internal @This checks whether the segment being parsed was already
+ * output by a previous load of the playlist, in which case its tags are
+ * skipped.
+ *
+ * @param upipe description structure of the pipe
+ * @param flow_def the current flow definition
+ * @return true if the segment is already known
+ */
+static bool upipe_m3u_reader_known(struct upipe *upipe, struct uref *flow_def)
+{
+    struct upipe_m3u_reader *upipe_m3u_reader =
+        upipe_m3u_reader_from_upipe(upipe);
+
+    if (!upipe_m3u_reader->incremental ||
+        upipe_m3u_reader->known_end == UINT64_MAX)
+        return false;
+
+    uint64_t media_sequence = 0;
+    uref_m3u_playlist_flow_get_media_sequence(flow_def, &media_sequence);
+    return media_sequence >= upipe_m3u_reader->known_start &&
+           media_sequence + upipe_m3u_reader->nb_segments <
+           upipe_m3u_reader->known_end;
+}
+
 /** @internal @This checks a "#EXTM3U" tag.
  *
  * @param upipe description structure of the pipe
@@ -447,6 +492,8 @@ static int upipe_m3u_reader_process_extinf(struct upipe *upipe,
     if (strcmp(def, M3U_FLOW_DEF) && strcmp(def, PLAYLIST_FLOW_DEF))
         return UBASE_ERR_INVALID;
     UBASE_RETURN(uref_flow_set_def(flow_def, PLAYLIST_FLOW_DEF));
+    if (upipe_m3u_reader_known(upipe, flow_def))
+        return UBASE_ERR_NONE;
     UBASE_RETURN(upipe_m3u_reader_get_item(upipe, flow_def, &item));
 
     const char *endptr;
@@ -559,6 +606,8 @@ static int upipe_m3u_reader_process_byte_range(struct upipe *upipe,
     if (strcmp(def, M3U_FLOW_DEF) && strcmp(def, PLAYLIST_FLOW_DEF))
         return UBASE_ERR_INVALID;
     UBASE_RETURN(uref_flow_set_def(flow_def, PLAYLIST_FLOW_DEF));
+    if (upipe_m3u_reader_known(upipe, flow_def))
+        return UBASE_ERR_NONE;
     UBASE_RETURN(upipe_m3u_reader_get_item(upipe, flow_def, &item));
 
     char *endptr = NULL;
@@ -772,6 +821,307 @@ static int upipe_m3u_reader_key(struct upipe *upipe,
     return UBASE_ERR_NONE;
 }
 
+/** @internal @This parses a "YES" or "NO" attribute value.
+ *
+ * @param upipe description structure of the pipe
+ * @param name attribute name
+ * @param value attribute value
+ * @param yes_p filled with true if the value is "YES"
+ * @return an error code
+ */
+static int upipe_m3u_reader_parse_bool(struct upipe *upipe,
+                                       struct ustring name,
+                                       struct ustring value,
+                                       bool *yes_p)
+{
+    if (!ustring_cmp_str(value, "YES"))
+        *yes_p = true;
+    else if (!ustring_cmp_str(value, "NO"))
+        *yes_p = false;
+    else {
+        upipe_warn_va(upipe, "invalid %.*s value %.*s",
+                      (int)name.len, name.at, (int)value.len, value.at);
+        return UBASE_ERR_INVALID;
+    }
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This checks and parses a "#EXT-X-SERVER-CONTROL" tag.
+ *
+ * @param upipe description structure of the pipe
+ * @param flow_def the current flow definition
+ * @param line the trailing characters of the line
+ * @return an error code
+ */
+static int upipe_m3u_reader_ext_x_server_control(struct upipe *upipe,
+                                                 struct uref *flow_def,
+                                                 const char *line)
+{
+    const char *def;
+    UBASE_RETURN(uref_flow_get_def(flow_def, &def));
+    if (strcmp(def, M3U_FLOW_DEF) && strcmp(def, PLAYLIST_FLOW_DEF))
+        return UBASE_ERR_INVALID;
+    UBASE_RETURN(uref_flow_set_def(flow_def, PLAYLIST_FLOW_DEF));
+
+    struct ustring name, value;
+    while (ubase_check(attribute_iterate(&line, &name, &value)) && line) {
+        char value_str[value.len + 1];
+        int err = ustring_cpy(value, value_str, sizeof (value_str));
+        if (unlikely(!ubase_check(err))) {
+            upipe_err_va(upipe, "fail to copy ustring %.*s",
+                         (int)value.len, value.at);
+            continue;
+        }
+
+        if (!ustring_cmp_str(name, "CAN-BLOCK-RELOAD")) {
+            bool yes;
+            if (ubase_check(upipe_m3u_reader_parse_bool(upipe, name, value,
+                                                        &yes)) && yes) {
+                upipe_dbg(upipe, "server can block reload");
+                UBASE_RETURN(uref_m3u_playlist_flow_set_can_block_reload(
+                        flow_def));
+            }
+        }
+        else if (!ustring_cmp_str(name, "PART-HOLD-BACK")) {
+            const char *endptr;
+            uint64_t hold_back;
+            UBASE_RETURN(duration_to_uclock(value_str, &endptr, &hold_back));
+            if (endptr == value_str || strlen(endptr)) {
+                upipe_warn_va(upipe, "invalid part hold back %s", value_str);
+                continue;
+            }
+            upipe_dbg_va(upipe, "part hold back: %"PRIu64, hold_back);
+            UBASE_RETURN(uref_m3u_playlist_flow_set_part_hold_back(
+                    flow_def, hold_back));
+        }
+        else {
+            upipe_dbg_va(upipe, "ignoring attribute %.*s (%.*s)",
+                         (int)name.len, name.at, (int)value.len, value.at);
+        }
+    }
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This checks and parses a "#EXT-X-PART-INF" tag.
+ *
+ * @param upipe description structure of the pipe
+ * @param flow_def the current flow definition
+ * @param line the trailing characters of the line
+ * @return an error code
+ */
+static int upipe_m3u_reader_ext_x_part_inf(struct upipe *upipe,
+                                           struct uref *flow_def,
+                                           const char *line)
+{
+    const char *def;
+    UBASE_RETURN(uref_flow_get_def(flow_def, &def));
+    if (strcmp(def, M3U_FLOW_DEF) && strcmp(def, PLAYLIST_FLOW_DEF))
+        return UBASE_ERR_INVALID;
+    UBASE_RETURN(uref_flow_set_def(flow_def, PLAYLIST_FLOW_DEF));
+
+    struct ustring name, value;
+    while (ubase_check(attribute_iterate(&line, &name, &value)) && line) {
+        if (ustring_cmp_str(name, "PART-TARGET")) {
+            upipe_dbg_va(upipe, "ignoring attribute %.*s (%.*s)",
+                         (int)name.len, name.at, (int)value.len, value.at);
+            continue;
+        }
+
+        char value_str[value.len + 1];
+        UBASE_RETURN(ustring_cpy(value, value_str, sizeof (value_str)));
+        const char *endptr;
+        uint64_t part_target;
+        UBASE_RETURN(duration_to_uclock(value_str, &endptr, &part_target));
+        if (endptr == value_str || strlen(endptr)) {
+            upipe_warn_va(upipe, "invalid part target %s", value_str);
+            return UBASE_ERR_INVALID;
+        }
+        upipe_dbg_va(upipe, "part target: %"PRIu64, part_target);
+        UBASE_RETURN(uref_m3u_playlist_flow_set_part_target(
+                flow_def, part_target));
+    }
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This parses a byte range of a partial segment.
+ *
+ * @param upipe description structure of the pipe
+ * @param item partial segment item
+ * @param str byte range in the "<length>[@<offset>]" form
+ * @return an error code
+ */
+static int upipe_m3u_reader_part_byte_range(struct upipe *upipe,
+                                            struct uref *item,
+                                            const char *str)
+{
+    char *endptr;
+    unsigned long long len = strtoull(str, &endptr, 10);
+    if (endptr == str || (*endptr != '\0' && *endptr != '@')) {
+        upipe_warn_va(upipe, "invalid byte range %s", str);
+        return UBASE_ERR_INVALID;
+    }
+    if (*endptr == '@') {
+        const char *off_str = endptr + 1;
+        unsigned long long off = strtoull(off_str, &endptr, 10);
+        if (endptr == off_str || *endptr != '\0') {
+            upipe_warn_va(upipe, "invalid byte range %s", str);
+            return UBASE_ERR_INVALID;
+        }
+        UBASE_RETURN(uref_m3u_playlist_set_byte_range_off(item, off));
+    }
+    return uref_m3u_playlist_set_byte_range_len(item, len);
+}
+
+/** @internal @This checks and parses a "#EXT-X-PART" or a
+ * "#EXT-X-PRELOAD-HINT" tag.
+ *
+ * @param upipe description structure of the pipe
+ * @param flow_def the current flow definition
+ * @param line the trailing characters of the line
+ * @param hint true for a preload hint
+ * @return an error code
+ */
+static int upipe_m3u_reader_process_part(struct upipe *upipe,
+                                         struct uref *flow_def,
+                                         const char *line,
+                                         bool hint)
+{
+    struct upipe_m3u_reader *upipe_m3u_reader =
+        upipe_m3u_reader_from_upipe(upipe);
+
+    const char *def;
+    UBASE_RETURN(uref_flow_get_def(flow_def, &def));
+    if (strcmp(def, M3U_FLOW_DEF) && strcmp(def, PLAYLIST_FLOW_DEF))
+        return UBASE_ERR_INVALID;
+    UBASE_RETURN(uref_flow_set_def(flow_def, PLAYLIST_FLOW_DEF));
+    if (upipe_m3u_reader_known(upipe, flow_def))
+        return UBASE_ERR_NONE;
+
+    struct uref *item = uref_sibling_alloc_control(flow_def);
+    if (unlikely(item == NULL)) {
+        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+        return UBASE_ERR_ALLOC;
+    }
+
+    bool has_uri = false;
+    int ret = UBASE_ERR_NONE;
+    struct ustring name, value;
+    while (ubase_check(ret) &&
+           ubase_check(attribute_iterate(&line, &name, &value)) && line) {
+        char value_str[value.len + 1];
+        ret = ustring_cpy(value, value_str, sizeof (value_str));
+        if (unlikely(!ubase_check(ret)))
+            break;
+
+        if (!ustring_cmp_str(name, "URI")) {
+            ret = uref_m3u_set_uri(item, value_str);
+            has_uri = true;
+        }
+        else if (!hint && !ustring_cmp_str(name, "DURATION")) {
+            const char *endptr;
+            uint64_t duration;
+            ret = duration_to_uclock(value_str, &endptr, &duration);
+            if (ubase_check(ret) && (endptr == value_str || strlen(endptr))) {
+                upipe_warn_va(upipe, "invalid part duration %s", value_str);
+                ret = UBASE_ERR_INVALID;
+            }
+            if (ubase_check(ret))
+                ret = uref_m3u_playlist_set_seq_duration(item, duration);
+        }
+        else if (!hint && !ustring_cmp_str(name, "INDEPENDENT")) {
+            bool yes;
+            if (ubase_check(upipe_m3u_reader_parse_bool(upipe, name, value,
+                                                        &yes)) && yes)
+                ret = uref_m3u_playlist_set_part_independent(item);
+        }
+        else if (!hint && !ustring_cmp_str(name, "BYTERANGE")) {
+            ret = upipe_m3u_reader_part_byte_range(upipe, item, value_str);
+        }
+        else if (hint && !ustring_cmp_str(name, "TYPE")) {
+            if (strcmp(value_str, "PART")) {
+                /* only partial segments hints are used */
+                upipe_dbg_va(upipe, "ignoring %s preload hint", value_str);
+                uref_free(item);
+                return UBASE_ERR_NONE;
+            }
+        }
+        else if (hint && !ustring_cmp_str(name, "BYTERANGE-START")) {
+            char *endptr;
+            unsigned long long off = strtoull(value_str, &endptr, 10);
+            if (endptr == value_str || *endptr != '\0')
+                ret = UBASE_ERR_INVALID;
+            else
+                ret = uref_m3u_playlist_set_byte_range_off(item, off);
+        }
+        else if (hint && !ustring_cmp_str(name, "BYTERANGE-LENGTH")) {
+            char *endptr;
+            unsigned long long len = strtoull(value_str, &endptr, 10);
+            if (endptr == value_str || *endptr != '\0')
+                ret = UBASE_ERR_INVALID;
+            else
+                ret = uref_m3u_playlist_set_byte_range_len(item, len);
+        }
+        else {
+            upipe_dbg_va(upipe, "ignoring attribute %.*s (%.*s)",
+                         (int)name.len, name.at, (int)value.len, value.at);
+        }
+    }
+
+    if (ubase_check(ret) && !has_uri) {
+        upipe_warn(upipe, "partial segment without URI");
+        ret = UBASE_ERR_INVALID;
+    }
+    if (ubase_check(ret))
+        ret = uref_m3u_playlist_set_part(item);
+    if (ubase_check(ret))
+        ret = uref_m3u_playlist_set_part_index(item,
+                                               upipe_m3u_reader->part_index);
+    if (ubase_check(ret) && hint)
+        ret = uref_m3u_playlist_set_preload_hint(item);
+    if (ubase_check(ret) && upipe_m3u_reader->key)
+        ret = uref_m3u_playlist_key_copy(item, upipe_m3u_reader->key);
+    if (unlikely(!ubase_check(ret))) {
+        uref_free(item);
+        return ret;
+    }
+
+    upipe_verbose_va(upipe, "%s %"PRIu64,
+                     hint ? "preload hint" : "part",
+                     upipe_m3u_reader->part_index);
+    if (!hint)
+        upipe_m3u_reader->part_index++;
+    ulist_add(&upipe_m3u_reader->items, uref_to_uchain(item));
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This checks and parses a "#EXT-X-PART" tag.
+ *
+ * @param upipe description structure of the pipe
+ * @param flow_def the current flow definition
+ * @param line the trailing characters of the line
+ * @return an error code
+ */
+static int upipe_m3u_reader_ext_x_part(struct upipe *upipe,
+                                       struct uref *flow_def,
+                                       const char *line)
+{
+    return upipe_m3u_reader_process_part(upipe, flow_def, line, false);
+}
+
+/** @internal @This checks and parses a "#EXT-X-PRELOAD-HINT" tag.
+ *
+ * @param upipe description structure of the pipe
+ * @param flow_def the current flow definition
+ * @param line the trailing characters of the line
+ * @return an error code
+ */
+static int upipe_m3u_reader_ext_x_preload_hint(struct upipe *upipe,
+                                               struct uref *flow_def,
+                                               const char *line)
+{
+    return upipe_m3u_reader_process_part(upipe, flow_def, line, true);
+}
+
 /** @internal @This checks an URI.
  *
  * @param upipe description structure of the pipe
@@ -788,12 +1138,21 @@ static int upipe_m3u_reader_process_uri(struct upipe *upipe,
 
     upipe_verbose_va(upipe, "uri %s", uri);
     UBASE_RETURN(uref_flow_match_def(flow_def, M3U_FLOW_DEF));
+    if (upipe_m3u_reader_known(upipe, flow_def)) {
+        uref_free(upipe_m3u_reader->item);
+        upipe_m3u_reader->item = NULL;
+        upipe_m3u_reader->part_index = 0;
+        upipe_m3u_reader->nb_segments++;
+        return UBASE_ERR_NONE;
+    }
     struct uref *item;
     UBASE_RETURN(upipe_m3u_reader_get_item(upipe, flow_def, &item));
     UBASE_RETURN(uref_m3u_set_uri(item, uri));
     if (upipe_m3u_reader->key)
         UBASE_RETURN(uref_m3u_playlist_key_copy(item, upipe_m3u_reader->key));
     upipe_m3u_reader->item = NULL;
+    upipe_m3u_reader->part_index = 0;
+    upipe_m3u_reader->nb_segments++;
     ulist_add(&upipe_m3u_reader->items, uref_to_uchain(item));
     return UBASE_ERR_NONE;
 }
@@ -824,6 +1183,10 @@ static int upipe_m3u_reader_process_line(struct upipe *upipe,
         { "#EXT-X-MEDIA-SEQUENCE:", upipe_m3u_reader_ext_x_media_sequence },
         { "#EXT-X-ENDLIST", upipe_m3u_reader_ext_x_endlist },
         { "#EXT-X-KEY:", upipe_m3u_reader_key },
+        { "#EXT-X-SERVER-CONTROL:", upipe_m3u_reader_ext_x_server_control },
+        { "#EXT-X-PART-INF:", upipe_m3u_reader_ext_x_part_inf },
+        { "#EXT-X-PART:", upipe_m3u_reader_ext_x_part },
+        { "#EXT-X-PRELOAD-HINT:", upipe_m3u_reader_ext_x_preload_hint },
     };
 
     size_t block_size;
@@ -893,8 +1256,44 @@ static void upipe_m3u_reader_process(struct upipe *upipe)
         uref_free(line);
     }
 
-    if (!ubase_check(ret))
+    if (!ubase_check(ret)) {
+        upipe_m3u_reader->error = true;
         upipe_throw_error(upipe, ret);
+    }
+}
+
+/** @internal @This updates the segments already output once a media
+ * playlist is completely parsed, and tags the flow definition of an
+ * incremental refresh.
+ *
+ * @param upipe description structure of the pipe
+ * @param flow_def the playlist flow definition
+ * @return an error code
+ */
+static int upipe_m3u_reader_update_known(struct upipe *upipe,
+                                         struct uref *flow_def)
+{
+    struct upipe_m3u_reader *upipe_m3u_reader =
+        upipe_m3u_reader_from_upipe(upipe);
+
+    uint64_t media_sequence = 0;
+    uref_m3u_playlist_flow_get_media_sequence(flow_def, &media_sequence);
+    uint64_t end = media_sequence + upipe_m3u_reader->nb_segments;
+
+    if (upipe_m3u_reader->known_end != UINT64_MAX &&
+        media_sequence >= upipe_m3u_reader->known_start) {
+        uint64_t append = media_sequence > upipe_m3u_reader->known_end ?
+            media_sequence : upipe_m3u_reader->known_end;
+        upipe_verbose_va(upipe, "append from sequence %"PRIu64, append);
+        UBASE_RETURN(uref_m3u_playlist_flow_set_append(flow_def, append));
+        if (end < upipe_m3u_reader->known_end)
+            end = upipe_m3u_reader->known_end;
+    }
+
+    upipe_m3u_reader->known_start = media_sequence;
+    /* restart from a full playlist after a parsing error */
+    upipe_m3u_reader->known_end = upipe_m3u_reader->error ? UINT64_MAX : end;
+    return UBASE_ERR_NONE;
 }
 
 /** @internal @This outputs the m3u.
@@ -916,6 +1315,27 @@ static void upipe_m3u_reader_output_all(struct upipe *upipe,
         return;
     }
 
+    if (upipe_m3u_reader->incremental &&
+        ubase_check(uref_flow_match_def(flow_def, PLAYLIST_FLOW_DEF))) {
+        int ret = upipe_m3u_reader_update_known(upipe, flow_def);
+        if (unlikely(!ubase_check(ret))) {
+            uref_free(flow_def);
+            upipe_throw_error(upipe, ret);
+            return;
+        }
+
+        if (ulist_empty(&upipe_m3u_reader->items)) {
+            /* signal the end of a refresh appending nothing */
+            struct uref *uref = uref_sibling_alloc_control(flow_def);
+            if (unlikely(uref == NULL)) {
+                uref_free(flow_def);
+                upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+                return;
+            }
+            ulist_add(&upipe_m3u_reader->items, uref_to_uchain(uref));
+        }
+    }
+
     /* force new flow def */
     upipe_m3u_reader_store_flow_def(upipe, NULL);
     /* set output flow def */
@@ -1015,6 +1435,15 @@ static int upipe_m3u_reader_control(struct upipe *upipe,
         return upipe_m3u_reader_set_flow_def(upipe, p);
     }
 
+    case UPIPE_M3U_READER_SET_INCREMENTAL: {
+        UBASE_SIGNATURE_CHECK(args, UPIPE_M3U_READER_SIGNATURE)
+        struct upipe_m3u_reader *upipe_m3u_reader =
+            upipe_m3u_reader_from_upipe(upipe);
+        upipe_m3u_reader->incremental = va_arg(args, int) != 0;
+        upipe_m3u_reader->known_end = UINT64_MAX;
+        return UBASE_ERR_NONE;
+    }
+
     default:
         return UBASE_ERR_UNHANDLED;
     }
@@ -1028,6 +1457,7 @@ static struct upipe_mgr upipe_m3u_reader_mgr = {
     .upipe_alloc = upipe_m3u_reader_alloc,
     .upipe_input = upipe_m3u_reader_input,
     .upipe_control = upipe_m3u_reader_control,
+    .upipe_command_str = upipe_m3u_reader_command_str,
 
     .upipe_mgr_control = NULL,
 };
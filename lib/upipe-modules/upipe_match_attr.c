@@ -42,12 +42,14 @@
 #include <stdlib.h>
 #include <stdbool.h>
 #include <stdarg.h>
+#include <string.h>
 #include <assert.h>
 
 enum upipe_match_attr_type {
     UPIPE_MATCH_ATTR_NONE,
     UPIPE_MATCH_ATTR_UINT8_T,
     UPIPE_MATCH_ATTR_UINT64_T,
+    UPIPE_MATCH_ATTR_ATTR,
 };
 
 /** @internal @This is the private context of a match_attr pipe. */
@@ -68,6 +70,12 @@ struct upipe_match_attr {
     int (*match_uint8_t) (struct uref*, uint8_t, uint8_t);
     /** match uint64_t */
     int (*match_uint64_t) (struct uref*, uint64_t, uint64_t);
+    /** name of the attribute to match, or NULL for a shorthand */
+    char *attr_name;
+    /** type of the attribute to match */
+    enum udict_type attr_type;
+    /** true if the attribute name was resolved */
+    bool attr_resolved;
     /** mode */
     enum upipe_match_attr_type mode;
     /** min */
@@ -84,6 +92,66 @@ UPIPE_HELPER_UREFCOUNT(upipe_match_attr, urefcount, upipe_match_attr_free)
 UPIPE_HELPER_VOID(upipe_match_attr)
 UPIPE_HELPER_OUTPUT(upipe_match_attr, output, flow_def, output_state, request_list)
 
+/** @internal @This resolves the name of the attribute to match to a
+ * shorthand type, if there is one, so that later lookups go through the
+ * shorthand index of the udict.
+ *
+ * @param upipe description structure of the pipe
+ * @param udict any udict of the manager of the input urefs
+ */
+static void upipe_match_attr_resolve(struct upipe *upipe, struct udict *udict)
+{
+    struct upipe_match_attr *upipe_match_attr = upipe_match_attr_from_upipe(upipe);
+    upipe_match_attr->attr_resolved = true;
+    if (upipe_match_attr->attr_type > UDICT_TYPE_SHORTHAND)
+        return;
+
+    for (enum udict_type type = UDICT_TYPE_SHORTHAND + 1; ; type++) {
+        const char *name;
+        enum udict_type base_type;
+        if (!ubase_check(udict_name(udict, type, &name, &base_type)))
+            break;
+        if (base_type == upipe_match_attr->attr_type &&
+            !strcmp(name, upipe_match_attr->attr_name)) {
+            upipe_dbg_va(upipe, "matching %s as shorthand %d", name, type);
+            free(upipe_match_attr->attr_name);
+            upipe_match_attr->attr_name = NULL;
+            upipe_match_attr->attr_type = type;
+            break;
+        }
+    }
+}
+
+/** @internal @This checks the pre-resolved attribute of a uref against the
+ * boundaries.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref uref structure
+ * @return an error code
+ */
+static int upipe_match_attr_check_attr(struct upipe *upipe, struct uref *uref)
+{
+    struct upipe_match_attr *upipe_match_attr = upipe_match_attr_from_upipe(upipe);
+    if (uref->udict == NULL)
+        return UBASE_ERR_INVALID;
+    if (unlikely(!upipe_match_attr->attr_resolved))
+        upipe_match_attr_resolve(upipe, uref->udict);
+
+    size_t size;
+    const uint8_t *v;
+    UBASE_RETURN(udict_get(uref->udict, upipe_match_attr->attr_name,
+                           upipe_match_attr->attr_type, &size, &v))
+    uint64_t value;
+    if (size == 1)
+        value = *v;
+    else if (size == 8)
+        value = udict_get_uint64(v);
+    else
+        return UBASE_ERR_INVALID;
+    return value >= upipe_match_attr->min && value <= upipe_match_attr->max ?
+           UBASE_ERR_NONE : UBASE_ERR_INVALID;
+}
+
 /** @internal @This receives data.
  *
  * @param upipe description structure of the pipe
@@ -112,6 +180,9 @@ static void upipe_match_attr_input(struct upipe *upipe, struct uref *uref,
             }
             break;
         }
+        case UPIPE_MATCH_ATTR_ATTR:
+            forward = upipe_match_attr_check_attr(upipe, uref);
+            break;
         case UPIPE_MATCH_ATTR_NONE:
         default:
             break;
@@ -175,6 +246,28 @@ static int upipe_match_attr_control(struct upipe *upipe,
             upipe_match_attr->mode = UPIPE_MATCH_ATTR_UINT64_T;
             return UBASE_ERR_NONE;
         }
+        case UPIPE_MATCH_ATTR_SET_ATTR: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_MATCH_ATTR_SIGNATURE)
+            enum udict_type type = va_arg(args, enum udict_type);
+            const char *name = va_arg(args, const char *);
+            if (type != UDICT_TYPE_SMALL_UNSIGNED &&
+                type != UDICT_TYPE_UNSIGNED && type <= UDICT_TYPE_SHORTHAND)
+                return UBASE_ERR_INVALID;
+            char *name_dup = NULL;
+            if (type <= UDICT_TYPE_SHORTHAND) {
+                if (unlikely(name == NULL))
+                    return UBASE_ERR_INVALID;
+                name_dup = strdup(name);
+                if (unlikely(name_dup == NULL))
+                    return UBASE_ERR_ALLOC;
+            }
+            free(upipe_match_attr->attr_name);
+            upipe_match_attr->attr_name = name_dup;
+            upipe_match_attr->attr_type = type;
+            upipe_match_attr->attr_resolved = false;
+            upipe_match_attr->mode = UPIPE_MATCH_ATTR_ATTR;
+            return UBASE_ERR_NONE;
+        }
         case UPIPE_MATCH_ATTR_SET_BOUNDARIES: {
             UBASE_SIGNATURE_CHECK(args, UPIPE_MATCH_ATTR_SIGNATURE)
             upipe_match_attr->min = va_arg(args, uint64_t);
@@ -209,6 +302,9 @@ static struct upipe *upipe_match_attr_alloc(struct upipe_mgr *mgr,
     upipe_match_attr_init_output(upipe);
     upipe_match_attr->match_uint8_t = NULL;
     upipe_match_attr->match_uint64_t = NULL;
+    upipe_match_attr->attr_name = NULL;
+    upipe_match_attr->attr_type = UDICT_TYPE_END;
+    upipe_match_attr->attr_resolved = false;
     upipe_match_attr->mode = UPIPE_MATCH_ATTR_NONE;
     upipe_throw_ready(upipe);
     return upipe;
@@ -220,8 +316,10 @@ static struct upipe *upipe_match_attr_alloc(struct upipe_mgr *mgr,
  */
 static void upipe_match_attr_free(struct upipe *upipe)
 {
+    struct upipe_match_attr *upipe_match_attr = upipe_match_attr_from_upipe(upipe);
     upipe_throw_dead(upipe);
 
+    free(upipe_match_attr->attr_name);
     upipe_match_attr_clean_output(upipe);
     upipe_match_attr_clean_urefcount(upipe);
     upipe_match_attr_free_void(upipe);
@@ -27,6 +27,8 @@
  * @short Upipe module - multicat file sink
  */
 
+#define _GNU_SOURCE
+
 #include <upipe/ubase.h>
 #include <upipe/uprobe.h>
 #include <upipe/uprobe_prefix.h>
@@ -53,10 +55,20 @@
 #include <unistd.h>
 #include <errno.h>
 #include <math.h>
+#include <fcntl.h>
+#include <pthread.h>
 #include <assert.h>
 #include <sys/param.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifndef O_CLOEXEC
+#   define O_CLOEXEC 0
+#endif
 
 #define EXPECTED_FLOW_DEF "block."
+/** maximum number of buffers in a batched write */
+#define BATCH_MAX_BUFFERS 256
 
 /** upipe_multicat_sink structure */
 struct upipe_multicat_sink {
@@ -89,6 +101,30 @@ struct upipe_multicat_sink {
     /** sync period */
     uint64_t sync_period;
 
+    /** preallocated size of the files, or 0 */
+    uint64_t prealloc;
+    /** true if the next file is being opened */
+    bool next_pending;
+    /** index of the next file */
+    int64_t next_idx;
+    /** thread opening the next file */
+    pthread_t next_thread;
+    /** path of the next file */
+    char next_path[MAXPATHLEN];
+    /** opening flags of the next file */
+    int next_flags;
+    /** file descriptor of the next file, or -1 */
+    int next_fd;
+
+    /** size of the batched writes, or 0 */
+    unsigned int batch;
+    /** batched buffers */
+    struct uref *batch_uref;
+    /** size of the batched buffers */
+    size_t batch_size;
+    /** number of batched buffers */
+    unsigned int batch_nb;
+
     /** public upipe structure */
     struct upipe upipe;
 };
@@ -97,6 +133,160 @@ UPIPE_HELPER_UPIPE(upipe_multicat_sink, upipe, UPIPE_MULTICAT_SINK_SIGNATURE);
 UPIPE_HELPER_UREFCOUNT(upipe_multicat_sink, urefcount, upipe_multicat_sink_free)
 UPIPE_HELPER_VOID(upipe_multicat_sink)
 
+/** @internal @This generates the path of a file from its index.
+ *
+ * @param upipe description structure of the pipe
+ * @param filepath filled in with the path, of MAXPATHLEN octets
+ * @param idx file index
+ */
+static void upipe_multicat_sink_filepath(struct upipe *upipe, char *filepath,
+                                         int64_t idx)
+{
+    struct upipe_multicat_sink *upipe_multicat_sink = upipe_multicat_sink_from_upipe(upipe);
+    snprintf(filepath, MAXPATHLEN, "%s%"PRId64"%s", upipe_multicat_sink->dirpath, idx, upipe_multicat_sink->suffix);
+}
+
+/** @internal @This opens the next file and preallocates it, in a background
+ * thread.
+ *
+ * @param arg pointer to the private context of the pipe
+ * @return NULL
+ */
+static void *upipe_multicat_sink_next_thread(void *arg)
+{
+    struct upipe_multicat_sink *upipe_multicat_sink = arg;
+    int fd = open(upipe_multicat_sink->next_path,
+                  O_WRONLY | O_NONBLOCK | O_CLOEXEC |
+                  upipe_multicat_sink->next_flags,
+                  S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+#ifdef FALLOC_FL_KEEP_SIZE
+    struct stat st;
+    if (fd != -1 && fstat(fd, &st) != -1)
+        /* this is only a hint, so errors are ignored */
+        fallocate(fd, FALLOC_FL_KEEP_SIZE, st.st_size,
+                  upipe_multicat_sink->prealloc);
+#endif
+    upipe_multicat_sink->next_fd = fd;
+    return NULL;
+}
+
+/** @internal @This starts opening the next file in the background.
+ *
+ * @param upipe description structure of the pipe
+ * @param idx index of the next file
+ */
+static void upipe_multicat_sink_next_open(struct upipe *upipe, int64_t idx)
+{
+    struct upipe_multicat_sink *upipe_multicat_sink = upipe_multicat_sink_from_upipe(upipe);
+    int flags;
+    switch (upipe_multicat_sink->mode) {
+        case UPIPE_FSINK_APPEND:
+            flags = O_CREAT;
+            break;
+        case UPIPE_FSINK_OVERWRITE:
+            flags = O_CREAT | O_TRUNC;
+            break;
+        case UPIPE_FSINK_CREATE:
+            flags = O_CREAT | O_EXCL;
+            break;
+        default:
+            flags = 0;
+            break;
+    }
+
+    upipe_multicat_sink_filepath(upipe, upipe_multicat_sink->next_path, idx);
+    upipe_multicat_sink->next_flags = flags;
+    upipe_multicat_sink->next_idx = idx;
+    upipe_multicat_sink->next_fd = -1;
+    if (unlikely(pthread_create(&upipe_multicat_sink->next_thread, NULL,
+                                upipe_multicat_sink_next_thread,
+                                upipe_multicat_sink))) {
+        upipe_warn(upipe, "couldn't open next file in the background");
+        return;
+    }
+    upipe_multicat_sink->next_pending = true;
+}
+
+/** @internal @This waits for the next file to be opened.
+ *
+ * @param upipe description structure of the pipe
+ * @param idx index of the file to open
+ * @return file descriptor of the file, or -1 if it was not opened ahead
+ */
+static int upipe_multicat_sink_next_get(struct upipe *upipe, int64_t idx)
+{
+    struct upipe_multicat_sink *upipe_multicat_sink = upipe_multicat_sink_from_upipe(upipe);
+    if (!upipe_multicat_sink->next_pending)
+        return -1;
+    pthread_join(upipe_multicat_sink->next_thread, NULL);
+    upipe_multicat_sink->next_pending = false;
+
+    int fd = upipe_multicat_sink->next_fd;
+    upipe_multicat_sink->next_fd = -1;
+    if (unlikely(fd != -1 && upipe_multicat_sink->next_idx != idx)) {
+        close(fd);
+        fd = -1;
+    }
+    return fd;
+}
+
+/** @internal @This writes the batched buffers to the internal (fsink) output.
+ *
+ * @param upipe description structure of the pipe
+ * @param upump_p reference to pump that generated the buffers
+ */
+static void upipe_multicat_sink_flush_batch(struct upipe *upipe,
+                                            struct upump **upump_p)
+{
+    struct upipe_multicat_sink *upipe_multicat_sink = upipe_multicat_sink_from_upipe(upipe);
+    struct uref *uref = upipe_multicat_sink->batch_uref;
+    if (uref == NULL)
+        return;
+    upipe_multicat_sink->batch_uref = NULL;
+    upipe_multicat_sink->batch_size = 0;
+    upipe_multicat_sink->batch_nb = 0;
+    if (likely(upipe_multicat_sink->fsink != NULL))
+        upipe_input(upipe_multicat_sink->fsink, uref, upump_p);
+    else
+        uref_free(uref);
+}
+
+/** @internal @This adds a buffer to the batched buffers, and writes them if
+ * they are big enough.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref uref structure
+ * @param upump_p reference to pump that generated the buffer
+ */
+static void upipe_multicat_sink_output_batch(struct upipe *upipe,
+                                             struct uref *uref,
+                                             struct upump **upump_p)
+{
+    struct upipe_multicat_sink *upipe_multicat_sink = upipe_multicat_sink_from_upipe(upipe);
+    size_t size = 0;
+    uref_block_size(uref, &size);
+
+    if (upipe_multicat_sink->batch_uref == NULL)
+        upipe_multicat_sink->batch_uref = uref;
+    else {
+        struct ubuf *ubuf = uref_detach_ubuf(uref);
+        uref_free(uref);
+        if (unlikely(ubuf == NULL))
+            return;
+        if (unlikely(!ubase_check(uref_block_append(
+                            upipe_multicat_sink->batch_uref, ubuf)))) {
+            upipe_warn(upipe, "couldn't batch buffer, dropping");
+            ubuf_free(ubuf);
+            return;
+        }
+    }
+    upipe_multicat_sink->batch_size += size;
+    upipe_multicat_sink->batch_nb++;
+    if (upipe_multicat_sink->batch_size >= upipe_multicat_sink->batch ||
+        upipe_multicat_sink->batch_nb >= BATCH_MAX_BUFFERS)
+        upipe_multicat_sink_flush_batch(upipe, upump_p);
+}
+
 /** @internal @This generates a path from idx and send set_path to the internal
  * (fsink) output
  *
@@ -113,9 +303,15 @@ static bool _upipe_multicat_sink_change_file(struct upipe *upipe, int64_t idx)
         upipe_warn(upipe, "call set_path first !");
         return false;
     }
-    snprintf(filepath, MAXPATHLEN, "%s%"PRId64"%s", upipe_multicat_sink->dirpath, idx, upipe_multicat_sink->suffix);
-    if (!ubase_check(upipe_fsink_set_path(upipe_multicat_sink->fsink, filepath, upipe_multicat_sink->mode)))
-        return false;
+    int fd = upipe_multicat_sink_next_get(upipe, idx);
+    if (fd != -1) {
+        if (!ubase_check(upipe_fsink_set_fd(upipe_multicat_sink->fsink, fd, upipe_multicat_sink->mode)))
+            return false;
+    } else {
+        upipe_multicat_sink_filepath(upipe, filepath, idx);
+        if (!ubase_check(upipe_fsink_set_path(upipe_multicat_sink->fsink, filepath, upipe_multicat_sink->mode)))
+            return false;
+    }
     if (upipe_multicat_sink->sync_period)
         upipe_fsink_set_sync_period(upipe_multicat_sink->fsink,
                                     upipe_multicat_sink->sync_period);
@@ -143,6 +339,7 @@ static void upipe_multicat_sink_input(struct upipe *upipe, struct uref *uref,
     newidx = (systime - upipe_multicat_sink->rotate_offset) /
              upipe_multicat_sink->rotate;
     if (upipe_multicat_sink->fileidx != newidx) {
+        upipe_multicat_sink_flush_batch(upipe, upump_p);
         if (unlikely(! _upipe_multicat_sink_change_file(upipe, newidx))) {
             upipe_warn(upipe, "couldn't change file path");
             uref_free(uref);
@@ -151,7 +348,17 @@ static void upipe_multicat_sink_input(struct upipe *upipe, struct uref *uref,
         upipe_multicat_sink->fileidx = newidx;
     }
 
-    upipe_input(upipe_multicat_sink->fsink, uref, upump_p);
+    /* open the next file half a rotate interval ahead */
+    if (upipe_multicat_sink->prealloc && !upipe_multicat_sink->next_pending &&
+        systime + upipe_multicat_sink->rotate / 2 >=
+        (newidx + 1) * upipe_multicat_sink->rotate +
+        upipe_multicat_sink->rotate_offset)
+        upipe_multicat_sink_next_open(upipe, newidx + 1);
+
+    if (upipe_multicat_sink->batch)
+        upipe_multicat_sink_output_batch(upipe, uref, upump_p);
+    else
+        upipe_input(upipe_multicat_sink->fsink, uref, upump_p);
 }
 
 /** @internal @This allocates multicat_sink output (fsink)
@@ -225,6 +432,10 @@ static int _upipe_multicat_sink_set_path(struct upipe *upipe, const char *path,
         UBASE_RETURN(_upipe_multicat_sink_output_alloc(upipe));
     }
 
+    upipe_multicat_sink_flush_batch(upipe, NULL);
+    int fd = upipe_multicat_sink_next_get(upipe, upipe_multicat_sink->next_idx);
+    if (fd != -1)
+        close(fd);
     free(upipe_multicat_sink->dirpath);
     free(upipe_multicat_sink->suffix);
     upipe_multicat_sink->fileidx = -1;
@@ -383,6 +594,30 @@ static int upipe_multicat_sink_control(struct upipe *upipe,
             UBASE_SIGNATURE_CHECK(args, UPIPE_MULTICAT_SINK_SIGNATURE)
             return _upipe_multicat_sink_get_path(upipe, va_arg(args, char **), va_arg(args, char **));
         }
+        case UPIPE_MULTICAT_SINK_GET_PREALLOC: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_MULTICAT_SINK_SIGNATURE)
+            uint64_t *p = va_arg(args, uint64_t *);
+            *p = upipe_multicat_sink->prealloc;
+            return UBASE_ERR_NONE;
+        }
+        case UPIPE_MULTICAT_SINK_SET_PREALLOC: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_MULTICAT_SINK_SIGNATURE)
+            upipe_multicat_sink->prealloc = va_arg(args, uint64_t);
+            return UBASE_ERR_NONE;
+        }
+        case UPIPE_MULTICAT_SINK_GET_BATCH: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_MULTICAT_SINK_SIGNATURE)
+            unsigned int *p = va_arg(args, unsigned int *);
+            *p = upipe_multicat_sink->batch;
+            return UBASE_ERR_NONE;
+        }
+        case UPIPE_MULTICAT_SINK_SET_BATCH: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_MULTICAT_SINK_SIGNATURE)
+            upipe_multicat_sink->batch = va_arg(args, unsigned int);
+            if (!upipe_multicat_sink->batch)
+                upipe_multicat_sink_flush_batch(upipe, NULL);
+            return UBASE_ERR_NONE;
+        }
         case UPIPE_FSINK_SET_SYNC_PERIOD: {
             UBASE_SIGNATURE_CHECK(args, UPIPE_FSINK_SIGNATURE)
             uint64_t sync_period = va_arg(args, uint64_t);
@@ -437,6 +672,14 @@ static struct upipe *upipe_multicat_sink_alloc(struct upipe_mgr *mgr,
     upipe_multicat_sink->rotate_offset = UPIPE_MULTICAT_SINK_DEF_ROTATE_OFFSET;
     upipe_multicat_sink->mode = UPIPE_FSINK_APPEND;
     upipe_multicat_sink->sync_period = 0;
+    upipe_multicat_sink->prealloc = 0;
+    upipe_multicat_sink->next_pending = false;
+    upipe_multicat_sink->next_idx = -1;
+    upipe_multicat_sink->next_fd = -1;
+    upipe_multicat_sink->batch = 0;
+    upipe_multicat_sink->batch_uref = NULL;
+    upipe_multicat_sink->batch_size = 0;
+    upipe_multicat_sink->batch_nb = 0;
     upipe_multicat_sink->flow_def = NULL;
     upipe_throw_ready(upipe);
     return upipe;
@@ -449,10 +692,18 @@ static struct upipe *upipe_multicat_sink_alloc(struct upipe_mgr *mgr,
 static void upipe_multicat_sink_free(struct upipe *upipe)
 {
     struct upipe_multicat_sink *upipe_multicat_sink = upipe_multicat_sink_from_upipe(upipe);
+    upipe_multicat_sink_flush_batch(upipe, NULL);
+    int fd = upipe_multicat_sink_next_get(upipe, upipe_multicat_sink->next_idx);
+    if (fd != -1)
+        close(fd);
     if (upipe_multicat_sink->flow_def != NULL)
         uref_free(upipe_multicat_sink->flow_def);
-    if (upipe_multicat_sink->fsink != NULL)
+    if (upipe_multicat_sink->fsink != NULL) {
+        /* also closes a file descriptor opened ahead */
+        upipe_fsink_set_path(upipe_multicat_sink->fsink, NULL,
+                             UPIPE_FSINK_NONE);
         upipe_release(upipe_multicat_sink->fsink);
+    }
 
     upipe_dbg_va(upipe, "releasing pipe %p", upipe);
     upipe_throw_dead(upipe);
@@ -29,6 +29,7 @@
  */
 
 #include <upipe/ubase.h>
+#include <upipe/ulist.h>
 #include <upipe/uprobe.h>
 #include <upipe/uref_clock.h>
 #include <upipe/uref.h>
@@ -58,7 +59,6 @@
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <fcntl.h>
-#include <sys/mman.h>
 #include <errno.h>
 #include <assert.h>
 
@@ -70,6 +70,24 @@
 #define UBUF_DEFAULT_SIZE       1316
 /** mux number of missing segments */
 #define MISSING_SEGMENTS        5
+/** max number of segments kept in the coarse index */
+#define INDEX_SEGMENTS          32
+
+/** @internal @This is the coarse index of an aux file. */
+struct upipe_msrc_index {
+    /** structure for the list of indexes */
+    struct uchain uchain;
+    /** file index */
+    uint64_t fileidx;
+    /** number of aux entries when the index was built */
+    uint64_t nb_entries;
+    /** number of samples */
+    uint64_t nb_samples;
+    /** dates of one aux entry every stride entries */
+    uint64_t samples[];
+};
+
+UBASE_FROM_TO(upipe_msrc_index, uchain, uchain, uchain)
 
 /** @internal @This is the private context of a multicat source pipe. */
 struct upipe_msrc {
@@ -118,6 +136,13 @@ struct upipe_msrc {
     /** number of missing segments */
     unsigned long missing;
 
+    /** number of aux entries between two samples of the index, or 0 */
+    unsigned int index_stride;
+    /** list of indexes, most recently used first */
+    struct uchain indexes;
+    /** number of indexes in the list */
+    unsigned int nb_indexes;
+
     /** public upipe structure */
     struct upipe upipe;
 };
@@ -191,6 +216,9 @@ static struct upipe *upipe_msrc_alloc(struct upipe_mgr *mgr,
     upipe_msrc->fileidx = -1;
     upipe_msrc->pos = UINT64_MAX;
     upipe_msrc->missing = 0;
+    upipe_msrc->index_stride = 0;
+    ulist_init(&upipe_msrc->indexes);
+    upipe_msrc->nb_indexes = 0;
     upipe_throw_ready(upipe);
     return upipe;
 }
@@ -255,6 +283,168 @@ static int upipe_msrc_setup(struct upipe *upipe)
     return UBASE_ERR_NONE;
 }
 
+/** @internal @This reads the date of an aux entry.
+ *
+ * @param fd aux file descriptor
+ * @param entry index of the entry
+ * @param date_p filled in with the date
+ * @return an error code
+ */
+static int upipe_msrc_aux_read(int fd, uint64_t entry, uint64_t *date_p)
+{
+    uint8_t buf[sizeof(uint64_t)];
+    if (unlikely(pread(fd, buf, sizeof(buf), entry * sizeof(buf)) !=
+                 sizeof(buf)))
+        return UBASE_ERR_EXTERNAL;
+    *date_p = upipe_msrc_ntoh64(buf);
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This looks for the first aux entry dated at or after the given
+ * position, in a range of entries.
+ *
+ * @param fd aux file descriptor
+ * @param low first entry of the range
+ * @param high entry following the range
+ * @param pos position to look for
+ * @param entry_p filled in with the index of the entry, or high if all
+ * entries of the range are before pos
+ * @return an error code
+ */
+static int upipe_msrc_aux_search(int fd, uint64_t low, uint64_t high,
+                                 uint64_t pos, uint64_t *entry_p)
+{
+    while (low < high) {
+        uint64_t mid = low + (high - low) / 2;
+        uint64_t date;
+        UBASE_RETURN(upipe_msrc_aux_read(fd, mid, &date))
+        if (date >= pos)
+            high = mid;
+        else
+            low = mid + 1;
+    }
+    *entry_p = low;
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This flushes the coarse indexes.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_msrc_flush_indexes(struct upipe *upipe)
+{
+    struct upipe_msrc *upipe_msrc = upipe_msrc_from_upipe(upipe);
+    struct uchain *uchain, *uchain_tmp;
+    ulist_delete_foreach(&upipe_msrc->indexes, uchain, uchain_tmp) {
+        ulist_delete(uchain);
+        free(upipe_msrc_index_from_uchain(uchain));
+    }
+    upipe_msrc->nb_indexes = 0;
+}
+
+/** @internal @This returns the coarse index of the current segment, and
+ * builds it if needed.
+ *
+ * @param upipe description structure of the pipe
+ * @param fd aux file descriptor
+ * @param nb_entries number of aux entries
+ * @return pointer to the index, or NULL
+ */
+static struct upipe_msrc_index *upipe_msrc_get_index(struct upipe *upipe,
+                                                     int fd,
+                                                     uint64_t nb_entries)
+{
+    struct upipe_msrc *upipe_msrc = upipe_msrc_from_upipe(upipe);
+    struct uchain *uchain, *uchain_tmp;
+    ulist_delete_foreach(&upipe_msrc->indexes, uchain, uchain_tmp) {
+        struct upipe_msrc_index *index = upipe_msrc_index_from_uchain(uchain);
+        if (index->fileidx != upipe_msrc->fileidx)
+            continue;
+        ulist_delete(uchain);
+        if (likely(index->nb_entries <= nb_entries)) {
+            /* the segment may have grown since */
+            ulist_unshift(&upipe_msrc->indexes, uchain);
+            return index;
+        }
+        /* the segment was rewritten */
+        free(index);
+        upipe_msrc->nb_indexes--;
+        break;
+    }
+
+    unsigned int stride = upipe_msrc->index_stride;
+    uint64_t nb_samples = (nb_entries + stride - 1) / stride;
+    struct upipe_msrc_index *index =
+        malloc(sizeof(struct upipe_msrc_index) +
+               nb_samples * sizeof(uint64_t));
+    if (unlikely(index == NULL))
+        return NULL;
+    for (uint64_t i = 0; i < nb_samples; i++) {
+        if (unlikely(!ubase_check(upipe_msrc_aux_read(fd, i * stride,
+                                                      &index->samples[i])))) {
+            free(index);
+            return NULL;
+        }
+    }
+    index->fileidx = upipe_msrc->fileidx;
+    index->nb_entries = nb_entries;
+    index->nb_samples = nb_samples;
+    upipe_dbg_va(upipe, "indexed segment %"PRIu64" with %"PRIu64" samples",
+                 index->fileidx, nb_samples);
+
+    if (upipe_msrc->nb_indexes >= INDEX_SEGMENTS) {
+        uchain = upipe_msrc->indexes.prev;
+        ulist_delete(uchain);
+        free(upipe_msrc_index_from_uchain(uchain));
+        upipe_msrc->nb_indexes--;
+    }
+    ulist_unshift(&upipe_msrc->indexes, upipe_msrc_index_to_uchain(index));
+    upipe_msrc->nb_indexes++;
+    return index;
+}
+
+/** @internal @This looks for the first aux entry of the current segment
+ * dated at or after the current position.
+ *
+ * @param upipe description structure of the pipe
+ * @param fd aux file descriptor
+ * @param nb_entries number of aux entries
+ * @param entry_p filled in with the index of the entry
+ * @return an error code
+ */
+static int upipe_msrc_seek(struct upipe *upipe, int fd, uint64_t nb_entries,
+                           uint64_t *entry_p)
+{
+    struct upipe_msrc *upipe_msrc = upipe_msrc_from_upipe(upipe);
+    uint64_t low = 0, high = nb_entries;
+
+    struct upipe_msrc_index *index = NULL;
+    if (upipe_msrc->index_stride)
+        index = upipe_msrc_get_index(upipe, fd, nb_entries);
+    if (index != NULL) {
+        uint64_t stride = upipe_msrc->index_stride;
+        uint64_t sample_low = 0, sample_high = index->nb_samples;
+        while (sample_low < sample_high) {
+            uint64_t mid = sample_low + (sample_high - sample_low) / 2;
+            if (index->samples[mid] >= upipe_msrc->pos)
+                sample_high = mid;
+            else
+                sample_low = mid + 1;
+        }
+        if (sample_low)
+            low = (sample_low - 1) * stride;
+        if (sample_low < index->nb_samples)
+            high = sample_low * stride;
+    }
+
+    UBASE_RETURN(upipe_msrc_aux_search(fd, low, high, upipe_msrc->pos,
+                                       entry_p))
+    /* start from the last entry if the position is not reached yet */
+    if (*entry_p == nb_entries)
+        *entry_p = nb_entries - 1;
+    return UBASE_ERR_NONE;
+}
+
 /** @internal @This starts the reader.
  *
  * @param upipe description structure of the pipe
@@ -271,7 +461,9 @@ static int upipe_msrc_start(struct upipe *upipe)
     UBASE_RETURN(uref_msrc_flow_get_aux(upipe_msrc->flow_def_input, &aux))
     uref_msrc_flow_get_rotate(upipe_msrc->flow_def_input, &rotate);
     uref_msrc_flow_get_offset(upipe_msrc->flow_def_input, &offset);
-    upipe_msrc->fileidx = (upipe_msrc->pos - offset) / rotate;
+    /* positions before the first segment start from it */
+    upipe_msrc->fileidx = upipe_msrc->pos > offset ?
+                          (upipe_msrc->pos - offset) / rotate : 0;
 
     char aux_file[strlen(path) + strlen(aux) +
                   sizeof(".18446744073709551615")];
@@ -286,39 +478,16 @@ static int upipe_msrc_start(struct upipe *upipe)
     }
 
     struct stat aux_stat;
+    uint64_t offset1;
     if (unlikely(fstat(fd, &aux_stat) == -1 ||
-                 aux_stat.st_size < sizeof(uint64_t))) {
+                 aux_stat.st_size < sizeof(uint64_t) ||
+                 !ubase_check(upipe_msrc_seek(upipe, fd,
+                         aux_stat.st_size / sizeof(uint64_t), &offset1)))) {
+        close(fd);
         upipe_warn_va(upipe, "invalid segment %"PRIu64, upipe_msrc->fileidx);
         /* try next file anyway */
         return upipe_msrc_skip(upipe);
     }
-
-    uint8_t *aux_buf = mmap(NULL, aux_stat.st_size, PROT_READ, MAP_SHARED,
-                            fd, 0);
-    if (unlikely(aux_buf == MAP_FAILED)) {
-        upipe_err_va(upipe,
-                     "unable to mmap segment %"PRIu64, upipe_msrc->fileidx);
-        return UBASE_ERR_EXTERNAL;
-    }
-
-    uint64_t offset1 = 0;
-    uint64_t offset2 = aux_stat.st_size / sizeof(uint64_t);
-
-    for ( ; ; ) {
-        uint64_t mid_offset = (offset1 + offset2) / 2;
-        uint64_t mid_aux = upipe_msrc_ntoh64(aux_buf +
-                                             mid_offset * sizeof(uint64_t));
-
-        if (offset1 == mid_offset)
-            break;
-
-        if (mid_aux >= upipe_msrc->pos)
-            offset2 = mid_offset;
-        else
-            offset1 = mid_offset;
-    }
-
-    munmap(aux_buf, aux_stat.st_size);
     close(fd);
 
     UBASE_RETURN(upipe_msrc_setup(upipe))
@@ -539,6 +708,7 @@ static int upipe_msrc_set_flow_def(struct upipe *upipe, struct uref *flow_def)
         return UBASE_ERR_INVALID;
 
     upipe_msrc_close(upipe);
+    upipe_msrc_flush_indexes(upipe);
     ubuf_mgr_release(upipe_msrc->ubuf_mgr);
     upipe_msrc->ubuf_mgr = NULL;
     uref_free(upipe_msrc->flow_def_input);
@@ -629,6 +799,21 @@ static int _upipe_msrc_control(struct upipe *upipe, int command, va_list args)
             return upipe_msrc_get_position(upipe, p);
         }
 
+        case UPIPE_MSRC_GET_INDEX_STRIDE: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_MSRC_SIGNATURE)
+            struct upipe_msrc *upipe_msrc = upipe_msrc_from_upipe(upipe);
+            unsigned int *p = va_arg(args, unsigned int *);
+            *p = upipe_msrc->index_stride;
+            return UBASE_ERR_NONE;
+        }
+        case UPIPE_MSRC_SET_INDEX_STRIDE: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_MSRC_SIGNATURE)
+            struct upipe_msrc *upipe_msrc = upipe_msrc_from_upipe(upipe);
+            upipe_msrc->index_stride = va_arg(args, unsigned int);
+            upipe_msrc_flush_indexes(upipe);
+            return UBASE_ERR_NONE;
+        }
+
         default:
             return UBASE_ERR_UNHANDLED;
     }
@@ -660,6 +845,7 @@ static void upipe_msrc_free(struct upipe *upipe)
     upipe_throw_dead(upipe);
 
     struct upipe_msrc *upipe_msrc = upipe_msrc_from_upipe(upipe);
+    upipe_msrc_flush_indexes(upipe);
     uref_free(upipe_msrc->flow_def_input);
     upipe_msrc_clean_output_size(upipe);
     upipe_msrc_clean_upump(upipe);
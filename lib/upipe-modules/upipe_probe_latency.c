@@ -0,0 +1,575 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short Upipe modules measuring the latency of urefs across a pipeline
+ */
+
+#include <upipe/ubase.h>
+#include <upipe/uprobe.h>
+#include <upipe/uclock.h>
+#include <upipe/uref.h>
+#include <upipe/upipe.h>
+#include <upipe/upipe_helper_upipe.h>
+#include <upipe/upipe_helper_urefcount.h>
+#include <upipe/upipe_helper_void.h>
+#include <upipe/upipe_helper_output.h>
+#include <upipe/upipe_helper_uclock.h>
+#include <upipe/uhist.h>
+#include <upipe-modules/upipe_probe_latency.h>
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+/** default report interval */
+#define DEFAULT_INTERVAL UCLOCK_FREQ
+
+/** @internal @This is the private context of a latency stamp pipe. */
+struct upipe_probe_latency_stamp {
+    /** refcount management structure */
+    struct urefcount urefcount;
+
+    /** uclock structure */
+    struct uclock *uclock;
+    /** uclock request */
+    struct urequest uclock_request;
+
+    /** output pipe */
+    struct upipe *output;
+    /** flow_definition packet */
+    struct uref *flow_def;
+    /** output state */
+    enum upipe_helper_output_state output_state;
+    /** list of output requests */
+    struct uchain request_list;
+
+    /** public upipe structure */
+    struct upipe upipe;
+};
+
+/** @hidden */
+static int upipe_probe_latency_stamp_check(struct upipe *upipe,
+                                           struct uref *flow_format);
+
+UPIPE_HELPER_UPIPE(upipe_probe_latency_stamp, upipe,
+                   UPIPE_PROBE_LATENCY_STAMP_SIGNATURE);
+UPIPE_HELPER_UREFCOUNT(upipe_probe_latency_stamp, urefcount,
+                       upipe_probe_latency_stamp_free)
+UPIPE_HELPER_VOID(upipe_probe_latency_stamp)
+UPIPE_HELPER_OUTPUT(upipe_probe_latency_stamp, output, flow_def, output_state,
+                    request_list);
+UPIPE_HELPER_UCLOCK(upipe_probe_latency_stamp, uclock, uclock_request,
+                    upipe_probe_latency_stamp_check,
+                    upipe_probe_latency_stamp_register_output_request,
+                    upipe_probe_latency_stamp_unregister_output_request);
+
+/** @internal @This stamps an incoming uref with the current date.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref uref structure
+ * @param upump_p reference to pump that generated the buffer
+ */
+static void upipe_probe_latency_stamp_input(struct upipe *upipe,
+                                            struct uref *uref,
+                                            struct upump **upump_p)
+{
+    struct upipe_probe_latency_stamp *upipe_probe_latency_stamp =
+        upipe_probe_latency_stamp_from_upipe(upipe);
+    uint64_t ingress;
+    if (likely(upipe_probe_latency_stamp->uclock != NULL) &&
+        !ubase_check(uref_probe_latency_get_ingress(uref, &ingress)))
+        uref_probe_latency_set_ingress(uref,
+                uclock_now(upipe_probe_latency_stamp->uclock));
+    upipe_probe_latency_stamp_output(upipe, uref, upump_p);
+}
+
+/** @internal @This sets the input flow definition.
+ *
+ * @param upipe description structure of the pipe
+ * @param flow_def flow definition packet
+ * @return an error code
+ */
+static int upipe_probe_latency_stamp_set_flow_def(struct upipe *upipe,
+                                                  struct uref *flow_def)
+{
+    if (flow_def == NULL)
+        return UBASE_ERR_INVALID;
+    struct uref *flow_def_dup;
+    if ((flow_def_dup = uref_dup(flow_def)) == NULL)
+        return UBASE_ERR_ALLOC;
+    upipe_probe_latency_stamp_store_flow_def(upipe, flow_def_dup);
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This requires a uclock if there is none.
+ *
+ * @param upipe description structure of the pipe
+ * @param flow_format amended flow format
+ * @return an error code
+ */
+static int upipe_probe_latency_stamp_check(struct upipe *upipe,
+                                           struct uref *flow_format)
+{
+    struct upipe_probe_latency_stamp *upipe_probe_latency_stamp =
+        upipe_probe_latency_stamp_from_upipe(upipe);
+    if (flow_format != NULL)
+        uref_free(flow_format);
+    if (unlikely(upipe_probe_latency_stamp->uclock == NULL))
+        upipe_probe_latency_stamp_require_uclock(upipe);
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This processes control commands on a latency stamp pipe.
+ *
+ * @param upipe description structure of the pipe
+ * @param command type of command to process
+ * @param args arguments of the command
+ * @return an error code
+ */
+static int _upipe_probe_latency_stamp_control(struct upipe *upipe,
+                                              int command, va_list args)
+{
+    UBASE_HANDLED_RETURN(
+        upipe_probe_latency_stamp_control_output(upipe, command, args));
+    switch (command) {
+        case UPIPE_ATTACH_UCLOCK:
+            upipe_probe_latency_stamp_require_uclock(upipe);
+            return UBASE_ERR_NONE;
+
+        case UPIPE_SET_FLOW_DEF: {
+            struct uref *flow_def = va_arg(args, struct uref *);
+            return upipe_probe_latency_stamp_set_flow_def(upipe, flow_def);
+        }
+
+        default:
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** @internal @This processes control commands on a latency stamp pipe, and
+ * checks the status of the pipe afterwards.
+ *
+ * @param upipe description structure of the pipe
+ * @param command type of command to process
+ * @param args arguments of the command
+ * @return an error code
+ */
+static int upipe_probe_latency_stamp_control(struct upipe *upipe,
+                                             int command, va_list args)
+{
+    UBASE_RETURN(_upipe_probe_latency_stamp_control(upipe, command, args));
+    return upipe_probe_latency_stamp_check(upipe, NULL);
+}
+
+/** @internal @This allocates a latency stamp pipe.
+ *
+ * @param mgr common management structure
+ * @param uprobe structure used to raise events
+ * @param signature signature of the pipe allocator
+ * @param args optional arguments
+ * @return pointer to upipe or NULL in case of allocation error
+ */
+static struct upipe *upipe_probe_latency_stamp_alloc(struct upipe_mgr *mgr,
+                                                     struct uprobe *uprobe,
+                                                     uint32_t signature,
+                                                     va_list args)
+{
+    struct upipe *upipe = upipe_probe_latency_stamp_alloc_void(mgr, uprobe,
+                                                               signature, args);
+    if (unlikely(upipe == NULL))
+        return NULL;
+
+    upipe_probe_latency_stamp_init_urefcount(upipe);
+    upipe_probe_latency_stamp_init_output(upipe);
+    upipe_probe_latency_stamp_init_uclock(upipe);
+    upipe_throw_ready(upipe);
+    return upipe;
+}
+
+/** @internal @This frees all resources allocated.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_probe_latency_stamp_free(struct upipe *upipe)
+{
+    upipe_throw_dead(upipe);
+    upipe_probe_latency_stamp_clean_uclock(upipe);
+    upipe_probe_latency_stamp_clean_output(upipe);
+    upipe_probe_latency_stamp_clean_urefcount(upipe);
+    upipe_probe_latency_stamp_free_void(upipe);
+}
+
+/** @internal @This is the static latency stamp pipe manager. */
+static struct upipe_mgr upipe_probe_latency_stamp_mgr = {
+    .refcount = NULL,
+    .signature = UPIPE_PROBE_LATENCY_STAMP_SIGNATURE,
+
+    .upipe_alloc = upipe_probe_latency_stamp_alloc,
+    .upipe_input = upipe_probe_latency_stamp_input,
+    .upipe_control = upipe_probe_latency_stamp_control,
+
+    .upipe_mgr_control = NULL
+};
+
+/** @This returns the management structure for latency stamp pipes.
+ *
+ * @return pointer to manager
+ */
+struct upipe_mgr *upipe_probe_latency_stamp_mgr_alloc(void)
+{
+    return &upipe_probe_latency_stamp_mgr;
+}
+
+/** @internal @This is the private context of a latency meter pipe. */
+struct upipe_probe_latency_meter {
+    /** refcount management structure */
+    struct urefcount urefcount;
+
+    /** uclock structure */
+    struct uclock *uclock;
+    /** uclock request */
+    struct urequest uclock_request;
+
+    /** output pipe */
+    struct upipe *output;
+    /** flow_definition packet */
+    struct uref *flow_def;
+    /** output state */
+    enum upipe_helper_output_state output_state;
+    /** list of output requests */
+    struct uchain request_list;
+
+    /** report interval */
+    uint64_t interval;
+    /** date of the beginning of the window, or UINT64_MAX */
+    uint64_t window_start;
+    /** number of urefs without a stamp in the window */
+    uint64_t missing;
+    /** latency histogram of the window */
+    struct uhist hist;
+
+    /** public upipe structure */
+    struct upipe upipe;
+};
+
+/** @hidden */
+static int upipe_probe_latency_meter_check(struct upipe *upipe,
+                                           struct uref *flow_format);
+
+UPIPE_HELPER_UPIPE(upipe_probe_latency_meter, upipe,
+                   UPIPE_PROBE_LATENCY_METER_SIGNATURE);
+UPIPE_HELPER_UREFCOUNT(upipe_probe_latency_meter, urefcount,
+                       upipe_probe_latency_meter_free)
+UPIPE_HELPER_VOID(upipe_probe_latency_meter)
+UPIPE_HELPER_OUTPUT(upipe_probe_latency_meter, output, flow_def, output_state,
+                    request_list);
+UPIPE_HELPER_UCLOCK(upipe_probe_latency_meter, uclock, uclock_request,
+                    upipe_probe_latency_meter_check,
+                    upipe_probe_latency_meter_register_output_request,
+                    upipe_probe_latency_meter_unregister_output_request);
+
+/** @internal @This resets the measurement window.
+ *
+ * @param upipe description structure of the pipe
+ * @param now date of the beginning of the new window
+ */
+static void upipe_probe_latency_meter_reset(struct upipe *upipe, uint64_t now)
+{
+    struct upipe_probe_latency_meter *upipe_probe_latency_meter =
+        upipe_probe_latency_meter_from_upipe(upipe);
+    upipe_probe_latency_meter->window_start = now;
+    upipe_probe_latency_meter->missing = 0;
+    uhist_init(&upipe_probe_latency_meter->hist);
+}
+
+/** @internal @This computes the statistics of the current window.
+ *
+ * @param upipe description structure of the pipe
+ * @param now current date, or UINT64_MAX
+ * @param stats filled in with the statistics
+ */
+static void upipe_probe_latency_meter_compute(struct upipe *upipe,
+        uint64_t now, struct upipe_probe_latency_stats *stats)
+{
+    struct upipe_probe_latency_meter *upipe_probe_latency_meter =
+        upipe_probe_latency_meter_from_upipe(upipe);
+    const struct uhist *hist = &upipe_probe_latency_meter->hist;
+
+    memset(stats, 0, sizeof(*stats));
+    if (now != UINT64_MAX &&
+        upipe_probe_latency_meter->window_start != UINT64_MAX &&
+        now > upipe_probe_latency_meter->window_start)
+        stats->duration = now - upipe_probe_latency_meter->window_start;
+    stats->count = hist->count;
+    stats->missing = upipe_probe_latency_meter->missing;
+    if (!hist->count)
+        return;
+
+    stats->min = hist->min;
+    stats->max = hist->max;
+    stats->mean = uhist_mean(hist);
+
+    /* ranks are rounded up, so that p999 of less than 1000 values is the
+     * maximum */
+    static const unsigned int permille[] = { 500, 900, 990, 999 };
+    uint64_t quantiles[UBASE_ARRAY_SIZE(permille)];
+    uhist_quantiles(hist, UBASE_ARRAY_SIZE(permille), permille, quantiles);
+    stats->p50 = quantiles[0];
+    stats->p90 = quantiles[1];
+    stats->p99 = quantiles[2];
+    stats->p999 = quantiles[3];
+}
+
+/** @internal @This reports the statistics of the current window and starts
+ * a new one.
+ *
+ * @param upipe description structure of the pipe
+ * @param now current date
+ */
+static void upipe_probe_latency_meter_report(struct upipe *upipe,
+                                             uint64_t now)
+{
+    struct upipe_probe_latency_stats stats;
+    upipe_probe_latency_meter_compute(upipe, now, &stats);
+    upipe_throw(upipe, UPROBE_PROBE_LATENCY_REPORT,
+                UPIPE_PROBE_LATENCY_METER_SIGNATURE, &stats);
+    upipe_probe_latency_meter_reset(upipe, now);
+}
+
+/** @internal @This measures the latency of an incoming uref.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref uref structure
+ * @param upump_p reference to pump that generated the buffer
+ */
+static void upipe_probe_latency_meter_input(struct upipe *upipe,
+                                            struct uref *uref,
+                                            struct upump **upump_p)
+{
+    struct upipe_probe_latency_meter *upipe_probe_latency_meter =
+        upipe_probe_latency_meter_from_upipe(upipe);
+    if (unlikely(upipe_probe_latency_meter->uclock == NULL)) {
+        upipe_probe_latency_meter_output(upipe, uref, upump_p);
+        return;
+    }
+
+    uint64_t now = uclock_now(upipe_probe_latency_meter->uclock);
+    if (unlikely(upipe_probe_latency_meter->window_start == UINT64_MAX))
+        upipe_probe_latency_meter->window_start = now;
+    else if (upipe_probe_latency_meter->interval &&
+             now >= upipe_probe_latency_meter->window_start +
+                    upipe_probe_latency_meter->interval)
+        upipe_probe_latency_meter_report(upipe, now);
+
+    uint64_t ingress;
+    if (unlikely(!ubase_check(uref_probe_latency_get_ingress(uref,
+                                                             &ingress)))) {
+        upipe_probe_latency_meter->missing++;
+    } else {
+        /* a stamp in the future means the clocks differ, count it as 0 */
+        uhist_add(&upipe_probe_latency_meter->hist,
+                  now > ingress ? now - ingress : 0);
+    }
+
+    upipe_probe_latency_meter_output(upipe, uref, upump_p);
+}
+
+/** @internal @This sets the input flow definition.
+ *
+ * @param upipe description structure of the pipe
+ * @param flow_def flow definition packet
+ * @return an error code
+ */
+static int upipe_probe_latency_meter_set_flow_def(struct upipe *upipe,
+                                                  struct uref *flow_def)
+{
+    if (flow_def == NULL)
+        return UBASE_ERR_INVALID;
+    struct uref *flow_def_dup;
+    if ((flow_def_dup = uref_dup(flow_def)) == NULL)
+        return UBASE_ERR_ALLOC;
+    upipe_probe_latency_meter_store_flow_def(upipe, flow_def_dup);
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This requires a uclock if there is none.
+ *
+ * @param upipe description structure of the pipe
+ * @param flow_format amended flow format
+ * @return an error code
+ */
+static int upipe_probe_latency_meter_check(struct upipe *upipe,
+                                           struct uref *flow_format)
+{
+    struct upipe_probe_latency_meter *upipe_probe_latency_meter =
+        upipe_probe_latency_meter_from_upipe(upipe);
+    if (flow_format != NULL)
+        uref_free(flow_format);
+    if (unlikely(upipe_probe_latency_meter->uclock == NULL))
+        upipe_probe_latency_meter_require_uclock(upipe);
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This processes control commands on a latency meter pipe.
+ *
+ * @param upipe description structure of the pipe
+ * @param command type of command to process
+ * @param args arguments of the command
+ * @return an error code
+ */
+static int _upipe_probe_latency_meter_control(struct upipe *upipe,
+                                              int command, va_list args)
+{
+    struct upipe_probe_latency_meter *upipe_probe_latency_meter =
+        upipe_probe_latency_meter_from_upipe(upipe);
+
+    UBASE_HANDLED_RETURN(
+        upipe_probe_latency_meter_control_output(upipe, command, args));
+    switch (command) {
+        case UPIPE_ATTACH_UCLOCK:
+            upipe_probe_latency_meter_require_uclock(upipe);
+            return UBASE_ERR_NONE;
+
+        case UPIPE_SET_FLOW_DEF: {
+            struct uref *flow_def = va_arg(args, struct uref *);
+            return upipe_probe_latency_meter_set_flow_def(upipe, flow_def);
+        }
+
+        case UPIPE_PROBE_LATENCY_SET_INTERVAL: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_PROBE_LATENCY_METER_SIGNATURE);
+            upipe_probe_latency_meter->interval = va_arg(args, uint64_t);
+            return UBASE_ERR_NONE;
+        }
+        case UPIPE_PROBE_LATENCY_GET_INTERVAL: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_PROBE_LATENCY_METER_SIGNATURE);
+            uint64_t *interval_p = va_arg(args, uint64_t *);
+            *interval_p = upipe_probe_latency_meter->interval;
+            return UBASE_ERR_NONE;
+        }
+        case UPIPE_PROBE_LATENCY_GET_STATS: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_PROBE_LATENCY_METER_SIGNATURE);
+            struct upipe_probe_latency_stats *stats =
+                va_arg(args, struct upipe_probe_latency_stats *);
+            uint64_t now = upipe_probe_latency_meter->uclock != NULL ?
+                uclock_now(upipe_probe_latency_meter->uclock) : UINT64_MAX;
+            upipe_probe_latency_meter_compute(upipe, now, stats);
+            return UBASE_ERR_NONE;
+        }
+
+        default:
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** @internal @This processes control commands on a latency meter pipe, and
+ * checks the status of the pipe afterwards.
+ *
+ * @param upipe description structure of the pipe
+ * @param command type of command to process
+ * @param args arguments of the command
+ * @return an error code
+ */
+static int upipe_probe_latency_meter_control(struct upipe *upipe,
+                                             int command, va_list args)
+{
+    UBASE_RETURN(_upipe_probe_latency_meter_control(upipe, command, args));
+    return upipe_probe_latency_meter_check(upipe, NULL);
+}
+
+/** @internal @This allocates a latency meter pipe.
+ *
+ * @param mgr common management structure
+ * @param uprobe structure used to raise events
+ * @param signature signature of the pipe allocator
+ * @param args optional arguments
+ * @return pointer to upipe or NULL in case of allocation error
+ */
+static struct upipe *upipe_probe_latency_meter_alloc(struct upipe_mgr *mgr,
+                                                     struct uprobe *uprobe,
+                                                     uint32_t signature,
+                                                     va_list args)
+{
+    struct upipe *upipe = upipe_probe_latency_meter_alloc_void(mgr, uprobe,
+                                                               signature, args);
+    if (unlikely(upipe == NULL))
+        return NULL;
+
+    struct upipe_probe_latency_meter *upipe_probe_latency_meter =
+        upipe_probe_latency_meter_from_upipe(upipe);
+    upipe_probe_latency_meter_init_urefcount(upipe);
+    upipe_probe_latency_meter_init_output(upipe);
+    upipe_probe_latency_meter_init_uclock(upipe);
+    upipe_probe_latency_meter->interval = DEFAULT_INTERVAL;
+    upipe_probe_latency_meter_reset(upipe, UINT64_MAX);
+    upipe_throw_ready(upipe);
+    return upipe;
+}
+
+/** @internal @This frees all resources allocated, after reporting the last
+ * window.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_probe_latency_meter_free(struct upipe *upipe)
+{
+    struct upipe_probe_latency_meter *upipe_probe_latency_meter =
+        upipe_probe_latency_meter_from_upipe(upipe);
+    if (upipe_probe_latency_meter->hist.count ||
+        upipe_probe_latency_meter->missing)
+        upipe_probe_latency_meter_report(upipe,
+                upipe_probe_latency_meter->uclock != NULL ?
+                uclock_now(upipe_probe_latency_meter->uclock) : UINT64_MAX);
+
+    upipe_throw_dead(upipe);
+    upipe_probe_latency_meter_clean_uclock(upipe);
+    upipe_probe_latency_meter_clean_output(upipe);
+    upipe_probe_latency_meter_clean_urefcount(upipe);
+    upipe_probe_latency_meter_free_void(upipe);
+}
+
+/** @internal @This is the static latency meter pipe manager. */
+static struct upipe_mgr upipe_probe_latency_meter_mgr = {
+    .refcount = NULL,
+    .signature = UPIPE_PROBE_LATENCY_METER_SIGNATURE,
+
+    .upipe_command_str = upipe_probe_latency_command_str,
+    .upipe_event_str = upipe_probe_latency_event_str,
+    .upipe_alloc = upipe_probe_latency_meter_alloc,
+    .upipe_input = upipe_probe_latency_meter_input,
+    .upipe_control = upipe_probe_latency_meter_control,
+
+    .upipe_mgr_control = NULL
+};
+
+/** @This returns the management structure for latency meter pipes.
+ *
+ * @return pointer to manager
+ */
+struct upipe_mgr *upipe_probe_latency_meter_mgr_alloc(void)
+{
+    return &upipe_probe_latency_meter_mgr;
+}
@@ -28,7 +28,10 @@
  */
 
 #include <upipe/ubase.h>
+#include <upipe/uatomic.h>
 #include <upipe/uqueue.h>
+#include <upipe/uref.h>
+#include <upipe/ubuf_size.h>
 #include <upipe/upipe.h>
 
 #include <assert.h>
@@ -44,6 +47,15 @@ struct upipe_queue {
     /** out of band upstream queue */
     struct uqueue upstream_oob;
 
+    /** octets of the urefs currently in the queue */
+    uatomic_uint32_t bytes;
+    /** set by the sink while it waits for the queue to drain */
+    uatomic_uint32_t waiting;
+    /** number of urefs at or below which the sink is woken up */
+    uatomic_uint32_t low_length;
+    /** number of octets at or below which the sink is woken up */
+    uatomic_uint32_t low_bytes;
+
     /** public upipe structure */
     struct upipe upipe;
 };
@@ -59,6 +71,62 @@ static inline struct upipe_queue *upipe_queue(struct upipe *upipe)
     return container_of(upipe, struct upipe_queue, upipe);
 }
 
+/** @internal @This returns the number of octets accounted for a uref in the
+ * queue, which is the size of its block, picture or sound buffer.
+ *
+ * @param uref uref structure
+ * @return size in octets
+ */
+static inline uint32_t upipe_queue_uref_size(struct uref *uref)
+{
+    size_t size;
+    if (uref->ubuf == NULL || !ubase_check(ubuf_size(uref->ubuf, &size)))
+        return 0;
+    return size;
+}
+
+/** @internal @This checks if the queue has drained to the low watermarks.
+ *
+ * @param queue pointer to the upipe_queue structure
+ * @return true if the sink may push again
+ */
+static inline bool upipe_queue_drained(struct upipe_queue *queue)
+{
+    return uqueue_length(&queue->uqueue) <= uatomic_load(&queue->low_length) &&
+           uatomic_load(&queue->bytes) <= uatomic_load(&queue->low_bytes);
+}
+
+/** @internal @This is called by the sink to wait for the queue to drain.
+ * The push event of the queue is cleared and the source is asked to raise it
+ * again when the low watermarks are reached.
+ *
+ * @param queue pointer to the upipe_queue structure
+ * @return true if the queue has already drained
+ */
+static inline bool upipe_queue_sink_wait(struct upipe_queue *queue)
+{
+    uatomic_store(&queue->waiting, 1);
+    ueventfd_read(&queue->uqueue.event_push);
+    if (!upipe_queue_drained(queue))
+        return false;
+    uatomic_store(&queue->waiting, 0);
+    return true;
+}
+
+/** @internal @This is called by the source after it popped urefs, to wake up
+ * the sink if it is waiting and the queue has drained.
+ *
+ * @param queue pointer to the upipe_queue structure
+ */
+static inline void upipe_queue_source_wake(struct upipe_queue *queue)
+{
+    if (likely(!uatomic_load(&queue->waiting)) || !upipe_queue_drained(queue))
+        return;
+    uint32_t expected = 1;
+    if (uatomic_compare_exchange(&queue->waiting, &expected, 0))
+        ueventfd_write(&queue->uqueue.event_push);
+}
+
 /** @internal @This is a super-set of @ref urequest. */
 struct upipe_queue_request {
     /** refcount management structure */
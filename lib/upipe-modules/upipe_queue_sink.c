@@ -53,6 +53,9 @@
 #include <string.h>
 #include <assert.h>
 
+/** maximum number of urefs pushed to the queue at once */
+#define UPIPE_QSINK_BATCH 32
+
 /** @hidden */
 static void upipe_qsink_watcher(struct upump *upump);
 /** @hidden */
@@ -84,6 +87,14 @@ struct upipe_qsink {
 
     /** pointer to queue source */
     struct upipe *qsrc;
+    /** number of polls of a full queue before waiting */
+    unsigned int spin;
+    /** number of urefs at which the sink blocks */
+    unsigned int high;
+    /** number of octets at which the sink blocks, or 0 */
+    unsigned int high_bytes;
+    /** true if watermark events are thrown */
+    bool watermark_events;
     /** temporary uref storage */
     struct uchain urefs;
     /** nb urefs in storage */
@@ -134,6 +145,10 @@ static struct upipe *_upipe_qsink_alloc(struct upipe_mgr *mgr,
     upipe_qsink_init_upump_oob(upipe);
     upipe_qsink_init_input(upipe);
     upipe_qsink->qsrc = upipe_use(qsrc);
+    upipe_qsink->spin = 0;
+    upipe_qsink->high = upipe_queue(qsrc)->max_length;
+    upipe_qsink->high_bytes = 0;
+    upipe_qsink->watermark_events = false;
     upipe_qsink->flow_def = NULL;
     upipe_qsink->flow_def_sent = false;
     upipe_qsink->output = NULL;
@@ -148,6 +163,45 @@ upipe_qsink_alloc_err:
     return NULL;
 }
 
+/** @internal @This throws an event when the queue crosses a watermark, if
+ * watermarks have been set.
+ *
+ * @param upipe description structure of the pipe
+ * @param event UPROBE_QSINK_HIGH_WATERMARK or UPROBE_QSINK_LOW_WATERMARK
+ * @return an error code
+ */
+static int upipe_qsink_throw_watermark(struct upipe *upipe, int event)
+{
+    struct upipe_qsink *upipe_qsink = upipe_qsink_from_upipe(upipe);
+    if (!upipe_qsink->watermark_events)
+        return UBASE_ERR_NONE;
+
+    struct upipe_queue *queue = upipe_queue(upipe_qsink->qsrc);
+    unsigned int length = uqueue_length(&queue->uqueue);
+    unsigned int bytes = uatomic_load(&queue->bytes);
+    upipe_verbose_va(upipe, "throw %s (%u urefs, %u octets)",
+                     uprobe_qsink_event_str(event), length, bytes);
+    return upipe_throw(upipe, event, UPIPE_QSINK_SIGNATURE, length, bytes);
+}
+
+/** @internal @This returns the number of urefs that may be pushed before
+ * reaching the high watermarks.
+ *
+ * @param upipe description structure of the pipe
+ * @return number of urefs, 0 if the queue is above a high watermark
+ */
+static unsigned int upipe_qsink_room(struct upipe *upipe)
+{
+    struct upipe_qsink *upipe_qsink = upipe_qsink_from_upipe(upipe);
+    struct upipe_queue *queue = upipe_queue(upipe_qsink->qsrc);
+    unsigned int length = uqueue_length(&queue->uqueue);
+    if (length >= upipe_qsink->high ||
+        (upipe_qsink->high_bytes &&
+         uatomic_load(&queue->bytes) >= upipe_qsink->high_bytes))
+        return 0;
+    return upipe_qsink->high - length;
+}
+
 /** @internal @This outputs data to the queue.
  *
  * @param upipe description structure of the pipe
@@ -159,26 +213,110 @@ static bool upipe_qsink_output(struct upipe *upipe, struct uref *uref,
                                struct upump **upump_p)
 {
     struct upipe_qsink *upipe_qsink = upipe_qsink_from_upipe(upipe);
-    return uqueue_push(&upipe_queue(upipe_qsink->qsrc)->uqueue,
-                       uref_to_uchain(uref));
+    struct upipe_queue *queue = upipe_queue(upipe_qsink->qsrc);
+    if (unlikely(!upipe_qsink_room(upipe)))
+        return false;
+
+    /* account for the octets before the source may pop the uref */
+    uint32_t size = upipe_queue_uref_size(uref);
+    uatomic_fetch_add(&queue->bytes, size);
+    if (unlikely(!uqueue_push(&queue->uqueue, uref_to_uchain(uref)))) {
+        uatomic_fetch_sub(&queue->bytes, size);
+        return false;
+    }
+    return true;
 }
 
-/** @internal @This is called when the queue can be written again.
- * Unblock the sink.
+/** @internal @This outputs data to the queue, polling a full queue for a
+ * while before giving up, which avoids waiting on the watcher when the
+ * queue source is draining it.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref uref structure
+ * @param upump_p reference to pump that generated the buffer
+ * @return true if the output could be written
+ */
+static bool upipe_qsink_output_spin(struct upipe *upipe, struct uref *uref,
+                                    struct upump **upump_p)
+{
+    struct upipe_qsink *upipe_qsink = upipe_qsink_from_upipe(upipe);
+    struct upipe_queue *queue = upipe_queue(upipe_qsink->qsrc);
+    if (likely(upipe_qsink_output(upipe, uref, upump_p)))
+        return true;
+
+    for (unsigned int i = 0; i < upipe_qsink->spin; i++)
+        if (upipe_queue_drained(queue))
+            return upipe_qsink_output(upipe, uref, upump_p);
+    return false;
+}
+
+/** @internal @This outputs the held urefs to the queue, in batches.
+ *
+ * @param upipe description structure of the pipe
+ * @return true if all urefs could be output
+ */
+static bool upipe_qsink_output_batch(struct upipe *upipe)
+{
+    struct upipe_qsink *upipe_qsink = upipe_qsink_from_upipe(upipe);
+    struct upipe_queue *queue = upipe_queue(upipe_qsink->qsrc);
+    void *uchains[UPIPE_QSINK_BATCH];
+    uint32_t sizes[UPIPE_QSINK_BATCH];
+
+    while (!upipe_qsink_check_input(upipe)) {
+        unsigned int room = upipe_qsink_room(upipe);
+        if (!room)
+            return false;
+        if (room > UPIPE_QSINK_BATCH)
+            room = UPIPE_QSINK_BATCH;
+
+        unsigned int nb = 0;
+        uint32_t bytes = uatomic_load(&queue->bytes);
+        uint32_t batch_bytes = 0;
+        struct uref *uref;
+        while (nb < room &&
+               (!upipe_qsink->high_bytes ||
+                bytes + batch_bytes < upipe_qsink->high_bytes) &&
+               (uref = upipe_qsink_pop_input(upipe)) != NULL) {
+            sizes[nb] = upipe_queue_uref_size(uref);
+            batch_bytes += sizes[nb];
+            uchains[nb++] = uref_to_uchain(uref);
+        }
+
+        uatomic_fetch_add(&queue->bytes, batch_bytes);
+        unsigned int pushed = uqueue_push_batch(&queue->uqueue, uchains, nb);
+        if (pushed < nb) {
+            while (nb > pushed) {
+                uatomic_fetch_sub(&queue->bytes, sizes[--nb]);
+                upipe_qsink_unshift_input(upipe, uref_from_uchain(uchains[nb]));
+            }
+            return false;
+        }
+    }
+    return true;
+}
+
+/** @internal @This is called when the queue may have drained. Unblock the
+ * sink once it is down to the low watermarks.
  *
  * @param upump description structure of the watcher
  */
 static void upipe_qsink_watcher(struct upump *upump)
 {
     struct upipe *upipe = upump_get_opaque(upump, struct upipe *);
-    upipe_qsink_output_input(upipe);
+    struct upipe_qsink *upipe_qsink = upipe_qsink_from_upipe(upipe);
+    struct upipe_queue *queue = upipe_queue(upipe_qsink->qsrc);
+
+    do {
+        if (!upipe_queue_sink_wait(queue))
+            return;
+    } while (!upipe_qsink_output_batch(upipe));
+
+    upump_stop(upump);
     upipe_qsink_unblock_input(upipe);
-    if (upipe_qsink_check_input(upipe)) {
-        upump_stop(upump);
-        /* All packets have been output, release again the pipe that has been
-         * used in @ref upipe_qsink_input. */
-        upipe_release(upipe);
-    }
+    upipe_qsink_throw_watermark(upipe, UPROBE_QSINK_LOW_WATERMARK);
+    /* All packets have been output, release again the pipe that has been
+     * used in @ref upipe_qsink_input. */
+    upipe_release(upipe);
 }
 
 /** @internal @This checks and creates the upump watcher to wait for the
@@ -233,18 +371,21 @@ static void upipe_qsink_input(struct upipe *upipe, struct uref *uref,
     if (!upipe_qsink_check_input(upipe)) {
         upipe_qsink_hold_input(upipe, uref);
         upipe_qsink_block_input(upipe, upump_p);
-    } else if (!upipe_qsink_output(upipe, uref, upump_p)) {
+    } else if (!upipe_qsink_output_spin(upipe, uref, upump_p)) {
         if (!upipe_qsink_check_watcher(upipe)) {
             upipe_warn(upipe, "unable to spool uref");
             uref_free(uref);
             return;
         }
         upump_start(upipe_qsink->upump);
+        /* let the watcher arm the wake-up by the queue source */
+        ueventfd_write(&upipe_queue(upipe_qsink->qsrc)->uqueue.event_push);
         upipe_qsink_hold_input(upipe, uref);
         upipe_qsink_block_input(upipe, upump_p);
         /* Increment upipe refcount to avoid disappearing before all packets
          * have been sent. */
         upipe_use(upipe);
+        upipe_qsink_throw_watermark(upipe, UPROBE_QSINK_HIGH_WATERMARK);
         upipe_throw_stalled(upipe);
     }
 }
@@ -316,6 +457,7 @@ static int upipe_qsink_flush(struct upipe *upipe)
 {
     if (upipe_qsink_flush_input(upipe)) {
         struct upipe_qsink *upipe_qsink = upipe_qsink_from_upipe(upipe);
+        uatomic_store(&upipe_queue(upipe_qsink->qsrc)->waiting, 0);
         upump_stop(upipe_qsink->upump);
         /* All packets have been output, release again the pipe that has been
          * used in @ref upipe_qsink_input. */
@@ -475,6 +617,87 @@ static void upipe_qsink_oob(struct upump *upump)
     upipe_queue_upstream_free(upstream);
 }
 
+/** @internal @This returns the watermarks in number of urefs.
+ *
+ * @param upipe description structure of the pipe
+ * @param high_p filled in with the high watermark
+ * @param low_p filled in with the low watermark
+ * @return an error code
+ */
+static int _upipe_qsink_get_watermarks(struct upipe *upipe,
+                                       unsigned int *high_p,
+                                       unsigned int *low_p)
+{
+    struct upipe_qsink *upipe_qsink = upipe_qsink_from_upipe(upipe);
+    if (high_p != NULL)
+        *high_p = upipe_qsink->high;
+    if (low_p != NULL)
+        *low_p = uatomic_load(&upipe_queue(upipe_qsink->qsrc)->low_length);
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This sets the watermarks in number of urefs.
+ *
+ * @param upipe description structure of the pipe
+ * @param high high watermark
+ * @param low low watermark
+ * @return an error code
+ */
+static int _upipe_qsink_set_watermarks(struct upipe *upipe,
+                                       unsigned int high,
+                                       unsigned int low)
+{
+    struct upipe_qsink *upipe_qsink = upipe_qsink_from_upipe(upipe);
+    struct upipe_queue *queue = upipe_queue(upipe_qsink->qsrc);
+    if (!high || high > queue->max_length || low >= high)
+        return UBASE_ERR_INVALID;
+    upipe_qsink->high = high;
+    upipe_qsink->watermark_events = true;
+    uatomic_store(&queue->low_length, low);
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This returns the watermarks in octets.
+ *
+ * @param upipe description structure of the pipe
+ * @param high_p filled in with the high watermark
+ * @param low_p filled in with the low watermark
+ * @return an error code
+ */
+static int _upipe_qsink_get_byte_watermarks(struct upipe *upipe,
+                                            unsigned int *high_p,
+                                            unsigned int *low_p)
+{
+    struct upipe_qsink *upipe_qsink = upipe_qsink_from_upipe(upipe);
+    if (high_p != NULL)
+        *high_p = upipe_qsink->high_bytes;
+    if (low_p != NULL)
+        *low_p = upipe_qsink->high_bytes ?
+            uatomic_load(&upipe_queue(upipe_qsink->qsrc)->low_bytes) : 0;
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This sets the watermarks in octets.
+ *
+ * @param upipe description structure of the pipe
+ * @param high high watermark, or 0 to disable
+ * @param low low watermark
+ * @return an error code
+ */
+static int _upipe_qsink_set_byte_watermarks(struct upipe *upipe,
+                                            unsigned int high,
+                                            unsigned int low)
+{
+    struct upipe_qsink *upipe_qsink = upipe_qsink_from_upipe(upipe);
+    struct upipe_queue *queue = upipe_queue(upipe_qsink->qsrc);
+    if (high && low >= high)
+        return UBASE_ERR_INVALID;
+    upipe_qsink->high_bytes = high;
+    upipe_qsink->watermark_events = true;
+    uatomic_store(&queue->low_bytes, high ? low : UINT32_MAX);
+    return UBASE_ERR_NONE;
+}
+
 /** @internal @This processes control commands on a queue sink pipe.
  *
  * @param upipe description structure of the pipe
@@ -520,6 +743,70 @@ static int _upipe_qsink_control(struct upipe *upipe, int command, va_list args)
 
         case UPIPE_FLUSH:
             return upipe_qsink_flush(upipe);
+
+        case UPIPE_GET_OCCUPANCY: {
+            struct upipe_qsink *upipe_qsink = upipe_qsink_from_upipe(upipe);
+            struct upipe_occupancy *occupancy =
+                va_arg(args, struct upipe_occupancy *);
+            /* urefs held in the sink, plus the ones in the queue */
+            occupancy->urefs = upipe_qsink->nb_urefs;
+            if (upipe_qsink->qsrc != NULL) {
+                struct upipe_queue *queue = upipe_queue(upipe_qsink->qsrc);
+                occupancy->urefs += uqueue_length(&queue->uqueue);
+                occupancy->max_urefs = queue->max_length;
+            }
+            return UBASE_ERR_NONE;
+        }
+
+        case UPIPE_QSINK_GET_SPIN: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_QSINK_SIGNATURE)
+            struct upipe_qsink *upipe_qsink = upipe_qsink_from_upipe(upipe);
+            unsigned int *spin_p = va_arg(args, unsigned int *);
+            *spin_p = upipe_qsink->spin;
+            return UBASE_ERR_NONE;
+        }
+        case UPIPE_QSINK_SET_SPIN: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_QSINK_SIGNATURE)
+            struct upipe_qsink *upipe_qsink = upipe_qsink_from_upipe(upipe);
+            upipe_qsink->spin = va_arg(args, unsigned int);
+            return UBASE_ERR_NONE;
+        }
+        case UPIPE_QSINK_GET_WATERMARKS: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_QSINK_SIGNATURE)
+            unsigned int *high_p = va_arg(args, unsigned int *);
+            unsigned int *low_p = va_arg(args, unsigned int *);
+            return _upipe_qsink_get_watermarks(upipe, high_p, low_p);
+        }
+        case UPIPE_QSINK_SET_WATERMARKS: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_QSINK_SIGNATURE)
+            unsigned int high = va_arg(args, unsigned int);
+            unsigned int low = va_arg(args, unsigned int);
+            return _upipe_qsink_set_watermarks(upipe, high, low);
+        }
+        case UPIPE_QSINK_GET_BYTE_WATERMARKS: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_QSINK_SIGNATURE)
+            unsigned int *high_p = va_arg(args, unsigned int *);
+            unsigned int *low_p = va_arg(args, unsigned int *);
+            return _upipe_qsink_get_byte_watermarks(upipe, high_p, low_p);
+        }
+        case UPIPE_QSINK_SET_BYTE_WATERMARKS: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_QSINK_SIGNATURE)
+            unsigned int high = va_arg(args, unsigned int);
+            unsigned int low = va_arg(args, unsigned int);
+            return _upipe_qsink_set_byte_watermarks(upipe, high, low);
+        }
+        case UPIPE_QSINK_GET_FILL: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_QSINK_SIGNATURE)
+            struct upipe_qsink *upipe_qsink = upipe_qsink_from_upipe(upipe);
+            struct upipe_queue *queue = upipe_queue(upipe_qsink->qsrc);
+            unsigned int *length_p = va_arg(args, unsigned int *);
+            unsigned int *bytes_p = va_arg(args, unsigned int *);
+            if (length_p != NULL)
+                *length_p = uqueue_length(&queue->uqueue);
+            if (bytes_p != NULL)
+                *bytes_p = uatomic_load(&queue->bytes);
+            return UBASE_ERR_NONE;
+        }
         default:
             return UBASE_ERR_UNHANDLED;
     }
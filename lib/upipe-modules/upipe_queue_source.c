@@ -58,6 +58,10 @@
 
 /** maximum length of out of band queues */
 #define OOB_QUEUES 255
+/** maximum number of urefs popped from the queue at once */
+#define UPIPE_QSRC_BATCH 32
+/** default maximum number of urefs handled per wake-up */
+#define UPIPE_QSRC_DEFAULT_BATCH UPIPE_QSRC_BATCH
 
 /** @internal @This is the private context of a queue source pipe. */
 struct upipe_qsrc {
@@ -80,6 +84,9 @@ struct upipe_qsrc {
     /** list of output requests */
     struct uchain request_list;
 
+    /** maximum number of urefs handled per wake-up */
+    unsigned int batch;
+
     /** structure exported to the sinks */
     struct upipe_queue upipe_queue;
 
@@ -140,6 +147,11 @@ static struct upipe *_upipe_qsrc_alloc(struct upipe_mgr *mgr,
     upipe_qsrc_init_upump(upipe);
     upipe_qsrc_init_upump_oob(upipe);
     upipe_qsrc->upipe_queue.max_length = length;
+    uatomic_init(&upipe_qsrc->upipe_queue.bytes, 0);
+    uatomic_init(&upipe_qsrc->upipe_queue.waiting, 0);
+    uatomic_init(&upipe_qsrc->upipe_queue.low_length, length - 1);
+    uatomic_init(&upipe_qsrc->upipe_queue.low_bytes, UINT32_MAX);
+    upipe_qsrc->batch = UPIPE_QSRC_DEFAULT_BATCH;
     upipe_throw_ready(upipe);
 
     return upipe;
@@ -167,7 +179,10 @@ static void upipe_qsrc_input(struct upipe *upipe, struct uref *uref,
     upipe_qsrc_output(upipe, uref, upump_p);
 }
 
-/** @internal @This reads data from the queue and outputs it.
+/** @internal @This reads data from the queue and outputs it. The queue is
+ * drained until it is empty or the batch size is reached, so that urefs
+ * pushed while the previous ones are processed do not cost another
+ * wake-up.
  *
  * @param upump description structure of the read watcher
  */
@@ -175,9 +190,27 @@ static void upipe_qsrc_worker(struct upump *upump)
 {
     struct upipe *upipe = upump_get_opaque(upump, struct upipe *);
     struct upipe_qsrc *upipe_qsrc = upipe_qsrc_from_upipe(upipe);
-    struct uref *uref = uqueue_pop(&upipe_queue(upipe)->uqueue, struct uref *);
-    if (likely(uref != NULL))
-        upipe_qsrc_input(upipe, uref, &upipe_qsrc->upump);
+    void *uchains[UPIPE_QSRC_BATCH];
+    unsigned int done = 0;
+    while (done < upipe_qsrc->batch) {
+        unsigned int n = upipe_qsrc->batch - done;
+        if (n > UPIPE_QSRC_BATCH)
+            n = UPIPE_QSRC_BATCH;
+        unsigned int nb = uqueue_pop_batch(&upipe_queue(upipe)->uqueue,
+                                           uchains, n);
+        uint32_t bytes = 0;
+        for (unsigned int i = 0; i < nb; i++)
+            bytes += upipe_queue_uref_size(uref_from_uchain(uchains[i]));
+        uatomic_fetch_sub(&upipe_queue(upipe)->bytes, bytes);
+        upipe_queue_source_wake(upipe_queue(upipe));
+
+        for (unsigned int i = 0; i < nb; i++)
+            upipe_qsrc_input(upipe, uref_from_uchain(uchains[i]),
+                             &upipe_qsrc->upump);
+        if (nb < n)
+            break;
+        done += nb;
+    }
 }
 
 /** @internal @This handles the result of a request.
@@ -308,6 +341,10 @@ static void upipe_qsrc_ref_end(struct upipe *upipe)
     uqueue_clean(&upipe_queue(upipe)->uqueue);
     uqueue_clean(&upipe_queue(upipe)->downstream_oob);
     uqueue_clean(&upipe_queue(upipe)->upstream_oob);
+    uatomic_clean(&upipe_queue(upipe)->bytes);
+    uatomic_clean(&upipe_queue(upipe)->waiting);
+    uatomic_clean(&upipe_queue(upipe)->low_length);
+    uatomic_clean(&upipe_queue(upipe)->low_bytes);
 
     upipe_qsrc_clean_urefcount(upipe);
     upipe_clean(upipe);
@@ -380,6 +417,21 @@ static int _upipe_qsrc_get_length(struct upipe *upipe, unsigned int *length_p)
     return UBASE_ERR_NONE;
 }
 
+/** @internal @This sets the maximum number of urefs handled per wake-up.
+ *
+ * @param upipe description structure of the pipe
+ * @param batch maximum number of urefs (at least 1)
+ * @return an error code
+ */
+static int _upipe_qsrc_set_batch(struct upipe *upipe, unsigned int batch)
+{
+    struct upipe_qsrc *upipe_qsrc = upipe_qsrc_from_upipe(upipe);
+    if (!batch)
+        return UBASE_ERR_INVALID;
+    upipe_qsrc->batch = batch;
+    return UBASE_ERR_NONE;
+}
+
 /** @internal @This processes control commands on a queue source pipe.
  *
  * @param upipe description structure of the pipe
@@ -408,6 +460,26 @@ static int _upipe_qsrc_control(struct upipe *upipe, int command, va_list args)
             unsigned int *length_p = va_arg(args, unsigned int *);
             return _upipe_qsrc_get_length(upipe, length_p);
         }
+        case UPIPE_GET_OCCUPANCY: {
+            struct upipe_qsrc *upipe_qsrc = upipe_qsrc_from_upipe(upipe);
+            struct upipe_occupancy *occupancy =
+                va_arg(args, struct upipe_occupancy *);
+            occupancy->urefs = uqueue_length(&upipe_queue(upipe)->uqueue);
+            occupancy->max_urefs = upipe_qsrc->upipe_queue.max_length;
+            return UBASE_ERR_NONE;
+        }
+        case UPIPE_QSRC_GET_BATCH: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_QSRC_SIGNATURE)
+            struct upipe_qsrc *upipe_qsrc = upipe_qsrc_from_upipe(upipe);
+            unsigned int *batch_p = va_arg(args, unsigned int *);
+            *batch_p = upipe_qsrc->batch;
+            return UBASE_ERR_NONE;
+        }
+        case UPIPE_QSRC_SET_BATCH: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_QSRC_SIGNATURE)
+            unsigned int batch = va_arg(args, unsigned int);
+            return _upipe_qsrc_set_batch(upipe, batch);
+        }
         default:
             return UBASE_ERR_UNHANDLED;
     }
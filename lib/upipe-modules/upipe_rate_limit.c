@@ -28,6 +28,7 @@
 /** @showvalue default rate limit window */
 #define DURATION_DEFAULT (UCLOCK_FREQ)
 
+#include <upipe/config.h>
 #include <upipe/uclock.h>
 #include <upipe/uref_attr.h>
 #include <upipe/uref_block.h>
@@ -41,6 +42,12 @@
 #include <upipe/upipe_helper_uclock.h>
 #include <upipe-modules/upipe_rate_limit.h>
 
+#ifdef UPIPE_HAVE_SYS_TIMERFD_H
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include <time.h>
+#endif
+
 UREF_ATTR_UNSIGNED(rate_limit, size, "rate_limit.size", rate limit block size);
 UREF_ATTR_UNSIGNED(rate_limit, date, "rate_limit.date", rate limit block date);
 
@@ -82,6 +89,18 @@ struct upipe_rate_limit {
     struct uchain sent_blocks;
     /** window duration */
     uint64_t duration;
+    /** token bucket depth in octets, or 0 to use the window */
+    uint64_t bucket;
+    /** available tokens, in octets multiplied by UCLOCK_FREQ */
+    uint64_t tokens;
+    /** date of the last refill of the bucket, or UINT64_MAX */
+    uint64_t tokens_date;
+    /** tokens needed by the held block */
+    uint64_t tokens_needed;
+    /** high resolution timer, or -1 */
+    int timerfd;
+    /** pump watching the high resolution timer */
+    struct upump *upump_timerfd;
 };
 
 /** @hidden */
@@ -105,6 +124,7 @@ UPIPE_HELPER_OUTPUT(upipe_rate_limit, output, flow_def, output_state,
                     request_list);
 UPIPE_HELPER_UPUMP_MGR(upipe_rate_limit, upump_mgr);
 UPIPE_HELPER_UPUMP(upipe_rate_limit, upump, upump_mgr);
+UPIPE_HELPER_UPUMP(upipe_rate_limit, upump_timerfd, upump_mgr);
 UPIPE_HELPER_UCLOCK(upipe_rate_limit, uclock, uclock_request,
                     upipe_rate_limit_check,
                     upipe_rate_limit_register_output_request,
@@ -135,10 +155,16 @@ static struct upipe *upipe_rate_limit_alloc(struct upipe_mgr *mgr,
     upipe_rate_limit_init_output(upipe);
     upipe_rate_limit_init_upump_mgr(upipe);
     upipe_rate_limit_init_upump(upipe);
+    upipe_rate_limit_init_upump_timerfd(upipe);
     upipe_rate_limit_init_uclock(upipe);
     upipe_rate_limit->rate_limit = (uint64_t)-1;
     upipe_rate_limit->size = 0;
     upipe_rate_limit->duration = DURATION_DEFAULT;
+    upipe_rate_limit->bucket = 0;
+    upipe_rate_limit->tokens = 0;
+    upipe_rate_limit->tokens_date = UINT64_MAX;
+    upipe_rate_limit->tokens_needed = 0;
+    upipe_rate_limit->timerfd = -1;
     ulist_init(&upipe_rate_limit->sent_blocks);
     upipe_throw_ready(upipe);
 
@@ -153,6 +179,13 @@ static void upipe_rate_limit_free(struct upipe *upipe)
 {
     upipe_throw_dead(upipe);
     upipe_rate_limit_clean_uclock(upipe);
+    upipe_rate_limit_clean_upump_timerfd(upipe);
+#ifdef UPIPE_HAVE_SYS_TIMERFD_H
+    struct upipe_rate_limit *upipe_rate_limit =
+        upipe_rate_limit_from_upipe(upipe);
+    if (upipe_rate_limit->timerfd != -1)
+        close(upipe_rate_limit->timerfd);
+#endif
     upipe_rate_limit_clean_upump(upipe);
     upipe_rate_limit_clean_upump_mgr(upipe);
     upipe_rate_limit_clean_output(upipe);
@@ -219,6 +252,128 @@ static void upipe_rate_limit_wake_upump(struct upump *upump)
     return upipe_rate_limit_wake(upump_get_opaque(upump, struct upipe *));
 }
 
+#ifdef UPIPE_HAVE_SYS_TIMERFD_H
+/** @internal @This is called when the high resolution timer expires.
+ *
+ * @param upump description structure of the timer watcher
+ */
+static void upipe_rate_limit_wake_timerfd(struct upump *upump)
+{
+    struct upipe *upipe = upump_get_opaque(upump, struct upipe *);
+    struct upipe_rate_limit *upipe_rate_limit =
+        upipe_rate_limit_from_upipe(upipe);
+    uint64_t expirations;
+    if (read(upipe_rate_limit->timerfd, &expirations,
+             sizeof(expirations)) != sizeof(expirations))
+        return;
+    upump_stop(upump);
+    upipe_rate_limit_wake(upipe);
+}
+
+/** @internal @This arms the high resolution timer, which is not subject to
+ * the millisecond resolution of the event loop timeouts.
+ *
+ * @param upipe description structure of the pipe
+ * @param timeout time to wait in clock ticks
+ * @return an error code
+ */
+static int upipe_rate_limit_arm_timerfd(struct upipe *upipe, uint64_t timeout)
+{
+    struct upipe_rate_limit *upipe_rate_limit =
+        upipe_rate_limit_from_upipe(upipe);
+
+    if (upipe_rate_limit->timerfd == -1) {
+        upipe_rate_limit->timerfd =
+            timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if (unlikely(upipe_rate_limit->timerfd == -1))
+            return UBASE_ERR_EXTERNAL;
+    }
+
+    if (upipe_rate_limit->upump_timerfd == NULL) {
+        if (unlikely(upipe_rate_limit->upump_mgr == NULL))
+            return UBASE_ERR_INVALID;
+        struct upump *upump =
+            upump_alloc_fd_read(upipe_rate_limit->upump_mgr,
+                                upipe_rate_limit_wake_timerfd, upipe,
+                                upipe->refcount, upipe_rate_limit->timerfd);
+        if (unlikely(upump == NULL))
+            return UBASE_ERR_UPUMP;
+        upipe_rate_limit_set_upump_timerfd(upipe, upump);
+    }
+
+    uint64_t nsec = timeout * 1000 / (UCLOCK_FREQ / 1000000);
+    struct itimerspec its = {
+        .it_interval = { 0, 0 },
+        .it_value = { nsec / 1000000000, nsec % 1000000000 },
+    };
+    if (!its.it_value.tv_sec && !its.it_value.tv_nsec)
+        its.it_value.tv_nsec = 1;
+    if (unlikely(timerfd_settime(upipe_rate_limit->timerfd, 0,
+                                 &its, NULL) == -1))
+        return UBASE_ERR_EXTERNAL;
+    upump_start(upipe_rate_limit->upump_timerfd);
+    return UBASE_ERR_NONE;
+}
+#endif
+
+/** @internal @This sleeps before trying to output again.
+ *
+ * @param upipe description structure of the pipe
+ * @param timeout time to wait in clock ticks
+ */
+static void upipe_rate_limit_sleep(struct upipe *upipe, uint64_t timeout)
+{
+    upipe_verbose_va(upipe, "wait %"PRIu64"us",
+                     timeout / (UCLOCK_FREQ / 1000000));
+#ifdef UPIPE_HAVE_SYS_TIMERFD_H
+    if (ubase_check(upipe_rate_limit_arm_timerfd(upipe, timeout)))
+        return;
+#endif
+    upipe_rate_limit_wait_upump(upipe, timeout, upipe_rate_limit_wake_upump);
+}
+
+/** @internal @This refills the token bucket and takes the tokens needed to
+ * output a block.
+ *
+ * @param upipe description structure of the pipe
+ * @param now current date
+ * @param size size of the block in octets
+ * @return true if the block may be output
+ */
+static bool upipe_rate_limit_take(struct upipe *upipe, uint64_t now,
+                                  uint64_t size)
+{
+    struct upipe_rate_limit *upipe_rate_limit =
+        upipe_rate_limit_from_upipe(upipe);
+    uint64_t rate = upipe_rate_limit->rate_limit;
+    uint64_t depth = upipe_rate_limit->bucket * UCLOCK_FREQ;
+
+    if (upipe_rate_limit->tokens_date == UINT64_MAX ||
+        now < upipe_rate_limit->tokens_date)
+        upipe_rate_limit->tokens = depth;
+    else if (rate) {
+        uint64_t elapsed = now - upipe_rate_limit->tokens_date;
+        if (elapsed >= (depth - upipe_rate_limit->tokens) / rate + 1)
+            upipe_rate_limit->tokens = depth;
+        else
+            upipe_rate_limit->tokens += elapsed * rate;
+        if (upipe_rate_limit->tokens > depth)
+            upipe_rate_limit->tokens = depth;
+    }
+    upipe_rate_limit->tokens_date = now;
+
+    /* a block larger than the bucket goes when the bucket is full */
+    uint64_t needed = size * UCLOCK_FREQ;
+    if (needed > depth)
+        needed = depth;
+    if (upipe_rate_limit->tokens < needed) {
+        upipe_rate_limit->tokens_needed = needed;
+        return false;
+    }
+    upipe_rate_limit->tokens -= needed;
+    return true;
+}
+
 /** @internal @This waits to rate limit the output.
  *
  * @param upipe description structure of the pipe
@@ -228,6 +383,16 @@ static void upipe_rate_limit_wait(struct upipe *upipe)
     struct upipe_rate_limit *upipe_rate_limit =
         upipe_rate_limit_from_upipe(upipe);
 
+    if (upipe_rate_limit->bucket) {
+        uint64_t rate = upipe_rate_limit->rate_limit;
+        if (unlikely(!rate))
+            return;
+        uint64_t missing = upipe_rate_limit->tokens_needed -
+                           upipe_rate_limit->tokens;
+        upipe_rate_limit_sleep(upipe, (missing + rate - 1) / rate);
+        return;
+    }
+
     assert(upipe_rate_limit->uclock != NULL);
     uint64_t now = uclock_now(upipe_rate_limit->uclock);
 
@@ -241,8 +406,7 @@ static void upipe_rate_limit_wait(struct upipe *upipe)
     uint64_t timeout = 1;
     if (likely(upipe_rate_limit->duration > now - date))
         timeout = upipe_rate_limit->duration - (now - date);
-    upipe_verbose_va(upipe, "wait %"PRIu64"ms", timeout / (UCLOCK_FREQ / 1000));
-    upipe_rate_limit_wait_upump(upipe, timeout, upipe_rate_limit_wake_upump);
+    upipe_rate_limit_sleep(upipe, timeout);
 }
 
 /** @internal @This tries to output an uref.
@@ -278,6 +442,16 @@ static bool upipe_rate_limit_process(struct upipe *upipe,
     size_t size = 0;
     uref_block_size(uref, &size);
 
+    if (upipe_rate_limit->bucket) {
+        if (!upipe_rate_limit_take(upipe, now, size)) {
+            /* not enough tokens, wait... */
+            upipe_rate_limit_wait(upipe);
+            return false;
+        }
+        upipe_rate_limit_output(upipe, uref, upump_p);
+        return true;
+    }
+
     if (upipe_rate_limit->size &&
         (upipe_rate_limit->size + size) * UCLOCK_FREQ /
         upipe_rate_limit->duration > upipe_rate_limit->rate_limit) {
@@ -398,6 +572,40 @@ static int _upipe_rate_limit_get_duration(struct upipe *upipe,
     return UBASE_ERR_NONE;
 }
 
+/** @internal @This sets the token bucket depth.
+ *
+ * @param upipe description structure of the pipe
+ * @param bucket depth of the bucket in octets, or 0 to use the window
+ * @return an error code
+ */
+static int _upipe_rate_limit_set_bucket(struct upipe *upipe, uint64_t bucket)
+{
+    struct upipe_rate_limit *upipe_rate_limit =
+        upipe_rate_limit_from_upipe(upipe);
+    if (unlikely(bucket > UINT64_MAX / UCLOCK_FREQ))
+        return UBASE_ERR_INVALID;
+    upipe_dbg_va(upipe, "set token bucket to %"PRIu64" bytes", bucket);
+    upipe_rate_limit->bucket = bucket;
+    upipe_rate_limit->tokens_date = UINT64_MAX;
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This gets the token bucket depth.
+ *
+ * @param upipe description structure of the pipe
+ * @param bucket_p filled in with the depth of the bucket in octets
+ * @return an error code
+ */
+static int _upipe_rate_limit_get_bucket(struct upipe *upipe,
+                                        uint64_t *bucket_p)
+{
+    struct upipe_rate_limit *upipe_rate_limit =
+        upipe_rate_limit_from_upipe(upipe);
+    if (bucket_p)
+        *bucket_p = upipe_rate_limit->bucket;
+    return UBASE_ERR_NONE;
+}
+
 /** @internal @This dispatches the control commands.
  *
  * @param upipe description structure of the pipe
@@ -412,6 +620,8 @@ static int _upipe_rate_limit_control(struct upipe *upipe,
     UBASE_HANDLED_RETURN(upipe_rate_limit_control_output(upipe, command, args));
     switch (command) {
     case UPIPE_ATTACH_UPUMP_MGR:
+        upipe_rate_limit_set_upump(upipe, NULL);
+        upipe_rate_limit_set_upump_timerfd(upipe, NULL);
         return upipe_rate_limit_attach_upump_mgr(upipe);
 
     case UPIPE_ATTACH_UCLOCK:
@@ -443,6 +653,16 @@ static int _upipe_rate_limit_control(struct upipe *upipe,
         uint64_t *duration_p = va_arg(args, uint64_t *);
         return _upipe_rate_limit_get_duration(upipe, duration_p);
     }
+    case UPIPE_RATE_LIMIT_SET_BUCKET: {
+        UBASE_SIGNATURE_CHECK(args, UPIPE_RATE_LIMIT_SIGNATURE);
+        uint64_t bucket = va_arg(args, uint64_t);
+        return _upipe_rate_limit_set_bucket(upipe, bucket);
+    }
+    case UPIPE_RATE_LIMIT_GET_BUCKET: {
+        UBASE_SIGNATURE_CHECK(args, UPIPE_RATE_LIMIT_SIGNATURE);
+        uint64_t *bucket_p = va_arg(args, uint64_t *);
+        return _upipe_rate_limit_get_bucket(upipe, bucket_p);
+    }
     }
     return UBASE_ERR_UNHANDLED;
 }
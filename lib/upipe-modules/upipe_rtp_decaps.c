@@ -161,6 +161,8 @@ struct upipe_rtpd {
 
     /* number of packets lost */
     uint64_t lost;
+    /** true if packets continuing a timestamp are not dated */
+    bool header_only;
 
     /** public upipe structure */
     struct upipe upipe;
@@ -203,6 +205,7 @@ static struct upipe *upipe_rtpd_alloc(struct upipe_mgr *mgr,
     upipe_rtpd->type = UINT8_MAX;
     upipe_rtpd->mode = upipe_rtpd->mode_config = UPIPE_RTPD_UNKNOWN;
     upipe_rtpd->lost = 0;
+    upipe_rtpd->header_only = false;
     upipe_rtpd->flow_def_input = NULL;
     upipe_rtpd->rate = 0;
     upipe_rtpd->last_timestamp = UINT64_MAX;
@@ -571,8 +574,12 @@ static inline void upipe_rtpd_output_mpeg4_audio(struct upipe *upipe,
         upipe_rtpd->next_uref = NULL;
     }
 
+    /* frames after the first one are dated from the number of samples
+     * preceding them, assuming AAC frames of 1024 samples */
+    uint64_t duration = upipe_rtpd->rate ?
+        UINT64_C(1024) * UCLOCK_FREQ / upipe_rtpd->rate : 0;
     uint16_t i;
-    size_t offset = au_headers_length;
+    size_t offset = RTP3640_AU_HEADERS_LENGTH_SIZE + au_headers_length;
     for (i = 0; i < au_headers_length / RTP3640_AU_HEADER_AAC_HBR_SIZE; i++) {
         uint8_t au_header[RTP3640_AU_HEADER_AAC_HBR_SIZE];
         if (unlikely(!ubase_check(uref_block_extract(uref,
@@ -591,12 +598,24 @@ static inline void upipe_rtpd_output_mpeg4_audio(struct upipe *upipe,
             continue;
         }
         /* TODO support interleaving */
+        if (i && duration) {
+            uref_clock_add_date_orig(frame, i * duration);
+            uref_clock_add_date_prog(frame, i * duration);
+            uref_clock_add_date_sys(frame, i * duration);
+        }
+        if (duration)
+            uref_clock_set_duration(frame, duration);
         upipe_rtpd_output(upipe, frame, upump_p);
         offset += au_size;
     }
     uref_free(uref);
 }
 
+/** @hidden */
+static void upipe_rtpd_process(struct upipe *upipe, struct uref *uref,
+                               struct upump **upump_p, bool marker,
+                               uint16_t seqnum, uint32_t timestamp);
+
 /** @internal @This handles data.
  *
  * @param upipe description structure of the pipe
@@ -616,6 +635,19 @@ static inline void upipe_rtpd_input(struct upipe *upipe, struct uref *uref,
         return;
     }
 
+    /* fast path for the common header without padding, extension nor
+     * CSRC, and the same payload type as the previous packet */
+    if (likely(rtp_header[0] == 0x80 &&
+               rtp_get_type(rtp_header) == upipe_rtpd->type)) {
+        bool marker = rtp_check_marker(rtp_header);
+        uint16_t seqnum = rtp_get_seqnum(rtp_header);
+        uint32_t timestamp = rtp_get_timestamp(rtp_header);
+        uref_block_peek_unmap(uref, 0, rtp_buffer, rtp_header);
+        uref_block_resize(uref, RTP_HEADER_SIZE, -1);
+        upipe_rtpd_process(upipe, uref, upump_p, marker, seqnum, timestamp);
+        return;
+    }
+
     bool valid = rtp_check_hdr(rtp_header);
     bool padding = rtp_check_padding(rtp_header);
     bool extension = rtp_check_extension(rtp_header);
@@ -660,6 +692,27 @@ static inline void upipe_rtpd_input(struct upipe *upipe, struct uref *uref,
     }
     uref_block_resize(uref, offset, -1);
 
+    if (unlikely(type != upipe_rtpd->type)) {
+        upipe_rtpd->type = type;
+        upipe_rtpd_build_flow_def(upipe);
+    }
+    upipe_rtpd_process(upipe, uref, upump_p, marker, seqnum, timestamp);
+}
+
+/** @internal @This handles a packet stripped of its RTP header.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref uref structure
+ * @param upump_p reference to pump that generated the buffer
+ * @param marker marker bit in the RTP header
+ * @param seqnum sequence number in the RTP header
+ * @param timestamp timestamp in the RTP header
+ */
+static void upipe_rtpd_process(struct upipe *upipe, struct uref *uref,
+                               struct upump **upump_p, bool marker,
+                               uint16_t seqnum, uint32_t timestamp)
+{
+    struct upipe_rtpd *upipe_rtpd = upipe_rtpd_from_upipe(upipe);
     if (unlikely(upipe_rtpd->expected_seqnum != -1 &&
                  seqnum != upipe_rtpd->expected_seqnum)) {
         upipe_dbg_va(upipe, "potentially lost %d RTP packets, got %u expected %u",
@@ -672,12 +725,9 @@ static inline void upipe_rtpd_input(struct upipe *upipe, struct uref *uref,
     upipe_rtpd->expected_seqnum = seqnum + 1;
     upipe_rtpd->expected_seqnum &= UINT16_MAX;
 
-    if (unlikely(type != upipe_rtpd->type)) {
-        upipe_rtpd->type = type;
-        upipe_rtpd_build_flow_def(upipe);
-    }
-
     /* timestamp */
+    if (upipe_rtpd->header_only && timestamp == upipe_rtpd->last_timestamp)
+        goto payload;
     switch (upipe_rtpd->mode) {
         case UPIPE_RTPD_MPA:
         case UPIPE_RTPD_MPV:
@@ -740,7 +790,7 @@ static inline void upipe_rtpd_input(struct upipe *upipe, struct uref *uref,
     }
     upipe_rtpd->last_timestamp = timestamp;
 
-    /* payload */
+payload:
     switch (upipe_rtpd->mode) {
         case UPIPE_RTPD_MPA:
             upipe_rtpd_output_mpa(upipe, uref, upump_p);
@@ -844,6 +894,11 @@ static int upipe_rtpd_control(struct upipe *upipe, int command, va_list args)
             upipe_rtpd->lost = 0; /* reset counter */
             return UBASE_ERR_NONE;
         }
+        case UPIPE_RTPD_SET_HEADER_ONLY: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_RTPD_SIGNATURE)
+            upipe_rtpd->header_only = !!va_arg(args, int);
+            return UBASE_ERR_NONE;
+        }
         default:
             return UBASE_ERR_UNHANDLED;
     }
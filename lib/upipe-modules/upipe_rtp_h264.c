@@ -37,25 +37,7 @@
 #include <upipe/upipe_helper_flow.h>
 #include <upipe/upipe_helper_flow_def.h>
 #include <upipe-modules/upipe_rtp_h264.h>
-
-static const uint8_t *upipe_mpeg_scan(const uint8_t *p, const uint8_t *end,
-                                      uint8_t *len)
-{
-    while (p < end) {
-        if ((p + 2 < end) && p[0] == 0 && p[1] == 0) {
-            if ((p + 3 < end) && p[2] == 1) {
-                *len = 3;
-                return p;
-            }
-            else if ((p + 4 < end) && p[2] == 0 && p[3] == 1) {
-                *len = 4;
-                return p;
-            }
-        }
-        p++;
-    }
-    return NULL;
-}
+#include <upipe-framers/uref_h26x.h>
 
 struct upipe_rtp_h264 {
     /** refcount management structure */
@@ -71,6 +53,15 @@ struct upipe_rtp_h264 {
     /** list of output requests */
     struct uchain request_list;
 
+    /** NAL unit or STAP-A packet waiting for more small NAL units */
+    struct uref *aggregate;
+    /** NAL header of the waiting NAL unit, or F and NRI of the STAP-A */
+    uint8_t aggregate_nalu;
+    /** number of waiting NAL units */
+    unsigned int aggregate_count;
+    /** size of the STAP-A packet containing the waiting NAL units */
+    size_t aggregate_size;
+
     /** public upipe structure */
     struct upipe upipe;
 };
@@ -121,8 +112,11 @@ static int upipe_rtp_h264_control(struct upipe *upipe, int command,
 
 static void upipe_rtp_h264_free(struct upipe *upipe)
 {
+    struct upipe_rtp_h264 *upipe_rtp_h264 = upipe_rtp_h264_from_upipe(upipe);
+
     upipe_throw_dead(upipe);
 
+    uref_free(upipe_rtp_h264->aggregate);
     upipe_rtp_h264_clean_output(upipe);
     upipe_rtp_h264_clean_urefcount(upipe);
     upipe_rtp_h264_free_void(upipe);
@@ -141,6 +135,12 @@ static struct upipe *upipe_rtp_h264_alloc(struct upipe_mgr *mgr,
     upipe_rtp_h264_init_urefcount(upipe);
     upipe_rtp_h264_init_output(upipe);
 
+    struct upipe_rtp_h264 *upipe_rtp_h264 = upipe_rtp_h264_from_upipe(upipe);
+    upipe_rtp_h264->aggregate = NULL;
+    upipe_rtp_h264->aggregate_nalu = 0;
+    upipe_rtp_h264->aggregate_count = 0;
+    upipe_rtp_h264->aggregate_size = 0;
+
     upipe_throw_ready(upipe);
 
     return upipe;
@@ -150,6 +150,9 @@ static struct upipe *upipe_rtp_h264_alloc(struct upipe_mgr *mgr,
 #define FU_START        (1 << 7)
 #define FU_END          (1 << 6)
 #define FU_A            28
+#define STAP_A          24
+/** size of the NAL unit size field of a STAP-A packet */
+#define STAP_SIZE_SIZE  2
 
 #define NALU_F(Nalu)    ((Nalu) & 0x80)
 #define NALU_NRI(Nalu)  ((Nalu) & 0x60)
@@ -231,48 +234,297 @@ static void upipe_rtp_h264_output_nalu(struct upipe *upipe,
     }
 }
 
+/** @internal @This appends a NAL unit to a STAP-A payload, prefixed with
+ * its size and its NAL header.
+ *
+ * @param ubuf STAP-A payload
+ * @param nalu NAL header
+ * @param payload NAL unit without its header, consumed
+ * @param size size of the NAL unit without its header
+ * @return an error code
+ */
+static int upipe_rtp_h264_stap_append(struct ubuf *ubuf, uint8_t nalu,
+                                      struct ubuf *payload, size_t size)
+{
+    struct ubuf *header = ubuf_block_alloc(ubuf->mgr, STAP_SIZE_SIZE + 1);
+    if (unlikely(header == NULL)) {
+        ubuf_free(payload);
+        return UBASE_ERR_ALLOC;
+    }
+
+    uint8_t *buf = NULL;
+    int buf_size = STAP_SIZE_SIZE + 1;
+    ubuf_block_write(header, 0, &buf_size, &buf);
+    buf[0] = (size + 1) >> 8;
+    buf[1] = (size + 1) & 0xff;
+    buf[2] = nalu;
+    ubuf_block_unmap(header, 0);
+
+    if (unlikely(!ubase_check(ubuf_block_append(header, payload)))) {
+        ubuf_free(header);
+        ubuf_free(payload);
+        return UBASE_ERR_ALLOC;
+    }
+    if (unlikely(!ubase_check(ubuf_block_append(ubuf, header)))) {
+        ubuf_free(header);
+        return UBASE_ERR_ALLOC;
+    }
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This outputs the waiting NAL units, in a STAP-A packet if
+ * there are several of them.
+ *
+ * @param upipe description structure of the pipe
+ * @param upump_p reference to pump that generated the buffer
+ */
+static void upipe_rtp_h264_flush(struct upipe *upipe, struct upump **upump_p)
+{
+    struct upipe_rtp_h264 *upipe_rtp_h264 = upipe_rtp_h264_from_upipe(upipe);
+    struct uref *uref = upipe_rtp_h264->aggregate;
+    uint8_t nalu = upipe_rtp_h264->aggregate_nalu;
+    unsigned int count = upipe_rtp_h264->aggregate_count;
+
+    upipe_rtp_h264->aggregate = NULL;
+    upipe_rtp_h264->aggregate_count = 0;
+    upipe_rtp_h264->aggregate_size = 0;
+    if (uref == NULL)
+        return;
+
+    if (count == 1) {
+        upipe_rtp_h264_output_nalu(upipe, nalu, uref, upump_p);
+        return;
+    }
+
+    uint8_t *buf = NULL;
+    int buf_size = 1;
+    if (unlikely(!ubase_check(uref_block_write(uref, 0, &buf_size, &buf)))) {
+        upipe_warn(upipe, "could not write STAP-A header");
+        uref_free(uref);
+        return;
+    }
+    buf[0] = nalu | STAP_A;
+    uref_block_unmap(uref, 0);
+    uref_clock_set_cr_dts_delay(uref, 0);
+    upipe_rtp_h264_output(upipe, uref, upump_p);
+}
+
+/** @internal @This outputs a NAL unit of an access unit. Small NAL units
+ * such as parameter sets and SEI are kept and aggregated in a single STAP-A
+ * packet, which is output when the next NAL unit does not fit or at the end
+ * of the access unit.
+ *
+ * @param upipe description structure of the pipe
+ * @param nalu NAL header
+ * @param uref NAL unit without its header
+ * @param upump_p reference to pump that generated the buffer
+ */
+static void upipe_rtp_h264_output_nal(struct upipe *upipe, uint8_t nalu,
+                                      struct uref *uref,
+                                      struct upump **upump_p)
+{
+    struct upipe_rtp_h264 *upipe_rtp_h264 = upipe_rtp_h264_from_upipe(upipe);
+
+    size_t size = 0;
+    if (unlikely(uref == NULL)) {
+        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+        return;
+    }
+    if (unlikely(!ubase_check(uref_block_size(uref, &size)))) {
+        upipe_err(upipe, "fail to get block size");
+        uref_free(uref);
+        return;
+    }
+
+    size_t stap_size = STAP_SIZE_SIZE + 1 + size;
+    if (upipe_rtp_h264->aggregate != NULL &&
+        upipe_rtp_h264->aggregate_size + stap_size > RTP_SPLIT_SIZE)
+        upipe_rtp_h264_flush(upipe, upump_p);
+
+    if (1 + stap_size > RTP_SPLIT_SIZE) {
+        upipe_rtp_h264_output_nalu(upipe, nalu, uref, upump_p);
+        return;
+    }
+
+    if (upipe_rtp_h264->aggregate == NULL) {
+        upipe_rtp_h264->aggregate = uref;
+        upipe_rtp_h264->aggregate_nalu = nalu;
+        upipe_rtp_h264->aggregate_count = 1;
+        upipe_rtp_h264->aggregate_size = 1 + stap_size;
+        return;
+    }
+
+    struct uref *stap = upipe_rtp_h264->aggregate;
+    if (upipe_rtp_h264->aggregate_count == 1) {
+        /* the STAP-A header is written when the packet is output */
+        uint8_t first = upipe_rtp_h264->aggregate_nalu;
+        size_t first_size = upipe_rtp_h264->aggregate_size - 1 -
+                            STAP_SIZE_SIZE - 1;
+        struct ubuf *ubuf = ubuf_block_alloc(stap->ubuf->mgr, 1);
+        if (unlikely(ubuf == NULL)) {
+            upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+            uref_free(uref);
+            return;
+        }
+        if (unlikely(!ubase_check(upipe_rtp_h264_stap_append(
+                        ubuf, first, uref_detach_ubuf(stap), first_size)))) {
+            upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+            ubuf_free(ubuf);
+            uref_free(uref);
+            return;
+        }
+        uref_attach_ubuf(stap, ubuf);
+        upipe_rtp_h264->aggregate_nalu = NALU_F(first) | NALU_NRI(first);
+    }
+
+    int err = upipe_rtp_h264_stap_append(stap->ubuf, nalu,
+                                         uref_detach_ubuf(uref), size);
+    uref_free(uref);
+    if (unlikely(!ubase_check(err))) {
+        upipe_throw_fatal(upipe, err);
+        return;
+    }
+
+    uint8_t nri = NALU_NRI(upipe_rtp_h264->aggregate_nalu);
+    if (NALU_NRI(nalu) > nri)
+        nri = NALU_NRI(nalu);
+    upipe_rtp_h264->aggregate_nalu =
+        NALU_F(upipe_rtp_h264->aggregate_nalu) | NALU_F(nalu) | nri;
+    upipe_rtp_h264->aggregate_count++;
+    upipe_rtp_h264->aggregate_size += stap_size;
+}
+
 static void upipe_rtp_h264_drop(struct upipe *upipe, struct uref *uref)
 {
     upipe_warn(upipe, "drop...");
     uref_free(uref);
 }
 
+/** @internal @This finds the start code and NAL header of a NAL unit
+ * indexed by the framer.
+ *
+ * @param uref annex B access unit
+ * @param nal_offset offset of the NAL unit, including its start code
+ * @param nal_size size of the NAL unit, including its start code
+ * @param start_size_p filled in with the size of the start code
+ * @param nalu_p filled in with the NAL header
+ * @return an error code
+ */
+static int upipe_rtp_h264_check_nal(struct uref *uref,
+                                    uint64_t nal_offset, uint64_t nal_size,
+                                    uint8_t *start_size_p, uint8_t *nalu_p)
+{
+    uint8_t buf[5];
+    if (nal_size < sizeof (buf))
+        return UBASE_ERR_INVALID;
+    UBASE_RETURN(uref_block_extract(uref, nal_offset, sizeof (buf), buf))
+    if (buf[0] || buf[1])
+        return UBASE_ERR_INVALID;
+    if (buf[2] == 1)
+        *start_size_p = 3;
+    else if (!buf[2] && buf[3] == 1)
+        *start_size_p = 4;
+    else
+        return UBASE_ERR_INVALID;
+    *nalu_p = buf[*start_size_p];
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This outputs the NAL units of an access unit using the NAL
+ * offsets set by the framer, so that the access unit is neither copied nor
+ * scanned for start codes.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref annex B access unit
+ * @param upump_p reference to pump that generated the buffer
+ * @return an error code, and UBASE_ERR_INVALID if the offsets are missing
+ * or stale, in which case the uref is not used
+ */
+static int upipe_rtp_h264_input_indexed(struct upipe *upipe,
+                                        struct uref *uref,
+                                        struct upump **upump_p)
+{
+    uint64_t offset;
+    if (!ubase_check(uref_h26x_get_nal_offset(uref, &offset, 0)))
+        return UBASE_ERR_INVALID;
+
+    uint64_t nal_units = 0;
+    uint64_t nal_offset = 0;
+    uint64_t nal_size = 0;
+    uint8_t start_size, nalu;
+    while (ubase_check(uref_h26x_iterate_nal(uref, &nal_units,
+                                             &nal_offset, &nal_size, 0)))
+        UBASE_RETURN(upipe_rtp_h264_check_nal(uref, nal_offset, nal_size,
+                                              &start_size, &nalu))
+
+    nal_units = 0;
+    while (ubase_check(uref_h26x_iterate_nal(uref, &nal_units,
+                                             &nal_offset, &nal_size, 0))) {
+        upipe_rtp_h264_check_nal(uref, nal_offset, nal_size,
+                                 &start_size, &nalu);
+        struct uref *part = uref_block_splice(uref,
+                nal_offset + start_size + 1, nal_size - start_size - 1);
+        upipe_rtp_h264_output_nal(upipe, nalu, part, upump_p);
+    }
+    upipe_rtp_h264_flush(upipe, upump_p);
+
+    uref_free(uref);
+    return UBASE_ERR_NONE;
+}
+
 static void upipe_rtp_h264_input(struct upipe *upipe,
                                 struct uref *uref,
                                 struct upump **upump_p)
 {
+    if (ubase_check(upipe_rtp_h264_input_indexed(upipe, uref, upump_p)))
+        return;
+
     size_t bz = 0;
     if (!ubase_check(uref_block_size(uref, &bz))) {
         upipe_err(upipe, "fail to get uref block size");
         return upipe_rtp_h264_drop(upipe, uref);
     }
 
-    uint8_t buf[bz];
-    int size = bz;
-    if (unlikely(!ubase_check(uref_block_extract(uref, 0, size, buf)))) {
-        upipe_err(upipe, "fail to read from uref");
-        return upipe_rtp_h264_drop(upipe, uref);
-    }
-
-    uint8_t s_len;
-    const uint8_t *s = upipe_mpeg_scan(buf, buf + size, &s_len);
-    if (s != buf) {
+    /* scan the start codes in place instead of copying the access unit */
+    size_t start = 0;
+    uint8_t zero = 0;
+    if (!ubase_check(uref_block_find(uref, &start, 3, 0, 0, 1)) ||
+        (start && (start != 1 ||
+                   !ubase_check(uref_block_extract(uref, 0, 1, &zero)) ||
+                   zero))) {
         upipe_err(upipe, "uref does not start with a mpeg start code");
         return upipe_rtp_h264_drop(upipe, uref);
     }
 
-    while (s < buf + size) {
-        uint8_t e_len = 0;
-        const uint8_t *e = upipe_mpeg_scan(s + s_len, buf + size, &e_len);
-        if (!e)
-            e = buf + size;
-
-        struct uref *part = uref_block_splice(uref, s - buf + s_len + 1,
-                                              e - (s + s_len + 1));
-        upipe_rtp_h264_output_nalu(upipe, *(s + s_len), part, upump_p);
-        s = e;
-        s_len = e_len;
+    start += 3;
+    while (start < bz) {
+        uint8_t nalu;
+        if (unlikely(!ubase_check(uref_block_extract(uref, start, 1,
+                                                     &nalu)))) {
+            upipe_err(upipe, "fail to read from uref");
+            break;
+        }
+
+        size_t next = start + 1;
+        size_t end = bz;
+        if (ubase_check(uref_block_find(uref, &next, 3, 0, 0, 1))) {
+            end = next;
+            /* four bytes start code */
+            if (end > start + 1 &&
+                ubase_check(uref_block_extract(uref, end - 1, 1, &zero)) &&
+                !zero)
+                end--;
+            next += 3;
+        }
+        else
+            next = bz;
+
+        struct uref *part = uref_block_splice(uref, start + 1,
+                                              end - (start + 1));
+        upipe_rtp_h264_output_nal(upipe, nalu, part, upump_p);
+        start = next;
     }
+    upipe_rtp_h264_flush(upipe, upump_p);
 
     uref_free(uref);
 }
@@ -1,6 +1,8 @@
 #include <stdlib.h>
 
 #include <upipe/upipe.h>
+#include <upipe/uref_block.h>
+#include <upipe/uref_clock.h>
 #include <upipe/upipe_helper_upipe.h>
 #include <upipe/upipe_helper_urefcount.h>
 #include <upipe/upipe_helper_void.h>
@@ -10,6 +12,19 @@
 #include <upipe/upipe_helper_flow_def.h>
 #include <upipe-modules/upipe_rtp_mpeg4.h>
 
+/** default maximum payload size */
+#define DEFAULT_MTU             1400
+/** maximum number of access units in a packet */
+#define MAX_AUS                 64
+/** size of the AU-headers-length field */
+#define AU_HEADERS_LENGTH_SIZE  2
+/** size of an AAC-hbr AU header */
+#define AU_HEADER_SIZE          2
+/** maximum size of an access unit in an AAC-hbr AU header */
+#define AU_SIZE_MAX             ((1 << 13) - 1)
+/** size of the ADTS header */
+#define ADTS_HEADER_SIZE        7
+
 struct upipe_rtp_mpeg4 {
     /** refcount management structure */
     struct urefcount urefcount;
@@ -24,6 +39,21 @@ struct upipe_rtp_mpeg4 {
     /** list of output requests */
     struct uchain request_list;
 
+    /** maximum payload size */
+    unsigned int mtu;
+    /** maximum duration of a packet */
+    uint64_t max_duration;
+    /** packet being aggregated, carrying the first access unit attributes */
+    struct uref *aggregate;
+    /** duration of the access units being aggregated */
+    uint64_t aggregate_duration;
+    /** payload size of the access units being aggregated */
+    size_t aggregate_size;
+    /** number of access units being aggregated */
+    unsigned int nb_aus;
+    /** sizes of the access units being aggregated */
+    uint16_t au_sizes[MAX_AUS];
+
     /** public upipe structure */
     struct upipe upipe;
 };
@@ -51,15 +81,87 @@ static int upipe_rtp_mpeg4_set_flow_def(struct upipe *upipe,
     return UBASE_ERR_NONE;
 }
 
+/** @internal @This outputs the aggregated access units, prefixed with
+ * their AU headers.
+ *
+ * @param upipe description structure of the pipe
+ * @param upump_p reference to pump that generated the buffer
+ */
+static void upipe_rtp_mpeg4_flush(struct upipe *upipe, struct upump **upump_p)
+{
+    struct upipe_rtp_mpeg4 *upipe_rtp_mpeg4 =
+        upipe_rtp_mpeg4_from_upipe(upipe);
+    struct uref *uref = upipe_rtp_mpeg4->aggregate;
+    unsigned int nb_aus = upipe_rtp_mpeg4->nb_aus;
+
+    upipe_rtp_mpeg4->aggregate = NULL;
+    upipe_rtp_mpeg4->aggregate_duration = 0;
+    upipe_rtp_mpeg4->aggregate_size = 0;
+    upipe_rtp_mpeg4->nb_aus = 0;
+    if (uref == NULL)
+        return;
+
+    size_t header_size = AU_HEADERS_LENGTH_SIZE + nb_aus * AU_HEADER_SIZE;
+    struct ubuf *au = ubuf_block_alloc(uref->ubuf->mgr, header_size);
+    if (unlikely(au == NULL)) {
+        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+        uref_free(uref);
+        return;
+    }
+
+    int size = -1;
+    uint8_t *buf;
+    ubuf_block_write(au, 0, &size, &buf);
+    /* AU-headers-length is in bits */
+    buf[0] = (nb_aus * AU_HEADER_SIZE * 8) >> 8;
+    buf[1] = nb_aus * AU_HEADER_SIZE * 8;
+    for (unsigned int i = 0; i < nb_aus; i++) {
+        /* 13 bits of size, 3 bits of index (delta) set to 0 */
+        uint16_t au_header = upipe_rtp_mpeg4->au_sizes[i] << 3;
+        buf[AU_HEADERS_LENGTH_SIZE + i * AU_HEADER_SIZE] = au_header >> 8;
+        buf[AU_HEADERS_LENGTH_SIZE + i * AU_HEADER_SIZE + 1] = au_header;
+    }
+    ubuf_block_unmap(au, 0);
+
+    struct ubuf *tmp = uref_detach_ubuf(uref);
+    if (unlikely(!ubase_check(ubuf_block_append(au, tmp)))) {
+        upipe_warn(upipe, "could not append payload to header");
+        ubuf_free(au);
+        ubuf_free(tmp);
+        uref_free(uref);
+        return;
+    }
+    uref_attach_ubuf(uref, au);
+    uref_clock_set_cr_dts_delay(uref, 0);
+    upipe_rtp_mpeg4_output(upipe, uref, upump_p);
+}
+
 static int upipe_rtp_mpeg4_control(struct upipe *upipe, int command,
                                   va_list args)
 {
+    struct upipe_rtp_mpeg4 *upipe_rtp_mpeg4 =
+        upipe_rtp_mpeg4_from_upipe(upipe);
+
     UBASE_HANDLED_RETURN(upipe_rtp_mpeg4_control_output(upipe, command, args));
     switch (command) {
         case UPIPE_SET_FLOW_DEF: {
             struct uref *flow_def = va_arg(args, struct uref *);
+            upipe_rtp_mpeg4_flush(upipe, NULL);
             return upipe_rtp_mpeg4_set_flow_def(upipe, flow_def);
         }
+        case UPIPE_RTP_MPEG4_SET_MTU: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_RTP_MPEG4_SIGNATURE)
+            unsigned int mtu = va_arg(args, unsigned int);
+            if (mtu <= AU_HEADERS_LENGTH_SIZE + AU_HEADER_SIZE)
+                return UBASE_ERR_INVALID;
+            upipe_rtp_mpeg4->mtu = mtu;
+            return UBASE_ERR_NONE;
+        }
+        case UPIPE_RTP_MPEG4_SET_MAX_DURATION: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_RTP_MPEG4_SIGNATURE)
+            upipe_rtp_mpeg4->max_duration = va_arg(args, uint64_t);
+            return UBASE_ERR_NONE;
+        }
         default:
             return UBASE_ERR_UNHANDLED;
     }
@@ -67,6 +169,7 @@ static int upipe_rtp_mpeg4_control(struct upipe *upipe, int command,
 
 static void upipe_rtp_mpeg4_free(struct upipe *upipe)
 {
+    upipe_rtp_mpeg4_flush(upipe, NULL);
     upipe_throw_dead(upipe);
 
     upipe_rtp_mpeg4_clean_output(upipe);
@@ -87,6 +190,15 @@ static struct upipe *upipe_rtp_mpeg4_alloc(struct upipe_mgr *mgr,
     upipe_rtp_mpeg4_init_urefcount(upipe);
     upipe_rtp_mpeg4_init_output(upipe);
 
+    struct upipe_rtp_mpeg4 *upipe_rtp_mpeg4 =
+        upipe_rtp_mpeg4_from_upipe(upipe);
+    upipe_rtp_mpeg4->mtu = DEFAULT_MTU;
+    upipe_rtp_mpeg4->max_duration = 0;
+    upipe_rtp_mpeg4->aggregate = NULL;
+    upipe_rtp_mpeg4->aggregate_duration = 0;
+    upipe_rtp_mpeg4->aggregate_size = 0;
+    upipe_rtp_mpeg4->nb_aus = 0;
+
     upipe_throw_ready(upipe);
 
     return upipe;
@@ -95,51 +207,63 @@ static struct upipe *upipe_rtp_mpeg4_alloc(struct upipe_mgr *mgr,
 static void upipe_rtp_mpeg4_input(struct upipe *upipe, struct uref *uref,
                                   struct upump **upump_p)
 {
+    struct upipe_rtp_mpeg4 *upipe_rtp_mpeg4 =
+        upipe_rtp_mpeg4_from_upipe(upipe);
+
     size_t block_size = 0;
     if (!ubase_check(uref_block_size(uref, &block_size))) {
         upipe_warn(upipe, "fail to get uref block size");
         uref_free(uref);
         return;
     }
-    if (block_size <= 7) {
+    if (block_size <= ADTS_HEADER_SIZE ||
+        block_size - ADTS_HEADER_SIZE > AU_SIZE_MAX) {
         upipe_warn(upipe, "invalid packet");
         uref_free(uref);
         return;
     }
-    block_size = (block_size - 7) << 3;
+    block_size -= ADTS_HEADER_SIZE;
 
-    struct ubuf *au = ubuf_block_alloc(uref->ubuf->mgr, 4);
-    if (unlikely(au == NULL)) {
+    if (!ubase_check(uref_block_resize(uref, ADTS_HEADER_SIZE, -1))) {
+        upipe_err(upipe, "could not skip ADTS header");
         uref_free(uref);
         return;
     }
 
-    int size = -1;
-    uint8_t *buf;
-    ubuf_block_write(au, 0, &size, &buf);
-    buf[0] = 0;
-    buf[1] = 16;
-    buf[2] = block_size >> 8;
-    buf[3] = block_size;
-    ubuf_block_unmap(au, 0);
+    /* without duration, access units are not aggregated */
+    uint64_t duration = 0;
+    bool aggregate = upipe_rtp_mpeg4->max_duration &&
+        ubase_check(uref_clock_get_duration(uref, &duration));
 
-    if (!ubase_check(uref_block_truncate(uref, 7))) {
-        upipe_err(upipe, "could not truncate uref");
-        uref_free(uref);
-        return;
-    }
+    if (upipe_rtp_mpeg4->aggregate != NULL &&
+        (!aggregate || upipe_rtp_mpeg4->nb_aus >= MAX_AUS ||
+         upipe_rtp_mpeg4->aggregate_duration + duration >
+            upipe_rtp_mpeg4->max_duration ||
+         AU_HEADERS_LENGTH_SIZE +
+            (upipe_rtp_mpeg4->nb_aus + 1) * AU_HEADER_SIZE +
+            upipe_rtp_mpeg4->aggregate_size + block_size >
+            upipe_rtp_mpeg4->mtu))
+        upipe_rtp_mpeg4_flush(upipe, upump_p);
 
-    struct ubuf *tmp = uref_detach_ubuf(uref);
-    if (unlikely(!ubase_check(ubuf_block_append(au, tmp)))) {
-        upipe_warn(upipe, "could not append payload to header");
-        ubuf_free(au);
-        ubuf_free(tmp);
+    if (upipe_rtp_mpeg4->aggregate == NULL)
+        upipe_rtp_mpeg4->aggregate = uref;
+    else {
+        struct ubuf *ubuf = uref_detach_ubuf(uref);
         uref_free(uref);
-        return;
+        if (unlikely(!ubase_check(uref_block_append(
+                        upipe_rtp_mpeg4->aggregate, ubuf)))) {
+            upipe_warn(upipe, "could not append access unit");
+            ubuf_free(ubuf);
+            return;
+        }
     }
-    uref_attach_ubuf(uref, au);
-    uref_clock_set_cr_dts_delay(uref, 0);
-    upipe_rtp_mpeg4_output(upipe, uref, upump_p);
+    upipe_rtp_mpeg4->au_sizes[upipe_rtp_mpeg4->nb_aus++] = block_size;
+    upipe_rtp_mpeg4->aggregate_size += block_size;
+    upipe_rtp_mpeg4->aggregate_duration += duration;
+
+    if (!aggregate ||
+        upipe_rtp_mpeg4->aggregate_duration >= upipe_rtp_mpeg4->max_duration)
+        upipe_rtp_mpeg4_flush(upipe, upump_p);
 }
 
 static struct upipe_mgr upipe_rtp_mpeg4_mgr = {
@@ -149,6 +273,7 @@ static struct upipe_mgr upipe_rtp_mpeg4_mgr = {
     .upipe_alloc = upipe_rtp_mpeg4_alloc,
     .upipe_input = upipe_rtp_mpeg4_input,
     .upipe_control = upipe_rtp_mpeg4_control,
+    .upipe_command_str = upipe_rtp_mpeg4_command_str,
 
     .upipe_mgr_control = NULL,
 };
@@ -49,6 +49,14 @@
 
 #include <upipe-modules/upipe_rtp_pcm_pack.h>
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSSE3__)
+#include <tmmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
 struct upipe_rtp_pcm_pack {
     /** refcount management structure */
     struct urefcount urefcount;
@@ -116,6 +124,49 @@ UPIPE_HELPER_UREF_STREAM(upipe_rtp_pcm_pack, next_uref, next_uref_size, urefs, N
 UPIPE_HELPER_INPUT(upipe_rtp_pcm_pack, input_urefs, nb_urefs, max_urefs, blockers,
         upipe_rtp_pcm_pack_handle)
 
+/** @internal @This converts s32 samples to 24-bit big-endian samples.
+ *
+ * @param dst destination buffer, 3 octets per sample
+ * @param src source samples
+ * @param samples number of samples (all channels)
+ */
+static void upipe_rtp_pcm_pack_s24be(uint8_t *dst, const int32_t *src,
+                                     size_t samples)
+{
+    size_t i = 0;
+#if defined(__AVX2__)
+    const __m256i shuffle = _mm256_setr_epi8(
+        3, 2, 1, 7, 6, 5, 11, 10, 9, 15, 14, 13, -1, -1, -1, -1,
+        3, 2, 1, 7, 6, 5, 11, 10, 9, 15, 14, 13, -1, -1, -1, -1);
+    const __m256i permute = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 7, 7);
+    /* 8 samples produce 24 octets, but 32 are stored */
+    for (; i + 11 <= samples; i += 8) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(src + i));
+        v = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(v, shuffle),
+                                        permute);
+        _mm256_storeu_si256((__m256i *)(dst + 3 * i), v);
+    }
+#elif defined(__SSSE3__)
+    const __m128i shuffle = _mm_setr_epi8(
+        3, 2, 1, 7, 6, 5, 11, 10, 9, 15, 14, 13, -1, -1, -1, -1);
+    /* 4 samples produce 12 octets, but 16 are stored */
+    for (; i + 6 <= samples; i += 4) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(src + i));
+        _mm_storeu_si128((__m128i *)(dst + 3 * i),
+                         _mm_shuffle_epi8(v, shuffle));
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    for (; i + 16 <= samples; i += 16) {
+        uint8x16x4_t v = vld4q_u8((const uint8_t *)(src + i));
+        uint8x16x3_t out = { { v.val[3], v.val[2], v.val[1] } };
+        vst3q_u8(dst + 3 * i, out);
+    }
+#endif
+    for (; i < samples; i++)
+        for (int j = 0; j < 3; j++)
+            dst[3*i+j] = (src[i] >> (8 * (3-j))) & 0xff;
+}
+
 static int upipe_rtp_pcm_pack_check(struct upipe *upipe, struct uref *flow_format)
 {
     if (flow_format)
@@ -295,9 +346,7 @@ static bool upipe_rtp_pcm_pack_handle(struct upipe *upipe, struct uref *uref,
 
     uref_sound_read_int32_t(uref, 0, -1, &src, 1);
 
-    for (int i = 0; i < s; i++)
-        for (int j = 0; j < 3; j++)
-            dst[3*i+j] = (src[i] >> (8 * (3-j))) & 0xff;
+    upipe_rtp_pcm_pack_s24be(dst, src, s);
 
     ubuf_block_unmap(ubuf, 0);
     uref_sound_unmap(uref, 0, -1, 1);
@@ -49,6 +49,14 @@
 #include <upipe/ubuf_sound.h>
 #include <upipe/ubuf_block.h>
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSSE3__)
+#include <tmmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
 struct upipe_rtp_pcm_unpack {
     /** refcount management structure */
     struct urefcount urefcount;
@@ -227,6 +235,48 @@ static void upipe_rtp_pcm_unpack_input(struct upipe *upipe, struct uref *uref,
     }
 }
 
+/** @internal @This converts 24-bit big-endian samples to s32 samples.
+ *
+ * @param dst destination samples
+ * @param src source buffer, 3 octets per sample
+ * @param samples number of samples (all channels)
+ */
+static void upipe_rtp_pcm_unpack_s24be(int32_t *dst, const uint8_t *src,
+                                       size_t samples)
+{
+    size_t i = 0;
+#if defined(__AVX2__)
+    const __m256i permute = _mm256_setr_epi32(0, 1, 2, 3, 3, 4, 5, 6);
+    const __m256i shuffle = _mm256_setr_epi8(
+        -1, 2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9,
+        -1, 2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9);
+    /* 8 samples use 24 octets, but 32 are loaded */
+    for (; i + 11 <= samples; i += 8) {
+        __m256i v = _mm256_loadu_si256((const __m256i *)(src + 3 * i));
+        v = _mm256_shuffle_epi8(_mm256_permutevar8x32_epi32(v, permute),
+                                shuffle);
+        _mm256_storeu_si256((__m256i *)(dst + i), v);
+    }
+#elif defined(__SSSE3__)
+    const __m128i shuffle = _mm_setr_epi8(
+        -1, 2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9);
+    /* 4 samples use 12 octets, but 16 are loaded */
+    for (; i + 6 <= samples; i += 4) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(src + 3 * i));
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_shuffle_epi8(v, shuffle));
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    for (; i + 16 <= samples; i += 16) {
+        uint8x16x3_t v = vld3q_u8(src + 3 * i);
+        uint8x16x4_t out = { { vdupq_n_u8(0), v.val[2], v.val[1], v.val[0] } };
+        vst4q_u8((uint8_t *)(dst + i), out);
+    }
+#endif
+    for (; i < samples; i++)
+        dst[i] = ((uint32_t)src[3*i] << 24) | (src[3*i+1] << 16) |
+                 (src[3*i+2] << 8);
+}
+
 static bool upipe_rtp_pcm_unpack_handle(struct upipe *upipe, struct uref *uref,
                                   struct upump **upump_p)
 {
@@ -252,8 +302,7 @@ static bool upipe_rtp_pcm_unpack_handle(struct upipe *upipe, struct uref *uref,
     uref_block_read(uref, 0, &size, &src);
     ubuf_sound_write_int32_t(ubuf, 0, -1, &dst, 1);
 
-    for (int i = 0; i < s; i++)
-        dst[i] = (src[3*i] << 24) | (src[3*i+1] << 16) | (src[3*i+2] << 8);
+    upipe_rtp_pcm_unpack_s24be(dst, src, s);
 
     ubuf_sound_unmap(ubuf, 0, -1, 1);
     uref_block_unmap(uref, 0);
@@ -151,48 +151,42 @@ static void upipe_rtp_prepend_input(struct upipe *upipe, struct uref *uref,
     ts = div.quot * upipe_rtp_prepend->clockrate
          + ((uint64_t)div.rem * upipe_rtp_prepend->clockrate)/UCLOCK_FREQ;
 
-    /* alloc header */
-    header = ubuf_block_alloc(uref->ubuf->mgr, RTP_HEADER_SIZE);
-    if (unlikely(!header)) {
-        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
-        uref_free(uref);
-        return;
-    }
-
-    /* write header */
-    ubuf_block_write(header, 0, &size, &buf);
-    memset(buf, 0, RTP_HEADER_SIZE);
-    rtp_set_hdr(buf);
-    rtp_set_type(buf, upipe_rtp_prepend->type);
-    rtp_set_seqnum(buf, upipe_rtp_prepend->seqnum);
-    rtp_set_timestamp(buf, ts);
-    ubuf_block_unmap(header, 0);
-    upipe_rtp_prepend->seqnum++;
+    size_t header_size = RTP_HEADER_SIZE + (upipe_rtp_prepend->mpa ? 4 : 0);
 
-    if (upipe_rtp_prepend->mpa) {
-        /* alloc mpa header */
-        struct ubuf *mpa_header = ubuf_block_alloc(uref->ubuf->mgr, 4);
-        if (unlikely(!mpa_header)) {
+    /* write the header in the headroom of the payload if possible,
+     * otherwise in a new segment */
+    if (ubase_check(uref_block_prepend(uref, header_size))) {
+        header = NULL;
+        if (unlikely(!ubase_check(uref_block_write(uref, 0, &size, &buf)))) {
             upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
             uref_free(uref);
-            ubuf_free(header);
             return;
         }
-
-        /* write mpa mpa_header */
-        ubuf_block_write(mpa_header, 0, &size, &buf);
-        memset(buf, 0, 4); // frag_offset = 0
-        ubuf_block_unmap(mpa_header, 0);
-
-        if (unlikely(!ubase_check(ubuf_block_append(header, mpa_header)))) {
-            upipe_warn(upipe, "could not append mpa header to header");
-            ubuf_free(header);
-            ubuf_free(mpa_header);
+    } else {
+        header = ubuf_block_alloc(uref->ubuf->mgr, header_size);
+        if (unlikely(!header)) {
+            upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
             uref_free(uref);
             return;
         }
+        ubuf_block_write(header, 0, &size, &buf);
     }
 
+    /* write header, the mpa header being all zeros (frag_offset = 0) */
+    memset(buf, 0, header_size);
+    rtp_set_hdr(buf);
+    rtp_set_type(buf, upipe_rtp_prepend->type);
+    rtp_set_seqnum(buf, upipe_rtp_prepend->seqnum);
+    rtp_set_timestamp(buf, ts);
+    upipe_rtp_prepend->seqnum++;
+
+    if (header == NULL) {
+        uref_block_unmap(uref, 0);
+        upipe_rtp_prepend_output(upipe, uref, upump_p);
+        return;
+    }
+    ubuf_block_unmap(header, 0);
+
     /* append payload (current ubuf) to header to form segmented ubuf */
     payload = uref_detach_ubuf(uref);
     if (unlikely(!ubase_check(ubuf_block_append(header, payload)))) {
@@ -63,6 +63,19 @@
 #include <math.h>
 #include <assert.h>
 
+/** initial number of slots of the reorder ring (power of 2) */
+#define RTPR_RING_MIN 1024
+/** maximum number of slots of the reorder ring (half the sequence space) */
+#define RTPR_RING_MAX 32768
+/** lateness offset divider in adaptive mode */
+#define RTPR_OFFSET_DIVIDER 100
+/** lateness deviation divider in adaptive mode */
+#define RTPR_DEVIATION_DIVIDER 100
+/** period after which a reorder-free path is accounted as on-time */
+#define RTPR_CLEAN_PERIOD (UCLOCK_FREQ / 10)
+/** the delay moves by at most 1/RTPR_SLEW of the elapsed time */
+#define RTPR_SLEW 100
+
 /** @hidden */
 static bool upipe_rtpr_sub_output(struct upipe *upipe, struct uref *uref,
                                   struct upump **upump_p);
@@ -102,13 +115,38 @@ struct upipe_rtpr {
     /** manager to create subs */
     struct upipe_mgr sub_mgr;
 
-    struct uchain queue;
+    /** buffered packets indexed by sequence number */
+    struct uref **ring;
+    /** number of slots of the ring (power of 2) */
+    uint32_t ring_size;
+    /** sequence number of the oldest buffered packet, or UINT32_MAX */
+    uint32_t first_seqnum;
+    /** sequence number of the newest buffered packet */
+    uint32_t last_seqnum;
+    /** bitmap of the buffered sequence numbers */
+    uint64_t present[UINT16_MAX / 64 + 1];
 
     uint64_t last_sent_seqnum;
     uint64_t num_consecutive_late;
 
     /** delay to set */
     uint64_t delay;
+    /** minimum delay in adaptive mode */
+    uint64_t delay_min;
+    /** maximum delay in adaptive mode, equal to delay_min otherwise */
+    uint64_t delay_max;
+    /** average lateness of reordered packets */
+    double late_offset;
+    /** number of samples in the average lateness */
+    unsigned int late_offset_count;
+    /** RMS deviation of the lateness of reordered packets */
+    double late_deviation;
+    /** number of samples in the deviation */
+    unsigned int late_deviation_count;
+    /** system date of the last lateness sample, or UINT64_MAX */
+    uint64_t late_date;
+    /** system date of the last adjustment of the delay, or UINT64_MAX */
+    uint64_t adjust_date;
 
     /** public upipe structure */
     struct upipe upipe;
@@ -263,38 +301,202 @@ static int upipe_rtpr_sub_control(struct upipe *upipe,
     }
 }
 
+/** @internal @This checks if a sequence number is buffered.
+ *
+ * @param rtpr private structure of the pipe
+ * @param seqnum sequence number
+ * @return true if a packet with this sequence number is buffered
+ */
+static inline bool upipe_rtpr_is_present(struct upipe_rtpr *rtpr,
+                                         uint16_t seqnum)
+{
+    return rtpr->present[seqnum / 64] & (UINT64_C(1) << (seqnum % 64));
+}
+
+/** @internal @This removes a packet from the ring and returns it.
+ *
+ * @param rtpr private structure of the pipe
+ * @param seqnum sequence number of the buffered packet
+ * @return pointer to the packet
+ */
+static struct uref *upipe_rtpr_take(struct upipe_rtpr *rtpr, uint16_t seqnum)
+{
+    struct uref **slot = &rtpr->ring[seqnum & (rtpr->ring_size - 1)];
+    struct uref *uref = *slot;
+    *slot = NULL;
+    rtpr->present[seqnum / 64] &= ~(UINT64_C(1) << (seqnum % 64));
+
+    if (seqnum == rtpr->first_seqnum) {
+        /* move to the next buffered packet */
+        uint16_t end = rtpr->last_seqnum + 1;
+        do
+            seqnum++;
+        while (seqnum != end && !upipe_rtpr_is_present(rtpr, seqnum));
+        rtpr->first_seqnum = seqnum == end ? UINT32_MAX : seqnum;
+    }
+    return uref;
+}
+
+/** @internal @This outputs the oldest buffered packet.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_rtpr_output_first(struct upipe *upipe)
+{
+    struct upipe_rtpr *rtpr = upipe_rtpr_from_upipe(upipe);
+    uint16_t seqnum = rtpr->first_seqnum;
+    struct uref *uref = upipe_rtpr_take(rtpr, seqnum);
+    rtpr->last_sent_seqnum = seqnum;
+    upipe_rtpr_output(upipe, uref, NULL);
+}
+
+/** @internal @This doubles the size of the ring.
+ *
+ * @param upipe description structure of the pipe
+ * @return false if the ring couldn't be grown
+ */
+static bool upipe_rtpr_grow(struct upipe *upipe)
+{
+    struct upipe_rtpr *rtpr = upipe_rtpr_from_upipe(upipe);
+    if (rtpr->ring_size >= RTPR_RING_MAX)
+        return false;
+
+    uint32_t ring_size = rtpr->ring_size ? 2 * rtpr->ring_size : RTPR_RING_MIN;
+    struct uref **ring = calloc(ring_size, sizeof(struct uref *));
+    if (unlikely(ring == NULL)) {
+        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+        return false;
+    }
+
+    if (rtpr->first_seqnum != UINT32_MAX) {
+        uint16_t seqnum = rtpr->first_seqnum;
+        uint16_t end = rtpr->last_seqnum + 1;
+        for ( ; seqnum != end; seqnum++)
+            ring[seqnum & (ring_size - 1)] =
+                rtpr->ring[seqnum & (rtpr->ring_size - 1)];
+    }
+    free(rtpr->ring);
+    rtpr->ring = ring;
+    rtpr->ring_size = ring_size;
+    return true;
+}
+
+/** @internal @This accounts the lateness of a packet in adaptive mode, in
+ * the same way as uprobe_dejitter accounts the offset of clock references.
+ *
+ * @param rtpr private structure of the pipe
+ * @param lateness time between the arrival of the next packet and the
+ * arrival of this packet
+ */
+static void upipe_rtpr_adapt_sample(struct upipe_rtpr *rtpr, double lateness)
+{
+    rtpr->late_offset =
+        (rtpr->late_offset * rtpr->late_offset_count + lateness) /
+        (rtpr->late_offset_count + 1);
+    if (rtpr->late_offset_count < RTPR_OFFSET_DIVIDER)
+        rtpr->late_offset_count++;
+
+    double deviation = lateness - rtpr->late_offset;
+    rtpr->late_deviation =
+        sqrt((rtpr->late_deviation * rtpr->late_deviation *
+              rtpr->late_deviation_count + deviation * deviation) /
+             (rtpr->late_deviation_count + 1));
+    if (rtpr->late_deviation_count < RTPR_DEVIATION_DIVIDER)
+        rtpr->late_deviation_count++;
+}
+
+/** @internal @This moves the delay towards the wanted delay in adaptive
+ * mode. The delay is slewed so that the output is only slightly stretched
+ * or compressed in time.
+ *
+ * @param upipe description structure of the pipe
+ * @param now current system time
+ */
+static void upipe_rtpr_adapt(struct upipe *upipe, uint64_t now)
+{
+    struct upipe_rtpr *rtpr = upipe_rtpr_from_upipe(upipe);
+    if (rtpr->delay_max <= rtpr->delay_min)
+        return;
+
+    if (unlikely(rtpr->adjust_date == UINT64_MAX || now < rtpr->adjust_date))
+        rtpr->adjust_date = rtpr->late_date = now;
+    if (now - rtpr->late_date > RTPR_CLEAN_PERIOD) {
+        upipe_rtpr_adapt_sample(rtpr, 0);
+        rtpr->late_date = now;
+    }
+
+    double wanted = rtpr->late_offset + 3 * rtpr->late_deviation;
+    uint64_t target = wanted < rtpr->delay_min ? rtpr->delay_min :
+                      wanted > rtpr->delay_max ? rtpr->delay_max : wanted;
+    uint64_t max_change = (now - rtpr->adjust_date) / RTPR_SLEW;
+    if (!max_change)
+        return;
+    rtpr->adjust_date = now;
+
+    if (target > rtpr->delay + max_change)
+        rtpr->delay += max_change;
+    else if (target + max_change < rtpr->delay)
+        rtpr->delay -= max_change;
+    else
+        rtpr->delay = target;
+}
+
+/** @internal @This measures the lateness of a reordered packet in adaptive
+ * mode, against the next buffered packet.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref reordered packet
+ * @param seqnum sequence number of the reordered packet
+ */
+static void upipe_rtpr_adapt_late(struct upipe *upipe, struct uref *uref,
+                                  uint16_t seqnum)
+{
+    struct upipe_rtpr *rtpr = upipe_rtpr_from_upipe(upipe);
+    uint64_t date_sys, next_date_sys;
+    int type;
+    uref_clock_get_date_sys(uref, &date_sys, &type);
+    if (type == UREF_DATE_NONE)
+        return;
+
+    uint16_t end = rtpr->last_seqnum + 1;
+    for (seqnum++; seqnum != end; seqnum++) {
+        if (!upipe_rtpr_is_present(rtpr, seqnum))
+            continue;
+        struct uref *next = rtpr->ring[seqnum & (rtpr->ring_size - 1)];
+        uref_clock_get_date_sys(next, &next_date_sys, &type);
+        if (type == UREF_DATE_NONE)
+            continue;
+        if (date_sys > next_date_sys) {
+            upipe_rtpr_adapt_sample(rtpr, date_sys - next_date_sys);
+            rtpr->late_date = date_sys;
+        }
+        return;
+    }
+}
+
 static void upipe_rtpr_timer(struct upump *upump)
 {
     struct upipe *upipe = upump_get_opaque(upump, struct upipe *);
     struct upipe_rtpr *rtpr = upipe_rtpr_from_upipe(upipe);
     uint64_t now = uclock_now(rtpr->uclock);
-    uint64_t date_sys;
-    int type;
-    struct uchain *uchain, *uchain_tmp;
-    struct uref *uref;
+    upipe_rtpr_adapt(upipe, now);
 
-    ulist_delete_foreach(&rtpr->queue, uchain, uchain_tmp) {
-        uref = uref_from_uchain(uchain);
+    while (rtpr->first_seqnum != UINT32_MAX) {
+        struct uref *uref =
+            rtpr->ring[rtpr->first_seqnum & (rtpr->ring_size - 1)];
+        uint64_t date_sys = UINT64_MAX;
+        int type;
         uref_clock_get_date_sys(uref, &date_sys, &type);
-        uint64_t seqnum = 0;
-        uref_attr_get_priv(uref, &seqnum);
 
-        if (now >= date_sys || date_sys == UINT64_MAX) {
-            ulist_delete(uchain);
-            upipe_rtpr_output(upipe, uref, NULL);
-            rtpr->last_sent_seqnum = seqnum;
-        }
-        else {
+        if (now < date_sys && date_sys != UINT64_MAX)
             break;
-        }
+        upipe_rtpr_output_first(upipe);
     }
 }
 
 static void upipe_rtpr_list_add(struct upipe *upipe, struct uref *uref)
 {
     struct upipe_rtpr *rtpr = upipe_rtpr_from_upipe(upipe);
-    int dup = 0, ooo = 0;
-    struct uchain *uchain, *uchain_tmp;
 
     uint8_t rtp_buffer[RTP_HEADER_SIZE];
     const uint8_t *rtp_header = uref_block_peek(uref, 0, RTP_HEADER_SIZE,
@@ -314,6 +516,9 @@ static void upipe_rtpr_list_add(struct upipe *upipe, struct uref *uref)
         (seq_num_lt(new_seqnum, rtpr->last_sent_seqnum) || new_seqnum == rtpr->last_sent_seqnum)) {
         uref_free(uref);
         rtpr->num_consecutive_late++;
+        /* the packet was later than the delay */
+        if (rtpr->delay_max > rtpr->delay_min)
+            upipe_rtpr_adapt_sample(rtpr, 2 * rtpr->delay);
 
         /* Assume new stream if too many consecutive late packets */
         if (rtpr->num_consecutive_late > 200)
@@ -324,46 +529,50 @@ static void upipe_rtpr_list_add(struct upipe *upipe, struct uref *uref)
 
     rtpr->num_consecutive_late = 0;
 
-    /* Remove date_sys for any late packets */
-    ulist_delete_foreach_reverse(&rtpr->queue, uchain, uchain_tmp) {
-        struct uref *cur_uref = uref_from_uchain(uchain);
-        uint64_t seqnum = 0;
-        uref_attr_get_priv(cur_uref, &seqnum);
-
-        if (seq_num_lt(new_seqnum, seqnum)) {
-            if (ulist_is_first(&rtpr->queue, uchain)) {
-                uref_clock_delete_date_sys(uref);
-                ulist_insert(uchain->prev, uchain, uref_to_uchain(uref));
-                ooo = 1;
-                break;
-            }
-            else {
-                struct uref *prev_uref = uref_from_uchain(uchain->prev);
-                uint64_t prev_seqnum = 0;
-                uref_attr_get_priv(prev_uref, &prev_seqnum);
-                if (!seq_num_lt(new_seqnum, prev_seqnum) && !(new_seqnum == prev_seqnum)) {
-                    uref_clock_delete_date_sys(uref);
-                    ulist_insert(uchain->prev, uchain, uref_to_uchain(uref));
-                    ooo = 1;
-                    break;
+    /* Duplicate packet */
+    if (upipe_rtpr_is_present(rtpr, new_seqnum)) {
+        uref_free(uref);
+        return;
+    }
+
+    if (rtpr->first_seqnum == UINT32_MAX) {
+        if (unlikely(rtpr->ring == NULL) && !upipe_rtpr_grow(upipe)) {
+            uref_free(uref);
+            return;
+        }
+        rtpr->first_seqnum = rtpr->last_seqnum = new_seqnum;
+    } else if (seq_num_lt(rtpr->last_seqnum, new_seqnum)) {
+        /* Normal packet, make room for it */
+        while (rtpr->first_seqnum != UINT32_MAX &&
+               (uint16_t)(new_seqnum - rtpr->first_seqnum) >=
+                   rtpr->ring_size &&
+               !upipe_rtpr_grow(upipe)) {
+            upipe_warn(upipe, "reorder buffer full, releasing packet");
+            upipe_rtpr_output_first(upipe);
+        }
+        if (rtpr->first_seqnum == UINT32_MAX)
+            rtpr->first_seqnum = new_seqnum;
+        rtpr->last_seqnum = new_seqnum;
+    } else {
+        if (rtpr->delay_max > rtpr->delay_min)
+            upipe_rtpr_adapt_late(upipe, uref, new_seqnum);
+
+        /* Remove date_sys for any late packets */
+        if (seq_num_lt(new_seqnum, rtpr->first_seqnum)) {
+            while ((uint16_t)(rtpr->last_seqnum - new_seqnum) >=
+                       rtpr->ring_size) {
+                if (!upipe_rtpr_grow(upipe)) {
+                    uref_free(uref);
+                    return;
                 }
             }
+            rtpr->first_seqnum = new_seqnum;
         }
-        /* Duplicate packet */
-        else if (new_seqnum == seqnum) {
-            dup = 1;
-            uref_free(uref);
-            break;
-        }
-        else
-            break;
+        uref_clock_delete_date_sys(uref);
     }
 
-
-    /* Add to end if normal packet */
-    if (!dup && !ooo) {
-        ulist_add(&rtpr->queue, uref_to_uchain(uref));
-    }
+    rtpr->ring[new_seqnum & (rtpr->ring_size - 1)] = uref;
+    rtpr->present[new_seqnum / 64] |= UINT64_C(1) << (new_seqnum % 64);
 }
 
 /** @internal @This receives data.
@@ -443,14 +652,10 @@ static void upipe_rtpr_init_sub_mgr(struct upipe *upipe)
 static void upipe_rtpr_clean_queue(struct upipe *upipe)
 {
     struct upipe_rtpr *rtpr = upipe_rtpr_from_upipe(upipe);
-    struct uchain *uchain, *uchain_tmp;
-    struct uref *uref;
 
-    ulist_delete_foreach(&rtpr->queue, uchain, uchain_tmp) {
-        uref = uref_from_uchain(uchain);
-        ulist_delete(uchain);
-        uref_free(uref);
-    }
+    while (rtpr->first_seqnum != UINT32_MAX)
+        uref_free(upipe_rtpr_take(rtpr, rtpr->first_seqnum));
+    free(rtpr->ring);
 }
 
 /** @internal @This allocates a rtpr pipe.
@@ -484,11 +689,22 @@ static struct upipe *upipe_rtpr_alloc(struct upipe_mgr *mgr,
 
     upipe_rtpr->flow_def_input = NULL;
 
-    ulist_init(&upipe_rtpr->queue);
+    upipe_rtpr->ring = NULL;
+    upipe_rtpr->ring_size = 0;
+    upipe_rtpr->first_seqnum = UINT32_MAX;
+    upipe_rtpr->last_seqnum = UINT32_MAX;
+    memset(upipe_rtpr->present, 0, sizeof(upipe_rtpr->present));
 
     upipe_rtpr->last_sent_seqnum = UINT64_MAX;
     upipe_rtpr->num_consecutive_late = 0;
     upipe_rtpr->delay = UCLOCK_FREQ/10;
+    upipe_rtpr->delay_min = upipe_rtpr->delay_max = upipe_rtpr->delay;
+    upipe_rtpr->late_offset = 0;
+    upipe_rtpr->late_offset_count = 0;
+    upipe_rtpr->late_deviation = 0;
+    upipe_rtpr->late_deviation_count = 0;
+    upipe_rtpr->late_date = UINT64_MAX;
+    upipe_rtpr->adjust_date = UINT64_MAX;
 
     upipe_rtpr_check_upump_mgr(upipe);
 
@@ -535,7 +751,7 @@ static int _upipe_rtpr_get_delay(struct upipe *upipe, uint64_t *delay_p)
     return UBASE_ERR_NONE;
 }
 
-/** @This sets the delay to set into urefs.
+/** @This sets the delay to set into urefs, and disables the adaptive mode.
  *
  * @param upipe description structure of the pipe
  * @param delay delay to set
@@ -545,6 +761,74 @@ static int _upipe_rtpr_set_delay(struct upipe *upipe, uint64_t delay)
 {
     struct upipe_rtpr *upipe_rtpr = upipe_rtpr_from_upipe(upipe);
     upipe_rtpr->delay = delay;
+    upipe_rtpr->delay_min = upipe_rtpr->delay_max = delay;
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This sets the bounds of the delay in adaptive mode.
+ *
+ * @param upipe description structure of the pipe
+ * @param delay_min minimum delay
+ * @param delay_max maximum delay
+ * @return an error code
+ */
+static int _upipe_rtpr_set_delay_range(struct upipe *upipe,
+                                       uint64_t delay_min, uint64_t delay_max)
+{
+    struct upipe_rtpr *upipe_rtpr = upipe_rtpr_from_upipe(upipe);
+    if (delay_min > delay_max)
+        return UBASE_ERR_INVALID;
+    upipe_rtpr->delay_min = delay_min;
+    upipe_rtpr->delay_max = delay_max;
+    if (upipe_rtpr->delay < delay_min)
+        upipe_rtpr->delay = delay_min;
+    else if (upipe_rtpr->delay > delay_max)
+        upipe_rtpr->delay = delay_max;
+    upipe_rtpr->adjust_date = UINT64_MAX;
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This returns the packets buffered in the reorder ring.
+ *
+ * @param upipe description structure of the pipe
+ * @param occupancy filled in with the buffered packets
+ * @return an error code
+ */
+static int upipe_rtpr_get_occupancy(struct upipe *upipe,
+                                    struct upipe_occupancy *occupancy)
+{
+    struct upipe_rtpr *rtpr = upipe_rtpr_from_upipe(upipe);
+    occupancy->urefs = 0;
+    occupancy->max_urefs = RTPR_RING_MAX;
+    occupancy->bytes = 0;
+    occupancy->duration = 0;
+    if (rtpr->first_seqnum == UINT32_MAX)
+        return UBASE_ERR_NONE;
+
+    uint64_t first_date = UINT64_MAX, last_date = 0;
+    uint16_t seqnum = rtpr->first_seqnum;
+    uint16_t end = rtpr->last_seqnum + 1;
+    for ( ; seqnum != end; seqnum++) {
+        if (!upipe_rtpr_is_present(rtpr, seqnum))
+            continue;
+        struct uref *uref = rtpr->ring[seqnum & (rtpr->ring_size - 1)];
+        size_t size = 0;
+        uref_block_size(uref, &size);
+        occupancy->urefs++;
+        occupancy->bytes += size;
+
+        uint64_t date_sys;
+        int type;
+        uref_clock_get_date_sys(uref, &date_sys, &type);
+        if (type == UREF_DATE_NONE)
+            continue;
+        if (date_sys < first_date)
+            first_date = date_sys;
+        if (date_sys > last_date)
+            last_date = date_sys;
+    }
+    if (first_date < last_date)
+        occupancy->duration = last_date - first_date;
     return UBASE_ERR_NONE;
 }
 
@@ -574,6 +858,11 @@ static int upipe_rtpr_control(struct upipe *upipe, int command, va_list args)
             struct uref *flow_def = va_arg(args, struct uref *);
             return upipe_rtpr_set_flow_def(upipe, flow_def);
         }
+        case UPIPE_GET_OCCUPANCY: {
+            struct upipe_occupancy *occupancy =
+                va_arg(args, struct upipe_occupancy *);
+            return upipe_rtpr_get_occupancy(upipe, occupancy);
+        }
         case UPIPE_RTPR_GET_DELAY: {
             UBASE_SIGNATURE_CHECK(args, UPIPE_RTPR_SIGNATURE)
             uint64_t *delay_p = va_arg(args, uint64_t *);
@@ -584,6 +873,12 @@ static int upipe_rtpr_control(struct upipe *upipe, int command, va_list args)
             uint64_t delay = va_arg(args, uint64_t);
             return _upipe_rtpr_set_delay(upipe, delay);
         }
+        case UPIPE_RTPR_SET_DELAY_RANGE: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_RTPR_SIGNATURE)
+            uint64_t delay_min = va_arg(args, uint64_t);
+            uint64_t delay_max = va_arg(args, uint64_t);
+            return _upipe_rtpr_set_delay_range(upipe, delay_min, delay_max);
+        }
         default:
             return UBASE_ERR_UNHANDLED;
     }
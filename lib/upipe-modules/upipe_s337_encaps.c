@@ -53,6 +53,16 @@
 #include <bitstream/atsc/a52.h>
 #include <bitstream/smpte/337.h>
 
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define UPIPE_S337E_SSE2
+#elif defined(__aarch64__) && !defined(__AARCH64EB__)
+#include <arm_neon.h>
+#define UPIPE_S337E_NEON
+#endif
+
 #define EXPECTED_FLOW_DEF "block.ac3.sound."
 
 /** upipe_s337_encaps structure */
@@ -92,6 +102,39 @@ struct upipe_s337_encaps {
 /** @hidden */
 static int upipe_s337_encaps_check(struct upipe *upipe, struct uref *flow_format);
 
+/** @internal @This packs payload octets into 16-bit words, in the upper
+ * bits of s32 samples.
+ *
+ * @param out output samples
+ * @param buf payload octets
+ * @param words number of 16-bit words to pack
+ */
+static void upipe_s337_encaps_pack16(int32_t *out, const uint8_t *buf,
+                                     int words)
+{
+    int i = 0;
+#if defined(UPIPE_S337E_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+    for ( ; i + 8 <= words; i += 8) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(buf + 2 * i));
+        /* big-endian words */
+        v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+        _mm_storeu_si128((__m128i *)(out + i), _mm_unpacklo_epi16(zero, v));
+        _mm_storeu_si128((__m128i *)(out + i + 4),
+                         _mm_unpackhi_epi16(zero, v));
+    }
+#elif defined(UPIPE_S337E_NEON)
+    const uint8x16_t zero = vdupq_n_u8(0);
+    for ( ; i + 16 <= words; i += 16) {
+        uint8x16x2_t v = vld2q_u8(buf + 2 * i);
+        uint8x16x4_t o = { { zero, zero, v.val[1], v.val[0] } };
+        vst4q_u8((uint8_t *)(out + i), o);
+    }
+#endif
+    for ( ; i < words; i++)
+        out[i] = ((uint32_t)buf[2*i + 0] << 24) | (buf[2*i + 1] << 16);
+}
+
 /** @hidden */
 static bool upipe_s337_encaps_handle(struct upipe *upipe, struct uref *uref,
                                 struct upump **upump_p);
@@ -196,8 +239,7 @@ static bool upipe_s337_encaps_handle(struct upipe *upipe, struct uref *uref,
             return true;
         }
 
-        for (int i = 0; i < size/2; i++)
-            out_data[4 + offset/2 + i] = (buf[2*i + 0] << 24) | (buf[2*i + 1] << 16);
+        upipe_s337_encaps_pack16(&out_data[4 + offset/2], buf, size/2);
 
         uref_block_unmap(uref, offset);
 
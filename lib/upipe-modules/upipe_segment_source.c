@@ -36,6 +36,7 @@
 #include <upipe/upipe_helper_upipe.h>
 
 #include <upipe/uref_block.h>
+#include <upipe/upump_blocker.h>
 
 #include <upipe/uprobe_prefix.h>
 
@@ -57,6 +58,23 @@ struct upipe_seg_src {
     uint64_t start;
     size_t size;
     bool first_uref;
+
+    /** source pipe opened in advance, or NULL */
+    struct upipe *prefetch_src;
+    /** probe pipe of the source opened in advance */
+    struct upipe *prefetch_uref;
+    /** uri of the source opened in advance */
+    char *prefetch_uri;
+    /** size to read in advance */
+    uint64_t prefetch_size;
+    /** list of urefs read in advance */
+    struct uchain prefetched;
+    /** size of the urefs read in advance */
+    uint64_t prefetched_size;
+    /** blocker of the source pump once enough data is read in advance */
+    struct upump_blocker *blocker;
+    /** the end of the source was reached while prefetching */
+    bool prefetch_ended;
 };
 
 static int probe_burst(struct uprobe *uprobe, struct upipe *inner,
@@ -104,6 +122,77 @@ static int upipe_seg_src_update(struct upipe *upipe)
     return UBASE_ERR_INVALID;
 }
 
+/** @internal @This is called when the blocked source pump is released.
+ *
+ * @param blocker description structure of the blocker
+ */
+static void upipe_seg_src_blocker_cb(struct upump_blocker *blocker)
+{
+    struct upipe *upipe = upump_blocker_get_opaque(blocker, struct upipe *);
+    struct upipe_seg_src *upipe_seg_src = upipe_seg_src_from_upipe(upipe);
+
+    upump_blocker_free(upipe_seg_src->blocker);
+    upipe_seg_src->blocker = NULL;
+}
+
+/** @internal @This keeps an uref read in advance, and blocks the source pump
+ * once enough data is read.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref uref read in advance
+ * @param upump_p reference to the pump that generated the uref
+ * @return an error code
+ */
+static int upipe_seg_src_hold(struct upipe *upipe, struct uref *uref,
+                              struct upump **upump_p)
+{
+    struct upipe_seg_src *upipe_seg_src = upipe_seg_src_from_upipe(upipe);
+
+    size_t size = 0;
+    uref_block_size(uref, &size);
+    uref = uref_dup(uref);
+    UBASE_ALLOC_RETURN(uref);
+    ulist_add(&upipe_seg_src->prefetched, uref_to_uchain(uref));
+    upipe_seg_src->prefetched_size += size;
+
+    if (upipe_seg_src->prefetched_size >= upipe_seg_src->prefetch_size &&
+        upipe_seg_src->blocker == NULL && upump_p != NULL && *upump_p != NULL) {
+        upipe_dbg_va(upipe, "prefetched %"PRIu64" bytes",
+                     upipe_seg_src->prefetched_size);
+        upipe_seg_src->blocker =
+            upump_blocker_alloc(*upump_p, upipe_seg_src_blocker_cb, upipe,
+                                upipe->refcount);
+    }
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This releases the source opened in advance, if any.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_seg_src_cancel_prefetch(struct upipe *upipe)
+{
+    struct upipe_seg_src *upipe_seg_src = upipe_seg_src_from_upipe(upipe);
+    struct uchain *uchain;
+
+    if (upipe_seg_src->blocker != NULL) {
+        upump_blocker_free(upipe_seg_src->blocker);
+        upipe_seg_src->blocker = NULL;
+    }
+    while ((uchain = ulist_pop(&upipe_seg_src->prefetched)) != NULL)
+        uref_free(uref_from_uchain(uchain));
+    upipe_seg_src->prefetched_size = 0;
+    upipe_seg_src->prefetch_ended = false;
+    ubase_clean_str(&upipe_seg_src->prefetch_uri);
+
+    /* the probe pipe is still known when it dies, so that no update is
+     * thrown for it */
+    upipe_release(upipe_seg_src->prefetch_src);
+    upipe_seg_src->prefetch_src = NULL;
+    upipe_release(upipe_seg_src->prefetch_uref);
+    upipe_seg_src->prefetch_uref = NULL;
+}
+
 static int probe_burst(struct uprobe *uprobe, struct upipe *inner,
                      int event, va_list args)
 {
@@ -150,6 +239,13 @@ static int probe_uref(struct uprobe *uprobe, struct upipe *inner,
         UBASE_SIGNATURE_CHECK(args, UPIPE_PROBE_UREF_SIGNATURE);
         struct uref *uref = va_arg(args, struct uref *);
 
+        if (inner == upipe_seg_src->prefetch_uref) {
+            struct upump **upump_p = va_arg(args, struct upump **);
+            bool *drop = va_arg(args, bool *);
+            *drop = true;
+            return upipe_seg_src_hold(upipe, uref, upump_p);
+        }
+
         size_t size;
         UBASE_RETURN(uref_block_size(uref, &size));
         upipe_seg_src->size += size;
@@ -164,6 +260,8 @@ static int probe_uref(struct uprobe *uprobe, struct upipe *inner,
     }
 
     case UPROBE_DEAD:
+        if (inner == upipe_seg_src->prefetch_uref)
+            return UBASE_ERR_NONE;
         return upipe_seg_src_update(upipe);
     }
     return upipe_throw_proxy(upipe, inner, event, args);
@@ -190,6 +288,11 @@ static int probe_src(struct uprobe *uprobe, struct upipe *inner,
     }
 
     case UPROBE_SOURCE_END:
+        if (inner == upipe_seg_src->prefetch_src) {
+            /* the source is cleaned once the prefetched urefs are output */
+            upipe_seg_src->prefetch_ended = true;
+            return UBASE_ERR_NONE;
+        }
         upipe_seg_src_clean_src(upipe);
         return UBASE_ERR_NONE;
     }
@@ -220,6 +323,14 @@ static struct upipe *upipe_seg_src_alloc(struct upipe_mgr *mgr,
     upipe_seg_src->size = 0;
     upipe_seg_src->first_uref = true;
     upipe_seg_src->start = UINT64_MAX;
+    upipe_seg_src->prefetch_src = NULL;
+    upipe_seg_src->prefetch_uref = NULL;
+    upipe_seg_src->prefetch_uri = NULL;
+    upipe_seg_src->prefetch_size = 0;
+    ulist_init(&upipe_seg_src->prefetched);
+    upipe_seg_src->prefetched_size = 0;
+    upipe_seg_src->blocker = NULL;
+    upipe_seg_src->prefetch_ended = false;
 
     upipe_throw_ready(upipe);
 
@@ -245,6 +356,7 @@ static void upipe_seg_src_free(struct upipe *upipe)
 
 static void upipe_seg_src_no_ref(struct upipe *upipe)
 {
+    upipe_seg_src_cancel_prefetch(upipe);
     upipe_seg_src_clean_src(upipe);
     upipe_seg_src_clean_last_inner(upipe);
     upipe_seg_src_release_urefcount_real(upipe);
@@ -277,17 +389,122 @@ static int upipe_seg_src_check_src(struct upipe *upipe)
     return UBASE_ERR_NONE;
 }
 
+/** @internal @This opens a source in advance.
+ *
+ * @param upipe description structure of the pipe
+ * @param uri uri to open, or NULL
+ * @param size size to read in advance
+ * @return an error code
+ */
+static int _upipe_seg_src_prefetch(struct upipe *upipe, const char *uri,
+                                   uint64_t size)
+{
+    struct upipe_seg_src *upipe_seg_src = upipe_seg_src_from_upipe(upipe);
+
+    upipe_seg_src_cancel_prefetch(upipe);
+    if (uri == NULL)
+        return UBASE_ERR_NONE;
+
+    UBASE_RETURN(upipe_seg_src_check_source_mgr(upipe));
+    upipe_seg_src->prefetch_uri = strdup(uri);
+    UBASE_ALLOC_RETURN(upipe_seg_src->prefetch_uri);
+    upipe_seg_src->prefetch_size = size;
+
+    struct upipe *src = upipe_void_alloc(
+        upipe_seg_src->source_mgr,
+        uprobe_pfx_alloc(uprobe_use(&upipe_seg_src->probe_src),
+                         UPROBE_LOG_VERBOSE, "prefetch src"));
+    if (unlikely(src == NULL)) {
+        upipe_seg_src_cancel_prefetch(upipe);
+        return UBASE_ERR_ALLOC;
+    }
+    upipe_seg_src->prefetch_src = src;
+
+    struct upipe_mgr *upipe_probe_uref_mgr = upipe_probe_uref_mgr_alloc();
+    if (likely(upipe_probe_uref_mgr != NULL))
+        upipe_seg_src->prefetch_uref = upipe_void_alloc_output(
+            src, upipe_probe_uref_mgr,
+            uprobe_pfx_alloc(uprobe_use(&upipe_seg_src->probe_uref),
+                             UPROBE_LOG_VERBOSE, "prefetch uref"));
+    upipe_mgr_release(upipe_probe_uref_mgr);
+    if (unlikely(upipe_seg_src->prefetch_uref == NULL)) {
+        upipe_seg_src_cancel_prefetch(upipe);
+        return UBASE_ERR_ALLOC;
+    }
+
+    upipe_dbg_va(upipe, "prefetching %s", uri);
+    int ret = upipe_set_uri(src, uri);
+    if (unlikely(!ubase_check(ret)))
+        upipe_seg_src_cancel_prefetch(upipe);
+    return ret;
+}
+
+/** @internal @This starts the source opened in advance, and outputs the
+ * urefs already read.
+ *
+ * @param upipe description structure of the pipe
+ * @return an error code
+ */
+static int upipe_seg_src_resume(struct upipe *upipe)
+{
+    struct upipe_seg_src *upipe_seg_src = upipe_seg_src_from_upipe(upipe);
+    struct uchain *uchain;
+
+    upipe_dbg_va(upipe, "start prefetched source (%"PRIu64" bytes)",
+                 upipe_seg_src->prefetched_size);
+    if (upipe_seg_src->blocker != NULL) {
+        upump_blocker_free(upipe_seg_src->blocker);
+        upipe_seg_src->blocker = NULL;
+    }
+    ubase_clean_str(&upipe_seg_src->prefetch_uri);
+
+    struct upipe *output = upipe_seg_src->prefetch_uref;
+    upipe_seg_src->prefetch_uref = NULL;
+    upipe_seg_src->first_uref = true;
+    upipe_seg_src_store_src(upipe, upipe_seg_src->prefetch_src);
+    upipe_seg_src->prefetch_src = NULL;
+
+    while ((uchain = ulist_pop(&upipe_seg_src->prefetched)) != NULL)
+        upipe_input(output, uref_from_uchain(uchain), NULL);
+    upipe_seg_src->prefetched_size = 0;
+    upipe_release(output);
+
+    if (upipe_seg_src->prefetch_ended) {
+        upipe_seg_src->prefetch_ended = false;
+        upipe_seg_src_clean_src(upipe);
+    }
+    return UBASE_ERR_NONE;
+}
+
 static int upipe_seg_src_control(struct upipe *upipe,
                                  int command,
                                  va_list args)
 {
+    struct upipe_seg_src *upipe_seg_src = upipe_seg_src_from_upipe(upipe);
+
     switch (command) {
     case UPIPE_ATTACH_UCLOCK:
         upipe_seg_src_require_uclock(upipe);
         return UBASE_ERR_NONE;
 
-    case UPIPE_SET_URI:
+    case UPIPE_SEG_SRC_PREFETCH: {
+        UBASE_SIGNATURE_CHECK(args, UPIPE_SEG_SRC_SIGNATURE);
+        const char *uri = va_arg(args, const char *);
+        uint64_t size = va_arg(args, uint64_t);
+        return _upipe_seg_src_prefetch(upipe, uri, size);
+    }
+
+    case UPIPE_SET_URI: {
         upipe_seg_src_clean_src(upipe);
+        va_list args_copy;
+        va_copy(args_copy, args);
+        const char *uri = va_arg(args_copy, const char *);
+        va_end(args_copy);
+        if (uri != NULL && upipe_seg_src->prefetch_uri != NULL &&
+            !strcmp(uri, upipe_seg_src->prefetch_uri))
+            return upipe_seg_src_resume(upipe);
+        upipe_seg_src_cancel_prefetch(upipe);
+    }
         /* fallthrough */
     case UPIPE_GET_OUTPUT_SIZE:
     case UPIPE_SET_OUTPUT_SIZE:
@@ -300,7 +517,6 @@ static int upipe_seg_src_control(struct upipe *upipe,
         return upipe_seg_src_control_src(upipe, command, args);
     }
     case UPIPE_BIN_GET_FIRST_INNER: {
-        struct upipe_seg_src *upipe_seg_src = upipe_seg_src_from_upipe(upipe);
         struct upipe **p = va_arg(args, struct upipe **);
         *p = upipe_seg_src->src;
         return (*p != NULL) ? UBASE_ERR_NONE : UBASE_ERR_UNHANDLED;
@@ -315,6 +531,7 @@ static struct upipe_mgr upipe_seg_src_mgr = {
     .signature = UPIPE_SEG_SRC_SIGNATURE,
     .upipe_alloc = upipe_seg_src_alloc,
     .upipe_control = upipe_seg_src_control,
+    .upipe_command_str = upipe_seg_src_command_str,
     .upipe_event_str = upipe_seg_src_event_str,
 };
 
@@ -32,6 +32,8 @@
 #include <upipe/upipe_helper_upipe.h>
 #include <upipe/upipe.h>
 #include <upipe/uprobe_prefix.h>
+#include <upipe/uref_block.h>
+#include <upipe/upump_blocker.h>
 
 struct upipe_seq_src {
     struct upipe upipe;
@@ -46,6 +48,20 @@ struct upipe_seq_src {
     struct urefcount inner_ref;
     struct uclock *uclock;
     struct urequest uclock_request;
+    /** source pipe of a prefetched item */
+    struct upipe *prefetch_src;
+    /** probe pipe of a prefetched item, until the item is started */
+    struct upipe *prefetch;
+    /** list of urefs read in advance */
+    struct uchain prefetched;
+    /** size of the urefs read in advance */
+    uint64_t prefetched_size;
+    /** blocker of the source pump once enough data is read in advance */
+    struct upump_blocker *blocker;
+    /** the item is read in advance and not started yet */
+    bool prefetching;
+    /** the end of the source was reached while prefetching */
+    bool ended;
 };
 
 static int probe_src(struct uprobe *uprobe, struct upipe *inner,
@@ -74,6 +90,10 @@ struct upipe_seq_src_mgr {
     struct upipe_mgr *source_mgr;
     struct uchain jobs;
     struct urefcount *lock;
+    /** item being read in advance, or NULL */
+    struct upipe_seq_src *prefetch;
+    /** size to read in advance from the next item, 0 to disable */
+    uint64_t prefetch_size;
 };
 
 UBASE_FROM_TO(upipe_seq_src_mgr, upipe_mgr, mgr, mgr);
@@ -85,6 +105,97 @@ static int upipe_seq_src_mgr_next(struct upipe_mgr *mgr);
  * pipe
  */
 
+/** @internal @This is called when the blocked source pump is released.
+ *
+ * @param blocker description structure of the blocker
+ */
+static void upipe_seq_src_blocker_cb(struct upump_blocker *blocker)
+{
+    struct upipe *upipe = upump_blocker_get_opaque(blocker, struct upipe *);
+    struct upipe_seq_src *upipe_seq_src = upipe_seq_src_from_upipe(upipe);
+
+    upump_blocker_free(upipe_seq_src->blocker);
+    upipe_seq_src->blocker = NULL;
+}
+
+/** @internal @This keeps an uref read in advance, and blocks the source pump
+ * once enough data is read.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref uref read in advance
+ * @param upump_p reference to the pump that generated the uref
+ * @return an error code
+ */
+static int upipe_seq_src_hold(struct upipe *upipe, struct uref *uref,
+                              struct upump **upump_p)
+{
+    struct upipe_seq_src *upipe_seq_src = upipe_seq_src_from_upipe(upipe);
+    struct upipe_seq_src_mgr *upipe_seq_src_mgr =
+        upipe_seq_src_mgr_from_mgr(upipe->mgr);
+
+    size_t size = 0;
+    uref_block_size(uref, &size);
+    uref = uref_dup(uref);
+    UBASE_ALLOC_RETURN(uref);
+    ulist_add(&upipe_seq_src->prefetched, uref_to_uchain(uref));
+    upipe_seq_src->prefetched_size += size;
+
+    if (upipe_seq_src->prefetched_size >= upipe_seq_src_mgr->prefetch_size &&
+        upipe_seq_src->blocker == NULL && upump_p != NULL && *upump_p != NULL) {
+        upipe_dbg_va(upipe, "prefetched %"PRIu64" bytes",
+                     upipe_seq_src->prefetched_size);
+        upipe_seq_src->blocker =
+            upump_blocker_alloc(*upump_p, upipe_seq_src_blocker_cb, upipe,
+                                upipe->refcount);
+    }
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This releases the pipes and urefs of a prefetched item.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_seq_src_clean_prefetch(struct upipe *upipe)
+{
+    struct upipe_seq_src *upipe_seq_src = upipe_seq_src_from_upipe(upipe);
+    struct uchain *uchain;
+
+    if (upipe_seq_src->blocker != NULL) {
+        upump_blocker_free(upipe_seq_src->blocker);
+        upipe_seq_src->blocker = NULL;
+    }
+    while ((uchain = ulist_pop(&upipe_seq_src->prefetched)) != NULL)
+        uref_free(uref_from_uchain(uchain));
+    upipe_seq_src->prefetched_size = 0;
+    upipe_seq_src->prefetching = false;
+    upipe_seq_src->ended = false;
+
+    struct upipe *prefetch = upipe_seq_src->prefetch;
+    struct upipe *prefetch_src = upipe_seq_src->prefetch_src;
+    upipe_seq_src->prefetch = NULL;
+    upipe_seq_src->prefetch_src = NULL;
+    upipe_release(prefetch);
+    upipe_release(prefetch_src);
+}
+
+/** @internal @This stops reading an item in advance, if it was.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_seq_src_cancel_prefetch(struct upipe *upipe)
+{
+    struct upipe_seq_src *upipe_seq_src = upipe_seq_src_from_upipe(upipe);
+    struct upipe_seq_src_mgr *upipe_seq_src_mgr =
+        upipe_seq_src_mgr_from_mgr(upipe->mgr);
+
+    if (upipe_seq_src_mgr->prefetch != upipe_seq_src)
+        return;
+
+    upipe_dbg(upipe, "cancel prefetch");
+    upipe_seq_src_mgr->prefetch = NULL;
+    upipe_seq_src_clean_prefetch(upipe);
+}
+
 static int probe_src(struct uprobe *uprobe, struct upipe *inner,
                      int event, va_list args)
 {
@@ -93,8 +204,27 @@ static int probe_src(struct uprobe *uprobe, struct upipe *inner,
 
     switch (event) {
     case UPROBE_SOURCE_END:
+        if (upipe_seq_src->prefetching) {
+            /* the end is thrown once the prefetched urefs are output */
+            upipe_seq_src->ended = true;
+            return UBASE_ERR_NONE;
+        }
         upipe_seq_src_store_bin_output(upipe, NULL);
+        upipe_seq_src_clean_prefetch(upipe);
         break;
+
+    case UPROBE_PROBE_UREF: {
+        if (ubase_get_signature(args) != UPIPE_PROBE_UREF_SIGNATURE)
+            break;
+        UBASE_SIGNATURE_CHECK(args, UPIPE_PROBE_UREF_SIGNATURE);
+        struct uref *uref = va_arg(args, struct uref *);
+        struct upump **upump_p = va_arg(args, struct upump **);
+        bool *drop = va_arg(args, bool *);
+        if (!upipe_seq_src->prefetching)
+            return UBASE_ERR_NONE;
+        *drop = true;
+        return upipe_seq_src_hold(upipe, uref, upump_p);
+    }
     }
 
     return upipe_throw_proxy(upipe, inner, event, args);
@@ -119,6 +249,13 @@ static struct upipe *upipe_seq_src_alloc(struct upipe_mgr *mgr,
     urefcount_init(&upipe_seq_src->urefcount_real, upipe_seq_src_free);
     uchain_init(&upipe_seq_src->uchain);
     upipe_seq_src->uri = NULL;
+    upipe_seq_src->prefetch_src = NULL;
+    upipe_seq_src->prefetch = NULL;
+    ulist_init(&upipe_seq_src->prefetched);
+    upipe_seq_src->prefetched_size = 0;
+    upipe_seq_src->blocker = NULL;
+    upipe_seq_src->prefetching = false;
+    upipe_seq_src->ended = false;
 
     upipe_throw_ready(upipe);
 
@@ -145,9 +282,11 @@ static void upipe_seq_src_free(struct urefcount *urefcount)
 static void upipe_seq_src_no_ref(struct upipe *upipe)
 {
     struct upipe_seq_src *upipe_seq_src = upipe_seq_src_from_upipe(upipe);
+    upipe_seq_src_cancel_prefetch(upipe);
     if (ulist_is_in(&upipe_seq_src->uchain))
         ulist_delete(&upipe_seq_src->uchain);
     upipe_seq_src_store_bin_output(upipe, NULL);
+    upipe_seq_src_clean_prefetch(upipe);
     urefcount_release(&upipe_seq_src->urefcount_real);
 }
 
@@ -160,8 +299,11 @@ static void upipe_seq_src_done(struct urefcount *urefcount)
         upipe_seq_src_mgr_from_mgr(upipe->mgr);
 
     upipe_seq_src->probe_src.refcount = NULL;
-    upipe_seq_src_mgr->lock = NULL;
-    upipe_seq_src_mgr_next(upipe->mgr);
+    /* a cancelled prefetch does not hold the lock */
+    if (upipe_seq_src_mgr->lock == &upipe_seq_src->inner_ref) {
+        upipe_seq_src_mgr->lock = NULL;
+        upipe_seq_src_mgr_next(upipe->mgr);
+    }
     urefcount_release(&upipe_seq_src->urefcount_real);
 }
 
@@ -199,12 +341,100 @@ static int upipe_seq_src_worker(struct upipe *upipe)
     return UBASE_ERR_NONE;
 }
 
+/** @internal @This opens the source of an item in advance, and keeps the
+ * urefs it reads until the item is started.
+ *
+ * @param upipe description structure of the pipe
+ * @return an error code
+ */
+static int upipe_seq_src_prefetch(struct upipe *upipe)
+{
+    struct upipe_seq_src *upipe_seq_src = upipe_seq_src_from_upipe(upipe);
+    struct upipe_seq_src_mgr *upipe_seq_src_mgr =
+        upipe_seq_src_mgr_from_mgr(upipe->mgr);
+
+    urefcount_init(&upipe_seq_src->inner_ref, upipe_seq_src_done);
+    urefcount_use(&upipe_seq_src->urefcount_real);
+    upipe_seq_src->probe_src.refcount = &upipe_seq_src->inner_ref;
+    struct upipe *inner = upipe_void_alloc(
+        upipe_seq_src_mgr->source_mgr,
+        uprobe_pfx_alloc(uprobe_use(&upipe_seq_src->probe_src),
+                         UPROBE_LOG_VERBOSE, "src"));
+    struct upipe *output = NULL;
+    if (likely(inner != NULL)) {
+        struct upipe_mgr *upipe_probe_uref_mgr = upipe_probe_uref_mgr_alloc();
+        if (likely(upipe_probe_uref_mgr != NULL))
+            output = upipe_void_alloc_output(
+                inner, upipe_probe_uref_mgr,
+                uprobe_pfx_alloc(uprobe_use(&upipe_seq_src->probe_src),
+                                 UPROBE_LOG_VERBOSE, "prefetch"));
+        upipe_mgr_release(upipe_probe_uref_mgr);
+    }
+    urefcount_release(&upipe_seq_src->inner_ref);
+    if (unlikely(output == NULL)) {
+        upipe_release(inner);
+        return UBASE_ERR_ALLOC;
+    }
+
+    upipe_dbg_va(upipe, "prefetching %s", upipe_seq_src->uri);
+    upipe_seq_src->prefetch_src = inner;
+    upipe_seq_src->prefetch = output;
+    upipe_seq_src->prefetching = true;
+    if (upipe_seq_src->uclock)
+        upipe_attach_uclock(inner);
+    int ret = upipe_set_uri(inner, upipe_seq_src->uri);
+    if (unlikely(!ubase_check(ret)))
+        upipe_seq_src_clean_prefetch(upipe);
+    return ret;
+}
+
+/** @internal @This starts an item read in advance, and outputs the urefs
+ * already read.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_seq_src_resume(struct upipe *upipe)
+{
+    struct upipe_seq_src *upipe_seq_src = upipe_seq_src_from_upipe(upipe);
+    struct uchain *uchain;
+
+    upipe_dbg_va(upipe, "start prefetched source (%"PRIu64" bytes)",
+                 upipe_seq_src->prefetched_size);
+    upipe_use(upipe);
+    upipe_seq_src->prefetching = false;
+    if (upipe_seq_src->blocker != NULL) {
+        upump_blocker_free(upipe_seq_src->blocker);
+        upipe_seq_src->blocker = NULL;
+    }
+
+    struct upipe *output = upipe_seq_src->prefetch;
+    upipe_seq_src->prefetch = NULL;
+    upipe_seq_src_store_bin_output(upipe, output);
+    if (upipe_seq_src->uclock)
+        upipe_attach_uclock(upipe_seq_src->prefetch_src);
+
+    output = upipe_use(output);
+    while ((uchain = ulist_pop(&upipe_seq_src->prefetched)) != NULL)
+        upipe_input(output, uref_from_uchain(uchain), NULL);
+    upipe_release(output);
+    upipe_seq_src->prefetched_size = 0;
+
+    if (upipe_seq_src->ended && upipe_seq_src->prefetch_src != NULL) {
+        upipe_seq_src->ended = false;
+        upipe_throw_source_end(upipe);
+        upipe_seq_src_store_bin_output(upipe, NULL);
+        upipe_seq_src_clean_prefetch(upipe);
+    }
+    upipe_release(upipe);
+}
+
 static int upipe_seq_src_set_uri(struct upipe *upipe, const char *uri)
 {
     struct upipe_seq_src *upipe_seq_src = upipe_seq_src_from_upipe(upipe);
     struct upipe_seq_src_mgr *upipe_seq_src_mgr =
         upipe_seq_src_mgr_from_mgr(upipe->mgr);
 
+    upipe_seq_src_cancel_prefetch(upipe);
     if (ulist_is_in(&upipe_seq_src->uchain))
         ulist_delete(&upipe_seq_src->uchain);
     if (upipe_seq_src->uri)
@@ -247,7 +477,8 @@ static int upipe_seq_src_control(struct upipe *upipe,
     case UPIPE_BIN_GET_FIRST_INNER: {
         struct upipe_seq_src *upipe_seq_src = upipe_seq_src_from_upipe(upipe);
         struct upipe **p = va_arg(args, struct upipe **);
-        *p = upipe_seq_src->src;
+        *p = upipe_seq_src->prefetch_src != NULL ?
+             upipe_seq_src->prefetch_src : upipe_seq_src->src;
         return (*p != NULL) ? UBASE_ERR_NONE : UBASE_ERR_UNHANDLED;
     }
     }
@@ -276,6 +507,8 @@ struct upipe_mgr *upipe_seq_src_mgr_alloc(void)
     upipe_seq_src_mgr->mgr.upipe_control = upipe_seq_src_control;
     upipe_seq_src_mgr->source_mgr = NULL;
     upipe_seq_src_mgr->lock = NULL;
+    upipe_seq_src_mgr->prefetch = NULL;
+    upipe_seq_src_mgr->prefetch_size = 0;
     ulist_init(&upipe_seq_src_mgr->jobs);
 
     return upipe_seq_src_mgr_to_mgr(upipe_seq_src_mgr);
@@ -303,19 +536,65 @@ int upipe_seq_src_mgr_set_source_mgr(struct upipe_mgr *mgr,
     return UBASE_ERR_NONE;
 }
 
+int upipe_seq_src_mgr_set_prefetch(struct upipe_mgr *mgr, uint64_t size)
+{
+    struct upipe_seq_src_mgr *upipe_seq_src_mgr =
+        upipe_seq_src_mgr_from_mgr(mgr);
+    upipe_seq_src_mgr->prefetch_size = size;
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This starts reading the next item in advance, if enabled.
+ *
+ * @param mgr pointer to manager
+ */
+static void upipe_seq_src_mgr_prefetch(struct upipe_mgr *mgr)
+{
+    struct upipe_seq_src_mgr *upipe_seq_src_mgr =
+        upipe_seq_src_mgr_from_mgr(mgr);
+
+    if (!upipe_seq_src_mgr->prefetch_size ||
+        upipe_seq_src_mgr->prefetch != NULL)
+        return;
+
+    struct uchain *uchain = ulist_peek(&upipe_seq_src_mgr->jobs);
+    if (uchain == NULL)
+        return;
+
+    struct upipe_seq_src *upipe_seq_src = upipe_seq_src_from_uchain(uchain);
+    struct upipe *upipe = upipe_seq_src_to_upipe(upipe_seq_src);
+    upipe_seq_src_mgr->prefetch = upipe_seq_src;
+    if (unlikely(!ubase_check(upipe_seq_src_prefetch(upipe)))) {
+        /* the item will be opened when it is started */
+        upipe_warn(upipe, "fail to prefetch");
+        upipe_seq_src_mgr->prefetch = NULL;
+    }
+}
+
 static int upipe_seq_src_mgr_next(struct upipe_mgr *mgr)
 {
     struct upipe_seq_src_mgr *upipe_seq_src_mgr =
         upipe_seq_src_mgr_from_mgr(mgr);
 
-    if (unlikely(upipe_seq_src_mgr->lock))
+    if (unlikely(upipe_seq_src_mgr->lock)) {
+        upipe_seq_src_mgr_prefetch(mgr);
         return UBASE_ERR_NONE;
+    }
 
     struct uchain *uchain = ulist_pop(&upipe_seq_src_mgr->jobs);
     if (unlikely(uchain == NULL))
         return UBASE_ERR_NONE;
 
     struct upipe_seq_src *upipe_seq_src = upipe_seq_src_from_uchain(uchain);
+    struct upipe *upipe = upipe_seq_src_to_upipe(upipe_seq_src);
     upipe_seq_src_mgr->lock = &upipe_seq_src->inner_ref;
-    return upipe_seq_src_worker(upipe_seq_src_to_upipe(upipe_seq_src));
+    int ret = UBASE_ERR_NONE;
+    if (upipe_seq_src_mgr->prefetch == upipe_seq_src) {
+        upipe_seq_src_mgr->prefetch = NULL;
+        upipe_seq_src_resume(upipe);
+    }
+    else
+        ret = upipe_seq_src_worker(upipe);
+    upipe_seq_src_mgr_prefetch(mgr);
+    return ret;
 }
@@ -44,6 +44,18 @@
 #include <stdarg.h>
 #include <assert.h>
 
+/** @internal @This is a pre-resolved attribute of the dictionary. */
+struct upipe_setattr_attr {
+    /** name of the attribute, or NULL for a shorthand */
+    const char *name;
+    /** type of the attribute */
+    enum udict_type type;
+    /** size of the value */
+    size_t size;
+    /** value, pointing into the dictionary */
+    const uint8_t *value;
+};
+
 /** @internal @This is the private context of a setattr pipe. */
 struct upipe_setattr {
     /** refcount management structure */
@@ -60,6 +72,10 @@ struct upipe_setattr {
 
     /** dictionary to set */
     struct uref *dict;
+    /** attributes of the dictionary, resolved once */
+    struct upipe_setattr_attr *attrs;
+    /** number of attributes of the dictionary */
+    unsigned int nb_attrs;
 
     /** public upipe structure */
     struct upipe upipe;
@@ -91,6 +107,8 @@ static struct upipe *upipe_setattr_alloc(struct upipe_mgr *mgr,
     upipe_setattr_init_urefcount(upipe);
     upipe_setattr_init_output(upipe);
     upipe_setattr->dict = NULL;
+    upipe_setattr->attrs = NULL;
+    upipe_setattr->nb_attrs = 0;
     upipe_throw_ready(upipe);
     return upipe;
 }
@@ -110,32 +128,28 @@ static void upipe_setattr_input(struct upipe *upipe, struct uref *uref,
         return;
     }
 
-    if (upipe_setattr->dict->udict != NULL) {
-        if (uref->udict == NULL) {
-            uref->udict = udict_alloc(uref->mgr->udict_mgr, 0);
-            if (unlikely(uref->udict == NULL)) {
-                upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
-                uref_free(uref);
-                return;
-            }
+    if (upipe_setattr->nb_attrs && uref->udict == NULL) {
+        /* nothing to merge with, share the attributes of the dictionary */
+        uref->udict = udict_dup(upipe_setattr->dict->udict);
+        if (unlikely(uref->udict == NULL)) {
+            upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+            uref_free(uref);
+            return;
         }
-        const char *name = NULL;
-        enum udict_type type = UDICT_TYPE_END;
-        while (ubase_check(udict_iterate(upipe_setattr->dict->udict,
-                                         &name, &type)) &&
-               type != UDICT_TYPE_END) {
-            size_t size;
-            const uint8_t *v1 = NULL;
-            udict_get(upipe_setattr->dict->udict, name, type, &size, &v1);
-            uint8_t *v2 = NULL;
-            udict_set(uref->udict, name, type, size, &v2);
-            if (unlikely(v1 == NULL || v2 == NULL)) {
-                uref_free(uref);
-                upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
-                return;
-            }
-            memcpy(v2, v1, size);
+        upipe_setattr_output(upipe, uref, upump_p);
+        return;
+    }
+
+    for (unsigned int i = 0; i < upipe_setattr->nb_attrs; i++) {
+        const struct upipe_setattr_attr *attr = &upipe_setattr->attrs[i];
+        uint8_t *v = NULL;
+        udict_set(uref->udict, attr->name, attr->type, attr->size, &v);
+        if (unlikely(v == NULL)) {
+            uref_free(uref);
+            upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+            return;
         }
+        memcpy(v, attr->value, attr->size);
     }
     upipe_setattr_output(upipe, uref, upump_p);
 }
@@ -171,6 +185,50 @@ static int _upipe_setattr_get_dict(struct upipe *upipe, struct uref **dict_p)
     return UBASE_ERR_NONE;
 }
 
+/** @internal @This resolves the attributes of the dictionary once, so that
+ * they are applied to urefs without iterating over the dictionary.
+ *
+ * @param upipe description structure of the pipe
+ * @return an error code
+ */
+static int upipe_setattr_compile(struct upipe *upipe)
+{
+    struct upipe_setattr *upipe_setattr = upipe_setattr_from_upipe(upipe);
+    free(upipe_setattr->attrs);
+    upipe_setattr->attrs = NULL;
+    upipe_setattr->nb_attrs = 0;
+    if (upipe_setattr->dict == NULL || upipe_setattr->dict->udict == NULL)
+        return UBASE_ERR_NONE;
+
+    struct udict *udict = upipe_setattr->dict->udict;
+    const char *name = NULL;
+    enum udict_type type = UDICT_TYPE_END;
+    unsigned int nb_attrs = 0;
+    while (ubase_check(udict_iterate(udict, &name, &type)) &&
+           type != UDICT_TYPE_END)
+        nb_attrs++;
+    if (!nb_attrs)
+        return UBASE_ERR_NONE;
+
+    upipe_setattr->attrs = malloc(nb_attrs * sizeof(*upipe_setattr->attrs));
+    if (unlikely(upipe_setattr->attrs == NULL))
+        return UBASE_ERR_ALLOC;
+
+    name = NULL;
+    type = UDICT_TYPE_END;
+    while (ubase_check(udict_iterate(udict, &name, &type)) &&
+           type != UDICT_TYPE_END) {
+        assert(upipe_setattr->nb_attrs < nb_attrs);
+        struct upipe_setattr_attr *attr =
+            &upipe_setattr->attrs[upipe_setattr->nb_attrs];
+        attr->name = name;
+        attr->type = type;
+        UBASE_RETURN(udict_get(udict, name, type, &attr->size, &attr->value))
+        upipe_setattr->nb_attrs++;
+    }
+    return UBASE_ERR_NONE;
+}
+
 /** @This sets the dictionary to set into urefs.
  *
  * @param upipe description structure of the pipe
@@ -190,6 +248,12 @@ static int _upipe_setattr_set_dict(struct upipe *upipe, struct uref *dict)
         }
     } else
         upipe_setattr->dict = NULL;
+
+    int err = upipe_setattr_compile(upipe);
+    if (unlikely(!ubase_check(err))) {
+        upipe_throw_fatal(upipe, err);
+        return err;
+    }
     return UBASE_ERR_NONE;
 }
 
@@ -237,6 +301,7 @@ static void upipe_setattr_free(struct upipe *upipe)
 
     if (upipe_setattr->dict != NULL)
         uref_free(upipe_setattr->dict);
+    free(upipe_setattr->attrs);
 
     upipe_setattr_clean_urefcount(upipe);
     upipe_setattr_free_void(upipe);
@@ -0,0 +1,318 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short Upipe internal helper functions for shared memory modules
+ */
+
+#define _GNU_SOURCE
+
+#include <upipe/ubase.h>
+#include <upipe/udict.h>
+#include <upipe/uref.h>
+#include <upipe/upipe.h>
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+
+#include "upipe_shm.h"
+
+/** size of a cache line, separating the indexes of the ring */
+#define UPIPE_SHM_CACHE_LINE 64
+/** alignment of the slots */
+#define UPIPE_SHM_PAGE_SIZE 4096
+/** offset of the index written by the sink */
+#define UPIPE_SHM_HEAD_OFFSET UPIPE_SHM_CACHE_LINE
+/** offset of the index written by the source */
+#define UPIPE_SHM_TAIL_OFFSET (2 * UPIPE_SHM_CACHE_LINE)
+/** offset of the links of the free stack */
+#define UPIPE_SHM_NEXT_OFFSET (3 * UPIPE_SHM_CACHE_LINE)
+
+/** @internal @This rounds a size up to a multiple of an alignment. */
+#define UPIPE_SHM_ROUND(size, align) (((size) + (align) - 1) / (align) * (align))
+
+/** @internal @This points the members of a mapping to the structures of the
+ * segment, and returns the total size of the segment.
+ *
+ * @param seg mapping of the segment, whose base is set, or NULL
+ * @param nb_slots number of slots
+ * @param slot_size size of a slot
+ * @param ring_size number of descriptors in the ring
+ * @return size of the segment
+ */
+static size_t upipe_shm_layout(struct upipe_shm_seg *seg, uint32_t nb_slots,
+                               uint32_t slot_size, uint32_t ring_size)
+{
+    size_t refs = UPIPE_SHM_ROUND(UPIPE_SHM_NEXT_OFFSET +
+                                  (size_t)nb_slots * sizeof(uint32_t),
+                                  sizeof(uint64_t));
+    size_t descs = UPIPE_SHM_ROUND(refs + (size_t)nb_slots * sizeof(uint64_t),
+                                   UPIPE_SHM_CACHE_LINE);
+    size_t slots = UPIPE_SHM_ROUND(descs + (size_t)ring_size *
+                                   sizeof(struct upipe_shm_desc),
+                                   UPIPE_SHM_PAGE_SIZE);
+    size_t size = slots + (size_t)nb_slots * slot_size;
+
+    if (seg != NULL) {
+        seg->size = size;
+        seg->header = (struct upipe_shm_header *)seg->base;
+        seg->head = (uint32_t *)(seg->base + UPIPE_SHM_HEAD_OFFSET);
+        seg->tail = (uint32_t *)(seg->base + UPIPE_SHM_TAIL_OFFSET);
+        seg->next = (uint32_t *)(seg->base + UPIPE_SHM_NEXT_OFFSET);
+        seg->refs = (uint64_t *)(seg->base + refs);
+        seg->descs = (struct upipe_shm_desc *)(seg->base + descs);
+        seg->slots = seg->base + slots;
+    }
+    return size;
+}
+
+/** @This creates a new segment, replacing any segment with the same name.
+ *
+ * @param upipe description structure of the pipe
+ * @param seg mapping to fill in
+ * @param name name of the segment, starting with a slash
+ * @param nb_slots number of slots
+ * @param slot_size size of a slot
+ * @param ring_size number of descriptors in the ring, a power of two
+ * @return an error code
+ */
+int upipe_shm_create(struct upipe *upipe, struct upipe_shm_seg *seg,
+                     const char *name, uint32_t nb_slots, uint32_t slot_size,
+                     uint32_t ring_size)
+{
+    slot_size = UPIPE_SHM_ROUND(slot_size, UPIPE_SHM_CACHE_LINE);
+    if (unlikely(!nb_slots || nb_slots >= UINT32_MAX || !slot_size ||
+                 !ring_size || (ring_size & (ring_size - 1))))
+        return UBASE_ERR_INVALID;
+    size_t size = upipe_shm_layout(NULL, nb_slots, slot_size, ring_size);
+
+    /* a segment left by a crashed sink is replaced, while its source keeps
+     * its own mapping until it notices */
+    shm_unlink(name);
+    int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
+    if (unlikely(fd == -1)) {
+        upipe_err_va(upipe, "can't create segment %s (%m)", name);
+        return UBASE_ERR_EXTERNAL;
+    }
+    if (unlikely(ftruncate(fd, size) == -1)) {
+        upipe_err_va(upipe, "can't resize segment %s (%m)", name);
+        close(fd);
+        shm_unlink(name);
+        return UBASE_ERR_EXTERNAL;
+    }
+    void *base = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (unlikely(base == MAP_FAILED)) {
+        upipe_err_va(upipe, "can't map segment %s (%m)", name);
+        shm_unlink(name);
+        return UBASE_ERR_EXTERNAL;
+    }
+
+    seg->base = base;
+    upipe_shm_layout(seg, nb_slots, slot_size, ring_size);
+    struct upipe_shm_header *header = seg->header;
+    header->version = UPIPE_SHM_VERSION;
+    header->nb_slots = nb_slots;
+    header->slot_size = slot_size;
+    header->ring_size = ring_size;
+    header->sink_pid = getpid();
+    header->source_pid = 0;
+    header->free_top = 0;
+    *seg->head = *seg->tail = 0;
+    for (uint32_t i = nb_slots; i > 0; i--) {
+        seg->refs[i - 1] = 0;
+        upipe_shm_slot_push(seg, i - 1);
+    }
+    __atomic_store_n(&header->magic, UPIPE_SHM_MAGIC, __ATOMIC_RELEASE);
+    return UBASE_ERR_NONE;
+}
+
+/** @This maps an existing segment created by a sink.
+ *
+ * @param upipe description structure of the pipe
+ * @param seg mapping to fill in
+ * @param name name of the segment, starting with a slash
+ * @return an error code
+ */
+int upipe_shm_open(struct upipe *upipe, struct upipe_shm_seg *seg,
+                   const char *name)
+{
+    int fd = shm_open(name, O_RDWR, 0);
+    if (unlikely(fd == -1)) {
+        upipe_err_va(upipe, "can't open segment %s (%m)", name);
+        return UBASE_ERR_EXTERNAL;
+    }
+    struct stat st;
+    if (unlikely(fstat(fd, &st) == -1 ||
+                 st.st_size < (off_t)sizeof(struct upipe_shm_header))) {
+        upipe_err_va(upipe, "invalid segment %s", name);
+        close(fd);
+        return UBASE_ERR_INVALID;
+    }
+    void *base = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                      fd, 0);
+    close(fd);
+    if (unlikely(base == MAP_FAILED)) {
+        upipe_err_va(upipe, "can't map segment %s (%m)", name);
+        return UBASE_ERR_EXTERNAL;
+    }
+
+    struct upipe_shm_header *header = base;
+    if (unlikely(__atomic_load_n(&header->magic, __ATOMIC_ACQUIRE) !=
+                 UPIPE_SHM_MAGIC || header->version != UPIPE_SHM_VERSION ||
+                 !header->nb_slots || !header->slot_size ||
+                 !header->ring_size ||
+                 (header->ring_size & (header->ring_size - 1)) ||
+                 upipe_shm_layout(NULL, header->nb_slots, header->slot_size,
+                                  header->ring_size) != (size_t)st.st_size)) {
+        upipe_err_va(upipe, "invalid segment %s", name);
+        munmap(base, st.st_size);
+        return UBASE_ERR_INVALID;
+    }
+    seg->base = base;
+    upipe_shm_layout(seg, header->nb_slots, header->slot_size,
+                     header->ring_size);
+    return UBASE_ERR_NONE;
+}
+
+/** @This unmaps a segment.
+ *
+ * @param seg mapping of the segment
+ */
+void upipe_shm_close(struct upipe_shm_seg *seg)
+{
+    if (seg->base != NULL)
+        munmap(seg->base, seg->size);
+    seg->base = NULL;
+}
+
+/** @This returns whether a process is still alive.
+ *
+ * @param pid pid of the process
+ * @return false if the process has exited
+ */
+bool upipe_shm_peer_alive(int32_t pid)
+{
+    return pid > 0 && (kill(pid, 0) == 0 || errno != ESRCH);
+}
+
+/** @This serializes the attributes of a uref. Each attribute is written as
+ * its type, its nul-terminated name unless the type is a shorthand, its
+ * size on 16 bits, and its value.
+ *
+ * @param uref uref structure
+ * @param buffer buffer of @ref UPIPE_SHM_ATTR_SIZE octets
+ * @param size_p filled in with the size of the serialized attributes
+ * @return an error code
+ */
+int upipe_shm_attr_export(struct uref *uref, uint8_t *buffer,
+                          uint32_t *size_p)
+{
+    uint32_t size = 0;
+    *size_p = 0;
+    if (uref->udict == NULL)
+        return UBASE_ERR_NONE;
+
+    const char *name = NULL;
+    enum udict_type type = UDICT_TYPE_END;
+    for ( ; ; ) {
+        udict_iterate(uref->udict, &name, &type);
+        if (unlikely(type == UDICT_TYPE_END))
+            break;
+
+        size_t attr_size;
+        const uint8_t *attr;
+        UBASE_RETURN(udict_get(uref->udict, name, type, &attr_size, &attr));
+        size_t name_size = type > UDICT_TYPE_SHORTHAND ? 0 : strlen(name) + 1;
+        if (unlikely(attr_size > UINT16_MAX ||
+                     size + 1 + name_size + 2 + attr_size >
+                     UPIPE_SHM_ATTR_SIZE))
+            return UBASE_ERR_INVALID;
+
+        buffer[size++] = type;
+        if (name_size) {
+            memcpy(buffer + size, name, name_size);
+            size += name_size;
+        }
+        buffer[size++] = attr_size >> 8;
+        buffer[size++] = attr_size & 0xff;
+        memcpy(buffer + size, attr, attr_size);
+        size += attr_size;
+    }
+    *size_p = size;
+    return UBASE_ERR_NONE;
+}
+
+/** @This deserializes attributes into a uref.
+ *
+ * @param uref uref structure
+ * @param buffer serialized attributes
+ * @param size size of the serialized attributes
+ * @return an error code
+ */
+int upipe_shm_attr_import(struct uref *uref, const uint8_t *buffer,
+                          uint32_t size)
+{
+    if (!size)
+        return UBASE_ERR_NONE;
+    if (uref->udict == NULL) {
+        uref->udict = udict_alloc(uref->mgr->udict_mgr, 0);
+        UBASE_ALLOC_RETURN(uref->udict)
+    }
+
+    const uint8_t *end = buffer + size;
+    while (buffer < end) {
+        enum udict_type type = *buffer++;
+        const char *name = NULL;
+        if (type <= UDICT_TYPE_SHORTHAND) {
+            const uint8_t *nul = memchr(buffer, '\0', end - buffer);
+            if (unlikely(nul == NULL))
+                return UBASE_ERR_INVALID;
+            name = (const char *)buffer;
+            buffer = nul + 1;
+        }
+        if (unlikely(end - buffer < 2))
+            return UBASE_ERR_INVALID;
+        size_t attr_size = (buffer[0] << 8) | buffer[1];
+        buffer += 2;
+        if (unlikely((size_t)(end - buffer) < attr_size))
+            return UBASE_ERR_INVALID;
+
+        uint8_t *attr;
+        UBASE_RETURN(udict_set(uref->udict, name, type, attr_size, &attr));
+        memcpy(attr, buffer, attr_size);
+        buffer += attr_size;
+    }
+    return UBASE_ERR_NONE;
+}
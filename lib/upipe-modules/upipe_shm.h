@@ -0,0 +1,353 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short Upipe internal helper functions for shared memory modules
+ *
+ * A segment is created by the shm sink and attached by a single shm source,
+ * possibly in another process. It contains a fixed number of slots holding
+ * the payloads, a lock-free stack of free slots (an inter-process
+ * equivalent of @ref ulifo), and a single-producer single-consumer ring of
+ * descriptors (an inter-process equivalent of @ref uring) carrying the
+ * urefs with their serialized attributes.
+ *
+ * Each slot has a 64-bit reference count: the low half counts the
+ * references of the sink process, and the high half the references of the
+ * source process, including the descriptors still in the ring. The slot
+ * returns to the free stack when both halves reach 0, so that the halves
+ * of a crashed peer may be cleared in one go.
+ */
+
+#ifndef _UPIPE_MODULES_UPIPE_SHM_H_
+/** @hidden */
+#define _UPIPE_MODULES_UPIPE_SHM_H_
+
+#include <upipe/upipe.h>
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/** magic value identifying a segment */
+#define UPIPE_SHM_MAGIC UBASE_FOURCC('u','s','h','m')
+/** version of the layout of a segment */
+#define UPIPE_SHM_VERSION 1
+/** maximum size of the serialized attributes of a uref */
+#define UPIPE_SHM_ATTR_SIZE 4096
+/** slot number of descriptors without payload */
+#define UPIPE_SHM_NO_SLOT UINT32_MAX
+/** reference of the sink process on a slot */
+#define UPIPE_SHM_SINK_REF UINT64_C(1)
+/** reference of the source process on a slot */
+#define UPIPE_SHM_SOURCE_REF (UINT64_C(1) << 32)
+/** mask of the references of the sink process */
+#define UPIPE_SHM_SINK_MASK UINT64_C(0xffffffff)
+/** value of source_pid while the sink drains the ring of a dead or
+ * detached source */
+#define UPIPE_SHM_PID_DETACHED -1
+
+/** @This is the header of a segment, at offset 0. */
+struct upipe_shm_header {
+    /** magic value, written last by the sink */
+    uint32_t magic;
+    /** version of the layout */
+    uint32_t version;
+    /** number of slots */
+    uint32_t nb_slots;
+    /** size of a slot */
+    uint32_t slot_size;
+    /** number of descriptors in the ring, a power of two so that the
+     * indexes may wrap around */
+    uint32_t ring_size;
+    /** pid of the sink, or 0 once it has left */
+    int32_t sink_pid;
+    /** pid of the attached source, 0 or @ref UPIPE_SHM_PID_DETACHED */
+    int32_t source_pid;
+    /** unused */
+    uint32_t reserved;
+    /** top of the stack of free slots (ABA tag in the high half, slot
+     * number + 1 in the low half) */
+    uint64_t free_top;
+};
+
+/** @This is a flag of descriptors carrying a flow definition. */
+#define UPIPE_SHM_DESC_FLOW_DEF 0x1
+
+/** @This describes a uref in the ring. */
+struct upipe_shm_desc {
+    /** slot holding the payload, or @ref UPIPE_SHM_NO_SLOT */
+    uint32_t slot;
+    /** flags of the descriptor */
+    uint32_t flags;
+    /** offset of the payload in the slot */
+    uint64_t offset;
+    /** size of the payload */
+    uint64_t size;
+
+    /** void flags of the uref */
+    uint64_t uref_flags;
+    /** date in system time */
+    uint64_t date_sys;
+    /** date in program time */
+    uint64_t date_prog;
+    /** original date */
+    uint64_t date_orig;
+    /** duration between DTS and PTS */
+    uint64_t dts_pts_delay;
+    /** duration between CR and DTS */
+    uint64_t cr_dts_delay;
+    /** duration between RAP and CR */
+    uint64_t rap_cr_delay;
+    /** duration of the contents */
+    uint64_t duration;
+
+    /** size of the serialized attributes */
+    uint32_t attr_size;
+    /** unused */
+    uint32_t reserved;
+    /** serialized attributes */
+    uint8_t attr[UPIPE_SHM_ATTR_SIZE];
+};
+
+/** @This is the mapping of a segment in the current process. */
+struct upipe_shm_seg {
+    /** start of the mapping, or NULL */
+    uint8_t *base;
+    /** size of the mapping */
+    size_t size;
+
+    /** header */
+    struct upipe_shm_header *header;
+    /** index of the next descriptor written by the sink */
+    uint32_t *head;
+    /** index of the next descriptor read by the source */
+    uint32_t *tail;
+    /** next free slot + 1, for each slot in the free stack */
+    uint32_t *next;
+    /** reference counts of the slots */
+    uint64_t *refs;
+    /** ring of descriptors */
+    struct upipe_shm_desc *descs;
+    /** start of the slots */
+    uint8_t *slots;
+};
+
+/** @This creates a new segment, replacing any segment with the same name.
+ *
+ * @param upipe description structure of the pipe
+ * @param seg mapping to fill in
+ * @param name name of the segment, starting with a slash
+ * @param nb_slots number of slots
+ * @param slot_size size of a slot
+ * @param ring_size number of descriptors in the ring, a power of two
+ * @return an error code
+ */
+int upipe_shm_create(struct upipe *upipe, struct upipe_shm_seg *seg,
+                     const char *name, uint32_t nb_slots, uint32_t slot_size,
+                     uint32_t ring_size);
+
+/** @This maps an existing segment created by a sink.
+ *
+ * @param upipe description structure of the pipe
+ * @param seg mapping to fill in
+ * @param name name of the segment, starting with a slash
+ * @return an error code
+ */
+int upipe_shm_open(struct upipe *upipe, struct upipe_shm_seg *seg,
+                   const char *name);
+
+/** @This unmaps a segment.
+ *
+ * @param seg mapping of the segment
+ */
+void upipe_shm_close(struct upipe_shm_seg *seg);
+
+/** @This returns whether a process is still alive.
+ *
+ * @param pid pid of the process
+ * @return false if the process has exited
+ */
+bool upipe_shm_peer_alive(int32_t pid);
+
+/** @This serializes the attributes of a uref.
+ *
+ * @param uref uref structure
+ * @param buffer buffer of @ref UPIPE_SHM_ATTR_SIZE octets
+ * @param size_p filled in with the size of the serialized attributes
+ * @return an error code
+ */
+int upipe_shm_attr_export(struct uref *uref, uint8_t *buffer,
+                          uint32_t *size_p);
+
+/** @This deserializes attributes into a uref.
+ *
+ * @param uref uref structure
+ * @param buffer serialized attributes
+ * @param size size of the serialized attributes
+ * @return an error code
+ */
+int upipe_shm_attr_import(struct uref *uref, const uint8_t *buffer,
+                          uint32_t size);
+
+/** @This pushes a slot on the stack of free slots.
+ *
+ * @param seg mapping of the segment
+ * @param slot slot number
+ */
+static inline void upipe_shm_slot_push(struct upipe_shm_seg *seg,
+                                       uint32_t slot)
+{
+    uint64_t top = __atomic_load_n(&seg->header->free_top, __ATOMIC_RELAXED);
+    uint64_t new_top;
+    do {
+        __atomic_store_n(&seg->next[slot], (uint32_t)top, __ATOMIC_RELAXED);
+        new_top = (((top >> 32) + 1) << 32) | (slot + 1);
+    } while (!__atomic_compare_exchange_n(&seg->header->free_top, &top,
+                                          new_top, true, __ATOMIC_RELEASE,
+                                          __ATOMIC_RELAXED));
+}
+
+/** @This pops a slot from the stack of free slots.
+ *
+ * @param seg mapping of the segment
+ * @param slot_p filled in with the slot number
+ * @return false if there is no free slot
+ */
+static inline bool upipe_shm_slot_pop(struct upipe_shm_seg *seg,
+                                      uint32_t *slot_p)
+{
+    uint64_t top = __atomic_load_n(&seg->header->free_top, __ATOMIC_ACQUIRE);
+    uint64_t new_top;
+    do {
+        uint32_t slot = (uint32_t)top;
+        if (slot == 0)
+            return false;
+        *slot_p = slot - 1;
+        new_top = (((top >> 32) + 1) << 32) |
+                  __atomic_load_n(&seg->next[slot - 1], __ATOMIC_RELAXED);
+    } while (!__atomic_compare_exchange_n(&seg->header->free_top, &top,
+                                          new_top, true, __ATOMIC_ACQUIRE,
+                                          __ATOMIC_ACQUIRE));
+    return true;
+}
+
+/** @This releases references on a slot, and frees it when no reference is
+ * left.
+ *
+ * @param seg mapping of the segment
+ * @param slot slot number
+ * @param ref @ref UPIPE_SHM_SINK_REF or @ref UPIPE_SHM_SOURCE_REF
+ */
+static inline void upipe_shm_slot_release(struct upipe_shm_seg *seg,
+                                          uint32_t slot, uint64_t ref)
+{
+    if (__atomic_sub_fetch(&seg->refs[slot], ref, __ATOMIC_ACQ_REL) == 0)
+        upipe_shm_slot_push(seg, slot);
+}
+
+/** @This returns the buffer of a slot.
+ *
+ * @param seg mapping of the segment
+ * @param slot slot number
+ * @return pointer to the buffer
+ */
+static inline uint8_t *upipe_shm_slot_buffer(struct upipe_shm_seg *seg,
+                                             uint32_t slot)
+{
+    return seg->slots + (size_t)slot * seg->header->slot_size;
+}
+
+/** @This finds the slot containing a buffer.
+ *
+ * @param seg mapping of the segment
+ * @param buffer pointer to a buffer
+ * @param size size of the buffer
+ * @param slot_p filled in with the slot number
+ * @return false if the buffer isn't entirely contained in a slot
+ */
+static inline bool upipe_shm_slot_lookup(struct upipe_shm_seg *seg,
+                                         const uint8_t *buffer, size_t size,
+                                         uint32_t *slot_p)
+{
+    if (buffer < seg->slots || buffer >= seg->base + seg->size)
+        return false;
+    size_t offset = buffer - seg->slots;
+    uint32_t slot = offset / seg->header->slot_size;
+    if (offset + size > (size_t)(slot + 1) * seg->header->slot_size)
+        return false;
+    *slot_p = slot;
+    return true;
+}
+
+/** @This reserves the next descriptor of the ring, on the sink side.
+ *
+ * @param seg mapping of the segment
+ * @return pointer to the descriptor, or NULL if the ring is full
+ */
+static inline struct upipe_shm_desc *
+    upipe_shm_ring_reserve(struct upipe_shm_seg *seg)
+{
+    uint32_t head = __atomic_load_n(seg->head, __ATOMIC_RELAXED);
+    uint32_t tail = __atomic_load_n(seg->tail, __ATOMIC_ACQUIRE);
+    if (head - tail >= seg->header->ring_size)
+        return NULL;
+    return &seg->descs[head & (seg->header->ring_size - 1)];
+}
+
+/** @This publishes the descriptor returned by @ref upipe_shm_ring_reserve.
+ *
+ * @param seg mapping of the segment
+ */
+static inline void upipe_shm_ring_commit(struct upipe_shm_seg *seg)
+{
+    __atomic_store_n(seg->head, __atomic_load_n(seg->head, __ATOMIC_RELAXED)
+                     + 1, __ATOMIC_RELEASE);
+}
+
+/** @This returns the next descriptor of the ring, on the source side.
+ *
+ * @param seg mapping of the segment
+ * @return pointer to the descriptor, or NULL if the ring is empty
+ */
+static inline struct upipe_shm_desc *
+    upipe_shm_ring_peek(struct upipe_shm_seg *seg)
+{
+    uint32_t tail = __atomic_load_n(seg->tail, __ATOMIC_RELAXED);
+    uint32_t head = __atomic_load_n(seg->head, __ATOMIC_ACQUIRE);
+    if (head == tail)
+        return NULL;
+    return &seg->descs[tail & (seg->header->ring_size - 1)];
+}
+
+/** @This releases the descriptor returned by @ref upipe_shm_ring_peek.
+ *
+ * @param seg mapping of the segment
+ */
+static inline void upipe_shm_ring_consume(struct upipe_shm_seg *seg)
+{
+    __atomic_store_n(seg->tail, __atomic_load_n(seg->tail, __ATOMIC_RELAXED)
+                     + 1, __ATOMIC_RELEASE);
+}
+
+#endif
@@ -0,0 +1,790 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short Upipe sink module for shared memory segments
+ */
+
+#define _GNU_SOURCE
+
+#include <upipe/ubase.h>
+#include <upipe/ulist.h>
+#include <upipe/uprobe.h>
+#include <upipe/uclock.h>
+#include <upipe/umem.h>
+#include <upipe/umem_alloc.h>
+#include <upipe/uref.h>
+#include <upipe/uref_block.h>
+#include <upipe/uref_flow.h>
+#include <upipe/upump.h>
+#include <upipe/ubuf.h>
+#include <upipe/ubuf_mem.h>
+#include <upipe/upipe.h>
+#include <upipe/upipe_helper_upipe.h>
+#include <upipe/upipe_helper_urefcount.h>
+#include <upipe/upipe_helper_void.h>
+#include <upipe/upipe_helper_upump_mgr.h>
+#include <upipe/upipe_helper_upump.h>
+#include <upipe/upipe_helper_input.h>
+#include <upipe-modules/upipe_shm_sink.h>
+#include "upipe_shm.h"
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <assert.h>
+
+/** expected flow definition on all flows */
+#define EXPECTED_FLOW_DEF "block."
+/** default number of slots */
+#define DEFAULT_NB_SLOTS 64
+/** default size of a slot */
+#define DEFAULT_SLOT_SIZE (256 * 1024)
+/** default period of the checks of the source */
+#define DEFAULT_PERIOD (UCLOCK_FREQ / 1000)
+/** depth of the pools of the provided ubuf managers */
+#define UBUF_POOL_DEPTH 16
+
+/** @hidden */
+static bool upipe_shmsink_output(struct upipe *upipe, struct uref *uref,
+                                 struct upump **upump_p);
+
+/** @internal @This is a segment created by the sink, acting as umem manager
+ * for its slots. It is unmapped when the pipe and all buffers are
+ * released. */
+struct upipe_shmsink_mem {
+    /** refcount management structure */
+    struct urefcount urefcount;
+
+    /** mapping of the segment */
+    struct upipe_shm_seg seg;
+    /** manager of the buffers that don't fit in a free slot */
+    struct umem_mgr *fallback;
+
+    /** common management structure */
+    struct umem_mgr mgr;
+};
+
+UBASE_FROM_TO(upipe_shmsink_mem, umem_mgr, umem_mgr, mgr)
+UBASE_FROM_TO(upipe_shmsink_mem, urefcount, urefcount, urefcount)
+
+/** @internal @This is the private context of a shm sink pipe. */
+struct upipe_shmsink {
+    /** refcount management structure */
+    struct urefcount urefcount;
+
+    /** upump manager */
+    struct upump_mgr *upump_mgr;
+    /** timer checking the source */
+    struct upump *upump;
+
+    /** segment, or NULL */
+    struct upipe_shmsink_mem *mem;
+    /** segment name */
+    char *uri;
+    /** number of slots of the next segment */
+    unsigned int nb_slots;
+    /** size of a slot of the next segment */
+    unsigned int slot_size;
+    /** period of the checks of the source */
+    uint64_t period;
+
+    /** input flow definition */
+    struct uref *flow_def;
+    /** pid of the source which received the flow definition, or 0 */
+    int32_t peer;
+
+    /** temporary uref storage */
+    struct uchain urefs;
+    /** nb urefs in storage */
+    unsigned int nb_urefs;
+    /** max urefs in storage */
+    unsigned int max_urefs;
+    /** list of blockers */
+    struct uchain blockers;
+
+    /** public upipe structure */
+    struct upipe upipe;
+};
+
+UPIPE_HELPER_UPIPE(upipe_shmsink, upipe, UPIPE_SHMSINK_SIGNATURE)
+UPIPE_HELPER_UREFCOUNT(upipe_shmsink, urefcount, upipe_shmsink_free)
+UPIPE_HELPER_VOID(upipe_shmsink)
+UPIPE_HELPER_UPUMP_MGR(upipe_shmsink, upump_mgr)
+UPIPE_HELPER_UPUMP(upipe_shmsink, upump, upump_mgr)
+UPIPE_HELPER_INPUT(upipe_shmsink, urefs, nb_urefs, max_urefs, blockers, upipe_shmsink_output)
+
+/** @This allocates a buffer in a free slot, or from the fallback manager.
+ *
+ * @param mgr common management structure
+ * @param umem caller-allocated structure, filled in with the required pointer
+ * and size
+ * @param size requested size of the umem
+ * @return false if the memory couldn't be allocated
+ */
+static bool upipe_shmsink_mem_alloc(struct umem_mgr *mgr, struct umem *umem,
+                                    size_t size)
+{
+    struct upipe_shmsink_mem *mem = upipe_shmsink_mem_from_umem_mgr(mgr);
+    struct upipe_shm_seg *seg = &mem->seg;
+    uint32_t slot;
+    if (unlikely(size > seg->header->slot_size ||
+                 !upipe_shm_slot_pop(seg, &slot)))
+        /* the block will be copied if it fits in a slot later */
+        return umem_alloc(mem->fallback, umem, size);
+
+    __atomic_store_n(&seg->refs[slot], UPIPE_SHM_SINK_REF, __ATOMIC_RELAXED);
+    umem->buffer = upipe_shm_slot_buffer(seg, slot);
+    umem->size = size;
+    umem->real_size = seg->header->slot_size;
+    umem->mgr = mgr;
+    return true;
+}
+
+/** @This frees a buffer allocated in a slot.
+ *
+ * @param umem pointer to umem
+ */
+static void upipe_shmsink_mem_free(struct umem *umem)
+{
+    struct upipe_shmsink_mem *mem = upipe_shmsink_mem_from_umem_mgr(umem->mgr);
+    struct upipe_shm_seg *seg = &mem->seg;
+    uint32_t slot;
+    if (likely(upipe_shm_slot_lookup(seg, umem->buffer, 0, &slot)))
+        upipe_shm_slot_release(seg, slot, UPIPE_SHM_SINK_REF);
+    umem->buffer = NULL;
+    umem->mgr = NULL;
+}
+
+/** @This resizes a buffer allocated in a slot. Buffers outgrowing the slot
+ * are moved to the fallback manager.
+ *
+ * @param umem pointer to umem
+ * @param new_size new requested size of the umem
+ * @return false if the memory couldn't be allocated (umem left untouched)
+ */
+static bool upipe_shmsink_mem_realloc(struct umem *umem, size_t new_size)
+{
+    if (new_size <= umem->real_size) {
+        umem->size = new_size;
+        return true;
+    }
+
+    struct upipe_shmsink_mem *mem = upipe_shmsink_mem_from_umem_mgr(umem->mgr);
+    struct umem new_umem;
+    if (unlikely(!umem_alloc(mem->fallback, &new_umem, new_size)))
+        return false;
+    memcpy(new_umem.buffer, umem->buffer, umem->size);
+    upipe_shmsink_mem_free(umem);
+    *umem = new_umem;
+    return true;
+}
+
+/** @This releases the buffers kept in pools (none).
+ *
+ * @param mgr pointer to a umem_mgr structure
+ */
+static void upipe_shmsink_mem_vacuum(struct umem_mgr *mgr)
+{
+    struct upipe_shmsink_mem *mem = upipe_shmsink_mem_from_umem_mgr(mgr);
+    umem_mgr_vacuum(mem->fallback);
+}
+
+/** @This unmaps a segment.
+ *
+ * @param urefcount pointer to urefcount
+ */
+static void upipe_shmsink_mem_free_inner(struct urefcount *urefcount)
+{
+    struct upipe_shmsink_mem *mem =
+        upipe_shmsink_mem_from_urefcount(urefcount);
+    upipe_shm_close(&mem->seg);
+    umem_mgr_release(mem->fallback);
+    urefcount_clean(urefcount);
+    free(mem);
+}
+
+/** @internal @This creates a segment.
+ *
+ * @param upipe description structure of the pipe
+ * @param name name of the segment
+ * @return pointer to the segment, or NULL in case of error
+ */
+static struct upipe_shmsink_mem *upipe_shmsink_mem_open(struct upipe *upipe,
+                                                        const char *name)
+{
+    struct upipe_shmsink *upipe_shmsink = upipe_shmsink_from_upipe(upipe);
+    /* the ring holds a descriptor per slot, rounded up to a power of two */
+    uint32_t ring_size = 1;
+    while (ring_size && ring_size < upipe_shmsink->nb_slots)
+        ring_size <<= 1;
+
+    struct upipe_shmsink_mem *mem = malloc(sizeof(struct upipe_shmsink_mem));
+    if (unlikely(mem == NULL))
+        return NULL;
+    mem->fallback = umem_alloc_mgr_alloc();
+    if (unlikely(mem->fallback == NULL)) {
+        free(mem);
+        return NULL;
+    }
+    if (unlikely(!ubase_check(upipe_shm_create(upipe, &mem->seg, name,
+                        upipe_shmsink->nb_slots, upipe_shmsink->slot_size,
+                        ring_size)))) {
+        umem_mgr_release(mem->fallback);
+        free(mem);
+        return NULL;
+    }
+
+    urefcount_init(upipe_shmsink_mem_to_urefcount(mem),
+                   upipe_shmsink_mem_free_inner);
+    mem->mgr.refcount = upipe_shmsink_mem_to_urefcount(mem);
+    mem->mgr.umem_alloc = upipe_shmsink_mem_alloc;
+    mem->mgr.umem_realloc = upipe_shmsink_mem_realloc;
+    mem->mgr.umem_free = upipe_shmsink_mem_free;
+    mem->mgr.umem_mgr_vacuum = upipe_shmsink_mem_vacuum;
+    mem->mgr.umem_mgr_control = NULL;
+    return mem;
+}
+
+/** @internal @This allocates a shm sink pipe.
+ *
+ * @param mgr common management structure
+ * @param uprobe structure used to raise events
+ * @param signature signature of the pipe allocator
+ * @param args optional arguments
+ * @return pointer to upipe or NULL in case of allocation error
+ */
+static struct upipe *upipe_shmsink_alloc(struct upipe_mgr *mgr,
+                                         struct uprobe *uprobe,
+                                         uint32_t signature, va_list args)
+{
+    struct upipe *upipe = upipe_shmsink_alloc_void(mgr, uprobe, signature,
+                                                   args);
+    struct upipe_shmsink *upipe_shmsink = upipe_shmsink_from_upipe(upipe);
+    upipe_shmsink_init_urefcount(upipe);
+    upipe_shmsink_init_upump_mgr(upipe);
+    upipe_shmsink_init_upump(upipe);
+    upipe_shmsink_init_input(upipe);
+    upipe_shmsink->mem = NULL;
+    upipe_shmsink->uri = NULL;
+    upipe_shmsink->nb_slots = DEFAULT_NB_SLOTS;
+    upipe_shmsink->slot_size = DEFAULT_SLOT_SIZE;
+    upipe_shmsink->period = DEFAULT_PERIOD;
+    upipe_shmsink->flow_def = NULL;
+    upipe_shmsink->peer = 0;
+    upipe_throw_ready(upipe);
+    return upipe;
+}
+
+/** @internal @This gives back the slots referenced by a source which has
+ * left or crashed, and makes the segment available to a new source.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_shmsink_check_source(struct upipe *upipe)
+{
+    struct upipe_shmsink *upipe_shmsink = upipe_shmsink_from_upipe(upipe);
+    struct upipe_shm_seg *seg = &upipe_shmsink->mem->seg;
+    int32_t pid = __atomic_load_n(&seg->header->source_pid, __ATOMIC_ACQUIRE);
+    if (pid == 0 || upipe_shm_peer_alive(pid))
+        return;
+
+    if (pid == UPIPE_SHM_PID_DETACHED) {
+        /* the source still releases the buffers it has output, so only the
+         * descriptors it didn't read are given back */
+        struct upipe_shm_desc *desc;
+        while ((desc = upipe_shm_ring_peek(seg)) != NULL) {
+            if (desc->slot != UPIPE_SHM_NO_SLOT)
+                upipe_shm_slot_release(seg, desc->slot, UPIPE_SHM_SOURCE_REF);
+            upipe_shm_ring_consume(seg);
+        }
+    } else {
+        upipe_warn_va(upipe, "source %"PRId32" died, reclaiming its buffers",
+                      pid);
+        __atomic_store_n(&seg->header->source_pid, UPIPE_SHM_PID_DETACHED,
+                         __ATOMIC_RELAXED);
+        for (uint32_t slot = 0; slot < seg->header->nb_slots; slot++) {
+            uint64_t refs = __atomic_load_n(&seg->refs[slot],
+                                            __ATOMIC_RELAXED);
+            while ((refs & ~UPIPE_SHM_SINK_MASK) &&
+                   !__atomic_compare_exchange_n(&seg->refs[slot], &refs,
+                            refs & UPIPE_SHM_SINK_MASK, true,
+                            __ATOMIC_ACQ_REL, __ATOMIC_RELAXED));
+            if ((refs & ~UPIPE_SHM_SINK_MASK) && !(refs & UPIPE_SHM_SINK_MASK))
+                upipe_shm_slot_push(seg, slot);
+        }
+        __atomic_store_n(seg->tail, __atomic_load_n(seg->head,
+                                                    __ATOMIC_RELAXED),
+                         __ATOMIC_RELAXED);
+    }
+
+    upipe_shmsink->peer = 0;
+    __atomic_store_n(&seg->header->source_pid, 0, __ATOMIC_RELEASE);
+}
+
+/** @internal @This passes a uref to the source.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref uref structure, left untouched
+ * @param flags flags of the descriptor
+ * @return UBASE_ERR_BUSY if the segment is full, or an error code
+ */
+static int upipe_shmsink_send(struct upipe *upipe, struct uref *uref,
+                              uint32_t flags)
+{
+    struct upipe_shmsink *upipe_shmsink = upipe_shmsink_from_upipe(upipe);
+    struct upipe_shm_seg *seg = &upipe_shmsink->mem->seg;
+    struct upipe_shm_desc *desc = upipe_shm_ring_reserve(seg);
+    if (unlikely(desc == NULL))
+        return UBASE_ERR_BUSY;
+
+    UBASE_RETURN(upipe_shm_attr_export(uref, desc->attr, &desc->attr_size))
+    desc->flags = flags;
+    desc->uref_flags = uref->flags;
+    desc->date_sys = uref->date_sys;
+    desc->date_prog = uref->date_prog;
+    desc->date_orig = uref->date_orig;
+    desc->dts_pts_delay = uref->dts_pts_delay;
+    desc->cr_dts_delay = uref->cr_dts_delay;
+    desc->rap_cr_delay = uref->rap_cr_delay;
+    desc->duration = uref->duration;
+    desc->slot = UPIPE_SHM_NO_SLOT;
+    desc->offset = desc->size = 0;
+
+    size_t size;
+    if (uref->ubuf != NULL &&
+        ubase_check(uref_block_size(uref, &size)) && size) {
+        int read_size = -1;
+        const uint8_t *buffer;
+        uint32_t slot;
+        UBASE_RETURN(uref_block_read(uref, 0, &read_size, &buffer))
+        bool shared = read_size == size &&
+                      upipe_shm_slot_lookup(seg, buffer, size, &slot);
+        uref_block_unmap(uref, 0);
+
+        if (shared) {
+            /* the block already lies in a slot */
+            __atomic_fetch_add(&seg->refs[slot], UPIPE_SHM_SOURCE_REF,
+                               __ATOMIC_RELAXED);
+            desc->offset = buffer - upipe_shm_slot_buffer(seg, slot);
+        } else {
+            if (unlikely(size > seg->header->slot_size))
+                return UBASE_ERR_INVALID;
+            if (unlikely(!upipe_shm_slot_pop(seg, &slot)))
+                return UBASE_ERR_BUSY;
+            __atomic_store_n(&seg->refs[slot], UPIPE_SHM_SOURCE_REF,
+                             __ATOMIC_RELAXED);
+            uref_block_extract(uref, 0, size,
+                               upipe_shm_slot_buffer(seg, slot));
+        }
+        desc->slot = slot;
+        desc->size = size;
+    }
+
+    upipe_shm_ring_commit(seg);
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This outputs a uref to the segment.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref uref structure
+ * @param upump_p reference to pump that generated the buffer
+ * @return false if the uref has to be held until the segment is no longer
+ * full
+ */
+static bool upipe_shmsink_output(struct upipe *upipe, struct uref *uref,
+                                 struct upump **upump_p)
+{
+    struct upipe_shmsink *upipe_shmsink = upipe_shmsink_from_upipe(upipe);
+    const char *def;
+    if (unlikely(ubase_check(uref_flow_get_def(uref, &def)))) {
+        uref_free(upipe_shmsink->flow_def);
+        upipe_shmsink->flow_def = uref;
+        upipe_shmsink->peer = 0;
+        return true;
+    }
+
+    if (unlikely(upipe_shmsink->mem == NULL)) {
+        uref_free(uref);
+        return true;
+    }
+
+    struct upipe_shm_seg *seg = &upipe_shmsink->mem->seg;
+    int32_t pid = __atomic_load_n(&seg->header->source_pid, __ATOMIC_ACQUIRE);
+    if (pid <= 0) {
+        /* no source is listening */
+        uref_free(uref);
+        return true;
+    }
+
+    int err;
+    if (unlikely(pid != upipe_shmsink->peer)) {
+        if (upipe_shmsink->flow_def != NULL) {
+            err = upipe_shmsink_send(upipe, upipe_shmsink->flow_def,
+                                     UPIPE_SHM_DESC_FLOW_DEF);
+            if (err == UBASE_ERR_BUSY)
+                return false;
+            if (unlikely(!ubase_check(err)))
+                upipe_warn(upipe, "unable to pass flow definition");
+        }
+        upipe_shmsink->peer = pid;
+    }
+
+    err = upipe_shmsink_send(upipe, uref, 0);
+    if (err == UBASE_ERR_BUSY)
+        return false;
+    if (unlikely(!ubase_check(err)))
+        upipe_warn(upipe, "dropping buffer not fitting in the segment");
+    uref_free(uref);
+    return true;
+}
+
+/** @internal @This is called periodically to check the source, and to output
+ * the urefs held while the segment was full.
+ *
+ * @param upump description structure of the timer
+ */
+static void upipe_shmsink_timer(struct upump *upump)
+{
+    struct upipe *upipe = upump_get_opaque(upump, struct upipe *);
+    upipe_shmsink_check_source(upipe);
+    if (upipe_shmsink_check_input(upipe))
+        return;
+
+    upipe_shmsink_output_input(upipe);
+    upipe_shmsink_unblock_input(upipe);
+    if (upipe_shmsink_check_input(upipe)) {
+        /* All packets have been output, release again the pipe that has been
+         * used in @ref upipe_shmsink_input. */
+        upipe_release(upipe);
+    }
+}
+
+/** @internal @This starts the timer checking the source.
+ *
+ * @param upipe description structure of the pipe
+ * @return an error code
+ */
+static int upipe_shmsink_check(struct upipe *upipe)
+{
+    struct upipe_shmsink *upipe_shmsink = upipe_shmsink_from_upipe(upipe);
+    if (upipe_shmsink->mem == NULL || upipe_shmsink->upump != NULL)
+        return UBASE_ERR_NONE;
+
+    upipe_shmsink_check_upump_mgr(upipe);
+    if (upipe_shmsink->upump_mgr == NULL)
+        return UBASE_ERR_NONE;
+
+    struct upump *upump = upump_alloc_timer(upipe_shmsink->upump_mgr,
+                                            upipe_shmsink_timer, upipe,
+                                            upipe->refcount,
+                                            upipe_shmsink->period,
+                                            upipe_shmsink->period);
+    if (unlikely(upump == NULL)) {
+        upipe_throw_fatal(upipe, UBASE_ERR_UPUMP);
+        return UBASE_ERR_UPUMP;
+    }
+    upipe_shmsink_set_upump(upipe, upump);
+    upump_start(upump);
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This receives data.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref uref structure
+ * @param upump_p reference to pump that generated the buffer
+ */
+static void upipe_shmsink_input(struct upipe *upipe, struct uref *uref,
+                                struct upump **upump_p)
+{
+    if (!upipe_shmsink_check_input(upipe)) {
+        upipe_shmsink_hold_input(upipe, uref);
+        upipe_shmsink_block_input(upipe, upump_p);
+    } else if (!upipe_shmsink_output(upipe, uref, upump_p)) {
+        upipe_shmsink_hold_input(upipe, uref);
+        upipe_shmsink_block_input(upipe, upump_p);
+        /* Increment upipe refcount to avoid disappearing before all packets
+         * have been sent. */
+        upipe_use(upipe);
+    }
+}
+
+/** @internal @This sets the input flow definition.
+ *
+ * @param upipe description structure of the pipe
+ * @param flow_def flow definition packet
+ * @return an error code
+ */
+static int upipe_shmsink_set_flow_def(struct upipe *upipe,
+                                      struct uref *flow_def)
+{
+    if (flow_def == NULL)
+        return UBASE_ERR_INVALID;
+    UBASE_RETURN(uref_flow_match_def(flow_def, EXPECTED_FLOW_DEF))
+    flow_def = uref_dup(flow_def);
+    UBASE_ALLOC_RETURN(flow_def)
+    upipe_input(upipe, flow_def, NULL);
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This provides a ubuf manager allocating blocks directly in the
+ * slots of the segment.
+ *
+ * @param upipe description structure of the pipe
+ * @param request ubuf manager request
+ * @return an error code
+ */
+static int upipe_shmsink_provide_ubuf_mgr(struct upipe *upipe,
+                                          struct urequest *request)
+{
+    struct upipe_shmsink *upipe_shmsink = upipe_shmsink_from_upipe(upipe);
+    const char *def;
+    if (upipe_shmsink->mem == NULL || request->uref == NULL ||
+        !ubase_check(uref_flow_get_def(request->uref, &def)) ||
+        ubase_ncmp(def, EXPECTED_FLOW_DEF))
+        return upipe_throw_provide_request(upipe, request);
+
+    struct uref *flow_format = uref_dup(request->uref);
+    UBASE_ALLOC_RETURN(flow_format);
+    struct ubuf_mgr *ubuf_mgr =
+        ubuf_mem_mgr_alloc_from_flow_def(UBUF_POOL_DEPTH, UBUF_POOL_DEPTH,
+                                         &upipe_shmsink->mem->mgr,
+                                         flow_format);
+    if (unlikely(ubuf_mgr == NULL)) {
+        uref_free(flow_format);
+        return upipe_throw_provide_request(upipe, request);
+    }
+
+    upipe_dbg(upipe, "providing shared memory buffers");
+    return urequest_provide_ubuf_mgr(request, ubuf_mgr, flow_format);
+}
+
+/** @internal @This closes the segment, which is unmapped once all its
+ * buffers are released.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_shmsink_close(struct upipe *upipe)
+{
+    struct upipe_shmsink *upipe_shmsink = upipe_shmsink_from_upipe(upipe);
+    upipe_shmsink_set_upump(upipe, NULL);
+    if (upipe_shmsink->mem != NULL) {
+        upipe_notice_va(upipe, "closing segment %s", upipe_shmsink->uri);
+        __atomic_store_n(&upipe_shmsink->mem->seg.header->sink_pid, 0,
+                         __ATOMIC_RELEASE);
+        shm_unlink(upipe_shmsink->uri);
+        urefcount_release(upipe_shmsink_mem_to_urefcount(upipe_shmsink->mem));
+        upipe_shmsink->mem = NULL;
+    }
+    ubase_clean_str(&upipe_shmsink->uri);
+    upipe_shmsink->peer = 0;
+}
+
+/** @internal @This returns the name of the currently opened segment.
+ *
+ * @param upipe description structure of the pipe
+ * @param uri_p filled in with the name of the segment
+ * @return an error code
+ */
+static int upipe_shmsink_get_uri(struct upipe *upipe, const char **uri_p)
+{
+    struct upipe_shmsink *upipe_shmsink = upipe_shmsink_from_upipe(upipe);
+    assert(uri_p != NULL);
+    *uri_p = upipe_shmsink->uri;
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This creates the given segment.
+ *
+ * @param upipe description structure of the pipe
+ * @param uri name of the segment
+ * @return an error code
+ */
+static int upipe_shmsink_set_uri(struct upipe *upipe, const char *uri)
+{
+    struct upipe_shmsink *upipe_shmsink = upipe_shmsink_from_upipe(upipe);
+    upipe_shmsink_close(upipe);
+    if (unlikely(uri == NULL))
+        return UBASE_ERR_NONE;
+
+    upipe_shmsink->uri = strdup(uri);
+    UBASE_ALLOC_RETURN(upipe_shmsink->uri)
+    upipe_shmsink->mem = upipe_shmsink_mem_open(upipe, uri);
+    if (unlikely(upipe_shmsink->mem == NULL)) {
+        ubase_clean_str(&upipe_shmsink->uri);
+        return UBASE_ERR_EXTERNAL;
+    }
+    upipe_notice_va(upipe, "opening segment %s (%u slots of %u octets)",
+                    uri, upipe_shmsink->mem->seg.header->nb_slots,
+                    upipe_shmsink->mem->seg.header->slot_size);
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This processes control commands on a shm sink pipe.
+ *
+ * @param upipe description structure of the pipe
+ * @param command type of command to process
+ * @param args arguments of the command
+ * @return an error code
+ */
+static int _upipe_shmsink_control(struct upipe *upipe,
+                                  int command, va_list args)
+{
+    struct upipe_shmsink *upipe_shmsink = upipe_shmsink_from_upipe(upipe);
+
+    switch (command) {
+        case UPIPE_REGISTER_REQUEST: {
+            struct urequest *request = va_arg(args, struct urequest *);
+            if (request->type == UREQUEST_UBUF_MGR)
+                return upipe_shmsink_provide_ubuf_mgr(upipe, request);
+            return upipe_throw_provide_request(upipe, request);
+        }
+        case UPIPE_UNREGISTER_REQUEST:
+            return UBASE_ERR_NONE;
+
+        case UPIPE_ATTACH_UPUMP_MGR:
+            upipe_shmsink_set_upump(upipe, NULL);
+            return upipe_shmsink_attach_upump_mgr(upipe);
+        case UPIPE_SET_FLOW_DEF: {
+            struct uref *flow_def = va_arg(args, struct uref *);
+            return upipe_shmsink_set_flow_def(upipe, flow_def);
+        }
+
+        case UPIPE_GET_MAX_LENGTH: {
+            unsigned int *p = va_arg(args, unsigned int *);
+            return upipe_shmsink_get_max_length(upipe, p);
+        }
+        case UPIPE_SET_MAX_LENGTH: {
+            unsigned int max_length = va_arg(args, unsigned int);
+            return upipe_shmsink_set_max_length(upipe, max_length);
+        }
+
+        case UPIPE_GET_URI: {
+            const char **uri_p = va_arg(args, const char **);
+            return upipe_shmsink_get_uri(upipe, uri_p);
+        }
+        case UPIPE_SET_URI: {
+            const char *uri = va_arg(args, const char *);
+            return upipe_shmsink_set_uri(upipe, uri);
+        }
+
+        case UPIPE_SHMSINK_GET_SLOTS: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_SHMSINK_SIGNATURE)
+            unsigned int *nb_slots_p = va_arg(args, unsigned int *);
+            unsigned int *slot_size_p = va_arg(args, unsigned int *);
+            if (nb_slots_p != NULL)
+                *nb_slots_p = upipe_shmsink->nb_slots;
+            if (slot_size_p != NULL)
+                *slot_size_p = upipe_shmsink->slot_size;
+            return UBASE_ERR_NONE;
+        }
+        case UPIPE_SHMSINK_SET_SLOTS: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_SHMSINK_SIGNATURE)
+            unsigned int nb_slots = va_arg(args, unsigned int);
+            unsigned int slot_size = va_arg(args, unsigned int);
+            if (!nb_slots || !slot_size)
+                return UBASE_ERR_INVALID;
+            upipe_shmsink->nb_slots = nb_slots;
+            upipe_shmsink->slot_size = slot_size;
+            return UBASE_ERR_NONE;
+        }
+        case UPIPE_SHMSINK_GET_PERIOD: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_SHMSINK_SIGNATURE)
+            uint64_t *period_p = va_arg(args, uint64_t *);
+            *period_p = upipe_shmsink->period;
+            return UBASE_ERR_NONE;
+        }
+        case UPIPE_SHMSINK_SET_PERIOD: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_SHMSINK_SIGNATURE)
+            uint64_t period = va_arg(args, uint64_t);
+            if (!period)
+                return UBASE_ERR_INVALID;
+            upipe_shmsink->period = period;
+            upipe_shmsink_set_upump(upipe, NULL);
+            return UBASE_ERR_NONE;
+        }
+        default:
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** @internal @This processes control commands on a shm sink pipe, and
+ * checks the status of the pipe afterwards.
+ *
+ * @param upipe description structure of the pipe
+ * @param command type of command to process
+ * @param args arguments of the command
+ * @return an error code
+ */
+static int upipe_shmsink_control(struct upipe *upipe, int command,
+                                 va_list args)
+{
+    UBASE_RETURN(_upipe_shmsink_control(upipe, command, args));
+    return upipe_shmsink_check(upipe);
+}
+
+/** @This frees a upipe.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_shmsink_free(struct upipe *upipe)
+{
+    struct upipe_shmsink *upipe_shmsink = upipe_shmsink_from_upipe(upipe);
+    upipe_throw_dead(upipe);
+
+    upipe_shmsink_clean_input(upipe);
+    upipe_shmsink_close(upipe);
+    uref_free(upipe_shmsink->flow_def);
+    upipe_shmsink_clean_upump(upipe);
+    upipe_shmsink_clean_upump_mgr(upipe);
+    upipe_shmsink_clean_urefcount(upipe);
+    upipe_shmsink_free_void(upipe);
+}
+
+/** module manager static descriptor */
+static struct upipe_mgr upipe_shmsink_mgr = {
+    .refcount = NULL,
+    .signature = UPIPE_SHMSINK_SIGNATURE,
+
+    .upipe_alloc = upipe_shmsink_alloc,
+    .upipe_input = upipe_shmsink_input,
+    .upipe_control = upipe_shmsink_control,
+
+    .upipe_mgr_control = NULL
+};
+
+/** @This returns the management structure for all shm sink pipes.
+ *
+ * @return pointer to manager
+ */
+struct upipe_mgr *upipe_shmsink_mgr_alloc(void)
+{
+    return &upipe_shmsink_mgr;
+}
@@ -0,0 +1,774 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short Upipe source module for shared memory segments
+ */
+
+#define _GNU_SOURCE
+
+#include <upipe/ubase.h>
+#include <upipe/uprobe.h>
+#include <upipe/urequest.h>
+#include <upipe/uclock.h>
+#include <upipe/uref.h>
+#include <upipe/uref_flow.h>
+#include <upipe/upump.h>
+#include <upipe/ubuf.h>
+#include <upipe/ubuf_block.h>
+#include <upipe/ubuf_block_common.h>
+#include <upipe/upool.h>
+#include <upipe/uatomic.h>
+#include <upipe/upipe.h>
+#include <upipe/upipe_helper_upipe.h>
+#include <upipe/upipe_helper_urefcount.h>
+#include <upipe/upipe_helper_void.h>
+#include <upipe/upipe_helper_uref_mgr.h>
+#include <upipe/upipe_helper_output.h>
+#include <upipe/upipe_helper_upump_mgr.h>
+#include <upipe/upipe_helper_upump.h>
+#include <upipe-modules/upipe_shm_source.h>
+#include "upipe_shm.h"
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include <string.h>
+#include <unistd.h>
+#include <assert.h>
+
+/** default polling period */
+#define DEFAULT_PERIOD (UCLOCK_FREQ / 1000)
+/** depth of the pools of ubufs and chunks pointing to a segment */
+#define MAP_POOL_DEPTH 64
+
+/** @hidden */
+static int upipe_shmsrc_check(struct upipe *upipe, struct uref *flow_format);
+
+/** @internal @This is a payload passed by the sink, referenced by one or
+ * several ubufs. */
+struct upipe_shmsrc_chunk {
+    /** number of ubufs pointing to the chunk */
+    uatomic_uint32_t refcount;
+    /** slot holding the payload */
+    uint32_t slot;
+};
+
+/** @internal @This is a segment attached by the source, acting as ubuf
+ * manager for its slots. It is unmapped when the pipe and all ubufs are
+ * released. */
+struct upipe_shmsrc_map {
+    /** refcount management structure */
+    struct urefcount urefcount;
+
+    /** mapping of the segment */
+    struct upipe_shm_seg seg;
+
+    /** ubuf pool */
+    struct upool ubuf_pool;
+    /** chunk pool */
+    struct upool chunk_pool;
+
+    /** common management structure */
+    struct ubuf_mgr mgr;
+
+    /** extra space for the upools */
+    uint8_t extra[];
+};
+
+UBASE_FROM_TO(upipe_shmsrc_map, ubuf_mgr, ubuf_mgr, mgr)
+UBASE_FROM_TO(upipe_shmsrc_map, urefcount, urefcount, urefcount)
+UBASE_FROM_TO(upipe_shmsrc_map, upool, ubuf_pool, ubuf_pool)
+UBASE_FROM_TO(upipe_shmsrc_map, upool, chunk_pool, chunk_pool)
+
+/** @internal @This is a super-set of the @ref ubuf (and @ref ubuf_block)
+ * structure pointing to a payload in the segment. */
+struct upipe_shmsrc_ubuf {
+    /** pointer to the chunk */
+    struct upipe_shmsrc_chunk *chunk;
+
+    /** block structure */
+    struct ubuf_block ubuf_block;
+};
+
+UBASE_FROM_TO(upipe_shmsrc_ubuf, ubuf, ubuf, ubuf_block.ubuf)
+
+/** @internal @This is the private context of a shm source pipe. */
+struct upipe_shmsrc {
+    /** refcount management structure */
+    struct urefcount urefcount;
+
+    /** uref manager */
+    struct uref_mgr *uref_mgr;
+    /** uref manager request */
+    struct urequest uref_mgr_request;
+
+    /** pipe acting as output */
+    struct upipe *output;
+    /** flow definition packet */
+    struct uref *flow_def;
+    /** output state */
+    enum upipe_helper_output_state output_state;
+    /** list of output requests */
+    struct uchain request_list;
+
+    /** upump manager */
+    struct upump_mgr *upump_mgr;
+    /** polling timer */
+    struct upump *upump;
+    /** polling period */
+    uint64_t period;
+
+    /** attached segment, or NULL */
+    struct upipe_shmsrc_map *map;
+    /** segment name */
+    char *uri;
+
+    /** public upipe structure */
+    struct upipe upipe;
+};
+
+UPIPE_HELPER_UPIPE(upipe_shmsrc, upipe, UPIPE_SHMSRC_SIGNATURE)
+UPIPE_HELPER_UREFCOUNT(upipe_shmsrc, urefcount, upipe_shmsrc_free)
+UPIPE_HELPER_VOID(upipe_shmsrc)
+
+UPIPE_HELPER_OUTPUT(upipe_shmsrc, output, flow_def, output_state, request_list)
+UPIPE_HELPER_UREF_MGR(upipe_shmsrc, uref_mgr, uref_mgr_request,
+                      upipe_shmsrc_check,
+                      upipe_shmsrc_register_output_request,
+                      upipe_shmsrc_unregister_output_request)
+UPIPE_HELPER_UPUMP_MGR(upipe_shmsrc, upump_mgr)
+UPIPE_HELPER_UPUMP(upipe_shmsrc, upump, upump_mgr)
+
+/** @This unmaps a segment.
+ *
+ * @param urefcount pointer to urefcount
+ */
+static void upipe_shmsrc_map_free(struct urefcount *urefcount)
+{
+    struct upipe_shmsrc_map *map = upipe_shmsrc_map_from_urefcount(urefcount);
+    upipe_shm_close(&map->seg);
+    upool_clean(&map->ubuf_pool);
+    upool_clean(&map->chunk_pool);
+    urefcount_clean(urefcount);
+    free(map);
+}
+
+/** @internal @This releases a chunk, once it isn't used by any ubuf anymore,
+ * and gives the slot back to the sink.
+ *
+ * @param map pointer to the segment
+ * @param chunk pointer to the chunk
+ */
+static void upipe_shmsrc_chunk_release(struct upipe_shmsrc_map *map,
+                                       struct upipe_shmsrc_chunk *chunk)
+{
+    if (uatomic_fetch_sub(&chunk->refcount, 1) == 1) {
+        upipe_shm_slot_release(&map->seg, chunk->slot, UPIPE_SHM_SOURCE_REF);
+        upool_free(&map->chunk_pool, chunk);
+    }
+}
+
+/** @internal @This allocates a ubuf structure from the pool.
+ *
+ * @param map pointer to the segment
+ * @param chunk pointer to the chunk, whose reference is taken over
+ * @return pointer to ubuf or NULL in case of allocation error
+ */
+static struct ubuf *upipe_shmsrc_ubuf_alloc(struct upipe_shmsrc_map *map,
+                                            struct upipe_shmsrc_chunk *chunk)
+{
+    struct upipe_shmsrc_ubuf *shmsrc_ubuf =
+        upool_alloc(&map->ubuf_pool, struct upipe_shmsrc_ubuf *);
+    if (unlikely(shmsrc_ubuf == NULL))
+        return NULL;
+    shmsrc_ubuf->chunk = chunk;
+    struct ubuf *ubuf = upipe_shmsrc_ubuf_to_ubuf(shmsrc_ubuf);
+    ubuf_block_common_init(ubuf, false);
+    ubuf_block_common_set_buffer(ubuf, map->seg.slots);
+    return ubuf;
+}
+
+/** @This refuses to allocate arbitrary ubufs.
+ *
+ * @param mgr common management structure
+ * @param signature signature of the allocator
+ * @param args optional arguments
+ * @return NULL
+ */
+static struct ubuf *upipe_shmsrc_map_alloc(struct ubuf_mgr *mgr,
+                                           uint32_t signature, va_list args)
+{
+    return NULL;
+}
+
+/** @This creates a new reference to the same chunk, with another offset
+ * and size.
+ *
+ * @param ubuf pointer to ubuf
+ * @param new_ubuf_p reference written with a pointer to the newly allocated
+ * ubuf
+ * @param offset offset in the buffer, or -1 to duplicate the ubuf
+ * @param size final size of the buffer
+ * @return an error code
+ */
+static int upipe_shmsrc_ubuf_splice(struct ubuf *ubuf,
+                                    struct ubuf **new_ubuf_p,
+                                    int offset, int size)
+{
+    assert(new_ubuf_p != NULL);
+    struct upipe_shmsrc_map *map = upipe_shmsrc_map_from_ubuf_mgr(ubuf->mgr);
+    struct upipe_shmsrc_ubuf *shmsrc_ubuf = upipe_shmsrc_ubuf_from_ubuf(ubuf);
+    uatomic_fetch_add(&shmsrc_ubuf->chunk->refcount, 1);
+    struct ubuf *new_ubuf = upipe_shmsrc_ubuf_alloc(map, shmsrc_ubuf->chunk);
+    if (unlikely(new_ubuf == NULL)) {
+        upipe_shmsrc_chunk_release(map, shmsrc_ubuf->chunk);
+        return UBASE_ERR_ALLOC;
+    }
+
+    int err = offset < 0 ? ubuf_block_common_dup(ubuf, new_ubuf) :
+              ubuf_block_common_splice(ubuf, new_ubuf, offset, size);
+    if (unlikely(!ubase_check(err))) {
+        ubuf_free(new_ubuf);
+        return UBASE_ERR_INVALID;
+    }
+    *new_ubuf_p = new_ubuf;
+    return UBASE_ERR_NONE;
+}
+
+/** @This handles control commands.
+ *
+ * @param ubuf pointer to ubuf
+ * @param command type of command to process
+ * @param args arguments of the command
+ * @return an error code
+ */
+static int upipe_shmsrc_ubuf_control(struct ubuf *ubuf, int command,
+                                     va_list args)
+{
+    switch (command) {
+        case UBUF_DUP: {
+            struct ubuf **new_ubuf_p = va_arg(args, struct ubuf **);
+            return upipe_shmsrc_ubuf_splice(ubuf, new_ubuf_p, -1, 0);
+        }
+        case UBUF_SINGLE: {
+            /* the payload may still be read by the sink process */
+            struct upipe_shmsrc_map *map =
+                upipe_shmsrc_map_from_ubuf_mgr(ubuf->mgr);
+            struct upipe_shmsrc_ubuf *shmsrc_ubuf =
+                upipe_shmsrc_ubuf_from_ubuf(ubuf);
+            uint32_t slot = shmsrc_ubuf->chunk->slot;
+            return uatomic_load(&shmsrc_ubuf->chunk->refcount) == 1 &&
+                   __atomic_load_n(&map->seg.refs[slot], __ATOMIC_ACQUIRE) ==
+                   UPIPE_SHM_SOURCE_REF ? UBASE_ERR_NONE : UBASE_ERR_BUSY;
+        }
+        case UBUF_SPLICE_BLOCK: {
+            struct ubuf **new_ubuf_p = va_arg(args, struct ubuf **);
+            int offset = va_arg(args, int);
+            int size = va_arg(args, int);
+            return upipe_shmsrc_ubuf_splice(ubuf, new_ubuf_p, offset, size);
+        }
+        default:
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** @This releases a ubuf, and the chunk if it was the last reference.
+ *
+ * @param ubuf pointer to a ubuf structure
+ */
+static void upipe_shmsrc_ubuf_free(struct ubuf *ubuf)
+{
+    struct upipe_shmsrc_map *map = upipe_shmsrc_map_from_ubuf_mgr(ubuf->mgr);
+    struct upipe_shmsrc_ubuf *shmsrc_ubuf = upipe_shmsrc_ubuf_from_ubuf(ubuf);
+    ubuf_block_common_clean(ubuf);
+    upipe_shmsrc_chunk_release(map, shmsrc_ubuf->chunk);
+    /* may unmap the segment */
+    upool_free(&map->ubuf_pool, shmsrc_ubuf);
+}
+
+/** @internal @This allocates the data structure.
+ *
+ * @param upool pointer to upool
+ * @return pointer to upipe_shmsrc_ubuf or NULL in case of allocation error
+ */
+static void *upipe_shmsrc_ubuf_alloc_inner(struct upool *upool)
+{
+    struct upipe_shmsrc_map *map = upipe_shmsrc_map_from_ubuf_pool(upool);
+    struct upipe_shmsrc_ubuf *shmsrc_ubuf =
+        malloc(sizeof(struct upipe_shmsrc_ubuf));
+    if (unlikely(shmsrc_ubuf == NULL))
+        return NULL;
+    upipe_shmsrc_ubuf_to_ubuf(shmsrc_ubuf)->mgr =
+        upipe_shmsrc_map_to_ubuf_mgr(map);
+    return shmsrc_ubuf;
+}
+
+/** @internal @This frees a upipe_shmsrc_ubuf.
+ *
+ * @param upool pointer to upool
+ * @param shmsrc_ubuf pointer to a upipe_shmsrc_ubuf structure to free
+ */
+static void upipe_shmsrc_ubuf_free_inner(struct upool *upool,
+                                         void *shmsrc_ubuf)
+{
+    free(shmsrc_ubuf);
+}
+
+/** @internal @This allocates a chunk.
+ *
+ * @param upool pointer to upool
+ * @return pointer to upipe_shmsrc_chunk or NULL in case of allocation error
+ */
+static void *upipe_shmsrc_chunk_alloc_inner(struct upool *upool)
+{
+    struct upipe_shmsrc_chunk *chunk =
+        malloc(sizeof(struct upipe_shmsrc_chunk));
+    if (unlikely(chunk == NULL))
+        return NULL;
+    uatomic_init(&chunk->refcount, 0);
+    return chunk;
+}
+
+/** @internal @This frees a chunk.
+ *
+ * @param upool pointer to upool
+ * @param chunk pointer to a upipe_shmsrc_chunk structure to free
+ */
+static void upipe_shmsrc_chunk_free_inner(struct upool *upool, void *chunk)
+{
+    uatomic_clean(&((struct upipe_shmsrc_chunk *)chunk)->refcount);
+    free(chunk);
+}
+
+/** @This handles manager control commands.
+ *
+ * @param mgr pointer to ubuf manager
+ * @param command type of command to process
+ * @param args arguments of the command
+ * @return an error code
+ */
+static int upipe_shmsrc_map_control(struct ubuf_mgr *mgr,
+                                    int command, va_list args)
+{
+    struct upipe_shmsrc_map *map = upipe_shmsrc_map_from_ubuf_mgr(mgr);
+    switch (command) {
+        case UBUF_MGR_VACUUM:
+            upool_vacuum(&map->ubuf_pool);
+            upool_vacuum(&map->chunk_pool);
+            return UBASE_ERR_NONE;
+        default:
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** @internal @This maps a segment and attaches to it as its source.
+ *
+ * @param upipe description structure of the pipe
+ * @param name name of the segment
+ * @return pointer to the segment, or NULL in case of error
+ */
+static struct upipe_shmsrc_map *upipe_shmsrc_map_open(struct upipe *upipe,
+                                                      const char *name)
+{
+    struct upipe_shmsrc_map *map =
+        malloc(sizeof(struct upipe_shmsrc_map) +
+               2 * upool_sizeof(MAP_POOL_DEPTH));
+    if (unlikely(map == NULL)) {
+        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+        return NULL;
+    }
+    if (unlikely(!ubase_check(upipe_shm_open(upipe, &map->seg, name)))) {
+        free(map);
+        return NULL;
+    }
+
+    /* the sink gives the segment to a new source once it has reclaimed the
+     * buffers of the previous one */
+    int32_t pid = 0;
+    if (unlikely(!__atomic_compare_exchange_n(&map->seg.header->source_pid,
+                        &pid, getpid(), false, __ATOMIC_ACQ_REL,
+                        __ATOMIC_RELAXED))) {
+        upipe_err_va(upipe, "segment %s is busy", name);
+        upipe_shm_close(&map->seg);
+        free(map);
+        return NULL;
+    }
+
+    urefcount_init(upipe_shmsrc_map_to_urefcount(map), upipe_shmsrc_map_free);
+    map->mgr.refcount = upipe_shmsrc_map_to_urefcount(map);
+    map->mgr.signature = UBUF_ALLOC_BLOCK;
+    map->mgr.ubuf_alloc = upipe_shmsrc_map_alloc;
+    map->mgr.ubuf_control = upipe_shmsrc_ubuf_control;
+    map->mgr.ubuf_free = upipe_shmsrc_ubuf_free;
+    map->mgr.ubuf_mgr_control = upipe_shmsrc_map_control;
+    upool_init(&map->ubuf_pool, map->mgr.refcount, MAP_POOL_DEPTH,
+               map->extra, upipe_shmsrc_ubuf_alloc_inner,
+               upipe_shmsrc_ubuf_free_inner);
+    upool_init(&map->chunk_pool, map->mgr.refcount, MAP_POOL_DEPTH,
+               map->extra + upool_sizeof(MAP_POOL_DEPTH),
+               upipe_shmsrc_chunk_alloc_inner, upipe_shmsrc_chunk_free_inner);
+    return map;
+}
+
+/** @internal @This allocates a shm source pipe.
+ *
+ * @param mgr common management structure
+ * @param uprobe structure used to raise events
+ * @param signature signature of the pipe allocator
+ * @param args optional arguments
+ * @return pointer to upipe or NULL in case of allocation error
+ */
+static struct upipe *upipe_shmsrc_alloc(struct upipe_mgr *mgr,
+                                        struct uprobe *uprobe,
+                                        uint32_t signature, va_list args)
+{
+    struct upipe *upipe = upipe_shmsrc_alloc_void(mgr, uprobe, signature,
+                                                  args);
+    struct upipe_shmsrc *upipe_shmsrc = upipe_shmsrc_from_upipe(upipe);
+    upipe_shmsrc_init_urefcount(upipe);
+    upipe_shmsrc_init_uref_mgr(upipe);
+    upipe_shmsrc_init_output(upipe);
+    upipe_shmsrc_init_upump_mgr(upipe);
+    upipe_shmsrc_init_upump(upipe);
+    upipe_shmsrc->period = DEFAULT_PERIOD;
+    upipe_shmsrc->map = NULL;
+    upipe_shmsrc->uri = NULL;
+    upipe_throw_ready(upipe);
+    return upipe;
+}
+
+/** @internal @This rebuilds a uref from a descriptor of the ring.
+ *
+ * @param upipe description structure of the pipe
+ * @param desc descriptor, whose reference on the slot is taken over
+ * @return pointer to uref, or NULL in case of error
+ */
+static struct uref *upipe_shmsrc_import(struct upipe *upipe,
+                                        struct upipe_shm_desc *desc)
+{
+    struct upipe_shmsrc *upipe_shmsrc = upipe_shmsrc_from_upipe(upipe);
+    struct upipe_shmsrc_map *map = upipe_shmsrc->map;
+    struct upipe_shm_seg *seg = &map->seg;
+    uint32_t slot = desc->slot;
+    if (unlikely(slot != UPIPE_SHM_NO_SLOT &&
+                 (slot >= seg->header->nb_slots ||
+                  desc->offset > seg->header->slot_size ||
+                  desc->size > seg->header->slot_size - desc->offset))) {
+        upipe_warn(upipe, "invalid descriptor");
+        return NULL;
+    }
+
+    struct upipe_shmsrc_chunk *chunk = NULL;
+    if (slot != UPIPE_SHM_NO_SLOT) {
+        chunk = upool_alloc(&map->chunk_pool, struct upipe_shmsrc_chunk *);
+        if (unlikely(chunk == NULL)) {
+            upipe_shm_slot_release(seg, slot, UPIPE_SHM_SOURCE_REF);
+            upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+            return NULL;
+        }
+        uatomic_store(&chunk->refcount, 1);
+        chunk->slot = slot;
+    }
+
+    struct uref *uref = desc->flags & UPIPE_SHM_DESC_FLOW_DEF ?
+                        uref_alloc_control(upipe_shmsrc->uref_mgr) :
+                        uref_alloc(upipe_shmsrc->uref_mgr);
+    if (unlikely(uref == NULL)) {
+        if (chunk != NULL)
+            upipe_shmsrc_chunk_release(map, chunk);
+        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+        return NULL;
+    }
+
+    if (chunk != NULL) {
+        struct ubuf *ubuf = upipe_shmsrc_ubuf_alloc(map, chunk);
+        if (unlikely(ubuf == NULL)) {
+            upipe_shmsrc_chunk_release(map, chunk);
+            uref_free(uref);
+            upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+            return NULL;
+        }
+        ubuf_block_common_set(ubuf, (size_t)slot * seg->header->slot_size +
+                              desc->offset, desc->size);
+        uref_attach_ubuf(uref, ubuf);
+    }
+
+    uref->flags = desc->uref_flags;
+    uref->date_sys = desc->date_sys;
+    uref->date_prog = desc->date_prog;
+    uref->date_orig = desc->date_orig;
+    uref->dts_pts_delay = desc->dts_pts_delay;
+    uref->cr_dts_delay = desc->cr_dts_delay;
+    uref->rap_cr_delay = desc->rap_cr_delay;
+    uref->duration = desc->duration;
+    if (unlikely(desc->attr_size > UPIPE_SHM_ATTR_SIZE ||
+                 !ubase_check(upipe_shm_attr_import(uref, desc->attr,
+                                                    desc->attr_size)))) {
+        upipe_warn(upipe, "invalid attributes");
+        uref_free(uref);
+        return NULL;
+    }
+    return uref;
+}
+
+/** @internal @This is called periodically to output the urefs passed by the
+ * sink.
+ *
+ * @param upump description structure of the timer
+ */
+static void upipe_shmsrc_worker(struct upump *upump)
+{
+    struct upipe *upipe = upump_get_opaque(upump, struct upipe *);
+    struct upipe_shmsrc *upipe_shmsrc = upipe_shmsrc_from_upipe(upipe);
+    struct upipe_shmsrc_map *map = upipe_shmsrc->map;
+    struct upipe_shm_seg *seg = &map->seg;
+    struct upipe_shm_desc *desc;
+    bool empty = true;
+
+    while (upipe_shmsrc->map == map &&
+           (desc = upipe_shm_ring_peek(seg)) != NULL) {
+        bool flow_def = desc->flags & UPIPE_SHM_DESC_FLOW_DEF;
+        struct uref *uref = upipe_shmsrc_import(upipe, desc);
+        upipe_shm_ring_consume(seg);
+        empty = false;
+        if (unlikely(uref == NULL))
+            continue;
+
+        if (flow_def)
+            upipe_shmsrc_store_flow_def(upipe, uref);
+        else
+            upipe_shmsrc_output(upipe, uref, &upipe_shmsrc->upump);
+    }
+
+    if (empty && !upipe_shm_peer_alive(
+                __atomic_load_n(&seg->header->sink_pid, __ATOMIC_ACQUIRE))) {
+        upipe_notice_va(upipe, "sink of segment %s has left",
+                        upipe_shmsrc->uri);
+        upipe_shmsrc_set_upump(upipe, NULL);
+        upipe_throw_source_end(upipe);
+    }
+}
+
+/** @internal @This checks if the pump may be allocated.
+ *
+ * @param upipe description structure of the pipe
+ * @param flow_format amended flow format
+ * @return an error code
+ */
+static int upipe_shmsrc_check(struct upipe *upipe, struct uref *flow_format)
+{
+    struct upipe_shmsrc *upipe_shmsrc = upipe_shmsrc_from_upipe(upipe);
+    if (flow_format != NULL)
+        uref_free(flow_format);
+
+    upipe_shmsrc_check_upump_mgr(upipe);
+    if (upipe_shmsrc->upump_mgr == NULL)
+        return UBASE_ERR_NONE;
+
+    if (upipe_shmsrc->uref_mgr == NULL) {
+        upipe_shmsrc_require_uref_mgr(upipe);
+        return UBASE_ERR_NONE;
+    }
+
+    if (upipe_shmsrc->map != NULL && upipe_shmsrc->upump == NULL) {
+        struct upump *upump = upump_alloc_timer(upipe_shmsrc->upump_mgr,
+                                                upipe_shmsrc_worker, upipe,
+                                                upipe->refcount,
+                                                upipe_shmsrc->period,
+                                                upipe_shmsrc->period);
+        if (unlikely(upump == NULL)) {
+            upipe_throw_fatal(upipe, UBASE_ERR_UPUMP);
+            return UBASE_ERR_UPUMP;
+        }
+        upipe_shmsrc_set_upump(upipe, upump);
+        upump_start(upump);
+    }
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This detaches from the segment, which is unmapped once all its
+ * ubufs are released. The sink then gives back the descriptors which weren't
+ * read.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_shmsrc_close(struct upipe *upipe)
+{
+    struct upipe_shmsrc *upipe_shmsrc = upipe_shmsrc_from_upipe(upipe);
+    upipe_shmsrc_set_upump(upipe, NULL);
+    if (upipe_shmsrc->map != NULL) {
+        upipe_notice_va(upipe, "closing segment %s", upipe_shmsrc->uri);
+        int32_t pid = getpid();
+        __atomic_compare_exchange_n(&upipe_shmsrc->map->seg.header->source_pid,
+                                    &pid, UPIPE_SHM_PID_DETACHED, false,
+                                    __ATOMIC_RELEASE, __ATOMIC_RELAXED);
+        urefcount_release(upipe_shmsrc_map_to_urefcount(upipe_shmsrc->map));
+        upipe_shmsrc->map = NULL;
+    }
+    ubase_clean_str(&upipe_shmsrc->uri);
+}
+
+/** @internal @This returns the name of the currently attached segment.
+ *
+ * @param upipe description structure of the pipe
+ * @param uri_p filled in with the name of the segment
+ * @return an error code
+ */
+static int upipe_shmsrc_get_uri(struct upipe *upipe, const char **uri_p)
+{
+    struct upipe_shmsrc *upipe_shmsrc = upipe_shmsrc_from_upipe(upipe);
+    assert(uri_p != NULL);
+    *uri_p = upipe_shmsrc->uri;
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This attaches to the given segment.
+ *
+ * @param upipe description structure of the pipe
+ * @param uri name of the segment
+ * @return an error code
+ */
+static int upipe_shmsrc_set_uri(struct upipe *upipe, const char *uri)
+{
+    struct upipe_shmsrc *upipe_shmsrc = upipe_shmsrc_from_upipe(upipe);
+    upipe_shmsrc_close(upipe);
+    if (unlikely(uri == NULL))
+        return UBASE_ERR_NONE;
+
+    upipe_shmsrc->uri = strdup(uri);
+    UBASE_ALLOC_RETURN(upipe_shmsrc->uri)
+    upipe_shmsrc->map = upipe_shmsrc_map_open(upipe, uri);
+    if (unlikely(upipe_shmsrc->map == NULL)) {
+        ubase_clean_str(&upipe_shmsrc->uri);
+        return UBASE_ERR_EXTERNAL;
+    }
+    upipe_notice_va(upipe, "opening segment %s", uri);
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This processes control commands on a shm source pipe.
+ *
+ * @param upipe description structure of the pipe
+ * @param command type of command to process
+ * @param args arguments of the command
+ * @return an error code
+ */
+static int _upipe_shmsrc_control(struct upipe *upipe,
+                                 int command, va_list args)
+{
+    struct upipe_shmsrc *upipe_shmsrc = upipe_shmsrc_from_upipe(upipe);
+
+    switch (command) {
+        case UPIPE_ATTACH_UPUMP_MGR:
+            upipe_shmsrc_set_upump(upipe, NULL);
+            return upipe_shmsrc_attach_upump_mgr(upipe);
+
+        case UPIPE_GET_FLOW_DEF:
+        case UPIPE_GET_OUTPUT:
+        case UPIPE_SET_OUTPUT:
+            return upipe_shmsrc_control_output(upipe, command, args);
+
+        case UPIPE_GET_URI: {
+            const char **uri_p = va_arg(args, const char **);
+            return upipe_shmsrc_get_uri(upipe, uri_p);
+        }
+        case UPIPE_SET_URI: {
+            const char *uri = va_arg(args, const char *);
+            return upipe_shmsrc_set_uri(upipe, uri);
+        }
+
+        case UPIPE_SHMSRC_GET_PERIOD: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_SHMSRC_SIGNATURE)
+            uint64_t *period_p = va_arg(args, uint64_t *);
+            *period_p = upipe_shmsrc->period;
+            return UBASE_ERR_NONE;
+        }
+        case UPIPE_SHMSRC_SET_PERIOD: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_SHMSRC_SIGNATURE)
+            uint64_t period = va_arg(args, uint64_t);
+            if (!period)
+                return UBASE_ERR_INVALID;
+            upipe_shmsrc->period = period;
+            upipe_shmsrc_set_upump(upipe, NULL);
+            return UBASE_ERR_NONE;
+        }
+        default:
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** @internal @This processes control commands on a shm source pipe, and
+ * checks the status of the pipe afterwards.
+ *
+ * @param upipe description structure of the pipe
+ * @param command type of command to process
+ * @param args arguments of the command
+ * @return an error code
+ */
+static int upipe_shmsrc_control(struct upipe *upipe, int command, va_list args)
+{
+    UBASE_RETURN(_upipe_shmsrc_control(upipe, command, args));
+    return upipe_shmsrc_check(upipe, NULL);
+}
+
+/** @This frees a upipe.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_shmsrc_free(struct upipe *upipe)
+{
+    upipe_throw_dead(upipe);
+
+    upipe_shmsrc_close(upipe);
+    upipe_shmsrc_clean_upump(upipe);
+    upipe_shmsrc_clean_upump_mgr(upipe);
+    upipe_shmsrc_clean_output(upipe);
+    upipe_shmsrc_clean_uref_mgr(upipe);
+    upipe_shmsrc_clean_urefcount(upipe);
+    upipe_shmsrc_free_void(upipe);
+}
+
+/** module manager static descriptor */
+static struct upipe_mgr upipe_shmsrc_mgr = {
+    .refcount = NULL,
+    .signature = UPIPE_SHMSRC_SIGNATURE,
+
+    .upipe_alloc = upipe_shmsrc_alloc,
+    .upipe_input = NULL,
+    .upipe_control = upipe_shmsrc_control,
+
+    .upipe_mgr_control = NULL
+};
+
+/** @This returns the management structure for all shm sources.
+ *
+ * @return pointer to manager
+ */
+struct upipe_mgr *upipe_shmsrc_mgr_alloc(void)
+{
+    return &upipe_shmsrc_mgr;
+}
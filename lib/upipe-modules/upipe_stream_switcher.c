@@ -99,6 +99,12 @@ struct upipe_stream_switcher {
     uint64_t last_pts_orig;
     uint64_t rebase_timestamp;
     bool rebase_timestamp_set;
+    /** maximum pre-buffer duration, or 0 */
+    uint64_t prebuffer;
+    /** last dts of the output stream, after shift, or UINT64_MAX */
+    uint64_t last_dts_orig;
+    /** duration of the last output frame */
+    uint64_t last_duration;
 
     /** for upipe helper */
     struct upipe upipe;
@@ -138,6 +144,10 @@ struct upipe_stream_switcher_input {
 
     /** private */
     bool sync;
+    /** true if synchronized on a key frame older than the output */
+    bool late;
+    /** shift applied to the timestamps of the stream */
+    uint64_t shift;
 
     /** for upipe helper */
     struct upipe upipe;
@@ -189,6 +199,8 @@ static struct upipe *upipe_stream_switcher_input_alloc(struct upipe_mgr *mgr,
     struct upipe_stream_switcher_input *upipe_stream_switcher_input =
         upipe_stream_switcher_input_from_upipe(upipe);
     upipe_stream_switcher_input->sync = false;
+    upipe_stream_switcher_input->late = false;
+    upipe_stream_switcher_input->shift = 0;
     urefcount_init(&upipe_stream_switcher_input->urefcount_real,
                    upipe_stream_switcher_input_free);
 
@@ -333,6 +345,21 @@ static void upipe_stream_switcher_switch(struct upipe_stream_switcher *super)
 
     /* wake up the new one */
     if (super->selected) {
+        struct upipe_stream_switcher_input *selected =
+            upipe_stream_switcher_input_from_upipe(super->selected);
+        struct uchain *uchain = ulist_peek(&selected->urefs);
+        uint64_t dts_orig;
+        uint64_t dts_end = super->last_dts_orig + super->last_duration;
+        if (selected->late && uchain != NULL &&
+            super->last_dts_orig != UINT64_MAX &&
+            ubase_check(uref_clock_get_dts_orig(uref_from_uchain(uchain),
+                                                &dts_orig)) &&
+            dts_orig < dts_end) {
+            /* start from the pre-buffered key frame */
+            selected->shift = dts_end - dts_orig;
+            upipe_dbg_va(super->selected, "shift timestamps by %"PRIu64"ms",
+                         selected->shift / (UCLOCK_FREQ / 1000));
+        }
         upipe_stream_switcher_input_throw_entering(super->selected);
         if (upipe_stream_switcher_input_output_input(super->selected))
             upipe_stream_switcher_input_unblock_input(super->selected);
@@ -356,11 +383,25 @@ static bool upipe_stream_switcher_fwd(struct upipe *upipe,
         upipe_stream_switcher_from_sub_mgr(upipe_mgr);
     struct upipe *super = upipe_stream_switcher_to_upipe(upipe_stream_switcher);
 
+    struct upipe_stream_switcher_input *upipe_stream_switcher_input =
+        upipe_stream_switcher_input_from_upipe(upipe);
+
     uint64_t dts_orig = 0;
     if (!ubase_check(uref_clock_get_dts_orig(uref, &dts_orig))) {
         upipe_err(upipe, "no dts orig");
         return upipe_stream_switcher_drop(upipe, uref);
     }
+    dts_orig += upipe_stream_switcher_input->shift;
+
+    uint64_t duration;
+    if (ubase_check(uref_clock_get_duration(uref, &duration)))
+        upipe_stream_switcher->last_duration = duration;
+    else if (upipe_stream_switcher->last_dts_orig != UINT64_MAX &&
+             dts_orig > upipe_stream_switcher->last_dts_orig)
+        upipe_stream_switcher->last_duration =
+            dts_orig - upipe_stream_switcher->last_dts_orig;
+    upipe_stream_switcher->last_dts_orig = dts_orig;
+
     if (!upipe_stream_switcher->rebase_timestamp_set) {
         upipe_stream_switcher->rebase_timestamp_set = true;
         upipe_stream_switcher->rebase_timestamp = dts_orig;
@@ -399,16 +440,24 @@ static bool upipe_stream_switcher_wait(struct upipe_stream_switcher *super,
 
     assert(super->waiting == upipe);
 
-    if (upipe_stream_switcher_input->sync)
-        return false;
-
     const char *flow_def;
     if (!ubase_check(uref_flow_get_def(super->flow_def, &flow_def))) {
         upipe_err(upipe, "fail to get flow format");
         return upipe_stream_switcher_drop(upipe, uref);
     }
+    bool key = !strstr(flow_def, ".pic.") || ubase_check(uref_pic_get_key(uref));
+
+    if (upipe_stream_switcher_input->sync) {
+        if (upipe_stream_switcher_input->late && key) {
+            /* only keep the frames since the most recent key frame */
+            struct uref *held;
+            while ((held = upipe_stream_switcher_input_pop_input(upipe)))
+                uref_free(held);
+        }
+        return false;
+    }
 
-    if (strstr(flow_def, ".pic.") && !ubase_check(uref_pic_get_key(uref)))
+    if (!key)
         /* drop if not a key frames */
         return upipe_stream_switcher_drop(upipe, uref);
 
@@ -422,6 +471,19 @@ static bool upipe_stream_switcher_wait(struct upipe_stream_switcher *super,
         }
     }
 
+    if (pts_orig <= super->last_pts_orig && super->selected != NULL &&
+        super->last_pts_orig - pts_orig <= super->prebuffer) {
+        /* late key frame within the pre-buffer, switch on the next frame of
+         * the selected stream and shift the timestamps */
+        upipe_dbg_va(upipe, "pre-buffered key frame %"PRIu64 " <= %"PRIu64,
+                     pts_orig, super->last_pts_orig);
+        super->pts_orig = 0;
+        upipe_stream_switcher_input->late = true;
+        upipe_stream_switcher_input->sync = true;
+        upipe_stream_switcher_input_throw_sync(upipe);
+        return false;
+    }
+
     if (pts_orig <= super->last_pts_orig) {
         /* late frame, drop... */
         upipe_dbg_va(upipe, "late frame %"PRIu64 " <= %"PRIu64,
@@ -471,6 +533,7 @@ static bool upipe_stream_switcher_input_output(struct upipe *upipe,
             }
         }
 
+        pts_orig += upipe_stream_switcher_input_from_upipe(upipe)->shift;
         super->last_pts_orig = pts_orig;
         if (!super->waiting)
             /* no waiting stream, forward */
@@ -574,6 +637,9 @@ static struct upipe *upipe_stream_switcher_alloc(struct upipe_mgr *mgr,
     upipe_stream_switcher->last_pts_orig = 0;
     upipe_stream_switcher->rebase_timestamp_set = false;
     upipe_stream_switcher->rebase_timestamp = 0;
+    upipe_stream_switcher->prebuffer = 0;
+    upipe_stream_switcher->last_dts_orig = UINT64_MAX;
+    upipe_stream_switcher->last_duration = 0;
     urefcount_init(
         upipe_stream_switcher_to_urefcount_real(upipe_stream_switcher),
         upipe_stream_switcher_free);
@@ -650,6 +716,37 @@ static int upipe_stream_switcher_set_flow_def(struct upipe *upipe,
     return UBASE_ERR_NONE;
 }
 
+/** @internal @This sets the maximum pre-buffer duration.
+ *
+ * @param upipe description structure of the pipe
+ * @param duration maximum pre-buffer duration, or 0
+ * @return an error code
+ */
+static int _upipe_stream_switcher_set_prebuffer(struct upipe *upipe,
+                                                uint64_t duration)
+{
+    struct upipe_stream_switcher *upipe_stream_switcher =
+        upipe_stream_switcher_from_upipe(upipe);
+    upipe_stream_switcher->prebuffer = duration;
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This gets the maximum pre-buffer duration.
+ *
+ * @param upipe description structure of the pipe
+ * @param duration_p filled in with the maximum pre-buffer duration
+ * @return an error code
+ */
+static int _upipe_stream_switcher_get_prebuffer(struct upipe *upipe,
+                                                uint64_t *duration_p)
+{
+    struct upipe_stream_switcher *upipe_stream_switcher =
+        upipe_stream_switcher_from_upipe(upipe);
+    if (duration_p)
+        *duration_p = upipe_stream_switcher->prebuffer;
+    return UBASE_ERR_NONE;
+}
+
 /** @internal @This processes control commands on a stream switcher pipe,
  * and checks the status of the pipe afterwards.
  *
@@ -676,6 +773,17 @@ static int upipe_stream_switcher_control(struct upipe *upipe,
     case UPIPE_SET_OUTPUT:
         return upipe_stream_switcher_control_output(upipe, command, args);
 
+    case UPIPE_STREAM_SWITCHER_SET_PREBUFFER: {
+        UBASE_SIGNATURE_CHECK(args, UPIPE_STREAM_SWITCHER_SIGNATURE);
+        uint64_t duration = va_arg(args, uint64_t);
+        return _upipe_stream_switcher_set_prebuffer(upipe, duration);
+    }
+    case UPIPE_STREAM_SWITCHER_GET_PREBUFFER: {
+        UBASE_SIGNATURE_CHECK(args, UPIPE_STREAM_SWITCHER_SIGNATURE);
+        uint64_t *duration_p = va_arg(args, uint64_t *);
+        return _upipe_stream_switcher_get_prebuffer(upipe, duration_p);
+    }
+
     default:
         return UBASE_ERR_UNHANDLED;
     }
@@ -684,6 +792,7 @@ static int upipe_stream_switcher_control(struct upipe *upipe,
 /** module manager static descriptor */
 static struct upipe_mgr upipe_stream_switcher_mgr = {
     .signature = UPIPE_STREAM_SWITCHER_SIGNATURE,
+    .upipe_command_str = upipe_stream_switcher_command_str,
     .upipe_alloc = upipe_stream_switcher_alloc,
     .upipe_control = upipe_stream_switcher_control,
 };
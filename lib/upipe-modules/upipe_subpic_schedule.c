@@ -40,6 +40,18 @@
 #include <upipe/upipe_helper_subpipe.h>
 #include <upipe-modules/upipe_subpic_schedule.h>
 
+#include <stdlib.h>
+
+/** @internal @This is an entry of the heap of pending subpictures. */
+struct upipe_subpic_schedule_entry {
+    /** PTS of the subpicture */
+    uint64_t pts;
+    /** arrival order, to keep the input order of identical PTS */
+    uint64_t seq;
+    /** subpicture */
+    struct uref *uref;
+};
+
 /** upipe_subpic_schedule structure */
 struct upipe_subpic_schedule {
     /** real refcount management structure */
@@ -92,9 +104,18 @@ struct upipe_subpic_schedule_sub {
 
     /** pts + duration of current uref */
     uint64_t pts_end;
-
-    /** buffered urefs */
-    struct uchain urefs;
+    /** date of the last video frame, or UINT64_MAX if new subpictures
+     * arrived since */
+    uint64_t last_date;
+
+    /** binary min-heap of buffered urefs, ordered by PTS */
+    struct upipe_subpic_schedule_entry *heap;
+    /** number of buffered urefs */
+    unsigned int heap_count;
+    /** allocated size of the heap */
+    unsigned int heap_size;
+    /** arrival counter of buffered urefs */
+    uint64_t seq;
 
     /** public upipe structure */
     struct upipe upipe;
@@ -115,6 +136,94 @@ UPIPE_HELPER_SUBPIPE(upipe_subpic_schedule, upipe_subpic_schedule_sub, sub,
 
 UBASE_FROM_TO(upipe_subpic_schedule, urefcount, urefcount_real, urefcount_real)
 
+/** @internal @This compares two entries of the heap.
+ *
+ * @param a first entry
+ * @param b second entry
+ * @return true if a must be output before b
+ */
+static inline bool
+    upipe_subpic_schedule_entry_before(const struct upipe_subpic_schedule_entry *a,
+                                       const struct upipe_subpic_schedule_entry *b)
+{
+    return a->pts < b->pts || (a->pts == b->pts && a->seq < b->seq);
+}
+
+/** @internal @This inserts a subpicture in the heap, in O(log n).
+ *
+ * @param upipe description structure of the pipe
+ * @param uref subpicture
+ * @param pts PTS of the subpicture
+ * @return an error code
+ */
+static int upipe_subpic_schedule_sub_push(struct upipe *upipe,
+                                          struct uref *uref, uint64_t pts)
+{
+    struct upipe_subpic_schedule_sub *upipe_subpic_schedule_sub = upipe_subpic_schedule_sub_from_upipe(upipe);
+    if (unlikely(upipe_subpic_schedule_sub->heap_count ==
+                 upipe_subpic_schedule_sub->heap_size)) {
+        unsigned int size = upipe_subpic_schedule_sub->heap_size ?
+                            upipe_subpic_schedule_sub->heap_size * 2 : 8;
+        struct upipe_subpic_schedule_entry *heap =
+            realloc(upipe_subpic_schedule_sub->heap, size * sizeof(*heap));
+        if (unlikely(heap == NULL))
+            return UBASE_ERR_ALLOC;
+        upipe_subpic_schedule_sub->heap = heap;
+        upipe_subpic_schedule_sub->heap_size = size;
+    }
+
+    struct upipe_subpic_schedule_entry *heap = upipe_subpic_schedule_sub->heap;
+    struct upipe_subpic_schedule_entry entry = {
+        .pts = pts,
+        .seq = upipe_subpic_schedule_sub->seq++,
+        .uref = uref,
+    };
+    unsigned int i = upipe_subpic_schedule_sub->heap_count++;
+    while (i) {
+        unsigned int parent = (i - 1) / 2;
+        if (!upipe_subpic_schedule_entry_before(&entry, &heap[parent]))
+            break;
+        heap[i] = heap[parent];
+        i = parent;
+    }
+    heap[i] = entry;
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This removes the earliest subpicture from the heap, in
+ * O(log n).
+ *
+ * @param upipe description structure of the pipe
+ * @return earliest subpicture
+ */
+static struct uref *upipe_subpic_schedule_sub_pop(struct upipe *upipe)
+{
+    struct upipe_subpic_schedule_sub *upipe_subpic_schedule_sub = upipe_subpic_schedule_sub_from_upipe(upipe);
+    struct upipe_subpic_schedule_entry *heap = upipe_subpic_schedule_sub->heap;
+    assert(upipe_subpic_schedule_sub->heap_count);
+    struct uref *uref = heap[0].uref;
+    unsigned int count = --upipe_subpic_schedule_sub->heap_count;
+    if (!count)
+        return uref;
+
+    struct upipe_subpic_schedule_entry last = heap[count];
+    unsigned int i = 0;
+    for ( ; ; ) {
+        unsigned int child = 2 * i + 1;
+        if (child >= count)
+            break;
+        if (child + 1 < count &&
+            upipe_subpic_schedule_entry_before(&heap[child + 1], &heap[child]))
+            child++;
+        if (!upipe_subpic_schedule_entry_before(&heap[child], &last))
+            break;
+        heap[i] = heap[child];
+        i = child;
+    }
+    heap[i] = last;
+    return uref;
+}
+
 /** @internal @This frees all resources allocated.
  *
  * @param upipe description structure of the pipe
@@ -123,12 +232,9 @@ static void upipe_subpic_schedule_sub_free(struct upipe *upipe)
 {
     upipe_throw_dead(upipe);
     struct upipe_subpic_schedule_sub *upipe_subpic_schedule_sub = upipe_subpic_schedule_sub_from_upipe(upipe);
-    for (;;) {
-        struct uchain *uchain = ulist_pop(&upipe_subpic_schedule_sub->urefs);
-        if (!uchain)
-            break;
-        uref_free(uref_from_uchain(uchain));
-    }
+    while (upipe_subpic_schedule_sub->heap_count)
+        uref_free(upipe_subpic_schedule_sub_pop(upipe));
+    free(upipe_subpic_schedule_sub->heap);
     uref_free(upipe_subpic_schedule_sub->uref);
     upipe_subpic_schedule_sub_clean_urefcount(upipe);
     upipe_subpic_schedule_sub_clean_output(upipe);
@@ -178,7 +284,13 @@ static void upipe_subpic_schedule_sub_input(struct upipe *upipe, struct uref *ur
         return;
     }
 
-    ulist_add(&upipe_subpic_schedule_sub->urefs, &uref->uchain);
+    if (unlikely(!ubase_check(upipe_subpic_schedule_sub_push(upipe, uref,
+                                                             pts)))) {
+        uref_free(uref);
+        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+        return;
+    }
+    upipe_subpic_schedule_sub->last_date = UINT64_MAX;
 }
 
 /** @internal @This allocates a subpic schedule_sub pipe.
@@ -199,7 +311,12 @@ static struct upipe *upipe_subpic_schedule_sub_alloc(struct upipe_mgr *mgr,
 
     struct upipe_subpic_schedule_sub *upipe_subpic_schedule_sub = upipe_subpic_schedule_sub_from_upipe(upipe);
     upipe_subpic_schedule_sub->uref = NULL;
-    ulist_init(&upipe_subpic_schedule_sub->urefs);
+    upipe_subpic_schedule_sub->pts_end = 0;
+    upipe_subpic_schedule_sub->last_date = UINT64_MAX;
+    upipe_subpic_schedule_sub->heap = NULL;
+    upipe_subpic_schedule_sub->heap_count = 0;
+    upipe_subpic_schedule_sub->heap_size = 0;
+    upipe_subpic_schedule_sub->seq = 0;
 
     upipe_subpic_schedule_sub_init_urefcount(upipe);
     upipe_subpic_schedule_sub_init_output(upipe);
@@ -278,6 +395,11 @@ static void upipe_subpic_schedule_sub_handle_subpic(struct upipe *upipe,
     struct upipe_subpic_schedule_sub *upipe_subpic_schedule_sub =
         upipe_subpic_schedule_sub_from_upipe(upipe);
 
+    /* repeated frame: the resolved subpicture is still valid */
+    if (date == upipe_subpic_schedule_sub->last_date)
+        goto output;
+    upipe_subpic_schedule_sub->last_date = date;
+
     struct uref *uref = upipe_subpic_schedule_sub->uref;
     if (uref && upipe_subpic_schedule_sub->pts_end < date) {
         upipe_verbose(upipe, "Subpicture elapsed");
@@ -285,16 +407,12 @@ static void upipe_subpic_schedule_sub_handle_subpic(struct upipe *upipe,
         upipe_subpic_schedule_sub->uref = NULL;
     }
 
-    struct uchain *uchain, *uchain_tmp;
-    ulist_delete_foreach(&upipe_subpic_schedule_sub->urefs, uchain, uchain_tmp) {
-        struct uref *next = uref_from_uchain(uchain);
-
-        uint64_t date_next = 0;
-        uref_clock_get_pts_prog(next, &date_next);
-
+    while (upipe_subpic_schedule_sub->heap_count) {
+        uint64_t date_next = upipe_subpic_schedule_sub->heap[0].pts;
         if (date_next > date) /* The next subpicture is in advance */
             break;
 
+        struct uref *next = upipe_subpic_schedule_sub_pop(upipe);
         uint64_t duration;
         if (unlikely(!ubase_check(uref_clock_get_duration(next, &duration))))
             duration = 0;
@@ -304,10 +422,10 @@ static void upipe_subpic_schedule_sub_handle_subpic(struct upipe *upipe,
                 date_next, upipe_subpic_schedule_sub->pts_end);
 
         uref_free(upipe_subpic_schedule_sub->uref);     /* free previous */
-        ulist_delete(uchain);
         upipe_subpic_schedule_sub->uref = next;
     }
 
+output:
     uref = upipe_subpic_schedule_sub->uref;
     if (uref && uref->ubuf)
         upipe_subpic_schedule_sub_output(upipe, uref_dup(uref), NULL);
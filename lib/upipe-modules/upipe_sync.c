@@ -35,6 +35,7 @@
 #include <upipe/uref_sound.h>
 #include <upipe/uref_pic_flow.h>
 #include <upipe/uclock.h>
+#include <upipe/ubuf_size.h>
 #include <upipe/upipe.h>
 #include <upipe/upump.h>
 #include <upipe/upipe_helper_upipe.h>
@@ -49,6 +50,100 @@
 #include <upipe/upipe_helper_ubuf_mgr.h>
 #include <upipe-modules/upipe_sync.h>
 
+/** capacity of the picture and sound queues (power of 2) */
+#define UPIPE_SYNC_QUEUE_SIZE 64
+
+/** @internal @This is a fixed-capacity queue of urefs. */
+struct upipe_sync_queue {
+    /** buffered urefs */
+    struct uref *urefs[UPIPE_SYNC_QUEUE_SIZE];
+    /** index of the first uref */
+    unsigned int start;
+    /** number of buffered urefs */
+    unsigned int count;
+};
+
+/** @internal @This initializes a queue.
+ *
+ * @param queue pointer to queue
+ */
+static void upipe_sync_queue_init(struct upipe_sync_queue *queue)
+{
+    queue->start = 0;
+    queue->count = 0;
+}
+
+/** @internal @This returns the first uref of a queue without dequeuing it.
+ *
+ * @param queue pointer to queue
+ * @return pointer to uref, or NULL if the queue is empty
+ */
+static struct uref *upipe_sync_queue_peek(struct upipe_sync_queue *queue)
+{
+    return queue->count ? queue->urefs[queue->start] : NULL;
+}
+
+/** @internal @This dequeues the first uref of a queue.
+ *
+ * @param queue pointer to queue
+ * @return pointer to uref, or NULL if the queue is empty
+ */
+static struct uref *upipe_sync_queue_pop(struct upipe_sync_queue *queue)
+{
+    if (!queue->count)
+        return NULL;
+    struct uref *uref = queue->urefs[queue->start];
+    queue->start = (queue->start + 1) & (UPIPE_SYNC_QUEUE_SIZE - 1);
+    queue->count--;
+    return uref;
+}
+
+/** @internal @This appends a uref to a queue.
+ *
+ * @param queue pointer to queue
+ * @param uref uref to append
+ * @return false if the queue is full
+ */
+static bool upipe_sync_queue_push(struct upipe_sync_queue *queue,
+                                  struct uref *uref)
+{
+    if (queue->count == UPIPE_SYNC_QUEUE_SIZE)
+        return false;
+    queue->urefs[(queue->start + queue->count) &
+                 (UPIPE_SYNC_QUEUE_SIZE - 1)] = uref;
+    queue->count++;
+    return true;
+}
+
+/** @internal @This returns the number of octets buffered in a queue.
+ *
+ * @param queue pointer to queue
+ * @return number of octets
+ */
+static uint64_t upipe_sync_queue_bytes(struct upipe_sync_queue *queue)
+{
+    uint64_t bytes = 0;
+    for (unsigned int i = 0; i < queue->count; i++) {
+        struct uref *uref = queue->urefs[(queue->start + i) &
+                                         (UPIPE_SYNC_QUEUE_SIZE - 1)];
+        size_t size;
+        if (uref->ubuf != NULL && ubase_check(ubuf_size(uref->ubuf, &size)))
+            bytes += size;
+    }
+    return bytes;
+}
+
+/** @internal @This frees all the urefs of a queue.
+ *
+ * @param queue pointer to queue
+ */
+static void upipe_sync_queue_flush(struct upipe_sync_queue *queue)
+{
+    struct uref *uref;
+    while ((uref = upipe_sync_queue_pop(queue)) != NULL)
+        uref_free(uref);
+}
+
 /** upipe_sync structure */
 struct upipe_sync {
     /** refcount management structure */
@@ -72,8 +167,8 @@ struct upipe_sync {
     uint64_t latency;
     uint64_t pts;
 
-    /** linked list of buffered pics */
-    struct uchain urefs;
+    /** queue of buffered pics */
+    struct upipe_sync_queue urefs;
 
     /* fps */
     struct urational fps;
@@ -156,11 +251,14 @@ struct upipe_sync_sub {
     /** channels */
     uint8_t channels;
 
-    /** linked list of buffered urefs */
-    struct uchain urefs;
+    /** queue of buffered urefs */
+    struct upipe_sync_queue urefs;
 
     /** buffered duration */
     uint64_t samples;
+
+    /** cleared sound frame, shared by all the gaps */
+    struct uref *silence;
 };
 
 /** @hidden */
@@ -198,8 +296,9 @@ static struct upipe *upipe_sync_sub_alloc(struct upipe_mgr *mgr,
         return NULL;
 
     struct upipe_sync_sub *upipe_sync_sub = upipe_sync_sub_from_upipe(upipe);
-    ulist_init(&upipe_sync_sub->urefs);
+    upipe_sync_queue_init(&upipe_sync_sub->urefs);
     upipe_sync_sub->samples = 0;
+    upipe_sync_sub->silence = NULL;
     upipe_sync_sub->sound = false;
     upipe_sync_sub->s337 = false;
     upipe_sync_sub->a52 = false;
@@ -369,6 +468,10 @@ static int upipe_sync_sub_set_flow_def(struct upipe *upipe, struct uref *flow_de
 
     upipe_sync_sub->sound = true;
 
+    /* the format may have changed */
+    uref_free(upipe_sync_sub->silence);
+    upipe_sync_sub->silence = NULL;
+
     upipe_sync_sub_store_flow_def(upipe, flow_def);
 
     return UBASE_ERR_NONE;
@@ -384,6 +487,20 @@ static int upipe_sync_sub_set_flow_def(struct upipe *upipe, struct uref *flow_de
 static int upipe_sync_sub_control(struct upipe *upipe, int command, va_list args)
 {
     switch (command) {
+        case UPIPE_GET_OCCUPANCY: {
+            struct upipe_sync_sub *upipe_sync_sub =
+                upipe_sync_sub_from_upipe(upipe);
+            struct upipe_occupancy *occupancy =
+                va_arg(args, struct upipe_occupancy *);
+            occupancy->urefs = upipe_sync_sub->urefs.count;
+            occupancy->max_urefs = UPIPE_SYNC_QUEUE_SIZE;
+            occupancy->bytes = upipe_sync_queue_bytes(&upipe_sync_sub->urefs);
+            if (upipe_sync_sub->sound)
+                occupancy->duration =
+                    UCLOCK_FREQ * upipe_sync_sub->samples / 48000;
+            return UBASE_ERR_NONE;
+        }
+
         case UPIPE_REGISTER_REQUEST: {
             struct urequest *request = va_arg(args, struct urequest *);
             return upipe_sync_sub_alloc_output_proxy(upipe, request);
@@ -432,10 +549,10 @@ static bool sync_channel(struct upipe *upipe)
     const bool s337 = upipe_sync_sub->s337;
     const bool a52 = upipe_sync_sub->a52;
 
-    struct uchain *uchain_uref = NULL, *uchain_tmp;
-    ulist_delete_foreach(&upipe_sync_sub->urefs, uchain_uref, uchain_tmp) {
-        struct uref *uref = uref_from_uchain(uchain_uref);
-
+    /* urefs are in presentation order, so only the first ones may be too
+     * early */
+    struct uref *uref;
+    while ((uref = upipe_sync_queue_peek(&upipe_sync_sub->urefs)) != NULL) {
         uint64_t pts = 0;
         uref_clock_get_pts_sys(uref, &pts);
         pts += upipe_sync->latency;
@@ -448,43 +565,46 @@ static bool sync_channel(struct upipe *upipe)
             pts_diff = 0;
         }
 
-        if (pts_diff > 0) { /* audio too early, drop */
-            size_t samples = 0;
-            uref_sound_size(uref, &samples, NULL);
-            uint64_t duration = UCLOCK_FREQ * samples / 48000;
-            if (pts_diff < duration) {
-                uint64_t drop_samples = pts_diff * 48000 / UCLOCK_FREQ;
-                if (drop_samples >= samples) {
-                    upipe_notice_va(upipe_sync_sub_to_upipe(upipe_sync_sub),
-                            "LOLDROP, duration in CLOCK %" PRIu64 "", duration);
-                    ulist_delete(uchain_uref);
-                    uref_free(uref);
-                    continue;
-                }
-                if (!s337 || a52) {
-                    // resize
-                    upipe_notice_va(upipe_sync_sub_to_upipe(upipe_sync_sub),
-                            "RESIZE, skip %" PRIu64 " (%" PRId64 " < %" PRIu64 ")",
-                            drop_samples, pts_diff, duration);
-                    if (a52) /* drop from the end (padding) */
-                        uref_sound_resize(uref, 0, samples - drop_samples);
-                    else
-                        uref_sound_resize(uref, drop_samples, -1);
-                    upipe_sync_sub->samples -= drop_samples;
-                    pts += pts_diff;
-                    pts -= upipe_sync->latency;
-                    uref_clock_set_pts_sys(uref, pts);
-                }
-            } else {
-                float f = (float)((int64_t)pts - (int64_t)video_pts) * 1000 / UCLOCK_FREQ;
+        if (pts_diff <= 0)
+            break;
+
+        /* audio too early, drop */
+        size_t samples = 0;
+        uref_sound_size(uref, &samples, NULL);
+        uint64_t duration = UCLOCK_FREQ * samples / 48000;
+        if (pts_diff < duration) {
+            uint64_t drop_samples = pts_diff * 48000 / UCLOCK_FREQ;
+            if (drop_samples >= samples) {
                 upipe_notice_va(upipe_sync_sub_to_upipe(upipe_sync_sub),
-                        "DROP %.2f, duration in CLOCK %" PRIu64 "", f, duration);
-                ulist_delete(uchain_uref);
+                        "LOLDROP, duration in CLOCK %" PRIu64 "", duration);
+                upipe_sync_queue_pop(&upipe_sync_sub->urefs);
                 uref_free(uref);
                 upipe_sync_sub->samples -= samples;
                 continue;
             }
+            if (!s337 || a52) {
+                // resize
+                upipe_notice_va(upipe_sync_sub_to_upipe(upipe_sync_sub),
+                        "RESIZE, skip %" PRIu64 " (%" PRId64 " < %" PRIu64 ")",
+                        drop_samples, pts_diff, duration);
+                if (a52) /* drop from the end (padding) */
+                    uref_sound_resize(uref, 0, samples - drop_samples);
+                else
+                    uref_sound_resize(uref, drop_samples, -1);
+                upipe_sync_sub->samples -= drop_samples;
+                pts += pts_diff;
+                pts -= upipe_sync->latency;
+                uref_clock_set_pts_sys(uref, pts);
+            }
+            break;
         }
+
+        float f = (float)((int64_t)pts - (int64_t)video_pts) * 1000 / UCLOCK_FREQ;
+        upipe_notice_va(upipe_sync_sub_to_upipe(upipe_sync_sub),
+                "DROP %.2f, duration in CLOCK %" PRIu64 "", f, duration);
+        upipe_sync_queue_pop(&upipe_sync_sub->urefs);
+        uref_free(uref);
+        upipe_sync_sub->samples -= samples;
     }
 
     if (upipe_sync_sub->samples < 48000 * fps->den / fps->num)
@@ -555,6 +675,13 @@ static struct uref *upipe_sync_get_cached_compressed_audio(struct upipe *upipe)
     return uref_dup(upipe_sync_sub->uref);
 }
 
+/** @internal @This returns a cleared sound frame. The frame is allocated and
+ * cleared once, and then shared by all the gaps of the subpipe.
+ *
+ * @param upipe description structure of the subpipe
+ * @param samples number of samples
+ * @return pointer to uref, or NULL in case of error
+ */
 static struct uref *get_silence(struct upipe *upipe, size_t samples)
 {
     struct upipe_sync_sub *upipe_sync_sub = upipe_sync_sub_from_upipe(upipe);
@@ -562,22 +689,37 @@ static struct uref *get_silence(struct upipe *upipe, size_t samples)
     if (!upipe_sync_sub->uref_mgr || !upipe_sync_sub->ubuf_mgr)
         return NULL;
 
-    struct uref *uref = uref_sound_alloc(upipe_sync_sub->uref_mgr,
-            upipe_sync_sub->ubuf_mgr, samples);
+    size_t size = 0;
+    if (upipe_sync_sub->silence)
+        uref_sound_size(upipe_sync_sub->silence, &size, NULL);
+
+    if (size < samples) {
+        /* leave room for the longest frame of NTSC sequences */
+        size = samples + 1;
+        uref_free(upipe_sync_sub->silence);
+        upipe_sync_sub->silence = uref_sound_alloc(upipe_sync_sub->uref_mgr,
+                upipe_sync_sub->ubuf_mgr, size);
+        if (!upipe_sync_sub->silence)
+            return NULL;
+
+        int32_t *buf;
+        if (!ubase_check(uref_sound_write_int32_t(upipe_sync_sub->silence,
+                                                  0, -1, &buf, 1))) {
+            upipe_err_va(upipe, "Could not map uref");
+            uref_free(upipe_sync_sub->silence);
+            upipe_sync_sub->silence = NULL;
+            return NULL;
+        }
 
-    if (!uref)
-        return NULL;
+        memset(buf, 0, size * sizeof(int32_t) * upipe_sync_sub->channels);
 
-    int32_t *buf;
-    if (!ubase_check(uref_sound_write_int32_t(uref, 0, -1, &buf, 1))) {
-        upipe_err_va(upipe, "Could not map uref");
-        return uref;
+        uref_sound_unmap(upipe_sync_sub->silence, 0, -1, 1);
     }
 
-    memset(buf, 0, samples * sizeof(int32_t) * upipe_sync_sub->channels);
-
-    uref_sound_unmap(uref, 0, -1, 1);
-
+    struct uref *uref = uref_dup(upipe_sync_sub->silence);
+    if (!uref)
+        return NULL;
+    uref_sound_resize(uref, 0, samples);
     return uref;
 }
 
@@ -601,16 +743,14 @@ static void output_sound(struct upipe *upipe, const struct urational *fps,
         const bool a52 = upipe_sync_sub->a52;
 
         if (s337 && !a52) {
-            struct uref *uref = NULL;
-            struct uchain *uchain = ulist_peek(&upipe_sync_sub->urefs);
-            if (!uchain) {
+            struct uref *uref = upipe_sync_queue_peek(&upipe_sync_sub->urefs);
+            if (!uref) {
                 upipe_err_va(upipe_sub, "no urefs");
 
                 uref = upipe_sync_get_cached_compressed_audio(upipe_sub);
                 if (!uref)
                     continue;
             } else {
-                uref = uref_from_uchain(uchain);
 
                 uint64_t pts = 0;
                 uref_clock_get_pts_sys(uref, &pts);
@@ -624,7 +764,7 @@ static void output_sound(struct upipe *upipe, const struct urational *fps,
                     if (!uref)
                         continue;
                 } else {
-                    ulist_pop(&upipe_sync_sub->urefs);
+                    upipe_sync_queue_pop(&upipe_sync_sub->urefs);
                     upipe_sync_sub->missed_compressed_audio_e = 0;
                     /* cache uref */
                     uref_free(upipe_sync_sub->uref);
@@ -654,14 +794,15 @@ static void output_sound(struct upipe *upipe, const struct urational *fps,
         }
 
         /* look at first uref without dequeuing */
-        struct uref *src = uref_from_uchain(ulist_peek(&upipe_sync_sub->urefs));
+        struct uref *src = upipe_sync_queue_peek(&upipe_sync_sub->urefs);
         if (!src) {
-            src = get_silence(upipe_sub, samples);
-            if (src)
-                uref_clock_set_pts_sys(src, upipe_sync->pts - upipe_sync->latency);
-        }
-        if (!src) {
-            upipe_dbg_va(upipe_sub, "no urefs");
+            struct uref *uref = get_silence(upipe_sub, samples);
+            if (!uref) {
+                upipe_dbg_va(upipe_sub, "no urefs");
+                continue;
+            }
+            uref_clock_set_pts_sys(uref, upipe_sync->pts - upipe_sync->latency);
+            upipe_sync_sub_output(upipe_sub, uref, upump_p);
             continue;
         }
 
@@ -673,62 +814,89 @@ static void output_sound(struct upipe *upipe, const struct urational *fps,
             continue;
         }
 
-        /* output */
-        struct uref *uref = uref_dup_inner(src);
-        if (!uref)
-            upipe_err_va(upipe_sub, "Could not allocate ubuf");
-        uref->ubuf = ubuf_sound_alloc(src->ubuf->mgr, samples);
-        if (!uref->ubuf)
-            upipe_err_va(upipe_sub, "Could not allocate ubuf");
-        int32_t *dst_buf;
-        if (!ubase_check(uref_sound_write_int32_t(uref, 0, -1, &dst_buf, 1))) {
-            upipe_err_va(upipe_sub, "Could not map dst");
-        }
-        // map
+        size_t src_samples = 0;
+        uref_sound_size(src, &src_samples, NULL);
+
+        struct uref *uref;
+        if (src_samples == samples) {
+            /* output the buffer as is */
+            uref = upipe_sync_queue_pop(&upipe_sync_sub->urefs);
+            upipe_sync_sub->samples -= samples;
+        } else if (src_samples > samples) {
+            /* output the beginning of the buffer, without copying */
+            uref = uref_dup(src);
+            if (!uref) {
+                upipe_err_va(upipe_sub, "Could not allocate uref");
+                continue;
+            }
+            uref_sound_resize(uref, 0, samples);
+            uref_sound_resize(src, samples, -1);
+            pts += samples * UCLOCK_FREQ / 48000;
+            uref_clock_set_pts_sys(src, pts);
+            upipe_sync_sub->samples -= samples;
+        } else {
+            /* gather several buffers */
+            uref = uref_dup_inner(src);
+            if (!uref) {
+                upipe_err_va(upipe_sub, "Could not allocate uref");
+                continue;
+            }
+            uref->ubuf = ubuf_sound_alloc(src->ubuf->mgr, samples);
+            if (!uref->ubuf) {
+                upipe_err_va(upipe_sub, "Could not allocate ubuf");
+                uref_free(uref);
+                continue;
+            }
+            int32_t *dst_buf;
+            if (!ubase_check(uref_sound_write_int32_t(uref, 0, -1, &dst_buf, 1))) {
+                upipe_err_va(upipe_sub, "Could not map dst");
+                uref_free(uref);
+                continue;
+            }
 
-        while (samples) {
-            const int32_t *src_buf;
-            size_t src_samples = 0;
-            uref_sound_size(src, &src_samples, NULL);
+            while (samples && src) {
+                const int32_t *src_buf;
+                src_samples = 0;
+                uref_sound_size(src, &src_samples, NULL);
 
-            if (!ubase_check(uref_sound_read_int32_t(src, 0, src_samples, &src_buf, 1))) {
-                upipe_err_va(upipe_sub, "Could not map src");
-            }
+                if (!ubase_check(uref_sound_read_int32_t(src, 0, src_samples, &src_buf, 1))) {
+                    upipe_err_va(upipe_sub, "Could not map src");
+                    break;
+                }
 
-            size_t uref_samples = src_samples;
-            if (uref_samples > samples) {
-                uref_samples = samples;
-            }
+                size_t uref_samples = src_samples;
+                if (uref_samples > samples) {
+                    uref_samples = samples;
+                }
 
-            memcpy(dst_buf, src_buf, channels * sizeof(int32_t) * uref_samples);
-            dst_buf += channels * uref_samples;
+                memcpy(dst_buf, src_buf, channels * sizeof(int32_t) * uref_samples);
+                dst_buf += channels * uref_samples;
 
-            uref_sound_unmap(src, 0, -1, 1);
+                uref_sound_unmap(src, 0, -1, 1);
 
-            src_samples -= uref_samples;
-            samples -= uref_samples;
-            upipe_sync_sub->samples -= uref_samples;
-            //upipe_notice_va(upipe_sub, "pop, samples %" PRIu64, upipe_sync_sub->samples);
+                src_samples -= uref_samples;
+                samples -= uref_samples;
+                upipe_sync_sub->samples -= uref_samples;
 
-            if (src_samples == 0) {
-                ulist_pop(&upipe_sync_sub->urefs);
-                uref_free(src);
-                src = uref_from_uchain(ulist_peek(&upipe_sync_sub->urefs));
-                if (!src)
-                    break;
-            } else {
-                uref_sound_resize(src, uref_samples, -1);
-                assert(samples == 0);
+                if (src_samples == 0) {
+                    uref_free(upipe_sync_queue_pop(&upipe_sync_sub->urefs));
+                    src = upipe_sync_queue_peek(&upipe_sync_sub->urefs);
+                } else {
+                    uref_sound_resize(src, uref_samples, -1);
+                    assert(samples == 0);
 
-                uref_clock_get_pts_sys(src, &pts);
-                pts += uref_samples * UCLOCK_FREQ / 48000;
-                uref_clock_set_pts_sys(src, pts);
+                    uref_clock_get_pts_sys(src, &pts);
+                    pts += uref_samples * UCLOCK_FREQ / 48000;
+                    uref_clock_set_pts_sys(src, pts);
+                }
             }
 
-            // TODO : next uref
+            /* not enough samples buffered */
+            memset(dst_buf, 0, channels * sizeof(int32_t) * samples);
+
+            uref_sound_unmap(uref, 0, -1, 1);
         }
 
-        uref_sound_unmap(uref, 0, -1, 1);
         uref_clock_set_pts_sys(uref, upipe_sync->pts - upipe_sync->latency);
         upipe_sync_sub_output(upipe_sub, uref, upump_p);
     }
@@ -745,17 +913,16 @@ static void cb(struct upump *upump)
         (int64_t)((int64_t)now - (int64_t)upipe_sync->pts) / 27000);
 
     now = upipe_sync->pts; // the upump was scheduled for now
-    struct uchain *uchain = NULL;
+    struct uref *pic = NULL;
     for (;;) {
-        uchain = ulist_peek(&upipe_sync->urefs);
-        if (!uchain) {
+        pic = upipe_sync_queue_peek(&upipe_sync->urefs);
+        if (!pic) {
             upipe_err_va(upipe, "no pictures");
             break;
         }
 
-        struct uref *uref = uref_from_uchain(uchain);
         uint64_t pts = 0;
-        uref_clock_get_pts_sys(uref, &pts);
+        uref_clock_get_pts_sys(pic, &pts);
         pts += upipe_sync->latency;
 
         /* frame duration */
@@ -768,14 +935,14 @@ static void cb(struct upump *upump)
             upipe_warn_va(upipe, "video too early: %.2f > %.2f",
                 pts_to_time(pts), pts_to_time(now + ticks / 2)
             );
-            uchain = NULL; /* do not drop */
+            pic = NULL; /* do not drop */
             break;
         } else {
             break; // ok
         }
 
-        ulist_pop(&upipe_sync->urefs);
-        uref_free(uref);
+        upipe_sync_queue_pop(&upipe_sync->urefs);
+        uref_free(pic);
         int64_t u = pts - now;
         upipe_err_va(upipe, "Drop pic (pts-now == %" PRId64 "ms)", u / 27000);
     }
@@ -789,11 +956,11 @@ static void cb(struct upump *upump)
     output_sound(upipe_sync_to_upipe(upipe_sync), &upipe_sync->fps, NULL);
 
     /* output pic */
-    if (uchain) {
-        ulist_pop(&upipe_sync->urefs);
+    if (pic) {
+        upipe_sync_queue_pop(&upipe_sync->urefs);
         /* buffer picture */
         uref_free(upipe_sync->uref);
-        upipe_sync->uref = uref_from_uchain(uchain);
+        upipe_sync->uref = pic;
     } else {
         upipe_dbg_va(upipe, "no picture, repeating last one");
     }
@@ -866,7 +1033,15 @@ static void upipe_sync_sub_input(struct upipe *upipe, struct uref *uref,
     upipe_sync_sub->samples += samples;
     //upipe_notice_va(upipe, "push, samples %" PRIu64, upipe_sync_sub->samples);
 
-    ulist_add(&upipe_sync_sub->urefs, uref_to_uchain(uref));
+    if (!upipe_sync_queue_push(&upipe_sync_sub->urefs, uref)) {
+        struct uref *old = upipe_sync_queue_pop(&upipe_sync_sub->urefs);
+        size_t old_samples = 0;
+        uref_sound_size(old, &old_samples, NULL);
+        upipe_sync_sub->samples -= old_samples;
+        upipe_warn(upipe, "queue full, dropping oldest sound");
+        uref_free(old);
+        upipe_sync_queue_push(&upipe_sync_sub->urefs, uref);
+    }
 }
 
 /** @internal @This initializes the output manager for a dup set pipe.
@@ -920,7 +1095,11 @@ static void upipe_sync_input(struct upipe *upipe, struct uref *uref,
     //upipe_dbg_va(upipe, "push PTS in %" PRIu64 " ms", (pts - now) / 27000);
 
     /* buffer pic */
-    ulist_add(&upipe_sync->urefs, uref_to_uchain(uref));
+    if (!upipe_sync_queue_push(&upipe_sync->urefs, uref)) {
+        upipe_warn(upipe, "queue full, dropping oldest picture");
+        uref_free(upipe_sync_queue_pop(&upipe_sync->urefs));
+        upipe_sync_queue_push(&upipe_sync->urefs, uref);
+    }
 
 
     /* timer already active */
@@ -959,7 +1138,7 @@ static struct upipe *upipe_sync_alloc(struct upipe_mgr *mgr,
     upipe_sync->ticks_per_frame = 0;
     upipe_sync->frame_idx = 0;
     upipe_sync->uref = NULL;
-    ulist_init(&upipe_sync->urefs);
+    upipe_sync_queue_init(&upipe_sync->urefs);
 
     upipe_sync_init_urefcount(upipe);
     upipe_sync_init_uclock(upipe);
@@ -1033,6 +1212,19 @@ static int upipe_sync_set_flow_def(struct upipe *upipe, struct uref *flow_def)
 static int upipe_sync_control(struct upipe *upipe, int command, va_list args)
 {
     switch (command) {
+        case UPIPE_GET_OCCUPANCY: {
+            struct upipe_sync *upipe_sync = upipe_sync_from_upipe(upipe);
+            struct upipe_occupancy *occupancy =
+                va_arg(args, struct upipe_occupancy *);
+            occupancy->urefs = upipe_sync->urefs.count;
+            occupancy->max_urefs = UPIPE_SYNC_QUEUE_SIZE;
+            occupancy->bytes = upipe_sync_queue_bytes(&upipe_sync->urefs);
+            if (upipe_sync->fps.num)
+                occupancy->duration = occupancy->urefs * UCLOCK_FREQ *
+                    upipe_sync->fps.den / upipe_sync->fps.num;
+            return UBASE_ERR_NONE;
+        }
+
         case UPIPE_GET_OUTPUT: {
             struct upipe **p = va_arg(args, struct upipe **);
             return upipe_sync_get_output(upipe, p);
@@ -1077,16 +1269,6 @@ static int upipe_sync_control(struct upipe *upipe, int command, va_list args)
     }
 }
 
-static void ulist_uref_flush(struct uchain *ulist)
-{
-    for (;;) {
-        struct uchain *uchain = ulist_pop(ulist);
-        if (!uchain)
-            break;
-        uref_free(uref_from_uchain(uchain));
-    }
-}
-
 /** @internal @This frees all resources allocated.
  *
  * @param upipe description structure of the pipe
@@ -1097,7 +1279,7 @@ static void upipe_sync_free(struct upipe *upipe)
 
     upipe_throw_dead(upipe);
 
-    ulist_uref_flush(&upipe_sync->urefs);
+    upipe_sync_queue_flush(&upipe_sync->urefs);
     uref_free(upipe_sync->uref);
 
     upipe_sync_clean_urefcount(upipe);
@@ -1118,8 +1300,9 @@ static void upipe_sync_sub_free(struct upipe *upipe)
     struct upipe_sync_sub *upipe_sync_sub = upipe_sync_sub_from_upipe(upipe);
     upipe_throw_dead(upipe);
 
-    ulist_uref_flush(&upipe_sync_sub->urefs);
+    upipe_sync_queue_flush(&upipe_sync_sub->urefs);
     uref_free(upipe_sync_sub->uref);
+    uref_free(upipe_sync_sub->silence);
 
     upipe_sync_sub_clean_urefcount(upipe);
     upipe_sync_sub_clean_output(upipe);
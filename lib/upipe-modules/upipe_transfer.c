@@ -54,6 +54,9 @@
 #include <math.h>
 #include <assert.h>
 
+/** maximum number of messages pushed to or popped from a queue at once */
+#define UPIPE_XFER_BATCH 16
+
 /** @internal @This is the private context of a xfer pipe manager. */
 struct upipe_xfer_mgr {
     /** real refcount management structure */
@@ -74,6 +77,14 @@ struct upipe_xfer_mgr {
     struct uqueue uqueue;
     /** pool of @ref upipe_xfer_msg */
     struct ulifo msg_pool;
+    /** preallocated messages */
+    struct upipe_xfer_msg *msgs;
+    /** number of nested batches */
+    unsigned int batch_depth;
+    /** number of messages in the pending batch */
+    unsigned int batch_nb;
+    /** messages of the pending batch */
+    void *batch[UPIPE_XFER_BATCH];
     /** extra data for the queue and pool structures */
     uint8_t extra[];
 };
@@ -140,24 +151,18 @@ struct upipe_xfer_msg {
 
 UBASE_FROM_TO(upipe_xfer_msg, uchain, uchain, uchain)
 
-/** @This allocates and initializes a message structure.
+/** @This allocates a message structure from the preallocated pool.
  *
  * @param mgr xfer_mgr structure
- * @return pointer to upipe_xfer_msg or NULL in case of allocation error
+ * @return pointer to upipe_xfer_msg or NULL if the pool is exhausted
  */
 static struct upipe_xfer_msg *upipe_xfer_msg_alloc(struct upipe_mgr *mgr)
 {
     struct upipe_xfer_mgr *xfer_mgr = upipe_xfer_mgr_from_upipe_mgr(mgr);
-    struct upipe_xfer_msg *msg = ulifo_pop(&xfer_mgr->msg_pool,
-                                           struct upipe_xfer_msg *);
-    if (unlikely(msg == NULL))
-        msg = malloc(sizeof(struct upipe_xfer_msg));
-    if (unlikely(msg == NULL))
-        return NULL;
-    return msg;
+    return ulifo_pop(&xfer_mgr->msg_pool, struct upipe_xfer_msg *);
 }
 
-/** @This frees a message structure.
+/** @This returns a message structure to the pool.
  *
  * @param mgr xfer_mgr structure
  * @param msg message structure to free
@@ -166,8 +171,29 @@ static void upipe_xfer_msg_free(struct upipe_mgr *mgr,
                                 struct upipe_xfer_msg *msg)
 {
     struct upipe_xfer_mgr *xfer_mgr = upipe_xfer_mgr_from_upipe_mgr(mgr);
-    if (unlikely(!ulifo_push(&xfer_mgr->msg_pool, msg)))
-        free(msg);
+    /* the pool is large enough for all preallocated messages */
+    ulifo_push(&xfer_mgr->msg_pool, msg);
+}
+
+/** @This frees a message which couldn't be sent, along with its argument.
+ *
+ * @param mgr xfer_mgr structure
+ * @param msg message structure to drop
+ */
+static void upipe_xfer_msg_drop(struct upipe_mgr *mgr,
+                                struct upipe_xfer_msg *msg)
+{
+    switch (msg->type) {
+        case UPIPE_XFER_SET_URI:
+            free(msg->arg.string);
+            break;
+        case UPIPE_XFER_SET_OUTPUT:
+            upipe_release(msg->arg.pipe);
+            break;
+        default:
+            break;
+    }
+    upipe_xfer_msg_free(mgr, msg);
 }
 
 /** @internal @This is the private context of a xfer pipe. */
@@ -364,6 +390,40 @@ upipe_xfer_alloc_err:
     return NULL;
 }
 
+/** @This handles a probe received from remote, in the local upump manager.
+ *
+ * @param upipe description structure of the pipe
+ * @param msg message received
+ */
+static void upipe_xfer_handle(struct upipe *upipe, struct upipe_xfer_msg *msg)
+{
+    struct upipe_xfer *upipe_xfer = upipe_xfer_from_upipe(upipe);
+    switch (msg->type) {
+        case UPROBE_DEAD:
+            urefcount_release(upipe_xfer_to_urefcount_real(upipe_xfer));
+            break;
+        case UPROBE_XFER_VOID:
+            if (upipe_xfer->upipe_remote == msg->upipe_remote)
+                upipe_throw(upipe, msg->arg.event);
+            break;
+        case UPROBE_XFER_UINT64_T:
+            if (upipe_xfer->upipe_remote == msg->upipe_remote)
+                upipe_throw(upipe, msg->arg.event, msg->event_arg.u64);
+            break;
+        case UPROBE_XFER_UNSIGNED_LONG_LOCAL:
+            if (upipe_xfer->upipe_remote == msg->upipe_remote)
+                upipe_throw(upipe, msg->arg.event, msg->event_signature,
+                            msg->event_arg.ulong);
+            break;
+        default:
+            /* this should not happen */
+            break;
+    }
+
+    upipe_xfer_msg_free(upipe->mgr, msg);
+    urefcount_release(upipe_xfer_to_urefcount_real(upipe_xfer));
+}
+
 /** @This is called by the local upump manager to receive probes from remote.
  *
  * @param upump description structure of the read watcher
@@ -372,34 +432,12 @@ static void upipe_xfer_worker(struct upump *upump)
 {
     struct upipe *upipe = upump_get_opaque(upump, struct upipe *);
     struct upipe_xfer *upipe_xfer = upipe_xfer_from_upipe(upipe);
-    struct upipe_xfer_msg *msg;
-    while ((msg = uqueue_pop(&upipe_xfer->uqueue,
-                             struct upipe_xfer_msg *)) != NULL) {
-        switch (msg->type) {
-            case UPROBE_DEAD:
-                urefcount_release(upipe_xfer_to_urefcount_real(upipe_xfer));
-                break;
-            case UPROBE_XFER_VOID:
-                if (upipe_xfer->upipe_remote == msg->upipe_remote)
-                    upipe_throw(upipe, msg->arg.event);
-                break;
-            case UPROBE_XFER_UINT64_T:
-                if (upipe_xfer->upipe_remote == msg->upipe_remote)
-                    upipe_throw(upipe, msg->arg.event, msg->event_arg.u64);
-                break;
-            case UPROBE_XFER_UNSIGNED_LONG_LOCAL:
-                if (upipe_xfer->upipe_remote == msg->upipe_remote)
-                    upipe_throw(upipe, msg->arg.event, msg->event_signature,
-                                msg->event_arg.ulong);
-                break;
-            default:
-                /* this should not happen */
-                break;
-        }
-
-        upipe_xfer_msg_free(upipe->mgr, msg);
-        urefcount_release(upipe_xfer_to_urefcount_real(upipe_xfer));
-    }
+    void *msgs[UPIPE_XFER_BATCH];
+    unsigned int nb;
+    while ((nb = uqueue_pop_batch(&upipe_xfer->uqueue, msgs,
+                                  UPIPE_XFER_BATCH)) > 0)
+        for (unsigned int i = 0; i < nb; i++)
+            upipe_xfer_handle(upipe, msgs[i]);
 }
 
 /** @This processes control commands.
@@ -451,6 +489,18 @@ static int upipe_xfer_control(struct upipe *upipe, int command, va_list args)
                                        upipe_xfer->upipe_remote, arg);
         }
 
+        case UPIPE_GET_OCCUPANCY: {
+            /* commands of all the pipes of the manager, not yet handled by
+             * the remote thread */
+            struct upipe_xfer_mgr *xfer_mgr =
+                upipe_xfer_mgr_from_upipe_mgr(upipe->mgr);
+            struct upipe_occupancy *occupancy =
+                va_arg(args, struct upipe_occupancy *);
+            occupancy->urefs = uqueue_length(&xfer_mgr->uqueue) +
+                               xfer_mgr->batch_nb;
+            occupancy->max_urefs = xfer_mgr->queue_length;
+            return UBASE_ERR_NONE;
+        }
         case UPIPE_XFER_GET_REMOTE: {
             UBASE_SIGNATURE_CHECK(args, UPIPE_XFER_SIGNATURE)
             struct upipe_xfer *upipe_xfer = upipe_xfer_from_upipe(upipe);
@@ -499,21 +549,6 @@ static void upipe_xfer_no_ref(struct upipe *upipe)
         upipe_throw_fatal(upipe, UBASE_ERR_UPUMP);
 }
 
-/** @This instructs an existing manager to release all structures
- * currently kept in pools. It is intended as a debug tool only.
- *
- * @param mgr pointer to a upipe manager
- */
-static void upipe_xfer_mgr_vacuum(struct upipe_mgr *mgr)
-{
-    struct upipe_xfer_mgr *xfer_mgr = upipe_xfer_mgr_from_upipe_mgr(mgr);
-    struct upipe_xfer_msg *msg;
-
-    while ((msg = ulifo_pop(&xfer_mgr->msg_pool,
-                            struct upipe_xfer_msg *)) != NULL)
-        free(msg);
-}
-
 /** @internal @This frees a upipe manager.
  *
  * @param mgr pointer to a upipe manager
@@ -526,7 +561,8 @@ static void upipe_xfer_mgr_free(struct upipe_mgr *mgr)
     upump_mgr_release(xfer_mgr->upump_mgr);
     uqueue_clean(&xfer_mgr->uqueue);
     umutex_release(xfer_mgr->mutex);
-    upipe_xfer_mgr_vacuum(mgr);
+    ulifo_clean(&xfer_mgr->msg_pool);
+    free(xfer_mgr->msgs);
     free(xfer_mgr);
 }
 
@@ -538,43 +574,71 @@ static void upipe_xfer_mgr_worker(struct upump *upump)
 {
     struct upipe_mgr *mgr = upump_get_opaque(upump, struct upipe_mgr *);
     struct upipe_xfer_mgr *xfer_mgr = upipe_xfer_mgr_from_upipe_mgr(mgr);
-    struct upipe_xfer_msg *msg;
-    while ((msg = uqueue_pop(&xfer_mgr->uqueue,
-                             struct upipe_xfer_msg *)) != NULL) {
-        switch (msg->type) {
-            case UPIPE_XFER_ATTACH_UPUMP_MGR:
-                upipe_attach_upump_mgr(msg->upipe_remote);
-                break;
-            case UPIPE_XFER_SET_URI:
-                upipe_set_uri(msg->upipe_remote, msg->arg.string);
-                free(msg->arg.string);
-                break;
-            case UPIPE_XFER_SET_OUTPUT:
-                upipe_set_output(msg->upipe_remote, msg->arg.pipe);
-                upipe_release(msg->arg.pipe);
-                break;
-            case UPIPE_XFER_RELEASE:
-                upipe_release(msg->upipe_remote);
-                break;
-            case UPIPE_XFER_DETACH:
-                upipe_xfer_msg_free(mgr, msg);
-                upipe_xfer_mgr_free(mgr);
-                return;
-            default:
-                /* this should not happen */
-                break;
-        }
+    void *msgs[UPIPE_XFER_BATCH];
+    unsigned int nb;
+    while ((nb = uqueue_pop_batch(&xfer_mgr->uqueue, msgs,
+                                  UPIPE_XFER_BATCH)) > 0) {
+        for (unsigned int i = 0; i < nb; i++) {
+            struct upipe_xfer_msg *msg = msgs[i];
+            switch (msg->type) {
+                case UPIPE_XFER_ATTACH_UPUMP_MGR:
+                    upipe_attach_upump_mgr(msg->upipe_remote);
+                    break;
+                case UPIPE_XFER_SET_URI:
+                    upipe_set_uri(msg->upipe_remote, msg->arg.string);
+                    free(msg->arg.string);
+                    break;
+                case UPIPE_XFER_SET_OUTPUT:
+                    upipe_set_output(msg->upipe_remote, msg->arg.pipe);
+                    upipe_release(msg->arg.pipe);
+                    break;
+                case UPIPE_XFER_RELEASE:
+                    upipe_release(msg->upipe_remote);
+                    break;
+                case UPIPE_XFER_DETACH:
+                    /* detach is always the last message */
+                    assert(i == nb - 1);
+                    upipe_xfer_msg_free(mgr, msg);
+                    upipe_xfer_mgr_free(mgr);
+                    return;
+                default:
+                    /* this should not happen */
+                    break;
+            }
 
-        upipe_xfer_msg_free(mgr, msg);
+            upipe_xfer_msg_free(mgr, msg);
+        }
     }
 }
 
-/** @This sends a message to the remote upump manager.
+/** @This pushes the pending batch of messages to the remote upump manager,
+ * with a single wake-up.
+ *
+ * @param mgr xfer_mgr structure
+ * @return an error code
+ */
+static int upipe_xfer_mgr_flush(struct upipe_mgr *mgr)
+{
+    struct upipe_xfer_mgr *xfer_mgr = upipe_xfer_mgr_from_upipe_mgr(mgr);
+    unsigned int nb = xfer_mgr->batch_nb;
+    if (!nb)
+        return UBASE_ERR_NONE;
+
+    unsigned int count = uqueue_push_batch(&xfer_mgr->uqueue,
+                                           xfer_mgr->batch, nb);
+    for (unsigned int i = count; i < nb; i++)
+        upipe_xfer_msg_drop(mgr, xfer_mgr->batch[i]);
+    xfer_mgr->batch_nb = 0;
+    return count < nb ? UBASE_ERR_EXTERNAL : UBASE_ERR_NONE;
+}
+
+/** @This sends a message to the remote upump manager, or adds it to the
+ * pending batch.
  *
  * @param mgr xfer_mgr structure
  * @param type type of message
  * @param upipe_remote optional remote pipe
- * @paral arg optional argument
+ * @param arg optional argument
  * @return an error code
  */
 static int upipe_xfer_mgr_send(struct upipe_mgr *mgr, int type,
@@ -583,15 +647,27 @@ static int upipe_xfer_mgr_send(struct upipe_mgr *mgr, int type,
 {
     struct upipe_xfer_mgr *xfer_mgr = upipe_xfer_mgr_from_upipe_mgr(mgr);
     struct upipe_xfer_msg *msg = upipe_xfer_msg_alloc(mgr);
-    if (msg == NULL)
+    if (msg == NULL) {
+        if (type == UPIPE_XFER_SET_URI)
+            free(arg.string);
+        else if (type == UPIPE_XFER_SET_OUTPUT)
+            upipe_release(arg.pipe);
         return UBASE_ERR_ALLOC;
+    }
 
     msg->type = type;
     msg->upipe_remote = upipe_remote;
     msg->arg = arg;
 
+    if (xfer_mgr->batch_depth) {
+        xfer_mgr->batch[xfer_mgr->batch_nb++] = msg;
+        if (xfer_mgr->batch_nb < UPIPE_XFER_BATCH)
+            return UBASE_ERR_NONE;
+        return upipe_xfer_mgr_flush(mgr);
+    }
+
     if (unlikely(!uqueue_push(&xfer_mgr->uqueue, msg))) {
-        upipe_xfer_msg_free(mgr, msg);
+        upipe_xfer_msg_drop(mgr, msg);
         return UBASE_ERR_EXTERNAL;
     }
     return UBASE_ERR_NONE;
@@ -676,6 +752,39 @@ static inline int _upipe_xfer_mgr_thaw(struct upipe_mgr *mgr)
     return err;
 }
 
+/** @This starts a batch of messages. The messages sent until the end of
+ * the batch are pushed at once to the remote event loop.
+ *
+ * @param mgr xfer_mgr structure
+ * @return an error code
+ */
+static int _upipe_xfer_mgr_batch_begin(struct upipe_mgr *mgr)
+{
+    struct upipe_xfer_mgr *xfer_mgr = upipe_xfer_mgr_from_upipe_mgr(mgr);
+    upipe_mgr_use(mgr);
+    xfer_mgr->batch_depth++;
+    return UBASE_ERR_NONE;
+}
+
+/** @This ends a batch of messages previously started by @ref
+ * upipe_xfer_mgr_batch_begin, and pushes the pending messages.
+ *
+ * @param mgr xfer_mgr structure
+ * @return an error code
+ */
+static int _upipe_xfer_mgr_batch_end(struct upipe_mgr *mgr)
+{
+    struct upipe_xfer_mgr *xfer_mgr = upipe_xfer_mgr_from_upipe_mgr(mgr);
+    if (unlikely(!xfer_mgr->batch_depth))
+        return UBASE_ERR_INVALID;
+
+    int err = UBASE_ERR_NONE;
+    if (!--xfer_mgr->batch_depth)
+        err = upipe_xfer_mgr_flush(mgr);
+    upipe_mgr_release(mgr);
+    return err;
+}
+
 /** @This processes manager control commands.
  *
  * @param mgr xfer_mgr structure
@@ -700,6 +809,14 @@ static int upipe_xfer_mgr_control(struct upipe_mgr *mgr,
             UBASE_SIGNATURE_CHECK(args, UPIPE_XFER_SIGNATURE)
             return _upipe_xfer_mgr_thaw(mgr);
         }
+        case UPIPE_XFER_MGR_BATCH_BEGIN: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_XFER_SIGNATURE)
+            return _upipe_xfer_mgr_batch_begin(mgr);
+        }
+        case UPIPE_XFER_MGR_BATCH_END: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_XFER_SIGNATURE)
+            return _upipe_xfer_mgr_batch_end(mgr);
+        }
         default:
             return UBASE_ERR_UNHANDLED;
     }
@@ -710,8 +827,12 @@ static int upipe_xfer_mgr_control(struct upipe_mgr *mgr,
  * structure can be allocated in any thread, but must be attached in the
  * same thread as the one running the upump manager.
  *
+ * The messages are all preallocated: enough to fill the queue to the remote
+ * event loop and a batch, plus msg_pool_depth for the events sent back by
+ * the remote pipes.
+ *
  * @param queue_length maximum length of the internal queues
- * @param msg_pool_depth maximum number of messages in the pool
+ * @param msg_pool_depth number of messages preallocated for events
  * @param mutex mutual exclusion primitives to access the event loop, or NULL
  * @return pointer to manager
  */
@@ -720,15 +841,24 @@ struct upipe_mgr *upipe_xfer_mgr_alloc(uint8_t queue_length,
                                        struct umutex *mutex)
 {
     assert(queue_length);
+    unsigned int nb_msgs = queue_length + UPIPE_XFER_BATCH + msg_pool_depth;
+    if (nb_msgs > UINT16_MAX)
+        nb_msgs = UINT16_MAX;
     struct upipe_xfer_mgr *xfer_mgr = malloc(sizeof(struct upipe_xfer_mgr) +
                                              uqueue_sizeof(queue_length) +
-                                             ulifo_sizeof(msg_pool_depth));
+                                             ulifo_sizeof(nb_msgs));
     if (unlikely(xfer_mgr == NULL))
         return NULL;
 
     memset(xfer_mgr, 0, sizeof(*xfer_mgr));
+    xfer_mgr->msgs = malloc(nb_msgs * sizeof(struct upipe_xfer_msg));
+    if (unlikely(xfer_mgr->msgs == NULL)) {
+        free(xfer_mgr);
+        return NULL;
+    }
     if (unlikely(!uqueue_init(&xfer_mgr->uqueue, queue_length,
                               xfer_mgr->extra))) {
+        free(xfer_mgr->msgs);
         free(xfer_mgr);
         return NULL;
     }
@@ -736,8 +866,12 @@ struct upipe_mgr *upipe_xfer_mgr_alloc(uint8_t queue_length,
     xfer_mgr->upump = NULL;
     xfer_mgr->upump_mgr = NULL;
     xfer_mgr->queue_length = queue_length;
-    ulifo_init(&xfer_mgr->msg_pool, msg_pool_depth,
+    xfer_mgr->batch_depth = 0;
+    xfer_mgr->batch_nb = 0;
+    ulifo_init(&xfer_mgr->msg_pool, nb_msgs,
                xfer_mgr->extra + uqueue_sizeof(queue_length));
+    for (unsigned int i = 0; i < nb_msgs; i++)
+        ulifo_push(&xfer_mgr->msg_pool, &xfer_mgr->msgs[i]);
 
     struct upipe_mgr *mgr = upipe_xfer_mgr_to_upipe_mgr(xfer_mgr);
     urefcount_init(upipe_xfer_mgr_to_urefcount(xfer_mgr),
@@ -33,6 +33,7 @@
 #include <upipe/uclock.h>
 #include <upipe/uref.h>
 #include <upipe/uref_clock.h>
+#include <upipe/uref_flow.h>
 #include <upipe/upipe.h>
 #include <upipe/upipe_helper_upipe.h>
 #include <upipe/upipe_helper_urefcount.h>
@@ -45,10 +46,18 @@
 
 #include <stdlib.h>
 #include <stdbool.h>
+#include <string.h>
 #include <limits.h>
 #include <stdarg.h>
 #include <assert.h>
 
+/** minimum absolute rate for the index-driven mode */
+#define UPIPE_TRICKP_INDEX_RATE 2
+/** interval between two pictures output in index-driven mode */
+#define UPIPE_TRICKP_INDEX_PERIOD (UCLOCK_FREQ / 4)
+/** initial number of entries of the index */
+#define UPIPE_TRICKP_INDEX_SIZE 64
+
 /** @hidden */
 static uint64_t upipe_trickp_get_date_sys(struct upipe *upipe, uint64_t ts);
 /** @hidden */
@@ -57,6 +66,14 @@ static int upipe_trickp_check_start(struct upipe *upipe, struct uref *);
 static bool upipe_trickp_sub_process(struct upipe *upipe, struct uref *uref,
                                      struct upump **upump);
 
+/** @internal @This is an entry of the index of random access points. */
+struct upipe_trickp_rap {
+    /** program date of the random access picture */
+    uint64_t date;
+    /** position of the picture in the source */
+    uint64_t position;
+};
+
 /** @internal @This is the private context of a trickp pipe. */
 struct upipe_trickp {
     /** refcount management structure */
@@ -76,6 +93,19 @@ struct upipe_trickp {
 
     /** current rate */
     struct urational rate;
+    /** true if the index-driven mode is enabled */
+    bool indexed;
+    /** true if the index is learnt from the random access pictures */
+    bool learn;
+    /** index of random access points, sorted by date */
+    struct upipe_trickp_rap *index;
+    /** number of entries in the index */
+    unsigned int index_size;
+    /** number of allocated entries of the index */
+    unsigned int index_alloc;
+    /** date of the next picture to output in index-driven mode, or
+     * UINT64_MAX */
+    uint64_t next_date;
     /** list of subs */
     struct uchain subs;
 
@@ -92,6 +122,116 @@ UPIPE_HELPER_VOID(upipe_trickp)
 UPIPE_HELPER_UCLOCK(upipe_trickp, uclock, uclock_request,
                     upipe_trickp_check_start, upipe_throw_provide_request, NULL)
 
+/** @internal @This checks if the pipe currently skips to the random access
+ * pictures.
+ *
+ * @param upipe_trickp private context of the trickp pipe
+ * @return true in index-driven mode
+ */
+static inline bool upipe_trickp_skipping(struct upipe_trickp *upipe_trickp)
+{
+    struct urational rate = upipe_trickp->rate;
+    uint64_t num = rate.num < 0 ? -rate.num : rate.num;
+    return upipe_trickp->indexed && rate.den &&
+           num >= UPIPE_TRICKP_INDEX_RATE * rate.den;
+}
+
+/** @internal @This returns the first entry of the index dated at or after
+ * the given date.
+ *
+ * @param upipe_trickp private context of the trickp pipe
+ * @param date program date
+ * @return index of the entry, or the number of entries
+ */
+static unsigned int upipe_trickp_find_rap(struct upipe_trickp *upipe_trickp,
+                                          uint64_t date)
+{
+    unsigned int low = 0, high = upipe_trickp->index_size;
+    while (low < high) {
+        unsigned int mid = low + (high - low) / 2;
+        if (upipe_trickp->index[mid].date >= date)
+            high = mid;
+        else
+            low = mid + 1;
+    }
+    return low;
+}
+
+/** @internal @This adds a random access point to the index.
+ *
+ * @param upipe description structure of the pipe
+ * @param date program date of the random access picture
+ * @param position position of the picture in the source
+ * @return an error code
+ */
+static int upipe_trickp_add_rap(struct upipe *upipe,
+                                uint64_t date, uint64_t position)
+{
+    struct upipe_trickp *upipe_trickp = upipe_trickp_from_upipe(upipe);
+    unsigned int size = upipe_trickp->index_size;
+    unsigned int i = size;
+    if (size && upipe_trickp->index[size - 1].date >= date)
+        i = upipe_trickp_find_rap(upipe_trickp, date);
+    if (i < size && upipe_trickp->index[i].date == date) {
+        upipe_trickp->index[i].position = position;
+        return UBASE_ERR_NONE;
+    }
+
+    if (unlikely(size == upipe_trickp->index_alloc)) {
+        unsigned int alloc = size ? size * 2 : UPIPE_TRICKP_INDEX_SIZE;
+        struct upipe_trickp_rap *index =
+            realloc(upipe_trickp->index, alloc * sizeof(*index));
+        UBASE_ALLOC_RETURN(index)
+        upipe_trickp->index = index;
+        upipe_trickp->index_alloc = alloc;
+    }
+    memmove(&upipe_trickp->index[i + 1], &upipe_trickp->index[i],
+            (size - i) * sizeof(*upipe_trickp->index));
+    upipe_trickp->index[i].date = date;
+    upipe_trickp->index[i].position = position;
+    upipe_trickp->index_size++;
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This asks for the source to be seeked to the indexed picture
+ * which should be displayed after the given one, in index-driven mode.
+ *
+ * @param upipe description structure of the pipe
+ * @param date program date of the picture being output
+ */
+static void upipe_trickp_seek(struct upipe *upipe, uint64_t date)
+{
+    struct upipe_trickp *upipe_trickp = upipe_trickp_from_upipe(upipe);
+    struct urational rate = upipe_trickp->rate;
+    uint64_t num = rate.num < 0 ? -rate.num : rate.num;
+    uint64_t step = UPIPE_TRICKP_INDEX_PERIOD * num / rate.den;
+    unsigned int i;
+
+    if (rate.num > 0) {
+        upipe_trickp->next_date = date + step;
+        i = upipe_trickp_find_rap(upipe_trickp, upipe_trickp->next_date);
+        /* not indexed yet, or no picture to skip */
+        if (i >= upipe_trickp->index_size ||
+            i == upipe_trickp_find_rap(upipe_trickp, date + 1))
+            return;
+    } else {
+        upipe_trickp->next_date = date > step ? date - step : 0;
+        i = upipe_trickp_find_rap(upipe_trickp, upipe_trickp->next_date + 1);
+        if (unlikely(i == 0)) {
+            upipe_warn(upipe, "beginning of the index reached");
+            return;
+        }
+        i--;
+    }
+
+    upipe_trickp->next_date = upipe_trickp->index[i].date;
+    upipe_verbose_va(upipe, "seeking to %"PRIu64" (position %"PRIu64")",
+                     upipe_trickp->index[i].date,
+                     upipe_trickp->index[i].position);
+    upipe_throw(upipe, UPROBE_TRICKP_SEEK, UPIPE_TRICKP_SIGNATURE,
+                upipe_trickp->index[i].position);
+}
+
 /** @internal @This is the type of the flow (different behaviours). */
 enum upipe_trickp_sub_type {
     UPIPE_TRICKP_UNKNOWN,
@@ -173,6 +313,34 @@ static struct upipe *upipe_trickp_sub_alloc(struct upipe_mgr *mgr,
     return upipe;
 }
 
+/** @internal @This checks if a uref is skipped in index-driven mode.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref uref structure
+ * @return true if the uref must be dropped
+ */
+static bool upipe_trickp_sub_skip(struct upipe *upipe, struct uref *uref)
+{
+    struct upipe_trickp *upipe_trickp = upipe_trickp_from_sub_mgr(upipe->mgr);
+    struct upipe_trickp_sub *upipe_trickp_sub =
+        upipe_trickp_sub_from_upipe(upipe);
+    if (!upipe_trickp_skipping(upipe_trickp))
+        return false;
+    if (upipe_trickp_sub->type != UPIPE_TRICKP_PIC ||
+        !ubase_check(uref_flow_get_random(uref)))
+        return true;
+
+    uint64_t date;
+    int type;
+    uref_clock_get_date_prog(uref, &date, &type);
+    if (unlikely(type == UREF_DATE_NONE))
+        return true;
+    if (upipe_trickp->next_date == UINT64_MAX)
+        return false;
+    return upipe_trickp->rate.num > 0 ? date < upipe_trickp->next_date :
+                                        date > upipe_trickp->next_date;
+}
+
 /** @internal @This processes data.
  *
  * @param upipe description structure of the pipe
@@ -188,8 +356,16 @@ static bool upipe_trickp_sub_process(struct upipe *upipe, struct uref *uref,
         /* pause */
         return false;
     }
+    if (unlikely(upipe_trickp_sub_skip(upipe, uref))) {
+        uref_free(uref);
+        return true;
+    }
 
-    uref_clock_set_rate(uref, upipe_trickp->rate);
+    bool skipping = upipe_trickp_skipping(upipe_trickp);
+    struct urational rate = upipe_trickp->rate;
+    if (rate.num < 0)
+        rate.num = -rate.num;
+    uref_clock_set_rate(uref, rate);
     uint64_t date;
     int type;
     uref_clock_get_date_prog(uref, &date, &type);
@@ -203,6 +379,8 @@ static bool upipe_trickp_sub_process(struct upipe *upipe, struct uref *uref,
     }
 
     upipe_trickp_sub_output(upipe, uref, upump_p);
+    if (skipping && type != UREF_DATE_NONE)
+        upipe_trickp_seek(upipe_trickp_to_upipe(upipe_trickp), date);
     return true;
 }
 
@@ -216,6 +394,23 @@ static void upipe_trickp_sub_input(struct upipe *upipe, struct uref *uref,
                                    struct upump **upump_p)
 {
     struct upipe_trickp *upipe_trickp = upipe_trickp_from_sub_mgr(upipe->mgr);
+    struct upipe_trickp_sub *upipe_trickp_sub =
+        upipe_trickp_sub_from_upipe(upipe);
+
+    if (upipe_trickp->learn && upipe_trickp_sub->type == UPIPE_TRICKP_PIC &&
+        ubase_check(uref_flow_get_random(uref))) {
+        uint64_t date, rap;
+        int type;
+        uref_clock_get_date_prog(uref, &date, &type);
+        if (type != UREF_DATE_NONE &&
+            ubase_check(uref_clock_get_rap_sys(uref, &rap)))
+            upipe_trickp_add_rap(upipe_trickp_to_upipe(upipe_trickp),
+                                 date, rap);
+    }
+    if (upipe_trickp_sub_skip(upipe, uref)) {
+        uref_free(uref);
+        return;
+    }
 
     if (upipe_trickp->uclock == NULL || upipe_trickp->rate.num == 0 ||
         upipe_trickp->rate.den == 0) {
@@ -351,6 +546,11 @@ static struct upipe *upipe_trickp_alloc(struct upipe_mgr *mgr,
     upipe_trickp->ts_origin = 0;
     upipe_trickp->preroll = true;
     upipe_trickp->rate.num = upipe_trickp->rate.den = 1;
+    upipe_trickp->indexed = false;
+    upipe_trickp->learn = false;
+    upipe_trickp->index = NULL;
+    upipe_trickp->index_size = upipe_trickp->index_alloc = 0;
+    upipe_trickp->next_date = UINT64_MAX;
     upipe_throw_ready(upipe);
     upipe_trickp_require_uclock(upipe);
     return upipe;
@@ -371,7 +571,9 @@ static int upipe_trickp_check_start(struct upipe *upipe, struct uref *uref)
     ulist_foreach (&upipe_trickp->subs, uchain) {
         struct upipe_trickp_sub *upipe_trickp_sub =
             upipe_trickp_sub_from_uchain(uchain);
-        if (upipe_trickp_sub->type == UPIPE_TRICKP_SUBPIC)
+        if (upipe_trickp_sub->type == UPIPE_TRICKP_SUBPIC ||
+            (upipe_trickp_sub->type != UPIPE_TRICKP_PIC &&
+             upipe_trickp_skipping(upipe_trickp)))
             continue;
 
         for ( ; ; ) {
@@ -427,6 +629,15 @@ static int upipe_trickp_check_start(struct upipe *upipe, struct uref *uref)
 static uint64_t upipe_trickp_get_date_sys(struct upipe *upipe, uint64_t ts)
 {
     struct upipe_trickp *upipe_trickp = upipe_trickp_from_upipe(upipe);
+    if (upipe_trickp->rate.num < 0) {
+        if (unlikely(ts > upipe_trickp->ts_origin)) {
+            upipe_warn(upipe, "got a timestamp in the future");
+            ts = upipe_trickp->ts_origin;
+        }
+        return (upipe_trickp->ts_origin - ts) *
+                   upipe_trickp->rate.den / -upipe_trickp->rate.num +
+               upipe_trickp->systime_offset;
+    }
     if (unlikely(ts < upipe_trickp->ts_origin)) {
         upipe_warn(upipe, "got a timestamp in the past");
         ts = upipe_trickp->ts_origin;
@@ -471,7 +682,10 @@ static inline int _upipe_trickp_set_rate(struct upipe *upipe,
                                          struct urational rate)
 {
     struct upipe_trickp *upipe_trickp = upipe_trickp_from_upipe(upipe);
+    if (unlikely(rate.num < 0 && !upipe_trickp->indexed))
+        return UBASE_ERR_INVALID;
     upipe_trickp->rate = rate;
+    upipe_trickp->next_date = UINT64_MAX;
     upipe_trickp_reset_uclock(upipe);
     if (rate.den) {
         upipe_dbg_va(upipe, "setting rate to %f", (float)rate.num/rate.den);
@@ -498,6 +712,25 @@ static inline int _upipe_trickp_set_rate(struct upipe *upipe,
     return UBASE_ERR_NONE;
 }
 
+/** @This enables or disables the index-driven mode.
+ *
+ * @param upipe description structure of the pipe
+ * @param enabled true to enable the index-driven mode
+ * @param learn true to learn the index from the random access pictures
+ * @return an error code
+ */
+static int _upipe_trickp_set_index_mode(struct upipe *upipe,
+                                        bool enabled, bool learn)
+{
+    struct upipe_trickp *upipe_trickp = upipe_trickp_from_upipe(upipe);
+    if (unlikely(!enabled && upipe_trickp->rate.num < 0))
+        return UBASE_ERR_INVALID;
+    upipe_trickp->indexed = enabled;
+    upipe_trickp->learn = learn;
+    upipe_trickp->next_date = UINT64_MAX;
+    return UBASE_ERR_NONE;
+}
+
 /** @internal @This processes control commands on a trickp pipe.
  *
  * @param upipe description structure of the pipe
@@ -527,6 +760,18 @@ static int upipe_trickp_control(struct upipe *upipe, int command, va_list args)
             struct urational rate = va_arg(args, struct urational);
             return _upipe_trickp_set_rate(upipe, rate);
         }
+        case UPIPE_TRICKP_SET_INDEX_MODE: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_TRICKP_SIGNATURE)
+            bool enabled = !!va_arg(args, int);
+            bool learn = !!va_arg(args, int);
+            return _upipe_trickp_set_index_mode(upipe, enabled, learn);
+        }
+        case UPIPE_TRICKP_ADD_INDEX: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_TRICKP_SIGNATURE)
+            uint64_t date = va_arg(args, uint64_t);
+            uint64_t position = va_arg(args, uint64_t);
+            return upipe_trickp_add_rap(upipe, date, position);
+        }
 
         default:
             return UBASE_ERR_UNHANDLED;
@@ -539,7 +784,9 @@ static int upipe_trickp_control(struct upipe *upipe, int command, va_list args)
  */
 static void upipe_trickp_free(struct upipe *upipe)
 {
+    struct upipe_trickp *upipe_trickp = upipe_trickp_from_upipe(upipe);
     upipe_throw_dead(upipe);
+    free(upipe_trickp->index);
     upipe_trickp_clean_sub_subs(upipe);
     upipe_trickp_clean_uclock(upipe);
     upipe_trickp_clean_urefcount(upipe);
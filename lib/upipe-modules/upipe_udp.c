@@ -337,6 +337,8 @@ int upipe_udp_open_socket(struct upipe *upipe, const char *_uri, int ttl,
     in_addr_t src_addr = INADDR_ANY;
     uint16_t src_port = 4242;
     int tos = 0;
+    bool reuseport = false;
+    int busy_poll = 0;
     bool b_tcp;
     bool b_raw;
     int family;
@@ -446,6 +448,10 @@ int upipe_udp_open_socket(struct upipe *upipe, const char *_uri, int ttl,
                 ttl = strtol(ARG_OPTION("ttl="), NULL, 0);
             } else if (IS_OPTION("tos=")) {
                 tos = strtol(ARG_OPTION("tos="), NULL, 0);
+            } else if (IS_OPTION("reuseport")) {
+                reuseport = true;
+            } else if (IS_OPTION("busypoll=")) {
+                busy_poll = strtol(ARG_OPTION("busypoll="), NULL, 0);
             } else if (IS_OPTION("tcp")) {
                 *use_tcp = true;
             } else if (IS_OPTION("fd=")) {
@@ -530,6 +536,32 @@ int upipe_udp_open_socket(struct upipe *upipe, const char *_uri, int ttl,
             return -1;
         }
 
+        if (reuseport) {
+#ifdef SO_REUSEPORT
+            i = 1;
+            if (setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, (void *)&i,
+                           sizeof(i)) == -1) {
+                upipe_err_va(upipe, "unable to set SO_REUSEPORT (%m)");
+                close(fd);
+                return -1;
+            }
+#else
+            upipe_warn(upipe, "SO_REUSEPORT is not supported");
+#endif
+        }
+
+        if (busy_poll > 0) {
+#ifdef SO_BUSY_POLL
+            /* poll the device queue for at most this number of microseconds
+             * when the socket has no data */
+            if (setsockopt(fd, SOL_SOCKET, SO_BUSY_POLL, (void *)&busy_poll,
+                           sizeof(busy_poll)) == -1)
+                upipe_warn_va(upipe, "unable to set SO_BUSY_POLL (%m)");
+#else
+            upipe_warn(upipe, "SO_BUSY_POLL is not supported");
+#endif
+        }
+
         if (family == AF_INET6) {
             if (bind_if_index
                   && setsockopt(fd, IPPROTO_IPV6, IPV6_MULTICAST_IF,
@@ -28,6 +28,9 @@
  * @short Upipe sink module for udp
  */
 
+#define _GNU_SOURCE
+
+#include <upipe/config.h>
 #include <upipe/ubase.h>
 #include <upipe/ulist.h>
 #include <upipe/uprobe.h>
@@ -37,6 +40,7 @@
 #include <upipe/uref_clock.h>
 #include <upipe/upump.h>
 #include <upipe/ubuf.h>
+#include <upipe/ubuf_block_file.h>
 #include <upipe/upipe.h>
 #include <upipe/upipe_helper_upipe.h>
 #include <upipe/upipe_helper_urefcount.h>
@@ -56,11 +60,23 @@
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#include <time.h>
 #include <errno.h>
 #include <assert.h>
+#ifdef __linux__
+#include <linux/net_tstamp.h>
+#endif
+
+#if defined(SO_TXTIME) && defined(SCM_TXTIME)
+/** transmission times may be given to the kernel */
+#define UPIPE_UDPSINK_TXTIME
+#endif
 
 /** tolerance for late packets */
 #define SYSTIME_TOLERANCE UCLOCK_FREQ
@@ -71,12 +87,23 @@
 
 #define UDP_DEFAULT_TTL 0
 #define UDP_DEFAULT_PORT 1234
+/** default pacing window in batch mode */
+#define BATCH_DEFAULT_WINDOW (UCLOCK_FREQ / 1000)
+/** maximum payload of a UDP segmentation offload write */
+#define GSO_MAX_SIZE 65507
+
+/** size of the control message carrying the transmission time */
+#define TXTIME_CONTROL_SIZE CMSG_SPACE(sizeof(uint64_t))
 
 /** @hidden */
 static void upipe_udpsink_watcher(struct upump *upump);
 /** @hidden */
 static bool upipe_udpsink_output(struct upipe *upipe, struct uref *uref,
                                  struct upump **upump_p);
+#ifdef UPIPE_HAVE_SENDMMSG
+/** @hidden */
+static void upipe_udpsink_batch_timer(struct upump *upump);
+#endif
 
 /** @internal @This is the private context of a udp sink pipe. */
 struct upipe_udpsink {
@@ -108,6 +135,28 @@ struct upipe_udpsink {
     /** list of blockers */
     struct uchain blockers;
 
+    /** maximum number of datagrams sent per system call */
+    unsigned int batch;
+    /** maximum advance of the datagrams sent with the first one of a batch */
+    uint64_t window;
+    /** datagrams of the current batch */
+    struct uref *batch_urefs[UPIPE_UDPSINK_BATCH_MAX];
+    /** transmission times of the datagrams of the current batch, or 0 */
+    uint64_t batch_txtimes[UPIPE_UDPSINK_BATCH_MAX];
+    /** number of datagrams in the current batch */
+    unsigned int nb_batch;
+    /** date of the first datagram of the current batch */
+    uint64_t batch_systime;
+    /** timer sending an incomplete batch */
+    struct upump *upump_batch;
+    /** true if UDP segmentation offload failed */
+    bool gso_disabled;
+    /** true if file ranges may be sent with sendfile() */
+    bool sendfile;
+    /** advance of the datagrams given to the kernel with their transmission
+     * time, or 0 if SO_TXTIME is not used */
+    uint64_t txtime_lead;
+
     /** RAW sockets */
     bool raw;
     /** RAW header */
@@ -127,6 +176,7 @@ UPIPE_HELPER_UREFCOUNT(upipe_udpsink, urefcount, upipe_udpsink_free)
 UPIPE_HELPER_VOID(upipe_udpsink)
 UPIPE_HELPER_UPUMP_MGR(upipe_udpsink, upump_mgr)
 UPIPE_HELPER_UPUMP(upipe_udpsink, upump, upump_mgr)
+UPIPE_HELPER_UPUMP(upipe_udpsink, upump_batch, upump_mgr)
 UPIPE_HELPER_INPUT(upipe_udpsink, urefs, nb_urefs, max_urefs, blockers, upipe_udpsink_output)
 UPIPE_HELPER_UCLOCK(upipe_udpsink, uclock, uclock_request, NULL, upipe_throw_provide_request, NULL)
 
@@ -151,6 +201,7 @@ static struct upipe *upipe_udpsink_alloc(struct upipe_mgr *mgr,
     upipe_udpsink_init_urefcount(upipe);
     upipe_udpsink_init_upump_mgr(upipe);
     upipe_udpsink_init_upump(upipe);
+    upipe_udpsink_init_upump_batch(upipe);
     upipe_udpsink_init_input(upipe);
     upipe_udpsink_init_uclock(upipe);
     upipe_udpsink->latency = 0;
@@ -158,6 +209,13 @@ static struct upipe *upipe_udpsink_alloc(struct upipe_mgr *mgr,
     upipe_udpsink->uri = NULL;
     upipe_udpsink->raw = false;
     upipe_udpsink->addrlen = 0;
+    upipe_udpsink->batch = 1;
+    upipe_udpsink->window = BATCH_DEFAULT_WINDOW;
+    upipe_udpsink->nb_batch = 0;
+    upipe_udpsink->batch_systime = 0;
+    upipe_udpsink->gso_disabled = false;
+    upipe_udpsink->sendfile = true;
+    upipe_udpsink->txtime_lead = 0;
     upipe_throw_ready(upipe);
     return upipe;
 }
@@ -185,6 +243,331 @@ static void upipe_udpsink_poll(struct upipe *upipe)
     }
 }
 
+/** @internal @This enables the transmission times on the socket, if
+ * requested.
+ *
+ * @param upipe description structure of the pipe
+ * @return an error code
+ */
+static int upipe_udpsink_apply_txtime(struct upipe *upipe)
+{
+    struct upipe_udpsink *upipe_udpsink = upipe_udpsink_from_upipe(upipe);
+    if (!upipe_udpsink->txtime_lead || upipe_udpsink->fd == -1)
+        return UBASE_ERR_NONE;
+#ifdef UPIPE_UDPSINK_TXTIME
+    struct sock_txtime sock_txtime = {
+        .clockid = CLOCK_TAI,
+        .flags = 0,
+    };
+    if (unlikely(setsockopt(upipe_udpsink->fd, SOL_SOCKET, SO_TXTIME,
+                            &sock_txtime, sizeof(sock_txtime)) == -1)) {
+        upipe_err_va(upipe, "can't set SO_TXTIME (%m)");
+        return UBASE_ERR_EXTERNAL;
+    }
+    return UBASE_ERR_NONE;
+#else
+    return UBASE_ERR_UNHANDLED;
+#endif
+}
+
+/** @internal @This converts the date of a datagram to a transmission time.
+ *
+ * @param systime date of the datagram
+ * @param now current date
+ * @return transmission time in nanoseconds of CLOCK_TAI, or 0
+ */
+static uint64_t upipe_udpsink_txtime(uint64_t systime, uint64_t now)
+{
+    struct timespec ts;
+    if (unlikely(clock_gettime(CLOCK_TAI, &ts) == -1))
+        return 0;
+    uint64_t txtime = ts.tv_sec * UINT64_C(1000000000) + ts.tv_nsec;
+    /* late datagrams are sent as soon as possible */
+    if (systime > now)
+        txtime += (systime - now) * 1000 / (UCLOCK_FREQ / 1000000);
+    return txtime;
+}
+
+/** @internal @This fills in the control message carrying the transmission
+ * time of a datagram.
+ *
+ * @param msghdr message header, pointing to a buffer of
+ * @ref TXTIME_CONTROL_SIZE octets if txtime is not 0
+ * @param txtime transmission time, or 0
+ */
+static void upipe_udpsink_set_control(struct msghdr *msghdr, uint64_t txtime)
+{
+#ifdef UPIPE_UDPSINK_TXTIME
+    if (txtime) {
+        memset(msghdr->msg_control, 0, TXTIME_CONTROL_SIZE);
+        msghdr->msg_controllen = TXTIME_CONTROL_SIZE;
+        struct cmsghdr *cmsg = CMSG_FIRSTHDR(msghdr);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_TXTIME;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(uint64_t));
+        memcpy(CMSG_DATA(cmsg), &txtime, sizeof(uint64_t));
+        return;
+    }
+#endif
+    msghdr->msg_control = NULL;
+    msghdr->msg_controllen = 0;
+}
+
+#if defined(UPIPE_HAVE_SENDMMSG)
+/** @internal @This returns the number of datagrams at the beginning of the
+ * current batch which may be sent with a single UDP segmentation offload
+ * write.
+ *
+ * @param upipe description structure of the pipe
+ * @param sizes sizes of the datagrams of the batch
+ * @return number of datagrams, or 0 if segmentation offload can't be used
+ */
+static unsigned int upipe_udpsink_gso_count(struct upipe *upipe,
+                                            const size_t *sizes)
+{
+#ifdef UDP_SEGMENT
+    struct upipe_udpsink *upipe_udpsink = upipe_udpsink_from_upipe(upipe);
+    /* a single write only carries one transmission time */
+    if (upipe_udpsink->raw || upipe_udpsink->gso_disabled ||
+        upipe_udpsink->txtime_lead || upipe_udpsink->nb_batch < 2)
+        return 0;
+
+    /* all segments have the size of the first one, except the last one */
+    size_t total = 0;
+    unsigned int i;
+    for (i = 0; i < upipe_udpsink->nb_batch; i++) {
+        if (sizes[i] > sizes[0] || total + sizes[i] > GSO_MAX_SIZE)
+            break;
+        total += sizes[i];
+        if (sizes[i] < sizes[0]) {
+            i++;
+            break;
+        }
+    }
+    return i > 1 ? i : 0;
+#else
+    return 0;
+#endif
+}
+
+/** @internal @This sends the datagrams of the current batch.
+ *
+ * @param upipe description structure of the pipe
+ * @return false if the socket is not writable, in which case the watcher is
+ * started and the remaining datagrams are kept
+ */
+static bool upipe_udpsink_flush_batch(struct upipe *upipe)
+{
+    struct upipe_udpsink *upipe_udpsink = upipe_udpsink_from_upipe(upipe);
+    int raw = upipe_udpsink->raw ? 1 : 0;
+
+    while (upipe_udpsink->nb_batch) {
+        unsigned int nb = upipe_udpsink->nb_batch;
+        struct uref **urefs = upipe_udpsink->batch_urefs;
+        int counts[nb];
+        size_t sizes[nb];
+        int nb_iovecs = 0;
+        for (unsigned int i = 0; i < nb; i++) {
+            counts[i] = uref_block_iovec_count(urefs[i], 0, -1);
+            sizes[i] = 0;
+            uref_block_size(urefs[i], &sizes[i]);
+            nb_iovecs += counts[i] + raw;
+        }
+
+        struct iovec iovecs[nb_iovecs];
+        uint8_t raw_headers[nb][RAW_HEADER_SIZE];
+        uint8_t controls[nb][TXTIME_CONTROL_SIZE];
+        struct mmsghdr msgs[nb];
+        struct iovec *iovec = iovecs;
+        for (unsigned int i = 0; i < nb; i++) {
+            memset(&msgs[i], 0, sizeof(struct mmsghdr));
+            msgs[i].msg_hdr.msg_name =
+                upipe_udpsink->addrlen ? &upipe_udpsink->addr : NULL;
+            msgs[i].msg_hdr.msg_namelen = upipe_udpsink->addrlen;
+            msgs[i].msg_hdr.msg_iov = iovec;
+            msgs[i].msg_hdr.msg_iovlen = counts[i] + raw;
+            msgs[i].msg_hdr.msg_control = controls[i];
+            upipe_udpsink_set_control(&msgs[i].msg_hdr,
+                                      upipe_udpsink->batch_txtimes[i]);
+            if (raw) {
+                memcpy(raw_headers[i], upipe_udpsink->raw_header,
+                       RAW_HEADER_SIZE);
+                udp_raw_set_len(raw_headers[i], sizes[i]);
+                iovec->iov_base = raw_headers[i];
+                iovec->iov_len = RAW_HEADER_SIZE;
+                iovec++;
+            }
+            if (unlikely(!ubase_check(uref_block_iovec_read(urefs[i], 0, -1,
+                                                            iovec)))) {
+                while (i-- > 0)
+                    uref_block_iovec_unmap(urefs[i], 0, -1,
+                                           msgs[i].msg_hdr.msg_iov + raw);
+                for (i = 0; i < nb; i++)
+                    uref_free(urefs[i]);
+                upipe_udpsink->nb_batch = 0;
+                upipe_warn(upipe, "cannot read ubuf buffer");
+                break;
+            }
+            iovec += counts[i];
+        }
+        if (unlikely(!upipe_udpsink->nb_batch))
+            break;
+
+        int ret;
+        unsigned int gso = upipe_udpsink_gso_count(upipe, sizes);
+#ifdef UDP_SEGMENT
+        if (gso) {
+            uint8_t control[CMSG_SPACE(sizeof(uint16_t))];
+            memset(control, 0, sizeof(control));
+            struct msghdr msghdr = {
+                .msg_name = msgs[0].msg_hdr.msg_name,
+                .msg_namelen = msgs[0].msg_hdr.msg_namelen,
+                .msg_iov = iovecs,
+                .msg_iovlen = msgs[gso - 1].msg_hdr.msg_iov +
+                              msgs[gso - 1].msg_hdr.msg_iovlen - iovecs,
+                .msg_control = control,
+                .msg_controllen = sizeof(control),
+                .msg_flags = 0,
+            };
+            struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msghdr);
+            cmsg->cmsg_level = SOL_UDP;
+            cmsg->cmsg_type = UDP_SEGMENT;
+            cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+            uint16_t segment = sizes[0];
+            memcpy(CMSG_DATA(cmsg), &segment, sizeof(segment));
+
+            ret = sendmsg(upipe_udpsink->fd, &msghdr, 0);
+            if (ret != -1)
+                ret = gso;
+        } else
+#endif
+            ret = sendmmsg(upipe_udpsink->fd, msgs, nb, 0);
+
+        for (unsigned int i = 0; i < nb; i++)
+            uref_block_iovec_unmap(urefs[i], 0, -1,
+                                   msgs[i].msg_hdr.msg_iov + raw);
+
+        if (unlikely(ret == -1)) {
+            switch (errno) {
+                case EINTR:
+                    continue;
+                case EAGAIN:
+#if EAGAIN != EWOULDBLOCK
+                case EWOULDBLOCK:
+#endif
+                    upipe_udpsink_poll(upipe);
+                    return false;
+                case EIO:
+                case EINVAL:
+                case ENOPROTOOPT:
+                case EOPNOTSUPP:
+                    if (gso) {
+                        upipe_warn_va(upipe,
+                            "disabling UDP segmentation offload (%m)");
+                        upipe_udpsink->gso_disabled = true;
+                        continue;
+                    }
+                    break;
+                default:
+                    break;
+            }
+            /* Transient errors, see @ref upipe_udpsink_output. */
+            ret = gso ? gso : 1;
+        }
+
+        for (unsigned int i = 0; i < ret; i++)
+            uref_free(urefs[i]);
+        memmove(urefs, urefs + ret, (nb - ret) * sizeof(struct uref *));
+        memmove(upipe_udpsink->batch_txtimes,
+                upipe_udpsink->batch_txtimes + ret,
+                (nb - ret) * sizeof(uint64_t));
+        upipe_udpsink->nb_batch -= ret;
+    }
+
+    upipe_udpsink_set_upump_batch(upipe, NULL);
+    return true;
+}
+
+/** @internal @This is called at the end of the pacing window of an
+ * incomplete batch.
+ *
+ * @param upump description structure of the timer
+ */
+static void upipe_udpsink_batch_timer(struct upump *upump)
+{
+    struct upipe *upipe = upump_get_opaque(upump, struct upipe *);
+    upipe_udpsink_set_upump_batch(upipe, NULL);
+    upipe_udpsink_flush_batch(upipe);
+}
+
+/** @internal @This adds a datagram to the current batch, and sends the batch
+ * if it is complete.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref uref structure
+ * @param systime date of the datagram, if a uclock is provided
+ * @param txtime transmission time of the datagram, or 0
+ * @return true if the uref was processed
+ */
+static bool upipe_udpsink_add_batch(struct upipe *upipe, struct uref *uref,
+                                    uint64_t systime, uint64_t txtime)
+{
+    struct upipe_udpsink *upipe_udpsink = upipe_udpsink_from_upipe(upipe);
+    int iovec_count = uref_block_iovec_count(uref, 0, -1);
+    if (unlikely(iovec_count <= 0)) {
+        if (iovec_count == -1)
+            upipe_warn(upipe, "cannot read ubuf buffer");
+        uref_free(uref);
+        return true;
+    }
+
+    if (upipe_udpsink->nb_batch &&
+        (upipe_udpsink->nb_batch >= upipe_udpsink->batch ||
+         (upipe_udpsink->uclock != NULL &&
+          systime > upipe_udpsink->batch_systime + upipe_udpsink->window)) &&
+        !upipe_udpsink_flush_batch(upipe))
+        return false;
+
+    if (!upipe_udpsink->nb_batch) {
+        upipe_udpsink->batch_systime = systime;
+        upipe_udpsink_wait_upump_batch(upipe, upipe_udpsink->window,
+                                       upipe_udpsink_batch_timer);
+    }
+    upipe_udpsink->batch_txtimes[upipe_udpsink->nb_batch] = txtime;
+    upipe_udpsink->batch_urefs[upipe_udpsink->nb_batch++] = uref;
+    if (upipe_udpsink->nb_batch >= upipe_udpsink->batch)
+        /* if the socket is not writable, the watcher sends the rest */
+        upipe_udpsink_flush_batch(upipe);
+    return true;
+}
+#else
+/** @internal @This sends the datagrams of the current batch.
+ *
+ * @param upipe description structure of the pipe
+ * @return true
+ */
+static bool upipe_udpsink_flush_batch(struct upipe *upipe)
+{
+    return true;
+}
+#endif
+
+/** @internal @This sends what can be sent of the current batch, and drops
+ * the rest.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_udpsink_clean_batch(struct upipe *upipe)
+{
+    struct upipe_udpsink *upipe_udpsink = upipe_udpsink_from_upipe(upipe);
+    if (upipe_udpsink->nb_batch && upipe_udpsink->fd != -1)
+        upipe_udpsink_flush_batch(upipe);
+    for (unsigned int i = 0; i < upipe_udpsink->nb_batch; i++)
+        uref_free(upipe_udpsink->batch_urefs[i]);
+    upipe_udpsink->nb_batch = 0;
+    upipe_udpsink_set_upump_batch(upipe, NULL);
+}
+
 /** @internal @This outputs data to the udp sink.
  *
  * @param upipe description structure of the pipe
@@ -212,10 +595,11 @@ static bool upipe_udpsink_output(struct upipe *upipe, struct uref *uref,
         return true;
     }
 
+    uint64_t systime = 0;
+    uint64_t txtime = 0;
     if (likely(upipe_udpsink->uclock == NULL))
         goto write_buffer;
 
-    uint64_t systime = 0;
     if (unlikely(!ubase_check(uref_clock_get_cr_sys(uref, &systime)))) {
         upipe_warn(upipe, "received non-dated buffer");
         goto write_buffer;
@@ -223,12 +607,23 @@ static bool upipe_udpsink_output(struct upipe *upipe, struct uref *uref,
 
     uint64_t now = uclock_now(upipe_udpsink->uclock);
     systime += upipe_udpsink->latency;
-    if (unlikely(now < systime)) {
+    if (upipe_udpsink->txtime_lead)
+        /* the kernel or the NIC holds the datagram until its date */
+        txtime = upipe_udpsink_txtime(systime, now);
+    if (upipe_udpsink->nb_batch &&
+        systime <= upipe_udpsink->batch_systime + upipe_udpsink->window)
+        /* sent with the first datagram of the batch */
+        goto write_buffer;
+    uint64_t wakeup = systime > upipe_udpsink->txtime_lead ?
+                      systime - upipe_udpsink->txtime_lead : 0;
+    if (unlikely(now < wakeup)) {
         upipe_udpsink_check_upump_mgr(upipe);
         if (likely(upipe_udpsink->upump_mgr != NULL)) {
+            if (!upipe_udpsink_flush_batch(upipe))
+                return false;
             upipe_verbose_va(upipe, "sleeping %"PRIu64" (%"PRIu64")",
-                             systime - now, systime);
-            upipe_udpsink_wait_upump(upipe, systime - now,
+                             wakeup - now, systime);
+            upipe_udpsink_wait_upump(upipe, wakeup - now,
                                      upipe_udpsink_watcher);
             return false;
         }
@@ -246,6 +641,13 @@ static bool upipe_udpsink_output(struct upipe *upipe, struct uref *uref,
                       upipe_udpsink->latency / (UCLOCK_FREQ / 1000));
 
 write_buffer:
+#ifdef UPIPE_HAVE_SENDMMSG
+    if (upipe_udpsink->batch > 1 && upipe_udpsink->upump_mgr != NULL)
+        return upipe_udpsink_add_batch(upipe, uref, systime, txtime);
+#endif
+    if (!upipe_udpsink_flush_batch(upipe))
+        return false;
+
     for ( ; ; ) {
         size_t payload_len = 0;
         if (unlikely(!ubase_check(uref_block_size(uref, &payload_len)))) {
@@ -253,51 +655,81 @@ write_buffer:
             return false;
         }
 
-        int iovec_count = uref_block_iovec_count(uref, 0, -1);
-        if (unlikely(iovec_count == -1)) {
-            uref_free(uref);
-            upipe_warn(upipe, "cannot read ubuf buffer");
-            break;
-        }
-        if (unlikely(iovec_count == 0)) {
-            uref_free(uref);
-            break;
-        }
+        ssize_t ret;
+        int range_size = -1, range_fd;
+        uint64_t range_offset;
+        if (upipe_udpsink->sendfile && !upipe_udpsink->raw && !txtime &&
+            !upipe_udpsink->addrlen && uref->ubuf != NULL &&
+            ubase_check(ubuf_block_file_get_range(uref->ubuf, 0, &range_size,
+                                                  &range_fd, &range_offset)) &&
+            range_size == payload_len) {
+            /* the datagram is copied by the kernel from the source file */
+            off_t offset = range_offset;
+            ret = sendfile(upipe_udpsink->fd, range_fd, &offset, payload_len);
+            if (unlikely(ret == -1 && (errno == EINVAL || errno == ENOSYS))) {
+                upipe_dbg_va(upipe, "falling back to sendmsg (%m)");
+                upipe_udpsink->sendfile = false;
+                continue;
+            }
+            if (unlikely(ret >= 0 && (size_t)ret < payload_len)) {
+                /* the rest cannot be sent without splitting the datagram */
+                upipe_warn_va(upipe, "short sendfile (%zd/%zu), dropping",
+                              ret, payload_len);
+                upipe_udpsink->sendfile = false;
+                uref_free(uref);
+                break;
+            }
+        } else {
+            int iovec_count = uref_block_iovec_count(uref, 0, -1);
+            if (unlikely(iovec_count == -1)) {
+                uref_free(uref);
+                upipe_warn(upipe, "cannot read ubuf buffer");
+                break;
+            }
+            if (unlikely(iovec_count == 0)) {
+                uref_free(uref);
+                break;
+            }
 
-        if (upipe_udpsink->raw) {
-            iovec_count++;
-        }
+            if (upipe_udpsink->raw) {
+                iovec_count++;
+            }
 
-        struct iovec iovecs_s[iovec_count];
-        struct iovec *iovecs = iovecs_s;
+            struct iovec iovecs_s[iovec_count];
+            struct iovec *iovecs = iovecs_s;
 
-        if (upipe_udpsink->raw) {
-            udp_raw_set_len(upipe_udpsink->raw_header, payload_len);
-            iovecs[0].iov_base = upipe_udpsink->raw_header;
-            iovecs[0].iov_len = RAW_HEADER_SIZE;
-            iovecs++;
-        }
+            if (upipe_udpsink->raw) {
+                udp_raw_set_len(upipe_udpsink->raw_header, payload_len);
+                iovecs[0].iov_base = upipe_udpsink->raw_header;
+                iovecs[0].iov_len = RAW_HEADER_SIZE;
+                iovecs++;
+            }
 
-        if (unlikely(!ubase_check(uref_block_iovec_read(uref, 0, -1, iovecs)))) {
-            uref_free(uref);
-            upipe_warn(upipe, "cannot read ubuf buffer");
-            break;
-        }
+            if (unlikely(!ubase_check(uref_block_iovec_read(uref, 0, -1,
+                                                            iovecs)))) {
+                uref_free(uref);
+                upipe_warn(upipe, "cannot read ubuf buffer");
+                break;
+            }
 
-        struct msghdr msghdr = {
-            .msg_name = upipe_udpsink->addrlen ? &upipe_udpsink->addr : NULL,
-            .msg_namelen = upipe_udpsink->addrlen,
+            uint8_t control[TXTIME_CONTROL_SIZE];
+            struct msghdr msghdr = {
+                .msg_name = upipe_udpsink->addrlen ?
+                            &upipe_udpsink->addr : NULL,
+                .msg_namelen = upipe_udpsink->addrlen,
 
-            .msg_iov = iovecs_s,
-            .msg_iovlen = iovec_count,
+                .msg_iov = iovecs_s,
+                .msg_iovlen = iovec_count,
 
-            .msg_control = NULL,
-            .msg_controllen = 0,
-            .msg_flags = 0,
-        };
+                .msg_control = control,
+                .msg_controllen = 0,
+                .msg_flags = 0,
+            };
+            upipe_udpsink_set_control(&msghdr, txtime);
 
-        ssize_t ret = sendmsg(upipe_udpsink->fd, &msghdr, 0);
-        uref_block_iovec_unmap(uref, 0, -1, iovecs);
+            ret = sendmsg(upipe_udpsink->fd, &msghdr, 0);
+            uref_block_iovec_unmap(uref, 0, -1, iovecs);
+        }
 
         if (unlikely(ret == -1)) {
             switch (errno) {
@@ -338,6 +770,8 @@ static void upipe_udpsink_watcher(struct upump *upump)
 {
     struct upipe *upipe = upump_get_opaque(upump, struct upipe *);
     upipe_udpsink_set_upump(upipe, NULL);
+    if (!upipe_udpsink_flush_batch(upipe))
+        return;
     upipe_udpsink_output_input(upipe);
     upipe_udpsink_unblock_input(upipe);
     if (upipe_udpsink_check_input(upipe)) {
@@ -412,6 +846,7 @@ static int _upipe_udpsink_set_uri(struct upipe *upipe, const char *uri)
     struct upipe_udpsink *upipe_udpsink = upipe_udpsink_from_upipe(upipe);
     bool use_tcp = false;
 
+    upipe_udpsink_clean_batch(upipe);
     if (unlikely(upipe_udpsink->fd != -1)) {
         if (likely(upipe_udpsink->uri != NULL))
             upipe_notice_va(upipe, "closing socket %s", upipe_udpsink->uri);
@@ -447,7 +882,28 @@ static int _upipe_udpsink_set_uri(struct upipe *upipe, const char *uri)
         /* Use again the pipe that we previously released. */
         upipe_use(upipe);
     upipe_notice_va(upipe, "opening uri %s", upipe_udpsink->uri);
-    return UBASE_ERR_NONE;
+    return upipe_udpsink_apply_txtime(upipe);
+}
+
+/** @internal @This sets the advance of the datagrams handed to the kernel
+ * with their transmission time.
+ *
+ * @param upipe description structure of the pipe
+ * @param lead advance in 27 MHz ticks, or 0 to pace with timers
+ * @return an error code
+ */
+static int _upipe_udpsink_set_txtime(struct upipe *upipe, uint64_t lead)
+{
+    struct upipe_udpsink *upipe_udpsink = upipe_udpsink_from_upipe(upipe);
+#ifndef UPIPE_UDPSINK_TXTIME
+    if (lead)
+        return UBASE_ERR_UNHANDLED;
+#endif
+    /* the datagrams of the current batch were prepared for the former mode */
+    upipe_udpsink_clean_batch(upipe);
+    upipe_udpsink_set_upump(upipe, NULL);
+    upipe_udpsink->txtime_lead = lead;
+    return upipe_udpsink_apply_txtime(upipe);
 }
 
 /** @internal @This flushes all currently held buffers, and unblocks the
@@ -458,6 +914,7 @@ static int _upipe_udpsink_set_uri(struct upipe *upipe, const char *uri)
  */
 static int upipe_udpsink_flush(struct upipe *upipe)
 {
+    upipe_udpsink_clean_batch(upipe);
     if (upipe_udpsink_flush_input(upipe)) {
         upipe_udpsink_set_upump(upipe, NULL);
         /* All packets have been output, release again the pipe that has been
@@ -485,6 +942,7 @@ static int _upipe_udpsink_control(struct upipe *upipe,
             return upipe_control_provide_request(upipe, command, args);
 
         case UPIPE_ATTACH_UPUMP_MGR:
+            upipe_udpsink_clean_batch(upipe);
             upipe_udpsink_set_upump(upipe, NULL);
             return upipe_udpsink_attach_upump_mgr(upipe);
         case UPIPE_ATTACH_UCLOCK:
@@ -522,9 +980,10 @@ static int _upipe_udpsink_control(struct upipe *upipe,
         }
         case UPIPE_UDPSINK_SET_FD: {
             UBASE_SIGNATURE_CHECK(args, UPIPE_UDPSINK_SIGNATURE)
+            upipe_udpsink_clean_batch(upipe);
             upipe_udpsink_set_upump(upipe, NULL);
             upipe_udpsink->fd = va_arg(args, int );
-            return UBASE_ERR_NONE;
+            return upipe_udpsink_apply_txtime(upipe);
         }
         case UPIPE_UDPSINK_SET_PEER: {
             UBASE_SIGNATURE_CHECK(args, UPIPE_UDPSINK_SIGNATURE)
@@ -533,6 +992,43 @@ static int _upipe_udpsink_control(struct upipe *upipe,
             memcpy(&upipe_udpsink->addr, s, upipe_udpsink->addrlen);
             return UBASE_ERR_NONE;
         }
+        case UPIPE_UDPSINK_GET_BATCH: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_UDPSINK_SIGNATURE)
+            unsigned int *batch_p = va_arg(args, unsigned int *);
+            uint64_t *window_p = va_arg(args, uint64_t *);
+            if (batch_p != NULL)
+                *batch_p = upipe_udpsink->batch;
+            if (window_p != NULL)
+                *window_p = upipe_udpsink->window;
+            return UBASE_ERR_NONE;
+        }
+        case UPIPE_UDPSINK_SET_BATCH: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_UDPSINK_SIGNATURE)
+            unsigned int batch = va_arg(args, unsigned int);
+            uint64_t window = va_arg(args, uint64_t);
+            if (!batch || batch > UPIPE_UDPSINK_BATCH_MAX)
+                return UBASE_ERR_INVALID;
+#ifndef UPIPE_HAVE_SENDMMSG
+            if (batch > 1)
+                return UBASE_ERR_UNHANDLED;
+#endif
+            if (batch < upipe_udpsink->batch)
+                upipe_udpsink_clean_batch(upipe);
+            upipe_udpsink->batch = batch;
+            upipe_udpsink->window = window;
+            return UBASE_ERR_NONE;
+        }
+        case UPIPE_UDPSINK_GET_TXTIME: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_UDPSINK_SIGNATURE)
+            uint64_t *lead_p = va_arg(args, uint64_t *);
+            *lead_p = upipe_udpsink->txtime_lead;
+            return UBASE_ERR_NONE;
+        }
+        case UPIPE_UDPSINK_SET_TXTIME: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_UDPSINK_SIGNATURE)
+            uint64_t lead = va_arg(args, uint64_t);
+            return _upipe_udpsink_set_txtime(upipe, lead);
+        }
         case UPIPE_FLUSH:
             return upipe_udpsink_flush(upipe);
         default:
@@ -565,6 +1061,7 @@ static int upipe_udpsink_control(struct upipe *upipe, int command, va_list args)
 static void upipe_udpsink_free(struct upipe *upipe)
 {
     struct upipe_udpsink *upipe_udpsink = upipe_udpsink_from_upipe(upipe);
+    upipe_udpsink_clean_batch(upipe);
     if (likely(upipe_udpsink->fd != -1)) {
         if (likely(upipe_udpsink->uri != NULL))
             upipe_notice_va(upipe, "closing socket %s", upipe_udpsink->uri);
@@ -575,6 +1072,7 @@ static void upipe_udpsink_free(struct upipe *upipe)
     free(upipe_udpsink->uri);
     upipe_udpsink_clean_uclock(upipe);
     upipe_udpsink_clean_upump(upipe);
+    upipe_udpsink_clean_upump_batch(upipe);
     upipe_udpsink_clean_upump_mgr(upipe);
     upipe_udpsink_clean_input(upipe);
     upipe_udpsink_clean_urefcount(upipe);
@@ -28,6 +28,9 @@
  * @short Upipe source module for udp sockets
  */
 
+#define _GNU_SOURCE
+
+#include <upipe/config.h>
 #include <upipe/ubase.h>
 #include <upipe/uprobe.h>
 #include <upipe/uclock.h>
@@ -49,6 +52,7 @@
 #include <upipe/upipe_helper_uclock.h>
 #include <upipe/upipe_helper_output_size.h>
 #include <upipe-modules/upipe_udp_source.h>
+#include <upump-uring/upump_uring.h>
 #include "upipe_udp.h"
 
 #include <stdlib.h>
@@ -64,12 +68,22 @@
 #include <errno.h>
 #include <assert.h>
 #include <sys/socket.h>
+#include <time.h>
+
+#ifdef UPIPE_HAVE_LINUX_NET_TSTAMP_H
+#include <linux/net_tstamp.h>
+#endif
+#ifdef UPIPE_HAVE_LINUX_FILTER_H
+#include <linux/filter.h>
+#endif
 
 /** default size of buffers when unspecified */
 #define UBUF_DEFAULT_SIZE       4096
 
 #define UDP_DEFAULT_TTL 0
 #define UDP_DEFAULT_PORT 1234
+/** size of the control buffer receiving the timestamps */
+#define UDP_CONTROL_SIZE CMSG_SPACE(3 * sizeof(struct timespec))
 
 /** @hidden */
 static int upipe_udpsrc_check(struct upipe *upipe, struct uref *flow_format);
@@ -111,6 +125,14 @@ struct upipe_udpsrc {
     struct upump *upump;
     /** read size */
     unsigned int output_size;
+    /** number of datagrams received per system call */
+    unsigned int batch;
+    /** source of the reception dates */
+    enum upipe_udpsrc_timestamp timestamp;
+    /** steering policy of the SO_REUSEPORT group */
+    enum upipe_udpsrc_steering steering;
+    /** number of sockets in the SO_REUSEPORT group */
+    unsigned int nb_sockets;
 
     /** udp socket descriptor */
     int fd;
@@ -122,6 +144,17 @@ struct upipe_udpsrc {
     /** source address (size) */
     socklen_t addrlen;
 
+    /** buffer submitted to the io_uring event loop, or NULL */
+    struct uref *recv_uref;
+    /** description of the submitted buffer */
+    struct iovec recv_iovec;
+    /** source address of the submitted buffer */
+    struct sockaddr_storage recv_addr;
+    /** message header of the submitted buffer */
+    struct msghdr recv_msghdr;
+    /** control buffer of the submitted buffer */
+    uint8_t recv_control[UDP_CONTROL_SIZE];
+
     /** public upipe structure */
     struct upipe upipe;
 };
@@ -169,51 +202,37 @@ static struct upipe *upipe_udpsrc_alloc(struct upipe_mgr *mgr,
     upipe_udpsrc_init_upump(upipe);
     upipe_udpsrc_init_uclock(upipe);
     upipe_udpsrc_init_output_size(upipe, UBUF_DEFAULT_SIZE);
+    upipe_udpsrc->batch = 1;
+    upipe_udpsrc->timestamp = UPIPE_UDPSRC_TIMESTAMP_SOFTWARE;
+    upipe_udpsrc->steering = UPIPE_UDPSRC_STEERING_NONE;
+    upipe_udpsrc->nb_sockets = 1;
     upipe_udpsrc->fd = -1;
     upipe_udpsrc->uri = NULL;
     upipe_udpsrc->addrlen = 0;
+    upipe_udpsrc->recv_uref = NULL;
+    memset(&upipe_udpsrc->recv_msghdr, 0, sizeof(struct msghdr));
+    upipe_udpsrc->recv_msghdr.msg_name = &upipe_udpsrc->recv_addr;
+    upipe_udpsrc->recv_msghdr.msg_iov = &upipe_udpsrc->recv_iovec;
+    upipe_udpsrc->recv_msghdr.msg_iovlen = 1;
+    upipe_udpsrc->recv_msghdr.msg_control = upipe_udpsrc->recv_control;
     upipe_throw_ready(upipe);
     return upipe;
 }
 
-/** @internal @This reads data from the source and outputs it.
- * It is called either when the idler triggers (permanent storage mode) or
- * when data is available on the udp socket descriptor (live stream mode).
+/** @internal @This outputs a received datagram.
  *
- * @param upump description structure of the read watcher
+ * @param upipe description structure of the pipe
+ * @param uref buffer the datagram was received into (unmapped)
+ * @param ret size of the datagram, or -1 with errno set in case of error
+ * @param addr source address of the datagram
+ * @param addrlen size of the source address
+ * @param systime date of the reception
  */
-static void upipe_udpsrc_worker(struct upump *upump)
+static void upipe_udpsrc_process(struct upipe *upipe, struct uref *uref,
+                                 ssize_t ret, struct sockaddr_storage *addr,
+                                 socklen_t addrlen, uint64_t systime)
 {
-    struct upipe *upipe = upump_get_opaque(upump, struct upipe *);
     struct upipe_udpsrc *upipe_udpsrc = upipe_udpsrc_from_upipe(upipe);
-    uint64_t systime = 0; /* to keep gcc quiet */
-    if (unlikely(upipe_udpsrc->uclock != NULL))
-        systime = uclock_now(upipe_udpsrc->uclock);
-
-    struct uref *uref = uref_block_alloc(upipe_udpsrc->uref_mgr,
-                                         upipe_udpsrc->ubuf_mgr,
-                                         upipe_udpsrc->output_size);
-    if (unlikely(uref == NULL)) {
-        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
-        return;
-    }
-
-    uint8_t *buffer;
-    int output_size = -1;
-    if (unlikely(!ubase_check(uref_block_write(uref, 0, &output_size,
-                                               &buffer)))) {
-        uref_free(uref);
-        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
-        return;
-    }
-    assert(output_size == upipe_udpsrc->output_size);
-
-    struct sockaddr_storage addr;
-    socklen_t addrlen = sizeof(addr);
-
-    ssize_t ret = recvfrom(upipe_udpsrc->fd, buffer, upipe_udpsrc->output_size,
-                        0, (struct sockaddr*)&addr, &addrlen);
-    uref_block_unmap(uref, 0);
 
     if (unlikely(ret == -1)) {
         uref_free(uref);
@@ -236,11 +255,11 @@ static void upipe_udpsrc_worker(struct upump *upump)
         upipe_throw_source_end(upipe);
         return;
     } else if (addrlen != upipe_udpsrc->addrlen ||
-        memcmp(&addr, &upipe_udpsrc->addr, addrlen)) {
+        memcmp(addr, &upipe_udpsrc->addr, addrlen)) {
         upipe_throw(upipe, UPROBE_UDPSRC_NEW_PEER, UPIPE_UDPSRC_SIGNATURE,
-                &addr, &addrlen);
+                addr, &addrlen);
         upipe_udpsrc->addrlen = addrlen;
-        memcpy(&upipe_udpsrc->addr, &addr, addrlen);
+        memcpy(&upipe_udpsrc->addr, addr, addrlen);
     }
 
     if (unlikely(ret == 0)) {
@@ -259,6 +278,414 @@ static void upipe_udpsrc_worker(struct upump *upump)
     upipe_udpsrc_output(upipe, uref, &upipe_udpsrc->upump);
 }
 
+/** @internal @This returns the current date of the uclock and of the
+ * real-time clock, which is the reference of the timestamps of the kernel.
+ *
+ * @param upipe description structure of the pipe
+ * @param realtime_p filled in with the real-time date in nanoseconds
+ * @return current date of the uclock
+ */
+static uint64_t upipe_udpsrc_now(struct upipe *upipe, uint64_t *realtime_p)
+{
+    struct upipe_udpsrc *upipe_udpsrc = upipe_udpsrc_from_upipe(upipe);
+    struct timespec ts;
+    uint64_t systime = uclock_now(upipe_udpsrc->uclock);
+    clock_gettime(CLOCK_REALTIME, &ts);
+    *realtime_p = ts.tv_sec * UINT64_C(1000000000) + ts.tv_nsec;
+    return systime;
+}
+
+/** @internal @This extracts the timestamp of the kernel from a control
+ * message, preferably the hardware one.
+ *
+ * @param cmsg control message
+ * @param ts_p filled in with the timestamp
+ * @return false if the control message doesn't carry a timestamp
+ */
+static bool upipe_udpsrc_cmsg_timestamp(struct cmsghdr *cmsg,
+                                        struct timespec *ts_p)
+{
+    if (cmsg->cmsg_level != SOL_SOCKET)
+        return false;
+#ifdef SO_TIMESTAMPNS
+    if (cmsg->cmsg_type == SCM_TIMESTAMPNS) {
+        memcpy(ts_p, CMSG_DATA(cmsg), sizeof(struct timespec));
+        return true;
+    }
+#endif
+#ifdef SO_TIMESTAMPING
+    if (cmsg->cmsg_type == SCM_TIMESTAMPING) {
+        /* software, deprecated, and raw hardware timestamps */
+        struct timespec ts[3];
+        memcpy(ts, CMSG_DATA(cmsg), sizeof(ts));
+        *ts_p = ts[2].tv_sec || ts[2].tv_nsec ? ts[2] : ts[0];
+        return true;
+    }
+#endif
+    return false;
+}
+
+/** @internal @This returns the date of reception of a datagram, from the
+ * timestamp of the kernel.
+ *
+ * @param msghdr message header of the datagram
+ * @param systime date of the return of the system call
+ * @param realtime matching real-time date in nanoseconds
+ * @return date of reception of the datagram
+ */
+static uint64_t upipe_udpsrc_msg_systime(struct msghdr *msghdr,
+                                         uint64_t systime, uint64_t realtime)
+{
+    struct cmsghdr *cmsg;
+    for (cmsg = CMSG_FIRSTHDR(msghdr); cmsg != NULL;
+         cmsg = CMSG_NXTHDR(msghdr, cmsg)) {
+        struct timespec ts;
+        if (!upipe_udpsrc_cmsg_timestamp(cmsg, &ts))
+            continue;
+        /* ignore timestamps from the future or too far away, before
+         * converting them */
+        if (ts.tv_sec <= 0 || ts.tv_nsec < 0 || ts.tv_nsec >= 1000000000 ||
+            (uint64_t)ts.tv_sec > realtime / UINT64_C(1000000000))
+            continue;
+        uint64_t date = ts.tv_sec * UINT64_C(1000000000) + ts.tv_nsec;
+        if (date > realtime || realtime - date >= UINT64_C(1000000000))
+            continue;
+        uint64_t delay = (realtime - date) * UCLOCK_FREQ / UINT64_C(1000000000);
+        if (delay <= systime)
+            return systime - delay;
+    }
+    return systime;
+}
+
+/** @internal @This reads data from the source and outputs it.
+ * It is called either when the idler triggers (permanent storage mode) or
+ * when data is available on the udp socket descriptor (live stream mode).
+ *
+ * @param upump description structure of the read watcher
+ */
+static void upipe_udpsrc_worker(struct upump *upump)
+{
+    struct upipe *upipe = upump_get_opaque(upump, struct upipe *);
+    struct upipe_udpsrc *upipe_udpsrc = upipe_udpsrc_from_upipe(upipe);
+    struct uref *uref = uref_block_alloc(upipe_udpsrc->uref_mgr,
+                                         upipe_udpsrc->ubuf_mgr,
+                                         upipe_udpsrc->output_size);
+    if (unlikely(uref == NULL)) {
+        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+        return;
+    }
+
+    uint8_t *buffer;
+    int output_size = -1;
+    if (unlikely(!ubase_check(uref_block_write(uref, 0, &output_size,
+                                               &buffer)))) {
+        uref_free(uref);
+        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+        return;
+    }
+    assert(output_size == upipe_udpsrc->output_size);
+
+    struct sockaddr_storage addr;
+    struct iovec iovec = {
+        .iov_base = buffer,
+        .iov_len = upipe_udpsrc->output_size
+    };
+    uint8_t control[UDP_CONTROL_SIZE];
+    struct msghdr msghdr = {
+        .msg_name = &addr,
+        .msg_namelen = sizeof(addr),
+        .msg_iov = &iovec,
+        .msg_iovlen = 1,
+        .msg_control = control,
+        .msg_controllen = sizeof(control),
+        .msg_flags = 0
+    };
+
+    ssize_t ret = recvmsg(upipe_udpsrc->fd, &msghdr, 0);
+    uint64_t systime = 0; /* to keep gcc quiet */
+    if (unlikely(upipe_udpsrc->uclock != NULL)) {
+        uint64_t realtime;
+        systime = upipe_udpsrc_now(upipe, &realtime);
+        if (ret != -1)
+            systime = upipe_udpsrc_msg_systime(&msghdr, systime, realtime);
+    }
+    uref_block_unmap(uref, 0);
+
+    upipe_udpsrc_process(upipe, uref, ret, &addr, msghdr.msg_namelen,
+                         systime);
+}
+
+#ifdef UPIPE_HAVE_RECVMMSG
+/** @internal @This reads a batch of datagrams from the source with a single
+ * system call, and outputs them.
+ *
+ * @param upump description structure of the read watcher
+ */
+static void upipe_udpsrc_worker_batch(struct upump *upump)
+{
+    struct upipe *upipe = upump_get_opaque(upump, struct upipe *);
+    struct upipe_udpsrc *upipe_udpsrc = upipe_udpsrc_from_upipe(upipe);
+    unsigned int batch = upipe_udpsrc->batch;
+    struct uref *urefs[batch];
+    struct iovec iovecs[batch];
+    struct sockaddr_storage addrs[batch];
+    struct mmsghdr msgs[batch];
+    uint8_t controls[batch][UDP_CONTROL_SIZE];
+
+    for (unsigned int i = 0; i < batch; i++) {
+        urefs[i] = uref_block_alloc(upipe_udpsrc->uref_mgr,
+                                    upipe_udpsrc->ubuf_mgr,
+                                    upipe_udpsrc->output_size);
+        uint8_t *buffer;
+        int output_size = -1;
+        if (unlikely(urefs[i] == NULL ||
+                     !ubase_check(uref_block_write(urefs[i], 0, &output_size,
+                                                   &buffer)))) {
+            if (urefs[i] != NULL)
+                uref_free(urefs[i]);
+            while (i-- > 0) {
+                uref_block_unmap(urefs[i], 0);
+                uref_free(urefs[i]);
+            }
+            upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+            return;
+        }
+        iovecs[i].iov_base = buffer;
+        iovecs[i].iov_len = output_size;
+        memset(&msgs[i], 0, sizeof(struct mmsghdr));
+        msgs[i].msg_hdr.msg_name = &addrs[i];
+        msgs[i].msg_hdr.msg_namelen = sizeof(struct sockaddr_storage);
+        msgs[i].msg_hdr.msg_iov = &iovecs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+        if (upipe_udpsrc->uclock != NULL) {
+            msgs[i].msg_hdr.msg_control = controls[i];
+            msgs[i].msg_hdr.msg_controllen = sizeof(controls[i]);
+        }
+    }
+
+    int fd = upipe_udpsrc->fd;
+    int ret = recvmmsg(fd, msgs, batch, MSG_DONTWAIT, NULL);
+    uint64_t systime = 0, realtime = 0;
+    if (unlikely(upipe_udpsrc->uclock != NULL))
+        systime = upipe_udpsrc_now(upipe, &realtime);
+    for (unsigned int i = 0; i < batch; i++)
+        uref_block_unmap(urefs[i], 0);
+
+    if (unlikely(ret == -1)) {
+        for (unsigned int i = 1; i < batch; i++)
+            uref_free(urefs[i]);
+        upipe_udpsrc_process(upipe, urefs[0], ret, &addrs[0],
+                             msgs[0].msg_hdr.msg_namelen, systime);
+        return;
+    }
+
+    unsigned int i;
+    for (i = 0; i < (unsigned int)ret && upipe_udpsrc->upump == upump &&
+                upipe_udpsrc->fd == fd; i++) {
+        uint64_t date = systime;
+        if (unlikely(upipe_udpsrc->uclock != NULL))
+            date = upipe_udpsrc_msg_systime(&msgs[i].msg_hdr,
+                                            systime, realtime);
+        upipe_udpsrc_process(upipe, urefs[i], msgs[i].msg_len, &addrs[i],
+                             msgs[i].msg_hdr.msg_namelen, date);
+    }
+    /* the remaining buffers are empty, or the socket was closed */
+    for ( ; i < batch; i++)
+        uref_free(urefs[i]);
+}
+#endif
+
+/** @internal @This enables the timestamping of datagrams by the kernel, in
+ * live mode.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_udpsrc_set_timestamping(struct upipe *upipe)
+{
+    struct upipe_udpsrc *upipe_udpsrc = upipe_udpsrc_from_upipe(upipe);
+    enum upipe_udpsrc_timestamp timestamp = upipe_udpsrc->timestamp;
+    if (upipe_udpsrc->fd == -1)
+        return;
+    if (upipe_udpsrc->uclock == NULL)
+        timestamp = UPIPE_UDPSRC_TIMESTAMP_NONE;
+
+#if defined(SO_TIMESTAMPING) && defined(UPIPE_HAVE_LINUX_NET_TSTAMP_H)
+    int flags = 0;
+    if (timestamp == UPIPE_UDPSRC_TIMESTAMP_HARDWARE)
+        flags = SOF_TIMESTAMPING_RX_HARDWARE | SOF_TIMESTAMPING_RAW_HARDWARE |
+                SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE;
+    if (setsockopt(upipe_udpsrc->fd, SOL_SOCKET, SO_TIMESTAMPING,
+                   &flags, sizeof(flags)) < 0 && flags) {
+        upipe_warn_va(upipe, "unable to set hardware timestamping (%m)");
+        timestamp = UPIPE_UDPSRC_TIMESTAMP_SOFTWARE;
+    }
+#else
+    if (timestamp == UPIPE_UDPSRC_TIMESTAMP_HARDWARE) {
+        upipe_warn(upipe, "hardware timestamping is not supported");
+        timestamp = UPIPE_UDPSRC_TIMESTAMP_SOFTWARE;
+    }
+#endif
+
+#ifdef SO_TIMESTAMPNS
+    /* only one kind of timestamp is requested from the kernel */
+    int enable = timestamp == UPIPE_UDPSRC_TIMESTAMP_SOFTWARE;
+    if (setsockopt(upipe_udpsrc->fd, SOL_SOCKET, SO_TIMESTAMPNS,
+                   &enable, sizeof(enable)) < 0 && enable)
+        upipe_warn_va(upipe, "unable to set timestamping (%m)");
+#endif
+}
+
+/** @internal @This attaches the steering program to the SO_REUSEPORT group
+ * of the socket.
+ *
+ * @param upipe description structure of the pipe
+ * @return an error code
+ */
+static int upipe_udpsrc_set_steering_prog(struct upipe *upipe)
+{
+    struct upipe_udpsrc *upipe_udpsrc = upipe_udpsrc_from_upipe(upipe);
+    if (upipe_udpsrc->fd == -1)
+        return UBASE_ERR_NONE;
+
+#if defined(SO_ATTACH_REUSEPORT_CBPF) && defined(UPIPE_HAVE_LINUX_FILTER_H)
+    if (upipe_udpsrc->steering == UPIPE_UDPSRC_STEERING_NONE) {
+#ifdef SO_DETACH_REUSEPORT_BPF
+        int dummy = 0;
+        setsockopt(upipe_udpsrc->fd, SOL_SOCKET, SO_DETACH_REUSEPORT_BPF,
+                   &dummy, sizeof(dummy));
+#endif
+        return UBASE_ERR_NONE;
+    }
+
+    /* the data of the datagram starts after the UDP header */
+    uint32_t offset = 8; /* SSRC in the RTP header */
+    if (upipe_udpsrc->steering == UPIPE_UDPSRC_STEERING_SOURCE) {
+        struct sockaddr_storage addr;
+        socklen_t addrlen = sizeof(addr);
+        if (getsockname(upipe_udpsrc->fd, (struct sockaddr *)&addr,
+                        &addrlen) < 0)
+            addr.ss_family = AF_INET;
+        /* last 32 bits of the source address */
+        offset = SKF_NET_OFF + (addr.ss_family == AF_INET6 ? 20 : 12);
+    }
+
+    struct sock_filter code[] = {
+        { BPF_LD | BPF_W | BPF_ABS, 0, 0, offset },
+        { BPF_ALU | BPF_MOD | BPF_K, 0, 0, upipe_udpsrc->nb_sockets },
+        { BPF_RET | BPF_A, 0, 0, 0 },
+    };
+    struct sock_fprog prog = {
+        .len = UBASE_ARRAY_SIZE(code),
+        .filter = code,
+    };
+    if (unlikely(setsockopt(upipe_udpsrc->fd, SOL_SOCKET,
+                            SO_ATTACH_REUSEPORT_CBPF,
+                            &prog, sizeof(prog)) < 0)) {
+        upipe_err_va(upipe, "unable to attach steering program (%m)");
+        return UBASE_ERR_EXTERNAL;
+    }
+    return UBASE_ERR_NONE;
+#else
+    if (upipe_udpsrc->steering == UPIPE_UDPSRC_STEERING_NONE)
+        return UBASE_ERR_NONE;
+    upipe_err(upipe, "steering programs are not supported");
+    return UBASE_ERR_UNHANDLED;
+#endif
+}
+
+/** @internal @This allocates a buffer and maps it into the message header
+ * submitted to the io_uring event loop.
+ *
+ * @param upipe description structure of the pipe
+ * @return an error code
+ */
+static int upipe_udpsrc_prepare_recv(struct upipe *upipe)
+{
+    struct upipe_udpsrc *upipe_udpsrc = upipe_udpsrc_from_upipe(upipe);
+    struct uref *uref = uref_block_alloc(upipe_udpsrc->uref_mgr,
+                                         upipe_udpsrc->ubuf_mgr,
+                                         upipe_udpsrc->output_size);
+    if (unlikely(uref == NULL))
+        return UBASE_ERR_ALLOC;
+
+    uint8_t *buffer;
+    int output_size = -1;
+    if (unlikely(!ubase_check(uref_block_write(uref, 0, &output_size,
+                                               &buffer)))) {
+        uref_free(uref);
+        return UBASE_ERR_ALLOC;
+    }
+
+    upipe_udpsrc->recv_uref = uref;
+    upipe_udpsrc->recv_iovec.iov_base = buffer;
+    upipe_udpsrc->recv_iovec.iov_len = output_size;
+    upipe_udpsrc->recv_msghdr.msg_namelen = sizeof(struct sockaddr_storage);
+    upipe_udpsrc->recv_msghdr.msg_controllen =
+        sizeof(upipe_udpsrc->recv_control);
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This releases the buffer submitted to the io_uring event loop.
+ * The pump must have been freed before.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_udpsrc_clean_recv(struct upipe *upipe)
+{
+    struct upipe_udpsrc *upipe_udpsrc = upipe_udpsrc_from_upipe(upipe);
+    if (upipe_udpsrc->recv_uref != NULL) {
+        uref_block_unmap(upipe_udpsrc->recv_uref, 0);
+        uref_free(upipe_udpsrc->recv_uref);
+        upipe_udpsrc->recv_uref = NULL;
+    }
+}
+
+/** @internal @This outputs the data received by the io_uring event loop
+ * directly into the buffer of the pipe, and submits a new buffer.
+ *
+ * @param upump description structure of the reception pump
+ */
+static void upipe_udpsrc_worker_recv(struct upump *upump)
+{
+    struct upipe *upipe = upump_get_opaque(upump, struct upipe *);
+    struct upipe_udpsrc *upipe_udpsrc = upipe_udpsrc_from_upipe(upipe);
+    uint64_t systime = 0; /* to keep gcc quiet */
+    int result;
+    if (unlikely(!ubase_check(upump_uring_get_result(upump, &result))))
+        return;
+    if (result == -EINTR || result == -EAGAIN || result == -EWOULDBLOCK)
+        /* the same buffer is submitted again */
+        return;
+
+    struct uref *uref = upipe_udpsrc->recv_uref;
+    struct sockaddr_storage addr;
+    socklen_t addrlen = upipe_udpsrc->recv_msghdr.msg_namelen;
+    memcpy(&addr, &upipe_udpsrc->recv_addr, addrlen);
+    if (unlikely(upipe_udpsrc->uclock != NULL)) {
+        uint64_t realtime;
+        systime = upipe_udpsrc_now(upipe, &realtime);
+        if (result >= 0)
+            systime = upipe_udpsrc_msg_systime(&upipe_udpsrc->recv_msghdr,
+                                               systime, realtime);
+    }
+    uref_block_unmap(uref, 0);
+    upipe_udpsrc->recv_uref = NULL;
+
+    if (unlikely(!ubase_check(upipe_udpsrc_prepare_recv(upipe)))) {
+        uref_free(uref);
+        upipe_udpsrc_set_upump(upipe, NULL);
+        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+        return;
+    }
+
+    ssize_t ret = result;
+    if (result < 0) {
+        errno = -result;
+        ret = -1;
+    }
+    upipe_udpsrc_process(upipe, uref, ret, &addr, addrlen, systime);
+}
+
 /** @internal @This checks if the pump may be allocated.
  *
  * @param upipe description structure of the pipe
@@ -299,9 +726,28 @@ static int upipe_udpsrc_check(struct upipe *upipe, struct uref *flow_format)
 
     if (upipe_udpsrc->fd != -1 && upipe_udpsrc->upump == NULL) {
         struct upump *upump;
-        upump = upump_alloc_fd_read(upipe_udpsrc->upump_mgr,
-                                    upipe_udpsrc_worker, upipe, upipe->refcount,
-                                    upipe_udpsrc->fd);
+        /* the previous pump, if any, doesn't use the buffer anymore */
+        upipe_udpsrc_clean_recv(upipe);
+        upipe_udpsrc_set_timestamping(upipe);
+        if (upipe_udpsrc->upump_mgr->signature == UPUMP_URING_SIGNATURE) {
+            if (unlikely(!ubase_check(upipe_udpsrc_prepare_recv(upipe)))) {
+                upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+                return UBASE_ERR_ALLOC;
+            }
+            upump = upump_uring_alloc_recvmsg(upipe_udpsrc->upump_mgr,
+                                              upipe_udpsrc_worker_recv, upipe,
+                                              upipe->refcount,
+                                              upipe_udpsrc->fd,
+                                              &upipe_udpsrc->recv_msghdr);
+        } else {
+            upump_cb cb = upipe_udpsrc_worker;
+#ifdef UPIPE_HAVE_RECVMMSG
+            if (upipe_udpsrc->batch > 1)
+                cb = upipe_udpsrc_worker_batch;
+#endif
+            upump = upump_alloc_fd_read(upipe_udpsrc->upump_mgr, cb, upipe,
+                                        upipe->refcount, upipe_udpsrc->fd);
+        }
         if (unlikely(upump == NULL)) {
             upipe_throw_fatal(upipe, UBASE_ERR_UPUMP);
             return UBASE_ERR_UPUMP;
@@ -362,10 +808,39 @@ static int upipe_udpsrc_set_uri(struct upipe *upipe, const char *uri)
         upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
         return UBASE_ERR_ALLOC;
     }
+    int err = upipe_udpsrc_set_steering_prog(upipe);
+    if (unlikely(!ubase_check(err))) {
+        ubase_clean_fd(&upipe_udpsrc->fd);
+        ubase_clean_str(&upipe_udpsrc->uri);
+        return err;
+    }
     upipe_notice_va(upipe, "opening udp socket %s", upipe_udpsrc->uri);
     return UBASE_ERR_NONE;
 }
 
+/** @internal @This sets the number of datagrams received per system call.
+ *
+ * @param upipe description structure of the pipe
+ * @param batch number of datagrams
+ * @return an error code
+ */
+static int upipe_udpsrc_set_batch_real(struct upipe *upipe, unsigned int batch)
+{
+    struct upipe_udpsrc *upipe_udpsrc = upipe_udpsrc_from_upipe(upipe);
+    if (unlikely(!batch || batch > UPIPE_UDPSRC_BATCH_MAX))
+        return UBASE_ERR_INVALID;
+#ifndef UPIPE_HAVE_RECVMMSG
+    if (batch > 1)
+        return UBASE_ERR_UNHANDLED;
+#endif
+    if (batch == upipe_udpsrc->batch)
+        return UBASE_ERR_NONE;
+    upipe_udpsrc->batch = batch;
+    /* the pump is allocated again with the right worker */
+    upipe_udpsrc_set_upump(upipe, NULL);
+    return UBASE_ERR_NONE;
+}
+
 /** @internal @This processes control commands on a udp socket source pipe.
  *
  * @param upipe description structure of the pipe
@@ -416,6 +891,54 @@ static int _upipe_udpsrc_control(struct upipe *upipe,
             upipe_udpsrc->fd = va_arg(args, int );
             return UBASE_ERR_NONE;
         }
+        case UPIPE_UDPSRC_GET_BATCH: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_UDPSRC_SIGNATURE)
+            unsigned int *batch_p = va_arg(args, unsigned int *);
+            *batch_p = upipe_udpsrc->batch;
+            return UBASE_ERR_NONE;
+        }
+        case UPIPE_UDPSRC_SET_BATCH: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_UDPSRC_SIGNATURE)
+            unsigned int batch = va_arg(args, unsigned int);
+            return upipe_udpsrc_set_batch_real(upipe, batch);
+        }
+        case UPIPE_UDPSRC_GET_TIMESTAMP: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_UDPSRC_SIGNATURE)
+            int *timestamp_p = va_arg(args, int *);
+            *timestamp_p = upipe_udpsrc->timestamp;
+            return UBASE_ERR_NONE;
+        }
+        case UPIPE_UDPSRC_SET_TIMESTAMP: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_UDPSRC_SIGNATURE)
+            int timestamp = va_arg(args, int);
+            if (timestamp < UPIPE_UDPSRC_TIMESTAMP_NONE ||
+                timestamp > UPIPE_UDPSRC_TIMESTAMP_HARDWARE)
+                return UBASE_ERR_INVALID;
+            upipe_udpsrc->timestamp = timestamp;
+            upipe_udpsrc_set_timestamping(upipe);
+            return UBASE_ERR_NONE;
+        }
+        case UPIPE_UDPSRC_GET_STEERING: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_UDPSRC_SIGNATURE)
+            int *steering_p = va_arg(args, int *);
+            unsigned int *nb_sockets_p = va_arg(args, unsigned int *);
+            if (steering_p != NULL)
+                *steering_p = upipe_udpsrc->steering;
+            if (nb_sockets_p != NULL)
+                *nb_sockets_p = upipe_udpsrc->nb_sockets;
+            return UBASE_ERR_NONE;
+        }
+        case UPIPE_UDPSRC_SET_STEERING: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_UDPSRC_SIGNATURE)
+            int steering = va_arg(args, int);
+            unsigned int nb_sockets = va_arg(args, unsigned int);
+            if (steering < UPIPE_UDPSRC_STEERING_NONE ||
+                steering > UPIPE_UDPSRC_STEERING_SSRC || !nb_sockets)
+                return UBASE_ERR_INVALID;
+            upipe_udpsrc->steering = steering;
+            upipe_udpsrc->nb_sockets = nb_sockets;
+            return upipe_udpsrc_set_steering_prog(upipe);
+        }
         default:
             return UBASE_ERR_UNHANDLED;
     }
@@ -456,6 +979,7 @@ static void upipe_udpsrc_free(struct upipe *upipe)
     upipe_udpsrc_clean_output_size(upipe);
     upipe_udpsrc_clean_uclock(upipe);
     upipe_udpsrc_clean_upump(upipe);
+    upipe_udpsrc_clean_recv(upipe);
     upipe_udpsrc_clean_upump_mgr(upipe);
     upipe_udpsrc_clean_output(upipe);
     upipe_udpsrc_clean_ubuf_mgr(upipe);
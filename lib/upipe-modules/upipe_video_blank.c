@@ -284,17 +284,25 @@ static int upipe_vblk_set_flow_def(struct upipe *upipe,
     } else {
         uref_pic_delete_progressive(flow_def_dup);
     }
-    upipe_vblk_store_flow_def(upipe, flow_def_dup);
 
-    if (upipe_vblk->ubuf) {
-        ubuf_free(upipe_vblk->ubuf);
-        upipe_vblk->ubuf = NULL;
-    }
+    /* the blank picture is shared by all the outputs, keep it as long as
+     * the format does not change */
+    bool same_format = upipe_vblk->flow_def != NULL &&
+        uref_pic_flow_compare_format(upipe_vblk->flow_def, flow_def_dup) &&
+        !uref_pic_flow_cmp_hsize(upipe_vblk->flow_def, flow_def_dup) &&
+        !uref_pic_flow_cmp_vsize(upipe_vblk->flow_def, flow_def_dup);
+    upipe_vblk_store_flow_def(upipe, flow_def_dup);
 
     if (upipe_vblk->ubuf_mgr &&
         !ubase_check(ubuf_mgr_check(upipe_vblk->ubuf_mgr, flow_def_dup))) {
         ubuf_mgr_release(upipe_vblk->ubuf_mgr);
         upipe_vblk->ubuf_mgr = NULL;
+        same_format = false;
+    }
+
+    if (upipe_vblk->ubuf && !same_format) {
+        ubuf_free(upipe_vblk->ubuf);
+        upipe_vblk->ubuf = NULL;
     }
 
     return UBASE_ERR_NONE;
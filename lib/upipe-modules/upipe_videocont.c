@@ -93,8 +93,10 @@ struct upipe_videocont {
     uint64_t latency;
     /** last pts received from source */
     uint64_t last_pts;
-    /** pointer value of last taken uref, for debug purposes */
+    /** last taken uref, still buffered in the current input, or NULL */
     struct uref *last_uref;
+    /** counters */
+    struct upipe_videocont_stats stats;
 
     /** manager to create input subpipes */
     struct upipe_mgr sub_mgr;
@@ -340,6 +342,8 @@ static void upipe_videocont_sub_dead(struct upipe *upipe)
     ulist_delete_foreach (&upipe_videocont_sub->urefs, uchain, uchain_tmp) {
         struct uref *uref = uref_from_uchain(uchain);
         ulist_delete(uchain);
+        if (uref == upipe_videocont->last_uref)
+            upipe_videocont->last_uref = NULL;
         uref_free(uref);
     }
     if (upipe == upipe_videocont->input_cur) {
@@ -405,6 +409,7 @@ static struct upipe *upipe_videocont_alloc(struct upipe_mgr *mgr,
     upipe_videocont->flow_input_format = false;
     upipe_videocont->flow_def_uptodate = false;
     upipe_videocont->last_uref = NULL;
+    memset(&upipe_videocont->stats, 0, sizeof(upipe_videocont->stats));
 
     upipe_throw_ready(upipe);
 
@@ -521,6 +526,11 @@ static void upipe_videocont_input(struct upipe *upipe, struct uref *uref,
                     pts + upipe_videocont->latency < next_pts - MAX_RETENTION) {
                     upipe_verbose_va(upipe, "(%d) deleted uref %p (%"PRIu64")",
                                      subs, uref_uchain, pts);
+                    if (uref_uchain == upipe_videocont->last_uref)
+                        upipe_videocont->last_uref = NULL;
+                    else if (upipe_videocont_sub_to_upipe(sub) ==
+                             upipe_videocont->input_cur)
+                        upipe_videocont->stats.dropped++;
                     ulist_delete(uchain);
                     uref_free(uref_uchain);
                 } else {
@@ -548,12 +558,14 @@ static void upipe_videocont_input(struct upipe *upipe, struct uref *uref,
 
     upipe_verbose_va(upipe, "attached ubuf %p (%"PRIu64") next %"PRIu64,
                      next_uref->ubuf, pts, next_pts);
+    /* the picture buffer is shared by reference, even when repeated */
     uref_attach_ubuf(uref, ubuf_dup(next_uref->ubuf));
     uref_attr_import(uref, next_uref);
     uref_clock_delete_rate(uref);
     if (upipe_videocont->last_uref == next_uref) {
-        upipe_warn_va(upipe, "reusing the same picture %"PRIu64" %"PRIu64,
+        upipe_verbose_va(upipe, "reusing the same picture %"PRIu64" %"PRIu64,
                   pts + upipe_videocont->latency, next_pts + upipe_videocont->tolerance);
+        upipe_videocont->stats.repeated++;
     }
     upipe_videocont->last_uref = next_uref;
     sub_attached = true;
@@ -578,6 +590,9 @@ output:
         upipe_videocont->flow_input_format = sub_attached;
         upipe_videocont->flow_def_uptodate = true;
     }
+    if (!sub_attached)
+        upipe_videocont->stats.blank++;
+    upipe_videocont->stats.output++;
     upipe_verbose_va(upipe, "outputting picture %p (%"PRIu64")", uref, next_pts);
     upipe_videocont_output(upipe, uref, upump_p);
 }
@@ -731,6 +746,13 @@ static int upipe_videocont_control(struct upipe *upipe,
             const char **name_p = va_arg(args, const char **);
             return _upipe_videocont_get_current_input(upipe, name_p);
         }
+        case UPIPE_VIDEOCONT_GET_STATS: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_VIDEOCONT_SIGNATURE)
+            struct upipe_videocont_stats *stats =
+                va_arg(args, struct upipe_videocont_stats *);
+            *stats = upipe_videocont->stats;
+            return UBASE_ERR_NONE;
+        }
 
         default:
             return UBASE_ERR_UNHANDLED;
@@ -63,8 +63,12 @@ struct upipe_work_mgr {
     struct upipe_mgr *qsrc_mgr;
     /** pointer to queue sink manager */
     struct upipe_mgr *qsink_mgr;
-    /** pointer to xfer manager */
-    struct upipe_mgr *xfer_mgr;
+    /** number of xfer managers in the pool */
+    unsigned int nb_xfer_mgrs;
+    /** pool of xfer managers, one per remote thread */
+    struct upipe_mgr **xfer_mgrs;
+    /** number of live worker pipes per xfer manager */
+    unsigned int *loads;
 
     /** public upipe_mgr structure */
     struct upipe_mgr mgr;
@@ -107,6 +111,9 @@ struct upipe_work {
     /** list of inner pipes that may require @ref upipe_attach_upump_mgr */
     struct uchain upump_mgr_pipes;
 
+    /** index of the xfer manager running the remote subpipeline */
+    unsigned int thread;
+
     /** true if @ref upipe_bin_freeze has been called */
     bool frozen;
 
@@ -156,6 +163,21 @@ static int upipe_work_out_qsrc_probe(struct uprobe *uprobe, struct upipe *inner,
     return uprobe_throw_next(uprobe, inner, event, args);
 }
 
+/** @internal @This returns the index of the least loaded xfer manager of
+ * the pool.
+ *
+ * @param work_mgr private context of the worker manager
+ * @return index of the xfer manager
+ */
+static unsigned int upipe_work_mgr_pick(struct upipe_work_mgr *work_mgr)
+{
+    unsigned int best = 0;
+    for (unsigned int i = 1; i < work_mgr->nb_xfer_mgrs; i++)
+        if (work_mgr->loads[i] < work_mgr->loads[best])
+            best = i;
+    return best;
+}
+
 /** @internal @This allocates a worker pipe.
  *
  * @param mgr common management structure
@@ -199,12 +221,15 @@ static struct upipe *_upipe_work_alloc(struct upipe_mgr *mgr,
             break;
     }
 
-    if (unlikely(!work_mgr->xfer_mgr))
+    if (unlikely(!work_mgr->nb_xfer_mgrs))
         goto error;
 
     if (unlikely(remote == NULL))
         goto error;
 
+    unsigned int thread = upipe_work_mgr_pick(work_mgr);
+    struct upipe_mgr *xfer_mgr = work_mgr->xfer_mgrs[thread];
+
     struct upipe_work *upipe_work = malloc(sizeof(struct upipe_work));
     if (unlikely(upipe_work == NULL))
         goto error;
@@ -218,6 +243,8 @@ static struct upipe *_upipe_work_alloc(struct upipe_mgr *mgr,
     upipe_work_init_bin_input(upipe);
     upipe_work_init_bin_output(upipe);
     ulist_init(&upipe_work->upump_mgr_pipes);
+    upipe_work->thread = thread;
+    work_mgr->loads[thread]++;
 
     uprobe_init(&upipe_work->in_qsrc_probe, upipe_work_in_qsrc_probe,
                 uprobe_use(uprobe_remote));
@@ -277,7 +304,7 @@ static struct upipe *_upipe_work_alloc(struct upipe_mgr *mgr,
         upipe_work_store_bin_output(upipe, upipe_use(out_qsrc));
     }
 
-    struct upipe *last_remote_xfer = upipe_xfer_alloc(work_mgr->xfer_mgr,
+    struct upipe *last_remote_xfer = upipe_xfer_alloc(xfer_mgr,
             uprobe_pfx_alloc(uprobe_use(&upipe_work->proxy_probe),
                              UPROBE_LOG_VERBOSE, "lin_last_xfer"),
             upipe_use(last_remote));
@@ -291,7 +318,7 @@ static struct upipe *_upipe_work_alloc(struct upipe_mgr *mgr,
 
     /* remote */
     if (last_remote != remote) {
-        struct upipe *remote_xfer = upipe_xfer_alloc(work_mgr->xfer_mgr,
+        struct upipe *remote_xfer = upipe_xfer_alloc(xfer_mgr,
                 uprobe_pfx_alloc(uprobe_use(&upipe_work->proxy_probe),
                                  UPROBE_LOG_VERBOSE, "lin_xfer"),
                 upipe_use(remote));
@@ -332,7 +359,7 @@ static struct upipe *_upipe_work_alloc(struct upipe_mgr *mgr,
             upipe_set_max_length(upipe_work->in_qsink,
                                       in_queue_length - UINT8_MAX);
 
-        struct upipe *in_qsrc_xfer = upipe_xfer_alloc(work_mgr->xfer_mgr,
+        struct upipe *in_qsrc_xfer = upipe_xfer_alloc(xfer_mgr,
                 uprobe_pfx_alloc(uprobe_use(&upipe_work->proxy_probe),
                                  UPROBE_LOG_VERBOSE, "in_qsrc_xfer"),
                 in_qsrc);
@@ -372,7 +399,8 @@ static int upipe_work_freeze(struct upipe *upipe)
         return UBASE_ERR_NONE;
 
     struct upipe_work_mgr *work_mgr = upipe_work_mgr_from_upipe_mgr(upipe->mgr);
-    UBASE_RETURN(upipe_xfer_mgr_freeze(work_mgr->xfer_mgr));
+    UBASE_RETURN(upipe_xfer_mgr_freeze(
+                work_mgr->xfer_mgrs[upipe_work->thread]));
     upipe_work->frozen = true;
     return UBASE_ERR_NONE;
 }
@@ -389,7 +417,8 @@ static int upipe_work_thaw(struct upipe *upipe)
         return UBASE_ERR_NONE;
 
     struct upipe_work_mgr *work_mgr = upipe_work_mgr_from_upipe_mgr(upipe->mgr);
-    UBASE_RETURN(upipe_xfer_mgr_thaw(work_mgr->xfer_mgr));
+    UBASE_RETURN(upipe_xfer_mgr_thaw(
+                work_mgr->xfer_mgrs[upipe_work->thread]));
     upipe_work->frozen = false;
     return UBASE_ERR_NONE;
 }
@@ -489,6 +518,8 @@ static void upipe_work_free(struct upipe *upipe)
 static void upipe_work_no_ref(struct upipe *upipe)
 {
     struct upipe_work *upipe_work = upipe_work_from_upipe(upipe);
+    struct upipe_work_mgr *work_mgr = upipe_work_mgr_from_upipe_mgr(upipe->mgr);
+    work_mgr->loads[upipe_work->thread]--;
     upipe_work_clean_bin_input(upipe);
     upipe_work_clean_bin_output(upipe);
     upipe_release(upipe_work->first_remote_xfer);
@@ -514,7 +545,10 @@ static void upipe_work_mgr_free(struct urefcount *urefcount)
         upipe_work_mgr_from_urefcount(urefcount);
     upipe_mgr_release(work_mgr->qsrc_mgr);
     upipe_mgr_release(work_mgr->qsink_mgr);
-    upipe_mgr_release(work_mgr->xfer_mgr);
+    for (unsigned int i = 0; i < work_mgr->nb_xfer_mgrs; i++)
+        upipe_mgr_release(work_mgr->xfer_mgrs[i]);
+    free(work_mgr->xfer_mgrs);
+    free(work_mgr->loads);
 
     urefcount_clean(urefcount);
     free(work_mgr);
@@ -569,23 +603,41 @@ static int upipe_work_mgr_control(struct upipe_mgr *mgr,
     }
 }
 
-/** @This returns the management structure for all worker pipes.
+/** @This returns the management structure for worker pipes multiplexed
+ * onto a pool of remote threads. Each new worker pipe runs its remote
+ * subpipeline in the thread of the pool which currently has the fewest live
+ * worker pipes.
  *
- * @param xfer_mgr manager to transfer pipes to the remote thread
+ * @param xfer_mgrs array of managers to transfer pipes to the remote threads
+ * @param nb_xfer_mgrs number of managers in the array
  * @return pointer to manager
  */
-struct upipe_mgr *upipe_work_mgr_alloc(struct upipe_mgr *xfer_mgr)
+struct upipe_mgr *upipe_work_pool_mgr_alloc(struct upipe_mgr **xfer_mgrs,
+                                            unsigned int nb_xfer_mgrs)
 {
-    assert(xfer_mgr != NULL);
+    assert(xfer_mgrs != NULL);
+    assert(nb_xfer_mgrs);
     struct upipe_work_mgr *work_mgr =
         malloc(sizeof(struct upipe_work_mgr));
     if (unlikely(work_mgr == NULL))
         return NULL;
 
     memset(work_mgr, 0, sizeof(*work_mgr));
+    work_mgr->xfer_mgrs = malloc(sizeof(struct upipe_mgr *) * nb_xfer_mgrs);
+    work_mgr->loads = calloc(nb_xfer_mgrs, sizeof(unsigned int));
+    if (unlikely(work_mgr->xfer_mgrs == NULL || work_mgr->loads == NULL)) {
+        free(work_mgr->xfer_mgrs);
+        free(work_mgr->loads);
+        free(work_mgr);
+        return NULL;
+    }
+    for (unsigned int i = 0; i < nb_xfer_mgrs; i++) {
+        assert(xfer_mgrs[i] != NULL);
+        work_mgr->xfer_mgrs[i] = upipe_mgr_use(xfer_mgrs[i]);
+    }
+    work_mgr->nb_xfer_mgrs = nb_xfer_mgrs;
     work_mgr->qsrc_mgr = upipe_qsrc_mgr_alloc();
     work_mgr->qsink_mgr = upipe_qsink_mgr_alloc();
-    work_mgr->xfer_mgr = upipe_mgr_use(xfer_mgr);
 
     urefcount_init(upipe_work_mgr_to_urefcount(work_mgr),
                    upipe_work_mgr_free);
@@ -597,3 +649,14 @@ struct upipe_mgr *upipe_work_mgr_alloc(struct upipe_mgr *xfer_mgr)
     work_mgr->mgr.upipe_mgr_control = upipe_work_mgr_control;
     return upipe_work_mgr_to_upipe_mgr(work_mgr);
 }
+
+/** @This returns the management structure for all worker pipes.
+ *
+ * @param xfer_mgr manager to transfer pipes to the remote thread
+ * @return pointer to manager
+ */
+struct upipe_mgr *upipe_work_mgr_alloc(struct upipe_mgr *xfer_mgr)
+{
+    assert(xfer_mgr != NULL);
+    return upipe_work_pool_mgr_alloc(&xfer_mgr, 1);
+}
@@ -0,0 +1,758 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/** @file
+ * @short Bin pipe running copies of a stateless pipe in parallel
+ */
+
+#include <upipe/ubase.h>
+#include <upipe/ulist.h>
+#include <upipe/urefcount.h>
+#include <upipe/udict.h>
+#include <upipe/uprobe.h>
+#include <upipe/uprobe_prefix.h>
+#include <upipe/uref.h>
+#include <upipe/uref_attr.h>
+#include <upipe/upipe.h>
+#include <upipe/upipe_helper_upipe.h>
+#include <upipe/upipe_helper_urefcount.h>
+#include <upipe/upipe_helper_urefcount_real.h>
+#include <upipe/upipe_helper_void.h>
+#include <upipe/upipe_helper_output.h>
+#include <upipe/upipe_helper_uprobe.h>
+#include <upipe-modules/upipe_worker_linear.h>
+#include <upipe-modules/upipe_worker_parallel.h>
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdarg.h>
+#include <string.h>
+#include <inttypes.h>
+#include <assert.h>
+
+UREF_ATTR_UNSIGNED(wpar, seq, "wpar.seq", sequence number in the wpar bin)
+UREF_ATTR_UNSIGNED(wpar, lane_seq, "wpar.lseq", sequence number in the lane)
+
+/** @internal @This is the private context of a wpar manager. */
+struct upipe_wpar_mgr {
+    /** refcount management structure */
+    struct urefcount urefcount;
+
+    /** worker managers for the lanes */
+    struct upipe_mgr *worker_mgrs[UPIPE_WPAR_MAX_WORKERS];
+    /** number of worker managers */
+    unsigned int nb_workers;
+    /** next worker manager to use */
+    unsigned int next_worker;
+
+    /** public upipe_mgr structure */
+    struct upipe_mgr mgr;
+};
+
+UBASE_FROM_TO(upipe_wpar_mgr, upipe_mgr, upipe_mgr, mgr)
+UBASE_FROM_TO(upipe_wpar_mgr, urefcount, urefcount, urefcount)
+
+/** @internal @This is the private context of a lane of a wpar pipe, which
+ * collects the output of the inner pipe. */
+struct upipe_wpar_lane {
+    /** refcount management structure */
+    struct urefcount urefcount;
+
+    /** index of the lane */
+    unsigned int index;
+    /** pipe receiving the urefs of the lane (worker or inner pipe) */
+    struct upipe *first;
+    /** true if the inner pipe runs in a worker */
+    bool worker;
+    /** number of urefs dispatched to the lane */
+    uint64_t dispatched;
+    /** number of urefs dispatched and not yet output or lost */
+    uint64_t in_flight;
+
+    /** public upipe structure */
+    struct upipe upipe;
+};
+
+UPIPE_HELPER_UPIPE(upipe_wpar_lane, upipe, UPIPE_WPAR_LANE_SIGNATURE)
+UPIPE_HELPER_UREFCOUNT(upipe_wpar_lane, urefcount, upipe_wpar_lane_free)
+UPIPE_HELPER_VOID(upipe_wpar_lane)
+
+/** @internal @This is the private context of a wpar pipe. */
+struct upipe_wpar {
+    /** real refcount management structure */
+    struct urefcount urefcount_real;
+    /** refcount management structure exported to the public structure */
+    struct urefcount urefcount;
+
+    /** output pipe */
+    struct upipe *output;
+    /** output flow definition */
+    struct uref *flow_def;
+    /** output state */
+    enum upipe_helper_output_state output_state;
+    /** list of output requests */
+    struct uchain request_list;
+    /** proxy probe for the pipes of the lanes */
+    struct uprobe proxy_probe;
+
+    /** manager to create lanes */
+    struct upipe_mgr lane_mgr;
+    /** lanes */
+    struct upipe_wpar_lane **lanes;
+    /** number of lanes */
+    unsigned int nb_lanes;
+    /** next lane to dispatch to */
+    unsigned int next_lane;
+    /** dispatch policy */
+    enum upipe_wpar_dispatch dispatch;
+
+    /** sequence number of the next incoming uref */
+    uint64_t seq;
+    /** sequence number of the next uref to output */
+    uint64_t next_seq;
+    /** urefs waiting for a missing sequence number, in order */
+    struct uchain pending;
+    /** number of urefs in pending */
+    unsigned int nb_pending;
+    /** maximum number of urefs in pending */
+    unsigned int reorder_depth;
+
+    /** public upipe structure */
+    struct upipe upipe;
+};
+
+UPIPE_HELPER_UPIPE(upipe_wpar, upipe, UPIPE_WPAR_SIGNATURE)
+UPIPE_HELPER_UREFCOUNT(upipe_wpar, urefcount, upipe_wpar_no_ref)
+UPIPE_HELPER_UREFCOUNT_REAL(upipe_wpar, urefcount_real, upipe_wpar_free)
+UPIPE_HELPER_OUTPUT(upipe_wpar, output, flow_def, output_state, request_list)
+UPIPE_HELPER_UPROBE(upipe_wpar, urefcount_real, proxy_probe, NULL)
+
+UBASE_FROM_TO(upipe_wpar, upipe_mgr, lane_mgr, lane_mgr)
+
+/** @internal @This allocates a lane of a wpar pipe.
+ *
+ * @param mgr common management structure
+ * @param uprobe structure used to raise events
+ * @param signature signature of the pipe allocator
+ * @param args optional arguments
+ * @return pointer to upipe or NULL in case of allocation error
+ */
+static struct upipe *upipe_wpar_lane_alloc(struct upipe_mgr *mgr,
+                                           struct uprobe *uprobe,
+                                           uint32_t signature, va_list args)
+{
+    struct upipe *upipe =
+        upipe_wpar_lane_alloc_void(mgr, uprobe, signature, args);
+    if (unlikely(upipe == NULL))
+        return NULL;
+
+    struct upipe_wpar_lane *lane = upipe_wpar_lane_from_upipe(upipe);
+    upipe_wpar_lane_init_urefcount(upipe);
+    lane->index = 0;
+    lane->first = NULL;
+    lane->worker = false;
+    lane->dispatched = 0;
+    lane->in_flight = 0;
+    upipe_throw_ready(upipe);
+    return upipe;
+}
+
+/** @internal @This compares the sequence numbers of two pending urefs.
+ *
+ * @param uchain1 first uref
+ * @param uchain2 second uref
+ * @return a negative, zero or positive value
+ */
+static int upipe_wpar_cmp(struct uchain *uchain1, struct uchain *uchain2)
+{
+    uint64_t seq1 = 0, seq2 = 0;
+    uref_wpar_get_seq(uref_from_uchain(uchain1), &seq1);
+    uref_wpar_get_seq(uref_from_uchain(uchain2), &seq2);
+    return seq1 < seq2 ? -1 : seq1 > seq2;
+}
+
+/** @internal @This outputs the pending urefs which are in order, or all of
+ * them if flush is true.
+ *
+ * @param upipe description structure of the pipe
+ * @param flush true to stop waiting for missing urefs
+ * @param upump_p reference to pump that generated the buffer
+ */
+static void upipe_wpar_merge(struct upipe *upipe, bool flush,
+                             struct upump **upump_p)
+{
+    struct upipe_wpar *upipe_wpar = upipe_wpar_from_upipe(upipe);
+    struct uchain *uchain;
+
+    while ((uchain = ulist_peek(&upipe_wpar->pending)) != NULL) {
+        struct uref *uref = uref_from_uchain(uchain);
+        uint64_t seq = 0;
+        uref_wpar_get_seq(uref, &seq);
+        if (seq != upipe_wpar->next_seq) {
+            if (!flush && upipe_wpar->nb_pending <= upipe_wpar->reorder_depth)
+                break;
+            upipe_warn_va(upipe, "lost %"PRIu64" urefs in the lanes",
+                          seq - upipe_wpar->next_seq);
+        }
+
+        ulist_pop(&upipe_wpar->pending);
+        upipe_wpar->nb_pending--;
+        upipe_wpar->next_seq = seq + 1;
+        uref_wpar_delete_seq(uref);
+        upipe_wpar_output(upipe, uref, upump_p);
+    }
+}
+
+/** @internal @This receives the output of the inner pipe of a lane.
+ *
+ * @param upipe description structure of the lane
+ * @param uref uref structure
+ * @param upump_p reference to pump that generated the buffer
+ */
+static void upipe_wpar_lane_input(struct upipe *upipe, struct uref *uref,
+                                  struct upump **upump_p)
+{
+    struct upipe_wpar_lane *lane = upipe_wpar_lane_from_upipe(upipe);
+    struct upipe_wpar *upipe_wpar = upipe_wpar_from_lane_mgr(upipe->mgr);
+    struct upipe *super = upipe_wpar_to_upipe(upipe_wpar);
+
+    /* the lane is in order, so the urefs dispatched before are done */
+    uint64_t lane_seq;
+    if (ubase_check(uref_wpar_get_lane_seq(uref, &lane_seq)) &&
+        lane_seq < lane->dispatched) {
+        lane->in_flight = lane->dispatched - lane_seq - 1;
+        uref_wpar_delete_lane_seq(uref);
+    }
+
+    uint64_t seq;
+    if (unlikely(!ubase_check(uref_wpar_get_seq(uref, &seq)))) {
+        /* created by the inner pipe, no way to order it */
+        upipe_wpar_output(super, uref, upump_p);
+        return;
+    }
+
+    if (unlikely(seq < upipe_wpar->next_seq)) {
+        upipe_warn_va(upipe, "dropping late uref %"PRIu64, seq);
+        uref_free(uref);
+        return;
+    }
+
+    ulist_bubble_reverse(&upipe_wpar->pending, uref_to_uchain(uref),
+                         upipe_wpar_cmp);
+    upipe_wpar->nb_pending++;
+    upipe_wpar_merge(super, false, upump_p);
+}
+
+/** @internal @This receives the output flow definition of a lane.
+ *
+ * @param upipe description structure of the lane
+ * @param flow_def new flow definition
+ * @return an error code
+ */
+static int upipe_wpar_lane_set_flow_def(struct upipe *upipe,
+                                        struct uref *flow_def)
+{
+    struct upipe_wpar *upipe_wpar = upipe_wpar_from_lane_mgr(upipe->mgr);
+    if (flow_def == NULL)
+        return UBASE_ERR_INVALID;
+
+    /* all lanes are expected to output the same flow definition */
+    if (upipe_wpar->flow_def != NULL &&
+        !udict_cmp(upipe_wpar->flow_def->udict, flow_def->udict))
+        return UBASE_ERR_NONE;
+
+    struct uref *flow_def_dup = uref_dup(flow_def);
+    UBASE_ALLOC_RETURN(flow_def_dup);
+    upipe_wpar_store_flow_def(upipe_wpar_to_upipe(upipe_wpar), flow_def_dup);
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This processes control commands on a lane.
+ *
+ * @param upipe description structure of the lane
+ * @param command type of command to process
+ * @param args arguments of the command
+ * @return an error code
+ */
+static int upipe_wpar_lane_control(struct upipe *upipe,
+                                   int command, va_list args)
+{
+    struct upipe_wpar *upipe_wpar = upipe_wpar_from_lane_mgr(upipe->mgr);
+    struct upipe *super = upipe_wpar_to_upipe(upipe_wpar);
+
+    switch (command) {
+        case UPIPE_REGISTER_REQUEST: {
+            struct urequest *urequest = va_arg(args, struct urequest *);
+            return upipe_wpar_alloc_output_proxy(super, urequest);
+        }
+        case UPIPE_UNREGISTER_REQUEST: {
+            struct urequest *urequest = va_arg(args, struct urequest *);
+            return upipe_wpar_free_output_proxy(super, urequest);
+        }
+        case UPIPE_SET_FLOW_DEF: {
+            struct uref *flow_def = va_arg(args, struct uref *);
+            return upipe_wpar_lane_set_flow_def(upipe, flow_def);
+        }
+        default:
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** @This frees a lane.
+ *
+ * @param upipe description structure of the lane
+ */
+static void upipe_wpar_lane_free(struct upipe *upipe)
+{
+    upipe_throw_dead(upipe);
+    upipe_wpar_lane_clean_urefcount(upipe);
+    upipe_wpar_lane_free_void(upipe);
+}
+
+/** @internal @This initializes the lane manager of a wpar pipe.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_wpar_init_lane_mgr(struct upipe *upipe)
+{
+    struct upipe_wpar *upipe_wpar = upipe_wpar_from_upipe(upipe);
+    struct upipe_mgr *lane_mgr = &upipe_wpar->lane_mgr;
+    lane_mgr->refcount = upipe_wpar_to_urefcount_real(upipe_wpar);
+    lane_mgr->signature = UPIPE_WPAR_LANE_SIGNATURE;
+    lane_mgr->upipe_alloc = upipe_wpar_lane_alloc;
+    lane_mgr->upipe_input = upipe_wpar_lane_input;
+    lane_mgr->upipe_control = upipe_wpar_lane_control;
+    lane_mgr->upipe_mgr_control = NULL;
+}
+
+/** @internal @This allocates the inner pipe of a lane, and the worker
+ * running it if any.
+ *
+ * @param upipe description structure of the pipe
+ * @param index index of the lane
+ * @param inner_mgr manager of the inner pipes
+ * @param uprobe_remote probe hierarchy of the inner pipes
+ * @param inner_flow_def flow definition to allocate the inner pipes, or NULL
+ * @param input_queue_length length of the queue to the worker
+ * @param output_queue_length length of the queue from the worker
+ * @return an error code
+ */
+static int upipe_wpar_alloc_lane(struct upipe *upipe, unsigned int index,
+                                 struct upipe_mgr *inner_mgr,
+                                 struct uprobe *uprobe_remote,
+                                 struct uref *inner_flow_def,
+                                 unsigned int input_queue_length,
+                                 unsigned int output_queue_length)
+{
+    struct upipe_wpar *upipe_wpar = upipe_wpar_from_upipe(upipe);
+    struct upipe_wpar_mgr *wpar_mgr = upipe_wpar_mgr_from_upipe_mgr(upipe->mgr);
+
+    struct uprobe *uprobe_inner =
+        uprobe_pfx_alloc_va(uprobe_use(uprobe_remote), UPROBE_LOG_VERBOSE,
+                            "inner %u", index);
+    struct upipe *inner = inner_flow_def != NULL ?
+        upipe_flow_alloc(inner_mgr, uprobe_inner, inner_flow_def) :
+        upipe_void_alloc(inner_mgr, uprobe_inner);
+    UBASE_ALLOC_RETURN(inner);
+
+    struct upipe *upipe_lane = upipe_void_alloc(&upipe_wpar->lane_mgr,
+            uprobe_pfx_alloc_va(uprobe_use(&upipe_wpar->proxy_probe),
+                                UPROBE_LOG_VERBOSE, "lane %u", index));
+    if (unlikely(upipe_lane == NULL)) {
+        upipe_release(inner);
+        return UBASE_ERR_ALLOC;
+    }
+    struct upipe_wpar_lane *lane = upipe_wpar_lane_from_upipe(upipe_lane);
+    lane->index = index;
+    upipe_wpar->lanes[index] = lane;
+
+    if (wpar_mgr->nb_workers) {
+        struct upipe_mgr *worker_mgr =
+            wpar_mgr->worker_mgrs[wpar_mgr->next_worker];
+        wpar_mgr->next_worker =
+            (wpar_mgr->next_worker + 1) % wpar_mgr->nb_workers;
+
+        lane->first = upipe_wlin_alloc(worker_mgr,
+                uprobe_pfx_alloc_va(uprobe_use(&upipe_wpar->proxy_probe),
+                                    UPROBE_LOG_VERBOSE, "worker %u", index),
+                inner,
+                uprobe_pfx_alloc_va(uprobe_use(uprobe_remote),
+                                    UPROBE_LOG_VERBOSE, "worker_x %u", index),
+                input_queue_length, output_queue_length);
+        UBASE_ALLOC_RETURN(lane->first);
+        lane->worker = true;
+    } else
+        lane->first = inner;
+
+    return upipe_set_output(lane->first, upipe_lane);
+}
+
+/** @internal @This allocates a wpar pipe.
+ *
+ * @param mgr common management structure
+ * @param uprobe structure used to raise events
+ * @param signature signature of the pipe allocator
+ * @param args optional arguments
+ * @return pointer to upipe or NULL in case of allocation error
+ */
+static struct upipe *_upipe_wpar_alloc(struct upipe_mgr *mgr,
+                                       struct uprobe *uprobe,
+                                       uint32_t signature, va_list args)
+{
+    if (signature != UPIPE_WPAR_SIGNATURE) {
+        uprobe_release(uprobe);
+        return NULL;
+    }
+    struct upipe_mgr *inner_mgr = va_arg(args, struct upipe_mgr *);
+    struct uprobe *uprobe_remote = va_arg(args, struct uprobe *);
+    struct uref *inner_flow_def = va_arg(args, struct uref *);
+    unsigned int nb_lanes = va_arg(args, unsigned int);
+    unsigned int input_queue_length = va_arg(args, unsigned int);
+    unsigned int output_queue_length = va_arg(args, unsigned int);
+
+    struct upipe_wpar *upipe_wpar = NULL;
+    struct upipe_wpar_lane **lanes = NULL;
+    if (unlikely(inner_mgr == NULL || !nb_lanes ||
+                 (upipe_wpar = malloc(sizeof(struct upipe_wpar))) == NULL ||
+                 (lanes = calloc(nb_lanes, sizeof(*lanes))) == NULL)) {
+        free(upipe_wpar);
+        uprobe_release(uprobe_remote);
+        uprobe_release(uprobe);
+        return NULL;
+    }
+
+    struct upipe *upipe = upipe_wpar_to_upipe(upipe_wpar);
+    upipe_init(upipe, mgr, uprobe);
+    upipe_wpar_init_urefcount(upipe);
+    upipe_wpar_init_urefcount_real(upipe);
+    upipe_wpar_init_output(upipe);
+    upipe_wpar_init_proxy_probe(upipe);
+    upipe_wpar_init_lane_mgr(upipe);
+    upipe_wpar->lanes = lanes;
+    upipe_wpar->nb_lanes = nb_lanes;
+    upipe_wpar->next_lane = 0;
+    upipe_wpar->dispatch = UPIPE_WPAR_DISPATCH_LOAD;
+    upipe_wpar->seq = 0;
+    upipe_wpar->next_seq = 0;
+    ulist_init(&upipe_wpar->pending);
+    upipe_wpar->nb_pending = 0;
+    upipe_wpar->reorder_depth =
+        nb_lanes * (input_queue_length + output_queue_length + 1);
+    upipe_throw_ready(upipe);
+
+    for (unsigned int i = 0; i < nb_lanes; i++) {
+        int err = upipe_wpar_alloc_lane(upipe, i, inner_mgr, uprobe_remote,
+                                        inner_flow_def, input_queue_length,
+                                        output_queue_length);
+        if (unlikely(!ubase_check(err))) {
+            upipe_err_va(upipe, "unable to allocate lane %u (%s)",
+                         i, ubase_err_str(err));
+            upipe_release(upipe);
+            uprobe_release(uprobe_remote);
+            return NULL;
+        }
+    }
+
+    uprobe_release(uprobe_remote);
+    return upipe;
+}
+
+/** @internal @This selects the lane to dispatch the next uref to.
+ *
+ * @param upipe description structure of the pipe
+ * @return pointer to the lane
+ */
+static struct upipe_wpar_lane *upipe_wpar_pick(struct upipe *upipe)
+{
+    struct upipe_wpar *upipe_wpar = upipe_wpar_from_upipe(upipe);
+    unsigned int index = upipe_wpar->next_lane;
+
+    if (upipe_wpar->dispatch == UPIPE_WPAR_DISPATCH_LOAD) {
+        for (unsigned int i = 1; i < upipe_wpar->nb_lanes; i++) {
+            unsigned int j = (upipe_wpar->next_lane + i) %
+                             upipe_wpar->nb_lanes;
+            if (upipe_wpar->lanes[j]->in_flight <
+                upipe_wpar->lanes[index]->in_flight)
+                index = j;
+        }
+    }
+
+    upipe_wpar->next_lane = (index + 1) % upipe_wpar->nb_lanes;
+    return upipe_wpar->lanes[index];
+}
+
+/** @internal @This receives data.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref uref structure
+ * @param upump_p reference to pump that generated the buffer
+ */
+static void upipe_wpar_input(struct upipe *upipe, struct uref *uref,
+                             struct upump **upump_p)
+{
+    struct upipe_wpar *upipe_wpar = upipe_wpar_from_upipe(upipe);
+    struct upipe_wpar_lane *lane = upipe_wpar_pick(upipe);
+    if (unlikely(!ubase_check(uref_wpar_set_seq(uref, upipe_wpar->seq)) ||
+                 !ubase_check(uref_wpar_set_lane_seq(uref,
+                                                     lane->dispatched)))) {
+        uref_free(uref);
+        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+        return;
+    }
+    upipe_wpar->seq++;
+    lane->dispatched++;
+    lane->in_flight++;
+    upipe_input(lane->first, uref, upump_p);
+}
+
+/** @internal @This sets the input flow definition on all lanes.
+ *
+ * @param upipe description structure of the pipe
+ * @param flow_def new flow definition
+ * @return an error code
+ */
+static int upipe_wpar_set_flow_def(struct upipe *upipe, struct uref *flow_def)
+{
+    struct upipe_wpar *upipe_wpar = upipe_wpar_from_upipe(upipe);
+    if (flow_def == NULL)
+        return UBASE_ERR_INVALID;
+
+    for (unsigned int i = 0; i < upipe_wpar->nb_lanes; i++)
+        UBASE_RETURN(upipe_set_flow_def(upipe_wpar->lanes[i]->first,
+                                        flow_def))
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This forwards a control command to the inner pipes of all
+ * lanes.
+ *
+ * @param upipe description structure of the pipe
+ * @param command type of command to process
+ * @param args arguments of the command
+ * @return an error code
+ */
+static int upipe_wpar_control_lanes(struct upipe *upipe,
+                                    int command, va_list args)
+{
+    struct upipe_wpar *upipe_wpar = upipe_wpar_from_upipe(upipe);
+    int ret = UBASE_ERR_NONE;
+
+    for (unsigned int i = 0; i < upipe_wpar->nb_lanes; i++) {
+        struct upipe_wpar_lane *lane = upipe_wpar->lanes[i];
+        struct upipe *inner = lane->first;
+        int err;
+
+        if (lane->worker) {
+            err = upipe_bin_freeze(lane->first);
+            if (unlikely(!ubase_check(err))) {
+                ret = ubase_check(ret) ? err : ret;
+                continue;
+            }
+            err = upipe_bin_get_first_inner(lane->first, &inner);
+        } else
+            err = UBASE_ERR_NONE;
+
+        if (ubase_check(err)) {
+            va_list args_copy;
+            va_copy(args_copy, args);
+            err = upipe_control_va(inner, command, args_copy);
+            va_end(args_copy);
+        }
+
+        if (lane->worker)
+            upipe_bin_thaw(lane->first);
+        if (!ubase_check(err) && ubase_check(ret))
+            ret = err;
+    }
+    return ret;
+}
+
+/** @internal @This processes control commands on a wpar pipe.
+ *
+ * @param upipe description structure of the pipe
+ * @param command type of command to process
+ * @param args arguments of the command
+ * @return an error code
+ */
+static int upipe_wpar_control(struct upipe *upipe, int command, va_list args)
+{
+    struct upipe_wpar *upipe_wpar = upipe_wpar_from_upipe(upipe);
+    UBASE_HANDLED_RETURN(upipe_wpar_control_output(upipe, command, args));
+
+    switch (command) {
+        case UPIPE_ATTACH_UPUMP_MGR:
+            for (unsigned int i = 0; i < upipe_wpar->nb_lanes; i++)
+                upipe_attach_upump_mgr(upipe_wpar->lanes[i]->first);
+            return UBASE_ERR_NONE;
+        case UPIPE_SET_FLOW_DEF: {
+            struct uref *flow_def = va_arg(args, struct uref *);
+            return upipe_wpar_set_flow_def(upipe, flow_def);
+        }
+        case UPIPE_WPAR_GET_DISPATCH: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_WPAR_SIGNATURE)
+            int *dispatch_p = va_arg(args, int *);
+            *dispatch_p = upipe_wpar->dispatch;
+            return UBASE_ERR_NONE;
+        }
+        case UPIPE_WPAR_SET_DISPATCH: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_WPAR_SIGNATURE)
+            int dispatch = va_arg(args, int);
+            if (dispatch != UPIPE_WPAR_DISPATCH_ROUND_ROBIN &&
+                dispatch != UPIPE_WPAR_DISPATCH_LOAD)
+                return UBASE_ERR_INVALID;
+            upipe_wpar->dispatch = dispatch;
+            return UBASE_ERR_NONE;
+        }
+        case UPIPE_WPAR_GET_REORDER_DEPTH: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_WPAR_SIGNATURE)
+            unsigned int *depth_p = va_arg(args, unsigned int *);
+            *depth_p = upipe_wpar->reorder_depth;
+            return UBASE_ERR_NONE;
+        }
+        case UPIPE_WPAR_SET_REORDER_DEPTH: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_WPAR_SIGNATURE)
+            upipe_wpar->reorder_depth = va_arg(args, unsigned int);
+            upipe_wpar_merge(upipe, false, NULL);
+            return UBASE_ERR_NONE;
+        }
+        default:
+            break;
+    }
+
+    return upipe_wpar_control_lanes(upipe, command, args);
+}
+
+/** @This frees a upipe.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_wpar_free(struct upipe *upipe)
+{
+    struct upipe_wpar *upipe_wpar = upipe_wpar_from_upipe(upipe);
+
+    upipe_throw_dead(upipe);
+
+    struct uchain *uchain, *uchain_tmp;
+    ulist_delete_foreach (&upipe_wpar->pending, uchain, uchain_tmp) {
+        ulist_delete(uchain);
+        uref_free(uref_from_uchain(uchain));
+    }
+    free(upipe_wpar->lanes);
+    upipe_wpar_clean_proxy_probe(upipe);
+    upipe_wpar_clean_output(upipe);
+    upipe_wpar_clean_urefcount_real(upipe);
+    upipe_wpar_clean_urefcount(upipe);
+    upipe_clean(upipe);
+    free(upipe_wpar);
+}
+
+/** @This is called when there is no external reference to the pipe anymore.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_wpar_no_ref(struct upipe *upipe)
+{
+    struct upipe_wpar *upipe_wpar = upipe_wpar_from_upipe(upipe);
+    upipe_wpar_merge(upipe, true, NULL);
+    for (unsigned int i = 0; i < upipe_wpar->nb_lanes; i++) {
+        struct upipe_wpar_lane *lane = upipe_wpar->lanes[i];
+        if (lane == NULL)
+            continue;
+        upipe_release(lane->first);
+        lane->first = NULL;
+        upipe_release(upipe_wpar_lane_to_upipe(lane));
+        upipe_wpar->lanes[i] = NULL;
+    }
+    upipe_wpar->nb_lanes = 0;
+    upipe_wpar_release_urefcount_real(upipe);
+}
+
+/** @This frees a upipe manager.
+ *
+ * @param urefcount pointer to urefcount structure
+ */
+static void upipe_wpar_mgr_free(struct urefcount *urefcount)
+{
+    struct upipe_wpar_mgr *wpar_mgr = upipe_wpar_mgr_from_urefcount(urefcount);
+    for (unsigned int i = 0; i < wpar_mgr->nb_workers; i++)
+        upipe_mgr_release(wpar_mgr->worker_mgrs[i]);
+
+    urefcount_clean(urefcount);
+    free(wpar_mgr);
+}
+
+/** @This processes control commands on a wpar manager.
+ *
+ * @param mgr pointer to manager
+ * @param command type of command to process
+ * @param args arguments of the command
+ * @return an error code
+ */
+static int upipe_wpar_mgr_control(struct upipe_mgr *mgr,
+                                  int command, va_list args)
+{
+    struct upipe_wpar_mgr *wpar_mgr = upipe_wpar_mgr_from_upipe_mgr(mgr);
+
+    switch (command) {
+        case UPIPE_WPAR_MGR_ADD_WORKER: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_WPAR_SIGNATURE)
+            if (!urefcount_single(&wpar_mgr->urefcount))
+                return UBASE_ERR_BUSY;
+            struct upipe_mgr *m = va_arg(args, struct upipe_mgr *);
+            if (m == NULL || wpar_mgr->nb_workers >= UPIPE_WPAR_MAX_WORKERS)
+                return UBASE_ERR_INVALID;
+            wpar_mgr->worker_mgrs[wpar_mgr->nb_workers++] = upipe_mgr_use(m);
+            return UBASE_ERR_NONE;
+        }
+
+        default:
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** @This returns the management structure for all wpar pipes.
+ *
+ * @return pointer to manager
+ */
+struct upipe_mgr *upipe_wpar_mgr_alloc(void)
+{
+    struct upipe_wpar_mgr *wpar_mgr = malloc(sizeof(struct upipe_wpar_mgr));
+    if (unlikely(wpar_mgr == NULL))
+        return NULL;
+
+    memset(wpar_mgr, 0, sizeof(*wpar_mgr));
+    wpar_mgr->nb_workers = 0;
+    wpar_mgr->next_worker = 0;
+
+    urefcount_init(upipe_wpar_mgr_to_urefcount(wpar_mgr), upipe_wpar_mgr_free);
+    wpar_mgr->mgr.refcount = upipe_wpar_mgr_to_urefcount(wpar_mgr);
+    wpar_mgr->mgr.signature = UPIPE_WPAR_SIGNATURE;
+    wpar_mgr->mgr.upipe_alloc = _upipe_wpar_alloc;
+    wpar_mgr->mgr.upipe_input = upipe_wpar_input;
+    wpar_mgr->mgr.upipe_control = upipe_wpar_control;
+    wpar_mgr->mgr.upipe_mgr_control = upipe_wpar_mgr_control;
+    return upipe_wpar_mgr_to_upipe_mgr(wpar_mgr);
+}
@@ -0,0 +1,710 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short Upipe netmap sink module
+ */
+
+#include <upipe/ubase.h>
+#include <upipe/uprobe.h>
+#include <upipe/uclock.h>
+#include <upipe/uref.h>
+#include <upipe/uref_block.h>
+#include <upipe/uref_flow.h>
+#include <upipe/uref_clock.h>
+#include <upipe/upump.h>
+#include <upipe/upipe.h>
+#include <upipe/upipe_helper_upipe.h>
+#include <upipe/upipe_helper_urefcount.h>
+#include <upipe/upipe_helper_void.h>
+#include <upipe/upipe_helper_upump_mgr.h>
+#include <upipe/upipe_helper_upump.h>
+#include <upipe/upipe_helper_input.h>
+#include <upipe/upipe_helper_uclock.h>
+#include <upipe-netmap/upipe_netmap_sink.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <inttypes.h>
+#include <assert.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#define NETMAP_WITH_LIBS
+#include <net/netmap.h>
+#include <net/netmap_user.h>
+
+#include <bitstream/ietf/ip.h>
+#include <bitstream/ietf/udp.h>
+#include <bitstream/ieee/ethernet.h>
+
+/** tolerance for late packets */
+#define SYSTIME_TOLERANCE (UCLOCK_FREQ / 100)
+/** print late packets */
+#define SYSTIME_PRINT (UCLOCK_FREQ / 1000)
+/** expected flow definition on all flows */
+#define EXPECTED_FLOW_DEF "block."
+/** period of the pacing timer */
+#define PACING_PERIOD (UCLOCK_FREQ / 10000)
+/** maximum number of slots filled before synchronizing the ring */
+#define SYNC_BATCH 64
+/** size of the Ethernet, IPv4 and UDP headers */
+#define HEADERS_SIZE (ETHERNET_HEADER_LEN + IP_HEADER_MINSIZE + UDP_HEADER_SIZE)
+/** time-to-live of the datagrams */
+#define DEFAULT_TTL 64
+
+/** @hidden */
+static bool upipe_netmap_sink_output(struct upipe *upipe, struct uref *uref,
+                                     struct upump **upump_p);
+
+/** @internal @This is the private context of a netmap sink pipe. */
+struct upipe_netmap_sink {
+    /** refcount management structure */
+    struct urefcount urefcount;
+
+    /** upump manager */
+    struct upump_mgr *upump_mgr;
+    /** pacing timer */
+    struct upump *upump;
+
+    /** uclock structure, if not NULL we are in live mode */
+    struct uclock *uclock;
+    /** uclock request */
+    struct urequest uclock_request;
+
+    /** delay applied to systime attribute when uclock is provided */
+    uint64_t latency;
+
+    /** temporary uref storage */
+    struct uchain urefs;
+    /** nb urefs in storage */
+    unsigned int nb_urefs;
+    /** max urefs in storage */
+    unsigned int max_urefs;
+    /** list of blockers */
+    struct uchain blockers;
+
+    /** netmap descriptor */
+    struct nm_desc *d;
+    /** netmap uri */
+    char *uri;
+    /** netmap ring */
+    unsigned int ring_idx;
+    /** number of slots filled since the last synchronization */
+    unsigned int nb_pending;
+    /** pre-built Ethernet, IPv4 and UDP headers */
+    uint8_t header[HEADERS_SIZE];
+
+    /** public upipe structure */
+    struct upipe upipe;
+};
+
+UPIPE_HELPER_UPIPE(upipe_netmap_sink, upipe, UPIPE_NETMAP_SINK_SIGNATURE)
+UPIPE_HELPER_UREFCOUNT(upipe_netmap_sink, urefcount, upipe_netmap_sink_free)
+UPIPE_HELPER_VOID(upipe_netmap_sink)
+UPIPE_HELPER_UPUMP_MGR(upipe_netmap_sink, upump_mgr)
+UPIPE_HELPER_UPUMP(upipe_netmap_sink, upump, upump_mgr)
+UPIPE_HELPER_INPUT(upipe_netmap_sink, urefs, nb_urefs, max_urefs, blockers,
+                   upipe_netmap_sink_output)
+UPIPE_HELPER_UCLOCK(upipe_netmap_sink, uclock, uclock_request, NULL,
+                    upipe_throw_provide_request, NULL)
+
+/** @internal @This allocates a netmap sink pipe.
+ *
+ * @param mgr common management structure
+ * @param uprobe structure used to raise events
+ * @param signature signature of the pipe allocator
+ * @param args optional arguments
+ * @return pointer to upipe or NULL in case of allocation error
+ */
+static struct upipe *upipe_netmap_sink_alloc(struct upipe_mgr *mgr,
+                                             struct uprobe *uprobe,
+                                             uint32_t signature, va_list args)
+{
+    struct upipe *upipe = upipe_netmap_sink_alloc_void(mgr, uprobe, signature,
+                                                       args);
+    if (unlikely(upipe == NULL))
+        return NULL;
+
+    struct upipe_netmap_sink *upipe_netmap_sink =
+        upipe_netmap_sink_from_upipe(upipe);
+    upipe_netmap_sink_init_urefcount(upipe);
+    upipe_netmap_sink_init_upump_mgr(upipe);
+    upipe_netmap_sink_init_upump(upipe);
+    upipe_netmap_sink_init_input(upipe);
+    upipe_netmap_sink_init_uclock(upipe);
+    upipe_netmap_sink->latency = 0;
+    upipe_netmap_sink->d = NULL;
+    upipe_netmap_sink->uri = NULL;
+    upipe_netmap_sink->ring_idx = 0;
+    upipe_netmap_sink->nb_pending = 0;
+    memset(upipe_netmap_sink->header, 0, HEADERS_SIZE);
+    upipe_throw_ready(upipe);
+    return upipe;
+}
+
+/** @internal @This computes the checksum of an IPv4 header without options.
+ *
+ * @param ip pointer to the IPv4 header
+ * @return checksum in host byte order
+ */
+static uint16_t upipe_netmap_sink_ip_cksum(const uint8_t *ip)
+{
+    uint32_t sum = 0;
+    for (unsigned int i = 0; i < IP_HEADER_MINSIZE; i += 2)
+        sum += (ip[i] << 8) | ip[i + 1];
+    while (sum >> 16)
+        sum = (sum & 0xffff) + (sum >> 16);
+    return ~sum & 0xffff;
+}
+
+/** @internal @This synchronizes the TX ring with the NIC.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_netmap_sink_sync(struct upipe *upipe)
+{
+    struct upipe_netmap_sink *upipe_netmap_sink =
+        upipe_netmap_sink_from_upipe(upipe);
+    ioctl(NETMAP_FD(upipe_netmap_sink->d), NIOCTXSYNC, NULL);
+    upipe_netmap_sink->nb_pending = 0;
+}
+
+/** @internal @This writes a datagram into the TX ring.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref uref structure
+ * @param upump_p reference to pump that generated the buffer
+ * @return false if the ring is full and the uref must be held
+ */
+static bool upipe_netmap_sink_output(struct upipe *upipe, struct uref *uref,
+                                     struct upump **upump_p)
+{
+    struct upipe_netmap_sink *upipe_netmap_sink =
+        upipe_netmap_sink_from_upipe(upipe);
+    const char *def;
+    if (unlikely(ubase_check(uref_flow_get_def(uref, &def)))) {
+        uint64_t latency = 0;
+        uref_clock_get_latency(uref, &latency);
+        if (latency > upipe_netmap_sink->latency)
+            upipe_netmap_sink->latency = latency;
+        uref_free(uref);
+        return true;
+    }
+
+    if (unlikely(upipe_netmap_sink->d == NULL)) {
+        uref_free(uref);
+        upipe_warn(upipe, "received a buffer before opening netmap");
+        return true;
+    }
+
+    if (likely(upipe_netmap_sink->uclock != NULL)) {
+        uint64_t systime;
+        if (unlikely(!ubase_check(uref_clock_get_cr_sys(uref, &systime)))) {
+            upipe_warn(upipe, "received non-dated buffer");
+            goto write_buffer;
+        }
+
+        uint64_t now = uclock_now(upipe_netmap_sink->uclock);
+        systime += upipe_netmap_sink->latency;
+        if (now < systime)
+            /* released by the pacing timer */
+            return false;
+        if (now > systime + SYSTIME_TOLERANCE) {
+            upipe_warn_va(upipe,
+                    "dropping late packet %"PRIu64" ms, latency %"PRIu64" ms",
+                    (now - systime) / (UCLOCK_FREQ / 1000),
+                    upipe_netmap_sink->latency / (UCLOCK_FREQ / 1000));
+            uref_free(uref);
+            return true;
+        }
+        if (now > systime + SYSTIME_PRINT)
+            upipe_warn_va(upipe,
+                    "outputting late packet %"PRIu64" ms, latency %"PRIu64" ms",
+                    (now - systime) / (UCLOCK_FREQ / 1000),
+                    upipe_netmap_sink->latency / (UCLOCK_FREQ / 1000));
+    }
+
+write_buffer:;
+    struct netmap_ring *txring = NETMAP_TXRING(upipe_netmap_sink->d->nifp,
+                                               upipe_netmap_sink->ring_idx);
+    if (unlikely(nm_ring_space(txring) == 0)) {
+        upipe_netmap_sink_sync(upipe);
+        if (nm_ring_space(txring) == 0)
+            return false;
+    }
+
+    size_t size = 0;
+    if (unlikely(!ubase_check(uref_block_size(uref, &size)) ||
+                 size > txring->nr_buf_size - HEADERS_SIZE ||
+                 size > UINT16_MAX - IP_HEADER_MINSIZE - UDP_HEADER_SIZE)) {
+        upipe_warn(upipe, "invalid or too large buffer, dropping");
+        uref_free(uref);
+        return true;
+    }
+
+    const uint32_t cur = txring->cur;
+    struct netmap_slot *slot = &txring->slot[cur];
+    uint8_t *dst = (uint8_t *)NETMAP_BUF(txring, slot->buf_idx);
+    memcpy(dst, upipe_netmap_sink->header, HEADERS_SIZE);
+    if (unlikely(!ubase_check(uref_block_extract(uref, 0, size,
+                                                 dst + HEADERS_SIZE)))) {
+        upipe_warn(upipe, "cannot read ubuf buffer");
+        uref_free(uref);
+        return true;
+    }
+    uref_free(uref);
+
+    uint8_t *ip = dst + ETHERNET_HEADER_LEN;
+    ip_set_len(ip, size + IP_HEADER_MINSIZE + UDP_HEADER_SIZE);
+    ip_set_cksum(ip, 0);
+    ip_set_cksum(ip, upipe_netmap_sink_ip_cksum(ip));
+    udp_set_len(ip + IP_HEADER_MINSIZE, size + UDP_HEADER_SIZE);
+
+    slot->len = size + HEADERS_SIZE;
+    txring->head = txring->cur = nm_ring_next(txring, cur);
+    if (++upipe_netmap_sink->nb_pending >= SYNC_BATCH)
+        upipe_netmap_sink_sync(upipe);
+    return true;
+}
+
+/** @internal @This is called periodically to release the datagrams whose
+ * date has come.
+ *
+ * @param upump description structure of the timer
+ */
+static void upipe_netmap_sink_worker(struct upump *upump)
+{
+    struct upipe *upipe = upump_get_opaque(upump, struct upipe *);
+    struct upipe_netmap_sink *upipe_netmap_sink =
+        upipe_netmap_sink_from_upipe(upipe);
+    if (upipe_netmap_sink_check_input(upipe))
+        return;
+
+    upipe_netmap_sink_output_input(upipe);
+    if (upipe_netmap_sink->nb_pending)
+        upipe_netmap_sink_sync(upipe);
+    upipe_netmap_sink_unblock_input(upipe);
+    if (upipe_netmap_sink_check_input(upipe)) {
+        /* All packets have been output, release again the pipe that has been
+         * used in @ref upipe_netmap_sink_input. */
+        upipe_release(upipe);
+    }
+}
+
+/** @internal @This receives data.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref uref structure
+ * @param upump_p reference to pump that generated the buffer
+ */
+static void upipe_netmap_sink_input(struct upipe *upipe, struct uref *uref,
+                                    struct upump **upump_p)
+{
+    if (!upipe_netmap_sink_check_input(upipe)) {
+        upipe_netmap_sink_hold_input(upipe, uref);
+        upipe_netmap_sink_block_input(upipe, upump_p);
+    } else if (!upipe_netmap_sink_output(upipe, uref, upump_p)) {
+        upipe_netmap_sink_hold_input(upipe, uref);
+        upipe_netmap_sink_block_input(upipe, upump_p);
+        /* Increment upipe refcount to avoid disappearing before all packets
+         * have been sent. */
+        upipe_use(upipe);
+    }
+}
+
+/** @internal @This sets the input flow definition.
+ *
+ * @param upipe description structure of the pipe
+ * @param flow_def flow definition packet
+ * @return an error code
+ */
+static int upipe_netmap_sink_set_flow_def(struct upipe *upipe,
+                                          struct uref *flow_def)
+{
+    if (flow_def == NULL)
+        return UBASE_ERR_INVALID;
+    UBASE_RETURN(uref_flow_match_def(flow_def, EXPECTED_FLOW_DEF))
+    flow_def = uref_dup(flow_def);
+    UBASE_ALLOC_RETURN(flow_def)
+    upipe_input(upipe, flow_def, NULL);
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This checks if the pacing timer may be allocated.
+ *
+ * @param upipe description structure of the pipe
+ * @return an error code
+ */
+static int upipe_netmap_sink_check(struct upipe *upipe)
+{
+    struct upipe_netmap_sink *upipe_netmap_sink =
+        upipe_netmap_sink_from_upipe(upipe);
+    if (upipe_netmap_sink->d == NULL || upipe_netmap_sink->upump != NULL)
+        return UBASE_ERR_NONE;
+
+    upipe_netmap_sink_check_upump_mgr(upipe);
+    if (upipe_netmap_sink->upump_mgr == NULL)
+        return UBASE_ERR_NONE;
+
+    struct upump *upump = upump_alloc_timer(upipe_netmap_sink->upump_mgr,
+            upipe_netmap_sink_worker, upipe, upipe->refcount,
+            PACING_PERIOD, PACING_PERIOD);
+    if (unlikely(upump == NULL)) {
+        upipe_throw_fatal(upipe, UBASE_ERR_UPUMP);
+        return UBASE_ERR_UPUMP;
+    }
+    upipe_netmap_sink_set_upump(upipe, upump);
+    upump_start(upump);
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This returns the uri of the currently opened netmap.
+ *
+ * @param upipe description structure of the pipe
+ * @param uri_p filled in with the uri of the netmap sink
+ * @return an error code
+ */
+static int upipe_netmap_sink_get_uri(struct upipe *upipe, const char **uri_p)
+{
+    struct upipe_netmap_sink *upipe_netmap_sink =
+        upipe_netmap_sink_from_upipe(upipe);
+    assert(uri_p != NULL);
+    *uri_p = upipe_netmap_sink->uri;
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This finds the hardware address of a unicast destination in
+ * the ARP table.
+ *
+ * @param dst destination address
+ * @param mac filled in with the hardware address
+ * @return false if the destination is not in the table
+ */
+static bool upipe_netmap_sink_arp(struct in_addr dst, uint8_t *mac)
+{
+    FILE *f = fopen("/proc/net/arp", "r");
+    if (f == NULL)
+        return false;
+
+    char line[256];
+    bool found = false;
+    while (!found && fgets(line, sizeof(line), f) != NULL) {
+        char ip[INET_ADDRSTRLEN];
+        unsigned int hw[ETHERNET_ADDR_LEN];
+        struct in_addr addr;
+        if (sscanf(line, "%15s %*s %*s %x:%x:%x:%x:%x:%x", ip,
+                   &hw[0], &hw[1], &hw[2], &hw[3], &hw[4], &hw[5]) != 7 ||
+            inet_pton(AF_INET, ip, &addr) != 1 ||
+            addr.s_addr != dst.s_addr)
+            continue;
+        for (int i = 0; i < ETHERNET_ADDR_LEN; i++)
+            mac[i] = hw[i];
+        found = true;
+    }
+    fclose(f);
+    return found;
+}
+
+/** @internal @This builds the Ethernet, IPv4 and UDP headers.
+ *
+ * @param upipe description structure of the pipe
+ * @param ifname name of the interface
+ * @param dst destination address
+ * @param port destination port
+ * @return an error code
+ */
+static int upipe_netmap_sink_build_header(struct upipe *upipe,
+                                          const char *ifname,
+                                          struct in_addr dst, uint16_t port)
+{
+    struct upipe_netmap_sink *upipe_netmap_sink =
+        upipe_netmap_sink_from_upipe(upipe);
+    uint8_t *header = upipe_netmap_sink->header;
+
+    struct ifreq ifr;
+    memset(&ifr, 0, sizeof(ifr));
+    snprintf(ifr.ifr_name, sizeof(ifr.ifr_name), "%s", ifname);
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (unlikely(fd == -1)) {
+        upipe_err_va(upipe, "unable to open socket (%m)");
+        return UBASE_ERR_EXTERNAL;
+    }
+    if (unlikely(ioctl(fd, SIOCGIFHWADDR, &ifr) < 0)) {
+        upipe_err_va(upipe, "unable to get address of %s (%m)", ifname);
+        close(fd);
+        return UBASE_ERR_EXTERNAL;
+    }
+    memcpy(header + ETHERNET_ADDR_LEN, ifr.ifr_hwaddr.sa_data,
+           ETHERNET_ADDR_LEN);
+    if (unlikely(ioctl(fd, SIOCGIFADDR, &ifr) < 0)) {
+        upipe_err_va(upipe, "unable to get address of %s (%m)", ifname);
+        close(fd);
+        return UBASE_ERR_EXTERNAL;
+    }
+    close(fd);
+    struct in_addr src = ((struct sockaddr_in *)&ifr.ifr_addr)->sin_addr;
+
+    uint32_t group = ntohl(dst.s_addr);
+    if (IN_MULTICAST(group)) {
+        header[0] = 0x01;
+        header[1] = 0x00;
+        header[2] = 0x5e;
+        header[3] = (group >> 16) & 0x7f;
+        header[4] = (group >> 8) & 0xff;
+        header[5] = group & 0xff;
+    } else if (unlikely(!upipe_netmap_sink_arp(dst, header))) {
+        upipe_err_va(upipe, "unable to resolve destination %s",
+                     inet_ntoa(dst));
+        return UBASE_ERR_EXTERNAL;
+    }
+    ethernet_set_lentype(header, ETHERNET_TYPE_IP);
+
+    uint8_t *ip = header + ETHERNET_HEADER_LEN;
+    ip_set_version(ip, 4);
+    ip_set_ihl(ip, 5);
+    ip_set_tos(ip, 0);
+    ip_set_len(ip, IP_HEADER_MINSIZE + UDP_HEADER_SIZE);
+    ip_set_id(ip, 0);
+    ip_set_flag_reserved(ip, 0);
+    ip_set_flag_mf(ip, 0);
+    ip_set_flag_df(ip, 1);
+    ip_set_frag_offset(ip, 0);
+    ip_set_ttl(ip, DEFAULT_TTL);
+    ip_set_proto(ip, IP_PROTO_UDP);
+    ip_set_cksum(ip, 0);
+    ip_set_srcaddr(ip, ntohl(src.s_addr));
+    ip_set_dstaddr(ip, group);
+
+    uint8_t *udp = ip + IP_HEADER_MINSIZE;
+    udp_set_srcport(udp, port);
+    udp_set_dstport(udp, port);
+    udp_set_len(udp, UDP_HEADER_SIZE);
+    udp_set_cksum(udp, 0);
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This closes the netmap port and drops the pending datagrams.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_netmap_sink_close(struct upipe *upipe)
+{
+    struct upipe_netmap_sink *upipe_netmap_sink =
+        upipe_netmap_sink_from_upipe(upipe);
+    upipe_netmap_sink_set_upump(upipe, NULL);
+    if (upipe_netmap_sink->d != NULL) {
+        if (upipe_netmap_sink->nb_pending)
+            upipe_netmap_sink_sync(upipe);
+        if (likely(upipe_netmap_sink->uri != NULL))
+            upipe_notice_va(upipe, "closing netmap %s", upipe_netmap_sink->uri);
+        nm_close(upipe_netmap_sink->d);
+        upipe_netmap_sink->d = NULL;
+    }
+    ubase_clean_str(&upipe_netmap_sink->uri);
+    if (upipe_netmap_sink_flush_input(upipe))
+        /* Release the pipe used in @ref upipe_netmap_sink_input. */
+        upipe_release(upipe);
+}
+
+/** @internal @This asks to open the given netmap sink.
+ *
+ * @param upipe description structure of the pipe
+ * @param uri of the form netmap:<ifname>-<ring>/T@<dst>:<port>
+ * @return an error code
+ */
+static int upipe_netmap_sink_set_uri(struct upipe *upipe, const char *uri)
+{
+    struct upipe_netmap_sink *upipe_netmap_sink =
+        upipe_netmap_sink_from_upipe(upipe);
+
+    upipe_netmap_sink_close(upipe);
+    if (unlikely(uri == NULL))
+        return UBASE_ERR_NONE;
+
+    char ifname[IF_NAMESIZE];
+    char dst_str[INET_ADDRSTRLEN];
+    unsigned int port;
+    struct in_addr dst;
+    const char *at = strchr(uri, '@');
+    if (at == NULL || at - uri >= 64 ||
+        sscanf(uri, "%*[^:]:%15[^-]-%u/T@", ifname,
+               &upipe_netmap_sink->ring_idx) != 2 ||
+        sscanf(at + 1, "%15[^:]:%u", dst_str, &port) != 2 ||
+        !port || port > UINT16_MAX ||
+        inet_pton(AF_INET, dst_str, &dst) != 1) {
+        upipe_err_va(upipe, "invalid netmap transmit uri %s", uri);
+        return UBASE_ERR_INVALID;
+    }
+    UBASE_RETURN(upipe_netmap_sink_build_header(upipe, ifname, dst, port))
+
+    char port_name[64];
+    memcpy(port_name, uri, at - uri);
+    port_name[at - uri] = '\0';
+    upipe_netmap_sink->d = nm_open(port_name, NULL, 0, 0);
+    if (unlikely(!upipe_netmap_sink->d)) {
+        upipe_err_va(upipe, "can't open netmap socket %s", port_name);
+        return UBASE_ERR_EXTERNAL;
+    }
+
+    upipe_netmap_sink->uri = strdup(uri);
+    if (unlikely(upipe_netmap_sink->uri == NULL)) {
+        nm_close(upipe_netmap_sink->d);
+        upipe_netmap_sink->d = NULL;
+        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+        return UBASE_ERR_ALLOC;
+    }
+
+    upipe_notice_va(upipe, "opening netmap socket %s ring %u",
+                    upipe_netmap_sink->uri, upipe_netmap_sink->ring_idx);
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This flushes all currently held buffers, and unblocks the
+ * sources.
+ *
+ * @param upipe description structure of the pipe
+ * @return an error code
+ */
+static int upipe_netmap_sink_flush(struct upipe *upipe)
+{
+    struct upipe_netmap_sink *upipe_netmap_sink =
+        upipe_netmap_sink_from_upipe(upipe);
+    if (upipe_netmap_sink->d != NULL && upipe_netmap_sink->nb_pending)
+        upipe_netmap_sink_sync(upipe);
+    if (upipe_netmap_sink_flush_input(upipe))
+        /* All packets have been output, release again the pipe that has been
+         * used in @ref upipe_netmap_sink_input. */
+        upipe_release(upipe);
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This processes control commands on a netmap sink pipe.
+ *
+ * @param upipe description structure of the pipe
+ * @param command type of command to process
+ * @param args arguments of the command
+ * @return an error code
+ */
+static int _upipe_netmap_sink_control(struct upipe *upipe,
+                                      int command, va_list args)
+{
+    switch (command) {
+        case UPIPE_REGISTER_REQUEST:
+        case UPIPE_UNREGISTER_REQUEST:
+            return upipe_control_provide_request(upipe, command, args);
+
+        case UPIPE_ATTACH_UPUMP_MGR:
+            upipe_netmap_sink_set_upump(upipe, NULL);
+            return upipe_netmap_sink_attach_upump_mgr(upipe);
+        case UPIPE_ATTACH_UCLOCK:
+            upipe_netmap_sink_require_uclock(upipe);
+            return UBASE_ERR_NONE;
+        case UPIPE_SET_FLOW_DEF: {
+            struct uref *flow_def = va_arg(args, struct uref *);
+            return upipe_netmap_sink_set_flow_def(upipe, flow_def);
+        }
+
+        case UPIPE_GET_MAX_LENGTH: {
+            unsigned int *p = va_arg(args, unsigned int *);
+            return upipe_netmap_sink_get_max_length(upipe, p);
+        }
+        case UPIPE_SET_MAX_LENGTH: {
+            unsigned int max_length = va_arg(args, unsigned int);
+            return upipe_netmap_sink_set_max_length(upipe, max_length);
+        }
+
+        case UPIPE_GET_URI: {
+            const char **uri_p = va_arg(args, const char **);
+            return upipe_netmap_sink_get_uri(upipe, uri_p);
+        }
+        case UPIPE_SET_URI: {
+            const char *uri = va_arg(args, const char *);
+            return upipe_netmap_sink_set_uri(upipe, uri);
+        }
+        case UPIPE_FLUSH:
+            return upipe_netmap_sink_flush(upipe);
+        default:
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** @internal @This processes control commands on a netmap sink pipe, and
+ * checks the status of the pipe afterwards.
+ *
+ * @param upipe description structure of the pipe
+ * @param command type of command to process
+ * @param args arguments of the command
+ * @return an error code
+ */
+static int upipe_netmap_sink_control(struct upipe *upipe,
+                                     int command, va_list args)
+{
+    UBASE_RETURN(_upipe_netmap_sink_control(upipe, command, args));
+
+    return upipe_netmap_sink_check(upipe);
+}
+
+/** @This frees a upipe.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_netmap_sink_free(struct upipe *upipe)
+{
+    upipe_netmap_sink_close(upipe);
+    upipe_throw_dead(upipe);
+
+    upipe_netmap_sink_clean_uclock(upipe);
+    upipe_netmap_sink_clean_upump(upipe);
+    upipe_netmap_sink_clean_upump_mgr(upipe);
+    upipe_netmap_sink_clean_input(upipe);
+    upipe_netmap_sink_clean_urefcount(upipe);
+    upipe_netmap_sink_free_void(upipe);
+}
+
+/** module manager static descriptor */
+static struct upipe_mgr upipe_netmap_sink_mgr = {
+    .refcount = NULL,
+    .signature = UPIPE_NETMAP_SINK_SIGNATURE,
+
+    .upipe_alloc = upipe_netmap_sink_alloc,
+    .upipe_input = upipe_netmap_sink_input,
+    .upipe_control = upipe_netmap_sink_control,
+
+    .upipe_mgr_control = NULL
+};
+
+/** @This returns the management structure for all netmap sinks
+ *
+ * @return pointer to manager
+ */
+struct upipe_mgr *upipe_netmap_sink_mgr_alloc(void)
+{
+    return &upipe_netmap_sink_mgr;
+}
@@ -102,8 +102,10 @@ struct upipe_netmap_source {
     /** netmape uri **/
     char *uri;
 
-    /** netmap ring **/
-    unsigned int ring_idx;
+    /** first bound netmap ring **/
+    unsigned int first_ring;
+    /** last bound netmap ring **/
+    unsigned int last_ring;
 
     /** public upipe structure */
     struct upipe upipe;
@@ -156,29 +158,32 @@ static struct upipe *upipe_netmap_source_alloc(struct upipe_mgr *mgr,
     return upipe;
 }
 
-static void upipe_netmap_source_worker(struct upump *upump)
+/** @internal @This outputs all the UDP payloads available in a ring.
+ *
+ * @param upipe description structure of the pipe
+ * @param rxring netmap ring to read from
+ * @param systime date of reception
+ * @return false in case of fatal error
+ */
+static bool upipe_netmap_source_rx(struct upipe *upipe,
+                                   struct netmap_ring *rxring,
+                                   uint64_t systime)
 {
-    struct upipe *upipe = upump_get_opaque(upump, struct upipe *);
     struct upipe_netmap_source *upipe_netmap_source = upipe_netmap_source_from_upipe(upipe);
+    uint32_t cur = rxring->cur;
+    bool ret = true;
 
-    uint64_t systime = 0;
-    if (likely(upipe_netmap_source->uclock != NULL))
-        systime = uclock_now(upipe_netmap_source->uclock);
-
-    ioctl(NETMAP_FD(upipe_netmap_source->d), NIOCRXSYNC, NULL);
-    struct netmap_ring *rxring = NETMAP_RXRING(upipe_netmap_source->d->nifp,
-            upipe_netmap_source->ring_idx);
-
-    while (!nm_ring_empty(rxring)) {
-        const uint32_t cur = rxring->cur;
+    /* process all the slots received since the last sync, and give them
+     * back to the kernel at once */
+    for ( ; cur != rxring->tail; cur = nm_ring_next(rxring, cur)) {
         uint8_t *src = (uint8_t*)NETMAP_BUF(rxring, rxring->slot[cur].buf_idx);
 
         if (ethernet_get_lentype(src) != ETHERNET_TYPE_IP)
-            goto next;
+            continue;
 
         uint8_t *ip = &src[ETHERNET_HEADER_LEN];
         if (ip_get_proto(ip) != IP_PROTO_UDP)
-            goto next;
+            continue;
 
         uint8_t *udp = ip_payload(ip);
         const uint8_t *rtp = udp_payload(udp);
@@ -189,7 +194,8 @@ static void upipe_netmap_source_worker(struct upump *upump)
                                              payload_len);
         if (unlikely(uref == NULL)) {
             upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
-            return;
+            ret = false;
+            break;
         }
 
         uint8_t *buffer;
@@ -198,7 +204,8 @@ static void upipe_netmap_source_worker(struct upump *upump)
                                                    &buffer)))) {
             uref_free(uref);
             upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
-            return;
+            ret = false;
+            break;
         }
 
         memcpy(buffer, rtp, payload_len);
@@ -207,8 +214,30 @@ static void upipe_netmap_source_worker(struct upump *upump)
         uref_clock_set_cr_sys(uref, systime);
 
         upipe_netmap_source_output(upipe, uref, &upipe_netmap_source->upump);
-next:
-        rxring->head = rxring->cur = nm_ring_next(rxring, cur);
+    }
+
+    rxring->head = rxring->cur = cur;
+    return ret;
+}
+
+static void upipe_netmap_source_worker(struct upump *upump)
+{
+    struct upipe *upipe = upump_get_opaque(upump, struct upipe *);
+    struct upipe_netmap_source *upipe_netmap_source = upipe_netmap_source_from_upipe(upipe);
+
+    uint64_t systime = 0;
+    if (likely(upipe_netmap_source->uclock != NULL))
+        systime = uclock_now(upipe_netmap_source->uclock);
+
+    /* one sync for all the bound rings */
+    ioctl(NETMAP_FD(upipe_netmap_source->d), NIOCRXSYNC, NULL);
+
+    for (unsigned int i = upipe_netmap_source->first_ring;
+         i <= upipe_netmap_source->last_ring; i++) {
+        struct netmap_ring *rxring =
+            NETMAP_RXRING(upipe_netmap_source->d->nifp, i);
+        if (!upipe_netmap_source_rx(upipe, rxring, systime))
+            return;
     }
 }
 
@@ -299,16 +328,16 @@ static int upipe_netmap_source_set_uri(struct upipe *upipe, const char *uri)
     if (unlikely(uri == NULL))
         return UBASE_ERR_NONE;
 
-    if (sscanf(uri, "%*[^-]-%u/R", &upipe_netmap_source->ring_idx) != 1) {
-        upipe_err_va(upipe, "invalid netmap receive uri %s", uri);
-        return UBASE_ERR_EXTERNAL;
-    }
-
+    /* netmap:eth0-2/R binds hardware ring 2 only, so that one pipe may
+     * be allocated per RSS queue, while netmap:eth0/R binds all the
+     * hardware rings, aggregated in this pipe */
     upipe_netmap_source->d = nm_open(uri, NULL, 0, 0);
     if (unlikely(!upipe_netmap_source->d)) {
         upipe_err_va(upipe, "can't open netmap socket %s", uri);
         return UBASE_ERR_EXTERNAL;
     }
+    upipe_netmap_source->first_ring = upipe_netmap_source->d->first_rx_ring;
+    upipe_netmap_source->last_ring = upipe_netmap_source->d->last_rx_ring;
 
     upipe_netmap_source->uri = strdup(uri);
     if (unlikely(upipe_netmap_source->uri == NULL)) {
@@ -318,8 +347,13 @@ static int upipe_netmap_source_set_uri(struct upipe *upipe, const char *uri)
         return UBASE_ERR_ALLOC;
     }
 
-    upipe_notice_va(upipe, "opening netmap socket %s ring %u",
-            upipe_netmap_source->uri, upipe_netmap_source->ring_idx);
+    if (upipe_netmap_source->first_ring == upipe_netmap_source->last_ring)
+        upipe_notice_va(upipe, "opening netmap socket %s ring %u",
+                upipe_netmap_source->uri, upipe_netmap_source->first_ring);
+    else
+        upipe_notice_va(upipe, "opening netmap socket %s rings %u-%u",
+                upipe_netmap_source->uri, upipe_netmap_source->first_ring,
+                upipe_netmap_source->last_ring);
     return UBASE_ERR_NONE;
 }
 
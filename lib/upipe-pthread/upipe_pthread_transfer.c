@@ -28,6 +28,8 @@
  * This is particularly helpful for multithreaded applications.
  */
 
+#define _GNU_SOURCE
+
 #include <upipe/ubase.h>
 #include <upipe/urefcount.h>
 #include <upipe/ueventfd.h>
@@ -52,8 +54,21 @@
 #include <signal.h>
 #include <errno.h>
 #include <math.h>
+#include <sched.h>
 #include <assert.h>
 
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+/** maximum length of a thread name, including the trailing nul */
+#define UPIPE_PTHREAD_NAME_SIZE 16
+/** set_mempolicy(2) policy to allocate pages on the given nodes
+ * (linux/mempolicy.h) */
+#define UPIPE_PTHREAD_MPOL_BIND 2
+/** maximum NUMA node supported by set_mempolicy(2) nodemasks */
+#define UPIPE_PTHREAD_MAX_NODES 256
+
 /** @internal @This is the private context for pthread. */
 struct upipe_pthread_ctx {
     /** xfer manager */
@@ -72,8 +87,109 @@ struct upipe_pthread_ctx {
     struct ueventfd event;
     /** mutual exclusion primitives for access to the event loop */
     struct umutex *mutex;
+
+    /** name of the thread, or empty */
+    char name[UPIPE_PTHREAD_NAME_SIZE];
+#ifdef __linux__
+    /** true if the CPU affinity is set */
+    bool has_cpus;
+    /** CPU affinity of the thread */
+    cpu_set_t cpus;
+#endif
+    /** SCHED_FIFO priority, or 0 */
+    int rt_priority;
+    /** NUMA node, or -1 */
+    int numa_node;
 };
 
+#ifdef __linux__
+/** @internal @This parses a list of CPUs such as "0,2-3".
+ *
+ * @param list list of CPUs
+ * @param cpus filled in with the CPU set
+ * @return false if the list is invalid
+ */
+static bool upipe_pthread_parse_cpus(const char *list, cpu_set_t *cpus)
+{
+    CPU_ZERO(cpus);
+    while (*list != '\0') {
+        char *end;
+        unsigned long first = strtoul(list, &end, 10);
+        unsigned long last = first;
+        if (end == list)
+            return false;
+        if (*end == '-') {
+            list = end + 1;
+            last = strtoul(list, &end, 10);
+            if (end == list || last < first)
+                return false;
+        }
+        if (last >= CPU_SETSIZE)
+            return false;
+        for (unsigned long cpu = first; cpu <= last; cpu++)
+            CPU_SET(cpu, cpus);
+        if (*end == ',')
+            end++;
+        else if (*end != '\0')
+            return false;
+        list = end;
+    }
+    return CPU_COUNT(cpus) > 0;
+}
+#endif
+
+/** @internal @This applies the scheduling options to the calling thread.
+ *
+ * @param pthread_ctx private context of the thread
+ */
+static void upipe_pthread_apply(struct upipe_pthread_ctx *pthread_ctx)
+{
+    struct uprobe *uprobe = pthread_ctx->uprobe_pthread_upump_mgr;
+
+#ifdef __linux__
+    if (pthread_ctx->name[0] != '\0' &&
+        pthread_setname_np(pthread_self(), pthread_ctx->name) != 0)
+        uprobe_warn_va(uprobe, NULL, "unable to set thread name %s",
+                       pthread_ctx->name);
+
+    if (pthread_ctx->has_cpus) {
+        int err = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t),
+                                         &pthread_ctx->cpus);
+        if (err != 0)
+            uprobe_warn_va(uprobe, NULL, "unable to set CPU affinity (%s)",
+                           strerror(err));
+    }
+#endif
+
+    if (pthread_ctx->rt_priority > 0) {
+        struct sched_param param;
+        memset(&param, 0, sizeof(param));
+        param.sched_priority = pthread_ctx->rt_priority;
+        int err = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+        if (err != 0)
+            uprobe_warn_va(uprobe, NULL,
+                           "unable to set SCHED_FIFO priority %d (%s)",
+                           pthread_ctx->rt_priority, strerror(err));
+    }
+
+    if (pthread_ctx->numa_node >= 0) {
+#if defined(__linux__) && defined(SYS_set_mempolicy)
+        unsigned long nodemask[UPIPE_PTHREAD_MAX_NODES /
+                               (sizeof(unsigned long) * 8)];
+        unsigned int bits = sizeof(unsigned long) * 8;
+        memset(nodemask, 0, sizeof(nodemask));
+        nodemask[pthread_ctx->numa_node / bits] =
+            1UL << (pthread_ctx->numa_node % bits);
+        if (syscall(SYS_set_mempolicy, UPIPE_PTHREAD_MPOL_BIND, nodemask,
+                    (unsigned long)UPIPE_PTHREAD_MAX_NODES + 1) != 0)
+            uprobe_warn_va(uprobe, NULL, "unable to bind to NUMA node %d (%s)",
+                           pthread_ctx->numa_node, strerror(errno));
+#else
+        uprobe_warn(uprobe, NULL, "NUMA binding is not supported");
+#endif
+    }
+}
+
 /** @internal @This is the main function of the new thread.
  *
  * @param mgr pointer to a upipe pthread manager
@@ -93,6 +209,8 @@ static void *upipe_pthread_start(void *_pthread_ctx)
 
     pthread_setcanceltype(PTHREAD_CANCEL_ASYNCHRONOUS, NULL);
 
+    upipe_pthread_apply(pthread_ctx);
+
     /* spawn the upump manager */
     struct upump_mgr *upump_mgr =
         pthread_ctx->upump_mgr_alloc(pthread_ctx->upump_pool_depth,
@@ -154,7 +272,7 @@ static void upipe_pthread_stop(struct upump *upump)
 }
 
 /** @This returns a management structure for transfer pipes, using a new
- * pthread. You would need one management structure per target thread.
+ * pthread configured with the given scheduling options.
  *
  * @param queue_length maximum length of the internal queue of commands
  * @param msg_pool_depth maximum number of messages in the pool
@@ -167,19 +285,56 @@ static void upipe_pthread_stop(struct upump *upump)
  * @param mutex mutual exclusion pimitives to access the event loop, or NULL
  * @param pthread_id_p reference to created thread ID (may be NULL)
  * @param attr pthread attributes
+ * @param options scheduling options of the thread, or NULL
  * @return pointer to xfer manager
  */
-struct upipe_mgr *upipe_pthread_xfer_mgr_alloc(uint8_t queue_length,
+struct upipe_mgr *upipe_pthread_xfer_mgr_alloc_opts(uint8_t queue_length,
         uint16_t msg_pool_depth, struct uprobe *uprobe_pthread_upump_mgr,
         upump_mgr_alloc upump_mgr_alloc, uint16_t upump_pool_depth,
         uint16_t upump_blocker_pool_depth, struct umutex *mutex,
-        pthread_t *pthread_id_p, const pthread_attr_t *restrict attr)
+        pthread_t *pthread_id_p, const pthread_attr_t *restrict attr,
+        const struct upipe_pthread_options *options)
 {
     struct upipe_pthread_ctx *pthread_ctx =
         malloc(sizeof(struct upipe_pthread_ctx));
     if (unlikely(pthread_ctx == NULL))
         goto upipe_pthread_xfer_mgr_alloc_err1;
 
+    pthread_ctx->name[0] = '\0';
+#ifdef __linux__
+    pthread_ctx->has_cpus = false;
+#endif
+    pthread_ctx->rt_priority = 0;
+    pthread_ctx->numa_node = -1;
+    if (options != NULL) {
+        if (options->name != NULL) {
+            strncpy(pthread_ctx->name, options->name,
+                    UPIPE_PTHREAD_NAME_SIZE - 1);
+            pthread_ctx->name[UPIPE_PTHREAD_NAME_SIZE - 1] = '\0';
+        }
+        if (options->cpus != NULL) {
+#ifdef __linux__
+            if (unlikely(!upipe_pthread_parse_cpus(options->cpus,
+                                                   &pthread_ctx->cpus))) {
+                uprobe_err_va(uprobe_pthread_upump_mgr, NULL,
+                              "invalid CPU list %s", options->cpus);
+                goto upipe_pthread_xfer_mgr_alloc_err2;
+            }
+            pthread_ctx->has_cpus = true;
+#else
+            uprobe_warn(uprobe_pthread_upump_mgr, NULL,
+                        "CPU affinity is not supported");
+#endif
+        }
+        if (options->numa_node >= UPIPE_PTHREAD_MAX_NODES) {
+            uprobe_err_va(uprobe_pthread_upump_mgr, NULL,
+                          "invalid NUMA node %d", options->numa_node);
+            goto upipe_pthread_xfer_mgr_alloc_err2;
+        }
+        pthread_ctx->rt_priority = options->rt_priority;
+        pthread_ctx->numa_node = options->numa_node;
+    }
+
     if (unlikely(!ueventfd_init(&pthread_ctx->event, false)))
         goto upipe_pthread_xfer_mgr_alloc_err2;
 
@@ -231,3 +386,89 @@ upipe_pthread_xfer_mgr_alloc_err1:
     uprobe_release(uprobe_pthread_upump_mgr);
     return NULL;
 }
+
+/** @This returns a management structure for transfer pipes, using a new
+ * pthread. You would need one management structure per target thread.
+ *
+ * @param queue_length maximum length of the internal queue of commands
+ * @param msg_pool_depth maximum number of messages in the pool
+ * @param uprobe_pthread_upump_mgr pointer to optional probe, that will be set
+ * with the created upump_mgr
+ * @param upump_mgr_alloc alloc function provided by the upump manager
+ * @param upump_pool_depth maximum number of upump structures in the pool
+ * @param upump_blocker_pool_depth maximum number of upump_blocker structures in
+ * the pool
+ * @param mutex mutual exclusion pimitives to access the event loop, or NULL
+ * @param pthread_id_p reference to created thread ID (may be NULL)
+ * @param attr pthread attributes
+ * @return pointer to xfer manager
+ */
+struct upipe_mgr *upipe_pthread_xfer_mgr_alloc(uint8_t queue_length,
+        uint16_t msg_pool_depth, struct uprobe *uprobe_pthread_upump_mgr,
+        upump_mgr_alloc upump_mgr_alloc, uint16_t upump_pool_depth,
+        uint16_t upump_blocker_pool_depth, struct umutex *mutex,
+        pthread_t *pthread_id_p, const pthread_attr_t *restrict attr)
+{
+    return upipe_pthread_xfer_mgr_alloc_opts(queue_length, msg_pool_depth,
+            uprobe_pthread_upump_mgr, upump_mgr_alloc, upump_pool_depth,
+            upump_blocker_pool_depth, mutex, pthread_id_p, attr, NULL);
+}
+
+/** @This returns a management structure for worker pipes (wsrc, wlin,
+ * wsink), multiplexing the remote subpipelines onto a pool of new pthreads
+ * configured with the given scheduling options. Each new worker pipe is
+ * assigned to the thread with the fewest live worker pipes.
+ *
+ * @param nb_threads number of threads in the pool, or 0 for one thread per
+ * online CPU
+ * @param queue_length maximum length of the internal queue of commands
+ * @param msg_pool_depth maximum number of messages in the pool
+ * @param uprobe_pthread_upump_mgr pointer to optional probe, that will be set
+ * with the created upump_mgr
+ * @param upump_mgr_alloc alloc function provided by the upump manager
+ * @param upump_pool_depth maximum number of upump structures in the pool
+ * @param upump_blocker_pool_depth maximum number of upump_blocker structures in
+ * the pool
+ * @param mutex mutual exclusion pimitives to access the event loop, or NULL
+ * @param options scheduling options of the threads, or NULL
+ * @return pointer to worker manager
+ */
+struct upipe_mgr *upipe_pthread_work_pool_mgr_alloc(unsigned int nb_threads,
+        uint8_t queue_length, uint16_t msg_pool_depth,
+        struct uprobe *uprobe_pthread_upump_mgr,
+        upump_mgr_alloc upump_mgr_alloc, uint16_t upump_pool_depth,
+        uint16_t upump_blocker_pool_depth, struct umutex *mutex,
+        const struct upipe_pthread_options *options)
+{
+    if (!nb_threads) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        nb_threads = cpus > 0 ? cpus : 1;
+    }
+
+    struct upipe_mgr *work_mgr = NULL;
+    struct upipe_mgr **xfer_mgrs = calloc(nb_threads,
+                                          sizeof(struct upipe_mgr *));
+    if (unlikely(xfer_mgrs == NULL))
+        goto upipe_pthread_work_pool_mgr_alloc_err;
+
+    for (unsigned int i = 0; i < nb_threads; i++) {
+        xfer_mgrs[i] = upipe_pthread_xfer_mgr_alloc_opts(
+                queue_length, msg_pool_depth,
+                uprobe_use(uprobe_pthread_upump_mgr), upump_mgr_alloc,
+                upump_pool_depth, upump_blocker_pool_depth, mutex,
+                NULL, NULL, options);
+        if (unlikely(xfer_mgrs[i] == NULL))
+            goto upipe_pthread_work_pool_mgr_alloc_err;
+    }
+
+    work_mgr = upipe_work_pool_mgr_alloc(xfer_mgrs, nb_threads);
+
+upipe_pthread_work_pool_mgr_alloc_err:
+    if (xfer_mgrs != NULL) {
+        for (unsigned int i = 0; i < nb_threads; i++)
+            upipe_mgr_release(xfer_mgrs[i]);
+        free(xfer_mgrs);
+    }
+    uprobe_release(uprobe_pthread_upump_mgr);
+    return work_mgr;
+}
@@ -0,0 +1,410 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short probe logging asynchronously from a dedicated thread
+ */
+
+#include <upipe/ubase.h>
+#include <upipe/ulist.h>
+#include <upipe/uclock.h>
+#include <upipe/uprobe.h>
+#include <upipe/uprobe_helper_alloc.h>
+#include <upipe-pthread/uprobe_pthread_log.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <inttypes.h>
+#include <time.h>
+
+/** size of the text of a record, including prefixes */
+#define RECORD_TEXT_SIZE 480
+/** maximum number of prefixes in a record */
+#define RECORD_MAX_PFX 16
+/** number of entries in the table of message sites (power of 2) */
+#define NB_SITES 256
+/** number of characters of the message used to identify its site */
+#define SITE_MSG_LEN 48
+/** default maximum number of messages per site and period */
+#define DEFAULT_BURST 20
+/** default rate limiting period */
+#define DEFAULT_PERIOD UCLOCK_FREQ
+/** maximum number of spins of the logging thread before sleeping */
+#define MAX_SPIN 256
+/** maximum sleeping time of the logging thread */
+#define WAIT_TIMEOUT (UCLOCK_FREQ / 10)
+/** polling period of the logging thread without futexes, in ns */
+#define POLL_PERIOD 10000000
+
+/** @internal @This is a preformatted log message. */
+struct uprobe_pthread_log_record {
+    /** level of the message */
+    enum uprobe_log_level level;
+    /** number of prefixes */
+    unsigned int nb_pfx;
+    /** prefixes from the innermost one, then message, separated by '\0' */
+    char text[RECORD_TEXT_SIZE];
+};
+
+/** @internal @This is the rate limiting state of a message site. */
+struct uprobe_pthread_log_site {
+    /** start of the current period */
+    uint64_t start;
+    /** number of messages in the current period */
+    uint32_t count;
+};
+
+/** @internal @This returns the current monotonic time.
+ *
+ * @return current time in 27 MHz ticks
+ */
+static uint64_t uprobe_pthread_log_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * UCLOCK_FREQ +
+           (uint64_t)ts.tv_nsec * 27 / 1000;
+}
+
+/** @internal @This checks whether the rate limit of the site of a message
+ * allows to log it. Concurrent threads may race on the same site, which
+ * only makes the limit approximate.
+ *
+ * @param uprobe_pthread_log private structure of the probe
+ * @param upipe pipe throwing the message
+ * @param ulog log message
+ * @return false if the message must be dropped
+ */
+static bool uprobe_pthread_log_check_rate(
+        struct uprobe_pthread_log *uprobe_pthread_log,
+        struct upipe *upipe, struct ulog *ulog)
+{
+    unsigned int burst = __atomic_load_n(&uprobe_pthread_log->burst,
+                                         __ATOMIC_RELAXED);
+    if (!burst)
+        return true;
+
+    /* FNV-1a of the pipe, the level and the message without digits */
+    uint64_t hash = UINT64_C(14695981039346656037);
+    uintptr_t key[2] = { (uintptr_t)upipe, ulog->level };
+    const uint8_t *p = (const uint8_t *)key;
+    for (size_t i = 0; i < sizeof(key); i++)
+        hash = (hash ^ p[i]) * UINT64_C(1099511628211);
+    for (size_t i = 0; i < SITE_MSG_LEN && ulog->msg[i]; i++)
+        if (ulog->msg[i] < '0' || ulog->msg[i] > '9')
+            hash = (hash ^ (uint8_t)ulog->msg[i]) * UINT64_C(1099511628211);
+
+    struct uprobe_pthread_log_site *site =
+        &uprobe_pthread_log->sites[hash & (NB_SITES - 1)];
+    uint64_t period = __atomic_load_n(&uprobe_pthread_log->period,
+                                      __ATOMIC_RELAXED);
+    uint64_t now = uprobe_pthread_log_now();
+    uint64_t start = __atomic_load_n(&site->start, __ATOMIC_RELAXED);
+    if ((!start || now - start >= period) &&
+        __atomic_compare_exchange_n(&site->start, &start, now, false,
+                                    __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        __atomic_store_n(&site->count, 1, __ATOMIC_RELAXED);
+        return true;
+    }
+    return __atomic_add_fetch(&site->count, 1, __ATOMIC_RELAXED) <= burst;
+}
+
+/** @internal @This copies a log message into a record.
+ *
+ * @param record record to fill in
+ * @param ulog log message
+ */
+static void uprobe_pthread_log_fill(struct uprobe_pthread_log_record *record,
+                                    struct ulog *ulog)
+{
+    size_t msg_len = strlen(ulog->msg) + 1;
+    size_t pos = 0;
+    struct uchain *uchain;
+
+    record->level = ulog->level;
+    record->nb_pfx = 0;
+    ulist_foreach(&ulog->prefixes, uchain) {
+        struct ulog_pfx *ulog_pfx = ulog_pfx_from_uchain(uchain);
+        size_t len = strlen(ulog_pfx->tag) + 1;
+        /* keep the room for the message, which is more useful */
+        if (record->nb_pfx == RECORD_MAX_PFX ||
+            pos + len + (msg_len < 64 ? msg_len : 64) > RECORD_TEXT_SIZE)
+            break;
+        memcpy(record->text + pos, ulog_pfx->tag, len);
+        pos += len;
+        record->nb_pfx++;
+    }
+
+    if (msg_len > RECORD_TEXT_SIZE - pos)
+        msg_len = RECORD_TEXT_SIZE - pos;
+    memcpy(record->text + pos, ulog->msg, msg_len);
+    record->text[pos + msg_len - 1] = '\0';
+}
+
+/** @internal @This catches events thrown by pipes.
+ *
+ * @param uprobe pointer to probe
+ * @param upipe pointer to pipe throwing the event
+ * @param event event thrown
+ * @param args optional event-specific parameters
+ * @return an error code
+ */
+static int uprobe_pthread_log_throw(struct uprobe *uprobe,
+                                    struct upipe *upipe,
+                                    int event, va_list args)
+{
+    struct uprobe_pthread_log *uprobe_pthread_log =
+        uprobe_pthread_log_from_uprobe(uprobe);
+    if (event != UPROBE_LOG)
+        return uprobe_throw_next(uprobe, upipe, event, args);
+
+    struct ulog *ulog = va_arg(args, struct ulog *);
+    if (!uprobe_log_enabled(uprobe->next, ulog->level))
+        return UBASE_ERR_NONE;
+
+    if (!uprobe_pthread_log_check_rate(uprobe_pthread_log, upipe, ulog)) {
+        __atomic_add_fetch(&uprobe_pthread_log->limited, 1, __ATOMIC_RELAXED);
+        return UBASE_ERR_NONE;
+    }
+
+    struct uprobe_pthread_log_record *record =
+        ulifo_pop(&uprobe_pthread_log->records,
+                  struct uprobe_pthread_log_record *);
+    if (unlikely(record == NULL)) {
+        __atomic_add_fetch(&uprobe_pthread_log->dropped, 1, __ATOMIC_RELAXED);
+        return UBASE_ERR_NONE;
+    }
+
+    uprobe_pthread_log_fill(record, ulog);
+    if (unlikely(!uqueue_push(&uprobe_pthread_log->queue, record))) {
+        ulifo_push(&uprobe_pthread_log->records, record);
+        __atomic_add_fetch(&uprobe_pthread_log->dropped, 1, __ATOMIC_RELAXED);
+    }
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This throws the pending records to the next probe, and
+ * reports the messages dropped since the last call.
+ *
+ * @param uprobe_pthread_log private structure of the probe
+ * @param dropped_p number of dropped messages already reported
+ */
+static void uprobe_pthread_log_drain(
+        struct uprobe_pthread_log *uprobe_pthread_log, uint64_t *dropped_p)
+{
+    struct uprobe *next = uprobe_pthread_log->uprobe.next;
+    struct uprobe_pthread_log_record *record;
+
+    while ((record = uqueue_pop(&uprobe_pthread_log->queue,
+                                struct uprobe_pthread_log_record *))
+            != NULL) {
+        struct ulog ulog;
+        struct ulog_pfx ulog_pfx[RECORD_MAX_PFX];
+        const char *text = record->text;
+        ulog_init(&ulog, record->level, NULL);
+        for (unsigned int i = 0; i < record->nb_pfx; i++) {
+            ulog_pfx[i].tag = text;
+            ulist_add(&ulog.prefixes, ulog_pfx_to_uchain(&ulog_pfx[i]));
+            text += strlen(text) + 1;
+        }
+        ulog.msg = text;
+        uprobe_throw(next, NULL, UPROBE_LOG, &ulog);
+        ulifo_push(&uprobe_pthread_log->records, record);
+    }
+
+    uint64_t dropped = __atomic_load_n(&uprobe_pthread_log->dropped,
+                                       __ATOMIC_RELAXED) +
+                       __atomic_load_n(&uprobe_pthread_log->limited,
+                                       __ATOMIC_RELAXED);
+    if (unlikely(dropped != *dropped_p)) {
+        uprobe_log_va(next, NULL, UPROBE_LOG_WARNING,
+                      "%"PRIu64" log messages dropped", dropped - *dropped_p);
+        *dropped_p = dropped;
+    }
+}
+
+/** @internal @This is the main function of the logging thread.
+ *
+ * @param opaque private structure of the probe
+ * @return NULL
+ */
+static void *uprobe_pthread_log_run(void *opaque)
+{
+    struct uprobe_pthread_log *uprobe_pthread_log = opaque;
+    uint64_t dropped = 0;
+
+    while (!__atomic_load_n(&uprobe_pthread_log->stop, __ATOMIC_ACQUIRE)) {
+        uprobe_pthread_log_drain(uprobe_pthread_log, &dropped);
+        if (uprobe_pthread_log->queue.futex)
+            uqueue_wait_pop(&uprobe_pthread_log->queue, MAX_SPIN,
+                            WAIT_TIMEOUT);
+        else {
+            struct timespec ts = { .tv_sec = 0, .tv_nsec = POLL_PERIOD };
+            nanosleep(&ts, NULL);
+        }
+    }
+    uprobe_pthread_log_drain(uprobe_pthread_log, &dropped);
+    return NULL;
+}
+
+/** @This initializes an already allocated uprobe_pthread_log structure, and
+ * starts the logging thread.
+ *
+ * @param uprobe_pthread_log pointer to the already allocated structure
+ * @param next next probe, receiving the log events in the logging thread
+ * @param length maximum number of pending messages
+ * @return pointer to uprobe, or NULL in case of error
+ */
+struct uprobe *uprobe_pthread_log_init(
+        struct uprobe_pthread_log *uprobe_pthread_log,
+        struct uprobe *next, uint8_t length)
+{
+    assert(uprobe_pthread_log != NULL);
+    assert(length);
+    struct uprobe *uprobe = uprobe_pthread_log_to_uprobe(uprobe_pthread_log);
+
+    uprobe_pthread_log->extra = malloc(uqueue_sizeof(length) +
+                                       ulifo_sizeof(length));
+    uprobe_pthread_log->record_array =
+        malloc(length * sizeof(struct uprobe_pthread_log_record));
+    uprobe_pthread_log->sites =
+        calloc(NB_SITES, sizeof(struct uprobe_pthread_log_site));
+    if (unlikely(uprobe_pthread_log->extra == NULL ||
+                 uprobe_pthread_log->record_array == NULL ||
+                 uprobe_pthread_log->sites == NULL))
+        goto uprobe_pthread_log_init_err;
+
+    if (!uqueue_init_futex(&uprobe_pthread_log->queue, length,
+                           uprobe_pthread_log->extra) &&
+        unlikely(!uqueue_init(&uprobe_pthread_log->queue, length,
+                              uprobe_pthread_log->extra)))
+        goto uprobe_pthread_log_init_err;
+    ulifo_init(&uprobe_pthread_log->records, length,
+               (uint8_t *)uprobe_pthread_log->extra + uqueue_sizeof(length));
+    for (unsigned int i = 0; i < length; i++)
+        ulifo_push(&uprobe_pthread_log->records,
+                   &uprobe_pthread_log->record_array[i]);
+
+    uprobe_pthread_log->burst = DEFAULT_BURST;
+    uprobe_pthread_log->period = DEFAULT_PERIOD;
+    uprobe_pthread_log->dropped = 0;
+    uprobe_pthread_log->limited = 0;
+    uprobe_pthread_log->stop = false;
+
+    uprobe_init(uprobe, uprobe_pthread_log_throw, next);
+    uprobe_set_event_mask(uprobe, UPROBE_EVENT_MASK(UPROBE_LOG));
+    uprobe_set_log_filter(uprobe, UPROBE_LOG_VERBOSE);
+
+    if (unlikely(pthread_create(&uprobe_pthread_log->thread, NULL,
+                                uprobe_pthread_log_run,
+                                uprobe_pthread_log) != 0)) {
+        uprobe_clean(uprobe);
+        ulifo_clean(&uprobe_pthread_log->records);
+        uqueue_clean(&uprobe_pthread_log->queue);
+        free(uprobe_pthread_log->sites);
+        free(uprobe_pthread_log->record_array);
+        free(uprobe_pthread_log->extra);
+        return NULL;
+    }
+    return uprobe;
+
+uprobe_pthread_log_init_err:
+    free(uprobe_pthread_log->sites);
+    free(uprobe_pthread_log->record_array);
+    free(uprobe_pthread_log->extra);
+    uprobe_release(next);
+    return NULL;
+}
+
+/** @This stops the logging thread after it has logged the pending messages,
+ * and cleans a uprobe_pthread_log structure.
+ *
+ * @param uprobe_pthread_log structure to clean
+ */
+void uprobe_pthread_log_clean(struct uprobe_pthread_log *uprobe_pthread_log)
+{
+    assert(uprobe_pthread_log != NULL);
+    struct uprobe *uprobe = uprobe_pthread_log_to_uprobe(uprobe_pthread_log);
+
+    __atomic_store_n(&uprobe_pthread_log->stop, true, __ATOMIC_RELEASE);
+    uqueue_signal_pop(&uprobe_pthread_log->queue);
+    pthread_join(uprobe_pthread_log->thread, NULL);
+
+    while (ulifo_pop(&uprobe_pthread_log->records, void *) != NULL);
+    ulifo_clean(&uprobe_pthread_log->records);
+    uqueue_clean(&uprobe_pthread_log->queue);
+    free(uprobe_pthread_log->sites);
+    free(uprobe_pthread_log->record_array);
+    free(uprobe_pthread_log->extra);
+    uprobe_clean(uprobe);
+}
+
+#define ARGS_DECL struct uprobe *next, uint8_t length
+#define ARGS next, length
+UPROBE_HELPER_ALLOC(uprobe_pthread_log)
+#undef ARGS
+#undef ARGS_DECL
+
+/** @This sets the rate limiting of the messages. At most burst messages
+ * from the same site are logged per period.
+ *
+ * @param uprobe pointer to probe
+ * @param burst maximum number of messages per site and period, or 0 to
+ * disable rate limiting
+ * @param period duration of the period, in 27 MHz ticks
+ */
+void uprobe_pthread_log_set_rate_limit(struct uprobe *uprobe,
+                                       unsigned int burst, uint64_t period)
+{
+    struct uprobe_pthread_log *uprobe_pthread_log =
+        uprobe_pthread_log_from_uprobe(uprobe);
+    __atomic_store_n(&uprobe_pthread_log->period, period, __ATOMIC_RELAXED);
+    __atomic_store_n(&uprobe_pthread_log->burst, burst, __ATOMIC_RELAXED);
+}
+
+/** @This returns the number of dropped messages. It may be called from any
+ * thread.
+ *
+ * @param uprobe pointer to probe
+ * @param dropped_p filled in with the number of messages dropped because the
+ * queue was full (may be NULL)
+ * @param limited_p filled in with the number of messages dropped by rate
+ * limiting (may be NULL)
+ */
+void uprobe_pthread_log_get_dropped(struct uprobe *uprobe,
+                                    uint64_t *dropped_p, uint64_t *limited_p)
+{
+    struct uprobe_pthread_log *uprobe_pthread_log =
+        uprobe_pthread_log_from_uprobe(uprobe);
+    if (dropped_p != NULL)
+        *dropped_p = __atomic_load_n(&uprobe_pthread_log->dropped,
+                                     __ATOMIC_RELAXED);
+    if (limited_p != NULL)
+        *limited_p = __atomic_load_n(&uprobe_pthread_log->limited,
+                                     __ATOMIC_RELAXED);
+}
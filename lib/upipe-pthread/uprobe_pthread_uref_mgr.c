@@ -0,0 +1,352 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/** @file
+ * @short probe catching provide_request events asking for uref or ubuf managers, and providing managers allocated for the calling thread
+ */
+
+#include <upipe/ubase.h>
+#include <upipe/ulist.h>
+#include <upipe/umem.h>
+#include <upipe/udict.h>
+#include <upipe/udict_inline.h>
+#include <upipe/uref.h>
+#include <upipe/uref_std.h>
+#include <upipe/ubuf.h>
+#include <upipe/ubuf_mem.h>
+#include <upipe/uprobe.h>
+#include <upipe/uprobe_helper_alloc.h>
+#include <upipe/upipe.h>
+#include <upipe-pthread/uprobe_pthread_uref_mgr.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stdbool.h>
+
+/** @This is a ubuf manager allocated for a thread. */
+struct uprobe_pthread_uref_mgr_ubuf {
+    /** structure for double-linked lists */
+    struct uchain uchain;
+    /** pointer to ubuf manager */
+    struct ubuf_mgr *ubuf_mgr;
+};
+
+UBASE_FROM_TO(uprobe_pthread_uref_mgr_ubuf, uchain, uchain, uchain)
+
+/** @This is a thread-local structure used by the probe. */
+struct uprobe_pthread_uref_mgr_local {
+    /** pointer to uref manager, allocated on first use */
+    struct uref_mgr *uref_mgr;
+    /** list of ubuf managers */
+    struct uchain ubuf_mgrs;
+    /** depth of the udict pool */
+    uint16_t udict_pool_depth;
+    /** depth of the uref pool */
+    uint16_t uref_pool_depth;
+    /** depth of the ubuf pools */
+    uint16_t ubuf_pool_depth;
+    /** depth of the shared object pools */
+    uint16_t shared_pool_depth;
+};
+
+/** @internal @This returns thread local storage, or allocates it if needed.
+ *
+ * @param uprobe pointer to probe
+ * @return thread local storage, or NULL in case of error
+ */
+static struct uprobe_pthread_uref_mgr_local *
+    uprobe_pthread_uref_mgr_tls(struct uprobe *uprobe)
+{
+    struct uprobe_pthread_uref_mgr *uprobe_pthread_uref_mgr =
+        uprobe_pthread_uref_mgr_from_uprobe(uprobe);
+    struct uprobe_pthread_uref_mgr_local *tls =
+        pthread_getspecific(uprobe_pthread_uref_mgr->key);
+    if (unlikely(tls == NULL)) {
+        tls = malloc(sizeof(struct uprobe_pthread_uref_mgr_local));
+        if (unlikely(tls == NULL))
+            return NULL;
+        tls->uref_mgr = NULL;
+        ulist_init(&tls->ubuf_mgrs);
+        tls->udict_pool_depth = uprobe_pthread_uref_mgr->udict_pool_depth;
+        tls->uref_pool_depth = uprobe_pthread_uref_mgr->uref_pool_depth;
+        tls->ubuf_pool_depth = uprobe_pthread_uref_mgr->ubuf_pool_depth;
+        tls->shared_pool_depth = uprobe_pthread_uref_mgr->shared_pool_depth;
+        if (unlikely(pthread_setspecific(uprobe_pthread_uref_mgr->key,
+                                         tls) != 0)) {
+            free(tls);
+            return NULL;
+        }
+    }
+    return tls;
+}
+
+/** @internal @This releases the managers kept in thread local storage.
+ *
+ * @param tls thread local storage
+ */
+static void uprobe_pthread_uref_mgr_release(
+        struct uprobe_pthread_uref_mgr_local *tls)
+{
+    uref_mgr_release(tls->uref_mgr);
+    tls->uref_mgr = NULL;
+
+    struct uchain *uchain, *uchain_tmp;
+    ulist_delete_foreach (&tls->ubuf_mgrs, uchain, uchain_tmp) {
+        struct uprobe_pthread_uref_mgr_ubuf *elem =
+            uprobe_pthread_uref_mgr_ubuf_from_uchain(uchain);
+        ulist_delete(uchain);
+        ubuf_mgr_release(elem->ubuf_mgr);
+        free(elem);
+    }
+}
+
+/** @internal @This destroys thread local storage.
+ *
+ * @param pointer to thread local storage
+ */
+static void uprobe_pthread_uref_mgr_destr(void *_tls)
+{
+    struct uprobe_pthread_uref_mgr_local *tls = _tls;
+    uprobe_pthread_uref_mgr_release(tls);
+    free(_tls);
+}
+
+/** @internal @This returns the uref manager of the current thread, or
+ * allocates it if needed.
+ *
+ * @param uprobe pointer to probe
+ * @param tls thread local storage
+ * @return pointer to uref manager, or NULL in case of error
+ */
+static struct uref_mgr *uprobe_pthread_uref_mgr_get_uref_mgr(
+        struct uprobe *uprobe, struct uprobe_pthread_uref_mgr_local *tls)
+{
+    struct uprobe_pthread_uref_mgr *uprobe_pthread_uref_mgr =
+        uprobe_pthread_uref_mgr_from_uprobe(uprobe);
+    if (likely(tls->uref_mgr != NULL))
+        return tls->uref_mgr;
+
+    struct udict_mgr *udict_mgr =
+        udict_inline_mgr_alloc(tls->udict_pool_depth,
+                               uprobe_pthread_uref_mgr->umem_mgr, -1, -1);
+    if (unlikely(udict_mgr == NULL))
+        return NULL;
+    tls->uref_mgr = uref_std_mgr_alloc(tls->uref_pool_depth, udict_mgr, 0);
+    udict_mgr_release(udict_mgr);
+    return tls->uref_mgr;
+}
+
+/** @internal @This returns a ubuf manager of the current thread for the
+ * given flow definition, or allocates it if needed.
+ *
+ * @param uprobe pointer to probe
+ * @param tls thread local storage
+ * @param flow_def flow definition
+ * @return pointer to ubuf manager, or NULL in case of error
+ */
+static struct ubuf_mgr *uprobe_pthread_uref_mgr_get_ubuf_mgr(
+        struct uprobe *uprobe, struct uprobe_pthread_uref_mgr_local *tls,
+        struct uref *flow_def)
+{
+    struct uprobe_pthread_uref_mgr *uprobe_pthread_uref_mgr =
+        uprobe_pthread_uref_mgr_from_uprobe(uprobe);
+    struct uchain *uchain;
+    ulist_foreach (&tls->ubuf_mgrs, uchain) {
+        struct uprobe_pthread_uref_mgr_ubuf *elem =
+            uprobe_pthread_uref_mgr_ubuf_from_uchain(uchain);
+        if (ubase_check(ubuf_mgr_check(elem->ubuf_mgr, flow_def)))
+            return elem->ubuf_mgr;
+    }
+
+    struct uprobe_pthread_uref_mgr_ubuf *elem =
+        malloc(sizeof(struct uprobe_pthread_uref_mgr_ubuf));
+    if (unlikely(elem == NULL))
+        return NULL;
+    elem->ubuf_mgr = ubuf_mem_mgr_alloc_from_flow_def(tls->ubuf_pool_depth,
+            tls->shared_pool_depth, uprobe_pthread_uref_mgr->umem_mgr,
+            flow_def);
+    if (unlikely(elem->ubuf_mgr == NULL)) {
+        free(elem);
+        return NULL;
+    }
+    uchain_init(&elem->uchain);
+    ulist_add(&tls->ubuf_mgrs, &elem->uchain);
+    return elem->ubuf_mgr;
+}
+
+/** @internal @This catches events thrown by pipes.
+ *
+ * @param uprobe pointer to probe
+ * @param upipe pointer to pipe throwing the event
+ * @param event event thrown
+ * @param args optional event-specific parameters
+ * @return an error code
+ */
+static int uprobe_pthread_uref_mgr_throw(struct uprobe *uprobe,
+                                         struct upipe *upipe,
+                                         int event, va_list args)
+{
+    struct uprobe_pthread_uref_mgr *uprobe_pthread_uref_mgr =
+        uprobe_pthread_uref_mgr_from_uprobe(uprobe);
+    if (event != UPROBE_PROVIDE_REQUEST ||
+        uprobe_pthread_uref_mgr->umem_mgr == NULL)
+        return uprobe_throw_next(uprobe, upipe, event, args);
+
+    va_list args_copy;
+    va_copy(args_copy, args);
+    struct urequest *urequest = va_arg(args_copy, struct urequest *);
+    va_end(args_copy);
+    if (urequest->type != UREQUEST_UREF_MGR &&
+        urequest->type != UREQUEST_UBUF_MGR)
+        return uprobe_throw_next(uprobe, upipe, event, args);
+
+    struct uprobe_pthread_uref_mgr_local *tls =
+        uprobe_pthread_uref_mgr_tls(uprobe);
+    if (unlikely(tls == NULL))
+        return UBASE_ERR_ALLOC;
+
+    if (urequest->type == UREQUEST_UREF_MGR) {
+        struct uref_mgr *uref_mgr =
+            uprobe_pthread_uref_mgr_get_uref_mgr(uprobe, tls);
+        if (unlikely(uref_mgr == NULL))
+            return uprobe_throw_next(uprobe, upipe, event, args);
+        return urequest_provide_uref_mgr(urequest, uref_mgr_use(uref_mgr));
+    }
+
+    struct ubuf_mgr *ubuf_mgr =
+        uprobe_pthread_uref_mgr_get_ubuf_mgr(uprobe, tls, urequest->uref);
+    if (unlikely(ubuf_mgr == NULL))
+        return uprobe_throw_next(uprobe, upipe, event, args);
+
+    struct uref *uref = uref_dup(urequest->uref);
+    if (unlikely(uref == NULL))
+        return UBASE_ERR_ALLOC;
+    return urequest_provide_ubuf_mgr(urequest, ubuf_mgr_use(ubuf_mgr), uref);
+}
+
+/** @This initializes an already allocated uprobe_pthread_uref_mgr structure.
+ *
+ * @param uprobe_pthread_uref_mgr pointer to the already allocated structure
+ * @param next next probe to test if this one doesn't catch the event
+ * @param umem_mgr memory allocator to use for managers and buffers
+ * @param udict_pool_depth maximum number of udict structures in each pool
+ * @param uref_pool_depth maximum number of uref structures in each pool
+ * @param ubuf_pool_depth maximum number of ubuf structures in each pool
+ * @param shared_pool_depth maximum number of shared structures in each pool
+ * @return pointer to uprobe, or NULL in case of error
+ */
+struct uprobe *uprobe_pthread_uref_mgr_init(
+        struct uprobe_pthread_uref_mgr *uprobe_pthread_uref_mgr,
+        struct uprobe *next, struct umem_mgr *umem_mgr,
+        uint16_t udict_pool_depth, uint16_t uref_pool_depth,
+        uint16_t ubuf_pool_depth, uint16_t shared_pool_depth)
+{
+    assert(uprobe_pthread_uref_mgr != NULL);
+    struct uprobe *uprobe =
+        uprobe_pthread_uref_mgr_to_uprobe(uprobe_pthread_uref_mgr);
+    if (unlikely(pthread_key_create(&uprobe_pthread_uref_mgr->key,
+                                    uprobe_pthread_uref_mgr_destr) != 0))
+        return NULL;
+    uprobe_pthread_uref_mgr->umem_mgr = umem_mgr_use(umem_mgr);
+    uprobe_pthread_uref_mgr->udict_pool_depth = udict_pool_depth;
+    uprobe_pthread_uref_mgr->uref_pool_depth = uref_pool_depth;
+    uprobe_pthread_uref_mgr->ubuf_pool_depth = ubuf_pool_depth;
+    uprobe_pthread_uref_mgr->shared_pool_depth = shared_pool_depth;
+    uprobe_init(uprobe, uprobe_pthread_uref_mgr_throw, next);
+    uprobe_set_event_mask(uprobe, UPROBE_EVENT_MASK(UPROBE_PROVIDE_REQUEST));
+    return uprobe;
+}
+
+/** @This cleans a uprobe_pthread_uref_mgr structure.
+ *
+ * @param uprobe_pthread_uref_mgr structure to clean
+ */
+void uprobe_pthread_uref_mgr_clean(
+        struct uprobe_pthread_uref_mgr *uprobe_pthread_uref_mgr)
+{
+    assert(uprobe_pthread_uref_mgr != NULL);
+    struct uprobe *uprobe =
+        uprobe_pthread_uref_mgr_to_uprobe(uprobe_pthread_uref_mgr);
+    struct uprobe_pthread_uref_mgr_local *tls =
+        pthread_getspecific(uprobe_pthread_uref_mgr->key);
+    if (tls != NULL)
+        /* POSIX doesn't deallocate values on key deletion */
+        uprobe_pthread_uref_mgr_destr(tls);
+    pthread_key_delete(uprobe_pthread_uref_mgr->key);
+    umem_mgr_release(uprobe_pthread_uref_mgr->umem_mgr);
+    uprobe_clean(uprobe);
+}
+
+#define ARGS_DECL struct uprobe *next, struct umem_mgr *umem_mgr, uint16_t udict_pool_depth, uint16_t uref_pool_depth, uint16_t ubuf_pool_depth, uint16_t shared_pool_depth
+#define ARGS next, umem_mgr, udict_pool_depth, uref_pool_depth, ubuf_pool_depth, shared_pool_depth
+UPROBE_HELPER_ALLOC(uprobe_pthread_uref_mgr)
+#undef ARGS
+#undef ARGS_DECL
+
+/** @This changes the pool depths used by this probe for the current thread.
+ * The managers already allocated for the thread are released, so that the
+ * next requests get managers with the new depths.
+ *
+ * @param uprobe pointer to probe
+ * @param udict_pool_depth maximum number of udict structures in the pool
+ * @param uref_pool_depth maximum number of uref structures in the pool
+ * @param ubuf_pool_depth maximum number of ubuf structures in each pool
+ * @param shared_pool_depth maximum number of shared structures in each pool
+ * @return an error code
+ */
+int uprobe_pthread_uref_mgr_set_depths(struct uprobe *uprobe,
+                                       uint16_t udict_pool_depth,
+                                       uint16_t uref_pool_depth,
+                                       uint16_t ubuf_pool_depth,
+                                       uint16_t shared_pool_depth)
+{
+    struct uprobe_pthread_uref_mgr_local *tls =
+        uprobe_pthread_uref_mgr_tls(uprobe);
+    if (unlikely(tls == NULL))
+        return UBASE_ERR_ALLOC;
+    uprobe_pthread_uref_mgr_release(tls);
+    tls->udict_pool_depth = udict_pool_depth;
+    tls->uref_pool_depth = uref_pool_depth;
+    tls->ubuf_pool_depth = ubuf_pool_depth;
+    tls->shared_pool_depth = shared_pool_depth;
+    return UBASE_ERR_NONE;
+}
+
+/** @This releases the managers allocated for the current thread. They are
+ * allocated again on the next requests.
+ *
+ * @param uprobe pointer to probe
+ */
+void uprobe_pthread_uref_mgr_vacuum(struct uprobe *uprobe)
+{
+    struct uprobe_pthread_uref_mgr *uprobe_pthread_uref_mgr =
+        uprobe_pthread_uref_mgr_from_uprobe(uprobe);
+    struct uprobe_pthread_uref_mgr_local *tls =
+        pthread_getspecific(uprobe_pthread_uref_mgr->key);
+    if (tls != NULL)
+        uprobe_pthread_uref_mgr_release(tls);
+}
@@ -100,10 +100,21 @@ struct upipe_speexdsp {
 
     /** current drift rate */
     struct urational drift_rate;
+    /** true if the drift rate was set by the application */
+    bool drift_rate_forced;
 
     /** resampling quality */
     int quality;
 
+    /** size of an interleaved sample */
+    uint8_t sample_size;
+    /** number of samples per output chunk, or 0 */
+    unsigned int chunk;
+    /** output chunk being filled, in streaming mode */
+    struct uref *chunk_uref;
+    /** number of samples already in the output chunk */
+    unsigned int chunk_fill;
+
     /** public upipe structure */
     struct upipe upipe;
 };
@@ -119,6 +130,126 @@ UPIPE_HELPER_UBUF_MGR(upipe_speexdsp, ubuf_mgr, flow_format, ubuf_mgr_request,
                       upipe_speexdsp_unregister_output_request)
 UPIPE_HELPER_INPUT(upipe_speexdsp, urefs, nb_urefs, max_urefs, blockers, upipe_speexdsp_handle)
 
+/** @internal @This updates the resampling ratio from a drift rate, without
+ * resetting the resampler.
+ *
+ * @param upipe description structure of the pipe
+ * @param drift_rate drift rate
+ */
+static void upipe_speexdsp_update_rate(struct upipe *upipe,
+                                       struct urational drift_rate)
+{
+    struct upipe_speexdsp *upipe_speexdsp = upipe_speexdsp_from_upipe(upipe);
+    if (!urational_cmp(&drift_rate, &upipe_speexdsp->drift_rate))
+        return;
+
+    upipe_speexdsp->drift_rate = drift_rate;
+    if (upipe_speexdsp->ctx == NULL)
+        return;
+
+    spx_uint32_t ratio_num = drift_rate.den;
+    spx_uint32_t ratio_den = drift_rate.num;
+    spx_uint32_t in_rate = upipe_speexdsp->rate * ratio_num / ratio_den;
+    spx_uint32_t out_rate = upipe_speexdsp->rate;
+    int err = speex_resampler_set_rate_frac(upipe_speexdsp->ctx,
+            ratio_num, ratio_den, in_rate, out_rate);
+    if (err) {
+        upipe_err_va(upipe, "Couldn't resample from %u to %u: %s",
+            in_rate, out_rate, speex_resampler_strerror(err));
+    } else {
+        upipe_dbg_va(upipe, "Resampling from %u to %u",
+            in_rate, out_rate);
+    }
+}
+
+/** @internal @This resamples data in streaming mode, outputting chunks of
+ * fixed size.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref uref structure
+ * @param size number of samples in the uref
+ * @param upump_p reference to pump that generated the buffer
+ */
+static void upipe_speexdsp_stream(struct upipe *upipe, struct uref *uref,
+                                  size_t size, struct upump **upump_p)
+{
+    struct upipe_speexdsp *upipe_speexdsp = upipe_speexdsp_from_upipe(upipe);
+    unsigned int chunk = upipe_speexdsp->chunk;
+
+    const uint8_t *in;
+    if (unlikely(!ubase_check(uref_sound_read_uint8_t(uref, 0, -1, &in, 1)))) {
+        upipe_err(upipe, "could not read uref, dropping samples");
+        uref_free(uref);
+        return;
+    }
+
+    size_t offset = 0;
+    while (offset < size) {
+        if (upipe_speexdsp->chunk_uref == NULL) {
+            struct ubuf *ubuf = ubuf_sound_alloc(upipe_speexdsp->ubuf_mgr,
+                                                 chunk);
+            if (unlikely(ubuf == NULL)) {
+                upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+                break;
+            }
+            struct uref *chunk_uref = uref_fork(uref, ubuf);
+            if (unlikely(chunk_uref == NULL)) {
+                ubuf_free(ubuf);
+                upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+                break;
+            }
+            /* date of the first sample of the chunk */
+            int64_t delay = offset * UCLOCK_FREQ / upipe_speexdsp->rate;
+            uref_clock_add_date_sys(chunk_uref, delay);
+            uref_clock_add_date_prog(chunk_uref, delay);
+            uref_clock_add_date_orig(chunk_uref, delay);
+            uref_clock_set_duration(chunk_uref,
+                    (uint64_t)chunk * UCLOCK_FREQ / upipe_speexdsp->rate);
+            upipe_speexdsp->chunk_uref = chunk_uref;
+            upipe_speexdsp->chunk_fill = 0;
+        }
+
+        void *out;
+        unsigned int fill = upipe_speexdsp->chunk_fill;
+        if (unlikely(!ubase_check(uref_sound_write_void(
+                            upipe_speexdsp->chunk_uref, fill, chunk - fill,
+                            &out, 1)))) {
+            upipe_err(upipe, "could not write uref, dropping samples");
+            break;
+        }
+
+        spx_uint32_t in_len = size - offset;
+        spx_uint32_t out_len = chunk - fill;
+        const void *in_buf = in + offset * upipe_speexdsp->sample_size;
+        int err;
+        if (upipe_speexdsp->f32)
+            err = speex_resampler_process_interleaved_float(
+                    upipe_speexdsp->ctx, in_buf, &in_len, out, &out_len);
+        else
+            err = speex_resampler_process_interleaved_int(
+                    upipe_speexdsp->ctx, in_buf, &in_len, out, &out_len);
+        uref_sound_unmap(upipe_speexdsp->chunk_uref, fill, chunk - fill, 1);
+
+        if (unlikely(err)) {
+            upipe_err_va(upipe, "Could not resample: %s",
+                    speex_resampler_strerror(err));
+            break;
+        }
+
+        offset += in_len;
+        upipe_speexdsp->chunk_fill += out_len;
+        if (upipe_speexdsp->chunk_fill == chunk) {
+            struct uref *output = upipe_speexdsp->chunk_uref;
+            upipe_speexdsp->chunk_uref = NULL;
+            upipe_speexdsp_output(upipe, output, upump_p);
+        } else if (!in_len && !out_len)
+            break;
+    }
+
+    uref_sound_unmap(uref, 0, -1, 1);
+    uref_free(uref);
+}
+
 /** @internal @This handles data.
  *
  * @param upipe description structure of the pipe
@@ -131,26 +262,12 @@ static bool upipe_speexdsp_handle(struct upipe *upipe, struct uref *uref,
 {
     struct upipe_speexdsp *upipe_speexdsp = upipe_speexdsp_from_upipe(upipe);
 
-    struct urational drift_rate;
-    if (!ubase_check(uref_clock_get_rate(uref, &drift_rate)))
-        drift_rate = (struct urational){ 1, 1 };
-
-    /* reinitialize resampler when drift rate changes */
-    if (urational_cmp(&drift_rate, &upipe_speexdsp->drift_rate)) {
-        upipe_speexdsp->drift_rate = drift_rate;
-        spx_uint32_t ratio_num = drift_rate.den;
-        spx_uint32_t ratio_den = drift_rate.num;
-        spx_uint32_t in_rate = upipe_speexdsp->rate * ratio_num / ratio_den;
-        spx_uint32_t out_rate = upipe_speexdsp->rate;
-        int err = speex_resampler_set_rate_frac(upipe_speexdsp->ctx,
-                ratio_num, ratio_den, in_rate, out_rate);
-        if (err) {
-            upipe_err_va(upipe, "Couldn't resample from %u to %u: %s",
-                in_rate, out_rate, speex_resampler_strerror(err));
-        } else {
-            upipe_dbg_va(upipe, "Resampling from %u to %u",
-                in_rate, out_rate);
-        }
+    /* update resampler when drift rate changes */
+    if (!upipe_speexdsp->drift_rate_forced) {
+        struct urational drift_rate;
+        if (!ubase_check(uref_clock_get_rate(uref, &drift_rate)))
+            drift_rate = (struct urational){ 1, 1 };
+        upipe_speexdsp_update_rate(upipe, drift_rate);
     }
 
     size_t size;
@@ -159,6 +276,11 @@ static bool upipe_speexdsp_handle(struct upipe *upipe, struct uref *uref,
         return true;
     }
 
+    if (upipe_speexdsp->chunk) {
+        upipe_speexdsp_stream(upipe, uref, size, upump_p);
+        return true;
+    }
+
     struct ubuf *ubuf = ubuf_sound_alloc(upipe_speexdsp->ubuf_mgr, size + 10);
     if (!ubuf)
         return false;
@@ -299,8 +421,13 @@ static int upipe_speexdsp_set_flow_def(struct upipe *upipe, struct uref *flow_de
 
     if (upipe_speexdsp->ctx)
         speex_resampler_destroy(upipe_speexdsp->ctx);
+    if (upipe_speexdsp->chunk_uref != NULL) {
+        uref_free(upipe_speexdsp->chunk_uref);
+        upipe_speexdsp->chunk_uref = NULL;
+    }
 
     upipe_speexdsp->f32 = !ubase_ncmp(def, "sound.f32.");
+    upipe_speexdsp->sample_size = channels * (upipe_speexdsp->f32 ? 4 : 2);
 
     int err;
     upipe_speexdsp->ctx = speex_resampler_init(channels,
@@ -311,6 +438,14 @@ static int upipe_speexdsp_set_flow_def(struct upipe *upipe, struct uref *flow_de
                 speex_resampler_strerror(err));
         return UBASE_ERR_INVALID;
     }
+    if (upipe_speexdsp->chunk)
+        speex_resampler_skip_zeros(upipe_speexdsp->ctx);
+
+    /* apply the drift rate to the new resampler */
+    struct urational drift_rate = upipe_speexdsp->drift_rate;
+    upipe_speexdsp->drift_rate = (struct urational){ 0, 0 };
+    if (upipe_speexdsp->drift_rate_forced)
+        upipe_speexdsp_update_rate(upipe, drift_rate);
 
     return UBASE_ERR_NONE;
 }
@@ -410,6 +545,36 @@ static int upipe_speexdsp_control(struct upipe *upipe, int command, va_list args
             return UBASE_ERR_NONE;
         }
 
+        case UPIPE_SPEEXDSP_GET_CHUNK: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_SPEEXDSP_SIGNATURE)
+            unsigned int *chunk_p = va_arg(args, unsigned int *);
+            *chunk_p = upipe_speexdsp->chunk;
+            return UBASE_ERR_NONE;
+        }
+        case UPIPE_SPEEXDSP_SET_CHUNK: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_SPEEXDSP_SIGNATURE)
+            unsigned int chunk = va_arg(args, unsigned int);
+            if (upipe_speexdsp->ctx)
+                return UBASE_ERR_BUSY;
+            upipe_speexdsp->chunk = chunk;
+            return UBASE_ERR_NONE;
+        }
+        case UPIPE_SPEEXDSP_GET_DRIFT_RATE: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_SPEEXDSP_SIGNATURE)
+            struct urational *rate_p = va_arg(args, struct urational *);
+            *rate_p = upipe_speexdsp->drift_rate;
+            return UBASE_ERR_NONE;
+        }
+        case UPIPE_SPEEXDSP_SET_DRIFT_RATE: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_SPEEXDSP_SIGNATURE)
+            struct urational rate = va_arg(args, struct urational);
+            if (!rate.num || !rate.den)
+                return UBASE_ERR_INVALID;
+            upipe_speexdsp->drift_rate_forced = true;
+            upipe_speexdsp_update_rate(upipe, rate);
+            return UBASE_ERR_NONE;
+        }
+
         default:
             return UBASE_ERR_UNHANDLED;
     }
@@ -436,7 +601,12 @@ static struct upipe *upipe_speexdsp_alloc(struct upipe_mgr *mgr,
 
     upipe_speexdsp->ctx = NULL;
     upipe_speexdsp->drift_rate = (struct urational){ 0, 0 };
+    upipe_speexdsp->drift_rate_forced = false;
     upipe_speexdsp->quality = SPEEX_RESAMPLER_QUALITY_MAX;
+    upipe_speexdsp->sample_size = 0;
+    upipe_speexdsp->chunk = 0;
+    upipe_speexdsp->chunk_uref = NULL;
+    upipe_speexdsp->chunk_fill = 0;
 
     upipe_speexdsp_init_urefcount(upipe);
     upipe_speexdsp_init_ubuf_mgr(upipe);
@@ -457,6 +627,8 @@ static void upipe_speexdsp_free(struct upipe *upipe)
     struct upipe_speexdsp *upipe_speexdsp = upipe_speexdsp_from_upipe(upipe);
     if (likely(upipe_speexdsp->ctx))
         speex_resampler_destroy(upipe_speexdsp->ctx);
+    if (upipe_speexdsp->chunk_uref != NULL)
+        uref_free(upipe_speexdsp->chunk_uref);
 
     upipe_throw_dead(upipe);
     upipe_speexdsp_clean_input(upipe);
@@ -55,15 +55,116 @@
 #include <unistd.h>
 #include <errno.h>
 #include <assert.h>
+#include <math.h>
 
 #include <libavutil/opt.h>
 #include <libavutil/channel_layout.h>
 #include <libavutil/mathematics.h>
+#include <libavutil/common.h>
 #include <libswresample/swresample.h>
 
 /** typical frame size for latency calculation */
 #define FRAME_SIZE 1152
 
+/** @internal @This converts samples from one format to another.
+ *
+ * @param in input samples
+ * @param out output samples
+ * @param samples number of samples
+ * @param in_stride distance between two input samples, in samples
+ * @param out_stride distance between two output samples, in samples
+ */
+typedef void (*upipe_swr_kernel)(const void *in, void *out, size_t samples,
+                                 size_t in_stride, size_t out_stride);
+
+/** @hidden */
+#define UPIPE_SWR_KERNEL(name, in_type, out_type, conv)                     \
+static void upipe_swr_kernel_##name(const void *in, void *out,              \
+                                    size_t samples, size_t in_stride,       \
+                                    size_t out_stride)                      \
+{                                                                           \
+    const in_type *pi = in;                                                 \
+    out_type *po = out;                                                     \
+    if (in_stride == 1 && out_stride == 1) {                                \
+        for (size_t i = 0; i < samples; i++) {                              \
+            in_type x = pi[i];                                              \
+            po[i] = conv;                                                   \
+        }                                                                   \
+    } else {                                                                \
+        for (size_t i = 0; i < samples; i++) {                              \
+            in_type x = pi[i * in_stride];                                  \
+            po[i * out_stride] = conv;                                      \
+        }                                                                   \
+    }                                                                       \
+}
+
+/* conversions are identical to the ones of swresample (audioconvert.c) */
+UPIPE_SWR_KERNEL(u8_u8, uint8_t, uint8_t, x)
+UPIPE_SWR_KERNEL(u8_s16, uint8_t, int16_t, (x - 0x80U) << 8)
+UPIPE_SWR_KERNEL(u8_s32, uint8_t, int32_t, (x - 0x80U) << 24)
+UPIPE_SWR_KERNEL(u8_flt, uint8_t, float, (x - 0x80) * (1.0f / (1 << 7)))
+UPIPE_SWR_KERNEL(u8_dbl, uint8_t, double, (x - 0x80) * (1.0 / (1 << 7)))
+UPIPE_SWR_KERNEL(s16_u8, int16_t, uint8_t, (x >> 8) + 0x80)
+UPIPE_SWR_KERNEL(s16_s16, int16_t, int16_t, x)
+UPIPE_SWR_KERNEL(s16_s32, int16_t, int32_t, x * (1 << 16))
+UPIPE_SWR_KERNEL(s16_flt, int16_t, float, x * (1.0f / (1 << 15)))
+UPIPE_SWR_KERNEL(s16_dbl, int16_t, double, x * (1.0 / (1 << 15)))
+UPIPE_SWR_KERNEL(s32_u8, int32_t, uint8_t, (x >> 24) + 0x80)
+UPIPE_SWR_KERNEL(s32_s16, int32_t, int16_t, x >> 16)
+UPIPE_SWR_KERNEL(s32_s32, int32_t, int32_t, x)
+UPIPE_SWR_KERNEL(s32_flt, int32_t, float, x * (1.0f / (1U << 31)))
+UPIPE_SWR_KERNEL(s32_dbl, int32_t, double, x * (1.0 / (1U << 31)))
+UPIPE_SWR_KERNEL(flt_u8, float, uint8_t,
+                 av_clip_uint8(lrintf(x * (1 << 7)) + 0x80))
+UPIPE_SWR_KERNEL(flt_s16, float, int16_t, av_clip_int16(lrintf(x * (1 << 15))))
+UPIPE_SWR_KERNEL(flt_s32, float, int32_t,
+                 av_clipl_int32(llrintf(x * (1U << 31))))
+UPIPE_SWR_KERNEL(flt_flt, float, float, x)
+UPIPE_SWR_KERNEL(flt_dbl, float, double, x)
+UPIPE_SWR_KERNEL(dbl_u8, double, uint8_t,
+                 av_clip_uint8(lrint(x * (1 << 7)) + 0x80))
+UPIPE_SWR_KERNEL(dbl_s16, double, int16_t, av_clip_int16(lrint(x * (1 << 15))))
+UPIPE_SWR_KERNEL(dbl_s32, double, int32_t,
+                 av_clipl_int32(llrint(x * (1U << 31))))
+UPIPE_SWR_KERNEL(dbl_flt, double, float, x)
+UPIPE_SWR_KERNEL(dbl_dbl, double, double, x)
+#undef UPIPE_SWR_KERNEL
+
+/** @internal @This returns the kernel converting between two sample formats.
+ *
+ * @param in_fmt input sample format
+ * @param out_fmt output sample format
+ * @return pointer to the kernel, or NULL if the formats are not supported
+ */
+static upipe_swr_kernel upipe_swr_get_kernel(enum AVSampleFormat in_fmt,
+                                             enum AVSampleFormat out_fmt)
+{
+    /* indexed by packed formats, [in][out] */
+    static const upipe_swr_kernel kernels[5][5] = {
+        { upipe_swr_kernel_u8_u8, upipe_swr_kernel_u8_s16,
+          upipe_swr_kernel_u8_s32, upipe_swr_kernel_u8_flt,
+          upipe_swr_kernel_u8_dbl },
+        { upipe_swr_kernel_s16_u8, upipe_swr_kernel_s16_s16,
+          upipe_swr_kernel_s16_s32, upipe_swr_kernel_s16_flt,
+          upipe_swr_kernel_s16_dbl },
+        { upipe_swr_kernel_s32_u8, upipe_swr_kernel_s32_s16,
+          upipe_swr_kernel_s32_s32, upipe_swr_kernel_s32_flt,
+          upipe_swr_kernel_s32_dbl },
+        { upipe_swr_kernel_flt_u8, upipe_swr_kernel_flt_s16,
+          upipe_swr_kernel_flt_s32, upipe_swr_kernel_flt_flt,
+          upipe_swr_kernel_flt_dbl },
+        { upipe_swr_kernel_dbl_u8, upipe_swr_kernel_dbl_s16,
+          upipe_swr_kernel_dbl_s32, upipe_swr_kernel_dbl_flt,
+          upipe_swr_kernel_dbl_dbl },
+    };
+    int in = av_get_packed_sample_fmt(in_fmt);
+    int out = av_get_packed_sample_fmt(out_fmt);
+    if (in < AV_SAMPLE_FMT_U8 || in > AV_SAMPLE_FMT_DBL ||
+        out < AV_SAMPLE_FMT_U8 || out > AV_SAMPLE_FMT_DBL)
+        return NULL;
+    return kernels[in][out];
+}
+
 /** @hidden */
 static bool upipe_swr_handle(struct upipe *upipe, struct uref *uref,
                              struct upump **upump_p);
@@ -106,6 +207,20 @@ struct upipe_swr {
 
     /** swresample context */
     struct SwrContext *swr;
+    /** true if the input buffers are forwarded untouched */
+    bool passthrough;
+    /** kernel converting the samples without swresample, or NULL */
+    upipe_swr_kernel kernel;
+    /** true if the input is planar */
+    bool in_planar;
+    /** true if the output is planar */
+    bool out_planar;
+    /** number of channels, when converting without swresample */
+    uint8_t chan;
+    /** size of an input sample, when converting without swresample */
+    uint8_t in_size;
+    /** size of an output sample, when converting without swresample */
+    uint8_t out_size;
 
     /** number of planes in input */
     uint8_t in_planes;
@@ -133,6 +248,75 @@ UPIPE_HELPER_UBUF_MGR(upipe_swr, ubuf_mgr, flow_format, ubuf_mgr_request,
                       upipe_swr_unregister_output_request)
 UPIPE_HELPER_INPUT(upipe_swr, urefs, nb_urefs, max_urefs, blockers, upipe_swr_handle)
 
+/** @internal @This converts samples without swresample, when only the
+ * sample format or the planes differ.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref uref structure
+ * @param upump_p reference to pump that generated the buffer
+ */
+static void upipe_swr_convert(struct upipe *upipe, struct uref *uref,
+                              struct upump **upump_p)
+{
+    struct upipe_swr *upipe_swr = upipe_swr_from_upipe(upipe);
+    uint8_t chan = upipe_swr->chan;
+    uint8_t in_planes = upipe_swr->in_planar ? chan : 1;
+    uint8_t out_planes = upipe_swr->out_planar ? chan : 1;
+    size_t samples;
+
+    if (unlikely(!ubase_check(uref_sound_size(uref, &samples, NULL)))) {
+        uref_free(uref);
+        return;
+    }
+
+    const uint8_t *in_buf[in_planes];
+    if (unlikely(!ubase_check(uref_sound_read_uint8_t(uref, 0, -1, in_buf,
+                                                      in_planes)))) {
+        upipe_err(upipe, "could not read uref, dropping samples");
+        uref_free(uref);
+        return;
+    }
+
+    struct ubuf *ubuf = ubuf_sound_alloc(upipe_swr->ubuf_mgr, samples);
+    if (unlikely(!ubuf)) {
+        uref_sound_unmap(uref, 0, -1, in_planes);
+        uref_free(uref);
+        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+        return;
+    }
+
+    uint8_t *out_buf[out_planes];
+    if (unlikely(!ubase_check(ubuf_sound_write_uint8_t(ubuf, 0, -1, out_buf,
+                                                       out_planes)))) {
+        upipe_err(upipe, "could not write uref, dropping samples");
+        ubuf_free(ubuf);
+        uref_sound_unmap(uref, 0, -1, in_planes);
+        uref_free(uref);
+        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+        return;
+    }
+
+    if (!upipe_swr->in_planar && !upipe_swr->out_planar) {
+        upipe_swr->kernel(in_buf[0], out_buf[0], samples * chan, 1, 1);
+    } else {
+        /* interleave or deinterleave, one channel at a time */
+        for (uint8_t i = 0; i < chan; i++) {
+            const uint8_t *in = upipe_swr->in_planar ? in_buf[i] :
+                                in_buf[0] + i * upipe_swr->in_size;
+            uint8_t *out = upipe_swr->out_planar ? out_buf[i] :
+                           out_buf[0] + i * upipe_swr->out_size;
+            upipe_swr->kernel(in, out, samples,
+                              upipe_swr->in_planar ? 1 : chan,
+                              upipe_swr->out_planar ? 1 : chan);
+        }
+    }
+
+    ubuf_sound_unmap(ubuf, 0, -1, out_planes);
+    uref_sound_unmap(uref, 0, -1, in_planes);
+    uref_attach_ubuf(uref, ubuf);
+    upipe_swr_output(upipe, uref, upump_p);
+}
+
 /** @internal @This handles data.
  *
  * @param upipe description structure of the pipe
@@ -190,6 +374,34 @@ static bool upipe_swr_handle(struct upipe *upipe, struct uref *uref,
             upipe_throw_fatal(upipe, UBASE_ERR_EXTERNAL);
         }
 
+        /* bypass swresample when neither the rate nor the number of
+         * channels change */
+        enum AVSampleFormat out_fmt = upipe_swr->out_fmt;
+        if (out_fmt == AV_SAMPLE_FMT_NONE)
+            out_fmt = in_fmt;
+        if (upipe_swr->out_planes && av_sample_fmt_is_planar(out_fmt) !=
+                                     (upipe_swr->out_planes > 1))
+            out_fmt = upipe_swr->out_planes > 1 ?
+                      av_get_planar_sample_fmt(out_fmt) :
+                      av_get_packed_sample_fmt(out_fmt);
+        bool same_layout = in_rate != 0 && in_chan != 0 &&
+            (!upipe_swr->out_rate || upipe_swr->out_rate == in_rate) &&
+            (!upipe_swr->out_chan || upipe_swr->out_chan == in_chan);
+        upipe_swr->passthrough = same_layout && out_fmt == in_fmt;
+        upipe_swr->kernel = same_layout ?
+                            upipe_swr_get_kernel(in_fmt, out_fmt) : NULL;
+        upipe_swr->in_planar = av_sample_fmt_is_planar(in_fmt);
+        upipe_swr->out_planar = av_sample_fmt_is_planar(out_fmt);
+        upipe_swr->chan = in_chan;
+        upipe_swr->in_size = av_get_bytes_per_sample(in_fmt);
+        upipe_swr->out_size = av_get_bytes_per_sample(out_fmt);
+        if (upipe_swr->passthrough)
+            upipe_dbg(upipe, "input and output formats match, passthrough");
+        else if (upipe_swr->kernel != NULL)
+            upipe_dbg_va(upipe, "converting %s to %s without swresample",
+                         av_get_sample_fmt_name(in_fmt),
+                         av_get_sample_fmt_name(out_fmt));
+
         uref = upipe_swr_store_flow_def_input(upipe, uref);
         upipe_swr_require_ubuf_mgr(upipe, uref);
         return true;
@@ -198,6 +410,15 @@ static bool upipe_swr_handle(struct upipe *upipe, struct uref *uref,
     if (upipe_swr->flow_def == NULL)
         return false;
 
+    if (upipe_swr->passthrough) {
+        upipe_swr_output(upipe, uref, upump_p);
+        return true;
+    }
+    if (upipe_swr->kernel != NULL) {
+        upipe_swr_convert(upipe, uref, upump_p);
+        return true;
+    }
+
     struct ubuf *ubuf;
     size_t in_samples;
     uint64_t out_samples;
@@ -438,6 +659,8 @@ static struct upipe *upipe_swr_alloc(struct upipe_mgr *mgr,
     upipe_swr->out_chan = 0;
     upipe_swr->out_planes = 0;
     upipe_swr->out_fmt = AV_SAMPLE_FMT_NONE;
+    upipe_swr->passthrough = false;
+    upipe_swr->kernel = NULL;
 
     /* get sample format */
     const char *def = "(none)";
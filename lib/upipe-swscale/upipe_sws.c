@@ -44,6 +44,8 @@
 #include <upipe/upipe_helper_ubuf_mgr.h>
 #include <upipe/upipe_helper_output.h>
 #include <upipe/upipe_helper_input.h>
+#include <upipe/uslices.h>
+#include <upipe/ulist.h>
 #include <upipe-swscale/upipe_sws.h>
 #include <upipe-av/upipe_av_pixfmt.h>
 
@@ -57,7 +59,49 @@
 #include <assert.h>
 
 #include <libavutil/opt.h>
+#include <libavutil/frame.h>
+#include <libavutil/buffer.h>
 #include <libswscale/swscale.h>
+#include <libswscale/version.h>
+
+#if LIBSWSCALE_VERSION_INT >= AV_VERSION_INT(6, 1, 100)
+/** bands of a picture may be scaled concurrently with sws_receive_slice */
+#define UPIPE_SWS_BANDS
+#endif
+
+/** maximum number of sets of conversion contexts kept */
+#define UPIPE_SWS_CACHE_SIZE 4
+/** maximum number of bands of a picture scaled concurrently */
+#define UPIPE_SWS_MAX_BANDS 16
+
+/** @internal @This is a set of conversion contexts for a given input. */
+struct upipe_sws_convert {
+    /** structure for double-linked lists */
+    struct uchain uchain;
+
+    /** input horizontal size */
+    size_t input_hsize;
+    /** input vertical size */
+    size_t input_vsize;
+    /** input pixel format */
+    enum AVPixelFormat input_pix_fmt;
+    /** input colorspace */
+    int input_colorspace;
+    /** input color range */
+    int input_color_range;
+    /** output horizontal size */
+    uint64_t output_hsize;
+    /** output vertical size */
+    uint64_t output_vsize;
+
+    /** number of bands */
+    unsigned int nb_bands;
+    /** for each band, swscale image conversion context [0] for progressive,
+     * [1,2] interlaced */
+    struct SwsContext *ctx[][3];
+};
+
+UBASE_FROM_TO(upipe_sws_convert, uchain, uchain, uchain)
 
 /** @hidden */
 static bool upipe_sws_handle(struct upipe *upipe, struct uref *uref,
@@ -101,8 +145,14 @@ struct upipe_sws {
 
     /** swscale flags */
     int flags;
-    /** swscale image conversion context [0] for progressive, [1,2] interlaced */
-    struct SwsContext *convert_ctx[3];
+    /** list of sets of conversion contexts, most recently used first */
+    struct uchain converts;
+    /** number of sets of conversion contexts */
+    unsigned int nb_converts;
+    /** worker threads scaling bands of pictures, or NULL */
+    struct uslices *uslices;
+    /** dummy buffer referenced by the frames given to swscale */
+    AVBufferRef *buffer;
     /** input pixel format */
     enum AVPixelFormat input_pix_fmt;
     /** requested output pixel format */
@@ -119,8 +169,6 @@ struct upipe_sws {
     int input_color_range;
     /** output color range */
     int output_color_range;
-    /** true if the we already tried to set the colorspace, but failed at it */
-    bool colorspace_invalid;
 
     /** public upipe structure */
     struct upipe upipe;
@@ -163,6 +211,305 @@ static int upipe_sws_convert_color(struct upipe *upipe, struct uref *flow_def)
     return colorspace;
 }
 
+/** @internal @This frees a set of conversion contexts.
+ *
+ * @param convert set of conversion contexts
+ */
+static void upipe_sws_convert_free(struct upipe_sws_convert *convert)
+{
+    for (unsigned int i = 0; i < convert->nb_bands; i++)
+        for (int j = 0; j < 3; j++)
+            if (convert->ctx[i][j] != NULL)
+                sws_freeContext(convert->ctx[i][j]);
+    free(convert);
+}
+
+/** @internal @This frees all the sets of conversion contexts, for instance
+ * when the flags change.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_sws_flush_converts(struct upipe *upipe)
+{
+    struct upipe_sws *upipe_sws = upipe_sws_from_upipe(upipe);
+    struct uchain *uchain, *uchain_tmp;
+    ulist_delete_foreach(&upipe_sws->converts, uchain, uchain_tmp) {
+        ulist_delete(uchain);
+        upipe_sws_convert_free(upipe_sws_convert_from_uchain(uchain));
+    }
+    upipe_sws->nb_converts = 0;
+}
+
+/** @internal @This allocates and initializes a conversion context.
+ *
+ * @param upipe description structure of the pipe
+ * @param convert set of conversion contexts
+ * @param field 0 for progressive, 1 for top field, 2 for bottom field
+ * @return pointer to the context, or NULL in case of error
+ */
+static struct SwsContext *upipe_sws_ctx_alloc(struct upipe *upipe,
+        const struct upipe_sws_convert *convert, int field)
+{
+    struct upipe_sws *upipe_sws = upipe_sws_from_upipe(upipe);
+    struct SwsContext *ctx = sws_alloc_context();
+    if (unlikely(ctx == NULL))
+        return NULL;
+
+    av_opt_set_int(ctx, "srcw", convert->input_hsize, 0);
+    av_opt_set_int(ctx, "srch", convert->input_vsize >> !!field, 0);
+    av_opt_set_int(ctx, "src_format", convert->input_pix_fmt, 0);
+    av_opt_set_int(ctx, "dstw", convert->output_hsize, 0);
+    av_opt_set_int(ctx, "dsth", convert->output_vsize >> !!field, 0);
+    av_opt_set_int(ctx, "dst_format", upipe_sws->output_pix_fmt, 0);
+    av_opt_set_int(ctx, "sws_flags", upipe_sws->flags, 0);
+
+    static const int chr_pos[3] = { 128, 64, 192 };
+    if (convert->input_pix_fmt == AV_PIX_FMT_YUV420P)
+        av_opt_set_int(ctx, "src_v_chr_pos", chr_pos[field], 0);
+    if (upipe_sws->output_pix_fmt == AV_PIX_FMT_YUV420P)
+        av_opt_set_int(ctx, "dst_v_chr_pos", chr_pos[field], 0);
+
+    if (unlikely(sws_init_context(ctx, NULL, NULL) < 0)) {
+        sws_freeContext(ctx);
+        return NULL;
+    }
+
+    int in_full, out_full, brightness, contrast, saturation;
+    const int *inv_table, *table;
+
+    if (unlikely(sws_getColorspaceDetails(ctx,
+                    (int **)&inv_table, &in_full, (int **)&table, &out_full,
+                    &brightness, &contrast, &saturation) < 0)) {
+        upipe_warn(upipe, "unable to set color space data");
+        return ctx;
+    }
+
+    if (convert->input_colorspace != -1)
+        inv_table = sws_getCoefficients(convert->input_colorspace);
+    if (convert->input_color_range != -1)
+        in_full = convert->input_color_range;
+    if (upipe_sws->output_colorspace != -1)
+        table = sws_getCoefficients(upipe_sws->output_colorspace);
+    if (upipe_sws->output_color_range != -1)
+        out_full = upipe_sws->output_color_range;
+
+    if (unlikely(sws_setColorspaceDetails(ctx,
+                    inv_table, in_full, table, out_full,
+                    brightness, contrast, saturation) < 0))
+        upipe_warn(upipe, "unable to set color space data");
+    return ctx;
+}
+
+/** @internal @This returns the set of conversion contexts for the given
+ * input, from the cache of recently used sets, or allocates a new one.
+ * This avoids initializing the contexts again when the flow alternates
+ * between a few formats.
+ *
+ * @param upipe description structure of the pipe
+ * @param input_hsize input horizontal size
+ * @param input_vsize input vertical size
+ * @param output_hsize output horizontal size
+ * @param output_vsize output vertical size
+ * @param progressive true if the picture is progressive
+ * @return pointer to the set of conversion contexts, or NULL in case of
+ * error
+ */
+static struct upipe_sws_convert *upipe_sws_get_convert(struct upipe *upipe,
+        size_t input_hsize, size_t input_vsize,
+        uint64_t output_hsize, uint64_t output_vsize, bool progressive)
+{
+    struct upipe_sws *upipe_sws = upipe_sws_from_upipe(upipe);
+    unsigned int nb_bands = 1;
+#ifdef UPIPE_SWS_BANDS
+    nb_bands = uslices_get_threads(upipe_sws->uslices);
+    if (nb_bands > UPIPE_SWS_MAX_BANDS)
+        nb_bands = UPIPE_SWS_MAX_BANDS;
+#endif
+
+    struct upipe_sws_convert *convert = NULL;
+    struct uchain *uchain;
+    ulist_foreach(&upipe_sws->converts, uchain) {
+        struct upipe_sws_convert *entry = upipe_sws_convert_from_uchain(uchain);
+        if (entry->input_hsize == input_hsize &&
+            entry->input_vsize == input_vsize &&
+            entry->input_pix_fmt == upipe_sws->input_pix_fmt &&
+            entry->input_colorspace == upipe_sws->input_colorspace &&
+            entry->input_color_range == upipe_sws->input_color_range &&
+            entry->output_hsize == output_hsize &&
+            entry->output_vsize == output_vsize &&
+            entry->nb_bands == nb_bands) {
+            convert = entry;
+            ulist_delete(uchain);
+            break;
+        }
+    }
+
+    if (convert == NULL) {
+        upipe_dbg_va(upipe, "new conversion %zux%zu %s -> %"PRIu64"x%"PRIu64
+                     " %s in %u bands", input_hsize, input_vsize,
+                     av_get_pix_fmt_name(upipe_sws->input_pix_fmt),
+                     output_hsize, output_vsize,
+                     av_get_pix_fmt_name(upipe_sws->output_pix_fmt),
+                     nb_bands);
+        convert = calloc(1, sizeof (struct upipe_sws_convert) +
+                            nb_bands * sizeof (convert->ctx[0]));
+        if (unlikely(convert == NULL))
+            return NULL;
+        uchain_init(&convert->uchain);
+        convert->input_hsize = input_hsize;
+        convert->input_vsize = input_vsize;
+        convert->input_pix_fmt = upipe_sws->input_pix_fmt;
+        convert->input_colorspace = upipe_sws->input_colorspace;
+        convert->input_color_range = upipe_sws->input_color_range;
+        convert->output_hsize = output_hsize;
+        convert->output_vsize = output_vsize;
+        convert->nb_bands = nb_bands;
+
+        if (upipe_sws->nb_converts >= UPIPE_SWS_CACHE_SIZE) {
+            /* evict the least recently used set */
+            struct uchain *last = upipe_sws->converts.prev;
+            ulist_delete(last);
+            upipe_sws_convert_free(upipe_sws_convert_from_uchain(last));
+            upipe_sws->nb_converts--;
+        }
+        upipe_sws->nb_converts++;
+    }
+    ulist_unshift(&upipe_sws->converts, &convert->uchain);
+
+    /* the contexts of the fields are only allocated when needed */
+    for (unsigned int i = 0; i < nb_bands; i++)
+        for (int j = progressive ? 0 : 1; j < (progressive ? 1 : 3); j++) {
+            if (convert->ctx[i][j] != NULL)
+                continue;
+            convert->ctx[i][j] = upipe_sws_ctx_alloc(upipe, convert, j);
+            if (unlikely(convert->ctx[i][j] == NULL)) {
+                upipe_err(upipe, "sws_getContext failed");
+                return NULL;
+            }
+        }
+    return convert;
+}
+
+/** @internal @This describes a picture being scaled. */
+struct upipe_sws_frame {
+    /** set of conversion contexts */
+    struct upipe_sws_convert *convert;
+    /** true if the picture is progressive */
+    bool progressive;
+    /** input planes of each field */
+    const uint8_t *input_planes[2][UPIPE_AV_MAX_PLANES + 1];
+    /** input strides */
+    int *input_strides;
+    /** number of input lines of each field */
+    int input_lines[2];
+    /** output planes of each field */
+    uint8_t *output_planes[2][UPIPE_AV_MAX_PLANES + 1];
+    /** output strides */
+    int *output_strides;
+#ifdef UPIPE_SWS_BANDS
+    /** input frames of each field */
+    AVFrame *input_frames[2];
+    /** output frames of each field */
+    AVFrame *output_frames[2];
+#endif
+    /** set to true by a slice which failed */
+    bool failed[2 * UPIPE_SWS_MAX_BANDS];
+};
+
+/** @internal @This scales a band of a field of a picture.
+ *
+ * @param opaque pointer to the description of the picture
+ * @param slice index of the band, followed by the bands of the second field
+ * @param nb_slices number of bands of all fields
+ */
+static void upipe_sws_scale_slice(void *opaque, unsigned int slice,
+                                  unsigned int nb_slices)
+{
+    struct upipe_sws_frame *frame = opaque;
+    unsigned int nb_bands = frame->convert->nb_bands;
+    unsigned int field = slice / nb_bands;
+    unsigned int band = slice % nb_bands;
+    struct SwsContext *ctx =
+        frame->convert->ctx[band][frame->progressive ? 0 : 1 + field];
+
+#ifdef UPIPE_SWS_BANDS
+    if (nb_bands > 1) {
+        AVFrame *input_frame = frame->input_frames[field];
+        AVFrame *output_frame = frame->output_frames[field];
+        unsigned int align = sws_receive_slice_alignment(ctx);
+        unsigned int lines = output_frame->height;
+        unsigned int start = lines * band / nb_bands / align * align;
+        unsigned int end = band + 1 == nb_bands ? lines :
+                           lines * (band + 1) / nb_bands / align * align;
+        if (start >= end)
+            return;
+
+        int ret = sws_frame_start(ctx, output_frame, input_frame);
+        if (ret >= 0)
+            ret = sws_send_slice(ctx, 0, input_frame->height);
+        if (ret >= 0)
+            ret = sws_receive_slice(ctx, start, end - start);
+        sws_frame_end(ctx);
+        frame->failed[slice] = ret < 0;
+        return;
+    }
+#endif
+
+    int ret = sws_scale(ctx, frame->input_planes[field], frame->input_strides,
+                        0, frame->input_lines[field],
+                        frame->output_planes[field], frame->output_strides);
+    frame->failed[slice] = ret <= 0;
+}
+
+/** @internal @This does nothing, as the buffers given to swscale belong to
+ * ubufs.
+ *
+ * @param opaque unused
+ * @param data unused
+ */
+static void upipe_sws_buffer_free(void *opaque, uint8_t *data)
+{
+}
+
+#ifdef UPIPE_SWS_BANDS
+
+/** @internal @This allocates a frame pointing to planes mapped from a ubuf.
+ *
+ * @param upipe description structure of the pipe
+ * @param planes planes of the field
+ * @param strides strides of the planes
+ * @param format pixel format
+ * @param width horizontal size
+ * @param height number of lines of the field
+ * @return pointer to the frame, or NULL in case of error
+ */
+static AVFrame *upipe_sws_frame_alloc(struct upipe *upipe,
+                                      const uint8_t *const *planes,
+                                      const int *strides,
+                                      enum AVPixelFormat format,
+                                      int width, int height)
+{
+    struct upipe_sws *upipe_sws = upipe_sws_from_upipe(upipe);
+    AVFrame *frame = av_frame_alloc();
+    if (unlikely(frame == NULL))
+        return NULL;
+
+    frame->buf[0] = av_buffer_ref(upipe_sws->buffer);
+    if (unlikely(frame->buf[0] == NULL)) {
+        av_frame_free(&frame);
+        return NULL;
+    }
+    for (int i = 0; i < UPIPE_AV_MAX_PLANES && planes[i] != NULL; i++) {
+        frame->data[i] = (uint8_t *)planes[i];
+        frame->linesize[i] = strides[i];
+    }
+    frame->format = format;
+    frame->width = width;
+    frame->height = height;
+    return frame;
+}
+#endif
+
 /** @internal @This handles data.
  *
  * @param upipe description structure of the pipe
@@ -209,49 +556,14 @@ static bool upipe_sws_handle(struct upipe *upipe, struct uref *uref,
         output_vsize = input_vsize;
     }
 
-    int i;
-    for (i = 0; i < 3; i++) {
-        upipe_sws->convert_ctx[i] = sws_getCachedContext(upipe_sws->convert_ctx[i],
-                    input_hsize, input_vsize >> !!i, upipe_sws->input_pix_fmt,
-                    output_hsize, output_vsize >> !!i, upipe_sws->output_pix_fmt,
-                    upipe_sws->flags, NULL, NULL, NULL);
-
-        if (unlikely(upipe_sws->convert_ctx[i] == NULL)) {
-            upipe_err(upipe, "sws_getContext failed");
-            uref_free(uref);
-            return true;
-        }
-
-        if (upipe_sws->colorspace_invalid)
-            continue;
-
-        int in_full, out_full, brightness, contrast, saturation;
-        const int *inv_table, *table;
-
-        if (unlikely(sws_getColorspaceDetails(upipe_sws->convert_ctx[i],
-                        (int **)&inv_table, &in_full, (int **)&table, &out_full,
-                        &brightness, &contrast, &saturation) < 0)) {
-            upipe_warn(upipe, "unable to set color space data");
-            upipe_sws->colorspace_invalid = true;
-            continue;
-        }
-
-        if (upipe_sws->input_colorspace != -1)
-            inv_table = sws_getCoefficients(upipe_sws->input_colorspace);
-        if (upipe_sws->input_color_range != -1)
-            in_full = upipe_sws->input_color_range;
-        if (upipe_sws->output_colorspace != -1)
-            table = sws_getCoefficients(upipe_sws->output_colorspace);
-        if (upipe_sws->output_color_range != -1)
-            out_full = upipe_sws->output_color_range;
-
-        if (unlikely(sws_setColorspaceDetails(upipe_sws->convert_ctx[i],
-                        inv_table, in_full, table, out_full,
-                        brightness, contrast, saturation) < 0)) {
-            upipe_warn(upipe, "unable to set color space data");
-            upipe_sws->colorspace_invalid = true;
-        }
+    struct upipe_sws_convert *convert =
+        upipe_sws_get_convert(upipe, input_hsize, input_vsize,
+                              output_hsize, output_vsize, progressive);
+    if (unlikely(convert == NULL)) {
+        uref_free(uref);
+        return true;
     }
+    int i;
 
     upipe_verbose_va(upipe, "%s -> %s",
         av_get_pix_fmt_name(upipe_sws->input_pix_fmt),
@@ -326,28 +638,63 @@ static bool upipe_sws_handle(struct upipe *upipe, struct uref *uref,
     }
 
     /* fire ! */
-    int ret = 0, ret2 = 1;
-    if (progressive) {
-        ret = sws_scale(upipe_sws->convert_ctx[0],
-                        input_planes, input_strides, 0, input_vsize,
-                        output_planes, output_strides);
-    }
-    else {
-        ret = sws_scale(upipe_sws->convert_ctx[1],
-                        input_planes, input_strides, 0, (input_vsize+1)/2,
-                        output_planes, output_strides);
-
-        for (i = 0; i < UPIPE_AV_MAX_PLANES && input_planes[i]; i++) {
-                input_planes[i] += input_strides[i] >> 1;
-        }
-        for (i = 0; i < UPIPE_AV_MAX_PLANES && output_planes[i]; i++) {
-                output_planes[i] += output_strides[i] >> 1;
+    struct upipe_sws_frame frame;
+    unsigned int nb_fields = progressive ? 1 : 2;
+    frame.convert = convert;
+    frame.progressive = progressive;
+    frame.input_strides = input_strides;
+    frame.output_strides = output_strides;
+    frame.input_lines[0] = progressive ? input_vsize : (input_vsize + 1) / 2;
+    frame.input_lines[1] = input_vsize / 2;
+    for (i = 0; i < UPIPE_AV_MAX_PLANES; i++) {
+        frame.input_planes[0][i] = input_planes[i];
+        frame.input_planes[1][i] = input_planes[i] == NULL ? NULL :
+                                   input_planes[i] + (input_strides[i] >> 1);
+        frame.output_planes[0][i] = output_planes[i];
+        frame.output_planes[1][i] = output_planes[i] == NULL ? NULL :
+                                    output_planes[i] + (output_strides[i] >> 1);
+    }
+    for (i = 0; i < 2; i++) {
+        frame.input_planes[i][UPIPE_AV_MAX_PLANES] = NULL;
+        frame.output_planes[i][UPIPE_AV_MAX_PLANES] = NULL;
+    }
+    memset(frame.failed, 0, sizeof (frame.failed));
+
+    bool failed = false;
+#ifdef UPIPE_SWS_BANDS
+    for (i = 0; i < 2; i++)
+        frame.input_frames[i] = frame.output_frames[i] = NULL;
+    if (convert->nb_bands > 1) {
+        for (i = 0; i < nb_fields; i++) {
+            frame.input_frames[i] = upipe_sws_frame_alloc(upipe,
+                    frame.input_planes[i], input_strides,
+                    upipe_sws->input_pix_fmt, input_hsize,
+                    frame.input_lines[i]);
+            frame.output_frames[i] = upipe_sws_frame_alloc(upipe,
+                    (const uint8_t *const *)frame.output_planes[i],
+                    output_strides, upipe_sws->output_pix_fmt, output_hsize,
+                    output_vsize >> !progressive);
+            if (unlikely(frame.input_frames[i] == NULL ||
+                         frame.output_frames[i] == NULL))
+                failed = true;
         }
+    }
+#endif
+
+    if (likely(!failed)) {
+        /* the fields, and the bands of the fields, are independent */
+        uslices_run(upipe_sws->uslices, upipe_sws_scale_slice, &frame,
+                    nb_fields * convert->nb_bands);
+        for (i = 0; i < nb_fields * convert->nb_bands; i++)
+            failed = failed || frame.failed[i];
+    }
 
-        ret2 = sws_scale(upipe_sws->convert_ctx[2],
-                         input_planes, input_strides, 0, input_vsize/2,
-                         output_planes, output_strides);
+#ifdef UPIPE_SWS_BANDS
+    for (i = 0; i < 2; i++) {
+        av_frame_free(&frame.input_frames[i]);
+        av_frame_free(&frame.output_frames[i]);
     }
+#endif
 
     /* unmap pictures */
     for (i = 0; i < UPIPE_AV_MAX_PLANES &&
@@ -360,7 +707,7 @@ static bool upipe_sws_handle(struct upipe *upipe, struct uref *uref,
                              0, 0, -1, -1);
 
     /* clean and attach */
-    if (unlikely(ret <= 0) || unlikely(ret2 <= 0)) {
+    if (unlikely(failed)) {
         upipe_warn(upipe, "error during sws conversion");
         ubuf_free(ubuf);
         uref_free(uref);
@@ -521,19 +868,6 @@ static int upipe_sws_set_flow_def(struct upipe *upipe, struct uref *flow_def)
         }
     }
 
-    if (upipe_sws->input_pix_fmt == AV_PIX_FMT_YUV420P) {
-        av_opt_set_int(upipe_sws->convert_ctx[0], "src_v_chr_pos", 128, 0);
-        av_opt_set_int(upipe_sws->convert_ctx[1], "src_v_chr_pos", 64, 0);
-        av_opt_set_int(upipe_sws->convert_ctx[2], "src_v_chr_pos", 192, 0);
-    }
-
-    if (upipe_sws->output_pix_fmt == AV_PIX_FMT_YUV420P) {
-        av_opt_set_int(upipe_sws->convert_ctx[0], "dst_v_chr_pos", 128, 0);
-        av_opt_set_int(upipe_sws->convert_ctx[1], "dst_v_chr_pos", 64, 0);
-        av_opt_set_int(upipe_sws->convert_ctx[2], "dst_v_chr_pos", 192, 0);
-    }
-    upipe_sws->colorspace_invalid = false;
-
     upipe_input(upipe, flow_def, NULL);
     return UBASE_ERR_NONE;
 }
@@ -561,10 +895,43 @@ static int _upipe_sws_set_flags(struct upipe *upipe, int flags)
 {
     struct upipe_sws *upipe_sws = upipe_sws_from_upipe(upipe);
     upipe_sws->flags = flags;
+    upipe_sws_flush_converts(upipe);
     upipe_dbg_va(upipe, "setting flags to %d", flags);
     return UBASE_ERR_NONE;
 }
 
+/** @internal @This sets the number of threads scaling the pictures.
+ *
+ * @param upipe description structure of the pipe
+ * @param nb_threads number of threads, or 0
+ * @return an error code
+ */
+static int _upipe_sws_set_threads(struct upipe *upipe,
+                                  unsigned int nb_threads)
+{
+    struct upipe_sws *upipe_sws = upipe_sws_from_upipe(upipe);
+    upipe_sws_flush_converts(upipe);
+    uslices_free(upipe_sws->uslices);
+    upipe_sws->uslices = NULL;
+    if (nb_threads <= 1)
+        return UBASE_ERR_NONE;
+    if (nb_threads > UPIPE_SWS_MAX_BANDS)
+        nb_threads = UPIPE_SWS_MAX_BANDS;
+
+    /* the thread of the pipe scales a band too */
+    upipe_sws->uslices = uslices_alloc(nb_threads - 1);
+    if (unlikely(upipe_sws->uslices == NULL)) {
+        upipe_err(upipe, "unable to create scaling threads");
+        return UBASE_ERR_EXTERNAL;
+    }
+#ifndef UPIPE_SWS_BANDS
+    upipe_warn(upipe, "swscale is too old to scale bands, only the fields "
+               "of interlaced pictures will be scaled concurrently");
+#endif
+    upipe_dbg_va(upipe, "scaling with %u threads", nb_threads);
+    return UBASE_ERR_NONE;
+}
+
 /** @internal @This processes control commands on a file source pipe, and
  * checks the status of the pipe afterwards.
  *
@@ -612,6 +979,11 @@ static int upipe_sws_control(struct upipe *upipe, int command, va_list args)
             int flags = va_arg(args, int);
             return _upipe_sws_set_flags(upipe, flags);
         }
+        case UPIPE_SWS_SET_THREADS: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_SWS_SIGNATURE)
+            unsigned int nb_threads = va_arg(args, unsigned int);
+            return _upipe_sws_set_threads(upipe, nb_threads);
+        }
         default:
             return UBASE_ERR_UNHANDLED;
     }
@@ -650,14 +1022,14 @@ static struct upipe *upipe_sws_alloc(struct upipe_mgr *mgr,
     upipe_sws_init_output(upipe);
     upipe_sws_init_flow_def(upipe);
     upipe_sws_init_input(upipe);
-    upipe_sws->colorspace_invalid = false;
-
-    memset(upipe_sws->convert_ctx, 0, sizeof(upipe_sws->convert_ctx));
-    for (int i = 0; i < 3; i++) {
-        upipe_sws->convert_ctx[i] = sws_alloc_context();
-        if (!upipe_sws->convert_ctx[i])
-            goto fail;
-    }
+    ulist_init(&upipe_sws->converts);
+    upipe_sws->nb_converts = 0;
+    upipe_sws->uslices = NULL;
+    upipe_sws->buffer = av_buffer_create((uint8_t *)upipe_sws,
+                                         sizeof (*upipe_sws),
+                                         upipe_sws_buffer_free, NULL, 0);
+    if (unlikely(upipe_sws->buffer == NULL))
+        goto fail;
 
     upipe_sws->flags = SWS_FULL_CHR_H_INP | SWS_ACCURATE_RND | SWS_LANCZOS;
 
@@ -672,11 +1044,6 @@ static struct upipe *upipe_sws_alloc(struct upipe_mgr *mgr,
     return upipe;
 
 fail:
-    for (int i = 0; i < 3; i++) {
-        if (likely(upipe_sws->convert_ctx[i]))
-            sws_freeContext(upipe_sws->convert_ctx[i]);
-        upipe_sws->convert_ctx[i] = NULL;
-    }
     uref_free(flow_def);
     upipe_sws_free_flow(upipe);
     return NULL;
@@ -689,11 +1056,9 @@ fail:
 static void upipe_sws_free(struct upipe *upipe)
 {
     struct upipe_sws *upipe_sws = upipe_sws_from_upipe(upipe);
-    for (int i = 0; i < 3; i++) {
-        if (likely(upipe_sws->convert_ctx[i]))
-            sws_freeContext(upipe_sws->convert_ctx[i]);
-        upipe_sws->convert_ctx[i] = NULL;
-    }
+    upipe_sws_flush_converts(upipe);
+    uslices_free(upipe_sws->uslices);
+    av_buffer_unref(&upipe_sws->buffer);
 
     upipe_throw_dead(upipe);
     upipe_sws_clean_input(upipe);
@@ -167,7 +167,24 @@ static inline bool upipe_sws_thumbs_set_context(struct upipe *upipe,
     return true;
 }
 
-/** @internal @This flushes current thumbs gallery.
+/** @internal @This clears a rectangle of the gallery, if it is not empty.
+ *
+ * @param gallery gallery picture
+ * @param hoffset horizontal offset of the rectangle
+ * @param voffset vertical offset of the rectangle
+ * @param hsize horizontal size of the rectangle
+ * @param vsize vertical size of the rectangle
+ */
+static inline void upipe_sws_thumbs_clear(struct uref *gallery,
+                                          size_t hoffset, size_t voffset,
+                                          size_t hsize, size_t vsize)
+{
+    if (hsize && vsize)
+        uref_pic_clear(gallery, hoffset, voffset, hsize, vsize, 0);
+}
+
+/** @internal @This flushes current thumbs gallery. The thumbs which have
+ * not been received are cleared.
  *
  * @param upipe description structure of the pipe
  * @param upump_p reference to pump that generated the buffer
@@ -177,6 +194,15 @@ static inline void upipe_sws_thumbs_flush(struct upipe *upipe, struct upump **up
     struct upipe_sws_thumbs *upipe_sws_thumbs = upipe_sws_thumbs_from_upipe(upipe);
     struct uref *gallery = upipe_sws_thumbs->gallery;
     if (likely(gallery)) {
+        struct picsize *thumbsize = upipe_sws_thumbs->thumbsize;
+        struct picsize *thumbnum = upipe_sws_thumbs->thumbnum;
+        int counter;
+        for (counter = upipe_sws_thumbs->counter;
+             counter < thumbnum->hsize * thumbnum->vsize; counter++)
+            upipe_sws_thumbs_clear(gallery,
+                    thumbsize->hsize * (counter % thumbnum->hsize),
+                    thumbsize->vsize * (counter / thumbnum->hsize),
+                    thumbsize->hsize, thumbsize->vsize);
         upipe_sws_thumbs->counter = 0;
         upipe_sws_thumbs->gallery = NULL;
         upipe_sws_thumbs_output(upipe, gallery, upump_p);
@@ -292,10 +318,23 @@ static bool upipe_sws_thumbs_handle(struct upipe *upipe, struct uref *uref,
             upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
             return true;
         }
-        ubuf_pic_clear(ubuf, 0, 0, -1, -1, 0);
         uref_attach_ubuf(gallery, ubuf);
     }
 
+    /* only clear the margins around the scaled picture */
+    upipe_sws_thumbs_clear(gallery, pos.hsize, pos.vsize,
+                           thumbsize->hsize, margins.vsize);
+    upipe_sws_thumbs_clear(gallery, pos.hsize,
+                           pos.vsize + margins.vsize + surface.vsize,
+                           thumbsize->hsize,
+                           thumbsize->vsize - margins.vsize - surface.vsize);
+    upipe_sws_thumbs_clear(gallery, pos.hsize, pos.vsize + margins.vsize,
+                           margins.hsize, surface.vsize);
+    upipe_sws_thumbs_clear(gallery, pos.hsize + margins.hsize + surface.hsize,
+                           pos.vsize + margins.vsize,
+                           thumbsize->hsize - margins.hsize - surface.hsize,
+                           surface.vsize);
+
     /* map input */
     memset(slices, 0, sizeof(slices));
     memset(strides, 0, sizeof(strides));
@@ -341,9 +380,8 @@ static bool upipe_sws_thumbs_handle(struct upipe *upipe, struct uref *uref,
 
     /* output if gallery is complete */
     counter++;
-    counter = counter % (thumbnum->hsize*thumbnum->vsize);
     upipe_sws_thumbs->counter = counter;
-    if (unlikely(counter == 0)) {
+    if (unlikely(counter >= thumbnum->hsize * thumbnum->vsize)) {
         upipe_sws_thumbs_flush(upipe, upump_p);
     }
     return true;
@@ -677,11 +715,11 @@ static void upipe_sws_thumbs_free(struct upipe *upipe)
     if (likely(upipe_sws_thumbs->convert_ctx)) {
         sws_freeContext(upipe_sws_thumbs->convert_ctx);
     }
-    free(upipe_sws_thumbs->thumbsize);
-    free(upipe_sws_thumbs->thumbnum);
     if (upipe_sws_thumbs->gallery) {
         upipe_sws_thumbs_flush(upipe, NULL);
     }
+    free(upipe_sws_thumbs->thumbsize);
+    free(upipe_sws_thumbs->thumbnum);
 
     upipe_throw_dead(upipe);
     upipe_sws_thumbs_clean_input(upipe);
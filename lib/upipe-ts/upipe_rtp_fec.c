@@ -64,6 +64,10 @@
 
 #define UPIPE_FEC_JITTER UCLOCK_FREQ/25
 #define FEC_MAX 255
+/** minimum number of slots of the main ring */
+#define MAIN_RING_MIN 64
+/** maximum number of slots of the main ring (half the sequence space) */
+#define MAIN_RING_MAX 32768
 
 /** upipe_rtp_fec structure with rtp-fec parameters */
 struct upipe_rtp_fec {
@@ -110,7 +114,15 @@ struct upipe_rtp_fec {
     /** row subpipe */
     struct upipe row_subpipe;
 
-    struct uchain main_queue;
+    /** main packets indexed by sequence number (power of 2 slots) */
+    struct uref **main_ring;
+    /** number of slots of the main ring */
+    uint32_t main_size;
+    /** sequence number of the oldest main packet, or UINT32_MAX if empty */
+    uint32_t main_first;
+    /** sequence number of the newest main packet */
+    uint32_t main_last;
+
     struct uchain col_queue;
     struct uchain row_queue;
 
@@ -193,18 +205,153 @@ static void upipe_rtp_fec_extract_parameters(struct uref *fec_uref,
     uref_block_peek_unmap(fec_uref, RTP_HEADER_SIZE, fec_header, peek);
 }
 
+/* Return the main packet with the given sequence number, if any */
+static struct uref *upipe_rtp_fec_main_get(struct upipe_rtp_fec *upipe_rtp_fec,
+                                           uint16_t seqnum)
+{
+    if (upipe_rtp_fec->main_first == UINT32_MAX)
+        return NULL;
+
+    uint16_t offset = seqnum - upipe_rtp_fec->main_first;
+    uint16_t window = upipe_rtp_fec->main_last - upipe_rtp_fec->main_first;
+    if (offset > window)
+        return NULL;
+
+    return upipe_rtp_fec->main_ring[seqnum & (upipe_rtp_fec->main_size - 1)];
+}
+
+/* Move the oldest main packet to the first occupied slot from seqnum */
+static void upipe_rtp_fec_main_set_first(struct upipe_rtp_fec *upipe_rtp_fec,
+                                         uint16_t seqnum)
+{
+    uint32_t mask = upipe_rtp_fec->main_size - 1;
+    uint16_t end = upipe_rtp_fec->main_last + 1;
+
+    while (seqnum != end && upipe_rtp_fec->main_ring[seqnum & mask] == NULL)
+        seqnum++;
+
+    upipe_rtp_fec->main_first = seqnum == end ? UINT32_MAX : seqnum;
+}
+
+/* Remove a main packet from the ring, and return it */
+static struct uref *upipe_rtp_fec_main_take(struct upipe_rtp_fec *upipe_rtp_fec,
+                                            uint16_t seqnum)
+{
+    struct uref **slot = &upipe_rtp_fec->main_ring[seqnum &
+                                                   (upipe_rtp_fec->main_size - 1)];
+    struct uref *uref = *slot;
+    *slot = NULL;
+    if (seqnum == upipe_rtp_fec->main_first)
+        upipe_rtp_fec_main_set_first(upipe_rtp_fec, seqnum + 1);
+    return uref;
+}
+
 /* Delete main packets older than the reference point */
-static void clear_main_list(struct uchain *main_list, uint16_t snbase)
+static void clear_main_list(struct upipe_rtp_fec *upipe_rtp_fec, uint16_t snbase)
 {
-    struct uchain *uchain, *uchain_tmp;
+    while (upipe_rtp_fec->main_first != UINT32_MAX &&
+           seq_num_lt(upipe_rtp_fec->main_first, snbase))
+        uref_free(upipe_rtp_fec_main_take(upipe_rtp_fec,
+                                          upipe_rtp_fec->main_first));
+}
 
-    ulist_delete_foreach (main_list, uchain, uchain_tmp) {
-        struct uref *uref = uref_from_uchain(uchain);
-        if (!seq_num_lt(uref->priv, snbase))
-            break;
+/* Insert a main packet in the ring */
+static void upipe_rtp_fec_main_insert(struct upipe *upipe, struct uref *uref)
+{
+    struct upipe_rtp_fec *upipe_rtp_fec = upipe_rtp_fec_from_upipe(upipe);
+    uint16_t seqnum = uref->priv;
+    uint32_t mask = upipe_rtp_fec->main_size - 1;
 
-        ulist_delete(uchain);
+    if (unlikely(upipe_rtp_fec->main_ring == NULL)) {
         uref_free(uref);
+        return;
+    }
+
+    if (upipe_rtp_fec->main_first == UINT32_MAX) {
+        upipe_rtp_fec->main_first = upipe_rtp_fec->main_last = seqnum;
+        upipe_rtp_fec->main_ring[seqnum & mask] = uref;
+        return;
+    }
+
+    if (seq_num_lt(upipe_rtp_fec->main_last, seqnum)) {
+        /* Newest packet, make room for it if needed */
+        while (upipe_rtp_fec->main_first != UINT32_MAX &&
+               (uint16_t)(seqnum - upipe_rtp_fec->main_first) >=
+                   upipe_rtp_fec->main_size) {
+            upipe_warn_va(upipe, "ring full, dropping packet %u",
+                          upipe_rtp_fec->main_first);
+            uref_free(upipe_rtp_fec_main_take(upipe_rtp_fec,
+                                              upipe_rtp_fec->main_first));
+        }
+        if (upipe_rtp_fec->main_first == UINT32_MAX)
+            upipe_rtp_fec->main_first = seqnum;
+        upipe_rtp_fec->main_last = seqnum;
+        upipe_rtp_fec->main_ring[seqnum & mask] = uref;
+        return;
+    }
+
+    /* Reordered packet */
+    if (seq_num_lt(seqnum, upipe_rtp_fec->main_first)) {
+        if ((uint16_t)(upipe_rtp_fec->main_last - seqnum) >=
+                upipe_rtp_fec->main_size ||
+            (upipe_rtp_fec->last_send_seqnum != UINT32_MAX &&
+             !seq_num_lt(upipe_rtp_fec->last_send_seqnum, seqnum))) {
+            /* Too late */
+            uref_free(uref);
+            return;
+        }
+        upipe_rtp_fec->main_first = seqnum;
+    } else if (upipe_rtp_fec->main_ring[seqnum & mask] != NULL) {
+        /* Duplicate packet */
+        uref_free(uref);
+        return;
+    }
+
+    uref_clock_delete_date_sys(uref);
+    upipe_rtp_fec->main_ring[seqnum & mask] = uref;
+}
+
+/* XOR a buffer into another, one word at a time so that the compiler may
+ * vectorize the loop */
+static void upipe_rtp_fec_xor(uint8_t *dst, const uint8_t *src, size_t size)
+{
+    size_t i = 0;
+    for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+        uint64_t a, b;
+        memcpy(&a, dst + i, sizeof(a));
+        memcpy(&b, src + i, sizeof(b));
+        a ^= b;
+        memcpy(dst + i, &a, sizeof(a));
+    }
+    for (; i < size; i++)
+        dst[i] ^= src[i];
+}
+
+/* XOR the payload of a packet into the recovered packet */
+static void upipe_rtp_fec_xor_payload(struct uref *uref, uint8_t *dst,
+                                      size_t length_rec)
+{
+    size_t size = 0;
+    uref_block_size(uref, &size);
+    if (size <= RTP_HEADER_SIZE)
+        return;
+
+    /* shorter packets are padded with zeros */
+    size -= RTP_HEADER_SIZE;
+    if (size > length_rec)
+        size = length_rec;
+
+    int offset = RTP_HEADER_SIZE;
+    while (size) {
+        int read = size;
+        const uint8_t *buf;
+        if (unlikely(!ubase_check(uref_block_read(uref, offset, &read,
+                                                  &buf))))
+            break;
+        upipe_rtp_fec_xor(dst + offset, buf, read);
+        uref_block_unmap(uref, offset);
+        offset += read;
+        size -= read;
     }
 }
 
@@ -269,28 +416,23 @@ static void upipe_rtp_fec_correct_packets(struct upipe *upipe,
 {
     struct upipe_rtp_fec *upipe_rtp_fec = upipe_rtp_fec_from_upipe(upipe);
 
-    bool found_seqnum[FEC_MAX] = {0};
+    struct uref *urefs[FEC_MAX];
+    uint16_t missing_seqnum = 0;
 
     /* Search to see if any packets are lost */
     int processed = 0;
-    struct uchain *uchain, *uchain_tmp;
-    ulist_foreach (&upipe_rtp_fec->main_queue, uchain) {
-        struct uref *uref = uref_from_uchain(uchain);
-        uint16_t seqnum = uref->priv;
-
-        for (int i = 0; i < items; i++) {
-            if (seqnum_list[i] == seqnum) {
-                processed++;
-                found_seqnum[i] = true;
-                break;
-            }
-        }
+    for (int i = 0; i < items; i++) {
+        urefs[i] = upipe_rtp_fec_main_get(upipe_rtp_fec, seqnum_list[i]);
+        if (urefs[i] != NULL)
+            processed++;
+        else
+            missing_seqnum = seqnum_list[i];
+    }
 
-        if (processed == items) {
-            upipe_verbose_va(upipe, "no packets lost");
-            uref_free(fec_uref);
-            return;
-        }
+    if (processed == items) {
+        upipe_verbose_va(upipe, "no packets lost");
+        uref_free(fec_uref);
+        return;
     }
 
     if (processed != items - 1) {
@@ -305,11 +447,11 @@ static void upipe_rtp_fec_correct_packets(struct upipe *upipe,
     uint32_t ts_rec;
     upipe_rtp_fec_extract_parameters(fec_uref, &ts_rec, &length_rec);
 
-    /* Recoverable packet */
-    ulist_foreach (&upipe_rtp_fec->main_queue, uchain) {
-        struct uref *uref = uref_from_uchain(uchain);
-
-        // TODO: only if in list?
+    /* Recover length and timestamp of missing packet */
+    for (int i = 0; i < items; i++) {
+        struct uref *uref = urefs[i];
+        if (uref == NULL)
+            continue;
 
         uint8_t rtp_buffer[RTP_HEADER_SIZE];
         const uint8_t *rtp_header = uref_block_peek(uref, 0, RTP_HEADER_SIZE,
@@ -322,17 +464,12 @@ static void upipe_rtp_fec_correct_packets(struct upipe *upipe,
         uint32_t timestamp = rtp_get_timestamp(rtp_header);
         uref_block_peek_unmap(uref, 0, rtp_buffer, rtp_header);
 
-        /* Recover length and timestamp of missing packet */
-        for (int i = 0; i < items; i++) {
-            if (seqnum_list[i] == uref->priv) {
-                size_t uref_len = 0;
-                uref_block_size(uref, &uref_len);
-                uref_len -= RTP_HEADER_SIZE;
+        size_t uref_len = 0;
+        uref_block_size(uref, &uref_len);
+        uref_len -= RTP_HEADER_SIZE;
 
-                length_rec ^= uref_len;
-                ts_rec ^= timestamp;
-            }
-        }
+        length_rec ^= uref_len;
+        ts_rec ^= timestamp;
     }
 
     if (length_rec != 7 * TS_SIZE)
@@ -342,49 +479,31 @@ static void upipe_rtp_fec_correct_packets(struct upipe *upipe,
     uref_block_resize(fec_uref, SMPTE_2022_FEC_HEADER_SIZE, -1);
     uint8_t *dst;
     int size = length_rec + RTP_HEADER_SIZE;
-    uref_block_write(fec_uref, 0, &size, &dst);
+    if (unlikely(!ubase_check(uref_block_write(fec_uref, 0, &size, &dst)))) {
+        upipe_warn(upipe, "unable to write FEC packet");
+        uref_free(fec_uref);
+        return;
+    }
+    if (unlikely(size < length_rec + RTP_HEADER_SIZE)) {
+        upipe_warn(upipe, "truncated FEC packet");
+        uref_block_unmap(fec_uref, 0);
+        uref_free(fec_uref);
+        return;
+    }
 
     bool copy_header = true;
+    for (int i = 0; i < items; i++) {
+        struct uref *uref = urefs[i];
+        if (uref == NULL)
+            continue;
 
-    processed = 0;
-    ulist_foreach (&upipe_rtp_fec->main_queue, uchain) {
-        struct uref *uref = uref_from_uchain(uchain);
-        for (int i = 0; i < items; i++) {
-            if (seqnum_list[i] == uref->priv) {
-                size_t size = 0;
-                uref_block_size(uref, &size);
-                uint8_t payload_buf[TS_SIZE * 7 + RTP_HEADER_SIZE];
-
-                if(size < sizeof(payload_buf))
-                    continue;
-
-                // TODO: uref_block_read in a loop
-                const uint8_t *peek = uref_block_peek(uref, 0, size,
-                        payload_buf);
-                if (copy_header) {
-                    memcpy(dst, peek, RTP_HEADER_SIZE);
-                    copy_header = false;
-                }
-                for (int i = 0; i < size - RTP_HEADER_SIZE; i++)
-                    dst[RTP_HEADER_SIZE + i] ^= peek[RTP_HEADER_SIZE + i];
-                uref_block_peek_unmap(uref, RTP_HEADER_SIZE, payload_buf, peek);
-                processed++;
-                break;
-            }
+        if (copy_header) {
+            uref_block_extract(uref, 0, RTP_HEADER_SIZE, dst);
+            copy_header = false;
         }
-
-        if (processed == items-1)
-            break;
+        upipe_rtp_fec_xor_payload(uref, dst, length_rec);
     }
 
-    /* Maybe possible to merge with above */
-    uint16_t missing_seqnum = 0;
-    for (int i = 0; i < items; i++)
-        if (!found_seqnum[i]) {
-            missing_seqnum = seqnum_list[i];
-            break;
-        }
-
     upipe_dbg_va(&upipe_rtp_fec->upipe, "Corrected packet. Sequence number: %u", missing_seqnum);
     upipe_rtp_fec->recovered++;
     fec_uref->priv = missing_seqnum;
@@ -393,7 +512,7 @@ static void upipe_rtp_fec_correct_packets(struct upipe *upipe,
     uref_block_unmap(fec_uref, 0);
     uref_block_resize(fec_uref, 0, size);
 
-    insert_ordered_uref(&upipe_rtp_fec->main_queue, fec_uref);
+    upipe_rtp_fec_main_insert(upipe, fec_uref);
 }
 
 static void upipe_rtp_fec_apply_col_fec(struct upipe *upipe)
@@ -473,7 +592,7 @@ static void upipe_rtp_fec_clear_queue(struct uchain *queue)
 
 static void upipe_rtp_fec_clear(struct upipe_rtp_fec *upipe_rtp_fec)
 {
-    upipe_rtp_fec_clear_queue(&upipe_rtp_fec->main_queue);
+    clear_main_list(upipe_rtp_fec, upipe_rtp_fec->main_last + 1);
     upipe_rtp_fec_clear_queue(&upipe_rtp_fec->col_queue);
     upipe_rtp_fec_clear_queue(&upipe_rtp_fec->row_queue);
 }
@@ -485,9 +604,17 @@ static void upipe_rtp_fec_timer(struct upump *upump)
     struct upipe_rtp_fec *upipe_rtp_fec = upipe_rtp_fec_from_upipe(upipe);
     uint64_t now = uclock_now(upipe_rtp_fec->uclock);
 
-    struct uchain *uchain, *uchain_tmp;
-    ulist_delete_foreach (&upipe_rtp_fec->main_queue, uchain, uchain_tmp) {
-        struct uref *uref = uref_from_uchain(uchain);
+    uint32_t mask = upipe_rtp_fec->main_size - 1;
+    uint16_t cur = upipe_rtp_fec->main_first;
+    while (upipe_rtp_fec->main_first != UINT32_MAX &&
+           cur != (uint16_t)(upipe_rtp_fec->main_last + 1)) {
+        struct uref *uref = upipe_rtp_fec->main_ring[cur & mask];
+        if (uref == NULL) {
+            /* Missing packet, may still be recovered */
+            cur++;
+            continue;
+        }
+
         uint64_t date_sys = UINT64_MAX;
         int type;
         uref_clock_get_date_sys(uref, &date_sys, &type);
@@ -503,7 +630,9 @@ static void upipe_rtp_fec_timer(struct upump *upump)
             uref_clock_set_date_sys(uref, date_sys, type);
         }
 
-        ulist_delete(uchain);
+        /* Packets missing before this one are lost */
+        upipe_rtp_fec->main_ring[cur & mask] = NULL;
+        upipe_rtp_fec_main_set_first(upipe_rtp_fec, ++cur);
         upipe_rtp_fec_output(upipe, uref, NULL);
 
         if (upipe_rtp_fec->last_send_seqnum != UINT32_MAX) {
@@ -548,6 +677,28 @@ static void clear_fec(struct upipe *upipe)
 
     upipe_rtp_fec_clear(upipe_rtp_fec);
 
+    /* Keep at least two matrices and the late column FEC packets */
+    uint32_t main_size = 0;
+    if (upipe_rtp_fec->cols || upipe_rtp_fec->rows) {
+        uint32_t needed = 4 * (upipe_rtp_fec->cols + 1) *
+                          (upipe_rtp_fec->rows + 1);
+        main_size = MAIN_RING_MIN;
+        while (main_size < needed && main_size < MAIN_RING_MAX)
+            main_size *= 2;
+    }
+    if (main_size != upipe_rtp_fec->main_size) {
+        free(upipe_rtp_fec->main_ring);
+        upipe_rtp_fec->main_ring = NULL;
+        upipe_rtp_fec->main_size = 0;
+        if (main_size) {
+            upipe_rtp_fec->main_ring = calloc(main_size, sizeof(struct uref *));
+            if (unlikely(upipe_rtp_fec->main_ring == NULL))
+                upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+            else
+                upipe_rtp_fec->main_size = main_size;
+        }
+    }
+
     upipe_rtp_fec->first_seqnum = UINT32_MAX;
     upipe_rtp_fec->last_seqnum = UINT32_MAX;
     upipe_rtp_fec->latency = 0;
@@ -561,13 +712,13 @@ static void upipe_rtp_fec_start_timer(struct upipe *upipe, uint16_t seqnum)
     struct upipe_rtp_fec *upipe_rtp_fec = upipe_rtp_fec_from_sub_mgr(upipe->mgr);
 
     /* Clear any old non-FEC packets */
-    clear_main_list(&upipe_rtp_fec->main_queue, upipe_rtp_fec->cur_matrix_snbase);
+    clear_main_list(upipe_rtp_fec, upipe_rtp_fec->cur_matrix_snbase);
 
-    struct uchain *first_uchain = ulist_peek(&upipe_rtp_fec->main_queue);
-    if (!first_uchain)
+    if (upipe_rtp_fec->main_first == UINT32_MAX)
         return;
 
-    struct uref *first_uref = uref_from_uchain(first_uchain);
+    struct uref *first_uref = upipe_rtp_fec_main_get(upipe_rtp_fec,
+            upipe_rtp_fec->main_first);
     upipe_rtp_fec->first_seqnum = first_uref->priv;
 
     /* Make sure we have at least two matrices of data as per the spec */
@@ -584,13 +735,10 @@ static void upipe_rtp_fec_start_timer(struct upipe *upipe, uint16_t seqnum)
 
     if (date_sys == UINT64_MAX) {
         /* First packet having an unusable date_sys is not useful */
-        ulist_delete(first_uchain);
-        uref_free(first_uref);
-        first_uchain = ulist_peek(&upipe_rtp_fec->main_queue);
-        if (first_uchain) {
-            struct uref *uref = uref_from_uchain(first_uchain);
-            upipe_rtp_fec->first_seqnum = uref->priv;
-        }
+        uref_free(upipe_rtp_fec_main_take(upipe_rtp_fec,
+                                          upipe_rtp_fec->main_first));
+        if (upipe_rtp_fec->main_first != UINT32_MAX)
+            upipe_rtp_fec->first_seqnum = upipe_rtp_fec->main_first;
         return;
     }
 
@@ -664,7 +812,7 @@ static void upipe_rtp_fec_main_input(struct upipe *upipe, struct uref *uref)
         uint64_t date_sys = 0;
         uref_clock_get_date_sys(uref, &date_sys, &type);
 
-        insert_ordered_uref(&upipe_rtp_fec->main_queue, uref);
+        upipe_rtp_fec_main_insert(super_pipe, uref);
 
         /* Owing to clock drift the latency of 2x the FEC matrix may increase
          * Build a continually updating duration and correct the latency if necessary.
@@ -935,7 +1083,10 @@ static struct upipe *_upipe_rtp_fec_alloc(struct upipe_mgr *mgr,
     upipe_rtp_fec_sub_init(upipe_rtp_fec_to_row_subpipe(upipe_rtp_fec),
                             &upipe_rtp_fec->sub_mgr, uprobe_row);
 
-    ulist_init(&upipe_rtp_fec->main_queue);
+    upipe_rtp_fec->main_ring = NULL;
+    upipe_rtp_fec->main_size = 0;
+    upipe_rtp_fec->main_first = UINT32_MAX;
+    upipe_rtp_fec->main_last = UINT32_MAX;
     ulist_init(&upipe_rtp_fec->col_queue);
     ulist_init(&upipe_rtp_fec->row_queue);
 
@@ -1046,6 +1197,7 @@ static void upipe_rtp_fec_free(struct upipe *upipe)
     upipe_throw_dead(upipe);
 
     upipe_rtp_fec_clear(upipe_rtp_fec);
+    free(upipe_rtp_fec->main_ring);
 
     upipe_rtp_fec_sub_clean(upipe_rtp_fec_to_main_subpipe(upipe_rtp_fec));
     upipe_rtp_fec_sub_clean(upipe_rtp_fec_to_col_subpipe(upipe_rtp_fec));
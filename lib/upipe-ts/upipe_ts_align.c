@@ -73,6 +73,10 @@ struct upipe_ts_align {
     struct upipe *last_inner;
     /** output */
     struct upipe *output;
+    /** maximum number of TS packets per output uref of ts_sync */
+    unsigned int batch;
+    /** true if the inner pipe is a ts_sync pipe */
+    bool sync;
 
     /** public upipe structure */
     struct upipe upipe;
@@ -126,6 +130,8 @@ static struct upipe *upipe_ts_align_alloc(struct upipe_mgr *mgr,
     upipe_ts_align_init_urefcount(upipe);
     upipe_ts_align_init_bin_input(upipe);
     upipe_ts_align_init_bin_output(upipe);
+    upipe_ts_align->batch = 1;
+    upipe_ts_align->sync = false;
 
     uprobe_init(&upipe_ts_align->proxy_probe, upipe_ts_align_proxy_probe, NULL);
     /* Because there is no buffering inside any of the inner pipes. */
@@ -156,6 +162,7 @@ static int upipe_ts_align_set_flow_def(struct upipe *upipe,
 
     struct upipe_mgr *inner_mgr;
     const char *inner_name;
+    upipe_ts_align->sync = false;
     if (!ubase_ncmp(def, EXPECTED_FLOW_DEF_SYNC)) {
         inner_mgr = upipe_idem_mgr_alloc();
         inner_name = "idem";
@@ -165,6 +172,7 @@ static int upipe_ts_align_set_flow_def(struct upipe *upipe,
     } else {
         inner_mgr = upipe_ts_sync_mgr_alloc();
         inner_name = "sync";
+        upipe_ts_align->sync = true;
     }
 
     if (unlikely(inner_mgr == NULL))
@@ -176,11 +184,60 @@ static int upipe_ts_align_set_flow_def(struct upipe *upipe,
                          uprobe_use(&upipe_ts_align->proxy_probe),
                          UPROBE_LOG_VERBOSE, inner_name));
     upipe_mgr_release(inner_mgr);
+    if (unlikely(inner == NULL))
+        return UBASE_ERR_ALLOC;
+    if (upipe_ts_align->sync && upipe_ts_align->batch != 1)
+        upipe_ts_sync_set_batch(inner, upipe_ts_align->batch);
     upipe_ts_align_store_bin_input(upipe, upipe_use(inner));
     upipe_ts_align_store_bin_output(upipe, inner);
     return upipe_set_flow_def(inner, flow_def);
 }
 
+/** @internal @This handles the batch commands of ts_sync, which are
+ * remembered for ts_sync inner pipes allocated later.
+ *
+ * @param upipe description structure of the pipe
+ * @param command type of command to process
+ * @param args arguments of the command
+ * @return an error code
+ */
+static int upipe_ts_align_control_batch(struct upipe *upipe,
+                                        int command, va_list args)
+{
+    struct upipe_ts_align *upipe_ts_align = upipe_ts_align_from_upipe(upipe);
+    va_list args_copy;
+    va_copy(args_copy, args);
+    int err = UBASE_ERR_UNHANDLED;
+
+    switch (command) {
+        case UPIPE_TS_SYNC_GET_BATCH: {
+            if (va_arg(args_copy, unsigned int) != UPIPE_TS_SYNC_SIGNATURE)
+                break;
+            unsigned int *batch_p = va_arg(args_copy, unsigned int *);
+            *batch_p = upipe_ts_align->batch;
+            err = UBASE_ERR_NONE;
+            break;
+        }
+        case UPIPE_TS_SYNC_SET_BATCH: {
+            if (va_arg(args_copy, unsigned int) != UPIPE_TS_SYNC_SIGNATURE)
+                break;
+            unsigned int batch = va_arg(args_copy, unsigned int);
+            if (!batch) {
+                err = UBASE_ERR_INVALID;
+                break;
+            }
+            upipe_ts_align->batch = batch;
+            err = UBASE_ERR_NONE;
+            if (upipe_ts_align->sync && upipe_ts_align->first_inner != NULL)
+                err = upipe_ts_sync_set_batch(upipe_ts_align->first_inner,
+                                              batch);
+            break;
+        }
+    }
+    va_end(args_copy);
+    return err;
+}
+
 /** @internal @This processes control commands on a ts check pipe.
  *
  * @param upipe description structure of the pipe
@@ -198,6 +255,7 @@ static int upipe_ts_align_control(struct upipe *upipe,
         }
     }
 
+    UBASE_HANDLED_RETURN(upipe_ts_align_control_batch(upipe, command, args));
     int err = upipe_ts_align_control_bin_input(upipe, command, args);
     if (err == UBASE_ERR_UNHANDLED)
         return upipe_ts_align_control_bin_output(upipe, command, args);
@@ -36,6 +36,7 @@
 #include <upipe/uprobe.h>
 #include <upipe/uref.h>
 #include <upipe/uref_block.h>
+#include <upipe/uref_clock.h>
 #include <upipe/ubuf.h>
 #include <upipe/upipe.h>
 #include <upipe/upipe_helper_upipe.h>
@@ -60,6 +61,32 @@
 #define OUTPUT_FLOW_DEF "block.mpegts."
 /** TS synchronization word */
 #define TS_SYNC 0x47
+/** number of PIDs */
+#define MAX_PIDS 8192
+/** null PID, exempted from continuity checks */
+#define NULL_PID 0x1fff
+/** wrap-around of the PCR, in 27 MHz ticks */
+#define PCR_WRAP (UINT64_C(8589934592) * 300)
+/** maximum interval between PCRs (ETR 290 2.3), in 27 MHz ticks */
+#define PCR_MAX_INTERVAL (27000000 / 10)
+/** maximum PCR inaccuracy (ETR 290 2.4: 500 ns), in 27 MHz ticks */
+#define PCR_MAX_INACCURACY 13
+
+/** @internal @This is the monitoring state of a PID. */
+struct upipe_ts_check_pid {
+    /** last continuity counter, or UINT8_MAX */
+    uint8_t last_cc;
+    /** true if the last packet was a duplicate */
+    bool duplicate;
+    /** last PCR in 27 MHz ticks, or UINT64_MAX */
+    uint64_t last_pcr;
+    /** index of the packet of the last PCR */
+    uint64_t last_pcr_index;
+    /** duration between the last two PCRs, or 0 */
+    uint64_t pcr_interval;
+    /** number of packets between the last two PCRs */
+    uint64_t pcr_interval_packets;
+};
 
 /** @internal @This is the private context of a ts_check pipe. */
 struct upipe_ts_check {
@@ -78,6 +105,23 @@ struct upipe_ts_check {
     /** TS packet size */
     size_t output_size;
 
+    /** monitoring interval, or 0 if monitoring is disabled */
+    uint64_t monitor;
+    /** start date of the monitoring window, or UINT64_MAX */
+    uint64_t window_start;
+    /** counters of the monitoring window */
+    struct upipe_ts_check_stats stats;
+    /** number of monitored packets, used as a time base for PCRs */
+    uint64_t monitored_packets;
+    /** index + 1 of each PID in the arrays below, or 0 */
+    uint16_t *pid_index;
+    /** counters of the PIDs, in order of appearance */
+    struct upipe_ts_check_pid_stats *pid_stats;
+    /** monitoring state of the PIDs, in the same order */
+    struct upipe_ts_check_pid *pid_states;
+    /** allocated size of the arrays */
+    unsigned int pids_size;
+
     /** public upipe structure */
     struct upipe upipe;
 };
@@ -108,10 +152,211 @@ static struct upipe *upipe_ts_check_alloc(struct upipe_mgr *mgr,
     upipe_ts_check_init_urefcount(upipe);
     upipe_ts_check_init_output(upipe);
     upipe_ts_check_init_output_size(upipe, TS_SIZE);
+    struct upipe_ts_check *upipe_ts_check = upipe_ts_check_from_upipe(upipe);
+    upipe_ts_check->monitor = 0;
+    upipe_ts_check->window_start = UINT64_MAX;
+    memset(&upipe_ts_check->stats, 0, sizeof(upipe_ts_check->stats));
+    upipe_ts_check->monitored_packets = 0;
+    upipe_ts_check->pid_index = NULL;
+    upipe_ts_check->pid_stats = NULL;
+    upipe_ts_check->pid_states = NULL;
+    upipe_ts_check->pids_size = 0;
     upipe_throw_ready(upipe);
     return upipe;
 }
 
+/** @internal @This returns the monitoring state of a PID, allocating it
+ * on first use.
+ *
+ * @param upipe description structure of the pipe
+ * @param pid PID
+ * @param state_p filled in with the monitoring state
+ * @return pointer to the counters of the PID, or NULL in case of allocation
+ * error
+ */
+static struct upipe_ts_check_pid_stats *
+    upipe_ts_check_get_pid(struct upipe *upipe, uint16_t pid,
+                           struct upipe_ts_check_pid **state_p)
+{
+    struct upipe_ts_check *upipe_ts_check = upipe_ts_check_from_upipe(upipe);
+    unsigned int index = upipe_ts_check->pid_index[pid];
+    if (likely(index)) {
+        *state_p = &upipe_ts_check->pid_states[index - 1];
+        return &upipe_ts_check->pid_stats[index - 1];
+    }
+
+    index = upipe_ts_check->stats.nb_pids;
+    if (unlikely(index >= upipe_ts_check->pids_size)) {
+        unsigned int size = upipe_ts_check->pids_size ?
+                            upipe_ts_check->pids_size * 2 : 16;
+        struct upipe_ts_check_pid_stats *pid_stats =
+            realloc(upipe_ts_check->pid_stats, size * sizeof(*pid_stats));
+        if (unlikely(pid_stats == NULL))
+            return NULL;
+        upipe_ts_check->pid_stats = pid_stats;
+        struct upipe_ts_check_pid *pid_states =
+            realloc(upipe_ts_check->pid_states, size * sizeof(*pid_states));
+        if (unlikely(pid_states == NULL))
+            return NULL;
+        upipe_ts_check->pid_states = pid_states;
+        upipe_ts_check->pids_size = size;
+    }
+
+    struct upipe_ts_check_pid_stats *stats = &upipe_ts_check->pid_stats[index];
+    memset(stats, 0, sizeof(*stats));
+    stats->pid = pid;
+    struct upipe_ts_check_pid *state = &upipe_ts_check->pid_states[index];
+    state->last_cc = UINT8_MAX;
+    state->duplicate = false;
+    state->last_pcr = UINT64_MAX;
+    state->last_pcr_index = 0;
+    state->pcr_interval = 0;
+    state->pcr_interval_packets = 0;
+    upipe_ts_check->stats.nb_pids++;
+    upipe_ts_check->pid_index[pid] = index + 1;
+    *state_p = state;
+    return stats;
+}
+
+/** @internal @This updates the conformance counters with a TS packet.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref uref structure containing one TS packet
+ */
+static void upipe_ts_check_monitor(struct upipe *upipe, struct uref *uref)
+{
+    struct upipe_ts_check *upipe_ts_check = upipe_ts_check_from_upipe(upipe);
+    uint8_t buffer[TS_HEADER_SIZE_PCR];
+    const uint8_t *ts = uref_block_peek(uref, 0, TS_HEADER_SIZE_PCR, buffer);
+    if (unlikely(ts == NULL))
+        return;
+
+    uint16_t pid = ts_get_pid(ts);
+    struct upipe_ts_check_pid *state;
+    struct upipe_ts_check_pid_stats *stats =
+        upipe_ts_check_get_pid(upipe, pid, &state);
+    if (unlikely(stats == NULL)) {
+        uref_block_peek_unmap(uref, 0, buffer, ts);
+        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+        return;
+    }
+    uint64_t index = upipe_ts_check->monitored_packets++;
+    upipe_ts_check->stats.packets++;
+    stats->packets++;
+
+    if (unlikely(ts_get_transporterror(ts)))
+        stats->transport_errors++;
+
+    uint8_t af_length = ts_has_adaptation(ts) ? ts_get_adaptation(ts) : 0;
+    bool discontinuity = af_length && tsaf_has_discontinuity(ts);
+
+    if (pid != NULL_PID) {
+        uint8_t cc = ts_get_cc(ts);
+        if (state->last_cc != UINT8_MAX && !discontinuity) {
+            if (!ts_has_payload(ts)) {
+                if (cc != state->last_cc)
+                    stats->cc_errors++;
+            } else if (cc == state->last_cc) {
+                /* a packet may be duplicated once */
+                if (state->duplicate)
+                    stats->cc_errors++;
+                state->duplicate = true;
+            } else {
+                if (cc != ((state->last_cc + 1) & 0xf))
+                    stats->cc_errors++;
+                state->duplicate = false;
+            }
+        }
+        state->last_cc = cc;
+    }
+
+    if (af_length >= TS_HEADER_SIZE_PCR - TS_HEADER_SIZE - 1 &&
+        tsaf_has_pcr(ts)) {
+        uint64_t pcr = tsaf_get_pcr(ts) * 300 + tsaf_get_pcrext(ts);
+        stats->pcrs++;
+        uint64_t interval = 0;
+        if (state->last_pcr != UINT64_MAX && !discontinuity) {
+            interval = (pcr + PCR_WRAP - state->last_pcr) % PCR_WRAP;
+            if (interval > PCR_MAX_INTERVAL) {
+                stats->pcr_repetition_errors++;
+                interval = 0;
+            } else if (state->pcr_interval) {
+                /* compare to the PCR extrapolated at the previous rate */
+                uint64_t expected = (index - state->last_pcr_index) *
+                    state->pcr_interval / state->pcr_interval_packets;
+                uint64_t inaccuracy = interval > expected ?
+                                      interval - expected :
+                                      expected - interval;
+                if (inaccuracy > stats->pcr_max_inaccuracy)
+                    stats->pcr_max_inaccuracy = inaccuracy;
+                if (inaccuracy > PCR_MAX_INACCURACY)
+                    stats->pcr_accuracy_errors++;
+            }
+        }
+        state->pcr_interval = interval;
+        state->pcr_interval_packets = index - state->last_pcr_index;
+        state->last_pcr = pcr;
+        state->last_pcr_index = index;
+    }
+
+    uref_block_peek_unmap(uref, 0, buffer, ts);
+}
+
+/** @internal @This reports the conformance counters of the current window
+ * and starts a new one.
+ *
+ * @param upipe description structure of the pipe
+ * @param now current date
+ */
+static void upipe_ts_check_report(struct upipe *upipe, uint64_t now)
+{
+    struct upipe_ts_check *upipe_ts_check = upipe_ts_check_from_upipe(upipe);
+    upipe_ts_check->stats.duration = now - upipe_ts_check->window_start;
+    upipe_ts_check->stats.pids = upipe_ts_check->pid_stats;
+    upipe_throw(upipe, UPROBE_TS_CHECK_REPORT, UPIPE_TS_CHECK_SIGNATURE,
+                &upipe_ts_check->stats);
+
+    for (unsigned int i = 0; i < upipe_ts_check->stats.nb_pids; i++) {
+        struct upipe_ts_check_pid_stats *stats = &upipe_ts_check->pid_stats[i];
+        uint16_t pid = stats->pid;
+        memset(stats, 0, sizeof(*stats));
+        stats->pid = pid;
+    }
+    upipe_ts_check->stats.packets = 0;
+    upipe_ts_check->stats.sync_errors = 0;
+    upipe_ts_check->window_start = now;
+}
+
+/** @internal @This enables or disables the monitoring mode.
+ *
+ * @param upipe description structure of the pipe
+ * @param interval report interval, or 0 to disable monitoring
+ * @return an error code
+ */
+static int upipe_ts_check_set_monitor_real(struct upipe *upipe,
+                                           uint64_t interval)
+{
+    struct upipe_ts_check *upipe_ts_check = upipe_ts_check_from_upipe(upipe);
+    if (interval && upipe_ts_check->pid_index == NULL) {
+        upipe_ts_check->pid_index =
+            calloc(MAX_PIDS, sizeof(*upipe_ts_check->pid_index));
+        if (unlikely(upipe_ts_check->pid_index == NULL))
+            return UBASE_ERR_ALLOC;
+    } else if (!interval) {
+        free(upipe_ts_check->pid_index);
+        free(upipe_ts_check->pid_stats);
+        free(upipe_ts_check->pid_states);
+        upipe_ts_check->pid_index = NULL;
+        upipe_ts_check->pid_stats = NULL;
+        upipe_ts_check->pid_states = NULL;
+        upipe_ts_check->pids_size = 0;
+        memset(&upipe_ts_check->stats, 0, sizeof(upipe_ts_check->stats));
+    }
+    upipe_ts_check->monitor = interval;
+    upipe_ts_check->window_start = UINT64_MAX;
+    return UBASE_ERR_NONE;
+}
+
 /** @internal @This checks the presence of the sync word.
  *
  * @param upipe description structure of the pipe
@@ -121,6 +366,7 @@ static struct upipe *upipe_ts_check_alloc(struct upipe_mgr *mgr,
 static bool upipe_ts_check_check(struct upipe *upipe, struct uref *uref,
                                  struct upump **upump_p)
 {
+    struct upipe_ts_check *upipe_ts_check = upipe_ts_check_from_upipe(upipe);
     const uint8_t *buffer;
     int size = 1;
     uint8_t word;
@@ -134,10 +380,16 @@ static bool upipe_ts_check_check(struct upipe *upipe, struct uref *uref,
     uref_block_unmap(uref, 0);
     if (word != TS_SYNC) {
         uref_free(uref);
-        upipe_warn_va(upipe, "invalid TS sync 0x%"PRIx8, word);
+        if (upipe_ts_check->monitor) {
+            upipe_ts_check->stats.sync_errors++;
+            upipe_verbose_va(upipe, "invalid TS sync 0x%"PRIx8, word);
+        } else
+            upipe_warn_va(upipe, "invalid TS sync 0x%"PRIx8, word);
         return false;
     }
 
+    if (upipe_ts_check->monitor)
+        upipe_ts_check_monitor(upipe, uref);
     upipe_ts_check_output(upipe, uref, upump_p);
     return true;
 }
@@ -159,6 +411,17 @@ static void upipe_ts_check_input(struct upipe *upipe, struct uref *uref,
         return;
     }
 
+    uint64_t date;
+    int type;
+    uref_clock_get_date_sys(uref, &date, &type);
+    if (upipe_ts_check->monitor && type != UREF_DATE_NONE) {
+        if (unlikely(upipe_ts_check->window_start == UINT64_MAX))
+            upipe_ts_check->window_start = date;
+        else if (date >= upipe_ts_check->window_start +
+                         upipe_ts_check->monitor)
+            upipe_ts_check_report(upipe, date);
+    }
+
     while (size > upipe_ts_check->output_size) {
         struct uref *next = uref_block_split(uref, upipe_ts_check->output_size);
         if (unlikely(next == NULL)) {
@@ -213,6 +476,7 @@ static int upipe_ts_check_set_flow_def(struct upipe *upipe,
 static int upipe_ts_check_control(struct upipe *upipe,
                                   int command, va_list args)
 {
+    struct upipe_ts_check *upipe_ts_check = upipe_ts_check_from_upipe(upipe);
     UBASE_HANDLED_RETURN(upipe_ts_check_control_output(upipe, command, args));
     UBASE_HANDLED_RETURN(
         upipe_ts_check_control_output_size(upipe, command, args));
@@ -221,6 +485,17 @@ static int upipe_ts_check_control(struct upipe *upipe,
             struct uref *flow_def = va_arg(args, struct uref *);
             return upipe_ts_check_set_flow_def(upipe, flow_def);
         }
+        case UPIPE_TS_CHECK_SET_MONITOR: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_TS_CHECK_SIGNATURE)
+            uint64_t interval = va_arg(args, uint64_t);
+            return upipe_ts_check_set_monitor_real(upipe, interval);
+        }
+        case UPIPE_TS_CHECK_GET_MONITOR: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_TS_CHECK_SIGNATURE)
+            uint64_t *interval_p = va_arg(args, uint64_t *);
+            *interval_p = upipe_ts_check->monitor;
+            return UBASE_ERR_NONE;
+        }
         default:
             return UBASE_ERR_UNHANDLED;
     }
@@ -234,6 +509,7 @@ static void upipe_ts_check_free(struct upipe *upipe)
 {
     upipe_throw_dead(upipe);
 
+    upipe_ts_check_set_monitor_real(upipe, 0);
     upipe_ts_check_clean_output(upipe);
     upipe_ts_check_clean_output_size(upipe);
     upipe_ts_check_clean_urefcount(upipe);
@@ -244,6 +520,8 @@ static void upipe_ts_check_free(struct upipe *upipe)
 static struct upipe_mgr upipe_ts_check_mgr = {
     .refcount = NULL,
     .signature = UPIPE_TS_CHECK_SIGNATURE,
+    .upipe_command_str = upipe_ts_check_command_str,
+    .upipe_event_str = upipe_ts_check_event_str,
 
     .upipe_alloc = upipe_ts_check_alloc,
     .upipe_input = upipe_ts_check_input,
@@ -0,0 +1,261 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short Upipe MPEG-2 CRC32 computation for PSI sections
+ * The portable implementation processes 8 octets per iteration with
+ * slicing tables. On x86, 64 octets are folded per iteration with
+ * carry-less multiplications (PCLMULQDQ), and the remainder is obtained
+ * with the tables. On ARMv8, the CRC32 instructions are used on bit-reversed
+ * data, as they only implement reflected CRCs.
+ */
+
+#include <upipe/ubase.h>
+#include <upipe/ucpu.h>
+#include "upipe_ts_crc.h"
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <pthread.h>
+
+#if defined(__i686__) || defined(__x86_64__)
+#include <immintrin.h>
+#define UPIPE_TS_CRC_X86
+#elif defined(__aarch64__) && defined(__linux__) && !defined(__AARCH64EB__)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#define UPIPE_TS_CRC_ARM
+#endif
+
+/** MPEG-2 CRC32 polynomial */
+#define UPIPE_TS_CRC_POLY 0x04c11db7
+
+/** slicing tables: the entry i of table n is i * x^(32 + 8 * n) mod P */
+static uint32_t upipe_ts_crc_tables[8][256];
+/** implementation selected for this CPU */
+static uint32_t (*upipe_ts_crc_impl)(uint32_t, const uint8_t *, size_t);
+/** protects the initialization of the above */
+static pthread_once_t upipe_ts_crc_once = PTHREAD_ONCE_INIT;
+
+/** @internal @This computes the CRC32 with slicing tables.
+ *
+ * @param crc value of the CRC register
+ * @param p pointer to the buffer
+ * @param size size of the buffer, in octets
+ * @return value of the CRC register
+ */
+static uint32_t upipe_ts_crc32_c(uint32_t crc, const uint8_t *p, size_t size)
+{
+    const uint32_t (*t)[256] = upipe_ts_crc_tables;
+    while (size >= 8) {
+        uint32_t v = crc ^ (((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) |
+                            ((uint32_t)p[2] << 8) | p[3]);
+        crc = t[7][v >> 24] ^ t[6][(v >> 16) & 0xff] ^
+              t[5][(v >> 8) & 0xff] ^ t[4][v & 0xff] ^
+              t[3][p[4]] ^ t[2][p[5]] ^ t[1][p[6]] ^ t[0][p[7]];
+        p += 8;
+        size -= 8;
+    }
+    while (size--)
+        crc = (crc << 8) ^ t[0][(crc >> 24) ^ *p++];
+    return crc;
+}
+
+#ifdef UPIPE_TS_CRC_X86
+/** x^(512 + 64) mod P and x^512 mod P, to fold 4 blocks */
+static uint64_t upipe_ts_crc_k512[2];
+/** x^(128 + 64) mod P and x^128 mod P, to fold 1 block */
+static uint64_t upipe_ts_crc_k128[2];
+
+/** @internal @This returns x^n mod P.
+ *
+ * @param n exponent
+ * @return remainder
+ */
+static uint32_t upipe_ts_crc_xpow(unsigned int n)
+{
+    uint32_t r = 1;
+    while (n--) {
+        uint32_t carry = r & 0x80000000;
+        r <<= 1;
+        if (carry)
+            r ^= UPIPE_TS_CRC_POLY;
+    }
+    return r;
+}
+
+/** @internal @This multiplies a 128-bit polynomial by the given power of x
+ * (modulo P), and adds another one.
+ *
+ * @param x polynomial to fold
+ * @param k folding constants, for the high and low halves of x
+ * @param b polynomial to add
+ * @return folded polynomial, congruent to x * x^n + b
+ */
+__attribute__((target("pclmul,ssse3")))
+static inline __m128i upipe_ts_crc_fold(__m128i x, __m128i k, __m128i b)
+{
+    return _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x, k, 0x11),
+                                       _mm_clmulepi64_si128(x, k, 0x00)), b);
+}
+
+/** @internal @This computes the CRC32 with carry-less multiplications.
+ *
+ * @param crc value of the CRC register
+ * @param p pointer to the buffer
+ * @param size size of the buffer, in octets
+ * @return value of the CRC register
+ */
+__attribute__((target("pclmul,ssse3")))
+static uint32_t upipe_ts_crc32_pclmul(uint32_t crc, const uint8_t *p,
+                                      size_t size)
+{
+    if (size < 64)
+        return upipe_ts_crc32_c(crc, p, size);
+
+    /* load blocks as big endian 128-bit polynomials */
+    const __m128i bswap = _mm_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8,
+                                        7, 6, 5, 4, 3, 2, 1, 0);
+    const __m128i k512 = _mm_set_epi64x(upipe_ts_crc_k512[0],
+                                        upipe_ts_crc_k512[1]);
+    const __m128i k128 = _mm_set_epi64x(upipe_ts_crc_k128[0],
+                                        upipe_ts_crc_k128[1]);
+#define LOAD(n) \
+    _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(p + 16 * n)), bswap)
+
+    /* the CRC register is added to the first 32 bits of the message */
+    __m128i x0 = _mm_xor_si128(LOAD(0), _mm_set_epi32(crc, 0, 0, 0));
+    __m128i x1 = LOAD(1);
+    __m128i x2 = LOAD(2);
+    __m128i x3 = LOAD(3);
+    p += 64;
+    size -= 64;
+
+    while (size >= 64) {
+        x0 = upipe_ts_crc_fold(x0, k512, LOAD(0));
+        x1 = upipe_ts_crc_fold(x1, k512, LOAD(1));
+        x2 = upipe_ts_crc_fold(x2, k512, LOAD(2));
+        x3 = upipe_ts_crc_fold(x3, k512, LOAD(3));
+        p += 64;
+        size -= 64;
+    }
+
+    x0 = upipe_ts_crc_fold(x0, k128, x1);
+    x0 = upipe_ts_crc_fold(x0, k128, x2);
+    x0 = upipe_ts_crc_fold(x0, k128, x3);
+    while (size >= 16) {
+        x0 = upipe_ts_crc_fold(x0, k128, LOAD(0));
+        p += 16;
+        size -= 16;
+    }
+#undef LOAD
+
+    /* the CRC register after x0 is x0 * x^32 mod P */
+    uint8_t buffer[16];
+    _mm_storeu_si128((__m128i *)buffer, _mm_shuffle_epi8(x0, bswap));
+    crc = upipe_ts_crc32_c(0, buffer, sizeof(buffer));
+    return upipe_ts_crc32_c(crc, p, size);
+}
+#endif
+
+#ifdef UPIPE_TS_CRC_ARM
+/** @internal @This computes the CRC32 with the ARMv8 CRC32 instructions.
+ * Reversing the bits of the octets and of the register turns the MPEG-2 CRC
+ * into the reflected CRC32 implemented by the CPU.
+ *
+ * @param crc value of the CRC register
+ * @param p pointer to the buffer
+ * @param size size of the buffer, in octets
+ * @return value of the CRC register
+ */
+static uint32_t upipe_ts_crc32_arm(uint32_t crc, const uint8_t *p,
+                                   size_t size)
+{
+    __asm__("rbit %w0, %w1" : "=r" (crc) : "r" (crc));
+    while (size >= 8) {
+        uint64_t v;
+        memcpy(&v, p, sizeof(v));
+        /* reverse the bits of each octet */
+        __asm__("rbit %x0, %x1" : "=r" (v) : "r" (v));
+        v = __builtin_bswap64(v);
+        __asm__(".arch_extension crc\n\t"
+                "crc32x %w0, %w0, %x1" : "+r" (crc) : "r" (v));
+        p += 8;
+        size -= 8;
+    }
+    __asm__("rbit %w0, %w1" : "=r" (crc) : "r" (crc));
+    return upipe_ts_crc32_c(crc, p, size);
+}
+#endif
+
+/** @internal @This initializes the tables and selects the implementation.
+ */
+static void upipe_ts_crc_init(void)
+{
+    for (unsigned int i = 0; i < 256; i++) {
+        uint32_t r = i << 24;
+        for (int j = 0; j < 8; j++)
+            r = (r << 1) ^ ((r & 0x80000000) ? UPIPE_TS_CRC_POLY : 0);
+        upipe_ts_crc_tables[0][i] = r;
+    }
+    for (unsigned int n = 1; n < 8; n++)
+        for (unsigned int i = 0; i < 256; i++) {
+            uint32_t r = upipe_ts_crc_tables[n - 1][i];
+            upipe_ts_crc_tables[n][i] =
+                (r << 8) ^ upipe_ts_crc_tables[0][r >> 24];
+        }
+    upipe_ts_crc_impl = upipe_ts_crc32_c;
+
+#ifdef UPIPE_TS_CRC_X86
+    if ((ucpu_flags() & (UCPU_PCLMUL | UCPU_SSSE3)) ==
+        (UCPU_PCLMUL | UCPU_SSSE3)) {
+        upipe_ts_crc_k512[0] = upipe_ts_crc_xpow(512 + 64);
+        upipe_ts_crc_k512[1] = upipe_ts_crc_xpow(512);
+        upipe_ts_crc_k128[0] = upipe_ts_crc_xpow(128 + 64);
+        upipe_ts_crc_k128[1] = upipe_ts_crc_xpow(128);
+        upipe_ts_crc_impl = upipe_ts_crc32_pclmul;
+    }
+#endif
+#ifdef UPIPE_TS_CRC_ARM
+    if (getauxval(AT_HWCAP) & HWCAP_CRC32)
+        upipe_ts_crc_impl = upipe_ts_crc32_arm;
+#endif
+}
+
+/** @This computes the MPEG-2 CRC32 (polynomial 0x04c11db7, not reflected)
+ * of a buffer.
+ *
+ * @param crc initial value of the CRC register (0xffffffff for PSI sections),
+ * or result of a previous call to continue the computation
+ * @param p pointer to the buffer
+ * @param size size of the buffer, in octets
+ * @return value of the CRC register
+ */
+uint32_t upipe_ts_crc32(uint32_t crc, const uint8_t *p, size_t size)
+{
+    pthread_once(&upipe_ts_crc_once, upipe_ts_crc_init);
+    return upipe_ts_crc_impl(crc, p, size);
+}
@@ -0,0 +1,82 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short Upipe MPEG-2 CRC32 computation for PSI sections
+ * This replaces the octet-by-octet psi_set_crc and psi_check_crc of
+ * <bitstream/mpeg/psi.h> with an implementation selected at runtime
+ * depending on the CPU.
+ */
+
+#ifndef _UPIPE_TS_UPIPE_TS_CRC_H_
+/** @hidden */
+#define _UPIPE_TS_UPIPE_TS_CRC_H_
+
+#include <upipe/ubase.h>
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <bitstream/mpeg/psi.h>
+
+/** @This computes the MPEG-2 CRC32 (polynomial 0x04c11db7, not reflected)
+ * of a buffer.
+ *
+ * @param crc initial value of the CRC register (0xffffffff for PSI sections),
+ * or result of a previous call to continue the computation
+ * @param p pointer to the buffer
+ * @param size size of the buffer, in octets
+ * @return value of the CRC register
+ */
+uint32_t upipe_ts_crc32(uint32_t crc, const uint8_t *p, size_t size);
+
+/** @This writes the CRC32 field of a PSI section.
+ *
+ * @param section PSI section, whose length field is already set
+ */
+static inline void upipe_ts_psi_set_crc(uint8_t *section)
+{
+    uint16_t size = psi_get_length(section) + PSI_HEADER_SIZE - PSI_CRC_SIZE;
+    uint32_t crc = upipe_ts_crc32(0xffffffff, section, size);
+    section[size] = crc >> 24;
+    section[size + 1] = crc >> 16;
+    section[size + 2] = crc >> 8;
+    section[size + 3] = crc;
+}
+
+/** @This checks the CRC32 field of a PSI section.
+ *
+ * @param section PSI section
+ * @return false if the CRC32 field is invalid
+ */
+static inline bool upipe_ts_psi_check_crc(const uint8_t *section)
+{
+    uint16_t size = psi_get_length(section) + PSI_HEADER_SIZE;
+    /* the remainder of a section including its CRC32 field is zero */
+    return !upipe_ts_crc32(0xffffffff, section, size);
+}
+
+#endif
@@ -103,6 +103,8 @@
 #define EXPECTED_FLOW_DEF_CHECK "block.mpegtsaligned."
 /** maximum number of PIDs */
 #define MAX_PIDS 8192
+/** maximum number of TS packets per uref output by ts_sync (a datagram) */
+#define SYNC_BATCH 7
 /** 2^33 (max resolution of PCR, PTS and DTS) */
 #define POW2_33 UINT64_C(8589934592)
 /** max resolution of PCR, PTS and DTS */
@@ -350,6 +352,8 @@ struct upipe_ts_demux_program {
     uint16_t pcr_pid;
     /** PCR ts_split output inner pipe */
     struct upipe *pcr_split_output;
+    /** true if new outputs forward TS packets without decapsulation */
+    bool passthrough;
 
     /** offset between MPEG timestamps and Upipe timestamps */
     int64_t timestamp_offset;
@@ -409,6 +413,8 @@ struct upipe_ts_demux_output {
     uint64_t pid;
     /** true if the output is used for PCR */
     bool pcr;
+    /** true if TS packets are forwarded without decapsulation */
+    bool passthrough;
     /** ts_split_output inner pipe */
     struct upipe *split_output;
     /** setrap inner pipe */
@@ -717,7 +723,9 @@ static int upipe_ts_demux_output_plumber(struct upipe *upipe,
     if (!uprobe_plumber(event, args, &flow_def, &def))
         return upipe_throw_proxy(upipe, inner, event, args);
 
-    if (!ubase_ncmp(def, "block.mpegts.")) {
+    bool passthrough = upipe_ts_demux_output->passthrough &&
+                       !ubase_ncmp(def, "block.mpegts.");
+    if (!passthrough && !ubase_ncmp(def, "block.mpegts.")) {
         /* allocate ts_decaps inner */
         if (unlikely(upipe_ts_demux_output->decaps == NULL)) {
             upipe_release(upipe_ts_demux_output->setrap);
@@ -759,7 +767,7 @@ static int upipe_ts_demux_output_plumber(struct upipe *upipe,
         return UBASE_ERR_NONE;
     }
 
-    if (ts_demux_mgr->autof_mgr != NULL) {
+    if (!passthrough && ts_demux_mgr->autof_mgr != NULL) {
         /* allocate autof inner */
         struct upipe *output =
             upipe_void_alloc_output(inner, ts_demux_mgr->autof_mgr,
@@ -772,7 +780,8 @@ static int upipe_ts_demux_output_plumber(struct upipe *upipe,
         return UBASE_ERR_NONE;
     }
 
-    upipe_warn_va(upipe, "unframed output flow definition: %s", def);
+    if (!passthrough)
+        upipe_warn_va(upipe, "unframed output flow definition: %s", def);
     /* allocate idem inner */
     struct upipe *output =
         upipe_void_alloc_output(inner, ts_demux_mgr->idem_mgr,
@@ -840,8 +849,10 @@ static struct upipe *upipe_ts_demux_output_alloc(struct upipe_mgr *mgr,
     upipe_ts_demux_output_init_bin_output(upipe);
     upipe_ts_demux_output->flow_def_input = flow_def;
     upipe_ts_demux_output->pcr = false;
+    upipe_ts_demux_output->passthrough = false;
     upipe_ts_demux_output->split_output = NULL;
     upipe_ts_demux_output->setrap = NULL;
+    upipe_ts_demux_output->decaps = NULL;
     upipe_ts_demux_output->max_delay = MAX_DELAY;
     uref_ts_flow_get_max_delay(flow_def, &upipe_ts_demux_output->max_delay);
     uprobe_init(&upipe_ts_demux_output->probe,
@@ -868,6 +879,7 @@ static struct upipe *upipe_ts_demux_output_alloc(struct upipe_mgr *mgr,
                 upipe_ts_demux_program_to_upipe(program)->mgr);
     struct upipe_ts_demux_mgr *ts_demux_mgr =
         upipe_ts_demux_mgr_from_upipe_mgr(upipe_ts_demux_to_upipe(demux)->mgr);
+    upipe_ts_demux_output->passthrough = program->passthrough;
     /* set up split_output and set rap inner pipes */
     if (unlikely((upipe_ts_demux_output->split_output =
                     upipe_flow_alloc_sub(
@@ -886,11 +898,14 @@ static struct upipe *upipe_ts_demux_output_alloc(struct upipe_mgr *mgr,
                                    upipe_ts_demux_output->pid))) == NULL))
         upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
 
-    upipe_ts_demux_output->decaps = upipe_void_alloc(ts_demux_mgr->ts_decaps_mgr,
+    if (!upipe_ts_demux_output->passthrough) {
+        upipe_ts_demux_output->decaps =
+            upipe_void_alloc(ts_demux_mgr->ts_decaps_mgr,
                 uprobe_pfx_alloc(uprobe_use(&upipe_ts_demux_output->probe),
                     UPROBE_LOG_VERBOSE, "decaps"));
-    if (unlikely(upipe_ts_demux_output->decaps == NULL))
-        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+        if (unlikely(upipe_ts_demux_output->decaps == NULL))
+            upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+    }
 
     upipe_ts_demux_program_check_pcr(upipe_ts_demux_program_to_upipe(program));
     return upipe;
@@ -969,6 +984,8 @@ static int upipe_ts_demux_output_control(struct upipe *upipe,
         case UPIPE_TS_DECAPS_GET_PACKETS_LOST: {
             struct upipe_ts_demux_output *upipe_ts_demux_output =
                 upipe_ts_demux_output_from_upipe(upipe);
+            if (upipe_ts_demux_output->decaps == NULL)
+                return UBASE_ERR_UNHANDLED;
             return upipe_control_va(upipe_ts_demux_output->decaps, command, args);
         }
         default:
@@ -1557,7 +1574,9 @@ static void upipe_ts_demux_program_check_pcr(struct upipe *upipe)
     ulist_foreach (&upipe_ts_demux_program->outputs, uchain) {
         struct upipe_ts_demux_output *output =
             upipe_ts_demux_output_from_uchain(uchain);
-        if (output->pid == upipe_ts_demux_program->pcr_pid) {
+        /* passthrough outputs do not decapsulate the PCR */
+        if (output->pid == upipe_ts_demux_program->pcr_pid &&
+            !output->passthrough) {
             output->pcr = !found;
             found = true;
         } else
@@ -1648,6 +1667,7 @@ static struct upipe *upipe_ts_demux_program_alloc(struct upipe_mgr *mgr,
     upipe_ts_demux_program->pmt_rap = 0;
     upipe_ts_demux_program->pcr_pid = 0;
     upipe_ts_demux_program->pcr_split_output = NULL;
+    upipe_ts_demux_program->passthrough = false;
     upipe_ts_demux_program->psi_pid_pmt =
         upipe_ts_demux_program->psi_pid_eit = NULL;
     upipe_ts_demux_program->psi_split_output_pmt =
@@ -1804,6 +1824,21 @@ static int upipe_ts_demux_program_control(struct upipe *upipe,
             *p = upipe_ts_demux_program->pmtd;
             return (*p != NULL) ? UBASE_ERR_NONE : UBASE_ERR_UNHANDLED;
         }
+        case UPIPE_TS_DEMUX_PROGRAM_GET_PASSTHROUGH: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_TS_DEMUX_PROGRAM_SIGNATURE)
+            struct upipe_ts_demux_program *upipe_ts_demux_program =
+                upipe_ts_demux_program_from_upipe(upipe);
+            bool *p = va_arg(args, bool *);
+            *p = upipe_ts_demux_program->passthrough;
+            return UBASE_ERR_NONE;
+        }
+        case UPIPE_TS_DEMUX_PROGRAM_SET_PASSTHROUGH: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_TS_DEMUX_PROGRAM_SIGNATURE)
+            struct upipe_ts_demux_program *upipe_ts_demux_program =
+                upipe_ts_demux_program_from_upipe(upipe);
+            upipe_ts_demux_program->passthrough = !!va_arg(args, int);
+            return UBASE_ERR_NONE;
+        }
 
         default:
             return UBASE_ERR_NONE;
@@ -2830,6 +2865,9 @@ static int upipe_ts_demux_set_flow_def(struct upipe *upipe,
             upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
             return UBASE_ERR_ALLOC;
         }
+        /* ts_split accepts several TS packets per uref */
+        if (ubase_ncmp(def, EXPECTED_FLOW_DEF_CHECK))
+            upipe_ts_sync_set_batch(input, SYNC_BATCH);
         upipe_ts_demux_store_bin_input(upipe, input);
         upipe_set_output(input, upipe_ts_demux->setrap);
 
@@ -2911,6 +2949,35 @@ static int _upipe_ts_demux_set_conformance(struct upipe *upipe,
     return UBASE_ERR_NONE;
 }
 
+/** @internal @This returns the duration of the fast channel change cache.
+ *
+ * @param upipe description structure of the pipe
+ * @param duration_p filled in with the duration
+ * @return an error code
+ */
+static int _upipe_ts_demux_get_fcc(struct upipe *upipe, uint64_t *duration_p)
+{
+    struct upipe_ts_demux *upipe_ts_demux = upipe_ts_demux_from_upipe(upipe);
+    if (unlikely(upipe_ts_demux->split == NULL))
+        return UBASE_ERR_INVALID;
+    return upipe_ts_split_get_fcc(upipe_ts_demux->split, duration_p);
+}
+
+/** @internal @This sets the duration of the fast channel change cache, which
+ * is kept by the ts_split inner pipe.
+ *
+ * @param upipe description structure of the pipe
+ * @param duration duration, or 0 to disable the cache
+ * @return an error code
+ */
+static int _upipe_ts_demux_set_fcc(struct upipe *upipe, uint64_t duration)
+{
+    struct upipe_ts_demux *upipe_ts_demux = upipe_ts_demux_from_upipe(upipe);
+    if (unlikely(upipe_ts_demux->split == NULL))
+        return UBASE_ERR_INVALID;
+    return upipe_ts_split_set_fcc(upipe_ts_demux->split, duration);
+}
+
 /** @internal @This processes control commands on a ts_demux pipe.
  *
  * @param upipe description structure of the pipe
@@ -2960,6 +3027,16 @@ static int upipe_ts_demux_control(struct upipe *upipe,
                 va_arg(args, enum upipe_ts_conformance);
             return _upipe_ts_demux_set_conformance(upipe, conformance);
         }
+        case UPIPE_TS_DEMUX_GET_FCC: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_TS_DEMUX_SIGNATURE)
+            uint64_t *duration_p = va_arg(args, uint64_t *);
+            return _upipe_ts_demux_get_fcc(upipe, duration_p);
+        }
+        case UPIPE_TS_DEMUX_SET_FCC: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_TS_DEMUX_SIGNATURE)
+            uint64_t duration = va_arg(args, uint64_t);
+            return _upipe_ts_demux_set_fcc(upipe, duration);
+        }
 
         default:
             break;
@@ -331,6 +331,12 @@ static void upipe_ts_eitd_input(struct upipe *upipe, struct uref *uref,
     struct upipe_ts_eitd *upipe_ts_eitd = upipe_ts_eitd_from_upipe(upipe);
     assert(upipe_ts_eitd->flow_def_input != NULL);
 
+    if (upipe_ts_psid_table_repetition(upipe_ts_eitd->eit, upipe_ts_eitd->next_eit, uref)) {
+        /* Repetition of a section of the current EIT. */
+        uref_free(uref);
+        return;
+    }
+
     if (!upipe_ts_eitd_table_section(upipe_ts_eitd->next_eit, uref))
         return;
 
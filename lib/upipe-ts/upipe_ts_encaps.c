@@ -763,38 +763,26 @@ static size_t upipe_ts_encaps_pes_header_size(struct upipe *upipe,
     return header_size;
 }
 
-/** @internal @This builds a PES header.
+/** @internal @This writes a PES header.
  *
  * @param upipe description structure of the pipe
+ * @param buffer buffer to write the header to
+ * @param header_size size of the header
  * @param payload_size size of the payload
  * @param alignment true if the data alignment flag must be set
  * @param pts_prog value of the PTS field, in 27 MHz units
  * @param dts_prog value of the DTS field, in 27 MHz units
- * @return allocated PES header
  */
-static struct ubuf *upipe_ts_encaps_build_pes(struct upipe *upipe,
-                                              size_t payload_size,
-                                              bool alignment,
-                                              uint64_t pts_prog,
-                                              uint64_t dts_prog)
+static void upipe_ts_encaps_write_pes(struct upipe *upipe, uint8_t *buffer,
+                                      size_t header_size, size_t payload_size,
+                                      bool alignment, uint64_t pts_prog,
+                                      uint64_t dts_prog)
 {
     struct upipe_ts_encaps *encaps = upipe_ts_encaps_from_upipe(upipe);
-    size_t header_size = upipe_ts_encaps_pes_header_size(upipe,
-                                                         pts_prog, dts_prog);
 
 #ifdef VERBOSE_HEADERS
     upipe_verbose_va(upipe, "preparing PES header (size %zu)", header_size);
 #endif
-    struct ubuf *ubuf = ubuf_block_alloc(encaps->ubuf_mgr, header_size);
-    uint8_t *buffer;
-    int size = -1;
-    if (unlikely(ubuf == NULL ||
-                 !ubase_check(ubuf_block_write(ubuf, 0, &size, &buffer)))) {
-        ubuf_free(ubuf);
-        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
-        return NULL;
-    }
-
     pes_init(buffer);
     pes_set_streamid(buffer, encaps->pes_id);
     size_t pes_length = payload_size + header_size - PES_HEADER_SIZE;
@@ -821,9 +809,62 @@ static struct ubuf *upipe_ts_encaps_build_pes(struct upipe *upipe,
                             POW2_33);
         }
     }
+}
+
+/** @internal @This prepends a PES header to the current access unit. The
+ * header is written in place in the headroom of the first segment if it is
+ * not shared, otherwise in a new segment.
+ *
+ * @param upipe description structure of the pipe
+ * @param payload_size size of the payload
+ * @param alignment true if the data alignment flag must be set
+ * @param pts_prog value of the PTS field, in 27 MHz units
+ * @param dts_prog value of the DTS field, in 27 MHz units
+ * @param header_size_p filled in with the size of the PES header
+ * @return an error code
+ */
+static int upipe_ts_encaps_prepend_pes(struct upipe *upipe,
+                                       size_t payload_size, bool alignment,
+                                       uint64_t pts_prog, uint64_t dts_prog,
+                                       size_t *header_size_p)
+{
+    struct upipe_ts_encaps *encaps = upipe_ts_encaps_from_upipe(upipe);
+    size_t header_size = upipe_ts_encaps_pes_header_size(upipe,
+                                                         pts_prog, dts_prog);
+    uint8_t *buffer;
+    int size = -1;
+    *header_size_p = header_size;
 
+    if (ubase_check(uref_block_prepend(encaps->uref, header_size))) {
+        if (unlikely(!ubase_check(uref_block_write(encaps->uref, 0, &size,
+                                                   &buffer)))) {
+            uref_block_resize(encaps->uref, header_size, -1);
+            return UBASE_ERR_ALLOC;
+        }
+        upipe_ts_encaps_write_pes(upipe, buffer, header_size, payload_size,
+                                  alignment, pts_prog, dts_prog);
+        uref_block_unmap(encaps->uref, 0);
+        return UBASE_ERR_NONE;
+    }
+
+    struct ubuf *ubuf = ubuf_block_alloc(encaps->ubuf_mgr, header_size);
+    if (unlikely(ubuf == NULL ||
+                 !ubase_check(ubuf_block_write(ubuf, 0, &size, &buffer)))) {
+        ubuf_free(ubuf);
+        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+        return UBASE_ERR_ALLOC;
+    }
+    upipe_ts_encaps_write_pes(upipe, buffer, header_size, payload_size,
+                              alignment, pts_prog, dts_prog);
     ubuf_block_unmap(ubuf, 0);
-    return ubuf;
+
+    struct ubuf *section = uref_detach_ubuf(encaps->uref);
+    uref_attach_ubuf(encaps->uref, ubuf);
+    if (unlikely(!ubase_check(uref_block_append(encaps->uref, section)))) {
+        ubuf_free(section);
+        return UBASE_ERR_ALLOC;
+    }
+    return UBASE_ERR_NONE;
 }
 
 /** @internal @This counts the number of PCRs we plan to insert for the next
@@ -1063,17 +1104,11 @@ static int upipe_ts_encaps_promote_au(struct upipe *upipe)
         }
     }
 
-    struct ubuf *ubuf = upipe_ts_encaps_build_pes(upipe, au_size,
-            ubase_check(uref_block_get_end(encaps->uref)), pts_prog, dts_prog);
     size_t header_size = 0;
-    ubuf_block_size(ubuf, &header_size);
+    UBASE_RETURN(upipe_ts_encaps_prepend_pes(upipe, au_size,
+            ubase_check(uref_block_get_end(encaps->uref)), pts_prog, dts_prog,
+            &header_size));
     uref_attr_set_priv(encaps->uref, header_size);
-    struct ubuf *section = uref_detach_ubuf(encaps->uref);
-    uref_attach_ubuf(encaps->uref, ubuf);
-    if (unlikely(!ubase_check(uref_block_append(encaps->uref, section)))) {
-        ubuf_free(section);
-        return UBASE_ERR_ALLOC;
-    }
     encaps->uref_size += header_size;
     encaps->au_size = au_size + header_size;
     assert(encaps->uref_size <= encaps->au_size);
@@ -1104,8 +1139,16 @@ static struct ubuf *upipe_ts_encaps_build_ts(struct upipe *upipe,
     else
         header_size = TS_HEADER_SIZE;
 
-    if (!encaps->psi && payload_size < TS_SIZE - header_size)
-        header_size = TS_SIZE - payload_size;
+    size_t stuffing_size = 0;
+    if (!encaps->psi && payload_size < TS_SIZE - header_size) {
+        if (!payload_size && encaps->padding != NULL) {
+            /* packet without payload: share the adaptation field stuffing */
+            if (header_size < TS_HEADER_SIZE_AF)
+                header_size = TS_HEADER_SIZE_AF;
+            stuffing_size = TS_SIZE - header_size;
+        } else
+            header_size = TS_SIZE - payload_size;
+    }
 
 #ifdef VERBOSE_HEADERS
     upipe_verbose_va(upipe, "preparing TS header (size %zu%s%s%s%s)",
@@ -1145,9 +1188,23 @@ static struct ubuf *upipe_ts_encaps_build_ts(struct upipe *upipe,
             tsaf_set_pcr(buffer, (pcr_prog / SCALE_33) % POW2_33);
             tsaf_set_pcrext(buffer, pcr_prog % SCALE_33);
         }
+        /* adaptation_field_length, including the shared stuffing */
+        buffer[4] += stuffing_size;
     }
 
     ubuf_block_unmap(ubuf, 0);
+
+    if (stuffing_size) {
+        struct ubuf *stuffing = ubuf_dup(encaps->padding);
+        if (unlikely(stuffing == NULL ||
+                     !ubase_check(ubuf_block_resize(stuffing, 0,
+                                                    stuffing_size)) ||
+                     !ubase_check(ubuf_block_append(ubuf, stuffing)))) {
+            ubuf_free(stuffing);
+            ubuf_free(ubuf);
+            return NULL;
+        }
+    }
     return ubuf;
 }
 
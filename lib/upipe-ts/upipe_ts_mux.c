@@ -216,6 +216,32 @@ static int upipe_ts_mux_check(struct upipe *upipe, struct uref *unused);
 
 /** @hidden */
 struct upipe_ts_mux_psi_pid;
+/** @hidden */
+struct upipe_ts_mux_input;
+
+/** @internal @This defines the dates on which inputs are scheduled. */
+enum upipe_ts_mux_sched_key {
+    /** dts_sys of the next packet */
+    UPIPE_TS_MUX_SCHED_DTS,
+    /** cr_sys of the next PCR */
+    UPIPE_TS_MUX_SCHED_PCR,
+    /** cr_sys of the next packet */
+    UPIPE_TS_MUX_SCHED_CR,
+
+    /** number of scheduling keys */
+    UPIPE_TS_MUX_SCHED_MAX
+};
+
+/** @internal @This is a binary min-heap of inputs, ordered by one of their
+ * dates. */
+struct upipe_ts_mux_sched {
+    /** array of inputs */
+    struct upipe_ts_mux_input **inputs;
+    /** number of inputs in the heap */
+    unsigned int size;
+    /** allocated size of the array */
+    unsigned int alloc;
+};
 
 /** @internal @This is the private context of a ts_mux pipe. */
 struct upipe_ts_mux {
@@ -348,6 +374,14 @@ struct upipe_ts_mux {
     struct uchain psi_pids_splice;
     /** list of inputs that are actually PSI */
     struct uchain psi_inputs;
+    /** heaps of inputs, one per scheduling key */
+    struct upipe_ts_mux_sched sched[UPIPE_TS_MUX_SCHED_MAX];
+    /** list of deleted inputs whose encaps must be released */
+    struct uchain inputs_dead;
+    /** number of video and audio inputs that are not ready */
+    unsigned int nb_unready;
+    /** number of inputs of unknown type that are not ready */
+    unsigned int nb_unknown;
     /** max latency of the subpipes */
     uint64_t latency;
     /** date of the current uref (system time, latency taken into account) */
@@ -514,6 +548,8 @@ struct upipe_ts_mux_input {
     struct uchain uchain;
     /** structure for double-linked lists for PSI inputs */
     struct uchain uchain_psi;
+    /** structure for double-linked lists for deleted inputs */
+    struct uchain uchain_dead;
 
     /** true if the input is in the process of being deleted */
     bool deleted;
@@ -552,6 +588,11 @@ struct upipe_ts_mux_input {
     uint64_t pcr_sys;
     /** true if the input is ready to output packet */
     bool ready;
+    /** positions in the scheduling heaps, or UINT_MAX */
+    unsigned int sched_pos[UPIPE_TS_MUX_SCHED_MAX];
+    /** pointer to the counter of unready inputs the input is accounted in,
+     * or NULL */
+    unsigned int *sched_count;
 
     /** psi_pid structure for PSI-based elementary streams */
     struct upipe_ts_mux_psi_pid *psi_pid;
@@ -580,6 +621,7 @@ UPIPE_HELPER_BIN_INPUT(upipe_ts_mux_input, input, input_request_list)
 
 UBASE_FROM_TO(upipe_ts_mux_input, urefcount, urefcount_real, urefcount_real)
 UBASE_FROM_TO(upipe_ts_mux_input, uchain, uchain_psi, uchain_psi)
+UBASE_FROM_TO(upipe_ts_mux_input, uchain, uchain_dead, uchain_dead)
 
 UPIPE_HELPER_SUBPIPE(upipe_ts_mux_program, upipe_ts_mux_input, input,
                      input_mgr, inputs, uchain)
@@ -588,6 +630,264 @@ UPIPE_HELPER_SUBPIPE(upipe_ts_mux_program, upipe_ts_mux_input, input,
 static void upipe_ts_mux_input_free(struct urefcount *urefcount_real);
 
 
+/*
+ * input scheduling
+ */
+
+/** @internal @This returns the date of an input for a scheduling key.
+ *
+ * @param input pointer to input
+ * @param key scheduling key
+ * @return date in system time
+ */
+static inline uint64_t
+    upipe_ts_mux_sched_date(struct upipe_ts_mux_input *input,
+                            enum upipe_ts_mux_sched_key key)
+{
+    switch (key) {
+        case UPIPE_TS_MUX_SCHED_DTS:
+            return input->dts_sys;
+        case UPIPE_TS_MUX_SCHED_PCR:
+            return input->pcr_sys;
+        default:
+            return input->cr_sys;
+    }
+}
+
+/** @internal @This stores an input at the given position of a heap.
+ *
+ * @param sched pointer to heap
+ * @param key scheduling key of the heap
+ * @param pos position in the heap
+ * @param input pointer to input
+ */
+static inline void upipe_ts_mux_sched_set(struct upipe_ts_mux_sched *sched,
+                                          enum upipe_ts_mux_sched_key key,
+                                          unsigned int pos,
+                                          struct upipe_ts_mux_input *input)
+{
+    sched->inputs[pos] = input;
+    input->sched_pos[key] = pos;
+}
+
+/** @internal @This moves an input towards the top of a heap.
+ *
+ * @param sched pointer to heap
+ * @param key scheduling key of the heap
+ * @param pos current position of the input
+ * @return new position of the input
+ */
+static unsigned int upipe_ts_mux_sched_up(struct upipe_ts_mux_sched *sched,
+                                          enum upipe_ts_mux_sched_key key,
+                                          unsigned int pos)
+{
+    struct upipe_ts_mux_input *input = sched->inputs[pos];
+    uint64_t date = upipe_ts_mux_sched_date(input, key);
+    while (pos) {
+        unsigned int parent = (pos - 1) / 2;
+        if (upipe_ts_mux_sched_date(sched->inputs[parent], key) <= date)
+            break;
+        upipe_ts_mux_sched_set(sched, key, pos, sched->inputs[parent]);
+        pos = parent;
+    }
+    upipe_ts_mux_sched_set(sched, key, pos, input);
+    return pos;
+}
+
+/** @internal @This moves an input towards the bottom of a heap.
+ *
+ * @param sched pointer to heap
+ * @param key scheduling key of the heap
+ * @param pos current position of the input
+ */
+static void upipe_ts_mux_sched_down(struct upipe_ts_mux_sched *sched,
+                                    enum upipe_ts_mux_sched_key key,
+                                    unsigned int pos)
+{
+    struct upipe_ts_mux_input *input = sched->inputs[pos];
+    uint64_t date = upipe_ts_mux_sched_date(input, key);
+    for ( ; ; ) {
+        unsigned int child = 2 * pos + 1;
+        if (child >= sched->size)
+            break;
+        if (child + 1 < sched->size &&
+            upipe_ts_mux_sched_date(sched->inputs[child + 1], key) <
+            upipe_ts_mux_sched_date(sched->inputs[child], key))
+            child++;
+        if (upipe_ts_mux_sched_date(sched->inputs[child], key) >= date)
+            break;
+        upipe_ts_mux_sched_set(sched, key, pos, sched->inputs[child]);
+        pos = child;
+    }
+    upipe_ts_mux_sched_set(sched, key, pos, input);
+}
+
+/** @internal @This inserts an input into a heap.
+ *
+ * @param sched pointer to heap
+ * @param key scheduling key of the heap
+ * @param input pointer to input
+ * @return an error code
+ */
+static int upipe_ts_mux_sched_insert(struct upipe_ts_mux_sched *sched,
+                                     enum upipe_ts_mux_sched_key key,
+                                     struct upipe_ts_mux_input *input)
+{
+    if (unlikely(sched->size >= sched->alloc)) {
+        unsigned int alloc = sched->alloc ? sched->alloc * 2 : 8;
+        struct upipe_ts_mux_input **inputs =
+            realloc(sched->inputs, alloc * sizeof(*inputs));
+        if (unlikely(inputs == NULL))
+            return UBASE_ERR_ALLOC;
+        sched->inputs = inputs;
+        sched->alloc = alloc;
+    }
+    upipe_ts_mux_sched_set(sched, key, sched->size++, input);
+    upipe_ts_mux_sched_up(sched, key, sched->size - 1);
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This removes an input from a heap, if it is present.
+ *
+ * @param sched pointer to heap
+ * @param key scheduling key of the heap
+ * @param input pointer to input
+ */
+static void upipe_ts_mux_sched_remove(struct upipe_ts_mux_sched *sched,
+                                      enum upipe_ts_mux_sched_key key,
+                                      struct upipe_ts_mux_input *input)
+{
+    unsigned int pos = input->sched_pos[key];
+    if (pos == UINT_MAX)
+        return;
+    input->sched_pos[key] = UINT_MAX;
+    if (pos == --sched->size)
+        return;
+    upipe_ts_mux_sched_set(sched, key, pos, sched->inputs[sched->size]);
+    upipe_ts_mux_sched_down(sched, key, upipe_ts_mux_sched_up(sched, key, pos));
+}
+
+/** @internal @This restores the position of an input in a heap after a
+ * change of its date.
+ *
+ * @param sched pointer to heap
+ * @param key scheduling key of the heap
+ * @param input pointer to input
+ */
+static void upipe_ts_mux_sched_update(struct upipe_ts_mux_sched *sched,
+                                      enum upipe_ts_mux_sched_key key,
+                                      struct upipe_ts_mux_input *input)
+{
+    unsigned int pos = input->sched_pos[key];
+    if (pos != UINT_MAX)
+        upipe_ts_mux_sched_down(sched, key,
+                                upipe_ts_mux_sched_up(sched, key, pos));
+}
+
+/** @internal @This returns the input with the lowest date in a heap.
+ *
+ * @param sched pointer to heap
+ * @return pointer to input, or NULL if the heap is empty
+ */
+static inline struct upipe_ts_mux_input *
+    upipe_ts_mux_sched_peek(struct upipe_ts_mux_sched *sched)
+{
+    return sched->size ? sched->inputs[0] : NULL;
+}
+
+/** @internal @This returns the ts_mux pipe of an input.
+ *
+ * @param upipe description structure of the input
+ * @return pointer to the private ts_mux structure
+ */
+static inline struct upipe_ts_mux *
+    upipe_ts_mux_input_get_mux(struct upipe *upipe)
+{
+    struct upipe_ts_mux_program *program =
+        upipe_ts_mux_program_from_input_mgr(upipe->mgr);
+    return upipe_ts_mux_from_program_mgr(
+                upipe_ts_mux_program_to_upipe(program)->mgr);
+}
+
+/** @internal @This updates the scheduling of an input after a change of
+ * its dates or of its state. Deleted inputs which are no longer ready are
+ * withdrawn and queued for release by @ref upipe_ts_mux_collect.
+ *
+ * @param upipe description structure of the input
+ */
+static void upipe_ts_mux_input_sched(struct upipe *upipe)
+{
+    struct upipe_ts_mux_input *input = upipe_ts_mux_input_from_upipe(upipe);
+    struct upipe_ts_mux *mux = upipe_ts_mux_input_get_mux(upipe);
+
+    unsigned int *count = NULL;
+    if (!input->ready && !input->deleted) {
+        if (input->input_type == UPIPE_TS_MUX_INPUT_VIDEO ||
+            input->input_type == UPIPE_TS_MUX_INPUT_AUDIO)
+            count = &mux->nb_unready;
+        else if (input->input_type == UPIPE_TS_MUX_INPUT_UNKNOWN)
+            count = &mux->nb_unknown;
+    }
+    if (count != input->sched_count) {
+        if (input->sched_count != NULL)
+            (*input->sched_count)--;
+        if (count != NULL)
+            (*count)++;
+        input->sched_count = count;
+    }
+
+    bool dead = input->deleted && !input->ready;
+    for (int key = 0; key < UPIPE_TS_MUX_SCHED_MAX; key++) {
+        if (dead)
+            upipe_ts_mux_sched_remove(&mux->sched[key], key, input);
+        else
+            upipe_ts_mux_sched_update(&mux->sched[key], key, input);
+    }
+
+    struct uchain *uchain_dead = upipe_ts_mux_input_to_uchain_dead(input);
+    if (dead && input->encaps != NULL && !ulist_is_in(uchain_dead))
+        ulist_add(&mux->inputs_dead, uchain_dead);
+}
+
+/** @internal @This withdraws an input from scheduling before it is freed.
+ *
+ * @param upipe description structure of the input
+ */
+static void upipe_ts_mux_input_unsched(struct upipe *upipe)
+{
+    struct upipe_ts_mux_input *input = upipe_ts_mux_input_from_upipe(upipe);
+    struct upipe_ts_mux *mux = upipe_ts_mux_input_get_mux(upipe);
+
+    if (input->sched_count != NULL)
+        (*input->sched_count)--;
+    input->sched_count = NULL;
+    for (int key = 0; key < UPIPE_TS_MUX_SCHED_MAX; key++)
+        upipe_ts_mux_sched_remove(&mux->sched[key], key, input);
+
+    struct uchain *uchain_dead = upipe_ts_mux_input_to_uchain_dead(input);
+    if (ulist_is_in(uchain_dead))
+        ulist_delete(uchain_dead);
+}
+
+/** @internal @This releases the encaps of deleted inputs which are no longer
+ * ready, which triggers their deletion.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_ts_mux_collect(struct upipe *upipe)
+{
+    struct upipe_ts_mux *mux = upipe_ts_mux_from_upipe(upipe);
+    struct uchain *uchain;
+    while ((uchain = ulist_pop(&mux->inputs_dead)) != NULL) {
+        struct upipe_ts_mux_input *input =
+            upipe_ts_mux_input_from_uchain_dead(uchain);
+        struct upipe *encaps = input->encaps;
+        input->encaps = NULL;
+        upipe_release(encaps);
+    }
+}
+
+
 /*
  * psi_pid structure handling
  */
@@ -920,6 +1220,7 @@ static int upipe_ts_mux_input_encaps_probe(struct uprobe *uprobe,
     upipe_ts_mux_input->dts_sys = va_arg(args, uint64_t);
     upipe_ts_mux_input->pcr_sys = va_arg(args, uint64_t);
     upipe_ts_mux_input->ready = !!va_arg(args, int);
+    upipe_ts_mux_input_sched(upipe);
     return UBASE_ERR_NONE;
 }
 
@@ -953,6 +1254,7 @@ static struct upipe *upipe_ts_mux_input_alloc(struct upipe_mgr *mgr,
                    upipe_ts_mux_input_free);
     upipe_ts_mux_input_init_bin_input(upipe);
     uchain_init(upipe_ts_mux_input_to_uchain_psi(upipe_ts_mux_input));
+    uchain_init(upipe_ts_mux_input_to_uchain_dead(upipe_ts_mux_input));
     upipe_ts_mux_input->pcr = false;
     upipe_ts_mux_input->deleted = false;
     upipe_ts_mux_input->input_type = UPIPE_TS_MUX_INPUT_UNKNOWN;
@@ -966,6 +1268,9 @@ static struct upipe *upipe_ts_mux_input_alloc(struct upipe_mgr *mgr,
     upipe_ts_mux_input->dts_sys = UINT64_MAX;
     upipe_ts_mux_input->pcr_sys = UINT64_MAX;
     upipe_ts_mux_input->ready = false;
+    for (int key = 0; key < UPIPE_TS_MUX_SCHED_MAX; key++)
+        upipe_ts_mux_input->sched_pos[key] = UINT_MAX;
+    upipe_ts_mux_input->sched_count = NULL;
     upipe_ts_mux_input->psi_pid = NULL;
     upipe_ts_mux_input->scte35_interval = program->scte35_interval;
     upipe_ts_mux_input->aac_encaps = program->aac_encaps;
@@ -984,6 +1289,16 @@ static struct upipe *upipe_ts_mux_input_alloc(struct upipe_mgr *mgr,
         upipe_ts_mux_input_to_urefcount_real(upipe_ts_mux_input);
     upipe_throw_ready(upipe);
 
+    for (int key = 0; key < UPIPE_TS_MUX_SCHED_MAX; key++) {
+        if (unlikely(!ubase_check(upipe_ts_mux_sched_insert(
+                            &upipe_ts_mux->sched[key], key,
+                            upipe_ts_mux_input)))) {
+            upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+            return upipe;
+        }
+    }
+    upipe_ts_mux_input_sched(upipe);
+
     struct upipe_ts_mux_mgr *ts_mux_mgr =
         upipe_ts_mux_mgr_from_upipe_mgr(upipe_ts_mux_to_upipe(upipe_ts_mux)->mgr);
     if (unlikely((upipe_ts_mux_input->tstd =
@@ -1267,6 +1582,7 @@ static int upipe_ts_mux_input_set_flow_def(struct upipe *upipe,
         input->dts_sys = UINT64_MAX;
         input->pcr_sys = UINT64_MAX;
         input->ready = false;
+        upipe_ts_mux_input_sched(upipe);
         ulist_add(&upipe_ts_mux->psi_inputs,
                   upipe_ts_mux_input_to_uchain_psi(input));
 
@@ -1348,6 +1664,7 @@ static int upipe_ts_mux_input_set_flow_def(struct upipe *upipe,
     uref_free(flow_def_dup);
 
     input->input_type = input_type;
+    upipe_ts_mux_input_sched(upipe);
     input->pid = pid;
     input->octetrate = octetrate;
     input->required_octetrate = octetrate + pes_overhead + ts_overhead;
@@ -1569,6 +1886,7 @@ static void upipe_ts_mux_input_free(struct urefcount *urefcount_real)
     struct upipe_ts_mux_program *program =
         upipe_ts_mux_program_from_input_mgr(upipe->mgr);
 
+    upipe_ts_mux_input_unsched(upipe);
     upipe_ts_mux_input_clean_sub(upipe);
     if (!upipe_single(upipe_ts_mux_program_to_upipe(program)))
         upipe_ts_mux_program_change(upipe_ts_mux_program_to_upipe(program));
@@ -1597,6 +1915,7 @@ static void upipe_ts_mux_input_no_input(struct upipe *upipe)
     upipe_use(upipe_ts_mux_to_upipe(mux));
 
     upipe_ts_mux_input->deleted = true;
+    upipe_ts_mux_input_sched(upipe);
     if (upipe_ts_mux_input->input_type == UPIPE_TS_MUX_INPUT_SCTE35) {
         ulist_delete(upipe_ts_mux_input_to_uchain_psi(upipe_ts_mux_input));
         upipe_release(upipe_ts_mux_input->encaps);
@@ -2486,6 +2805,12 @@ static struct upipe *upipe_ts_mux_alloc(struct upipe_mgr *mgr,
     ulist_init(&upipe_ts_mux->psi_pids);
     ulist_init(&upipe_ts_mux->psi_pids_splice);
     ulist_init(&upipe_ts_mux->psi_inputs);
+    for (int key = 0; key < UPIPE_TS_MUX_SCHED_MAX; key++) {
+        upipe_ts_mux->sched[key].inputs = NULL;
+        upipe_ts_mux->sched[key].size = upipe_ts_mux->sched[key].alloc = 0;
+    }
+    ulist_init(&upipe_ts_mux->inputs_dead);
+    upipe_ts_mux->nb_unready = upipe_ts_mux->nb_unknown = 0;
     upipe_ts_mux->mode = UPIPE_TS_MUX_MODE_CBR;
     upipe_ts_mux->tb_size = T_STD_TS_BUFFER;
     upipe_ts_mux->mtu = TS_SIZE;
@@ -2656,51 +2981,37 @@ static void upipe_ts_mux_splice(struct upipe *upipe, struct ubuf **ubuf_p,
         return;
     }
 
-    /* 2. Inputs */
-    uint64_t cr_sys = UINT64_MAX;
-    struct upipe_ts_mux_input *selected_input = NULL;
-    struct uchain *uchain_tmp;
-    ulist_delete_foreach (&mux->programs, uchain, uchain_tmp) {
-        struct upipe_ts_mux_program *program =
-            upipe_ts_mux_program_from_uchain(uchain);
-        upipe_use(upipe_ts_mux_program_to_upipe(program));
-
-        struct uchain *uchain_input, *uchain_tmp2;
-        ulist_delete_foreach (&program->inputs, uchain_input, uchain_tmp2) {
-            struct upipe_ts_mux_input *input =
-                upipe_ts_mux_input_from_uchain(uchain_input);
-            if (input->dts_sys < original_cr_sys) { /* flush */
-                upipe_ts_encaps_splice(input->encaps, original_cr_sys,
-                                       original_cr_sys + mux->interval,
-                                       NULL, NULL);
-
-                if (input->deleted && !input->ready) {
-                    /* This triggers the immediate deletion of the input. */
-                    upipe_release(input->encaps);
-                    continue;
-                }
-            }
-
-            if (input->dts_sys <= original_cr_sys + mux->interval ||
-                input->pcr_sys <= original_cr_sys) {
-                selected_input = input;
-                upipe_release(upipe_ts_mux_program_to_upipe(program));
-                goto upipe_ts_mux_splice_done;
-            }
-            if (input->cr_sys < cr_sys) {
-                selected_input = input;
-                cr_sys = input->cr_sys;
-            }
-        }
-
-        upipe_release(upipe_ts_mux_program_to_upipe(program));
+    /* 2. Inputs: flush late packets */
+    struct upipe_ts_mux_input *input;
+    while ((input = upipe_ts_mux_sched_peek(
+                    &mux->sched[UPIPE_TS_MUX_SCHED_DTS])) != NULL &&
+           input->dts_sys < original_cr_sys) {
+        uint64_t dts_sys = input->dts_sys;
+        upipe_ts_encaps_splice(input->encaps, original_cr_sys,
+                               original_cr_sys + mux->interval, NULL, NULL);
+        if (input->dts_sys == dts_sys)
+            break;
     }
-
-    if (selected_input == NULL ||
-        selected_input->cr_sys > original_cr_sys)
+    upipe_ts_mux_collect(upipe);
+
+    /* 3. Inputs with a PCR due, or packets about to be late, or the first
+     * packet in time */
+    struct upipe_ts_mux_input *selected_input;
+    if ((input = upipe_ts_mux_sched_peek(
+                    &mux->sched[UPIPE_TS_MUX_SCHED_PCR])) != NULL &&
+        input->pcr_sys <= original_cr_sys)
+        selected_input = input;
+    else if ((input = upipe_ts_mux_sched_peek(
+                    &mux->sched[UPIPE_TS_MUX_SCHED_DTS])) != NULL &&
+             input->dts_sys <= original_cr_sys + mux->interval)
+        selected_input = input;
+    else if ((input = upipe_ts_mux_sched_peek(
+                    &mux->sched[UPIPE_TS_MUX_SCHED_CR])) != NULL &&
+             input->cr_sys <= original_cr_sys)
+        selected_input = input;
+    else
         return;
 
-upipe_ts_mux_splice_done:
     err = upipe_ts_encaps_splice(selected_input->encaps, original_cr_sys,
                                  original_cr_sys + mux->interval,
                                  ubuf_p, dts_sys_p);
@@ -2709,10 +3020,8 @@ upipe_ts_mux_splice_done:
         upipe_throw_fatal(upipe, err);
     }
 
-    if (selected_input->deleted && !selected_input->ready) {
-        /* This triggers the immediate deletion of the input. */
-        upipe_release(selected_input->encaps);
-    }
+    /* This triggers the immediate deletion of the input if it is done. */
+    upipe_ts_mux_collect(upipe);
 }
 
 /** @internal @This appends a uref to our buffer.
@@ -2831,38 +3140,14 @@ static void upipe_ts_mux_watcher(struct upump *upump)
 static uint64_t upipe_ts_mux_check_available(struct upipe *upipe)
 {
     struct upipe_ts_mux *mux = upipe_ts_mux_from_upipe(upipe);
-    uint64_t min_cr_sys = UINT64_MAX;
+    upipe_ts_mux_collect(upipe);
 
-    struct uchain *uchain_program, *uchain_program_tmp;
-    ulist_delete_foreach (&mux->programs, uchain_program,
-                          uchain_program_tmp) {
-        struct upipe_ts_mux_program *program =
-            upipe_ts_mux_program_from_uchain(uchain_program);
-        upipe_use(upipe_ts_mux_program_to_upipe(program));
+    if (mux->nb_unready || (mux->preroll && mux->nb_unknown))
+        return UINT64_MAX;
 
-        struct uchain *uchain_input, *uchain_input_tmp;
-        ulist_delete_foreach (&program->inputs, uchain_input,
-                              uchain_input_tmp) {
-            struct upipe_ts_mux_input *input =
-                upipe_ts_mux_input_from_uchain(uchain_input);
-            if (!input->ready) {
-                if (input->deleted) {
-                    upipe_release(input->encaps);
-                    continue;
-                } else if (input->input_type != UPIPE_TS_MUX_INPUT_OTHER &&
-                           input->input_type != UPIPE_TS_MUX_INPUT_SCTE35 &&
-                           (input->input_type != UPIPE_TS_MUX_INPUT_UNKNOWN ||
-                            mux->preroll)) {
-                    upipe_release(upipe_ts_mux_program_to_upipe(program));
-                    return UINT64_MAX;
-                }
-            }
-            if (min_cr_sys > input->cr_sys)
-                min_cr_sys = input->cr_sys;
-        }
-        upipe_release(upipe_ts_mux_program_to_upipe(program));
-    }
-    return min_cr_sys;
+    struct upipe_ts_mux_input *input =
+        upipe_ts_mux_sched_peek(&mux->sched[UPIPE_TS_MUX_SCHED_CR]);
+    return input != NULL ? input->cr_sys : UINT64_MAX;
 }
 
 /** @internal @This sets the initial cr_prog of all programs.
@@ -4476,6 +4761,8 @@ static void upipe_ts_mux_free(struct urefcount *urefcount_real)
 
     ubuf_free(mux->padding);
     uref_free(mux->flow_def_input);
+    for (int key = 0; key < UPIPE_TS_MUX_SCHED_MAX; key++)
+        free(mux->sched[key].inputs);
     uprobe_clean(&mux->probe);
     urefcount_clean(urefcount_real);
     upipe_ts_mux_clean_inner_sink(upipe);
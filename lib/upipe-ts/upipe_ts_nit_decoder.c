@@ -44,6 +44,7 @@
 #include <upipe-ts/upipe_ts_nit_decoder.h>
 #include <upipe-ts/uref_ts_flow.h>
 #include "upipe_ts_psi_decoder.h"
+#include "upipe_ts_crc.h"
 
 #include <stdlib.h>
 #include <stdbool.h>
@@ -195,7 +196,7 @@ static bool upipe_ts_nitd_table_validate(struct upipe *upipe)
                                                   &section))))
             return false;
 
-        if (!nit_validate(section) || !psi_check_crc(section)) {
+        if (!nit_validate(section) || !upipe_ts_psi_check_crc(section)) {
             uref_block_unmap(section_uref, 0);
             return false;
         }
@@ -314,6 +315,12 @@ static void upipe_ts_nitd_input(struct upipe *upipe, struct uref *uref,
     struct upipe_ts_nitd *upipe_ts_nitd = upipe_ts_nitd_from_upipe(upipe);
     assert(upipe_ts_nitd->flow_def_input != NULL);
 
+    if (upipe_ts_psid_table_repetition(upipe_ts_nitd->nit, upipe_ts_nitd->next_nit, uref)) {
+        /* Repetition of a section of the current NIT. */
+        uref_free(uref);
+        return;
+    }
+
     if (!upipe_ts_psid_table_section(upipe_ts_nitd->next_nit, uref))
         return;
 
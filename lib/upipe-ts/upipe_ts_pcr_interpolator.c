@@ -45,8 +45,12 @@
 #include <string.h>
 #include <assert.h>
 
+#include <bitstream/mpeg/ts.h>
+
 /** we only accept TS packets */
 #define EXPECTED_FLOW_DEF "block.mpegts."
+/** wrap-around of the PCR, in clock units */
+#define PCR_WRAP (UINT64_C(8589934592) * 300 * (UCLOCK_FREQ / 27000000))
 
 /** @internal @This is the private context of a ts_pcr_interpolator pipe. */
 struct upipe_ts_pcr_interpolator {
@@ -116,31 +120,35 @@ static struct upipe *upipe_ts_pcr_interpolator_alloc(struct upipe_mgr *mgr,
     return upipe;
 }
 
-/** @internal @This interpolates the PCRs for packets without a PCR.
+/** @internal @This resets the state of the interpolation.
  *
  * @param upipe description structure of the pipe
- * @param uref uref structure
- * @param upump_p reference to pump that generated the buffer
  */
-static void upipe_ts_pcr_interpolator_input(struct upipe *upipe, struct uref *uref,
-                                  struct upump **upump_p)
+static void upipe_ts_pcr_interpolator_reset(struct upipe *upipe)
 {
     struct upipe_ts_pcr_interpolator *upipe_ts_pcr_interpolator = upipe_ts_pcr_interpolator_from_upipe(upipe);
-    bool discontinuity = ubase_check(uref_flow_get_discontinuity(uref));
-    if (discontinuity) {
-        upipe_ts_pcr_interpolator->last_pcr = 0;
-        upipe_ts_pcr_interpolator->packets = 0;
-        upipe_ts_pcr_interpolator->pcr_packets = 0;
-        upipe_ts_pcr_interpolator->pcr_delta = 0;
-        upipe_ts_pcr_interpolator->discontinuity = true;
-        upipe_notice_va(upipe, "Clearing state");
-    }
+    upipe_ts_pcr_interpolator->last_pcr = 0;
+    upipe_ts_pcr_interpolator->packets = 0;
+    upipe_ts_pcr_interpolator->pcr_packets = 0;
+    upipe_ts_pcr_interpolator->pcr_delta = 0;
+    upipe_ts_pcr_interpolator->discontinuity = true;
+    upipe_notice_va(upipe, "Clearing state");
+}
 
+/** @internal @This accounts a TS packet and computes its date.
+ *
+ * @param upipe description structure of the pipe
+ * @param pcr_prog PCR carried by the packet, or 0
+ * @param date_p filled in with the date of the packet
+ * @return false if the date of the packet cannot be determined yet
+ */
+static bool upipe_ts_pcr_interpolator_packet(struct upipe *upipe,
+                                             uint64_t pcr_prog,
+                                             uint64_t *date_p)
+{
+    struct upipe_ts_pcr_interpolator *upipe_ts_pcr_interpolator = upipe_ts_pcr_interpolator_from_upipe(upipe);
     upipe_ts_pcr_interpolator->packets++;
 
-    uint64_t pcr_prog = 0;
-    uref_clock_get_cr_prog(uref, &pcr_prog);
-
     if (pcr_prog) {
         uint64_t delta = pcr_prog - upipe_ts_pcr_interpolator->last_pcr;
         upipe_ts_pcr_interpolator->last_pcr = pcr_prog;
@@ -156,11 +164,136 @@ static void upipe_ts_pcr_interpolator_input(struct upipe *upipe, struct uref *ur
 
         upipe_ts_pcr_interpolator->pcr_delta = delta;
         upipe_ts_pcr_interpolator->packets = 0;
-    } else if (upipe_ts_pcr_interpolator->pcr_packets) {
-        uint64_t offset = upipe_ts_pcr_interpolator->pcr_delta *
-                    upipe_ts_pcr_interpolator->packets / upipe_ts_pcr_interpolator->pcr_packets;
-        uint64_t prog = upipe_ts_pcr_interpolator->last_pcr + offset;
-        uref_clock_set_date_prog(uref, prog, UREF_DATE_CR);
+        *date_p = pcr_prog;
+        return !!upipe_ts_pcr_interpolator->pcr_packets;
+    }
+
+    if (!upipe_ts_pcr_interpolator->pcr_packets)
+        return false;
+
+    uint64_t offset = upipe_ts_pcr_interpolator->pcr_delta *
+                upipe_ts_pcr_interpolator->packets / upipe_ts_pcr_interpolator->pcr_packets;
+    *date_p = upipe_ts_pcr_interpolator->last_pcr + offset;
+    return true;
+}
+
+/** @internal @This reads the PCR of a TS packet of a multi-packet uref.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref uref structure
+ * @param offset offset of the packet in the uref
+ * @return PCR of the packet in the program timeline, or 0
+ */
+static uint64_t upipe_ts_pcr_interpolator_read_pcr(struct upipe *upipe,
+                                                   struct uref *uref,
+                                                   int offset)
+{
+    struct upipe_ts_pcr_interpolator *upipe_ts_pcr_interpolator = upipe_ts_pcr_interpolator_from_upipe(upipe);
+    uint8_t buffer[TS_HEADER_SIZE_PCR];
+    const uint8_t *ts = uref_block_peek(uref, offset, TS_HEADER_SIZE_PCR,
+                                        buffer);
+    if (unlikely(ts == NULL))
+        return 0;
+
+    uint64_t pcr = 0;
+    if (ts_has_adaptation(ts) &&
+        ts_get_adaptation(ts) >= TS_HEADER_SIZE_PCR - TS_HEADER_SIZE - 1 &&
+        tsaf_has_pcr(ts))
+        pcr = (tsaf_get_pcr(ts) * 300 + tsaf_get_pcrext(ts)) *
+              (UCLOCK_FREQ / 27000000);
+    uref_block_peek_unmap(uref, offset, buffer, ts);
+
+    if (pcr && upipe_ts_pcr_interpolator->last_pcr) {
+        /* unwrap in the timeline of the previous PCR */
+        uint64_t last = upipe_ts_pcr_interpolator->last_pcr;
+        pcr = last + (pcr + PCR_WRAP - last % PCR_WRAP) % PCR_WRAP;
+    }
+    return pcr;
+}
+
+/** @internal @This interpolates the PCRs of all packets of a multi-packet
+ * uref in one pass, and attaches the per-packet offsets to the uref.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref uref structure
+ * @param size size of the uref in octets
+ * @param upump_p reference to pump that generated the buffer
+ */
+static void upipe_ts_pcr_interpolator_input_batch(struct upipe *upipe,
+                                                  struct uref *uref,
+                                                  size_t size,
+                                                  struct upump **upump_p)
+{
+    struct upipe_ts_pcr_interpolator *upipe_ts_pcr_interpolator = upipe_ts_pcr_interpolator_from_upipe(upipe);
+    unsigned int nb_packets = size / TS_SIZE;
+    int32_t offsets[nb_packets];
+    unsigned int first = nb_packets;
+    uint64_t base = 0;
+
+    for (unsigned int i = 0; i < nb_packets; i++) {
+        uint64_t pcr = upipe_ts_pcr_interpolator_read_pcr(upipe, uref,
+                                                          i * TS_SIZE);
+        uint64_t date;
+        if (!upipe_ts_pcr_interpolator_packet(upipe, pcr, &date))
+            continue;
+        if (first == nb_packets) {
+            first = i;
+            base = date;
+        }
+        offsets[i - first] = date - base;
+    }
+
+    if (first == nb_packets) {
+        uref_free(uref);
+        return;
+    }
+
+    if (first)
+        uref_block_resize(uref, first * TS_SIZE, -1);
+    uref_clock_set_cr_prog(uref, base);
+    if (unlikely(!ubase_check(uref_ts_pcr_interpolator_set_offsets(uref,
+                        (const uint8_t *)offsets,
+                        (nb_packets - first) * sizeof(int32_t))))) {
+        uref_free(uref);
+        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+        return;
+    }
+    upipe_throw_clock_ts(upipe, uref);
+
+    if (upipe_ts_pcr_interpolator->discontinuity) {
+        uref_flow_set_discontinuity(uref);
+        upipe_ts_pcr_interpolator->discontinuity = false;
+    }
+    upipe_ts_pcr_interpolator_output(upipe, uref, upump_p);
+}
+
+/** @internal @This interpolates the PCRs for packets without a PCR.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref uref structure
+ * @param upump_p reference to pump that generated the buffer
+ */
+static void upipe_ts_pcr_interpolator_input(struct upipe *upipe, struct uref *uref,
+                                  struct upump **upump_p)
+{
+    struct upipe_ts_pcr_interpolator *upipe_ts_pcr_interpolator = upipe_ts_pcr_interpolator_from_upipe(upipe);
+    if (ubase_check(uref_flow_get_discontinuity(uref)))
+        upipe_ts_pcr_interpolator_reset(upipe);
+
+    size_t size = 0;
+    uref_block_size(uref, &size);
+    if (size > TS_SIZE) {
+        upipe_ts_pcr_interpolator_input_batch(upipe, uref, size, upump_p);
+        return;
+    }
+
+    uint64_t pcr_prog = 0;
+    uref_clock_get_cr_prog(uref, &pcr_prog);
+
+    uint64_t date;
+    if (upipe_ts_pcr_interpolator_packet(upipe, pcr_prog, &date) &&
+        !pcr_prog) {
+        uref_clock_set_date_prog(uref, date, UREF_DATE_CR);
         upipe_throw_clock_ts(upipe, uref);
     }
 
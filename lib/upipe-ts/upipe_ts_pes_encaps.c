@@ -188,18 +188,31 @@ static void upipe_ts_pese_work(struct upipe *upipe, struct upump **upump_p)
     if (header_size < upipe_ts_pese->pes_header_size)
         header_size = upipe_ts_pese->pes_header_size;
 
-    struct ubuf *ubuf = ubuf_block_alloc(upipe_ts_pese->ubuf_mgr, header_size);
-    if (unlikely(ubuf == NULL)) {
-        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
-        goto upipe_ts_pese_work_err;
-    }
-
+    /* write the header in the headroom of the payload if possible,
+     * otherwise in a new segment */
+    struct ubuf *ubuf = NULL;
     uint8_t *buffer;
     int size = -1;
-    if (unlikely(!ubase_check(ubuf_block_write(ubuf, 0, &size, &buffer)))) {
-        ubuf_free(ubuf);
-        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
-        goto upipe_ts_pese_work_err;
+    if (ubase_check(uref_block_prepend(uref, header_size))) {
+        if (unlikely(!ubase_check(uref_block_write(uref, 0, &size,
+                                                   &buffer)))) {
+            uref_block_resize(uref, header_size, -1);
+            upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+            goto upipe_ts_pese_work_err;
+        }
+    } else {
+        ubuf = ubuf_block_alloc(upipe_ts_pese->ubuf_mgr, header_size);
+        if (unlikely(ubuf == NULL)) {
+            upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+            goto upipe_ts_pese_work_err;
+        }
+
+        if (unlikely(!ubase_check(ubuf_block_write(ubuf, 0, &size,
+                                                   &buffer)))) {
+            ubuf_free(ubuf);
+            upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+            goto upipe_ts_pese_work_err;
+        }
     }
 
     pes_init(buffer);
@@ -225,15 +238,19 @@ static void upipe_ts_pese_work(struct upipe *upipe, struct upump **upump_p)
                 pes_set_dts(buffer, (dts / CLOCK_SCALE) % POW2_33);
         }
     }
-    ubuf_block_unmap(ubuf, 0);
-
-    struct ubuf *payload = uref_detach_ubuf(uref);
-    uref_attach_ubuf(uref, ubuf);
-    if (unlikely(!ubase_check(uref_block_append(uref, payload)))) {
-        uref_free(uref);
-        ubuf_free(payload);
-        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
-        return;
+    if (ubuf == NULL)
+        uref_block_unmap(uref, 0);
+    else {
+        ubuf_block_unmap(ubuf, 0);
+
+        struct ubuf *payload = uref_detach_ubuf(uref);
+        uref_attach_ubuf(uref, ubuf);
+        if (unlikely(!ubase_check(uref_block_append(uref, payload)))) {
+            uref_free(uref);
+            ubuf_free(payload);
+            upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+            return;
+        }
     }
 
     /* intended pass-through */
@@ -44,7 +44,7 @@
 
 #include <bitstream/mpeg/ts.h>
 
-/** we only accept blocks containing exactly one TS packet */
+/** we only accept blocks containing whole TS packets */
 #define EXPECTED_FLOW_DEF "block.mpegts."
 /** maximum number of PIDs */
 #define MAX_PIDS 8192
@@ -104,31 +104,126 @@ static struct upipe *upipe_ts_pidf_alloc(struct upipe_mgr *mgr,
     return upipe;
 }
 
-/** @internal @This demuxes a TS packet to the appropriate output(s).
+/** @internal @This checks whether the TS packet at the given offset is on an
+ * enabled PID.
  *
  * @param upipe description structure of the pipe
  * @param uref uref structure
- * @param upump_p reference to pump that generated the buffer
+ * @param offset offset of the TS packet in the uref
+ * @param enabled_p filled in with true if the packet must be kept
+ * @return an error code
  */
-static void upipe_ts_pidf_input(struct upipe *upipe, struct uref *uref,
-                                 struct upump **upump_p)
+static int upipe_ts_pidf_check(struct upipe *upipe, struct uref *uref,
+                               int offset, bool *enabled_p)
 {
     struct upipe_ts_pidf *upipe_ts_pidf = upipe_ts_pidf_from_upipe(upipe);
     uint8_t buffer[TS_HEADER_SIZE];
-    const uint8_t *ts_header = uref_block_peek(uref, 0, TS_HEADER_SIZE,
+    const uint8_t *ts_header = uref_block_peek(uref, offset, TS_HEADER_SIZE,
                                                buffer);
-    if (unlikely(ts_header == NULL)) {
+    if (unlikely(ts_header == NULL))
+        return UBASE_ERR_ALLOC;
+    uint16_t pid = ts_get_pid(ts_header);
+    UBASE_RETURN(uref_block_peek_unmap(uref, offset, buffer, ts_header))
+
+    *enabled_p = upipe_ts_pidf->enabled_pids[pid / 8] & (1 << (pid & 0x7));
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This appends a run of consecutive kept TS packets to the
+ * output buffer, without copying them.
+ *
+ * @param uref uref structure
+ * @param ubuf_p reference to the output buffer, or NULL
+ * @param offset offset of the first packet of the run
+ * @param size size of the run
+ * @return an error code
+ */
+static int upipe_ts_pidf_keep(struct uref *uref, struct ubuf **ubuf_p,
+                              int offset, int size)
+{
+    struct ubuf *ubuf = ubuf_block_splice(uref->ubuf, offset, size);
+    UBASE_ALLOC_RETURN(ubuf)
+    if (*ubuf_p == NULL) {
+        *ubuf_p = ubuf;
+        return UBASE_ERR_NONE;
+    }
+    int err = ubuf_block_append(*ubuf_p, ubuf);
+    if (unlikely(!ubase_check(err)))
+        ubuf_free(ubuf);
+    return err;
+}
+
+/** @internal @This filters a block of TS packets. The packets on enabled
+ * PIDs are output in a single uref, referencing the same data.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref uref structure
+ * @param upump_p reference to pump that generated the buffer
+ */
+static void upipe_ts_pidf_input(struct upipe *upipe, struct uref *uref,
+                                 struct upump **upump_p)
+{
+    size_t size;
+    if (unlikely(!ubase_check(uref_block_size(uref, &size)))) {
         uref_free(uref);
-        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+        upipe_throw_fatal(upipe, UBASE_ERR_INVALID);
         return;
     }
-    uint16_t pid = ts_get_pid(ts_header);
-    UBASE_FATAL(upipe, uref_block_peek_unmap(uref, 0, buffer, ts_header))
 
-    if (upipe_ts_pidf->enabled_pids[pid / 8] & (1 << (pid & 0x7)))
+    struct ubuf *ubuf = NULL;
+    int run = -1;
+    bool all = true;
+    for (int offset = 0; offset < size; offset += TS_SIZE) {
+        bool enabled;
+        int err = upipe_ts_pidf_check(upipe, uref, offset, &enabled);
+        if (unlikely(!ubase_check(err))) {
+            ubuf_free(ubuf);
+            uref_free(uref);
+            upipe_throw_fatal(upipe, err);
+            return;
+        }
+
+        if (enabled) {
+            if (run < 0)
+                run = offset;
+            continue;
+        }
+
+        all = false;
+        if (run >= 0) {
+            err = upipe_ts_pidf_keep(uref, &ubuf, run, offset - run);
+            if (unlikely(!ubase_check(err))) {
+                ubuf_free(ubuf);
+                uref_free(uref);
+                upipe_throw_fatal(upipe, err);
+                return;
+            }
+            run = -1;
+        }
+    }
+
+    if (all) {
+        /* includes the case of a single TS packet */
         upipe_ts_pidf_output(upipe, uref, upump_p);
-    else
+        return;
+    }
+
+    if (run >= 0) {
+        int err = upipe_ts_pidf_keep(uref, &ubuf, run, size - run);
+        if (unlikely(!ubase_check(err))) {
+            ubuf_free(ubuf);
+            uref_free(uref);
+            upipe_throw_fatal(upipe, err);
+            return;
+        }
+    }
+
+    if (ubuf == NULL) {
         uref_free(uref);
+        return;
+    }
+    uref_attach_ubuf(uref, ubuf);
+    upipe_ts_pidf_output(upipe, uref, upump_p);
 }
 
 /** @internal @This sets the input flow definition.
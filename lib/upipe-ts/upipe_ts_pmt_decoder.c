@@ -591,8 +591,7 @@ static void upipe_ts_pmtd_input(struct upipe *upipe, struct uref *uref,
 {
     struct upipe_ts_pmtd *upipe_ts_pmtd = upipe_ts_pmtd_from_upipe(upipe);
     assert(upipe_ts_pmtd->flow_def_input != NULL);
-    if (upipe_ts_pmtd->pmt != NULL &&
-        ubase_check(uref_block_equal(upipe_ts_pmtd->pmt, uref))) {
+    if (upipe_ts_psid_repetition(upipe_ts_pmtd->pmt, uref)) {
         /* Identical PMT. */
         upipe_throw_new_rap(upipe, uref);
         uref_free(uref);
@@ -601,8 +600,8 @@ static void upipe_ts_pmtd_input(struct upipe *upipe, struct uref *uref,
 
     const uint8_t *pmt;
     int size = -1;
-    if (unlikely(!ubase_check(uref_block_merge(uref, upipe_ts_pmtd->ubuf_mgr,
-                                               0, -1)) ||
+    if (unlikely(!ubase_check(uref_block_merge_read(uref, upipe_ts_pmtd->ubuf_mgr,
+                                                    0, -1)) ||
                  !ubase_check(uref_block_read(uref, 0, &size, &pmt)))) {
         upipe_warn(upipe, "invalid PMT section received");
         uref_free(uref);
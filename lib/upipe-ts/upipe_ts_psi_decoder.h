@@ -29,6 +29,7 @@
 #include <upipe/uref_block.h>
 
 #include <stdbool.h>
+#include <string.h>
 #include <assert.h>
 
 #include <bitstream/mpeg/psi.h>
@@ -49,6 +50,42 @@ static inline bool upipe_ts_psid_equal(struct uref *section1,
     return ubase_check(uref_block_equal(section1, section2));
 }
 
+/** @This checks if a PSI section is a repetition of another one, by comparing
+ * their headers (including version and length) and their CRC_32 fields, which
+ * is much cheaper than checking and comparing the whole sections.
+ *
+ * @param section1 PSI section 1 (may be NULL)
+ * @param section2 PSI section 2
+ * @return true if section2 is a repetition of section1
+ */
+static inline bool upipe_ts_psid_repetition(struct uref *section1,
+                                            struct uref *section2)
+{
+    uint8_t header1[PSI_HEADER_SIZE_SYNTAX1];
+    uint8_t header2[PSI_HEADER_SIZE_SYNTAX1];
+    if (section1 == NULL ||
+        !ubase_check(uref_block_extract(section1, 0, PSI_HEADER_SIZE_SYNTAX1,
+                                        header1)) ||
+        !ubase_check(uref_block_extract(section2, 0, PSI_HEADER_SIZE_SYNTAX1,
+                                        header2)) ||
+        memcmp(header1, header2, PSI_HEADER_SIZE_SYNTAX1) ||
+        !psi_get_syntax(header1))
+        return false;
+
+    uint16_t length = psi_get_length(header1);
+    if (length < PSI_HEADER_SIZE_SYNTAX1 - PSI_HEADER_SIZE + PSI_CRC_SIZE)
+        return false;
+
+    uint8_t crc1[PSI_CRC_SIZE];
+    uint8_t crc2[PSI_CRC_SIZE];
+    int offset = PSI_HEADER_SIZE + length - PSI_CRC_SIZE;
+    return ubase_check(uref_block_extract(section1, offset, PSI_CRC_SIZE,
+                                          crc1)) &&
+           ubase_check(uref_block_extract(section2, offset, PSI_CRC_SIZE,
+                                          crc2)) &&
+           !memcmp(crc1, crc2, PSI_CRC_SIZE);
+}
+
 /** @This declares a PSI table in a structure.
  *
  * @param table name of the member
@@ -194,6 +231,32 @@ static inline bool upipe_ts_psid_table_section(struct uref **sections,
     return true;
 }
 
+/** @This checks if a new section is a repetition of the corresponding section
+ * of the table in effect, while no other table is being gathered. Such
+ * sections may be dropped before being reassembled, checked and parsed.
+ *
+ * @param sections PSI table in effect
+ * @param next_sections PSI table being gathered
+ * @param uref new section
+ * @return true if the section is a repetition
+ */
+static inline bool upipe_ts_psid_table_repetition(struct uref **sections,
+                                                  struct uref **next_sections,
+                                                  struct uref *uref)
+{
+    uint8_t header[PSI_HEADER_SIZE_SYNTAX1];
+    if (unlikely(!ubase_check(uref_block_extract(uref, 0,
+                        PSI_HEADER_SIZE_SYNTAX1, header))))
+        return false;
+
+    uint8_t last_section = psi_get_lastsection(header);
+    for (int i = 0; i <= last_section; i++)
+        if (next_sections[i] != NULL)
+            return false;
+
+    return upipe_ts_psid_repetition(sections[psi_get_section(header)], uref);
+}
+
 /** @This returns a section from a PSI table.
  *
  * @param sections PSI table
@@ -244,10 +307,11 @@ static inline bool upipe_ts_psid_table_compare(struct uref **sections1,
     return true;
 }
 
-/** @This calls @ref ubuf_block_merge on all sections of the PSI table.
+/** @This calls @ref ubuf_block_merge_read on all sections of the PSI table,
+ * which must not be written to afterwards.
  *
  * @param sections PSI table
- * @param ubuf_mgr ubuf manager used for @ref ubuf_block_merge
+ * @param ubuf_mgr ubuf manager used for @ref ubuf_block_merge_read
  * @return an error code
  */
 static inline int upipe_ts_psid_table_merge(struct uref **sections,
@@ -256,7 +320,7 @@ static inline int upipe_ts_psid_table_merge(struct uref **sections,
     upipe_ts_psid_table_foreach (sections, section) {
         if (section == NULL)
             continue;
-        UBASE_RETURN(uref_block_merge(section, ubuf_mgr, 0, -1));
+        UBASE_RETURN(uref_block_merge_read(section, ubuf_mgr, 0, -1));
     }
     return UBASE_ERR_NONE;
 }
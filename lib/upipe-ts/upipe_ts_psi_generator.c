@@ -48,6 +48,8 @@
 #include <upipe-ts/upipe_ts_psi_generator.h>
 #include <upipe-ts/upipe_ts_mux.h>
 #include <upipe-ts/uref_ts_flow.h>
+#include "upipe_ts_crc.h"
+#include "upipe_ts_psi_section.h"
 #include <upipe-framers/uref_mpga_flow.h>
 
 #include <stdlib.h>
@@ -914,10 +916,18 @@ static void upipe_ts_psig_program_build(struct upipe *upipe)
     uint8_t *es = pmt_get_es(buffer, j);
     pmt_set_length(buffer, es - buffer - PMT_HEADER_SIZE);
     uint16_t pmt_size = psi_get_length(buffer) + PSI_HEADER_SIZE;
-    psi_set_crc(buffer);
+    upipe_ts_psi_set_crc(buffer);
     ubuf_block_unmap(ubuf, 0);
     ubuf_block_resize(ubuf, 0, pmt_size);
 
+    if (program->pmt_section != NULL &&
+        upipe_ts_psi_section_equal(program->pmt_section, ubuf)) {
+        /* keep the version and repetition schedule of the current PMT */
+        ubuf_free(ubuf);
+        upipe_notice(upipe, "end PMT (unchanged)");
+        return;
+    }
+
     ubuf_free(program->pmt_section);
     program->pmt_section = ubuf;
     program->pmt_size = pmt_size;
@@ -1137,7 +1147,14 @@ static int upipe_ts_psig_program_set_version(struct upipe *upipe,
     upipe_dbg_va(upipe, "setting version to %u", version);
     upipe_ts_psig_program->pmt_version = version;
     upipe_ts_psig_program->pmt_version &= 0x1f;
+    /* do not let the PMT be considered unchanged */
+    struct ubuf *pmt_section = upipe_ts_psig_program->pmt_section;
+    upipe_ts_psig_program->pmt_section = NULL;
     upipe_ts_psig_program_build(upipe);
+    if (upipe_ts_psig_program->pmt_section == NULL)
+        upipe_ts_psig_program->pmt_section = pmt_section;
+    else
+        ubuf_free(pmt_section);
     upipe_ts_psig_program_build_flow_def(upipe);
     return UBASE_ERR_NONE;
 }
@@ -1370,10 +1387,11 @@ static void upipe_ts_psig_build(struct upipe *upipe)
     struct uchain *program_chain = &psig->programs;
     uint64_t total_size = 0;
 
-    struct uchain *section_chain;
-    while ((section_chain = ulist_pop(&psig->pat_sections)) != NULL)
-        ubuf_free(ubuf_from_uchain(section_chain));
+    struct uchain old_sections;
+    ulist_init(&old_sections);
+    upipe_ts_psi_sections_move(&old_sections, &psig->pat_sections);
 
+    struct uchain *section_chain;
     do {
         if (unlikely(nb_sections >= PSI_TABLE_MAX_SECTIONS)) {
             upipe_warn(upipe, "PAT too large");
@@ -1384,6 +1402,7 @@ static void upipe_ts_psig_build(struct upipe *upipe)
         struct ubuf *ubuf = ubuf_block_alloc(psig->ubuf_mgr,
                                              PSI_MAX_SIZE + PSI_HEADER_SIZE);
         if (unlikely(ubuf == NULL)) {
+            upipe_ts_psi_sections_clean(&old_sections);
             upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
             return;
         }
@@ -1450,11 +1469,21 @@ static void upipe_ts_psig_build(struct upipe *upipe)
         }
 
         psi_set_lastsection(buffer, nb_sections - 1);
-        psi_set_crc(buffer);
+        upipe_ts_psi_set_crc(buffer);
 
         ubuf_block_unmap(ubuf, 0);
     }
 
+    if (!ulist_empty(&old_sections) &&
+        upipe_ts_psi_sections_equal(&old_sections, &psig->pat_sections)) {
+        /* keep the version and repetition schedule of the current PAT */
+        upipe_ts_psi_sections_clean(&psig->pat_sections);
+        upipe_ts_psi_sections_move(&psig->pat_sections, &old_sections);
+        upipe_notice(upipe, "end PAT (unchanged)");
+        return;
+    }
+    upipe_ts_psi_sections_clean(&old_sections);
+
     psig->pat_cr_sys = 0;
     psig->pat_sent = false;
 
@@ -1630,7 +1659,16 @@ static int upipe_ts_psig_set_version(struct upipe *upipe,
     upipe_dbg_va(upipe, "setting version to %u", version);
     upipe_ts_psig->pat_version = version;
     upipe_ts_psig->pat_version &= 0x1f;
+    /* do not let the PAT be considered unchanged */
+    struct uchain pat_sections;
+    ulist_init(&pat_sections);
+    upipe_ts_psi_sections_move(&pat_sections, &upipe_ts_psig->pat_sections);
     upipe_ts_psig_build(upipe);
+    if (ulist_empty(&upipe_ts_psig->pat_sections))
+        upipe_ts_psi_sections_move(&upipe_ts_psig->pat_sections,
+                                   &pat_sections);
+    else
+        upipe_ts_psi_sections_clean(&pat_sections);
     upipe_ts_psig_build_flow_def(upipe);
     return UBASE_ERR_NONE;
 }
@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short Upipe helpers to compare and recycle generated PSI sections
+ * Tables are rebuilt whenever one of their inputs changes, but the result
+ * is often identical to the sections already in use. Keeping the previous
+ * sections in that case avoids bumping the version number and resetting
+ * the repetition schedule, which would force decoders to parse the table
+ * again.
+ */
+
+#ifndef _UPIPE_TS_UPIPE_TS_PSI_SECTION_H_
+/** @hidden */
+#define _UPIPE_TS_UPIPE_TS_PSI_SECTION_H_
+
+#include <upipe/ubase.h>
+#include <upipe/ulist.h>
+#include <upipe/ubuf.h>
+#include <upipe/ubuf_block.h>
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include <bitstream/mpeg/psi.h>
+
+/** @This checks whether two PSI sections carry the same content, regardless
+ * of the version number and CRC32 fields.
+ *
+ * @param ubuf1 pointer to the first section
+ * @param ubuf2 pointer to the second section
+ * @return true if both sections are identical
+ */
+static inline bool upipe_ts_psi_section_equal(struct ubuf *ubuf1,
+                                              struct ubuf *ubuf2)
+{
+    size_t size1, size2;
+    if (unlikely(!ubase_check(ubuf_block_size(ubuf1, &size1)) ||
+                 !ubase_check(ubuf_block_size(ubuf2, &size2)) ||
+                 size1 != size2 || size1 < PSI_HEADER_SIZE_SYNTAX1 +
+                                           PSI_CRC_SIZE))
+        return false;
+
+    const uint8_t *buffer1, *buffer2;
+    int read1 = size1, read2 = size2;
+    if (unlikely(!ubase_check(ubuf_block_read(ubuf1, 0, &read1, &buffer1))))
+        return false;
+    if (unlikely(!ubase_check(ubuf_block_read(ubuf2, 0, &read2, &buffer2)))) {
+        ubuf_block_unmap(ubuf1, 0);
+        return false;
+    }
+
+    /* the version number lies in bits 1 to 5 of the sixth octet */
+    bool equal = (size_t)read1 == size1 && (size_t)read2 == size2 &&
+                 !memcmp(buffer1, buffer2, 5) &&
+                 !((buffer1[5] ^ buffer2[5]) & ~0x3e) &&
+                 !memcmp(buffer1 + 6, buffer2 + 6,
+                         size1 - 6 - PSI_CRC_SIZE);
+    ubuf_block_unmap(ubuf1, 0);
+    ubuf_block_unmap(ubuf2, 0);
+    return equal;
+}
+
+/** @This checks whether two lists of PSI sections carry the same table,
+ * regardless of the version number and CRC32 fields.
+ *
+ * @param sections1 first list of sections
+ * @param sections2 second list of sections
+ * @return true if both tables are identical
+ */
+static inline bool upipe_ts_psi_sections_equal(struct uchain *sections1,
+                                               struct uchain *sections2)
+{
+    struct uchain *uchain1 = sections1->next, *uchain2 = sections2->next;
+    while (uchain1 != sections1 && uchain2 != sections2) {
+        if (!upipe_ts_psi_section_equal(ubuf_from_uchain(uchain1),
+                                        ubuf_from_uchain(uchain2)))
+            return false;
+        uchain1 = uchain1->next;
+        uchain2 = uchain2->next;
+    }
+    return uchain1 == sections1 && uchain2 == sections2;
+}
+
+/** @This moves all sections from a list to the end of another.
+ *
+ * @param to destination list
+ * @param from source list, empty in the end
+ */
+static inline void upipe_ts_psi_sections_move(struct uchain *to,
+                                              struct uchain *from)
+{
+    struct uchain *uchain;
+    while ((uchain = ulist_pop(from)) != NULL)
+        ulist_add(to, uchain);
+}
+
+/** @This releases all sections of a list.
+ *
+ * @param sections list of sections
+ */
+static inline void upipe_ts_psi_sections_clean(struct uchain *sections)
+{
+    struct uchain *uchain;
+    while ((uchain = ulist_pop(sections)) != NULL)
+        ubuf_free(ubuf_from_uchain(uchain));
+}
+
+#endif
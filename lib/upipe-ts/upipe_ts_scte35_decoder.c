@@ -174,8 +174,8 @@ static void upipe_ts_scte35d_input(struct upipe *upipe, struct uref *uref,
 
     const uint8_t *scte35;
     int size = -1;
-    if (unlikely(!ubase_check(uref_block_merge(uref, upipe_ts_scte35d->ubuf_mgr,
-                                               0, -1)) ||
+    if (unlikely(!ubase_check(uref_block_merge_read(uref, upipe_ts_scte35d->ubuf_mgr,
+                                                    0, -1)) ||
                  !ubase_check(uref_block_read(uref, 0, &size, &scte35)))) {
         upipe_warn(upipe, "invalid SCTE35 section received");
         uref_free(uref);
@@ -46,6 +46,7 @@
 #include <upipe-ts/upipe_ts_scte35_generator.h>
 #include <upipe-ts/upipe_ts_mux.h>
 #include <upipe-ts/uref_ts_scte35.h>
+#include "upipe_ts_crc.h"
 
 #include <stdlib.h>
 #include <stdbool.h>
@@ -257,7 +258,7 @@ static void upipe_ts_scte35g_input(struct upipe *upipe, struct uref *uref,
         scte35_set_desclength(scte35, 0);
         psi_set_length(scte35,
                 scte35_get_descl(scte35) + PSI_CRC_SIZE - scte35 - PSI_HEADER_SIZE);
-        psi_set_crc(scte35);
+        upipe_ts_psi_set_crc(scte35);
 
         uint16_t scte35_size = psi_get_length(scte35) + PSI_HEADER_SIZE;
         ubuf_block_unmap(ubuf, 0);
@@ -314,7 +315,7 @@ static void upipe_ts_scte35g_build_null(struct upipe *upipe)
     scte35_set_desclength(scte35, 0);
     psi_set_length(scte35,
             scte35_get_descl(scte35) + PSI_CRC_SIZE - scte35 - PSI_HEADER_SIZE);
-    psi_set_crc(scte35);
+    upipe_ts_psi_set_crc(scte35);
 
     uint16_t scte35_size = psi_get_length(scte35) + PSI_HEADER_SIZE;
     ubuf_block_unmap(ubuf, 0);
@@ -52,6 +52,8 @@
 #include <upipe-ts/upipe_ts_mux.h>
 #include <upipe-ts/uref_ts_flow.h>
 #include <upipe-ts/uref_ts_event.h>
+#include "upipe_ts_crc.h"
+#include "upipe_ts_psi_section.h"
 
 #include <stdlib.h>
 #include <stdbool.h>
@@ -78,6 +80,9 @@
 #define DEFAULT_ENCODING "ISO6937"
 /** native encoding */
 #define NATIVE_ENCODING "UTF-8"
+/** number of EIT schedule table IDs for the actual TS */
+#define EITS_NB_TABLES \
+    (EIT_TABLE_ID_SCHED_ACTUAL_LAST - EIT_TABLE_ID_SCHED_ACTUAL_FIRST + 1)
 /** define to get timing verbosity */
 #undef VERBOSE_TIMING
 
@@ -270,6 +275,8 @@ struct upipe_ts_sig_service {
     /** false if a new EITp/f was built but not sent yet */
     bool eit_sent;
 
+    /** EIT schedule version numbers, per table ID */
+    uint8_t eits_version[EITS_NB_TABLES];
     /** EIT schedule sections */
     struct uchain eits_sections;
     /** number of EIT schedule sections */
@@ -278,8 +285,8 @@ struct upipe_ts_sig_service {
     uint64_t eits_size;
     /** last EIT schedule cr_sys */
     uint64_t eits_cr_sys;
-    /** next EIT schedule section number */
-    uint16_t eits_next_section;
+    /** next EIT schedule section to send */
+    struct uchain *eits_next;
 
     /** public upipe structure */
     struct upipe upipe;
@@ -329,7 +336,9 @@ static struct upipe *upipe_ts_sig_service_alloc(struct upipe_mgr *mgr,
     service->eits_nb_sections = 0;
     service->eits_size = 0;
     service->eits_cr_sys = 0;
-    service->eits_next_section = 0;
+    service->eits_next = NULL;
+    for (int i = 0; i < EITS_NB_TABLES; i++)
+        service->eits_version[i] = 0;
 
     upipe_throw_ready(upipe);
     return upipe;
@@ -421,6 +430,37 @@ static int upipe_ts_sig_service_build_eit_event(struct upipe *upipe, uint64_t i,
     return UBASE_ERR_NONE;
 }
 
+/** @internal @This dispatches EIT schedule sections per table ID.
+ *
+ * @param upipe description structure of the pipe
+ * @param sections list of EIT schedule sections, empty in the end
+ * @param tables array of EITS_NB_TABLES lists of sections to initialize
+ */
+static void upipe_ts_sig_service_split_eits(struct upipe *upipe,
+                                            struct uchain *sections,
+                                            struct uchain *tables)
+{
+    for (int t = 0; t < EITS_NB_TABLES; t++)
+        ulist_init(&tables[t]);
+
+    struct uchain *section_chain;
+    while ((section_chain = ulist_pop(sections)) != NULL) {
+        struct ubuf *ubuf = ubuf_from_uchain(section_chain);
+        const uint8_t *buffer;
+        int size = 1;
+        if (unlikely(!ubase_check(ubuf_block_read(ubuf, 0, &size,
+                                                  &buffer)))) {
+            ubuf_free(ubuf);
+            upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+            continue;
+        }
+        uint8_t table_id = psi_get_tableid(buffer);
+        ubuf_block_unmap(ubuf, 0);
+        ulist_add(&tables[table_id - EIT_TABLE_ID_SCHED_ACTUAL_FIRST],
+                  section_chain);
+    }
+}
+
 /** @internal @This generates a new EIT PSI section.
  *
  * @param upipe description structure of the pipe
@@ -452,10 +492,12 @@ static void upipe_ts_sig_service_build_eit(struct upipe *upipe)
             ubuf_free(ubuf_from_uchain(section_chain));
         while ((section_chain = ulist_pop(&service->eits_sections)) != NULL)
             ubuf_free(ubuf_from_uchain(section_chain));
+        sig->eits_nb_sections -= service->eits_nb_sections;
         service->eit_nb_sections = 0;
         service->eit_size = 0;
         service->eits_nb_sections = 0;
         service->eits_size = 0;
+        service->eits_next = NULL;
         return;
     }
 
@@ -466,10 +508,11 @@ static void upipe_ts_sig_service_build_eit(struct upipe *upipe)
     uint64_t i = 0;
     uint64_t total_size = 0;
 
-    struct uchain *section_chain;
-    while ((section_chain = ulist_pop(&service->eit_sections)) != NULL)
-        ubuf_free(ubuf_from_uchain(section_chain));
+    struct uchain old_sections;
+    ulist_init(&old_sections);
+    upipe_ts_psi_sections_move(&old_sections, &service->eit_sections);
 
+    struct uchain *section_chain;
     do {
         if (unlikely(nb_sections >= PSI_TABLE_MAX_SECTIONS)) {
             upipe_warn(upipe, "EIT too large");
@@ -481,6 +524,7 @@ static void upipe_ts_sig_service_build_eit(struct upipe *upipe)
                 PSI_PRIVATE_MAX_SIZE + PSI_HEADER_SIZE);
         if (unlikely(ubuf == NULL)) {
             upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+            upipe_ts_psi_sections_clean(&old_sections);
             return;
         }
 
@@ -489,6 +533,7 @@ static void upipe_ts_sig_service_build_eit(struct upipe *upipe)
         if (!ubase_check(ubuf_block_write(ubuf, 0, &size, &buffer))) {
             ubuf_free(ubuf);
             upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+            upipe_ts_psi_sections_clean(&old_sections);
             return;
         }
 
@@ -551,22 +596,28 @@ static void upipe_ts_sig_service_build_eit(struct upipe *upipe)
 
         eit_set_segment_last_sec_number(buffer, nb_sections - 1);
         psi_set_lastsection(buffer, nb_sections - 1);
-        psi_set_crc(buffer);
+        upipe_ts_psi_set_crc(buffer);
 
         ubuf_block_unmap(ubuf, 0);
     }
 
-    service->eit_nb_sections = nb_sections;
-    service->eit_size = total_size;
-    service->eit_sent = false;
-
+    if (!ulist_empty(&old_sections) &&
+        upipe_ts_psi_sections_equal(&old_sections, &service->eit_sections)) {
+        /* keep the version of the current EITp/f */
+        upipe_ts_psi_sections_clean(&service->eit_sections);
+        upipe_ts_psi_sections_move(&service->eit_sections, &old_sections);
+    } else {
+        upipe_ts_psi_sections_clean(&old_sections);
+        service->eit_nb_sections = nb_sections;
+        service->eit_size = total_size;
+        service->eit_sent = false;
+    }
 
     /* EIT schedules */
     total_size = 0;
     nb_sections = 0;
 
-    while ((section_chain = ulist_pop(&service->eits_sections)) != NULL)
-        ubuf_free(ubuf_from_uchain(section_chain));
+    upipe_ts_psi_sections_move(&old_sections, &service->eits_sections);
     sig->eits_nb_sections -= service->eits_nb_sections;
 
     uint8_t table_id = EIT_TABLE_ID_SCHED_ACTUAL_FIRST;
@@ -589,6 +640,7 @@ static void upipe_ts_sig_service_build_eit(struct upipe *upipe)
                     PSI_PRIVATE_MAX_SIZE + PSI_HEADER_SIZE);
             if (unlikely(ubuf == NULL)) {
                 upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+                upipe_ts_psi_sections_clean(&old_sections);
                 return;
             }
 
@@ -597,6 +649,7 @@ static void upipe_ts_sig_service_build_eit(struct upipe *upipe)
             if (!ubase_check(ubuf_block_write(ubuf, 0, &size, &buffer))) {
                 ubuf_free(ubuf);
                 upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+                upipe_ts_psi_sections_clean(&old_sections);
                 return;
             }
 
@@ -608,7 +661,8 @@ static void upipe_ts_sig_service_build_eit(struct upipe *upipe)
             eit_set_tsid(buffer, tsid);
             eit_set_onid(buffer, onid);
             /* set last table id later */
-            psi_set_version(buffer, service->eit_version);
+            psi_set_version(buffer, service->eits_version[table_id -
+                                            EIT_TABLE_ID_SCHED_ACTUAL_FIRST]);
             psi_set_current(buffer);
             psi_set_section(buffer, nb_sections);
             /* assume max number of sections, and overwrite later for the last
@@ -663,17 +717,51 @@ static void upipe_ts_sig_service_build_eit(struct upipe *upipe)
             psi_set_lastsection(buffer, nb_sections - 1);
         }
         eit_set_last_table_id(buffer, table_id);
-        psi_set_crc(buffer);
 
         ubuf_block_unmap(ubuf, 0);
     }
 
+    /* only bump the version and compute the CRC of the tables that changed */
+    struct uchain tables[EITS_NB_TABLES], old_tables[EITS_NB_TABLES];
+    upipe_ts_sig_service_split_eits(upipe, &service->eits_sections, tables);
+    upipe_ts_sig_service_split_eits(upipe, &old_sections, old_tables);
+    for (int t = 0; t < EITS_NB_TABLES; t++) {
+        if (!ulist_empty(&old_tables[t]) &&
+            upipe_ts_psi_sections_equal(&old_tables[t], &tables[t])) {
+            upipe_ts_psi_sections_clean(&tables[t]);
+            upipe_ts_psi_sections_move(&service->eits_sections,
+                                       &old_tables[t]);
+            continue;
+        }
+
+        if (!ulist_empty(&old_tables[t])) {
+            service->eits_version[t]++;
+            service->eits_version[t] &= 0x1f;
+            upipe_ts_psi_sections_clean(&old_tables[t]);
+        }
+        ulist_foreach (&tables[t], section_chain) {
+            struct ubuf *ubuf = ubuf_from_uchain(section_chain);
+            uint8_t *buffer;
+            int size = -1;
+            if (!ubase_check(ubuf_block_write(ubuf, 0, &size, &buffer))) {
+                upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+                continue;
+            }
+
+            psi_set_version(buffer, service->eits_version[t]);
+            upipe_ts_psi_set_crc(buffer);
+
+            ubuf_block_unmap(ubuf, 0);
+        }
+        upipe_ts_psi_sections_move(&service->eits_sections, &tables[t]);
+    }
+
     service->eits_nb_sections =
         (table_id - EIT_TABLE_ID_SCHED_ACTUAL_FIRST) * PSI_TABLE_MAX_SECTIONS +
         nb_sections;
     sig->eits_nb_sections += service->eits_nb_sections;
     service->eits_size = total_size;
-    service->eits_next_section = 0;
+    service->eits_next = ulist_peek(&service->eits_sections);
 
     upipe_notice_va(upipe, "end EIT (%"PRIu8" sections p/f, %"PRIu16" sections schedule)",
                     service->eit_nb_sections, service->eits_nb_sections);
@@ -854,6 +942,7 @@ static void upipe_ts_sig_service_free(struct upipe *upipe)
         ubuf_free(ubuf_from_uchain(section_chain));
     while ((section_chain = ulist_pop(&service->eits_sections)) != NULL)
         ubuf_free(ubuf_from_uchain(section_chain));
+    sig->eits_nb_sections -= service->eits_nb_sections;
     uref_free(service->flow_def);
 
     upipe_ts_sig_build_sdt(upipe_ts_sig_to_upipe(sig));
@@ -1178,9 +1267,11 @@ static void upipe_ts_sig_build_nit(struct upipe *upipe)
     uref_ts_flow_get_nit_ts(sig->flow_def, &ts_number);
     uint64_t total_size = 0;
 
+    struct uchain old_sections;
+    ulist_init(&old_sections);
+    upipe_ts_psi_sections_move(&old_sections, &sig->nit_sections);
+
     struct uchain *section_chain;
-    while ((section_chain = ulist_pop(&sig->nit_sections)) != NULL)
-        ubuf_free(ubuf_from_uchain(section_chain));
 
     do {
         if (unlikely(nb_sections >= PSI_TABLE_MAX_SECTIONS)) {
@@ -1193,6 +1284,7 @@ static void upipe_ts_sig_build_nit(struct upipe *upipe)
                                              PSI_MAX_SIZE + PSI_HEADER_SIZE);
         if (unlikely(ubuf == NULL)) {
             upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+            upipe_ts_psi_sections_clean(&old_sections);
             return;
         }
 
@@ -1201,6 +1293,7 @@ static void upipe_ts_sig_build_nit(struct upipe *upipe)
         if (!ubase_check(ubuf_block_write(ubuf, 0, &size, &buffer))) {
             ubuf_free(ubuf);
             upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+            upipe_ts_psi_sections_clean(&old_sections);
             return;
         }
 
@@ -1257,6 +1350,7 @@ static void upipe_ts_sig_build_nit(struct upipe *upipe)
                 upipe_err_va(upipe, "NIT ts too large");
                 ubuf_free(ubuf);
                 upipe_throw_error(upipe, UBASE_ERR_INVALID);
+                upipe_ts_psi_sections_clean(&old_sections);
                 return;
             }
 
@@ -1295,11 +1389,21 @@ static void upipe_ts_sig_build_nit(struct upipe *upipe)
         }
 
         psi_set_lastsection(buffer, nb_sections - 1);
-        psi_set_crc(buffer);
+        upipe_ts_psi_set_crc(buffer);
 
         ubuf_block_unmap(ubuf, 0);
     }
 
+    if (!ulist_empty(&old_sections) &&
+        upipe_ts_psi_sections_equal(&old_sections, &sig->nit_sections)) {
+        /* keep the version of the current NIT */
+        upipe_ts_psi_sections_clean(&sig->nit_sections);
+        upipe_ts_psi_sections_move(&sig->nit_sections, &old_sections);
+        upipe_notice(upipe, "end NIT (unchanged)");
+        return;
+    }
+    upipe_ts_psi_sections_clean(&old_sections);
+
     upipe_notice_va(upipe, "end NIT (%u sections)", nb_sections);
 
     sig->nit_nb_sections = nb_sections;
@@ -1412,9 +1516,11 @@ static void upipe_ts_sig_build_sdt(struct upipe *upipe)
     struct uchain *service_chain = &sig->services;
     uint64_t total_size = 0;
 
+    struct uchain old_sections;
+    ulist_init(&old_sections);
+    upipe_ts_psi_sections_move(&old_sections, &sig->sdt_sections);
+
     struct uchain *section_chain;
-    while ((section_chain = ulist_pop(&sig->sdt_sections)) != NULL)
-        ubuf_free(ubuf_from_uchain(section_chain));
 
     do {
         if (unlikely(nb_sections >= PSI_TABLE_MAX_SECTIONS)) {
@@ -1427,6 +1533,7 @@ static void upipe_ts_sig_build_sdt(struct upipe *upipe)
                                              PSI_MAX_SIZE + PSI_HEADER_SIZE);
         if (unlikely(ubuf == NULL)) {
             upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+            upipe_ts_psi_sections_clean(&old_sections);
             return;
         }
 
@@ -1435,6 +1542,7 @@ static void upipe_ts_sig_build_sdt(struct upipe *upipe)
         if (!ubase_check(ubuf_block_write(ubuf, 0, &size, &buffer))) {
             ubuf_free(ubuf);
             upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+            upipe_ts_psi_sections_clean(&old_sections);
             return;
         }
 
@@ -1499,6 +1607,7 @@ static void upipe_ts_sig_build_sdt(struct upipe *upipe)
                 upipe_err_va(upipe, "SDT service too large");
                 ubuf_free(ubuf);
                 upipe_throw_error(upipe, UBASE_ERR_INVALID);
+                upipe_ts_psi_sections_clean(&old_sections);
                 return;
             }
 
@@ -1553,11 +1662,21 @@ static void upipe_ts_sig_build_sdt(struct upipe *upipe)
         }
 
         psi_set_lastsection(buffer, nb_sections - 1);
-        psi_set_crc(buffer);
+        upipe_ts_psi_set_crc(buffer);
 
         ubuf_block_unmap(ubuf, 0);
     }
 
+    if (!ulist_empty(&old_sections) &&
+        upipe_ts_psi_sections_equal(&old_sections, &sig->sdt_sections)) {
+        /* keep the version of the current SDT */
+        upipe_ts_psi_sections_clean(&sig->sdt_sections);
+        upipe_ts_psi_sections_move(&sig->sdt_sections, &old_sections);
+        upipe_notice(upipe, "end SDT (unchanged)");
+        return;
+    }
+    upipe_ts_psi_sections_clean(&old_sections);
+
     upipe_notice_va(upipe, "end SDT (%u sections)", nb_sections);
 
     sig->sdt_nb_sections = nb_sections;
@@ -1734,30 +1853,23 @@ static void upipe_ts_sig_send_eits(struct upipe *upipe, uint64_t cr_sys)
     ulist_foreach (&sig->services, uchain) {
         struct upipe_ts_sig_service *service_chain =
             upipe_ts_sig_service_from_uchain(uchain);
-        if (service_chain->eits_nb_sections &&
-            service_chain->eits_cr_sys < last_cr_sys)
+        if (service_chain->eits_next != NULL &&
+            service_chain->eits_cr_sys < last_cr_sys) {
             service = service_chain;
+            last_cr_sys = service->eits_cr_sys;
+        }
     }
 
     if (service == NULL)
         return; /* This should not happen */
 
-    assert(service->eits_next_section < service->eits_nb_sections);
-
-    uchain = ulist_at(&service->eits_sections, service->eits_next_section);
-    assert(uchain != NULL);
-
+    uchain = service->eits_next;
     output->cr_sys = cr_sys;
-    service->eits_next_section++;
-    if (service->eits_next_section >= service->eits_nb_sections) {
+    if (ulist_is_last(&service->eits_sections, uchain)) {
         service->eits_cr_sys = cr_sys;
-        service->eits_next_section = 0;
-    }
-    if (!service->eit_sent) {
-        service->eit_version++;
-        service->eit_version &= 0x1f;
-        service->eit_sent = true;
-    }
+        service->eits_next = ulist_peek(&service->eits_sections);
+    } else
+        service->eits_next = uchain->next;
 
     size_t eits_size = 0;
     ubuf_block_size(ubuf_from_uchain(uchain), &eits_size);
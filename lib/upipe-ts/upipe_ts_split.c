@@ -27,6 +27,7 @@
 #include <upipe/uprobe.h>
 #include <upipe/uref.h>
 #include <upipe/uref_block.h>
+#include <upipe/uref_clock.h>
 #include <upipe/ubuf.h>
 #include <upipe/upipe.h>
 #include <upipe/upipe_helper_upipe.h>
@@ -46,17 +47,30 @@
 
 #include <bitstream/mpeg/ts.h>
 
-/** we only accept blocks containing exactly one TS packet */
+/** we only accept blocks containing one or several whole TS packets */
 #define EXPECTED_FLOW_DEF "block.mpegts."
 /** maximum number of PIDs */
 #define MAX_PIDS 8192
+/** maximum number of packets in the fast channel change cache of a PID */
+#define FCC_MAX_PACKETS 16384
+
+/** @hidden */
+struct upipe_ts_split_sub;
 
 /** @internal @This keeps internal information about a PID. */
 struct upipe_ts_split_pid {
-    /** subs specific to that PID */
-    struct uchain subs;
+    /** outputs specific to that PID */
+    struct upipe_ts_split_sub **outputs;
+    /** number of outputs specific to that PID */
+    unsigned int nb_outputs;
     /** true if we asked for this PID */
     bool set;
+    /** packets since the last random access point */
+    struct uchain cache;
+    /** number of packets in the cache */
+    unsigned int nb_cached;
+    /** true if random access points are flagged on this PID */
+    bool rai;
 };
 
 /** @internal @This is the private context of a ts split pipe. */
@@ -71,6 +85,8 @@ struct upipe_ts_split {
 
     /** PIDs array */
     struct upipe_ts_split_pid pids[MAX_PIDS];
+    /** duration of the fast channel change cache, or 0 */
+    uint64_t fcc;
 
     /** manager to create output subpipes */
     struct upipe_mgr sub_mgr;
@@ -94,8 +110,6 @@ struct upipe_ts_split_sub {
     struct urefcount urefcount;
     /** structure for double-linked lists, all subs */
     struct uchain uchain;
-    /** structure for double-linked lists, PID */
-    struct uchain uchain_pid;
 
     /** pipe acting as output */
     struct upipe *output;
@@ -105,6 +119,8 @@ struct upipe_ts_split_sub {
     enum upipe_helper_output_state output_state;
     /** list of output requests */
     struct uchain request_list;
+    /** true if the cached packets remain to be replayed */
+    bool replay;
 
     /** public upipe structure */
     struct upipe upipe;
@@ -118,8 +134,6 @@ UPIPE_HELPER_OUTPUT(upipe_ts_split_sub, output, flow_def, output_state, request_
 UPIPE_HELPER_SUBPIPE(upipe_ts_split, upipe_ts_split_sub, sub, sub_mgr,
                      subs, uchain)
 
-UBASE_FROM_TO(upipe_ts_split_sub, uchain, uchain_pid, uchain_pid)
-
 /** @hidden */
 static void upipe_ts_split_pid_set(struct upipe *upipe, uint16_t pid,
                                    struct upipe_ts_split_sub *output);
@@ -148,10 +162,10 @@ static struct upipe *upipe_ts_split_sub_alloc(struct upipe_mgr *mgr,
     struct upipe_ts_split_sub *upipe_ts_split_sub =
         upipe_ts_split_sub_from_upipe(upipe);
     upipe_ts_split_sub_init_urefcount(upipe);
-    uchain_init(&upipe_ts_split_sub->uchain_pid);
     upipe_ts_split_sub_init_output(upipe);
     upipe_ts_split_sub_init_sub(upipe);
     upipe_ts_split_sub_store_flow_def(upipe, flow_def);
+    upipe_ts_split_sub->replay = true;
 
     struct upipe_ts_split *upipe_ts_split =
         upipe_ts_split_from_sub_mgr(upipe->mgr);
@@ -258,9 +272,14 @@ static struct upipe *upipe_ts_split_alloc(struct upipe_mgr *mgr,
 
     int i;
     for (i = 0; i < MAX_PIDS; i++) {
-        ulist_init(&upipe_ts_split->pids[i].subs);
+        upipe_ts_split->pids[i].outputs = NULL;
+        upipe_ts_split->pids[i].nb_outputs = 0;
         upipe_ts_split->pids[i].set = false;
+        ulist_init(&upipe_ts_split->pids[i].cache);
+        upipe_ts_split->pids[i].nb_cached = 0;
+        upipe_ts_split->pids[i].rai = false;
     }
+    upipe_ts_split->fcc = 0;
     upipe_throw_ready(upipe);
     return upipe;
 }
@@ -275,7 +294,7 @@ static void upipe_ts_split_pid_check(struct upipe *upipe, uint16_t pid)
 {
     assert(pid < MAX_PIDS);
     struct upipe_ts_split *upipe_ts_split = upipe_ts_split_from_upipe(upipe);
-    if (!ulist_empty(&upipe_ts_split->pids[pid].subs)) {
+    if (upipe_ts_split->pids[pid].nb_outputs) {
         if (!upipe_ts_split->pids[pid].set) {
             upipe_ts_split->pids[pid].set = true;
             upipe_dbg_va(upipe, "throw ts split add pid %"PRIu16, pid);
@@ -303,8 +322,15 @@ static void upipe_ts_split_pid_set(struct upipe *upipe, uint16_t pid,
 {
     assert(pid < MAX_PIDS);
     struct upipe_ts_split *upipe_ts_split = upipe_ts_split_from_upipe(upipe);
-    ulist_add(&upipe_ts_split->pids[pid].subs,
-              upipe_ts_split_sub_to_uchain_pid(output));
+    struct upipe_ts_split_pid *split_pid = &upipe_ts_split->pids[pid];
+    struct upipe_ts_split_sub **outputs = realloc(split_pid->outputs,
+            (split_pid->nb_outputs + 1) * sizeof(struct upipe_ts_split_sub *));
+    if (unlikely(outputs == NULL)) {
+        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+        return;
+    }
+    outputs[split_pid->nb_outputs++] = output;
+    split_pid->outputs = outputs;
     upipe_ts_split_pid_check(upipe, pid);
 }
 
@@ -319,16 +345,186 @@ static void upipe_ts_split_pid_unset(struct upipe *upipe, uint16_t pid,
 {
     assert(pid < MAX_PIDS);
     struct upipe_ts_split *upipe_ts_split = upipe_ts_split_from_upipe(upipe);
-    struct uchain *uchain, *uchain_tmp;
-    ulist_delete_foreach (&upipe_ts_split->pids[pid].subs, uchain, uchain_tmp) {
-        if (output == upipe_ts_split_sub_from_uchain_pid(uchain)) {
-            ulist_delete(uchain);
-        }
+    struct upipe_ts_split_pid *split_pid = &upipe_ts_split->pids[pid];
+    unsigned int j = 0;
+    for (unsigned int i = 0; i < split_pid->nb_outputs; i++)
+        if (split_pid->outputs[i] != output)
+            split_pid->outputs[j++] = split_pid->outputs[i];
+    split_pid->nb_outputs = j;
+    if (!j) {
+        free(split_pid->outputs);
+        split_pid->outputs = NULL;
     }
     upipe_ts_split_pid_check(upipe, pid);
 }
 
-/** @internal @This demuxes a TS packet to the appropriate output(s).
+/** @internal @This flushes the fast channel change cache of a PID.
+ *
+ * @param split_pid PID structure
+ */
+static void upipe_ts_split_pid_flush(struct upipe_ts_split_pid *split_pid)
+{
+    struct uchain *uchain;
+    while ((uchain = ulist_pop(&split_pid->cache)) != NULL)
+        uref_free(uref_from_uchain(uchain));
+    split_pid->nb_cached = 0;
+}
+
+/** @internal @This keeps a TS packet in the fast channel change cache of its
+ * PID. The cache starts again on each random access point, or on each unit
+ * start if the PID never flagged a random access point, and is flushed if
+ * it grows beyond its duration.
+ *
+ * @param upipe description structure of the pipe
+ * @param pid PID of the packet
+ * @param uref uref structure containing the packet
+ */
+static void upipe_ts_split_pid_cache(struct upipe *upipe, uint16_t pid,
+                                     struct uref *uref)
+{
+    struct upipe_ts_split *upipe_ts_split = upipe_ts_split_from_upipe(upipe);
+    struct upipe_ts_split_pid *split_pid = &upipe_ts_split->pids[pid];
+
+    uint8_t buffer[TS_HEADER_SIZE_AF];
+    const uint8_t *ts_header = uref_block_peek(uref, 0, TS_HEADER_SIZE_AF,
+                                               buffer);
+    if (unlikely(ts_header == NULL))
+        return;
+    bool unitstart = ts_get_unitstart(ts_header);
+    bool rai = ts_has_adaptation(ts_header) && ts_get_adaptation(ts_header) &&
+               tsaf_has_randomaccess(ts_header);
+    uref_block_peek_unmap(uref, 0, buffer, ts_header);
+
+    if (rai)
+        split_pid->rai = true;
+    if (split_pid->rai ? rai : unitstart)
+        upipe_ts_split_pid_flush(split_pid);
+    else if (ulist_empty(&split_pid->cache))
+        /* no starting point yet */
+        return;
+
+    if (split_pid->nb_cached) {
+        uint64_t first_date, date;
+        struct uref *first = uref_from_uchain(ulist_peek(&split_pid->cache));
+        if (split_pid->nb_cached >= FCC_MAX_PACKETS ||
+            (ubase_check(uref_clock_get_cr_sys(first, &first_date)) &&
+             ubase_check(uref_clock_get_cr_sys(uref, &date)) &&
+             date > first_date + upipe_ts_split->fcc)) {
+            /* too long since the last random access point */
+            upipe_ts_split_pid_flush(split_pid);
+            return;
+        }
+    }
+
+    struct uref *cached = uref_dup(uref);
+    if (unlikely(cached == NULL)) {
+        upipe_ts_split_pid_flush(split_pid);
+        return;
+    }
+    ulist_add(&split_pid->cache, uref_to_uchain(cached));
+    split_pid->nb_cached++;
+}
+
+/** @internal @This replays the cached packets of a PID, but the last one
+ * which is being dispatched, to a new output.
+ *
+ * @param upipe description structure of the pipe
+ * @param pid PID of the output
+ * @param sub output sub-structure
+ * @param upump_p reference to pump that generated the buffer
+ */
+static void upipe_ts_split_pid_replay(struct upipe *upipe, uint16_t pid,
+                                      struct upipe_ts_split_sub *sub,
+                                      struct upump **upump_p)
+{
+    struct upipe_ts_split *upipe_ts_split = upipe_ts_split_from_upipe(upipe);
+    struct upipe_ts_split_pid *split_pid = &upipe_ts_split->pids[pid];
+    struct upipe *output = upipe_ts_split_sub_to_upipe(sub);
+    sub->replay = false;
+    if (split_pid->nb_cached <= 1)
+        return;
+
+    upipe_verbose_va(output, "replaying %u cached packets",
+                     split_pid->nb_cached - 1);
+    struct uchain *uchain;
+    ulist_foreach(&split_pid->cache, uchain) {
+        if (ulist_is_last(&split_pid->cache, uchain))
+            break;
+        struct uref *uref = uref_dup(uref_from_uchain(uchain));
+        if (unlikely(uref == NULL)) {
+            upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+            return;
+        }
+        upipe_ts_split_sub_output(output, uref, upump_p);
+    }
+}
+
+/** @internal @This outputs a TS packet to the outputs of its PID.
+ *
+ * @param upipe description structure of the pipe
+ * @param pid PID of the packet
+ * @param uref uref structure containing the packet
+ * @param upump_p reference to pump that generated the buffer
+ * @return false in case of allocation error
+ */
+static bool upipe_ts_split_dispatch(struct upipe *upipe, uint16_t pid,
+                                    struct uref *uref, struct upump **upump_p)
+{
+    struct upipe_ts_split *upipe_ts_split = upipe_ts_split_from_upipe(upipe);
+    struct upipe_ts_split_pid *split_pid = &upipe_ts_split->pids[pid];
+
+    if (unlikely(upipe_ts_split->fcc))
+        upipe_ts_split_pid_cache(upipe, pid, uref);
+
+    /* the table is read again at each step, as outputs may go away */
+    for (unsigned int i = 0; i < split_pid->nb_outputs; i++) {
+        if (unlikely(split_pid->outputs[i]->replay))
+            upipe_ts_split_pid_replay(upipe, pid, split_pid->outputs[i],
+                                      upump_p);
+        if (unlikely(i >= split_pid->nb_outputs))
+            break;
+        struct upipe *output =
+            upipe_ts_split_sub_to_upipe(split_pid->outputs[i]);
+        if (likely(i + 1 == split_pid->nb_outputs)) {
+            upipe_ts_split_sub_output(output, uref, upump_p);
+            return true;
+        }
+
+        struct uref *new_uref = uref_dup(uref);
+        if (unlikely(new_uref == NULL)) {
+            uref_free(uref);
+            upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+            return false;
+        }
+        upipe_ts_split_sub_output(output, new_uref, upump_p);
+    }
+    uref_free(uref);
+    return true;
+}
+
+/** @internal @This returns the PID of a TS packet.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref uref structure
+ * @param offset offset of the packet in the uref
+ * @param pid_p filled in with the PID
+ * @return an error code
+ */
+static int upipe_ts_split_get_pid(struct upipe *upipe, struct uref *uref,
+                                  int offset, uint16_t *pid_p)
+{
+    uint8_t buffer[TS_HEADER_SIZE];
+    const uint8_t *ts_header = uref_block_peek(uref, offset, TS_HEADER_SIZE,
+                                               buffer);
+    if (unlikely(ts_header == NULL))
+        return UBASE_ERR_ALLOC;
+    *pid_p = ts_get_pid(ts_header);
+    return uref_block_peek_unmap(uref, offset, buffer, ts_header);
+}
+
+/** @internal @This demuxes TS packets to the appropriate output(s). Urefs
+ * containing several packets, such as datagrams, are split here, and only
+ * the packets of the selected PIDs are allocated a new uref.
  *
  * @param upipe description structure of the pipe
  * @param uref uref structure
@@ -338,40 +534,50 @@ static void upipe_ts_split_input(struct upipe *upipe, struct uref *uref,
                                  struct upump **upump_p)
 {
     struct upipe_ts_split *upipe_ts_split = upipe_ts_split_from_upipe(upipe);
-    uint8_t buffer[TS_HEADER_SIZE];
-    const uint8_t *ts_header = uref_block_peek(uref, 0, TS_HEADER_SIZE,
-                                               buffer);
-    if (unlikely(ts_header == NULL)) {
+    size_t size;
+    uint16_t pid;
+    if (unlikely(!ubase_check(uref_block_size(uref, &size)))) {
         uref_free(uref);
         upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
         return;
     }
-    uint16_t pid = ts_get_pid(ts_header);
-    UBASE_FATAL(upipe, uref_block_peek_unmap(uref, 0, buffer, ts_header))
 
-    struct uchain *uchain;
-    ulist_foreach (&upipe_ts_split->pids[pid].subs, uchain) {
-        struct upipe_ts_split_sub *output =
-                upipe_ts_split_sub_from_uchain_pid(uchain);
-        if (likely(uchain->next == NULL)) {
-            upipe_ts_split_sub_output(upipe_ts_split_sub_to_upipe(output),
-                                      uref, upump_p);
-            uref = NULL;
-        } else {
-            struct uref *new_uref = uref_dup(uref);
-            if (likely(new_uref != NULL))
-                upipe_ts_split_sub_output(
-                        upipe_ts_split_sub_to_upipe(output),
-                        new_uref, upump_p);
-            else {
-                uref_free(uref);
-                upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
-                return;
-            }
+    if (likely(size <= TS_SIZE)) {
+        if (unlikely(!ubase_check(upipe_ts_split_get_pid(upipe, uref, 0,
+                                                         &pid)))) {
+            uref_free(uref);
+            upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+            return;
         }
+        upipe_ts_split_dispatch(upipe, pid, uref, upump_p);
+        return;
     }
-    if (uref != NULL)
-        uref_free(uref);
+
+    if (unlikely(size % TS_SIZE))
+        upipe_warn_va(upipe, "dropping %zu trailing octets", size % TS_SIZE);
+
+    for (int offset = 0; offset + TS_SIZE <= size; offset += TS_SIZE) {
+        if (unlikely(!ubase_check(upipe_ts_split_get_pid(upipe, uref, offset,
+                                                         &pid)))) {
+            uref_free(uref);
+            upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+            return;
+        }
+        if (!upipe_ts_split->pids[pid].nb_outputs && !upipe_ts_split->fcc)
+            continue;
+
+        struct uref *packet = uref_block_splice(uref, offset, TS_SIZE);
+        if (unlikely(packet == NULL)) {
+            uref_free(uref);
+            upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+            return;
+        }
+        if (unlikely(!upipe_ts_split_dispatch(upipe, pid, packet, upump_p))) {
+            uref_free(uref);
+            return;
+        }
+    }
+    uref_free(uref);
 }
 
 /** @internal @This sets the input flow definition.
@@ -388,6 +594,36 @@ static int upipe_ts_split_set_flow_def(struct upipe *upipe,
     return uref_flow_match_def(flow_def, EXPECTED_FLOW_DEF);
 }
 
+/** @internal @This returns the duration of the fast channel change cache.
+ *
+ * @param upipe description structure of the pipe
+ * @param duration_p filled in with the duration
+ * @return an error code
+ */
+static int _upipe_ts_split_get_fcc(struct upipe *upipe, uint64_t *duration_p)
+{
+    struct upipe_ts_split *upipe_ts_split = upipe_ts_split_from_upipe(upipe);
+    assert(duration_p != NULL);
+    *duration_p = upipe_ts_split->fcc;
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This sets the duration of the fast channel change cache.
+ *
+ * @param upipe description structure of the pipe
+ * @param duration duration, or 0 to disable the cache
+ * @return an error code
+ */
+static int _upipe_ts_split_set_fcc(struct upipe *upipe, uint64_t duration)
+{
+    struct upipe_ts_split *upipe_ts_split = upipe_ts_split_from_upipe(upipe);
+    upipe_ts_split->fcc = duration;
+    if (!duration)
+        for (int i = 0; i < MAX_PIDS; i++)
+            upipe_ts_split_pid_flush(&upipe_ts_split->pids[i]);
+    return UBASE_ERR_NONE;
+}
+
 /** @internal @This processes control commands.
  *
  * @param upipe description structure of the pipe
@@ -413,6 +649,16 @@ static int upipe_ts_split_control(struct upipe *upipe,
             struct uref *flow_def = va_arg(args, struct uref *);
             return upipe_ts_split_set_flow_def(upipe, flow_def);
         }
+        case UPIPE_TS_SPLIT_GET_FCC: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_TS_SPLIT_SIGNATURE)
+            uint64_t *duration_p = va_arg(args, uint64_t *);
+            return _upipe_ts_split_get_fcc(upipe, duration_p);
+        }
+        case UPIPE_TS_SPLIT_SET_FCC: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_TS_SPLIT_SIGNATURE)
+            uint64_t duration = va_arg(args, uint64_t);
+            return _upipe_ts_split_set_fcc(upipe, duration);
+        }
 
         default:
             return UBASE_ERR_UNHANDLED;
@@ -430,6 +676,10 @@ static void upipe_ts_split_free(struct urefcount *urefcount_real)
     struct upipe *upipe = upipe_ts_split_to_upipe(upipe_ts_split);
     upipe_throw_dead(upipe);
     upipe_ts_split_clean_sub_subs(upipe);
+    for (int i = 0; i < MAX_PIDS; i++) {
+        free(upipe_ts_split->pids[i].outputs);
+        upipe_ts_split_pid_flush(&upipe_ts_split->pids[i]);
+    }
     urefcount_clean(urefcount_real);
     upipe_ts_split_clean_urefcount(upipe);
     upipe_ts_split_free_void(upipe);
@@ -0,0 +1,1044 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short Upipe module splitting a multi-program TS into single-program TS
+ *
+ * The PAT and the PMTs are assembled and parsed once, whatever the number of
+ * outputs, and packets are dispatched to the outputs with @ref uref_dup, so
+ * that the payload is never copied. Only the PAT is rewritten, once per
+ * output and per input PAT.
+ */
+
+#include <upipe/ubase.h>
+#include <upipe/ulist.h>
+#include <upipe/uprobe.h>
+#include <upipe/uref.h>
+#include <upipe/uref_block.h>
+#include <upipe/uref_flow.h>
+#include <upipe/ubuf.h>
+#include <upipe/ubuf_block.h>
+#include <upipe/upipe.h>
+#include <upipe/upipe_helper_upipe.h>
+#include <upipe/upipe_helper_urefcount.h>
+#include <upipe/upipe_helper_void.h>
+#include <upipe/upipe_helper_flow.h>
+#include <upipe/upipe_helper_output.h>
+#include <upipe/upipe_helper_subpipe.h>
+#include <upipe-ts/upipe_ts_split.h>
+#include <upipe-ts/upipe_ts_spts_split.h>
+
+#include "upipe_ts_crc.h"
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdarg.h>
+#include <string.h>
+#include <assert.h>
+
+#include <bitstream/mpeg/ts.h>
+#include <bitstream/mpeg/psi.h>
+
+/** we only accept blocks containing one or several whole TS packets */
+#define EXPECTED_FLOW_DEF "block.mpegts."
+/** maximum number of PIDs */
+#define MAX_PIDS 8192
+/** size of the buffer assembling a PAT or PMT section */
+#define SECTION_SIZE (PSI_MAX_SIZE + PSI_HEADER_SIZE)
+/** PCR PID of programs without PCR */
+#define NO_PCR_PID 8191
+
+/** @hidden */
+struct upipe_ts_spts_split_sub;
+
+/** @internal @This keeps internal information about a PID. */
+struct upipe_ts_spts_split_pid {
+    /** outputs carrying that PID */
+    struct upipe_ts_spts_split_sub **outputs;
+    /** number of outputs carrying that PID */
+    unsigned int nb_outputs;
+    /** number of outputs needing the sections of that PID */
+    unsigned int nb_psi;
+    /** true if we asked for this PID */
+    bool set;
+    /** buffer assembling a section, allocated on first use */
+    uint8_t *section;
+    /** octets in the section being assembled, or -1 if waiting for a unit
+     * start */
+    int section_used;
+    /** last continuity counter, or -1 */
+    int cc;
+};
+
+/** @internal @This is the private context of a ts_spts_split pipe. */
+struct upipe_ts_spts_split {
+    /** real refcount management structure */
+    struct urefcount urefcount_real;
+    /** refcount management structure exported to the public structure */
+    struct urefcount urefcount;
+
+    /** list of output subpipes */
+    struct uchain subs;
+
+    /** PIDs array */
+    struct upipe_ts_spts_split_pid pids[MAX_PIDS];
+
+    /** manager to create output subpipes */
+    struct upipe_mgr sub_mgr;
+
+    /** public upipe structure */
+    struct upipe upipe;
+};
+
+UPIPE_HELPER_UPIPE(upipe_ts_spts_split, upipe, UPIPE_TS_SPTS_SPLIT_SIGNATURE)
+UPIPE_HELPER_UREFCOUNT(upipe_ts_spts_split, urefcount,
+                       upipe_ts_spts_split_no_input)
+UPIPE_HELPER_VOID(upipe_ts_spts_split)
+
+UBASE_FROM_TO(upipe_ts_spts_split, urefcount, urefcount_real, urefcount_real)
+
+/** @hidden */
+static void upipe_ts_spts_split_free(struct urefcount *urefcount_real);
+
+/** @internal @This is the private context of an output of a ts_spts_split
+ * pipe. */
+struct upipe_ts_spts_split_sub {
+    /** refcount management structure */
+    struct urefcount urefcount;
+    /** structure for double-linked lists, all subs */
+    struct uchain uchain;
+
+    /** pipe acting as output */
+    struct upipe *output;
+    /** flow definition packet on this output */
+    struct uref *flow_def;
+    /** output state */
+    enum upipe_helper_output_state output_state;
+    /** list of output requests */
+    struct uchain request_list;
+
+    /** program number */
+    uint16_t program;
+    /** PMT PID, or MAX_PIDS if the program is not in the PAT */
+    uint16_t pmt_pid;
+    /** bitmap of the PIDs carried on this output */
+    uint8_t pids[MAX_PIDS / 8];
+    /** true if pmt_crc is valid */
+    bool pmt_crc_valid;
+    /** CRC of the last PMT, to skip unchanged PMTs */
+    uint32_t pmt_crc;
+    /** version of the rewritten PAT */
+    uint8_t pat_version;
+    /** continuity counter of the rewritten PAT */
+    uint8_t pat_cc;
+
+    /** public upipe structure */
+    struct upipe upipe;
+};
+
+UPIPE_HELPER_UPIPE(upipe_ts_spts_split_sub, upipe,
+                   UPIPE_TS_SPTS_SPLIT_OUTPUT_SIGNATURE)
+UPIPE_HELPER_UREFCOUNT(upipe_ts_spts_split_sub, urefcount,
+                       upipe_ts_spts_split_sub_free)
+UPIPE_HELPER_FLOW(upipe_ts_spts_split_sub, NULL)
+UPIPE_HELPER_OUTPUT(upipe_ts_spts_split_sub, output, flow_def, output_state,
+                    request_list)
+
+UPIPE_HELPER_SUBPIPE(upipe_ts_spts_split, upipe_ts_spts_split_sub, sub,
+                     sub_mgr, subs, uchain)
+
+/** @internal @This checks the status of the PID, and sends the split_set_pid
+ * or split_unset_pid event if it has not already been sent.
+ *
+ * @param upipe description structure of the pipe
+ * @param pid PID to check
+ */
+static void upipe_ts_spts_split_pid_check(struct upipe *upipe, uint16_t pid)
+{
+    assert(pid < MAX_PIDS);
+    struct upipe_ts_spts_split *upipe_ts_spts_split =
+        upipe_ts_spts_split_from_upipe(upipe);
+    struct upipe_ts_spts_split_pid *split_pid =
+        &upipe_ts_spts_split->pids[pid];
+    if (split_pid->nb_outputs || split_pid->nb_psi) {
+        if (!split_pid->set) {
+            split_pid->set = true;
+            upipe_dbg_va(upipe, "throw ts split add pid %"PRIu16, pid);
+            upipe_throw(upipe, UPROBE_TS_SPLIT_ADD_PID,
+                        UPIPE_TS_SPLIT_SIGNATURE, (unsigned int)pid);
+        }
+    } else {
+        if (split_pid->set) {
+            split_pid->set = false;
+            upipe_dbg_va(upipe, "throw ts split del pid %"PRIu16, pid);
+            upipe_throw(upipe, UPROBE_TS_SPLIT_DEL_PID,
+                        UPIPE_TS_SPLIT_SIGNATURE, (unsigned int)pid);
+        }
+    }
+}
+
+/** @internal @This adds an output to a given PID.
+ *
+ * @param upipe description structure of the pipe
+ * @param pid PID
+ * @param output output sub-structure
+ */
+static void upipe_ts_spts_split_pid_set(struct upipe *upipe, uint16_t pid,
+                                        struct upipe_ts_spts_split_sub *output)
+{
+    assert(pid < MAX_PIDS);
+    struct upipe_ts_spts_split *upipe_ts_spts_split =
+        upipe_ts_spts_split_from_upipe(upipe);
+    struct upipe_ts_spts_split_pid *split_pid =
+        &upipe_ts_spts_split->pids[pid];
+    struct upipe_ts_spts_split_sub **outputs = realloc(split_pid->outputs,
+            (split_pid->nb_outputs + 1) *
+            sizeof(struct upipe_ts_spts_split_sub *));
+    if (unlikely(outputs == NULL)) {
+        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+        return;
+    }
+    outputs[split_pid->nb_outputs++] = output;
+    split_pid->outputs = outputs;
+    upipe_ts_spts_split_pid_check(upipe, pid);
+}
+
+/** @internal @This removes an output from a given PID.
+ *
+ * @param upipe description structure of the pipe
+ * @param pid PID
+ * @param output output sub-structure
+ */
+static void upipe_ts_spts_split_pid_unset(struct upipe *upipe, uint16_t pid,
+                                        struct upipe_ts_spts_split_sub *output)
+{
+    assert(pid < MAX_PIDS);
+    struct upipe_ts_spts_split *upipe_ts_spts_split =
+        upipe_ts_spts_split_from_upipe(upipe);
+    struct upipe_ts_spts_split_pid *split_pid =
+        &upipe_ts_spts_split->pids[pid];
+    unsigned int j = 0;
+    for (unsigned int i = 0; i < split_pid->nb_outputs; i++)
+        if (split_pid->outputs[i] != output)
+            split_pid->outputs[j++] = split_pid->outputs[i];
+    split_pid->nb_outputs = j;
+    if (!j) {
+        free(split_pid->outputs);
+        split_pid->outputs = NULL;
+    }
+    upipe_ts_spts_split_pid_check(upipe, pid);
+}
+
+/** @internal @This registers an output needing the sections of a PID. The
+ * section buffer is only released with the pipe, as it may be in use when
+ * the last output goes away.
+ *
+ * @param upipe description structure of the pipe
+ * @param pid PID
+ */
+static void upipe_ts_spts_split_psi_use(struct upipe *upipe, uint16_t pid)
+{
+    assert(pid < MAX_PIDS);
+    struct upipe_ts_spts_split *upipe_ts_spts_split =
+        upipe_ts_spts_split_from_upipe(upipe);
+    struct upipe_ts_spts_split_pid *split_pid =
+        &upipe_ts_spts_split->pids[pid];
+    if (split_pid->section == NULL) {
+        split_pid->section = malloc(SECTION_SIZE);
+        if (unlikely(split_pid->section == NULL)) {
+            upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+            return;
+        }
+        split_pid->section_used = -1;
+        split_pid->cc = -1;
+    }
+    split_pid->nb_psi++;
+    upipe_ts_spts_split_pid_check(upipe, pid);
+}
+
+/** @internal @This unregisters an output needing the sections of a PID.
+ *
+ * @param upipe description structure of the pipe
+ * @param pid PID
+ */
+static void upipe_ts_spts_split_psi_release(struct upipe *upipe, uint16_t pid)
+{
+    assert(pid < MAX_PIDS);
+    struct upipe_ts_spts_split *upipe_ts_spts_split =
+        upipe_ts_spts_split_from_upipe(upipe);
+    struct upipe_ts_spts_split_pid *split_pid =
+        &upipe_ts_spts_split->pids[pid];
+    if (split_pid->nb_psi && !--split_pid->nb_psi) {
+        split_pid->section_used = -1;
+        split_pid->cc = -1;
+    }
+    upipe_ts_spts_split_pid_check(upipe, pid);
+}
+
+/** @internal @This changes the set of PIDs carried by an output.
+ *
+ * @param upipe description structure of the subpipe
+ * @param pids bitmap of the new PIDs
+ */
+static void upipe_ts_spts_split_sub_update(struct upipe *upipe,
+                                           const uint8_t *pids)
+{
+    struct upipe_ts_spts_split_sub *sub =
+        upipe_ts_spts_split_sub_from_upipe(upipe);
+    struct upipe *super = upipe_ts_spts_split_to_upipe(
+            upipe_ts_spts_split_from_sub_mgr(upipe->mgr));
+
+    for (unsigned int i = 0; i < MAX_PIDS / 8; i++) {
+        uint8_t diff = sub->pids[i] ^ pids[i];
+        sub->pids[i] = pids[i];
+        for (unsigned int bit = 0; diff; bit++, diff >>= 1) {
+            if (!(diff & 1))
+                continue;
+            uint16_t pid = i * 8 + bit;
+            if (pids[i] & (1 << bit))
+                upipe_ts_spts_split_pid_set(super, pid, sub);
+            else
+                upipe_ts_spts_split_pid_unset(super, pid, sub);
+        }
+    }
+}
+
+/** @internal @This sets the PMT PID of the program of an output. The
+ * elementary streams are dropped until the new PMT is received.
+ *
+ * @param upipe description structure of the subpipe
+ * @param pmt_pid PMT PID, or MAX_PIDS if the program is not in the PAT
+ */
+static void upipe_ts_spts_split_sub_set_pmt_pid(struct upipe *upipe,
+                                                uint16_t pmt_pid)
+{
+    struct upipe_ts_spts_split_sub *sub =
+        upipe_ts_spts_split_sub_from_upipe(upipe);
+    struct upipe *super = upipe_ts_spts_split_to_upipe(
+            upipe_ts_spts_split_from_sub_mgr(upipe->mgr));
+    if (sub->pmt_pid == pmt_pid)
+        return;
+
+    uint8_t pids[MAX_PIDS / 8];
+    memset(pids, 0, sizeof(pids));
+    if (pmt_pid < MAX_PIDS)
+        pids[pmt_pid / 8] |= 1 << (pmt_pid % 8);
+
+    if (sub->pmt_pid < MAX_PIDS)
+        upipe_ts_spts_split_psi_release(super, sub->pmt_pid);
+    sub->pmt_pid = pmt_pid;
+    if (pmt_pid < MAX_PIDS)
+        upipe_ts_spts_split_psi_use(super, pmt_pid);
+    sub->pmt_crc_valid = false;
+    sub->pat_version = (sub->pat_version + 1) & 0x1f;
+    upipe_ts_spts_split_sub_update(upipe, pids);
+}
+
+/** @internal @This outputs a single-program PAT on an output.
+ *
+ * @param upipe description structure of the subpipe
+ * @param tsid transport stream ID of the input PAT
+ * @param uref uref structure containing the input PAT packet
+ * @param upump_p reference to pump that generated the buffer
+ */
+static void upipe_ts_spts_split_sub_output_pat(struct upipe *upipe,
+                                               uint16_t tsid,
+                                               struct uref *uref,
+                                               struct upump **upump_p)
+{
+    struct upipe_ts_spts_split_sub *sub =
+        upipe_ts_spts_split_sub_from_upipe(upipe);
+    struct ubuf *ubuf = ubuf_block_alloc(uref->ubuf->mgr, TS_SIZE);
+    struct uref *pat = uref_dup(uref);
+    if (unlikely(ubuf == NULL || pat == NULL)) {
+        if (ubuf != NULL)
+            ubuf_free(ubuf);
+        if (pat != NULL)
+            uref_free(pat);
+        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+        return;
+    }
+
+    uint8_t *buffer;
+    int size = -1;
+    if (unlikely(!ubase_check(ubuf_block_write(ubuf, 0, &size, &buffer)))) {
+        ubuf_free(ubuf);
+        uref_free(pat);
+        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+        return;
+    }
+
+    ts_init(buffer);
+    ts_set_pid(buffer, PAT_PID);
+    ts_set_unitstart(buffer);
+    ts_set_payload(buffer);
+    ts_set_cc(buffer, sub->pat_cc);
+    sub->pat_cc = (sub->pat_cc + 1) & 0xf;
+    /* pointer_field */
+    buffer[TS_HEADER_SIZE] = 0;
+
+    uint8_t *section = buffer + TS_HEADER_SIZE + 1;
+    pat_init(section);
+    pat_set_length(section, PAT_PROGRAM_SIZE);
+    pat_set_tsid(section, tsid);
+    psi_set_version(section, sub->pat_version);
+    psi_set_current(section);
+    psi_set_section(section, 0);
+    psi_set_lastsection(section, 0);
+    uint8_t *program = pat_get_program(section, 0);
+    patn_init(program);
+    patn_set_program(program, sub->program);
+    patn_set_pid(program, sub->pmt_pid);
+    upipe_ts_psi_set_crc(section);
+
+    uint8_t *end = section + PAT_HEADER_SIZE + PAT_PROGRAM_SIZE + PSI_CRC_SIZE;
+    memset(end, 0xff, buffer + TS_SIZE - end);
+    ubuf_block_unmap(ubuf, 0);
+
+    uref_attach_ubuf(pat, ubuf);
+    upipe_ts_spts_split_sub_output(upipe, pat, upump_p);
+}
+
+/** @internal @This handles a PAT section.
+ *
+ * @param upipe description structure of the pipe
+ * @param section PAT section
+ * @param uref uref structure containing the last packet of the section
+ * @param upump_p reference to pump that generated the buffer
+ */
+static void upipe_ts_spts_split_handle_pat(struct upipe *upipe,
+                                           uint8_t *section,
+                                           struct uref *uref,
+                                           struct upump **upump_p)
+{
+    struct upipe_ts_spts_split *upipe_ts_spts_split =
+        upipe_ts_spts_split_from_upipe(upipe);
+    uint16_t tsid = pat_get_tsid(section);
+    bool complete = !psi_get_section(section) &&
+                    !psi_get_lastsection(section);
+
+    struct uchain *uchain, *uchain_tmp;
+    ulist_delete_foreach(&upipe_ts_spts_split->subs, uchain, uchain_tmp) {
+        struct upipe_ts_spts_split_sub *sub =
+            upipe_ts_spts_split_sub_from_uchain(uchain);
+        struct upipe *output = upipe_ts_spts_split_sub_to_upipe(sub);
+        uint8_t *program;
+        uint16_t j = 0;
+        while ((program = pat_get_program(section, j++)) != NULL)
+            if (patn_get_program(program) == sub->program)
+                break;
+
+        if (program != NULL) {
+            uint16_t pmt_pid = patn_get_pid(program);
+            if (pmt_pid != sub->pmt_pid) {
+                upipe_notice_va(output, "program %"PRIu16" on PMT PID %"PRIu16,
+                                sub->program, pmt_pid);
+                upipe_ts_spts_split_sub_set_pmt_pid(output, pmt_pid);
+            }
+            upipe_ts_spts_split_sub_output_pat(output, tsid, uref, upump_p);
+        } else if (complete && sub->pmt_pid != MAX_PIDS) {
+            upipe_warn_va(output, "program %"PRIu16" is not in the PAT",
+                          sub->program);
+            upipe_ts_spts_split_sub_set_pmt_pid(output, MAX_PIDS);
+        }
+    }
+}
+
+/** @internal @This handles a PMT section.
+ *
+ * @param upipe description structure of the pipe
+ * @param pid PID of the section
+ * @param section PMT section
+ */
+static void upipe_ts_spts_split_handle_pmt(struct upipe *upipe, uint16_t pid,
+                                           uint8_t *section)
+{
+    struct upipe_ts_spts_split *upipe_ts_spts_split =
+        upipe_ts_spts_split_from_upipe(upipe);
+    uint16_t program = pmt_get_program(section);
+    const uint8_t *crc_p = section + psi_get_length(section) +
+                           PSI_HEADER_SIZE - PSI_CRC_SIZE;
+    uint32_t crc = ((uint32_t)crc_p[0] << 24) | (crc_p[1] << 16) |
+                   (crc_p[2] << 8) | crc_p[3];
+
+    struct uchain *uchain;
+    ulist_foreach (&upipe_ts_spts_split->subs, uchain) {
+        struct upipe_ts_spts_split_sub *sub =
+            upipe_ts_spts_split_sub_from_uchain(uchain);
+        if (sub->pmt_pid != pid || sub->program != program ||
+            (sub->pmt_crc_valid && sub->pmt_crc == crc))
+            continue;
+        sub->pmt_crc_valid = true;
+        sub->pmt_crc = crc;
+
+        uint8_t pids[MAX_PIDS / 8];
+        memset(pids, 0, sizeof(pids));
+        pids[pid / 8] |= 1 << (pid % 8);
+        uint16_t pcr_pid = pmt_get_pcrpid(section);
+        if (pcr_pid != NO_PCR_PID)
+            pids[pcr_pid / 8] |= 1 << (pcr_pid % 8);
+
+        uint8_t *es;
+        uint8_t j = 0;
+        while ((es = pmt_get_es(section, j++)) != NULL) {
+            uint16_t es_pid = pmtn_get_pid(es);
+            pids[es_pid / 8] |= 1 << (es_pid % 8);
+        }
+
+        struct upipe *output = upipe_ts_spts_split_sub_to_upipe(sub);
+        upipe_notice_va(output, "new PMT for program %"PRIu16" (%"PRIu8
+                        " elementary streams)", program, j - 1);
+        upipe_ts_spts_split_sub_update(output, pids);
+    }
+}
+
+/** @internal @This handles a complete section.
+ *
+ * @param upipe description structure of the pipe
+ * @param pid PID of the section
+ * @param section section
+ * @param uref uref structure containing the last packet of the section
+ * @param upump_p reference to pump that generated the buffer
+ */
+static void upipe_ts_spts_split_handle_section(struct upipe *upipe,
+                                               uint16_t pid,
+                                               uint8_t *section,
+                                               struct uref *uref,
+                                               struct upump **upump_p)
+{
+    if (pid == PAT_PID) {
+        if (unlikely(!pat_validate(section) ||
+                     !upipe_ts_psi_check_crc(section))) {
+            upipe_warn(upipe, "invalid PAT section received");
+            return;
+        }
+        if (psi_get_current(section))
+            upipe_ts_spts_split_handle_pat(upipe, section, uref, upump_p);
+        return;
+    }
+
+    if (psi_get_tableid(section) != PMT_TABLE_ID)
+        return;
+    if (unlikely(!pmt_validate(section) ||
+                 !upipe_ts_psi_check_crc(section))) {
+        upipe_warn_va(upipe, "invalid PMT section received on PID %"PRIu16,
+                      pid);
+        return;
+    }
+    if (psi_get_current(section))
+        upipe_ts_spts_split_handle_pmt(upipe, pid, section);
+}
+
+/** @internal @This appends a chunk of payload to the section being
+ * assembled on a PID.
+ *
+ * @param upipe description structure of the pipe
+ * @param pid PID of the packet
+ * @param payload pointer to the chunk
+ * @param size size of the chunk
+ * @param uref uref structure containing the packet
+ * @param upump_p reference to pump that generated the buffer
+ */
+static void upipe_ts_spts_split_assemble(struct upipe *upipe, uint16_t pid,
+                                         const uint8_t *payload, size_t size,
+                                         struct uref *uref,
+                                         struct upump **upump_p)
+{
+    struct upipe_ts_spts_split *upipe_ts_spts_split =
+        upipe_ts_spts_split_from_upipe(upipe);
+    struct upipe_ts_spts_split_pid *split_pid =
+        &upipe_ts_spts_split->pids[pid];
+
+    while (size && split_pid->section_used >= 0) {
+        unsigned int used = split_pid->section_used;
+        if (!used && *payload == 0xff) {
+            /* stuffing */
+            split_pid->section_used = -1;
+            return;
+        }
+
+        unsigned int needed = used < PSI_HEADER_SIZE ? PSI_HEADER_SIZE :
+            psi_get_length(split_pid->section) + PSI_HEADER_SIZE;
+        size_t chunk = needed - used;
+        if (chunk > size)
+            chunk = size;
+        memcpy(split_pid->section + used, payload, chunk);
+        payload += chunk;
+        size -= chunk;
+        used += chunk;
+        split_pid->section_used = used;
+        if (used < PSI_HEADER_SIZE)
+            continue;
+
+        if (unlikely(psi_get_length(split_pid->section) > PSI_MAX_SIZE)) {
+            upipe_warn_va(upipe, "invalid section length on PID %"PRIu16,
+                          pid);
+            split_pid->section_used = -1;
+            return;
+        }
+        if (used == psi_get_length(split_pid->section) + PSI_HEADER_SIZE) {
+            split_pid->section_used = 0;
+            upipe_ts_spts_split_handle_section(upipe, pid,
+                                               split_pid->section,
+                                               uref, upump_p);
+        }
+    }
+}
+
+/** @internal @This extracts the sections carried by a TS packet.
+ *
+ * @param upipe description structure of the pipe
+ * @param pid PID of the packet
+ * @param uref uref structure containing the packet
+ * @param upump_p reference to pump that generated the buffer
+ */
+static void upipe_ts_spts_split_psi(struct upipe *upipe, uint16_t pid,
+                                    struct uref *uref, struct upump **upump_p)
+{
+    struct upipe_ts_spts_split *upipe_ts_spts_split =
+        upipe_ts_spts_split_from_upipe(upipe);
+    struct upipe_ts_spts_split_pid *split_pid =
+        &upipe_ts_spts_split->pids[pid];
+
+    uint8_t buffer[TS_SIZE];
+    const uint8_t *ts = uref_block_peek(uref, 0, TS_SIZE, buffer);
+    if (unlikely(ts == NULL)) {
+        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+        return;
+    }
+
+    const uint8_t *payload = ts + TS_HEADER_SIZE;
+    if (ts_has_adaptation(ts))
+        payload += 1 + ts_get_adaptation(ts);
+    if (unlikely(!ts_has_payload(ts) || payload >= ts + TS_SIZE))
+        goto upipe_ts_spts_split_psi_end;
+
+    int cc = ts_get_cc(ts);
+    if (split_pid->cc != -1 && cc != ((split_pid->cc + 1) & 0xf)) {
+        if (cc == split_pid->cc)
+            /* duplicate packet */
+            goto upipe_ts_spts_split_psi_end;
+        split_pid->section_used = -1;
+    }
+    split_pid->cc = cc;
+
+    size_t size = ts + TS_SIZE - payload;
+    if (ts_get_unitstart(ts)) {
+        uint8_t pointer = *payload++;
+        size--;
+        if (unlikely(pointer > size)) {
+            split_pid->section_used = -1;
+            goto upipe_ts_spts_split_psi_end;
+        }
+        if (split_pid->section_used > 0)
+            upipe_ts_spts_split_assemble(upipe, pid, payload, pointer,
+                                         uref, upump_p);
+        payload += pointer;
+        size -= pointer;
+        split_pid->section_used = 0;
+    }
+    upipe_ts_spts_split_assemble(upipe, pid, payload, size, uref, upump_p);
+
+upipe_ts_spts_split_psi_end:
+    uref_block_peek_unmap(uref, 0, buffer, ts);
+}
+
+/** @internal @This outputs a TS packet to the outputs of its PID.
+ *
+ * @param upipe description structure of the pipe
+ * @param pid PID of the packet
+ * @param uref uref structure containing the packet
+ * @param upump_p reference to pump that generated the buffer
+ * @return false in case of allocation error
+ */
+static bool upipe_ts_spts_split_dispatch(struct upipe *upipe, uint16_t pid,
+                                         struct uref *uref,
+                                         struct upump **upump_p)
+{
+    struct upipe_ts_spts_split *upipe_ts_spts_split =
+        upipe_ts_spts_split_from_upipe(upipe);
+    struct upipe_ts_spts_split_pid *split_pid =
+        &upipe_ts_spts_split->pids[pid];
+
+    if (split_pid->nb_psi)
+        upipe_ts_spts_split_psi(upipe, pid, uref, upump_p);
+    if (pid == PAT_PID) {
+        /* the PAT is rewritten for each output */
+        uref_free(uref);
+        return true;
+    }
+
+    /* the table is read again at each step, as outputs may go away */
+    for (unsigned int i = 0; i < split_pid->nb_outputs; i++) {
+        struct upipe *output =
+            upipe_ts_spts_split_sub_to_upipe(split_pid->outputs[i]);
+        if (likely(i + 1 == split_pid->nb_outputs)) {
+            upipe_ts_spts_split_sub_output(output, uref, upump_p);
+            return true;
+        }
+
+        struct uref *new_uref = uref_dup(uref);
+        if (unlikely(new_uref == NULL)) {
+            uref_free(uref);
+            upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+            return false;
+        }
+        upipe_ts_spts_split_sub_output(output, new_uref, upump_p);
+    }
+    uref_free(uref);
+    return true;
+}
+
+/** @internal @This returns the PID of a TS packet.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref uref structure
+ * @param offset offset of the packet in the uref
+ * @param pid_p filled in with the PID
+ * @return an error code
+ */
+static int upipe_ts_spts_split_get_pid(struct upipe *upipe, struct uref *uref,
+                                       int offset, uint16_t *pid_p)
+{
+    uint8_t buffer[TS_HEADER_SIZE];
+    const uint8_t *ts_header = uref_block_peek(uref, offset, TS_HEADER_SIZE,
+                                               buffer);
+    if (unlikely(ts_header == NULL))
+        return UBASE_ERR_ALLOC;
+    *pid_p = ts_get_pid(ts_header);
+    return uref_block_peek_unmap(uref, offset, buffer, ts_header);
+}
+
+/** @internal @This splits TS packets to the outputs of their programs. Urefs
+ * containing several packets are split here, and only the packets of the
+ * selected PIDs are allocated a new uref.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref uref structure
+ * @param upump_p reference to pump that generated the buffer
+ */
+static void upipe_ts_spts_split_input(struct upipe *upipe, struct uref *uref,
+                                      struct upump **upump_p)
+{
+    struct upipe_ts_spts_split *upipe_ts_spts_split =
+        upipe_ts_spts_split_from_upipe(upipe);
+    size_t size;
+    uint16_t pid;
+    if (unlikely(!ubase_check(uref_block_size(uref, &size)))) {
+        uref_free(uref);
+        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+        return;
+    }
+
+    if (likely(size == TS_SIZE)) {
+        if (unlikely(!ubase_check(upipe_ts_spts_split_get_pid(upipe, uref, 0,
+                                                              &pid)))) {
+            uref_free(uref);
+            upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+            return;
+        }
+        upipe_ts_spts_split_dispatch(upipe, pid, uref, upump_p);
+        return;
+    }
+
+    if (unlikely(size % TS_SIZE))
+        upipe_warn_va(upipe, "dropping %zu trailing octets", size % TS_SIZE);
+
+    for (int offset = 0; offset + TS_SIZE <= size; offset += TS_SIZE) {
+        if (unlikely(!ubase_check(upipe_ts_spts_split_get_pid(upipe, uref,
+                                                    offset, &pid)))) {
+            uref_free(uref);
+            upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+            return;
+        }
+        if (!upipe_ts_spts_split->pids[pid].nb_outputs &&
+            !upipe_ts_spts_split->pids[pid].nb_psi)
+            continue;
+
+        struct uref *packet = uref_block_splice(uref, offset, TS_SIZE);
+        if (unlikely(packet == NULL)) {
+            uref_free(uref);
+            upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+            return;
+        }
+        if (unlikely(!upipe_ts_spts_split_dispatch(upipe, pid, packet,
+                                                   upump_p))) {
+            uref_free(uref);
+            return;
+        }
+    }
+    uref_free(uref);
+}
+
+/** @internal @This allocates an output subpipe of a ts_spts_split pipe.
+ *
+ * @param mgr common management structure
+ * @param uprobe structure used to raise events
+ * @param signature signature of the pipe allocator
+ * @param args optional arguments
+ * @return pointer to upipe or NULL in case of allocation error
+ */
+static struct upipe *upipe_ts_spts_split_sub_alloc(struct upipe_mgr *mgr,
+                                                   struct uprobe *uprobe,
+                                                   uint32_t signature,
+                                                   va_list args)
+{
+    struct uref *flow_def;
+    struct upipe *upipe = upipe_ts_spts_split_sub_alloc_flow(mgr, uprobe,
+            signature, args, &flow_def);
+    if (unlikely(upipe == NULL))
+        return NULL;
+
+    uint64_t program;
+    if (unlikely(!ubase_check(uref_flow_get_id(flow_def, &program)) ||
+                 !program || program > UINT16_MAX)) {
+        upipe_err(upipe, "invalid program number");
+        uref_free(flow_def);
+        upipe_ts_spts_split_sub_free_flow(upipe);
+        return NULL;
+    }
+
+    struct upipe_ts_spts_split_sub *sub =
+        upipe_ts_spts_split_sub_from_upipe(upipe);
+    upipe_ts_spts_split_sub_init_urefcount(upipe);
+    upipe_ts_spts_split_sub_init_output(upipe);
+    upipe_ts_spts_split_sub_init_sub(upipe);
+    upipe_ts_spts_split_sub_store_flow_def(upipe, flow_def);
+    sub->program = program;
+    sub->pmt_pid = MAX_PIDS;
+    memset(sub->pids, 0, sizeof(sub->pids));
+    sub->pmt_crc_valid = false;
+    sub->pmt_crc = 0;
+    sub->pat_version = 0;
+    sub->pat_cc = 0;
+
+    upipe_ts_spts_split_psi_use(upipe_ts_spts_split_to_upipe(
+                upipe_ts_spts_split_from_sub_mgr(mgr)), PAT_PID);
+
+    upipe_throw_ready(upipe);
+    return upipe;
+}
+
+/** @internal @This processes control commands on an output subpipe of a
+ * ts_spts_split pipe.
+ *
+ * @param upipe description structure of the pipe
+ * @param command type of command to process
+ * @param args arguments of the command
+ * @return an error code
+ */
+static int upipe_ts_spts_split_sub_control(struct upipe *upipe,
+                                           int command, va_list args)
+{
+    UBASE_HANDLED_RETURN(
+        upipe_ts_spts_split_sub_control_super(upipe, command, args));
+    switch (command) {
+        case UPIPE_GET_FLOW_DEF:
+        case UPIPE_GET_OUTPUT:
+        case UPIPE_SET_OUTPUT:
+            return upipe_ts_spts_split_sub_control_output(upipe, command,
+                                                          args);
+        default:
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** @This frees a upipe.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_ts_spts_split_sub_free(struct upipe *upipe)
+{
+    struct upipe *super = upipe_ts_spts_split_to_upipe(
+            upipe_ts_spts_split_from_sub_mgr(upipe->mgr));
+
+    upipe_ts_spts_split_sub_set_pmt_pid(upipe, MAX_PIDS);
+    upipe_ts_spts_split_psi_release(super, PAT_PID);
+
+    upipe_throw_dead(upipe);
+    upipe_ts_spts_split_sub_clean_output(upipe);
+    upipe_ts_spts_split_sub_clean_sub(upipe);
+    upipe_ts_spts_split_sub_clean_urefcount(upipe);
+    upipe_ts_spts_split_sub_free_flow(upipe);
+}
+
+/** @internal @This initializes the output manager for a ts_spts_split pipe.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_ts_spts_split_init_sub_mgr(struct upipe *upipe)
+{
+    struct upipe_ts_spts_split *upipe_ts_spts_split =
+        upipe_ts_spts_split_from_upipe(upipe);
+    struct upipe_mgr *sub_mgr = &upipe_ts_spts_split->sub_mgr;
+    sub_mgr->refcount =
+        upipe_ts_spts_split_to_urefcount_real(upipe_ts_spts_split);
+    sub_mgr->signature = UPIPE_TS_SPTS_SPLIT_OUTPUT_SIGNATURE;
+    sub_mgr->upipe_alloc = upipe_ts_spts_split_sub_alloc;
+    sub_mgr->upipe_input = NULL;
+    sub_mgr->upipe_control = upipe_ts_spts_split_sub_control;
+    sub_mgr->upipe_mgr_control = NULL;
+}
+
+/** @internal @This allocates a ts_spts_split pipe.
+ *
+ * @param mgr common management structure
+ * @param uprobe structure used to raise events
+ * @param signature signature of the pipe allocator
+ * @param args optional arguments
+ * @return pointer to upipe or NULL in case of allocation error
+ */
+static struct upipe *upipe_ts_spts_split_alloc(struct upipe_mgr *mgr,
+                                               struct uprobe *uprobe,
+                                               uint32_t signature,
+                                               va_list args)
+{
+    struct upipe *upipe = upipe_ts_spts_split_alloc_void(mgr, uprobe,
+                                                         signature, args);
+    if (unlikely(upipe == NULL))
+        return NULL;
+
+    struct upipe_ts_spts_split *upipe_ts_spts_split =
+        upipe_ts_spts_split_from_upipe(upipe);
+    upipe_ts_spts_split_init_urefcount(upipe);
+    urefcount_init(upipe_ts_spts_split_to_urefcount_real(upipe_ts_spts_split),
+                   upipe_ts_spts_split_free);
+    upipe_ts_spts_split_init_sub_mgr(upipe);
+    upipe_ts_spts_split_init_sub_subs(upipe);
+
+    for (int i = 0; i < MAX_PIDS; i++) {
+        struct upipe_ts_spts_split_pid *split_pid =
+            &upipe_ts_spts_split->pids[i];
+        split_pid->outputs = NULL;
+        split_pid->nb_outputs = 0;
+        split_pid->nb_psi = 0;
+        split_pid->set = false;
+        split_pid->section = NULL;
+        split_pid->section_used = -1;
+        split_pid->cc = -1;
+    }
+    upipe_throw_ready(upipe);
+    return upipe;
+}
+
+/** @internal @This sets the input flow definition.
+ *
+ * @param upipe description structure of the pipe
+ * @param flow_def flow definition packet
+ * @return an error code
+ */
+static int upipe_ts_spts_split_set_flow_def(struct upipe *upipe,
+                                            struct uref *flow_def)
+{
+    if (flow_def == NULL)
+        return UBASE_ERR_INVALID;
+    return uref_flow_match_def(flow_def, EXPECTED_FLOW_DEF);
+}
+
+/** @internal @This processes control commands.
+ *
+ * @param upipe description structure of the pipe
+ * @param command type of command to process
+ * @param args arguments of the command
+ * @return an error code
+ */
+static int upipe_ts_spts_split_control(struct upipe *upipe,
+                                       int command, va_list args)
+{
+    UBASE_HANDLED_RETURN(
+        upipe_ts_spts_split_control_subs(upipe, command, args));
+
+    switch (command) {
+        case UPIPE_REGISTER_REQUEST: {
+            struct urequest *request = va_arg(args, struct urequest *);
+            /* We do not pass through the requests ; which output would
+             * we use ? */
+            return upipe_throw_provide_request(upipe, request);
+        }
+        case UPIPE_UNREGISTER_REQUEST:
+            return UBASE_ERR_NONE;
+        case UPIPE_SET_FLOW_DEF: {
+            struct uref *flow_def = va_arg(args, struct uref *);
+            return upipe_ts_spts_split_set_flow_def(upipe, flow_def);
+        }
+
+        default:
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** @This frees a upipe.
+ *
+ * @param urefcount_real pointer to urefcount_real structure
+ */
+static void upipe_ts_spts_split_free(struct urefcount *urefcount_real)
+{
+    struct upipe_ts_spts_split *upipe_ts_spts_split =
+        upipe_ts_spts_split_from_urefcount_real(urefcount_real);
+    struct upipe *upipe = upipe_ts_spts_split_to_upipe(upipe_ts_spts_split);
+    upipe_throw_dead(upipe);
+    upipe_ts_spts_split_clean_sub_subs(upipe);
+    for (int i = 0; i < MAX_PIDS; i++) {
+        free(upipe_ts_spts_split->pids[i].outputs);
+        free(upipe_ts_spts_split->pids[i].section);
+    }
+    urefcount_clean(urefcount_real);
+    upipe_ts_spts_split_clean_urefcount(upipe);
+    upipe_ts_spts_split_free_void(upipe);
+}
+
+/** @This is called when there is no external reference to the pipe anymore.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_ts_spts_split_no_input(struct upipe *upipe)
+{
+    struct upipe_ts_spts_split *upipe_ts_spts_split =
+        upipe_ts_spts_split_from_upipe(upipe);
+    upipe_ts_spts_split_throw_sub_subs(upipe, UPROBE_SOURCE_END);
+    urefcount_release(
+            upipe_ts_spts_split_to_urefcount_real(upipe_ts_spts_split));
+}
+
+/** module manager static descriptor */
+static struct upipe_mgr upipe_ts_spts_split_mgr = {
+    .refcount = NULL,
+    .signature = UPIPE_TS_SPTS_SPLIT_SIGNATURE,
+
+    .upipe_alloc = upipe_ts_spts_split_alloc,
+    .upipe_input = upipe_ts_spts_split_input,
+    .upipe_control = upipe_ts_spts_split_control,
+
+    .upipe_mgr_control = NULL
+};
+
+/** @This returns the management structure for all ts_spts_split pipes.
+ *
+ * @return pointer to manager
+ */
+struct upipe_mgr *upipe_ts_spts_split_mgr_alloc(void)
+{
+    return &upipe_ts_spts_split_mgr;
+}
@@ -55,6 +55,18 @@
 
 #include <bitstream/mpeg/ts.h>
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+/** number of candidate positions tested at once */
+#define UPIPE_TS_SYNC_VECTOR 32
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define UPIPE_TS_SYNC_VECTOR 16
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define UPIPE_TS_SYNC_VECTOR 16
+#endif
+
 /** default number of packets to sync with */
 #define DEFAULT_TS_SYNC 2
 /** we only accept blocks */
@@ -90,6 +102,8 @@ struct upipe_ts_sync {
     size_t next_uref_size;
     /** urefs received after next uref */
     struct uchain urefs;
+    /** maximum number of TS packets per output uref */
+    unsigned int batch;
     /** true if we have thrown the sync_acquired event */
     bool acquired;
 
@@ -129,12 +143,91 @@ static struct upipe *upipe_ts_sync_alloc(struct upipe_mgr *mgr,
     upipe_ts_sync_init_output(upipe);
     upipe_ts_sync_init_output_size(upipe, TS_SIZE);
     upipe_ts_sync->ts_sync = DEFAULT_TS_SYNC;
+    upipe_ts_sync->batch = 1;
     upipe_ts_sync->next_uref = NULL;
     ulist_init(&upipe_ts_sync->urefs);
     upipe_throw_ready(upipe);
     return upipe;
 }
 
+#ifdef UPIPE_TS_SYNC_VECTOR
+/** @internal @This returns the position of the first candidate in a vector
+ * of @ref UPIPE_TS_SYNC_VECTOR octets which is followed by the required
+ * number of sync words.
+ *
+ * @param p pointer to the vector (not necessarily aligned)
+ * @param stride size of TS packets
+ * @param nb_sync number of sync words to test
+ * @return position of the first candidate, or UPIPE_TS_SYNC_VECTOR if there
+ * is none
+ */
+static inline unsigned int upipe_ts_sync_scan_vector(const uint8_t *p,
+                                                     size_t stride,
+                                                     unsigned int nb_sync)
+{
+#if defined(__AVX2__)
+    __m256i sync = _mm256_set1_epi8(TS_SYNC);
+    __m256i v = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)p),
+                                  sync);
+    for (unsigned int i = 1; i < nb_sync; i++)
+        v = _mm256_and_si256(v, _mm256_cmpeq_epi8(
+                    _mm256_loadu_si256((const __m256i *)(p + i * stride)),
+                    sync));
+    uint32_t mask = _mm256_movemask_epi8(v);
+    return mask ? __builtin_ctz(mask) : UPIPE_TS_SYNC_VECTOR;
+#elif defined(__SSE2__)
+    __m128i sync = _mm_set1_epi8(TS_SYNC);
+    __m128i v = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)p), sync);
+    for (unsigned int i = 1; i < nb_sync; i++)
+        v = _mm_and_si128(v, _mm_cmpeq_epi8(
+                    _mm_loadu_si128((const __m128i *)(p + i * stride)),
+                    sync));
+    uint32_t mask = _mm_movemask_epi8(v);
+    return mask ? __builtin_ctz(mask) : UPIPE_TS_SYNC_VECTOR;
+#else
+    uint8x16_t v = vceqq_u8(vld1q_u8(p), vdupq_n_u8(TS_SYNC));
+    for (unsigned int i = 1; i < nb_sync; i++)
+        v = vandq_u8(v, vceqq_u8(vld1q_u8(p + i * stride),
+                                 vdupq_n_u8(TS_SYNC)));
+    /* narrow to 4 bits per octet, as there is no movemask */
+    uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(
+                vshrn_n_u16(vreinterpretq_u16_u8(v), 4)), 0);
+    return mask ? __builtin_ctzll(mask) / 4 : UPIPE_TS_SYNC_VECTOR;
+#endif
+}
+#endif
+
+/** @internal @This looks for the first candidate in a linear buffer which is
+ * followed by the required number of sync words.
+ *
+ * @param p linear buffer, containing at least
+ * nb_candidates + (nb_sync - 1) * stride octets
+ * @param nb_candidates number of candidate positions to test
+ * @param stride size of TS packets
+ * @param nb_sync number of sync words to test
+ * @return position of the first candidate, or nb_candidates if there is none
+ */
+static size_t upipe_ts_sync_scan(const uint8_t *p, size_t nb_candidates,
+                                 size_t stride, unsigned int nb_sync)
+{
+    size_t i = 0;
+#ifdef UPIPE_TS_SYNC_VECTOR
+    for ( ; i + UPIPE_TS_SYNC_VECTOR <= nb_candidates;
+          i += UPIPE_TS_SYNC_VECTOR) {
+        unsigned int pos = upipe_ts_sync_scan_vector(p + i, stride, nb_sync);
+        if (pos < UPIPE_TS_SYNC_VECTOR)
+            return i + pos;
+    }
+#endif
+    for ( ; i < nb_candidates; i++) {
+        unsigned int j;
+        for (j = 0; j < nb_sync && p[i + j * stride] == TS_SYNC; j++);
+        if (j == nb_sync)
+            return i;
+    }
+    return nb_candidates;
+}
+
 /** @internal @This checks the presence of the required number of sync words
  * in the working buffer.
  *
@@ -151,7 +244,29 @@ static bool upipe_ts_sync_check(struct upipe *upipe, size_t *offset_p)
                                                   offset_p, TS_SYNC))))
             return false;
 
-        /* first octet at *offset_p is a sync word */
+        /* first octet at *offset_p is a sync word; test all candidates
+         * of the current segment at once if it is large enough */
+        size_t span = (upipe_ts_sync->ts_sync - 1) *
+                      upipe_ts_sync->output_size;
+        const uint8_t *buffer;
+        int size = -1;
+        if (likely(ubase_check(uref_block_read(upipe_ts_sync->next_uref,
+                                               *offset_p, &size, &buffer)))) {
+            if (size > span) {
+                size_t nb_candidates = size - span;
+                size_t pos = upipe_ts_sync_scan(buffer, nb_candidates,
+                                                upipe_ts_sync->output_size,
+                                                upipe_ts_sync->ts_sync);
+                uref_block_unmap(upipe_ts_sync->next_uref, *offset_p);
+                *offset_p += pos;
+                if (pos < nb_candidates)
+                    break;
+                continue;
+            }
+            uref_block_unmap(upipe_ts_sync->next_uref, *offset_p);
+        }
+
+        /* the candidate spans several segments */
         int ts_sync = upipe_ts_sync->ts_sync - 1;
         for (int offset = *offset_p + upipe_ts_sync->output_size; ts_sync;
              ts_sync--, offset += upipe_ts_sync->output_size) {
@@ -177,6 +292,45 @@ static bool upipe_ts_sync_check(struct upipe *upipe, size_t *offset_p)
     return true;
 }
 
+/** @internal @This returns the number of TS packets which may be output at
+ * once from the start of the working buffer, which is known to be
+ * synchronized, by testing all sync words of the current segment.
+ *
+ * @param upipe description structure of the pipe
+ * @return number of TS packets (at least 1)
+ */
+static unsigned int upipe_ts_sync_batch(struct upipe *upipe)
+{
+    struct upipe_ts_sync *upipe_ts_sync = upipe_ts_sync_from_upipe(upipe);
+    size_t output_size = upipe_ts_sync->output_size;
+    /* do not go past the current input uref, so that packets keep the
+     * attributes of the uref they started in */
+    size_t max = (upipe_ts_sync->next_uref_size + output_size - 1) /
+                 output_size;
+    if (max > upipe_ts_sync->batch)
+        max = upipe_ts_sync->batch;
+    if (max <= 1)
+        return 1;
+
+    const uint8_t *buffer;
+    int size = -1;
+    if (unlikely(!ubase_check(uref_block_read(upipe_ts_sync->next_uref, 0,
+                                              &size, &buffer))))
+        return 1;
+
+    /* a packet is output when the sync words of the next ts_sync - 1
+     * packets are also there */
+    size_t nb_sync = max + upipe_ts_sync->ts_sync - 1;
+    size_t i;
+    for (i = 0; i < nb_sync && i * output_size < size &&
+                buffer[i * output_size] == TS_SYNC; i++);
+    uref_block_unmap(upipe_ts_sync->next_uref, 0);
+
+    if (i < upipe_ts_sync->ts_sync)
+        return 1;
+    return i - (upipe_ts_sync->ts_sync - 1);
+}
+
 /** @internal @This flushes all input buffers.
  *
  * @param upipe description structure of the pipe
@@ -235,8 +389,9 @@ static void upipe_ts_sync_input(struct upipe *upipe, struct uref *uref,
 
         /* upipe_ts_sync_check said there is at least one TS packet there. */
         upipe_ts_sync_sync_acquired(upipe);
+        unsigned int nb_packets = upipe_ts_sync_batch(upipe);
         struct uref *output = upipe_ts_sync_extract_uref_stream(upipe,
-                                                    upipe_ts_sync->output_size);
+                                    nb_packets * upipe_ts_sync->output_size);
         if (unlikely(output == NULL)) {
             upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
             continue;
@@ -302,6 +457,37 @@ static int _upipe_ts_sync_set_sync(struct upipe *upipe, int sync)
     return UBASE_ERR_NONE;
 }
 
+/** @internal @This returns the maximum number of TS packets per output uref.
+ *
+ * @param upipe description structure of the pipe
+ * @param batch_p filled in with the number of packets
+ * @return an error code
+ */
+static int _upipe_ts_sync_get_batch(struct upipe *upipe,
+                                    unsigned int *batch_p)
+{
+    struct upipe_ts_sync *upipe_ts_sync = upipe_ts_sync_from_upipe(upipe);
+    assert(batch_p != NULL);
+    *batch_p = upipe_ts_sync->batch;
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This sets the maximum number of TS packets per output uref.
+ * The default value is 1.
+ *
+ * @param upipe description structure of the pipe
+ * @param batch number of packets
+ * @return an error code
+ */
+static int _upipe_ts_sync_set_batch(struct upipe *upipe, unsigned int batch)
+{
+    struct upipe_ts_sync *upipe_ts_sync = upipe_ts_sync_from_upipe(upipe);
+    if (!batch)
+        return UBASE_ERR_INVALID;
+    upipe_ts_sync->batch = batch;
+    return UBASE_ERR_NONE;
+}
+
 /** @internal @This processes control commands on a ts sync pipe.
  *
  * @param upipe description structure of the pipe
@@ -333,6 +519,16 @@ static int upipe_ts_sync_control(struct upipe *upipe,
             int sync = va_arg(args, int);
             return _upipe_ts_sync_set_sync(upipe, sync);
         }
+        case UPIPE_TS_SYNC_GET_BATCH: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_TS_SYNC_SIGNATURE)
+            unsigned int *batch_p = va_arg(args, unsigned int *);
+            return _upipe_ts_sync_get_batch(upipe, batch_p);
+        }
+        case UPIPE_TS_SYNC_SET_BATCH: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_TS_SYNC_SIGNATURE)
+            unsigned int batch = va_arg(args, unsigned int);
+            return _upipe_ts_sync_set_batch(upipe, batch);
+        }
         default:
             return UBASE_ERR_UNHANDLED;
     }
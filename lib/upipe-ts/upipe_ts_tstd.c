@@ -76,6 +76,13 @@ struct upipe_ts_tstd {
     /** previous DTS */
     uint64_t last_dts;
 
+    /** monitoring interval, or 0 if monitoring is disabled */
+    uint64_t monitor;
+    /** start of the monitoring window, or UINT64_MAX */
+    uint64_t window_start;
+    /** counters of the monitoring window */
+    struct upipe_ts_tstd_stats stats;
+
     /** public upipe structure */
     struct upipe upipe;
 };
@@ -85,6 +92,19 @@ UPIPE_HELPER_UREFCOUNT(upipe_ts_tstd, urefcount, upipe_ts_tstd_free)
 UPIPE_HELPER_VOID(upipe_ts_tstd)
 UPIPE_HELPER_OUTPUT(upipe_ts_tstd, output, flow_def, output_state, request_list)
 
+/** @internal @This resets the counters of the monitoring window.
+ *
+ * @param upipe description structure of the pipe
+ * @param now start of the new window, or UINT64_MAX
+ */
+static void upipe_ts_tstd_reset_stats(struct upipe *upipe, uint64_t now)
+{
+    struct upipe_ts_tstd *upipe_ts_tstd = upipe_ts_tstd_from_upipe(upipe);
+    memset(&upipe_ts_tstd->stats, 0, sizeof(upipe_ts_tstd->stats));
+    upipe_ts_tstd->stats.min_fullness = UINT64_MAX;
+    upipe_ts_tstd->window_start = now;
+}
+
 /** @internal @This handles urefs.
  *
  * @param upipe description structure of the pipe
@@ -105,20 +125,53 @@ static void upipe_ts_tstd_input(struct upipe *upipe, struct uref *uref,
             upipe_ts_tstd->remainder = q.rem;
         }
         upipe_ts_tstd->last_dts = dts;
+
+        if (upipe_ts_tstd->monitor) {
+            if (unlikely(upipe_ts_tstd->window_start == UINT64_MAX))
+                upipe_ts_tstd->window_start = dts;
+            else if (dts >= upipe_ts_tstd->window_start +
+                            upipe_ts_tstd->monitor) {
+                upipe_ts_tstd->stats.duration =
+                    dts - upipe_ts_tstd->window_start;
+                if (upipe_ts_tstd->stats.min_fullness == UINT64_MAX)
+                    upipe_ts_tstd->stats.min_fullness = 0;
+                upipe_throw(upipe, UPROBE_TS_TSTD_REPORT,
+                            UPIPE_TS_TSTD_SIGNATURE, &upipe_ts_tstd->stats);
+                upipe_ts_tstd_reset_stats(upipe, dts);
+            }
+        }
     }
 
     size_t uref_size = 0;
     uref_block_size(uref, &uref_size);
+    struct upipe_ts_tstd_stats *stats = &upipe_ts_tstd->stats;
     upipe_ts_tstd->fullness -= uref_size;
     if (upipe_ts_tstd->fullness < 0) {
-        upipe_warn_va(upipe, "T-STD underflow (%"PRId64" octets)",
-                      -upipe_ts_tstd->fullness);
+        if (upipe_ts_tstd->monitor) {
+            stats->underflows++;
+            stats->underflow_octets += -upipe_ts_tstd->fullness;
+        } else
+            upipe_warn_va(upipe, "T-STD underflow (%"PRId64" octets)",
+                          -upipe_ts_tstd->fullness);
         upipe_ts_tstd->fullness = 0;
     } else if (upipe_ts_tstd->fullness > upipe_ts_tstd->bs) {
-        upipe_verbose_va(upipe, "T-STD overflow (%"PRId64" octets)",
-                         upipe_ts_tstd->fullness - upipe_ts_tstd->bs);
+        if (upipe_ts_tstd->monitor) {
+            stats->overflows++;
+            stats->overflow_octets +=
+                upipe_ts_tstd->fullness - upipe_ts_tstd->bs;
+        } else
+            upipe_verbose_va(upipe, "T-STD overflow (%"PRId64" octets)",
+                             upipe_ts_tstd->fullness - upipe_ts_tstd->bs);
         upipe_ts_tstd->fullness = upipe_ts_tstd->bs;
     }
+    if (upipe_ts_tstd->monitor) {
+        stats->urefs++;
+        stats->octets += uref_size;
+        if (upipe_ts_tstd->fullness < stats->min_fullness)
+            stats->min_fullness = upipe_ts_tstd->fullness;
+        if (upipe_ts_tstd->fullness > stats->max_fullness)
+            stats->max_fullness = upipe_ts_tstd->fullness;
+    }
 
     uint64_t delay = (upipe_ts_tstd->fullness * UCLOCK_FREQ) /
                      upipe_ts_tstd->octetrate;
@@ -237,6 +290,23 @@ static int upipe_ts_tstd_control(struct upipe *upipe, int command, va_list args)
             uint64_t delay = va_arg(args, uint64_t);
             return upipe_ts_tstd_set_max_delay(upipe, delay);
         }
+
+        case UPIPE_TS_TSTD_SET_MONITOR: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_TS_TSTD_SIGNATURE)
+            struct upipe_ts_tstd *upipe_ts_tstd =
+                upipe_ts_tstd_from_upipe(upipe);
+            upipe_ts_tstd->monitor = va_arg(args, uint64_t);
+            upipe_ts_tstd_reset_stats(upipe, UINT64_MAX);
+            return UBASE_ERR_NONE;
+        }
+        case UPIPE_TS_TSTD_GET_MONITOR: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_TS_TSTD_SIGNATURE)
+            struct upipe_ts_tstd *upipe_ts_tstd =
+                upipe_ts_tstd_from_upipe(upipe);
+            uint64_t *interval_p = va_arg(args, uint64_t *);
+            *interval_p = upipe_ts_tstd->monitor;
+            return UBASE_ERR_NONE;
+        }
         default:
             return UBASE_ERR_UNHANDLED;
     }
@@ -265,6 +335,8 @@ static struct upipe *upipe_ts_tstd_alloc(struct upipe_mgr *mgr,
     upipe_ts_tstd->max_delay = UINT64_MAX;
     upipe_ts_tstd->bs = upipe_ts_tstd->fullness = 0;
     upipe_ts_tstd->last_dts = UINT64_MAX;
+    upipe_ts_tstd->monitor = 0;
+    upipe_ts_tstd_reset_stats(upipe, UINT64_MAX);
     upipe_throw_ready(upipe);
     return upipe;
 }
@@ -284,6 +356,8 @@ static void upipe_ts_tstd_free(struct upipe *upipe)
 static struct upipe_mgr upipe_ts_tstd_mgr = {
     .refcount = NULL,
     .signature = UPIPE_TS_TSTD_SIGNATURE,
+    .upipe_command_str = upipe_ts_tstd_command_str,
+    .upipe_event_str = upipe_ts_tstd_event_str,
 
     .upipe_alloc = upipe_ts_tstd_alloc,
     .upipe_input = upipe_ts_tstd_input,
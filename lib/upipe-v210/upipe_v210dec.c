@@ -41,6 +41,8 @@
 #include <upipe/upipe_helper_ubuf_mgr.h>
 #include <upipe/upipe_helper_output.h>
 #include <upipe/upipe_helper_input.h>
+#include <upipe/uslices.h>
+#include <upipe/ucpu.h>
 
 #include <stdlib.h>
 #include <stdbool.h>
@@ -102,10 +104,17 @@ struct upipe_v210dec {
     void (*v210_to_planar_8)(const void *src, uint8_t *y, uint8_t *u, uint8_t *v, uintptr_t pixels);
     /** 10-bit line packing function **/
     void (*v210_to_planar_10)(const void *src, uint16_t *y, uint16_t *u, uint16_t *v, uintptr_t pixels);
+    /** instruction set extensions allowed for the kernels */
+    uint32_t cpu_flags;
+    /** true if the input buffers are aligned for the assembly kernels */
+    bool aligned;
 
     /** output chroma map */
     const char *output_chroma_map[UPIPE_V210_MAX_PLANES+1];
 
+    /** worker threads unpacking ranges of lines, or NULL */
+    struct uslices *uslices;
+
     /** public upipe structure */
     struct upipe upipe;
 };
@@ -156,37 +165,171 @@ static inline uint32_t rl32(const void *src)
         *(c)++ = (val >> 20) & 1023; \
     } while (0)
 
-/** @internal @This setups convert functions
+/** @internal @This describes an implementation of the unpacking kernels. */
+struct upipe_v210dec_kernel {
+    /** required instruction set extensions */
+    uint32_t cpu_flags;
+    /** 8-bit line unpacking function */
+    void (*v210_to_planar_8)(const void *src, uint8_t *y, uint8_t *u,
+                             uint8_t *v, uintptr_t pixels);
+    /** 10-bit line unpacking function */
+    void (*v210_to_planar_10)(const void *src, uint16_t *y, uint16_t *u,
+                              uint16_t *v, uintptr_t pixels);
+};
+
+/** @internal @This lists the kernels, from the most to the least preferred */
+static const struct upipe_v210dec_kernel upipe_v210dec_kernels[] = {
+    /* the following kernels do not require aligned buffers */
+#if defined(__x86_64__)
+    { UCPU_AVX512, upipe_v210_to_planar_8_avx512,
+      upipe_v210_to_planar_10_avx512 },
+#endif
+#if defined(__aarch64__) && !defined(__AARCH64EB__)
+    { UCPU_NEON, upipe_v210_to_planar_8_neon, upipe_v210_to_planar_10_neon },
+#endif
+#if defined(HAVE_X86ASM)
+#if defined(__i686__) || defined(__x86_64__)
+    { UCPU_AVX2, upipe_v210_to_planar_8_aligned_avx2,
+      upipe_v210_to_planar_10_aligned_avx2 },
+    { UCPU_AVX, upipe_v210_to_planar_8_aligned_avx,
+      upipe_v210_to_planar_10_aligned_avx },
+    { UCPU_SSSE3, upipe_v210_to_planar_8_aligned_ssse3,
+      upipe_v210_to_planar_10_aligned_ssse3 },
+#endif
+#endif
+    { 0, upipe_v210_to_planar_8_c, upipe_v210_to_planar_10_c },
+};
+
+/** @internal @This selects the convert functions.
  *
  * @param upipe description structure of the pipe
- * @param assembly whether to use assembly
  */
-static void v210dec_setup_asm(struct upipe *upipe, bool assembly)
+static void v210dec_setup_asm(struct upipe *upipe)
 {
     struct upipe_v210dec *v210dec = upipe_v210dec_from_upipe(upipe);
+    uint32_t flags = ucpu_flags() & v210dec->cpu_flags;
+    /* the x86 assembly kernels require aligned buffers */
+    if (!v210dec->aligned)
+        flags &= ~(UCPU_SSSE3 | UCPU_AVX | UCPU_AVX2);
+
+    const struct upipe_v210dec_kernel *kernel =
+        ucpu_select(upipe_v210dec_kernels, flags);
+    v210dec->v210_to_planar_8  = kernel->v210_to_planar_8;
+    v210dec->v210_to_planar_10 = kernel->v210_to_planar_10;
+}
+
+/** @internal @This describes a picture being unpacked. */
+struct upipe_v210dec_frame {
+    /** pointer to the pipe */
+    struct upipe_v210dec *v210dec;
+    /** input plane */
+    const uint8_t *input_plane;
+    /** input stride */
+    size_t input_stride;
+    /** output planes */
+    uint8_t *output_planes[3];
+    /** output strides */
+    size_t output_strides[3];
+    /** horizontal size */
+    uint64_t output_hsize;
+    /** vertical size */
+    size_t input_vsize;
+};
+
+/** @internal @This unpacks a range of lines of a picture.
+ *
+ * @param opaque pointer to the description of the picture
+ * @param slice index of the range of lines
+ * @param nb_slices number of ranges of lines
+ */
+static void upipe_v210dec_unpack_slice(void *opaque, unsigned int slice,
+                                       unsigned int nb_slices)
+{
+    const struct upipe_v210dec_frame *frame = opaque;
+    const struct upipe_v210dec *v210dec = frame->v210dec;
+    uint64_t output_hsize = frame->output_hsize;
+    size_t h_start = frame->input_vsize * slice / nb_slices;
+    size_t h_end = frame->input_vsize * (slice + 1) / nb_slices;
 
-    v210dec->v210_to_planar_8  = upipe_v210_to_planar_8_c;
-    v210dec->v210_to_planar_10 = upipe_v210_to_planar_10_c;
+    switch (v210dec->output_type) {
+        case V2D_OUTPUT_PLANAR_8: {
+            for (size_t h = h_start; h < h_end; h++) {
+                uint8_t *y = frame->output_planes[0] +
+                    h * frame->output_strides[0];
+                uint8_t *u = frame->output_planes[1] +
+                    h * frame->output_strides[1];
+                uint8_t *v = frame->output_planes[2] +
+                    h * frame->output_strides[2];
+                const uint32_t *src = (const uint32_t *)
+                    (frame->input_plane + h * frame->input_stride);
 
-    if (!assembly)
-        return;
+                int w = (output_hsize / 6) * 6;
+                v210dec->v210_to_planar_8(src, y, u, v, w);
 
-#if defined(HAVE_X86ASM)
-#if defined(__i686__) || defined(__x86_64__)
-    if (__builtin_cpu_supports("ssse3")) {
-        v210dec->v210_to_planar_8  = upipe_v210_to_planar_8_aligned_ssse3;
-        v210dec->v210_to_planar_10 = upipe_v210_to_planar_10_aligned_ssse3;
-    }
-    if (__builtin_cpu_supports("avx")) {
-        v210dec->v210_to_planar_8  = upipe_v210_to_planar_8_aligned_avx;
-        v210dec->v210_to_planar_10 = upipe_v210_to_planar_10_aligned_avx;
-    }
-    if (__builtin_cpu_supports("avx2")) {
-        v210dec->v210_to_planar_8  = upipe_v210_to_planar_8_aligned_avx2;
-        v210dec->v210_to_planar_10 = upipe_v210_to_planar_10_aligned_avx2;
+                y += w;
+                u += w >> 1;
+                v += w >> 1;
+                src += (w * 2) / 3;
+
+                if (w < output_hsize - 1) {
+                    READ_PIXELS_8(u, y, v);
+                    uint32_t val = *src++;
+                    *y++ = (val >> 2) & 255;
+
+                    if (w < output_hsize - 3) {
+                        *u++ = (val >> 12) & 255;
+                        *y++ = (val >> 22) & 255;
+
+                        val = rl32(src);
+                        src++;
+                        *v++ = (val >>  2) & 255;
+                        *y++ = (val >> 12) & 255;
+                    }
+                }
+            }
+        } break;
+
+        case V2D_OUTPUT_PLANAR_10: {
+            for (size_t h = h_start; h < h_end; h++) {
+                uint16_t *y = (uint16_t *)(frame->output_planes[0] +
+                                           h * frame->output_strides[0]);
+                uint16_t *u = (uint16_t *)(frame->output_planes[1] +
+                                           h * frame->output_strides[1]);
+                uint16_t *v = (uint16_t *)(frame->output_planes[2] +
+                                           h * frame->output_strides[2]);
+                const uint32_t *src = (const uint32_t *)
+                    (frame->input_plane + h * frame->input_stride);
+
+                int w = (output_hsize / 6) * 6;
+                v210dec->v210_to_planar_10(src, y, u, v, w);
+
+                y += w;
+                u += w >> 1;
+                v += w >> 1;
+                src += (w * 2) / 3;
+
+                if (w < output_hsize - 1) {
+                    READ_PIXELS_10(u, y, v);
+                    uint32_t val = rl32(src);
+                    src++;
+                    *y++ = val & 1023;
+
+                    if (w < output_hsize - 3) {
+                        *u++ = (val >> 10) & 1023;
+                        *y++ = (val >> 20) & 1023;
+
+                        val = rl32(src);
+                        src++;
+                        *v++ = val & 1023;
+                        *y++ = (val >> 10) & 1023;
+                    }
+                }
+            }
+        } break;
+
+        default:
+            assert(0);
     }
-#endif
-#endif
 }
 
 /** @internal @This handles data.
@@ -262,85 +405,19 @@ static bool upipe_v210dec_handle(struct upipe *upipe, struct uref *uref,
         }
     }
 
-    switch (v210dec->output_type) {
-        case V2D_OUTPUT_PLANAR_8: {
-            for (int h = 0; h < input_vsize; h++) {
-                uint8_t *y = output_planes[0];
-                uint8_t *u = output_planes[1];
-                uint8_t *v = output_planes[2];
-                const uint32_t *src = (uint32_t*)input_plane;
-
-                int w = (output_hsize / 6) * 6;
-                v210dec->v210_to_planar_8(src, y, u, v, w);
-
-                y += w;
-                u += w >> 1;
-                v += w >> 1;
-                src += (w * 2) / 3;
-
-                if (w < output_hsize - 1) {
-                    READ_PIXELS_8(u, y, v);
-                    uint32_t val = *src++;
-                    *y++ = (val >> 2) & 255;
-
-                    if (w < output_hsize - 3) {
-                        *u++ = (val >> 12) & 255;
-                        *y++ = (val >> 22) & 255;
-
-                        val = rl32(src);
-                        src++;
-                        *v++ = (val >>  2) & 255;
-                        *y++ = (val >> 12) & 255;
-                    }
-                }
-
-                for (int i = 0; i < 3; i++)
-                    output_planes[i] += output_strides[i];
-                input_plane += input_stride;
-            }
-        } break;
-
-        case V2D_OUTPUT_PLANAR_10: {
-            for (int h = 0; h < input_vsize; h++) {
-                uint16_t *y = (uint16_t*)output_planes[0];
-                uint16_t *u = (uint16_t*)output_planes[1];
-                uint16_t *v = (uint16_t*)output_planes[2];
-                const uint32_t *src = (uint32_t*)input_plane;
-
-                int w = (output_hsize / 6) * 6;
-                v210dec->v210_to_planar_10(src, y, u, v, w);
-
-                y += w;
-                u += w >> 1;
-                v += w >> 1;
-                src += (w * 2) / 3;
-
-                if (w < output_hsize - 1) {
-                    READ_PIXELS_10(u, y, v);
-                    uint32_t val = rl32(src);
-                    src++;
-                    *y++ = val & 1023;
-
-                    if (w < output_hsize - 3) {
-                        *u++ = (val >> 10) & 1023;
-                        *y++ = (val >> 20) & 1023;
-
-                        val = rl32(src);
-                        src++;
-                        *v++ = val & 1023;
-                        *y++ = (val >> 10) & 1023;
-                    }
-                }
-
-                for (int i = 0; i < 3; i++)
-                    output_planes[i] += output_strides[i];
-                input_plane += input_stride;
-            }
-        } break;
-
-        default:
-            assert(0);
+    /* Do v210 unpacking, possibly in several threads */
+    struct upipe_v210dec_frame frame;
+    frame.v210dec = v210dec;
+    frame.input_plane = input_plane;
+    frame.input_stride = input_stride;
+    for (int i = 0; i < 3; i++) {
+        frame.output_planes[i] = output_planes[i];
+        frame.output_strides[i] = output_strides[i];
     }
+    frame.output_hsize = output_hsize;
+    frame.input_vsize = input_vsize;
+    uslices_run(v210dec->uslices, upipe_v210dec_unpack_slice, &frame,
+                uslices_get_threads(v210dec->uslices));
 
     uref_pic_plane_unmap(uref, v210_chroma_str, 0, 0, -1, -1);
     for (int i = 0; i < 3; i++)
@@ -456,7 +533,8 @@ static int upipe_v210dec_set_flow_def(struct upipe *upipe, struct uref *flow_def
     if (!ubase_check(uref_pic_flow_get_align(flow_def, &align)))
         align = 0;
 
-    v210dec_setup_asm(upipe, align && (align % UBUF_ALIGN) == 0);
+    v210dec->aligned = align && (align % UBUF_ALIGN) == 0;
+    v210dec_setup_asm(upipe);
 
     struct uref *output_flow = uref_dup(flow_def);
     if (output_flow == NULL)
@@ -521,6 +599,31 @@ static int upipe_v210dec_provide_flow_format(struct upipe *upipe,
 }
 #endif
 
+/** @internal @This sets the number of threads unpacking the pictures.
+ *
+ * @param upipe description structure of the pipe
+ * @param nb_threads number of threads, or 0
+ * @return an error code
+ */
+static int upipe_v210dec_set_nb_threads(struct upipe *upipe,
+                                        unsigned int nb_threads)
+{
+    struct upipe_v210dec *v210dec = upipe_v210dec_from_upipe(upipe);
+    uslices_free(v210dec->uslices);
+    v210dec->uslices = NULL;
+    if (nb_threads <= 1)
+        return UBASE_ERR_NONE;
+
+    /* the thread of the pipe unpacks a range of lines too */
+    v210dec->uslices = uslices_alloc(nb_threads - 1);
+    if (unlikely(v210dec->uslices == NULL)) {
+        upipe_err(upipe, "unable to create unpacking threads");
+        return UBASE_ERR_EXTERNAL;
+    }
+    upipe_dbg_va(upipe, "unpacking with %u threads", nb_threads);
+    return UBASE_ERR_NONE;
+}
+
 /** @internal @This processes control commands on a file source pipe, and
  * checks the status of the pipe afterwards.
  *
@@ -558,6 +661,17 @@ static int upipe_v210dec_control(struct upipe *upipe, int command, va_list args)
             struct uref *flow = va_arg(args, struct uref *);
             return upipe_v210dec_set_flow_def(upipe, flow);
         }
+        case UPIPE_SET_CPU_FLAGS: {
+            struct upipe_v210dec *v210dec = upipe_v210dec_from_upipe(upipe);
+            v210dec->cpu_flags = va_arg(args, uint32_t);
+            v210dec_setup_asm(upipe);
+            return UBASE_ERR_NONE;
+        }
+        case UPIPE_V210DEC_SET_THREADS: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_V210DEC_SIGNATURE)
+            unsigned int nb_threads = va_arg(args, unsigned int);
+            return upipe_v210dec_set_nb_threads(upipe, nb_threads);
+        }
 
         default:
             return UBASE_ERR_UNHANDLED;
@@ -610,6 +724,10 @@ static struct upipe *upipe_v210dec_alloc(struct upipe_mgr *manager,
 
 #undef PRINT_OUTPUT_TYPE
 
+    v210dec->uslices = NULL;
+    v210dec->cpu_flags = UCPU_ALL;
+    v210dec->aligned = false;
+    v210dec_setup_asm(upipe);
     upipe_v210dec_init_urefcount(upipe);
     upipe_v210dec_init_ubuf_mgr(upipe);
     upipe_v210dec_init_output(upipe);
@@ -626,7 +744,9 @@ static struct upipe *upipe_v210dec_alloc(struct upipe_mgr *manager,
  */
 static void upipe_v210dec_free(struct upipe *upipe)
 {
+    struct upipe_v210dec *v210dec = upipe_v210dec_from_upipe(upipe);
     upipe_throw_dead(upipe);
+    uslices_free(v210dec->uslices);
     upipe_v210dec_clean_input(upipe);
     upipe_v210dec_clean_output(upipe);
     upipe_v210dec_clean_ubuf_mgr(upipe);
@@ -41,6 +41,8 @@
 #include <upipe/upipe_helper_ubuf_mgr.h>
 #include <upipe/upipe_helper_output.h>
 #include <upipe/upipe_helper_input.h>
+#include <upipe/uslices.h>
+#include <upipe/ucpu.h>
 
 #include <stdlib.h>
 #include <stdbool.h>
@@ -104,6 +106,10 @@ struct upipe_v210enc {
     upipe_v210enc_pack_line_8 pack_line_8;
     /** 10-bit line packing function **/
     upipe_v210enc_pack_line_10 pack_line_10;
+    /** instruction set extensions allowed for the kernels */
+    uint32_t cpu_flags;
+    /** worker threads packing ranges of lines, or NULL */
+    struct uslices *uslices;
 
     /** input chroma map */
     const char *input_chroma_map[UPIPE_V210_MAX_PLANES+1];
@@ -159,6 +165,129 @@ static inline void wl32(uint8_t *dst, uint32_t u)
         dst += 4;                       \
     } while (0)
 
+/** @internal @This describes a picture being packed. */
+struct upipe_v210enc_frame {
+    /** pointer to the pipe */
+    struct upipe_v210enc *upipe_v210enc;
+    /** input planes */
+    const uint8_t *input_planes[UPIPE_V210_MAX_PLANES];
+    /** input strides */
+    int input_strides[UPIPE_V210_MAX_PLANES];
+    /** output plane */
+    uint8_t *output_plane;
+    /** output stride */
+    size_t stride;
+    /** horizontal size */
+    size_t input_hsize;
+    /** vertical size */
+    size_t input_vsize;
+};
+
+/** @internal @This packs a range of lines of a picture.
+ *
+ * @param opaque pointer to the description of the picture
+ * @param slice index of the range of lines
+ * @param nb_slices number of ranges of lines
+ */
+static void upipe_v210enc_pack_slice(void *opaque, unsigned int slice,
+                                     unsigned int nb_slices)
+{
+    const struct upipe_v210enc_frame *frame = opaque;
+    const struct upipe_v210enc *upipe_v210enc = frame->upipe_v210enc;
+    const uint8_t * const *input_planes = frame->input_planes;
+    const int *input_strides = frame->input_strides;
+    uint8_t *output_plane = frame->output_plane;
+    size_t stride = frame->stride;
+    size_t input_hsize = frame->input_hsize;
+    size_t h_start = frame->input_vsize * slice / nb_slices;
+    size_t h_end = frame->input_vsize * (slice + 1) / nb_slices;
+    int line_padding = stride - ((input_hsize * 8 + 11) / 12) * 4;
+    size_t h;
+    int w;
+
+    if (upipe_v210enc->input_bit_depth == 10) {
+        for (h = h_start; h < h_end; h++) {
+            const uint16_t *y = (const uint16_t *)
+                (input_planes[0] + h * input_strides[0]);
+            const uint16_t *u = (const uint16_t *)
+                (input_planes[1] + h * input_strides[1]);
+            const uint16_t *v = (const uint16_t *)
+                (input_planes[2] + h * input_strides[2]);
+            uint8_t *dst = output_plane + h * stride;
+            uint32_t val = 0;
+            w = (input_hsize / 6) * 6;
+            upipe_v210enc->pack_line_10(y, u, v, dst, w);
+
+            y += w;
+            u += w >> 1;
+            v += w >> 1;
+            dst += (w / 6) * 16;
+            if (w < input_hsize - 1) {
+                WRITE_PIXELS(u, y, v);
+
+                val = CLIP(*y++);
+                if (w == input_hsize - 2) {
+                    wl32(dst, val);
+                    dst += 4;
+                }
+            }
+            if (w < input_hsize - 3) {
+                val |= (CLIP(*u++) << 10) | (CLIP(*y++) << 20);
+                wl32(dst, val);
+                dst += 4;
+
+                val = CLIP(*v++) | (CLIP(*y++) << 10);
+                wl32(dst, val);
+                dst += 4;
+            }
+
+            memset(dst, 0, line_padding);
+        }
+    }
+    else {
+        for (h = h_start; h < h_end; h++) {
+            const uint8_t *y = input_planes[0] + h * input_strides[0];
+            const uint8_t *u = input_planes[1] + h * input_strides[1];
+            const uint8_t *v = input_planes[2] + h * input_strides[2];
+            uint8_t *dst = output_plane + h * stride;
+            uint32_t val = 0;
+            w = (input_hsize / 12) * 12;
+            upipe_v210enc->pack_line_8(y, u, v, dst, w);
+
+            y += w;
+            u += w >> 1;
+            v += w >> 1;
+            dst += (w / 12) * 32;
+
+            for (; w < input_hsize - 5; w += 6) {
+                WRITE_PIXELS8(u, y, v);
+                WRITE_PIXELS8(y, u, y);
+                WRITE_PIXELS8(v, y, u);
+                WRITE_PIXELS8(y, v, y);
+            }
+            if (w < input_hsize - 1) {
+                WRITE_PIXELS8(u, y, v);
+
+                val = CLIP8(*y++) << 2;
+                if (w == input_hsize - 2) {
+                    wl32(dst, val);
+                    dst += 4;
+                }
+            }
+            if (w < input_hsize - 3) {
+                val |= (CLIP8(*u++) << 12) | (CLIP8(*y++) << 22);
+                wl32(dst, val);
+                dst += 4;
+
+                val = (CLIP8(*v++) << 2) | (CLIP8(*y++) << 12);
+                wl32(dst, val);
+                dst += 4;
+            }
+            memset(dst, 0, line_padding);
+        }
+    }
+}
+
 /** @internal @This handles data.
  *
  * @param upipe description structure of the pipe
@@ -253,95 +382,19 @@ static bool upipe_v210enc_handle(struct upipe *upipe, struct uref *uref,
         return true;
     }
 
-    /* Do v210 packing */
-    int line_padding = stride - ((input_hsize * 8 + 11) / 12) * 4;
-    uint8_t *dst = output_plane;
-    int h, w;
-    if (upipe_v210enc->input_bit_depth == 10) {
-        const uint16_t *y = (const uint16_t *)input_planes[0];
-        const uint16_t *u = (const uint16_t *)input_planes[1];
-        const uint16_t *v = (const uint16_t *)input_planes[2];
-        for (h = 0; h < input_vsize; h++) {
-            uint32_t val = 0;
-            w = (input_hsize / 6) * 6;
-            upipe_v210enc->pack_line_10(y, u, v, dst, w);
-
-            y += w;
-            u += w >> 1;
-            v += w >> 1;
-            dst += (w / 6) * 16;
-            if (w < input_hsize - 1) {
-                WRITE_PIXELS(u, y, v);
-
-                val = CLIP(*y++);
-                if (w == input_hsize - 2) {
-                    wl32(dst, val);
-                    dst += 4;
-                }
-            }
-            if (w < input_hsize - 3) {
-                val |= (CLIP(*u++) << 10) | (CLIP(*y++) << 20);
-                wl32(dst, val);
-                dst += 4;
-
-                val = CLIP(*v++) | (CLIP(*y++) << 10);
-                wl32(dst, val);
-                dst += 4;
-            }
-
-            memset(dst, 0, line_padding);
-            dst += line_padding;
-            y += input_strides[0] / 2 - input_hsize;
-            u += input_strides[1] / 2 - input_hsize / 2;
-            v += input_strides[2] / 2 - input_hsize / 2;
-        }
-    }
-    else {
-        const uint8_t *y = input_planes[0];
-        const uint8_t *u = input_planes[1];
-        const uint8_t *v = input_planes[2];
-        for (h = 0; h < input_vsize; h++) {
-            uint32_t val = 0;
-            w = (input_hsize / 12) * 12;
-            upipe_v210enc->pack_line_8(y, u, v, dst, w);
-
-            y += w;
-            u += w >> 1;
-            v += w >> 1;
-            dst += (w / 12) * 32;
-
-            for (; w < input_hsize - 5; w += 6) {
-                WRITE_PIXELS8(u, y, v);
-                WRITE_PIXELS8(y, u, y);
-                WRITE_PIXELS8(v, y, u);
-                WRITE_PIXELS8(y, v, y);
-            }
-            if (w < input_hsize - 1) {
-                WRITE_PIXELS8(u, y, v);
-
-                val = CLIP8(*y++) << 2;
-                if (w == input_hsize - 2) {
-                    wl32(dst, val);
-                    dst += 4;
-                }
-            }
-            if (w < input_hsize - 3) {
-                val |= (CLIP8(*u++) << 12) | (CLIP8(*y++) << 22);
-                wl32(dst, val);
-                dst += 4;
-
-                val = (CLIP8(*v++) << 2) | (CLIP8(*y++) << 12);
-                wl32(dst, val);
-                dst += 4;
-            }
-            memset(dst, 0, line_padding);
-            dst += line_padding;
-
-            y += input_strides[0] - input_hsize;
-            u += input_strides[1] - input_hsize / 2;
-            v += input_strides[2] - input_hsize / 2;
-        }
+    /* Do v210 packing, possibly in several threads */
+    struct upipe_v210enc_frame frame;
+    frame.upipe_v210enc = upipe_v210enc;
+    for (i = 0; i < UPIPE_V210_MAX_PLANES; i++) {
+        frame.input_planes[i] = input_planes[i];
+        frame.input_strides[i] = input_strides[i];
     }
+    frame.output_plane = output_plane;
+    frame.stride = stride;
+    frame.input_hsize = input_hsize;
+    frame.input_vsize = input_vsize;
+    uslices_run(upipe_v210enc->uslices, upipe_v210enc_pack_slice, &frame,
+                uslices_get_threads(upipe_v210enc->uslices));
 
     /* unmap pictures */
     for (i = 0; i < UPIPE_V210_MAX_PLANES &&
@@ -518,6 +571,79 @@ static int upipe_v210enc_provide_flow_format(struct upipe *upipe,
     return urequest_provide_flow_format(request, flow_format);
 }
 
+/** @internal @This sets the number of threads packing the pictures.
+ *
+ * @param upipe description structure of the pipe
+ * @param nb_threads number of threads, or 0
+ * @return an error code
+ */
+static int upipe_v210enc_set_nb_threads(struct upipe *upipe,
+                                        unsigned int nb_threads)
+{
+    struct upipe_v210enc *upipe_v210enc = upipe_v210enc_from_upipe(upipe);
+    uslices_free(upipe_v210enc->uslices);
+    upipe_v210enc->uslices = NULL;
+    if (nb_threads <= 1)
+        return UBASE_ERR_NONE;
+
+    /* the thread of the pipe packs a range of lines too */
+    upipe_v210enc->uslices = uslices_alloc(nb_threads - 1);
+    if (unlikely(upipe_v210enc->uslices == NULL)) {
+        upipe_err(upipe, "unable to create packing threads");
+        return UBASE_ERR_EXTERNAL;
+    }
+    upipe_dbg_va(upipe, "packing with %u threads", nb_threads);
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This describes an implementation of the packing kernels. */
+struct upipe_v210enc_kernel {
+    /** required instruction set extensions */
+    uint32_t cpu_flags;
+    /** 8-bit line packing function */
+    upipe_v210enc_pack_line_8 pack_line_8;
+    /** 10-bit line packing function */
+    upipe_v210enc_pack_line_10 pack_line_10;
+};
+
+/** @internal @This lists the kernels, from the most to the least preferred */
+static const struct upipe_v210enc_kernel upipe_v210enc_kernels[] = {
+#if defined(__x86_64__)
+    { UCPU_AVX512, upipe_v210_planar_pack_8_avx512,
+      upipe_v210_planar_pack_10_avx512 },
+#endif
+#if defined(__aarch64__) && !defined(__AARCH64EB__)
+    { UCPU_NEON, upipe_v210_planar_pack_8_neon,
+      upipe_v210_planar_pack_10_neon },
+#endif
+#if defined(HAVE_X86ASM)
+#if defined(__i686__) || defined(__x86_64__)
+    { UCPU_AVX2, upipe_v210_planar_pack_8_avx2,
+      upipe_v210_planar_pack_10_avx2 },
+    /* there is no AVX version of the 10-bit kernel */
+    { UCPU_AVX | UCPU_SSSE3, upipe_v210_planar_pack_8_avx,
+      upipe_v210_planar_pack_10_ssse3 },
+    { UCPU_SSSE3, upipe_v210_planar_pack_8_ssse3,
+      upipe_v210_planar_pack_10_ssse3 },
+#endif
+#endif
+    { 0, upipe_v210enc_planar_pack_8_c, upipe_v210enc_planar_pack_10_c },
+};
+
+/** @internal @This selects the packing functions.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_v210enc_setup_asm(struct upipe *upipe)
+{
+    struct upipe_v210enc *upipe_v210enc = upipe_v210enc_from_upipe(upipe);
+    const struct upipe_v210enc_kernel *kernel =
+        ucpu_select(upipe_v210enc_kernels,
+                    ucpu_flags() & upipe_v210enc->cpu_flags);
+    upipe_v210enc->pack_line_8  = kernel->pack_line_8;
+    upipe_v210enc->pack_line_10 = kernel->pack_line_10;
+}
+
 /** @internal @This processes control commands on a file source pipe, and
  * checks the status of the pipe afterwards.
  *
@@ -553,6 +679,18 @@ static int upipe_v210enc_control(struct upipe *upipe, int command, va_list args)
             struct uref *flow = va_arg(args, struct uref *);
             return upipe_v210enc_set_flow_def(upipe, flow);
         }
+        case UPIPE_SET_CPU_FLAGS: {
+            struct upipe_v210enc *upipe_v210enc =
+                upipe_v210enc_from_upipe(upipe);
+            upipe_v210enc->cpu_flags = va_arg(args, uint32_t);
+            upipe_v210enc_setup_asm(upipe);
+            return UBASE_ERR_NONE;
+        }
+        case UPIPE_V210ENC_SET_THREADS: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_V210ENC_SIGNATURE)
+            unsigned int nb_threads = va_arg(args, unsigned int);
+            return upipe_v210enc_set_nb_threads(upipe, nb_threads);
+        }
 
         default:
             return UBASE_ERR_UNHANDLED;
@@ -577,24 +715,9 @@ static struct upipe *upipe_v210enc_alloc(struct upipe_mgr *mgr,
 
     struct upipe_v210enc *upipe_v210enc = upipe_v210enc_from_upipe(upipe);
 
-    upipe_v210enc->pack_line_8  = upipe_v210enc_planar_pack_8_c;
-    upipe_v210enc->pack_line_10 = upipe_v210enc_planar_pack_10_c;
-
-#if defined(HAVE_X86ASM)
-#if defined(__i686__) || defined(__x86_64__)
-    if (__builtin_cpu_supports("avx2")) {
-        upipe_v210enc->pack_line_8  = upipe_v210_planar_pack_8_avx2;
-        upipe_v210enc->pack_line_10 = upipe_v210_planar_pack_10_avx2;
-    } else {
-        if (__builtin_cpu_supports("ssse3")) {
-            upipe_v210enc->pack_line_8  = upipe_v210_planar_pack_8_ssse3;
-            upipe_v210enc->pack_line_10 = upipe_v210_planar_pack_10_ssse3;
-        }
-        if (__builtin_cpu_supports("avx"))
-            upipe_v210enc->pack_line_8  = upipe_v210_planar_pack_8_avx;
-    }
-#endif
-#endif
+    upipe_v210enc->cpu_flags = UCPU_ALL;
+    upipe_v210enc_setup_asm(upipe);
+    upipe_v210enc->uslices = NULL;
 
     upipe_v210enc_init_urefcount(upipe);
     upipe_v210enc_init_ubuf_mgr(upipe);
@@ -611,7 +734,9 @@ static struct upipe *upipe_v210enc_alloc(struct upipe_mgr *mgr,
  */
 static void upipe_v210enc_free(struct upipe *upipe)
 {
+    struct upipe_v210enc *upipe_v210enc = upipe_v210enc_from_upipe(upipe);
     upipe_throw_dead(upipe);
+    uslices_free(upipe_v210enc->uslices);
     upipe_v210enc_clean_input(upipe);
     upipe_v210enc_clean_output(upipe);
     upipe_v210enc_clean_ubuf_mgr(upipe);
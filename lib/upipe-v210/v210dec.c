@@ -79,3 +79,183 @@ void upipe_v210_to_planar_10_c(const void *src, uint16_t *y, uint16_t *u, uint16
         READ_PIXELS_10(y, v, y);
     }
 }
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+
+/** word permutations gathering the luma (y0-y23) and the chroma (u0-u11 and
+ * v0-v11 at 16-27) of 4 v210 blocks from the first and second components
+ * of the words (indices 0-31) and their third component (32-63) */
+static const uint16_t upipe_v210dec_avx512_perm[2][32] = {
+    {  1,  2, 34,  5,  6, 38,  9, 10, 42, 13, 14, 46, 17, 18, 50, 21,
+      22, 54, 25, 26, 58, 29, 30, 62,  0,  0,  0,  0,  0,  0,  0,  0 },
+    {  0,  3, 36,  8, 11, 44, 16, 19, 52, 24, 27, 60,  0,  0,  0,  0,
+      32,  4,  7, 40, 12, 15, 48, 20, 23, 56, 28, 31,  0,  0,  0,  0 },
+};
+
+/** @internal @This unpacks 4 v210 blocks into 24 10-bit pixels. */
+__attribute__((target("avx512f,avx512bw,avx512vl")))
+static inline void upipe_v210dec_avx512_unpack(const uint8_t *src,
+                                               __m512i *y, __m512i *uv)
+{
+    const __m512i mask = _mm512_set1_epi32(0x3ff);
+    __m512i in = _mm512_loadu_si512(src);
+    __m512i a = _mm512_and_si512(in, mask);
+    __m512i b = _mm512_and_si512(_mm512_srli_epi32(in, 10), mask);
+    __m512i c = _mm512_and_si512(_mm512_srli_epi32(in, 20), mask);
+    __m512i ab = _mm512_or_si512(a, _mm512_slli_epi32(b, 16));
+    *y = _mm512_permutex2var_epi16(ab,
+            _mm512_loadu_si512(upipe_v210dec_avx512_perm[0]), c);
+    *uv = _mm512_permutex2var_epi16(ab,
+            _mm512_loadu_si512(upipe_v210dec_avx512_perm[1]), c);
+}
+
+__attribute__((target("avx512f,avx512bw,avx512vl")))
+void upipe_v210_to_planar_10_avx512(const void *src, uint16_t *y, uint16_t *u, uint16_t *v, uintptr_t pixels)
+{
+    const uint8_t *s = src;
+    for ( ; pixels >= 24; pixels -= 24) {
+        __m512i ly, luv;
+        upipe_v210dec_avx512_unpack(s, &ly, &luv);
+        _mm512_mask_storeu_epi16(y, 0xffffff, ly);
+        _mm256_mask_storeu_epi16(u, 0xfff, _mm512_castsi512_si256(luv));
+        _mm256_mask_storeu_epi16(v, 0xfff, _mm512_extracti64x4_epi64(luv, 1));
+        s += 64;
+        y += 24;
+        u += 12;
+        v += 12;
+    }
+
+    if (pixels > 0)
+        upipe_v210_to_planar_10_c(s, y, u, v, pixels);
+}
+
+__attribute__((target("avx512f,avx512bw,avx512vl")))
+void upipe_v210_to_planar_8_avx512(const void *src, uint8_t *y, uint8_t *u, uint8_t *v, uintptr_t pixels)
+{
+    const uint8_t *s = src;
+    for ( ; pixels >= 24; pixels -= 24) {
+        __m512i ly, luv;
+        upipe_v210dec_avx512_unpack(s, &ly, &luv);
+        __m256i y8 = _mm512_cvtepi16_epi8(_mm512_srli_epi16(ly, 2));
+        __m256i uv8 = _mm512_cvtepi16_epi8(_mm512_srli_epi16(luv, 2));
+        _mm256_mask_storeu_epi8(y, 0xffffff, y8);
+        _mm_mask_storeu_epi8(u, 0xfff, _mm256_castsi256_si128(uv8));
+        _mm_mask_storeu_epi8(v, 0xfff, _mm256_extracti128_si256(uv8, 1));
+        s += 64;
+        y += 24;
+        u += 12;
+        v += 12;
+    }
+
+    if (pixels > 0)
+        upipe_v210_to_planar_8_c(s, y, u, v, pixels);
+}
+#endif
+
+#if defined(__aarch64__) && !defined(__AARCH64EB__)
+#include <arm_neon.h>
+#include <string.h>
+
+/** byte lookups gathering y0-y7, y8-y15, y16-y23, u0-u7, v0-v7 and
+ * u8-u11, v8-v11 of 4 v210 blocks, first from the table of the first and
+ * second components of the words, then from the table of their third
+ * component (0xff keeps the octet) */
+static const uint8_t upipe_v210dec_neon_tbl[6][2][16] = {
+    { { 32, 33, 2, 3, 0xff, 0xff, 36, 37, 6, 7, 0xff, 0xff, 40, 41, 10, 11 },
+      { 0xff, 0xff, 0xff, 0xff, 2, 3, 0xff, 0xff, 0xff, 0xff, 6, 7, 0xff, 0xff, 0xff, 0xff } },
+    { { 0xff, 0xff, 44, 45, 14, 15, 0xff, 0xff, 48, 49, 18, 19, 0xff, 0xff, 52, 53 },
+      { 10, 11, 0xff, 0xff, 0xff, 0xff, 14, 15, 0xff, 0xff, 0xff, 0xff, 18, 19, 0xff, 0xff } },
+    { { 22, 23, 0xff, 0xff, 56, 57, 26, 27, 0xff, 0xff, 60, 61, 30, 31, 0xff, 0xff },
+      { 0xff, 0xff, 22, 23, 0xff, 0xff, 0xff, 0xff, 26, 27, 0xff, 0xff, 0xff, 0xff, 30, 31 } },
+    { { 0, 1, 34, 35, 0xff, 0xff, 8, 9, 42, 43, 0xff, 0xff, 16, 17, 50, 51 },
+      { 0xff, 0xff, 0xff, 0xff, 4, 5, 0xff, 0xff, 0xff, 0xff, 12, 13, 0xff, 0xff, 0xff, 0xff } },
+    { { 0xff, 0xff, 4, 5, 38, 39, 0xff, 0xff, 12, 13, 46, 47, 0xff, 0xff, 20, 21 },
+      { 0, 1, 0xff, 0xff, 0xff, 0xff, 8, 9, 0xff, 0xff, 0xff, 0xff, 16, 17, 0xff, 0xff } },
+    { { 0xff, 0xff, 24, 25, 58, 59, 0xff, 0xff, 54, 55, 0xff, 0xff, 28, 29, 62, 63 },
+      { 20, 21, 0xff, 0xff, 0xff, 0xff, 28, 29, 0xff, 0xff, 24, 25, 0xff, 0xff, 0xff, 0xff } },
+};
+
+/** @internal @This unpacks 4 v210 blocks into 24 10-bit pixels.
+ *
+ * @param src source of the 64 octets
+ * @param out filled in with y0-y7, y8-y15, y16-y23, u0-u7, v0-v7 and
+ * u8-u11, v8-v11
+ */
+static inline void upipe_v210dec_neon_unpack(const uint8_t *src,
+                                             uint16x8_t out[6])
+{
+    const uint32x4_t mask = vdupq_n_u32(0x3ff);
+    uint16x8_t c[3][2];
+    for (int i = 0; i < 2; i++) {
+        uint32x4_t in0 = vreinterpretq_u32_u8(vld1q_u8(src + 32 * i));
+        uint32x4_t in1 = vreinterpretq_u32_u8(vld1q_u8(src + 32 * i + 16));
+        c[0][i] = vcombine_u16(vmovn_u32(vandq_u32(in0, mask)),
+                               vmovn_u32(vandq_u32(in1, mask)));
+        c[1][i] = vcombine_u16(vmovn_u32(vandq_u32(vshrq_n_u32(in0, 10), mask)),
+                               vmovn_u32(vandq_u32(vshrq_n_u32(in1, 10), mask)));
+        c[2][i] = vcombine_u16(vmovn_u32(vandq_u32(vshrq_n_u32(in0, 20), mask)),
+                               vmovn_u32(vandq_u32(vshrq_n_u32(in1, 20), mask)));
+    }
+
+    uint8x16x4_t t1 = { {
+        vreinterpretq_u8_u16(c[0][0]), vreinterpretq_u8_u16(c[0][1]),
+        vreinterpretq_u8_u16(c[1][0]), vreinterpretq_u8_u16(c[1][1])
+    } };
+    uint8x16x2_t t2 = { {
+        vreinterpretq_u8_u16(c[2][0]), vreinterpretq_u8_u16(c[2][1])
+    } };
+    for (int i = 0; i < 6; i++)
+        out[i] = vreinterpretq_u16_u8(vqtbx2q_u8(
+                    vqtbl4q_u8(t1, vld1q_u8(upipe_v210dec_neon_tbl[i][0])),
+                    t2, vld1q_u8(upipe_v210dec_neon_tbl[i][1])));
+}
+
+void upipe_v210_to_planar_10_neon(const void *src, uint16_t *y, uint16_t *u, uint16_t *v, uintptr_t pixels)
+{
+    const uint8_t *s = src;
+    for ( ; pixels >= 24; pixels -= 24) {
+        uint16x8_t out[6];
+        upipe_v210dec_neon_unpack(s, out);
+        vst1q_u16(y, out[0]);
+        vst1q_u16(y + 8, out[1]);
+        vst1q_u16(y + 16, out[2]);
+        vst1q_u16(u, out[3]);
+        vst1_u16(u + 8, vget_low_u16(out[5]));
+        vst1q_u16(v, out[4]);
+        vst1_u16(v + 8, vget_high_u16(out[5]));
+        s += 64;
+        y += 24;
+        u += 12;
+        v += 12;
+    }
+
+    if (pixels > 0)
+        upipe_v210_to_planar_10_c(s, y, u, v, pixels);
+}
+
+void upipe_v210_to_planar_8_neon(const void *src, uint8_t *y, uint8_t *u, uint8_t *v, uintptr_t pixels)
+{
+    const uint8_t *s = src;
+    for ( ; pixels >= 24; pixels -= 24) {
+        uint16x8_t out[6];
+        upipe_v210dec_neon_unpack(s, out);
+        vst1_u8(y, vshrn_n_u16(out[0], 2));
+        vst1_u8(y + 8, vshrn_n_u16(out[1], 2));
+        vst1_u8(y + 16, vshrn_n_u16(out[2], 2));
+        vst1_u8(u, vshrn_n_u16(out[3], 2));
+        vst1_u8(v, vshrn_n_u16(out[4], 2));
+        uint32x2_t uv1 = vreinterpret_u32_u8(vshrn_n_u16(out[5], 2));
+        uint32_t u1 = vget_lane_u32(uv1, 0), v1 = vget_lane_u32(uv1, 1);
+        memcpy(u + 8, &u1, sizeof (u1));
+        memcpy(v + 8, &v1, sizeof (v1));
+        s += 64;
+        y += 24;
+        u += 12;
+        v += 12;
+    }
+
+    if (pixels > 0)
+        upipe_v210_to_planar_8_c(s, y, u, v, pixels);
+}
+#endif
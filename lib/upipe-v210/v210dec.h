@@ -10,3 +10,13 @@ void upipe_v210_to_planar_10_aligned_avx2 (const void *src, uint16_t *y, uint16_
 void upipe_v210_to_planar_8_aligned_ssse3(const void *src, uint8_t *y, uint8_t *u, uint8_t *v, uintptr_t pixels);
 void upipe_v210_to_planar_8_aligned_avx  (const void *src, uint8_t *y, uint8_t *u, uint8_t *v, uintptr_t pixels);
 void upipe_v210_to_planar_8_aligned_avx2 (const void *src, uint8_t *y, uint8_t *u, uint8_t *v, uintptr_t pixels);
+
+/* process 24 pixels per iteration, no alignment required */
+#if defined(__x86_64__)
+void upipe_v210_to_planar_10_avx512(const void *src, uint16_t *y, uint16_t *u, uint16_t *v, uintptr_t pixels);
+void upipe_v210_to_planar_8_avx512 (const void *src, uint8_t *y, uint8_t *u, uint8_t *v, uintptr_t pixels);
+#endif
+#if defined(__aarch64__) && !defined(__AARCH64EB__)
+void upipe_v210_to_planar_10_neon(const void *src, uint16_t *y, uint16_t *u, uint16_t *v, uintptr_t pixels);
+void upipe_v210_to_planar_8_neon (const void *src, uint8_t *y, uint8_t *u, uint8_t *v, uintptr_t pixels);
+#endif
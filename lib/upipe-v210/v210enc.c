@@ -91,3 +91,208 @@ void upipe_v210enc_planar_pack_10_c(const uint16_t *y, const uint16_t *u,
         WRITE_PIXELS(y, v, y);
     }
 }
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+
+/** word permutations gathering the first, second and third components of
+ * the 16 words of 4 v210 blocks from the luma vector (indices 0-23) and the
+ * chroma vector (u at 32-43, v at 48-59) */
+static const uint16_t upipe_v210enc_avx512_perm[3][32] = {
+    { 32, 0,  1, 0, 49, 0,  4, 0, 35, 0,  7, 0, 52, 0, 10, 0,
+      38, 0, 13, 0, 55, 0, 16, 0, 41, 0, 19, 0, 58, 0, 22, 0 },
+    {  0, 0, 33, 0,  3, 0, 50, 0,  6, 0, 36, 0,  9, 0, 53, 0,
+      12, 0, 39, 0, 15, 0, 56, 0, 18, 0, 42, 0, 21, 0, 59, 0 },
+    { 48, 0,  2, 0, 34, 0,  5, 0, 51, 0,  8, 0, 37, 0, 11, 0,
+      54, 0, 14, 0, 40, 0, 17, 0, 57, 0, 20, 0, 43, 0, 23, 0 },
+};
+
+/** @internal @This packs 24 clipped 10-bit pixels into 4 v210 blocks. */
+__attribute__((target("avx512f,avx512bw,avx512vl")))
+static inline __m512i upipe_v210enc_avx512_pack(__m512i y, __m512i uv)
+{
+    const __mmask32 even = 0x55555555;
+    __m512i a = _mm512_maskz_permutex2var_epi16(even, y,
+            _mm512_loadu_si512(upipe_v210enc_avx512_perm[0]), uv);
+    __m512i b = _mm512_maskz_permutex2var_epi16(even, y,
+            _mm512_loadu_si512(upipe_v210enc_avx512_perm[1]), uv);
+    __m512i c = _mm512_maskz_permutex2var_epi16(even, y,
+            _mm512_loadu_si512(upipe_v210enc_avx512_perm[2]), uv);
+    return _mm512_or_si512(a, _mm512_or_si512(_mm512_slli_epi32(b, 10),
+                                              _mm512_slli_epi32(c, 20)));
+}
+
+__attribute__((target("avx512f,avx512bw,avx512vl")))
+void upipe_v210_planar_pack_10_avx512(const uint16_t *y, const uint16_t *u,
+                                      const uint16_t *v, uint8_t *dst, ptrdiff_t width)
+{
+    const __m512i min = _mm512_set1_epi16(4);
+    const __m512i max = _mm512_set1_epi16(1019);
+
+    for ( ; width >= 24; width -= 24) {
+        __m512i ly = _mm512_maskz_loadu_epi16(0xffffff, y);
+        __m512i luv = _mm512_inserti64x4(
+                _mm512_castsi256_si512(_mm256_maskz_loadu_epi16(0xfff, u)),
+                _mm256_maskz_loadu_epi16(0xfff, v), 1);
+        ly = _mm512_min_epu16(_mm512_max_epu16(ly, min), max);
+        luv = _mm512_min_epu16(_mm512_max_epu16(luv, min), max);
+        _mm512_storeu_si512(dst, upipe_v210enc_avx512_pack(ly, luv));
+        y += 24;
+        u += 12;
+        v += 12;
+        dst += 64;
+    }
+
+    if (width > 0)
+        upipe_v210enc_planar_pack_10_c(y, u, v, dst, width);
+}
+
+__attribute__((target("avx512f,avx512bw,avx512vl")))
+void upipe_v210_planar_pack_8_avx512(const uint8_t *y, const uint8_t *u,
+                                     const uint8_t *v, uint8_t *dst, ptrdiff_t width)
+{
+    const __m512i min = _mm512_set1_epi16(1);
+    const __m512i max = _mm512_set1_epi16(254);
+
+    for ( ; width >= 24; width -= 24) {
+        __m512i ly = _mm512_cvtepu8_epi16(_mm256_maskz_loadu_epi8(0xffffff, y));
+        __m512i luv = _mm512_inserti64x4(_mm512_castsi256_si512(
+                    _mm256_cvtepu8_epi16(_mm_maskz_loadu_epi8(0xfff, u))),
+                _mm256_cvtepu8_epi16(_mm_maskz_loadu_epi8(0xfff, v)), 1);
+        ly = _mm512_slli_epi16(_mm512_min_epu16(_mm512_max_epu16(ly, min),
+                                                max), 2);
+        luv = _mm512_slli_epi16(_mm512_min_epu16(_mm512_max_epu16(luv, min),
+                                                 max), 2);
+        _mm512_storeu_si512(dst, upipe_v210enc_avx512_pack(ly, luv));
+        y += 24;
+        u += 12;
+        v += 12;
+        dst += 64;
+    }
+
+    if (width > 0)
+        upipe_v210enc_planar_pack_8_c(y, u, v, dst, width);
+}
+#endif
+
+#if defined(__aarch64__) && !defined(__AARCH64EB__)
+#include <arm_neon.h>
+#include <string.h>
+
+/** byte lookups gathering the first, second and third components of the
+ * 8 words of 2 v210 blocks, first from the luma (y0-y23) and u0-u7 table,
+ * then from the v0-v7 and u8-u11, v8-v11 table (0xff keeps the octet) */
+static const uint8_t upipe_v210enc_neon_tbl[2][3][2][16] = {
+    {
+        { { 48, 49, 2, 3, 0xff, 0xff, 8, 9, 54, 55, 14, 15, 0xff, 0xff, 20, 21 },
+          { 0xff, 0xff, 0xff, 0xff, 2, 3, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 8, 9, 0xff, 0xff } },
+        { { 0, 1, 50, 51, 6, 7, 0xff, 0xff, 12, 13, 56, 57, 18, 19, 0xff, 0xff },
+          { 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 4, 5, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 10, 11 } },
+        { { 0xff, 0xff, 4, 5, 52, 53, 10, 11, 0xff, 0xff, 16, 17, 58, 59, 22, 23 },
+          { 0, 1, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 6, 7, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff } },
+    }, {
+        { { 60, 61, 26, 27, 0xff, 0xff, 32, 33, 0xff, 0xff, 38, 39, 0xff, 0xff, 44, 45 },
+          { 0xff, 0xff, 0xff, 0xff, 14, 15, 0xff, 0xff, 18, 19, 0xff, 0xff, 28, 29, 0xff, 0xff } },
+        { { 24, 25, 62, 63, 30, 31, 0xff, 0xff, 36, 37, 0xff, 0xff, 42, 43, 0xff, 0xff },
+          { 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 24, 25, 0xff, 0xff, 20, 21, 0xff, 0xff, 30, 31 } },
+        { { 0xff, 0xff, 28, 29, 0xff, 0xff, 34, 35, 0xff, 0xff, 40, 41, 0xff, 0xff, 46, 47 },
+          { 12, 13, 0xff, 0xff, 16, 17, 0xff, 0xff, 26, 27, 0xff, 0xff, 22, 23, 0xff, 0xff } },
+    },
+};
+
+/** @internal @This packs 24 clipped 10-bit pixels into 4 v210 blocks.
+ *
+ * @param y luma y0-y23
+ * @param u0 chroma u0-u7
+ * @param v0 chroma v0-v7
+ * @param uv1 chroma u8-u11 and v8-v11
+ * @param dst destination of the 64 octets
+ */
+static inline void upipe_v210enc_neon_pack(const uint16x8_t y[3],
+                                           uint16x8_t u0, uint16x8_t v0,
+                                           uint16x8_t uv1, uint8_t *dst)
+{
+    uint8x16x4_t t1 = { {
+        vreinterpretq_u8_u16(y[0]), vreinterpretq_u8_u16(y[1]),
+        vreinterpretq_u8_u16(y[2]), vreinterpretq_u8_u16(u0)
+    } };
+    uint8x16x2_t t2 = { {
+        vreinterpretq_u8_u16(v0), vreinterpretq_u8_u16(uv1)
+    } };
+
+    for (int i = 0; i < 2; i++) {
+        uint16x8_t c[3];
+        for (int j = 0; j < 3; j++)
+            c[j] = vreinterpretq_u16_u8(vqtbx2q_u8(
+                        vqtbl4q_u8(t1, vld1q_u8(upipe_v210enc_neon_tbl[i][j][0])),
+                        t2, vld1q_u8(upipe_v210enc_neon_tbl[i][j][1])));
+
+        /* low and high halves of the words */
+        uint16x8_t lo = vorrq_u16(c[0], vshlq_n_u16(c[1], 10));
+        uint16x8_t hi = vorrq_u16(vshrq_n_u16(c[1], 6), vshlq_n_u16(c[2], 4));
+        vst1q_u8(dst, vreinterpretq_u8_u16(vzip1q_u16(lo, hi)));
+        vst1q_u8(dst + 16, vreinterpretq_u8_u16(vzip2q_u16(lo, hi)));
+        dst += 32;
+    }
+}
+
+void upipe_v210_planar_pack_10_neon(const uint16_t *y, const uint16_t *u,
+                                    const uint16_t *v, uint8_t *dst, ptrdiff_t width)
+{
+    const uint16x8_t min = vdupq_n_u16(4);
+    const uint16x8_t max = vdupq_n_u16(1019);
+
+    for ( ; width >= 24; width -= 24) {
+        uint16x8_t ly[3];
+        for (int i = 0; i < 3; i++)
+            ly[i] = vminq_u16(vmaxq_u16(vld1q_u16(y + 8 * i), min), max);
+        uint16x8_t u0 = vminq_u16(vmaxq_u16(vld1q_u16(u), min), max);
+        uint16x8_t v0 = vminq_u16(vmaxq_u16(vld1q_u16(v), min), max);
+        uint16x8_t uv1 = vminq_u16(vmaxq_u16(
+                    vcombine_u16(vld1_u16(u + 8), vld1_u16(v + 8)), min), max);
+        upipe_v210enc_neon_pack(ly, u0, v0, uv1, dst);
+        y += 24;
+        u += 12;
+        v += 12;
+        dst += 64;
+    }
+
+    if (width > 0)
+        upipe_v210enc_planar_pack_10_c(y, u, v, dst, width);
+}
+
+/** @internal @This widens and clips 8 8-bit components to 10 bits. */
+static inline uint16x8_t upipe_v210enc_neon_widen(uint8x8_t x)
+{
+    return vshlq_n_u16(vmovl_u8(vmin_u8(vmax_u8(x, vdup_n_u8(1)),
+                                        vdup_n_u8(254))), 2);
+}
+
+void upipe_v210_planar_pack_8_neon(const uint8_t *y, const uint8_t *u,
+                                   const uint8_t *v, uint8_t *dst, ptrdiff_t width)
+{
+    for ( ; width >= 24; width -= 24) {
+        uint8x16_t y01 = vld1q_u8(y);
+        uint16x8_t ly[3] = {
+            upipe_v210enc_neon_widen(vget_low_u8(y01)),
+            upipe_v210enc_neon_widen(vget_high_u8(y01)),
+            upipe_v210enc_neon_widen(vld1_u8(y + 16))
+        };
+        uint32_t u1, v1;
+        memcpy(&u1, u + 8, sizeof (u1));
+        memcpy(&v1, v + 8, sizeof (v1));
+        uint16x8_t u0 = upipe_v210enc_neon_widen(vld1_u8(u));
+        uint16x8_t v0 = upipe_v210enc_neon_widen(vld1_u8(v));
+        uint16x8_t uv1 = upipe_v210enc_neon_widen(
+                vcreate_u8(u1 | ((uint64_t)v1 << 32)));
+        upipe_v210enc_neon_pack(ly, u0, v0, uv1, dst);
+        y += 24;
+        u += 12;
+        v += 12;
+        dst += 64;
+    }
+
+    if (width > 0)
+        upipe_v210enc_planar_pack_8_c(y, u, v, dst, width);
+}
+#endif
@@ -13,3 +13,17 @@ void upipe_v210_planar_pack_8_avx(const uint8_t *y, const uint8_t *u,
                                   const uint8_t *v, uint8_t *dst, ptrdiff_t width);
 void upipe_v210_planar_pack_8_avx2(const uint8_t *y, const uint8_t *u,
                                    const uint8_t *v, uint8_t *dst, ptrdiff_t width);
+
+/* process 24 pixels per iteration, no alignment required */
+#if defined(__x86_64__)
+void upipe_v210_planar_pack_10_avx512(const uint16_t *y, const uint16_t *u,
+                                      const uint16_t *v, uint8_t *dst, ptrdiff_t width);
+void upipe_v210_planar_pack_8_avx512(const uint8_t *y, const uint8_t *u,
+                                     const uint8_t *v, uint8_t *dst, ptrdiff_t width);
+#endif
+#if defined(__aarch64__) && !defined(__AARCH64EB__)
+void upipe_v210_planar_pack_10_neon(const uint16_t *y, const uint16_t *u,
+                                    const uint16_t *v, uint8_t *dst, ptrdiff_t width);
+void upipe_v210_planar_pack_8_neon(const uint8_t *y, const uint8_t *u,
+                                   const uint8_t *v, uint8_t *dst, ptrdiff_t width);
+#endif
@@ -75,6 +75,41 @@
 #define EXPECTED_FLOW "pic."
 #define OUT_FLOW "block.h264.pic."
 #define OUT_FLOW_MPEG2 "block.mpeg2video.pic."
+/** encoding load (in % of the frame duration) above which the load control
+ * lowers the analysis parameters */
+#define LOAD_HIGH 90
+/** encoding load (in % of the frame duration) below which the load control
+ * restores the analysis parameters */
+#define LOAD_LOW 60
+
+/** @internal @This describes the analysis parameters of a load control
+ * level; the configured parameters are only lowered, never raised */
+struct upipe_x264_load_level {
+    /** maximum subpixel refinement */
+    int subme;
+    /** maximum motion estimation method */
+    int me_method;
+    /** maximum motion estimation range */
+    int me_range;
+    /** maximum number of reference frames */
+    int refs;
+    /** maximum trellis mode */
+    int trellis;
+    /** mask of allowed inter partitions */
+    unsigned int inter;
+};
+
+/** @internal load control levels, from the slowest to the fastest */
+static const struct upipe_x264_load_level upipe_x264_load_levels[] = {
+    { 6, X264_ME_UMH, 24, 3, 1, ~0U },
+    { 4, X264_ME_HEX, 16, 2, 0, ~0U },
+    { 2, X264_ME_HEX, 16, 1, 0, ~(unsigned int)X264_ANALYSE_PSUB8x8 },
+    { 1, X264_ME_DIA, 16, 1, 0, 0 },
+};
+
+/** @internal maximum load control level */
+#define LOAD_LEVEL_MAX \
+    (sizeof(upipe_x264_load_levels) / sizeof(upipe_x264_load_levels[0]))
 
 /** @internal upipe_x264 private structure */
 struct upipe_x264 {
@@ -93,6 +128,19 @@ struct upipe_x264 {
     uint64_t sc_latency;
     /** true if the existing slice types must be enforced */
     bool slice_type_enforce;
+    /** x264 colorspace of the input pictures */
+    int csp;
+
+    /** true if the load control is enabled */
+    bool load_control;
+    /** current load control level (0 = configured parameters) */
+    unsigned int load_level;
+    /** configured parameters, saved when leaving level 0 */
+    x264_param_t load_params;
+    /** time spent encoding in the current window */
+    uint64_t load_time;
+    /** number of frames in the current window */
+    unsigned int load_frames;
 
     /** x264 "PTS" */
     uint64_t x264_ts;
@@ -240,6 +288,57 @@ static inline bool upipe_x264_mpeg2_enabled(struct upipe *upipe)
 #endif
 }
 
+/** @internal @This returns the x264 colorspace matching the planes of a
+ * picture flow definition, so that the planes may be passed to x264 as is.
+ *
+ * @param flow_def picture flow definition
+ * @return x264 colorspace, or X264_CSP_NONE if the format is not supported
+ */
+static int upipe_x264_infer_csp(struct uref *flow_def)
+{
+    uint8_t macropixel;
+    if (!ubase_check(uref_pic_flow_get_macropixel(flow_def, &macropixel)) ||
+        macropixel != 1 ||
+        !ubase_check(uref_pic_flow_check_chroma(flow_def, 1, 1, 1, "y8")))
+        return X264_CSP_NONE;
+
+    if (ubase_check(uref_pic_flow_check_chroma(flow_def, 2, 2, 1, "u8")) &&
+        ubase_check(uref_pic_flow_check_chroma(flow_def, 2, 2, 1, "v8")))
+        return X264_CSP_I420;
+    if (ubase_check(uref_pic_flow_check_chroma(flow_def, 2, 2, 2, "u8v8")))
+        return X264_CSP_NV12;
+    return X264_CSP_NONE;
+}
+
+/** @internal @This lowers the analysis parameters according to the current
+ * load control level.
+ *
+ * @param upipe description structure of the pipe
+ * @param params parameters to modify
+ */
+static void upipe_x264_load_apply(struct upipe *upipe, x264_param_t *params)
+{
+    struct upipe_x264 *upipe_x264 = upipe_x264_from_upipe(upipe);
+    if (!upipe_x264->load_level)
+        return;
+
+    const x264_param_t *base = &upipe_x264->load_params;
+    const struct upipe_x264_load_level *level =
+        &upipe_x264_load_levels[upipe_x264->load_level - 1];
+#define LOAD_MIN(a, b) ((a) < (b) ? (a) : (b))
+    params->analyse.i_subpel_refine =
+        LOAD_MIN(base->analyse.i_subpel_refine, level->subme);
+    params->analyse.i_me_method =
+        LOAD_MIN(base->analyse.i_me_method, level->me_method);
+    params->analyse.i_me_range =
+        LOAD_MIN(base->analyse.i_me_range, level->me_range);
+    params->i_frame_reference = LOAD_MIN(base->i_frame_reference, level->refs);
+    params->analyse.i_trellis = LOAD_MIN(base->analyse.i_trellis,
+                                         level->trellis);
+#undef LOAD_MIN
+    params->analyse.inter = base->analyse.inter & level->inter;
+}
+
 /** @internal @This reconfigures encoder with updated parameters
  * @param upipe description structure of the pipe
  * @return an error code
@@ -251,7 +350,9 @@ static int _upipe_x264_reconfigure(struct upipe *upipe)
     if (unlikely(!upipe_x264->encoder)) {
         return UBASE_ERR_UNHANDLED;
     }
-    ret = x264_encoder_reconfig(upipe_x264->encoder, &upipe_x264->params);
+    x264_param_t params = upipe_x264->params;
+    upipe_x264_load_apply(upipe, &params);
+    ret = x264_encoder_reconfig(upipe_x264->encoder, &params);
     return ( (ret < 0) ? UBASE_ERR_EXTERNAL : UBASE_ERR_NONE );
 }
 
@@ -367,6 +468,158 @@ static int _upipe_x264_set_slice_type_enforce(struct upipe *upipe, bool enforce)
     return UBASE_ERR_NONE;
 }
 
+/** @internal @This sets the load control level and reconfigures the
+ * encoder.
+ *
+ * @param upipe description structure of the pipe
+ * @param load_level new load control level
+ */
+static void upipe_x264_set_load_level(struct upipe *upipe,
+                                      unsigned int load_level)
+{
+    struct upipe_x264 *upipe_x264 = upipe_x264_from_upipe(upipe);
+    if (load_level == upipe_x264->load_level)
+        return;
+
+    if (!upipe_x264->load_level)
+        upipe_x264->load_params = upipe_x264->params;
+    upipe_x264->load_level = load_level;
+    if (!load_level) {
+        /* restore the configured analysis parameters */
+        x264_param_t *base = &upipe_x264->load_params;
+        upipe_x264->params.analyse.i_subpel_refine =
+            base->analyse.i_subpel_refine;
+        upipe_x264->params.analyse.i_me_method = base->analyse.i_me_method;
+        upipe_x264->params.analyse.i_me_range = base->analyse.i_me_range;
+        upipe_x264->params.i_frame_reference = base->i_frame_reference;
+        upipe_x264->params.analyse.i_trellis = base->analyse.i_trellis;
+        upipe_x264->params.analyse.inter = base->analyse.inter;
+    }
+
+    upipe_notice_va(upipe, "load control level %u", load_level);
+    if (!ubase_check(_upipe_x264_reconfigure(upipe)))
+        upipe_warn(upipe, "unable to reconfigure encoder");
+    upipe_throw(upipe, UPROBE_X264_LOAD_LEVEL, UPIPE_X264_SIGNATURE,
+                load_level);
+}
+
+/** @internal @This accounts the time spent encoding a frame, and steps the
+ * load control level once per second of frames.
+ *
+ * @param upipe description structure of the pipe
+ * @param duration time spent in x264_encoder_encode
+ */
+static void upipe_x264_load_update(struct upipe *upipe, uint64_t duration)
+{
+    struct upipe_x264 *upipe_x264 = upipe_x264_from_upipe(upipe);
+    x264_param_t *params = &upipe_x264->params;
+    if (!params->i_fps_num || !params->i_fps_den)
+        return;
+
+    upipe_x264->load_time += duration;
+    upipe_x264->load_frames++;
+    unsigned int window = params->i_fps_num / params->i_fps_den;
+    if (upipe_x264->load_frames < window)
+        return;
+
+    uint64_t budget = (uint64_t)upipe_x264->load_frames * UCLOCK_FREQ *
+                      params->i_fps_den / params->i_fps_num;
+    uint64_t load = upipe_x264->load_time * 100 / budget;
+    upipe_x264->load_time = 0;
+    upipe_x264->load_frames = 0;
+    upipe_verbose_va(upipe, "encoding load %"PRIu64"%%", load);
+
+    if (load > LOAD_HIGH && upipe_x264->load_level < LOAD_LEVEL_MAX)
+        upipe_x264_set_load_level(upipe, upipe_x264->load_level + 1);
+    else if (load < LOAD_LOW && upipe_x264->load_level)
+        upipe_x264_set_load_level(upipe, upipe_x264->load_level - 1);
+}
+
+/** @internal @This enables or disables the load control.
+ *
+ * @param upipe description structure of the pipe
+ * @param enable true to enable the load control
+ * @return an error code
+ */
+static int _upipe_x264_set_load_control(struct upipe *upipe, bool enable)
+{
+    struct upipe_x264 *upipe_x264 = upipe_x264_from_upipe(upipe);
+    upipe_x264->load_control = enable;
+    upipe_x264->load_time = 0;
+    upipe_x264->load_frames = 0;
+    upipe_dbg_va(upipe, "%sactivating load control", enable ? "" : "de");
+    if (enable) {
+        if (upipe_x264->uclock == NULL)
+            upipe_x264_require_uclock(upipe);
+    } else
+        upipe_x264_set_load_level(upipe, 0);
+    return UBASE_ERR_NONE;
+}
+
+/** @hidden */
+static void upipe_x264_close(struct upipe *upipe);
+
+/** @internal @This flushes and closes the encoder if it is opened, so that
+ * it is reopened with the new parameters on the next picture. This is
+ * necessary for parameters which x264_encoder_reconfig ignores.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_x264_reopen(struct upipe *upipe)
+{
+    struct upipe_x264 *upipe_x264 = upipe_x264_from_upipe(upipe);
+    if (upipe_x264->encoder == NULL)
+        return;
+
+    upipe_x264_close(upipe);
+    /* the latency will be recomputed in the new flow definition */
+    upipe_x264_store_flow_def(upipe, NULL);
+}
+
+/** @internal @This sets the depth of the rate control lookahead.
+ *
+ * @param upipe description structure of the pipe
+ * @param depth number of frames of lookahead
+ * @return an error code
+ */
+static int _upipe_x264_set_lookahead(struct upipe *upipe, int depth)
+{
+    struct upipe_x264 *upipe_x264 = upipe_x264_from_upipe(upipe);
+    if (depth < 0)
+        return UBASE_ERR_INVALID;
+    if (upipe_x264->params.rc.i_lookahead == depth)
+        return UBASE_ERR_NONE;
+
+    upipe_dbg_va(upipe, "setting lookahead to %d frames", depth);
+    upipe_x264->params.rc.i_lookahead = depth;
+    upipe_x264_reopen(upipe);
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This sets the number of frame threads.
+ *
+ * @param upipe description structure of the pipe
+ * @param threads number of frame threads, or 0 for automatic
+ * @return an error code
+ */
+static int _upipe_x264_set_threads(struct upipe *upipe, int threads)
+{
+    struct upipe_x264 *upipe_x264 = upipe_x264_from_upipe(upipe);
+    if (threads < 0)
+        return UBASE_ERR_INVALID;
+    if (threads == 0)
+        threads = X264_THREADS_AUTO;
+    if (upipe_x264->params.i_threads == threads &&
+        !upipe_x264->params.b_sliced_threads)
+        return UBASE_ERR_NONE;
+
+    upipe_dbg_va(upipe, "setting %d frame threads", threads);
+    upipe_x264->params.i_threads = threads;
+    upipe_x264->params.b_sliced_threads = 0;
+    upipe_x264_reopen(upipe);
+    return UBASE_ERR_NONE;
+}
+
 /** @internal @This allocates a filter pipe.
  *
  * @param mgr common management structure
@@ -391,6 +644,11 @@ static struct upipe *upipe_x264_alloc(struct upipe_mgr *mgr,
     upipe_x264->initial_latency = 0;
     upipe_x264->sc_latency = 0;
     upipe_x264->slice_type_enforce = false;
+    upipe_x264->csp = X264_CSP_I420;
+    upipe_x264->load_control = false;
+    upipe_x264->load_level = 0;
+    upipe_x264->load_time = 0;
+    upipe_x264->load_frames = 0;
     upipe_x264->x264_ts = 0;
 
     upipe_x264_init_urefcount(upipe);
@@ -454,6 +712,7 @@ static bool upipe_x264_open(struct upipe *upipe, int width, int height)
     }
     params->i_width = width;
     params->i_height = height;
+    params->i_csp = upipe_x264->csp;
     if (!ubase_check(uref_pic_get_progressive(upipe_x264->flow_def_input)))
         params->b_interlaced = true;
 
@@ -494,7 +753,9 @@ static bool upipe_x264_open(struct upipe *upipe, int width, int height)
             return false;
     } else {
         /* open encoder */
-        upipe_x264->encoder = x264_encoder_open(params);
+        x264_param_t open_params = *params;
+        upipe_x264_load_apply(upipe, &open_params);
+        upipe_x264->encoder = x264_encoder_open(&open_params);
         if (unlikely(!upipe_x264->encoder))
             return false;
     }
@@ -656,6 +917,7 @@ static void upipe_x264_close(struct upipe *upipe)
 
         upipe_notice(upipe, "closing encoder");
         x264_encoder_close(upipe_x264->encoder);
+        upipe_x264->encoder = NULL;
     }
 }
 
@@ -750,6 +1012,7 @@ static bool upipe_x264_handle(struct upipe *upipe, struct uref *uref,
     if (unlikely(uref != NULL && ubase_check(uref_flow_get_def(uref, &def)))) {
         upipe_x264->input_latency = 0;
         uref_clock_get_latency(uref, &upipe_x264->input_latency);
+        upipe_x264->csp = upipe_x264_infer_csp(uref);
         upipe_x264_store_flow_def(upipe, NULL);
         uref_free(upipe_x264->flow_def_requested);
         upipe_x264->flow_def_requested = NULL;
@@ -789,7 +1052,10 @@ static bool upipe_x264_handle(struct upipe *upipe, struct uref *uref,
         return true;
     }
 
-    static const char *const chromas[] = {"y8", "u8", "v8"};
+    static const char *const chromas_i420[] = {"y8", "u8", "v8"};
+    static const char *const chromas_nv12[] = {"y8", "u8v8"};
+    const char *const *chromas = chromas_i420;
+    int nb_planes = 3;
     size_t width, height;
     x264_picture_t pic;
     x264_nal_t *nals;
@@ -805,7 +1071,11 @@ static bool upipe_x264_handle(struct upipe *upipe, struct uref *uref,
 
     if (likely(uref)) {
         pic.opaque = uref;
-        pic.img.i_csp = X264_CSP_I420;
+        pic.img.i_csp = upipe_x264->csp;
+        if (upipe_x264->csp == X264_CSP_NV12) {
+            chromas = chromas_nv12;
+            nb_planes = 2;
+        }
 
         uref_pic_size(uref, &width, &height, NULL);
 
@@ -877,8 +1147,9 @@ static bool upipe_x264_handle(struct upipe *upipe, struct uref *uref,
             }
         }
 
-        /* map */
-        for (i = 0; i < 3; i++) {
+        /* map, x264 copies the planes into its own frames during
+         * x264_encoder_encode so they are only mapped for this call */
+        for (i = 0; i < nb_planes; i++) {
             size_t stride;
             const uint8_t *plane;
             if (unlikely(!ubase_check(uref_pic_plane_size(uref, chromas[i], &stride,
@@ -887,6 +1158,8 @@ static bool upipe_x264_handle(struct upipe *upipe, struct uref *uref,
                                               &plane)))) {
                 upipe_err_va(upipe, "Could not read origin chroma %s",
                              chromas[i]);
+                while (--i >= 0)
+                    uref_pic_plane_unmap(uref, chromas[i], 0, 0, -1, -1);
                 uref_free(uref);
                 return true;
             }
@@ -897,11 +1170,16 @@ static bool upipe_x264_handle(struct upipe *upipe, struct uref *uref,
         pic.img.i_plane = i;
 
         /* encode frame ! */
+        bool load = upipe_x264->load_control && upipe_x264->uclock != NULL;
+        uint64_t start = load ? uclock_now(upipe_x264->uclock) : 0;
         ret = x264_encoder_encode(upipe_x264->encoder,
                                   &nals, &nals_num, &pic, &pic);
+        if (load)
+            upipe_x264_load_update(upipe,
+                                   uclock_now(upipe_x264->uclock) - start);
 
         /* unmap */
-        for (i = 0; i < 3; i++) {
+        for (i = 0; i < nb_planes; i++) {
             uref_pic_plane_unmap(uref, chromas[i], 0, 0, -1, -1);
         }
         ubuf_free(uref_detach_ubuf(uref));
@@ -1128,14 +1406,9 @@ static int upipe_x264_set_flow_def(struct upipe *upipe,
     if (flow_def == NULL)
         return UBASE_ERR_INVALID;
 
-    /* We only accept YUV420P for the moment. */
-    uint8_t macropixel;
+    /* We accept YUV420P and NV12, which x264 reads without conversion. */
     if (unlikely(!ubase_check(uref_flow_match_def(flow_def, EXPECTED_FLOW)) ||
-                 !ubase_check(uref_pic_flow_get_macropixel(flow_def, &macropixel)) ||
-                 macropixel != 1 ||
-                 !ubase_check(uref_pic_flow_check_chroma(flow_def, 1, 1, 1, "y8")) ||
-                 !ubase_check(uref_pic_flow_check_chroma(flow_def, 2, 2, 1, "u8")) ||
-                 !ubase_check(uref_pic_flow_check_chroma(flow_def, 2, 2, 1, "v8"))))
+                 upipe_x264_infer_csp(flow_def) == X264_CSP_NONE))
         return UBASE_ERR_INVALID;
 
     /* Extract relevant attributes to flow def check. */
@@ -1214,6 +1487,10 @@ static int _upipe_x264_provide_flow_format(struct upipe *upipe,
 {
     struct uref *flow_format = uref_dup(request->uref);
     UBASE_ALLOC_RETURN(flow_format);
+    /* keep NV12 as is to avoid a conversion */
+    if (upipe_x264_infer_csp(flow_format) == X264_CSP_NV12)
+        return urequest_provide_flow_format(request, flow_format);
+
     uref_pic_flow_clear_format(flow_format);
     uref_pic_flow_set_macropixel(flow_format, 1);
     uref_pic_flow_set_planes(flow_format, 0);
@@ -1299,6 +1576,21 @@ static int upipe_x264_control(struct upipe *upipe, int command, va_list args)
             bool enforce = !(va_arg(args, int) == 0);
             return _upipe_x264_set_slice_type_enforce(upipe, enforce);
         }
+        case UPIPE_X264_SET_LOOKAHEAD: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_X264_SIGNATURE)
+            int depth = va_arg(args, int);
+            return _upipe_x264_set_lookahead(upipe, depth);
+        }
+        case UPIPE_X264_SET_THREADS: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_X264_SIGNATURE)
+            int threads = va_arg(args, int);
+            return _upipe_x264_set_threads(upipe, threads);
+        }
+        case UPIPE_X264_SET_LOAD_CONTROL: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_X264_SIGNATURE)
+            bool enable = !!va_arg(args, int);
+            return _upipe_x264_set_load_control(upipe, enable);
+        }
         default:
             return UBASE_ERR_UNHANDLED;
     }
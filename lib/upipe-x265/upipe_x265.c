@@ -63,16 +63,28 @@
 #include <upipe-framers/upipe_h26x_common.h>
 
 #include <stdlib.h>
+#include <string.h>
 #include <strings.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <ctype.h>
+#include <unistd.h>
+#include <sched.h>
+#include <pthread.h>
 
 #include <x265.h>
 #include <bitstream/itu/h265.h>
 
 #define EXPECTED_FLOW "pic."
 #define OUT_FLOW "block.hevc.pic."
+/** encoding load (in % of the frame duration) above which the load control
+ * switches to a faster preset */
+#define LOAD_HIGH 90
+/** encoding load (in % of the frame duration) below which the load control
+ * switches back to a slower preset */
+#define LOAD_LOW 60
+/** maximum number of NUMA nodes for local thread pools */
+#define NUMA_NODES_MAX 64
 
 // speed control presets
 //     ultrafast
@@ -187,6 +199,28 @@ struct upipe_x265 {
     /** speedcontrol buffer fullness */
     int64_t sc_buffer_fill;
 
+    /** true if the load control is enabled */
+    bool load_control;
+    /** current load control level (0 = configured preset) */
+    unsigned int load_level;
+    /** configured preset (index in x265_preset_names) */
+    unsigned int load_preset;
+    /** time spent encoding in the current window */
+    uint64_t load_time;
+    /** number of frames in the current window */
+    unsigned int load_frames;
+
+    /** thread pools, or NULL for the default */
+    char *pools;
+    /** true if the thread pools are restricted to the local NUMA node */
+    bool pools_local;
+    /** thread pools of the local NUMA node */
+    char local_pools[NUMA_NODES_MAX * 2];
+    /** number of frame threads, or -1 for the default */
+    int frame_threads;
+    /** wavefront parallel processing, or -1 for the default */
+    int wpp;
+
     struct option {
         const char *name;
         const char *value;
@@ -257,6 +291,7 @@ static int _upipe_x265_set_default(struct upipe *upipe, int bit_depth)
 
     upipe_x265->api->param_default_preset(&upipe_x265->params, "slow", NULL);
     upipe_x265->sc_preset = 4;
+    upipe_x265->load_preset = 6;
 
     upipe_notice_va(upipe, "bit depth: %d", upipe_x265->params.internalBitDepth);
 
@@ -348,6 +383,76 @@ static int _upipe_x265_set_slice_type_enforce(struct upipe *upipe, bool enforce)
     return UBASE_ERR_NONE;
 }
 
+/** @internal @This sets the thread pools.
+ *
+ * @param upipe description structure of the pipe
+ * @param pools x265 pools string, or NULL for the default
+ * @return an error code
+ */
+static int _upipe_x265_set_pools(struct upipe *upipe, const char *pools)
+{
+    struct upipe_x265 *upipe_x265 = upipe_x265_from_upipe(upipe);
+    if (upipe_x265->encoder != NULL)
+        return UBASE_ERR_BUSY;
+
+    char *dup = NULL;
+    if (pools != NULL) {
+        dup = strdup(pools);
+        UBASE_ALLOC_RETURN(dup);
+    }
+    free(upipe_x265->pools);
+    upipe_x265->pools = dup;
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This restricts the thread pools to the local NUMA node.
+ *
+ * @param upipe description structure of the pipe
+ * @param local true to use the local NUMA node only
+ * @return an error code
+ */
+static int _upipe_x265_set_pools_local(struct upipe *upipe, bool local)
+{
+    struct upipe_x265 *upipe_x265 = upipe_x265_from_upipe(upipe);
+    if (upipe_x265->encoder != NULL)
+        return UBASE_ERR_BUSY;
+    upipe_x265->pools_local = local;
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This sets the number of frame threads.
+ *
+ * @param upipe description structure of the pipe
+ * @param frame_threads number of frame threads, or 0 for automatic
+ * @return an error code
+ */
+static int _upipe_x265_set_frame_threads(struct upipe *upipe,
+                                         int frame_threads)
+{
+    struct upipe_x265 *upipe_x265 = upipe_x265_from_upipe(upipe);
+    if (frame_threads < 0)
+        return UBASE_ERR_INVALID;
+    if (upipe_x265->encoder != NULL)
+        return UBASE_ERR_BUSY;
+    upipe_x265->frame_threads = frame_threads;
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This enables or disables wavefront parallel processing.
+ *
+ * @param upipe description structure of the pipe
+ * @param wpp true to enable wavefront parallel processing
+ * @return an error code
+ */
+static int _upipe_x265_set_wpp(struct upipe *upipe, bool wpp)
+{
+    struct upipe_x265 *upipe_x265 = upipe_x265_from_upipe(upipe);
+    if (upipe_x265->encoder != NULL)
+        return UBASE_ERR_BUSY;
+    upipe_x265->wpp = wpp ? 1 : 0;
+    return UBASE_ERR_NONE;
+}
+
 /** @internal @This allocates a filter pipe.
  *
  * @param mgr common management structure
@@ -375,6 +480,15 @@ static struct upipe *upipe_x265_alloc(struct upipe_mgr *mgr,
     upipe_x265->sc_latency = 0;
     upipe_x265->slice_type_enforce = false;
     upipe_x265->delayed_frames = true;
+    upipe_x265->load_control = false;
+    upipe_x265->load_level = 0;
+    upipe_x265->load_time = 0;
+    upipe_x265->load_frames = 0;
+    upipe_x265->pools = NULL;
+    upipe_x265->pools_local = false;
+    upipe_x265->local_pools[0] = '\0';
+    upipe_x265->frame_threads = -1;
+    upipe_x265->wpp = -1;
 
     upipe_x265_init_urefcount(upipe);
     upipe_x265_init_ubuf_mgr(upipe);
@@ -402,6 +516,72 @@ static struct upipe *upipe_x265_alloc(struct upipe_mgr *mgr,
     return upipe;
 }
 
+/** @internal @This returns the NUMA node of a CPU.
+ *
+ * @param cpu CPU number
+ * @return NUMA node, or -1 if unknown
+ */
+static int upipe_x265_cpu_node(int cpu)
+{
+    char path[64];
+    for (int node = 0; node < NUMA_NODES_MAX; node++) {
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/node%d",
+                 cpu, node);
+        if (!access(path, F_OK))
+            return node;
+    }
+    return -1;
+}
+
+/** @internal @This builds the thread pools string which restricts x265 to
+ * the NUMA node of the current thread. If the CPU affinity of the thread
+ * spans several nodes, the node of the current CPU is used.
+ *
+ * @param upipe description structure of the pipe
+ * @return false if the NUMA node could not be found
+ */
+static bool upipe_x265_build_local_pools(struct upipe *upipe)
+{
+    struct upipe_x265 *upipe_x265 = upipe_x265_from_upipe(upipe);
+    int node = -1;
+    cpu_set_t cpus;
+
+    upipe_x265->local_pools[0] = '\0';
+    if (!pthread_getaffinity_np(pthread_self(), sizeof(cpus), &cpus)) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+            if (!CPU_ISSET(cpu, &cpus))
+                continue;
+            int cpu_node = upipe_x265_cpu_node(cpu);
+            if (node == -1)
+                node = cpu_node;
+            else if (cpu_node != node) {
+                node = -1;
+                break;
+            }
+        }
+    }
+    if (node == -1) {
+        int cpu = sched_getcpu();
+        if (cpu >= 0)
+            node = upipe_x265_cpu_node(cpu);
+    }
+    if (node < 0) {
+        upipe_warn(upipe, "unable to find the local NUMA node");
+        return false;
+    }
+
+    char *pools = upipe_x265->local_pools;
+    for (int i = 0; i < node; i++) {
+        *pools++ = '-';
+        *pools++ = ',';
+    }
+    *pools++ = '+';
+    *pools = '\0';
+    upipe_dbg_va(upipe, "using thread pools of NUMA node %d (%s)",
+                 node, upipe_x265->local_pools);
+    return true;
+}
+
 static void apply_params(struct upipe *upipe)
 {
     struct upipe_x265 *upipe_x265 = upipe_x265_from_upipe(upipe);
@@ -427,6 +607,18 @@ static void apply_params(struct upipe *upipe)
     params->sourceWidth = upipe_x265->width;
     params->sourceHeight = upipe_x265->height;
 
+    /* the thread pools are only created when opening the encoder */
+    if (upipe_x265->pools_local && upipe_x265->encoder == NULL)
+        upipe_x265_build_local_pools(upipe);
+    if (upipe_x265->pools_local && upipe_x265->local_pools[0])
+        params->numaPools = upipe_x265->local_pools;
+    else if (upipe_x265->pools != NULL)
+        params->numaPools = upipe_x265->pools;
+    if (upipe_x265->frame_threads >= 0)
+        params->frameNumThreads = upipe_x265->frame_threads;
+    if (upipe_x265->wpp >= 0)
+        params->bEnableWavefront = upipe_x265->wpp;
+
     if (!ubase_check(uref_pic_get_progressive(flow_def)))
         params->interlaceMode = 1;
 
@@ -447,6 +639,29 @@ static void apply_params(struct upipe *upipe)
         upipe_x265_set_option(upipe, "colormatrix", value);
 }
 
+/** @internal @This switches the encoder to the given preset, keeping the
+ * flow parameters and the options set by the user.
+ *
+ * @param upipe description structure of the pipe
+ * @param preset x265 preset
+ * @return an error code
+ */
+static int upipe_x265_apply_preset(struct upipe *upipe, const char *preset)
+{
+    struct upipe_x265 *upipe_x265 = upipe_x265_from_upipe(upipe);
+
+    if (_upipe_x265_set_default_preset(upipe, preset, NULL) != UBASE_ERR_NONE)
+        upipe_err_va(upipe, "x265 set_default_preset failed");
+
+    apply_params(upipe);
+
+    struct option *opt;
+    for (opt = upipe_x265->options; opt != NULL; opt = opt->next)
+        upipe_x265_set_option(upipe, opt->name, opt->value);
+
+    return _upipe_x265_reconfigure(upipe);
+}
+
 static void speedcontrol_update(struct upipe *upipe)
 {
     struct upipe_x265 *upipe_x265 = upipe_x265_from_upipe(upipe);
@@ -472,18 +687,87 @@ static void speedcontrol_update(struct upipe *upipe)
 
         upipe_verbose_va(upipe, "apply speedcontrol preset %s", preset);
 
-        if (_upipe_x265_set_default_preset(upipe, preset, NULL) != UBASE_ERR_NONE)
-            upipe_err_va(upipe, "x265 set_default_preset failed");
+        if (upipe_x265_apply_preset(upipe, preset) == UBASE_ERR_NONE)
+            upipe_x265->sc_preset = set;
+    }
+}
 
-        apply_params(upipe);
+/** @internal @This sets the load control level and reconfigures the
+ * encoder.
+ *
+ * @param upipe description structure of the pipe
+ * @param load_level new load control level
+ */
+static void upipe_x265_set_load_level(struct upipe *upipe,
+                                      unsigned int load_level)
+{
+    struct upipe_x265 *upipe_x265 = upipe_x265_from_upipe(upipe);
+    if (load_level == upipe_x265->load_level)
+        return;
 
-        struct option *opt;
-        for (opt = upipe_x265->options; opt != NULL; opt = opt->next)
-            upipe_x265_set_option(upipe, opt->name, opt->value);
+    const char *preset =
+        x265_preset_names[upipe_x265->load_preset - load_level];
+    upipe_notice_va(upipe, "load control level %u, preset %s",
+                    load_level, preset);
+    upipe_x265->load_level = load_level;
+    if (upipe_x265->encoder != NULL &&
+        !ubase_check(upipe_x265_apply_preset(upipe, preset)))
+        upipe_warn(upipe, "unable to reconfigure encoder");
+    upipe_throw(upipe, UPROBE_X265_LOAD_LEVEL, UPIPE_X265_SIGNATURE,
+                load_level);
+}
 
-        if (_upipe_x265_reconfigure(upipe) == UBASE_ERR_NONE)
-            upipe_x265->sc_preset = set;
-    }
+/** @internal @This accounts the time spent encoding a frame, and steps the
+ * load control level once per second of frames.
+ *
+ * @param upipe description structure of the pipe
+ * @param duration time spent in x265_encoder_encode
+ */
+static void upipe_x265_load_update(struct upipe *upipe, uint64_t duration)
+{
+    struct upipe_x265 *upipe_x265 = upipe_x265_from_upipe(upipe);
+    x265_param *params = &upipe_x265->params;
+    if (!params->fpsNum || !params->fpsDenom)
+        return;
+
+    upipe_x265->load_time += duration;
+    upipe_x265->load_frames++;
+    unsigned int window = params->fpsNum / params->fpsDenom;
+    if (upipe_x265->load_frames < window)
+        return;
+
+    uint64_t budget = (uint64_t)upipe_x265->load_frames * UCLOCK_FREQ *
+                      params->fpsDenom / params->fpsNum;
+    uint64_t load = upipe_x265->load_time * 100 / budget;
+    upipe_x265->load_time = 0;
+    upipe_x265->load_frames = 0;
+    upipe_verbose_va(upipe, "encoding load %"PRIu64"%%", load);
+
+    if (load > LOAD_HIGH && upipe_x265->load_level < upipe_x265->load_preset)
+        upipe_x265_set_load_level(upipe, upipe_x265->load_level + 1);
+    else if (load < LOAD_LOW && upipe_x265->load_level)
+        upipe_x265_set_load_level(upipe, upipe_x265->load_level - 1);
+}
+
+/** @internal @This enables or disables the load control.
+ *
+ * @param upipe description structure of the pipe
+ * @param enable true to enable the load control
+ * @return an error code
+ */
+static int _upipe_x265_set_load_control(struct upipe *upipe, bool enable)
+{
+    struct upipe_x265 *upipe_x265 = upipe_x265_from_upipe(upipe);
+    upipe_x265->load_control = enable;
+    upipe_x265->load_time = 0;
+    upipe_x265->load_frames = 0;
+    upipe_dbg_va(upipe, "%sactivating load control", enable ? "" : "de");
+    if (enable) {
+        if (upipe_x265->uclock == NULL)
+            upipe_x265_require_uclock(upipe);
+    } else
+        upipe_x265_set_load_level(upipe, 0);
+    return UBASE_ERR_NONE;
 }
 
 /** @internal @This opens x265 encoder.
@@ -877,9 +1161,15 @@ static bool upipe_x265_handle(struct upipe *upipe,
         }
 
         /* encode frame */
+        bool load = upipe_x265->load_control && !upipe_x265->sc_latency &&
+                    upipe_x265->uclock != NULL;
+        uint64_t start = load ? uclock_now(upipe_x265->uclock) : 0;
         ret = upipe_x265->api->encoder_encode(upipe_x265->encoder,
                                               &nals, &nals_num,
                                               &pic, &pic);
+        if (load)
+            upipe_x265_load_update(upipe,
+                                   uclock_now(upipe_x265->uclock) - start);
 
         /* unmap */
         for (i = 0; i < 3; i++)
@@ -1250,7 +1540,13 @@ static int upipe_x265_control(struct upipe *upipe, int command, va_list args)
             UBASE_SIGNATURE_CHECK(args, UPIPE_X265_SIGNATURE)
             const char *preset = va_arg(args, const char *);
             const char *tune = va_arg(args, const char *);
-            return _upipe_x265_set_default_preset(upipe, preset, tune);
+            UBASE_RETURN(_upipe_x265_set_default_preset(upipe, preset, tune))
+            struct upipe_x265 *upipe_x265 = upipe_x265_from_upipe(upipe);
+            for (unsigned int i = 0; x265_preset_names[i] != NULL; i++)
+                if (preset != NULL && !strcmp(x265_preset_names[i], preset))
+                    upipe_x265->load_preset = i;
+            upipe_x265->load_level = 0;
+            return UBASE_ERR_NONE;
         }
         case UPIPE_X265_SET_PROFILE: {
             UBASE_SIGNATURE_CHECK(args, UPIPE_X265_SIGNATURE)
@@ -1283,6 +1579,31 @@ static int upipe_x265_control(struct upipe *upipe, int command, va_list args)
             bool enforce = va_arg(args, int);
             return _upipe_x265_set_slice_type_enforce(upipe, enforce);
         }
+        case UPIPE_X265_SET_LOAD_CONTROL: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_X265_SIGNATURE)
+            bool enable = !!va_arg(args, int);
+            return _upipe_x265_set_load_control(upipe, enable);
+        }
+        case UPIPE_X265_SET_POOLS: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_X265_SIGNATURE)
+            const char *pools = va_arg(args, const char *);
+            return _upipe_x265_set_pools(upipe, pools);
+        }
+        case UPIPE_X265_SET_POOLS_LOCAL: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_X265_SIGNATURE)
+            bool local = !!va_arg(args, int);
+            return _upipe_x265_set_pools_local(upipe, local);
+        }
+        case UPIPE_X265_SET_FRAME_THREADS: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_X265_SIGNATURE)
+            int frame_threads = va_arg(args, int);
+            return _upipe_x265_set_frame_threads(upipe, frame_threads);
+        }
+        case UPIPE_X265_SET_WPP: {
+            UBASE_SIGNATURE_CHECK(args, UPIPE_X265_SIGNATURE)
+            bool wpp = !!va_arg(args, int);
+            return _upipe_x265_set_wpp(upipe, wpp);
+        }
         default:
             return UBASE_ERR_UNHANDLED;
     }
@@ -1316,6 +1637,7 @@ static void upipe_x265_free(struct upipe *upipe)
 
     upipe_x265_close(upipe);
     upipe_x265_free_options(upipe);
+    free(upipe_x265->pools);
     upipe_throw_dead(upipe);
     upipe_x265_clean_uclock(upipe);
     upipe_x265_clean_ubuf_mgr(upipe);
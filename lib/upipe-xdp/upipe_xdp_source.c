@@ -0,0 +1,1327 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short Upipe source module for AF_XDP sockets
+ * Datagrams are received in a UMEM area shared with the kernel, and exposed
+ * as block ubufs pointing directly to the UMEM frames. A frame is given back
+ * to the kernel when the last ubuf pointing to it is released, possibly in
+ * another thread.
+ *
+ * An XDP program is attached to each interface (in driver mode if possible,
+ * otherwise in generic mode), and shared by all the pipes opened on it. It
+ * looks up the filter of the receive queue, and redirects the matching IPv4
+ * UDP datagrams to the AF_XDP socket of the queue.
+ */
+
+#define _GNU_SOURCE
+
+#include <upipe/ubase.h>
+#include <upipe/ulist.h>
+#include <upipe/uatomic.h>
+#include <upipe/urefcount.h>
+#include <upipe/ulifo.h>
+#include <upipe/upool.h>
+#include <upipe/uprobe.h>
+#include <upipe/uclock.h>
+#include <upipe/ubuf.h>
+#include <upipe/ubuf_block.h>
+#include <upipe/ubuf_block_common.h>
+#include <upipe/uref.h>
+#include <upipe/uref_block.h>
+#include <upipe/uref_block_flow.h>
+#include <upipe/uref_clock.h>
+#include <upipe/upump.h>
+#include <upipe/upipe.h>
+#include <upipe/upipe_helper_upipe.h>
+#include <upipe/upipe_helper_urefcount.h>
+#include <upipe/upipe_helper_void.h>
+#include <upipe/upipe_helper_uref_mgr.h>
+#include <upipe/upipe_helper_output.h>
+#include <upipe/upipe_helper_upump_mgr.h>
+#include <upipe/upipe_helper_upump.h>
+#include <upipe/upipe_helper_uclock.h>
+#include <upipe-xdp/upipe_xdp_source.h>
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <assert.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <net/if.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include <linux/bpf.h>
+#include <linux/if_link.h>
+#include <linux/if_xdp.h>
+#include <linux/if_ether.h>
+
+#ifndef AF_XDP
+#define AF_XDP 44
+#endif
+#ifndef SOL_XDP
+#define SOL_XDP 283
+#endif
+
+/** number of frames in the UMEM area */
+#define XDP_NB_FRAMES 4096
+/** size of a frame */
+#define XDP_FRAME_SIZE 2048
+/** number of descriptors of the receive ring */
+#define XDP_RX_SIZE 2048
+/** number of descriptors of the completion ring (unused for reception) */
+#define XDP_COMP_SIZE 64
+/** maximum number of receive queues */
+#define XDP_NB_QUEUES 256
+/** depth of the pool of ubuf structures */
+#define XDP_UBUF_POOL 512
+/** maximum number of datagrams processed per iteration */
+#define XDP_BURST 64
+/** period of the refill of the fill ring */
+#define XDP_REFILL_PERIOD (UCLOCK_FREQ / 1000)
+/** size of the Ethernet, IPv4 and UDP headers */
+#define XDP_HEADERS_SIZE (ETH_HLEN + 20 + 8)
+
+/** @internal @This is a ring shared with the kernel. */
+struct upipe_xdp_ring {
+    /** producer index */
+    uint32_t *producer;
+    /** consumer index */
+    uint32_t *consumer;
+    /** flags */
+    uint32_t *flags;
+    /** descriptors */
+    void *descs;
+    /** number of descriptors (power of 2) */
+    uint32_t size;
+    /** local copy of the index written by this side */
+    uint32_t cached;
+    /** mapped area */
+    void *map;
+    /** size of the mapped area */
+    size_t map_size;
+};
+
+/** @internal @This is a frame of the UMEM area. */
+struct upipe_xdp_frame {
+    /** number of ubufs pointing to the frame */
+    uatomic_uint32_t refcount;
+    /** address of the frame in the UMEM area */
+    uint64_t addr;
+};
+
+/** @internal @This is an AF_XDP socket with its UMEM area, acting as ubuf
+ * manager for the frames. It is freed when the pipe and all ubufs are
+ * released. */
+struct upipe_xdp_umem {
+    /** refcount management structure */
+    struct urefcount urefcount;
+
+    /** AF_XDP socket */
+    int fd;
+    /** UMEM area */
+    uint8_t *area;
+    /** fill ring */
+    struct upipe_xdp_ring fill;
+    /** completion ring */
+    struct upipe_xdp_ring comp;
+    /** receive ring */
+    struct upipe_xdp_ring rx;
+
+    /** frames */
+    struct upipe_xdp_frame frames[XDP_NB_FRAMES];
+    /** frames released by the ubufs, to give back to the kernel */
+    struct ulifo recycle;
+    /** ubuf pool */
+    struct upool ubuf_pool;
+
+    /** common management structure */
+    struct ubuf_mgr mgr;
+
+    /** extra space for the ulifo and upool */
+    uint8_t extra[];
+};
+
+UBASE_FROM_TO(upipe_xdp_umem, ubuf_mgr, ubuf_mgr, mgr)
+UBASE_FROM_TO(upipe_xdp_umem, urefcount, urefcount, urefcount)
+UBASE_FROM_TO(upipe_xdp_umem, upool, ubuf_pool, ubuf_pool)
+
+/** @internal @This is a super-set of the @ref ubuf (and @ref ubuf_block)
+ * structure pointing to a frame. */
+struct upipe_xdp_ubuf {
+    /** pointer to the frame */
+    struct upipe_xdp_frame *frame;
+
+    /** block structure */
+    struct ubuf_block ubuf_block;
+};
+
+UBASE_FROM_TO(upipe_xdp_ubuf, ubuf, ubuf, ubuf_block.ubuf)
+
+/** @internal @This is the XDP program attached to an interface. */
+struct upipe_xdp_prog {
+    /** structure for the list of programs */
+    struct uchain uchain;
+    /** number of pipes using the program */
+    unsigned int refcount;
+    /** interface index */
+    int ifindex;
+    /** map of the AF_XDP sockets, by queue */
+    int xsk_map_fd;
+    /** map of the filters, by queue */
+    int filter_map_fd;
+    /** program */
+    int prog_fd;
+    /** link between the program and the interface */
+    int link_fd;
+};
+
+UBASE_FROM_TO(upipe_xdp_prog, uchain, uchain, uchain)
+
+/** @internal @This is the filter of a queue, in the XDP program. */
+struct upipe_xdp_filter {
+    /** destination address in network byte order, or 0 */
+    uint32_t group;
+    /** destination port in network byte order */
+    uint32_t port;
+};
+
+/** list of the XDP programs */
+static struct uchain upipe_xdp_progs = {
+    .next = &upipe_xdp_progs,
+    .prev = &upipe_xdp_progs
+};
+/** lock protecting the list of the XDP programs */
+static pthread_mutex_t upipe_xdp_progs_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/** @hidden */
+static int upipe_xdp_source_check(struct upipe *upipe,
+                                  struct uref *flow_format);
+
+/** @internal @This is the private context of an AF_XDP source pipe. */
+struct upipe_xdp_source {
+    /** refcount management structure */
+    struct urefcount urefcount;
+
+    /** uref manager */
+    struct uref_mgr *uref_mgr;
+    /** uref manager request */
+    struct urequest uref_mgr_request;
+
+    /** uclock structure, if not NULL we are in live mode */
+    struct uclock *uclock;
+    /** uclock request */
+    struct urequest uclock_request;
+
+    /** pipe acting as output */
+    struct upipe *output;
+    /** flow definition packet */
+    struct uref *flow_def;
+    /** output state */
+    enum upipe_helper_output_state output_state;
+    /** list of output requests */
+    struct uchain request_list;
+
+    /** upump manager */
+    struct upump_mgr *upump_mgr;
+    /** read watcher */
+    struct upump *upump;
+    /** refill timer */
+    struct upump *upump_timer;
+
+    /** AF_XDP socket and UMEM area */
+    struct upipe_xdp_umem *umem;
+    /** XDP program */
+    struct upipe_xdp_prog *prog;
+    /** receive queue */
+    unsigned int queue;
+
+    /** AF_XDP uri */
+    char *uri;
+
+    /** public upipe structure */
+    struct upipe upipe;
+};
+
+UPIPE_HELPER_UPIPE(upipe_xdp_source, upipe, UPIPE_XDP_SOURCE_SIGNATURE)
+UPIPE_HELPER_UREFCOUNT(upipe_xdp_source, urefcount, upipe_xdp_source_free)
+UPIPE_HELPER_VOID(upipe_xdp_source)
+
+UPIPE_HELPER_OUTPUT(upipe_xdp_source, output, flow_def, output_state,
+                    request_list)
+UPIPE_HELPER_UREF_MGR(upipe_xdp_source, uref_mgr, uref_mgr_request,
+                      upipe_xdp_source_check,
+                      upipe_xdp_source_register_output_request,
+                      upipe_xdp_source_unregister_output_request)
+UPIPE_HELPER_UCLOCK(upipe_xdp_source, uclock, uclock_request,
+                    upipe_xdp_source_check,
+                    upipe_xdp_source_register_output_request,
+                    upipe_xdp_source_unregister_output_request)
+
+UPIPE_HELPER_UPUMP_MGR(upipe_xdp_source, upump_mgr)
+UPIPE_HELPER_UPUMP(upipe_xdp_source, upump, upump_mgr)
+UPIPE_HELPER_UPUMP(upipe_xdp_source, upump_timer, upump_mgr)
+
+/** @internal @This calls the bpf system call.
+ *
+ * @param cmd command
+ * @param attr attributes of the command
+ * @return the result of the system call
+ */
+static int upipe_xdp_bpf(int cmd, union bpf_attr *attr)
+{
+    return syscall(__NR_bpf, cmd, attr, sizeof(union bpf_attr));
+}
+
+/** @internal @This creates a BPF map.
+ *
+ * @param type type of map
+ * @param key_size size of the keys
+ * @param value_size size of the values
+ * @return file descriptor of the map, or -1 in case of error
+ */
+static int upipe_xdp_map_create(enum bpf_map_type type,
+                                uint32_t key_size, uint32_t value_size)
+{
+    union bpf_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.map_type = type;
+    attr.key_size = key_size;
+    attr.value_size = value_size;
+    attr.max_entries = XDP_NB_QUEUES;
+    return upipe_xdp_bpf(BPF_MAP_CREATE, &attr);
+}
+
+/** @internal @This updates an element of a BPF map.
+ *
+ * @param fd file descriptor of the map
+ * @param key pointer to the key
+ * @param value pointer to the value
+ * @return the result of the system call
+ */
+static int upipe_xdp_map_update(int fd, const void *key, const void *value)
+{
+    union bpf_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.map_fd = fd;
+    attr.key = (uintptr_t)key;
+    attr.value = (uintptr_t)value;
+    attr.flags = BPF_ANY;
+    return upipe_xdp_bpf(BPF_MAP_UPDATE_ELEM, &attr);
+}
+
+/** @internal @This builds a BPF instruction. */
+#define XDP_INSN(CODE, DST, SRC, OFF, IMM)                                  \
+    ((struct bpf_insn){ .code = (CODE), .dst_reg = (DST), .src_reg = (SRC), \
+                        .off = (OFF), .imm = (IMM) })
+
+/** @internal @This loads the XDP program redirecting the datagrams matching
+ * the filter of the receive queue to the AF_XDP socket of the queue.
+ *
+ * @param xsk_map_fd file descriptor of the map of sockets
+ * @param filter_map_fd file descriptor of the map of filters
+ * @return file descriptor of the program, or -1 in case of error
+ */
+static int upipe_xdp_prog_load(int xsk_map_fd, int filter_map_fd)
+{
+    struct bpf_insn insns[64];
+    unsigned int pass_jumps[16];
+    unsigned int n = 0, nb_pass = 0;
+#define EMIT(...) insns[n++] = XDP_INSN(__VA_ARGS__)
+#define EMIT_PASS(...) do {                                                 \
+    pass_jumps[nb_pass++] = n;                                              \
+    EMIT(__VA_ARGS__);                                                      \
+} while (0)
+
+    /* r7 = queue, r8 = filter of the queue */
+    EMIT(BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_6, BPF_REG_1, 0, 0);
+    EMIT(BPF_LDX | BPF_MEM | BPF_W, BPF_REG_7, BPF_REG_6,
+         offsetof(struct xdp_md, rx_queue_index), 0);
+    EMIT(BPF_STX | BPF_MEM | BPF_W, BPF_REG_10, BPF_REG_7, -4, 0);
+    EMIT(BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_2, BPF_REG_10, 0, 0);
+    EMIT(BPF_ALU64 | BPF_ADD | BPF_K, BPF_REG_2, 0, 0, -4);
+    EMIT(BPF_LD | BPF_DW | BPF_IMM, BPF_REG_1, BPF_PSEUDO_MAP_FD, 0,
+         filter_map_fd);
+    EMIT(0, 0, 0, 0, 0);
+    EMIT(BPF_JMP | BPF_CALL, 0, 0, 0, BPF_FUNC_map_lookup_elem);
+    EMIT_PASS(BPF_JMP | BPF_JEQ | BPF_K, BPF_REG_0, 0, 0, 0);
+    EMIT(BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_8, BPF_REG_0, 0, 0);
+
+    /* r2 = Ethernet header, checked up to the end of the UDP header */
+    EMIT(BPF_LDX | BPF_MEM | BPF_W, BPF_REG_2, BPF_REG_6,
+         offsetof(struct xdp_md, data), 0);
+    EMIT(BPF_LDX | BPF_MEM | BPF_W, BPF_REG_3, BPF_REG_6,
+         offsetof(struct xdp_md, data_end), 0);
+    EMIT(BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_4, BPF_REG_2, 0, 0);
+    EMIT(BPF_ALU64 | BPF_ADD | BPF_K, BPF_REG_4, 0, 0, XDP_HEADERS_SIZE);
+    EMIT_PASS(BPF_JMP | BPF_JGT | BPF_X, BPF_REG_4, BPF_REG_3, 0, 0);
+
+    /* IPv4 without options, UDP, not fragmented */
+    EMIT(BPF_LDX | BPF_MEM | BPF_H, BPF_REG_5, BPF_REG_2, 12, 0);
+    EMIT_PASS(BPF_JMP32 | BPF_JNE | BPF_K, BPF_REG_5, 0, 0, htons(ETH_P_IP));
+    EMIT(BPF_LDX | BPF_MEM | BPF_B, BPF_REG_5, BPF_REG_2, ETH_HLEN, 0);
+    EMIT_PASS(BPF_JMP32 | BPF_JNE | BPF_K, BPF_REG_5, 0, 0, 0x45);
+    EMIT(BPF_LDX | BPF_MEM | BPF_B, BPF_REG_5, BPF_REG_2, ETH_HLEN + 9, 0);
+    EMIT_PASS(BPF_JMP32 | BPF_JNE | BPF_K, BPF_REG_5, 0, 0, IPPROTO_UDP);
+    EMIT(BPF_LDX | BPF_MEM | BPF_H, BPF_REG_5, BPF_REG_2, ETH_HLEN + 6, 0);
+    EMIT(BPF_ALU | BPF_AND | BPF_K, BPF_REG_5, 0, 0, htons(0x3fff));
+    EMIT_PASS(BPF_JMP32 | BPF_JNE | BPF_K, BPF_REG_5, 0, 0, 0);
+
+    /* destination address, if any, and port */
+    EMIT(BPF_LDX | BPF_MEM | BPF_W, BPF_REG_4, BPF_REG_8,
+         offsetof(struct upipe_xdp_filter, group), 0);
+    EMIT(BPF_JMP32 | BPF_JEQ | BPF_K, BPF_REG_4, 0, 2, 0);
+    EMIT(BPF_LDX | BPF_MEM | BPF_W, BPF_REG_5, BPF_REG_2, ETH_HLEN + 16, 0);
+    EMIT_PASS(BPF_JMP32 | BPF_JNE | BPF_X, BPF_REG_5, BPF_REG_4, 0, 0);
+    EMIT(BPF_LDX | BPF_MEM | BPF_W, BPF_REG_4, BPF_REG_8,
+         offsetof(struct upipe_xdp_filter, port), 0);
+    EMIT(BPF_LDX | BPF_MEM | BPF_H, BPF_REG_5, BPF_REG_2, ETH_HLEN + 22, 0);
+    EMIT_PASS(BPF_JMP32 | BPF_JNE | BPF_X, BPF_REG_5, BPF_REG_4, 0, 0);
+
+    /* redirect to the socket of the queue, or pass if there is none */
+    EMIT(BPF_LD | BPF_DW | BPF_IMM, BPF_REG_1, BPF_PSEUDO_MAP_FD, 0,
+         xsk_map_fd);
+    EMIT(0, 0, 0, 0, 0);
+    EMIT(BPF_ALU64 | BPF_MOV | BPF_X, BPF_REG_2, BPF_REG_7, 0, 0);
+    EMIT(BPF_ALU64 | BPF_MOV | BPF_K, BPF_REG_3, 0, 0, XDP_PASS);
+    EMIT(BPF_JMP | BPF_CALL, 0, 0, 0, BPF_FUNC_redirect_map);
+    EMIT(BPF_JMP | BPF_EXIT, 0, 0, 0, 0);
+
+    for (unsigned int i = 0; i < nb_pass; i++)
+        insns[pass_jumps[i]].off = n - pass_jumps[i] - 1;
+    EMIT(BPF_ALU64 | BPF_MOV | BPF_K, BPF_REG_0, 0, 0, XDP_PASS);
+    EMIT(BPF_JMP | BPF_EXIT, 0, 0, 0, 0);
+#undef EMIT_PASS
+#undef EMIT
+
+    union bpf_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.prog_type = BPF_PROG_TYPE_XDP;
+    attr.insns = (uintptr_t)insns;
+    attr.insn_cnt = n;
+    attr.license = (uintptr_t)"Dual MIT/GPL";
+    return upipe_xdp_bpf(BPF_PROG_LOAD, &attr);
+}
+
+/** @internal @This detaches an XDP program from the interface and frees it.
+ *
+ * @param prog pointer to the XDP program, not in the list of programs
+ */
+static void upipe_xdp_prog_free(struct upipe_xdp_prog *prog)
+{
+    ubase_clean_fd(&prog->link_fd);
+    ubase_clean_fd(&prog->prog_fd);
+    ubase_clean_fd(&prog->filter_map_fd);
+    ubase_clean_fd(&prog->xsk_map_fd);
+    free(prog);
+}
+
+/** @internal @This releases an XDP program, and detaches it from the
+ * interface if it is not used anymore.
+ *
+ * @param prog pointer to the XDP program
+ */
+static void upipe_xdp_prog_release(struct upipe_xdp_prog *prog)
+{
+    if (prog == NULL)
+        return;
+    pthread_mutex_lock(&upipe_xdp_progs_lock);
+    bool last = !--prog->refcount;
+    if (last)
+        ulist_delete(upipe_xdp_prog_to_uchain(prog));
+    pthread_mutex_unlock(&upipe_xdp_progs_lock);
+    if (last)
+        upipe_xdp_prog_free(prog);
+}
+
+/** @internal @This returns the XDP program attached to an interface, and
+ * attaches it if needed.
+ *
+ * @param upipe description structure of the pipe
+ * @param ifindex interface index
+ * @return pointer to the XDP program, or NULL in case of error
+ */
+static struct upipe_xdp_prog *upipe_xdp_prog_use(struct upipe *upipe,
+                                                 int ifindex)
+{
+    struct upipe_xdp_prog *prog = NULL;
+    struct uchain *uchain;
+    pthread_mutex_lock(&upipe_xdp_progs_lock);
+    ulist_foreach (&upipe_xdp_progs, uchain) {
+        struct upipe_xdp_prog *p = upipe_xdp_prog_from_uchain(uchain);
+        if (p->ifindex == ifindex) {
+            prog = p;
+            prog->refcount++;
+            break;
+        }
+    }
+    if (prog != NULL)
+        goto upipe_xdp_prog_use_end;
+
+    prog = malloc(sizeof(struct upipe_xdp_prog));
+    if (unlikely(prog == NULL)) {
+        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+        goto upipe_xdp_prog_use_end;
+    }
+    uchain_init(upipe_xdp_prog_to_uchain(prog));
+    prog->refcount = 1;
+    prog->ifindex = ifindex;
+    prog->prog_fd = prog->link_fd = -1;
+    prog->xsk_map_fd = upipe_xdp_map_create(BPF_MAP_TYPE_XSKMAP,
+                                            sizeof(uint32_t),
+                                            sizeof(uint32_t));
+    prog->filter_map_fd = upipe_xdp_map_create(BPF_MAP_TYPE_ARRAY,
+            sizeof(uint32_t), sizeof(struct upipe_xdp_filter));
+    if (unlikely(prog->xsk_map_fd == -1 || prog->filter_map_fd == -1)) {
+        upipe_err_va(upipe, "unable to create BPF maps (%m)");
+        goto upipe_xdp_prog_use_err;
+    }
+
+    prog->prog_fd = upipe_xdp_prog_load(prog->xsk_map_fd,
+                                        prog->filter_map_fd);
+    if (unlikely(prog->prog_fd == -1)) {
+        upipe_err_va(upipe, "unable to load XDP program (%m)");
+        goto upipe_xdp_prog_use_err;
+    }
+
+    union bpf_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.link_create.prog_fd = prog->prog_fd;
+    attr.link_create.target_ifindex = ifindex;
+    attr.link_create.attach_type = BPF_XDP;
+    attr.link_create.flags = XDP_FLAGS_DRV_MODE;
+    prog->link_fd = upipe_xdp_bpf(BPF_LINK_CREATE, &attr);
+    if (prog->link_fd == -1) {
+        upipe_warn_va(upipe, "unable to attach XDP program in driver mode (%m)");
+        attr.link_create.flags = XDP_FLAGS_SKB_MODE;
+        prog->link_fd = upipe_xdp_bpf(BPF_LINK_CREATE, &attr);
+    }
+    if (unlikely(prog->link_fd == -1)) {
+        upipe_err_va(upipe, "unable to attach XDP program (%m)");
+        goto upipe_xdp_prog_use_err;
+    }
+    ulist_add(&upipe_xdp_progs, upipe_xdp_prog_to_uchain(prog));
+
+upipe_xdp_prog_use_end:
+    pthread_mutex_unlock(&upipe_xdp_progs_lock);
+    return prog;
+
+upipe_xdp_prog_use_err:
+    pthread_mutex_unlock(&upipe_xdp_progs_lock);
+    /* the program was never added to the list */
+    upipe_xdp_prog_free(prog);
+    return NULL;
+}
+
+/** @internal @This maps a ring shared with the kernel.
+ *
+ * @param ring pointer to the ring
+ * @param fd AF_XDP socket
+ * @param offsets offsets of the ring
+ * @param pgoff offset of the ring in the socket
+ * @param size number of descriptors
+ * @param desc_size size of a descriptor
+ * @return false in case of error
+ */
+static bool upipe_xdp_ring_map(struct upipe_xdp_ring *ring, int fd,
+                               const struct xdp_ring_offset *offsets,
+                               off_t pgoff, uint32_t size, size_t desc_size)
+{
+    ring->map_size = offsets->desc + size * desc_size;
+    ring->map = mmap(NULL, ring->map_size, PROT_READ | PROT_WRITE,
+                     MAP_SHARED | MAP_POPULATE, fd, pgoff);
+    if (unlikely(ring->map == MAP_FAILED)) {
+        ring->map = NULL;
+        return false;
+    }
+    uint8_t *map = ring->map;
+    ring->producer = (uint32_t *)(map + offsets->producer);
+    ring->consumer = (uint32_t *)(map + offsets->consumer);
+    ring->flags = (uint32_t *)(map + offsets->flags);
+    ring->descs = map + offsets->desc;
+    ring->size = size;
+    ring->cached = 0;
+    return true;
+}
+
+/** @internal @This unmaps a ring shared with the kernel.
+ *
+ * @param ring pointer to the ring
+ */
+static void upipe_xdp_ring_unmap(struct upipe_xdp_ring *ring)
+{
+    if (ring->map != NULL)
+        munmap(ring->map, ring->map_size);
+    ring->map = NULL;
+}
+
+/** @This frees the AF_XDP socket and the UMEM area.
+ *
+ * @param urefcount pointer to urefcount
+ */
+static void upipe_xdp_umem_free(struct urefcount *urefcount)
+{
+    struct upipe_xdp_umem *umem = upipe_xdp_umem_from_urefcount(urefcount);
+    ubase_clean_fd(&umem->fd);
+    upipe_xdp_ring_unmap(&umem->rx);
+    upipe_xdp_ring_unmap(&umem->comp);
+    upipe_xdp_ring_unmap(&umem->fill);
+    if (umem->area != NULL)
+        munmap(umem->area, (size_t)XDP_NB_FRAMES * XDP_FRAME_SIZE);
+    upool_clean(&umem->ubuf_pool);
+    while (ulifo_pop(&umem->recycle, struct upipe_xdp_frame *) != NULL);
+    ulifo_clean(&umem->recycle);
+    for (unsigned int i = 0; i < XDP_NB_FRAMES; i++)
+        uatomic_clean(&umem->frames[i].refcount);
+    urefcount_clean(urefcount);
+    free(umem);
+}
+
+/** @internal @This gives a frame back to the kernel, once it isn't used by
+ * any ubuf anymore.
+ *
+ * @param umem pointer to the UMEM area
+ * @param frame pointer to the frame
+ */
+static void upipe_xdp_frame_release(struct upipe_xdp_umem *umem,
+                                    struct upipe_xdp_frame *frame)
+{
+    if (uatomic_fetch_sub(&frame->refcount, 1) == 1)
+        ulifo_push(&umem->recycle, frame);
+}
+
+/** @internal @This allocates a ubuf structure from the pool.
+ *
+ * @param umem pointer to the UMEM area
+ * @param frame pointer to the frame, whose reference is taken over
+ * @return pointer to ubuf or NULL in case of allocation error
+ */
+static struct ubuf *upipe_xdp_ubuf_alloc(struct upipe_xdp_umem *umem,
+                                         struct upipe_xdp_frame *frame)
+{
+    struct upipe_xdp_ubuf *xdp_ubuf =
+        upool_alloc(&umem->ubuf_pool, struct upipe_xdp_ubuf *);
+    if (unlikely(xdp_ubuf == NULL))
+        return NULL;
+    xdp_ubuf->frame = frame;
+    struct ubuf *ubuf = upipe_xdp_ubuf_to_ubuf(xdp_ubuf);
+    ubuf_block_common_init(ubuf, false);
+    ubuf_block_common_set_buffer(ubuf, umem->area + frame->addr);
+    return ubuf;
+}
+
+/** @This refuses to allocate arbitrary ubufs.
+ *
+ * @param mgr common management structure
+ * @param signature signature of the allocator
+ * @param args optional arguments
+ * @return NULL
+ */
+static struct ubuf *upipe_xdp_umem_alloc(struct ubuf_mgr *mgr,
+                                         uint32_t signature, va_list args)
+{
+    return NULL;
+}
+
+/** @This creates a new reference to the same frame, with another offset
+ * and size.
+ *
+ * @param ubuf pointer to ubuf
+ * @param new_ubuf_p reference written with a pointer to the newly allocated
+ * ubuf
+ * @param offset offset in the buffer, or -1 to duplicate the ubuf
+ * @param size final size of the buffer
+ * @return an error code
+ */
+static int upipe_xdp_ubuf_splice(struct ubuf *ubuf, struct ubuf **new_ubuf_p,
+                                 int offset, int size)
+{
+    assert(new_ubuf_p != NULL);
+    struct upipe_xdp_umem *umem = upipe_xdp_umem_from_ubuf_mgr(ubuf->mgr);
+    struct upipe_xdp_ubuf *xdp_ubuf = upipe_xdp_ubuf_from_ubuf(ubuf);
+    uatomic_fetch_add(&xdp_ubuf->frame->refcount, 1);
+    struct ubuf *new_ubuf = upipe_xdp_ubuf_alloc(umem, xdp_ubuf->frame);
+    if (unlikely(new_ubuf == NULL)) {
+        upipe_xdp_frame_release(umem, xdp_ubuf->frame);
+        return UBASE_ERR_ALLOC;
+    }
+
+    int err = offset < 0 ? ubuf_block_common_dup(ubuf, new_ubuf) :
+              ubuf_block_common_splice(ubuf, new_ubuf, offset, size);
+    if (unlikely(!ubase_check(err))) {
+        ubuf_free(new_ubuf);
+        return UBASE_ERR_INVALID;
+    }
+    *new_ubuf_p = new_ubuf;
+    return UBASE_ERR_NONE;
+}
+
+/** @This handles control commands.
+ *
+ * @param ubuf pointer to ubuf
+ * @param command type of command to process
+ * @param args arguments of the command
+ * @return an error code
+ */
+static int upipe_xdp_ubuf_control(struct ubuf *ubuf, int command, va_list args)
+{
+    switch (command) {
+        case UBUF_DUP: {
+            struct ubuf **new_ubuf_p = va_arg(args, struct ubuf **);
+            return upipe_xdp_ubuf_splice(ubuf, new_ubuf_p, -1, 0);
+        }
+        case UBUF_SINGLE: {
+            struct upipe_xdp_ubuf *xdp_ubuf = upipe_xdp_ubuf_from_ubuf(ubuf);
+            return uatomic_load(&xdp_ubuf->frame->refcount) == 1 ?
+                   UBASE_ERR_NONE : UBASE_ERR_BUSY;
+        }
+        case UBUF_SPLICE_BLOCK: {
+            struct ubuf **new_ubuf_p = va_arg(args, struct ubuf **);
+            int offset = va_arg(args, int);
+            int size = va_arg(args, int);
+            return upipe_xdp_ubuf_splice(ubuf, new_ubuf_p, offset, size);
+        }
+        default:
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** @This releases a ubuf, and the frame if it was the last reference.
+ *
+ * @param ubuf pointer to a ubuf structure
+ */
+static void upipe_xdp_ubuf_free(struct ubuf *ubuf)
+{
+    struct upipe_xdp_umem *umem = upipe_xdp_umem_from_ubuf_mgr(ubuf->mgr);
+    struct upipe_xdp_ubuf *xdp_ubuf = upipe_xdp_ubuf_from_ubuf(ubuf);
+    ubuf_block_common_clean(ubuf);
+    upipe_xdp_frame_release(umem, xdp_ubuf->frame);
+    /* may free the UMEM area */
+    upool_free(&umem->ubuf_pool, xdp_ubuf);
+}
+
+/** @internal @This allocates the data structure.
+ *
+ * @param upool pointer to upool
+ * @return pointer to upipe_xdp_ubuf or NULL in case of allocation error
+ */
+static void *upipe_xdp_ubuf_alloc_inner(struct upool *upool)
+{
+    struct upipe_xdp_umem *umem = upipe_xdp_umem_from_ubuf_pool(upool);
+    struct upipe_xdp_ubuf *xdp_ubuf = malloc(sizeof(struct upipe_xdp_ubuf));
+    if (unlikely(xdp_ubuf == NULL))
+        return NULL;
+    upipe_xdp_ubuf_to_ubuf(xdp_ubuf)->mgr = upipe_xdp_umem_to_ubuf_mgr(umem);
+    return xdp_ubuf;
+}
+
+/** @internal @This frees a upipe_xdp_ubuf.
+ *
+ * @param upool pointer to upool
+ * @param xdp_ubuf pointer to a upipe_xdp_ubuf structure to free
+ */
+static void upipe_xdp_ubuf_free_inner(struct upool *upool, void *xdp_ubuf)
+{
+    free(xdp_ubuf);
+}
+
+/** @This handles manager control commands.
+ *
+ * @param mgr pointer to ubuf manager
+ * @param command type of command to process
+ * @param args arguments of the command
+ * @return an error code
+ */
+static int upipe_xdp_umem_control(struct ubuf_mgr *mgr,
+                                  int command, va_list args)
+{
+    struct upipe_xdp_umem *umem = upipe_xdp_umem_from_ubuf_mgr(mgr);
+    switch (command) {
+        case UBUF_MGR_VACUUM:
+            upool_vacuum(&umem->ubuf_pool);
+            return UBASE_ERR_NONE;
+        default:
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** @internal @This opens an AF_XDP socket with its UMEM area, and binds it to
+ * a receive queue.
+ *
+ * @param upipe description structure of the pipe
+ * @param ifindex interface index
+ * @param queue receive queue
+ * @return pointer to the UMEM area, or NULL in case of error
+ */
+static struct upipe_xdp_umem *upipe_xdp_umem_alloc_socket(struct upipe *upipe,
+                                                          int ifindex,
+                                                          unsigned int queue)
+{
+    struct upipe_xdp_umem *umem =
+        malloc(sizeof(struct upipe_xdp_umem) + ulifo_sizeof(XDP_NB_FRAMES) +
+               upool_sizeof(XDP_UBUF_POOL));
+    if (unlikely(umem == NULL)) {
+        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+        return NULL;
+    }
+
+    urefcount_init(upipe_xdp_umem_to_urefcount(umem), upipe_xdp_umem_free);
+    umem->mgr.refcount = upipe_xdp_umem_to_urefcount(umem);
+    umem->mgr.signature = UBUF_ALLOC_BLOCK;
+    umem->mgr.ubuf_alloc = upipe_xdp_umem_alloc;
+    umem->mgr.ubuf_control = upipe_xdp_ubuf_control;
+    umem->mgr.ubuf_free = upipe_xdp_ubuf_free;
+    umem->mgr.ubuf_mgr_control = upipe_xdp_umem_control;
+    ulifo_init(&umem->recycle, XDP_NB_FRAMES, umem->extra);
+    upool_init(&umem->ubuf_pool, umem->mgr.refcount, XDP_UBUF_POOL,
+               umem->extra + ulifo_sizeof(XDP_NB_FRAMES),
+               upipe_xdp_ubuf_alloc_inner, upipe_xdp_ubuf_free_inner);
+    for (unsigned int i = 0; i < XDP_NB_FRAMES; i++) {
+        uatomic_init(&umem->frames[i].refcount, 0);
+        umem->frames[i].addr = (uint64_t)i * XDP_FRAME_SIZE;
+    }
+    umem->fill.map = umem->comp.map = umem->rx.map = NULL;
+    umem->area = mmap(NULL, (size_t)XDP_NB_FRAMES * XDP_FRAME_SIZE,
+                      PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS,
+                      -1, 0);
+    if (unlikely(umem->area == MAP_FAILED)) {
+        umem->area = NULL;
+        umem->fd = -1;
+        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+        goto upipe_xdp_umem_alloc_err;
+    }
+
+    umem->fd = socket(AF_XDP, SOCK_RAW | SOCK_CLOEXEC, 0);
+    if (unlikely(umem->fd == -1)) {
+        upipe_err_va(upipe, "unable to open AF_XDP socket (%m)");
+        goto upipe_xdp_umem_alloc_err;
+    }
+
+    struct xdp_umem_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.addr = (uintptr_t)umem->area;
+    reg.len = (uint64_t)XDP_NB_FRAMES * XDP_FRAME_SIZE;
+    reg.chunk_size = XDP_FRAME_SIZE;
+    reg.headroom = 0;
+    int fill_size = XDP_NB_FRAMES, comp_size = XDP_COMP_SIZE;
+    int rx_size = XDP_RX_SIZE;
+    struct xdp_mmap_offsets offsets;
+    socklen_t optlen = sizeof(offsets);
+    if (unlikely(setsockopt(umem->fd, SOL_XDP, XDP_UMEM_REG,
+                            &reg, sizeof(reg)) < 0 ||
+                 setsockopt(umem->fd, SOL_XDP, XDP_UMEM_FILL_RING,
+                            &fill_size, sizeof(fill_size)) < 0 ||
+                 setsockopt(umem->fd, SOL_XDP, XDP_UMEM_COMPLETION_RING,
+                            &comp_size, sizeof(comp_size)) < 0 ||
+                 setsockopt(umem->fd, SOL_XDP, XDP_RX_RING,
+                            &rx_size, sizeof(rx_size)) < 0 ||
+                 getsockopt(umem->fd, SOL_XDP, XDP_MMAP_OFFSETS,
+                            &offsets, &optlen) < 0)) {
+        upipe_err_va(upipe, "unable to set up UMEM area (%m)");
+        goto upipe_xdp_umem_alloc_err;
+    }
+
+    if (unlikely(!upipe_xdp_ring_map(&umem->fill, umem->fd, &offsets.fr,
+                                     XDP_UMEM_PGOFF_FILL_RING, fill_size,
+                                     sizeof(uint64_t)) ||
+                 !upipe_xdp_ring_map(&umem->comp, umem->fd, &offsets.cr,
+                                     XDP_UMEM_PGOFF_COMPLETION_RING,
+                                     comp_size, sizeof(uint64_t)) ||
+                 !upipe_xdp_ring_map(&umem->rx, umem->fd, &offsets.rx,
+                                     XDP_PGOFF_RX_RING, rx_size,
+                                     sizeof(struct xdp_desc)))) {
+        upipe_err_va(upipe, "unable to map AF_XDP rings (%m)");
+        goto upipe_xdp_umem_alloc_err;
+    }
+
+    /* give all frames to the kernel */
+    uint64_t *addrs = umem->fill.descs;
+    for (unsigned int i = 0; i < XDP_NB_FRAMES; i++)
+        addrs[i] = umem->frames[i].addr;
+    umem->fill.cached = XDP_NB_FRAMES;
+    __atomic_store_n(umem->fill.producer, umem->fill.cached,
+                     __ATOMIC_RELEASE);
+    umem->rx.cached = __atomic_load_n(umem->rx.consumer, __ATOMIC_ACQUIRE);
+
+    struct sockaddr_xdp sxdp;
+    memset(&sxdp, 0, sizeof(sxdp));
+    sxdp.sxdp_family = AF_XDP;
+    sxdp.sxdp_ifindex = ifindex;
+    sxdp.sxdp_queue_id = queue;
+    sxdp.sxdp_flags = XDP_ZEROCOPY | XDP_USE_NEED_WAKEUP;
+    if (bind(umem->fd, (struct sockaddr *)&sxdp, sizeof(sxdp)) < 0) {
+        upipe_dbg_va(upipe, "zero-copy mode unavailable (%m)");
+        sxdp.sxdp_flags = XDP_COPY | XDP_USE_NEED_WAKEUP;
+        if (unlikely(bind(umem->fd, (struct sockaddr *)&sxdp,
+                          sizeof(sxdp)) < 0)) {
+            upipe_err_va(upipe, "unable to bind AF_XDP socket (%m)");
+            goto upipe_xdp_umem_alloc_err;
+        }
+        upipe_notice(upipe, "using copy mode");
+    }
+    return umem;
+
+upipe_xdp_umem_alloc_err:
+    urefcount_release(upipe_xdp_umem_to_urefcount(umem));
+    return NULL;
+}
+
+/** @internal @This allocates an AF_XDP source pipe.
+ *
+ * @param mgr common management structure
+ * @param uprobe structure used to raise events
+ * @param signature signature of the pipe allocator
+ * @param args optional arguments
+ * @return pointer to upipe or NULL in case of allocation error
+ */
+static struct upipe *upipe_xdp_source_alloc(struct upipe_mgr *mgr,
+                                            struct uprobe *uprobe,
+                                            uint32_t signature, va_list args)
+{
+    struct upipe *upipe = upipe_xdp_source_alloc_void(mgr, uprobe, signature,
+                                                      args);
+    struct upipe_xdp_source *upipe_xdp_source =
+        upipe_xdp_source_from_upipe(upipe);
+    upipe_xdp_source_init_urefcount(upipe);
+    upipe_xdp_source_init_uref_mgr(upipe);
+    upipe_xdp_source_init_output(upipe);
+    upipe_xdp_source_init_upump_mgr(upipe);
+    upipe_xdp_source_init_upump(upipe);
+    upipe_xdp_source_init_upump_timer(upipe);
+    upipe_xdp_source_init_uclock(upipe);
+    upipe_xdp_source->umem = NULL;
+    upipe_xdp_source->prog = NULL;
+    upipe_xdp_source->queue = 0;
+    upipe_xdp_source->uri = NULL;
+    upipe_throw_ready(upipe);
+    return upipe;
+}
+
+/** @internal @This gives the released frames back to the kernel.
+ *
+ * @param umem pointer to the UMEM area
+ */
+static void upipe_xdp_umem_refill(struct upipe_xdp_umem *umem)
+{
+    struct upipe_xdp_ring *fill = &umem->fill;
+    uint32_t consumer = __atomic_load_n(fill->consumer, __ATOMIC_ACQUIRE);
+    uint32_t free_slots = fill->size - (fill->cached - consumer);
+    uint64_t *addrs = fill->descs;
+    uint32_t n = 0;
+    struct upipe_xdp_frame *frame;
+    while (n < free_slots &&
+           (frame = ulifo_pop(&umem->recycle,
+                              struct upipe_xdp_frame *)) != NULL)
+        addrs[(fill->cached + n++) & (fill->size - 1)] = frame->addr;
+
+    if (n) {
+        fill->cached += n;
+        __atomic_store_n(fill->producer, fill->cached, __ATOMIC_RELEASE);
+    }
+    if (__atomic_load_n(fill->flags, __ATOMIC_ACQUIRE) & XDP_RING_NEED_WAKEUP)
+        recvfrom(umem->fd, NULL, 0, MSG_DONTWAIT, NULL, NULL);
+}
+
+/** @internal @This outputs a received datagram.
+ *
+ * @param upipe description structure of the pipe
+ * @param desc receive descriptor
+ * @param systime date of the reception
+ */
+static void upipe_xdp_source_process(struct upipe *upipe,
+                                     const struct xdp_desc *desc,
+                                     uint64_t systime)
+{
+    struct upipe_xdp_source *upipe_xdp_source =
+        upipe_xdp_source_from_upipe(upipe);
+    struct upipe_xdp_umem *umem = upipe_xdp_source->umem;
+    struct upipe_xdp_frame *frame = &umem->frames[desc->addr / XDP_FRAME_SIZE];
+    uatomic_store(&frame->refcount, 1);
+
+    /* the headers were checked by the XDP program */
+    const uint8_t *eth = umem->area + desc->addr;
+    const uint8_t *udp = eth + ETH_HLEN + 20;
+    size_t size = ((udp[4] << 8) | udp[5]) - 8;
+    if (unlikely(desc->len < XDP_HEADERS_SIZE ||
+                 size > desc->len - XDP_HEADERS_SIZE)) {
+        upipe_warn(upipe, "received invalid datagram");
+        upipe_xdp_frame_release(umem, frame);
+        return;
+    }
+
+    struct ubuf *ubuf = upipe_xdp_ubuf_alloc(umem, frame);
+    if (unlikely(ubuf == NULL)) {
+        upipe_xdp_frame_release(umem, frame);
+        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+        return;
+    }
+    ubuf_block_common_set(ubuf, desc->addr - frame->addr + XDP_HEADERS_SIZE,
+                          size);
+
+    struct uref *uref = uref_alloc(upipe_xdp_source->uref_mgr);
+    if (unlikely(uref == NULL)) {
+        ubuf_free(ubuf);
+        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+        return;
+    }
+    uref_attach_ubuf(uref, ubuf);
+    if (likely(upipe_xdp_source->uclock != NULL))
+        uref_clock_set_cr_sys(uref, systime);
+    upipe_xdp_source_output(upipe, uref, &upipe_xdp_source->upump);
+}
+
+/** @internal @This reads the datagrams of the receive ring and outputs
+ * them.
+ *
+ * @param upump description structure of the read watcher
+ */
+static void upipe_xdp_source_worker(struct upump *upump)
+{
+    struct upipe *upipe = upump_get_opaque(upump, struct upipe *);
+    struct upipe_xdp_source *upipe_xdp_source =
+        upipe_xdp_source_from_upipe(upipe);
+    struct upipe_xdp_umem *umem = upipe_xdp_source->umem;
+    struct upipe_xdp_ring *rx = &umem->rx;
+
+    uint64_t systime = 0;
+    if (likely(upipe_xdp_source->uclock != NULL))
+        systime = uclock_now(upipe_xdp_source->uclock);
+
+    /* the pipe may be closed by the output */
+    urefcount_use(upipe_xdp_umem_to_urefcount(umem));
+    uint32_t producer = __atomic_load_n(rx->producer, __ATOMIC_ACQUIRE);
+    unsigned int n = 0;
+    while (rx->cached != producer && n++ < XDP_BURST &&
+           upipe_xdp_source->umem == umem) {
+        struct xdp_desc *descs = rx->descs;
+        struct xdp_desc desc = descs[rx->cached++ & (rx->size - 1)];
+        __atomic_store_n(rx->consumer, rx->cached, __ATOMIC_RELEASE);
+        upipe_xdp_source_process(upipe, &desc, systime);
+    }
+    upipe_xdp_umem_refill(umem);
+    urefcount_release(upipe_xdp_umem_to_urefcount(umem));
+}
+
+/** @internal @This periodically gives the frames released in other threads
+ * back to the kernel.
+ *
+ * @param upump description structure of the timer
+ */
+static void upipe_xdp_source_refill(struct upump *upump)
+{
+    struct upipe *upipe = upump_get_opaque(upump, struct upipe *);
+    struct upipe_xdp_source *upipe_xdp_source =
+        upipe_xdp_source_from_upipe(upipe);
+    upipe_xdp_umem_refill(upipe_xdp_source->umem);
+}
+
+/** @internal @This checks if the pump may be allocated.
+ *
+ * @param upipe description structure of the pipe
+ * @param flow_format amended flow format
+ * @return an error code
+ */
+static int upipe_xdp_source_check(struct upipe *upipe,
+                                  struct uref *flow_format)
+{
+    struct upipe_xdp_source *upipe_xdp_source =
+        upipe_xdp_source_from_upipe(upipe);
+    if (flow_format != NULL)
+        upipe_xdp_source_store_flow_def(upipe, flow_format);
+
+    upipe_xdp_source_check_upump_mgr(upipe);
+    if (upipe_xdp_source->upump_mgr == NULL)
+        return UBASE_ERR_NONE;
+
+    if (upipe_xdp_source->uref_mgr == NULL) {
+        upipe_xdp_source_require_uref_mgr(upipe);
+        return UBASE_ERR_NONE;
+    }
+
+    if (upipe_xdp_source->flow_def == NULL) {
+        struct uref *flow_def =
+            uref_block_flow_alloc_def(upipe_xdp_source->uref_mgr, NULL);
+        if (unlikely(flow_def == NULL)) {
+            upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+            return UBASE_ERR_ALLOC;
+        }
+        upipe_xdp_source_store_flow_def(upipe, flow_def);
+    }
+
+    if (upipe_xdp_source->uclock == NULL &&
+        urequest_get_opaque(&upipe_xdp_source->uclock_request, struct upipe *)
+            != NULL)
+        return UBASE_ERR_NONE;
+
+    if (upipe_xdp_source->umem == NULL || upipe_xdp_source->upump != NULL)
+        return UBASE_ERR_NONE;
+
+    struct upump *upump = upump_alloc_fd_read(upipe_xdp_source->upump_mgr,
+            upipe_xdp_source_worker, upipe, upipe->refcount,
+            upipe_xdp_source->umem->fd);
+    struct upump *timer = upump_alloc_timer(upipe_xdp_source->upump_mgr,
+            upipe_xdp_source_refill, upipe, upipe->refcount,
+            XDP_REFILL_PERIOD, XDP_REFILL_PERIOD);
+    if (unlikely(upump == NULL || timer == NULL)) {
+        if (upump != NULL)
+            upump_free(upump);
+        if (timer != NULL)
+            upump_free(timer);
+        upipe_throw_fatal(upipe, UBASE_ERR_UPUMP);
+        return UBASE_ERR_UPUMP;
+    }
+    upipe_xdp_source_set_upump(upipe, upump);
+    upipe_xdp_source_set_upump_timer(upipe, timer);
+    upump_start(upump);
+    upump_start(timer);
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This returns the uri of the currently opened socket.
+ *
+ * @param upipe description structure of the pipe
+ * @param uri_p filled in with the uri of the socket
+ * @return an error code
+ */
+static int upipe_xdp_source_get_uri(struct upipe *upipe, const char **uri_p)
+{
+    struct upipe_xdp_source *upipe_xdp_source =
+        upipe_xdp_source_from_upipe(upipe);
+    assert(uri_p != NULL);
+    *uri_p = upipe_xdp_source->uri;
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This closes the socket and releases the XDP program.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_xdp_source_close(struct upipe *upipe)
+{
+    struct upipe_xdp_source *upipe_xdp_source =
+        upipe_xdp_source_from_upipe(upipe);
+    upipe_xdp_source_set_upump(upipe, NULL);
+    upipe_xdp_source_set_upump_timer(upipe, NULL);
+
+    if (upipe_xdp_source->prog != NULL) {
+        uint32_t queue = upipe_xdp_source->queue;
+        struct upipe_xdp_filter filter = { .group = 0, .port = 0 };
+        upipe_xdp_map_update(upipe_xdp_source->prog->filter_map_fd,
+                             &queue, &filter);
+        upipe_xdp_prog_release(upipe_xdp_source->prog);
+        upipe_xdp_source->prog = NULL;
+    }
+    if (upipe_xdp_source->umem != NULL) {
+        if (likely(upipe_xdp_source->uri != NULL))
+            upipe_notice_va(upipe, "closing AF_XDP socket %s",
+                            upipe_xdp_source->uri);
+        /* the socket stays open until all the frames are released */
+        urefcount_release(upipe_xdp_umem_to_urefcount(upipe_xdp_source->umem));
+        upipe_xdp_source->umem = NULL;
+    }
+    ubase_clean_str(&upipe_xdp_source->uri);
+}
+
+/** @internal @This asks to open the given AF_XDP socket.
+ *
+ * @param upipe description structure of the pipe
+ * @param uri of the form <ifname>-<queue>@[<group>]:<port>
+ * @return an error code
+ */
+static int upipe_xdp_source_set_uri(struct upipe *upipe, const char *uri)
+{
+    struct upipe_xdp_source *upipe_xdp_source =
+        upipe_xdp_source_from_upipe(upipe);
+
+    upipe_xdp_source_close(upipe);
+    if (unlikely(uri == NULL))
+        return UBASE_ERR_NONE;
+
+    char ifname[IF_NAMESIZE];
+    char group[INET_ADDRSTRLEN];
+    unsigned int queue, port;
+    const char *at = strchr(uri, '@');
+    const char *dash = at != NULL ? memrchr(uri, '-', at - uri) : NULL;
+    const char *colon = at != NULL ? strchr(at, ':') : NULL;
+    struct in_addr addr = { .s_addr = 0 };
+    if (dash == NULL || colon == NULL ||
+        dash - uri >= IF_NAMESIZE || colon - at - 1 >= INET_ADDRSTRLEN ||
+        sscanf(dash + 1, "%u@", &queue) != 1 ||
+        sscanf(colon + 1, "%u", &port) != 1 ||
+        !port || port > UINT16_MAX || queue >= XDP_NB_QUEUES) {
+        upipe_err_va(upipe, "invalid AF_XDP uri %s", uri);
+        return UBASE_ERR_INVALID;
+    }
+    memcpy(ifname, uri, dash - uri);
+    ifname[dash - uri] = '\0';
+    memcpy(group, at + 1, colon - at - 1);
+    group[colon - at - 1] = '\0';
+    if (*group && inet_pton(AF_INET, group, &addr) != 1) {
+        upipe_err_va(upipe, "invalid AF_XDP uri %s", uri);
+        return UBASE_ERR_INVALID;
+    }
+
+    int ifindex = if_nametoindex(ifname);
+    if (unlikely(!ifindex)) {
+        upipe_err_va(upipe, "unknown interface %s", ifname);
+        return UBASE_ERR_EXTERNAL;
+    }
+
+    upipe_xdp_source->uri = strdup(uri);
+    if (unlikely(upipe_xdp_source->uri == NULL)) {
+        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+        return UBASE_ERR_ALLOC;
+    }
+    upipe_xdp_source->queue = queue;
+    upipe_xdp_source->umem = upipe_xdp_umem_alloc_socket(upipe, ifindex,
+                                                         queue);
+    if (upipe_xdp_source->umem != NULL)
+        upipe_xdp_source->prog = upipe_xdp_prog_use(upipe, ifindex);
+    if (unlikely(upipe_xdp_source->prog == NULL)) {
+        upipe_xdp_source_close(upipe);
+        return UBASE_ERR_EXTERNAL;
+    }
+
+    uint32_t key = queue;
+    struct upipe_xdp_filter filter = {
+        .group = addr.s_addr,
+        .port = htons(port)
+    };
+    if (unlikely(upipe_xdp_map_update(upipe_xdp_source->prog->xsk_map_fd,
+                                      &key, &upipe_xdp_source->umem->fd) < 0 ||
+                 upipe_xdp_map_update(upipe_xdp_source->prog->filter_map_fd,
+                                      &key, &filter) < 0)) {
+        upipe_err_va(upipe, "unable to set up queue %u (%m)", queue);
+        upipe_xdp_source_close(upipe);
+        return UBASE_ERR_EXTERNAL;
+    }
+
+    upipe_notice_va(upipe, "opening AF_XDP socket %s", upipe_xdp_source->uri);
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This processes control commands on an AF_XDP source pipe.
+ *
+ * @param upipe description structure of the pipe
+ * @param command type of command to process
+ * @param args arguments of the command
+ * @return an error code
+ */
+static int _upipe_xdp_source_control(struct upipe *upipe,
+                                     int command, va_list args)
+{
+    switch (command) {
+        case UPIPE_ATTACH_UPUMP_MGR:
+            upipe_xdp_source_set_upump(upipe, NULL);
+            upipe_xdp_source_set_upump_timer(upipe, NULL);
+            return upipe_xdp_source_attach_upump_mgr(upipe);
+        case UPIPE_ATTACH_UCLOCK:
+            upipe_xdp_source_set_upump(upipe, NULL);
+            upipe_xdp_source_set_upump_timer(upipe, NULL);
+            upipe_xdp_source_require_uclock(upipe);
+            return UBASE_ERR_NONE;
+
+        case UPIPE_GET_FLOW_DEF:
+        case UPIPE_GET_OUTPUT:
+        case UPIPE_SET_OUTPUT:
+            return upipe_xdp_source_control_output(upipe, command, args);
+
+        case UPIPE_GET_URI: {
+            const char **uri_p = va_arg(args, const char **);
+            return upipe_xdp_source_get_uri(upipe, uri_p);
+        }
+        case UPIPE_SET_URI: {
+            const char *uri = va_arg(args, const char *);
+            return upipe_xdp_source_set_uri(upipe, uri);
+        }
+        default:
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** @internal @This processes control commands on an AF_XDP source pipe, and
+ * checks the status of the pipe afterwards.
+ *
+ * @param upipe description structure of the pipe
+ * @param command type of command to process
+ * @param args arguments of the command
+ * @return an error code
+ */
+static int upipe_xdp_source_control(struct upipe *upipe,
+                                    int command, va_list args)
+{
+    UBASE_RETURN(_upipe_xdp_source_control(upipe, command, args));
+
+    return upipe_xdp_source_check(upipe, NULL);
+}
+
+/** @This frees a upipe.
+ *
+ * @param upipe description structure of the pipe
+ */
+static void upipe_xdp_source_free(struct upipe *upipe)
+{
+    upipe_xdp_source_close(upipe);
+    upipe_throw_dead(upipe);
+
+    upipe_xdp_source_clean_uclock(upipe);
+    upipe_xdp_source_clean_upump_timer(upipe);
+    upipe_xdp_source_clean_upump(upipe);
+    upipe_xdp_source_clean_upump_mgr(upipe);
+    upipe_xdp_source_clean_output(upipe);
+    upipe_xdp_source_clean_uref_mgr(upipe);
+    upipe_xdp_source_clean_urefcount(upipe);
+    upipe_xdp_source_free_void(upipe);
+}
+
+/** module manager static descriptor */
+static struct upipe_mgr upipe_xdp_source_mgr = {
+    .refcount = NULL,
+    .signature = UPIPE_XDP_SOURCE_SIGNATURE,
+
+    .upipe_alloc = upipe_xdp_source_alloc,
+    .upipe_input = NULL,
+    .upipe_control = upipe_xdp_source_control,
+
+    .upipe_mgr_control = NULL
+};
+
+/** @This returns the management structure for all AF_XDP sources.
+ *
+ * @return pointer to manager
+ */
+struct upipe_mgr *upipe_xdp_source_mgr_alloc(void)
+{
+    return &upipe_xdp_source_mgr;
+}
@@ -43,6 +43,9 @@
 
 #include <libzvbi.h>
 
+/** size of the raw VBI lines written to each picture */
+#define UPIPE_ZVBIENC_RAW_SIZE (720 * 2)
+
 /** upipe_zvbienc structure */
 struct upipe_zvbienc {
     /** refcount management structure */
@@ -61,6 +64,13 @@ struct upipe_zvbienc {
 
     vbi_sliced sliced[2];
 
+    /** true if raw contains the lines encoded from raw_data */
+    bool raw_valid;
+    /** caption data of the cached lines */
+    uint8_t raw_data[2][2];
+    /** cached encoded lines */
+    uint8_t raw[UPIPE_ZVBIENC_RAW_SIZE];
+
     /** public upipe structure */
     struct upipe upipe;
 };
@@ -96,13 +106,28 @@ static void upipe_zvbienc_input(struct upipe *upipe, struct uref *uref,
             memcpy(upipe_zvbienc->sliced[cc_type].data, &pic_data[3*i + 1], 2);
     }
 
-    uint8_t *buf;
-    if (ubase_check(uref_pic_plane_write(uref, "y8", 0, 1, -1, 2, &buf))) {
-        if (!vbi_raw_video_image(buf, 720*2, &upipe_zvbienc->sp,
-                0, 0, 0, 0x000000FF, false, upipe_zvbienc->sliced, 2)) {
+    /* the lines only depend on the caption data, which mostly carries
+     * padding: encode them again only when it changes */
+    if (!upipe_zvbienc->raw_valid ||
+        memcmp(upipe_zvbienc->raw_data[0], upipe_zvbienc->sliced[0].data, 2) ||
+        memcmp(upipe_zvbienc->raw_data[1], upipe_zvbienc->sliced[1].data, 2)) {
+        upipe_zvbienc->raw_valid = false;
+        memset(upipe_zvbienc->raw, 0, UPIPE_ZVBIENC_RAW_SIZE);
+        if (vbi_raw_video_image(upipe_zvbienc->raw, UPIPE_ZVBIENC_RAW_SIZE,
+                &upipe_zvbienc->sp, 0, 0, 0, 0x000000FF, false,
+                upipe_zvbienc->sliced, 2)) {
+            memcpy(upipe_zvbienc->raw_data[0], upipe_zvbienc->sliced[0].data, 2);
+            memcpy(upipe_zvbienc->raw_data[1], upipe_zvbienc->sliced[1].data, 2);
+            upipe_zvbienc->raw_valid = true;
+        } else {
             upipe_err(upipe, "Couldn't store VBI");
         }
+    }
 
+    uint8_t *buf;
+    if (upipe_zvbienc->raw_valid &&
+        ubase_check(uref_pic_plane_write(uref, "y8", 0, 1, -1, 2, &buf))) {
+        memcpy(buf, upipe_zvbienc->raw, UPIPE_ZVBIENC_RAW_SIZE);
         uref_pic_plane_unmap(uref, "y8", 0, 1, -1, 2);
     }
 
@@ -215,6 +240,7 @@ static struct upipe *upipe_zvbienc_alloc(struct upipe_mgr *mgr,
     upipe_zvbienc->sliced[0].line = upipe_zvbienc->sp.start[0];
     upipe_zvbienc->sliced[1].id = VBI_SLICED_CAPTION_525_F2;
     upipe_zvbienc->sliced[1].line = upipe_zvbienc->sp.start[1];
+    upipe_zvbienc->raw_valid = false;
 
     upipe_zvbienc_init_urefcount(upipe);
     upipe_zvbienc_init_output(upipe);
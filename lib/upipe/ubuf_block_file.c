@@ -0,0 +1,485 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short Upipe ubuf manager for block formats backed by a file range
+ */
+
+#include <upipe/ubase.h>
+#include <upipe/uatomic.h>
+#include <upipe/urefcount.h>
+#include <upipe/upool.h>
+#include <upipe/ubuf.h>
+#include <upipe/ubuf_block.h>
+#include <upipe/ubuf_block_common.h>
+#include <upipe/ubuf_block_file.h>
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdarg.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <assert.h>
+
+#ifndef F_DUPFD_CLOEXEC
+#   define F_DUPFD_CLOEXEC F_DUPFD
+#endif
+
+/** @internal @This is a range of the file, shared by one or several ubufs. */
+struct ubuf_block_file_shared {
+    /** number of ubufs pointing to the range */
+    uatomic_uint32_t refcount;
+    /** offset of the range in the file */
+    uint64_t offset;
+    /** size of the range */
+    size_t size;
+    /** copy of the range in memory, read on the first mapping, or NULL */
+    uatomic_ptr_t buffer;
+    /** true if the copy in memory may have been written */
+    bool dirty;
+};
+
+/** @This is a super-set of the @ref ubuf (and @ref ubuf_block)
+ * structure with private fields pointing to shared data. */
+struct ubuf_block_file {
+    /** pointer to shared structure */
+    struct ubuf_block_file_shared *shared;
+
+    /** block structure */
+    struct ubuf_block ubuf_block;
+};
+
+UBASE_FROM_TO(ubuf_block_file, ubuf, ubuf, ubuf_block.ubuf)
+
+/** @This is a super-set of the ubuf_mgr structure with additional local
+ * members. */
+struct ubuf_block_file_mgr {
+    /** refcount management structure */
+    struct urefcount urefcount;
+
+    /** file descriptor */
+    int fd;
+
+    /** ubuf pool */
+    struct upool ubuf_pool;
+    /** ubuf shared pool */
+    struct upool shared_pool;
+
+    /** common management structure */
+    struct ubuf_mgr mgr;
+
+    /** extra space for upool */
+    uint8_t upool_extra[];
+};
+
+UBASE_FROM_TO(ubuf_block_file_mgr, ubuf_mgr, ubuf_mgr, mgr)
+UBASE_FROM_TO(ubuf_block_file_mgr, urefcount, urefcount, urefcount)
+UBASE_FROM_TO(ubuf_block_file_mgr, upool, ubuf_pool, ubuf_pool)
+UBASE_FROM_TO(ubuf_block_file_mgr, upool, shared_pool, shared_pool)
+
+/** @internal @This releases a shared structure, once it isn't used by any
+ * ubuf anymore.
+ *
+ * @param file_mgr pointer to the file manager
+ * @param shared pointer to the shared structure
+ */
+static void ubuf_block_file_shared_release(struct ubuf_block_file_mgr *file_mgr,
+        struct ubuf_block_file_shared *shared)
+{
+    if (uatomic_fetch_sub(&shared->refcount, 1) == 1) {
+        free(uatomic_ptr_load(&shared->buffer));
+        uatomic_ptr_store(&shared->buffer, NULL);
+        upool_free(&file_mgr->shared_pool, shared);
+    }
+}
+
+/** @internal @This allocates a ubuf structure from the pool.
+ *
+ * @param file_mgr pointer to the file manager
+ * @param shared pointer to the shared structure, whose reference is taken
+ * over
+ * @return pointer to ubuf or NULL in case of allocation error
+ */
+static struct ubuf *ubuf_block_file_alloc_ubuf(
+        struct ubuf_block_file_mgr *file_mgr,
+        struct ubuf_block_file_shared *shared)
+{
+    struct ubuf_block_file *block_file =
+        upool_alloc(&file_mgr->ubuf_pool, struct ubuf_block_file *);
+    if (unlikely(block_file == NULL))
+        return NULL;
+    block_file->shared = shared;
+    struct ubuf *ubuf = ubuf_block_file_to_ubuf(block_file);
+    ubuf_block_common_init(ubuf, true);
+    return ubuf;
+}
+
+/** @This allocates a ubuf pointing to a range of the file.
+ *
+ * @param mgr common management structure
+ * @param signature type of allocation
+ * @param args optional arguments
+ * @return pointer to ubuf or NULL in case of allocation error
+ */
+static struct ubuf *_ubuf_block_file_alloc(struct ubuf_mgr *mgr,
+                                           uint32_t signature, va_list args)
+{
+    if (unlikely(signature != UBUF_BLOCK_FILE_ALLOC_RANGE))
+        return NULL;
+    uint64_t offset = va_arg(args, uint64_t);
+    int size = va_arg(args, int);
+    if (unlikely(size < 0))
+        return NULL;
+
+    struct ubuf_block_file_mgr *file_mgr =
+        ubuf_block_file_mgr_from_ubuf_mgr(mgr);
+    struct ubuf_block_file_shared *shared =
+        upool_alloc(&file_mgr->shared_pool, struct ubuf_block_file_shared *);
+    if (unlikely(shared == NULL))
+        return NULL;
+    uatomic_store(&shared->refcount, 1);
+    shared->offset = offset;
+    shared->size = size;
+    shared->dirty = false;
+
+    struct ubuf *ubuf = ubuf_block_file_alloc_ubuf(file_mgr, shared);
+    if (unlikely(ubuf == NULL)) {
+        ubuf_block_file_shared_release(file_mgr, shared);
+        return NULL;
+    }
+    ubuf_block_common_set(ubuf, 0, size);
+    return ubuf;
+}
+
+/** @This creates a new reference to the same range, with another offset
+ * and size.
+ *
+ * @param ubuf pointer to ubuf
+ * @param new_ubuf_p reference written with a pointer to the newly allocated
+ * ubuf
+ * @param offset offset in the buffer, or -1 to duplicate the ubuf
+ * @param size final size of the buffer
+ * @return an error code
+ */
+static int ubuf_block_file_splice(struct ubuf *ubuf, struct ubuf **new_ubuf_p,
+                                  int offset, int size)
+{
+    assert(new_ubuf_p != NULL);
+    struct ubuf_block_file_mgr *file_mgr =
+        ubuf_block_file_mgr_from_ubuf_mgr(ubuf->mgr);
+    struct ubuf_block_file *block_file = ubuf_block_file_from_ubuf(ubuf);
+    uatomic_fetch_add(&block_file->shared->refcount, 1);
+    struct ubuf *new_ubuf = ubuf_block_file_alloc_ubuf(file_mgr,
+                                                       block_file->shared);
+    if (unlikely(new_ubuf == NULL)) {
+        ubuf_block_file_shared_release(file_mgr, block_file->shared);
+        return UBASE_ERR_ALLOC;
+    }
+
+    int err = offset < 0 ? ubuf_block_common_dup(ubuf, new_ubuf) :
+              ubuf_block_common_splice(ubuf, new_ubuf, offset, size);
+    if (unlikely(!ubase_check(err))) {
+        ubuf_free(new_ubuf);
+        return UBASE_ERR_INVALID;
+    }
+    *new_ubuf_p = new_ubuf;
+    return UBASE_ERR_NONE;
+}
+
+/** @This reads the range in memory if it was not already done, and returns
+ * the copy.
+ *
+ * @param ubuf pointer to ubuf
+ * @param buffer_p reference written with a pointer to the copy of the range
+ * @return an error code
+ */
+static int ubuf_block_file_map(struct ubuf *ubuf, uint8_t **buffer_p)
+{
+    struct ubuf_block_file_mgr *file_mgr =
+        ubuf_block_file_mgr_from_ubuf_mgr(ubuf->mgr);
+    struct ubuf_block_file_shared *shared =
+        ubuf_block_file_from_ubuf(ubuf)->shared;
+    uint8_t *buffer = uatomic_ptr_load(&shared->buffer);
+    if (likely(buffer != NULL)) {
+        *buffer_p = buffer;
+        return UBASE_ERR_NONE;
+    }
+
+    buffer = malloc(shared->size ? shared->size : 1);
+    if (unlikely(buffer == NULL))
+        return UBASE_ERR_ALLOC;
+    size_t size = 0;
+    while (size < shared->size) {
+        ssize_t ret = pread(file_mgr->fd, buffer + size, shared->size - size,
+                            shared->offset + size);
+        if (unlikely(ret == -1 && errno == EINTR))
+            continue;
+        if (unlikely(ret <= 0)) {
+            free(buffer);
+            return UBASE_ERR_EXTERNAL;
+        }
+        size += ret;
+    }
+
+    /* another thread may have mapped a reference to the same range */
+    void *expected = NULL;
+    if (unlikely(!uatomic_ptr_compare_exchange(&shared->buffer, &expected,
+                                               buffer))) {
+        free(buffer);
+        buffer = expected;
+    }
+    *buffer_p = buffer;
+    return UBASE_ERR_NONE;
+}
+
+/** @This returns the file range of a segment.
+ *
+ * @param ubuf pointer to ubuf
+ * @param fd_p filled in with the file descriptor
+ * @param offset_p filled in with the offset of the range in the file
+ * @return an error code
+ */
+static int ubuf_block_file_get_range_inner(struct ubuf *ubuf, int *fd_p,
+                                           uint64_t *offset_p)
+{
+    struct ubuf_block_file_mgr *file_mgr =
+        ubuf_block_file_mgr_from_ubuf_mgr(ubuf->mgr);
+    struct ubuf_block_file_shared *shared =
+        ubuf_block_file_from_ubuf(ubuf)->shared;
+    if (unlikely(shared->dirty))
+        return UBASE_ERR_BUSY;
+    *fd_p = file_mgr->fd;
+    *offset_p = shared->offset;
+    return UBASE_ERR_NONE;
+}
+
+/** @This handles control commands.
+ *
+ * @param ubuf pointer to ubuf
+ * @param command type of command to process
+ * @param args arguments of the command
+ * @return an error code
+ */
+static int ubuf_block_file_control(struct ubuf *ubuf, int command,
+                                   va_list args)
+{
+    switch (command) {
+        case UBUF_DUP: {
+            struct ubuf **new_ubuf_p = va_arg(args, struct ubuf **);
+            return ubuf_block_file_splice(ubuf, new_ubuf_p, -1, 0);
+        }
+        case UBUF_SINGLE: {
+            /* writes only happen after this check, so the copy in memory can
+             * no longer be trusted to match the file */
+            struct ubuf_block_file_shared *shared =
+                ubuf_block_file_from_ubuf(ubuf)->shared;
+            if (uatomic_load(&shared->refcount) != 1)
+                return UBASE_ERR_BUSY;
+            shared->dirty = true;
+            return UBASE_ERR_NONE;
+        }
+        case UBUF_MAP_BLOCK: {
+            uint8_t **buffer_p = va_arg(args, uint8_t **);
+            return ubuf_block_file_map(ubuf, buffer_p);
+        }
+        case UBUF_UNMAP_BLOCK:
+            /* the copy is kept until the range is released */
+            return UBASE_ERR_NONE;
+        case UBUF_SPLICE_BLOCK: {
+            struct ubuf **new_ubuf_p = va_arg(args, struct ubuf **);
+            int offset = va_arg(args, int);
+            int size = va_arg(args, int);
+            return ubuf_block_file_splice(ubuf, new_ubuf_p, offset, size);
+        }
+        case UBUF_BLOCK_FILE_GET_RANGE: {
+            UBASE_SIGNATURE_CHECK(args, UBUF_BLOCK_FILE_SIGNATURE)
+            int *fd_p = va_arg(args, int *);
+            uint64_t *offset_p = va_arg(args, uint64_t *);
+            return ubuf_block_file_get_range_inner(ubuf, fd_p, offset_p);
+        }
+        default:
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** @This recycles or frees a ubuf.
+ *
+ * @param ubuf pointer to a ubuf structure
+ */
+static void ubuf_block_file_free(struct ubuf *ubuf)
+{
+    struct ubuf_block_file_mgr *file_mgr =
+        ubuf_block_file_mgr_from_ubuf_mgr(ubuf->mgr);
+    struct ubuf_block_file *block_file = ubuf_block_file_from_ubuf(ubuf);
+    ubuf_block_common_clean(ubuf);
+    ubuf_block_file_shared_release(file_mgr, block_file->shared);
+    upool_free(&file_mgr->ubuf_pool, block_file);
+}
+
+/** @internal @This allocates the data structure.
+ *
+ * @param upool pointer to upool
+ * @return pointer to ubuf_block_file or NULL in case of allocation error
+ */
+static void *ubuf_block_file_alloc_inner(struct upool *upool)
+{
+    struct ubuf_block_file_mgr *file_mgr =
+        ubuf_block_file_mgr_from_ubuf_pool(upool);
+    struct ubuf_block_file *block_file =
+        malloc(sizeof(struct ubuf_block_file));
+    if (unlikely(block_file == NULL))
+        return NULL;
+    ubuf_block_file_to_ubuf(block_file)->mgr =
+        ubuf_block_file_mgr_to_ubuf_mgr(file_mgr);
+    return block_file;
+}
+
+/** @internal @This frees a ubuf_block_file.
+ *
+ * @param upool pointer to upool
+ * @param block_file pointer to a ubuf_block_file structure to free
+ */
+static void ubuf_block_file_free_inner(struct upool *upool, void *block_file)
+{
+    free(block_file);
+}
+
+/** @internal @This allocates a shared structure.
+ *
+ * @param upool pointer to upool
+ * @return pointer to ubuf_block_file_shared or NULL in case of allocation
+ * error
+ */
+static void *ubuf_block_file_shared_alloc_inner(struct upool *upool)
+{
+    struct ubuf_block_file_shared *shared =
+        malloc(sizeof(struct ubuf_block_file_shared));
+    if (unlikely(shared == NULL))
+        return NULL;
+    uatomic_init(&shared->refcount, 0);
+    uatomic_ptr_init(&shared->buffer, NULL);
+    return shared;
+}
+
+/** @internal @This frees a shared structure.
+ *
+ * @param upool pointer to upool
+ * @param _shared pointer to a ubuf_block_file_shared structure to free
+ */
+static void ubuf_block_file_shared_free_inner(struct upool *upool,
+                                              void *_shared)
+{
+    struct ubuf_block_file_shared *shared =
+        (struct ubuf_block_file_shared *)_shared;
+    uatomic_clean(&shared->refcount);
+    uatomic_ptr_clean(&shared->buffer);
+    free(shared);
+}
+
+/** @This handles manager control commands.
+ *
+ * @param mgr pointer to ubuf manager
+ * @param command type of command to process
+ * @param args arguments of the command
+ * @return an error code
+ */
+static int ubuf_block_file_mgr_control(struct ubuf_mgr *mgr,
+                                       int command, va_list args)
+{
+    struct ubuf_block_file_mgr *file_mgr =
+        ubuf_block_file_mgr_from_ubuf_mgr(mgr);
+    switch (command) {
+        case UBUF_MGR_VACUUM:
+            upool_vacuum(&file_mgr->ubuf_pool);
+            upool_vacuum(&file_mgr->shared_pool);
+            return UBASE_ERR_NONE;
+        default:
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** @This frees a ubuf manager.
+ *
+ * @param urefcount pointer to urefcount
+ */
+static void ubuf_block_file_mgr_free(struct urefcount *urefcount)
+{
+    struct ubuf_block_file_mgr *file_mgr =
+        ubuf_block_file_mgr_from_urefcount(urefcount);
+    upool_clean(&file_mgr->ubuf_pool);
+    upool_clean(&file_mgr->shared_pool);
+    close(file_mgr->fd);
+
+    urefcount_clean(urefcount);
+    free(file_mgr);
+}
+
+/** @This allocates a new instance of the ubuf manager for block formats
+ * backed by a range of a file.
+ *
+ * @param ubuf_pool_depth maximum number of ubuf structures in the pool
+ * @param shared_pool_depth maximum number of shared structures in the pool
+ * @param fd file descriptor of the file (it is duplicated, so the caller
+ * may close it afterwards)
+ * @return pointer to manager, or NULL in case of error
+ */
+struct ubuf_mgr *ubuf_block_file_mgr_alloc(uint16_t ubuf_pool_depth,
+                                           uint16_t shared_pool_depth,
+                                           int fd)
+{
+    struct ubuf_block_file_mgr *file_mgr =
+        malloc(sizeof(struct ubuf_block_file_mgr) +
+               upool_sizeof(ubuf_pool_depth) +
+               upool_sizeof(shared_pool_depth));
+    if (unlikely(file_mgr == NULL))
+        return NULL;
+
+    file_mgr->fd = fcntl(fd, F_DUPFD_CLOEXEC, 0);
+    if (unlikely(file_mgr->fd == -1)) {
+        free(file_mgr);
+        return NULL;
+    }
+
+    urefcount_init(ubuf_block_file_mgr_to_urefcount(file_mgr),
+                   ubuf_block_file_mgr_free);
+    file_mgr->mgr.refcount = ubuf_block_file_mgr_to_urefcount(file_mgr);
+    file_mgr->mgr.signature = UBUF_ALLOC_BLOCK;
+    file_mgr->mgr.ubuf_alloc = _ubuf_block_file_alloc;
+    file_mgr->mgr.ubuf_control = ubuf_block_file_control;
+    file_mgr->mgr.ubuf_free = ubuf_block_file_free;
+    file_mgr->mgr.ubuf_mgr_control = ubuf_block_file_mgr_control;
+
+    upool_init(&file_mgr->ubuf_pool, file_mgr->mgr.refcount, ubuf_pool_depth,
+               file_mgr->upool_extra, ubuf_block_file_alloc_inner,
+               ubuf_block_file_free_inner);
+    upool_init(&file_mgr->shared_pool, file_mgr->mgr.refcount,
+               shared_pool_depth,
+               file_mgr->upool_extra + upool_sizeof(ubuf_pool_depth),
+               ubuf_block_file_shared_alloc_inner,
+               ubuf_block_file_shared_free_inner);
+
+    return ubuf_block_file_mgr_to_ubuf_mgr(file_mgr);
+}
@@ -264,6 +264,32 @@ static int ubuf_block_mem_splice(struct ubuf *ubuf, struct ubuf **new_ubuf_p,
     return UBASE_ERR_NONE;
 }
 
+/** @This returns the underlying shared buffer. The reference counter is not
+ * incremented.
+ *
+ * @param ubuf pointer to ubuf
+ * @param shared_p filled in with a pointer to the underlying shared buffer
+ * @param offset_p filled in with the offset of the data in the shared buffer
+ * @param size_p filled in with the size of the data
+ * @return an error code
+ */
+static int _ubuf_block_mem_get_shared(struct ubuf *ubuf,
+        struct ubuf_mem_shared **shared_p, size_t *offset_p, size_t *size_p)
+{
+    struct ubuf_block *block = ubuf_block_from_ubuf(ubuf);
+    if (unlikely(block->next_ubuf != NULL))
+        return UBASE_ERR_INVALID;
+
+    struct ubuf_block_mem *block_mem = ubuf_block_mem_from_ubuf(ubuf);
+    if (shared_p != NULL)
+        *shared_p = block_mem->shared;
+    if (offset_p != NULL)
+        *offset_p = block->offset;
+    if (size_p != NULL)
+        *size_p = block->size;
+    return UBASE_ERR_NONE;
+}
+
 /** @This handles control commands.
  *
  * @param ubuf pointer to ubuf
@@ -287,6 +313,16 @@ static int ubuf_block_mem_control(struct ubuf *ubuf, int command, va_list args)
             int size = va_arg(args, int);
             return ubuf_block_mem_splice(ubuf, new_ubuf_p, offset, size);
         }
+
+        case UBUF_BLOCK_MEM_GET_SHARED: {
+            UBASE_SIGNATURE_CHECK(args, UBUF_BLOCK_MEM_SIGNATURE)
+            struct ubuf_mem_shared **shared_p =
+                va_arg(args, struct ubuf_mem_shared **);
+            size_t *offset_p = va_arg(args, size_t *);
+            size_t *size_p = va_arg(args, size_t *);
+            return _ubuf_block_mem_get_shared(ubuf, shared_p, offset_p,
+                                              size_p);
+        }
         default:
             return UBASE_ERR_UNHANDLED;
     }
@@ -355,14 +391,21 @@ static int ubuf_block_mem_mgr_check(struct ubuf_mgr *mgr,
 
     uint64_t align = 0;
     int64_t align_offset = 0;
+    uint64_t prepend = 0;
+    uint64_t append = 0;
     uref_block_flow_get_align(flow_format, &align);
     uref_block_flow_get_align_offset(flow_format, &align_offset);
+    uref_block_flow_get_prepend(flow_format, &prepend);
+    uref_block_flow_get_append(flow_format, &append);
 
     struct ubuf_block_mem_mgr *block_mem_mgr =
         ubuf_block_mem_mgr_from_ubuf_mgr(mgr);
     if (align && (block_mem_mgr->align % align ||
                   block_mem_mgr->align_offset != align_offset))
         return UBASE_ERR_INVALID;
+    /* headroom and tailroom must be at least the requested ones */
+    if (block_mem_mgr->prepend < prepend || block_mem_mgr->append < append)
+        return UBASE_ERR_INVALID;
     return UBASE_ERR_NONE;
 }
 
@@ -385,6 +428,24 @@ static int ubuf_block_mem_mgr_control(struct ubuf_mgr *mgr,
             ubuf_block_mem_mgr_vacuum_pool(mgr);
             return UBASE_ERR_NONE;
         }
+        case UBUF_MGR_PREFILL: {
+            unsigned int count = va_arg(args, unsigned int);
+            ubuf_block_mem_mgr_prefill_pool(mgr, count);
+            return UBASE_ERR_NONE;
+        }
+        case UBUF_MGR_SET_STATS: {
+            bool enabled = va_arg(args, int);
+            ubuf_block_mem_mgr_set_stats_pool(mgr, enabled);
+            return UBASE_ERR_NONE;
+        }
+        case UBUF_MGR_GET_STATS: {
+            struct upool_stats *ubuf_stats =
+                va_arg(args, struct upool_stats *);
+            struct upool_stats *shared_stats =
+                va_arg(args, struct upool_stats *);
+            ubuf_block_mem_mgr_get_stats_pool(mgr, ubuf_stats, shared_stats);
+            return UBASE_ERR_NONE;
+        }
         default:
             return UBASE_ERR_UNHANDLED;
     }
@@ -31,8 +31,180 @@
 #include <upipe/ubuf_pic.h>
 
 #include <stdint.h>
+#include <stdbool.h>
 #include <string.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define UBUF_PIC_SSE2
+#elif defined(__aarch64__) && !defined(__AARCH64EB__)
+#include <arm_neon.h>
+#define UBUF_PIC_NEON
+#endif
+
+/** size of a clear pattern, in octets */
+#define UBUF_PIC_PATTERN_SIZE 16
+/** number of octets above which a whole plane is cleared with non-temporal
+ * stores, so that the cache is not evicted by the blank picture */
+#define UBUF_PIC_CLEAR_NT_SIZE (512 * 1024)
+
+/** @internal @This fills a buffer with a repeated pattern.
+ *
+ * @param buf pointer to the buffer
+ * @param pattern pattern, repeated twice
+ * @param size number of octets to write
+ * @param nt true to use non-temporal stores
+ */
+static void ubuf_pic_fill(uint8_t *buf,
+                          const uint8_t pattern[2 * UBUF_PIC_PATTERN_SIZE],
+                          size_t size, bool nt)
+{
+    size_t i = 0;
+
+#if defined(UBUF_PIC_SSE2)
+    if (nt) {
+        size_t head = (-(uintptr_t)buf) & (UBUF_PIC_PATTERN_SIZE - 1);
+        for ( ; i < head && i < size; i++)
+            buf[i] = pattern[i];
+    }
+
+    __m128i v = _mm_loadu_si128((const __m128i *)
+                                (pattern + (i % UBUF_PIC_PATTERN_SIZE)));
+    if (nt) {
+        for ( ; i + 64 <= size; i += 64) {
+            _mm_stream_si128((__m128i *)(buf + i), v);
+            _mm_stream_si128((__m128i *)(buf + i + 16), v);
+            _mm_stream_si128((__m128i *)(buf + i + 32), v);
+            _mm_stream_si128((__m128i *)(buf + i + 48), v);
+        }
+        for ( ; i + 16 <= size; i += 16)
+            _mm_stream_si128((__m128i *)(buf + i), v);
+        _mm_sfence();
+    } else {
+        for ( ; i + 64 <= size; i += 64) {
+            _mm_storeu_si128((__m128i *)(buf + i), v);
+            _mm_storeu_si128((__m128i *)(buf + i + 16), v);
+            _mm_storeu_si128((__m128i *)(buf + i + 32), v);
+            _mm_storeu_si128((__m128i *)(buf + i + 48), v);
+        }
+        for ( ; i + 16 <= size; i += 16)
+            _mm_storeu_si128((__m128i *)(buf + i), v);
+    }
+
+#elif defined(UBUF_PIC_NEON)
+    uint8x16_t v = vld1q_u8(pattern);
+    for ( ; i + 64 <= size; i += 64) {
+        vst1q_u8(buf + i, v);
+        vst1q_u8(buf + i + 16, v);
+        vst1q_u8(buf + i + 32, v);
+        vst1q_u8(buf + i + 48, v);
+    }
+    for ( ; i + 16 <= size; i += 16)
+        vst1q_u8(buf + i, v);
+
+#else
+    if (!memcmp(pattern, pattern + 1, UBUF_PIC_PATTERN_SIZE)) {
+        memset(buf, pattern[0], size);
+        return;
+    }
+#endif
+
+    for ( ; i < size; i++)
+        buf[i] = pattern[i % UBUF_PIC_PATTERN_SIZE];
+}
+
+/** @internal @This builds the pattern used to clear a plane.
+ *
+ * @param chroma chroma type (see chroma reference)
+ * @param fullrange whether the input is full-range
+ * @param pattern filled in with the pattern, repeated twice
+ * @param period_p filled in with the period of the pattern, in octets
+ * @return false if the chroma type is unknown
+ */
+static bool ubuf_pic_clear_pattern(const char *chroma, int fullrange,
+                                   uint8_t pattern[2 * UBUF_PIC_PATTERN_SIZE],
+                                   unsigned int *period_p)
+{
+    uint8_t y8 = fullrange ? 0 : 16;
+    uint16_t y10 = fullrange ? 0 : 64;
+    uint16_t y16 = fullrange ? 0 : 16 << 8;
+    uint8_t elem[UBUF_PIC_PATTERN_SIZE];
+    unsigned int period;
+
+#define MATCH(a) (strcmp(chroma, a) == 0)
+#define WORD_LE(p, w) do { (p)[0] = (w) & 0xff; (p)[1] = (w) >> 8; } while (0)
+#define WORD_BE(p, w) do { (p)[0] = (w) >> 8; (p)[1] = (w) & 0xff; } while (0)
+
+    if (MATCH("y8") || MATCH("a8")
+     || MATCH("r8g8b8") || MATCH("r8g8b8a8") || MATCH("a8r8g8b8")
+     || MATCH("b8g8r8") || MATCH("b8g8r8a8") || MATCH("a8b8g8r8")) {
+        elem[0] = y8;
+        period = 1;
+    } else if (MATCH("u8") || MATCH("v8")) {
+        elem[0] = 0x80;
+        period = 1;
+    } else if (MATCH("y10l")) {
+        WORD_LE(elem, y10);
+        period = 2;
+    } else if (MATCH("y10b")) {
+        WORD_BE(elem, y10);
+        period = 2;
+    } else if (MATCH("u10l") || MATCH("v10l")) {
+        WORD_LE(elem, 0x200);
+        period = 2;
+    } else if (MATCH("u10b") || MATCH("v10b")) {
+        WORD_BE(elem, 0x200);
+        period = 2;
+    } else if (MATCH("y16l")) {
+        WORD_LE(elem, y16);
+        period = 2;
+    } else if (MATCH("y16b")) {
+        WORD_BE(elem, y16);
+        period = 2;
+    } else if (MATCH("u16l") || MATCH("v16l")) {
+        WORD_LE(elem, 0x8000);
+        period = 2;
+    } else if (MATCH("u16b") || MATCH("v16b")) {
+        WORD_BE(elem, 0x8000);
+        period = 2;
+    } else if (MATCH("u8y8v8y8")) {
+        elem[0] = 0x80;
+        elem[1] = y8;
+        elem[2] = 0x80;
+        elem[3] = y8;
+        period = 4;
+    } else if (MATCH("y8u8y8v8") || MATCH("y8v8y8u8")) {
+        elem[0] = y8;
+        elem[1] = 0x80;
+        elem[2] = y8;
+        elem[3] = 0x80;
+        period = 4;
+    } else if (MATCH("u10y10v10y10u10y10v10y10u10y10v10y10")) {
+        /* v210: Cb Y Cr, Y Cb Y, Cr Y Cb, Y Cr Y */
+        uint32_t c = 0x200 | (y10 << 10) | (0x200 << 20);
+        uint32_t y = y10 | (0x200 << 10) | (y10 << 20);
+        for (int i = 0; i < 4; i++) {
+            uint32_t w = (i & 1) ? y : c;
+            elem[4 * i] = w;
+            elem[4 * i + 1] = w >> 8;
+            elem[4 * i + 2] = w >> 16;
+            elem[4 * i + 3] = w >> 24;
+        }
+        period = 16;
+    } else {
+        return false;
+    }
+
+#undef WORD_BE
+#undef WORD_LE
+#undef MATCH
+
+    for (unsigned int i = 0; i < 2 * UBUF_PIC_PATTERN_SIZE; i++)
+        pattern[i] = elem[i % period];
+    *period_p = period;
+    return true;
+}
+
 /** @This clears (part of) the specified plane, depending on plane type
  * and size (set U/V chroma to 0x80 instead of 0 for instance)
  *
@@ -57,9 +229,10 @@ int ubuf_pic_plane_clear(struct ubuf *ubuf, const char *chroma,
 {
     size_t stride, width, height;
     uint8_t hsub, vsub, macropixel_size, macropixel;
+    uint8_t pattern[2 * UBUF_PIC_PATTERN_SIZE];
+    unsigned int period;
     uint8_t *buf = NULL;
-    bool known = true;
-    int j;
+    size_t j;
 
     if (!ubuf)
         return UBASE_ERR_INVALID;
@@ -67,9 +240,12 @@ int ubuf_pic_plane_clear(struct ubuf *ubuf, const char *chroma,
     UBASE_RETURN(ubuf_pic_size(ubuf, &width, &height, &macropixel))
     UBASE_RETURN(ubuf_pic_plane_size(ubuf, chroma,
                     &stride, &hsub, &vsub, &macropixel_size))
+    if (!ubuf_pic_clear_pattern(chroma, fullrange, pattern, &period))
+        return UBASE_ERR_INVALID;
     UBASE_RETURN(ubuf_pic_plane_write(ubuf, chroma, hoffset, voffset,
                                       hsize, vsize, &buf))
 
+    bool whole_lines = hoffset == 0 && hsize == -1;
     if (hsize == -1) {
         width -= hoffset;
     } else {
@@ -82,31 +258,21 @@ int ubuf_pic_plane_clear(struct ubuf *ubuf, const char *chroma,
     }
 
     const size_t memset_width = width*macropixel_size/hsub/macropixel;
+    const size_t lines = height / vsub;
 
-#define MATCH(a) (strcmp(chroma, a) == 0)
-#define LINELOOP(a) for (a=0; a < height/vsub; a++)
-
-    if (MATCH("y8") || MATCH("y16l") || MATCH("y16b") || MATCH("a8")
-     || MATCH("r8g8b8") || MATCH("r8g8b8a8") || MATCH("a8r8g8b8")
-     || MATCH("b8g8r8") || MATCH("b8g8r8a8") || MATCH("a8b8g8r8")) {
-        LINELOOP(j) {
-            memset(buf, fullrange ? 0 : 16, memset_width);
-            buf += stride;
-        }
-    } else if (MATCH("u8") || MATCH("v8")) {
-        LINELOOP(j) {
-            memset(buf, 0x80, memset_width);
+    if (whole_lines && lines && stride % period == 0) {
+        /* the padding between lines may be overwritten, so the lines are
+         * cleared in one go */
+        size_t size = (lines - 1) * stride + memset_width;
+        ubuf_pic_fill(buf, pattern, size, size >= UBUF_PIC_CLEAR_NT_SIZE);
+    } else {
+        for (j = 0; j < lines; j++) {
+            ubuf_pic_fill(buf, pattern, memset_width, false);
             buf += stride;
         }
-    } else {
-        known = false;
     }
 
-#undef LINELOOP
-#undef MATCH
-    UBASE_RETURN(ubuf_pic_plane_unmap(ubuf, chroma, hoffset, voffset,
-                                      hsize, vsize))
-    return known ? UBASE_ERR_INVALID : UBASE_ERR_NONE;
+    return ubuf_pic_plane_unmap(ubuf, chroma, hoffset, voffset, hsize, vsize);
 }
 
 /** @This clears (part of) the specified picture, depending on plane type
@@ -132,13 +298,16 @@ int ubuf_pic_clear(struct ubuf *ubuf, int hoffset, int voffset,
     if (!ubuf)
         return UBASE_ERR_INVALID;
 
-    bool ret = false;
+    int err = UBASE_ERR_NONE;
     const char *chroma = NULL;
     while (ubase_check(ubuf_pic_plane_iterate(ubuf, &chroma)) &&
            chroma != NULL) {
-        ret = ubase_check(ubuf_pic_plane_clear(ubuf, chroma,
-            hoffset, voffset, hsize, vsize, fullrange)) || ret;
+        int ret = ubuf_pic_plane_clear(ubuf, chroma,
+                                       hoffset, voffset, hsize, vsize,
+                                       fullrange);
+        if (!ubase_check(ret))
+            err = ret;
     }
 
-    return ret ? UBASE_ERR_INVALID : UBASE_ERR_NONE;
+    return err;
 }
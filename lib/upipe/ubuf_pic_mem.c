@@ -55,8 +55,8 @@
 #define UBUF_DEFAULT_VPREPEND       2
 /** default extra lines after buffer when unspecified */
 #define UBUF_DEFAULT_VAPPEND        2
-/** default alignment in octets */
-#define UBUF_DEFAULT_ALIGN          0
+/** default alignment in octets, suitable for 512-bit vector loads */
+#define UBUF_DEFAULT_ALIGN          64
 
 /** @This is a super-set of the @ref ubuf (and @ref ubuf_pic_common)
  * structure with private fields pointing to shared data. */
@@ -98,6 +98,12 @@ struct ubuf_pic_mem_mgr {
     struct upool ubuf_pool;
     /** ubuf shared pool */
     struct upool shared_pool;
+    /** pool of shared structures keeping their frame buffers */
+    struct upool frame_pool;
+    /** size of the buffers in the frame pool, or 0 if there is no pool */
+    size_t frame_size;
+    /** extra space for the frame pool */
+    void *frame_pool_extra;
     /** umem allocator */
     struct umem_mgr *umem_mgr;
 
@@ -111,9 +117,47 @@ struct ubuf_pic_mem_mgr {
 UBASE_FROM_TO(ubuf_pic_mem_mgr, ubuf_mgr, ubuf_mgr, common_mgr.mgr)
 UBASE_FROM_TO(ubuf_pic_mem_mgr, urefcount, urefcount, urefcount)
 UBASE_FROM_TO(ubuf_pic_mem_mgr, upool, ubuf_pool, ubuf_pool)
+UBASE_FROM_TO(ubuf_pic_mem_mgr, upool, frame_pool, frame_pool)
 
 UBUF_MEM_MGR_HELPER_POOL(ubuf_pic_mem, ubuf_pool, shared_pool, shared)
 
+/** @internal @This computes the layout of the planes of a picture.
+ *
+ * @param pic_mgr pointer to private manager structure
+ * @param hsize horizontal size in pixels
+ * @param vsize vertical size in lines
+ * @param strides filled in with the stride of each plane
+ * @param plane_sizes filled in with the size of each plane
+ * @return size of the buffer to allocate
+ */
+static size_t ubuf_pic_mem_layout(struct ubuf_pic_mem_mgr *pic_mgr,
+                                  int hsize, int vsize,
+                                  size_t *strides, size_t *plane_sizes)
+{
+    size_t hmsize = hsize / pic_mgr->common_mgr.macropixel;
+    size_t buffer_size = 0;
+    for (uint8_t plane = 0; plane < pic_mgr->common_mgr.nb_planes; plane++) {
+        size_t align = 0;
+        if (pic_mgr->align &&
+                ((hmsize + pic_mgr->hmprepend + pic_mgr->hmappend) /
+                    pic_mgr->common_mgr.planes[plane]->hsub *
+                    pic_mgr->common_mgr.planes[plane]->macropixel_size) %
+                        pic_mgr->align)
+            align = pic_mgr->align;
+        strides[plane] = (hmsize + pic_mgr->hmprepend + pic_mgr->hmappend) /
+                            pic_mgr->common_mgr.planes[plane]->hsub *
+                            pic_mgr->common_mgr.planes[plane]->macropixel_size +
+                         align;
+        if (align)
+            strides[plane] -= strides[plane] % align;
+        plane_sizes[plane] = (vsize + pic_mgr->vprepend + pic_mgr->vappend) /
+                                 pic_mgr->common_mgr.planes[plane]->vsub *
+                                 strides[plane] + pic_mgr->align;
+        buffer_size += plane_sizes[plane];
+    }
+    return buffer_size;
+}
+
 /** @This allocates a ubuf, a shared structure and a umem buffer.
  *
  * @param mgr common management structure
@@ -140,41 +184,34 @@ static struct ubuf *ubuf_pic_mem_alloc(struct ubuf_mgr *mgr,
 
     struct ubuf *ubuf = ubuf_pic_mem_to_ubuf(pic_mem);
 
-    pic_mem->shared = ubuf_pic_mem_shared_alloc_pool(mgr);
-    if (unlikely(pic_mem->shared == NULL)) {
-        ubuf_pic_mem_free_pool(mgr, pic_mem);
-        return NULL;
-    }
-
     size_t hmsize = hsize / pic_mgr->common_mgr.macropixel;
-    size_t buffer_size = 0;
     size_t plane_sizes[pic_mgr->common_mgr.nb_planes];
     size_t strides[pic_mgr->common_mgr.nb_planes];
-    for (uint8_t plane = 0; plane < pic_mgr->common_mgr.nb_planes; plane++) {
-        size_t align = 0;
-        if (pic_mgr->align &&
-                ((hmsize + pic_mgr->hmprepend + pic_mgr->hmappend) /
-                    pic_mgr->common_mgr.planes[plane]->hsub *
-                    pic_mgr->common_mgr.planes[plane]->macropixel_size) %
-                        pic_mgr->align)
-            align = pic_mgr->align;
-        strides[plane] = (hmsize + pic_mgr->hmprepend + pic_mgr->hmappend) /
-                            pic_mgr->common_mgr.planes[plane]->hsub *
-                            pic_mgr->common_mgr.planes[plane]->macropixel_size +
-                         align;
-        if (align)
-            strides[plane] -= strides[plane] % align;
-        plane_sizes[plane] = (vsize + pic_mgr->vprepend + pic_mgr->vappend) /
-                                 pic_mgr->common_mgr.planes[plane]->vsub *
-                                 strides[plane] + pic_mgr->align;
-        buffer_size += plane_sizes[plane];
-    }
+    size_t buffer_size = ubuf_pic_mem_layout(pic_mgr, hsize, vsize,
+                                             strides, plane_sizes);
+
+    if (pic_mgr->frame_size && pic_mgr->frame_size == buffer_size) {
+        /* the buffer comes with the shared structure */
+        pic_mem->shared = upool_alloc(&pic_mgr->frame_pool,
+                                      struct ubuf_mem_shared *);
+        if (unlikely(pic_mem->shared == NULL)) {
+            ubuf_pic_mem_free_pool(mgr, pic_mem);
+            return NULL;
+        }
+        uatomic_store(&pic_mem->shared->refcount, 1);
+    } else {
+        pic_mem->shared = ubuf_pic_mem_shared_alloc_pool(mgr);
+        if (unlikely(pic_mem->shared == NULL)) {
+            ubuf_pic_mem_free_pool(mgr, pic_mem);
+            return NULL;
+        }
 
-    if (unlikely(!umem_alloc(pic_mgr->umem_mgr, &pic_mem->shared->umem,
-                             buffer_size))) {
-        ubuf_pic_mem_shared_free_pool(pic_mem->shared);
-        ubuf_pic_mem_free_pool(mgr, pic_mem);
-        return NULL;
+        if (unlikely(!umem_alloc(pic_mgr->umem_mgr, &pic_mem->shared->umem,
+                                 buffer_size))) {
+            ubuf_pic_mem_shared_free_pool(pic_mem->shared);
+            ubuf_pic_mem_free_pool(mgr, pic_mem);
+            return NULL;
+        }
     }
     ubuf_pic_common_init(ubuf, pic_mgr->hmprepend, pic_mgr->hmappend, hmsize,
                          pic_mgr->vprepend, pic_mgr->vappend, vsize);
@@ -387,8 +424,12 @@ static void ubuf_pic_mem_free(struct ubuf *ubuf)
 #endif
 
     if (unlikely(ubuf_mem_shared_release(pic_mem->shared))) {
-        umem_free(&pic_mem->shared->umem);
-        ubuf_pic_mem_shared_free_pool(pic_mem->shared);
+        if (pic_mem->shared->pool == &pic_mgr->frame_pool)
+            upool_free(&pic_mgr->frame_pool, pic_mem->shared);
+        else {
+            umem_free(&pic_mem->shared->umem);
+            ubuf_pic_mem_shared_free_pool(pic_mem->shared);
+        }
     }
     ubuf_pic_mem_free_pool(mgr, pic_mem);
 }
@@ -429,6 +470,38 @@ static void ubuf_pic_mem_free_inner(struct upool *upool, void *_pic_mem)
     free(pic_mem);
 }
 
+/** @internal @This allocates a shared structure and its frame buffer.
+ *
+ * @param upool pointer to upool
+ * @return pointer to ubuf_mem_shared or NULL in case of allocation error
+ */
+static void *ubuf_pic_mem_frame_alloc_inner(struct upool *upool)
+{
+    struct ubuf_pic_mem_mgr *pic_mgr =
+        ubuf_pic_mem_mgr_from_frame_pool(upool);
+    struct ubuf_mem_shared *shared = ubuf_mem_shared_alloc_inner(upool);
+    if (unlikely(shared == NULL))
+        return NULL;
+    if (unlikely(!umem_alloc(pic_mgr->umem_mgr, &shared->umem,
+                             pic_mgr->frame_size))) {
+        ubuf_mem_shared_free_inner(upool, shared);
+        return NULL;
+    }
+    return shared;
+}
+
+/** @internal @This frees a shared structure and its frame buffer.
+ *
+ * @param upool pointer to upool
+ * @param _shared pointer to a ubuf_mem_shared structure to free
+ */
+static void ubuf_pic_mem_frame_free_inner(struct upool *upool, void *_shared)
+{
+    struct ubuf_mem_shared *shared = (struct ubuf_mem_shared *)_shared;
+    umem_free(&shared->umem);
+    ubuf_mem_shared_free_inner(upool, shared);
+}
+
 /** @This checks if the given flow format can be allocated with the manager.
  *
  * @param mgr pointer to ubuf manager
@@ -504,7 +577,37 @@ static int ubuf_pic_mem_mgr_control(struct ubuf_mgr *mgr,
             return ubuf_pic_mem_mgr_check(mgr, flow_format);
         }
         case UBUF_MGR_VACUUM: {
+            struct ubuf_pic_mem_mgr *pic_mgr =
+                ubuf_pic_mem_mgr_from_ubuf_mgr(mgr);
             ubuf_pic_mem_mgr_vacuum_pool(mgr);
+            if (pic_mgr->frame_size)
+                upool_vacuum(&pic_mgr->frame_pool);
+            return UBASE_ERR_NONE;
+        }
+        case UBUF_MGR_PREFILL: {
+            struct ubuf_pic_mem_mgr *pic_mgr =
+                ubuf_pic_mem_mgr_from_ubuf_mgr(mgr);
+            unsigned int count = va_arg(args, unsigned int);
+            ubuf_pic_mem_mgr_prefill_pool(mgr, count);
+            if (pic_mgr->frame_size)
+                upool_prefill(&pic_mgr->frame_pool, count);
+            return UBASE_ERR_NONE;
+        }
+        case UBUF_MGR_SET_STATS: {
+            bool enabled = va_arg(args, int);
+            ubuf_pic_mem_mgr_set_stats_pool(mgr, enabled);
+            struct ubuf_pic_mem_mgr *pic_mgr =
+                ubuf_pic_mem_mgr_from_ubuf_mgr(mgr);
+            if (pic_mgr->frame_size)
+                upool_set_stats(&pic_mgr->frame_pool, enabled);
+            return UBASE_ERR_NONE;
+        }
+        case UBUF_MGR_GET_STATS: {
+            struct upool_stats *ubuf_stats =
+                va_arg(args, struct upool_stats *);
+            struct upool_stats *shared_stats =
+                va_arg(args, struct upool_stats *);
+            ubuf_pic_mem_mgr_get_stats_pool(mgr, ubuf_stats, shared_stats);
             return UBASE_ERR_NONE;
         }
         default:
@@ -522,6 +625,10 @@ static void ubuf_pic_mem_mgr_free(struct urefcount *urefcount)
         ubuf_pic_mem_mgr_from_urefcount(urefcount);
     struct ubuf_mgr *mgr = ubuf_pic_mem_mgr_to_ubuf_mgr(pic_mgr);
     ubuf_pic_mem_mgr_clean_pool(mgr);
+    if (pic_mgr->frame_size) {
+        upool_clean(&pic_mgr->frame_pool);
+        free(pic_mgr->frame_pool_extra);
+    }
     umem_mgr_release(pic_mgr->umem_mgr);
 
     ubuf_pic_common_mgr_clean(mgr);
@@ -596,6 +703,8 @@ struct ubuf_mgr *ubuf_pic_mem_mgr_alloc(uint16_t ubuf_pool_depth,
             ubuf_pool_depth, shared_pool_depth, pic_mgr->upool_extra,
             ubuf_pic_mem_alloc_inner, ubuf_pic_mem_free_inner);
 
+    pic_mgr->frame_size = 0;
+    pic_mgr->frame_pool_extra = NULL;
     pic_mgr->umem_mgr = umem_mgr;
     umem_mgr_use(umem_mgr);
 
@@ -624,6 +733,76 @@ int ubuf_pic_mem_mgr_add_plane(struct ubuf_mgr *mgr, const char *chroma,
                                          macropixel_size);
 }
 
+/** @This dedicates a pool of frame buffers to pictures of the given size.
+ * Buffers of released pictures of that size are kept in the pool instead of
+ * being returned to the umem allocator, which avoids allocating large frames
+ * in steady state. It may only be called on initializing the manager, after
+ * the planes are added and before any ubuf is allocated.
+ *
+ * @param mgr pointer to a ubuf_mgr structure
+ * @param hsize horizontal size of the pictures, in pixels
+ * @param vsize vertical size of the pictures, in lines
+ * @param depth maximum number of frame buffers in the pool
+ * @param prefill number of frame buffers to allocate immediately
+ * @return an error code
+ */
+int ubuf_pic_mem_mgr_add_frame_pool(struct ubuf_mgr *mgr,
+                                    int hsize, int vsize,
+                                    uint16_t depth, uint16_t prefill)
+{
+    assert(mgr != NULL);
+    struct ubuf_pic_mem_mgr *pic_mgr = ubuf_pic_mem_mgr_from_ubuf_mgr(mgr);
+    if (unlikely(pic_mgr->frame_size || !depth || prefill > depth ||
+                 !pic_mgr->common_mgr.nb_planes))
+        return UBASE_ERR_INVALID;
+    UBASE_RETURN(ubuf_pic_common_check_size(mgr, hsize, vsize))
+
+    size_t plane_sizes[pic_mgr->common_mgr.nb_planes];
+    size_t strides[pic_mgr->common_mgr.nb_planes];
+    size_t frame_size = ubuf_pic_mem_layout(pic_mgr, hsize, vsize,
+                                            strides, plane_sizes);
+    if (unlikely(!frame_size))
+        return UBASE_ERR_INVALID;
+
+    pic_mgr->frame_pool_extra = malloc(upool_sizeof(depth));
+    UBASE_ALLOC_RETURN(pic_mgr->frame_pool_extra)
+    pic_mgr->frame_size = frame_size;
+    upool_init(&pic_mgr->frame_pool, pic_mgr->common_mgr.mgr.refcount,
+               depth, pic_mgr->frame_pool_extra,
+               ubuf_pic_mem_frame_alloc_inner, ubuf_pic_mem_frame_free_inner);
+
+    struct ubuf_mem_shared *shared[prefill];
+    uint16_t i;
+    for (i = 0; i < prefill; i++) {
+        shared[i] = upool_alloc(&pic_mgr->frame_pool,
+                                struct ubuf_mem_shared *);
+        if (unlikely(shared[i] == NULL))
+            break;
+    }
+    uint16_t allocated = i;
+    for (i = 0; i < allocated; i++)
+        upool_free(&pic_mgr->frame_pool, shared[i]);
+    return allocated == prefill ? UBASE_ERR_NONE : UBASE_ERR_ALLOC;
+}
+
+/** @This reads the counters of the frame pool. They are only updated while
+ * the statistics of the manager are enabled, see @ref ubuf_mgr_set_stats.
+ *
+ * @param mgr pointer to a ubuf_mgr structure
+ * @param stats filled in with the counters of the frame pool
+ * @return an error code, UBASE_ERR_INVALID if there is no frame pool
+ */
+int ubuf_pic_mem_mgr_get_frame_stats(struct ubuf_mgr *mgr,
+                                     struct upool_stats *stats)
+{
+    assert(mgr != NULL);
+    struct ubuf_pic_mem_mgr *pic_mgr = ubuf_pic_mem_mgr_from_ubuf_mgr(mgr);
+    if (unlikely(!pic_mgr->frame_size))
+        return UBASE_ERR_INVALID;
+    upool_get_stats(&pic_mgr->frame_pool, stats);
+    return UBASE_ERR_NONE;
+}
+
 /** @This allocates a new instance of the ubuf manager for picture formats
  * using umem, from a fourcc image format.
  *
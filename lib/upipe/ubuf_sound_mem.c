@@ -36,6 +36,7 @@
 #include <upipe/ubuf_sound.h>
 #include <upipe/ubuf_sound_common.h>
 #include <upipe/ubuf_sound_mem.h>
+#include <upipe/ubuf_block_mem.h>
 #include <upipe/ubuf_mem_common.h>
 #include <upipe/uref.h>
 #include <upipe/uref_flow.h>
@@ -47,8 +48,8 @@
 #include <string.h>
 #include <assert.h>
 
-/** default alignment in octets */
-#define UBUF_DEFAULT_ALIGN          0
+/** default alignment in octets, the size of a cache line */
+#define UBUF_DEFAULT_ALIGN          64
 
 /** @This is a super-set of the @ref ubuf (and @ref ubuf_sound_common)
  * structure with private fields pointing to shared data. */
@@ -80,6 +81,12 @@ struct ubuf_sound_mem_mgr {
     struct upool ubuf_pool;
     /** ubuf shared pool */
     struct upool shared_pool;
+    /** pool of shared structures keeping their buffers */
+    struct upool frame_pool;
+    /** size of the buffers in the frame pool, or 0 if there is no pool */
+    size_t frame_size;
+    /** extra space for the frame pool */
+    void *frame_pool_extra;
     /** umem allocator */
     struct umem_mgr *umem_mgr;
 
@@ -93,43 +100,114 @@ struct ubuf_sound_mem_mgr {
 UBASE_FROM_TO(ubuf_sound_mem_mgr, ubuf_mgr, ubuf_mgr, common_mgr.mgr)
 UBASE_FROM_TO(ubuf_sound_mem_mgr, urefcount, urefcount, urefcount)
 UBASE_FROM_TO(ubuf_sound_mem_mgr, upool, ubuf_pool, ubuf_pool)
+UBASE_FROM_TO(ubuf_sound_mem_mgr, upool, frame_pool, frame_pool)
 
 UBUF_MEM_MGR_HELPER_POOL(ubuf_sound_mem, ubuf_pool, shared_pool, shared)
 
-/** @This allocates a ubuf, a shared structure and a umem buffer.
+/** @This allocates a ubuf reusing the shared structure of planes of
+ * another ubuf sound mem.
  *
  * @param mgr common management structure
- * @param alloc_type must be UBUF_ALLOC_SOUND (sentinel)
- * @param args optional arguments (1st = size)
+ * @param args optional arguments (1st = original ubuf, 2nd = array of
+ * channel types)
  * @return pointer to ubuf or NULL in case of allocation error
  */
-static struct ubuf *ubuf_sound_mem_alloc(struct ubuf_mgr *mgr,
-                                         uint32_t signature, va_list args)
+static struct ubuf *_ubuf_sound_mem_alloc_from_sound(struct ubuf_mgr *mgr,
+                                                     va_list args)
 {
-    if (unlikely(signature != UBUF_ALLOC_SOUND))
+    struct ubuf *ubuf_orig = va_arg(args, struct ubuf *);
+    const char *const *channels = va_arg(args, const char *const *);
+    struct ubuf_sound_mem_mgr *sound_mgr =
+        ubuf_sound_mem_mgr_from_ubuf_mgr(mgr);
+    uint8_t nb_planes = sound_mgr->common_mgr.nb_planes;
+
+    size_t size;
+    uint8_t sample_size;
+    if (unlikely(ubuf_orig == NULL || ubuf_orig->mgr == NULL ||
+                 channels == NULL ||
+                 !ubase_check(ubuf_sound_size(ubuf_orig, &size,
+                                              &sample_size)) ||
+                 sample_size != sound_mgr->common_mgr.sample_size))
         return NULL;
 
-    int ssize = va_arg(args, int);
-    if (ssize < 0)
+    struct ubuf_mem_shared *shared_orig = NULL;
+    size_t offsets[nb_planes];
+    for (uint8_t plane = 0; plane < nb_planes; plane++) {
+        struct ubuf_mem_shared *shared;
+        size_t plane_size;
+        if (unlikely(channels[plane] == NULL ||
+                     !ubase_check(ubuf_sound_mem_get_shared(ubuf_orig,
+                             channels[plane], &shared, &offsets[plane],
+                             &plane_size)) ||
+                     (shared_orig != NULL && shared != shared_orig)))
+            return NULL;
+        shared_orig = shared;
+    }
+    if (unlikely(shared_orig == NULL))
         return NULL;
-    size_t size = ssize;
 
+    struct ubuf_sound_mem *sound_mem = ubuf_sound_mem_alloc_pool(mgr);
+    if (unlikely(sound_mem == NULL))
+        return NULL;
+
+    /* We reuse the shared structure. */
+    struct ubuf *ubuf = ubuf_sound_mem_to_ubuf(sound_mem);
+    sound_mem->shared = ubuf_mem_shared_use(shared_orig);
+    ubuf_sound_common_init(ubuf, size);
+
+    uint8_t *buffer = ubuf_mem_shared_buffer(sound_mem->shared);
+    for (uint8_t plane = 0; plane < nb_planes; plane++)
+        ubuf_sound_common_plane_init(ubuf, plane, buffer + offsets[plane]);
+
+    return ubuf;
+}
+
+/** @This allocates a ubuf reusing the shared structure of a ubuf block mem.
+ *
+ * @param mgr common management structure
+ * @param args optional arguments (1st = original ubuf)
+ * @return pointer to ubuf or NULL in case of allocation error
+ */
+static struct ubuf *_ubuf_sound_mem_alloc_from_block(struct ubuf_mgr *mgr,
+                                                     va_list args)
+{
+    struct ubuf *ubuf_orig = va_arg(args, struct ubuf *);
     struct ubuf_sound_mem_mgr *sound_mgr =
         ubuf_sound_mem_mgr_from_ubuf_mgr(mgr);
+
+    struct ubuf_mem_shared *shared_orig;
+    size_t offset, size;
+    if (unlikely(sound_mgr->common_mgr.nb_planes != 1 ||
+                 ubuf_orig == NULL || ubuf_orig->mgr == NULL ||
+                 !ubase_check(ubuf_block_mem_get_shared(ubuf_orig,
+                         &shared_orig, &offset, &size))))
+        return NULL;
+
     struct ubuf_sound_mem *sound_mem = ubuf_sound_mem_alloc_pool(mgr);
     if (unlikely(sound_mem == NULL))
         return NULL;
 
+    /* We reuse the shared structure. */
     struct ubuf *ubuf = ubuf_sound_mem_to_ubuf(sound_mem);
+    sound_mem->shared = ubuf_mem_shared_use(shared_orig);
+    ubuf_sound_common_init(ubuf, size / sound_mgr->common_mgr.sample_size);
+    ubuf_sound_common_plane_init(ubuf, 0,
+            ubuf_mem_shared_buffer(sound_mem->shared) + offset);
 
-    sound_mem->shared = ubuf_sound_mem_shared_alloc_pool(mgr);
-    if (unlikely(sound_mem->shared == NULL)) {
-        ubuf_sound_mem_free_pool(mgr, sound_mem);
-        return NULL;
-    }
+    return ubuf;
+}
 
+/** @internal @This computes the layout of the planes of a sound buffer.
+ *
+ * @param sound_mgr pointer to private manager structure
+ * @param size number of samples
+ * @param plane_sizes filled in with the size of each plane
+ * @return size of the buffer to allocate
+ */
+static size_t ubuf_sound_mem_layout(struct ubuf_sound_mem_mgr *sound_mgr,
+                                    size_t size, size_t *plane_sizes)
+{
     size_t buffer_size = 0;
-    size_t plane_sizes[sound_mgr->common_mgr.nb_planes];
     for (uint8_t plane = 0; plane < sound_mgr->common_mgr.nb_planes; plane++) {
         size_t align = 0;
         size_t plane_size;
@@ -141,12 +219,66 @@ static struct ubuf *ubuf_sound_mem_alloc(struct ubuf_mgr *mgr,
         plane_sizes[plane] = plane_size + sound_mgr->align;
         buffer_size += plane_sizes[plane];
     }
+    return buffer_size;
+}
 
-    if (unlikely(!umem_alloc(sound_mgr->umem_mgr, &sound_mem->shared->umem,
-                             buffer_size))) {
-        ubuf_sound_mem_shared_free_pool(sound_mem->shared);
-        ubuf_sound_mem_free_pool(mgr, sound_mem);
+/** @This allocates a ubuf, a shared structure and a umem buffer.
+ *
+ * @param mgr common management structure
+ * @param alloc_type must be UBUF_ALLOC_SOUND,
+ * UBUF_SOUND_MEM_ALLOC_FROM_SOUND or UBUF_SOUND_MEM_ALLOC_FROM_BLOCK
+ * (sentinel)
+ * @param args optional arguments (1st = size)
+ * @return pointer to ubuf or NULL in case of allocation error
+ */
+static struct ubuf *ubuf_sound_mem_alloc(struct ubuf_mgr *mgr,
+                                         uint32_t signature, va_list args)
+{
+    if (signature == UBUF_SOUND_MEM_ALLOC_FROM_SOUND)
+        return _ubuf_sound_mem_alloc_from_sound(mgr, args);
+    if (signature == UBUF_SOUND_MEM_ALLOC_FROM_BLOCK)
+        return _ubuf_sound_mem_alloc_from_block(mgr, args);
+    if (unlikely(signature != UBUF_ALLOC_SOUND))
         return NULL;
+
+    int ssize = va_arg(args, int);
+    if (ssize < 0)
+        return NULL;
+    size_t size = ssize;
+
+    struct ubuf_sound_mem_mgr *sound_mgr =
+        ubuf_sound_mem_mgr_from_ubuf_mgr(mgr);
+    struct ubuf_sound_mem *sound_mem = ubuf_sound_mem_alloc_pool(mgr);
+    if (unlikely(sound_mem == NULL))
+        return NULL;
+
+    struct ubuf *ubuf = ubuf_sound_mem_to_ubuf(sound_mem);
+
+    size_t plane_sizes[sound_mgr->common_mgr.nb_planes];
+    size_t buffer_size = ubuf_sound_mem_layout(sound_mgr, size, plane_sizes);
+
+    if (sound_mgr->frame_size && sound_mgr->frame_size == buffer_size) {
+        /* the buffer comes with the shared structure */
+        sound_mem->shared = upool_alloc(&sound_mgr->frame_pool,
+                                        struct ubuf_mem_shared *);
+        if (unlikely(sound_mem->shared == NULL)) {
+            ubuf_sound_mem_free_pool(mgr, sound_mem);
+            return NULL;
+        }
+        uatomic_store(&sound_mem->shared->refcount, 1);
+    } else {
+        sound_mem->shared = ubuf_sound_mem_shared_alloc_pool(mgr);
+        if (unlikely(sound_mem->shared == NULL)) {
+            ubuf_sound_mem_free_pool(mgr, sound_mem);
+            return NULL;
+        }
+
+        if (unlikely(!umem_alloc(sound_mgr->umem_mgr,
+                                 &sound_mem->shared->umem, buffer_size))) {
+            ubuf_sound_mem_shared_free_pool(sound_mem->shared);
+            ubuf_sound_mem_free_pool(mgr, sound_mem);
+            return NULL;
+        }
     }
     ubuf_sound_common_init(ubuf, size);
 
@@ -328,8 +460,12 @@ static void ubuf_sound_mem_free(struct ubuf *ubuf)
 #endif
 
     if (unlikely(ubuf_mem_shared_release(sound_mem->shared))) {
-        umem_free(&sound_mem->shared->umem);
-        ubuf_sound_mem_shared_free_pool(sound_mem->shared);
+        if (sound_mem->shared->pool == &sound_mgr->frame_pool)
+            upool_free(&sound_mgr->frame_pool, sound_mem->shared);
+        else {
+            umem_free(&sound_mem->shared->umem);
+            ubuf_sound_mem_shared_free_pool(sound_mem->shared);
+        }
     }
     ubuf_sound_mem_free_pool(mgr, sound_mem);
 }
@@ -370,6 +506,38 @@ static void ubuf_sound_mem_free_inner(struct upool *upool, void *_sound_mem)
     free(sound_mem);
 }
 
+/** @internal @This allocates a shared structure and its buffer.
+ *
+ * @param upool pointer to upool
+ * @return pointer to ubuf_mem_shared or NULL in case of allocation error
+ */
+static void *ubuf_sound_mem_frame_alloc_inner(struct upool *upool)
+{
+    struct ubuf_sound_mem_mgr *sound_mgr =
+        ubuf_sound_mem_mgr_from_frame_pool(upool);
+    struct ubuf_mem_shared *shared = ubuf_mem_shared_alloc_inner(upool);
+    if (unlikely(shared == NULL))
+        return NULL;
+    if (unlikely(!umem_alloc(sound_mgr->umem_mgr, &shared->umem,
+                             sound_mgr->frame_size))) {
+        ubuf_mem_shared_free_inner(upool, shared);
+        return NULL;
+    }
+    return shared;
+}
+
+/** @internal @This frees a shared structure and its buffer.
+ *
+ * @param upool pointer to upool
+ * @param _shared pointer to a ubuf_mem_shared structure to free
+ */
+static void ubuf_sound_mem_frame_free_inner(struct upool *upool, void *_shared)
+{
+    struct ubuf_mem_shared *shared = (struct ubuf_mem_shared *)_shared;
+    umem_free(&shared->umem);
+    ubuf_mem_shared_free_inner(upool, shared);
+}
+
 /** @This checks if the given flow format can be allocated with the manager.
  *
  * @param mgr pointer to ubuf manager
@@ -429,7 +597,33 @@ static int ubuf_sound_mem_mgr_control(struct ubuf_mgr *mgr,
             return ubuf_sound_mem_mgr_check(mgr, flow_format);
         }
         case UBUF_MGR_VACUUM: {
+            struct ubuf_sound_mem_mgr *sound_mgr =
+                ubuf_sound_mem_mgr_from_ubuf_mgr(mgr);
             ubuf_sound_mem_mgr_vacuum_pool(mgr);
+            if (sound_mgr->frame_size)
+                upool_vacuum(&sound_mgr->frame_pool);
+            return UBASE_ERR_NONE;
+        }
+        case UBUF_MGR_PREFILL: {
+            struct ubuf_sound_mem_mgr *sound_mgr =
+                ubuf_sound_mem_mgr_from_ubuf_mgr(mgr);
+            unsigned int count = va_arg(args, unsigned int);
+            ubuf_sound_mem_mgr_prefill_pool(mgr, count);
+            if (sound_mgr->frame_size)
+                upool_prefill(&sound_mgr->frame_pool, count);
+            return UBASE_ERR_NONE;
+        }
+        case UBUF_MGR_SET_STATS: {
+            bool enabled = va_arg(args, int);
+            ubuf_sound_mem_mgr_set_stats_pool(mgr, enabled);
+            return UBASE_ERR_NONE;
+        }
+        case UBUF_MGR_GET_STATS: {
+            struct upool_stats *ubuf_stats =
+                va_arg(args, struct upool_stats *);
+            struct upool_stats *shared_stats =
+                va_arg(args, struct upool_stats *);
+            ubuf_sound_mem_mgr_get_stats_pool(mgr, ubuf_stats, shared_stats);
             return UBASE_ERR_NONE;
         }
         default:
@@ -447,6 +641,10 @@ static void ubuf_sound_mem_mgr_free(struct urefcount *urefcount)
         ubuf_sound_mem_mgr_from_urefcount(urefcount);
     struct ubuf_mgr *mgr = ubuf_sound_mem_mgr_to_ubuf_mgr(sound_mgr);
     ubuf_sound_mem_mgr_clean_pool(mgr);
+    if (sound_mgr->frame_size) {
+        upool_clean(&sound_mgr->frame_pool);
+        free(sound_mgr->frame_pool_extra);
+    }
     umem_mgr_release(sound_mgr->umem_mgr);
 
     ubuf_sound_common_mgr_clean(mgr);
@@ -496,8 +694,10 @@ struct ubuf_mgr *ubuf_sound_mem_mgr_alloc(uint16_t ubuf_pool_depth,
             ubuf_pool_depth, shared_pool_depth, sound_mgr->upool_extra,
             ubuf_sound_mem_alloc_inner, ubuf_sound_mem_free_inner);
 
+    sound_mgr->frame_size = 0;
+    sound_mgr->frame_pool_extra = NULL;
     sound_mgr->umem_mgr = umem_mgr;
-    sound_mgr->align = align;
+    sound_mgr->align = align ? align : UBUF_DEFAULT_ALIGN;
     umem_mgr_use(umem_mgr);
 
     return mgr;
@@ -518,3 +718,53 @@ int ubuf_sound_mem_mgr_add_plane(struct ubuf_mgr *mgr, const char *channel)
 
     return ubuf_sound_common_mgr_add_plane(mgr, channel);
 }
+
+/** @This dedicates a pool of buffers to sound ubufs of the given number of
+ * samples. Buffers of released ubufs of that size are kept in the pool
+ * instead of being returned to the umem allocator. It may only be called on
+ * initializing the manager, after the planes are added and before any ubuf
+ * is allocated.
+ *
+ * @param mgr pointer to a ubuf_mgr structure
+ * @param samples number of samples of the ubufs
+ * @param depth maximum number of buffers in the pool
+ * @param prefill number of buffers to allocate immediately
+ * @return an error code
+ */
+int ubuf_sound_mem_mgr_add_frame_pool(struct ubuf_mgr *mgr, size_t samples,
+                                      uint16_t depth, uint16_t prefill)
+{
+    assert(mgr != NULL);
+    struct ubuf_sound_mem_mgr *sound_mgr =
+        ubuf_sound_mem_mgr_from_ubuf_mgr(mgr);
+    if (unlikely(sound_mgr->frame_size || !depth || prefill > depth ||
+                 !samples || !sound_mgr->common_mgr.nb_planes))
+        return UBASE_ERR_INVALID;
+
+    size_t plane_sizes[sound_mgr->common_mgr.nb_planes];
+    size_t frame_size = ubuf_sound_mem_layout(sound_mgr, samples,
+                                              plane_sizes);
+    if (unlikely(!frame_size))
+        return UBASE_ERR_INVALID;
+
+    sound_mgr->frame_pool_extra = malloc(upool_sizeof(depth));
+    UBASE_ALLOC_RETURN(sound_mgr->frame_pool_extra)
+    sound_mgr->frame_size = frame_size;
+    upool_init(&sound_mgr->frame_pool, sound_mgr->common_mgr.mgr.refcount,
+               depth, sound_mgr->frame_pool_extra,
+               ubuf_sound_mem_frame_alloc_inner,
+               ubuf_sound_mem_frame_free_inner);
+
+    struct ubuf_mem_shared *shared[prefill];
+    uint16_t i;
+    for (i = 0; i < prefill; i++) {
+        shared[i] = upool_alloc(&sound_mgr->frame_pool,
+                                struct ubuf_mem_shared *);
+        if (unlikely(shared[i] == NULL))
+            break;
+    }
+    uint16_t allocated = i;
+    for (i = 0; i < allocated; i++)
+        upool_free(&sound_mgr->frame_pool, shared[i]);
+    return allocated == prefill ? UBASE_ERR_NONE : UBASE_ERR_ALLOC;
+}
@@ -0,0 +1,342 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short Upipe implementation of uclock reading a PTP hardware clock
+ *
+ * The clock is read either from a PTP hardware clock exposed by the kernel
+ * as /dev/ptpN, or from the TAI clock of the system when it is disciplined
+ * against the PTP hardware clock by phc2sys. Reading a PTP hardware clock
+ * is a system call, so in cached mode the monotonic clock is read instead,
+ * and the offset and rate between both clocks are measured once per
+ * @ref UCLOCK_PTP_PERIOD.
+ */
+
+#include <upipe/ubase.h>
+#include <upipe/urefcount.h>
+#include <upipe/uatomic.h>
+#include <upipe/uclock.h>
+#include <upipe/uclock_ptp.h>
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <time.h>
+
+#ifdef __linux__
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/timex.h>
+
+/** @hidden */
+#define UCLOCK_PTP_LINUX
+/** dynamic clock identifier of a PTP hardware clock file descriptor */
+#define UCLOCK_PTP_FD_TO_CLOCKID(fd) ((~(clockid_t)(fd) << 3) | 3)
+/** period between corrections of the cached mode, in monotonic time */
+#define UCLOCK_PTP_PERIOD UCLOCK_FREQ
+/** maximum error corrected by slewing, larger errors are stepped */
+#define UCLOCK_PTP_MAX_SLEW (UCLOCK_FREQ / 1000)
+#endif
+
+/** super-set of the uclock structure with additional local members */
+struct uclock_ptp {
+    /** refcount management structure */
+    struct urefcount urefcount;
+
+    /** flags at the creation of this clock */
+    enum uclock_ptp_flags flags;
+#ifdef UCLOCK_PTP_LINUX
+    /** file descriptor of the PTP hardware clock, or -1 */
+    int fd;
+    /** clock to read */
+    clockid_t clockid;
+
+    /** sequence number of the cached parameters, odd while they are
+     * updated */
+    uatomic_uint32_t seq;
+    /** monotonic time at the last correction */
+    uint64_t ref_mono;
+    /** PTP time at the last correction */
+    uint64_t ref_now;
+    /** PTP ticks per monotonic tick, in 32.32 fixed point */
+    uint64_t mult;
+    /** monotonic time of the last measurement */
+    uint64_t sample_mono;
+    /** PTP time of the last measurement */
+    uint64_t sample_now;
+#endif
+
+    /** structure exported to modules */
+    struct uclock uclock;
+};
+
+UBASE_FROM_TO(uclock_ptp, uclock, uclock, uclock)
+UBASE_FROM_TO(uclock_ptp, urefcount, urefcount, urefcount)
+
+#ifdef UCLOCK_PTP_LINUX
+/** @internal @This reads a clock of the system.
+ *
+ * @param clockid clock to read
+ * @return current time in 27 MHz ticks, or UINT64_MAX in case of error
+ */
+static uint64_t uclock_ptp_read(clockid_t clockid)
+{
+    struct timespec ts;
+    if (unlikely(clock_gettime(clockid, &ts) == -1))
+        return UINT64_MAX;
+    return ts.tv_sec * UCLOCK_FREQ +
+           ts.tv_nsec * UCLOCK_FREQ / UINT64_C(1000000000);
+}
+
+/** @internal @This measures the PTP clock against the monotonic clock.
+ * The PTP clock is read between two readings of the monotonic clock, whose
+ * average is returned.
+ *
+ * @param ptp pointer to uclock_ptp
+ * @param mono_p filled in with the monotonic time
+ * @param now_p filled in with the PTP time
+ * @return false in case of error
+ */
+static bool uclock_ptp_sample(struct uclock_ptp *ptp, uint64_t *mono_p,
+                              uint64_t *now_p)
+{
+    uint64_t before = uclock_ptp_read(CLOCK_MONOTONIC);
+    uint64_t now = uclock_ptp_read(ptp->clockid);
+    uint64_t after = uclock_ptp_read(CLOCK_MONOTONIC);
+    if (unlikely(before == UINT64_MAX || now == UINT64_MAX ||
+                 after == UINT64_MAX))
+        return false;
+    *mono_p = before + (after - before) / 2;
+    *now_p = now;
+    return true;
+}
+
+/** @internal @This measures the PTP clock again, and corrects the cached
+ * parameters so that the error is absorbed over the next period without
+ * going backwards.
+ *
+ * @param ptp pointer to uclock_ptp
+ */
+static void uclock_ptp_correct(struct uclock_ptp *ptp)
+{
+    uint32_t seq = uatomic_load(&ptp->seq);
+    if ((seq & 1) || !uatomic_compare_exchange(&ptp->seq, &seq, seq + 1))
+        return; /* another thread is already on it */
+
+    uint64_t mono, now;
+    if (likely(uclock_ptp_sample(ptp, &mono, &now))) {
+        uint64_t expected = ptp->ref_now +
+            (((unsigned __int128)(mono - ptp->ref_mono) * ptp->mult) >> 32);
+        int64_t error = now - expected;
+        /* short-term rate, which follows the steering of the PTP clock */
+        uint64_t mult = UINT64_C(1) << 32;
+        if (likely(mono > ptp->sample_mono && now > ptp->sample_now))
+            mult = ((unsigned __int128)(now - ptp->sample_now) << 32) /
+                   (mono - ptp->sample_mono);
+        ptp->sample_mono = mono;
+        ptp->sample_now = now;
+        ptp->ref_mono = mono;
+
+        if (error > (int64_t)UCLOCK_PTP_MAX_SLEW ||
+            error < -(int64_t)UCLOCK_PTP_MAX_SLEW ||
+            mult > (UINT64_C(3) << 31) || mult < (UINT64_C(1) << 31)) {
+            /* the PTP clock was stepped */
+            ptp->ref_now = now;
+            ptp->mult = UINT64_C(1) << 32;
+        } else {
+            ptp->ref_now = expected;
+            ptp->mult = mult +
+                ((__int128)error * (INT64_C(1) << 32) /
+                 (int64_t)UCLOCK_PTP_PERIOD);
+        }
+    }
+    uatomic_store(&ptp->seq, seq + 2);
+}
+
+/** @internal @This returns the current PTP time from the monotonic clock.
+ *
+ * @param ptp pointer to uclock_ptp
+ * @return current PTP time in 27 MHz ticks
+ */
+static uint64_t uclock_ptp_cached_now(struct uclock_ptp *ptp)
+{
+    uint64_t ref_mono, ref_now, mult;
+    uint32_t seq;
+    do {
+        seq = uatomic_load(&ptp->seq);
+        ref_mono = ptp->ref_mono;
+        ref_now = ptp->ref_now;
+        mult = ptp->mult;
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    } while (unlikely((seq & 1) || seq != uatomic_load(&ptp->seq)));
+
+    uint64_t mono = uclock_ptp_read(CLOCK_MONOTONIC);
+    if (unlikely(mono == UINT64_MAX))
+        return UINT64_MAX;
+    uint64_t delta = mono - ref_mono;
+    uint64_t now = ref_now + (((unsigned __int128)delta * mult) >> 32);
+    if (unlikely(delta > UCLOCK_PTP_PERIOD))
+        uclock_ptp_correct(ptp);
+    return now;
+}
+
+/** @internal @This returns the offset between TAI and UTC, as known by the
+ * kernel.
+ *
+ * @return offset in 27 MHz ticks
+ */
+static uint64_t uclock_ptp_tai_offset(void)
+{
+    struct timex tx = { .modes = 0 };
+    if (unlikely(adjtimex(&tx) == -1))
+        return 0;
+    return (uint64_t)tx.tai * UCLOCK_FREQ;
+}
+#endif
+
+/** @This returns the current PTP time.
+ *
+ * @param uclock utility structure passed to the module
+ * @return current PTP time in 27 MHz ticks
+ */
+static uint64_t uclock_ptp_now(struct uclock *uclock)
+{
+#ifdef UCLOCK_PTP_LINUX
+    struct uclock_ptp *ptp = uclock_ptp_from_uclock(uclock);
+    if (ptp->flags & UCLOCK_PTP_FLAG_CACHED)
+        return uclock_ptp_cached_now(ptp);
+    return uclock_ptp_read(ptp->clockid);
+#else
+    return UINT64_MAX;
+#endif
+}
+
+/** @This converts a PTP time to Epoch-based real time (from
+ * 1970-01-01 00:00:00 +0000). The scale is in units of @ref #UCLOCK_FREQ,
+ * divide by it to get standard time_t.
+ *
+ * @param uclock pointer to uclock
+ * @param systime PTP time in 27 MHz ticks
+ * @return number of ticks since the Epoch, or UINT64_MAX if unsupported
+ */
+static uint64_t uclock_ptp_to_real(struct uclock *uclock, uint64_t systime)
+{
+#ifdef UCLOCK_PTP_LINUX
+    return systime - uclock_ptp_tai_offset();
+#else
+    return UINT64_MAX;
+#endif
+}
+
+/** @This converts Epoch-based real time (from 1970-01-01 00:00:00 +0000)
+ * to PTP time. The scale has to be passed in units of @ref #UCLOCK_FREQ.
+ *
+ * @param uclock pointer to uclock
+ * @param real number of ticks since the Epoch
+ * @return PTP time in 27 MHz ticks, or UINT64_MAX if unsupported
+ */
+static uint64_t uclock_ptp_from_real(struct uclock *uclock, uint64_t real)
+{
+#ifdef UCLOCK_PTP_LINUX
+    return real + uclock_ptp_tai_offset();
+#else
+    return UINT64_MAX;
+#endif
+}
+
+/** @This frees a uclock.
+ *
+ * @param urefcount pointer to urefcount
+ */
+static void uclock_ptp_free(struct urefcount *urefcount)
+{
+    struct uclock_ptp *uclock_ptp = uclock_ptp_from_urefcount(urefcount);
+#ifdef UCLOCK_PTP_LINUX
+    uatomic_clean(&uclock_ptp->seq);
+    if (uclock_ptp->fd != -1)
+        close(uclock_ptp->fd);
+#endif
+    urefcount_clean(urefcount);
+    free(uclock_ptp);
+}
+
+/** @This allocates a new uclock structure returning the time of a PTP
+ * clock, that is the TAI time since 1970-01-01 00:00:00 TAI.
+ *
+ * @param device path to the PTP hardware clock (/dev/ptpN), or NULL to use
+ * the TAI time of the system, which is usually disciplined by phc2sys
+ * @param flags flags for the creation of a uclock structure
+ * @return pointer to uclock, or NULL in case of error
+ */
+struct uclock *uclock_ptp_alloc(const char *device,
+                                enum uclock_ptp_flags flags)
+{
+#ifdef UCLOCK_PTP_LINUX
+    int fd = -1;
+    clockid_t clockid = CLOCK_TAI;
+    if (device != NULL) {
+        fd = open(device, O_RDONLY | O_CLOEXEC);
+        if (unlikely(fd == -1))
+            return NULL;
+        clockid = UCLOCK_PTP_FD_TO_CLOCKID(fd);
+    }
+    if (unlikely(uclock_ptp_read(clockid) == UINT64_MAX)) {
+        if (fd != -1)
+            close(fd);
+        return NULL;
+    }
+
+    struct uclock_ptp *uclock_ptp = malloc(sizeof(struct uclock_ptp));
+    if (unlikely(uclock_ptp == NULL)) {
+        if (fd != -1)
+            close(fd);
+        return NULL;
+    }
+    uclock_ptp->fd = fd;
+    uclock_ptp->clockid = clockid;
+    uatomic_init(&uclock_ptp->seq, 0);
+    if (unlikely(!uclock_ptp_sample(uclock_ptp, &uclock_ptp->ref_mono,
+                                    &uclock_ptp->ref_now))) {
+        uatomic_clean(&uclock_ptp->seq);
+        if (fd != -1)
+            close(fd);
+        free(uclock_ptp);
+        return NULL;
+    }
+    uclock_ptp->mult = UINT64_C(1) << 32;
+    uclock_ptp->sample_mono = uclock_ptp->ref_mono;
+    uclock_ptp->sample_now = uclock_ptp->ref_now;
+
+    uclock_ptp->flags = flags;
+    urefcount_init(uclock_ptp_to_urefcount(uclock_ptp), uclock_ptp_free);
+    uclock_ptp->uclock.refcount = uclock_ptp_to_urefcount(uclock_ptp);
+    uclock_ptp->uclock.uclock_now = uclock_ptp_now;
+    uclock_ptp->uclock.uclock_to_real = uclock_ptp_to_real;
+    uclock_ptp->uclock.uclock_from_real = uclock_ptp_from_real;
+    return uclock_ptp_to_uclock(uclock_ptp);
+#else
+    /* PTP hardware clocks are only exposed by Linux */
+    return NULL;
+#endif
+}
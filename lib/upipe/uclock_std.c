@@ -30,12 +30,27 @@
 
 #include <upipe/ubase.h>
 #include <upipe/urefcount.h>
+#include <upipe/uatomic.h>
 #include <upipe/uclock.h>
 #include <upipe/uclock_std.h>
 
 #include <stdlib.h>
+#include <stdbool.h>
 #include <time.h>
 
+#if defined(__x86_64__) && !defined(__MACH__)
+#include <cpuid.h>
+#include <x86intrin.h>
+/** @hidden */
+#define UCLOCK_STD_TSC
+/** duration of the initial calibration of the TSC */
+#define UCLOCK_STD_TSC_CALIBRATION (UCLOCK_FREQ / 500)
+/** period between drift corrections, in units of the initial calibration */
+#define UCLOCK_STD_TSC_PERIOD 500
+/** maximum error corrected by slewing, larger errors are stepped */
+#define UCLOCK_STD_TSC_MAX_SLEW (UCLOCK_FREQ / 10)
+#endif
+
 #ifdef __MACH__
 #include <string.h>
 #include <mach/clock.h>
@@ -53,6 +68,22 @@ struct uclock_std {
     /** mach cclock structure */
     clock_serv_t cclock;
 #endif
+#ifdef UCLOCK_STD_TSC
+    /** sequence number of the TSC parameters, odd while they are updated */
+    uatomic_uint32_t tsc_seq;
+    /** TSC value at the last correction */
+    uint64_t tsc_ref;
+    /** system time at the last correction */
+    uint64_t tsc_ref_now;
+    /** 27 MHz ticks per TSC cycle, in 32.32 fixed point */
+    uint64_t tsc_mult;
+    /** number of TSC cycles between corrections */
+    uint64_t tsc_period;
+    /** TSC value at the initial calibration */
+    uint64_t tsc_origin;
+    /** system time at the initial calibration */
+    uint64_t tsc_origin_now;
+#endif
 
     /** structure exported to modules */
     struct uclock uclock;
@@ -89,6 +120,120 @@ static uint64_t uclock_std_now_inner(struct uclock *uclock,
     return now;
 }
 
+#ifdef UCLOCK_STD_TSC
+/** @internal @This checks whether the CPU has an invariant TSC.
+ *
+ * @return true if the TSC runs at a constant rate in all states
+ */
+static bool uclock_std_tsc_check(void)
+{
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid(0x80000000, &eax, &ebx, &ecx, &edx) ||
+        eax < 0x80000007)
+        return false;
+    __get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx);
+    return edx & (1 << 8);
+}
+
+/** @internal @This compares the TSC with the monotonic clock, and corrects
+ * the conversion parameters so that the drift is absorbed over the next
+ * period without going backwards.
+ *
+ * @param std pointer to uclock_std
+ * @param tsc current value of the TSC
+ * @param now current value of the TSC converted with the current parameters
+ */
+static void uclock_std_tsc_correct(struct uclock_std *std, uint64_t tsc,
+                                   uint64_t now)
+{
+    uint32_t seq = uatomic_load(&std->tsc_seq);
+    if ((seq & 1) ||
+        !uatomic_compare_exchange(&std->tsc_seq, &seq, seq + 1))
+        return; /* another thread is already on it */
+
+    uint64_t sys = uclock_std_now_inner(&std->uclock, 0);
+    if (likely(sys != UINT64_MAX)) {
+        /* long-term rate since the initial calibration */
+        uint64_t mult =
+            ((unsigned __int128)(sys - std->tsc_origin_now) << 32) /
+            (tsc - std->tsc_origin);
+        int64_t error = sys - now;
+        std->tsc_ref = tsc;
+        std->tsc_ref_now = now;
+        if (error > UCLOCK_STD_TSC_MAX_SLEW) {
+            /* probably resumed from suspend */
+            std->tsc_ref_now = sys;
+            std->tsc_mult = mult;
+        } else if (error < -(int64_t)UCLOCK_STD_TSC_MAX_SLEW) {
+            std->tsc_mult = mult / 2;
+        } else {
+            int64_t slew = ((__int128)error << 32) / (int64_t)std->tsc_period;
+            if (slew < -(int64_t)(mult / 2))
+                slew = -(int64_t)(mult / 2);
+            std->tsc_mult = mult + slew;
+        }
+    }
+    uatomic_store(&std->tsc_seq, seq + 2);
+}
+
+/** @internal @This returns the current system time from the TSC.
+ *
+ * @param std pointer to uclock_std
+ * @return current system time in 27 MHz ticks
+ */
+static uint64_t uclock_std_tsc_now(struct uclock_std *std)
+{
+    uint64_t tsc, ref, ref_now, mult;
+    uint32_t seq;
+    do {
+        seq = uatomic_load(&std->tsc_seq);
+        /* x86 does not reorder loads, only the compiler must be kept off */
+        __asm__ __volatile__("" ::: "memory");
+        ref = std->tsc_ref;
+        ref_now = std->tsc_ref_now;
+        mult = std->tsc_mult;
+        __asm__ __volatile__("" ::: "memory");
+    } while (unlikely((seq & 1) || seq != uatomic_load(&std->tsc_seq)));
+
+    tsc = __rdtsc();
+    uint64_t delta = tsc - ref;
+    uint64_t now = ref_now + (((unsigned __int128)delta * mult) >> 32);
+    if (unlikely(delta > std->tsc_period))
+        uclock_std_tsc_correct(std, tsc, now);
+    return now;
+}
+
+/** @internal @This calibrates the TSC against the monotonic clock.
+ *
+ * @param std pointer to uclock_std
+ * @return false if the TSC cannot be used
+ */
+static bool uclock_std_tsc_init(struct uclock_std *std)
+{
+    if (!uclock_std_tsc_check())
+        return false;
+
+    uint64_t sys0 = uclock_std_now_inner(&std->uclock, 0);
+    uint64_t tsc0 = __rdtsc();
+    uint64_t sys, tsc;
+    do {
+        sys = uclock_std_now_inner(&std->uclock, 0);
+        tsc = __rdtsc();
+    } while (sys - sys0 < UCLOCK_STD_TSC_CALIBRATION);
+    if (unlikely(tsc <= tsc0))
+        return false;
+
+    uatomic_init(&std->tsc_seq, 0);
+    std->tsc_origin = tsc0;
+    std->tsc_origin_now = sys0;
+    std->tsc_ref = tsc;
+    std->tsc_ref_now = sys;
+    std->tsc_mult = ((unsigned __int128)(sys - sys0) << 32) / (tsc - tsc0);
+    std->tsc_period = (tsc - tsc0) * UCLOCK_STD_TSC_PERIOD;
+    return true;
+}
+#endif
+
 /** @This returns the current system time.
  *
  * @param uclock utility structure passed to the module
@@ -97,6 +242,10 @@ static uint64_t uclock_std_now_inner(struct uclock *uclock,
 static uint64_t uclock_std_now(struct uclock *uclock)
 {
     struct uclock_std *std = uclock_std_from_uclock(uclock);
+#ifdef UCLOCK_STD_TSC
+    if (std->flags & UCLOCK_FLAG_TSC)
+        return uclock_std_tsc_now(std);
+#endif
     return uclock_std_now_inner(uclock, std->flags);
 }
 
@@ -148,6 +297,10 @@ static void uclock_std_free(struct urefcount *urefcount)
     struct uclock_std *uclock_std = uclock_std_from_urefcount(urefcount);
 #ifdef __MACH__
     mach_port_deallocate(mach_task_self(), uclock_std->cclock);
+#endif
+#ifdef UCLOCK_STD_TSC
+    if (uclock_std->flags & UCLOCK_FLAG_TSC)
+        uatomic_clean(&uclock_std->tsc_seq);
 #endif
     urefcount_clean(urefcount);
     free(uclock_std);
@@ -188,6 +341,13 @@ struct uclock *uclock_std_alloc(enum uclock_std_flags flags)
     uclock_std->uclock.uclock_from_real = uclock_std_from_real;
 #ifdef __MACH__
     memcpy(&uclock_std->cclock, &cclock, sizeof(cclock));
+#endif
+#ifdef UCLOCK_STD_TSC
+    if ((flags & UCLOCK_FLAG_TSC) && ((flags & UCLOCK_FLAG_REALTIME) ||
+                                      !uclock_std_tsc_init(uclock_std)))
+        uclock_std->flags &= ~UCLOCK_FLAG_TSC;
+#else
+    uclock_std->flags &= ~UCLOCK_FLAG_TSC;
 #endif
     return uclock_std_to_uclock(uclock_std);
 }
@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short Upipe run-time selection of SIMD kernels
+ */
+
+#include <upipe/ubase.h>
+#include <upipe/ucpu.h>
+
+#include <stdbool.h>
+
+/** extensions supported by the CPU, valid once ucpu_detected is set */
+static uint32_t ucpu_detected_flags = 0;
+/** true once the extensions have been detected */
+static bool ucpu_detected = false;
+/** extensions allowed by ucpu_set_mask */
+static uint32_t ucpu_mask = UCPU_ALL;
+
+/** @internal @This detects the extensions supported by the CPU.
+ *
+ * @return a combination of ucpu_flag
+ */
+static uint32_t ucpu_detect(void)
+{
+    uint32_t flags = 0;
+#if defined(__i386__) || defined(__x86_64__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sse2"))
+        flags |= UCPU_SSE2;
+    if (__builtin_cpu_supports("ssse3"))
+        flags |= UCPU_SSSE3;
+    if (__builtin_cpu_supports("sse4.1"))
+        flags |= UCPU_SSE41;
+    if (__builtin_cpu_supports("avx"))
+        flags |= UCPU_AVX;
+    if (__builtin_cpu_supports("avx2"))
+        flags |= UCPU_AVX2;
+    if (__builtin_cpu_supports("avx512bw") &&
+        __builtin_cpu_supports("avx512vl"))
+        flags |= UCPU_AVX512;
+    if (__builtin_cpu_supports("pclmul"))
+        flags |= UCPU_PCLMUL;
+    if (__builtin_cpu_supports("aes"))
+        flags |= UCPU_AES;
+#endif
+#if defined(__aarch64__) && !defined(__AARCH64EB__)
+    flags |= UCPU_NEON;
+#endif
+    return flags;
+}
+
+/** @This returns the instruction set extensions supported by the CPU,
+ * restricted by the mask set with @ref ucpu_set_mask.
+ *
+ * @return a combination of @ref ucpu_flag
+ */
+uint32_t ucpu_flags(void)
+{
+    if (unlikely(!__atomic_load_n(&ucpu_detected, __ATOMIC_ACQUIRE))) {
+        /* concurrent callers compute the same value */
+        __atomic_store_n(&ucpu_detected_flags, ucpu_detect(),
+                         __ATOMIC_RELAXED);
+        __atomic_store_n(&ucpu_detected, true, __ATOMIC_RELEASE);
+    }
+    return __atomic_load_n(&ucpu_detected_flags, __ATOMIC_RELAXED) &
+           __atomic_load_n(&ucpu_mask, __ATOMIC_RELAXED);
+}
+
+/** @This restricts the instruction set extensions returned by
+ * @ref ucpu_flags.
+ *
+ * @param mask combination of @ref ucpu_flag to allow, or @ref UCPU_ALL
+ */
+void ucpu_set_mask(uint32_t mask)
+{
+    __atomic_store_n(&ucpu_mask, mask, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,68 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short Upipe generation numbers of udicts
+ */
+
+#include <upipe/ubase.h>
+#include <upipe/uatomic.h>
+#include <upipe/udict.h>
+
+#include <stdint.h>
+#include <pthread.h>
+
+/** number of generations reserved at once by a thread */
+#define UDICT_GEN_BATCH 4096
+
+/** next batch of generations, shared by all threads */
+static uatomic_uint64_t udict_gen_next;
+/** protects the initialization of the above */
+static pthread_once_t udict_gen_once = PTHREAD_ONCE_INIT;
+
+/** @internal @This initializes the shared counter of generations.
+ */
+static void udict_gen_init(void)
+{
+    uatomic_uint64_init(&udict_gen_next, 1);
+}
+
+/** @This returns a new generation number, different from all the previous
+ * ones in the process. Generations are reserved by batches so that threads
+ * do not contend on the shared counter.
+ *
+ * @return generation number, never 0
+ */
+uint64_t udict_gen_alloc(void)
+{
+    static __thread uint64_t gen = 0;
+    static __thread uint64_t gen_end = 0;
+    if (unlikely(gen == gen_end)) {
+        pthread_once(&udict_gen_once, udict_gen_init);
+        gen = uatomic_uint64_fetch_add(&udict_gen_next, UDICT_GEN_BATCH);
+        gen_end = gen + UDICT_GEN_BATCH;
+    }
+    return gen++;
+}
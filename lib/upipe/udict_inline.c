@@ -28,25 +28,35 @@
  * This manager stores all attributes inline inside a single umem block.
  * This is designed in order to minimize calls to memory allocators, and
  * to transmit dictionaries over streams.
+ *
+ * Duplicated udicts share the same block, which is only copied on the first
+ * modification of one of them (copy-on-write).
  */
 
 #include <upipe/ubase.h>
 #include <upipe/urefcount.h>
+#include <upipe/uatomic.h>
 #include <upipe/upool.h>
 #include <upipe/umem.h>
 #include <upipe/udict.h>
 #include <upipe/udict_inline.h>
 
 #include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
 #include <inttypes.h>
 #include <assert.h>
 
-/** define to activate statistics */
-#undef STATS
 /** default minimal size of the dictionary */
 #define UDICT_MIN_SIZE 128
 /** default extra space added on udict expansion */
 #define UDICT_EXTRA_SIZE 64
+/** define to deactivate the lookup index */
+#undef UDICT_NO_INDEX
+/** number of buckets of the index of named attributes (power of 2) */
+#define UDICT_INDEX_BUCKETS 32
+/** maximum number of named attributes in the index */
+#define UDICT_INDEX_MAX_NAMED (UDICT_INDEX_BUCKETS * 3 / 4)
 
 /** @internal @This represents a shorthand attribute type. */
 struct inline_shorthand {
@@ -71,6 +81,7 @@ static const struct inline_shorthand inline_shorthands[] = {
 
     { "e.events", UDICT_TYPE_UNSIGNED },
 
+    /* unused, kept to match UDICT_TYPE_CLOCK_DURATION */
     { "k.duration", UDICT_TYPE_UNSIGNED },
     { "k.rate", UDICT_TYPE_RATIONAL },
     { "k.latency", UDICT_TYPE_UNSIGNED },
@@ -105,6 +116,32 @@ static const struct inline_shorthand inline_shorthands[] = {
     { "p.cea_708", UDICT_TYPE_OPAQUE }
 };
 
+/** number of shorthand attributes */
+#define UDICT_INLINE_SHORTHANDS \
+    (sizeof(inline_shorthands) / sizeof(struct inline_shorthand))
+
+/** number of counters in struct udict_stats */
+#define UDICT_INLINE_COUNTERS (sizeof(struct udict_stats) / sizeof(uint64_t))
+
+/** @This stores the counters of the manager, in the same order as
+ * struct udict_stats. */
+struct udict_inline_counters {
+    /** number of lookups of attributes, indexed by base type */
+    uatomic_uint64_t lookups[UDICT_TYPE_SHORTHAND];
+    /** number of lookups of shorthand attributes */
+    uatomic_uint64_t shorthand_lookups;
+    /** number of lookups of missing attributes */
+    uatomic_uint64_t misses;
+    /** number of udicts allocated */
+    uatomic_uint64_t allocs;
+    /** number of udicts released */
+    uatomic_uint64_t frees;
+    /** sum of the sizes of the attributes of the released udicts */
+    uatomic_uint64_t total_size;
+    /** number of times the attributes space had to be expanded */
+    uatomic_uint64_t reallocs;
+};
+
 /** @This stores the size of the value of basic attribute types. */
 static const size_t attr_sizes[] = { 0, 0, 0, 0, 1, 1, 1, 8, 8, 16, 8 };
 
@@ -123,9 +160,12 @@ struct udict_inline_mgr {
     /** umem allocator */
     struct umem_mgr *umem_mgr;
 
-#ifdef STATS
-    uint64_t stats[sizeof(inline_shorthands) / sizeof(struct inline_shorthand)];
-#endif
+    /** true if the counters below are updated */
+    uatomic_uint32_t stats;
+    /** counters */
+    struct udict_inline_counters counters;
+    /** number of lookups of each shorthand attribute */
+    uatomic_uint64_t shorthand_lookups[UDICT_INLINE_SHORTHANDS];
 
     /** common management structure */
     struct udict_mgr mgr;
@@ -142,12 +182,151 @@ struct udict_inline {
     /** used size */
     size_t size;
 
+#ifndef UDICT_NO_INDEX
+    /** true if the lookup index below reflects the buffer */
+    bool indexed;
+    /** true if there were too many named attributes to index them all */
+    bool named_overflow;
+    /** number of named attributes in the index */
+    uint8_t named_count;
+    /** offset + 1 of each shorthand attribute, or 0 if absent */
+    uint16_t shorthands[UDICT_INLINE_SHORTHANDS];
+    /** open-addressed table of offset + 1 of named attributes, 0 if empty */
+    uint16_t named[UDICT_INDEX_BUCKETS];
+#endif
+
     /** common structure */
     struct udict udict;
 };
 
 UBASE_FROM_TO(udict_inline, udict, udict, udict)
 
+/** @This is the header of a umem block, shared by all udicts duplicated
+ * from the same udict. */
+struct udict_inline_shared {
+    /** number of udicts pointing to the block */
+    uatomic_uint32_t refcount;
+};
+
+/** size of the header at the beginning of the umem block */
+#define UDICT_INLINE_HEADER_SIZE                                            \
+    ((sizeof(struct udict_inline_shared) + 7) & ~(size_t)7)
+
+/** @internal @This returns the header of the umem block of a udict.
+ *
+ * @param inl pointer to the udict_inline
+ * @return pointer to the shared header
+ */
+static inline struct udict_inline_shared *
+    udict_inline_shared(struct udict_inline *inl)
+{
+    return (struct udict_inline_shared *)umem_buffer(&inl->umem);
+}
+
+/** @internal @This returns the attributes of a udict.
+ *
+ * @param inl pointer to the udict_inline
+ * @return pointer to the first attribute
+ */
+static inline uint8_t *udict_inline_buffer(struct udict_inline *inl)
+{
+    return umem_buffer(&inl->umem) + UDICT_INLINE_HEADER_SIZE;
+}
+
+/** @internal @This returns the space available for attributes in a udict.
+ *
+ * @param inl pointer to the udict_inline
+ * @return size of the attributes space
+ */
+static inline size_t udict_inline_capacity(struct udict_inline *inl)
+{
+    return umem_size(&inl->umem) - UDICT_INLINE_HEADER_SIZE;
+}
+
+/** @internal @This returns true if the statistics of the manager are
+ * enabled.
+ *
+ * @param inline_mgr pointer to the udict manager
+ * @return true if the counters must be updated
+ */
+static inline bool udict_inline_stats(struct udict_inline_mgr *inline_mgr)
+{
+    return unlikely(uatomic_load_relaxed(&inline_mgr->stats));
+}
+
+/** @internal @This increments a counter of the manager.
+ *
+ * @param counter pointer to the counter
+ * @param value value to add
+ */
+static inline void udict_inline_stats_add(uatomic_uint64_t *counter,
+                                          uint64_t value)
+{
+    uatomic_uint64_fetch_add(counter, value);
+}
+
+/** @internal @This allocates a new umem block for a udict.
+ *
+ * @param inline_mgr pointer to the udict manager
+ * @param umem umem structure to initialize
+ * @param size size of the attributes space
+ * @return false in case of allocation error
+ */
+static bool udict_inline_umem_alloc(struct udict_inline_mgr *inline_mgr,
+                                    struct umem *umem, size_t size)
+{
+    if (unlikely(!umem_alloc(inline_mgr->umem_mgr, umem,
+                             size + UDICT_INLINE_HEADER_SIZE)))
+        return false;
+    struct udict_inline_shared *shared =
+        (struct udict_inline_shared *)umem_buffer(umem);
+    uatomic_init(&shared->refcount, 1);
+    return true;
+}
+
+/** @internal @This releases a umem block, and frees it if it is not shared
+ * anymore.
+ *
+ * @param umem umem structure pointing to the block
+ */
+static void udict_inline_umem_release(struct umem *umem)
+{
+    struct udict_inline_shared *shared =
+        (struct udict_inline_shared *)umem_buffer(umem);
+    if (uatomic_load(&shared->refcount) == 1 ||
+        uatomic_fetch_sub(&shared->refcount, 1) == 1) {
+        uatomic_clean(&shared->refcount);
+        umem_free(umem);
+    }
+}
+
+/** @internal @This makes sure the umem block of a udict is not shared, so
+ * that it can be modified.
+ *
+ * @param udict pointer to the udict
+ * @return an error code
+ */
+static int udict_inline_unshare(struct udict *udict)
+{
+    struct udict_inline *inl = udict_inline_from_udict(udict);
+    if (likely(uatomic_load(&udict_inline_shared(inl)->refcount) == 1))
+        return UBASE_ERR_NONE;
+
+    struct udict_inline_mgr *inline_mgr =
+        udict_inline_mgr_from_udict_mgr(udict->mgr);
+    struct umem umem = inl->umem;
+    if (unlikely(!udict_inline_umem_alloc(inline_mgr, &inl->umem,
+                    umem_size(&umem) - UDICT_INLINE_HEADER_SIZE))) {
+        inl->umem = umem;
+        return UBASE_ERR_ALLOC;
+    }
+    /* the layout is unchanged, and so is the lookup index */
+    memcpy(udict_inline_buffer(inl), umem_buffer(&umem) +
+           UDICT_INLINE_HEADER_SIZE, inl->size);
+    udict_inline_umem_release(&umem);
+    return UBASE_ERR_NONE;
+}
+
 /** @This allocates a udict with attributes space.
  *
  * @param mgr common management structure
@@ -159,23 +338,31 @@ static struct udict *udict_inline_alloc(struct udict_mgr *mgr, size_t size)
     struct udict_inline_mgr *inline_mgr = udict_inline_mgr_from_udict_mgr(mgr);
     struct udict_inline *inl = upool_alloc(&inline_mgr->udict_pool,
                                            struct udict_inline *);
+    if (unlikely(inl == NULL))
+        return NULL;
     struct udict *udict = udict_inline_to_udict(inl);
 
     if (size < inline_mgr->min_size)
         size = inline_mgr->min_size;
-    if (unlikely(!umem_alloc(inline_mgr->umem_mgr, &inl->umem, size))) {
+    if (unlikely(!udict_inline_umem_alloc(inline_mgr, &inl->umem, size))) {
         upool_free(&inline_mgr->udict_pool, inl);
         return NULL;
     }
 
-    uint8_t *buffer = umem_buffer(&inl->umem);
+    uint8_t *buffer = udict_inline_buffer(inl);
     buffer[0] = UDICT_TYPE_END;
     inl->size = 1;
+#ifndef UDICT_NO_INDEX
+    inl->indexed = false;
+#endif
 
+    if (udict_inline_stats(inline_mgr))
+        udict_inline_stats_add(&inline_mgr->counters.allocs, 1);
     return udict;
 }
 
-/** @This duplicates a given udict.
+/** @This duplicates a given udict. The umem block is shared until one of
+ * the udicts is modified.
  *
  * @param udict pointer to udict
  * @param new_udict_p reference written with a pointer to the newly allocated
@@ -185,16 +372,31 @@ static struct udict *udict_inline_alloc(struct udict_mgr *mgr, size_t size)
 static int udict_inline_dup(struct udict *udict, struct udict **new_udict_p)
 {
     assert(new_udict_p != NULL);
+    struct udict_inline_mgr *inline_mgr =
+        udict_inline_mgr_from_udict_mgr(udict->mgr);
     struct udict_inline *inl = udict_inline_from_udict(udict);
-    struct udict *new_udict = udict_inline_alloc(udict->mgr, inl->size);
-    if (unlikely(new_udict == NULL))
+    struct udict_inline *new_inl = upool_alloc(&inline_mgr->udict_pool,
+                                               struct udict_inline *);
+    if (unlikely(new_inl == NULL))
         return UBASE_ERR_ALLOC;
 
-    *new_udict_p = new_udict;
-
-    struct udict_inline *new_inl = udict_inline_from_udict(new_udict);
-    memcpy(umem_buffer(&new_inl->umem), umem_buffer(&inl->umem), inl->size);
+    uatomic_fetch_add(&udict_inline_shared(inl)->refcount, 1);
+    new_inl->umem = inl->umem;
     new_inl->size = inl->size;
+#ifndef UDICT_NO_INDEX
+    new_inl->indexed = inl->indexed;
+    if (inl->indexed) {
+        new_inl->named_overflow = inl->named_overflow;
+        new_inl->named_count = inl->named_count;
+        memcpy(new_inl->shorthands, inl->shorthands,
+               sizeof(inl->shorthands));
+        memcpy(new_inl->named, inl->named, sizeof(inl->named));
+    }
+#endif
+
+    if (udict_inline_stats(inline_mgr))
+        udict_inline_stats_add(&inline_mgr->counters.allocs, 1);
+    *new_udict_p = udict_inline_to_udict(new_inl);
     return UBASE_ERR_NONE;
 }
 
@@ -206,7 +408,7 @@ static int udict_inline_dup(struct udict *udict, struct udict **new_udict_p)
 static const struct inline_shorthand *
     udict_inline_shorthand(enum udict_type type)
 {
-    if (unlikely(type > UDICT_TYPE_SHORTHAND + 1 + sizeof(inline_shorthands) /
+    if (unlikely(type >= UDICT_TYPE_SHORTHAND + 1 + sizeof(inline_shorthands) /
                                                sizeof(struct inline_shorthand)))
         return NULL;
     return &inline_shorthands[type - UDICT_TYPE_SHORTHAND - 1];
@@ -236,26 +438,87 @@ static uint8_t *udict_inline_next(uint8_t *attr)
     return attr + 3 + size;
 }
 
+#ifndef UDICT_NO_INDEX
+/** @internal @This hashes the name of a named attribute.
+ *
+ * @param name name of the attribute
+ * @return bucket of the index where to start probing
+ */
+static inline unsigned int udict_inline_hash(const char *name)
+{
+    /* FNV-1a */
+    uint32_t hash = 2166136261U;
+    while (*name)
+        hash = (hash ^ (uint8_t)*name++) * 16777619U;
+    return (hash ^ (hash >> 16)) & (UDICT_INDEX_BUCKETS - 1);
+}
+
+/** @internal @This adds an attribute to the lookup index.
+ *
+ * @param inl pointer to the udict_inline
+ * @param attr pointer to the attribute inside the buffer
+ */
+static void udict_inline_index_add(struct udict_inline *inl, uint8_t *attr)
+{
+    size_t offset = attr - udict_inline_buffer(inl);
+    if (unlikely(offset >= UINT16_MAX)) {
+        inl->indexed = false;
+        return;
+    }
+
+    if (*attr > UDICT_TYPE_SHORTHAND) {
+        unsigned int i = *attr - UDICT_TYPE_SHORTHAND - 1;
+        if (likely(i < UDICT_INLINE_SHORTHANDS) && !inl->shorthands[i])
+            inl->shorthands[i] = offset + 1;
+        return;
+    }
+
+    if (unlikely(inl->named_count >= UDICT_INDEX_MAX_NAMED)) {
+        inl->named_overflow = true;
+        return;
+    }
+    unsigned int i = udict_inline_hash((const char *)(attr + 3));
+    while (inl->named[i])
+        i = (i + 1) & (UDICT_INDEX_BUCKETS - 1);
+    inl->named[i] = offset + 1;
+    inl->named_count++;
+}
+
+/** @internal @This builds the lookup index by walking the buffer once.
+ *
+ * @param inl pointer to the udict_inline
+ */
+static void udict_inline_index_build(struct udict_inline *inl)
+{
+    memset(inl->shorthands, 0, sizeof(inl->shorthands));
+    memset(inl->named, 0, sizeof(inl->named));
+    inl->named_count = 0;
+    inl->named_overflow = false;
+    inl->indexed = inl->size < UINT16_MAX;
+    if (unlikely(!inl->indexed))
+        return;
+
+    uint8_t *attr = udict_inline_buffer(inl);
+    while (attr != NULL && *attr != UDICT_TYPE_END) {
+        udict_inline_index_add(inl, attr);
+        attr = udict_inline_next(attr);
+    }
+}
+#endif
+
 /** @internal @This finds an attribute (shorthand or not) of the given name
- * and type and returns a pointer to its beginning.
+ * and type and returns a pointer to its beginning, by walking the buffer.
  *
  * @param udict pointer to the udict
  * @param name name of the attribute
  * @param type type of the attribute (excluding inline_shorthands)
  * @return pointer to the attribute, or NULL
  */
-static uint8_t *udict_inline_find(struct udict *udict, const char *name,
+static uint8_t *udict_inline_walk(struct udict *udict, const char *name,
                                   enum udict_type type)
 {
     struct udict_inline *inl = udict_inline_from_udict(udict);
-#ifdef STATS
-    if (type > UDICT_TYPE_SHORTHAND) {
-        struct udict_inline_mgr *inline_mgr =
-            udict_inline_mgr_from_udict_mgr(udict->mgr);
-        inline_mgr->stats[type - UDICT_TYPE_SHORTHAND - 1]++;
-    }
-#endif
-    uint8_t *attr = umem_buffer(&inl->umem);
+    uint8_t *attr = udict_inline_buffer(inl);
     while (attr != NULL) {
         if (*attr == type &&
              (type > UDICT_TYPE_SHORTHAND || type == UDICT_TYPE_END ||
@@ -266,6 +529,54 @@ static uint8_t *udict_inline_find(struct udict *udict, const char *name,
     return NULL;
 }
 
+/** @internal @This finds an attribute (shorthand or not) of the given name
+ * and type and returns a pointer to its beginning.
+ *
+ * The lookup index is built on the first call following a modification of
+ * the layout of the buffer, so that subsequent lookups do not walk it.
+ *
+ * @param udict pointer to the udict
+ * @param name name of the attribute
+ * @param type type of the attribute (excluding inline_shorthands)
+ * @return pointer to the attribute, or NULL
+ */
+static uint8_t *udict_inline_find(struct udict *udict, const char *name,
+                                  enum udict_type type)
+{
+    struct udict_inline *inl = udict_inline_from_udict(udict);
+    if (unlikely(type == UDICT_TYPE_END))
+        return udict_inline_buffer(inl) + inl->size - 1;
+
+#ifndef UDICT_NO_INDEX
+    if (unlikely(!inl->indexed)) {
+        udict_inline_index_build(inl);
+        if (unlikely(!inl->indexed))
+            return udict_inline_walk(udict, name, type);
+    }
+
+    uint8_t *buffer = udict_inline_buffer(inl);
+    if (type > UDICT_TYPE_SHORTHAND) {
+        unsigned int i = type - UDICT_TYPE_SHORTHAND - 1;
+        if (unlikely(i >= UDICT_INLINE_SHORTHANDS || !inl->shorthands[i]))
+            return NULL;
+        return buffer + inl->shorthands[i] - 1;
+    }
+
+    unsigned int i = udict_inline_hash(name);
+    while (inl->named[i]) {
+        uint8_t *attr = buffer + inl->named[i] - 1;
+        if (*attr == type && !strcmp((const char *)(attr + 3), name))
+            return attr;
+        i = (i + 1) & (UDICT_INDEX_BUCKETS - 1);
+    }
+    if (unlikely(inl->named_overflow))
+        return udict_inline_walk(udict, name, type);
+    return NULL;
+#else
+    return udict_inline_walk(udict, name, type);
+#endif
+}
+
 /** @internal @This finds an attribute (shorthand or not) of the given name
  * and type and returns the name and type of the next attribute.
  *
@@ -288,7 +599,7 @@ static void udict_inline_iterate(struct udict *udict, const char **name_p,
         if (likely(attr != NULL))
             attr = udict_inline_next(attr);
     } else
-        attr = umem_buffer(&inl->umem);
+        attr = udict_inline_buffer(inl);
     if (unlikely(attr == NULL || *attr == UDICT_TYPE_END)) {
         *type_p = UDICT_TYPE_END;
         return;
@@ -342,6 +653,33 @@ static uint8_t *_udict_inline_get(struct udict *udict, const char *name,
     return attr;
 }
 
+/** @internal @This accounts a lookup in the counters of the manager.
+ *
+ * @param inline_mgr pointer to the udict manager
+ * @param type type of the attribute
+ * @param found true if the attribute was found
+ */
+static void udict_inline_stats_get(struct udict_inline_mgr *inline_mgr,
+                                   enum udict_type type, bool found)
+{
+    enum udict_type base_type = type;
+    if (type > UDICT_TYPE_SHORTHAND) {
+        const struct inline_shorthand *shorthand =
+            udict_inline_shorthand(type);
+        if (unlikely(shorthand == NULL))
+            return;
+        base_type = shorthand->base_type;
+        udict_inline_stats_add(&inline_mgr->counters.shorthand_lookups, 1);
+        udict_inline_stats_add(
+            &inline_mgr->shorthand_lookups[type - UDICT_TYPE_SHORTHAND - 1],
+            1);
+    }
+    if (likely(base_type < UDICT_TYPE_SHORTHAND))
+        udict_inline_stats_add(&inline_mgr->counters.lookups[base_type], 1);
+    if (!found)
+        udict_inline_stats_add(&inline_mgr->counters.misses, 1);
+}
+
 /** @internal @This finds an attribute (shorthand or not) of the given name
  * and type and returns a pointer to the beginning of its value (const version).
  *
@@ -358,6 +696,10 @@ static int udict_inline_get(struct udict *udict, const char *name,
                             const uint8_t **attr_p)
 {
     uint8_t *attr = _udict_inline_get(udict, name, type, size_p);
+    struct udict_inline_mgr *inline_mgr =
+        udict_inline_mgr_from_udict_mgr(udict->mgr);
+    if (udict_inline_stats(inline_mgr))
+        udict_inline_stats_get(inline_mgr, type, attr != NULL);
     if (unlikely(attr == NULL))
         return UBASE_ERR_INVALID;
     if (attr_p != NULL)
@@ -377,13 +719,17 @@ static int udict_inline_delete(struct udict *udict, const char *name,
 {
     assert(type != UDICT_TYPE_END);
     struct udict_inline *inl = udict_inline_from_udict(udict);
+    UBASE_RETURN(udict_inline_unshare(udict))
     uint8_t *attr = udict_inline_find(udict, name, type);
     if (unlikely(attr == NULL))
         return UBASE_ERR_INVALID;
 
     uint8_t *end = udict_inline_next(attr);
-    memmove(attr, end, umem_buffer(&inl->umem) + inl->size - end);
+    memmove(attr, end, udict_inline_buffer(inl) + inl->size - end);
     inl->size -= end - attr;
+#ifndef UDICT_NO_INDEX
+    inl->indexed = false;
+#endif
     return UBASE_ERR_NONE;
 }
 
@@ -409,6 +755,7 @@ static int udict_inline_set(struct udict *udict, const char *name,
             return UBASE_ERR_INVALID;
         base_type = shorthand->base_type;
     }
+    UBASE_RETURN(udict_inline_unshare(udict))
 
     /* check if it already exists */
     size_t current_size;
@@ -444,21 +791,26 @@ static int udict_inline_set(struct udict *udict, const char *name,
     }
 
     /* check total attributes size */
-    attr = umem_buffer(&inl->umem) + inl->size - 1;
-    size_t total_size = (attr - umem_buffer(&inl->umem)) + header_size +
+    attr = udict_inline_buffer(inl) + inl->size - 1;
+    size_t total_size = (attr - udict_inline_buffer(inl)) + header_size +
                         attr_size + 1;
-    if (unlikely(total_size >= umem_size(&inl->umem))) {
+    if (unlikely(total_size >= udict_inline_capacity(inl))) {
         struct udict_inline_mgr *inline_mgr =
             udict_inline_mgr_from_udict_mgr(udict->mgr);
-        if (unlikely(!umem_realloc(&inl->umem, total_size +
-                                               inline_mgr->extra_size)))
+        if (unlikely(!umem_realloc(&inl->umem, UDICT_INLINE_HEADER_SIZE +
+                                   total_size + inline_mgr->extra_size)))
             return UBASE_ERR_ALLOC;
+        if (udict_inline_stats(inline_mgr))
+            udict_inline_stats_add(&inline_mgr->counters.reallocs, 1);
 
-        attr = umem_buffer(&inl->umem) + inl->size - 1;
+        attr = udict_inline_buffer(inl) + inl->size - 1;
     }
     assert(*attr == UDICT_TYPE_END);
 
     /* write attribute header */
+#ifndef UDICT_NO_INDEX
+    uint8_t *header = attr;
+#endif
     if (unlikely(shorthand == NULL)) {
         assert(namelen + 1 + attr_size <= UINT16_MAX);
         uint16_t size = namelen + 1 + attr_size;
@@ -481,6 +833,10 @@ static int udict_inline_set(struct udict *udict, const char *name,
     if (attr_p != NULL)
         *attr_p = attr;
     inl->size += header_size + attr_size;
+#ifndef UDICT_NO_INDEX
+    if (likely(inl->indexed))
+        udict_inline_index_add(inl, header);
+#endif
     return UBASE_ERR_NONE;
 }
 
@@ -566,7 +922,11 @@ static void udict_inline_free(struct udict *udict)
         udict_inline_mgr_from_udict_mgr(udict->mgr);
     struct udict_inline *inl = udict_inline_from_udict(udict);
 
-    umem_free(&inl->umem);
+    if (udict_inline_stats(inline_mgr)) {
+        udict_inline_stats_add(&inline_mgr->counters.frees, 1);
+        udict_inline_stats_add(&inline_mgr->counters.total_size, inl->size);
+    }
+    udict_inline_umem_release(&inl->umem);
     upool_free(&inline_mgr->udict_pool, inl);
 }
 
@@ -608,6 +968,67 @@ static void udict_inline_mgr_vacuum(struct udict_mgr *mgr)
     upool_vacuum(&inline_mgr->udict_pool);
 }
 
+/** @internal @This enables or disables the statistics of a udict manager,
+ * and resets them.
+ *
+ * @param mgr pointer to udict manager
+ * @param enabled true to update the counters
+ */
+static void udict_inline_mgr_set_stats(struct udict_mgr *mgr, bool enabled)
+{
+    struct udict_inline_mgr *inline_mgr = udict_inline_mgr_from_udict_mgr(mgr);
+    if (enabled) {
+        uatomic_uint64_t *counters = (uatomic_uint64_t *)&inline_mgr->counters;
+        for (unsigned int i = 0; i < UDICT_INLINE_COUNTERS; i++)
+            uatomic_uint64_store(&counters[i], 0);
+        for (unsigned int i = 0; i < UDICT_INLINE_SHORTHANDS; i++)
+            uatomic_uint64_store(&inline_mgr->shorthand_lookups[i], 0);
+    }
+    uatomic_store(&inline_mgr->stats, enabled);
+    upool_set_stats(&inline_mgr->udict_pool, enabled);
+}
+
+/** @internal @This reads the statistics of a udict manager.
+ *
+ * @param mgr pointer to udict manager
+ * @param stats filled in with the counters of the manager (may be NULL)
+ * @param pool_stats filled in with the counters of the pool (may be NULL)
+ */
+static void udict_inline_mgr_get_stats(struct udict_mgr *mgr,
+                                       struct udict_stats *stats,
+                                       struct upool_stats *pool_stats)
+{
+    struct udict_inline_mgr *inline_mgr = udict_inline_mgr_from_udict_mgr(mgr);
+    if (stats != NULL) {
+        uatomic_uint64_t *counters = (uatomic_uint64_t *)&inline_mgr->counters;
+        uint64_t *copy = (uint64_t *)stats;
+        for (unsigned int i = 0; i < UDICT_INLINE_COUNTERS; i++)
+            copy[i] = uatomic_uint64_load(&counters[i]);
+    }
+    if (pool_stats != NULL)
+        upool_get_stats(&inline_mgr->udict_pool, pool_stats);
+}
+
+/** @internal @This returns the number of lookups of a shorthand attribute.
+ *
+ * @param mgr pointer to udict manager
+ * @param type shorthand type
+ * @param lookups_p filled in with the number of lookups
+ * @return an error code
+ */
+static int _udict_inline_mgr_get_shorthand_stats(struct udict_mgr *mgr,
+                                                 enum udict_type type,
+                                                 uint64_t *lookups_p)
+{
+    struct udict_inline_mgr *inline_mgr = udict_inline_mgr_from_udict_mgr(mgr);
+    if (unlikely(type <= UDICT_TYPE_SHORTHAND ||
+                 type - UDICT_TYPE_SHORTHAND - 1 >= UDICT_INLINE_SHORTHANDS))
+        return UBASE_ERR_INVALID;
+    *lookups_p = uatomic_uint64_load(
+            &inline_mgr->shorthand_lookups[type - UDICT_TYPE_SHORTHAND - 1]);
+    return UBASE_ERR_NONE;
+}
+
 /** @This processes control commands on a udict_std_mgr.
  *
  * @param mgr pointer to a udict_mgr structure
@@ -622,6 +1043,31 @@ static int udict_inline_mgr_control(struct udict_mgr *mgr,
         case UDICT_MGR_VACUUM:
             udict_inline_mgr_vacuum(mgr);
             return UBASE_ERR_NONE;
+        case UDICT_MGR_PREFILL: {
+            struct udict_inline_mgr *inline_mgr =
+                udict_inline_mgr_from_udict_mgr(mgr);
+            unsigned int count = va_arg(args, unsigned int);
+            upool_prefill(&inline_mgr->udict_pool, count);
+            return UBASE_ERR_NONE;
+        }
+        case UDICT_MGR_SET_STATS: {
+            bool enabled = va_arg(args, int);
+            udict_inline_mgr_set_stats(mgr, enabled);
+            return UBASE_ERR_NONE;
+        }
+        case UDICT_MGR_GET_STATS: {
+            struct udict_stats *stats = va_arg(args, struct udict_stats *);
+            struct upool_stats *pool_stats =
+                va_arg(args, struct upool_stats *);
+            udict_inline_mgr_get_stats(mgr, stats, pool_stats);
+            return UBASE_ERR_NONE;
+        }
+        case UDICT_INLINE_MGR_GET_SHORTHAND_STATS: {
+            UBASE_SIGNATURE_CHECK(args, UDICT_INLINE_SIGNATURE)
+            enum udict_type type = va_arg(args, enum udict_type);
+            uint64_t *lookups_p = va_arg(args, uint64_t *);
+            return _udict_inline_mgr_get_shorthand_stats(mgr, type, lookups_p);
+        }
         default:
             return UBASE_ERR_UNHANDLED;
     }
@@ -635,20 +1081,16 @@ static void udict_inline_mgr_free(struct urefcount *urefcount)
 {
     struct udict_inline_mgr *inline_mgr =
         udict_inline_mgr_from_urefcount(urefcount);
-#ifdef STATS
-    int i;
-    for (i = 0; i < sizeof(inline_shorthands) / sizeof(struct inline_shorthand);
-         i++) {
-        const char *name;
-        enum udict_type base_type;
-        udict_inline_name(UDICT_TYPE_SHORTHAND + 1 + i, &name, &base_type);
-        printf("%s: %"PRIu64"\n", name, inline_mgr->stats[i]);
-    }
-#endif
-
     upool_clean(&inline_mgr->udict_pool);
     umem_mgr_release(inline_mgr->umem_mgr);
 
+    uatomic_uint64_t *counters = (uatomic_uint64_t *)&inline_mgr->counters;
+    for (unsigned int i = 0; i < UDICT_INLINE_COUNTERS; i++)
+        uatomic_uint64_clean(&counters[i]);
+    for (unsigned int i = 0; i < UDICT_INLINE_SHORTHANDS; i++)
+        uatomic_uint64_clean(&inline_mgr->shorthand_lookups[i]);
+    uatomic_clean(&inline_mgr->stats);
+
     urefcount_clean(urefcount);
     free(inline_mgr);
 }
@@ -691,12 +1133,12 @@ struct udict_mgr *udict_inline_mgr_alloc(unsigned int udict_pool_depth,
     inline_mgr->min_size = min_size > 0 ? min_size : UDICT_MIN_SIZE;
     inline_mgr->extra_size = extra_size > 0 ? extra_size : UDICT_EXTRA_SIZE;
 
-#ifdef STATS
-    int i;
-    for (i = 0; i < sizeof(inline_shorthands) / sizeof(struct inline_shorthand);
-         i++)
-        inline_mgr->stats[i] = 0;
-#endif
+    uatomic_init(&inline_mgr->stats, false);
+    uatomic_uint64_t *counters = (uatomic_uint64_t *)&inline_mgr->counters;
+    for (unsigned int i = 0; i < UDICT_INLINE_COUNTERS; i++)
+        uatomic_uint64_init(&counters[i], 0);
+    for (unsigned int i = 0; i < UDICT_INLINE_SHORTHANDS; i++)
+        uatomic_uint64_init(&inline_mgr->shorthand_lookups[i], 0);
 
     return udict_inline_mgr_to_udict_mgr(inline_mgr);
 }
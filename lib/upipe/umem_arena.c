@@ -0,0 +1,458 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short Upipe arena memory allocator
+ * This memory allocator carves small memory blocks one after the other out
+ * of larger chunks, and releases a chunk when all its blocks are freed.
+ */
+
+#include <upipe/ubase.h>
+#include <upipe/urefcount.h>
+#include <upipe/uatomic.h>
+#include <upipe/umem.h>
+#include <upipe/umem_arena.h>
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <assert.h>
+
+/** alignment of the blocks, and size of the header preceding them */
+#define UMEM_ARENA_ALIGN 16
+
+/** @This is the header of a chunk. */
+struct umem_arena_chunk {
+    /** number of blocks carved out of the chunk, plus one while the chunk
+     * is the current chunk of the manager */
+    uatomic_uint32_t refcount;
+    /** offset of the first free octet, only accessed with the lock */
+    size_t used;
+};
+
+/** size of the header at the beginning of a chunk */
+#define UMEM_ARENA_CHUNK_SIZE                                               \
+    ((sizeof(struct umem_arena_chunk) + UMEM_ARENA_ALIGN - 1) &             \
+     ~(size_t)(UMEM_ARENA_ALIGN - 1))
+
+/** @This is the header preceding each block. */
+struct umem_arena_header {
+    /** chunk the block was carved from, or NULL if it was allocated with
+     * malloc() */
+    struct umem_arena_chunk *chunk;
+};
+
+/** size of the header preceding each block */
+#define UMEM_ARENA_HEADER_SIZE                                              \
+    ((sizeof(struct umem_arena_header) + UMEM_ARENA_ALIGN - 1) &            \
+     ~(size_t)(UMEM_ARENA_ALIGN - 1))
+
+/** @internal @This returns the space for the blocks of a chunk.
+ *
+ * @param chunk pointer to the chunk
+ * @return pointer to the first octet of the space
+ */
+static inline uint8_t *umem_arena_chunk_buffer(struct umem_arena_chunk *chunk)
+{
+    return (uint8_t *)chunk + UMEM_ARENA_CHUNK_SIZE;
+}
+
+/** @This defines the private data structures of the umem arena manager. */
+struct umem_arena_mgr {
+    /** refcount management structure */
+    struct urefcount urefcount;
+
+    /** size of the space for blocks in a chunk */
+    size_t chunk_size;
+    /** largest block carved out of a chunk */
+    size_t max_size;
+
+    /** try-lock protecting the current chunk */
+    uatomic_uint32_t lock;
+    /** chunk blocks are currently carved out of, or NULL */
+    struct umem_arena_chunk *current;
+    /** released chunk kept for reuse, or NULL */
+    struct umem_arena_chunk *spare;
+
+    /** true if the counters are updated */
+    bool stats;
+    /** counters, updated with relaxed atomic operations */
+    struct umem_stats counters;
+
+    /** common management structure */
+    struct umem_mgr mgr;
+};
+
+UBASE_FROM_TO(umem_arena_mgr, umem_mgr, umem_mgr, mgr)
+UBASE_FROM_TO(umem_arena_mgr, urefcount, urefcount, urefcount)
+
+/** @internal @This returns the header of a block.
+ *
+ * @param umem pointer to umem
+ * @return pointer to the header
+ */
+static inline struct umem_arena_header *umem_arena_header(struct umem *umem)
+{
+    return (struct umem_arena_header *)(umem->buffer -
+                                        UMEM_ARENA_HEADER_SIZE);
+}
+
+/** @internal @This increments a counter of the manager if the statistics
+ * are enabled.
+ *
+ * @param arena_mgr pointer to the arena manager
+ * @param counter pointer to the counter
+ */
+static inline void umem_arena_stats_inc(struct umem_arena_mgr *arena_mgr,
+                                        uint64_t *counter)
+{
+    if (unlikely(__atomic_load_n(&arena_mgr->stats, __ATOMIC_RELAXED)))
+        __atomic_fetch_add(counter, 1, __ATOMIC_RELAXED);
+}
+
+/** @internal @This releases a reference to a chunk, and keeps it for reuse
+ * or frees it when no block points to it anymore.
+ *
+ * @param arena_mgr pointer to the arena manager
+ * @param chunk pointer to the chunk
+ */
+static void umem_arena_chunk_release(struct umem_arena_mgr *arena_mgr,
+                                     struct umem_arena_chunk *chunk)
+{
+    if (uatomic_fetch_sub(&chunk->refcount, 1) != 1)
+        return;
+
+    struct umem_arena_chunk *expected = NULL;
+    if (!__atomic_compare_exchange_n(&arena_mgr->spare, &expected, chunk,
+                                     false, __ATOMIC_RELEASE,
+                                     __ATOMIC_RELAXED)) {
+        uatomic_clean(&chunk->refcount);
+        free(chunk);
+    }
+}
+
+/** @internal @This replaces the current chunk of the manager, which must be
+ * locked.
+ *
+ * @param arena_mgr pointer to the arena manager
+ * @return pointer to the new current chunk, or NULL in case of allocation
+ * error
+ */
+static struct umem_arena_chunk *
+    umem_arena_chunk_renew(struct umem_arena_mgr *arena_mgr)
+{
+    struct umem_arena_chunk *chunk = arena_mgr->current;
+    arena_mgr->current = NULL;
+    if (chunk != NULL)
+        umem_arena_chunk_release(arena_mgr, chunk);
+
+    chunk = __atomic_exchange_n(&arena_mgr->spare, NULL, __ATOMIC_ACQUIRE);
+    if (chunk == NULL) {
+        chunk = malloc(UMEM_ARENA_CHUNK_SIZE + arena_mgr->chunk_size);
+        if (unlikely(chunk == NULL))
+            return NULL;
+        uatomic_init(&chunk->refcount, 1);
+    } else
+        uatomic_store(&chunk->refcount, 1);
+    chunk->used = 0;
+    arena_mgr->current = chunk;
+    return chunk;
+}
+
+/** @internal @This carves a block out of the current chunk.
+ *
+ * @param arena_mgr pointer to the arena manager
+ * @param size size of the block, header included, multiple of the alignment
+ * @return pointer to the header of the block, or NULL if the manager is
+ * busy or in case of allocation error
+ */
+static struct umem_arena_header *
+    umem_arena_carve(struct umem_arena_mgr *arena_mgr, size_t size)
+{
+    uint32_t expected = 0;
+    if (unlikely(!uatomic_compare_exchange(&arena_mgr->lock, &expected, 1)))
+        return NULL;
+
+    struct umem_arena_chunk *chunk = arena_mgr->current;
+    if (chunk == NULL || chunk->used + size > arena_mgr->chunk_size)
+        chunk = umem_arena_chunk_renew(arena_mgr);
+
+    struct umem_arena_header *header = NULL;
+    if (likely(chunk != NULL)) {
+        header = (struct umem_arena_header *)
+            (umem_arena_chunk_buffer(chunk) + chunk->used);
+        header->chunk = chunk;
+        chunk->used += size;
+        uatomic_fetch_add(&chunk->refcount, 1);
+    }
+    uatomic_store(&arena_mgr->lock, 0);
+    return header;
+}
+
+/** @This allocates a new umem buffer space.
+ *
+ * @param mgr management structure
+ * @param umem caller-allocated structure, filled in with the required pointer
+ * and size (previous content is discarded)
+ * @param size requested size of the umem
+ * @return false if the memory couldn't be allocated (umem left untouched)
+ */
+static bool umem_arena_alloc(struct umem_mgr *mgr, struct umem *umem,
+                             size_t size)
+{
+    struct umem_arena_mgr *arena_mgr = umem_arena_mgr_from_umem_mgr(mgr);
+    size_t real_size = (size + UMEM_ARENA_ALIGN - 1) &
+                       ~(size_t)(UMEM_ARENA_ALIGN - 1);
+    struct umem_arena_header *header = NULL;
+
+    umem_arena_stats_inc(arena_mgr, &arena_mgr->counters.allocs);
+    if (likely(size <= arena_mgr->max_size))
+        header = umem_arena_carve(arena_mgr,
+                                  real_size + UMEM_ARENA_HEADER_SIZE);
+    if (unlikely(header == NULL)) {
+        header = malloc(UMEM_ARENA_HEADER_SIZE + size);
+        if (unlikely(header == NULL))
+            return false;
+        header->chunk = NULL;
+        real_size = size;
+        umem_arena_stats_inc(arena_mgr, &arena_mgr->counters.fallbacks);
+    }
+
+    umem->buffer = (uint8_t *)header + UMEM_ARENA_HEADER_SIZE;
+    umem->size = size;
+    umem->real_size = real_size;
+    umem->mgr = mgr;
+    return true;
+}
+
+/** @This frees a umem.
+ *
+ * @param umem pointer to umem
+ */
+static void umem_arena_free(struct umem *umem)
+{
+    struct umem_arena_mgr *arena_mgr = umem_arena_mgr_from_umem_mgr(umem->mgr);
+    struct umem_arena_header *header = umem_arena_header(umem);
+    if (header->chunk != NULL)
+        umem_arena_chunk_release(arena_mgr, header->chunk);
+    else
+        free(header);
+    umem->buffer = NULL;
+    umem->mgr = NULL;
+}
+
+/** @internal @This tries to grow the last block of the current chunk in
+ * place.
+ *
+ * @param arena_mgr pointer to the arena manager
+ * @param umem pointer to umem
+ * @param real_size new reserved size of the block
+ * @return true if the block was grown
+ */
+static bool umem_arena_grow(struct umem_arena_mgr *arena_mgr,
+                            struct umem *umem, size_t real_size)
+{
+    uint32_t expected = 0;
+    if (unlikely(!uatomic_compare_exchange(&arena_mgr->lock, &expected, 1)))
+        return false;
+
+    struct umem_arena_chunk *chunk = umem_arena_header(umem)->chunk;
+    bool grown = false;
+    if (chunk == arena_mgr->current &&
+        umem->buffer + umem->real_size ==
+            umem_arena_chunk_buffer(chunk) + chunk->used &&
+        chunk->used - umem->real_size + real_size <= arena_mgr->chunk_size) {
+        chunk->used = chunk->used - umem->real_size + real_size;
+        grown = true;
+    }
+    uatomic_store(&arena_mgr->lock, 0);
+    return grown;
+}
+
+/** @This resizes a umem.
+ *
+ * @param umem caller-allocated structure, previously successfully passed to
+ * @ref umem_alloc, and filled in with the new pointer and size
+ * @param new_size new requested size of the umem
+ * @return false if the memory couldn't be allocated (umem left untouched)
+ */
+static bool umem_arena_realloc(struct umem *umem, size_t new_size)
+{
+    struct umem_arena_mgr *arena_mgr = umem_arena_mgr_from_umem_mgr(umem->mgr);
+    if (new_size <= umem->real_size) {
+        umem->size = new_size;
+        return true;
+    }
+
+    size_t real_size = (new_size + UMEM_ARENA_ALIGN - 1) &
+                       ~(size_t)(UMEM_ARENA_ALIGN - 1);
+    if (umem_arena_header(umem)->chunk != NULL &&
+        new_size <= arena_mgr->max_size &&
+        umem_arena_grow(arena_mgr, umem, real_size)) {
+        umem->size = new_size;
+        umem->real_size = real_size;
+        return true;
+    }
+
+    struct umem new_umem;
+    if (unlikely(!umem_arena_alloc(umem->mgr, &new_umem, new_size)))
+        return false;
+    memcpy(new_umem.buffer, umem->buffer, umem->size);
+    umem_arena_free(umem);
+    *umem = new_umem;
+    umem_arena_stats_inc(arena_mgr, &arena_mgr->counters.reallocs);
+    return true;
+}
+
+/** @internal @This releases the spare chunk of an arena manager.
+ *
+ * @param mgr pointer to a umem_mgr structure
+ */
+static void umem_arena_mgr_vacuum(struct umem_mgr *mgr)
+{
+    struct umem_arena_mgr *arena_mgr = umem_arena_mgr_from_umem_mgr(mgr);
+    struct umem_arena_chunk *chunk =
+        __atomic_exchange_n(&arena_mgr->spare, NULL, __ATOMIC_ACQUIRE);
+    if (chunk != NULL) {
+        uatomic_clean(&chunk->refcount);
+        free(chunk);
+    }
+}
+
+/** @internal @This enables or disables the counters of the manager.
+ *
+ * @param arena_mgr pointer to the arena manager
+ * @param enabled true to update the counters
+ */
+static void umem_arena_mgr_set_stats(struct umem_arena_mgr *arena_mgr,
+                                     bool enabled)
+{
+    if (enabled) {
+        __atomic_store_n(&arena_mgr->counters.allocs, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&arena_mgr->counters.reallocs, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&arena_mgr->counters.fallbacks, 0, __ATOMIC_RELAXED);
+    }
+    __atomic_store_n(&arena_mgr->stats, enabled, __ATOMIC_RELAXED);
+}
+
+/** @internal @This reads the counters of the manager.
+ *
+ * @param arena_mgr pointer to the arena manager
+ * @param stats filled in with the counters of the manager
+ */
+static void umem_arena_mgr_get_stats(struct umem_arena_mgr *arena_mgr,
+                                     struct umem_stats *stats)
+{
+    stats->allocs = __atomic_load_n(&arena_mgr->counters.allocs,
+                                    __ATOMIC_RELAXED);
+    stats->reallocs = __atomic_load_n(&arena_mgr->counters.reallocs,
+                                      __ATOMIC_RELAXED);
+    stats->fallbacks = __atomic_load_n(&arena_mgr->counters.fallbacks,
+                                       __ATOMIC_RELAXED);
+}
+
+/** @internal @This processes control commands on a umem arena manager.
+ *
+ * @param mgr pointer to a umem_mgr structure
+ * @param command type of command to process
+ * @param args arguments of the command
+ * @return an error code
+ */
+static int umem_arena_mgr_control(struct umem_mgr *mgr,
+                                  int command, va_list args)
+{
+    struct umem_arena_mgr *arena_mgr = umem_arena_mgr_from_umem_mgr(mgr);
+    switch (command) {
+        case UMEM_MGR_SET_STATS: {
+            bool enabled = va_arg(args, int);
+            umem_arena_mgr_set_stats(arena_mgr, enabled);
+            return UBASE_ERR_NONE;
+        }
+        case UMEM_MGR_GET_STATS: {
+            struct umem_stats *stats = va_arg(args, struct umem_stats *);
+            umem_arena_mgr_get_stats(arena_mgr, stats);
+            return UBASE_ERR_NONE;
+        }
+        default:
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** @This frees a umem manager.
+ *
+ * @param urefcount pointer to urefcount
+ */
+static void umem_arena_mgr_free(struct urefcount *urefcount)
+{
+    struct umem_arena_mgr *arena_mgr = umem_arena_mgr_from_urefcount(urefcount);
+    struct umem_arena_chunk *chunk = arena_mgr->current;
+    arena_mgr->current = NULL;
+    if (chunk != NULL)
+        umem_arena_chunk_release(arena_mgr, chunk);
+    umem_arena_mgr_vacuum(umem_arena_mgr_to_umem_mgr(arena_mgr));
+
+    uatomic_clean(&arena_mgr->lock);
+    urefcount_clean(urefcount);
+    free(arena_mgr);
+}
+
+/** @This allocates a new instance of the umem arena manager.
+ *
+ * @param chunk_size size (in octets) of the chunks allocated from the system
+ * @param max_size size (in octets) above which blocks are directly managed
+ * with malloc() and free(); it is lowered to a quarter of chunk_size if
+ * it is larger
+ * @return pointer to manager, or NULL in case of error
+ */
+struct umem_mgr *umem_arena_mgr_alloc(size_t chunk_size, size_t max_size)
+{
+    chunk_size &= ~(size_t)(UMEM_ARENA_ALIGN - 1);
+    if (unlikely(chunk_size < 4 * UMEM_ARENA_ALIGN))
+        return NULL;
+    if (max_size > chunk_size / 4)
+        max_size = chunk_size / 4;
+
+    struct umem_arena_mgr *arena_mgr = malloc(sizeof(struct umem_arena_mgr));
+    if (unlikely(arena_mgr == NULL))
+        return NULL;
+
+    arena_mgr->chunk_size = chunk_size;
+    arena_mgr->max_size = max_size;
+    uatomic_init(&arena_mgr->lock, 0);
+    arena_mgr->current = NULL;
+    arena_mgr->spare = NULL;
+    arena_mgr->stats = false;
+    memset(&arena_mgr->counters, 0, sizeof(arena_mgr->counters));
+
+    urefcount_init(umem_arena_mgr_to_urefcount(arena_mgr), umem_arena_mgr_free);
+    arena_mgr->mgr.refcount = umem_arena_mgr_to_urefcount(arena_mgr);
+    arena_mgr->mgr.umem_alloc = umem_arena_alloc;
+    arena_mgr->mgr.umem_realloc = umem_arena_realloc;
+    arena_mgr->mgr.umem_free = umem_arena_free;
+    arena_mgr->mgr.umem_mgr_vacuum = umem_arena_mgr_vacuum;
+    arena_mgr->mgr.umem_mgr_control = umem_arena_mgr_control;
+
+    return umem_arena_mgr_to_umem_mgr(arena_mgr);
+}
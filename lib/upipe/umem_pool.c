@@ -23,16 +23,63 @@
  * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  */
 
+#include <upipe/config.h>
 #include <upipe/ubase.h>
 #include <upipe/urefcount.h>
+#include <upipe/uatomic.h>
 #include <upipe/ulifo.h>
+#include <upipe/umagazine.h>
 #include <upipe/umem.h>
 #include <upipe/umem_pool.h>
 
 #include <stdlib.h>
 #include <stdbool.h>
+#include <string.h>
 #include <assert.h>
 
+#ifdef UPIPE_HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#endif
+#ifdef __linux__
+#include <unistd.h>
+#include <sys/syscall.h>
+#endif
+
+/** granularity (in octets) of the allocations in the arena */
+#define UMEM_POOL_ARENA_UNIT (64 * 1024)
+/** mbind(2) policy to allocate pages on the given nodes (linux/mempolicy.h) */
+#define UMEM_POOL_MPOL_BIND 2
+/** mmap(2) flag to select the size of huge pages (linux/mman.h) */
+#define UMEM_POOL_MAP_HUGE_SHIFT 26
+
+/** @This defines a pool of buffers of a given size. */
+struct umem_pool {
+    /** shared lifo of buffers */
+    struct ulifo lifo;
+    /** per-thread magazines in front of the lifo */
+    struct umagazine magazine;
+    /** lifo of released buffers carved from the arena, sized so that it
+     * can never overflow */
+    struct ulifo arena_lifo;
+    /** true if buffers of this pool are carved from the arena */
+    bool arena;
+    /** number of buffers allocated from this pool */
+    uatomic_uint64_t allocs;
+    /** number of buffers of this size allocated with malloc() */
+    uatomic_uint64_t fallbacks;
+};
+
+/** @This defines a reserved memory region from which large buffers are
+ * carved. */
+struct umem_pool_arena {
+    /** base address, or NULL if there is no arena */
+    uint8_t *base;
+    /** size of the mapping */
+    size_t size;
+    /** number of units already carved */
+    uatomic_uint32_t carved;
+};
+
 /** @This defines the private data structures of the umem pool manager. */
 struct umem_pool_mgr {
     /** refcount management structure */
@@ -45,8 +92,18 @@ struct umem_pool_mgr {
     size_t pool0_size;
     /** number of pools of buffers */
     size_t nb_pools;
+    /** optional arena backing large buffers */
+    struct umem_pool_arena arena;
+    /** true if the counters are updated */
+    uatomic_uint32_t stats;
+    /** number of buffers allocated */
+    uatomic_uint64_t allocs;
+    /** number of buffers reallocated */
+    uatomic_uint64_t reallocs;
+    /** number of buffers allocated with malloc() */
+    uatomic_uint64_t fallbacks;
     /** buffer pools */
-    struct ulifo pools[];
+    struct umem_pool pools[];
 };
 
 UBASE_FROM_TO(umem_pool_mgr, umem_mgr, umem_mgr, mgr)
@@ -75,6 +132,66 @@ static unsigned int umem_pool_find(struct umem_mgr *mgr, size_t wanted,
     return pool;
 }
 
+/** @internal @This returns true if the given buffer was carved from the
+ * arena.
+ *
+ * @param pool_mgr pointer to the umem pool manager
+ * @param buffer pointer to the buffer
+ * @return true if the buffer belongs to the arena
+ */
+static inline bool umem_pool_arena_owns(struct umem_pool_mgr *pool_mgr,
+                                        uint8_t *buffer)
+{
+    return pool_mgr->arena.base != NULL && buffer >= pool_mgr->arena.base &&
+           buffer < pool_mgr->arena.base + pool_mgr->arena.size;
+}
+
+/** @internal @This takes a buffer from the arena, either a previously
+ * released one or a newly carved one.
+ *
+ * @param pool_mgr pointer to the umem pool manager
+ * @param pool index of the pool
+ * @param size size of the buffers of the pool
+ * @return pointer to the buffer, or NULL if the arena is exhausted
+ */
+static uint8_t *umem_pool_arena_alloc(struct umem_pool_mgr *pool_mgr,
+                                      unsigned int pool, size_t size)
+{
+    uint8_t *buffer = ulifo_pop(&pool_mgr->pools[pool].arena_lifo, uint8_t *);
+    if (buffer != NULL)
+        return buffer;
+
+    struct umem_pool_arena *arena = &pool_mgr->arena;
+    uint32_t units = size / UMEM_POOL_ARENA_UNIT;
+    uint32_t max = arena->size / UMEM_POOL_ARENA_UNIT;
+    uint32_t carved = uatomic_load(&arena->carved);
+    do {
+        if (carved + units > max)
+            return NULL;
+    } while (unlikely(!uatomic_compare_exchange(&arena->carved, &carved,
+                                                carved + units)));
+    return arena->base + (size_t)carved * UMEM_POOL_ARENA_UNIT;
+}
+
+/** @internal @This accounts an allocation in the counters of the manager.
+ *
+ * @param pool_mgr pointer to the umem pool manager
+ * @param pool index of the pool, or nb_pools for larger buffers
+ * @param fallback true if the buffer was allocated with malloc()
+ */
+static void umem_pool_stats_alloc(struct umem_pool_mgr *pool_mgr,
+                                  unsigned int pool, bool fallback)
+{
+    uatomic_uint64_fetch_add(&pool_mgr->allocs, 1);
+    if (fallback)
+        uatomic_uint64_fetch_add(&pool_mgr->fallbacks, 1);
+    if (pool < pool_mgr->nb_pools) {
+        uatomic_uint64_fetch_add(&pool_mgr->pools[pool].allocs, 1);
+        if (fallback)
+            uatomic_uint64_fetch_add(&pool_mgr->pools[pool].fallbacks, 1);
+    }
+}
+
 /** @This allocates a new umem buffer space.
  *
  * @param mgr management structure
@@ -91,12 +208,19 @@ static bool umem_pool_alloc(struct umem_mgr *mgr, struct umem *umem,
     unsigned int pool = umem_pool_find(mgr, size, &real_size);
     uint8_t *buffer = NULL;
 
-    if (likely(pool < pool_mgr->nb_pools))
-        buffer = ulifo_pop(&pool_mgr->pools[pool], uint8_t *);
+    if (likely(pool < pool_mgr->nb_pools)) {
+        buffer = umagazine_pop(&pool_mgr->pools[pool].magazine,
+                               &pool_mgr->pools[pool].lifo, uint8_t *);
+        if (buffer == NULL && pool_mgr->pools[pool].arena)
+            buffer = umem_pool_arena_alloc(pool_mgr, pool, real_size);
+    }
+    bool fallback = buffer == NULL;
     if (unlikely(buffer == NULL))
         buffer = malloc(real_size);
     if (unlikely(buffer == NULL))
         return false;
+    if (unlikely(uatomic_load_relaxed(&pool_mgr->stats)))
+        umem_pool_stats_alloc(pool_mgr, pool, fallback);
 
     umem->buffer = buffer;
     umem->size = size;
@@ -118,8 +242,15 @@ static void umem_pool_free(struct umem *umem)
     unsigned int pool = umem_pool_find(umem->mgr, umem->real_size, NULL);
 
     if (unlikely(pool >= pool_mgr->nb_pools ||
-                 !ulifo_push(&pool_mgr->pools[pool], umem->buffer)))
-        free(umem->buffer);
+                 !umagazine_push(&pool_mgr->pools[pool].magazine,
+                                 &pool_mgr->pools[pool].lifo, umem->buffer))) {
+        if (umem_pool_arena_owns(pool_mgr, umem->buffer)) {
+            bool ret = ulifo_push(&pool_mgr->pools[pool].arena_lifo,
+                                  umem->buffer);
+            assert(ret);
+        } else
+            free(umem->buffer);
+    }
     umem->buffer = NULL;
     umem->mgr = NULL;
 }
@@ -140,9 +271,12 @@ static bool umem_pool_realloc(struct umem *umem, size_t new_size)
         return true;
     }
 
+    struct umem_pool_mgr *pool_mgr = umem_pool_mgr_from_umem_mgr(umem->mgr);
     struct umem new_umem;
     if (!umem_pool_alloc(umem->mgr, &new_umem, new_size))
         return false;
+    if (unlikely(uatomic_load_relaxed(&pool_mgr->stats)))
+        uatomic_uint64_fetch_add(&pool_mgr->reallocs, 1);
     memcpy(new_umem.buffer, umem->buffer, umem->size);
     umem_pool_free(umem);
     *umem = new_umem;
@@ -160,8 +294,165 @@ static void umem_pool_mgr_vacuum(struct umem_mgr *mgr)
 
     for (unsigned int i = 0; i < pool_mgr->nb_pools; i++) {
         uint8_t *buffer;
-        while ((buffer = ulifo_pop(&pool_mgr->pools[i], uint8_t *)) != NULL)
-            free(buffer);
+        while ((buffer = umagazine_vacuum_pop(&pool_mgr->pools[i].magazine,
+                                              &pool_mgr->pools[i].lifo))
+               != NULL) {
+            if (umem_pool_arena_owns(pool_mgr, buffer)) {
+                bool ret = ulifo_push(&pool_mgr->pools[i].arena_lifo, buffer);
+                assert(ret);
+            } else
+                free(buffer);
+        }
+    }
+}
+
+/** @internal @This allocates buffers in advance and keeps them in a pool.
+ * The buffers are zeroed to fault their pages in, and optionally locked in
+ * RAM. They are pushed directly into the shared lifo so that every thread
+ * can use them.
+ *
+ * @param pool_mgr pointer to the umem pool manager
+ * @param size size of the buffers
+ * @param count number of buffers to allocate
+ * @param lock true to lock the pages of the buffers with mlock(2)
+ * @return an error code
+ */
+static int umem_pool_mgr_prefill(struct umem_pool_mgr *pool_mgr, size_t size,
+                                 unsigned int count, bool lock)
+{
+    struct umem_mgr *mgr = umem_pool_mgr_to_umem_mgr(pool_mgr);
+    size_t real_size;
+    unsigned int pool = umem_pool_find(mgr, size, &real_size);
+    if (unlikely(pool >= pool_mgr->nb_pools))
+        return UBASE_ERR_INVALID;
+
+    struct umem_pool *umem_pool = &pool_mgr->pools[pool];
+    for (unsigned int i = 0; i < count; i++) {
+        uint8_t *buffer = NULL;
+        if (umem_pool->arena)
+            buffer = umem_pool_arena_alloc(pool_mgr, pool, real_size);
+        if (buffer == NULL)
+            buffer = malloc(real_size);
+        if (unlikely(buffer == NULL))
+            return UBASE_ERR_ALLOC;
+
+        memset(buffer, 0, real_size);
+#ifdef UPIPE_HAVE_SYS_MMAN_H
+        if (lock && unlikely(mlock(buffer, real_size) != 0))
+            lock = false;
+#endif
+
+        if (!ulifo_push(&umem_pool->lifo, buffer)) {
+            /* the pool is full */
+            if (umem_pool_arena_owns(pool_mgr, buffer)) {
+                bool ret = ulifo_push(&umem_pool->arena_lifo, buffer);
+                assert(ret);
+            } else
+                free(buffer);
+            break;
+        }
+    }
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This enables or disables the statistics of the manager, and
+ * resets them.
+ *
+ * @param pool_mgr pointer to the umem pool manager
+ * @param enabled true to update the counters
+ */
+static void umem_pool_mgr_set_stats(struct umem_pool_mgr *pool_mgr,
+                                    bool enabled)
+{
+    if (enabled) {
+        uatomic_uint64_store(&pool_mgr->allocs, 0);
+        uatomic_uint64_store(&pool_mgr->reallocs, 0);
+        uatomic_uint64_store(&pool_mgr->fallbacks, 0);
+        for (unsigned int i = 0; i < pool_mgr->nb_pools; i++) {
+            uatomic_uint64_store(&pool_mgr->pools[i].allocs, 0);
+            uatomic_uint64_store(&pool_mgr->pools[i].fallbacks, 0);
+        }
+    }
+    uatomic_store(&pool_mgr->stats, enabled);
+}
+
+/** @internal @This reads the statistics of the manager.
+ *
+ * @param pool_mgr pointer to the umem pool manager
+ * @param stats filled in with the counters of the manager
+ */
+static void umem_pool_mgr_get_stats(struct umem_pool_mgr *pool_mgr,
+                                    struct umem_stats *stats)
+{
+    stats->allocs = uatomic_uint64_load(&pool_mgr->allocs);
+    stats->reallocs = uatomic_uint64_load(&pool_mgr->reallocs);
+    stats->fallbacks = uatomic_uint64_load(&pool_mgr->fallbacks);
+}
+
+/** @internal @This reads the statistics of a size class of the manager.
+ *
+ * @param pool_mgr pointer to the umem pool manager
+ * @param pool index of the size class
+ * @param size_p filled in with the size of the buffers of the class
+ * @param allocs_p filled in with the number of allocations
+ * @param fallbacks_p filled in with the number of allocations with malloc()
+ * @return an error code
+ */
+static int _umem_pool_mgr_get_class_stats(struct umem_pool_mgr *pool_mgr,
+                                          unsigned int pool, size_t *size_p,
+                                          uint64_t *allocs_p,
+                                          uint64_t *fallbacks_p)
+{
+    if (unlikely(pool >= pool_mgr->nb_pools))
+        return UBASE_ERR_INVALID;
+    if (size_p != NULL)
+        *size_p = pool_mgr->pool0_size << pool;
+    if (allocs_p != NULL)
+        *allocs_p = uatomic_uint64_load(&pool_mgr->pools[pool].allocs);
+    if (fallbacks_p != NULL)
+        *fallbacks_p = uatomic_uint64_load(&pool_mgr->pools[pool].fallbacks);
+    return UBASE_ERR_NONE;
+}
+
+/** @This processes control commands on a umem pool manager.
+ *
+ * @param mgr pointer to umem manager
+ * @param command type of command to process
+ * @param args arguments of the command
+ * @return an error code
+ */
+static int umem_pool_mgr_control(struct umem_mgr *mgr,
+                                 int command, va_list args)
+{
+    struct umem_pool_mgr *pool_mgr = umem_pool_mgr_from_umem_mgr(mgr);
+    switch (command) {
+        case UMEM_MGR_SET_STATS: {
+            bool enabled = va_arg(args, int);
+            umem_pool_mgr_set_stats(pool_mgr, enabled);
+            return UBASE_ERR_NONE;
+        }
+        case UMEM_MGR_GET_STATS: {
+            struct umem_stats *stats = va_arg(args, struct umem_stats *);
+            umem_pool_mgr_get_stats(pool_mgr, stats);
+            return UBASE_ERR_NONE;
+        }
+        case UMEM_MGR_PREFILL: {
+            size_t size = va_arg(args, size_t);
+            unsigned int count = va_arg(args, unsigned int);
+            bool lock = va_arg(args, int);
+            return umem_pool_mgr_prefill(pool_mgr, size, count, lock);
+        }
+        case UMEM_POOL_MGR_GET_CLASS_STATS: {
+            UBASE_SIGNATURE_CHECK(args, UMEM_POOL_SIGNATURE)
+            unsigned int pool = va_arg(args, unsigned int);
+            size_t *size_p = va_arg(args, size_t *);
+            uint64_t *allocs_p = va_arg(args, uint64_t *);
+            uint64_t *fallbacks_p = va_arg(args, uint64_t *);
+            return _umem_pool_mgr_get_class_stats(pool_mgr, pool, size_p,
+                                                  allocs_p, fallbacks_p);
+        }
+        default:
+            return UBASE_ERR_UNHANDLED;
     }
 }
 
@@ -174,52 +465,161 @@ static void umem_pool_mgr_free(struct urefcount *urefcount)
     struct umem_pool_mgr *pool_mgr = umem_pool_mgr_from_urefcount(urefcount);
     umem_pool_mgr_vacuum(umem_pool_mgr_to_umem_mgr(pool_mgr));
 
-    for (unsigned int i = 0; i < pool_mgr->nb_pools; i++)
-        ulifo_clean(&pool_mgr->pools[i]);
+    for (unsigned int i = 0; i < pool_mgr->nb_pools; i++) {
+        while (ulifo_pop(&pool_mgr->pools[i].arena_lifo, uint8_t *) != NULL);
+        umagazine_clean(&pool_mgr->pools[i].magazine);
+        ulifo_clean(&pool_mgr->pools[i].lifo);
+        ulifo_clean(&pool_mgr->pools[i].arena_lifo);
+        uatomic_uint64_clean(&pool_mgr->pools[i].allocs);
+        uatomic_uint64_clean(&pool_mgr->pools[i].fallbacks);
+    }
+
+#ifdef UPIPE_HAVE_SYS_MMAN_H
+    if (pool_mgr->arena.base != NULL)
+        munmap(pool_mgr->arena.base, pool_mgr->arena.size);
+#endif
+    uatomic_clean(&pool_mgr->arena.carved);
+    uatomic_clean(&pool_mgr->stats);
+    uatomic_uint64_clean(&pool_mgr->allocs);
+    uatomic_uint64_clean(&pool_mgr->reallocs);
+    uatomic_uint64_clean(&pool_mgr->fallbacks);
 
     urefcount_clean(urefcount);
     free(pool_mgr);
 }
 
-/** @This allocates a new instance of the umem pool manager allocating buffers
- * from application memory, using pools in power of 2's.
+/** @internal @This reserves the memory of the arena.
+ *
+ * @param arena pointer to the arena
+ * @param size size of the arena
+ * @param page_size size of the huge pages to use, or 0 for the system default
+ * @param numa_node NUMA node to bind the memory to, or -1
+ * @return false if the memory couldn't be reserved
+ */
+static bool umem_pool_arena_init(struct umem_pool_arena *arena, size_t size,
+                                 size_t page_size, int numa_node)
+{
+    arena->base = NULL;
+    arena->size = 0;
+    uatomic_init(&arena->carved, 0);
+    if (!size)
+        return true;
+
+#ifdef UPIPE_HAVE_SYS_MMAN_H
+    if (page_size < UMEM_POOL_ARENA_UNIT)
+        page_size = 2 * 1024 * 1024;
+    size = (size + page_size - 1) & ~(page_size - 1);
+    if (size / UMEM_POOL_ARENA_UNIT > UINT32_MAX)
+        return false;
+
+    void *base = MAP_FAILED;
+#ifdef MAP_HUGETLB
+    int flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB;
+    flags |= __builtin_ctzl(page_size) << UMEM_POOL_MAP_HUGE_SHIFT;
+    base = mmap(NULL, size, PROT_READ | PROT_WRITE, flags, -1, 0);
+#endif
+    if (base == MAP_FAILED) {
+        /* no huge pages reserved, fall back to transparent huge pages */
+        base = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (unlikely(base == MAP_FAILED))
+            return false;
+#ifdef MADV_HUGEPAGE
+        madvise(base, size, MADV_HUGEPAGE);
+#endif
+    }
+
+#if defined(__linux__) && defined(SYS_mbind)
+    if (numa_node >= 0) {
+        unsigned long nodemask[4] = { 0, 0, 0, 0 };
+        unsigned int bits = sizeof(unsigned long) * 8;
+        if (numa_node < bits * 4) {
+            nodemask[numa_node / bits] = 1UL << (numa_node % bits);
+            /* best effort: the memory is still usable if this fails */
+            syscall(SYS_mbind, base, size, UMEM_POOL_MPOL_BIND, nodemask,
+                    (unsigned long)bits * 4 + 1, 0);
+        }
+    }
+#endif
+
+    arena->base = base;
+    arena->size = size;
+    return true;
+#else
+    return false;
+#endif
+}
+
+/** @internal @This allocates a new instance of the umem pool manager.
  *
+ * @param arena_size size of the arena backing large buffers, or 0
+ * @param page_size size of the huge pages of the arena
+ * @param numa_node NUMA node to bind the arena to, or -1
  * @param pool0_size size (in octets) of the smallest allocatable buffer; it
  * must be a power of 2
- * @param nb_pools number of buffer pools to maintain, with sizes in power of
- * 2's increments, followed, for each pool, by the maximum number of buffers
- * to keep in the pool (unsigned int); larger buffers will be directly managed
- * with malloc() and free()
+ * @param nb_pools number of buffer pools to maintain
+ * @param args maximum number of buffers to keep in each pool (unsigned int)
  * @return pointer to manager, or NULL in case of error
  */
-struct umem_mgr *umem_pool_mgr_alloc(size_t pool0_size, size_t nb_pools, ...)
+static struct umem_mgr *umem_pool_mgr_alloc_va(size_t arena_size,
+                                              size_t page_size, int numa_node,
+                                              size_t pool0_size,
+                                              size_t nb_pools, va_list args)
 {
     size_t alloc_size = sizeof(struct umem_pool_mgr) +
-                        sizeof(struct ulifo) * nb_pools;
+                        sizeof(struct umem_pool) * nb_pools;
     unsigned int pools_depths[nb_pools];
-    va_list args;
-    va_start(args, nb_pools);
+    unsigned int arena_depths[nb_pools];
     for (unsigned int i = 0; i < nb_pools; i++) {
         pools_depths[i] = va_arg(args, unsigned int);
         assert(pools_depths[i] <= UINT16_MAX);
         alloc_size += ulifo_sizeof(pools_depths[i]);
+
+        /* enough room to hold every buffer that can be carved, otherwise
+         * the class is not served by the arena */
+        size_t size = pool0_size << i;
+        arena_depths[i] = 0;
+        if (arena_size && size >= UMEM_POOL_ARENA_UNIT) {
+            size_t depth = (arena_size + page_size + size - 1) / size;
+            if (depth <= UINT16_MAX)
+                arena_depths[i] = depth;
+        }
+        alloc_size += ulifo_sizeof(arena_depths[i]);
     }
-    va_end(args);
 
     struct umem_pool_mgr *pool_mgr = malloc(alloc_size);
     if (unlikely(pool_mgr == NULL))
         return NULL;
 
+    if (unlikely(!umem_pool_arena_init(&pool_mgr->arena, arena_size,
+                                       page_size, numa_node))) {
+        uatomic_clean(&pool_mgr->arena.carved);
+        free(pool_mgr);
+        return NULL;
+    }
+
     pool_mgr->pool0_size = pool0_size;
     pool_mgr->nb_pools = nb_pools;
 
     void *extra = (void *)pool_mgr + sizeof(struct umem_pool_mgr) +
-                  sizeof(struct ulifo) * nb_pools;
+                  sizeof(struct umem_pool) * nb_pools;
 
     for (unsigned int i = 0; i < nb_pools; i++) {
-        ulifo_init(&pool_mgr->pools[i], pools_depths[i], extra);
+        ulifo_init(&pool_mgr->pools[i].lifo,
+                   umagazine_init(&pool_mgr->pools[i].magazine,
+                                  pools_depths[i]), extra);
         extra += ulifo_sizeof(pools_depths[i]);
+        ulifo_init(&pool_mgr->pools[i].arena_lifo, arena_depths[i], extra);
+        extra += ulifo_sizeof(arena_depths[i]);
+        pool_mgr->pools[i].arena = arena_depths[i] &&
+            (pool0_size << i) <= pool_mgr->arena.size;
+        uatomic_uint64_init(&pool_mgr->pools[i].allocs, 0);
+        uatomic_uint64_init(&pool_mgr->pools[i].fallbacks, 0);
     }
+    uatomic_init(&pool_mgr->stats, false);
+    uatomic_uint64_init(&pool_mgr->allocs, 0);
+    uatomic_uint64_init(&pool_mgr->reallocs, 0);
+    uatomic_uint64_init(&pool_mgr->fallbacks, 0);
 
     urefcount_init(umem_pool_mgr_to_urefcount(pool_mgr), umem_pool_mgr_free);
     pool_mgr->mgr.refcount = umem_pool_mgr_to_urefcount(pool_mgr);
@@ -227,10 +627,67 @@ struct umem_mgr *umem_pool_mgr_alloc(size_t pool0_size, size_t nb_pools, ...)
     pool_mgr->mgr.umem_realloc = umem_pool_realloc;
     pool_mgr->mgr.umem_free = umem_pool_free;
     pool_mgr->mgr.umem_mgr_vacuum = umem_pool_mgr_vacuum;
+    pool_mgr->mgr.umem_mgr_control = umem_pool_mgr_control;
 
     return umem_pool_mgr_to_umem_mgr(pool_mgr);
 }
 
+/** @This allocates a new instance of the umem pool manager allocating buffers
+ * from application memory, using pools in power of 2's.
+ *
+ * @param pool0_size size (in octets) of the smallest allocatable buffer; it
+ * must be a power of 2
+ * @param nb_pools number of buffer pools to maintain, with sizes in power of
+ * 2's increments, followed, for each pool, by the maximum number of buffers
+ * to keep in the pool (unsigned int); larger buffers will be directly managed
+ * with malloc() and free()
+ * @return pointer to manager, or NULL in case of error
+ */
+struct umem_mgr *umem_pool_mgr_alloc(size_t pool0_size, size_t nb_pools, ...)
+{
+    va_list args;
+    va_start(args, nb_pools);
+    struct umem_mgr *mgr = umem_pool_mgr_alloc_va(0, 0, -1, pool0_size,
+                                                  nb_pools, args);
+    va_end(args);
+    return mgr;
+}
+
+/** @This allocates a new instance of the umem pool manager, carving buffers
+ * of 64 KiB and more out of an arena of huge pages reserved at allocation.
+ * If no huge pages are reserved in the system, transparent huge pages are
+ * requested instead. When the arena is exhausted, buffers are allocated with
+ * malloc().
+ *
+ * @param arena_size size (in octets) of the arena
+ * @param page_size size (in octets) of the huge pages, typically 2 MiB or
+ * 1 GiB (if set to 0, 2 MiB is used)
+ * @param numa_node NUMA node to bind the arena to, or -1 for the default
+ * policy of the calling thread
+ * @param pool0_size size (in octets) of the smallest allocatable buffer; it
+ * must be a power of 2
+ * @param nb_pools number of buffer pools to maintain, with sizes in power of
+ * 2's increments, followed, for each pool, by the maximum number of buffers
+ * to keep in the pool (unsigned int); larger buffers will be directly managed
+ * with malloc() and free()
+ * @return pointer to manager, or NULL in case of error
+ */
+struct umem_mgr *umem_pool_mgr_alloc_arena(size_t arena_size,
+                                           size_t page_size, int numa_node,
+                                           size_t pool0_size,
+                                           size_t nb_pools, ...)
+{
+    if (page_size < UMEM_POOL_ARENA_UNIT)
+        page_size = 2 * 1024 * 1024;
+    va_list args;
+    va_start(args, nb_pools);
+    struct umem_mgr *mgr = umem_pool_mgr_alloc_va(arena_size, page_size,
+                                                  numa_node, pool0_size,
+                                                  nb_pools, args);
+    va_end(args);
+    return mgr;
+}
+
 /** @This allocates a new instance of the umem pool manager allocating buffers
  * from application memory, using pools in power of 2's, with a simpler API.
  *
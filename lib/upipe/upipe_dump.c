@@ -28,11 +28,20 @@
  */
 
 #include <upipe/ubase.h>
+#include <upipe/uclock.h>
 #include <upipe/upipe.h>
 #include <upipe/upipe_dump.h>
 #include <upipe/uprobe_prefix.h>
+#include <upipe/upump.h>
+#include <upipe/upool.h>
+#include <upipe/uref.h>
+#include <upipe/uref_flow.h>
+#include <upipe/ubuf.h>
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 #include <errno.h>
 #include <assert.h>
 
@@ -101,6 +110,95 @@ char *upipe_dump_flow_def_label_default(struct uref *flow_def)
     return string;
 }
 
+/** @internal @This appends the counters of an instrumented pipe to its
+ * label.
+ *
+ * @param upipe upipe structure
+ * @param label allocated label, freed by this function
+ * @return allocated string
+ */
+static char *upipe_dump_stats_label(struct upipe *upipe, char *label)
+{
+    struct upipe_stats stats;
+    upipe_stats_read(upipe->stats, &stats);
+
+    /* room for the text and 10 counters of up to 20 digits */
+    size_t size = strlen(label) + 160 + 10 * 20;
+    char *string = malloc(size);
+    if (unlikely(string == NULL))
+        return label;
+    snprintf(string, size, "%s\\n"
+             "in: %"PRIu64" urefs, %"PRIu64" octets\\n"
+             "out: %"PRIu64" urefs, %"PRIu64" octets\\n"
+             "input: %"PRIu64" us, max %"PRIu64" us\\n"
+             "control: %"PRIu64" calls, %"PRIu64" us\\n"
+             "alloc: %"PRIu64" ubufs, %"PRIu64" octets",
+             label, stats.urefs_in, stats.bytes_in,
+             stats.urefs_out, stats.bytes_out,
+             stats.input_time / (UCLOCK_FREQ / 1000000),
+             stats.input_max / (UCLOCK_FREQ / 1000000),
+             stats.controls, stats.control_time / (UCLOCK_FREQ / 1000000),
+             stats.ubufs_alloc, stats.ubuf_bytes_alloc);
+    free(label);
+    return string;
+}
+
+/** @internal @This prints the buffered urefs of a pipe.
+ *
+ * @param occupancy occupancy of the pipe
+ * @param string buffer to print to
+ * @param size size of the buffer
+ */
+static void upipe_dump_occupancy_print(const struct upipe_occupancy *occupancy,
+                                       char *string, size_t size)
+{
+    int len = snprintf(string, size, "queue: ");
+    if (occupancy->urefs != UINT64_MAX)
+        len += snprintf(string + len, size - len, "%"PRIu64, occupancy->urefs);
+    else
+        len += snprintf(string + len, size - len, "?");
+    if (occupancy->max_urefs != UINT64_MAX && occupancy->max_urefs)
+        len += snprintf(string + len, size - len, "/%"PRIu64,
+                        occupancy->max_urefs);
+    len += snprintf(string + len, size - len, " urefs");
+    if (occupancy->bytes != UINT64_MAX)
+        len += snprintf(string + len, size - len, ", %"PRIu64" octets",
+                        occupancy->bytes);
+    if (occupancy->duration != UINT64_MAX)
+        snprintf(string + len, size - len, ", %"PRIu64" ms",
+                 occupancy->duration / (UCLOCK_FREQ / 1000));
+}
+
+/** @internal @This appends the buffered urefs of a pipe to a label, if the
+ * pipe reports them.
+ *
+ * @param upipe upipe structure
+ * @param label allocated label, freed by this function
+ * @param prefix string inserted before the occupancy
+ * @param suffix string appended after the occupancy
+ * @return allocated string
+ */
+static char *upipe_dump_occupancy_label(struct upipe *upipe, char *label,
+                                        const char *prefix,
+                                        const char *suffix)
+{
+    struct upipe_occupancy occupancy;
+    if (!ubase_check(upipe_get_occupancy(upipe, &occupancy)))
+        return label;
+
+    /* room for the text and 4 counters of up to 20 digits */
+    char buffer[64 + 4 * 20];
+    upipe_dump_occupancy_print(&occupancy, buffer, sizeof(buffer));
+    size_t size = strlen(label) + strlen(prefix) + strlen(buffer) +
+                  strlen(suffix) + 1;
+    char *string = malloc(size);
+    if (unlikely(string == NULL))
+        return label;
+    snprintf(string, size, "%s%s%s%s", label, prefix, buffer, suffix);
+    free(label);
+    return string;
+}
+
 /** @internal @This finds in the list of a pipe has already been printed.
  *
  * @param upipe first pipe of the pipeline
@@ -136,6 +234,9 @@ static void upipe_dump_pipe(upipe_dump_pipe_label pipe_label,
         return;
 
     char *label = pipe_label(upipe);
+    if (upipe->stats != NULL)
+        label = upipe_dump_stats_label(upipe, label);
+    label = upipe_dump_occupancy_label(upipe, label, "\\n", "");
 
     /* Prepare context. */
     struct upipe_dump_ctx *ctx = malloc(sizeof(struct upipe_dump_ctx));
@@ -219,7 +320,8 @@ static void upipe_dump_pipe(upipe_dump_pipe_label pipe_label,
 
     struct uref *flow_def = NULL;
     upipe_get_flow_def(upipe, &flow_def);
-    label = flow_def_label(flow_def);
+    label = upipe_dump_occupancy_label(output, flow_def_label(flow_def),
+                                       "", "\\l");
 
     struct upipe_dump_ctx *output_ctx =
             upipe_get_opaque(output, struct upipe_dump_ctx *);
@@ -231,24 +333,113 @@ upipe_dump_pipe_end:
     fprintf(file, "#end pipe%"PRIu64"\n", ctx->input_uid);
 }
 
-/** @This dumps a pipeline in dot format.
+/** @This is a pool of buffers reported by a live dump. */
+struct upipe_dump_pool {
+    /** structure for double-linked lists */
+    struct uchain uchain;
+    /** name of the pool */
+    char *name;
+    /** uref manager, or NULL */
+    struct uref_mgr *uref_mgr;
+    /** ubuf manager, or NULL */
+    struct ubuf_mgr *ubuf_mgr;
+};
+
+UBASE_FROM_TO(upipe_dump_pool, uchain, uchain, uchain)
+
+/** @internal @This collects the source pipes given in a ulist and in a
+ * NULL-terminated list of arguments.
+ *
+ * @param ulist list of sources pipes in ulist format, or NULL
+ * @param args list of sources pipes terminated with NULL
+ * @param nb_sources_p filled in with the number of sources
+ * @return allocated array of sources, or NULL
+ */
+static struct upipe **upipe_dump_sources(struct uchain *ulist, va_list args,
+                                         unsigned int *nb_sources_p)
+{
+    struct upipe **sources = NULL;
+    unsigned int nb_sources = 0;
+    struct uchain *uchain;
+    struct upipe *source;
+
+    if (ulist != NULL) {
+        ulist_foreach (ulist, uchain) {
+            struct upipe **tmp = realloc(sources,
+                    (nb_sources + 1) * sizeof(struct upipe *));
+            if (unlikely(tmp == NULL))
+                break;
+            sources = tmp;
+            sources[nb_sources++] = upipe_from_uchain(uchain);
+        }
+    }
+    while ((source = va_arg(args, struct upipe *)) != NULL) {
+        struct upipe **tmp = realloc(sources,
+                (nb_sources + 1) * sizeof(struct upipe *));
+        if (unlikely(tmp == NULL))
+            break;
+        sources = tmp;
+        sources[nb_sources++] = source;
+    }
+    *nb_sources_p = nb_sources;
+    return sources;
+}
+
+/** @internal @This restores the pipes of a dump to their original state.
+ *
+ * @param list list of dumped pipes
+ */
+static void upipe_dump_clean(struct uchain *list)
+{
+    struct uchain *uchain, *uchain_tmp;
+    ulist_delete_foreach (list, uchain, uchain_tmp) {
+        struct upipe *upipe = upipe_from_uchain(uchain);
+        struct upipe_dump_ctx *ctx =
+            upipe_get_opaque(upipe, struct upipe_dump_ctx *);
+        upipe->uchain = ctx->original_uchain;
+        upipe->opaque = ctx->original_opaque;
+        free(ctx);
+    }
+}
+
+/** @internal @This reads the statistics of a pool.
+ *
+ * @param pool reported pool
+ * @param stats filled in with the statistics of the uref or ubuf pool
+ * @param shared_stats filled in with the statistics of the shared pool
+ * @return an error code
+ */
+static int upipe_dump_pool_stats(struct upipe_dump_pool *pool,
+                                 struct upool_stats *stats,
+                                 struct upool_stats *shared_stats)
+{
+    memset(shared_stats, 0, sizeof(*shared_stats));
+    if (pool->uref_mgr != NULL)
+        return uref_mgr_get_stats(pool->uref_mgr, stats);
+    return ubuf_mgr_get_stats(pool->ubuf_mgr, stats, shared_stats);
+}
+
+/** @internal @This dumps a pipeline in dot format.
  *
  * @param pipe_label function to print pipe labels
  * @param flow_def_label function to print flow_def labels
  * @param file file pointer to write to
- * @param ulist list of sources pipes in ulist format
- * @param args list of sources pipes terminated with NULL
+ * @param sources array of source pipes
+ * @param nb_sources number of source pipes
+ * @param pools list of pools to report, or NULL
  */
-void upipe_dump_va(upipe_dump_pipe_label pipe_label,
-                   upipe_dump_flow_def_label flow_def_label,
-                   FILE *file, struct uchain *ulist, va_list args)
+static void upipe_dump_dot_sources(upipe_dump_pipe_label pipe_label,
+                                   upipe_dump_flow_def_label flow_def_label,
+                                   FILE *file, struct upipe **sources,
+                                   unsigned int nb_sources,
+                                   struct uchain *pools)
 {
     pipe_label = pipe_label ?: upipe_dump_upipe_label_default;
     flow_def_label = flow_def_label ?: upipe_dump_flow_def_label_default;
 
     uint64_t uid = 0;
     struct uchain list;
-    struct uchain *uchain, *uchain_tmp;
+    struct uchain *uchain;
     ulist_init(&list);
 
     fprintf(file, "digraph \"upipe dump\" {\n");
@@ -257,17 +448,8 @@ void upipe_dump_va(upipe_dump_pipe_label pipe_label,
     fprintf(file, "node [shape=\"box\", style=\"filled\", color=\"#0e0e0e\", fillcolor=\"#f6f6f6\", fontname=\"Arial\", fontsize=10, fontcolor=\"#0e0e0e\"];\n");
     fprintf(file, "newrank=true;\n"); /* for rank=same */
 
-    if (ulist != NULL) {
-        ulist_foreach (ulist, uchain) {
-            struct upipe *source = upipe_from_uchain(uchain);
-            upipe_dump_pipe(pipe_label, flow_def_label, file, source,
-                            &uid, &list, false);
-        }
-    }
-
-    struct upipe *source;
-    while ((source = va_arg(args, struct upipe *)) != NULL)
-        upipe_dump_pipe(pipe_label, flow_def_label, file, source,
+    for (unsigned int i = 0; i < nb_sources; i++)
+        upipe_dump_pipe(pipe_label, flow_def_label, file, sources[i],
                         &uid, &list, false);
 
     /* Walk through the super-pipes that we may have forgotten. */
@@ -287,23 +469,342 @@ void upipe_dump_va(upipe_dump_pipe_label pipe_label,
         }
     } while (last_uid != uid);
 
+    if (pools != NULL && !ulist_empty(pools)) {
+        fprintf(file, "pools [shape=\"note\", label=\"");
+        ulist_foreach (pools, uchain) {
+            struct upipe_dump_pool *pool = upipe_dump_pool_from_uchain(uchain);
+            struct upool_stats stats, shared_stats;
+            if (!ubase_check(upipe_dump_pool_stats(pool, &stats,
+                                                   &shared_stats)))
+                continue;
+            fprintf(file, "%s: %"PRIu64" in use, max %"PRIu64"\\l",
+                    pool->name, stats.in_use, stats.high_water);
+            if (pool->ubuf_mgr != NULL)
+                fprintf(file, "%s buffers: %"PRIu64" in use, max %"PRIu64"\\l",
+                        pool->name, shared_stats.in_use,
+                        shared_stats.high_water);
+        }
+        fprintf(file, "\"];\n");
+    }
+
     fprintf(file, "}\n");
 
     /* Clean up. */
-    ulist_delete_foreach (&list, uchain, uchain_tmp) {
+    ulist_foreach (&list, uchain) {
         struct upipe *upipe = upipe_from_uchain(uchain);
         struct upipe_dump_ctx *ctx =
             upipe_get_opaque(upipe, struct upipe_dump_ctx *);
-        upipe->uchain = ctx->original_uchain;
-        upipe->opaque = ctx->original_opaque;
         uid--;
         if (ctx->output_uid != ctx->input_uid)
             uid--;
-        free(ctx);
     }
     assert(!uid);
+    upipe_dump_clean(&list);
+}
+
+/** @This dumps a pipeline in dot format.
+ *
+ * @param pipe_label function to print pipe labels
+ * @param flow_def_label function to print flow_def labels
+ * @param file file pointer to write to
+ * @param ulist list of sources pipes in ulist format
+ * @param args list of sources pipes terminated with NULL
+ */
+void upipe_dump_va(upipe_dump_pipe_label pipe_label,
+                   upipe_dump_flow_def_label flow_def_label,
+                   FILE *file, struct uchain *ulist, va_list args)
+{
+    unsigned int nb_sources;
+    struct upipe **sources = upipe_dump_sources(ulist, args, &nb_sources);
+    upipe_dump_dot_sources(pipe_label, flow_def_label, file, sources,
+                           nb_sources, NULL);
+    free(sources);
+}
+
+/** @internal @This prints a string in JSON format.
+ *
+ * @param file file pointer to write to
+ * @param string string to print
+ */
+static void upipe_dump_json_string(FILE *file, const char *string)
+{
+    fputc('"', file);
+    for ( ; *string; string++) {
+        unsigned char c = *string;
+        if (c == '"' || c == '\\')
+            fprintf(file, "\\%c", c);
+        else if (c < 0x20)
+            fprintf(file, "\\u%04x", c);
+        else
+            fputc(c, file);
+    }
+    fputc('"', file);
+}
+
+/** @internal @This prints a value in JSON format, or null if it is unknown.
+ *
+ * @param file file pointer to write to
+ * @param name name of the member
+ * @param value value, or UINT64_MAX
+ */
+static void upipe_dump_json_value(FILE *file, const char *name,
+                                  uint64_t value)
+{
+    if (value == UINT64_MAX)
+        fprintf(file, "\"%s\":null", name);
+    else
+        fprintf(file, "\"%s\":%"PRIu64, name, value);
 }
 
+/** @internal @This collects a pipe and the pipes connected to it.
+ *
+ * @param upipe upipe to collect
+ * @param uid_p pointer to unique ID
+ * @param list list of already collected pipes
+ * @param last_output last output pipe of the pipeline
+ */
+static void upipe_dump_json_collect(struct upipe *upipe, uint64_t *uid_p,
+                                    struct uchain *list,
+                                    struct upipe *last_output)
+{
+    if (upipe_dump_find(upipe, list))
+        return;
+
+    struct upipe_dump_ctx *ctx = malloc(sizeof(struct upipe_dump_ctx));
+    assert(ctx != NULL);
+    ctx->input_uid = ctx->output_uid = (*uid_p)++;
+    ctx->original_uchain = upipe->uchain;
+    ctx->original_opaque = upipe->opaque;
+    upipe_set_opaque(upipe, ctx);
+    ulist_add(list, upipe_to_uchain(upipe));
+
+    struct upipe *sub = NULL;
+    while (ubase_check(upipe_iterate_sub(upipe, &sub)) && sub != NULL)
+        upipe_dump_json_collect(sub, uid_p, list, last_output);
+
+    upipe_bin_freeze(upipe);
+    struct upipe *first_inner = NULL;
+    struct upipe *last_inner = NULL;
+    upipe_bin_get_first_inner(upipe, &first_inner);
+    upipe_bin_get_last_inner(upipe, &last_inner);
+    if (first_inner != NULL || last_inner != NULL) {
+        first_inner = first_inner ?: last_inner;
+        last_inner = last_inner ?: first_inner;
+        upipe_dump_json_collect(first_inner, uid_p, list, last_inner);
+        upipe_dump_json_collect(last_inner, uid_p, list, last_inner);
+    }
+    upipe_bin_thaw(upipe);
+
+    /* the output of the last inner pipe is the output of the bin */
+    if (upipe == last_output) {
+        ctx->output_uid = UINT64_MAX;
+        return;
+    }
+
+    struct upipe *output = NULL;
+    upipe_get_output(upipe, &output);
+    if (output != NULL)
+        upipe_dump_json_collect(output, uid_p, list, last_output);
+}
+
+/** @internal @This prints a collected pipe in JSON format.
+ *
+ * @param pipe_label function to print pipe labels
+ * @param file file pointer to write to
+ * @param upipe upipe to print
+ */
+static void upipe_dump_json_pipe(upipe_dump_pipe_label pipe_label,
+                                 FILE *file, struct upipe *upipe)
+{
+    struct upipe_dump_ctx *ctx =
+        upipe_get_opaque(upipe, struct upipe_dump_ctx *);
+    char signature[5];
+    snprintf(signature, sizeof(signature), "%4.4s",
+             (const char *)&upipe->mgr->signature);
+
+    fprintf(file, "{\"id\":%"PRIu64",\"label\":", ctx->input_uid);
+    char *label = pipe_label(upipe);
+    upipe_dump_json_string(file, label ?: "");
+    free(label);
+    fprintf(file, ",\"signature\":");
+    upipe_dump_json_string(file, signature);
+
+    struct upipe *super = NULL;
+    if (ubase_check(upipe_sub_get_super(upipe, &super)) && super != NULL) {
+        struct upipe_dump_ctx *super_ctx =
+            upipe_get_opaque(super, struct upipe_dump_ctx *);
+        fprintf(file, ",\"super\":%"PRIu64, super_ctx->input_uid);
+    }
+
+    upipe_bin_freeze(upipe);
+    struct upipe *first_inner = NULL;
+    struct upipe *last_inner = NULL;
+    upipe_bin_get_first_inner(upipe, &first_inner);
+    upipe_bin_get_last_inner(upipe, &last_inner);
+    if (first_inner != NULL || last_inner != NULL) {
+        struct upipe_dump_ctx *first_ctx =
+            upipe_get_opaque(first_inner ?: last_inner,
+                             struct upipe_dump_ctx *);
+        struct upipe_dump_ctx *last_ctx =
+            upipe_get_opaque(last_inner ?: first_inner,
+                             struct upipe_dump_ctx *);
+        fprintf(file, ",\"inner\":[%"PRIu64",%"PRIu64"]",
+                first_ctx->input_uid, last_ctx->input_uid);
+    }
+    upipe_bin_thaw(upipe);
+
+    struct upipe *output = NULL;
+    if (ctx->output_uid != UINT64_MAX &&
+        ubase_check(upipe_get_output(upipe, &output)) && output != NULL) {
+        struct upipe_dump_ctx *output_ctx =
+            upipe_get_opaque(output, struct upipe_dump_ctx *);
+        struct uref *flow_def = NULL;
+        const char *def = NULL;
+        upipe_get_flow_def(upipe, &flow_def);
+        if (flow_def != NULL)
+            uref_flow_get_def(flow_def, &def);
+        fprintf(file, ",\"output\":{\"id\":%"PRIu64",\"flow_def\":",
+                output_ctx->input_uid);
+        upipe_dump_json_string(file, def ?: "");
+        fprintf(file, "}");
+    }
+
+    if (upipe->stats != NULL) {
+        struct upipe_stats stats;
+        upipe_stats_read(upipe->stats, &stats);
+        fprintf(file, ",\"stats\":{\"urefs_in\":%"PRIu64
+                ",\"bytes_in\":%"PRIu64",\"urefs_out\":%"PRIu64
+                ",\"bytes_out\":%"PRIu64",\"input_time\":%"PRIu64
+                ",\"input_max\":%"PRIu64",\"controls\":%"PRIu64
+                ",\"control_time\":%"PRIu64",\"ubufs_alloc\":%"PRIu64
+                ",\"ubuf_bytes_alloc\":%"PRIu64"}",
+                stats.urefs_in, stats.bytes_in, stats.urefs_out,
+                stats.bytes_out, stats.input_time, stats.input_max,
+                stats.controls, stats.control_time, stats.ubufs_alloc,
+                stats.ubuf_bytes_alloc);
+    }
+
+    struct upipe_occupancy occupancy;
+    if (ubase_check(upipe_get_occupancy(upipe, &occupancy))) {
+        fprintf(file, ",\"occupancy\":{");
+        upipe_dump_json_value(file, "urefs", occupancy.urefs);
+        fprintf(file, ",");
+        upipe_dump_json_value(file, "max_urefs", occupancy.max_urefs);
+        fprintf(file, ",");
+        upipe_dump_json_value(file, "bytes", occupancy.bytes);
+        fprintf(file, ",");
+        upipe_dump_json_value(file, "duration", occupancy.duration);
+        fprintf(file, "}");
+    }
+    fprintf(file, "}");
+}
+
+/** @internal @This prints the statistics of a pool in JSON format.
+ *
+ * @param file file pointer to write to
+ * @param name name of the pool
+ * @param type type of the pool
+ * @param stats statistics of the pool
+ */
+static void upipe_dump_json_pool(FILE *file, const char *name,
+                                 const char *type,
+                                 const struct upool_stats *stats)
+{
+    fprintf(file, "{\"name\":");
+    upipe_dump_json_string(file, name);
+    fprintf(file, ",\"type\":\"%s\",\"in_use\":%"PRIu64
+            ",\"high_water\":%"PRIu64",\"hits\":%"PRIu64
+            ",\"misses\":%"PRIu64"}",
+            type, stats->in_use, stats->high_water, stats->hits,
+            stats->misses);
+}
+
+/** @internal @This dumps a pipeline in JSON format.
+ *
+ * @param pipe_label function to print pipe labels
+ * @param file file pointer to write to
+ * @param sources array of source pipes
+ * @param nb_sources number of source pipes
+ * @param pools list of pools to report, or NULL
+ */
+static void upipe_dump_json_sources(upipe_dump_pipe_label pipe_label,
+                                    FILE *file, struct upipe **sources,
+                                    unsigned int nb_sources,
+                                    struct uchain *pools)
+{
+    pipe_label = pipe_label ?: upipe_dump_upipe_label_default;
+
+    uint64_t uid = 0;
+    struct uchain list;
+    struct uchain *uchain;
+    ulist_init(&list);
+
+    for (unsigned int i = 0; i < nb_sources; i++)
+        upipe_dump_json_collect(sources[i], &uid, &list, NULL);
+
+    /* Walk through the super-pipes that we may have forgotten. */
+    uint64_t last_uid;
+    do {
+        last_uid = uid;
+        ulist_foreach (&list, uchain) {
+            struct upipe *upipe = upipe_from_uchain(uchain);
+            struct upipe *super = NULL;
+            while (ubase_check(upipe_sub_get_super(upipe, &upipe)) &&
+                   upipe != NULL)
+                super = upipe;
+            if (super != NULL)
+                upipe_dump_json_collect(super, &uid, &list, NULL);
+        }
+    } while (last_uid != uid);
+
+    fprintf(file, "{\"pipes\":[");
+    ulist_foreach (&list, uchain) {
+        if (uchain != list.next)
+            fprintf(file, ",");
+        upipe_dump_json_pipe(pipe_label, file, upipe_from_uchain(uchain));
+    }
+    fprintf(file, "],\"pools\":[");
+    bool first = true;
+    if (pools != NULL) {
+        ulist_foreach (pools, uchain) {
+            struct upipe_dump_pool *pool = upipe_dump_pool_from_uchain(uchain);
+            struct upool_stats stats, shared_stats;
+            if (!ubase_check(upipe_dump_pool_stats(pool, &stats,
+                                                   &shared_stats)))
+                continue;
+            if (!first)
+                fprintf(file, ",");
+            first = false;
+            upipe_dump_json_pool(file, pool->name,
+                                 pool->uref_mgr != NULL ? "uref" : "ubuf",
+                                 &stats);
+            if (pool->ubuf_mgr != NULL) {
+                fprintf(file, ",");
+                upipe_dump_json_pool(file, pool->name, "shared",
+                                     &shared_stats);
+            }
+        }
+    }
+    fprintf(file, "]}\n");
+
+    upipe_dump_clean(&list);
+}
+
+/** @This dumps a pipeline in JSON format.
+ *
+ * @param pipe_label function to print pipe labels
+ * @param file file pointer to write to
+ * @param ulist list of sources pipes in ulist format
+ * @param args list of sources pipes terminated with NULL
+ */
+void upipe_dump_json_va(upipe_dump_pipe_label pipe_label,
+                        FILE *file, struct uchain *ulist, va_list args)
+{
+    unsigned int nb_sources;
+    struct upipe **sources = upipe_dump_sources(ulist, args, &nb_sources);
+    upipe_dump_json_sources(pipe_label, file, sources, nb_sources, NULL);
+    free(sources);
+}
 
 /** @This opens a file and dumps a pipeline in dot format.
  *
@@ -326,3 +827,222 @@ int upipe_dump_open_va(upipe_dump_pipe_label pipe_label,
     fclose(file);
     return UBASE_ERR_NONE;
 }
+
+/** @This is the private context of a live dump. */
+struct upipe_dump_live {
+    /** function to print pipe labels */
+    upipe_dump_pipe_label *pipe_label;
+    /** function to print flow_def labels */
+    upipe_dump_flow_def_label *flow_def_label;
+    /** output format */
+    enum upipe_dump_format format;
+    /** path of the snapshot */
+    char *path;
+    /** path of the temporary file */
+    char *path_tmp;
+    /** timer, or NULL */
+    struct upump *upump;
+    /** source pipes */
+    struct upipe **sources;
+    /** number of source pipes */
+    unsigned int nb_sources;
+    /** list of reported pools */
+    struct uchain pools;
+};
+
+/** @internal @This is called when the snapshot period expires.
+ *
+ * @param upump description structure of the timer
+ */
+static void upipe_dump_live_timer(struct upump *upump)
+{
+    struct upipe_dump_live *live =
+        upump_get_opaque(upump, struct upipe_dump_live *);
+    upipe_dump_live_write(live);
+}
+
+/** @This allocates a live dump, which periodically writes a snapshot of
+ * the pipelines.
+ *
+ * @param upump_mgr upump manager of the thread running the pipes, or NULL
+ * to only write snapshots with @ref upipe_dump_live_write
+ * @param period snapshot period in units of UCLOCK_FREQ
+ * @param format format of the snapshot
+ * @param path path of the file to write
+ * @param pipe_label function to print pipe labels (may be NULL)
+ * @param flow_def_label function to print flow_def labels (may be NULL)
+ * @return pointer to the live dump, or NULL in case of error
+ */
+struct upipe_dump_live *upipe_dump_live_alloc(struct upump_mgr *upump_mgr,
+        uint64_t period, enum upipe_dump_format format, const char *path,
+        upipe_dump_pipe_label pipe_label,
+        upipe_dump_flow_def_label flow_def_label)
+{
+    if (unlikely(path == NULL))
+        return NULL;
+    struct upipe_dump_live *live = malloc(sizeof(struct upipe_dump_live));
+    if (unlikely(live == NULL))
+        return NULL;
+
+    live->pipe_label = pipe_label;
+    live->flow_def_label = flow_def_label;
+    live->format = format;
+    live->path = strdup(path);
+    live->path_tmp = malloc(strlen(path) + sizeof(".tmp"));
+    live->upump = NULL;
+    live->sources = NULL;
+    live->nb_sources = 0;
+    ulist_init(&live->pools);
+    if (unlikely(live->path == NULL || live->path_tmp == NULL)) {
+        upipe_dump_live_free(live);
+        return NULL;
+    }
+    sprintf(live->path_tmp, "%s.tmp", path);
+
+    if (upump_mgr != NULL) {
+        live->upump = upump_alloc_timer(upump_mgr, upipe_dump_live_timer,
+                                        live, NULL, period, period);
+        if (unlikely(live->upump == NULL)) {
+            upipe_dump_live_free(live);
+            return NULL;
+        }
+        upump_start(live->upump);
+    }
+    return live;
+}
+
+/** @This adds a source pipe to a live dump. The live dump keeps a
+ * reference on the pipe until it is freed.
+ *
+ * @param live pointer to the live dump
+ * @param source source pipe
+ * @return an error code
+ */
+int upipe_dump_live_add_source(struct upipe_dump_live *live,
+                               struct upipe *source)
+{
+    struct upipe **sources = realloc(live->sources,
+            (live->nb_sources + 1) * sizeof(struct upipe *));
+    if (unlikely(sources == NULL))
+        return UBASE_ERR_ALLOC;
+    live->sources = sources;
+    live->sources[live->nb_sources++] = upipe_use(source);
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This adds a pool to a live dump.
+ *
+ * @param live pointer to the live dump
+ * @param name name of the pool
+ * @param uref_mgr uref manager, or NULL
+ * @param ubuf_mgr ubuf manager, or NULL
+ * @return an error code
+ */
+static int upipe_dump_live_add_pool(struct upipe_dump_live *live,
+                                    const char *name,
+                                    struct uref_mgr *uref_mgr,
+                                    struct ubuf_mgr *ubuf_mgr)
+{
+    struct upipe_dump_pool *pool = malloc(sizeof(struct upipe_dump_pool));
+    if (unlikely(pool == NULL))
+        return UBASE_ERR_ALLOC;
+    pool->name = strdup(name ?: "");
+    if (unlikely(pool->name == NULL)) {
+        free(pool);
+        return UBASE_ERR_ALLOC;
+    }
+    pool->uref_mgr = uref_mgr_use(uref_mgr);
+    pool->ubuf_mgr = ubuf_mgr_use(ubuf_mgr);
+    uchain_init(&pool->uchain);
+    ulist_add(&live->pools, &pool->uchain);
+    return UBASE_ERR_NONE;
+}
+
+/** @This adds the pool of a uref manager to a live dump. The statistics of
+ * the manager are enabled, which resets them.
+ *
+ * @param live pointer to the live dump
+ * @param name name of the pool
+ * @param uref_mgr uref manager
+ * @return an error code
+ */
+int upipe_dump_live_add_uref_mgr(struct upipe_dump_live *live,
+                                 const char *name, struct uref_mgr *uref_mgr)
+{
+    UBASE_RETURN(uref_mgr_set_stats(uref_mgr, true))
+    return upipe_dump_live_add_pool(live, name, uref_mgr, NULL);
+}
+
+/** @This adds the pools of a ubuf manager to a live dump. The statistics of
+ * the manager are enabled, which resets them.
+ *
+ * @param live pointer to the live dump
+ * @param name name of the pool
+ * @param ubuf_mgr ubuf manager
+ * @return an error code
+ */
+int upipe_dump_live_add_ubuf_mgr(struct upipe_dump_live *live,
+                                 const char *name, struct ubuf_mgr *ubuf_mgr)
+{
+    UBASE_RETURN(ubuf_mgr_set_stats(ubuf_mgr, true))
+    return upipe_dump_live_add_pool(live, name, NULL, ubuf_mgr);
+}
+
+/** @This writes a snapshot of a live dump now. The snapshot is written to a
+ * temporary file, which then replaces the previous snapshot, so readers
+ * never see a partial file.
+ *
+ * @param live pointer to the live dump
+ * @return an error code
+ */
+int upipe_dump_live_write(struct upipe_dump_live *live)
+{
+    FILE *file = fopen(live->path_tmp, "w");
+    if (file == NULL)
+        return UBASE_ERR_EXTERNAL;
+
+    switch (live->format) {
+        case UPIPE_DUMP_FORMAT_DOT:
+            upipe_dump_dot_sources(live->pipe_label, live->flow_def_label,
+                                   file, live->sources, live->nb_sources,
+                                   &live->pools);
+            break;
+        case UPIPE_DUMP_FORMAT_JSON:
+            upipe_dump_json_sources(live->pipe_label, file, live->sources,
+                                    live->nb_sources, &live->pools);
+            break;
+    }
+    if (fclose(file) != 0 || rename(live->path_tmp, live->path) != 0) {
+        unlink(live->path_tmp);
+        return UBASE_ERR_EXTERNAL;
+    }
+    return UBASE_ERR_NONE;
+}
+
+/** @This frees a live dump, and releases the source pipes and managers.
+ *
+ * @param live pointer to the live dump
+ */
+void upipe_dump_live_free(struct upipe_dump_live *live)
+{
+    if (live == NULL)
+        return;
+    if (live->upump != NULL)
+        upump_free(live->upump);
+    for (unsigned int i = 0; i < live->nb_sources; i++)
+        upipe_release(live->sources[i]);
+    free(live->sources);
+
+    struct uchain *uchain, *uchain_tmp;
+    ulist_delete_foreach (&live->pools, uchain, uchain_tmp) {
+        struct upipe_dump_pool *pool = upipe_dump_pool_from_uchain(uchain);
+        ulist_delete(uchain);
+        uref_mgr_release(pool->uref_mgr);
+        ubuf_mgr_release(pool->ubuf_mgr);
+        free(pool->name);
+        free(pool);
+    }
+    free(live->path);
+    free(live->path_tmp);
+    free(live);
+}
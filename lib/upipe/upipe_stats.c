@@ -0,0 +1,348 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/** @file
+ * @short Upipe optional instrumentation of pipes
+ */
+
+#include <upipe/ubase.h>
+#include <upipe/urefcount.h>
+#include <upipe/uclock.h>
+#include <upipe/uref.h>
+#include <upipe/ubuf.h>
+#include <upipe/ubuf_size.h>
+#include <upipe/upipe.h>
+#include <upipe/upipe_stats.h>
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdarg.h>
+#include <time.h>
+
+/** true if counters are attached to all new pipes */
+static bool upipe_stats_global = false;
+
+/** @internal @This is the private context of the counters of a pipe. */
+struct upipe_stats_priv {
+    /** refcount management structure, the pipe and the ubuf wrappers
+     * hold a reference */
+    struct urefcount urefcount;
+    /** public counters */
+    struct upipe_stats stats;
+};
+
+UBASE_FROM_TO(upipe_stats_priv, upipe_stats, stats, stats)
+UBASE_FROM_TO(upipe_stats_priv, urefcount, urefcount, urefcount)
+
+/** @internal @This is the private context of a ubuf manager accounting the
+ * allocations of a pipe. */
+struct upipe_stats_ubuf_mgr {
+    /** refcount management structure */
+    struct urefcount urefcount;
+    /** counters of the pipe */
+    struct upipe_stats_priv *priv;
+    /** wrapped ubuf manager */
+    struct ubuf_mgr *wrapped;
+
+    /** common management structure */
+    struct ubuf_mgr mgr;
+};
+
+UBASE_FROM_TO(upipe_stats_ubuf_mgr, ubuf_mgr, ubuf_mgr, mgr)
+UBASE_FROM_TO(upipe_stats_ubuf_mgr, urefcount, urefcount, urefcount)
+
+/** @internal @This returns a monotonic time.
+ *
+ * @return current time in units of UCLOCK_FREQ
+ */
+static uint64_t upipe_stats_now(void)
+{
+    struct timespec ts;
+    if (unlikely(clock_gettime(CLOCK_MONOTONIC, &ts) == -1))
+        return 0;
+    return ts.tv_sec * UCLOCK_FREQ +
+           ts.tv_nsec * UCLOCK_FREQ / UINT64_C(1000000000);
+}
+
+/** @internal @This adds a value to a counter.
+ *
+ * @param counter pointer to counter
+ * @param value value to add
+ */
+static inline void upipe_stats_add(uint64_t *counter, uint64_t value)
+{
+    __atomic_fetch_add(counter, value, __ATOMIC_RELAXED);
+}
+
+/** @internal @This returns the number of octets carried by a uref.
+ *
+ * @param uref uref structure
+ * @return size in octets
+ */
+static inline uint64_t upipe_stats_size(struct uref *uref)
+{
+    size_t size;
+    if (uref->ubuf == NULL || !ubase_check(ubuf_size(uref->ubuf, &size)))
+        return 0;
+    return size;
+}
+
+/** @This enables or disables the instrumentation of the pipes allocated
+ * from now on. It should be called before the pipelines are built.
+ *
+ * @param enabled true to attach counters to all new pipes
+ */
+void upipe_stats_set_global(bool enabled)
+{
+    upipe_stats_global = enabled;
+}
+
+/** @internal @This frees the counters when the last reference is released.
+ *
+ * @param urefcount pointer to the urefcount structure
+ */
+static void upipe_stats_free(struct urefcount *urefcount)
+{
+    struct upipe_stats_priv *priv = upipe_stats_priv_from_urefcount(urefcount);
+    urefcount_clean(urefcount);
+    free(priv);
+}
+
+/** @internal @This allocates counters.
+ *
+ * @return pointer to counters, or NULL in case of allocation error
+ */
+static struct upipe_stats *upipe_stats_alloc(void)
+{
+    struct upipe_stats_priv *priv = calloc(1, sizeof(struct upipe_stats_priv));
+    if (unlikely(priv == NULL))
+        return NULL;
+    urefcount_init(&priv->urefcount, upipe_stats_free);
+    return upipe_stats_priv_to_stats(priv);
+}
+
+/** @internal @This allocates counters for a new pipe if the instrumentation
+ * is enabled globally.
+ *
+ * @return pointer to counters, or NULL
+ */
+struct upipe_stats *upipe_stats_alloc_default(void)
+{
+    if (likely(!upipe_stats_global))
+        return NULL;
+    return upipe_stats_alloc();
+}
+
+/** @This attaches counters to a pipe, if it doesn't have them already. It
+ * must be called from the thread running the pipe.
+ *
+ * @param upipe description structure of the pipe
+ * @return an error code
+ */
+int upipe_stats_enable(struct upipe *upipe)
+{
+    if (upipe->stats != NULL)
+        return UBASE_ERR_NONE;
+    upipe->stats = upipe_stats_alloc();
+    UBASE_ALLOC_RETURN(upipe->stats);
+    return UBASE_ERR_NONE;
+}
+
+/** @This detaches and frees the counters of a pipe. It must be called from
+ * the thread running the pipe.
+ *
+ * @param upipe description structure of the pipe
+ */
+void upipe_stats_disable(struct upipe *upipe)
+{
+    if (upipe->stats == NULL)
+        return;
+    urefcount_release(&upipe_stats_priv_from_stats(upipe->stats)->urefcount);
+    upipe->stats = NULL;
+}
+
+/** @internal @This sends a uref to an instrumented pipe.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref uref structure to send
+ * @param upump_p reference to the pump that generated the buffer
+ */
+void upipe_stats_input(struct upipe *upipe, struct uref *uref,
+                       struct upump **upump_p)
+{
+    struct upipe_stats *stats = upipe->stats;
+    upipe_stats_add(&stats->urefs_in, 1);
+    upipe_stats_add(&stats->bytes_in, upipe_stats_size(uref));
+
+    uint64_t start = upipe_stats_now();
+    upipe->mgr->upipe_input(upipe, uref, upump_p);
+    uint64_t duration = upipe_stats_now() - start;
+
+    /* the pipe may have disabled its counters */
+    stats = upipe->stats;
+    if (unlikely(stats == NULL))
+        return;
+    upipe_stats_add(&stats->input_time, duration);
+    if (duration > __atomic_load_n(&stats->input_max, __ATOMIC_RELAXED))
+        __atomic_store_n(&stats->input_max, duration, __ATOMIC_RELAXED);
+}
+
+/** @internal @This sends a control command to an instrumented pipe, and
+ * handles @ref UPIPE_GET_STATS.
+ *
+ * @param upipe description structure of the pipe
+ * @param command control command to send
+ * @param args optional read or write parameters
+ * @return an error code
+ */
+int upipe_stats_control(struct upipe *upipe, int command, va_list args)
+{
+    if (command == UPIPE_GET_STATS) {
+        struct upipe_stats *copy = va_arg(args, struct upipe_stats *);
+        upipe_stats_read(upipe->stats, copy);
+        return UBASE_ERR_NONE;
+    }
+
+    uint64_t start = upipe_stats_now();
+    int err = upipe->mgr->upipe_control(upipe, command, args);
+    uint64_t duration = upipe_stats_now() - start;
+
+    struct upipe_stats *stats = upipe->stats;
+    if (likely(stats != NULL)) {
+        upipe_stats_add(&stats->controls, 1);
+        upipe_stats_add(&stats->control_time, duration);
+    }
+    return err;
+}
+
+/** @internal @This accounts a uref output by an instrumented pipe.
+ *
+ * @param upipe description structure of the pipe
+ * @param uref uref structure output
+ */
+void upipe_stats_output(struct upipe *upipe, struct uref *uref)
+{
+    struct upipe_stats *stats = upipe->stats;
+    upipe_stats_add(&stats->urefs_out, 1);
+    upipe_stats_add(&stats->bytes_out, upipe_stats_size(uref));
+}
+
+/** @internal @This allocates a ubuf from the wrapped manager and accounts
+ * it.
+ *
+ * @param mgr common management structure
+ * @param signature signature of the allocator
+ * @param args optional arguments of the allocator
+ * @return pointer to ubuf or NULL in case of failure
+ */
+static struct ubuf *upipe_stats_ubuf_alloc(struct ubuf_mgr *mgr,
+                                           uint32_t signature, va_list args)
+{
+    struct upipe_stats_ubuf_mgr *wrapper =
+        upipe_stats_ubuf_mgr_from_ubuf_mgr(mgr);
+    struct ubuf_mgr *wrapped = wrapper->wrapped;
+    struct ubuf *ubuf = wrapped->ubuf_alloc(wrapped, signature, args);
+    if (unlikely(ubuf == NULL))
+        return NULL;
+
+    size_t size;
+    struct upipe_stats *stats = &wrapper->priv->stats;
+    upipe_stats_add(&stats->ubufs_alloc, 1);
+    if (ubase_check(ubuf_size(ubuf, &size)))
+        upipe_stats_add(&stats->ubuf_bytes_alloc, size);
+    return ubuf;
+}
+
+/** @internal @This handles the control commands of the wrapping manager,
+ * and forwards the others to the wrapped manager.
+ *
+ * @param mgr common management structure
+ * @param command type of command to process
+ * @param args optional arguments
+ * @return an error code
+ */
+static int upipe_stats_ubuf_mgr_control(struct ubuf_mgr *mgr,
+                                        int command, va_list args)
+{
+    struct upipe_stats_ubuf_mgr *wrapper =
+        upipe_stats_ubuf_mgr_from_ubuf_mgr(mgr);
+    if (command == UBUF_MGR_UNWRAP) {
+        struct ubuf_mgr **wrapped_p = va_arg(args, struct ubuf_mgr **);
+        *wrapped_p = wrapper->wrapped;
+        return UBASE_ERR_NONE;
+    }
+    return ubuf_mgr_control_va(wrapper->wrapped, command, args);
+}
+
+/** @internal @This frees the wrapping manager.
+ *
+ * @param urefcount pointer to the urefcount structure
+ */
+static void upipe_stats_ubuf_mgr_free(struct urefcount *urefcount)
+{
+    struct upipe_stats_ubuf_mgr *wrapper =
+        upipe_stats_ubuf_mgr_from_urefcount(urefcount);
+    ubuf_mgr_release(wrapper->wrapped);
+    urefcount_release(&wrapper->priv->urefcount);
+    urefcount_clean(urefcount);
+    free(wrapper);
+}
+
+/** @internal @This wraps the ubuf manager of an instrumented pipe so that
+ * the buffers it allocates are accounted in the counters of the pipe. The
+ * wrapper keeps the counters alive, so it may outlive the pipe or be passed
+ * to other threads.
+ *
+ * @param upipe description structure of the pipe
+ * @param ubuf_mgr ubuf manager to wrap (belongs to the callee)
+ * @return pointer to the wrapping manager, or ubuf_mgr if the pipe is not
+ * instrumented or in case of allocation error
+ */
+struct ubuf_mgr *upipe_stats_wrap_ubuf_mgr(struct upipe *upipe,
+                                           struct ubuf_mgr *ubuf_mgr)
+{
+    if (upipe->stats == NULL || ubuf_mgr == NULL)
+        return ubuf_mgr;
+
+    struct upipe_stats_ubuf_mgr *wrapper =
+        malloc(sizeof(struct upipe_stats_ubuf_mgr));
+    if (unlikely(wrapper == NULL))
+        return ubuf_mgr;
+
+    struct upipe_stats_priv *priv = upipe_stats_priv_from_stats(upipe->stats);
+    urefcount_use(&priv->urefcount);
+    wrapper->priv = priv;
+    wrapper->wrapped = ubuf_mgr;
+    urefcount_init(&wrapper->urefcount, upipe_stats_ubuf_mgr_free);
+    wrapper->mgr.refcount = &wrapper->urefcount;
+    wrapper->mgr.signature = ubuf_mgr->signature;
+    wrapper->mgr.ubuf_alloc = upipe_stats_ubuf_alloc;
+    /* the ubufs reference the wrapped manager */
+    wrapper->mgr.ubuf_control = NULL;
+    wrapper->mgr.ubuf_free = NULL;
+    wrapper->mgr.ubuf_mgr_control = upipe_stats_ubuf_mgr_control;
+    return &wrapper->mgr;
+}
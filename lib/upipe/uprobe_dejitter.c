@@ -40,12 +40,14 @@
 #include <upipe/uclock.h>
 #include <upipe/uref.h>
 #include <upipe/uref_clock.h>
+#include <upipe/uhist.h>
 #include <upipe/uprobe.h>
 #include <upipe/uprobe_dejitter.h>
 #include <upipe/uprobe_helper_alloc.h>
 #include <upipe/upipe.h>
 
 #include <stdlib.h>
+#include <string.h>
 #include <stdarg.h>
 #include <math.h>
 #include <assert.h>
@@ -75,6 +77,79 @@
 /** debug print periodicity */
 #define PRINT_PERIODICITY (60 * UCLOCK_FREQ)
 
+/** @internal @This holds the rolling histograms of the clock recovery. */
+struct uprobe_dejitter_hists {
+    /** index of the current window */
+    unsigned int current;
+    /** cr_sys of the beginning of the current window, or UINT64_MAX */
+    uint64_t window_start;
+    /** cr_sys of the beginning of the previous window, or UINT64_MAX */
+    uint64_t prev_start;
+    /** cr_sys of the last recorded clock reference */
+    uint64_t last_cr_sys;
+    /** input jitter, per window */
+    struct uhist jitter[2];
+    /** PLL phase error, per window */
+    struct uhist error[2];
+    /** average absolute deviation, per window */
+    struct uhist deviation[2];
+};
+
+/** @internal @This resets the rolling histograms.
+ *
+ * @param hists rolling histograms
+ */
+static void uprobe_dejitter_hists_reset(struct uprobe_dejitter_hists *hists)
+{
+    hists->current = 0;
+    hists->window_start = hists->prev_start = hists->last_cr_sys = UINT64_MAX;
+    for (unsigned int i = 0; i < 2; i++) {
+        uhist_init(&hists->jitter[i]);
+        uhist_init(&hists->error[i]);
+        uhist_init(&hists->deviation[i]);
+    }
+}
+
+/** @internal @This records a clock reference in the rolling histograms.
+ *
+ * @param uprobe_dejitter private structure of the probe
+ * @param cr_sys system date of the clock reference
+ * @param jitter absolute input jitter
+ * @param error absolute PLL phase error
+ */
+static void uprobe_dejitter_record(struct uprobe_dejitter *uprobe_dejitter,
+                                   uint64_t cr_sys, uint64_t jitter,
+                                   uint64_t error)
+{
+    struct uprobe_dejitter_hists *hists = uprobe_dejitter->hists;
+    if (hists->window_start == UINT64_MAX)
+        hists->window_start = cr_sys;
+    else if (cr_sys >= hists->window_start + uprobe_dejitter->stats_window) {
+        hists->current ^= 1;
+        uhist_init(&hists->jitter[hists->current]);
+        uhist_init(&hists->error[hists->current]);
+        uhist_init(&hists->deviation[hists->current]);
+        /* drop the previous window if it is too old */
+        hists->prev_start = cr_sys < hists->window_start +
+                            2 * uprobe_dejitter->stats_window ?
+                            hists->window_start : UINT64_MAX;
+        if (hists->prev_start == UINT64_MAX) {
+            unsigned int prev = hists->current ^ 1;
+            uhist_init(&hists->jitter[prev]);
+            uhist_init(&hists->error[prev]);
+            uhist_init(&hists->deviation[prev]);
+        }
+        hists->window_start = cr_sys;
+    }
+    hists->last_cr_sys = cr_sys;
+
+    unsigned int current = hists->current;
+    uhist_add(&hists->jitter[current], jitter);
+    uhist_add(&hists->error[current], error);
+    uhist_add(&hists->deviation[current],
+              (uint64_t)(uprobe_dejitter->deviation + .5));
+}
+
 /** @internal @This catches clock_ref events thrown by pipes.
  *
  * @param uprobe pointer to probe
@@ -190,6 +265,11 @@ static int uprobe_dejitter_clock_ref(struct uprobe *uprobe, struct upipe *upipe,
         uprobe_dejitter->drift_rate = drift_rate;
     }
 
+    if (uprobe_dejitter->hists != NULL && !discontinuity)
+        uprobe_dejitter_record(uprobe_dejitter, cr_sys,
+                               (uint64_t)(fabs(deviation) + .5),
+                               error_offset < 0 ? -error_offset : error_offset);
+
     if (cr_sys > uprobe_dejitter->last_print + PRINT_PERIODICITY) {
         upipe_dbg_va(upipe,
                 "dejitter drift %f error %"PRId64" deviation %g",
@@ -288,6 +368,81 @@ void uprobe_dejitter_set(struct uprobe *uprobe, bool enabled,
         uprobe_dejitter->deviation = DEFAULT_INITIAL_DEVIATION;
 }
 
+/** @This enables or disables the clock recovery statistics.
+ *
+ * @param uprobe pointer to probe
+ * @param window duration of a window in 27 MHz units, or 0 to disable
+ * @return an error code
+ */
+int uprobe_dejitter_set_stats(struct uprobe *uprobe, uint64_t window)
+{
+    struct uprobe_dejitter *uprobe_dejitter =
+        uprobe_dejitter_from_uprobe(uprobe);
+    if (!window) {
+        free(uprobe_dejitter->hists);
+        uprobe_dejitter->hists = NULL;
+        uprobe_dejitter->stats_window = 0;
+        return UBASE_ERR_NONE;
+    }
+
+    if (uprobe_dejitter->hists == NULL) {
+        uprobe_dejitter->hists = malloc(sizeof(struct uprobe_dejitter_hists));
+        if (unlikely(uprobe_dejitter->hists == NULL))
+            return UBASE_ERR_ALLOC;
+    }
+    uprobe_dejitter->stats_window = window;
+    uprobe_dejitter_hists_reset(uprobe_dejitter->hists);
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This computes the quantiles of a measure over both windows.
+ *
+ * @param hists two histograms of the measure
+ * @param quantiles filled in with the quantiles
+ */
+static void uprobe_dejitter_quantiles(const struct uhist hists[2],
+        struct uprobe_dejitter_quantiles *quantiles)
+{
+    static const unsigned int permille[] = { 500, 900, 990, 999 };
+    uint64_t values[UBASE_ARRAY_SIZE(permille)];
+    struct uhist merged = hists[0];
+    uhist_merge(&merged, &hists[1]);
+    uhist_quantiles(&merged, UBASE_ARRAY_SIZE(permille), permille, values);
+    quantiles->min = merged.count ? merged.min : 0;
+    quantiles->p50 = values[0];
+    quantiles->p90 = values[1];
+    quantiles->p99 = values[2];
+    quantiles->p999 = values[3];
+    quantiles->max = merged.max;
+}
+
+/** @This returns the clock recovery statistics.
+ *
+ * @param uprobe pointer to probe
+ * @param stats filled in with the statistics
+ * @return an error code, UBASE_ERR_INVALID if statistics are disabled
+ */
+int uprobe_dejitter_get_stats(struct uprobe *uprobe,
+                              struct uprobe_dejitter_stats *stats)
+{
+    struct uprobe_dejitter *uprobe_dejitter =
+        uprobe_dejitter_from_uprobe(uprobe);
+    struct uprobe_dejitter_hists *hists = uprobe_dejitter->hists;
+    if (unlikely(hists == NULL || stats == NULL))
+        return UBASE_ERR_INVALID;
+
+    memset(stats, 0, sizeof(*stats));
+    uint64_t start = hists->prev_start != UINT64_MAX ?
+                     hists->prev_start : hists->window_start;
+    if (start != UINT64_MAX)
+        stats->duration = hists->last_cr_sys - start;
+    stats->count = hists->jitter[0].count + hists->jitter[1].count;
+    uprobe_dejitter_quantiles(hists->jitter, &stats->jitter);
+    uprobe_dejitter_quantiles(hists->error, &stats->error);
+    uprobe_dejitter_quantiles(hists->deviation, &stats->deviation);
+    return UBASE_ERR_NONE;
+}
+
 /** @This initializes an already allocated uprobe_dejitter structure.
  *
  * @param uprobe_pfx pointer to the already allocated structure
@@ -304,8 +459,12 @@ struct uprobe *uprobe_dejitter_init(struct uprobe_dejitter *uprobe_dejitter,
     struct uprobe *uprobe = uprobe_dejitter_to_uprobe(uprobe_dejitter);
     uprobe_dejitter->drift_rate.num = uprobe_dejitter->drift_rate.den = 1;
     uprobe_dejitter->last_print = 0;
+    uprobe_dejitter->stats_window = 0;
+    uprobe_dejitter->hists = NULL;
     uprobe_dejitter_set(uprobe, enabled, deviation);
     uprobe_init(uprobe, uprobe_dejitter_throw, next);
+    uprobe_set_event_mask(uprobe, UPROBE_EVENT_MASK(UPROBE_CLOCK_REF) |
+                                  UPROBE_EVENT_MASK(UPROBE_CLOCK_TS));
     return uprobe;
 }
 
@@ -317,6 +476,7 @@ void uprobe_dejitter_clean(struct uprobe_dejitter *uprobe_dejitter)
 {
     assert(uprobe_dejitter != NULL);
     struct uprobe *uprobe = uprobe_dejitter_to_uprobe(uprobe_dejitter);
+    free(uprobe_dejitter->hists);
     uprobe_clean(uprobe);
 }
 
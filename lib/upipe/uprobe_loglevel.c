@@ -79,6 +79,9 @@ struct uprobe *uprobe_loglevel_init(struct uprobe_loglevel *uprobe_loglevel,
     assert(uprobe_loglevel);
     struct uprobe *uprobe = uprobe_loglevel_to_uprobe(uprobe_loglevel);
     uprobe_init(uprobe, uprobe_loglevel_throw, next);
+    /* patterns may be added later, so no level is enforced on the chain */
+    uprobe_set_event_mask(uprobe, UPROBE_EVENT_MASK(UPROBE_LOG));
+    uprobe_set_log_filter(uprobe, UPROBE_LOG_VERBOSE);
     ulist_init(&uprobe_loglevel->patterns);
     uprobe_loglevel->min_level = min_level;
     return uprobe;
@@ -91,6 +91,8 @@ struct uprobe *uprobe_pfx_init(struct uprobe_pfx *uprobe_pfx,
         uprobe_pfx->name = NULL;
     uprobe_pfx->min_level = min_level;
     uprobe_init(uprobe, uprobe_pfx_throw, next);
+    uprobe_set_event_mask(uprobe, UPROBE_EVENT_MASK(UPROBE_LOG));
+    uprobe_set_log_filter(uprobe, min_level);
     return uprobe;
 }
 
@@ -209,6 +209,8 @@ struct uprobe *uprobe_stdio_init(struct uprobe_stdio *uprobe_stdio,
     uprobe_stdio->min_level = min_level;
     uprobe_stdio->colored = isatty(fileno(stream));
     uprobe_init(uprobe, uprobe_stdio_throw, next);
+    uprobe_set_event_mask(uprobe, UPROBE_EVENT_MASK(UPROBE_LOG));
+    uprobe_set_log_level(uprobe, min_level);
     return uprobe;
 }
 
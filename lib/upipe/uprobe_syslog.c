@@ -130,6 +130,8 @@ struct uprobe *uprobe_syslog_init(struct uprobe_syslog *uprobe_syslog,
         openlog(uprobe_syslog->ident, option, facility);
 
     uprobe_init(uprobe, uprobe_syslog_throw, next);
+    uprobe_set_event_mask(uprobe, UPROBE_EVENT_MASK(UPROBE_LOG));
+    uprobe_set_log_level(uprobe, min_level);
     return uprobe;
 }
 
@@ -109,6 +109,7 @@ struct uprobe *uprobe_ubuf_mem_init(struct uprobe_ubuf_mem *uprobe_ubuf_mem,
     uprobe_ubuf_mem->ubuf_pool_depth = ubuf_pool_depth;
     uprobe_ubuf_mem->shared_pool_depth = shared_pool_depth;
     uprobe_init(uprobe, uprobe_ubuf_mem_throw, next);
+    uprobe_set_event_mask(uprobe, UPROBE_EVENT_MASK(UPROBE_PROVIDE_REQUEST));
     return uprobe;
 }
 
@@ -148,6 +148,7 @@ struct uprobe *
     uprobe_ubuf_mem_pool->shared_pool_depth = shared_pool_depth;
     uatomic_ptr_init(&uprobe_ubuf_mem_pool->first, NULL);
     uprobe_init(uprobe, uprobe_ubuf_mem_pool_throw, next);
+    uprobe_set_event_mask(uprobe, UPROBE_EVENT_MASK(UPROBE_PROVIDE_REQUEST));
     return uprobe;
 }
 
@@ -80,6 +80,7 @@ struct uprobe *uprobe_uref_mgr_init(struct uprobe_uref_mgr *uprobe_uref_mgr,
     struct uprobe *uprobe = uprobe_uref_mgr_to_uprobe(uprobe_uref_mgr);
     uprobe_uref_mgr->uref_mgr = uref_mgr_use(uref_mgr);
     uprobe_init(uprobe, uprobe_uref_mgr_throw, next);
+    uprobe_set_event_mask(uprobe, UPROBE_EVENT_MASK(UPROBE_PROVIDE_REQUEST));
     return uprobe;
 }
 
@@ -32,6 +32,7 @@
 #include <upipe/upool.h>
 #include <upipe/upump_common.h>
 #include <upipe/upump_blocker.h>
+#include <upipe/utrace.h>
 
 #include <stdlib.h>
 
@@ -141,7 +142,9 @@ void upump_common_init(struct upump *upump)
 void upump_common_dispatch(struct upump *upump)
 {
     struct urefcount *refcount = urefcount_use(upump->refcount);
+    UTRACE2(upump_dispatch, upump, upump->cb);
     upump->cb(upump);
+    UTRACE2(upump_dispatch_return, upump, upump->cb);
     urefcount_release(refcount);
 }
 
@@ -0,0 +1,493 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short Upipe timer wheel on top of another upump manager
+ *
+ * The wheel has four levels of 256 slots. A timer due in less than 256
+ * slots sits in the first level, one due in less than 65536 slots in the
+ * second level, and so on. When the index of a level wraps around, the
+ * current slot of the next level is cascaded into the lower levels, so
+ * that each timer is moved at most three times before it expires.
+ */
+
+#include <upipe/ubase.h>
+#include <upipe/ulist.h>
+#include <upipe/urefcount.h>
+#include <upipe/uclock.h>
+#include <upipe/upool.h>
+#include <upipe/upump.h>
+#include <upipe/upump_common.h>
+#include <upipe/upump_wheel.h>
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdarg.h>
+
+/** log2 of the number of slots per level */
+#define WHEEL_BITS 8
+/** number of slots per level */
+#define WHEEL_SIZE (1 << WHEEL_BITS)
+/** mask of the index of a slot */
+#define WHEEL_MASK (WHEEL_SIZE - 1)
+/** number of levels */
+#define WHEEL_LEVELS 4
+/** maximum number of slots before the expiration of a timer */
+#define WHEEL_MAX_DELTA ((UINT64_C(1) << (WHEEL_BITS * WHEEL_LEVELS)) - 1)
+
+/** @This stores management parameters and local structures.
+ */
+struct upump_wheel_mgr {
+    /** refcount management structure */
+    struct urefcount urefcount;
+
+    /** underlying manager */
+    struct upump_mgr *base;
+    /** clock giving the current date */
+    struct uclock *uclock;
+    /** duration of a slot */
+    uint64_t granularity;
+    /** periodic timer of the underlying manager */
+    struct upump *tick;
+    /** last processed slot */
+    uint64_t now;
+    /** number of armed timers */
+    unsigned int nb_armed;
+    /** number of armed blocking timers */
+    unsigned int nb_blocking;
+    /** lists of timers per level and slot */
+    struct uchain slots[WHEEL_LEVELS][WHEEL_SIZE];
+
+    /** common structure */
+    struct upump_common_mgr common_mgr;
+
+    /** extra space for upool */
+    uint8_t upool_extra[];
+};
+
+UBASE_FROM_TO(upump_wheel_mgr, upump_mgr, upump_mgr, common_mgr.mgr)
+UBASE_FROM_TO(upump_wheel_mgr, urefcount, urefcount, urefcount)
+
+/** @This stores local structures.
+ */
+struct upump_wheel {
+    /** structure for the list of the slot */
+    struct uchain uchain;
+    /** delay before the first expiration */
+    uint64_t after;
+    /** delay between expirations, or 0 */
+    uint64_t repeat;
+    /** slot of expiration */
+    uint64_t expire;
+    /** true if the timer is in a slot */
+    bool armed;
+    /** blocking status of the armed timer */
+    bool status;
+
+    /** common structure */
+    struct upump_common common;
+};
+
+UBASE_FROM_TO(upump_wheel, upump, upump, common.upump)
+UBASE_FROM_TO(upump_wheel, uchain, uchain, uchain)
+
+/** @internal @This returns the current slot.
+ *
+ * @param wheel_mgr pointer to the wheel manager
+ * @param delay delay to add to the current date
+ * @return index of the slot, rounded up
+ */
+static uint64_t upump_wheel_mgr_slot(struct upump_wheel_mgr *wheel_mgr,
+                                     uint64_t delay)
+{
+    uint64_t date = uclock_now(wheel_mgr->uclock) + delay;
+    return (date + wheel_mgr->granularity - 1) / wheel_mgr->granularity;
+}
+
+/** @internal @This inserts a timer in its slot, relative to the last
+ * processed slot. A timer beyond the range of the wheel is parked in the
+ * farthest slot, and inserted again with its remaining delay when that
+ * slot is cascaded.
+ *
+ * @param wheel_mgr pointer to the wheel manager
+ * @param upump_wheel timer to insert
+ */
+static void upump_wheel_insert(struct upump_wheel_mgr *wheel_mgr,
+                               struct upump_wheel *upump_wheel)
+{
+    uint64_t delta = upump_wheel->expire - wheel_mgr->now;
+    uint64_t slot = upump_wheel->expire;
+    if (unlikely(delta > WHEEL_MAX_DELTA)) {
+        slot = wheel_mgr->now + WHEEL_MAX_DELTA;
+        delta = WHEEL_MAX_DELTA;
+    }
+
+    unsigned int level = 0;
+    while (level < WHEEL_LEVELS - 1 &&
+           delta >= UINT64_C(1) << (WHEEL_BITS * (level + 1)))
+        level++;
+    unsigned int index = (slot >> (WHEEL_BITS * level)) & WHEEL_MASK;
+    ulist_add(&wheel_mgr->slots[level][index],
+              upump_wheel_to_uchain(upump_wheel));
+}
+
+/** @internal @This accounts a timer which is no longer armed.
+ *
+ * @param wheel_mgr pointer to the wheel manager
+ * @param upump_wheel timer
+ */
+static void upump_wheel_disarm(struct upump_wheel_mgr *wheel_mgr,
+                               struct upump_wheel *upump_wheel)
+{
+    upump_wheel->armed = false;
+    if (upump_wheel->status && !--wheel_mgr->nb_blocking)
+        upump_set_status(wheel_mgr->tick, false);
+    if (!--wheel_mgr->nb_armed)
+        upump_stop(wheel_mgr->tick);
+}
+
+/** @internal @This moves the timers of a slot to the lower levels.
+ *
+ * @param wheel_mgr pointer to the wheel manager
+ * @param level level of the slot
+ * @return true if the next level must also be cascaded
+ */
+static bool upump_wheel_cascade(struct upump_wheel_mgr *wheel_mgr,
+                                unsigned int level)
+{
+    unsigned int index = (wheel_mgr->now >> (WHEEL_BITS * level)) & WHEEL_MASK;
+    struct uchain *slot = &wheel_mgr->slots[level][index];
+    struct uchain *uchain;
+    while ((uchain = ulist_pop(slot)) != NULL)
+        upump_wheel_insert(wheel_mgr, upump_wheel_from_uchain(uchain));
+    return !index;
+}
+
+/** @internal @This processes the next slot.
+ *
+ * @param wheel_mgr pointer to the wheel manager
+ */
+static void upump_wheel_mgr_advance(struct upump_wheel_mgr *wheel_mgr)
+{
+    wheel_mgr->now++;
+    unsigned int index = wheel_mgr->now & WHEEL_MASK;
+    for (unsigned int level = 1; !index && level < WHEEL_LEVELS; level++)
+        if (!upump_wheel_cascade(wheel_mgr, level))
+            break;
+
+    /* timers started from the callbacks go to later slots */
+    struct uchain *slot = &wheel_mgr->slots[0][index];
+    struct uchain *uchain;
+    while ((uchain = ulist_pop(slot)) != NULL) {
+        struct upump_wheel *upump_wheel = upump_wheel_from_uchain(uchain);
+        struct upump *upump = upump_wheel_to_upump(upump_wheel);
+        if (upump_wheel->repeat) {
+            upump_wheel->expire = wheel_mgr->now +
+                (upump_wheel->repeat + wheel_mgr->granularity - 1) /
+                wheel_mgr->granularity;
+            upump_wheel_insert(wheel_mgr, upump_wheel);
+        } else
+            upump_wheel_disarm(wheel_mgr, upump_wheel);
+        upump_common_dispatch(upump);
+    }
+}
+
+/** @internal @This is called by the periodic timer of the underlying
+ * manager, and processes all the elapsed slots at once.
+ *
+ * @param tick description structure of the periodic timer
+ */
+static void upump_wheel_mgr_tick(struct upump *tick)
+{
+    struct upump_wheel_mgr *wheel_mgr =
+        upump_get_opaque(tick, struct upump_wheel_mgr *);
+    uint64_t date = uclock_now(wheel_mgr->uclock) / wheel_mgr->granularity;
+    /* keep the manager while the callbacks release their pumps */
+    upump_mgr_use(upump_wheel_mgr_to_upump_mgr(wheel_mgr));
+    while (wheel_mgr->now < date && wheel_mgr->nb_armed)
+        upump_wheel_mgr_advance(wheel_mgr);
+    if (!wheel_mgr->nb_armed)
+        wheel_mgr->now = date;
+    upump_mgr_release(upump_wheel_mgr_to_upump_mgr(wheel_mgr));
+}
+
+/** @This allocates a new pump.
+ *
+ * @param mgr pointer to a upump_mgr structure wrapped into a
+ * upump_wheel_mgr structure
+ * @param event type of event to watch for
+ * @param args optional parameters depending on event type
+ * @return pointer to allocated pump, or NULL in case of failure
+ */
+static struct upump *upump_wheel_alloc(struct upump_mgr *mgr,
+                                       int event, va_list args)
+{
+    struct upump_wheel_mgr *wheel_mgr = upump_wheel_mgr_from_upump_mgr(mgr);
+    if (event != UPUMP_TYPE_TIMER) {
+        struct upump_mgr *base = wheel_mgr->base;
+        return base->upump_alloc(base, event, args);
+    }
+
+    struct upump_wheel *upump_wheel =
+        upool_alloc(&wheel_mgr->common_mgr.upump_pool, struct upump_wheel *);
+    if (unlikely(upump_wheel == NULL))
+        return NULL;
+    struct upump *upump = upump_wheel_to_upump(upump_wheel);
+
+    upump_wheel->after = va_arg(args, uint64_t);
+    upump_wheel->repeat = va_arg(args, uint64_t);
+    upump_wheel->armed = false;
+    uchain_init(upump_wheel_to_uchain(upump_wheel));
+    upump_common_init(upump);
+    return upump;
+}
+
+/** @This starts a pump.
+ *
+ * @param upump description structure of the pump
+ * @param status blocking status of the pump
+ */
+static void upump_wheel_real_start(struct upump *upump, bool status)
+{
+    struct upump_wheel *upump_wheel = upump_wheel_from_upump(upump);
+    struct upump_wheel_mgr *wheel_mgr =
+        upump_wheel_mgr_from_upump_mgr(upump->mgr);
+    if (unlikely(upump_wheel->armed))
+        return;
+
+    if (!wheel_mgr->nb_armed) {
+        wheel_mgr->now = upump_wheel_mgr_slot(wheel_mgr, 0);
+        upump_start(wheel_mgr->tick);
+    }
+    wheel_mgr->nb_armed++;
+    upump_wheel->status = status;
+    if (status && !wheel_mgr->nb_blocking++)
+        upump_set_status(wheel_mgr->tick, true);
+
+    upump_wheel->expire = upump_wheel_mgr_slot(wheel_mgr, upump_wheel->after);
+    if (upump_wheel->expire <= wheel_mgr->now)
+        upump_wheel->expire = wheel_mgr->now + 1;
+    upump_wheel->armed = true;
+    upump_wheel_insert(wheel_mgr, upump_wheel);
+}
+
+/** @This stops a pump.
+ *
+ * @param upump description structure of the pump
+ * @param status blocking status of the pump
+ */
+static void upump_wheel_real_stop(struct upump *upump, bool status)
+{
+    struct upump_wheel *upump_wheel = upump_wheel_from_upump(upump);
+    struct upump_wheel_mgr *wheel_mgr =
+        upump_wheel_mgr_from_upump_mgr(upump->mgr);
+    if (!upump_wheel->armed)
+        return;
+
+    ulist_delete(upump_wheel_to_uchain(upump_wheel));
+    upump_wheel_disarm(wheel_mgr, upump_wheel);
+}
+
+/** @This released the memory space previously used by a pump.
+ *
+ * @param upump description structure of the pump
+ */
+static void upump_wheel_free(struct upump *upump)
+{
+    struct upump_wheel_mgr *wheel_mgr =
+        upump_wheel_mgr_from_upump_mgr(upump->mgr);
+    upump_stop(upump);
+    upump_common_clean(upump);
+    struct upump_wheel *upump_wheel = upump_wheel_from_upump(upump);
+    upool_free(&wheel_mgr->common_mgr.upump_pool, upump_wheel);
+}
+
+/** @internal @This allocates the data structure.
+ *
+ * @param upool pointer to upool
+ * @return pointer to upump_wheel or NULL in case of allocation error
+ */
+static void *upump_wheel_alloc_inner(struct upool *upool)
+{
+    struct upump_common_mgr *common_mgr =
+        upump_common_mgr_from_upump_pool(upool);
+    struct upump_wheel *upump_wheel = malloc(sizeof(struct upump_wheel));
+    if (unlikely(upump_wheel == NULL))
+        return NULL;
+    struct upump *upump = upump_wheel_to_upump(upump_wheel);
+    upump->mgr = upump_common_mgr_to_upump_mgr(common_mgr);
+    return upump_wheel;
+}
+
+/** @internal @This frees a upump_wheel.
+ *
+ * @param upool pointer to upool
+ * @param upump_wheel pointer to a upump_wheel structure to free
+ */
+static void upump_wheel_free_inner(struct upool *upool, void *upump_wheel)
+{
+    free(upump_wheel);
+}
+
+/** @This processes control commands on a upump_wheel.
+ *
+ * @param upump description structure of the pump
+ * @param command type of command to process
+ * @param args arguments of the command
+ * @return an error code
+ */
+static int upump_wheel_control(struct upump *upump, int command, va_list args)
+{
+    switch (command) {
+        case UPUMP_START:
+            upump_common_start(upump);
+            return UBASE_ERR_NONE;
+        case UPUMP_STOP:
+            upump_common_stop(upump);
+            return UBASE_ERR_NONE;
+        case UPUMP_FREE:
+            upump_wheel_free(upump);
+            return UBASE_ERR_NONE;
+        case UPUMP_GET_STATUS: {
+            int *status_p = va_arg(args, int *);
+            upump_common_get_status(upump, status_p);
+            return UBASE_ERR_NONE;
+        }
+        case UPUMP_SET_STATUS: {
+            int status = va_arg(args, int);
+            upump_common_set_status(upump, status);
+            return UBASE_ERR_NONE;
+        }
+        case UPUMP_ALLOC_BLOCKER: {
+            struct upump_blocker **p = va_arg(args, struct upump_blocker **);
+            *p = upump_common_blocker_alloc(upump);
+            return UBASE_ERR_NONE;
+        }
+        case UPUMP_FREE_BLOCKER: {
+            struct upump_blocker *blocker =
+                va_arg(args, struct upump_blocker *);
+            upump_common_blocker_free(blocker);
+            return UBASE_ERR_NONE;
+        }
+        default:
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** @This processes control commands on a upump_wheel_mgr, and forwards
+ * the others to the underlying manager.
+ *
+ * @param mgr pointer to a upump_mgr structure
+ * @param command type of command to process
+ * @param args arguments of the command
+ * @return an error code
+ */
+static int upump_wheel_mgr_control(struct upump_mgr *mgr,
+                                   int command, va_list args)
+{
+    struct upump_wheel_mgr *wheel_mgr = upump_wheel_mgr_from_upump_mgr(mgr);
+    if (command == UPUMP_MGR_VACUUM)
+        upump_common_mgr_vacuum(mgr);
+    return upump_mgr_control_va(wheel_mgr->base, command, args);
+}
+
+/** @This frees a upump manager.
+ *
+ * @param urefcount pointer to urefcount
+ */
+static void upump_wheel_mgr_free(struct urefcount *urefcount)
+{
+    struct upump_wheel_mgr *wheel_mgr =
+        upump_wheel_mgr_from_urefcount(urefcount);
+    upump_free(wheel_mgr->tick);
+    upump_common_mgr_clean(upump_wheel_mgr_to_upump_mgr(wheel_mgr));
+    upump_mgr_release(wheel_mgr->base);
+    uclock_release(wheel_mgr->uclock);
+    urefcount_clean(urefcount);
+    free(wheel_mgr);
+}
+
+/** @This allocates and initializes a upump_mgr structure whose timers are
+ * kept in a timer wheel.
+ *
+ * @param base underlying upump manager, which runs the event loop
+ * @param uclock clock giving the current date
+ * @param granularity duration of a slot, in 27 MHz ticks
+ * @param upump_pool_depth maximum number of upump structures in the pool
+ * @param upump_blocker_pool_depth maximum number of upump_blocker structures
+ * in the pool
+ * @return pointer to the wrapped upump_mgr structure
+ */
+struct upump_mgr *upump_wheel_mgr_alloc(struct upump_mgr *base,
+                                        struct uclock *uclock,
+                                        uint64_t granularity,
+                                        uint16_t upump_pool_depth,
+                                        uint16_t upump_blocker_pool_depth)
+{
+    if (unlikely(base == NULL || uclock == NULL || !granularity))
+        return NULL;
+
+    struct upump_wheel_mgr *wheel_mgr =
+        malloc(sizeof(struct upump_wheel_mgr) +
+               upump_common_mgr_sizeof(upump_pool_depth,
+                                       upump_blocker_pool_depth));
+    if (unlikely(wheel_mgr == NULL))
+        return NULL;
+
+    wheel_mgr->tick = upump_alloc_timer(base, upump_wheel_mgr_tick, wheel_mgr,
+                                        NULL, granularity, granularity);
+    if (unlikely(wheel_mgr->tick == NULL)) {
+        free(wheel_mgr);
+        return NULL;
+    }
+    upump_set_status(wheel_mgr->tick, false);
+
+    struct upump_mgr *mgr = upump_wheel_mgr_to_upump_mgr(wheel_mgr);
+    mgr->signature = UPUMP_WHEEL_SIGNATURE;
+    urefcount_init(upump_wheel_mgr_to_urefcount(wheel_mgr),
+                   upump_wheel_mgr_free);
+    wheel_mgr->common_mgr.mgr.refcount =
+        upump_wheel_mgr_to_urefcount(wheel_mgr);
+    wheel_mgr->common_mgr.mgr.upump_alloc = upump_wheel_alloc;
+    wheel_mgr->common_mgr.mgr.upump_control = upump_wheel_control;
+    wheel_mgr->common_mgr.mgr.upump_mgr_control = upump_wheel_mgr_control;
+
+    upump_common_mgr_init(mgr, upump_pool_depth, upump_blocker_pool_depth,
+                          wheel_mgr->upool_extra,
+                          upump_wheel_real_start, upump_wheel_real_stop,
+                          upump_wheel_alloc_inner, upump_wheel_free_inner);
+
+    wheel_mgr->base = upump_mgr_use(base);
+    wheel_mgr->uclock = uclock_use(uclock);
+    wheel_mgr->granularity = granularity;
+    wheel_mgr->now = 0;
+    wheel_mgr->nb_armed = 0;
+    wheel_mgr->nb_blocking = 0;
+    for (unsigned int level = 0; level < WHEEL_LEVELS; level++)
+        for (unsigned int index = 0; index < WHEEL_SIZE; index++)
+            ulist_init(&wheel_mgr->slots[level][index]);
+    return mgr;
+}
@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short Upipe futex wrappers for the queues woken up with futexes
+ */
+
+#include <upipe/config.h>
+#include <upipe/ubase.h>
+#include <upipe/uatomic.h>
+#include <upipe/uclock.h>
+#include <upipe/uqueue.h>
+
+#include <stdint.h>
+#include <limits.h>
+
+#ifdef UQUEUE_HAVE_FUTEX
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#endif
+
+/** @internal @This wakes up all the threads sleeping on a futex word.
+ *
+ * @param seq pointer to the futex word
+ */
+void uqueue_futex_wake_all(uatomic_uint32_t *seq)
+{
+#ifdef UQUEUE_HAVE_FUTEX
+    syscall(SYS_futex, seq, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+#endif
+}
+
+/** @internal @This sleeps on a futex word, unless it has changed.
+ *
+ * @param seq pointer to the futex word
+ * @param value expected value of the futex word
+ * @param timeout maximum time to sleep (in 27 MHz ticks), or UINT64_MAX
+ */
+void uqueue_futex_sleep(uatomic_uint32_t *seq, uint32_t value,
+                        uint64_t timeout)
+{
+#ifdef UQUEUE_HAVE_FUTEX
+    struct timespec ts, *tsp = NULL;
+    if (timeout != UINT64_MAX) {
+        ts.tv_sec = timeout / UCLOCK_FREQ;
+        ts.tv_nsec = (timeout % UCLOCK_FREQ) * 1000 / 27;
+        tsp = &ts;
+    }
+    syscall(SYS_futex, seq, FUTEX_WAIT_PRIVATE, value, tsp, NULL, 0);
+#endif
+}
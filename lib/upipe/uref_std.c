@@ -31,6 +31,7 @@
 #include <upipe/urefcount.h>
 #include <upipe/upool.h>
 #include <upipe/udict.h>
+#include <upipe/umem.h>
 #include <upipe/uref.h>
 #include <upipe/uref_std.h>
 
@@ -44,6 +45,8 @@ struct uref_std_mgr {
     struct urefcount urefcount;
     /** uref pool */
     struct upool uref_pool;
+    /** memory allocator for uref structures, or NULL to use malloc() */
+    struct umem_mgr *umem_mgr;
 
     /** common management structure */
     struct uref_mgr mgr;
@@ -56,6 +59,16 @@ UBASE_FROM_TO(uref_std_mgr, uref_mgr, uref_mgr, mgr)
 UBASE_FROM_TO(uref_std_mgr, urefcount, urefcount, urefcount)
 UBASE_FROM_TO(uref_std_mgr, upool, uref_pool, uref_pool)
 
+/** @This is the layout of a uref allocated with a umem manager. */
+struct uref_std_umem {
+    /** uref structure */
+    struct uref uref;
+    /** umem structure pointing to this buffer */
+    struct umem umem;
+};
+
+UBASE_FROM_TO(uref_std_umem, uref, uref, uref)
+
 /** @This allocates a uref.
  *
  * @param mgr common management structure
@@ -89,9 +102,21 @@ static void uref_std_free(struct uref *uref)
 static void *uref_std_alloc_inner(struct upool *upool)
 {
     struct uref_std_mgr *std_mgr = uref_std_mgr_from_uref_pool(upool);
-    struct uref *uref = malloc(sizeof(struct uref));
-    if (unlikely(uref == NULL))
-        return NULL;
+    struct uref *uref;
+    if (std_mgr->umem_mgr != NULL) {
+        struct umem umem;
+        if (unlikely(!umem_alloc(std_mgr->umem_mgr, &umem,
+                                 sizeof(struct uref_std_umem))))
+            return NULL;
+        struct uref_std_umem *std_umem =
+            (struct uref_std_umem *)umem_buffer(&umem);
+        std_umem->umem = umem;
+        uref = uref_std_umem_to_uref(std_umem);
+    } else {
+        uref = malloc(sizeof(struct uref));
+        if (unlikely(uref == NULL))
+            return NULL;
+    }
     uref->mgr = uref_std_mgr_to_uref_mgr(std_mgr);
     return uref;
 }
@@ -103,7 +128,12 @@ static void *uref_std_alloc_inner(struct upool *upool)
  */
 static void uref_std_free_inner(struct upool *upool, void *uref)
 {
-    free(uref);
+    struct uref_std_mgr *std_mgr = uref_std_mgr_from_uref_pool(upool);
+    if (std_mgr->umem_mgr != NULL) {
+        struct umem umem = uref_std_umem_from_uref(uref)->umem;
+        umem_free(&umem);
+    } else
+        free(uref);
 }
 
 /** @internal @This instructs an existing uref standard manager to release all
@@ -130,6 +160,25 @@ static int uref_std_mgr_control(struct uref_mgr *mgr, int command, va_list args)
         case UREF_MGR_VACUUM:
             uref_std_mgr_vacuum(mgr);
             return UBASE_ERR_NONE;
+        case UREF_MGR_PREFILL: {
+            struct uref_std_mgr *std_mgr = uref_std_mgr_from_uref_mgr(mgr);
+            unsigned int count = va_arg(args, unsigned int);
+            upool_prefill(&std_mgr->uref_pool, count);
+            udict_mgr_prefill(mgr->udict_mgr, count);
+            return UBASE_ERR_NONE;
+        }
+        case UREF_MGR_SET_STATS: {
+            struct uref_std_mgr *std_mgr = uref_std_mgr_from_uref_mgr(mgr);
+            bool enabled = va_arg(args, int);
+            upool_set_stats(&std_mgr->uref_pool, enabled);
+            return UBASE_ERR_NONE;
+        }
+        case UREF_MGR_GET_STATS: {
+            struct uref_std_mgr *std_mgr = uref_std_mgr_from_uref_mgr(mgr);
+            struct upool_stats *pool_stats = va_arg(args, struct upool_stats *);
+            upool_get_stats(&std_mgr->uref_pool, pool_stats);
+            return UBASE_ERR_NONE;
+        }
         default:
             return UBASE_ERR_UNHANDLED;
     }
@@ -145,21 +194,28 @@ static void uref_std_mgr_free(struct urefcount *urefcount)
     struct uref_mgr *mgr = uref_std_mgr_to_uref_mgr(std_mgr);
     upool_clean(&std_mgr->uref_pool);
     udict_mgr_release(mgr->udict_mgr);
+    umem_mgr_release(std_mgr->umem_mgr);
 
     urefcount_clean(urefcount);
     free(std_mgr);
 }
 
-/** @This allocates a new instance of the standard uref manager
+/** @This allocates a new instance of the standard uref manager, allocating
+ * the uref structures with a umem manager. Used with an arena manager shared
+ * with the udict and ubuf managers, a small uref is allocated next to its
+ * attributes and payload.
  *
  * @param uref_pool_depth maximum number of uref structures in the pool
  * @param udict_mgr udict manager to use to allocate udict structures
  * @param control_attr_size extra attributes space for control packets
+ * @param umem_mgr memory allocator to use for uref structures, or NULL to
+ * use malloc()
  * @return pointer to manager, or NULL in case of error
  */
-struct uref_mgr *uref_std_mgr_alloc(uint16_t uref_pool_depth,
-                                    struct udict_mgr *udict_mgr,
-                                    int control_attr_size)
+struct uref_mgr *uref_std_mgr_alloc_umem(uint16_t uref_pool_depth,
+                                         struct udict_mgr *udict_mgr,
+                                         int control_attr_size,
+                                         struct umem_mgr *umem_mgr)
 {
     assert(udict_mgr != NULL);
     assert(control_attr_size >= 0);
@@ -181,6 +237,22 @@ struct uref_mgr *uref_std_mgr_alloc(uint16_t uref_pool_depth,
     std_mgr->mgr.control_attr_size = control_attr_size;
     std_mgr->mgr.udict_mgr = udict_mgr;
     udict_mgr_use(udict_mgr);
+    std_mgr->umem_mgr = umem_mgr_use(umem_mgr);
 
     return uref_std_mgr_to_uref_mgr(std_mgr);
 }
+
+/** @This allocates a new instance of the standard uref manager
+ *
+ * @param uref_pool_depth maximum number of uref structures in the pool
+ * @param udict_mgr udict manager to use to allocate udict structures
+ * @param control_attr_size extra attributes space for control packets
+ * @return pointer to manager, or NULL in case of error
+ */
+struct uref_mgr *uref_std_mgr_alloc(uint16_t uref_pool_depth,
+                                    struct udict_mgr *udict_mgr,
+                                    int control_attr_size)
+{
+    return uref_std_mgr_alloc_umem(uref_pool_depth, udict_mgr,
+                                   control_attr_size, NULL);
+}
@@ -27,8 +27,10 @@
  * @short implementation of a Upipe event loop using libev
  */
 
+#include <upipe/config.h>
 #include <upipe/ubase.h>
 #include <upipe/urefcount.h>
+#include <upipe/uatomic.h>
 #include <upipe/uclock.h>
 #include <upipe/umutex.h>
 #include <upipe/upump.h>
@@ -36,9 +38,13 @@
 #include <upump-ev/upump_ev.h>
 
 #include <stdlib.h>
+#include <pthread.h>
 
 #include <ev.h>
 
+/** @hidden */
+struct upump_ev_pool_mgr;
+
 /** @This stores management parameters and local structures.
  */
 struct upump_ev_mgr {
@@ -50,6 +56,26 @@ struct upump_ev_mgr {
     /** true if the loop has to be destroyed at the end */
     bool destroy;
 
+    /** pool the loop belongs to, or NULL if it is not run by a pool */
+    struct upump_ev_pool_mgr *pool;
+    /** index of the loop in the pool */
+    unsigned int pool_index;
+    /** thread running the loop, if pooled */
+    pthread_t thread;
+    /** mutex released by the loop while it is waiting, if pooled */
+    pthread_mutex_t mutex;
+    /** watcher to wake up the loop from other threads, if pooled */
+    struct ev_async async;
+    /** set to true to exit the loop, if pooled */
+    bool exit;
+    /** number of allocated pumps */
+    uatomic_uint32_t nb_pumps;
+    /** time to spin without blocking after the last event (in 27 MHz
+     * ticks), or 0 to block */
+    uint64_t busy_poll;
+    /** number of events dispatched by the loop */
+    uint64_t dispatched;
+
     /** common structure */
     struct upump_common_mgr common_mgr;
 
@@ -80,6 +106,17 @@ struct upump_ev {
 
 UBASE_FROM_TO(upump_ev, upump, upump, common.upump)
 
+/** @internal @This dispatches an event to a pump.
+ *
+ * @param upump description structure of the pump
+ */
+static inline void upump_ev_dispatch(struct upump *upump)
+{
+    struct upump_ev_mgr *ev_mgr = upump_ev_mgr_from_upump_mgr(upump->mgr);
+    ev_mgr->dispatched++;
+    upump_common_dispatch(upump);
+}
+
 /** @This dispatches an event to a pump for type ev_io.
  *
  * @param ev_loop current event loop (unused parameter)
@@ -91,7 +128,7 @@ static void upump_ev_dispatch_io(struct ev_loop *ev_loop,
 {
     struct upump_ev *upump_ev = container_of(ev_io, struct upump_ev, ev_io);
     struct upump *upump = upump_ev_to_upump(upump_ev);
-    upump_common_dispatch(upump);
+    upump_ev_dispatch(upump);
 }
 
 /** @This dispatches an event to a pump for type ev_timer.
@@ -106,7 +143,7 @@ static void upump_ev_dispatch_timer(struct ev_loop *ev_loop,
     struct upump_ev *upump_ev = container_of(ev_timer, struct upump_ev,
                                              ev_timer);
     struct upump *upump = upump_ev_to_upump(upump_ev);
-    upump_common_dispatch(upump);
+    upump_ev_dispatch(upump);
 }
 
 /** @This dispatches an event to a pump for type ev_idle.
@@ -120,7 +157,7 @@ static void upump_ev_dispatch_idle(struct ev_loop *ev_loop,
 {
     struct upump_ev *upump_ev = container_of(ev_idle, struct upump_ev, ev_idle);
     struct upump *upump = upump_ev_to_upump(upump_ev);
-    upump_common_dispatch(upump);
+    upump_ev_dispatch(upump);
 }
 
 /** @This dispatches an event to a pump for type ev_signal.
@@ -135,7 +172,7 @@ static void upump_ev_dispatch_signal(struct ev_loop *ev_loop,
     struct upump_ev *upump_ev = container_of(ev_signal, struct upump_ev,
                                              ev_signal);
     struct upump *upump = upump_ev_to_upump(upump_ev);
-    upump_common_dispatch(upump);
+    upump_ev_dispatch(upump);
 }
 
 /** @This allocates a new upump_ev.
@@ -191,6 +228,7 @@ static struct upump *upump_ev_alloc(struct upump_mgr *mgr,
     upump_ev->event = event;
 
     upump_common_init(upump);
+    uatomic_fetch_add(&ev_mgr->nb_pumps, 1);
 
     return upump;
 }
@@ -269,6 +307,7 @@ static void upump_ev_free(struct upump *upump)
     upump_common_clean(upump);
     struct upump_ev *upump_ev = upump_ev_from_upump(upump);
     upool_free(&ev_mgr->common_mgr.upump_pool, upump_ev);
+    uatomic_fetch_sub(&ev_mgr->nb_pumps, 1);
 }
 
 /** @internal @This allocates the data structure.
@@ -305,7 +344,7 @@ static void upump_ev_free_inner(struct upool *upool, void *upump_ev)
  * @param args arguments of the command
  * @return an error code
  */
-static int upump_ev_control(struct upump *upump, int command, va_list args)
+static int _upump_ev_control(struct upump *upump, int command, va_list args)
 {
     switch (command) {
         case UPUMP_START:
@@ -343,6 +382,29 @@ static int upump_ev_control(struct upump *upump, int command, va_list args)
     }
 }
 
+/** @This processes control commands on a upump_ev, taking the lock of the
+ * event loop if it belongs to a pool and runs in another thread.
+ *
+ * @param upump description structure of the pump
+ * @param command type of command to process
+ * @param args arguments of the command
+ * @return an error code
+ */
+static int upump_ev_control(struct upump *upump, int command, va_list args)
+{
+    struct upump_ev_mgr *ev_mgr = upump_ev_mgr_from_upump_mgr(upump->mgr);
+    if (likely(ev_mgr->pool == NULL ||
+               pthread_equal(pthread_self(), ev_mgr->thread)))
+        return _upump_ev_control(upump, command, args);
+
+    pthread_mutex_lock(&ev_mgr->mutex);
+    int err = _upump_ev_control(upump, command, args);
+    /* have the loop take the new watchers into account */
+    ev_async_send(ev_mgr->ev_loop, &ev_mgr->async);
+    pthread_mutex_unlock(&ev_mgr->mutex);
+    return err;
+}
+
 /** @internal @This is called when the event loop starts invoking watchers.
  *
  * @param ev_loop ev loop
@@ -363,6 +425,47 @@ static void upump_ev_mgr_unlock(struct ev_loop *loop)
     umutex_unlock(mutex);
 }
 
+/** @internal @This runs an event loop until no watcher is active or, if
+ * pooled, the pool is freed. In busy-poll mode, the loop is polled without
+ * blocking until no event has been dispatched for the configured time, and
+ * then blocks until the next event.
+ *
+ * @param ev_mgr pointer to a upump_ev_mgr structure
+ * @return true if watchers are still active
+ */
+static bool upump_ev_mgr_loop(struct upump_ev_mgr *ev_mgr)
+{
+#if EV_VERSION_MAJOR > 4 || (EV_VERSION_MAJOR == 4 && EV_VERSION_MINOR > 11)
+    bool status = true;
+    while (status && !__atomic_load_n(&ev_mgr->exit, __ATOMIC_RELAXED)) {
+        uint64_t busy_poll = __atomic_load_n(&ev_mgr->busy_poll,
+                                             __ATOMIC_RELAXED);
+        if (!busy_poll)
+            return ev_run(ev_mgr->ev_loop, 0);
+
+        ev_tstamp budget = (ev_tstamp)busy_poll / UCLOCK_FREQ;
+        ev_tstamp deadline = ev_time() + budget;
+        uint64_t dispatched = ev_mgr->dispatched;
+        do {
+            status = ev_run(ev_mgr->ev_loop, EVRUN_NOWAIT);
+            if (ev_mgr->dispatched != dispatched) {
+                dispatched = ev_mgr->dispatched;
+                deadline = ev_time() + budget;
+            }
+        } while (status && !__atomic_load_n(&ev_mgr->exit, __ATOMIC_RELAXED) &&
+                 ev_time() < deadline);
+
+        if (status && !__atomic_load_n(&ev_mgr->exit, __ATOMIC_RELAXED))
+            status = ev_run(ev_mgr->ev_loop, EVRUN_ONCE);
+    }
+    return status;
+#else
+    /* busy-poll requires the loop to report active watchers */
+    ev_run(ev_mgr->ev_loop, 0);
+    return false;
+#endif
+}
+
 /** @internal @This runs an event loop.
  *
  * @param mgr pointer to a upump_mgr structure
@@ -382,13 +485,7 @@ static int upump_ev_mgr_run(struct upump_mgr *mgr, struct umutex *mutex)
         upump_ev_mgr_lock(ev_mgr->ev_loop);
     }
 
-    bool status;
-#if EV_VERSION_MAJOR > 4 || (EV_VERSION_MAJOR == 4 && EV_VERSION_MINOR > 11)
-    status = ev_run(ev_mgr->ev_loop, 0);
-#else
-    status = false;
-    ev_run(ev_mgr->ev_loop, 0);
-#endif
+    bool status = upump_ev_mgr_loop(ev_mgr);
 
     if (mutex != NULL)
         upump_ev_mgr_unlock(ev_mgr->ev_loop);
@@ -414,6 +511,13 @@ static int upump_ev_mgr_control(struct upump_mgr *mgr,
         case UPUMP_MGR_VACUUM:
             upump_common_mgr_vacuum(mgr);
             return UBASE_ERR_NONE;
+        case UPUMP_EV_MGR_SET_BUSY_POLL: {
+            UBASE_SIGNATURE_CHECK(args, UPUMP_EV_SIGNATURE)
+            struct upump_ev_mgr *ev_mgr = upump_ev_mgr_from_upump_mgr(mgr);
+            uint64_t busy_poll = va_arg(args, uint64_t);
+            __atomic_store_n(&ev_mgr->busy_poll, busy_poll, __ATOMIC_RELAXED);
+            return UBASE_ERR_NONE;
+        }
         default:
             return UBASE_ERR_UNHANDLED;
     }
@@ -429,6 +533,7 @@ static void upump_ev_mgr_free(struct urefcount *urefcount)
     upump_common_mgr_clean(upump_ev_mgr_to_upump_mgr(ev_mgr));
     if (ev_mgr->destroy)
         ev_loop_destroy(ev_mgr->ev_loop);
+    uatomic_clean(&ev_mgr->nb_pumps);
     free(ev_mgr);
 }
 
@@ -466,6 +571,11 @@ struct upump_mgr *upump_ev_mgr_alloc(struct ev_loop *ev_loop,
 
     ev_mgr->ev_loop = ev_loop;
     ev_mgr->destroy = false;
+    ev_mgr->pool = NULL;
+    ev_mgr->exit = false;
+    uatomic_init(&ev_mgr->nb_pumps, 0);
+    ev_mgr->busy_poll = 0;
+    ev_mgr->dispatched = 0;
     return mgr;
 }
 
@@ -520,3 +630,273 @@ struct upump_mgr *upump_ev_mgr_alloc_loop(uint16_t upump_pool_depth,
 
     return mgr;
 }
+
+/** @This stores a pool of event loops running in their own threads. */
+struct upump_ev_pool_mgr {
+    /** refcount management structure */
+    struct urefcount urefcount;
+
+    /** public upump_mgr structure */
+    struct upump_mgr mgr;
+
+    /** number of event loops */
+    unsigned int nb_loops;
+    /** managers of the event loops */
+    struct upump_mgr *loops[];
+};
+
+UBASE_FROM_TO(upump_ev_pool_mgr, upump_mgr, upump_mgr, mgr)
+UBASE_FROM_TO(upump_ev_pool_mgr, urefcount, urefcount, urefcount)
+
+#ifdef UPIPE_HAVE_TLS
+/** pool the calling thread is bound to */
+static __thread struct upump_ev_pool_mgr *upump_ev_pool_bound = NULL;
+/** event loop of the pool the calling thread is bound to */
+static __thread unsigned int upump_ev_pool_bound_loop;
+#endif
+
+/** @internal @This is called when a pooled event loop starts invoking
+ * watchers.
+ *
+ * @param ev_loop ev loop
+ */
+static void upump_ev_pool_lock(struct ev_loop *loop)
+{
+    struct upump_ev_mgr *ev_mgr = ev_userdata(loop);
+    pthread_mutex_lock(&ev_mgr->mutex);
+}
+
+/** @internal @This is called when a pooled event loop goes to sleep.
+ *
+ * @param ev_loop ev loop
+ */
+static void upump_ev_pool_unlock(struct ev_loop *loop)
+{
+    struct upump_ev_mgr *ev_mgr = ev_userdata(loop);
+    pthread_mutex_unlock(&ev_mgr->mutex);
+}
+
+/** @internal @This is called when a pooled event loop is woken up by another
+ * thread.
+ *
+ * @param ev_loop ev loop
+ * @param ev_async ev watcher
+ * @param revents events triggered (unused parameter)
+ */
+static void upump_ev_pool_wake(struct ev_loop *loop, struct ev_async *ev_async,
+                               int revents)
+{
+    struct upump_ev_mgr *ev_mgr = ev_userdata(loop);
+    if (ev_mgr->exit)
+        ev_break(loop, EVBREAK_ALL);
+}
+
+/** @internal @This is the main function of the threads of the pool.
+ *
+ * @param arg pointer to the upump_mgr of the event loop
+ * @return NULL
+ */
+static void *upump_ev_pool_thread(void *arg)
+{
+    struct upump_ev_mgr *ev_mgr = arg;
+#ifdef UPIPE_HAVE_TLS
+    /* pumps allocated from the callbacks stay in this loop */
+    upump_ev_pool_bound = ev_mgr->pool;
+    upump_ev_pool_bound_loop = ev_mgr->pool_index;
+#endif
+    upump_ev_pool_lock(ev_mgr->ev_loop);
+    upump_ev_mgr_loop(ev_mgr);
+    upump_ev_pool_unlock(ev_mgr->ev_loop);
+    return NULL;
+}
+
+/** @internal @This selects the event loop of a new pump.
+ *
+ * @param pool_mgr pointer to the pool manager
+ * @return index of the event loop
+ */
+static unsigned int upump_ev_pool_select(struct upump_ev_pool_mgr *pool_mgr)
+{
+#ifdef UPIPE_HAVE_TLS
+    if (upump_ev_pool_bound == pool_mgr)
+        return upump_ev_pool_bound_loop;
+#endif
+
+    unsigned int best = 0;
+    uint32_t best_pumps = UINT32_MAX;
+    for (unsigned int i = 0; i < pool_mgr->nb_loops; i++) {
+        struct upump_ev_mgr *ev_mgr =
+            upump_ev_mgr_from_upump_mgr(pool_mgr->loops[i]);
+        uint32_t nb_pumps = uatomic_load(&ev_mgr->nb_pumps);
+        if (nb_pumps < best_pumps) {
+            best = i;
+            best_pumps = nb_pumps;
+        }
+    }
+
+#ifdef UPIPE_HAVE_TLS
+    /* keep the following pumps of this thread in the same loop */
+    upump_ev_pool_bound = pool_mgr;
+    upump_ev_pool_bound_loop = best;
+#endif
+    return best;
+}
+
+/** @This allocates a new pump in one of the event loops of the pool.
+ *
+ * @param mgr pointer to a upump_mgr structure wrapped into a
+ * upump_ev_pool_mgr structure
+ * @param event type of event to watch for
+ * @param args optional parameters depending on event type
+ * @return pointer to allocated pump, or NULL in case of failure
+ */
+static struct upump *upump_ev_pool_alloc(struct upump_mgr *mgr,
+                                         int event, va_list args)
+{
+    struct upump_ev_pool_mgr *pool_mgr = upump_ev_pool_mgr_from_upump_mgr(mgr);
+    struct upump_mgr *loop = pool_mgr->loops[upump_ev_pool_select(pool_mgr)];
+    return loop->upump_alloc(loop, event, args);
+}
+
+/** @This processes control commands on a upump_ev_pool_mgr.
+ *
+ * @param mgr pointer to a upump_mgr structure
+ * @param command type of command to process
+ * @param args arguments of the command
+ * @return an error code
+ */
+static int upump_ev_pool_mgr_control(struct upump_mgr *mgr,
+                                     int command, va_list args)
+{
+    struct upump_ev_pool_mgr *pool_mgr = upump_ev_pool_mgr_from_upump_mgr(mgr);
+    switch (command) {
+        case UPUMP_MGR_VACUUM:
+            for (unsigned int i = 0; i < pool_mgr->nb_loops; i++)
+                upump_mgr_vacuum(pool_mgr->loops[i]);
+            return UBASE_ERR_NONE;
+        case UPUMP_EV_POOL_MGR_REBALANCE: {
+            UBASE_SIGNATURE_CHECK(args, UPUMP_EV_SIGNATURE)
+#ifdef UPIPE_HAVE_TLS
+            if (upump_ev_pool_bound == pool_mgr) {
+                struct upump_ev_mgr *ev_mgr = upump_ev_mgr_from_upump_mgr(
+                        pool_mgr->loops[upump_ev_pool_bound_loop]);
+                if (!pthread_equal(pthread_self(), ev_mgr->thread))
+                    upump_ev_pool_bound = NULL;
+            }
+#endif
+            return UBASE_ERR_NONE;
+        }
+        case UPUMP_EV_MGR_SET_BUSY_POLL: {
+            UBASE_SIGNATURE_CHECK(args, UPUMP_EV_SIGNATURE)
+            uint64_t busy_poll = va_arg(args, uint64_t);
+            for (unsigned int i = 0; i < pool_mgr->nb_loops; i++)
+                UBASE_RETURN(upump_ev_mgr_set_busy_poll(pool_mgr->loops[i],
+                                                        busy_poll))
+            return UBASE_ERR_NONE;
+        }
+        default:
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** @This stops the threads and frees a pool of event loops.
+ *
+ * @param urefcount pointer to urefcount
+ */
+static void upump_ev_pool_mgr_free(struct urefcount *urefcount)
+{
+    struct upump_ev_pool_mgr *pool_mgr =
+        upump_ev_pool_mgr_from_urefcount(urefcount);
+    for (unsigned int i = 0; i < pool_mgr->nb_loops; i++) {
+        struct upump_ev_mgr *ev_mgr =
+            upump_ev_mgr_from_upump_mgr(pool_mgr->loops[i]);
+        pthread_mutex_lock(&ev_mgr->mutex);
+        __atomic_store_n(&ev_mgr->exit, true, __ATOMIC_RELAXED);
+        ev_async_send(ev_mgr->ev_loop, &ev_mgr->async);
+        pthread_mutex_unlock(&ev_mgr->mutex);
+        pthread_join(ev_mgr->thread, NULL);
+
+        ev_async_stop(ev_mgr->ev_loop, &ev_mgr->async);
+        pthread_mutex_destroy(&ev_mgr->mutex);
+        ev_mgr->pool = NULL;
+        upump_mgr_release(pool_mgr->loops[i]);
+    }
+#ifdef UPIPE_HAVE_TLS
+    if (upump_ev_pool_bound == pool_mgr)
+        upump_ev_pool_bound = NULL;
+#endif
+    urefcount_clean(urefcount);
+    free(pool_mgr);
+}
+
+/** @This allocates and initializes a pool of event loops, each running in its
+ * own thread.
+ *
+ * @param nb_loops number of event loops and threads
+ * @param upump_pool_depth maximum number of upump structures in the pool of
+ * each event loop
+ * @param upump_blocker_pool_depth maximum number of upump_blocker structures in
+ * the pool of each event loop
+ * @return pointer to the wrapped upump_mgr structure
+ */
+struct upump_mgr *upump_ev_pool_mgr_alloc(unsigned int nb_loops,
+                                          uint16_t upump_pool_depth,
+                                          uint16_t upump_blocker_pool_depth)
+{
+    if (unlikely(!nb_loops))
+        return NULL;
+
+    struct upump_ev_pool_mgr *pool_mgr =
+        malloc(sizeof(struct upump_ev_pool_mgr) +
+               nb_loops * sizeof(struct upump_mgr *));
+    if (unlikely(pool_mgr == NULL))
+        return NULL;
+
+    struct upump_mgr *mgr = upump_ev_pool_mgr_to_upump_mgr(pool_mgr);
+    mgr->signature = UPUMP_EV_SIGNATURE;
+    urefcount_init(upump_ev_pool_mgr_to_urefcount(pool_mgr),
+                   upump_ev_pool_mgr_free);
+    mgr->refcount = upump_ev_pool_mgr_to_urefcount(pool_mgr);
+    mgr->upump_alloc = upump_ev_pool_alloc;
+    mgr->upump_control = upump_ev_control;
+    mgr->upump_mgr_control = upump_ev_pool_mgr_control;
+    pool_mgr->nb_loops = 0;
+
+    for (unsigned int i = 0; i < nb_loops; i++) {
+        struct upump_mgr *loop =
+            upump_ev_mgr_alloc_loop(upump_pool_depth, upump_blocker_pool_depth);
+        if (unlikely(loop == NULL))
+            break;
+        struct upump_ev_mgr *ev_mgr = upump_ev_mgr_from_upump_mgr(loop);
+        ev_mgr->pool = pool_mgr;
+        ev_mgr->pool_index = i;
+        /* recursive, as freeing a pump also stops it */
+        pthread_mutexattr_t attr;
+        pthread_mutexattr_init(&attr);
+        pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+        pthread_mutex_init(&ev_mgr->mutex, &attr);
+        pthread_mutexattr_destroy(&attr);
+        ev_set_userdata(ev_mgr->ev_loop, ev_mgr);
+        ev_set_loop_release_cb(ev_mgr->ev_loop,
+                               upump_ev_pool_unlock, upump_ev_pool_lock);
+        ev_async_init(&ev_mgr->async, upump_ev_pool_wake);
+        /* the watcher is active, so the loop runs until the pool is freed */
+        ev_async_start(ev_mgr->ev_loop, &ev_mgr->async);
+
+        if (unlikely(pthread_create(&ev_mgr->thread, NULL,
+                                    upump_ev_pool_thread, ev_mgr) != 0)) {
+            ev_async_stop(ev_mgr->ev_loop, &ev_mgr->async);
+            pthread_mutex_destroy(&ev_mgr->mutex);
+            ev_mgr->pool = NULL;
+            upump_mgr_release(loop);
+            break;
+        }
+        pool_mgr->loops[pool_mgr->nb_loops++] = loop;
+    }
+
+    if (unlikely(pool_mgr->nb_loops != nb_loops)) {
+        upump_ev_pool_mgr_free(upump_ev_pool_mgr_to_urefcount(pool_mgr));
+        return NULL;
+    }
+    return mgr;
+}
@@ -0,0 +1,851 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short implementation of a Upipe event loop using io_uring
+ */
+
+#include <upipe/ubase.h>
+#include <upipe/ulist.h>
+#include <upipe/urefcount.h>
+#include <upipe/uclock.h>
+#include <upipe/umutex.h>
+#include <upipe/upump.h>
+#include <upipe/upump_common.h>
+#include <upump-uring/upump_uring.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <errno.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+/** number of entries of the submission queue */
+#define UPUMP_URING_ENTRIES 256
+
+/** @This stores management parameters and local structures.
+ */
+struct upump_uring_mgr {
+    /** refcount management structure */
+    struct urefcount urefcount;
+
+    /** file descriptor of the ring */
+    int fd;
+    /** mapping of the rings */
+    uint8_t *rings;
+    /** size of the mapping of the rings */
+    size_t rings_size;
+    /** submission queue entries */
+    struct io_uring_sqe *sqes;
+    /** size of the mapping of the submission queue entries */
+    size_t sqes_size;
+
+    /** submission queue head (written by the kernel) */
+    unsigned int *sq_head;
+    /** submission queue tail */
+    unsigned int *sq_tail;
+    /** submission queue mask */
+    unsigned int sq_mask;
+    /** submission queue entries */
+    unsigned int sq_entries;
+    /** submission queue indirection array */
+    unsigned int *sq_array;
+    /** number of entries not yet submitted */
+    unsigned int sq_pending;
+    /** completion queue head */
+    unsigned int *cq_head;
+    /** completion queue tail (written by the kernel) */
+    unsigned int *cq_tail;
+    /** completion queue mask */
+    unsigned int cq_mask;
+    /** completion queue entries */
+    struct io_uring_cqe *cqes;
+
+    /** list of started idlers */
+    struct uchain idlers;
+    /** list of started timers, by ascending deadline */
+    struct uchain timers;
+    /** list of pumps with a completed operation */
+    struct uchain ready;
+    /** number of started pumps keeping the loop alive */
+    unsigned int nb_blocking;
+    /** pump being dispatched, or NULL */
+    struct upump_uring *dispatching;
+
+    /** common structure */
+    struct upump_common_mgr common_mgr;
+
+    /** extra space for upool */
+    uint8_t upool_extra[];
+};
+
+UBASE_FROM_TO(upump_uring_mgr, upump_mgr, upump_mgr, common_mgr.mgr)
+UBASE_FROM_TO(upump_uring_mgr, urefcount, urefcount, urefcount)
+
+/** @This stores local structures.
+ */
+struct upump_uring {
+    /** type of event to watch */
+    int event;
+    /** file descriptor */
+    int fd;
+    /** buffers to receive into, for @ref UPUMP_URING_TYPE_RECVMSG */
+    struct msghdr *msg;
+    /** delay before the first trigger of a timer */
+    uint64_t after;
+    /** period of a timer, or 0 */
+    uint64_t repeat;
+    /** date of the next trigger of a timer */
+    uint64_t deadline;
+
+    /** true if an operation was submitted and didn't complete */
+    bool armed;
+    /** true if an operation completed and wasn't dispatched */
+    bool pending;
+    /** true if the pump is in the list of idlers or timers */
+    bool active;
+    /** true if the pump keeps the loop alive */
+    bool blocking;
+    /** result of the last operation */
+    int result;
+
+    /** structure for the list of idlers or timers */
+    struct uchain uchain_mgr;
+    /** structure for the list of ready pumps */
+    struct uchain uchain_ready;
+
+    /** common structure */
+    struct upump_common common;
+};
+
+UBASE_FROM_TO(upump_uring, upump, upump, common.upump)
+UBASE_FROM_TO(upump_uring, uchain, uchain_mgr, uchain_mgr)
+UBASE_FROM_TO(upump_uring, uchain, uchain_ready, uchain_ready)
+
+/** @internal @This returns the current monotonic time.
+ *
+ * @return current time in 27 MHz ticks
+ */
+static uint64_t upump_uring_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * UCLOCK_FREQ +
+           ts.tv_nsec * UCLOCK_FREQ / UINT64_C(1000000000);
+}
+
+/** @internal @This submits the pending entries and waits for completions.
+ *
+ * @param uring_mgr pointer to a upump_uring_mgr structure
+ * @param timeout maximum time to wait in 27 MHz ticks, or UINT64_MAX
+ * @return false in case of fatal error
+ */
+static bool upump_uring_enter(struct upump_uring_mgr *uring_mgr,
+                              uint64_t timeout)
+{
+    unsigned int flags = 0;
+    unsigned int min_complete = 0;
+    struct __kernel_timespec ts;
+    struct io_uring_getevents_arg arg;
+    void *argp = NULL;
+    size_t argsz = 0;
+
+    if (timeout) {
+        flags |= IORING_ENTER_GETEVENTS;
+        min_complete = 1;
+        if (timeout != UINT64_MAX) {
+            ts.tv_sec = timeout / UCLOCK_FREQ;
+            ts.tv_nsec = (timeout % UCLOCK_FREQ) * UINT64_C(1000000000) /
+                         UCLOCK_FREQ;
+            memset(&arg, 0, sizeof(arg));
+            arg.ts = (uintptr_t)&ts;
+            flags |= IORING_ENTER_EXT_ARG;
+            argp = &arg;
+            argsz = sizeof(arg);
+        }
+    } else if (!uring_mgr->sq_pending)
+        return true;
+
+    int ret = syscall(__NR_io_uring_enter, uring_mgr->fd,
+                      uring_mgr->sq_pending, min_complete, flags, argp, argsz);
+    if (ret >= 0) {
+        uring_mgr->sq_pending -= ret;
+        return true;
+    }
+    return errno == EINTR || errno == ETIME || errno == EBUSY ||
+           errno == EAGAIN;
+}
+
+/** @internal @This returns a free submission queue entry.
+ *
+ * @param uring_mgr pointer to a upump_uring_mgr structure
+ * @return pointer to the entry, or NULL if the queue is full
+ */
+static struct io_uring_sqe *upump_uring_get_sqe(
+        struct upump_uring_mgr *uring_mgr)
+{
+    unsigned int tail = *uring_mgr->sq_tail;
+    if (tail - __atomic_load_n(uring_mgr->sq_head, __ATOMIC_ACQUIRE) >=
+        uring_mgr->sq_entries) {
+        /* flush the queue */
+        upump_uring_enter(uring_mgr, 0);
+        if (tail - __atomic_load_n(uring_mgr->sq_head, __ATOMIC_ACQUIRE) >=
+            uring_mgr->sq_entries)
+            return NULL;
+    }
+
+    unsigned int index = tail & uring_mgr->sq_mask;
+    struct io_uring_sqe *sqe = &uring_mgr->sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    uring_mgr->sq_array[index] = index;
+    return sqe;
+}
+
+/** @internal @This queues a submission queue entry, obtained with
+ * @ref upump_uring_get_sqe. It will be submitted with the next system call.
+ *
+ * @param uring_mgr pointer to a upump_uring_mgr structure
+ */
+static void upump_uring_queue_sqe(struct upump_uring_mgr *uring_mgr)
+{
+    __atomic_store_n(uring_mgr->sq_tail, *uring_mgr->sq_tail + 1,
+                     __ATOMIC_RELEASE);
+    uring_mgr->sq_pending++;
+}
+
+/** @internal @This submits the operation of a pump.
+ *
+ * @param upump_uring pointer to a upump_uring structure
+ */
+static void upump_uring_arm(struct upump_uring *upump_uring)
+{
+    struct upump *upump = upump_uring_to_upump(upump_uring);
+    struct upump_uring_mgr *uring_mgr =
+        upump_uring_mgr_from_upump_mgr(upump->mgr);
+    struct io_uring_sqe *sqe = upump_uring_get_sqe(uring_mgr);
+    if (unlikely(sqe == NULL)) {
+        /* report the error to the pipe */
+        upump_uring->result = -EBUSY;
+        upump_uring->pending = true;
+        if (upump_uring->uchain_ready.next == NULL)
+            ulist_add(&uring_mgr->ready, &upump_uring->uchain_ready);
+        return;
+    }
+
+    sqe->fd = upump_uring->fd;
+    sqe->user_data = (uintptr_t)upump_uring;
+    switch (upump_uring->event) {
+        case UPUMP_TYPE_FD_READ:
+            sqe->opcode = IORING_OP_POLL_ADD;
+            sqe->poll32_events = POLLIN;
+            break;
+        case UPUMP_TYPE_FD_WRITE:
+            sqe->opcode = IORING_OP_POLL_ADD;
+            sqe->poll32_events = POLLOUT;
+            break;
+        case UPUMP_URING_TYPE_RECVMSG:
+            sqe->opcode = IORING_OP_RECVMSG;
+            sqe->addr = (uintptr_t)upump_uring->msg;
+            sqe->len = 1;
+            break;
+        default:
+            break;
+    }
+    upump_uring_queue_sqe(uring_mgr);
+    upump_uring->armed = true;
+}
+
+/** @internal @This processes the completion queue.
+ *
+ * @param uring_mgr pointer to a upump_uring_mgr structure
+ */
+static void upump_uring_reap(struct upump_uring_mgr *uring_mgr)
+{
+    unsigned int head = *uring_mgr->cq_head;
+    unsigned int tail = __atomic_load_n(uring_mgr->cq_tail, __ATOMIC_ACQUIRE);
+    while (head != tail) {
+        struct io_uring_cqe *cqe = &uring_mgr->cqes[head & uring_mgr->cq_mask];
+        struct upump_uring *upump_uring =
+            (struct upump_uring *)(uintptr_t)cqe->user_data;
+        if (upump_uring != NULL) {
+            upump_uring->armed = false;
+            upump_uring->result = cqe->res;
+            if (cqe->res != -ECANCELED) {
+                upump_uring->pending = true;
+                if (upump_uring->common.started &&
+                    ulist_empty(&upump_uring->common.blockers) &&
+                    upump_uring->uchain_ready.next == NULL)
+                    ulist_add(&uring_mgr->ready, &upump_uring->uchain_ready);
+            }
+        }
+        head++;
+    }
+    __atomic_store_n(uring_mgr->cq_head, head, __ATOMIC_RELEASE);
+}
+
+/** @internal @This cancels the operation of a pump and waits for its
+ * completion, so that the buffers may be released.
+ *
+ * @param upump_uring pointer to a upump_uring structure
+ */
+static void upump_uring_cancel(struct upump_uring *upump_uring)
+{
+    struct upump *upump = upump_uring_to_upump(upump_uring);
+    struct upump_uring_mgr *uring_mgr =
+        upump_uring_mgr_from_upump_mgr(upump->mgr);
+
+    struct io_uring_sqe *sqe = upump_uring_get_sqe(uring_mgr);
+    if (likely(sqe != NULL)) {
+        sqe->opcode = IORING_OP_ASYNC_CANCEL;
+        sqe->fd = -1;
+        sqe->addr = (uintptr_t)upump_uring;
+        sqe->user_data = 0;
+        upump_uring_queue_sqe(uring_mgr);
+    }
+    while (upump_uring->armed) {
+        if (unlikely(!upump_uring_enter(uring_mgr, UINT64_MAX)))
+            break;
+        upump_uring_reap(uring_mgr);
+    }
+}
+
+/** @This allocates a new upump_uring.
+ *
+ * @param mgr pointer to a upump_mgr structure wrapped into a
+ * upump_uring_mgr structure
+ * @param event type of event to watch for
+ * @param args optional parameters depending on event type
+ * @return pointer to allocated pump, or NULL in case of failure
+ */
+static struct upump *upump_uring_alloc(struct upump_mgr *mgr,
+                                       int event, va_list args)
+{
+    struct upump_uring_mgr *uring_mgr = upump_uring_mgr_from_upump_mgr(mgr);
+
+    int fd = -1;
+    struct msghdr *msg = NULL;
+    uint64_t after = 0, repeat = 0;
+    switch (event) {
+        case UPUMP_TYPE_IDLER:
+            break;
+        case UPUMP_TYPE_TIMER:
+            after = va_arg(args, uint64_t);
+            repeat = va_arg(args, uint64_t);
+            break;
+        case UPUMP_TYPE_FD_READ:
+        case UPUMP_TYPE_FD_WRITE:
+            fd = va_arg(args, int);
+            break;
+        case UPUMP_URING_TYPE_RECVMSG:
+            if (va_arg(args, unsigned int) != UPUMP_URING_SIGNATURE)
+                return NULL;
+            fd = va_arg(args, int);
+            msg = va_arg(args, struct msghdr *);
+            break;
+        default:
+            /* signals would require blocking them in all threads */
+            return NULL;
+    }
+
+    struct upump_uring *upump_uring =
+        upool_alloc(&uring_mgr->common_mgr.upump_pool, struct upump_uring *);
+    if (unlikely(upump_uring == NULL))
+        return NULL;
+    struct upump *upump = upump_uring_to_upump(upump_uring);
+
+    upump_uring->event = event;
+    upump_uring->fd = fd;
+    upump_uring->msg = msg;
+    upump_uring->after = after;
+    upump_uring->repeat = repeat;
+    upump_uring->deadline = 0;
+    upump_uring->armed = false;
+    upump_uring->pending = false;
+    upump_uring->active = false;
+    upump_uring->blocking = false;
+    upump_uring->result = 0;
+    uchain_init(&upump_uring->uchain_mgr);
+    uchain_init(&upump_uring->uchain_ready);
+
+    upump_common_init(upump);
+
+    return upump;
+}
+
+/** @internal @This inserts a timer in the list of timers of the manager.
+ *
+ * @param uring_mgr pointer to a upump_uring_mgr structure
+ * @param upump_uring pointer to a upump_uring structure
+ */
+static void upump_uring_insert_timer(struct upump_uring_mgr *uring_mgr,
+                                     struct upump_uring *upump_uring)
+{
+    struct uchain *uchain;
+    ulist_foreach (&uring_mgr->timers, uchain) {
+        struct upump_uring *timer = upump_uring_from_uchain_mgr(uchain);
+        if (timer->deadline > upump_uring->deadline) {
+            ulist_insert(uchain->prev, uchain, &upump_uring->uchain_mgr);
+            return;
+        }
+    }
+    ulist_add(&uring_mgr->timers, &upump_uring->uchain_mgr);
+}
+
+/** @This starts a pump.
+ *
+ * @param upump description structure of the pump
+ * @param status blocking status of the pump
+ */
+static void upump_uring_real_start(struct upump *upump, bool status)
+{
+    struct upump_uring *upump_uring = upump_uring_from_upump(upump);
+    struct upump_uring_mgr *uring_mgr =
+        upump_uring_mgr_from_upump_mgr(upump->mgr);
+
+    switch (upump_uring->event) {
+        case UPUMP_TYPE_IDLER:
+            ulist_add(&uring_mgr->idlers, &upump_uring->uchain_mgr);
+            upump_uring->active = true;
+            break;
+        case UPUMP_TYPE_TIMER:
+            upump_uring->deadline = upump_uring_now() + upump_uring->after;
+            upump_uring_insert_timer(uring_mgr, upump_uring);
+            upump_uring->active = true;
+            break;
+        default:
+            if (upump_uring->pending && upump_uring->uchain_ready.next == NULL)
+                ulist_add(&uring_mgr->ready, &upump_uring->uchain_ready);
+            else if (!upump_uring->armed &&
+                     uring_mgr->dispatching != upump_uring)
+                upump_uring_arm(upump_uring);
+            break;
+    }
+    upump_uring->blocking = status;
+    if (status)
+        uring_mgr->nb_blocking++;
+}
+
+/** @This stops a pump.
+ *
+ * @param upump description structure of the pump
+ * @param status blocking status of the pump
+ */
+static void upump_uring_real_stop(struct upump *upump, bool status)
+{
+    struct upump_uring *upump_uring = upump_uring_from_upump(upump);
+    struct upump_uring_mgr *uring_mgr =
+        upump_uring_mgr_from_upump_mgr(upump->mgr);
+
+    if (upump_uring->blocking) {
+        upump_uring->blocking = false;
+        uring_mgr->nb_blocking--;
+    }
+    if (upump_uring->active) {
+        ulist_delete(&upump_uring->uchain_mgr);
+        upump_uring->active = false;
+    }
+    /* the operation stays armed, and is dispatched at the next start if it
+     * completes in the meantime */
+    if (upump_uring->uchain_ready.next != NULL)
+        ulist_delete(&upump_uring->uchain_ready);
+}
+
+/** @This released the memory space previously used by a pump.
+ * Please note that the pump must be stopped before.
+ *
+ * @param upump description structure of the pump
+ */
+static void upump_uring_free(struct upump *upump)
+{
+    struct upump_uring_mgr *uring_mgr =
+        upump_uring_mgr_from_upump_mgr(upump->mgr);
+    struct upump_uring *upump_uring = upump_uring_from_upump(upump);
+    upump_stop(upump);
+    if (upump_uring->armed)
+        upump_uring_cancel(upump_uring);
+    if (uring_mgr->dispatching == upump_uring)
+        uring_mgr->dispatching = NULL;
+    upump_common_clean(upump);
+    upool_free(&uring_mgr->common_mgr.upump_pool, upump_uring);
+}
+
+/** @internal @This allocates the data structure.
+ *
+ * @param upool pointer to upool
+ * @return pointer to upump_uring or NULL in case of allocation error
+ */
+static void *upump_uring_alloc_inner(struct upool *upool)
+{
+    struct upump_common_mgr *common_mgr =
+        upump_common_mgr_from_upump_pool(upool);
+    struct upump_uring *upump_uring = malloc(sizeof(struct upump_uring));
+    if (unlikely(upump_uring == NULL))
+        return NULL;
+    struct upump *upump = upump_uring_to_upump(upump_uring);
+    upump->mgr = upump_common_mgr_to_upump_mgr(common_mgr);
+    return upump_uring;
+}
+
+/** @internal @This frees a upump_uring.
+ *
+ * @param upool pointer to upool
+ * @param upump_uring pointer to a upump_uring structure to free
+ */
+static void upump_uring_free_inner(struct upool *upool, void *upump_uring)
+{
+    free(upump_uring);
+}
+
+/** @This processes control commands on a upump_uring.
+ *
+ * @param upump description structure of the pump
+ * @param command type of command to process
+ * @param args arguments of the command
+ * @return an error code
+ */
+static int upump_uring_control(struct upump *upump, int command, va_list args)
+{
+    switch (command) {
+        case UPUMP_START:
+            upump_common_start(upump);
+            return UBASE_ERR_NONE;
+        case UPUMP_STOP:
+            upump_common_stop(upump);
+            return UBASE_ERR_NONE;
+        case UPUMP_FREE:
+            upump_uring_free(upump);
+            return UBASE_ERR_NONE;
+        case UPUMP_GET_STATUS: {
+            int *status_p = va_arg(args, int *);
+            upump_common_get_status(upump, status_p);
+            return UBASE_ERR_NONE;
+        }
+        case UPUMP_SET_STATUS: {
+            int status = va_arg(args, int);
+            upump_common_set_status(upump, status);
+            return UBASE_ERR_NONE;
+        }
+        case UPUMP_ALLOC_BLOCKER: {
+            struct upump_blocker **p = va_arg(args, struct upump_blocker **);
+            *p = upump_common_blocker_alloc(upump);
+            return UBASE_ERR_NONE;
+        }
+        case UPUMP_FREE_BLOCKER: {
+            struct upump_blocker *blocker =
+                va_arg(args, struct upump_blocker *);
+            upump_common_blocker_free(blocker);
+            return UBASE_ERR_NONE;
+        }
+        case UPUMP_URING_GET_RESULT: {
+            UBASE_SIGNATURE_CHECK(args, UPUMP_URING_SIGNATURE)
+            int *result_p = va_arg(args, int *);
+            *result_p = upump_uring_from_upump(upump)->result;
+            return UBASE_ERR_NONE;
+        }
+        default:
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** @internal @This dispatches the pumps whose operation completed.
+ *
+ * @param uring_mgr pointer to a upump_uring_mgr structure
+ * @return true if at least one pump was dispatched
+ */
+static bool upump_uring_dispatch_ready(struct upump_uring_mgr *uring_mgr)
+{
+    struct uchain ready;
+    ulist_init(&ready);
+    struct uchain *uchain;
+    while ((uchain = ulist_pop(&uring_mgr->ready)) != NULL)
+        ulist_add(&ready, uchain);
+
+    bool dispatched = false;
+    while ((uchain = ulist_pop(&ready)) != NULL) {
+        dispatched = true;
+        struct upump_uring *upump_uring = upump_uring_from_uchain_ready(uchain);
+        struct upump *upump = upump_uring_to_upump(upump_uring);
+        upump_uring->pending = false;
+        if (upump_uring->event != UPUMP_URING_TYPE_RECVMSG)
+            /* the buffers of the pipe are not involved, poll again */
+            upump_uring_arm(upump_uring);
+
+        uring_mgr->dispatching = upump_uring;
+        upump_common_dispatch(upump);
+        if (uring_mgr->dispatching == upump_uring &&
+            upump_uring->common.started && !upump_uring->armed &&
+            !upump_uring->pending)
+            upump_uring_arm(upump_uring);
+        uring_mgr->dispatching = NULL;
+    }
+    return dispatched;
+}
+
+/** @internal @This dispatches the expired timers.
+ *
+ * @param uring_mgr pointer to a upump_uring_mgr structure
+ * @param now current time
+ * @return true if at least one timer was dispatched
+ */
+static bool upump_uring_dispatch_timers(struct upump_uring_mgr *uring_mgr,
+                                        uint64_t now)
+{
+    bool dispatched = false;
+    struct uchain *uchain;
+    while ((uchain = ulist_peek(&uring_mgr->timers)) != NULL) {
+        struct upump_uring *upump_uring = upump_uring_from_uchain_mgr(uchain);
+        if (upump_uring->deadline > now)
+            break;
+        ulist_delete(uchain);
+        if (upump_uring->repeat) {
+            upump_uring->deadline += upump_uring->repeat;
+            if (upump_uring->deadline < now)
+                upump_uring->deadline = now;
+            upump_uring_insert_timer(uring_mgr, upump_uring);
+        } else {
+            /* the timer is automatically stopped */
+            upump_uring->active = false;
+            if (upump_uring->blocking) {
+                upump_uring->blocking = false;
+                uring_mgr->nb_blocking--;
+            }
+        }
+        dispatched = true;
+        upump_common_dispatch(upump_uring_to_upump(upump_uring));
+    }
+    return dispatched;
+}
+
+/** @internal @This dispatches the started idlers.
+ *
+ * @param uring_mgr pointer to a upump_uring_mgr structure
+ */
+static void upump_uring_dispatch_idlers(struct upump_uring_mgr *uring_mgr)
+{
+    struct uchain idlers;
+    ulist_init(&idlers);
+    struct uchain *uchain;
+    while ((uchain = ulist_pop(&uring_mgr->idlers)) != NULL)
+        ulist_add(&idlers, uchain);
+
+    while ((uchain = ulist_pop(&idlers)) != NULL) {
+        /* back to the list, in case the callback stops the idler */
+        ulist_add(&uring_mgr->idlers, uchain);
+        struct upump_uring *upump_uring = upump_uring_from_uchain_mgr(uchain);
+        upump_common_dispatch(upump_uring_to_upump(upump_uring));
+    }
+}
+
+/** @internal @This runs an event loop.
+ *
+ * @param mgr pointer to a upump_mgr structure
+ * @param mutex mutual exclusion primitives to access the event loop
+ * @return an error code, including @ref UBASE_ERR_BUSY if a pump is still
+ * active
+ */
+static int upump_uring_mgr_run(struct upump_mgr *mgr, struct umutex *mutex)
+{
+    struct upump_uring_mgr *uring_mgr = upump_uring_mgr_from_upump_mgr(mgr);
+
+    if (mutex != NULL)
+        umutex_lock(mutex);
+
+    int err = UBASE_ERR_NONE;
+    while (uring_mgr->nb_blocking || !ulist_empty(&uring_mgr->ready)) {
+        uint64_t timeout = UINT64_MAX;
+        if (!ulist_empty(&uring_mgr->ready) ||
+            !ulist_empty(&uring_mgr->idlers))
+            timeout = 0;
+        else {
+            struct uchain *uchain = ulist_peek(&uring_mgr->timers);
+            if (uchain != NULL) {
+                uint64_t deadline =
+                    upump_uring_from_uchain_mgr(uchain)->deadline;
+                uint64_t now = upump_uring_now();
+                timeout = deadline > now ? deadline - now : 0;
+            }
+        }
+
+        if (mutex != NULL)
+            umutex_unlock(mutex);
+        bool ret = upump_uring_enter(uring_mgr, timeout);
+        if (mutex != NULL)
+            umutex_lock(mutex);
+        if (unlikely(!ret)) {
+            err = UBASE_ERR_EXTERNAL;
+            break;
+        }
+
+        upump_uring_reap(uring_mgr);
+        bool timers = upump_uring_dispatch_timers(uring_mgr,
+                                                  upump_uring_now());
+        bool ready = upump_uring_dispatch_ready(uring_mgr);
+        /* like ev, idlers are only run when no other event is pending */
+        if (!timers && !ready)
+            upump_uring_dispatch_idlers(uring_mgr);
+    }
+
+    if (mutex != NULL)
+        umutex_unlock(mutex);
+    return err;
+}
+
+/** @This processes control commands on a upump_uring_mgr.
+ *
+ * @param mgr pointer to a upump_mgr structure
+ * @param command type of command to process
+ * @param args arguments of the command
+ * @return an error code
+ */
+static int upump_uring_mgr_control(struct upump_mgr *mgr,
+                                   int command, va_list args)
+{
+    switch (command) {
+        case UPUMP_MGR_RUN: {
+            struct umutex *mutex = va_arg(args, struct umutex *);
+            return upump_uring_mgr_run(mgr, mutex);
+        }
+        case UPUMP_MGR_VACUUM:
+            upump_common_mgr_vacuum(mgr);
+            return UBASE_ERR_NONE;
+        default:
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** @This frees a upump manager.
+ *
+ * @param urefcount pointer to urefcount
+ */
+static void upump_uring_mgr_free(struct urefcount *urefcount)
+{
+    struct upump_uring_mgr *uring_mgr =
+        upump_uring_mgr_from_urefcount(urefcount);
+    upump_common_mgr_clean(upump_uring_mgr_to_upump_mgr(uring_mgr));
+    munmap(uring_mgr->sqes, uring_mgr->sqes_size);
+    munmap(uring_mgr->rings, uring_mgr->rings_size);
+    close(uring_mgr->fd);
+    free(uring_mgr);
+}
+
+/** @This allocates and initializes a upump_mgr structure bound to a new
+ * io_uring instance.
+ *
+ * @param upump_pool_depth maximum number of upump structures in the pool
+ * @param upump_blocker_pool_depth maximum number of upump_blocker structures in
+ * the pool
+ * @return pointer to the wrapped upump_mgr structure, or NULL if io_uring is
+ * not available
+ */
+struct upump_mgr *upump_uring_mgr_alloc(uint16_t upump_pool_depth,
+                                        uint16_t upump_blocker_pool_depth)
+{
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    int fd = syscall(__NR_io_uring_setup, UPUMP_URING_ENTRIES, &params);
+    if (unlikely(fd < 0))
+        return NULL;
+    if (unlikely(!(params.features & IORING_FEAT_SINGLE_MMAP) ||
+                 !(params.features & IORING_FEAT_EXT_ARG))) {
+        close(fd);
+        return NULL;
+    }
+
+    size_t sq_size = params.sq_off.array +
+                     params.sq_entries * sizeof(unsigned int);
+    size_t cq_size = params.cq_off.cqes +
+                     params.cq_entries * sizeof(struct io_uring_cqe);
+    size_t rings_size = sq_size > cq_size ? sq_size : cq_size;
+    uint8_t *rings = mmap(NULL, rings_size, PROT_READ | PROT_WRITE,
+                          MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (unlikely(rings == MAP_FAILED)) {
+        close(fd);
+        return NULL;
+    }
+    size_t sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    struct io_uring_sqe *sqes = mmap(NULL, sqes_size, PROT_READ | PROT_WRITE,
+                                     MAP_SHARED | MAP_POPULATE, fd,
+                                     IORING_OFF_SQES);
+    if (unlikely(sqes == MAP_FAILED)) {
+        munmap(rings, rings_size);
+        close(fd);
+        return NULL;
+    }
+
+    struct upump_uring_mgr *uring_mgr =
+        malloc(sizeof(struct upump_uring_mgr) +
+               upump_common_mgr_sizeof(upump_pool_depth,
+                                       upump_blocker_pool_depth));
+    if (unlikely(uring_mgr == NULL)) {
+        munmap(sqes, sqes_size);
+        munmap(rings, rings_size);
+        close(fd);
+        return NULL;
+    }
+
+    uring_mgr->fd = fd;
+    uring_mgr->rings = rings;
+    uring_mgr->rings_size = rings_size;
+    uring_mgr->sqes = sqes;
+    uring_mgr->sqes_size = sqes_size;
+    uring_mgr->sq_head = (unsigned int *)(rings + params.sq_off.head);
+    uring_mgr->sq_tail = (unsigned int *)(rings + params.sq_off.tail);
+    uring_mgr->sq_mask = *(unsigned int *)(rings + params.sq_off.ring_mask);
+    uring_mgr->sq_entries =
+        *(unsigned int *)(rings + params.sq_off.ring_entries);
+    uring_mgr->sq_array = (unsigned int *)(rings + params.sq_off.array);
+    uring_mgr->sq_pending = 0;
+    uring_mgr->cq_head = (unsigned int *)(rings + params.cq_off.head);
+    uring_mgr->cq_tail = (unsigned int *)(rings + params.cq_off.tail);
+    uring_mgr->cq_mask = *(unsigned int *)(rings + params.cq_off.ring_mask);
+    uring_mgr->cqes = (struct io_uring_cqe *)(rings + params.cq_off.cqes);
+
+    ulist_init(&uring_mgr->idlers);
+    ulist_init(&uring_mgr->timers);
+    ulist_init(&uring_mgr->ready);
+    uring_mgr->nb_blocking = 0;
+    uring_mgr->dispatching = NULL;
+
+    struct upump_mgr *mgr = upump_uring_mgr_to_upump_mgr(uring_mgr);
+    mgr->signature = UPUMP_URING_SIGNATURE;
+    urefcount_init(upump_uring_mgr_to_urefcount(uring_mgr),
+                   upump_uring_mgr_free);
+    uring_mgr->common_mgr.mgr.refcount =
+        upump_uring_mgr_to_urefcount(uring_mgr);
+    uring_mgr->common_mgr.mgr.upump_alloc = upump_uring_alloc;
+    uring_mgr->common_mgr.mgr.upump_control = upump_uring_control;
+    uring_mgr->common_mgr.mgr.upump_mgr_control = upump_uring_mgr_control;
+
+    upump_common_mgr_init(mgr, upump_pool_depth, upump_blocker_pool_depth,
+                          uring_mgr->upool_extra,
+                          upump_uring_real_start, upump_uring_real_stop,
+                          upump_uring_alloc_inner, upump_uring_free_inner);
+    return mgr;
+}
@@ -18,3 +18,25 @@ intptr_t ffi_va_arg(va_list *ap, const char *type)
     va(uint64_t);
     else abort();
 }
+
+/* typed variants, selected once per argument type by ffi-stdarg.lua */
+
+void *ffi_va_arg_ptr(va_list *ap)
+{
+    return va_arg(*ap, void *);
+}
+
+int ffi_va_arg_int(va_list *ap)
+{
+    return va_arg(*ap, int);
+}
+
+unsigned int ffi_va_arg_uint(va_list *ap)
+{
+    return va_arg(*ap, unsigned int);
+}
+
+uint64_t ffi_va_arg_uint64(va_list *ap)
+{
+    return va_arg(*ap, uint64_t);
+}
@@ -3,32 +3,87 @@ local stdarg = ffi.load("ffi-stdarg")
 
 ffi.cdef [[
     intptr_t ffi_va_arg(va_list *ap, const char *type);
+    void *ffi_va_arg_ptr(va_list *ap);
+    int ffi_va_arg_int(va_list *ap);
+    unsigned int ffi_va_arg_uint(va_list *ap);
+    uint64_t ffi_va_arg_uint64(va_list *ap);
 ]]
 
-local is_number = {
-    int = true,
-    ["unsigned int"] = true,
-    ["signed int"] = true,
-    uint32_t = true,
+local readers = {
+    int = stdarg.ffi_va_arg_int,
+    ["signed int"] = stdarg.ffi_va_arg_int,
+    ["unsigned int"] = stdarg.ffi_va_arg_uint,
+    uint32_t = stdarg.ffi_va_arg_uint,
+    uint64_t = stdarg.ffi_va_arg_uint64,
+    ["const char *"] = function (ap)
+        local p = stdarg.ffi_va_arg_ptr(ap)
+        return p ~= nil and ffi.string(ffi.cast("const char *", p)) or nil
+    end,
 }
 
-return function (va_list, ...)
+-- returns the function reading an argument of the given type
+local function reader(ty)
+    local f = readers[ty]
+    if f then return f end
+    if ty:sub(-1) == "*" then
+        local ct = ffi.typeof(ty)
+        f = function (ap) return ffi.cast(ct, stdarg.ffi_va_arg_ptr(ap)) end
+    elseif ty:match("^enum ") or ty == "bool" then
+        -- promoted to int
+        f = stdarg.ffi_va_arg_int
+    else
+        error("unsupported va_arg type " .. ty)
+    end
+    readers[ty] = f
+    return f
+end
+
+local function wrap(va_list)
     if ffi.arch ~= "x64" then
-        va_list = ffi.new("void *[1]", va_list)
+        return ffi.new("void *[1]", va_list)
     end
+    return va_list
+end
 
-    local ret = { }
-    local n = select("#", ...)
-    for i = 1, n do
-        local ty = select(i, ...)
-        local val = stdarg.ffi_va_arg(va_list, ty)
-        if is_number[ty] then
-            ret[i] = tonumber(val)
-        elseif ty == "const char *" then
-            ret[i] = val ~= 0 and ffi.string(ffi.cast("const char *", val)) or nil
-        else
-            ret[i] = ffi.cast(select(i, ...), val)
+-- returns a function reading the arguments of the given types from
+-- a va_list, with the readers resolved once
+local function compile(types)
+    local f = { }
+    for i, ty in ipairs(types) do f[i] = reader(ty) end
+    local n = #f
+    if n == 0 then
+        return function () end
+    elseif n == 1 then
+        local f1 = f[1]
+        return function (va_list)
+            return f1(wrap(va_list))
+        end
+    elseif n == 2 then
+        local f1, f2 = f[1], f[2]
+        return function (va_list)
+            local ap = wrap(va_list)
+            local a1 = f1(ap)
+            return a1, f2(ap)
         end
+    elseif n == 3 then
+        local f1, f2, f3 = f[1], f[2], f[3]
+        return function (va_list)
+            local ap = wrap(va_list)
+            local a1 = f1(ap)
+            local a2 = f2(ap)
+            return a1, a2, f3(ap)
+        end
+    end
+    return function (va_list)
+        local ap = wrap(va_list)
+        local ret = { }
+        for i = 1, n do ret[i] = f[i](ap) end
+        return unpack(ret, 1, n)
     end
-    return unpack(ret)
 end
+
+return setmetatable({ compile = compile }, {
+    __call = function (_, va_list, ...)
+        return compile({ ... })(va_list)
+    end
+})
@@ -124,10 +124,7 @@ end
 
 local probe_args = require "uprobe-args"
 
-local function get_probe_args(args, args_list)
-    if not args_list then return args end
-    return va_args(args, unpack(args_list))
-end
+local read_signature = va_args.compile { "uint32_t" }
 
 local function ubase_err(ret)
     return type(ret) == "string" and C["UBASE_ERR_" .. ret:upper()] or ret or C.UBASE_ERR_NONE
@@ -139,18 +136,25 @@ uprobe = setmetatable({ }, {
             local events = { }
             for k, v in pairs(uprobe_throw) do
                 local k = k:upper()
-                events[C[fmt("UPROBE_%s", k)]] = { func = v, args = probe_args[k] }
+                local args = probe_args[k]
+                events[C[fmt("UPROBE_%s", k)]] = {
+                    func = v,
+                    args = args and va_args.compile(args)
+                }
             end
             uprobe_throw = function (probe, pipe, event, args)
                 local e = events[event]
                 if e then
                     if event >= C.UPROBE_LOCAL then
-                        local signature = va_args(args, "uint32_t")
+                        local signature = read_signature(args)
                         if signature ~= pipe.mgr.signature then
                             return C.UBASE_ERR_UNHANDLED
                         end
                     end
-                    return ubase_err(e.func(probe, pipe, get_probe_args(args, e.args)))
+                    if e.args then
+                        return ubase_err(e.func(probe, pipe, e.args(args)))
+                    end
+                    return ubase_err(e.func(probe, pipe, args))
                 else
                     return probe:throw_next(pipe, event, args)
                 end
@@ -189,9 +193,10 @@ local uref_getters = require "uref-getters"
 
 local function getter(getters, f, key)
     if getters[key] then
+        -- the value is copied out before returning, so the buffer is reused
+        local arg_p = ffi.new(getters[key] .. "[1]")
         return function (self, arg)
             if arg ~= nil then return f(self, arg) end
-            local arg_p = ffi.new(getters[key] .. "[1]")
             local ret = f(self, arg_p)
             if not C.ubase_check(ret) then
                 return nil, ret
@@ -303,11 +308,52 @@ ffi.metatype("struct upipe", {
     end,
 })
 
-ffi.metatype("struct uref", {
-    __index = function (_, key)
+-- methods are resolved once per name, not on every access
+local uref_methods = setmetatable({ }, {
+    __index = function (methods, key)
         local f = C[fmt("uref_%s", key)]
-        return getter(uref_getters, f, key) or f
+        f = getter(uref_getters, f, key) or f
+        methods[key] = f
+        return f
+    end
+})
+
+local block_size_p = ffi.new("size_t[1]")
+local block_read_size_p = ffi.new("int[1]")
+local block_read_p = ffi.new("const uint8_t *[1]")
+
+-- returns the size of a block uref as a number, or nil and the error
+function uref_methods.block_size_n(ref)
+    local ret = C.uref_block_size(ref, block_size_p)
+    if not C.ubase_check(ret) then return nil, ret end
+    return tonumber(block_size_p[0])
+end
+
+-- calls f(buffer, size, offset) on each contiguous part of a block uref
+-- from offset, for size octets (-1 for the end), without copying
+function uref_methods.block_foreach(ref, f, offset, size)
+    offset = offset or 0
+    size = size or -1
+    if size < 0 then
+        size = uref_methods.block_size_n(ref)
+        if not size then return C.UBASE_ERR_INVALID end
+        size = size - offset
     end
+    while size > 0 do
+        block_read_size_p[0] = size
+        local ret = C.uref_block_read(ref, offset, block_read_size_p, block_read_p)
+        if not C.ubase_check(ret) then return ret end
+        local n = block_read_size_p[0]
+        f(block_read_p[0], n, offset)
+        C.uref_block_unmap(ref, offset)
+        offset = offset + n
+        size = size - n
+    end
+    return C.UBASE_ERR_NONE
+end
+
+ffi.metatype("struct uref", {
+    __index = uref_methods
 })
 
 ffi.metatype("struct ubuf", {
@@ -358,9 +404,15 @@ end
 
 local ctrl_args = require "upipe-control-args"
 
+local ctrl_readers = { }
+for cmd, types in pairs(ctrl_args) do
+    ctrl_readers[cmd] = va_args.compile(types)
+end
+
 local function control_args(cmd, args)
-    if not ctrl_args[cmd] then return args end
-    return va_args(args, unpack(ctrl_args[cmd]))
+    local r = ctrl_readers[cmd]
+    if not r then return args end
+    return r(args)
 end
 
 local function upipe_helper_alloc(cb)
@@ -0,0 +1,72 @@
+#!/bin/sh
+#
+# Compares the results of the benchmarks against a baseline.
+#
+# Usage: check_perf.sh <results> <baseline> <threshold>
+#
+# Both files contain one JSON object per line, as printed by
+# upipe_core_bench and upipe_ts_bench. A result is identified by its
+# "bench", "role", "producers", "consumers" and "topology" fields, and its
+# throughput is read from "ops_per_sec" or "packets_per_sec". The check
+# fails if a throughput is lower than the baseline by more than <threshold>
+# percent. If the baseline does not exist, it is created from the results.
+
+set -e
+
+results="$1"
+baseline="$2"
+threshold="$3"
+
+if [ ! -f "$results" ]; then
+    echo "check_perf: no results in $results" >&2
+    exit 1
+fi
+
+if [ ! -f "$baseline" ]; then
+    cp "$results" "$baseline"
+    echo "check_perf: recorded baseline $baseline"
+    exit 0
+fi
+
+awk -v threshold="$threshold" '
+function field(line, name,    re, v) {
+    re = "\"" name "\":(\"[^\"]*\"|[0-9.]+)"
+    if (!match(line, re))
+        return ""
+    v = substr(line, RSTART + length(name) + 3, RLENGTH - length(name) - 3)
+    gsub(/"/, "", v)
+    return v
+}
+function key(line) {
+    return field(line, "bench") "/" field(line, "role") field(line, "topology") \
+           "/" field(line, "producers") "/" field(line, "consumers")
+}
+function rate(line,    v) {
+    v = field(line, "ops_per_sec")
+    if (v == "")
+        v = field(line, "packets_per_sec")
+    return v
+}
+FNR == NR {
+    r = rate($0)
+    if (r != "")
+        base[key($0)] = r
+    next
+}
+{
+    r = rate($0)
+    k = key($0)
+    if (r == "" || !(k in base))
+        next
+    delta = base[k] > 0 ? (r - base[k]) * 100 / base[k] : 0
+    status = delta < -threshold ? "FAIL" : "ok"
+    printf "%-4s %-40s %14.0f %14.0f %+7.1f%%\n", status, k, base[k], r, delta
+    checked++
+    if (status == "FAIL")
+        failed++
+}
+END {
+    printf "check_perf: %d results checked, %d regressions over %s%%\n",
+           checked, failed, threshold
+    exit failed ? 1 : 0
+}' "$baseline" "$results"
@@ -77,5 +77,44 @@ int main(int argc, char **argv)
     ubits_put(&bw, 1, 0);
     ubits_put(&bw, 1, 0);
     ubase_nassert(ubits_clean(&bw, &buffer_end));
+
+    /* cross the 64-bit cache boundary */
+    uint8_t large[21];
+    ubits_init(&bw, large, 20);
+    for (int i = 0; i < 10; i++) {
+        ubits_put(&bw, 3, i >> 5);
+        ubits_put(&bw, 13, ((i & 0x1f) << 8) | (2 * i + 1));
+    }
+    ubase_assert(ubits_clean(&bw, &buffer_end));
+    assert(buffer_end == large + 20);
+    for (int i = 0; i < 10; i++) {
+        assert(large[2 * i] == i);
+        assert(large[2 * i + 1] == 2 * i + 1);
+    }
+
+    /* bulk writes */
+    static const uint8_t octets[] = { 9, 10, 11, 12, 13, 14, 15, 16, 17, 18 };
+    ubits_init(&bw, large, sizeof(large));
+    ubits_put64(&bw, 40, UINT64_C(0x0102030405));
+    ubits_put64(&bw, 24, 0x060708);
+    ubits_put(&bw, 8, 0);
+    ubits_put_octets(&bw, octets, sizeof(octets));
+    ubits_put(&bw, 4, 1);
+    ubits_put_octets(&bw, octets, 1);
+    ubits_put(&bw, 4, 2);
+    ubase_assert(ubits_clean(&bw, &buffer_end));
+    assert(buffer_end == large + sizeof(large));
+    for (int i = 0; i < 8; i++)
+        assert(large[i] == i + 1);
+    assert(large[8] == 0);
+    for (int i = 9; i < 19; i++)
+        assert(large[i] == i);
+    assert(large[19] == 0x10);
+    assert(large[20] == 0x92);
+
+    ubits_init(&bw, large, 4);
+    ubits_put(&bw, 8, 1);
+    ubits_put_octets(&bw, octets, 4);
+    ubase_nassert(ubits_clean(&bw, &buffer_end));
     return 0;
 }
@@ -0,0 +1,160 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short unit tests for ubuf manager for block formats backed by a file
+ */
+
+#undef NDEBUG
+
+#include <upipe/ubuf.h>
+#include <upipe/ubuf_block.h>
+#include <upipe/ubuf_block_file.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <assert.h>
+
+#define UBUF_POOL_DEPTH     1
+#define FILE_SIZE           4096
+#define UBUF_OFFSET         1000
+#define UBUF_SIZE           188
+
+int main(int argc, char **argv)
+{
+    char path[] = "ubuf_block_file_test.XXXXXX";
+    int fd = mkstemp(path);
+    assert(fd != -1);
+    unlink(path);
+    uint8_t data[FILE_SIZE];
+    for (int i = 0; i < FILE_SIZE; i++)
+        data[i] = i * 7;
+    assert(write(fd, data, FILE_SIZE) == FILE_SIZE);
+
+    struct ubuf_mgr *mgr = ubuf_block_file_mgr_alloc(UBUF_POOL_DEPTH,
+                                                     UBUF_POOL_DEPTH, fd);
+    assert(mgr != NULL);
+    /* the manager keeps its own file descriptor */
+    close(fd);
+
+    assert(ubuf_block_alloc(mgr, UBUF_SIZE) == NULL);
+    struct ubuf *ubuf1, *ubuf2;
+    ubuf1 = ubuf_block_file_alloc(mgr, UBUF_OFFSET, UBUF_SIZE);
+    assert(ubuf1 != NULL);
+
+    size_t size;
+    ubase_assert(ubuf_block_size(ubuf1, &size));
+    assert(size == UBUF_SIZE);
+
+    int wanted = -1, range_fd;
+    uint64_t range_offset;
+    ubase_assert(ubuf_block_file_get_range(ubuf1, 0, &wanted, &range_fd,
+                                           &range_offset));
+    assert(wanted == UBUF_SIZE);
+    assert(range_offset == UBUF_OFFSET);
+    wanted = 10;
+    ubase_assert(ubuf_block_file_get_range(ubuf1, 42, &wanted, &range_fd,
+                                           &range_offset));
+    assert(wanted == 10);
+    assert(range_offset == UBUF_OFFSET + 42);
+
+    /* the payload is only read on mapping */
+    const uint8_t *r;
+    wanted = -1;
+    ubase_assert(ubuf_block_read(ubuf1, 0, &wanted, &r));
+    assert(wanted == UBUF_SIZE);
+    assert(!memcmp(r, data + UBUF_OFFSET, UBUF_SIZE));
+    ubase_assert(ubuf_block_unmap(ubuf1, 0));
+
+    /* test ubuf_block_splice and ubuf_block_resize */
+    ubuf2 = ubuf_block_splice(ubuf1, 10, 20);
+    assert(ubuf2 != NULL);
+    ubase_assert(ubuf_block_resize(ubuf2, 5, -1));
+    ubase_assert(ubuf_block_size(ubuf2, &size));
+    assert(size == 15);
+    wanted = -1;
+    ubase_assert(ubuf_block_file_get_range(ubuf2, 0, &wanted, &range_fd,
+                                           &range_offset));
+    assert(wanted == 15);
+    assert(range_offset == UBUF_OFFSET + 15);
+    wanted = -1;
+    ubase_assert(ubuf_block_read(ubuf2, 0, &wanted, &r));
+    assert(wanted == 15);
+    assert(!memcmp(r, data + UBUF_OFFSET + 15, 15));
+    ubase_assert(ubuf_block_unmap(ubuf2, 0));
+
+    /* shared ranges are not writable */
+    uint8_t *w;
+    wanted = -1;
+    ubase_nassert(ubuf_block_write(ubuf2, 0, &wanted, &w));
+    ubuf_free(ubuf2);
+
+    /* test ubuf_block_split */
+    ubuf2 = ubuf_block_split(ubuf1, 100);
+    assert(ubuf2 != NULL);
+    wanted = -1;
+    ubase_assert(ubuf_block_file_get_range(ubuf2, 0, &wanted, &range_fd,
+                                           &range_offset));
+    assert(wanted == UBUF_SIZE - 100);
+    assert(range_offset == UBUF_OFFSET + 100);
+    ubase_assert(ubuf_block_append(ubuf1, ubuf2));
+    ubase_assert(ubuf_block_size(ubuf1, &size));
+    assert(size == UBUF_SIZE);
+    wanted = -1;
+    ubase_assert(ubuf_block_file_get_range(ubuf1, 120, &wanted, &range_fd,
+                                           &range_offset));
+    assert(wanted == UBUF_SIZE - 120);
+    assert(range_offset == UBUF_OFFSET + 120);
+    ubuf_free(ubuf1);
+
+    /* written ranges no longer match the file */
+    ubuf1 = ubuf_block_file_alloc(mgr, UBUF_OFFSET, UBUF_SIZE);
+    assert(ubuf1 != NULL);
+    wanted = 1;
+    ubase_assert(ubuf_block_write(ubuf1, 0, &wanted, &w));
+    assert(wanted == 1);
+    w[0] = 0xAB;
+    ubase_assert(ubuf_block_unmap(ubuf1, 0));
+    wanted = -1;
+    ubase_nassert(ubuf_block_file_get_range(ubuf1, 0, &wanted, &range_fd,
+                                            &range_offset));
+    wanted = 1;
+    ubase_assert(ubuf_block_read(ubuf1, 0, &wanted, &r));
+    assert(r[0] == 0xAB);
+    ubase_assert(ubuf_block_unmap(ubuf1, 0));
+    ubuf_free(ubuf1);
+
+    /* ranges past the end of file can't be mapped */
+    ubuf1 = ubuf_block_file_alloc(mgr, FILE_SIZE - 10, UBUF_SIZE);
+    assert(ubuf1 != NULL);
+    wanted = -1;
+    ubase_nassert(ubuf_block_read(ubuf1, 0, &wanted, &r));
+    ubuf_free(ubuf1);
+
+    ubuf_mgr_release(mgr);
+    return 0;
+}
@@ -121,6 +121,14 @@ int main(int argc, char **argv)
     assert(r[UBUF_SIZE + UBUF_PREPEND - 1] == UBUF_SIZE);
     ubase_assert(ubuf_block_unmap(ubuf1, 0));
 
+    /* headroom of a shared buffer may not be used */
+    ubase_assert(ubuf_block_resize(ubuf1, UBUF_PREPEND, -1));
+    ubuf2 = ubuf_dup(ubuf1);
+    assert(ubuf2 != NULL);
+    ubase_nassert(ubuf_block_prepend(ubuf1, UBUF_PREPEND));
+    ubuf_free(ubuf2);
+    ubase_assert(ubuf_block_prepend(ubuf1, UBUF_PREPEND));
+
     ubuf_free(ubuf1);
 
 
@@ -205,6 +213,24 @@ int main(int argc, char **argv)
     ubase_assert(ubuf_block_unmap(ubuf2, 0));
     ubuf_free(ubuf2);
 
+    /* test ubuf_block_consume */
+    ubuf2 = ubuf_block_splice(ubuf1, 0, -1);
+    assert(ubuf2 != NULL);
+    ubase_assert(ubuf_block_consume(&ubuf2, 10));
+    ubase_assert(ubuf_block_size(ubuf2, &size));
+    assert(size == 55);
+    ubase_assert(ubuf_block_consume(&ubuf2, 40));
+    ubase_assert(ubuf_block_size(ubuf2, &size));
+    assert(size == 15);
+    wanted = -1;
+    ubase_assert(ubuf_block_read(ubuf2, 0, &wanted, &r));
+    assert(wanted == 15);
+    for (int i = 0; i < 15; i++)
+        assert(r[i] == i + 50);
+    ubase_assert(ubuf_block_unmap(ubuf2, 0));
+    ubase_nassert(ubuf_block_consume(&ubuf2, 16));
+    ubuf_free(ubuf2);
+
     /* test ubuf_block_peek */
     uint8_t buffer[4];
     r = ubuf_block_peek(ubuf1, 30, 4, buffer);
@@ -254,6 +280,39 @@ int main(int argc, char **argv)
     ubase_assert(ubuf_block_equal(ubuf1, ubuf2));
     ubuf_free(ubuf2);
 
+    /* test ubuf_block_merge_read */
+    const uint8_t *segment;
+    wanted = -1;
+    ubase_assert(ubuf_block_read(ubuf1, 49, &wanted, &segment));
+    assert(wanted == 16);
+    ubase_assert(ubuf_block_unmap(ubuf1, 49));
+    ubuf2 = ubuf_block_splice(ubuf1, 0, -1);
+    assert(ubuf2 != NULL);
+    ubase_assert(ubuf_block_merge_read(mgr, &ubuf2, 50, 4));
+    wanted = -1;
+    ubase_assert(ubuf_block_read(ubuf2, 0, &wanted, &r));
+    assert(wanted == 4);
+    assert(r == segment + 1); /* no copy */
+    ubase_assert(ubuf_block_unmap(ubuf2, 0));
+    ubuf_free(ubuf2);
+
+    ubuf2 = ubuf_block_splice(ubuf1, 0, -1);
+    assert(ubuf2 != NULL);
+    ubase_assert(ubuf_block_merge_read(mgr, &ubuf2, 0, -1));
+    wanted = -1;
+    ubase_assert(ubuf_block_read(ubuf2, 0, &wanted, &r));
+    assert(wanted == 65);
+    for (int i = 0; i < wanted; i++)
+        assert(r[i] == i);
+    ubase_assert(ubuf_block_unmap(ubuf2, 0));
+    const uint8_t *merged = r;
+    ubase_assert(ubuf_block_merge_read(mgr, &ubuf2, 0, -1));
+    wanted = -1;
+    ubase_assert(ubuf_block_read(ubuf2, 0, &wanted, &r));
+    assert(r == merged); /* already contiguous */
+    ubase_assert(ubuf_block_unmap(ubuf2, 0));
+    ubuf_free(ubuf2);
+
     /* test ubuf_block_match */
     uint8_t filter[] = { 0, 1, 2, 1 };
     uint8_t mask[] = { 0xff, 0xff, 0x0f, 0xfd };
@@ -270,6 +329,16 @@ int main(int argc, char **argv)
     offset = 0;
     ubase_assert(ubuf_block_find(ubuf1, &offset, 2, 2, 3));
     assert(offset == 2);
+    offset = 0;
+    ubase_assert(ubuf_block_find(ubuf1, &offset, 4, 30, 31, 32, 33));
+    assert(offset == 30);
+    ubase_assert(ubuf_block_find(ubuf1, &offset, 3, 40, 41, 42));
+    assert(offset == 40);
+    offset = 0;
+    ubase_nassert(ubuf_block_find(ubuf1, &offset, 2, 5, 7));
+    size_t total;
+    ubase_assert(ubuf_block_size(ubuf1, &total));
+    assert(offset == total);
 
     /* test ubuf_block_stream */
     struct ubuf_block_stream s;
@@ -286,6 +355,22 @@ int main(int argc, char **argv)
     }
     ubuf_block_stream_clean(&s);
 
+    static const uint8_t opaque[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9 };
+    ubuf_block_stream_init_from_opaque(&s, opaque, sizeof(opaque));
+    ubuf_block_stream_fill_bits(&s, 4);
+    ubuf_block_stream_skip_bits(&s, 4);
+    ubuf_block_stream_fill_bits(&s, 32);
+    assert(ubuf_block_stream_show_bits(&s, 32) == 0x10203040);
+    ubuf_block_stream_skip_bits(&s, 32);
+    ubuf_block_stream_fill_bits(&s, 32);
+    assert(ubuf_block_stream_show_bits(&s, 32) == 0x50607080);
+    ubuf_block_stream_skip_bits(&s, 32);
+    assert(!s.overflow);
+    ubuf_block_stream_fill_bits(&s, 12);
+    assert(ubuf_block_stream_show_bits(&s, 12) == 0x900);
+    assert(s.overflow);
+    ubuf_block_stream_clean(&s);
+
     /* test ubuf_block_delete */
     ubase_assert(ubuf_block_delete(ubuf1, 8, 32));
     uint8_t buf[33];
@@ -31,6 +31,7 @@
 
 #include <upipe/umem.h>
 #include <upipe/umem_alloc.h>
+#include <upipe/upool.h>
 #include <upipe/ubuf.h>
 #include <upipe/ubuf_pic.h>
 #include <upipe/ubuf_block.h>
@@ -73,6 +74,59 @@ static void fill_in(struct ubuf *ubuf)
     }
 }
 
+static void check_clear(struct umem_mgr *umem_mgr, uint8_t macropixel,
+                        const char *chroma, uint8_t macropixel_size,
+                        size_t hsize, size_t vsize, int fullrange,
+                        const uint8_t *pattern, size_t period)
+{
+    struct ubuf_mgr *mgr;
+    struct ubuf *ubuf;
+    size_t stride;
+    uint8_t *w;
+    const uint8_t *r;
+
+    mgr = ubuf_pic_mem_mgr_alloc(UBUF_POOL_DEPTH, UBUF_POOL_DEPTH, umem_mgr,
+                                 macropixel, macropixel, macropixel,
+                                 UBUF_PREPEND, UBUF_APPEND,
+                                 UBUF_ALIGN, UBUF_ALIGN_HOFFSET);
+    assert(mgr != NULL);
+    ubase_assert(ubuf_pic_mem_mgr_add_plane(mgr, chroma, 1, 1,
+                                            macropixel_size));
+    ubuf = ubuf_pic_alloc(mgr, hsize, vsize);
+    assert(ubuf != NULL);
+    ubase_assert(ubuf_pic_plane_size(ubuf, chroma, &stride, NULL, NULL, NULL));
+    size_t octets = hsize / macropixel * macropixel_size;
+
+    /* whole picture */
+    ubase_assert(ubuf_pic_clear(ubuf, 0, 0, -1, -1, fullrange));
+    ubase_assert(ubuf_pic_plane_read(ubuf, chroma, 0, 0, -1, -1, &r));
+    for (size_t y = 0; y < vsize; y++)
+        for (size_t x = 0; x < octets; x++)
+            assert(r[y * stride + x] == pattern[x % period]);
+    ubase_assert(ubuf_pic_plane_unmap(ubuf, chroma, 0, 0, -1, -1));
+
+    /* part of the picture */
+    ubase_assert(ubuf_pic_plane_write(ubuf, chroma, 0, 0, -1, -1, &w));
+    for (size_t y = 0; y < vsize; y++)
+        memset(w + y * stride, 0xff, octets);
+    ubase_assert(ubuf_pic_plane_unmap(ubuf, chroma, 0, 0, -1, -1));
+    ubase_assert(ubuf_pic_plane_clear(ubuf, chroma, macropixel, 1,
+                                      2 * macropixel, 2, fullrange));
+    ubase_assert(ubuf_pic_plane_read(ubuf, chroma, 0, 0, -1, -1, &r));
+    for (size_t y = 0; y < vsize; y++)
+        for (size_t x = 0; x < octets; x++) {
+            if (y >= 1 && y < 3 && x >= macropixel_size &&
+                x < 3 * macropixel_size)
+                assert(r[y * stride + x] == pattern[x % period]);
+            else
+                assert(r[y * stride + x] == 0xff);
+        }
+    ubase_assert(ubuf_pic_plane_unmap(ubuf, chroma, 0, 0, -1, -1));
+
+    ubuf_free(ubuf);
+    ubuf_mgr_release(mgr);
+}
+
 int main(int argc, char **argv)
 {
     struct umem_mgr *umem_mgr = umem_alloc_mgr_alloc();
@@ -196,6 +250,23 @@ int main(int argc, char **argv)
     assert(r[0] == 1);
     ubase_assert(ubuf_pic_plane_unmap(ubuf1, "v8", 4, 0, -1, -1));
 
+    assert(ubuf_pic_view(ubuf1, 1, 0, 31, 32) == NULL);
+    ubuf2 = ubuf_pic_view(ubuf1, 4, 0, 8, 8);
+    assert(ubuf2 != NULL);
+    ubase_assert(ubuf_pic_size(ubuf2, &hsize, &vsize, NULL));
+    assert(hsize == 8);
+    assert(vsize == 8);
+    ubase_assert(ubuf_pic_plane_read(ubuf2, "y8", 0, 0, -1, -1, &r));
+    assert(r[0] == 1);
+    ubase_assert(ubuf_pic_plane_unmap(ubuf2, "y8", 0, 0, -1, -1));
+    ubase_assert(ubuf_pic_plane_read(ubuf2, "u8", 0, 0, -1, -1, &r));
+    assert(r[0] == 1);
+    ubase_assert(ubuf_pic_plane_unmap(ubuf2, "u8", 0, 0, -1, -1));
+    ubuf_free(ubuf2);
+    ubase_assert(ubuf_pic_plane_read(ubuf1, "y8", 4, 0, -1, -1, &r));
+    assert(r[0] == 1);
+    ubase_assert(ubuf_pic_plane_unmap(ubuf1, "y8", 4, 0, -1, -1));
+
     ubuf_free(ubuf1);
 
     ubuf_mgr_release(mgr);
@@ -298,6 +369,66 @@ int main(int argc, char **argv)
     ubuf_free(ubuf1);
 
     ubuf_mgr_release(mgr);
+
+    /* dedicated frame pool */
+    mgr = ubuf_pic_mem_mgr_alloc(UBUF_POOL_DEPTH, UBUF_POOL_DEPTH, umem_mgr, 1,
+                                 UBUF_PREPEND, UBUF_APPEND,
+                                 UBUF_PREPEND, UBUF_APPEND,
+                                 UBUF_ALIGN, UBUF_ALIGN_HOFFSET);
+    assert(mgr != NULL);
+    ubase_assert(ubuf_pic_mem_mgr_add_plane(mgr, "y8", 1, 1, 1));
+    ubase_assert(ubuf_pic_mem_mgr_add_plane(mgr, "u8", 2, 2, 1));
+    ubase_assert(ubuf_pic_mem_mgr_add_plane(mgr, "v8", 2, 2, 1));
+    ubase_assert(ubuf_pic_mem_mgr_add_frame_pool(mgr, 32, 32, 2, 2));
+    ubase_nassert(ubuf_pic_mem_mgr_add_frame_pool(mgr, 32, 32, 2, 2));
+    ubase_assert(ubuf_mgr_set_stats(mgr, true));
+
+    ubuf1 = ubuf_pic_alloc(mgr, 32, 32);
+    assert(ubuf1 != NULL);
+    ubase_assert(ubuf_pic_plane_write(ubuf1, "y8", 0, 0, -1, -1, &w));
+    ubase_assert(ubuf_pic_plane_unmap(ubuf1, "y8", 0, 0, -1, -1));
+    ubuf_free(ubuf1);
+    ubuf1 = ubuf_pic_alloc(mgr, 32, 32);
+    assert(ubuf1 != NULL);
+    ubase_assert(ubuf_pic_plane_read(ubuf1, "y8", 0, 0, -1, -1, &r));
+    assert(r == w);
+    ubase_assert(ubuf_pic_plane_unmap(ubuf1, "y8", 0, 0, -1, -1));
+    ubuf2 = ubuf_pic_alloc(mgr, 64, 64);
+    assert(ubuf2 != NULL);
+    ubase_assert(ubuf_pic_size(ubuf2, &hsize, &vsize, NULL));
+    assert(hsize == 64);
+    assert(vsize == 64);
+    ubuf_free(ubuf2);
+    ubuf_free(ubuf1);
+    struct upool_stats frame_stats;
+    ubase_assert(ubuf_pic_mem_mgr_get_frame_stats(mgr, &frame_stats));
+    assert(frame_stats.hits == 2);
+    assert(frame_stats.misses == 0);
+    assert(frame_stats.in_use == 0);
+    ubuf_mgr_release(mgr);
+
+    /* clear patterns */
+    static const uint8_t y8[] = { 16 };
+    static const uint8_t y10l[] = { 64, 0 };
+    static const uint8_t u10l[] = { 0, 2 };
+    static const uint8_t uyvy[] = { 0x80, 16, 0x80, 16 };
+    static const uint8_t v210[] = {
+        0x00, 0x02, 0x01, 0x20, 0x40, 0x00, 0x08, 0x04,
+        0x00, 0x02, 0x01, 0x20, 0x40, 0x00, 0x08, 0x04
+    };
+    static const uint8_t v210_full[] = {
+        0x00, 0x02, 0x00, 0x20, 0x00, 0x00, 0x08, 0x00,
+        0x00, 0x02, 0x00, 0x20, 0x00, 0x00, 0x08, 0x00
+    };
+    check_clear(umem_mgr, 1, "y8", 1, 33, 8, 0, y8, 1);
+    check_clear(umem_mgr, 1, "y10l", 2, 1920, 1080, 0, y10l, 2);
+    check_clear(umem_mgr, 1, "u10l", 2, 35, 8, 0, u10l, 2);
+    check_clear(umem_mgr, 2, "u8y8v8y8", 4, 1920, 1080, 0, uyvy, 4);
+    check_clear(umem_mgr, 6, "u10y10v10y10u10y10v10y10u10y10v10y10", 16,
+                1920, 1080, 0, v210, 16);
+    check_clear(umem_mgr, 6, "u10y10v10y10u10y10v10y10u10y10v10y10", 16,
+                1278, 4, 1, v210_full, 16);
+
     umem_mgr_release(umem_mgr);
     return 0;
 }
@@ -206,6 +206,55 @@ int main(int argc, char **argv)
     ubuf_free(ubuf1);
     ubuf_mgr_release(mgr);
 
+    /* planes shared with another sound ubuf */
+    mgr = ubuf_sound_mem_mgr_alloc(UBUF_POOL_DEPTH, UBUF_POOL_DEPTH, umem_mgr,
+                                   4, 32);
+    assert(mgr != NULL);
+    ubase_assert(ubuf_sound_mem_mgr_add_plane(mgr, "l"));
+    ubase_assert(ubuf_sound_mem_mgr_add_plane(mgr, "r"));
+    ubase_assert(ubuf_sound_mem_mgr_add_plane(mgr, "L"));
+    ubase_assert(ubuf_sound_mem_mgr_add_plane(mgr, "R"));
+
+    ubuf1 = ubuf_sound_alloc(mgr, 32);
+    assert(ubuf1 != NULL);
+    fill_in(ubuf1);
+    ubase_assert(ubuf_sound_resize(ubuf1, 2, -1));
+
+    struct ubuf_mgr *pair_mgr = ubuf_sound_mem_mgr_alloc(UBUF_POOL_DEPTH,
+            UBUF_POOL_DEPTH, umem_mgr, 4, 32);
+    assert(pair_mgr != NULL);
+    ubase_assert(ubuf_sound_mem_mgr_add_plane(pair_mgr, "l"));
+    ubase_assert(ubuf_sound_mem_mgr_add_plane(pair_mgr, "r"));
+
+    const char *pair[2] = { "R", "r" };
+    ubuf2 = ubuf_sound_mem_alloc_from_sound(pair_mgr, ubuf1, pair);
+    assert(ubuf2 != NULL);
+    ubase_assert(ubuf_sound_size(ubuf2, &size, &sample_size));
+    assert(size == 30);
+    assert(sample_size == 4);
+    ubase_assert(ubuf_sound_plane_read_uint8_t(ubuf2, "l", 0, -1, &r));
+    assert(r[0] == 'R' + 8);
+    ubase_assert(ubuf_sound_plane_unmap(ubuf2, "l", 0, -1));
+    ubase_assert(ubuf_sound_plane_read_uint8_t(ubuf2, "r", 0, -1, &r));
+    assert(r[0] == 'r' + 8);
+    ubase_assert(ubuf_sound_plane_unmap(ubuf2, "r", 0, -1));
+    /* the buffer is shared, so neither may be written */
+    ubase_nassert(ubuf_sound_plane_write_uint8_t(ubuf2, "l", 0, -1, &w));
+    ubase_nassert(ubuf_sound_plane_write_uint8_t(ubuf1, "l", 0, -1, &w));
+
+    const char *wrong[2] = { "R", "x" };
+    assert(ubuf_sound_mem_alloc_from_sound(pair_mgr, ubuf1, wrong) == NULL);
+
+    ubuf_free(ubuf1);
+    ubase_assert(ubuf_sound_plane_read_uint8_t(ubuf2, "r", 0, -1, &r));
+    assert(r[0] == 'r' + 8);
+    ubase_assert(ubuf_sound_plane_unmap(ubuf2, "r", 0, -1));
+    ubase_assert(ubuf_sound_plane_write_uint8_t(ubuf2, "r", 0, -1, &w));
+    ubase_assert(ubuf_sound_plane_unmap(ubuf2, "r", 0, -1));
+    ubuf_free(ubuf2);
+    ubuf_mgr_release(pair_mgr);
+    ubuf_mgr_release(mgr);
+
     /* sound -> block transformation */
     mgr = ubuf_sound_mem_mgr_alloc(UBUF_POOL_DEPTH, UBUF_POOL_DEPTH, umem_mgr,
                                    4, 32);
@@ -229,10 +278,82 @@ int main(int argc, char **argv)
     assert(r[0] == 'l');
 
     ubuf_free(ubuf_block);
+    ubuf_free(ubuf1);
+
+    /* block -> sound transformation */
+    ubuf_block = ubuf_block_alloc(block_mgr, 32 * 4 + 3);
+    assert(ubuf_block != NULL);
+    uint8_t *w_block;
+    size2 = -1;
+    ubase_assert(ubuf_block_write(ubuf_block, 0, &size2, &w_block));
+    memset(w_block, 'b', size2);
+    ubase_assert(ubuf_block_unmap(ubuf_block, 0));
+
+    ubuf1 = ubuf_sound_mem_alloc_from_block(mgr, ubuf_block);
+    assert(ubuf1 != NULL);
+    ubase_assert(ubuf_sound_size(ubuf1, &size, &sample_size));
+    assert(size == 32);
+    assert(sample_size == 4);
+    ubase_assert(ubuf_sound_plane_read_uint8_t(ubuf1, "lr", 0, -1, &r));
+    assert(r == w_block);
+    assert(r[0] == 'b');
+    ubase_assert(ubuf_sound_plane_unmap(ubuf1, "lr", 0, -1));
+    /* read-only while the block exists */
+    ubase_nassert(ubuf_sound_plane_write_uint8_t(ubuf1, "lr", 0, -1, &w));
+    ubuf_free(ubuf_block);
+    ubase_assert(ubuf_sound_plane_write_uint8_t(ubuf1, "lr", 0, -1, &w));
+    ubase_assert(ubuf_sound_plane_unmap(ubuf1, "lr", 0, -1));
+    ubuf_free(ubuf1);
+
+    /* segmented blocks are refused */
+    ubuf_block = ubuf_block_alloc(block_mgr, 32);
+    assert(ubuf_block != NULL);
+    ubase_assert(ubuf_block_append(ubuf_block,
+                                   ubuf_block_alloc(block_mgr, 32)));
+    assert(ubuf_sound_mem_alloc_from_block(mgr, ubuf_block) == NULL);
+    ubuf_free(ubuf_block);
+
     ubuf_mgr_release(block_mgr);
+
+    ubuf_mgr_release(mgr);
+
+    /* dedicated frame pool and views */
+    mgr = ubuf_sound_mem_mgr_alloc(UBUF_POOL_DEPTH, UBUF_POOL_DEPTH, umem_mgr,
+                                   sizeof(float), 0);
+    assert(mgr != NULL);
+    ubase_assert(ubuf_sound_mem_mgr_add_plane(mgr, "l"));
+    ubase_assert(ubuf_sound_mem_mgr_add_plane(mgr, "r"));
+    ubase_assert(ubuf_sound_mem_mgr_add_frame_pool(mgr, 1920, 2, 2));
+    ubase_nassert(ubuf_sound_mem_mgr_add_frame_pool(mgr, 1920, 2, 2));
+
+    ubuf1 = ubuf_sound_alloc(mgr, 1920);
+    assert(ubuf1 != NULL);
+    ubase_assert(ubuf_sound_plane_write_uint8_t(ubuf1, "r", 0, -1, &w));
+    assert(!((uintptr_t)w % 64));
+    ubase_assert(ubuf_sound_plane_unmap(ubuf1, "r", 0, -1));
     ubuf_free(ubuf1);
+    ubuf1 = ubuf_sound_alloc(mgr, 1920);
+    assert(ubuf1 != NULL);
+    ubase_assert(ubuf_sound_plane_read_uint8_t(ubuf1, "r", 0, -1, &r));
+    assert(r == w);
+    ubase_assert(ubuf_sound_plane_unmap(ubuf1, "r", 0, -1));
+    fill_in(ubuf1);
 
+    ubuf2 = ubuf_sound_view(ubuf1, 480, 960);
+    assert(ubuf2 != NULL);
+    ubase_assert(ubuf_sound_size(ubuf2, &size, NULL));
+    assert(size == 960);
+    ubase_assert(ubuf_sound_plane_read_uint8_t(ubuf2, "l", 0, 1, &r));
+    assert(*r == (uint8_t)('l' + 480 * sizeof(float)));
+    ubase_assert(ubuf_sound_plane_unmap(ubuf2, "l", 0, 1));
+    assert(ubuf_sound_view(ubuf1, 0, 1921) == NULL);
+    ubuf_free(ubuf2);
+
+    ubase_assert(ubuf_sound_size(ubuf1, &size, NULL));
+    assert(size == 1920);
+    ubuf_free(ubuf1);
     ubuf_mgr_release(mgr);
+
     umem_mgr_release(umem_mgr);
     return 0;
 }
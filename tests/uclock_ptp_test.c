@@ -0,0 +1,90 @@
+/*****************************************************************************
+ * uclock_ptp_test.c: unit tests for uclock_ptp
+ *****************************************************************************
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ *****************************************************************************/
+
+/** @file
+ * @short unit tests for uclock_ptp
+ */
+
+#undef NDEBUG
+
+#include <upipe/uclock.h>
+#include <upipe/uclock_ptp.h>
+#include <upipe/uclock_std.h>
+
+#include <stdio.h>
+#include <inttypes.h>
+#include <assert.h>
+
+#define TIME_SAMPLE 1429627742
+
+int main(int argc, char **argv)
+{
+    assert(uclock_ptp_alloc("/nonexistent/ptp", 0) == NULL);
+
+    struct uclock *uclock = uclock_ptp_alloc(NULL, 0);
+    if (uclock == NULL) {
+        printf("no TAI clock\n");
+        return 0;
+    }
+    struct uclock *uclock_cached =
+        uclock_ptp_alloc(NULL, UCLOCK_PTP_FLAG_CACHED);
+    struct uclock *uclock_real = uclock_std_alloc(UCLOCK_FLAG_REALTIME);
+    assert(uclock_cached);
+    assert(uclock_real);
+
+    uint64_t now = uclock_now(uclock);
+    printf("Now: %"PRIu64"\n", now);
+    assert(now != UINT64_MAX);
+
+    /* TAI is ahead of UTC by the number of leap seconds */
+    uint64_t real = uclock_to_real(uclock, now);
+    uint64_t real_std = uclock_now(uclock_real);
+    assert(real < real_std + UCLOCK_FREQ / 10 &&
+           real_std < real + UCLOCK_FREQ / 10);
+    assert(uclock_from_real(uclock, real) == now);
+    assert(uclock_to_real(uclock, (uint64_t)TIME_SAMPLE * UCLOCK_FREQ) <=
+           (uint64_t)TIME_SAMPLE * UCLOCK_FREQ);
+
+    /* the cached mode must follow the PTP clock */
+    uint64_t last = 0;
+    for (int i = 0; i < 1000; i++) {
+        uint64_t cached = uclock_now(uclock_cached);
+        assert(cached >= last);
+        last = cached;
+        if (!(i % 100)) {
+            now = uclock_now(uclock);
+            /* allow for 1 ms of drift */
+            assert(cached < now + UCLOCK_FREQ / 1000 &&
+                   now < cached + UCLOCK_FREQ / 1000);
+        }
+    }
+
+    uclock_release(uclock_real);
+    uclock_release(uclock_cached);
+    uclock_release(uclock);
+    return 0;
+}
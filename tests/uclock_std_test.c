@@ -55,6 +55,27 @@ int main(int argc, char **argv)
            TIME_SAMPLE * UCLOCK_FREQ);
     assert(uclock_from_real(uclock_cal, (uint64_t)TIME_SAMPLE * UCLOCK_FREQ) ==
            TIME_SAMPLE * UCLOCK_FREQ);
+
+    /* the TSC must follow the monotonic clock */
+    struct uclock *uclock_tsc = uclock_std_alloc(UCLOCK_FLAG_TSC);
+    assert(uclock_tsc);
+    uint64_t last = 0;
+    for (int i = 0; i < 1000; i++) {
+        uint64_t tsc = uclock_now(uclock_tsc);
+        assert(tsc >= last);
+        last = tsc;
+        if (!(i % 100)) {
+            now = uclock_now(uclock);
+            /* allow for 1 ms of drift */
+            assert(tsc < now + UCLOCK_FREQ / 1000 &&
+                   now < tsc + UCLOCK_FREQ / 1000);
+        }
+    }
+    uint64_t real = uclock_to_real(uclock_tsc, last);
+    assert(uclock_from_real(uclock_tsc, real) - last < UCLOCK_FREQ / 1000 ||
+           last - uclock_from_real(uclock_tsc, real) < UCLOCK_FREQ / 1000);
+    uclock_release(uclock_tsc);
+
     uclock_release(uclock);
     uclock_release(uclock_cal);
 }
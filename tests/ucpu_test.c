@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short unit tests for the run-time selection of SIMD kernels
+ */
+
+#undef NDEBUG
+
+#include <upipe/ucpu.h>
+
+#include <stdio.h>
+#include <assert.h>
+
+struct kernel {
+    uint32_t cpu_flags;
+    int id;
+};
+
+static const struct kernel kernels[] = {
+    { UCPU_AVX512, 4 },
+    { UCPU_AVX2, 3 },
+    { UCPU_AVX | UCPU_SSSE3, 2 },
+    { UCPU_SSSE3, 1 },
+    { 0, 0 },
+};
+
+static const struct kernel no_fallback[] = {
+    { UCPU_NEON, 1 },
+};
+
+int main(int argc, char **argv)
+{
+    assert(ucpu_select(kernels, UCPU_ALL)->id == 4);
+    assert(ucpu_select(kernels, UCPU_AVX2 | UCPU_AVX | UCPU_SSSE3)->id == 3);
+    assert(ucpu_select(kernels, UCPU_AVX | UCPU_SSSE3)->id == 2);
+    assert(ucpu_select(kernels, UCPU_AVX)->id == 0);
+    assert(ucpu_select(kernels, UCPU_SSSE3 | UCPU_SSE2)->id == 1);
+    assert(ucpu_select(kernels, 0)->id == 0);
+    assert(ucpu_select(no_fallback, UCPU_SSE2) == NULL);
+    assert(ucpu_select(no_fallback, UCPU_NEON)->id == 1);
+
+    uint32_t flags = ucpu_flags();
+    for (uint32_t flag = 1; flag <= UCPU_NEON; flag <<= 1)
+        if (flags & flag)
+            printf("%s ", ucpu_flag_str(flag));
+    printf("\n");
+
+    ucpu_set_mask(UCPU_SSE2);
+    assert(!(ucpu_flags() & ~UCPU_SSE2));
+    ucpu_set_mask(0);
+    assert(ucpu_flags() == 0);
+    assert(ucpu_select(kernels, ucpu_flags())->id == 0);
+    ucpu_set_mask(UCPU_ALL);
+    assert(ucpu_flags() == flags);
+    return 0;
+}
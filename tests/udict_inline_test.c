@@ -31,6 +31,7 @@
 
 #include <upipe/umem.h>
 #include <upipe/umem_alloc.h>
+#include <upipe/upool.h>
 #include <upipe/udict.h>
 #include <upipe/udict_inline.h>
 #include <upipe/udict_dump.h>
@@ -55,6 +56,7 @@ int main(int argc, char **argv)
     struct udict_mgr *mgr = udict_inline_mgr_alloc(UDICT_POOL_DEPTH, umem_mgr,
                                                    -1, -1);
     assert(mgr != NULL);
+    ubase_assert(udict_mgr_set_stats(mgr, true));
 
     struct udict *udict1 = udict_alloc(mgr, 0);
     assert(udict1 != NULL);
@@ -125,12 +127,99 @@ int main(int argc, char **argv)
     udict_dump(udict2, uprobe);
     udict_free(udict2);
 
+
     udict2 = udict_copy(mgr, udict1);
     assert(udict2 != NULL);
     udict_dump(udict2, uprobe);
     udict_free(udict2);
 
+    /* duplicates share the attributes until one of them is modified */
+    udict2 = udict_dup(udict1);
+    assert(udict2 != NULL);
+    struct udict *udict4 = udict_dup(udict2);
+    assert(udict4 != NULL);
+    const char *string2;
+    ubase_assert(udict_get_string(udict1, &string, UDICT_TYPE_STRING,
+                                  "x.salutation"));
+    ubase_assert(udict_get_string(udict2, &string2, UDICT_TYPE_STRING,
+                                  "x.salutation"));
+    assert(string == string2);
+    ubase_assert(udict_set_int(udict2, 42, UDICT_TYPE_INT, "x.date"));
+    ubase_assert(udict_get_string(udict2, &string2, UDICT_TYPE_STRING,
+                                  "x.salutation"));
+    assert(string != string2);
+    assert(!strcmp(string2, SALUTATION));
+    ubase_assert(udict_get_int(udict1, &d, UDICT_TYPE_INT, "x.date"));
+    assert(d == INT64_MAX);
+    ubase_assert(udict_get_int(udict4, &d, UDICT_TYPE_INT, "x.date"));
+    assert(d == INT64_MAX);
+    ubase_assert(udict_get_int(udict2, &d, UDICT_TYPE_INT, "x.date"));
+    assert(d == 42);
+
+    /* duplicates share a generation, which is lost on modification */
+    assert(udict1->gen && udict1->gen == udict4->gen);
+    assert(udict2->gen != udict1->gen);
+    assert(!udict_cmp(udict1, udict4));
+    assert(udict_cmp(udict1, udict2));
+    ubase_assert(udict_set_int(udict2, INT64_MAX, UDICT_TYPE_INT, "x.date"));
+    assert(!udict_cmp(udict1, udict2));
+    assert(udict2->gen == udict1->gen);
+    udict_free(udict1);
+    ubase_assert(udict_delete(udict4, UDICT_TYPE_INT, "x.date"));
+    ubase_nassert(udict_get_int(udict4, &d, UDICT_TYPE_INT, "x.date"));
+    ubase_assert(udict_get_rational(udict4, &r, UDICT_TYPE_RATIONAL, "x.ar"));
+    assert(r.num == 64 && r.den == 45);
+    udict1 = udict4;
+    udict_free(udict2);
+
     udict_free(udict1);
+
+    /* exercise the lookup index with more attributes than it can hold */
+    struct udict *udict3 = udict_alloc(mgr, 0);
+    assert(udict3 != NULL);
+    ubase_nassert(udict_get_unsigned(udict3, &u, UDICT_TYPE_UNSIGNED, "x.0"));
+    for (int i = 0; i < 64; i++) {
+        char name[16];
+        snprintf(name, sizeof(name), "x.%d", i);
+        ubase_assert(udict_set_unsigned(udict3, i, UDICT_TYPE_UNSIGNED, name));
+        ubase_assert(udict_get_unsigned(udict3, &u, UDICT_TYPE_UNSIGNED, name));
+        assert(u == i);
+    }
+    ubase_assert(udict_set_unsigned(udict3, 42, UDICT_TYPE_PIC_NUM, NULL));
+    ubase_assert(udict_delete(udict3, UDICT_TYPE_UNSIGNED, "x.10"));
+    ubase_nassert(udict_get_unsigned(udict3, &u, UDICT_TYPE_UNSIGNED, "x.10"));
+    ubase_nassert(udict_get_int(udict3, &d, UDICT_TYPE_INT, "x.11"));
+    for (int i = 0; i < 64; i++) {
+        char name[16];
+        snprintf(name, sizeof(name), "x.%d", i);
+        if (i == 10)
+            continue;
+        ubase_assert(udict_get_unsigned(udict3, &u, UDICT_TYPE_UNSIGNED, name));
+        assert(u == i);
+    }
+    ubase_assert(udict_get_unsigned(udict3, &u, UDICT_TYPE_PIC_NUM, NULL));
+    assert(u == 42);
+    ubase_assert(udict_delete(udict3, UDICT_TYPE_PIC_NUM, NULL));
+    ubase_nassert(udict_get_unsigned(udict3, &u, UDICT_TYPE_PIC_NUM, NULL));
+    udict_free(udict3);
+
+    struct udict_stats stats;
+    struct upool_stats pool_stats;
+    ubase_assert(udict_mgr_get_stats(mgr, &stats, &pool_stats));
+    assert(stats.allocs == 6);
+    assert(stats.frees == 6);
+    assert(stats.total_size > 0);
+    assert(stats.reallocs > 0);
+    assert(stats.misses == 6);
+    assert(stats.lookups[UDICT_TYPE_UNSIGNED] >= 127);
+    assert(pool_stats.hits + pool_stats.misses == 6);
+    assert(pool_stats.high_water == 3);
+    assert(pool_stats.vacuums == 0);
+    uint64_t lookups;
+    ubase_assert(udict_inline_mgr_get_shorthand_stats(mgr, UDICT_TYPE_PIC_NUM,
+                                                      &lookups));
+    assert(lookups == 2);
+
     udict_mgr_release(mgr);
 
     umem_mgr_release(umem_mgr);
@@ -151,6 +151,36 @@ static void pop(struct upump *upump)
         upump_stop(upump);
 }
 
+#ifdef UPIPE_HAVE_FUTEX
+static void *futex_push_thread(void *unused)
+{
+    for (uintptr_t i = 1; i <= nb_loops; i++)
+        while (!uqueue_push(&uqueue, (void *)i))
+            uqueue_wait_push(&uqueue, 100, UINT64_MAX);
+    return NULL;
+}
+
+/* hand-off between two threads without event loop */
+static void futex_test(void)
+{
+    uint8_t uqueue_buffer[uqueue_sizeof(UQUEUE_MAX_DEPTH)];
+    assert(uqueue_init_futex(&uqueue, UQUEUE_MAX_DEPTH, uqueue_buffer));
+    assert(!uqueue_wait_pop(&uqueue, 10, 0));
+
+    pthread_t id;
+    assert(pthread_create(&id, NULL, futex_push_thread, NULL) == 0);
+    for (uintptr_t i = 1; i <= nb_loops; i++) {
+        void *element;
+        while ((element = uqueue_pop(&uqueue, void *)) == NULL)
+            uqueue_wait_pop(&uqueue, 100, UINT64_MAX);
+        assert(element == (void *)i);
+    }
+    assert(!pthread_join(id, NULL));
+    assert(!uqueue_length(&uqueue));
+    uqueue_clean(&uqueue);
+}
+#endif
+
 int main(int argc, char **argv)
 {
     static const long nsec_timeouts[ULIFO_MAX_DEPTH] = {
@@ -176,7 +206,41 @@ int main(int argc, char **argv)
         ulifo_push(&ulifo, &elems[i].uchain);
     }
 
+    /* batch operations on the LIFO: same order as single operations */
+    void *batch[ULIFO_MAX_DEPTH + 1];
+    assert(ulifo_pop_batch(&ulifo, batch, 3) == 3);
+    for (int i = 0; i < 3; i++)
+        assert(batch[i] == &elems[ULIFO_MAX_DEPTH - 1 - i].uchain);
+    assert(ulifo_push_batch(&ulifo, batch, 3) == 3);
+    assert(ulifo_pop(&ulifo, struct uchain *) ==
+           &elems[ULIFO_MAX_DEPTH - 3].uchain);
+    ulifo_push(&ulifo, &elems[ULIFO_MAX_DEPTH - 3].uchain);
+    assert(ulifo_pop_batch(&ulifo, batch, ULIFO_MAX_DEPTH + 1) ==
+           ULIFO_MAX_DEPTH);
+    assert(ulifo_push_batch(&ulifo, batch, ULIFO_MAX_DEPTH) ==
+           ULIFO_MAX_DEPTH);
+
     assert(uqueue_init(&uqueue, UQUEUE_MAX_DEPTH, uqueue_buffer));
+
+    /* batch operations on the queue: FIFO order, partial push when full */
+    assert(ulifo_pop_batch(&ulifo, batch, ULIFO_MAX_DEPTH) ==
+           ULIFO_MAX_DEPTH);
+    assert(uqueue_push(&uqueue, batch[0]));
+    assert(uqueue_push_batch(&uqueue, batch + 1, ULIFO_MAX_DEPTH - 1) ==
+           UQUEUE_MAX_DEPTH - 1);
+    assert(uqueue_length(&uqueue) == UQUEUE_MAX_DEPTH);
+    void *popped[UQUEUE_MAX_DEPTH];
+    assert(uqueue_pop(&uqueue, void *) == batch[0]);
+    assert(uqueue_pop_batch(&uqueue, popped, 2) == 2);
+    assert(popped[0] == batch[1] && popped[1] == batch[2]);
+    assert(uqueue_pop_batch(&uqueue, popped, UQUEUE_MAX_DEPTH) ==
+           UQUEUE_MAX_DEPTH - 3);
+    for (int i = 0; i < UQUEUE_MAX_DEPTH - 3; i++)
+        assert(popped[i] == batch[3 + i]);
+    assert(!uqueue_pop_batch(&uqueue, popped, UQUEUE_MAX_DEPTH));
+    assert(ulifo_push_batch(&ulifo, batch, ULIFO_MAX_DEPTH) ==
+           ULIFO_MAX_DEPTH);
+
     struct upump *upump = uqueue_upump_alloc_pop(&uqueue, upump_mgr, pop, NULL,
                                                  NULL);
     assert(upump != NULL);
@@ -204,5 +268,8 @@ int main(int argc, char **argv)
     assert(!pthread_join(threads[0].id, NULL));
     assert(!pthread_join(threads[1].id, NULL));
 
+#ifdef UPIPE_HAVE_FUTEX
+    futex_test();
+#endif
     return 0;
 }
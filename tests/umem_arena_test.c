@@ -0,0 +1,146 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short unit tests for umem arena manager
+ */
+
+#undef NDEBUG
+
+#include <upipe/ubase.h>
+#include <upipe/umem.h>
+#include <upipe/umem_arena.h>
+#include <upipe/udict.h>
+#include <upipe/udict_inline.h>
+#include <upipe/uref.h>
+#include <upipe/uref_std.h>
+#include <upipe/uref_attr.h>
+#include <upipe/uref_block.h>
+#include <upipe/ubuf.h>
+#include <upipe/ubuf_block.h>
+#include <upipe/ubuf_block_mem.h>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+#define CHUNK_SIZE 4096
+
+UREF_ATTR_UNSIGNED(test, id, "x.id", test attribute)
+
+int main(int argc, char **argv)
+{
+    struct umem_mgr *mgr = umem_arena_mgr_alloc(CHUNK_SIZE, 512);
+    assert(mgr != NULL);
+    ubase_assert(umem_mgr_set_stats(mgr, true));
+
+    struct umem umem1, umem2;
+    assert(umem_alloc(mgr, &umem1, 42));
+    assert(umem_alloc(mgr, &umem2, 42));
+    uint8_t *p = umem_buffer(&umem1);
+    assert(!((uintptr_t)p % 16));
+    /* consecutive blocks are carved next to each other */
+    assert(umem_buffer(&umem2) > p);
+    assert(umem_buffer(&umem2) - p <= 64);
+    memset(p, 0x42, 42);
+    printf("Passed 1\n");
+
+    /* the last block is grown in place */
+    p = umem_buffer(&umem2);
+    memset(p, 0x43, 42);
+    assert(umem_realloc(&umem2, 200));
+    assert(umem_buffer(&umem2) == p);
+    assert(p[41] == 0x43);
+    printf("Passed 2\n");
+
+    /* other blocks are moved */
+    assert(umem_realloc(&umem1, 100));
+    p = umem_buffer(&umem1);
+    assert(p[0] == 0x42);
+    assert(p[41] == 0x42);
+    umem_free(&umem1);
+    umem_free(&umem2);
+    printf("Passed 3\n");
+
+    /* large blocks are allocated with malloc() */
+    assert(umem_alloc(mgr, &umem1, 1024));
+    memset(umem_buffer(&umem1), 0x44, 1024);
+    umem_free(&umem1);
+
+    struct umem_stats stats;
+    ubase_assert(umem_mgr_get_stats(mgr, &stats));
+    assert(stats.allocs == 4);
+    assert(stats.reallocs == 1);
+    assert(stats.fallbacks == 1);
+    printf("Passed 4\n");
+
+    /* fill several chunks and release them */
+    struct umem umems[256];
+    for (int i = 0; i < 256; i++) {
+        assert(umem_alloc(mgr, &umems[i], 48));
+        memset(umem_buffer(&umems[i]), i, 48);
+    }
+    for (int i = 0; i < 256; i++) {
+        assert(umem_buffer(&umems[i])[47] == (uint8_t)i);
+        umem_free(&umems[i]);
+    }
+    printf("Passed 5\n");
+
+    /* a small uref with its attributes and payload */
+    struct udict_mgr *udict_mgr = udict_inline_mgr_alloc(0, mgr, 64, -1);
+    assert(udict_mgr != NULL);
+    struct uref_mgr *uref_mgr = uref_std_mgr_alloc_umem(0, udict_mgr, 0, mgr);
+    assert(uref_mgr != NULL);
+    struct ubuf_mgr *ubuf_mgr = ubuf_block_mem_mgr_alloc(0, 0, mgr,
+                                                         0, 0, 0, 0);
+    assert(ubuf_mgr != NULL);
+
+    struct uref *uref = uref_block_alloc(uref_mgr, ubuf_mgr, 188);
+    assert(uref != NULL);
+    ubase_assert(uref_test_set_id(uref, 42));
+    uint8_t *buffer;
+    int size = -1;
+    ubase_assert(uref_block_write(uref, 0, &size, &buffer));
+    assert(size == 188);
+    assert((uint8_t *)buffer - (uint8_t *)uref < CHUNK_SIZE);
+    memset(buffer, 0x47, size);
+    uref_block_unmap(uref, 0);
+
+    struct uref *dup = uref_dup(uref);
+    assert(dup != NULL);
+    uref_free(uref);
+    uint64_t id;
+    ubase_assert(uref_test_get_id(dup, &id));
+    assert(id == 42);
+    uref_free(dup);
+    printf("Passed 6\n");
+
+    ubuf_mgr_release(ubuf_mgr);
+    uref_mgr_release(uref_mgr);
+    udict_mgr_release(udict_mgr);
+    umem_mgr_release(mgr);
+    return 0;
+}
@@ -29,10 +29,12 @@
 
 #undef NDEBUG
 
+#include <upipe/ubase.h>
 #include <upipe/umem.h>
 #include <upipe/umem_pool.h>
 
 #include <stdint.h>
+#include <inttypes.h>
 #include <stdio.h>
 #include <string.h>
 #include <assert.h>
@@ -41,6 +43,7 @@ int main(int argc, char **argv)
 {
     struct umem_mgr *mgr = umem_pool_mgr_alloc_simple(32);
     assert(mgr != NULL);
+    ubase_assert(umem_mgr_set_stats(mgr, true));
 
     struct umem umem;
     assert(umem_alloc(mgr, &umem, 42));
@@ -87,6 +90,78 @@ int main(int argc, char **argv)
     umem_free(&umem);
     printf("Passed 6\n");
 
+    /* go through the magazines and the shared pool in bursts */
+    struct umem umems[48];
+    for (int i = 0; i < 48; i++)
+        assert(umem_alloc(mgr, &umems[i], 32));
+    for (int i = 0; i < 48; i++)
+        umem_free(&umems[i]);
+    for (int i = 0; i < 48; i++) {
+        assert(umem_alloc(mgr, &umems[i], 32));
+        for (int j = 0; j < i; j++)
+            assert(umem_buffer(&umems[i]) != umem_buffer(&umems[j]));
+    }
+    for (int i = 0; i < 48; i++)
+        umem_free(&umems[i]);
+    umem_mgr_vacuum(mgr);
+    printf("Passed 7\n");
+
+    struct umem_stats stats;
+    ubase_assert(umem_mgr_get_stats(mgr, &stats));
+    assert(stats.allocs == 100);
+    assert(stats.reallocs == 1);
+    assert(stats.fallbacks >= 48 + 3 && stats.fallbacks < stats.allocs);
+    size_t class_size;
+    uint64_t allocs, fallbacks, total = 0;
+    unsigned int pool;
+    for (pool = 0; ubase_check(umem_pool_mgr_get_class_stats(mgr, pool,
+                    &class_size, &allocs, &fallbacks)); pool++) {
+        assert(fallbacks <= allocs);
+        if (class_size == 8192)
+            assert(allocs == 2 && fallbacks == 1);
+        total += allocs;
+    }
+    assert(pool > 0);
+    assert(total == stats.allocs);
+    printf("Passed 8\n");
+
+    umem_mgr_release(mgr);
+
+    /* carve large buffers out of an arena, then fall back to malloc() */
+    mgr = umem_pool_mgr_alloc_arena(2 * 1024 * 1024, 0, -1, 64 * 1024, 2,
+                                    4, 4);
+    assert(mgr != NULL);
+    struct umem big[40];
+    for (int i = 0; i < 40; i++) {
+        assert(umem_alloc(mgr, &big[i], 65536));
+        memset(umem_buffer(&big[i]), i, 65536);
+    }
+    for (int i = 0; i < 40; i++) {
+        assert(umem_buffer(&big[i])[65535] == i);
+        umem_free(&big[i]);
+    }
+    umem_mgr_vacuum(mgr);
+    for (int i = 0; i < 40; i++)
+        assert(umem_alloc(mgr, &big[i], 65536));
+    for (int i = 0; i < 40; i++)
+        umem_free(&big[i]);
+    umem_mgr_release(mgr);
+    printf("Passed 9\n");
+
+    /* buffers allocated in advance are served without fallback */
+    mgr = umem_pool_mgr_alloc(32, 2, 4, 4);
+    assert(mgr != NULL);
+    ubase_nassert(umem_mgr_prefill(mgr, 65, 4, false));
+    ubase_assert(umem_mgr_prefill(mgr, 64, 8, true));
+    ubase_assert(umem_mgr_set_stats(mgr, true));
+    for (int i = 0; i < 4; i++)
+        assert(umem_alloc(mgr, &big[i], 64));
+    ubase_assert(umem_mgr_get_stats(mgr, &stats));
+    assert(stats.allocs == 4);
+    assert(stats.fallbacks == 0);
+    for (int i = 0; i < 4; i++)
+        umem_free(&big[i]);
     umem_mgr_release(mgr);
+    printf("Passed 10\n");
     return 0;
 }
@@ -0,0 +1,278 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short unit tests for aes decrypt module
+ */
+
+#undef NDEBUG
+
+#include <upipe/uprobe.h>
+#include <upipe/uprobe_stdio.h>
+#include <upipe/uprobe_prefix.h>
+#include <upipe/uprobe_ubuf_mem.h>
+#include <upipe/umem.h>
+#include <upipe/umem_alloc.h>
+#include <upipe/udict.h>
+#include <upipe/udict_inline.h>
+#include <upipe/ubuf.h>
+#include <upipe/ubuf_block.h>
+#include <upipe/ubuf_block_mem.h>
+#include <upipe/uref.h>
+#include <upipe/uref_flow.h>
+#include <upipe/uref_block_flow.h>
+#include <upipe/uref_block.h>
+#include <upipe/uref_std.h>
+#include <upipe/upipe.h>
+#include <upipe-modules/upipe_aes_decrypt.h>
+#include <upipe-modules/uref_aes_flow.h>
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+#define UDICT_POOL_DEPTH 10
+#define UREF_POOL_DEPTH 10
+#define UBUF_POOL_DEPTH 10
+#define UPROBE_LOG_LEVEL UPROBE_LOG_DEBUG
+
+#define DATA_SIZE 160
+
+/** AES-128 key of NIST SP 800-38A */
+static const uint8_t key[16] = {
+    0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
+    0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c
+};
+
+/** initialization vector of NIST SP 800-38A */
+static const uint8_t iv[16] = {
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+    0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f
+};
+
+/** plain text (i * 7 + 3) encrypted in CBC mode */
+static const uint8_t encrypted[DATA_SIZE] = {
+    0x0f, 0xa0, 0x2a, 0x83, 0x40, 0xa0, 0x68, 0x7c,
+    0xa4, 0x41, 0x33, 0x28, 0xa0, 0x63, 0xed, 0x24,
+    0x8a, 0xe6, 0x1f, 0xb0, 0xdf, 0xdb, 0x68, 0x9e,
+    0x3e, 0xf0, 0x22, 0x12, 0x4f, 0xd8, 0x52, 0xc8,
+    0x7f, 0xca, 0xe9, 0xca, 0x1c, 0x7c, 0x5d, 0xf0,
+    0x9b, 0xb0, 0xd9, 0xec, 0xfc, 0x0b, 0x65, 0xbb,
+    0xc4, 0xd6, 0x2b, 0x7a, 0xb7, 0x95, 0x26, 0xab,
+    0xd0, 0xa1, 0x10, 0x51, 0x24, 0x52, 0x7c, 0x6e,
+    0x0b, 0x83, 0x93, 0xdb, 0x16, 0x90, 0x37, 0x39,
+    0x5c, 0xa0, 0xdf, 0x99, 0x36, 0x9b, 0x9a, 0x92,
+    0x3b, 0xe0, 0xe2, 0xd0, 0xcc, 0x0b, 0xba, 0x49,
+    0xf1, 0x00, 0x27, 0xf0, 0x59, 0xf7, 0x9f, 0xf3,
+    0x14, 0x8b, 0x27, 0xb8, 0xf5, 0x1b, 0x08, 0x73,
+    0x77, 0x31, 0x67, 0x14, 0x5a, 0xc5, 0xb6, 0x79,
+    0xc7, 0x45, 0x36, 0xd2, 0x17, 0x67, 0xfc, 0xba,
+    0x0e, 0x6d, 0x4d, 0x49, 0x61, 0x6d, 0x4a, 0x9b,
+    0x4c, 0xb7, 0x7a, 0xf7, 0xc8, 0xb2, 0x26, 0x14,
+    0x03, 0x16, 0x13, 0xea, 0xc2, 0x04, 0x6c, 0x79,
+    0xb9, 0x5e, 0x82, 0x49, 0x06, 0xb8, 0x2c, 0x4f,
+    0xef, 0x51, 0x4f, 0x72, 0xfa, 0xaf, 0x6f, 0xe2
+};
+
+static uint8_t decrypted[DATA_SIZE];
+static size_t nb_decrypted = 0;
+
+/** definition of our uprobe */
+static int catch(struct uprobe *uprobe, struct upipe *upipe,
+                 int event, va_list args)
+{
+    switch (event) {
+        default:
+            assert(0);
+            break;
+        case UPROBE_READY:
+        case UPROBE_DEAD:
+        case UPROBE_NEW_FLOW_DEF:
+            break;
+    }
+    return UBASE_ERR_NONE;
+}
+
+/** helper phony pipe */
+static struct upipe *test_alloc(struct upipe_mgr *mgr,
+                                struct uprobe *uprobe,
+                                uint32_t signature, va_list args)
+{
+    struct upipe *upipe = malloc(sizeof(struct upipe));
+    assert(upipe != NULL);
+    upipe_init(upipe, mgr, uprobe);
+    return upipe;
+}
+
+/** helper phony pipe */
+static void test_input(struct upipe *upipe, struct uref *uref,
+                       struct upump **upump_p)
+{
+    size_t size;
+    ubase_assert(uref_block_size(uref, &size));
+    upipe_dbg_va(upipe, "received buffer of size %zu", size);
+    assert(size % 16 == 0);
+    assert(nb_decrypted + size <= DATA_SIZE);
+    ubase_assert(uref_block_extract(uref, 0, size,
+                                    decrypted + nb_decrypted));
+    nb_decrypted += size;
+    uref_free(uref);
+}
+
+/** helper phony pipe */
+static int test_control(struct upipe *upipe, int command, va_list args)
+{
+    switch (command) {
+        case UPIPE_SET_FLOW_DEF:
+            return UBASE_ERR_NONE;
+        case UPIPE_REGISTER_REQUEST: {
+            struct urequest *urequest = va_arg(args, struct urequest *);
+            return upipe_throw_provide_request(upipe, urequest);
+        }
+        case UPIPE_UNREGISTER_REQUEST:
+            return UBASE_ERR_NONE;
+        default:
+            assert(0);
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** helper phony pipe */
+static void test_free(struct upipe *upipe)
+{
+    upipe_clean(upipe);
+    free(upipe);
+}
+
+/** helper phony pipe */
+static struct upipe_mgr aes_test_mgr = {
+    .refcount = NULL,
+    .upipe_alloc = test_alloc,
+    .upipe_input = test_input,
+    .upipe_control = test_control
+};
+
+/** helper to allocate a buffer with a part of the encrypted data */
+static struct uref *test_alloc_block(struct uref_mgr *uref_mgr,
+                                     struct ubuf_mgr *ubuf_mgr,
+                                     int offset, int size)
+{
+    struct uref *uref = uref_block_alloc(uref_mgr, ubuf_mgr, size);
+    assert(uref != NULL);
+    uint8_t *buffer;
+    int wsize = -1;
+    ubase_assert(uref_block_write(uref, 0, &wsize, &buffer));
+    assert(wsize == size);
+    memcpy(buffer, encrypted + offset, size);
+    ubase_assert(uref_block_unmap(uref, 0));
+    return uref;
+}
+
+int main(int argc, char *argv[])
+{
+    struct umem_mgr *umem_mgr = umem_alloc_mgr_alloc();
+    assert(umem_mgr != NULL);
+    struct udict_mgr *udict_mgr = udict_inline_mgr_alloc(UDICT_POOL_DEPTH,
+                                                         umem_mgr, -1, -1);
+    assert(udict_mgr != NULL);
+    struct uref_mgr *uref_mgr = uref_std_mgr_alloc(UREF_POOL_DEPTH, udict_mgr,
+                                                   0);
+    assert(uref_mgr != NULL);
+    struct ubuf_mgr *ubuf_mgr = ubuf_block_mem_mgr_alloc(UBUF_POOL_DEPTH,
+                                                         UBUF_POOL_DEPTH,
+                                                         umem_mgr, 0, 0, -1, 0);
+    assert(ubuf_mgr != NULL);
+    struct uprobe uprobe;
+    uprobe_init(&uprobe, catch, NULL);
+    struct uprobe *logger = uprobe_stdio_alloc(&uprobe, stdout,
+                                               UPROBE_LOG_LEVEL);
+    assert(logger != NULL);
+    logger = uprobe_ubuf_mem_alloc(logger, umem_mgr, UBUF_POOL_DEPTH,
+                                   UBUF_POOL_DEPTH);
+    assert(logger != NULL);
+
+    /* flow def */
+    struct uref *uref = uref_block_flow_alloc_def(uref_mgr, "aes.");
+    assert(uref != NULL);
+    ubase_assert(uref_aes_set_method(uref, "AES-128"));
+    ubase_assert(uref_aes_set_key(uref, key, sizeof (key)));
+    ubase_assert(uref_aes_set_iv(uref, iv, sizeof (iv)));
+
+    struct upipe *upipe_sink = upipe_void_alloc(&aes_test_mgr,
+                                                uprobe_use(logger));
+    assert(upipe_sink != NULL);
+
+    struct upipe_mgr *upipe_aes_decrypt_mgr = upipe_aes_decrypt_mgr_alloc();
+    assert(upipe_aes_decrypt_mgr != NULL);
+    struct upipe *upipe_aes_decrypt = upipe_void_alloc(upipe_aes_decrypt_mgr,
+            uprobe_pfx_alloc(uprobe_use(logger), UPROBE_LOG_LEVEL, "aes"));
+    assert(upipe_aes_decrypt != NULL);
+    ubase_assert(upipe_set_flow_def(upipe_aes_decrypt, uref));
+    ubase_assert(upipe_set_output(upipe_aes_decrypt, upipe_sink));
+    uref_free(uref);
+
+    /* the first block is incomplete */
+    uref = test_alloc_block(uref_mgr, ubuf_mgr, 0, 21);
+    upipe_input(upipe_aes_decrypt, uref, NULL);
+    assert(nb_decrypted == 16);
+
+    /* segmented buffer, with a block spanning two segments */
+    uref = test_alloc_block(uref_mgr, ubuf_mgr, 21, 11);
+    struct uref *append = test_alloc_block(uref_mgr, ubuf_mgr, 32, 32);
+    ubase_assert(uref_block_append(uref, uref_detach_ubuf(append)));
+    uref_free(append);
+    upipe_input(upipe_aes_decrypt, uref, NULL);
+    assert(nb_decrypted == 64);
+
+    /* shared buffer, which must not be decrypted in place */
+    uref = test_alloc_block(uref_mgr, ubuf_mgr, 64, DATA_SIZE - 64);
+    struct uref *dup = uref_dup(uref);
+    assert(dup != NULL);
+    upipe_input(upipe_aes_decrypt, uref, NULL);
+    assert(nb_decrypted == DATA_SIZE);
+    uint8_t byte;
+    ubase_assert(uref_block_extract(dup, 0, 1, &byte));
+    assert(byte == encrypted[64]);
+    uref_free(dup);
+
+    for (unsigned i = 0; i < DATA_SIZE; i++)
+        assert(decrypted[i] == (uint8_t)(i * 7 + 3));
+
+    upipe_release(upipe_aes_decrypt);
+    upipe_mgr_release(upipe_aes_decrypt_mgr); // nop
+
+    test_free(upipe_sink);
+
+    uref_mgr_release(uref_mgr);
+    ubuf_mgr_release(ubuf_mgr);
+    udict_mgr_release(udict_mgr);
+    umem_mgr_release(umem_mgr);
+    uprobe_release(logger);
+    uprobe_clean(&uprobe);
+
+    return 0;
+}
@@ -96,6 +96,8 @@ static void test_input(struct upipe *upipe, struct uref *uref,
     size_t size = 0;
     ubase_assert(uref_block_size(uref, &size));
     assert(!nb_packets ? size == 376 : size == 188);
+    /* packets are chained, not copied */
+    assert(uref_block_iovec_count(uref, 0, -1) == size / 188);
 
     nb_packets++;
     uref_free(uref);
@@ -189,10 +191,19 @@ int main(int argc, char *argv[])
     upipe_input(upipe_agg, uref, NULL);
     assert(nb_packets == 1);
 
+    ubase_assert(upipe_agg_flush(upipe_agg));
+    assert(nb_packets == 2);
+    ubase_assert(upipe_agg_flush(upipe_agg));
+    assert(nb_packets == 2);
+
+    uref = uref_block_alloc(uref_mgr, ubuf_mgr, 188);
+    upipe_input(upipe_agg, uref, NULL);
+    assert(nb_packets == 2);
+
     /* flush */
     upipe_release(upipe_agg);
 
-    assert(nb_packets == 2);
+    assert(nb_packets == 3);
 
     /* release everything */
     upipe_mgr_release(upipe_agg_mgr); // nop
@@ -144,6 +144,28 @@ static void test_input(struct upipe *upipe, struct uref *uref,
             assert(r[6] == 'l' + 10);
             ubase_assert(uref_sound_plane_unmap(uref, "lr", 0, -1));
             break;
+        case 4:
+            ubase_assert(uref_sound_plane_read_uint8_t(uref, "l", 0, -1, &r));
+            assert(r[0] == 'L' + 0);
+            assert(r[1] == 'L' + 1);
+            assert(r[2] == 'L' + 2);
+            ubase_assert(uref_sound_plane_unmap(uref, "l", 0, -1));
+            ubase_assert(uref_sound_plane_read_uint8_t(uref, "r", 0, -1, &r));
+            assert(r[0] == 'R' + 0);
+            assert(r[1] == 'R' + 1);
+            assert(r[2] == 'R' + 2);
+            ubase_assert(uref_sound_plane_unmap(uref, "r", 0, -1));
+            break;
+        case 5:
+            ubase_assert(uref_sound_plane_read_uint8_t(uref, "lr", 0, -1, &r));
+            assert(r[0] == 'l' + 0);
+            assert(r[1] == 'l' + 1);
+            assert(r[2] == 'r' + 0);
+            assert(r[3] == 'r' + 1);
+            assert(r[4] == 'l' + 2);
+            assert(r[6] == 'r' + 2);
+            ubase_assert(uref_sound_plane_unmap(uref, "lr", 0, -1));
+            break;
         default:
             assert(0);
     }
@@ -293,6 +315,59 @@ int main(int argc, char *argv[])
     upipe_input(upipe_audio_split, uref, NULL);
     assert(counter == 4);
 
+    upipe_release(upipe_audio_split_output0);
+    ubuf_mgr_release(sound_mgr);
+
+    /* planar input flow definition */
+    flow = uref_sound_flow_alloc_def(uref_mgr, "s16.", 4, 2);
+    ubase_assert(uref_sound_flow_add_plane(flow, "l"));
+    ubase_assert(uref_sound_flow_add_plane(flow, "r"));
+    ubase_assert(uref_sound_flow_add_plane(flow, "L"));
+    ubase_assert(uref_sound_flow_add_plane(flow, "R"));
+    sound_mgr = ubuf_mem_mgr_alloc_from_flow_def(UBUF_POOL_DEPTH,
+                                                 UBUF_POOL_DEPTH, umem_mgr,
+                                                 flow);
+    assert(sound_mgr);
+    ubase_assert(upipe_set_flow_def(upipe_audio_split, flow));
+    uref_free(flow);
+
+    /* planar split subpipe, sharing the input planes */
+    flow = uref_sound_flow_alloc_def(uref_mgr, "", 2, 0);
+    ubase_assert(uref_sound_flow_add_plane(flow, "l"));
+    ubase_assert(uref_sound_flow_add_plane(flow, "r"));
+    ubase_assert(uref_audio_split_set_bitfield(flow, 0xc));
+    upipe_audio_split_output0 = upipe_flow_alloc_sub(upipe_audio_split,
+            uprobe_pfx_alloc(uprobe_use(logger), UPROBE_LOG_LEVEL,
+                             "split output 0"), flow);
+    uref_free(flow);
+    assert(upipe_audio_split_output0 != NULL);
+    ubase_assert(upipe_set_output(upipe_audio_split_output0, upipe_sink0));
+
+    uref = uref_sound_alloc(uref_mgr, sound_mgr, SAMPLES);
+    assert(uref != NULL);
+    fill_in(uref->ubuf);
+    upipe_input(upipe_audio_split, uref, NULL);
+    assert(counter == 5);
+
+    upipe_release(upipe_audio_split_output0);
+
+    /* interleaved split subpipe from planar input */
+    flow = uref_sound_flow_alloc_def(uref_mgr, "", 2, 0);
+    ubase_assert(uref_sound_flow_add_plane(flow, "lr"));
+    ubase_assert(uref_audio_split_set_bitfield(flow, 0x3));
+    upipe_audio_split_output0 = upipe_flow_alloc_sub(upipe_audio_split,
+            uprobe_pfx_alloc(uprobe_use(logger), UPROBE_LOG_LEVEL,
+                             "split output 0"), flow);
+    uref_free(flow);
+    assert(upipe_audio_split_output0 != NULL);
+    ubase_assert(upipe_set_output(upipe_audio_split_output0, upipe_sink0));
+
+    uref = uref_sound_alloc(uref_mgr, sound_mgr, SAMPLES);
+    assert(uref != NULL);
+    fill_in(uref->ubuf);
+    upipe_input(upipe_audio_split, uref, NULL);
+    assert(counter == 6);
+
     upipe_release(upipe_audio_split_output0);
 
     /* clean */
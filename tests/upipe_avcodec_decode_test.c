@@ -298,7 +298,7 @@ static void *test_thread(void *_thread)
 }
 
 static void usage(const char *argv0) {
-    fprintf(stdout, "Usage: %s [-n threads] <source file> [pgmprefix]\n", argv0);
+    fprintf(stdout, "Usage: %s [-n threads] [-p <width>x<height>] <source file> [pgmprefix]\n", argv0);
     exit(EXIT_FAILURE);
 }
 
@@ -307,11 +307,17 @@ int main (int argc, char **argv)
     printf("Compiled %s %s - %s\n", __DATE__, __TIME__, __FILE__);
     int opt;
     int thread_num = THREAD_NUM;
-    while ((opt = getopt(argc, argv, "n:")) != -1) {
+    unsigned int preview_hsize = 0, preview_vsize = 0;
+    while ((opt = getopt(argc, argv, "n:p:")) != -1) {
         switch(opt) {
             case 'n':
                 thread_num = strtod(optarg, NULL);
                 break;
+            case 'p':
+                if (sscanf(optarg, "%ux%u", &preview_hsize,
+                           &preview_vsize) != 2)
+                    usage(argv[0]);
+                break;
             default:
                 usage(argv[0]);
         }
@@ -424,6 +430,9 @@ int main (int argc, char **argv)
     assert(avcdec);
     ubase_assert(upipe_set_flow_def(avcdec, flowdef));
     uref_free(flowdef);
+    if (preview_hsize || preview_vsize)
+        ubase_assert(upipe_avcdec_set_preview(avcdec, preview_hsize,
+                                              preview_vsize, false));
     /* mainthread avcdec runs alone (no thread) so it doesn't need any upump_mgr
      * Please do not add one, to check the nopump (direct call) case */
     mainthread.avcdec = avcdec;
@@ -84,6 +84,8 @@ UREF_ATTR_INT(xflow, num, "x.f.num", flow num)
 #define THREAD_NUM          4
 #define FRAMES_LIMIT        100
 #define THREAD_FRAMES_LIMIT (FRAMES_LIMIT / 8)
+#define POOL_FRAMES_LIMIT   40
+#define POOL_AVCODEC_REFS   8
 #define WIDTH 120
 #define HEIGHT 90
 #define STREAM stdout
@@ -98,6 +100,8 @@ struct ubuf_mgr *sound_mgr;
 struct ubuf_mgr *pic_mgr;
 struct uprobe *logger;
 struct uprobe uprobe_avcenc_s;
+struct uprobe uprobe_avcdec_s;
+unsigned int pool_misses = 0;
 
 struct thread {
     pthread_t id;
@@ -164,6 +168,95 @@ static int catch_avcenc(struct uprobe *uprobe, struct upipe *upipe,
     return UBASE_ERR_NONE;
 }
 
+/** definition of the probe of the pooled decoder */
+static int catch_avcdec(struct uprobe *uprobe, struct upipe *upipe,
+                        int event, va_list args)
+{
+    if (event != UPROBE_AVCDEC_POOL_MISS)
+        return uprobe_throw_next(uprobe, upipe, event, args);
+    UBASE_SIGNATURE_CHECK(args, UPIPE_AVCDEC_SIGNATURE)
+    assert(va_arg(args, unsigned int) == 1);
+    pool_misses++;
+    return UBASE_ERR_NONE;
+}
+
+/** pictures held by the phony pipe */
+struct uref *held[POOL_FRAMES_LIMIT];
+/** number of pictures received by the phony pipe */
+int held_count = 0;
+
+/** @This checks that all planes of a picture may be mapped for writing.
+ *
+ * @param uref picture to check
+ */
+static void check_writable(struct uref *uref)
+{
+    const char *chroma = NULL;
+    while (ubase_check(uref_pic_plane_iterate(uref, &chroma)) &&
+           chroma != NULL) {
+        uint8_t *buf;
+        ubase_assert(uref_pic_plane_write(uref, chroma, 0, 0, -1, -1, &buf));
+        buf[0] = 0;
+        ubase_assert(uref_pic_plane_unmap(uref, chroma, 0, 0, -1, -1));
+    }
+}
+
+/** helper phony pipe */
+static struct upipe *test_alloc(struct upipe_mgr *mgr, struct uprobe *uprobe,
+                                uint32_t signature, va_list args)
+{
+    struct upipe *upipe = malloc(sizeof(struct upipe));
+    assert(upipe != NULL);
+    upipe_init(upipe, mgr, uprobe);
+    return upipe;
+}
+
+/** helper phony pipe, holding the decoded pictures so that the frame
+ * buffers of the pool stay in use */
+static void test_input(struct upipe *upipe, struct uref *uref,
+                       struct upump **upump_p)
+{
+    assert(uref != NULL);
+    assert(uref->ubuf != NULL);
+    assert(held_count < POOL_FRAMES_LIMIT);
+    held[held_count++] = uref;
+}
+
+/** helper phony pipe */
+static int test_control(struct upipe *upipe, int command, va_list args)
+{
+    switch (command) {
+        case UPIPE_SET_FLOW_DEF:
+            return UBASE_ERR_NONE;
+        case UPIPE_REGISTER_REQUEST: {
+            struct urequest *urequest = va_arg(args, struct urequest *);
+            return upipe_throw_provide_request(upipe, urequest);
+        }
+        case UPIPE_UNREGISTER_REQUEST:
+            return UBASE_ERR_NONE;
+        default:
+            assert(0);
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** helper phony pipe */
+static void test_free(struct upipe *upipe)
+{
+    upipe_clean(upipe);
+    free(upipe);
+}
+
+/** helper phony pipe */
+static struct upipe_mgr test_mgr = {
+    .refcount = NULL,
+    .signature = 0,
+
+    .upipe_alloc = test_alloc,
+    .upipe_input = test_input,
+    .upipe_control = test_control
+};
+
 /* fill picture with some stuff */
 static void fill_pic(struct ubuf *ubuf)
 {
@@ -372,6 +465,53 @@ int main(int argc, char **argv)
     upipe_release(avcenc);
     printf("Everything good so far, cleaning\n");
 
+    /* picture pool test, with a pool too small for the held pictures */
+    flow = uref_pic_flow_alloc_def(uref_mgr, 1);
+    assert(flow != NULL);
+    ubase_assert(uref_pic_flow_add_plane(flow, 1, 1, 1, "y8"));
+    ubase_assert(uref_pic_flow_add_plane(flow, 2, 2, 1, "u8"));
+    ubase_assert(uref_pic_flow_add_plane(flow, 2, 2, 1, "v8"));
+    ubase_assert(uref_pic_flow_set_hsize(flow, WIDTH));
+    ubase_assert(uref_pic_flow_set_vsize(flow, HEIGHT));
+    ubase_assert(uref_pic_flow_set_fps(flow, fps));
+    avcenc = build_pipeline("mpeg2video.pic.", NULL, -1, flow);
+    uref_free(flow);
+
+    uprobe_init(&uprobe_avcdec_s, catch_avcdec, uprobe_use(logger));
+    struct upipe *avcdec = upipe_void_alloc_output(avcenc, upipe_avcdec_mgr,
+            uprobe_pfx_alloc(uprobe_use(&uprobe_avcdec_s), loglevel,
+                             "avcdec pool"));
+    assert(avcdec != NULL);
+    ubase_assert(upipe_avcdec_set_pool_depth(avcdec, 1));
+    ubase_assert(upipe_avcdec_set_threads(avcdec, -1, 1));
+    struct upipe *test = upipe_void_alloc(&test_mgr,
+            uprobe_pfx_alloc(uprobe_use(logger), loglevel, "test"));
+    assert(test != NULL);
+    ubase_assert(upipe_set_output(avcdec, test));
+    upipe_release(test);
+    upipe_release(avcdec);
+
+    for (i = 0; i < POOL_FRAMES_LIMIT; i++) {
+        pic = uref_pic_alloc(uref_mgr, pic_mgr, WIDTH, HEIGHT);
+        assert(pic != NULL);
+        fill_pic(pic->ubuf);
+        upipe_input(avcenc, pic, NULL);
+    }
+
+    /* once avcodec has released them, the pictures are only owned by the
+     * phony pipe, even though their frame buffers come from the pool */
+    assert(held_count > POOL_AVCODEC_REFS);
+    for (i = 0; i < held_count - POOL_AVCODEC_REFS; i++)
+        check_writable(held[i]);
+    assert(pool_misses);
+
+    upipe_release(avcenc);
+    for (i = 0; i < held_count; i++) {
+        check_writable(held[i]);
+        uref_free(held[i]);
+    }
+    printf("Everything good so far, cleaning\n");
+
     /* mono-threaded audio test without upump_mgr */
     flow = uref_sound_flow_alloc_def(uref_mgr, "s16le.", 2, 4);
     assert(flow != NULL);
@@ -407,6 +547,7 @@ int main(int argc, char **argv)
     upipe_av_clean();
     uprobe_release(logger);
     uprobe_clean(&uprobe_avcenc_s);
+    uprobe_clean(&uprobe_avcdec_s);
     uprobe_clean(&uprobe);
 
     return 0;
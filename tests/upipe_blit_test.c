@@ -62,6 +62,11 @@
 #define BGSIZE              (2 * SUBSIZE)
 #define UPROBE_LOG_LEVEL UPROBE_LOG_VERBOSE
 
+/** expected values of the four quadrants of the output picture */
+static uint8_t quadrants[4] = { 1, 2, 3, 0 };
+/** number of pictures received */
+static unsigned int nb_pictures = 0;
+
 /** definition of our uprobe */
 static int catch(struct uprobe *uprobe, struct upipe *upipe,
                  int event, va_list args)
@@ -202,6 +207,7 @@ static void test_input(struct upipe *upipe, struct uref *uref,
     upipe_dbg(upipe, "===> received input uref");
     uref_dump(uref, upipe->uprobe);
 
+    nb_pictures++;
     uint64_t priv;
     ubase_assert(uref_attr_get_priv(uref, &priv));
     switch (priv) {
@@ -212,27 +218,27 @@ static void test_input(struct upipe *upipe, struct uref *uref,
             break;
         case 1:
             uref_pic_resize(uref, 0, 0, SUBSIZE, SUBSIZE);
-            check_chroma(uref, "y8", 1);
-            check_chroma(uref, "u8", 1);
-            check_chroma(uref, "v8", 1);
+            check_chroma(uref, "y8", quadrants[0]);
+            check_chroma(uref, "u8", quadrants[0]);
+            check_chroma(uref, "v8", quadrants[0]);
             uref_pic_resize(uref, 0, 0, BGSIZE, BGSIZE);
 
             uref_pic_resize(uref, SUBSIZE, 0, SUBSIZE, SUBSIZE);
-            check_chroma(uref, "y8", 2);
-            check_chroma(uref, "u8", 2);
-            check_chroma(uref, "v8", 2);
+            check_chroma(uref, "y8", quadrants[1]);
+            check_chroma(uref, "u8", quadrants[1]);
+            check_chroma(uref, "v8", quadrants[1]);
             uref_pic_resize(uref, -SUBSIZE, 0, BGSIZE, BGSIZE);
 
             uref_pic_resize(uref, 0, SUBSIZE, SUBSIZE, SUBSIZE);
-            check_chroma(uref, "y8", 3);
-            check_chroma(uref, "u8", 3);
-            check_chroma(uref, "v8", 3);
+            check_chroma(uref, "y8", quadrants[2]);
+            check_chroma(uref, "u8", quadrants[2]);
+            check_chroma(uref, "v8", quadrants[2]);
             uref_pic_resize(uref, 0, -SUBSIZE, BGSIZE, BGSIZE);
 
             uref_pic_resize(uref, SUBSIZE, SUBSIZE, SUBSIZE, SUBSIZE);
-            check_chroma(uref, "y8", 0);
-            check_chroma(uref, "u8", 0);
-            check_chroma(uref, "v8", 0);
+            check_chroma(uref, "y8", quadrants[3]);
+            check_chroma(uref, "u8", quadrants[3]);
+            check_chroma(uref, "v8", quadrants[3]);
             break;
     }
 
@@ -374,9 +380,28 @@ int main(int argc, char **argv)
     upipe_input(blit, uref, NULL);
     ubase_assert(upipe_blit_prepare(blit, NULL));
 
+    /* same background and subpictures */
+    ubase_assert(upipe_blit_prepare(blit, NULL));
+
+    /* only the third subpicture changes */
+    uref = uref_pic_alloc(uref_mgr, pic_mgr, SUBSIZE, SUBSIZE);
+    assert(uref != NULL);
+    uref_pic_set_progressive(uref);
+    fill_in(uref, "y8", 4);
+    fill_in(uref, "u8", 4);
+    fill_in(uref, "v8", 4);
+    upipe_input(subpipe3, uref, NULL);
+    quadrants[2] = 4;
+    ubase_assert(upipe_blit_prepare(blit, NULL));
+
+    /* the second subpicture disappears */
+    upipe_release(subpipe2);
+    quadrants[1] = 0;
+    ubase_assert(upipe_blit_prepare(blit, NULL));
+    assert(nb_pictures == 5);
+
     /* release blit pipe and subpipes */
     upipe_release(subpipe1);
-    upipe_release(subpipe2);
     upipe_release(subpipe3);
     upipe_release(blit);
     test_free(test);
@@ -218,6 +218,11 @@ int main(int argc, char **argv)
     assert(uref);
     block_fill_in(uref->ubuf);
 
+    const uint8_t *block_r;
+    int block_end = -1;
+    ubase_assert(uref_block_read(uref, 0, &block_end, &block_r));
+    ubase_assert(uref_block_unmap(uref, 0));
+
     /* Now send uref */
     upipe_input(upipe_block_to_sound, uref, NULL);
     assert(output != NULL);
@@ -237,6 +242,63 @@ int main(int argc, char **argv)
         int32_t s = (4*x) | ((4*x+1) << 8) | ((4*x+2) << 16) | ((4*x+3) << 24);
         assert(s == r[x]);
     }
+    /* the block buffer is used as is */
+    assert((const uint8_t *)r == block_r);
+    uref_sound_plane_unmap(output, "lr", 0, -1);
+    uref_free(output);
+    output = NULL;
+
+    /* segmented block, copied */
+    uref = uref_block_alloc(uref_mgr, block_mgr, block_size / 2);
+    assert(uref);
+    struct ubuf *ubuf = ubuf_block_alloc(block_mgr, block_size / 2);
+    assert(ubuf);
+    ubase_assert(uref_block_append(uref, ubuf));
+    for (int offset = 0; offset < block_size; offset += block_size / 2) {
+        uint8_t *w;
+        int end = -1;
+        ubase_assert(uref_block_write(uref, offset, &end, &w));
+        assert(end == block_size / 2);
+        for (int x = 0; x < end; x++)
+            w[x] = offset + x;
+        ubase_assert(uref_block_unmap(uref, offset));
+    }
+
+    upipe_input(upipe_block_to_sound, uref, NULL);
+    assert(output != NULL);
+    ubase_assert(ubuf_sound_size(output->ubuf, &size, &sample_size));
+    assert(size == no_samples);
+    ubase_assert(uref_sound_plane_read_int32_t(output, "lr", 0, -1, &r));
+    for (int x = 0 ; x < no_samples; x++) {
+        int32_t s = (4*x) | ((4*x+1) << 8) | ((4*x+2) << 16) | ((4*x+3) << 24);
+        assert(s == r[x]);
+    }
+    uref_sound_plane_unmap(output, "lr", 0, -1);
+    uref_free(output);
+    output = NULL;
+
+    /* misaligned block, copied */
+    uref = uref_block_alloc(uref_mgr, block_mgr, block_size + 1);
+    assert(uref);
+    block_fill_in(uref->ubuf);
+    ubase_assert(uref_block_resize(uref, 1, -1));
+
+    block_end = -1;
+    ubase_assert(uref_block_read(uref, 0, &block_end, &block_r));
+    ubase_assert(uref_block_unmap(uref, 0));
+
+    upipe_input(upipe_block_to_sound, uref, NULL);
+    assert(output != NULL);
+    ubase_assert(ubuf_sound_size(output->ubuf, &size, &sample_size));
+    assert(size == no_samples);
+    ubase_assert(uref_sound_plane_read_int32_t(output, "lr", 0, -1, &r));
+    if ((uintptr_t)block_r % sizeof(int32_t))
+        assert((const uint8_t *)r != block_r);
+    for (int x = 0 ; x < no_samples; x++) {
+        int32_t s = (4*x+1) | ((4*x+2) << 8) | ((4*x+3) << 16) |
+                    ((uint32_t)(4*x+4) << 24);
+        assert(s == r[x]);
+    }
     uref_sound_plane_unmap(output, "lr", 0, -1);
     uref_free(output);
 
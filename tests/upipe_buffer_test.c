@@ -0,0 +1,360 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short unit tests for buffer pipe
+ */
+
+#undef NDEBUG
+
+#include <upipe/uclock.h>
+#include <upipe/uprobe.h>
+#include <upipe/uprobe_stdio.h>
+#include <upipe/uprobe_prefix.h>
+#include <upipe/uprobe_upump_mgr.h>
+#include <upipe/umem.h>
+#include <upipe/umem_alloc.h>
+#include <upipe/udict.h>
+#include <upipe/udict_inline.h>
+#include <upipe/ubuf.h>
+#include <upipe/ubuf_block_mem.h>
+#include <upipe/uref.h>
+#include <upipe/uref_attr.h>
+#include <upipe/uref_block.h>
+#include <upipe/uref_block_flow.h>
+#include <upipe/uref_flow.h>
+#include <upipe/uref_clock.h>
+#include <upipe/uref_std.h>
+#include <upipe/upump.h>
+#include <upump-ev/upump_ev.h>
+#include <upipe/upipe.h>
+#include <upipe-modules/upipe_buffer.h>
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <assert.h>
+
+#define UDICT_POOL_DEPTH    0
+#define UREF_POOL_DEPTH     0
+#define UBUF_POOL_DEPTH     0
+#define UPUMP_POOL          0
+#define UPUMP_BLOCKER_POOL  0
+#define UPROBE_LOG_LEVEL    UPROBE_LOG_DEBUG
+#define MAX_SIZE            4000
+#define UREF_SIZE           1000
+#define NB_POLICY           10
+#define NB_SPILL            2000
+
+UREF_ATTR_UNSIGNED(test, id, "x.id", test id)
+
+static struct uref_mgr *uref_mgr;
+static struct ubuf_mgr *ubuf_mgr;
+/** buffer pipe under test, released on the last expected uref */
+static struct upipe *buffer = NULL;
+/** id of the next expected uref */
+static uint64_t next_id;
+/** id of the last expected uref */
+static uint64_t last_id;
+
+/** definition of our uprobe */
+static int catch(struct uprobe *uprobe, struct upipe *upipe,
+                 int event, va_list args)
+{
+    switch (event) {
+        default:
+            assert(0);
+            break;
+        case UPROBE_READY:
+        case UPROBE_DEAD:
+        case UPROBE_NEW_FLOW_DEF:
+            break;
+        case UPROBE_BUFFER_UPDATE:
+            UBASE_SIGNATURE_CHECK(args, UPIPE_BUFFER_SIGNATURE)
+            break;
+    }
+    return UBASE_ERR_NONE;
+}
+
+/** @This allocates a uref with dates, attributes and a payload derived from
+ * its id.
+ *
+ * @param id id of the uref
+ * @return pointer to uref
+ */
+static struct uref *test_uref_alloc(uint64_t id)
+{
+    struct uref *uref = uref_block_alloc(uref_mgr, ubuf_mgr, UREF_SIZE);
+    assert(uref != NULL);
+    uint8_t *buf;
+    int size = -1;
+    ubase_assert(uref_block_write(uref, 0, &size, &buf));
+    assert(size == UREF_SIZE);
+    for (int i = 0; i < size; i++)
+        buf[i] = id + i;
+    ubase_assert(uref_block_unmap(uref, 0));
+
+    ubase_assert(uref_test_set_id(uref, id));
+    ubase_assert(uref_flow_set_id(uref, id % 7));
+    if (!(id % 3))
+        uref_flow_set_random(uref);
+    uref_clock_set_dts_prog(uref, id * UCLOCK_FREQ);
+    uref_clock_set_dts_pts_delay(uref, id);
+    uref_clock_set_duration(uref, UCLOCK_FREQ);
+    return uref;
+}
+
+/** helper phony pipe */
+static struct upipe *test_alloc(struct upipe_mgr *mgr, struct uprobe *uprobe,
+                                uint32_t signature, va_list args)
+{
+    struct upipe *upipe = malloc(sizeof(struct upipe));
+    assert(upipe != NULL);
+    upipe_init(upipe, mgr, uprobe);
+    return upipe;
+}
+
+/** helper phony pipe, checking that the urefs come out unchanged and in
+ * order */
+static void test_input(struct upipe *upipe, struct uref *uref,
+                       struct upump **upump_p)
+{
+    assert(uref != NULL);
+    uint64_t id;
+    ubase_assert(uref_test_get_id(uref, &id));
+    assert(id == next_id);
+    uint64_t flow_id;
+    ubase_assert(uref_flow_get_id(uref, &flow_id));
+    assert(flow_id == id % 7);
+    assert(ubase_check(uref_flow_get_random(uref)) == !(id % 3));
+
+    uint64_t date, delay;
+    ubase_assert(uref_clock_get_dts_prog(uref, &date));
+    assert(date == id * UCLOCK_FREQ);
+    ubase_assert(uref_clock_get_dts_pts_delay(uref, &delay));
+    assert(delay == id);
+    ubase_assert(uref_clock_get_duration(uref, &delay));
+    assert(delay == UCLOCK_FREQ);
+
+    const uint8_t *buf;
+    int size = -1;
+    ubase_assert(uref_block_read(uref, 0, &size, &buf));
+    assert(size == UREF_SIZE);
+    for (int i = 0; i < size; i++)
+        assert(buf[i] == (uint8_t)(id + i));
+    ubase_assert(uref_block_unmap(uref, 0));
+    uref_free(uref);
+
+    if (next_id++ == last_id) {
+        struct upipe_buffer_stats stats;
+        ubase_assert(upipe_buffer_get_stats(buffer, &stats));
+        assert(stats.size == 0);
+        assert(stats.spilled_size == 0);
+        /* stops the idler of the buffer pipe */
+        upipe_release(buffer);
+        buffer = NULL;
+    }
+}
+
+/** helper phony pipe */
+static int test_control(struct upipe *upipe, int command, va_list args)
+{
+    switch (command) {
+        case UPIPE_SET_FLOW_DEF:
+            return UBASE_ERR_NONE;
+        case UPIPE_REGISTER_REQUEST: {
+            struct urequest *urequest = va_arg(args, struct urequest *);
+            return upipe_throw_provide_request(upipe, urequest);
+        }
+        case UPIPE_UNREGISTER_REQUEST:
+            return UBASE_ERR_NONE;
+        default:
+            assert(0);
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** helper phony pipe */
+static void test_free(struct upipe *upipe)
+{
+    upipe_clean(upipe);
+    free(upipe);
+}
+
+/** helper phony pipe */
+static struct upipe_mgr buffer_test_mgr = {
+    .refcount = NULL,
+    .signature = 0,
+
+    .upipe_alloc = test_alloc,
+    .upipe_input = test_input,
+    .upipe_control = test_control
+};
+
+/** @This allocates the buffer pipe under test, and fills it exactly up to
+ * its maximum size.
+ *
+ * @param mgr buffer pipe manager
+ * @param uprobe structure used to raise events
+ * @param flow_def flow definition packet
+ * @param output phony output pipe
+ * @param policy policy when the maximum size is reached
+ */
+static void test_buffer_fill(struct upipe_mgr *mgr, struct uprobe *uprobe,
+                             struct uref *flow_def, struct upipe *output,
+                             enum upipe_buffer_policy policy)
+{
+    buffer = upipe_void_alloc(mgr,
+            uprobe_pfx_alloc(uprobe_use(uprobe), UPROBE_LOG_LEVEL, "buffer"));
+    assert(buffer != NULL);
+    ubase_assert(upipe_set_flow_def(buffer, flow_def));
+    ubase_assert(upipe_set_output(buffer, output));
+    ubase_assert(upipe_buffer_set_max_size(buffer, MAX_SIZE));
+    ubase_assert(upipe_buffer_set_policy(buffer, policy));
+
+    /* the output only runs in the event loop, so everything is buffered */
+    for (uint64_t id = 0; id < MAX_SIZE / UREF_SIZE; id++)
+        upipe_input(buffer, test_uref_alloc(id), NULL);
+
+    struct upipe_buffer_stats stats;
+    ubase_assert(upipe_buffer_get_stats(buffer, &stats));
+    assert(stats.size == MAX_SIZE);
+    assert(stats.spilled == 0);
+    assert(stats.dropped == 0);
+}
+
+int main(int argc, char **argv)
+{
+    printf("Compiled %s %s - %s\n", __DATE__, __TIME__, __FILE__);
+
+    /* uref and mem management */
+    struct umem_mgr *umem_mgr = umem_alloc_mgr_alloc();
+    assert(umem_mgr != NULL);
+    struct udict_mgr *udict_mgr = udict_inline_mgr_alloc(UDICT_POOL_DEPTH,
+                                                         umem_mgr, -1, -1);
+    assert(udict_mgr != NULL);
+    uref_mgr = uref_std_mgr_alloc(UREF_POOL_DEPTH, udict_mgr, 0);
+    assert(uref_mgr != NULL);
+    ubuf_mgr = ubuf_block_mem_mgr_alloc(UBUF_POOL_DEPTH, UBUF_POOL_DEPTH,
+                                        umem_mgr, 0, 0, 0, 0);
+    assert(ubuf_mgr != NULL);
+    struct upump_mgr *upump_mgr = upump_ev_mgr_alloc_default(UPUMP_POOL,
+            UPUMP_BLOCKER_POOL);
+    assert(upump_mgr != NULL);
+
+    /* uprobe stuff */
+    struct uprobe uprobe;
+    uprobe_init(&uprobe, catch, NULL);
+    struct uprobe *logger = uprobe_stdio_alloc(&uprobe, stdout,
+                                               UPROBE_LOG_LEVEL);
+    assert(logger != NULL);
+    logger = uprobe_upump_mgr_alloc(logger, upump_mgr);
+    assert(logger != NULL);
+
+    struct upipe_mgr *upipe_buffer_mgr = upipe_buffer_mgr_alloc();
+    assert(upipe_buffer_mgr != NULL);
+    struct upipe *buffer_test = upipe_void_alloc(&buffer_test_mgr,
+                                                 uprobe_use(logger));
+    assert(buffer_test != NULL);
+    struct uref *flow_def = uref_block_flow_alloc_def(uref_mgr, NULL);
+    assert(flow_def != NULL);
+
+    struct upipe_buffer_stats stats;
+
+    /* block policy: the urefs beyond the maximum size are held until the
+     * output drains the buffer */
+    test_buffer_fill(upipe_buffer_mgr, logger, flow_def, buffer_test,
+                     UPIPE_BUFFER_POLICY_BLOCK);
+    for (uint64_t id = MAX_SIZE / UREF_SIZE; id < NB_POLICY; id++)
+        upipe_input(buffer, test_uref_alloc(id), NULL);
+
+    ubase_assert(upipe_buffer_get_stats(buffer, &stats));
+    assert(stats.size == MAX_SIZE);
+    assert(stats.high_water == MAX_SIZE);
+    assert(stats.spilled == 0);
+    assert(stats.dropped == 0);
+
+    next_id = 0;
+    last_id = NB_POLICY - 1;
+    upump_mgr_run(upump_mgr, NULL);
+    assert(buffer == NULL);
+    assert(next_id == NB_POLICY);
+
+    /* drop oldest policy: each uref beyond the maximum size evicts the
+     * oldest buffered one */
+    test_buffer_fill(upipe_buffer_mgr, logger, flow_def, buffer_test,
+                     UPIPE_BUFFER_POLICY_DROP_OLDEST);
+    for (uint64_t id = MAX_SIZE / UREF_SIZE; id < NB_POLICY; id++)
+        upipe_input(buffer, test_uref_alloc(id), NULL);
+
+    ubase_assert(upipe_buffer_get_stats(buffer, &stats));
+    assert(stats.size == MAX_SIZE);
+    assert(stats.high_water == MAX_SIZE);
+    assert(stats.spilled == 0);
+    assert(stats.dropped == NB_POLICY - MAX_SIZE / UREF_SIZE);
+    assert(stats.dropped_size == stats.dropped * UREF_SIZE);
+
+    next_id = NB_POLICY - MAX_SIZE / UREF_SIZE;
+    last_id = NB_POLICY - 1;
+    upump_mgr_run(upump_mgr, NULL);
+    assert(buffer == NULL);
+    assert(next_id == NB_POLICY);
+
+    /* spill policy: the urefs beyond the maximum size, and all the following
+     * ones, go through the temporary file */
+    test_buffer_fill(upipe_buffer_mgr, logger, flow_def, buffer_test,
+                     UPIPE_BUFFER_POLICY_SPILL);
+    for (uint64_t id = MAX_SIZE / UREF_SIZE; id < NB_SPILL; id++)
+        upipe_input(buffer, test_uref_alloc(id), NULL);
+
+    ubase_assert(upipe_buffer_get_stats(buffer, &stats));
+    assert(stats.size == MAX_SIZE);
+    assert(stats.high_water == MAX_SIZE);
+    assert(stats.spilled == NB_SPILL - MAX_SIZE / UREF_SIZE);
+    assert(stats.spilled_size == stats.spilled * UREF_SIZE);
+    assert(stats.dropped == 0);
+
+    next_id = 0;
+    last_id = NB_SPILL - 1;
+    upump_mgr_run(upump_mgr, NULL);
+    assert(buffer == NULL);
+    assert(next_id == NB_SPILL);
+
+    uref_free(flow_def);
+    test_free(buffer_test);
+
+    /* release managers */
+    upipe_mgr_release(upipe_buffer_mgr);
+    ubuf_mgr_release(ubuf_mgr);
+    uref_mgr_release(uref_mgr);
+    udict_mgr_release(udict_mgr);
+    umem_mgr_release(umem_mgr);
+    upump_mgr_release(upump_mgr);
+    uprobe_release(logger);
+    uprobe_clean(&uprobe);
+
+    return 0;
+}
@@ -67,6 +67,7 @@
 #define REAL_MTU ((MTU / ALIGN) * ALIGN)
 
 static unsigned int nb_packets = 0;
+static bool contiguous = false;
 
 /** definition of our uprobe */
 static int catch(struct uprobe *uprobe, struct upipe *upipe,
@@ -112,6 +113,8 @@ static void test_input(struct upipe *upipe, struct uref *uref,
     while (size > 0) {
         ubase_assert(uref_block_read(uref, pos, &len, &buffer));
         uref_block_unmap(uref, 0);
+        if (contiguous)
+            assert(len == size);
         size -= len;
         pos += len;
     }
@@ -197,6 +200,11 @@ int main(int argc, char *argv[])
 
     nb_packets = ((PACKET_SIZE * ITERS * PACKETS_NUM * (ITERS - 1)) / 2 + REAL_MTU - 1) / REAL_MTU;
     for (j=0; j < ITERS; j++) {
+        if (j == ITERS / 2) {
+            ubase_assert(upipe_chunk_stream_set_contiguous(upipe_chunk_stream,
+                                                           true));
+            contiguous = true;
+        }
         for (i=0; i < PACKETS_NUM; i++) {
             packet_size = j * PACKET_SIZE;
             uref = uref_block_alloc(uref_mgr, ubuf_mgr, packet_size);
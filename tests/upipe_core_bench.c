@@ -0,0 +1,1021 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/** @file
+ * @short micro-benchmarks of the core primitives
+ *
+ * Every run prints one JSON object per line on stdout, with the members:
+ * @list
+ * @item bench: name of the benchmark
+ * @item role: "producer" or "consumer" for queues, "op" otherwise
+ * @item producers, consumers: number of threads of each role
+ * @item ops: number of operations, seconds: duration of the run,
+ * ops_per_sec: aggregated throughput of the threads of the role
+ * @item p50_ns, p90_ns, p99_ns, p999_ns, max_ns: distribution of the
+ * latency of one operation, sampled on one operation out of
+ * @ref BENCH_SAMPLE and corrected by the overhead of the clock
+ * @end list
+ *
+ * The first line describes the host and the clock overhead. Benchmarks may
+ * be selected by giving (prefixes of) their names on the command line.
+ */
+
+#undef NDEBUG
+
+#include <upipe/ubase.h>
+#include <upipe/urefcount.h>
+#include <upipe/uring.h>
+#include <upipe/ufifo.h>
+#include <upipe/ulifo.h>
+#include <upipe/uqueue.h>
+#include <upipe/upool.h>
+#include <upipe/umem.h>
+#include <upipe/umem_pool.h>
+#include <upipe/udict.h>
+#include <upipe/udict_inline.h>
+#include <upipe/ubuf.h>
+#include <upipe/ubuf_block.h>
+#include <upipe/ubuf_block_mem.h>
+#include <upipe/uref.h>
+#include <upipe/uref_std.h>
+#include <upipe/uref_flow.h>
+#include <upipe/uref_block.h>
+#include <upipe/uref_clock.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <inttypes.h>
+#include <time.h>
+#include <unistd.h>
+#include <sched.h>
+#include <pthread.h>
+#include <assert.h>
+
+/** one operation out of BENCH_SAMPLE is timed (power of 2) */
+#define BENCH_SAMPLE 16
+/** default number of operations per thread and per run */
+#define BENCH_OPS (1 << 20)
+/** default maximum number of threads */
+#define BENCH_MAX_THREADS 8
+/** number of exact buckets of the latency histogram */
+#define BENCH_HIST_LINEAR 64
+/** number of buckets per power of 2 above BENCH_HIST_LINEAR */
+#define BENCH_HIST_SUB 32
+/** total number of buckets of the latency histogram */
+#define BENCH_HIST_SIZE (BENCH_HIST_LINEAR + 58 * BENCH_HIST_SUB)
+/** length of the queues */
+#define BENCH_QUEUE_LENGTH 255
+/** length of the LIFOs */
+#define BENCH_LIFO_LENGTH 1024
+/** depth of the pools */
+#define BENCH_POOL_DEPTH 256
+/** number of elements allocated in a row from a upool */
+#define BENCH_POOL_BURST 16
+/** size of a TS packet */
+#define BENCH_TS_SIZE 188
+/** number of TS packets in a block */
+#define BENCH_TS_COUNT 7
+/** element pushed to tell a consumer to stop */
+#define BENCH_STOP ((void *)UINTPTR_MAX)
+
+/** @This is a histogram of latencies in nanoseconds, with a relative
+ * precision of 1/BENCH_HIST_SUB. */
+struct bench_hist {
+    /** number of samples */
+    uint64_t count;
+    /** highest sample */
+    uint64_t max;
+    /** buckets */
+    uint64_t buckets[BENCH_HIST_SIZE];
+};
+
+/** @hidden */
+struct bench_run;
+
+/** @This is the description of a benchmark. */
+struct bench {
+    /** name of the benchmark */
+    const char *name;
+    /** true if the benchmark has producers and consumers */
+    bool queue;
+    /** divisor of the number of operations per run */
+    unsigned int scale;
+    /** allocates the shared context of a run */
+    void *(*init)(void);
+    /** releases the shared context of a run */
+    void (*clean)(void *);
+    /** thread of a producer, or of every thread if queue is false */
+    void *(*producer)(void *);
+    /** thread of a consumer */
+    void *(*consumer)(void *);
+    /** pushes an element telling a consumer to stop, true on success */
+    bool (*stop)(void *);
+};
+
+/** @This is the state of a thread of a run. */
+struct bench_thread {
+    /** thread identifier */
+    pthread_t id;
+    /** run the thread belongs to */
+    struct bench_run *run;
+    /** number of operations done */
+    uint64_t ops;
+    /** time at which the thread started the run */
+    uint64_t begin;
+    /** time at which the thread finished the run */
+    uint64_t end;
+    /** latencies of the sampled operations */
+    struct bench_hist hist;
+};
+
+/** @This is the state of a run. */
+struct bench_run {
+    /** benchmark */
+    const struct bench *bench;
+    /** shared context */
+    void *ctx;
+    /** number of operations per producer */
+    uint64_t ops;
+    /** barrier to start all threads at once */
+    pthread_barrier_t barrier;
+};
+
+/** overhead of a call to bench_now, in nanoseconds */
+static uint64_t bench_overhead = 0;
+
+/** @internal @This returns the monotonic time in nanoseconds.
+ *
+ * @return current time
+ */
+static inline uint64_t bench_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * UINT64_C(1000000000) + ts.tv_nsec;
+}
+
+/** @internal @This waits a little before retrying an operation.
+ *
+ * @param spins_p reference to the number of failed attempts
+ */
+static inline void bench_relax(unsigned int *spins_p)
+{
+    if (++*spins_p >= 64) {
+        *spins_p = 0;
+        sched_yield();
+    }
+}
+
+/** @internal @This returns the index of the bucket of a latency.
+ *
+ * @param value latency in nanoseconds
+ * @return index of the bucket
+ */
+static unsigned int bench_hist_index(uint64_t value)
+{
+    if (value < BENCH_HIST_LINEAR)
+        return value;
+    unsigned int exp = 63 - __builtin_clzll(value);
+    return BENCH_HIST_LINEAR + (exp - 6) * BENCH_HIST_SUB +
+           ((value >> (exp - 5)) & (BENCH_HIST_SUB - 1));
+}
+
+/** @internal @This returns the lowest latency of a bucket.
+ *
+ * @param index index of the bucket
+ * @return latency in nanoseconds
+ */
+static uint64_t bench_hist_value(unsigned int index)
+{
+    if (index < BENCH_HIST_LINEAR)
+        return index;
+    index -= BENCH_HIST_LINEAR;
+    unsigned int exp = index / BENCH_HIST_SUB + 6;
+    return (uint64_t)(BENCH_HIST_SUB + index % BENCH_HIST_SUB) << (exp - 5);
+}
+
+/** @internal @This adds a sample to a histogram.
+ *
+ * @param hist pointer to histogram
+ * @param start time at the beginning of the operation
+ */
+static inline void bench_hist_add(struct bench_hist *hist, uint64_t start)
+{
+    uint64_t value = bench_now() - start;
+    value = value > bench_overhead ? value - bench_overhead : 0;
+    hist->buckets[bench_hist_index(value)]++;
+    hist->count++;
+    if (value > hist->max)
+        hist->max = value;
+}
+
+/** @internal @This merges a histogram into another.
+ *
+ * @param hist pointer to destination histogram
+ * @param other pointer to histogram to add
+ */
+static void bench_hist_merge(struct bench_hist *hist, struct bench_hist *other)
+{
+    for (unsigned int i = 0; i < BENCH_HIST_SIZE; i++)
+        hist->buckets[i] += other->buckets[i];
+    hist->count += other->count;
+    if (other->max > hist->max)
+        hist->max = other->max;
+}
+
+/** @internal @This returns a percentile of a histogram.
+ *
+ * @param hist pointer to histogram
+ * @param permille wanted percentile, in 1/1000
+ * @return latency in nanoseconds
+ */
+static uint64_t bench_hist_percentile(struct bench_hist *hist,
+                                      unsigned int permille)
+{
+    uint64_t target = (hist->count * permille + 999) / 1000;
+    uint64_t sum = 0;
+    for (unsigned int i = 0; i < BENCH_HIST_SIZE; i++) {
+        sum += hist->buckets[i];
+        if (sum >= target && sum)
+            return bench_hist_value(i);
+    }
+    return hist->max;
+}
+
+/** @internal @This measures the overhead of bench_now. */
+static void bench_calibrate(void)
+{
+    uint64_t best = UINT64_MAX;
+    for (unsigned int i = 0; i < 10000; i++) {
+        uint64_t start = bench_now();
+        uint64_t delta = bench_now() - start;
+        if (delta < best)
+            best = delta;
+    }
+    bench_overhead = best;
+}
+
+/** @internal @This waits for the start of a run, and returns the shared
+ * context.
+ *
+ * @param thread pointer to thread state
+ * @return shared context of the run
+ */
+static void *bench_start(struct bench_thread *thread)
+{
+    pthread_barrier_wait(&thread->run->barrier);
+    thread->begin = bench_now();
+    return thread->run->ctx;
+}
+
+/** @internal @This marks the end of the run of a thread.
+ *
+ * @param thread pointer to thread state
+ * @return NULL
+ */
+static void *bench_end(struct bench_thread *thread)
+{
+    thread->end = bench_now();
+    return NULL;
+}
+
+/** @This defines the producer and consumer threads of a queue benchmark,
+ * and the function stopping the consumers.
+ *
+ * @param NAME name of the benchmark
+ * @param TYPE type of the shared context
+ * @param PUSH expression pushing elem to queue, true on success
+ * @param POP expression popping an element from queue, or NULL
+ */
+#define BENCH_QUEUE(NAME, TYPE, PUSH, POP)                                  \
+static void *bench_##NAME##_producer(void *opaque)                          \
+{                                                                           \
+    struct bench_thread *thread = opaque;                                   \
+    TYPE *queue = bench_start(thread);                                      \
+    unsigned int spins = 0;                                                 \
+    for (uint64_t i = 0; i < thread->run->ops; i++) {                       \
+        void *elem = (void *)(uintptr_t)(i + 1);                            \
+        bool sample = !(i & (BENCH_SAMPLE - 1));                            \
+        for ( ; ; ) {                                                       \
+            uint64_t start = sample ? bench_now() : 0;                      \
+            if (likely(PUSH)) {                                             \
+                if (sample)                                                 \
+                    bench_hist_add(&thread->hist, start);                   \
+                break;                                                      \
+            }                                                               \
+            bench_relax(&spins);                                            \
+        }                                                                   \
+        thread->ops++;                                                      \
+    }                                                                       \
+    return bench_end(thread);                                               \
+}                                                                           \
+static void *bench_##NAME##_consumer(void *opaque)                          \
+{                                                                           \
+    struct bench_thread *thread = opaque;                                   \
+    TYPE *queue = bench_start(thread);                                      \
+    unsigned int spins = 0;                                                 \
+    for ( ; ; ) {                                                           \
+        bool sample = !(thread->ops & (BENCH_SAMPLE - 1));                  \
+        uint64_t start = sample ? bench_now() : 0;                          \
+        void *elem = POP;                                                   \
+        if (unlikely(elem == NULL)) {                                       \
+            bench_relax(&spins);                                            \
+            continue;                                                       \
+        }                                                                   \
+        if (unlikely(elem == BENCH_STOP))                                   \
+            break;                                                          \
+        if (sample)                                                         \
+            bench_hist_add(&thread->hist, start);                           \
+        thread->ops++;                                                      \
+    }                                                                       \
+    return bench_end(thread);                                               \
+}                                                                           \
+static bool bench_##NAME##_stop(void *opaque)                               \
+{                                                                           \
+    TYPE *queue = opaque;                                                   \
+    void *elem = BENCH_STOP;                                                \
+    return PUSH;                                                            \
+}
+
+/** @This is the shared context of the ufifo benchmark. */
+struct bench_ufifo {
+    /** FIFO */
+    struct ufifo ufifo;
+    /** extra space of the FIFO */
+    struct uring_elem extra[BENCH_QUEUE_LENGTH];
+};
+
+static void *bench_ufifo_init(void)
+{
+    struct bench_ufifo *ctx = malloc(sizeof(struct bench_ufifo));
+    assert(ctx != NULL);
+    ufifo_init(&ctx->ufifo, BENCH_QUEUE_LENGTH, ctx->extra);
+    return ctx;
+}
+
+static void bench_ufifo_clean(void *opaque)
+{
+    struct bench_ufifo *ctx = opaque;
+    ufifo_clean(&ctx->ufifo);
+    free(ctx);
+}
+
+BENCH_QUEUE(ufifo, struct bench_ufifo,
+            ufifo_push(&queue->ufifo, elem),
+            ufifo_pop(&queue->ufifo, void *))
+
+/** @This is the shared context of the ulifo benchmark. */
+struct bench_ulifo {
+    /** LIFO */
+    struct ulifo ulifo;
+    /** extra space of the LIFO */
+    struct uring_elem extra[BENCH_LIFO_LENGTH];
+};
+
+static void *bench_ulifo_init(void)
+{
+    struct bench_ulifo *ctx = malloc(sizeof(struct bench_ulifo));
+    assert(ctx != NULL);
+    ulifo_init(&ctx->ulifo, BENCH_LIFO_LENGTH, ctx->extra);
+    return ctx;
+}
+
+static void bench_ulifo_clean(void *opaque)
+{
+    struct bench_ulifo *ctx = opaque;
+    ulifo_clean(&ctx->ulifo);
+    free(ctx);
+}
+
+BENCH_QUEUE(ulifo, struct bench_ulifo,
+            ulifo_push(&queue->ulifo, elem),
+            ulifo_pop(&queue->ulifo, void *))
+
+/** @This is the shared context of the uqueue benchmark. */
+struct bench_uqueue {
+    /** queue */
+    struct uqueue uqueue;
+    /** extra space of the queue */
+    struct uring_elem extra[BENCH_QUEUE_LENGTH];
+};
+
+static void *bench_uqueue_init(void)
+{
+    struct bench_uqueue *ctx = malloc(sizeof(struct bench_uqueue));
+    assert(ctx != NULL);
+    assert(uqueue_init(&ctx->uqueue, BENCH_QUEUE_LENGTH, ctx->extra));
+    return ctx;
+}
+
+static void bench_uqueue_clean(void *opaque)
+{
+    struct bench_uqueue *ctx = opaque;
+    uqueue_clean(&ctx->uqueue);
+    free(ctx);
+}
+
+BENCH_QUEUE(uqueue, struct bench_uqueue,
+            uqueue_push(&queue->uqueue, elem),
+            uqueue_pop(&queue->uqueue, void *))
+
+/** @This is the shared context of the uring benchmark, a free list of
+ * ring elements taken and given back by all threads. */
+struct bench_uring {
+    /** ring */
+    struct uring uring;
+    /** LIFO of free elements */
+    uring_lifo lifo;
+    /** elements of the ring */
+    struct uring_elem extra[BENCH_LIFO_LENGTH];
+};
+
+static void *bench_uring_init(void)
+{
+    struct bench_uring *ctx = malloc(sizeof(struct bench_uring));
+    assert(ctx != NULL);
+    uring_lifo_init(&ctx->uring, &ctx->lifo,
+                    uring_init(&ctx->uring, BENCH_LIFO_LENGTH, ctx->extra));
+    return ctx;
+}
+
+static void bench_uring_clean(void *opaque)
+{
+    struct bench_uring *ctx = opaque;
+    uring_lifo_clean(&ctx->uring, &ctx->lifo);
+    free(ctx);
+}
+
+static void *bench_uring_thread(void *opaque)
+{
+    struct bench_thread *thread = opaque;
+    struct bench_uring *ctx = bench_start(thread);
+    unsigned int spins = 0;
+    for (uint64_t i = 0; i < thread->run->ops; i++) {
+        bool sample = !(i & (BENCH_SAMPLE - 1));
+        uint64_t start = sample ? bench_now() : 0;
+        uring_index index = uring_lifo_pop(&ctx->uring, &ctx->lifo);
+        if (unlikely(index == URING_INDEX_NULL)) {
+            bench_relax(&spins);
+            continue;
+        }
+        uring_lifo_push(&ctx->uring, &ctx->lifo, index);
+        if (sample)
+            bench_hist_add(&thread->hist, start);
+        thread->ops++;
+    }
+    return bench_end(thread);
+}
+
+/** @This is the shared context of the upool benchmark. */
+struct bench_upool {
+    /** refcount of the pool */
+    struct urefcount urefcount;
+    /** pool */
+    struct upool upool;
+    /** extra space of the pool */
+    struct uring_elem extra[BENCH_POOL_DEPTH];
+};
+
+static void bench_upool_dead(struct urefcount *urefcount)
+{
+}
+
+static void *bench_upool_alloc_cb(struct upool *upool)
+{
+    return malloc(64);
+}
+
+static void bench_upool_free_cb(struct upool *upool, void *obj)
+{
+    free(obj);
+}
+
+static void *bench_upool_init(void)
+{
+    struct bench_upool *ctx = malloc(sizeof(struct bench_upool));
+    assert(ctx != NULL);
+    urefcount_init(&ctx->urefcount, bench_upool_dead);
+    upool_init(&ctx->upool, &ctx->urefcount, BENCH_POOL_DEPTH, ctx->extra,
+               bench_upool_alloc_cb, bench_upool_free_cb);
+    return ctx;
+}
+
+static void bench_upool_clean(void *opaque)
+{
+    struct bench_upool *ctx = opaque;
+    upool_clean(&ctx->upool);
+    urefcount_clean(&ctx->urefcount);
+    free(ctx);
+}
+
+static void *bench_upool_thread(void *opaque)
+{
+    struct bench_thread *thread = opaque;
+    struct bench_upool *ctx = bench_start(thread);
+    void *objs[BENCH_POOL_BURST];
+    for (uint64_t i = 0; i < thread->run->ops; i += 2 * BENCH_POOL_BURST) {
+        for (unsigned int j = 0; j < BENCH_POOL_BURST; j++) {
+            bool sample = !(j & (BENCH_SAMPLE - 1));
+            uint64_t start = sample ? bench_now() : 0;
+            objs[j] = upool_alloc(&ctx->upool, void *);
+            assert(objs[j] != NULL);
+            if (sample)
+                bench_hist_add(&thread->hist, start);
+        }
+        for (unsigned int j = 0; j < BENCH_POOL_BURST; j++) {
+            bool sample = !(j & (BENCH_SAMPLE - 1));
+            uint64_t start = sample ? bench_now() : 0;
+            upool_free(&ctx->upool, objs[j]);
+            if (sample)
+                bench_hist_add(&thread->hist, start);
+        }
+        thread->ops += 2 * BENCH_POOL_BURST;
+    }
+    return bench_end(thread);
+}
+
+/** @This is the shared context of the benchmarks of urefs, udicts and
+ * ubufs: managers set up as in an application. */
+struct bench_mgrs {
+    /** memory allocator */
+    struct umem_mgr *umem_mgr;
+    /** udict manager */
+    struct udict_mgr *udict_mgr;
+    /** uref manager */
+    struct uref_mgr *uref_mgr;
+    /** block manager */
+    struct ubuf_mgr *ubuf_mgr;
+};
+
+static void *bench_mgrs_init(void)
+{
+    struct bench_mgrs *ctx = malloc(sizeof(struct bench_mgrs));
+    assert(ctx != NULL);
+    ctx->umem_mgr = umem_pool_mgr_alloc_simple(BENCH_POOL_DEPTH);
+    assert(ctx->umem_mgr != NULL);
+    ctx->udict_mgr = udict_inline_mgr_alloc(BENCH_POOL_DEPTH, ctx->umem_mgr,
+                                            -1, -1);
+    assert(ctx->udict_mgr != NULL);
+    ctx->uref_mgr = uref_std_mgr_alloc(BENCH_POOL_DEPTH, ctx->udict_mgr, 0);
+    assert(ctx->uref_mgr != NULL);
+    ctx->ubuf_mgr = ubuf_block_mem_mgr_alloc(BENCH_POOL_DEPTH,
+                                             BENCH_POOL_DEPTH, ctx->umem_mgr,
+                                             -1, 0, -1, 0);
+    assert(ctx->ubuf_mgr != NULL);
+    return ctx;
+}
+
+static void bench_mgrs_clean(void *opaque)
+{
+    struct bench_mgrs *ctx = opaque;
+    ubuf_mgr_release(ctx->ubuf_mgr);
+    uref_mgr_release(ctx->uref_mgr);
+    udict_mgr_release(ctx->udict_mgr);
+    umem_mgr_release(ctx->umem_mgr);
+    free(ctx);
+}
+
+/** @internal @This sets the attributes of a compressed video frame, as
+ * found on the output of a demux.
+ *
+ * @param udict pointer to udict
+ * @param num picture number
+ */
+static void bench_udict_fill(struct udict *udict, uint64_t num)
+{
+    ubase_assert(udict_set_string(udict, "block.h264.pic.",
+                                  UDICT_TYPE_FLOW_DEF, NULL));
+    ubase_assert(udict_set_unsigned(udict, 68, UDICT_TYPE_FLOW_ID, NULL));
+    ubase_assert(udict_set_unsigned(udict, num, UDICT_TYPE_PIC_NUM, NULL));
+    ubase_assert(udict_set_unsigned(udict, 1920, UDICT_TYPE_PIC_HSIZE, NULL));
+    ubase_assert(udict_set_unsigned(udict, 1080, UDICT_TYPE_PIC_VSIZE, NULL));
+    ubase_assert(udict_set_void(udict, NULL, UDICT_TYPE_PIC_PROGRESSIVE,
+                                NULL));
+    ubase_assert(udict_set_unsigned(udict, 27000000 / 25,
+                                    UDICT_TYPE_CLOCK_DURATION, NULL));
+    ubase_assert(udict_set_unsigned(udict, 27000000 / 10,
+                                    UDICT_TYPE_CLOCK_LATENCY, NULL));
+    if (!(num % 25))
+        ubase_assert(udict_set_void(udict, NULL, UDICT_TYPE_PIC_KEY, NULL));
+    ubase_assert(udict_set_string(udict, "eng", UDICT_TYPE_STRING,
+                                  "x.lang"));
+    ubase_assert(udict_set_unsigned(udict, 4, UDICT_TYPE_UNSIGNED,
+                                    "x.program"));
+    ubase_assert(udict_set_unsigned(udict, 8000000, UDICT_TYPE_UNSIGNED,
+                                    "x.bitrate"));
+}
+
+static void *bench_udict_set_thread(void *opaque)
+{
+    struct bench_thread *thread = opaque;
+    struct bench_mgrs *ctx = bench_start(thread);
+    for (uint64_t i = 0; i < thread->run->ops; i++) {
+        bool sample = !(i & (BENCH_SAMPLE - 1));
+        uint64_t start = sample ? bench_now() : 0;
+        struct udict *udict = udict_alloc(ctx->udict_mgr, 0);
+        assert(udict != NULL);
+        bench_udict_fill(udict, i);
+        udict_free(udict);
+        if (sample)
+            bench_hist_add(&thread->hist, start);
+        thread->ops++;
+    }
+    return bench_end(thread);
+}
+
+static void *bench_udict_get_thread(void *opaque)
+{
+    struct bench_thread *thread = opaque;
+    struct bench_mgrs *ctx = bench_start(thread);
+    struct udict *udict = udict_alloc(ctx->udict_mgr, 0);
+    assert(udict != NULL);
+    bench_udict_fill(udict, 1);
+    for (uint64_t i = 0; i < thread->run->ops; i++) {
+        bool sample = !(i & (BENCH_SAMPLE - 1));
+        uint64_t start = sample ? bench_now() : 0;
+        const char *s;
+        uint64_t u;
+        switch (i % 6) {
+            case 0:
+                ubase_assert(udict_get_string(udict, &s, UDICT_TYPE_FLOW_DEF,
+                                              NULL));
+                break;
+            case 1:
+                ubase_assert(udict_get_unsigned(udict, &u,
+                                                UDICT_TYPE_PIC_NUM, NULL));
+                break;
+            case 2:
+                ubase_assert(udict_get_unsigned(udict, &u,
+                            UDICT_TYPE_CLOCK_DURATION, NULL));
+                break;
+            case 3:
+                ubase_nassert(udict_get_void(udict, NULL, UDICT_TYPE_PIC_KEY,
+                                             NULL));
+                break;
+            case 4:
+                ubase_assert(udict_get_string(udict, &s, UDICT_TYPE_STRING,
+                                              "x.lang"));
+                break;
+            default:
+                ubase_assert(udict_get_unsigned(udict, &u,
+                            UDICT_TYPE_UNSIGNED, "x.bitrate"));
+                break;
+        }
+        if (sample)
+            bench_hist_add(&thread->hist, start);
+        thread->ops++;
+    }
+    udict_free(udict);
+    return bench_end(thread);
+}
+
+/** @internal @This allocates a block made of segments of TS packets, as
+ * received from a network source.
+ *
+ * @param ctx pointer to the managers
+ * @return pointer to ubuf
+ */
+static struct ubuf *bench_ubuf_alloc(struct bench_mgrs *ctx)
+{
+    struct ubuf *ubuf = NULL;
+    for (unsigned int i = 0; i < BENCH_TS_COUNT; i++) {
+        struct ubuf *packet = ubuf_block_alloc(ctx->ubuf_mgr, BENCH_TS_SIZE);
+        assert(packet != NULL);
+        int size = -1;
+        uint8_t *buffer;
+        ubase_assert(ubuf_block_write(packet, 0, &size, &buffer));
+        memset(buffer, i, BENCH_TS_SIZE);
+        buffer[0] = 0x47;
+        ubase_assert(ubuf_block_unmap(packet, 0));
+        if (ubuf == NULL)
+            ubuf = packet;
+        else
+            ubase_assert(ubuf_block_append(ubuf, packet));
+    }
+    return ubuf;
+}
+
+static void *bench_ubuf_scan_thread(void *opaque)
+{
+    struct bench_thread *thread = opaque;
+    struct bench_mgrs *ctx = bench_start(thread);
+    struct ubuf *ubuf = bench_ubuf_alloc(ctx);
+    for (uint64_t i = 0; i < thread->run->ops; i++) {
+        bool sample = !(i & (BENCH_SAMPLE - 1));
+        uint64_t start = sample ? bench_now() : 0;
+        size_t offset = 1 + (i * 37) % (BENCH_TS_SIZE * (BENCH_TS_COUNT - 1));
+        ubase_assert(ubuf_block_scan(ubuf, &offset, 0x47));
+        if (sample)
+            bench_hist_add(&thread->hist, start);
+        thread->ops++;
+    }
+    ubuf_free(ubuf);
+    return bench_end(thread);
+}
+
+static void *bench_ubuf_extract_thread(void *opaque)
+{
+    struct bench_thread *thread = opaque;
+    struct bench_mgrs *ctx = bench_start(thread);
+    struct ubuf *ubuf = bench_ubuf_alloc(ctx);
+    uint8_t buffer[BENCH_TS_SIZE];
+    for (uint64_t i = 0; i < thread->run->ops; i++) {
+        bool sample = !(i & (BENCH_SAMPLE - 1));
+        uint64_t start = sample ? bench_now() : 0;
+        int offset = (i * 97) % (BENCH_TS_SIZE * (BENCH_TS_COUNT - 1));
+        ubase_assert(ubuf_block_extract(ubuf, offset, BENCH_TS_SIZE, buffer));
+        if (sample)
+            bench_hist_add(&thread->hist, start);
+        thread->ops++;
+    }
+    ubuf_free(ubuf);
+    return bench_end(thread);
+}
+
+static void *bench_ubuf_merge_thread(void *opaque)
+{
+    struct bench_thread *thread = opaque;
+    struct bench_mgrs *ctx = bench_start(thread);
+    struct ubuf *ubuf = bench_ubuf_alloc(ctx);
+    for (uint64_t i = 0; i < thread->run->ops; i++) {
+        bool sample = !(i & (BENCH_SAMPLE - 1));
+        uint64_t start = sample ? bench_now() : 0;
+        struct ubuf *dup = ubuf_dup(ubuf);
+        assert(dup != NULL);
+        ubase_assert(ubuf_block_merge(ctx->ubuf_mgr, &dup, 0, -1));
+        ubuf_free(dup);
+        if (sample)
+            bench_hist_add(&thread->hist, start);
+        thread->ops++;
+    }
+    ubuf_free(ubuf);
+    return bench_end(thread);
+}
+
+static void *bench_uref_dup_thread(void *opaque)
+{
+    struct bench_thread *thread = opaque;
+    struct bench_mgrs *ctx = bench_start(thread);
+    struct uref *uref = uref_alloc(ctx->uref_mgr);
+    assert(uref != NULL);
+    uref_attach_ubuf(uref, bench_ubuf_alloc(ctx));
+    ubase_assert(uref_flow_set_def(uref, "block."));
+    bench_udict_fill(uref->udict, 1);
+    uref_clock_set_pts_prog(uref, UINT64_C(27000000));
+    uref_clock_set_dts_prog(uref, UINT64_C(26000000));
+
+    for (uint64_t i = 0; i < thread->run->ops; i++) {
+        bool sample = !(i & (BENCH_SAMPLE - 1));
+        uint64_t start = sample ? bench_now() : 0;
+        struct uref *dup = uref_dup(uref);
+        assert(dup != NULL);
+        uref_free(dup);
+        if (sample)
+            bench_hist_add(&thread->hist, start);
+        thread->ops++;
+    }
+    uref_free(uref);
+    return bench_end(thread);
+}
+
+/** list of benchmarks */
+static const struct bench benches[] = {
+    { "ufifo", true, 1, bench_ufifo_init, bench_ufifo_clean,
+      bench_ufifo_producer, bench_ufifo_consumer, bench_ufifo_stop },
+    { "ulifo", true, 1, bench_ulifo_init, bench_ulifo_clean,
+      bench_ulifo_producer, bench_ulifo_consumer, bench_ulifo_stop },
+    { "uqueue", true, 1, bench_uqueue_init, bench_uqueue_clean,
+      bench_uqueue_producer, bench_uqueue_consumer, bench_uqueue_stop },
+    { "uring_lifo", false, 1, bench_uring_init, bench_uring_clean,
+      bench_uring_thread, NULL, NULL },
+    { "upool", false, 1, bench_upool_init, bench_upool_clean,
+      bench_upool_thread, NULL, NULL },
+    { "udict_set", false, 8, bench_mgrs_init, bench_mgrs_clean,
+      bench_udict_set_thread, NULL, NULL },
+    { "udict_get", false, 1, bench_mgrs_init, bench_mgrs_clean,
+      bench_udict_get_thread, NULL, NULL },
+    { "ubuf_block_scan", false, 4, bench_mgrs_init, bench_mgrs_clean,
+      bench_ubuf_scan_thread, NULL, NULL },
+    { "ubuf_block_extract", false, 4, bench_mgrs_init, bench_mgrs_clean,
+      bench_ubuf_extract_thread, NULL, NULL },
+    { "ubuf_block_merge", false, 16, bench_mgrs_init, bench_mgrs_clean,
+      bench_ubuf_merge_thread, NULL, NULL },
+    { "uref_dup", false, 4, bench_mgrs_init, bench_mgrs_clean,
+      bench_uref_dup_thread, NULL, NULL },
+};
+
+/** @internal @This returns the time at which the last of the given threads
+ * finished.
+ *
+ * @param threads array of threads
+ * @param nb number of threads
+ * @return time of the end of the run
+ */
+static uint64_t bench_run_end(struct bench_thread *threads, unsigned int nb)
+{
+    uint64_t end = 0;
+    for (unsigned int i = 0; i < nb; i++)
+        if (threads[i].end > end)
+            end = threads[i].end;
+    return end;
+}
+
+/** @internal @This prints the results of the threads of a role.
+ *
+ * @param run pointer to the run
+ * @param role name of the role
+ * @param threads array of threads of the role
+ * @param nb number of threads of the role
+ * @param producers number of producers of the run
+ * @param consumers number of consumers of the run
+ * @param begin time at which the first thread started
+ */
+static void bench_report(struct bench_run *run, const char *role,
+                         struct bench_thread *threads, unsigned int nb,
+                         unsigned int producers, unsigned int consumers,
+                         uint64_t begin)
+{
+    struct bench_hist *hist = calloc(1, sizeof(struct bench_hist));
+    assert(hist != NULL);
+    uint64_t ops = 0;
+    for (unsigned int i = 0; i < nb; i++) {
+        ops += threads[i].ops;
+        bench_hist_merge(hist, &threads[i].hist);
+    }
+    double seconds = (bench_run_end(threads, nb) - begin) / 1e9;
+    printf("{\"bench\":\"%s\",\"role\":\"%s\",\"producers\":%u,"
+           "\"consumers\":%u,\"ops\":%"PRIu64",\"seconds\":%.6f,"
+           "\"ops_per_sec\":%.0f,\"p50_ns\":%"PRIu64",\"p90_ns\":%"PRIu64","
+           "\"p99_ns\":%"PRIu64",\"p999_ns\":%"PRIu64",\"max_ns\":%"PRIu64
+           "}\n",
+           run->bench->name, role, producers, consumers, ops, seconds,
+           seconds > 0 ? ops / seconds : 0,
+           bench_hist_percentile(hist, 500), bench_hist_percentile(hist, 900),
+           bench_hist_percentile(hist, 990), bench_hist_percentile(hist, 999),
+           hist->max);
+    fflush(stdout);
+    free(hist);
+}
+
+/** @internal @This runs a benchmark once.
+ *
+ * @param bench description of the benchmark
+ * @param ops number of operations per producer
+ * @param producers number of producers (or threads)
+ * @param consumers number of consumers
+ */
+static void bench_run(const struct bench *bench, uint64_t ops,
+                      unsigned int producers, unsigned int consumers)
+{
+    struct bench_run run;
+    run.bench = bench;
+    run.ctx = bench->init();
+    run.ops = ops;
+    unsigned int nb = producers + consumers;
+    assert(!pthread_barrier_init(&run.barrier, NULL, nb + 1));
+
+    struct bench_thread *threads = calloc(nb, sizeof(struct bench_thread));
+    assert(threads != NULL);
+    for (unsigned int i = 0; i < nb; i++) {
+        threads[i].run = &run;
+        assert(!pthread_create(&threads[i].id, NULL,
+                               i < producers ? bench->producer :
+                                               bench->consumer,
+                               &threads[i]));
+    }
+
+    pthread_barrier_wait(&run.barrier);
+    for (unsigned int i = 0; i < producers; i++)
+        assert(!pthread_join(threads[i].id, NULL));
+    /* the stop elements are queued after all the elements of the run */
+    for (unsigned int i = 0; i < consumers; i++)
+        while (!bench->stop(run.ctx))
+            sched_yield();
+    for (unsigned int i = producers; i < nb; i++)
+        assert(!pthread_join(threads[i].id, NULL));
+
+    uint64_t begin = UINT64_MAX;
+    for (unsigned int i = 0; i < nb; i++)
+        if (threads[i].begin < begin)
+            begin = threads[i].begin;
+    if (bench->queue) {
+        bench_report(&run, "producer", threads, producers, producers,
+                     consumers, begin);
+        bench_report(&run, "consumer", threads + producers, consumers,
+                     producers, consumers, begin);
+    } else
+        bench_report(&run, "op", threads, producers, producers, 0, begin);
+
+    free(threads);
+    pthread_barrier_destroy(&run.barrier);
+    bench->clean(run.ctx);
+}
+
+/** @internal @This prints the usage and exits.
+ *
+ * @param argv0 name of the program
+ */
+static void usage(const char *argv0)
+{
+    fprintf(stderr, "Usage: %s [-j <max threads>] [-n <ops per thread>] "
+            "[-l] [<bench>...]\n", argv0);
+    fprintf(stderr, "   -j: run with 1, 2, 4... up to this number of "
+            "threads of each role\n");
+    fprintf(stderr, "   -n: number of operations per thread and per run\n");
+    fprintf(stderr, "   -l: list the benchmarks\n");
+    exit(EXIT_FAILURE);
+}
+
+/** @internal @This returns the next number of threads to try.
+ *
+ * @param threads current number of threads
+ * @param max maximum number of threads
+ * @return next number of threads, or 0 when done
+ */
+static unsigned int bench_next_threads(unsigned int threads, unsigned int max)
+{
+    if (threads >= max)
+        return 0;
+    return threads * 2 > max ? max : threads * 2;
+}
+
+int main(int argc, char **argv)
+{
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    unsigned int max_threads = cpus > 0 && cpus < BENCH_MAX_THREADS ? cpus :
+                               BENCH_MAX_THREADS;
+    uint64_t ops = BENCH_OPS;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "j:n:l")) != -1) {
+        switch (opt) {
+            case 'j':
+                max_threads = strtoul(optarg, NULL, 0);
+                break;
+            case 'n':
+                ops = strtoull(optarg, NULL, 0);
+                break;
+            case 'l':
+                for (unsigned int i = 0; i < UBASE_ARRAY_SIZE(benches); i++)
+                    printf("%s\n", benches[i].name);
+                exit(EXIT_SUCCESS);
+            default:
+                usage(argv[0]);
+        }
+    }
+    if (!max_threads || !ops)
+        usage(argv[0]);
+
+    bench_calibrate();
+    printf("{\"bench\":\"clock\",\"cpus\":%ld,\"overhead_ns\":%"PRIu64","
+           "\"sample\":%u}\n", cpus, bench_overhead, BENCH_SAMPLE);
+
+    for (unsigned int i = 0; i < UBASE_ARRAY_SIZE(benches); i++) {
+        const struct bench *bench = &benches[i];
+        bool selected = optind >= argc;
+        for (int j = optind; j < argc && !selected; j++)
+            selected = !strncmp(bench->name, argv[j], strlen(argv[j]));
+        if (!selected)
+            continue;
+
+        uint64_t bench_ops = ops / bench->scale;
+        if (!bench_ops)
+            bench_ops = 1;
+        for (unsigned int p = 1; p; p = bench_next_threads(p, max_threads)) {
+            if (!bench->queue) {
+                bench_run(bench, bench_ops, p, 0);
+                continue;
+            }
+            for (unsigned int c = 1; c;
+                 c = bench_next_threads(c, max_threads))
+                bench_run(bench, bench_ops, p, c);
+        }
+    }
+    return 0;
+}
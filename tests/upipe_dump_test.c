@@ -0,0 +1,242 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short unit tests for pipeline dumps
+ */
+
+#undef NDEBUG
+
+#include <upipe/uprobe.h>
+#include <upipe/uprobe_stdio.h>
+#include <upipe/uprobe_prefix.h>
+#include <upipe/uclock.h>
+#include <upipe/umem.h>
+#include <upipe/umem_alloc.h>
+#include <upipe/udict.h>
+#include <upipe/udict_inline.h>
+#include <upipe/uref.h>
+#include <upipe/uref_flow.h>
+#include <upipe/uref_std.h>
+#include <upipe/upipe.h>
+#include <upipe/upipe_dump.h>
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <assert.h>
+
+#define UDICT_POOL_DEPTH 10
+#define UREF_POOL_DEPTH 10
+#define UPROBE_LOG_LEVEL UPROBE_LOG_DEBUG
+
+/** phony pipe */
+struct test_pipe {
+    /** output */
+    struct upipe *output;
+    /** flow definition */
+    struct uref *flow_def;
+    /** true if the pipe buffers urefs */
+    bool buffers;
+    /** public structure */
+    struct upipe upipe;
+};
+
+UBASE_FROM_TO(test_pipe, upipe, upipe, upipe)
+
+/** definition of our uprobe */
+static int catch(struct uprobe *uprobe, struct upipe *upipe,
+                 int event, va_list args)
+{
+    switch (event) {
+        default:
+            assert(0);
+            break;
+        case UPROBE_READY:
+        case UPROBE_DEAD:
+            break;
+    }
+    return UBASE_ERR_NONE;
+}
+
+/** helper phony pipe */
+static struct upipe *test_alloc(struct upipe_mgr *mgr, struct uprobe *uprobe,
+                                uint32_t signature, va_list args)
+{
+    struct test_pipe *test_pipe = malloc(sizeof(struct test_pipe));
+    assert(test_pipe != NULL);
+    test_pipe->output = NULL;
+    test_pipe->flow_def = NULL;
+    test_pipe->buffers = false;
+    upipe_init(&test_pipe->upipe, mgr, uprobe);
+    return &test_pipe->upipe;
+}
+
+/** helper phony pipe */
+static int test_control(struct upipe *upipe, int command, va_list args)
+{
+    struct test_pipe *test_pipe = test_pipe_from_upipe(upipe);
+    switch (command) {
+        case UPIPE_GET_OUTPUT: {
+            struct upipe **p = va_arg(args, struct upipe **);
+            *p = test_pipe->output;
+            return UBASE_ERR_NONE;
+        }
+        case UPIPE_GET_FLOW_DEF: {
+            struct uref **p = va_arg(args, struct uref **);
+            *p = test_pipe->flow_def;
+            return UBASE_ERR_NONE;
+        }
+        case UPIPE_GET_OCCUPANCY: {
+            if (!test_pipe->buffers)
+                return UBASE_ERR_UNHANDLED;
+            struct upipe_occupancy *occupancy =
+                va_arg(args, struct upipe_occupancy *);
+            occupancy->urefs = 3;
+            occupancy->max_urefs = 8;
+            occupancy->duration = UCLOCK_FREQ / 10;
+            return UBASE_ERR_NONE;
+        }
+        default:
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** helper phony pipe */
+static void test_free(struct upipe *upipe)
+{
+    struct test_pipe *test_pipe = test_pipe_from_upipe(upipe);
+    uref_free(test_pipe->flow_def);
+    uprobe_release(upipe->uprobe);
+    upipe_clean(upipe);
+    free(test_pipe);
+}
+
+/** helper phony pipe */
+static struct upipe_mgr test_mgr = {
+    .refcount = NULL,
+    .signature = UBASE_FOURCC('t','e','s','t'),
+    .upipe_alloc = test_alloc,
+    .upipe_input = NULL,
+    .upipe_control = test_control
+};
+
+/** reads a whole file */
+static char *read_file(const char *path)
+{
+    FILE *file = fopen(path, "r");
+    assert(file != NULL);
+    static char buffer[4096];
+    size_t size = fread(buffer, 1, sizeof(buffer) - 1, file);
+    buffer[size] = '\0';
+    fclose(file);
+    return buffer;
+}
+
+int main(int argc, char *argv[])
+{
+    struct umem_mgr *umem_mgr = umem_alloc_mgr_alloc();
+    assert(umem_mgr != NULL);
+    struct udict_mgr *udict_mgr = udict_inline_mgr_alloc(UDICT_POOL_DEPTH,
+                                                         umem_mgr, -1, -1);
+    assert(udict_mgr != NULL);
+    struct uref_mgr *uref_mgr = uref_std_mgr_alloc(UREF_POOL_DEPTH, udict_mgr,
+                                                   0);
+    assert(uref_mgr != NULL);
+    struct uprobe uprobe;
+    uprobe_init(&uprobe, catch, NULL);
+    struct uprobe *logger = uprobe_stdio_alloc(&uprobe, stdout,
+                                               UPROBE_LOG_LEVEL);
+    assert(logger != NULL);
+
+    struct upipe *source = upipe_void_alloc(&test_mgr,
+            uprobe_pfx_alloc(uprobe_use(logger), UPROBE_LOG_LEVEL, "src"));
+    struct upipe *queue = upipe_void_alloc(&test_mgr,
+            uprobe_pfx_alloc(uprobe_use(logger), UPROBE_LOG_LEVEL, "queue"));
+    assert(source != NULL && queue != NULL);
+    test_pipe_from_upipe(source)->output = queue;
+    test_pipe_from_upipe(queue)->buffers = true;
+    struct uref *flow_def = uref_alloc(uref_mgr);
+    assert(flow_def != NULL);
+    ubase_assert(uref_flow_set_def(flow_def, "block."));
+    test_pipe_from_upipe(source)->flow_def = flow_def;
+
+    struct upipe_occupancy occupancy;
+    ubase_assert(upipe_get_occupancy(queue, &occupancy));
+    assert(occupancy.urefs == 3);
+    assert(occupancy.bytes == UINT64_MAX);
+    assert(!ubase_check(upipe_get_occupancy(source, &occupancy)));
+
+    char path[] = "/tmp/upipe_dump_test.XXXXXX";
+    int fd = mkstemp(path);
+    assert(fd != -1);
+    close(fd);
+
+    /* one-shot JSON dump */
+    FILE *file = fopen(path, "w");
+    assert(file != NULL);
+    upipe_dump_json(NULL, file, NULL, source, NULL);
+    fclose(file);
+    const char *json = read_file(path);
+    printf("%s", json);
+    assert(strstr(json, "\"id\":0,\"label\":\"src (test)\"") != NULL);
+    assert(strstr(json, "\"output\":{\"id\":1,\"flow_def\":\"block.\"}"));
+    assert(strstr(json, "\"occupancy\":{\"urefs\":3,\"max_urefs\":8,"
+                        "\"bytes\":null,\"duration\":2700000}") != NULL);
+    assert(strstr(json, "\"pools\":[]") != NULL);
+
+    /* the dump leaves the pipes untouched */
+    assert(source->opaque == NULL && queue->opaque == NULL);
+
+    /* live dump in dot format, with a pool */
+    struct upipe_dump_live *live = upipe_dump_live_alloc(NULL, UCLOCK_FREQ,
+            UPIPE_DUMP_FORMAT_DOT, path, NULL, NULL);
+    assert(live != NULL);
+    ubase_assert(upipe_dump_live_add_source(live, source));
+    ubase_assert(upipe_dump_live_add_uref_mgr(live, "urefs", uref_mgr));
+    struct uref *uref = uref_alloc(uref_mgr);
+    assert(uref != NULL);
+    ubase_assert(upipe_dump_live_write(live));
+    const char *dot = read_file(path);
+    printf("%s", dot);
+    assert(strstr(dot, "queue: 3/8 urefs, 100 ms") != NULL);
+    assert(strstr(dot, "urefs: 1 in use, max 1") != NULL);
+    uref_free(uref);
+    upipe_dump_live_free(live);
+    unlink(path);
+
+    test_free(source);
+    test_free(queue);
+
+    uref_mgr_release(uref_mgr);
+    udict_mgr_release(udict_mgr);
+    umem_mgr_release(umem_mgr);
+    uprobe_release(logger);
+    uprobe_clean(&uprobe);
+
+    return 0;
+}
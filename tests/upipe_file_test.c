@@ -59,6 +59,7 @@
 #include <stdio.h>
 #include <unistd.h>
 #include <inttypes.h>
+#include <sys/stat.h>
 #include <assert.h>
 
 #define UDICT_POOL_DEPTH 0
@@ -67,15 +68,25 @@
 #define UPUMP_POOL 0
 #define UPUMP_BLOCKER_POOL 0
 #define READ_SIZE 4096
+#define SYNC_PERIOD (UCLOCK_FREQ / 100)
 #define UPROBE_LOG_LEVEL UPROBE_LOG_DEBUG
 
 static void usage(const char *argv0) {
-    fprintf(stdout, "Usage: %s [-d <delay>] [-a|-o] <source file> <sink file>\n", argv0);
+    fprintf(stdout, "Usage: %s [-d <delay>] [-a|-o] [-m|-f] [-w <depth>] [-s] <source file> <sink file>\n", argv0);
     fprintf(stdout, "-a : append\n");
     fprintf(stdout, "-o : overwrite\n");
+    fprintf(stdout, "-m : map the source file in memory\n");
+    fprintf(stdout, "-f : output the source file as file ranges\n");
+    fprintf(stdout, "-w : write asynchronously with <depth> buffers\n");
+    fprintf(stdout, "-s : check that the file is synced before it is closed\n");
     exit(EXIT_FAILURE);
 }
 
+static struct upipe *upipe_fsrc;
+static const char *sink_file;
+static uint64_t source_size;
+static bool source_end = false;
+
 /** definition of our uprobe */
 static int catch(struct uprobe *uprobe, struct upipe *upipe,
                  int event, va_list args)
@@ -87,19 +98,43 @@ static int catch(struct uprobe *uprobe, struct upipe *upipe,
         case UPROBE_READY:
         case UPROBE_DEAD:
         case UPROBE_NEW_FLOW_DEF:
+            break;
         case UPROBE_SOURCE_END:
+            source_end = true;
             break;
     }
     return UBASE_ERR_NONE;
 }
 
+/** checks that the whole file was synced while the sink is still open */
+static void check_sync(struct upump *upump)
+{
+    static bool ended = false;
+    if (!ended) {
+        /* wait for one more check once the source has ended */
+        ended = source_end;
+        return;
+    }
+
+    struct stat st;
+    assert(stat(sink_file, &st) == 0);
+    assert((uint64_t)st.st_size == source_size);
+    upump_stop(upump);
+    upipe_release(upipe_fsrc);
+    upipe_fsrc = NULL;
+}
+
 int main(int argc, char *argv[])
 {
-    const char *src_file, *sink_file;
+    const char *src_file;
     int64_t delay = 0;
     enum upipe_fsink_mode mode = UPIPE_FSINK_CREATE;
+    bool map = false;
+    bool file_ubuf = false;
+    unsigned int async_depth = 0;
+    bool sync = false;
     int opt;
-    while ((opt = getopt(argc, argv, "d:ao")) != -1) {
+    while ((opt = getopt(argc, argv, "d:aomfw:s")) != -1) {
         switch (opt) {
             case 'd':
                 delay = atoi(optarg);
@@ -110,6 +145,18 @@ int main(int argc, char *argv[])
             case 'o':
                 mode = UPIPE_FSINK_OVERWRITE;
                 break;
+            case 'm':
+                map = true;
+                break;
+            case 'f':
+                file_ubuf = true;
+                break;
+            case 'w':
+                async_depth = atoi(optarg);
+                break;
+            case 's':
+                sync = true;
+                break;
             default:
                 usage(argv[0]);
         }
@@ -151,15 +198,26 @@ int main(int argc, char *argv[])
 
     struct upipe_mgr *upipe_fsrc_mgr = upipe_fsrc_mgr_alloc();
     assert(upipe_fsrc_mgr != NULL);
-    struct upipe *upipe_fsrc = upipe_void_alloc(upipe_fsrc_mgr,
+    upipe_fsrc = upipe_void_alloc(upipe_fsrc_mgr,
             uprobe_pfx_alloc(uprobe_use(logger),
                              UPROBE_LOG_LEVEL, "file source"));
     assert(upipe_fsrc != NULL);
     ubase_assert(upipe_set_output_size(upipe_fsrc, READ_SIZE));
+    if (map) {
+        ubase_assert(upipe_fsrc_set_mmap(upipe_fsrc, true));
+        bool enabled = false;
+        ubase_assert(upipe_fsrc_get_mmap(upipe_fsrc, &enabled));
+        assert(enabled);
+    }
+    if (file_ubuf) {
+        ubase_assert(upipe_fsrc_set_file_ubuf(upipe_fsrc, true));
+        bool enabled = false;
+        ubase_assert(upipe_fsrc_get_file_ubuf(upipe_fsrc, &enabled));
+        assert(enabled);
+    }
     ubase_assert(upipe_set_uri(upipe_fsrc, src_file));
-    uint64_t size;
-    if (ubase_check(upipe_src_get_size(upipe_fsrc, &size)))
-        fprintf(stdout, "source file has size %"PRIu64"\n", size);
+    if (ubase_check(upipe_src_get_size(upipe_fsrc, &source_size)))
+        fprintf(stdout, "source file has size %"PRIu64"\n", source_size);
     else
         fprintf(stdout, "source path is not a regular file\n");
 
@@ -186,10 +244,32 @@ int main(int argc, char *argv[])
     assert(upipe_fsink != NULL);
     if (delay)
         ubase_assert(upipe_attach_uclock(upipe_fsink));
+    if (async_depth) {
+        ubase_assert(upipe_fsink_set_async_depth(upipe_fsink, async_depth));
+        unsigned int depth = 0;
+        ubase_assert(upipe_fsink_get_async_depth(upipe_fsink, &depth));
+        assert(depth == async_depth);
+    }
+    if (sync)
+        ubase_assert(upipe_fsink_set_sync_period(upipe_fsink, SYNC_PERIOD));
     ubase_assert(upipe_fsink_set_path(upipe_fsink, sink_file, mode));
     upipe_release(upipe_fsink);
 
+    struct upump *upump = NULL;
+    if (sync) {
+        /* the sync timer keeps the loop running until the pipes are
+         * released */
+        upump = upump_alloc_timer(upump_mgr, check_sync, NULL, NULL,
+                                  5 * SYNC_PERIOD, 5 * SYNC_PERIOD);
+        assert(upump != NULL);
+        upump_start(upump);
+    }
+
     upump_mgr_run(upump_mgr, NULL);
+    if (upump != NULL) {
+        assert(upipe_fsrc == NULL);
+        upump_free(upump);
+    }
 
     upipe_release(upipe_fsrc);
     upipe_mgr_release(upipe_fsrc_mgr); // nop
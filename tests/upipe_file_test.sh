@@ -10,3 +10,19 @@ trap cleanup EXIT
 
 "$srcdir"/valgrind_wrapper.sh "$srcdir" ./upipe_file_test Makefile "$TMP"/test
 cmp --quiet "$TMP"/test Makefile
+
+rm -f "$TMP"/test
+"$srcdir"/valgrind_wrapper.sh "$srcdir" ./upipe_file_test -m Makefile "$TMP"/test
+cmp --quiet "$TMP"/test Makefile
+
+rm -f "$TMP"/test
+"$srcdir"/valgrind_wrapper.sh "$srcdir" ./upipe_file_test -f Makefile "$TMP"/test
+cmp --quiet "$TMP"/test Makefile
+
+rm -f "$TMP"/test
+"$srcdir"/valgrind_wrapper.sh "$srcdir" ./upipe_file_test -f -w 2 Makefile "$TMP"/test
+cmp --quiet "$TMP"/test Makefile
+
+rm -f "$TMP"/test
+"$srcdir"/valgrind_wrapper.sh "$srcdir" ./upipe_file_test -w 2 -s Makefile "$TMP"/test
+cmp --quiet "$TMP"/test Makefile
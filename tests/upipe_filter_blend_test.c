@@ -135,7 +135,9 @@ int main(int argc, char **argv)
     upipe_release(nullpipe);
     uref_free(uref);
 
-    for (counter=0; counter < 10; counter++) {
+    for (counter=0; counter < 20; counter++) {
+        if (counter == 10)
+            ubase_assert(upipe_filter_blend_set_threads(filter_blend, 3));
         printf("Sending pic %d\n", counter);
         pic = uref_pic_alloc(uref_mgr, ubuf_mgr, WIDTH, HEIGHT);
         assert(pic);
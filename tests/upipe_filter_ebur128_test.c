@@ -117,6 +117,9 @@ int main(int argc, char **argv)
     struct upipe *r128 = upipe_void_alloc(upipe_filter_ebur128_mgr,
         uprobe_pfx_alloc(uprobe_use(logger), UPROBE_LOG_LEVEL, "r128"));
     assert(r128);
+    bool gating;
+    ubase_assert(upipe_filter_ebur128_get_gating(r128, &gating));
+    assert(gating);
 
     struct uref *flow = uref_sound_flow_alloc_def(uref_mgr, "s16.", CHANNELS,
                                                   2 * CHANNELS);
@@ -164,6 +167,13 @@ int main(int argc, char **argv)
         uref_clock_set_pts_sys(uref, UCLOCK_FREQ + i * DURATION);
         uref_clock_set_duration(uref, DURATION);
         upipe_input(r128, uref, NULL);
+
+        /* only measure momentary and short-term loudness afterwards */
+        if (i == ITERATIONS / 2) {
+            ubase_assert(upipe_filter_ebur128_set_gating(r128, false));
+            ubase_assert(upipe_filter_ebur128_get_gating(r128, &gating));
+            assert(!gating);
+        }
     }
 
     /* release pipe */
@@ -50,6 +50,7 @@
 #include <stdbool.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <unistd.h>
 #include <inttypes.h>
 #include <arpa/inet.h>
@@ -64,6 +65,8 @@
 #define PACKET_SIZE 524
 
 static unsigned int nb_packets = 0;
+/** expected content of a segmented packet */
+static const uint8_t *expected = NULL;
 
 /** definition of our uprobe */
 static int catch(struct uprobe *uprobe, struct upipe *upipe,
@@ -103,6 +106,15 @@ static void test_input(struct upipe *upipe, struct uref *uref,
     ubase_assert(uref_block_size(uref, &size));
     upipe_dbg_va(upipe, "received packet of size %zu", size);
 
+    if (expected != NULL) {
+        uint8_t content[size];
+        ubase_assert(uref_block_extract(uref, 0, size, content));
+        assert(!memcmp(content, expected, size));
+        expected = NULL;
+        uref_free(uref);
+        return;
+    }
+
     while (size > 0) {
         ubase_assert(uref_block_read(uref, pos, &len, &buffer));
         pos += len;
@@ -201,7 +213,42 @@ int main(int argc, char *argv[])
         uref_block_unmap(uref, 0);
         upipe_input(upipe_htons, uref, NULL);
     }
-    /* TODO test segmented, shared, unaligned ubufs */
+
+    /* segmented ubuf with 24-bit words split across segments */
+    unsigned int word_size;
+    ubase_assert(upipe_htons_get_word_size(upipe_htons, &word_size));
+    assert(word_size == 2);
+    ubase_assert(upipe_htons_set_word_size(upipe_htons, 3));
+    ubase_nassert(upipe_htons_set_word_size(upipe_htons, 5));
+
+    static const uint8_t segments[] = {
+        0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19
+    };
+    static const uint8_t swapped[] = {
+        2, 1, 0, 5, 4, 3, 8, 7, 6, 11, 10, 9, 14, 13, 12, 17, 16, 15, 18, 19
+    };
+    static const int segment_sizes[] = { 7, 1, 11, 1 };
+    uref = NULL;
+    int offset = 0;
+    for (i = 0; i < sizeof(segment_sizes) / sizeof(segment_sizes[0]); i++) {
+        struct uref *segment = uref_block_alloc(uref_mgr, ubuf_mgr,
+                                                segment_sizes[i]);
+        assert(segment != NULL);
+        size = -1;
+        ubase_assert(uref_block_write(segment, 0, &size, &buffer));
+        memcpy(buffer, segments + offset, size);
+        uref_block_unmap(segment, 0);
+        offset += size;
+        if (uref == NULL)
+            uref = segment;
+        else {
+            ubase_assert(uref_block_append(uref, uref_detach_ubuf(segment)));
+            uref_free(segment);
+        }
+    }
+    expected = swapped;
+    upipe_input(upipe_htons, uref, NULL);
+    assert(expected == NULL);
 
     /* flush */
     upipe_release(upipe_htons);
@@ -22,6 +22,7 @@
 #include <upipe-modules/upipe_null.h>
 
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 
 #define UDICT_POOL_DEPTH 0
@@ -81,6 +82,23 @@ static int catch_uref(struct uprobe *uprobe,
         if (ubase_check(uref_m3u_playlist_flow_get_endlist(uref)))
             printf("playlist end\n");
 
+        uint64_t part_target;
+        if (ubase_check(uref_m3u_playlist_flow_get_part_target(
+                    uref, &part_target)))
+            printf("playlist part target: %"PRIu64"\n", part_target);
+
+        uint64_t part_hold_back;
+        if (ubase_check(uref_m3u_playlist_flow_get_part_hold_back(
+                    uref, &part_hold_back)))
+            printf("playlist part hold back: %"PRIu64"\n", part_hold_back);
+
+        if (ubase_check(uref_m3u_playlist_flow_get_can_block_reload(uref)))
+            printf("playlist can block reload\n");
+
+        uint64_t append;
+        if (ubase_check(uref_m3u_playlist_flow_get_append(uref, &append)))
+            printf("playlist append: %"PRIu64"\n", append);
+
         return UBASE_ERR_NONE;
     }
 
@@ -110,6 +128,16 @@ static int catch_uref(struct uprobe *uprobe,
             printf("playlist byte range offset: %"PRIu64"\n",
                    playlist_byte_range_off);
 
+        uint64_t part_index;
+        if (ubase_check(uref_m3u_playlist_get_part_index(uref, &part_index)))
+            printf("playlist part: %"PRIu64"\n", part_index);
+
+        if (ubase_check(uref_m3u_playlist_get_part_independent(uref)))
+            printf("playlist part independent\n");
+
+        if (ubase_check(uref_m3u_playlist_get_preload_hint(uref)))
+            printf("playlist preload hint\n");
+
         uint64_t master_bandwidth;
         if (ubase_check(uref_m3u_master_get_bandwidth(
                     uref, &master_bandwidth)))
@@ -159,6 +187,12 @@ static int catch_uref(struct uprobe *uprobe,
 
 int main(int argc, char *argv[])
 {
+    bool incremental = false;
+    if (argc >= 2 && !strcmp(argv[1], "-i")) {
+        incremental = true;
+        argc--;
+        argv++;
+    }
     assert(argc >= 2);
     nb_files = argc - 1;
     files = argv + 1;
@@ -207,6 +241,8 @@ int main(int argc, char *argv[])
                          UPROBE_LOG_VERBOSE, "m3u reader"));
     upipe_mgr_release(upipe_m3u_reader_mgr);
     assert(upipe_m3u_reader != NULL);
+    if (incremental)
+        ubase_assert(upipe_m3u_reader_set_incremental(upipe_m3u_reader, true));
 
     struct uprobe uprobe_uref;
     uprobe_init(&uprobe_uref, catch_uref, uprobe_use(logger));
@@ -39,6 +39,7 @@
 #include <upipe/uref.h>
 #include <upipe/uref_flow.h>
 #include <upipe/uref_std.h>
+#include <upipe/uref_pic.h>
 #include <upipe/upipe.h>
 #include <upipe-modules/upipe_match_attr.h>
 
@@ -175,6 +176,42 @@ int main(int argc, char *argv[])
 
     assert(nb_packets == 1);
 
+    /* same match, resolved once without a callback */
+    ubase_assert(upipe_match_attr_set_attr(upipe_match_attr,
+                                           UDICT_TYPE_UNSIGNED, "x.test_foo"));
+    uref = uref_alloc(uref_mgr);
+    assert(uref != NULL);
+    uref_test_set_foo(uref, 36);
+    upipe_input(upipe_match_attr, uref, NULL);
+
+    uref = uref_alloc(uref_mgr);
+    assert(uref != NULL);
+    uref_test_set_foo(uref, 100);
+    upipe_input(upipe_match_attr, uref, NULL);
+
+    uref = uref_alloc(uref_mgr);
+    assert(uref != NULL);
+    upipe_input(upipe_match_attr, uref, NULL);
+
+    assert(nb_packets == 2);
+
+    /* name of a shorthand attribute */
+    ubase_assert(upipe_match_attr_set_attr(upipe_match_attr,
+                                           UDICT_TYPE_UNSIGNED, "p.num"));
+    uref = uref_alloc(uref_mgr);
+    assert(uref != NULL);
+    uref_test_set_foo(uref, 36);
+    ubase_assert(uref_pic_set_number(uref, 36));
+    upipe_input(upipe_match_attr, uref, NULL);
+
+    uref = uref_alloc(uref_mgr);
+    assert(uref != NULL);
+    uref_test_set_foo(uref, 36);
+    ubase_assert(uref_pic_set_number(uref, 100));
+    upipe_input(upipe_match_attr, uref, NULL);
+
+    assert(nb_packets == 3);
+
     upipe_release(upipe_match_attr);
     upipe_mgr_release(upipe_match_attr_mgr); // nop
 
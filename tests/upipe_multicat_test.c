@@ -85,6 +85,11 @@ static struct upump *idler;
 static uint64_t rotate = 0;
 static uint64_t rotate_offset = 0;
 static uint64_t gen_systime = 0;
+static uint64_t prealloc = 0;
+static unsigned int batch = 0;
+static unsigned int index_stride = 0;
+static uint64_t msrc_systime = 0;
+static unsigned int msrc_count = 0;
 
 static void sig_handler(int sig)
 {
@@ -93,7 +98,7 @@ static void sig_handler(int sig)
 }
 
 static void usage(const char *argv0) {
-    fprintf(stdout, "Usage: %s [-r <rotate> [-O <rotate offset>]] <dest dir> <suffix>\n", argv0);
+    fprintf(stdout, "Usage: %s [-r <rotate> [-O <rotate offset>]] [-p <prealloc>] [-b <batch>] [-i <index stride>] <dest dir> <suffix>\n", argv0);
     exit(EXIT_FAILURE);
 }
 
@@ -155,20 +160,20 @@ static void test_input(struct upipe *upipe, struct uref *uref,
     upipe_dbg(upipe, "===> received input uref");
     uref_dump(uref, upipe->uprobe);
 
-    static uint64_t systime = 0;
     uint64_t cr_sys;
     uref_clock_get_cr_sys(uref, &cr_sys);
-    assert(cr_sys == systime);
+    assert(cr_sys == msrc_systime);
 
     int size = -1;
     const uint8_t *buf;
     ubase_assert(uref_block_read(uref, 0, &size, &buf));
     assert(size == sizeof(uint64_t));
     cr_sys = upipe_genaux_ntoh64(buf);
-    assert(cr_sys == systime);
+    assert(cr_sys == msrc_systime);
     ubase_assert(uref_block_unmap(uref, 0));
     uref_free(uref);
-    systime += rotate/UREF_PER_SLICE;
+    msrc_systime += rotate/UREF_PER_SLICE;
+    msrc_count++;
 }
 
 /** helper phony pipe */
@@ -215,7 +220,7 @@ int main(int argc, char *argv[])
 
     signal (SIGINT, sig_handler);
 
-    while ((opt = getopt(argc, argv, "r:O:")) != -1) {
+    while ((opt = getopt(argc, argv, "r:O:p:b:i:")) != -1) {
         switch (opt) {
             case 'r':
                 rotate = strtoull(optarg, NULL, 0);
@@ -223,6 +228,15 @@ int main(int argc, char *argv[])
             case 'O':
                 gen_systime = rotate_offset = strtoull(optarg, NULL, 0);
                 break;
+            case 'p':
+                prealloc = strtoull(optarg, NULL, 0);
+                break;
+            case 'b':
+                batch = strtoul(optarg, NULL, 0);
+                break;
+            case 'i':
+                index_stride = strtoul(optarg, NULL, 0);
+                break;
             default:
                 usage(argv[0]);
         }
@@ -288,6 +302,18 @@ int main(int argc, char *argv[])
         upipe_multicat_sink_get_rotate(multicat_sink, &rotate, &rotate_offset);
     }
     ubase_assert(upipe_multicat_sink_set_mode(multicat_sink, UPIPE_FSINK_OVERWRITE));
+    if (prealloc) {
+        uint64_t p;
+        ubase_assert(upipe_multicat_sink_set_prealloc(multicat_sink, prealloc));
+        ubase_assert(upipe_multicat_sink_get_prealloc(multicat_sink, &p));
+        assert(p == prealloc);
+    }
+    if (batch) {
+        unsigned int b;
+        ubase_assert(upipe_multicat_sink_set_batch(multicat_sink, batch));
+        ubase_assert(upipe_multicat_sink_get_batch(multicat_sink, &b));
+        assert(b == batch);
+    }
     ubase_assert(upipe_multicat_sink_set_path(multicat_sink, dirpath, suffix));
 
     // idler - packet generator
@@ -324,34 +350,54 @@ int main(int argc, char *argv[])
         close(fd);
     }
 
-    // check resulting files with msrc
+    // check resulting files with msrc, reading everything from the start,
+    // then seeking in the middle of a slice and reading until the end
+    const uint64_t positions[] = {
+        0,
+        rotate_offset + (SLICES_NUM / 2) * rotate + 3 * (rotate / UREF_PER_SLICE)
+    };
+    const uint64_t first_systimes[] = { rotate_offset, positions[1] };
+    const unsigned int counts[] = {
+        SLICES_NUM * UREF_PER_SLICE,
+        (SLICES_NUM - SLICES_NUM / 2) * UREF_PER_SLICE - 3
+    };
     struct upipe_mgr *upipe_msrc_mgr = upipe_msrc_mgr_alloc();
-    struct upipe *msrc = upipe_void_alloc(upipe_msrc_mgr,
-            uprobe_pfx_alloc(uprobe_use(logger), UPROBE_LOG_LEVEL,
-                             "multicat source"));
-    assert(msrc != NULL);
-    upipe_mgr_release(upipe_msrc_mgr);
-    flow = uref_alloc_control(uref_mgr);
-    assert(flow != NULL);
-    ubase_assert(uref_msrc_flow_set_path(flow, dirpath));
-    ubase_assert(uref_msrc_flow_set_data(flow, suffix));
-    ubase_assert(uref_msrc_flow_set_aux(flow, suffix));
-    ubase_assert(uref_msrc_flow_set_rotate(flow, rotate));
-    ubase_assert(uref_msrc_flow_set_offset(flow, rotate_offset));
-    ubase_assert(upipe_set_flow_def(msrc, flow));
-    uref_free(flow);
-    ubase_assert(upipe_set_output_size(msrc, sizeof(uint64_t)));
-
     struct upipe *test = upipe_void_alloc(&test_mgr, uprobe_use(logger));
     assert(test != NULL);
-    ubase_assert(upipe_set_output(msrc, test));
-
-    // fire !
-    ubase_assert(upipe_src_set_position(msrc, 0));
-    upump_mgr_run(upump_mgr, NULL);
+    for (i = 0; i < 2; i++) {
+        struct upipe *msrc = upipe_void_alloc(upipe_msrc_mgr,
+                uprobe_pfx_alloc(uprobe_use(logger), UPROBE_LOG_LEVEL,
+                                 "multicat source"));
+        assert(msrc != NULL);
+        flow = uref_alloc_control(uref_mgr);
+        assert(flow != NULL);
+        ubase_assert(uref_msrc_flow_set_path(flow, dirpath));
+        ubase_assert(uref_msrc_flow_set_data(flow, suffix));
+        ubase_assert(uref_msrc_flow_set_aux(flow, suffix));
+        ubase_assert(uref_msrc_flow_set_rotate(flow, rotate));
+        ubase_assert(uref_msrc_flow_set_offset(flow, rotate_offset));
+        ubase_assert(upipe_set_flow_def(msrc, flow));
+        uref_free(flow);
+        ubase_assert(upipe_set_output_size(msrc, sizeof(uint64_t)));
+        if (index_stride) {
+            unsigned int stride;
+            ubase_assert(upipe_msrc_set_index_stride(msrc, index_stride));
+            ubase_assert(upipe_msrc_get_index_stride(msrc, &stride));
+            assert(stride == index_stride);
+        }
+        ubase_assert(upipe_set_output(msrc, test));
+
+        // fire !
+        msrc_systime = first_systimes[i];
+        msrc_count = 0;
+        ubase_assert(upipe_src_set_position(msrc, positions[i]));
+        upump_mgr_run(upump_mgr, NULL);
+        assert(msrc_count == counts[i]);
+        upipe_release(msrc);
+    }
+    upipe_mgr_release(upipe_msrc_mgr);
 
     // release everything
-    upipe_release(msrc);
     test_free(test);
     upump_mgr_release(upump_mgr);
     uref_mgr_release(uref_mgr);
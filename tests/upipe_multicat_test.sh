@@ -9,3 +9,5 @@ cleanup() { rm -rf "$TMP"; }
 trap cleanup EXIT
 
 "$srcdir"/valgrind_wrapper.sh "$srcdir" ./upipe_multicat_test -r 270000000 -O 135000000 "$TMP"/ .bar
+rm -f "$TMP"/*
+"$srcdir"/valgrind_wrapper.sh "$srcdir" ./upipe_multicat_test -r 270000000 -O 135000000 -p 65536 -b 32 -i 4 "$TMP"/ .bar
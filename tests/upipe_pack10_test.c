@@ -197,9 +197,17 @@ int main(int argc, char *argv[])
     for (int i = 0; i < WIDTH; i++)
         pixels_buf[i] = i;
     uref_block_unmap(uref, 0);
+    struct uref *dup = uref_dup(uref);
+    assert(dup != NULL);
     upipe_input(upipe_pack10, uref, NULL);
     assert(received_block);
 
+    /* again, with ranges of samples processed by several threads */
+    received_block = false;
+    ubase_assert(upipe_pack10bit_set_threads(upipe_pack10, 3));
+    upipe_input(upipe_pack10, dup, NULL);
+    assert(received_block);
+
     upipe_release(upipe_pack10);
     upipe_mgr_release(upipe_pack10bit_mgr); // nop
 
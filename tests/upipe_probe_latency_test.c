@@ -0,0 +1,297 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short unit tests for latency stamp and meter pipes
+ */
+
+#undef NDEBUG
+
+#include <upipe/uprobe.h>
+#include <upipe/uprobe_stdio.h>
+#include <upipe/uprobe_prefix.h>
+#include <upipe/uprobe_uclock.h>
+#include <upipe/uclock.h>
+#include <upipe/umem.h>
+#include <upipe/umem_alloc.h>
+#include <upipe/udict.h>
+#include <upipe/udict_inline.h>
+#include <upipe/uref.h>
+#include <upipe/uref_flow.h>
+#include <upipe/uref_std.h>
+#include <upipe/upipe.h>
+#include <upipe-modules/upipe_probe_latency.h>
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <inttypes.h>
+#include <assert.h>
+
+#define UDICT_POOL_DEPTH 10
+#define UREF_POOL_DEPTH 10
+#define UPROBE_LOG_LEVEL UPROBE_LOG_DEBUG
+
+#define UREFNB      1000
+#define MISSINGNB   10
+
+static uint64_t date = UCLOCK_FREQ;
+static uint64_t expected_ingress = 0;
+static unsigned int pipe_counter = 0, report_counter = 0;
+static struct upipe_probe_latency_stats last_report;
+
+/** definition of our uprobe */
+static int catch(struct uprobe *uprobe, struct upipe *upipe,
+                 int event, va_list args)
+{
+    switch (event) {
+        default:
+            assert(0);
+            break;
+        case UPROBE_READY:
+        case UPROBE_DEAD:
+        case UPROBE_NEW_FLOW_DEF:
+            break;
+        case UPROBE_PROBE_LATENCY_REPORT: {
+            assert(va_arg(args, uint32_t) ==
+                   UPIPE_PROBE_LATENCY_METER_SIGNATURE);
+            last_report = *va_arg(args,
+                                  const struct upipe_probe_latency_stats *);
+            report_counter++;
+            break;
+        }
+    }
+    return UBASE_ERR_NONE;
+}
+
+/** helper uclock */
+static uint64_t now(struct uclock *unused)
+{
+    return date;
+}
+
+/** helper phony pipe */
+static struct upipe *test_alloc(struct upipe_mgr *mgr, struct uprobe *uprobe,
+                                uint32_t signature, va_list args)
+{
+    struct upipe *upipe = malloc(sizeof(struct upipe));
+    assert(upipe != NULL);
+    upipe_init(upipe, mgr, uprobe);
+    return upipe;
+}
+
+/** helper phony pipe */
+static void test_input(struct upipe *upipe, struct uref *uref,
+                       struct upump **upump_p)
+{
+    assert(uref != NULL);
+    if (expected_ingress) {
+        uint64_t ingress;
+        ubase_assert(uref_probe_latency_get_ingress(uref, &ingress));
+        assert(ingress == expected_ingress);
+    }
+    uref_free(uref);
+    pipe_counter++;
+}
+
+/** helper phony pipe */
+static int test_control(struct upipe *upipe, int command, va_list args)
+{
+    switch (command) {
+        case UPIPE_SET_FLOW_DEF:
+        case UPIPE_REGISTER_REQUEST:
+        case UPIPE_UNREGISTER_REQUEST:
+            return UBASE_ERR_NONE;
+        default:
+            assert(0);
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** helper phony pipe */
+static void test_free(struct upipe *upipe)
+{
+    upipe_clean(upipe);
+    free(upipe);
+}
+
+/** helper phony pipe */
+static struct upipe_mgr test_mgr = {
+    .refcount = NULL,
+    .upipe_alloc = test_alloc,
+    .upipe_input = test_input,
+    .upipe_control = test_control
+};
+
+/** checks that a quantile is within the precision of the histogram */
+static void check_quantile(uint64_t value, uint64_t expected)
+{
+    assert(value <= expected);
+    assert(value >= expected - expected / 32 - 1);
+}
+
+int main(int argc, char *argv[])
+{
+    struct umem_mgr *umem_mgr = umem_alloc_mgr_alloc();
+    assert(umem_mgr != NULL);
+    struct udict_mgr *udict_mgr = udict_inline_mgr_alloc(UDICT_POOL_DEPTH,
+                                                         umem_mgr, -1, -1);
+    assert(udict_mgr != NULL);
+    struct uref_mgr *uref_mgr = uref_std_mgr_alloc(UREF_POOL_DEPTH, udict_mgr,
+                                                   0);
+    assert(uref_mgr != NULL);
+    struct uprobe uprobe;
+    uprobe_init(&uprobe, catch, NULL);
+    struct uprobe *logger = uprobe_stdio_alloc(&uprobe, stdout,
+                                               UPROBE_LOG_LEVEL);
+    assert(logger != NULL);
+
+    struct uclock uclock;
+    uclock.refcount = NULL;
+    uclock.uclock_now = now;
+    logger = uprobe_uclock_alloc(logger, &uclock);
+    assert(logger != NULL);
+
+    struct upipe *upipe_sink = upipe_void_alloc(&test_mgr,
+                                                uprobe_use(logger));
+    assert(upipe_sink != NULL);
+
+    struct uref *flow_def = uref_alloc(uref_mgr);
+    assert(flow_def != NULL);
+    ubase_assert(uref_flow_set_def(flow_def, "internal."));
+
+    /* stamp */
+    struct upipe_mgr *upipe_probe_latency_stamp_mgr =
+        upipe_probe_latency_stamp_mgr_alloc();
+    assert(upipe_probe_latency_stamp_mgr != NULL);
+    struct upipe *upipe_stamp = upipe_void_alloc(upipe_probe_latency_stamp_mgr,
+            uprobe_pfx_alloc(uprobe_use(logger), UPROBE_LOG_LEVEL, "stamp"));
+    assert(upipe_stamp != NULL);
+    ubase_assert(upipe_set_flow_def(upipe_stamp, flow_def));
+    ubase_assert(upipe_set_output(upipe_stamp, upipe_sink));
+
+    struct uref *uref = uref_alloc(uref_mgr);
+    assert(uref != NULL);
+    expected_ingress = date;
+    upipe_input(upipe_stamp, uref, NULL);
+    assert(pipe_counter == 1);
+
+    /* an earlier stamp is kept */
+    uref = uref_alloc(uref_mgr);
+    assert(uref != NULL);
+    ubase_assert(uref_probe_latency_set_ingress(uref, 42));
+    expected_ingress = 42;
+    upipe_input(upipe_stamp, uref, NULL);
+    assert(pipe_counter == 2);
+    upipe_release(upipe_stamp);
+    expected_ingress = 0;
+
+    /* meter */
+    struct upipe_mgr *upipe_probe_latency_meter_mgr =
+        upipe_probe_latency_meter_mgr_alloc();
+    assert(upipe_probe_latency_meter_mgr != NULL);
+    struct upipe *upipe_meter = upipe_void_alloc(upipe_probe_latency_meter_mgr,
+            uprobe_pfx_alloc(uprobe_use(logger), UPROBE_LOG_LEVEL, "meter"));
+    assert(upipe_meter != NULL);
+    ubase_assert(upipe_set_flow_def(upipe_meter, flow_def));
+    ubase_assert(upipe_set_output(upipe_meter, upipe_sink));
+    uref_free(flow_def);
+
+    uint64_t interval;
+    ubase_assert(upipe_probe_latency_get_interval(upipe_meter, &interval));
+    assert(interval == UCLOCK_FREQ);
+
+    for (unsigned int i = 1; i <= UREFNB; i++) {
+        uref = uref_alloc(uref_mgr);
+        assert(uref != NULL);
+        ubase_assert(uref_probe_latency_set_ingress(uref, date - i * 100));
+        upipe_input(upipe_meter, uref, NULL);
+    }
+    for (unsigned int i = 0; i < MISSINGNB; i++) {
+        uref = uref_alloc(uref_mgr);
+        assert(uref != NULL);
+        upipe_input(upipe_meter, uref, NULL);
+    }
+    /* stamps in the future are accounted as no latency */
+    uref = uref_alloc(uref_mgr);
+    assert(uref != NULL);
+    ubase_assert(uref_probe_latency_set_ingress(uref, date + 1));
+    upipe_input(upipe_meter, uref, NULL);
+    assert(pipe_counter == 2 + UREFNB + MISSINGNB + 1);
+    assert(report_counter == 0);
+
+    struct upipe_probe_latency_stats stats;
+    ubase_assert(upipe_probe_latency_get_stats(upipe_meter, &stats));
+    assert(stats.count == UREFNB + 1);
+    assert(stats.missing == MISSINGNB);
+    assert(stats.min == 0);
+    assert(stats.max == UREFNB * 100);
+    check_quantile(stats.p50, 500 * 100);
+    check_quantile(stats.p90, 900 * 100);
+    check_quantile(stats.p99, 990 * 100);
+    check_quantile(stats.p999, 999 * 100);
+
+    /* the next uref after the interval closes the window */
+    date += UCLOCK_FREQ;
+    uref = uref_alloc(uref_mgr);
+    assert(uref != NULL);
+    ubase_assert(uref_probe_latency_set_ingress(uref, date - 1000));
+    upipe_input(upipe_meter, uref, NULL);
+    assert(report_counter == 1);
+    assert(last_report.duration == UCLOCK_FREQ);
+    assert(last_report.count == UREFNB + 1);
+    assert(last_report.missing == MISSINGNB);
+    assert(last_report.p50 == stats.p50);
+    assert(last_report.p999 == stats.p999);
+
+    ubase_assert(upipe_probe_latency_get_stats(upipe_meter, &stats));
+    assert(stats.count == 1);
+    assert(stats.min == 1000 && stats.max == 1000 && stats.mean == 1000);
+    assert(stats.p50 == 1000 && stats.p999 == 1000);
+
+    /* no periodic report */
+    ubase_assert(upipe_probe_latency_set_interval(upipe_meter, 0));
+    date += 10 * UCLOCK_FREQ;
+    uref = uref_alloc(uref_mgr);
+    assert(uref != NULL);
+    upipe_input(upipe_meter, uref, NULL);
+    assert(report_counter == 1);
+
+    /* the last window is reported on release */
+    upipe_release(upipe_meter);
+    assert(report_counter == 2);
+    assert(last_report.count == 1);
+    assert(last_report.missing == 1);
+
+    test_free(upipe_sink);
+
+    uref_mgr_release(uref_mgr);
+    udict_mgr_release(udict_mgr);
+    umem_mgr_release(umem_mgr);
+    uprobe_release(logger);
+    uprobe_clean(&uprobe);
+
+    return 0;
+}
@@ -204,6 +204,11 @@ int main(int argc, char *argv[])
                              "queue source"), QUEUE_LENGTH);
     assert(upipe_qsrc != NULL);
     ubase_assert(upipe_set_output(upipe_qsrc, upipe_sink));
+    unsigned int batch;
+    ubase_nassert(upipe_qsrc_set_batch(upipe_qsrc, 0));
+    ubase_assert(upipe_qsrc_set_batch(upipe_qsrc, 1));
+    ubase_assert(upipe_qsrc_get_batch(upipe_qsrc, &batch));
+    assert(batch == 1);
 
     struct upipe_mgr *upipe_qsink_mgr = upipe_qsink_mgr_alloc();
     assert(upipe_qsink_mgr != NULL);
@@ -212,6 +217,28 @@ int main(int argc, char *argv[])
                              "queue sink"),
             upipe_qsrc);
     assert(upipe_qsink != NULL);
+    unsigned int spin;
+    ubase_assert(upipe_qsink_set_spin(upipe_qsink, 16));
+    ubase_assert(upipe_qsink_get_spin(upipe_qsink, &spin));
+    assert(spin == 16);
+    unsigned int high, low;
+    ubase_assert(upipe_qsink_get_watermarks(upipe_qsink, &high, &low));
+    assert(high == QUEUE_LENGTH);
+    assert(low == QUEUE_LENGTH - 1);
+    ubase_nassert(upipe_qsink_set_watermarks(upipe_qsink, QUEUE_LENGTH + 1,
+                                             2));
+    ubase_nassert(upipe_qsink_set_watermarks(upipe_qsink, 4, 4));
+    ubase_assert(upipe_qsink_set_watermarks(upipe_qsink, 4, 2));
+    ubase_assert(upipe_qsink_get_watermarks(upipe_qsink, &high, &low));
+    assert(high == 4);
+    assert(low == 2);
+    ubase_assert(upipe_qsink_get_byte_watermarks(upipe_qsink, &high, &low));
+    assert(high == 0);
+    ubase_nassert(upipe_qsink_set_byte_watermarks(upipe_qsink, 1024, 1024));
+    ubase_assert(upipe_qsink_set_byte_watermarks(upipe_qsink, 1024, 512));
+    ubase_assert(upipe_qsink_get_byte_watermarks(upipe_qsink, &high, &low));
+    assert(high == 1024);
+    assert(low == 512);
     ubase_assert(upipe_set_flow_def(upipe_qsink, uref));
     uref_free(uref);
 
@@ -228,6 +255,10 @@ int main(int argc, char *argv[])
     unsigned int length;
     ubase_assert(upipe_qsrc_get_length(upipe_qsrc, &length));
     assert(length == 3);
+    unsigned int bytes;
+    ubase_assert(upipe_qsink_get_fill(upipe_qsink, &length, &bytes));
+    assert(length == 3);
+    assert(bytes == 0);
 
     urequest_init_uref_mgr(&request, provide_request, NULL);
     upipe_register_request(upipe_qsink, &request);
@@ -0,0 +1,239 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short unit tests for rate limit pipe
+ */
+
+#undef NDEBUG
+
+#include <upipe/uclock.h>
+#include <upipe/uclock_std.h>
+#include <upipe/uprobe.h>
+#include <upipe/uprobe_stdio.h>
+#include <upipe/uprobe_prefix.h>
+#include <upipe/uprobe_uclock.h>
+#include <upipe/uprobe_upump_mgr.h>
+#include <upipe/umem.h>
+#include <upipe/umem_alloc.h>
+#include <upipe/udict.h>
+#include <upipe/udict_inline.h>
+#include <upipe/ubuf.h>
+#include <upipe/ubuf_block_mem.h>
+#include <upipe/uref.h>
+#include <upipe/uref_flow.h>
+#include <upipe/uref_block.h>
+#include <upipe/uref_block_flow.h>
+#include <upipe/uref_std.h>
+#include <upipe/upump.h>
+#include <upump-ev/upump_ev.h>
+#include <upipe/upipe.h>
+#include <upipe-modules/upipe_rate_limit.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+
+#define UDICT_POOL_DEPTH    0
+#define UREF_POOL_DEPTH     0
+#define UBUF_POOL_DEPTH     0
+#define UPUMP_POOL          0
+#define UPUMP_BLOCKER_POOL  0
+#define UPROBE_LOG_LEVEL    UPROBE_LOG_DEBUG
+#define NB_BLOCKS           20
+#define BLOCK_SIZE          1000
+/** rate limit, one block every 10 ms */
+#define RATE                (BLOCK_SIZE * 100)
+/** bucket depth, two blocks may be sent at once */
+#define BUCKET              (2 * BLOCK_SIZE)
+#define TOLERANCE           (UCLOCK_FREQ / 1000)
+
+static struct uclock *uclock;
+static uint64_t start;
+static unsigned int nb_received = 0;
+
+/** definition of our uprobe */
+static int catch(struct uprobe *uprobe, struct upipe *upipe, int event, va_list args)
+{
+    switch (event) {
+        default:
+            assert(0);
+            break;
+        case UPROBE_READY:
+        case UPROBE_DEAD:
+        case UPROBE_NEW_FLOW_DEF:
+            break;
+    }
+    return UBASE_ERR_NONE;
+}
+
+/** helper phony pipe */
+static struct upipe *test_alloc(struct upipe_mgr *mgr, struct uprobe *uprobe,
+                                uint32_t signature, va_list args)
+{
+    struct upipe *upipe = malloc(sizeof(struct upipe));
+    assert(upipe != NULL);
+    upipe_init(upipe, mgr, uprobe);
+    return upipe;
+}
+
+/** helper phony pipe */
+static void test_input(struct upipe *upipe, struct uref *uref,
+                       struct upump **upump_p)
+{
+    assert(uref != NULL);
+    /* block n needs the tokens of n + 1 blocks, the bucket starts full */
+    uint64_t now = uclock_now(uclock);
+    if (nb_received >= BUCKET / BLOCK_SIZE) {
+        uint64_t due = start + (uint64_t)(nb_received + 1 - BUCKET / BLOCK_SIZE) *
+                       BLOCK_SIZE * UCLOCK_FREQ / RATE;
+        assert(now + TOLERANCE >= due);
+    }
+    upipe_dbg_va(upipe, "received block %u after %"PRIu64" us", nb_received,
+                 (now - start) / (UCLOCK_FREQ / 1000000));
+    nb_received++;
+    uref_free(uref);
+}
+
+/** helper phony pipe */
+static int test_control(struct upipe *upipe, int command, va_list args)
+{
+    switch (command) {
+        case UPIPE_SET_FLOW_DEF:
+            return UBASE_ERR_NONE;
+        case UPIPE_REGISTER_REQUEST: {
+            struct urequest *urequest = va_arg(args, struct urequest *);
+            return upipe_throw_provide_request(upipe, urequest);
+        }
+        case UPIPE_UNREGISTER_REQUEST:
+            return UBASE_ERR_NONE;
+        default:
+            assert(0);
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** helper phony pipe */
+static void test_free(struct upipe *upipe)
+{
+    upipe_clean(upipe);
+    free(upipe);
+}
+
+/** helper phony pipe */
+static struct upipe_mgr rate_limit_test_mgr = {
+    .refcount = NULL,
+    .signature = 0,
+
+    .upipe_alloc = test_alloc,
+    .upipe_input = test_input,
+    .upipe_control = test_control
+};
+
+int main(int argc, char **argv)
+{
+    printf("Compiled %s %s - %s\n", __DATE__, __TIME__, __FILE__);
+
+    /* uref and mem management */
+    struct umem_mgr *umem_mgr = umem_alloc_mgr_alloc();
+    assert(umem_mgr != NULL);
+    struct udict_mgr *udict_mgr = udict_inline_mgr_alloc(UDICT_POOL_DEPTH, umem_mgr, -1, -1);
+    assert(udict_mgr != NULL);
+    struct uref_mgr *uref_mgr = uref_std_mgr_alloc(UREF_POOL_DEPTH, udict_mgr, 0);
+    assert(uref_mgr != NULL);
+    struct ubuf_mgr *ubuf_mgr = ubuf_block_mem_mgr_alloc(UBUF_POOL_DEPTH,
+            UBUF_POOL_DEPTH, umem_mgr, -1, -1, -1, 0);
+    assert(ubuf_mgr != NULL);
+    struct upump_mgr *upump_mgr = upump_ev_mgr_alloc_default(UPUMP_POOL,
+            UPUMP_BLOCKER_POOL);
+    assert(upump_mgr != NULL);
+    uclock = uclock_std_alloc(0);
+    assert(uclock);
+
+    /* uprobe stuff */
+    struct uprobe uprobe;
+    uprobe_init(&uprobe, catch, NULL);
+    struct uprobe *logger = uprobe_stdio_alloc(&uprobe, stdout,
+                                               UPROBE_LOG_DEBUG);
+    assert(logger != NULL);
+    logger = uprobe_upump_mgr_alloc(logger, upump_mgr);
+    assert(logger != NULL);
+    logger = uprobe_uclock_alloc(logger, uclock);
+    assert(logger != NULL);
+
+    struct uref *uref = uref_block_flow_alloc_def(uref_mgr, NULL);
+    assert(uref);
+
+    /* build rate_limit pipe */
+    struct upipe_mgr *upipe_rate_limit_mgr = upipe_rate_limit_mgr_alloc();
+    assert(upipe_rate_limit_mgr);
+    struct upipe *rate_limit = upipe_void_alloc(upipe_rate_limit_mgr,
+            uprobe_pfx_alloc(uprobe_use(logger), UPROBE_LOG_LEVEL,
+                             "rate_limit"));
+    assert(rate_limit);
+    ubase_assert(upipe_set_flow_def(rate_limit, uref));
+    uref_free(uref);
+
+    uint64_t value;
+    ubase_assert(upipe_rate_limit_get_bucket(rate_limit, &value));
+    assert(value == 0);
+    ubase_assert(upipe_rate_limit_set_limit(rate_limit, RATE));
+    ubase_assert(upipe_rate_limit_set_bucket(rate_limit, BUCKET));
+    ubase_assert(upipe_rate_limit_get_bucket(rate_limit, &value));
+    assert(value == BUCKET);
+    ubase_nassert(upipe_rate_limit_set_bucket(rate_limit, UINT64_MAX));
+
+    struct upipe *rate_limit_test = upipe_void_alloc(&rate_limit_test_mgr,
+                                                     uprobe_use(logger));
+    assert(rate_limit_test != NULL);
+    ubase_assert(upipe_set_output(rate_limit, rate_limit_test));
+
+    start = uclock_now(uclock);
+    for (int i = 0; i < NB_BLOCKS; i++) {
+        uref = uref_block_alloc(uref_mgr, ubuf_mgr, BLOCK_SIZE);
+        assert(uref);
+        upipe_input(rate_limit, uref, NULL);
+    }
+    /* the bucket allows a burst of two blocks */
+    assert(nb_received == BUCKET / BLOCK_SIZE);
+
+    upump_mgr_run(upump_mgr, NULL);
+    assert(nb_received == NB_BLOCKS);
+
+    upipe_release(rate_limit);
+    test_free(rate_limit_test);
+
+    /* release managers */
+    ubuf_mgr_release(ubuf_mgr);
+    uref_mgr_release(uref_mgr);
+    umem_mgr_release(umem_mgr);
+    udict_mgr_release(udict_mgr);
+    upump_mgr_release(upump_mgr);
+    uclock_release(uclock);
+    uprobe_release(logger);
+    uprobe_clean(&uprobe);
+
+    return 0;
+}
@@ -8,3 +8,4 @@ cleanup() { rm -rf "$TMP"; }
 trap cleanup EXIT
 
 "$srcdir"/valgrind_wrapper.sh "$srcdir" ./upipe_seq_src_test Makefile
+"$srcdir"/valgrind_wrapper.sh "$srcdir" ./upipe_seq_src_test -p 8192 Makefile
@@ -95,6 +95,10 @@ static void test_input(struct upipe *upipe, struct uref *uref,
     uint64_t num;
     ubase_assert(uref_test_get_2(uref, &num));
     assert(num == 42);
+    if (nb_packets == 2) {
+        ubase_assert(uref_flow_get_id(uref, &num));
+        assert(num == 2);
+    }
     uref_free(uref);
     nb_packets++;
 }
@@ -175,7 +179,14 @@ int main(int argc, char *argv[])
     assert(uref != NULL);
     upipe_input(upipe_setattr, uref, NULL);
 
-    assert(nb_packets == 2);
+    /* existing attributes are overwritten, not replaced */
+    uref = uref_alloc(uref_mgr);
+    assert(uref != NULL);
+    ubase_assert(uref_test_set_2(uref, 12));
+    ubase_assert(uref_flow_set_id(uref, 2));
+    upipe_input(upipe_setattr, uref, NULL);
+
+    assert(nb_packets == 3);
 
     upipe_release(upipe_setattr);
     upipe_mgr_release(upipe_setattr_mgr); // nop
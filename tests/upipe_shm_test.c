@@ -0,0 +1,343 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short unit tests for shm sink and source pipes
+ */
+
+#undef NDEBUG
+
+#include <upipe/uprobe.h>
+#include <upipe/uprobe_stdio.h>
+#include <upipe/uprobe_prefix.h>
+#include <upipe/uprobe_uref_mgr.h>
+#include <upipe/uprobe_upump_mgr.h>
+#include <upipe/uclock.h>
+#include <upipe/umem.h>
+#include <upipe/umem_alloc.h>
+#include <upipe/udict.h>
+#include <upipe/udict_inline.h>
+#include <upipe/ubuf.h>
+#include <upipe/ubuf_block.h>
+#include <upipe/ubuf_block_mem.h>
+#include <upipe/uref.h>
+#include <upipe/uref_block.h>
+#include <upipe/uref_flow.h>
+#include <upipe/uref_clock.h>
+#include <upipe/uref_block_flow.h>
+#include <upipe/uref_std.h>
+#include <upipe/upump.h>
+#include <upump-ev/upump_ev.h>
+#include <upipe/upipe.h>
+#include <upipe-modules/upipe_shm_sink.h>
+#include <upipe-modules/upipe_shm_source.h>
+#include <upipe/upipe_helper_upipe.h>
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <inttypes.h>
+#include <assert.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+#define UDICT_POOL_DEPTH 0
+#define UREF_POOL_DEPTH 0
+#define UBUF_POOL_DEPTH 0
+#define UPUMP_POOL 0
+#define UPUMP_BLOCKER_POOL 0
+#define UPROBE_LOG_LEVEL UPROBE_LOG_DEBUG
+#define NB_SLOTS 5
+#define SLOT_SIZE 4096
+#define NB_UREFS 16
+#define BUF_SIZE 256
+#define FORMAT "This is packet number %d"
+
+static char name[64];
+static struct uref_mgr *uref_mgr;
+static struct ubuf_mgr *ubuf_mgr;
+static struct ubuf_mgr *shm_ubuf_mgr = NULL;
+static struct uprobe *logger;
+static struct upipe *upipe_shmsink;
+static struct upipe *upipe_shmsrc;
+static struct upump *attach_pump;
+static bool flow_def_received = false;
+static int counter = 0;
+
+/** definition of our uprobe */
+static int catch(struct uprobe *uprobe, struct upipe *upipe,
+                 int event, va_list args)
+{
+    switch (event) {
+        default:
+            assert(0);
+            break;
+        case UPROBE_READY:
+        case UPROBE_DEAD:
+        case UPROBE_NEW_FLOW_DEF:
+        case UPROBE_SOURCE_END:
+            break;
+    }
+    return UBASE_ERR_NONE;
+}
+
+/** helper phony pipe */
+static struct upipe *test_alloc(struct upipe_mgr *mgr, struct uprobe *uprobe,
+                                uint32_t signature, va_list args)
+{
+    struct upipe *upipe = malloc(sizeof(struct upipe));
+    assert(upipe != NULL);
+    upipe_init(upipe, mgr, uprobe);
+    upipe_throw_ready(upipe);
+    return upipe;
+}
+
+/** helper phony pipe */
+static void test_input(struct upipe *upipe, struct uref *uref,
+                       struct upump **upump_p)
+{
+    uint8_t buf[BUF_SIZE], str[BUF_SIZE];
+    const uint8_t *rbuf;
+    assert(flow_def_received);
+
+    size_t size;
+    ubase_assert(uref_block_size(uref, &size));
+    assert(size == BUF_SIZE);
+    rbuf = uref_block_peek(uref, 0, -1, buf);
+    assert(rbuf != NULL);
+    upipe_dbg_va(upipe, "received string: %s", rbuf);
+    snprintf((char *)str, sizeof(str), FORMAT, counter);
+    assert(strncmp((char *)str, (char *)rbuf, BUF_SIZE) == 0);
+    uref_block_peek_unmap(uref, 0, buf, rbuf);
+
+    uint64_t date, header_size;
+    ubase_assert(uref_clock_get_pts_prog(uref, &date));
+    assert(date == counter * UCLOCK_FREQ);
+    ubase_assert(uref_clock_get_cr_sys(uref, &date));
+    assert(date == counter);
+    ubase_assert(uref_block_get_header_size(uref, &header_size));
+    assert(header_size == counter);
+    assert(ubase_check(uref_flow_get_random(uref)) == !(counter % 2));
+    assert(ubase_check(uref_flow_get_error(uref)) == !(counter % 3));
+    uref_free(uref);
+
+    if (++counter == NB_UREFS) {
+        ubase_assert(upipe_set_uri(upipe_shmsrc, NULL));
+        ubase_assert(upipe_set_uri(upipe_shmsink, NULL));
+    }
+}
+
+/** helper phony pipe */
+static int test_control(struct upipe *upipe, int command, va_list args)
+{
+    switch (command) {
+        case UPIPE_SET_FLOW_DEF: {
+            struct uref *flow_def = va_arg(args, struct uref *);
+            ubase_assert(uref_flow_match_def(flow_def, "block.test."));
+            flow_def_received = true;
+            return UBASE_ERR_NONE;
+        }
+        case UPIPE_REGISTER_REQUEST: {
+            struct urequest *urequest = va_arg(args, struct urequest *);
+            return upipe_throw_provide_request(upipe, urequest);
+        }
+        case UPIPE_UNREGISTER_REQUEST:
+            return UBASE_ERR_NONE;
+        default:
+            assert(0);
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** helper phony pipe */
+static void test_free(struct upipe *upipe)
+{
+    upipe_throw_dead(upipe);
+    upipe_clean(upipe);
+    free(upipe);
+}
+
+/** helper phony pipe */
+static struct upipe_mgr test_mgr = {
+    .refcount = NULL,
+    .signature = 0,
+    .upipe_alloc = test_alloc,
+    .upipe_input = test_input,
+    .upipe_control = test_control
+};
+
+/** ubuf manager provided by the sink */
+static int provide_ubuf_mgr(struct urequest *urequest, va_list args)
+{
+    struct ubuf_mgr *m = va_arg(args, struct ubuf_mgr *);
+    struct uref *flow_format = va_arg(args, struct uref *);
+    uref_free(flow_format);
+    ubuf_mgr_release(shm_ubuf_mgr);
+    shm_ubuf_mgr = m;
+    return UBASE_ERR_NONE;
+}
+
+/** sends a numbered uref to the sink */
+static void send_uref(int i)
+{
+    uint8_t *buf;
+    int size = -1;
+    struct uref *uref = uref_block_alloc(uref_mgr,
+                                         i % 2 ? ubuf_mgr : shm_ubuf_mgr,
+                                         BUF_SIZE);
+    assert(uref != NULL);
+    ubase_assert(uref_block_write(uref, 0, &size, &buf));
+    assert(size == BUF_SIZE);
+    memset(buf, 0, size);
+    snprintf((char *)buf, BUF_SIZE, FORMAT, i);
+    uref_block_unmap(uref, 0);
+    uref_clock_set_pts_prog(uref, i * UCLOCK_FREQ);
+    uref_clock_set_cr_sys(uref, i);
+    ubase_assert(uref_block_set_header_size(uref, i));
+    if (!(i % 2))
+        uref_flow_set_random(uref);
+    if (!(i % 3))
+        ubase_assert(uref_flow_set_error(uref));
+    upipe_input(upipe_shmsink, uref, NULL);
+}
+
+/** attaches the source once the sink has reclaimed the crashed one */
+static void attach(struct upump *upump)
+{
+    if (!ubase_check(upipe_set_uri(upipe_shmsrc, name)))
+        return;
+    upump_stop(upump);
+    for (int i = 0; i < NB_UREFS; i++)
+        send_uref(i);
+}
+
+int main(int argc, char *argv[])
+{
+    snprintf(name, sizeof(name), "/upipe_shm_test.%d", getpid());
+
+    /* env */
+    struct umem_mgr *umem_mgr = umem_alloc_mgr_alloc();
+    assert(umem_mgr != NULL);
+    struct udict_mgr *udict_mgr = udict_inline_mgr_alloc(UDICT_POOL_DEPTH,
+                                                         umem_mgr, -1, -1);
+    assert(udict_mgr != NULL);
+    uref_mgr = uref_std_mgr_alloc(UREF_POOL_DEPTH, udict_mgr, 0);
+    assert(uref_mgr != NULL);
+    ubuf_mgr = ubuf_block_mem_mgr_alloc(UBUF_POOL_DEPTH, UBUF_POOL_DEPTH,
+                                        umem_mgr, 0, 0, -1, 0);
+    assert(ubuf_mgr != NULL);
+    struct upump_mgr *upump_mgr = upump_ev_mgr_alloc_default(UPUMP_POOL,
+            UPUMP_BLOCKER_POOL);
+    assert(upump_mgr != NULL);
+    struct uprobe uprobe;
+    uprobe_init(&uprobe, catch, NULL);
+    logger = uprobe_stdio_alloc(&uprobe, stdout, UPROBE_LOG_LEVEL);
+    assert(logger != NULL);
+    logger = uprobe_uref_mgr_alloc(logger, uref_mgr);
+    assert(logger != NULL);
+    logger = uprobe_upump_mgr_alloc(logger, upump_mgr);
+    assert(logger != NULL);
+
+    struct upipe *test = upipe_void_alloc(&test_mgr,
+            uprobe_pfx_alloc(uprobe_use(logger), UPROBE_LOG_LEVEL, "test"));
+    assert(test != NULL);
+
+    /* shm sink */
+    struct upipe_mgr *upipe_shmsink_mgr = upipe_shmsink_mgr_alloc();
+    assert(upipe_shmsink_mgr != NULL);
+    upipe_shmsink = upipe_void_alloc(upipe_shmsink_mgr,
+            uprobe_pfx_alloc(uprobe_use(logger), UPROBE_LOG_LEVEL,
+                             "shm sink"));
+    assert(upipe_shmsink != NULL);
+    ubase_nassert(upipe_shmsink_set_slots(upipe_shmsink, 0, SLOT_SIZE));
+    ubase_assert(upipe_shmsink_set_slots(upipe_shmsink, NB_SLOTS, SLOT_SIZE));
+    ubase_assert(upipe_shmsink_set_period(upipe_shmsink, UCLOCK_FREQ / 100));
+    ubase_assert(upipe_attach_upump_mgr(upipe_shmsink));
+    ubase_assert(upipe_set_uri(upipe_shmsink, name));
+
+    struct uref *flow_def = uref_block_flow_alloc_def(uref_mgr, "test.");
+    assert(flow_def != NULL);
+    ubase_assert(upipe_set_flow_def(upipe_shmsink, flow_def));
+
+    struct urequest request;
+    urequest_init_ubuf_mgr(&request, flow_def, provide_ubuf_mgr, NULL);
+    ubase_assert(upipe_register_request(upipe_shmsink, &request));
+    assert(shm_ubuf_mgr != NULL);
+    ubase_assert(upipe_unregister_request(upipe_shmsink, &request));
+    urequest_clean(&request);
+
+    /* a source attaches and crashes */
+    pid_t pid = fork();
+    assert(pid != -1);
+    if (!pid) {
+        struct upipe *upipe = upipe_void_alloc(upipe_shmsrc_mgr_alloc(),
+                uprobe_pfx_alloc(uprobe_use(logger), UPROBE_LOG_LEVEL,
+                                 "crashed shm source"));
+        assert(upipe != NULL);
+        ubase_assert(upipe_set_uri(upipe, name));
+        _exit(EXIT_SUCCESS);
+    }
+    int status;
+    assert(waitpid(pid, &status, 0) == pid);
+    assert(WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS);
+    /* sent to the crashed source, and reclaimed */
+    send_uref(-1);
+
+    /* shm source */
+    struct upipe_mgr *upipe_shmsrc_mgr = upipe_shmsrc_mgr_alloc();
+    assert(upipe_shmsrc_mgr != NULL);
+    upipe_shmsrc = upipe_void_alloc(upipe_shmsrc_mgr,
+            uprobe_pfx_alloc(uprobe_use(logger), UPROBE_LOG_LEVEL,
+                             "shm source"));
+    assert(upipe_shmsrc != NULL);
+    ubase_assert(upipe_shmsrc_set_period(upipe_shmsrc, UCLOCK_FREQ / 1000));
+    ubase_assert(upipe_set_output(upipe_shmsrc, test));
+
+    attach_pump = upump_alloc_timer(upump_mgr, attach, NULL, NULL,
+                                    UCLOCK_FREQ / 100, UCLOCK_FREQ / 100);
+    assert(attach_pump != NULL);
+    upump_start(attach_pump);
+
+    upump_mgr_run(upump_mgr, NULL);
+    assert(counter == NB_UREFS);
+
+    upump_free(attach_pump);
+    upipe_release(upipe_shmsrc);
+    upipe_release(upipe_shmsink);
+    test_free(test);
+
+    ubuf_mgr_release(shm_ubuf_mgr);
+    upump_mgr_release(upump_mgr);
+    uref_mgr_release(uref_mgr);
+    ubuf_mgr_release(ubuf_mgr);
+    udict_mgr_release(udict_mgr);
+    umem_mgr_release(umem_mgr);
+    uprobe_release(logger);
+    uprobe_clean(&uprobe);
+
+    return 0;
+}
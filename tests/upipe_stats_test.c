@@ -0,0 +1,174 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/** @file
+ * @short unit tests for the instrumentation of pipes
+ */
+
+#undef NDEBUG
+
+#include <upipe/uprobe.h>
+#include <upipe/umem.h>
+#include <upipe/umem_alloc.h>
+#include <upipe/udict.h>
+#include <upipe/udict_inline.h>
+#include <upipe/uref.h>
+#include <upipe/uref_std.h>
+#include <upipe/uref_block.h>
+#include <upipe/ubuf.h>
+#include <upipe/ubuf_block_mem.h>
+#include <upipe/upipe.h>
+#include <upipe/upipe_stats.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <assert.h>
+
+#define UDICT_POOL_DEPTH 0
+#define UREF_POOL_DEPTH 0
+#define UBUF_POOL_DEPTH 0
+
+/** helper phony pipe */
+static struct upipe *test_alloc(struct upipe_mgr *mgr, struct uprobe *uprobe,
+                                uint32_t signature, va_list args)
+{
+    struct upipe *upipe = malloc(sizeof(struct upipe));
+    assert(upipe != NULL);
+    upipe_init(upipe, mgr, uprobe);
+    return upipe;
+}
+
+/** helper phony pipe */
+static void test_input(struct upipe *upipe, struct uref *uref,
+                       struct upump **upump_p)
+{
+    uref_free(uref);
+}
+
+/** helper phony pipe */
+static int test_control(struct upipe *upipe, int command, va_list args)
+{
+    if (command == UPIPE_FLUSH)
+        return UBASE_ERR_NONE;
+    return UBASE_ERR_UNHANDLED;
+}
+
+/** helper phony pipe */
+static void test_free(struct upipe *upipe)
+{
+    upipe_clean(upipe);
+    free(upipe);
+}
+
+/** helper phony pipe */
+static struct upipe_mgr test_mgr = {
+    .refcount = NULL,
+    .upipe_alloc = test_alloc,
+    .upipe_input = test_input,
+    .upipe_control = test_control
+};
+
+int main(int argc, char **argv)
+{
+    struct umem_mgr *umem_mgr = umem_alloc_mgr_alloc();
+    assert(umem_mgr != NULL);
+    struct udict_mgr *udict_mgr = udict_inline_mgr_alloc(UDICT_POOL_DEPTH,
+                                                         umem_mgr, -1, -1);
+    assert(udict_mgr != NULL);
+    struct uref_mgr *uref_mgr = uref_std_mgr_alloc(UREF_POOL_DEPTH,
+                                                   udict_mgr, 0);
+    assert(uref_mgr != NULL);
+    struct ubuf_mgr *ubuf_mgr = ubuf_block_mem_mgr_alloc(UBUF_POOL_DEPTH,
+                                                         UBUF_POOL_DEPTH,
+                                                         umem_mgr,
+                                                         0, 0, -1, 0);
+    assert(ubuf_mgr != NULL);
+
+    struct upipe_stats stats;
+    struct upipe *upipe = upipe_void_alloc(&test_mgr, NULL);
+    assert(upipe != NULL);
+    assert(upipe->stats == NULL);
+    ubase_nassert(upipe_get_stats(upipe, &stats));
+
+    ubase_assert(upipe_stats_enable(upipe));
+    assert(upipe->stats != NULL);
+    for (int i = 0; i < 3; i++) {
+        struct uref *uref = uref_block_alloc(uref_mgr, ubuf_mgr, 100);
+        assert(uref != NULL);
+        upipe_input(upipe, uref, NULL);
+    }
+    upipe_input(upipe, uref_alloc_control(uref_mgr), NULL);
+    ubase_assert(upipe_flush(upipe));
+
+    ubase_assert(upipe_get_stats(upipe, &stats));
+    assert(stats.urefs_in == 4);
+    assert(stats.bytes_in == 300);
+    assert(stats.urefs_out == 0);
+    assert(stats.bytes_out == 0);
+    assert(stats.controls == 1);
+    assert(stats.input_max <= stats.input_time);
+
+    upipe_stats_disable(upipe);
+    assert(upipe->stats == NULL);
+    ubase_nassert(upipe_get_stats(upipe, &stats));
+    test_free(upipe);
+
+    upipe_stats_set_global(true);
+    upipe = upipe_void_alloc(&test_mgr, NULL);
+    assert(upipe != NULL);
+    assert(upipe->stats != NULL);
+    upipe_stats_set_global(false);
+
+    /* allocations through the wrapped ubuf manager */
+    struct ubuf_mgr *wrapper =
+        upipe_stats_wrap_ubuf_mgr(upipe, ubuf_mgr_use(ubuf_mgr));
+    assert(wrapper != NULL && wrapper != ubuf_mgr);
+    assert(ubuf_mgr_unwrap(wrapper) == ubuf_mgr);
+    assert(ubuf_mgr_unwrap(ubuf_mgr) == ubuf_mgr);
+    struct ubuf *ubuf = ubuf_block_alloc(wrapper, 100);
+    assert(ubuf != NULL);
+    assert(ubuf->mgr == ubuf_mgr);
+    ubuf_free(ubuf);
+    ubuf = ubuf_block_alloc(wrapper, 50);
+    assert(ubuf != NULL);
+    ubuf_free(ubuf);
+    ubase_assert(upipe_get_stats(upipe, &stats));
+    assert(stats.ubufs_alloc == 2);
+    assert(stats.ubuf_bytes_alloc == 150);
+    test_free(upipe);
+
+    /* the wrapper keeps the counters alive */
+    ubuf = ubuf_block_alloc(wrapper, 10);
+    assert(ubuf != NULL);
+    ubuf_free(ubuf);
+    ubuf_mgr_release(wrapper);
+
+    ubuf_mgr_release(ubuf_mgr);
+    uref_mgr_release(uref_mgr);
+    udict_mgr_release(udict_mgr);
+    umem_mgr_release(umem_mgr);
+    return 0;
+}
@@ -424,6 +424,16 @@ int main(int argc, char **argv)
     assert(compare_chroma(((struct uref*[]){uref2, sws_test_from_upipe(sws_test)->pic}), "u8", 2, 2, 1, logger));
     assert(compare_chroma(((struct uref*[]){uref2, sws_test_from_upipe(sws_test)->pic}), "v8", 2, 2, 1, logger));
 
+    /* scale in bands on several threads */
+    ubase_assert(upipe_sws_set_threads(sws, 4));
+    pic = uref_dup(uref1);
+    upipe_input(sws, pic, NULL);
+
+    assert(sws_test_from_upipe(sws_test)->pic);
+    assert(compare_chroma(((struct uref*[]){uref2, sws_test_from_upipe(sws_test)->pic}), "y8", 1, 1, 1, logger));
+    assert(compare_chroma(((struct uref*[]){uref2, sws_test_from_upipe(sws_test)->pic}), "u8", 2, 2, 1, logger));
+    assert(compare_chroma(((struct uref*[]){uref2, sws_test_from_upipe(sws_test)->pic}), "v8", 2, 2, 1, logger));
+
     /* release urefs */
     uref_free(uref1);
     uref_free(uref2);
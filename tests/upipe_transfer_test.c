@@ -189,9 +189,13 @@ int main(int argc, char **argv)
             upipe_test);
     /* from now on upipe_test shouldn't be accessed from this thread */
     assert(upipe_handle != NULL);
+    /* the three commands are pushed at once */
+    ubase_assert(upipe_xfer_mgr_batch_begin(upipe_xfer_mgr));
     ubase_assert(upipe_attach_upump_mgr(upipe_handle));
     ubase_assert(upipe_set_uri(upipe_handle, "toto"));
     upipe_release(upipe_handle);
+    ubase_assert(upipe_xfer_mgr_batch_end(upipe_xfer_mgr));
+    ubase_nassert(upipe_xfer_mgr_batch_end(upipe_xfer_mgr));
 
     upipe_mgr_release(upipe_xfer_mgr);
 
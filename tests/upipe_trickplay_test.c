@@ -58,6 +58,7 @@
 static unsigned int count_pic = 0;
 static unsigned int count_sound = 0;
 static unsigned int count_subpic = 0;
+static uint64_t seek_position = UINT64_MAX;
 
 /** definition of our uprobe */
 static int catch(struct uprobe *uprobe, struct upipe *upipe,
@@ -72,6 +73,11 @@ static int catch(struct uprobe *uprobe, struct upipe *upipe,
         case UPROBE_NEW_FLOW_DEF:
         case UPROBE_SOURCE_END:
             break;
+        case UPROBE_TRICKP_SEEK: {
+            assert(va_arg(args, unsigned int) == UPIPE_TRICKP_SIGNATURE);
+            seek_position = va_arg(args, uint64_t);
+            break;
+        }
     }
     return UBASE_ERR_NONE;
 }
@@ -263,6 +269,84 @@ int main(int argc, char *argv[])
     assert(count_subpic == 0);
     count_pic = 0;
 
+    /* index-driven mode, with a random access point every 500 ms */
+    struct urational rate;
+    rate.num = -8;
+    rate.den = 1;
+    ubase_nassert(upipe_trickp_set_rate(upipe_trickp, rate));
+    ubase_assert(upipe_trickp_set_index_mode(upipe_trickp, true, false));
+    uint64_t origin = (uint64_t)UINT32_MAX + 3;
+    for (uint64_t i = 0; i < 20; i++)
+        ubase_assert(upipe_trickp_add_index(upipe_trickp,
+                    origin + i * UCLOCK_FREQ / 2, i));
+    rate.num = 8;
+    ubase_assert(upipe_trickp_set_rate(upipe_trickp, rate));
+
+    uref = uref_alloc(uref_mgr);
+    assert(uref != NULL);
+    uref_clock_set_pts_prog(uref, origin);
+    upipe_input(upipe_trickp_sound, uref, NULL);
+    uref = uref_alloc(uref_mgr);
+    assert(uref != NULL);
+    uref_clock_set_pts_prog(uref, origin);
+    upipe_input(upipe_trickp_pic, uref, NULL);
+    assert(count_pic == 0);
+    assert(count_sound == 0);
+    assert(seek_position == UINT64_MAX);
+
+    uref = uref_alloc(uref_mgr);
+    assert(uref != NULL);
+    uref_clock_set_pts_prog(uref, origin);
+    uref_flow_set_random(uref);
+    upipe_input(upipe_trickp_pic, uref, NULL);
+    assert(count_pic == 42);
+    assert(seek_position == 4);
+    count_pic = 0;
+
+    uref = uref_alloc(uref_mgr);
+    assert(uref != NULL);
+    uref_clock_set_pts_prog(uref, origin + UCLOCK_FREQ / 2);
+    uref_flow_set_random(uref);
+    upipe_input(upipe_trickp_pic, uref, NULL);
+    assert(count_pic == 0);
+
+    uref = uref_alloc(uref_mgr);
+    assert(uref != NULL);
+    uref_clock_set_pts_prog(uref, origin + 2 * UCLOCK_FREQ);
+    uref_flow_set_random(uref);
+    upipe_input(upipe_trickp_pic, uref, NULL);
+    assert(count_pic == 42 + UCLOCK_FREQ / 4);
+    assert(seek_position == 8);
+    count_pic = 0;
+
+    /* rewind */
+    rate.num = -8;
+    ubase_assert(upipe_trickp_set_rate(upipe_trickp, rate));
+    uref = uref_alloc(uref_mgr);
+    assert(uref != NULL);
+    uref_clock_set_pts_prog(uref, origin + 19 * UCLOCK_FREQ / 2);
+    uref_flow_set_random(uref);
+    upipe_input(upipe_trickp_pic, uref, NULL);
+    assert(count_pic == 42);
+    assert(seek_position == 15);
+    count_pic = 0;
+
+    uref = uref_alloc(uref_mgr);
+    assert(uref != NULL);
+    uref_clock_set_pts_prog(uref, origin + 16 * UCLOCK_FREQ / 2);
+    uref_flow_set_random(uref);
+    upipe_input(upipe_trickp_pic, uref, NULL);
+    assert(count_pic == 0);
+
+    uref = uref_alloc(uref_mgr);
+    assert(uref != NULL);
+    uref_clock_set_pts_prog(uref, origin + 15 * UCLOCK_FREQ / 2);
+    uref_flow_set_random(uref);
+    upipe_input(upipe_trickp_pic, uref, NULL);
+    assert(count_pic == 42 + UCLOCK_FREQ / 4);
+    assert(seek_position == 11);
+    count_pic = 0;
+
     upipe_release(upipe_trickp);
     upipe_release(upipe_trickp_pic);
     upipe_release(upipe_trickp_sound);
@@ -0,0 +1,922 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/** @file
+ * @short end-to-end throughput benchmark of the TS demux and mux
+ *
+ * A capture is loaded in memory, and played as fast as possible, without
+ * clock, through ts_demux, the framers, noclock/even and ts_mux into a null
+ * sink, like upipe_ts_test.sh does. The whole pipeline is allocated again
+ * for every pass over the capture, so that timestamps do not go backwards.
+ *
+ * Every topology prints one JSON object per line on stdout, with the members:
+ * @list
+ * @item bench: "ts", topology: "single" (everything in the main thread) or
+ * "worker" (source and sink in their own threads with @ref upipe_wsrc and
+ * @ref upipe_wsink, demux and mux in the main thread)
+ * @item passes, bytes, packets: amount of input data
+ * @item seconds: wall-clock duration, cpu_seconds: CPU time of the process
+ * @item mbps, packets_per_sec: input throughput
+ * @item bytes_out: size of the output of the mux
+ * @item stages: CPU seconds spent in demux, framers, glue (noclock, vtrim
+ * and even), mux, sink, remote_sink (the thread of the worker sink), and
+ * other (source, queues and event loops), computed from the counters of
+ * @ref upipe_stats
+ * @end list
+ *
+ * The instrumentation may be disabled with -S to measure the raw
+ * throughput, in which case bytes_out and stages are not printed.
+ */
+
+#undef NDEBUG
+
+#include <upipe/ubase.h>
+#include <upipe/uclock.h>
+#include <upipe/uprobe.h>
+#include <upipe/uprobe_stdio.h>
+#include <upipe/uprobe_prefix.h>
+#include <upipe/uprobe_uref_mgr.h>
+#include <upipe/uprobe_ubuf_mem_pool.h>
+#include <upipe/uprobe_transfer.h>
+#include <upipe/umem.h>
+#include <upipe/umem_pool.h>
+#include <upipe/udict.h>
+#include <upipe/udict_inline.h>
+#include <upipe/ubuf.h>
+#include <upipe/ubuf_block.h>
+#include <upipe/ubuf_block_mem.h>
+#include <upipe/uref.h>
+#include <upipe/uref_flow.h>
+#include <upipe/uref_block_flow.h>
+#include <upipe/uref_std.h>
+#include <upipe/upump.h>
+#include <upump-ev/upump_ev.h>
+#include <upipe/upipe.h>
+#include <upipe/upipe_stats.h>
+#include <upipe/upipe_helper_upipe.h>
+#include <upipe/upipe_helper_urefcount.h>
+#include <upipe/upipe_helper_void.h>
+#include <upipe/upipe_helper_output.h>
+#include <upipe/upipe_helper_upump_mgr.h>
+#include <upipe/upipe_helper_upump.h>
+#include <upipe/upipe_helper_uref_mgr.h>
+#include <upipe-pthread/uprobe_pthread_upump_mgr.h>
+#include <upipe-pthread/upipe_pthread_transfer.h>
+#include <upipe-ts/upipe_ts_demux.h>
+#include <upipe-ts/upipe_ts_mux.h>
+#include <upipe-framers/upipe_auto_framer.h>
+#include <upipe-framers/upipe_video_trim.h>
+#include <upipe-modules/upipe_noclock.h>
+#include <upipe-modules/upipe_even.h>
+#include <upipe-modules/upipe_null.h>
+#include <upipe-modules/upipe_worker.h>
+#include <upipe-modules/upipe_worker_source.h>
+#include <upipe-modules/upipe_worker_sink.h>
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <inttypes.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <assert.h>
+
+#define UMEM_POOL 128
+#define UDICT_POOL_DEPTH 500
+#define UREF_POOL_DEPTH 500
+#define UBUF_POOL_DEPTH 3000
+#define UBUF_SHARED_POOL_DEPTH 50
+#define UPUMP_POOL 5
+#define UPUMP_BLOCKER_POOL 5
+#define XFER_QUEUE 255
+#define XFER_POOL 20
+#define WSRC_QUEUE_LENGTH 255
+#define WSINK_QUEUE_LENGTH 255
+/** size of a TS packet */
+#define TS_SIZE 188
+/** default number of TS packets per buffer (the 4 KiB of upipe_ts_test) */
+#define BENCH_CHUNK 21
+/** default number of passes over the capture */
+#define BENCH_PASSES 10
+
+/** @This lists the topologies of the pipeline. */
+enum bench_topology {
+    /** everything in the main thread */
+    BENCH_SINGLE,
+    /** source and sink in worker threads */
+    BENCH_WORKER,
+
+    BENCH_TOPOLOGIES
+};
+
+/** names of the topologies */
+static const char *bench_topologies[BENCH_TOPOLOGIES] = {
+    "single", "worker"
+};
+
+/** @This lists the stages of the pipeline, in the order of the data. */
+enum bench_stage_id {
+    BENCH_DEMUX,
+    BENCH_FRAMERS,
+    BENCH_GLUE,
+    BENCH_MUX,
+    BENCH_SINK,
+    BENCH_REMOTE_SINK,
+
+    BENCH_STAGES
+};
+
+/** @This gathers the counters of the pipes of a stage. The time spent in
+ * the input of a pipe includes the time spent in the pipes it outputs to
+ * in the same thread, so the stage of a pipe is given by its probe, and
+ * only the pipe allocated by the benchmark at the head of the stage is
+ * accounted. */
+struct bench_stage {
+    /** probe given to the pipe at the head of the stage */
+    struct uprobe uprobe;
+    /** name of the stage */
+    const char *name;
+    /** signature of the manager of the head pipe, or 0 if unused */
+    uint32_t signature;
+    /** time spent in the input of the head pipes */
+    uint64_t input_time;
+    /** octets received by the head pipes */
+    uint64_t bytes_in;
+};
+
+static struct bench_stage stages[BENCH_STAGES] = {
+    [BENCH_DEMUX] = { .name = "demux" },
+    [BENCH_FRAMERS] = { .name = "framers" },
+    [BENCH_GLUE] = { .name = "glue" },
+    [BENCH_MUX] = { .name = "mux" },
+    [BENCH_SINK] = { .name = "sink" },
+    [BENCH_REMOTE_SINK] = { .name = "remote_sink" },
+};
+
+/** capture played by the memory source */
+static struct ubuf *capture = NULL;
+/** size of the capture */
+static size_t capture_size = 0;
+/** size of the buffers output by the memory source */
+static size_t chunk_size = BENCH_CHUNK * TS_SIZE;
+
+static enum uprobe_log_level log_level = UPROBE_LOG_ERROR;
+static struct uprobe *logger;
+static struct upump_mgr *upump_mgr;
+static struct upipe_mgr *upipe_autof_mgr;
+static struct upipe_mgr *upipe_noclock_mgr;
+static struct upipe_mgr *upipe_vtrim_mgr;
+static struct upipe *upipe_even;
+static struct upipe *source;
+
+static struct uprobe uprobe_src_s;
+static struct uprobe uprobe_ts_demux_s;
+static struct uprobe uprobe_demux_output_s;
+static struct uprobe uprobe_demux_program_s;
+
+/*
+ * memory source
+ */
+
+/** @internal @This is the private context of the memory source, which
+ * outputs the capture once in buffers of @ref chunk_size octets, without
+ * copying it. */
+struct memsrc {
+    struct upipe upipe;
+    struct urefcount urefcount;
+    struct upipe *output;
+    struct uref *flow_def;
+    enum upipe_helper_output_state output_state;
+    struct uchain requests;
+    struct upump_mgr *upump_mgr;
+    struct upump *upump;
+    struct uref_mgr *uref_mgr;
+    struct urequest uref_mgr_request;
+    /** offset of the next buffer in the capture */
+    size_t offset;
+};
+
+static int memsrc_check(struct upipe *upipe, struct uref *flow_def);
+
+UPIPE_HELPER_UPIPE(memsrc, upipe, 0);
+UPIPE_HELPER_UREFCOUNT(memsrc, urefcount, memsrc_free);
+UPIPE_HELPER_VOID(memsrc);
+UPIPE_HELPER_OUTPUT(memsrc, output, flow_def, output_state, requests);
+UPIPE_HELPER_UPUMP_MGR(memsrc, upump_mgr);
+UPIPE_HELPER_UPUMP(memsrc, upump, upump_mgr);
+UPIPE_HELPER_UREF_MGR(memsrc, uref_mgr, uref_mgr_request,
+                      memsrc_check,
+                      memsrc_register_output_request,
+                      memsrc_unregister_output_request);
+
+/** @internal @This allocates a memory source. */
+static struct upipe *memsrc_alloc(struct upipe_mgr *mgr,
+                                  struct uprobe *uprobe,
+                                  uint32_t signature,
+                                  va_list args)
+{
+    struct upipe *upipe = memsrc_alloc_void(mgr, uprobe, signature, args);
+    assert(upipe != NULL);
+
+    memsrc_init_urefcount(upipe);
+    memsrc_init_output(upipe);
+    memsrc_init_upump_mgr(upipe);
+    memsrc_init_upump(upipe);
+    memsrc_init_uref_mgr(upipe);
+
+    struct memsrc *memsrc = memsrc_from_upipe(upipe);
+    memsrc->offset = 0;
+
+    upipe_throw_ready(upipe);
+    return upipe;
+}
+
+/** @internal @This frees a memory source. */
+static void memsrc_free(struct upipe *upipe)
+{
+    upipe_throw_dead(upipe);
+
+    memsrc_clean_uref_mgr(upipe);
+    memsrc_clean_upump(upipe);
+    memsrc_clean_upump_mgr(upipe);
+    memsrc_clean_output(upipe);
+    memsrc_clean_urefcount(upipe);
+    memsrc_free_void(upipe);
+}
+
+/** @internal @This outputs the next buffer of the capture. */
+static void memsrc_idle(struct upump *upump)
+{
+    struct upipe *upipe = upump_get_opaque(upump, struct upipe *);
+    struct memsrc *memsrc = memsrc_from_upipe(upipe);
+
+    size_t size = capture_size - memsrc->offset;
+    if (size == 0) {
+        memsrc_set_upump(upipe, NULL);
+        upipe_throw_source_end(upipe);
+        return;
+    }
+    if (size > chunk_size)
+        size = chunk_size;
+
+    struct uref *uref = uref_alloc(memsrc->uref_mgr);
+    struct ubuf *ubuf = ubuf_block_splice(capture, memsrc->offset, size);
+    if (unlikely(uref == NULL || ubuf == NULL)) {
+        uref_free(uref);
+        ubuf_free(ubuf);
+        memsrc_set_upump(upipe, NULL);
+        upipe_throw_fatal(upipe, UBASE_ERR_ALLOC);
+        return;
+    }
+    uref_attach_ubuf(uref, ubuf);
+    memsrc->offset += size;
+    memsrc_output(upipe, uref, &memsrc->upump);
+}
+
+/** @internal @This checks the internal state of the memory source. */
+static int memsrc_check(struct upipe *upipe, struct uref *flow_def)
+{
+    struct memsrc *memsrc = memsrc_from_upipe(upipe);
+
+    if (flow_def != NULL)
+        memsrc_store_flow_def(upipe, flow_def);
+
+    if (memsrc->uref_mgr == NULL) {
+        memsrc_require_uref_mgr(upipe);
+        return UBASE_ERR_NONE;
+    }
+
+    if (memsrc->flow_def == NULL) {
+        flow_def = uref_block_flow_alloc_def(memsrc->uref_mgr, "mpegts.");
+        UBASE_ALLOC_RETURN(flow_def);
+        memsrc_store_flow_def(upipe, flow_def);
+    }
+
+    if (!ubase_check(memsrc_check_upump_mgr(upipe)))
+        return UBASE_ERR_NONE;
+
+    if (memsrc->upump == NULL && memsrc->offset < capture_size) {
+        struct upump *upump = upump_alloc_idler(memsrc->upump_mgr,
+                                                memsrc_idle, upipe,
+                                                upipe->refcount);
+        UBASE_ALLOC_RETURN(upump);
+        upump_start(upump);
+        memsrc_set_upump(upipe, upump);
+    }
+    return UBASE_ERR_NONE;
+}
+
+/** @internal @This processes control commands on a memory source. */
+static int memsrc_control(struct upipe *upipe, int command, va_list args)
+{
+    UBASE_HANDLED_RETURN(memsrc_control_output(upipe, command, args));
+    switch (command) {
+        case UPIPE_ATTACH_UPUMP_MGR:
+            memsrc_set_upump(upipe, NULL);
+            memsrc_attach_upump_mgr(upipe);
+            break;
+        default:
+            return UBASE_ERR_UNHANDLED;
+    }
+    return memsrc_check(upipe, NULL);
+}
+
+/** manager of memory sources */
+static struct upipe_mgr memsrc_mgr = {
+    .refcount = NULL,
+    .signature = 0,
+    .upipe_alloc = memsrc_alloc,
+    .upipe_input = NULL,
+    .upipe_control = memsrc_control,
+};
+
+/*
+ * probes
+ */
+
+/** @internal @This accounts the counters of the head pipe of a stage when
+ * it dies. */
+static int catch_stage(struct uprobe *uprobe, struct upipe *upipe,
+                       int event, va_list args)
+{
+    struct bench_stage *stage = container_of(uprobe, struct bench_stage,
+                                             uprobe);
+    struct upipe_stats stats;
+
+    if (event == UPROBE_DEAD && upipe != NULL && stage->signature &&
+        upipe->mgr->signature == stage->signature &&
+        ubase_check(upipe_get_stats(upipe, &stats))) {
+        /* the pipes of the remote sink die in their own thread */
+        __atomic_fetch_add(&stage->input_time, stats.input_time,
+                           __ATOMIC_RELAXED);
+        __atomic_fetch_add(&stage->bytes_in, stats.bytes_in,
+                           __ATOMIC_RELAXED);
+    }
+    return uprobe_throw_next(uprobe, upipe, event, args);
+}
+
+/** generic probe */
+static int catch(struct uprobe *uprobe, struct upipe *upipe,
+                 int event, va_list args)
+{
+    /* the error was already printed by the stdio probe */
+    if (event == UPROBE_FATAL)
+        exit(EXIT_FAILURE);
+    return UBASE_ERR_NONE;
+}
+
+/** probe to catch the end of the source */
+static int catch_src(struct uprobe *uprobe, struct upipe *upipe,
+                     int event, va_list args)
+{
+    if (event == UPROBE_SOURCE_END) {
+        upipe_release(source);
+        source = NULL;
+        return UBASE_ERR_NONE;
+    }
+    return uprobe_throw_next(uprobe, upipe, event, args);
+}
+
+/** probe to catch events from the TS demux outputs */
+static int catch_ts_demux_output(struct uprobe *uprobe,
+                                 struct upipe *upipe,
+                                 int event, va_list args)
+{
+    if (event == UPROBE_SOURCE_END) {
+        upipe_release(upipe);
+        return UBASE_ERR_NONE;
+    }
+    return uprobe_throw_next(uprobe, upipe, event, args);
+}
+
+/** @internal @This allocates the chain from a new TS demux output to the
+ * TS mux program. */
+static void bench_add_output(struct upipe *program, struct uref *flow_def,
+                             uint64_t flow_id)
+{
+    const char *def;
+    ubase_assert(uref_flow_get_def(flow_def, &def));
+
+    struct upipe *output = upipe_flow_alloc_sub(program,
+        uprobe_pfx_alloc_va(&uprobe_demux_output_s, log_level,
+                            "ts demux output %"PRIu64, flow_id), flow_def);
+    assert(output != NULL);
+
+    /* the framers are allocated here to account for them separately */
+    output = upipe_void_alloc_output(output, upipe_autof_mgr,
+        uprobe_pfx_alloc_va(uprobe_use(&stages[BENCH_FRAMERS].uprobe),
+                            log_level, "autof %"PRIu64, flow_id));
+    assert(output != NULL);
+    output = upipe_void_chain_output(output, upipe_noclock_mgr,
+        uprobe_pfx_alloc_va(uprobe_use(&stages[BENCH_GLUE].uprobe),
+                            log_level, "noclock %"PRIu64, flow_id));
+    assert(output != NULL);
+    if (strstr(def, ".pic.") != NULL) {
+        output = upipe_void_chain_output(output, upipe_vtrim_mgr,
+            uprobe_pfx_alloc_va(uprobe_use(logger), log_level,
+                                "vtrim %"PRIu64, flow_id));
+        assert(output != NULL);
+    }
+    output = upipe_void_chain_output_sub(output, upipe_even,
+        uprobe_pfx_alloc_va(uprobe_use(logger), log_level,
+                            "even %"PRIu64, flow_id));
+    assert(output != NULL);
+
+    struct upipe *upipe_ts_mux_program;
+    ubase_assert(upipe_get_output(program, &upipe_ts_mux_program));
+    output = upipe_void_chain_output_sub(output, upipe_ts_mux_program,
+        uprobe_pfx_alloc_va(uprobe_use(&stages[BENCH_MUX].uprobe),
+                            log_level, "mux input %"PRIu64, flow_id));
+    assert(output != NULL);
+    upipe_release(output);
+}
+
+/** probe to catch events from the TS demux programs */
+static int catch_ts_demux_program(struct uprobe *uprobe,
+                                  struct upipe *upipe,
+                                  int event, va_list args)
+{
+    switch (event) {
+        case UPROBE_SOURCE_END: {
+            struct upipe *upipe_ts_mux_program;
+            ubase_assert(upipe_get_output(upipe, &upipe_ts_mux_program));
+            ubase_assert(upipe_ts_mux_freeze_psi(upipe_ts_mux_program));
+
+            struct upipe *upipe_ts_mux;
+            ubase_assert(upipe_sub_get_super(upipe_ts_mux_program,
+                                             &upipe_ts_mux));
+            ubase_assert(upipe_ts_mux_freeze_psi(upipe_ts_mux));
+
+            upipe_release(upipe);
+            return UBASE_ERR_NONE;
+        }
+
+        case UPROBE_SPLIT_UPDATE: {
+            struct uref *flow_def = NULL;
+            while (ubase_check(upipe_split_iterate(upipe, &flow_def)) &&
+                   flow_def != NULL) {
+                uint64_t flow_id;
+                ubase_assert(uref_flow_get_id(flow_def, &flow_id));
+
+                struct upipe *output = NULL;
+                bool found = false;
+                while (ubase_check(upipe_iterate_sub(upipe, &output)) &&
+                       output != NULL) {
+                    struct uref *flow_def2;
+                    uint64_t id2;
+                    if (ubase_check(upipe_get_flow_def(output, &flow_def2)) &&
+                        ubase_check(uref_flow_get_id(flow_def2, &id2)) &&
+                        flow_id == id2) {
+                        found = true;
+                        break;
+                    }
+                }
+                if (!found)
+                    bench_add_output(upipe, flow_def, flow_id);
+            }
+            return UBASE_ERR_NONE;
+        }
+        default:
+            return uprobe_throw_next(uprobe, upipe, event, args);
+    }
+}
+
+/** probe to catch events from the TS demux */
+static int catch_ts_demux(struct uprobe *uprobe, struct upipe *upipe,
+                          int event, va_list args)
+{
+    if (event != UPROBE_SPLIT_UPDATE)
+        return uprobe_throw_next(uprobe, upipe, event, args);
+
+    struct uref *flow_def = NULL;
+    while (ubase_check(upipe_split_iterate(upipe, &flow_def)) &&
+           flow_def != NULL) {
+        uint64_t flow_id;
+        ubase_assert(uref_flow_get_id(flow_def, &flow_id));
+
+        struct upipe *program = NULL;
+        bool found = false;
+        while (ubase_check(upipe_iterate_sub(upipe, &program)) &&
+               program != NULL) {
+            struct uref *flow_def2;
+            uint64_t id2;
+            if (ubase_check(upipe_get_flow_def(program, &flow_def2)) &&
+                ubase_check(uref_flow_get_id(flow_def2, &id2)) &&
+                flow_id == id2) {
+                found = true;
+                break;
+            }
+        }
+        if (found)
+            continue;
+
+        program = upipe_flow_alloc_sub(upipe,
+            uprobe_pfx_alloc_va(&uprobe_demux_program_s,
+                                log_level, "ts demux program %"PRIu64,
+                                flow_id), flow_def);
+        assert(program != NULL);
+
+        struct upipe *upipe_ts_mux;
+        ubase_assert(upipe_get_output(upipe, &upipe_ts_mux));
+        assert(upipe_ts_mux != NULL);
+
+        program = upipe_void_alloc_output_sub(program, upipe_ts_mux,
+            uprobe_pfx_alloc_va(uprobe_use(logger), log_level,
+                                "ts mux program %"PRIu64, flow_id));
+        assert(program != NULL);
+        ubase_assert(upipe_ts_mux_set_version(program, 1));
+        upipe_release(program);
+    }
+    return UBASE_ERR_NONE;
+}
+
+/*
+ * benchmark
+ */
+
+/** @internal @This returns the current value of a clock.
+ *
+ * @param clock_id clock to read
+ * @return time in seconds
+ */
+static double bench_clock(clockid_t clock_id)
+{
+    struct timespec ts;
+    assert(clock_gettime(clock_id, &ts) == 0);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/** @internal @This loads the capture in memory.
+ *
+ * @param umem_mgr memory allocator to use
+ * @param path path of the capture
+ */
+static void bench_load(struct umem_mgr *umem_mgr, const char *path)
+{
+    FILE *file = fopen(path, "rb");
+    if (file == NULL) {
+        perror(path);
+        exit(EXIT_FAILURE);
+    }
+    assert(fseek(file, 0, SEEK_END) == 0);
+    long length = ftell(file);
+    assert(length >= 0 && fseek(file, 0, SEEK_SET) == 0);
+    /* only play whole packets */
+    capture_size = length - length % TS_SIZE;
+    if (!capture_size) {
+        fprintf(stderr, "%s: empty capture\n", path);
+        exit(EXIT_FAILURE);
+    }
+
+    struct ubuf_mgr *ubuf_mgr =
+        ubuf_block_mem_mgr_alloc(UBUF_POOL_DEPTH, UBUF_SHARED_POOL_DEPTH,
+                                 umem_mgr, 0, 0, -1, 0);
+    assert(ubuf_mgr != NULL);
+    capture = ubuf_block_alloc(ubuf_mgr, capture_size);
+    assert(capture != NULL);
+    ubuf_mgr_release(ubuf_mgr);
+
+    int size = -1;
+    uint8_t *buffer;
+    ubase_assert(ubuf_block_write(capture, 0, &size, &buffer));
+    assert(fread(buffer, 1, size, file) == (size_t)size);
+    ubase_assert(ubuf_block_unmap(capture, 0));
+    fclose(file);
+}
+
+/** @internal @This allocates a transfer manager running a new thread.
+ *
+ * @param thread_p filled in with the ID of the thread
+ * @return pointer to transfer manager
+ */
+static struct upipe_mgr *bench_xfer_mgr_alloc(pthread_t *thread_p)
+{
+    struct upipe_mgr *xfer_mgr = upipe_pthread_xfer_mgr_alloc(XFER_QUEUE,
+            XFER_POOL, uprobe_use(logger), upump_ev_mgr_alloc_loop,
+            UPUMP_POOL, UPUMP_BLOCKER_POOL, NULL, thread_p, NULL);
+    assert(xfer_mgr != NULL);
+    return xfer_mgr;
+}
+
+/** @internal @This builds the pipeline and plays the capture once.
+ *
+ * @param topology topology of the pipeline
+ */
+static void bench_pass(enum bench_topology topology)
+{
+    struct upipe_mgr *upipe_even_mgr = upipe_even_mgr_alloc();
+    assert(upipe_even_mgr != NULL);
+    upipe_even = upipe_void_alloc(upipe_even_mgr,
+            uprobe_pfx_alloc(uprobe_use(logger), log_level, "even"));
+    assert(upipe_even != NULL);
+    upipe_mgr_release(upipe_even_mgr);
+
+    /* source */
+    pthread_t src_thread, sink_thread;
+    struct upipe_mgr *upipe_wsink_mgr = NULL;
+    if (topology == BENCH_WORKER) {
+        struct upipe_mgr *xfer_mgr = bench_xfer_mgr_alloc(&src_thread);
+        struct upipe_mgr *upipe_wsrc_mgr = upipe_wsrc_mgr_alloc(xfer_mgr);
+        assert(upipe_wsrc_mgr != NULL);
+        upipe_mgr_release(xfer_mgr);
+        xfer_mgr = bench_xfer_mgr_alloc(&sink_thread);
+        upipe_wsink_mgr = upipe_wsink_mgr_alloc(xfer_mgr);
+        assert(upipe_wsink_mgr != NULL);
+        upipe_mgr_release(xfer_mgr);
+
+        struct uprobe *uprobe_remote = uprobe_xfer_alloc(uprobe_use(logger));
+        assert(uprobe_remote != NULL);
+        uprobe_xfer_add(uprobe_remote, UPROBE_XFER_VOID,
+                        UPROBE_SOURCE_END, 0);
+
+        /* do not attach the upump manager of the main thread */
+        uprobe_throw(logger, NULL, UPROBE_FREEZE_UPUMP_MGR);
+        struct upipe *remote = upipe_void_alloc(&memsrc_mgr,
+                uprobe_pfx_alloc(uprobe_remote, log_level, "memsrc"));
+        assert(remote != NULL);
+        uprobe_throw(logger, NULL, UPROBE_THAW_UPUMP_MGR);
+
+        source = upipe_wsrc_alloc(upipe_wsrc_mgr,
+                uprobe_pfx_alloc(uprobe_use(&uprobe_src_s), log_level,
+                                 "wsrc"),
+                remote,
+                uprobe_pfx_alloc(uprobe_use(logger), log_level, "wsrc_x"),
+                WSRC_QUEUE_LENGTH);
+        upipe_mgr_release(upipe_wsrc_mgr);
+    } else {
+        source = upipe_void_alloc(&memsrc_mgr,
+                uprobe_pfx_alloc(uprobe_use(&uprobe_src_s), log_level,
+                                 "memsrc"));
+    }
+    assert(source != NULL);
+
+    /* TS demux, the framers are allocated by the probes */
+    struct upipe_mgr *upipe_ts_demux_mgr = upipe_ts_demux_mgr_alloc();
+    assert(upipe_ts_demux_mgr != NULL);
+    struct upipe *upipe = upipe_void_alloc_output(source,
+            upipe_ts_demux_mgr,
+            uprobe_pfx_alloc(uprobe_use(&uprobe_ts_demux_s), log_level,
+                             "ts demux"));
+    assert(upipe != NULL);
+    upipe_mgr_release(upipe_ts_demux_mgr);
+    ubase_assert(upipe_ts_demux_set_conformance(upipe,
+                                                UPIPE_TS_CONFORMANCE_ISO));
+
+    /* TS mux */
+    struct upipe_mgr *upipe_ts_mux_mgr = upipe_ts_mux_mgr_alloc();
+    assert(upipe_ts_mux_mgr != NULL);
+    upipe = upipe_void_chain_output(upipe, upipe_ts_mux_mgr,
+            uprobe_pfx_alloc(uprobe_use(logger), log_level, "ts mux"));
+    assert(upipe != NULL);
+    upipe_mgr_release(upipe_ts_mux_mgr);
+    ubase_assert(upipe_ts_mux_set_mode(upipe, UPIPE_TS_MUX_MODE_CAPPED));
+    ubase_assert(upipe_ts_mux_set_version(upipe, 1));
+    ubase_assert(upipe_ts_mux_set_cr_prog(upipe, 0));
+
+    /* null sink */
+    struct upipe_mgr *upipe_null_mgr = upipe_null_mgr_alloc();
+    assert(upipe_null_mgr != NULL);
+    if (topology == BENCH_WORKER) {
+        struct upipe *sink = upipe_void_alloc(upipe_null_mgr,
+                uprobe_pfx_alloc(uprobe_use(&stages[BENCH_REMOTE_SINK].uprobe),
+                                 log_level, "null"));
+        assert(sink != NULL);
+        sink = upipe_wsink_alloc(upipe_wsink_mgr,
+                uprobe_pfx_alloc(uprobe_use(&stages[BENCH_SINK].uprobe),
+                                 log_level, "wsink"),
+                sink,
+                uprobe_pfx_alloc(uprobe_use(logger), log_level, "wsink_x"),
+                WSINK_QUEUE_LENGTH);
+        assert(sink != NULL);
+        upipe_mgr_release(upipe_wsink_mgr);
+        ubase_assert(upipe_set_output(upipe, sink));
+        upipe_release(sink);
+    } else {
+        upipe = upipe_void_chain_output(upipe, upipe_null_mgr,
+                uprobe_pfx_alloc(uprobe_use(&stages[BENCH_SINK].uprobe),
+                                 log_level, "null"));
+        assert(upipe != NULL);
+    }
+    upipe_mgr_release(upipe_null_mgr);
+    upipe_release(upipe);
+
+    upump_mgr_run(upump_mgr, NULL);
+
+    if (topology == BENCH_WORKER) {
+        assert(!pthread_join(src_thread, NULL));
+        assert(!pthread_join(sink_thread, NULL));
+    }
+    upipe_release(upipe_even);
+    upipe_even = NULL;
+}
+
+/** @internal @This returns the CPU time of a stage, excluding the time
+ * spent in the next stage of the same thread.
+ *
+ * @param id stage
+ * @return time in seconds
+ */
+static double bench_stage_time(enum bench_stage_id id)
+{
+    int64_t time = stages[id].input_time;
+    if (id < BENCH_SINK)
+        time -= stages[id + 1].input_time;
+    /* buffers flushed at release time do not go through the inputs */
+    return time > 0 ? (double)time / UCLOCK_FREQ : 0.;
+}
+
+/** @internal @This plays the capture with the given topology, and prints
+ * the results.
+ *
+ * @param topology topology of the pipeline
+ * @param passes number of passes over the capture
+ * @param instrumented true if the counters of the pipes are enabled
+ */
+static void bench_run(enum bench_topology topology, unsigned int passes,
+                      bool instrumented)
+{
+    stages[BENCH_DEMUX].signature = UPIPE_TS_DEMUX_SIGNATURE;
+    stages[BENCH_FRAMERS].signature = UPIPE_AUTOF_SIGNATURE;
+    stages[BENCH_GLUE].signature = UPIPE_NOCLOCK_SIGNATURE;
+    stages[BENCH_MUX].signature = UPIPE_TS_MUX_INPUT_SIGNATURE;
+    stages[BENCH_SINK].signature = topology == BENCH_WORKER ?
+        UPIPE_WORK_SIGNATURE : UPIPE_NULL_SIGNATURE;
+    stages[BENCH_REMOTE_SINK].signature = topology == BENCH_WORKER ?
+        UPIPE_NULL_SIGNATURE : 0;
+    for (unsigned int i = 0; i < BENCH_STAGES; i++) {
+        stages[i].input_time = 0;
+        stages[i].bytes_in = 0;
+    }
+
+    double wall = 0., cpu = 0.;
+    for (unsigned int i = 0; i < passes; i++) {
+        double wall_start = bench_clock(CLOCK_MONOTONIC);
+        double cpu_start = bench_clock(CLOCK_PROCESS_CPUTIME_ID);
+        bench_pass(topology);
+        wall += bench_clock(CLOCK_MONOTONIC) - wall_start;
+        cpu += bench_clock(CLOCK_PROCESS_CPUTIME_ID) - cpu_start;
+    }
+
+    uint64_t bytes = (uint64_t)capture_size * passes;
+    printf("{\"bench\":\"ts\",\"topology\":\"%s\",\"passes\":%u,"
+           "\"bytes\":%"PRIu64",\"packets\":%"PRIu64",\"seconds\":%.6f,"
+           "\"cpu_seconds\":%.6f,\"mbps\":%.3f,\"packets_per_sec\":%.0f",
+           bench_topologies[topology], passes, bytes, bytes / TS_SIZE,
+           wall, cpu, wall > 0. ? bytes * 8 / wall / 1e6 : 0.,
+           wall > 0. ? bytes / TS_SIZE / wall : 0.);
+
+    if (instrumented) {
+        printf(",\"bytes_out\":%"PRIu64",\"stages\":{",
+               stages[BENCH_SINK].bytes_in);
+        double other = cpu;
+        for (unsigned int i = 0; i < BENCH_STAGES; i++) {
+            if (!stages[i].signature)
+                continue;
+            double time = bench_stage_time(i);
+            other -= time;
+            printf("\"%s\":%.6f,", stages[i].name, time);
+        }
+        printf("\"other\":%.6f}", other > 0. ? other : 0.);
+    }
+    printf("}\n");
+}
+
+/** @internal @This prints the usage and exits.
+ *
+ * @param argv0 name of the program
+ */
+static void usage(const char *argv0)
+{
+    fprintf(stderr, "Usage: %s [-n <passes>] [-c <packets>] [-t <topology>] "
+            "[-S] [-v] <file.ts>\n", argv0);
+    fprintf(stderr, "   -n: number of passes over the capture\n");
+    fprintf(stderr, "   -c: number of TS packets per buffer\n");
+    fprintf(stderr, "   -t: only run \"single\" or \"worker\"\n");
+    fprintf(stderr, "   -S: disable the counters of the pipes\n");
+    fprintf(stderr, "   -v: print debug messages\n");
+    exit(EXIT_FAILURE);
+}
+
+int main(int argc, char **argv)
+{
+    unsigned int passes = BENCH_PASSES;
+    const char *topology = NULL;
+    bool instrumented = true;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:c:t:Sv")) != -1) {
+        switch (opt) {
+            case 'n':
+                passes = strtoul(optarg, NULL, 0);
+                break;
+            case 'c':
+                chunk_size = strtoul(optarg, NULL, 0) * TS_SIZE;
+                break;
+            case 't':
+                topology = optarg;
+                break;
+            case 'S':
+                instrumented = false;
+                break;
+            case 'v':
+                log_level = UPROBE_LOG_DEBUG;
+                break;
+            default:
+                usage(argv[0]);
+        }
+    }
+    if (optind != argc - 1 || !passes || !chunk_size)
+        usage(argv[0]);
+    setvbuf(stdout, NULL, _IOLBF, 0);
+
+    struct umem_mgr *umem_mgr = umem_pool_mgr_alloc_simple(UMEM_POOL);
+    assert(umem_mgr != NULL);
+    struct udict_mgr *udict_mgr = udict_inline_mgr_alloc(UDICT_POOL_DEPTH,
+                                                         umem_mgr, -1, -1);
+    assert(udict_mgr != NULL);
+    struct uref_mgr *uref_mgr = uref_std_mgr_alloc(UREF_POOL_DEPTH,
+                                                   udict_mgr, 0);
+    assert(uref_mgr != NULL);
+    upump_mgr = upump_ev_mgr_alloc_default(UPUMP_POOL, UPUMP_BLOCKER_POOL);
+    assert(upump_mgr != NULL);
+    bench_load(umem_mgr, argv[optind]);
+
+    struct uprobe uprobe_s;
+    uprobe_init(&uprobe_s, catch, NULL);
+    logger = uprobe_stdio_alloc(&uprobe_s, stderr, log_level);
+    assert(logger != NULL);
+    logger = uprobe_ubuf_mem_pool_alloc(logger, umem_mgr, UBUF_POOL_DEPTH,
+                                        UBUF_SHARED_POOL_DEPTH);
+    assert(logger != NULL);
+    logger = uprobe_uref_mgr_alloc(logger, uref_mgr);
+    assert(logger != NULL);
+    logger = uprobe_pthread_upump_mgr_alloc(logger);
+    assert(logger != NULL);
+    uprobe_pthread_upump_mgr_set(logger, upump_mgr);
+    uref_mgr_release(uref_mgr);
+    udict_mgr_release(udict_mgr);
+    umem_mgr_release(umem_mgr);
+
+    for (unsigned int i = 0; i < BENCH_STAGES; i++)
+        uprobe_init(&stages[i].uprobe, catch_stage, uprobe_use(logger));
+    uprobe_init(&uprobe_src_s, catch_src, uprobe_use(logger));
+    uprobe_init(&uprobe_ts_demux_s, catch_ts_demux,
+                uprobe_use(&stages[BENCH_DEMUX].uprobe));
+    uprobe_init(&uprobe_demux_output_s, catch_ts_demux_output,
+                uprobe_use(logger));
+    uprobe_init(&uprobe_demux_program_s, catch_ts_demux_program,
+                uprobe_use(logger));
+
+    upipe_autof_mgr = upipe_autof_mgr_alloc();
+    assert(upipe_autof_mgr != NULL);
+    upipe_noclock_mgr = upipe_noclock_mgr_alloc();
+    assert(upipe_noclock_mgr != NULL);
+    upipe_vtrim_mgr = upipe_vtrim_mgr_alloc();
+    assert(upipe_vtrim_mgr != NULL);
+
+    upipe_stats_set_global(instrumented);
+    for (unsigned int i = 0; i < BENCH_TOPOLOGIES; i++)
+        if (topology == NULL || !strcmp(topology, bench_topologies[i]))
+            bench_run(i, passes, instrumented);
+
+    upipe_mgr_release(upipe_vtrim_mgr);
+    upipe_mgr_release(upipe_noclock_mgr);
+    upipe_mgr_release(upipe_autof_mgr);
+    ubuf_free(capture);
+    uprobe_clean(&uprobe_demux_program_s);
+    uprobe_clean(&uprobe_demux_output_s);
+    uprobe_clean(&uprobe_ts_demux_s);
+    uprobe_clean(&uprobe_src_s);
+    for (unsigned int i = 0; i < BENCH_STAGES; i++)
+        uprobe_clean(&stages[i].uprobe);
+    uprobe_release(logger);
+    uprobe_clean(&uprobe_s);
+    upump_mgr_release(upump_mgr);
+    return 0;
+}
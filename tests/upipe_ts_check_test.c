@@ -29,6 +29,7 @@
 
 #undef NDEBUG
 
+#include <upipe/uclock.h>
 #include <upipe/uprobe.h>
 #include <upipe/uprobe_stdio.h>
 #include <upipe/uprobe_prefix.h>
@@ -43,6 +44,7 @@
 #include <upipe/uref_flow.h>
 #include <upipe/uref_block_flow.h>
 #include <upipe/uref_block.h>
+#include <upipe/uref_clock.h>
 #include <upipe/uref_std.h>
 #include <upipe/upipe.h>
 #include <upipe-ts/upipe_ts_check.h>
@@ -62,6 +64,9 @@
 #define UPROBE_LOG_LEVEL UPROBE_LOG_DEBUG
 
 static unsigned int nb_packets = 0;
+static unsigned int nb_reports = 0;
+static struct upipe_ts_check_stats report;
+static struct upipe_ts_check_pid_stats report_pid;
 
 /** definition of our uprobe */
 static int catch(struct uprobe *uprobe, struct upipe *upipe,
@@ -75,10 +80,32 @@ static int catch(struct uprobe *uprobe, struct upipe *upipe,
         case UPROBE_DEAD:
         case UPROBE_NEW_FLOW_DEF:
             break;
+        case UPROBE_TS_CHECK_REPORT: {
+            uint32_t signature = va_arg(args, uint32_t);
+            assert(signature == UPIPE_TS_CHECK_SIGNATURE);
+            report = *va_arg(args, const struct upipe_ts_check_stats *);
+            assert(report.nb_pids >= 1);
+            report_pid = report.pids[0];
+            nb_reports++;
+            break;
+        }
     }
     return UBASE_ERR_NONE;
 }
 
+/** builds a TS packet for the monitoring tests */
+static void build_packet(uint8_t *ts, uint16_t pid, uint8_t cc, uint64_t pcr)
+{
+    ts_pad(ts);
+    ts_set_pid(ts, pid);
+    ts_set_cc(ts, cc);
+    if (pcr != UINT64_MAX) {
+        ts_set_adaptation(ts, TS_HEADER_SIZE_PCR - TS_HEADER_SIZE - 1);
+        tsaf_set_pcr(ts, pcr / 300);
+        tsaf_set_pcrext(ts, pcr % 300);
+    }
+}
+
 /** helper phony pipe */
 static struct upipe *test_alloc(struct upipe_mgr *mgr, struct uprobe *uprobe,
                                 uint32_t signature, va_list args)
@@ -215,6 +242,79 @@ int main(int argc, char *argv[])
     upipe_input(upipe_ts_check, uref, NULL);
     assert(!nb_packets);
 
+    /* monitoring mode */
+    ubase_assert(upipe_ts_check_set_monitor(upipe_ts_check, UCLOCK_FREQ));
+    uref = uref_block_alloc(uref_mgr, ubuf_mgr, 7 * TS_SIZE);
+    assert(uref != NULL);
+    uref_clock_set_cr_sys(uref, 0);
+    size = -1;
+    ubase_assert(uref_block_write(uref, 0, &size, &buffer));
+    static const uint8_t ccs[7] = { 0, 1, 2, 3, 5, 5, 6 };
+    for (i = 0; i < 7; i++)
+        build_packet(buffer + i * TS_SIZE, 0x100, ccs[i],
+                     i == 0 ? 0 : (i == 6 ? 600 : UINT64_MAX));
+    ts_set_transporterror(buffer + 2 * TS_SIZE);
+    uref_block_unmap(uref, 0);
+    nb_packets = 7;
+    upipe_input(upipe_ts_check, uref, NULL);
+    assert(!nb_packets);
+
+    uref = uref_block_alloc(uref_mgr, ubuf_mgr, 7 * TS_SIZE);
+    assert(uref != NULL);
+    uref_clock_set_cr_sys(uref, UCLOCK_FREQ / 2);
+    size = -1;
+    ubase_assert(uref_block_write(uref, 0, &size, &buffer));
+    for (i = 0; i < 7; i++)
+        build_packet(buffer + i * TS_SIZE, 0x100, 7 + i,
+                     i == 5 ? 1220 : UINT64_MAX);
+    buffer[6 * TS_SIZE] = 0xff;
+    uref_block_unmap(uref, 0);
+    nb_packets = 6;
+    upipe_input(upipe_ts_check, uref, NULL);
+    assert(!nb_packets);
+    assert(!nb_reports);
+
+    uref = uref_block_alloc(uref_mgr, ubuf_mgr, TS_SIZE);
+    assert(uref != NULL);
+    uref_clock_set_cr_sys(uref, UCLOCK_FREQ);
+    size = -1;
+    ubase_assert(uref_block_write(uref, 0, &size, &buffer));
+    build_packet(buffer, 0x100, 13, 1220 + 27000000);
+    uref_block_unmap(uref, 0);
+    nb_packets = 1;
+    upipe_input(upipe_ts_check, uref, NULL);
+    assert(!nb_packets);
+    assert(nb_reports == 1);
+    assert(report.duration == UCLOCK_FREQ);
+    assert(report.packets == 13);
+    assert(report.sync_errors == 1);
+    assert(report.nb_pids == 1);
+    assert(report_pid.pid == 0x100);
+    assert(report_pid.packets == 13);
+    assert(report_pid.cc_errors == 1);
+    assert(report_pid.transport_errors == 1);
+    assert(report_pid.pcrs == 3);
+    assert(report_pid.pcr_repetition_errors == 0);
+    assert(report_pid.pcr_accuracy_errors == 1);
+    assert(report_pid.pcr_max_inaccuracy == 20);
+
+    uref = uref_block_alloc(uref_mgr, ubuf_mgr, TS_SIZE);
+    assert(uref != NULL);
+    uref_clock_set_cr_sys(uref, 2 * UCLOCK_FREQ);
+    size = -1;
+    ubase_assert(uref_block_write(uref, 0, &size, &buffer));
+    ts_pad(buffer);
+    uref_block_unmap(uref, 0);
+    nb_packets = 1;
+    upipe_input(upipe_ts_check, uref, NULL);
+    assert(!nb_packets);
+    assert(nb_reports == 2);
+    assert(report.packets == 1);
+    assert(!report.sync_errors);
+    assert(report_pid.packets == 1);
+    assert(!report_pid.cc_errors);
+    assert(report_pid.pcr_repetition_errors == 1);
+
     upipe_release(upipe_ts_check);
     upipe_mgr_release(upipe_ts_check_mgr); // nop
 
@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short unit tests for MPEG-2 CRC32 computation
+ */
+
+#undef NDEBUG
+
+#include "../lib/upipe-ts/upipe_ts_crc.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+#include <bitstream/mpeg/psi.h>
+
+#define BUFFER_SIZE 5000
+
+/** reference implementation, one bit at a time */
+static uint32_t crc32_ref(uint32_t crc, const uint8_t *p, size_t size)
+{
+    while (size--) {
+        crc ^= (uint32_t)*p++ << 24;
+        for (int i = 0; i < 8; i++)
+            crc = (crc << 1) ^ ((crc & 0x80000000) ? 0x04c11db7 : 0);
+    }
+    return crc;
+}
+
+int main(int argc, char **argv)
+{
+    static const uint8_t check[] = "123456789";
+    assert(upipe_ts_crc32(0xffffffff, check, 9) == 0x0376e6e7);
+
+    uint8_t *buffer = malloc(BUFFER_SIZE + 16);
+    assert(buffer != NULL);
+    for (int i = 0; i < BUFFER_SIZE + 16; i++)
+        buffer[i] = rand();
+
+    for (size_t size = 0; size <= BUFFER_SIZE; size += size < 300 ? 1 : 97) {
+        for (int offset = 0; offset < 16; offset += 5) {
+            const uint8_t *p = buffer + offset;
+            uint32_t crc = crc32_ref(0xffffffff, p, size);
+            assert(upipe_ts_crc32(0xffffffff, p, size) == crc);
+
+            /* continued computation */
+            size_t half = size / 3;
+            assert(upipe_ts_crc32(upipe_ts_crc32(0xffffffff, p, half),
+                                  p + half, size - half) == crc);
+        }
+    }
+
+    /* PSI sections */
+    uint8_t section[PSI_MAX_SIZE + PSI_HEADER_SIZE];
+    memcpy(section, buffer, sizeof(section));
+    psi_set_length(section, 1000);
+    upipe_ts_psi_set_crc(section);
+    assert(upipe_ts_psi_check_crc(section));
+    assert(psi_check_crc(section));
+    section[500] ^= 0x10;
+    assert(!upipe_ts_psi_check_crc(section));
+
+    free(buffer);
+    return 0;
+}
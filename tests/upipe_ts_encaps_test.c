@@ -135,9 +135,15 @@ static void check_ubuf(struct ubuf *ubuf, uint8_t stream_id, bool unitstart,
     assert(ts_get_unitstart(buffer) == unitstart);
 
     /* check af */
-    if (ts_has_adaptation(buffer))
-        assert(size == TS_HEADER_SIZE + 1 + ts_get_adaptation(buffer));
-    else
+    size_t stuffing_size = 0;
+    if (ts_has_adaptation(buffer)) {
+        if (!ts_has_payload(buffer)) {
+            /* the stuffing may be a separate, shared segment */
+            assert(TS_HEADER_SIZE + 1 + ts_get_adaptation(buffer) == TS_SIZE);
+            stuffing_size = TS_SIZE - size;
+        } else
+            assert(size == TS_HEADER_SIZE + 1 + ts_get_adaptation(buffer));
+    } else
         assert(size == TS_HEADER_SIZE);
     if (randomaccess || discontinuity)
         assert(size >= TS_HEADER_SIZE_AF);
@@ -156,6 +162,16 @@ static void check_ubuf(struct ubuf *ubuf, uint8_t stream_id, bool unitstart,
     assert(pcr_prog == UINT64_MAX);
 
     int offset = size;
+    if (stuffing_size) {
+        /* check stuffing */
+        uint8_t copy[stuffing_size];
+        buffer = ubuf_block_peek(ubuf, offset, stuffing_size, copy);
+        assert(buffer != NULL);
+        for (int i = 0; i < stuffing_size; i++)
+            assert(buffer[i] == 0xff);
+        ubase_assert(ubuf_block_peek_unmap(ubuf, offset, copy, buffer));
+        offset += stuffing_size;
+    }
     if (unitstart) {
         if (!stream_id) {
             /* check pointer_field */
@@ -295,6 +311,7 @@ int main(int argc, char *argv[])
     int i;
     for (i = 0; i < total_size; i++)
         buffer[i] = (total_size - i) % 256;
+    const uint8_t *input_buffer = buffer;
     uref_block_unmap(uref, 0);
     uref_clock_set_cr_prog(uref, UCLOCK_FREQ);
     uref_clock_set_cr_sys(uref, UINT32_MAX + UCLOCK_FREQ);
@@ -342,6 +359,18 @@ int main(int argc, char *argv[])
             check_ubuf(ubuf, 0, false, false, false, false,
                        UINT64_MAX, UINT64_MAX, UINT64_MAX,
                        &total_size, &payload_size);
+
+            /* the payload references the input buffer */
+            int header_size = -1;
+            const uint8_t *payload;
+            ubase_assert(ubuf_block_read(ubuf, 0, &header_size, &payload));
+            ubuf_block_unmap(ubuf, 0);
+            size = -1;
+            ubase_assert(ubuf_block_read(ubuf, header_size, &size, &payload));
+            assert(header_size + size == TS_SIZE);
+            assert(payload >= input_buffer &&
+                   payload + size <= input_buffer + 2206);
+            ubuf_block_unmap(ubuf, header_size);
         }
         ubuf_free(ubuf);
     }
@@ -62,6 +62,9 @@
 #define UPROBE_LOG_LEVEL UPROBE_LOG_DEBUG
 
 static uint16_t received_pid = UINT16_MAX;
+static uint16_t received_pids[8];
+static unsigned int nb_received = 0;
+static unsigned int nb_segments = 0;
 
 /** definition of our uprobe */
 static int catch(struct uprobe *uprobe, struct upipe *upipe,
@@ -94,13 +97,28 @@ static void test_input(struct upipe *upipe, struct uref *uref,
                        struct upump **upump_p)
 {
     assert(uref != NULL);
-    const uint8_t *buffer;
-    int size = -1;
-    ubase_assert(uref_block_read(uref, 0, &size, &buffer));
-    assert(size == TS_SIZE); //because of the way we allocated it
-    assert(ts_validate(buffer));
-    received_pid = ts_get_pid(buffer);
-    uref_block_unmap(uref, 0);
+    size_t uref_size;
+    ubase_assert(uref_block_size(uref, &uref_size));
+    assert(uref_size % TS_SIZE == 0);
+    nb_received = 0;
+    nb_segments = 0;
+    int offset = 0;
+    while (offset < uref_size) {
+        const uint8_t *buffer;
+        int size = -1;
+        ubase_assert(uref_block_read(uref, offset, &size, &buffer));
+        /* packets are never split because of the way we allocated them */
+        assert(size % TS_SIZE == 0);
+        for (int i = 0; i < size; i += TS_SIZE) {
+            assert(ts_validate(buffer + i));
+            received_pid = ts_get_pid(buffer + i);
+            assert(nb_received < sizeof(received_pids) / sizeof(uint16_t));
+            received_pids[nb_received++] = received_pid;
+        }
+        uref_block_unmap(uref, offset);
+        offset += size;
+        nb_segments++;
+    }
     uref_free(uref);
 }
 
@@ -209,6 +227,43 @@ int main(int argc, char *argv[])
     uref_block_unmap(uref, 0);
     upipe_input(upipe_ts_pidf, uref, NULL);
     assert(received_pid == 70);
+    received_pid = UINT16_MAX;
+
+    /* several packets in one block: 68 69 70 71 70 70 */
+    static const uint16_t pids[] = { 68, 69, 70, 71, 70, 70 };
+    unsigned int nb_pids = sizeof(pids) / sizeof(pids[0]);
+    uref = uref_block_alloc(uref_mgr, ubuf_mgr, nb_pids * TS_SIZE);
+    assert(uref != NULL);
+    size = -1;
+    ubase_assert(uref_block_write(uref, 0, &size, &buffer));
+    assert(size == nb_pids * TS_SIZE);
+    for (int i = 0; i < nb_pids; i++) {
+        ts_pad(buffer + i * TS_SIZE);
+        ts_set_pid(buffer + i * TS_SIZE, pids[i]);
+    }
+    uref_block_unmap(uref, 0);
+    upipe_input(upipe_ts_pidf, uref, NULL);
+    /* one uref, one segment per run of kept packets */
+    assert(nb_received == 4);
+    assert(received_pids[0] == 68);
+    assert(received_pids[1] == 70);
+    assert(received_pids[2] == 70);
+    assert(received_pids[3] == 70);
+    assert(nb_segments == 3);
+
+    /* no packet kept */
+    received_pid = UINT16_MAX;
+    uref = uref_block_alloc(uref_mgr, ubuf_mgr, 2 * TS_SIZE);
+    assert(uref != NULL);
+    size = -1;
+    ubase_assert(uref_block_write(uref, 0, &size, &buffer));
+    ts_pad(buffer);
+    ts_set_pid(buffer, 69);
+    ts_pad(buffer + TS_SIZE);
+    ts_set_pid(buffer + TS_SIZE, 71);
+    uref_block_unmap(uref, 0);
+    upipe_input(upipe_ts_pidf, uref, NULL);
+    assert(received_pid == UINT16_MAX);
 
     upipe_release(upipe_ts_pidf);
     upipe_mgr_release(upipe_ts_pidf_mgr); // nop
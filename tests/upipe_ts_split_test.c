@@ -95,6 +95,7 @@ static int catch(struct uprobe *uprobe, struct upipe *upipe,
 struct test {
     uint16_t pid;
     bool got_packet;
+    unsigned int nb_packets;
     struct upipe upipe;
 };
 
@@ -109,6 +110,7 @@ static struct upipe *test_alloc(struct upipe_mgr *mgr, struct uprobe *uprobe,
     assert(test != NULL);
     upipe_init(&test->upipe, mgr, uprobe);
     test->got_packet = false;
+    test->nb_packets = 0;
     test->pid = pid;
     return &test->upipe;
 }
@@ -120,6 +122,7 @@ static void test_input(struct upipe *upipe, struct uref *uref,
     struct test *test = container_of(upipe, struct test, upipe);
     assert(uref != NULL);
     test->got_packet = true;
+    test->nb_packets++;
     const uint8_t *buffer;
     int size = -1;
     ubase_assert(uref_block_read(uref, 0, &size, &buffer));
@@ -236,6 +239,24 @@ int main(int argc, char *argv[])
     uref_block_unmap(uref, 0);
     upipe_input(upipe_ts_split, uref, NULL);
 
+    /* a datagram of 7 packets, with a PID not selected */
+    static const uint16_t pids[] = { 68, 100, 69, 68, 100, 100, 68 };
+    uref = uref_block_alloc(uref_mgr, ubuf_mgr, 7 * TS_SIZE);
+    assert(uref != NULL);
+    size = -1;
+    ubase_assert(uref_block_write(uref, 0, &size, &buffer));
+    assert(size == 7 * TS_SIZE);
+    for (int i = 0; i < 7; i++) {
+        ts_pad(buffer + i * TS_SIZE);
+        ts_set_pid(buffer + i * TS_SIZE, pids[i]);
+    }
+    uref_block_unmap(uref, 0);
+    upipe_input(upipe_ts_split, uref, NULL);
+    struct test *test68 = container_of(upipe_sink68, struct test, upipe);
+    struct test *test69 = container_of(upipe_sink69, struct test, upipe);
+    assert(test68->nb_packets == 4);
+    assert(test69->nb_packets == 2);
+
     upipe_release(upipe_ts_split_output68);
     upipe_release(upipe_ts_split_output69);
     upipe_release(upipe_ts_split);
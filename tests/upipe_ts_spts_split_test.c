@@ -0,0 +1,373 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short unit tests for TS SPTS split module
+ */
+
+#undef NDEBUG
+
+#include <upipe/uprobe.h>
+#include <upipe/uprobe_stdio.h>
+#include <upipe/uprobe_prefix.h>
+#include <upipe/umem.h>
+#include <upipe/umem_alloc.h>
+#include <upipe/udict.h>
+#include <upipe/udict_inline.h>
+#include <upipe/ubuf.h>
+#include <upipe/ubuf_block.h>
+#include <upipe/ubuf_block_mem.h>
+#include <upipe/uref.h>
+#include <upipe/uref_flow.h>
+#include <upipe/uref_block_flow.h>
+#include <upipe/uref_block.h>
+#include <upipe/uref_std.h>
+#include <upipe/upipe.h>
+#include <upipe-ts/upipe_ts_split.h>
+#include <upipe-ts/upipe_ts_spts_split.h>
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <inttypes.h>
+#include <assert.h>
+
+#include <bitstream/mpeg/ts.h>
+#include <bitstream/mpeg/psi.h>
+
+#define UDICT_POOL_DEPTH 0
+#define UREF_POOL_DEPTH 0
+#define UBUF_POOL_DEPTH 0
+#define UPROBE_LOG_LEVEL UPROBE_LOG_DEBUG
+
+static struct uref_mgr *uref_mgr;
+static struct ubuf_mgr *ubuf_mgr;
+static struct upipe *upipe_ts_spts_split;
+static uint8_t cc[8192];
+
+/** definition of our uprobe */
+static int catch(struct uprobe *uprobe, struct upipe *upipe,
+                 int event, va_list args)
+{
+    switch (event) {
+        default:
+            assert(0);
+            break;
+        case UPROBE_READY:
+        case UPROBE_DEAD:
+        case UPROBE_NEW_FLOW_DEF:
+            break;
+        case UPROBE_TS_SPLIT_ADD_PID:
+        case UPROBE_TS_SPLIT_DEL_PID: {
+            unsigned int signature = va_arg(args, unsigned int);
+            unsigned int pid = va_arg(args, unsigned int);
+            assert(signature == UPIPE_TS_SPLIT_SIGNATURE);
+            assert(pid == 0 || pid == 100 || pid == 101 || pid == 102 ||
+                   pid == 200 || pid == 201);
+            break;
+        }
+    }
+    return UBASE_ERR_NONE;
+}
+
+struct test {
+    uint64_t program;
+    unsigned int nb_pats;
+    unsigned int nb_packets;
+    struct upipe upipe;
+};
+
+/** helper phony pipe */
+static struct upipe *test_alloc(struct upipe_mgr *mgr, struct uprobe *uprobe,
+                                uint32_t signature, va_list args)
+{
+    struct uref *flow_def = va_arg(args, struct uref *);
+    struct test *test = malloc(sizeof(struct test));
+    assert(test != NULL);
+    ubase_assert(uref_flow_get_id(flow_def, &test->program));
+    upipe_init(&test->upipe, mgr, uprobe);
+    test->nb_pats = 0;
+    test->nb_packets = 0;
+    return &test->upipe;
+}
+
+/** helper phony pipe */
+static void test_input(struct upipe *upipe, struct uref *uref,
+                       struct upump **upump_p)
+{
+    struct test *test = container_of(upipe, struct test, upipe);
+    assert(uref != NULL);
+    const uint8_t *buffer;
+    int size = -1;
+    ubase_assert(uref_block_read(uref, 0, &size, &buffer));
+    assert(size == TS_SIZE);
+    assert(ts_validate(buffer));
+    uint16_t pid = ts_get_pid(buffer);
+    if (pid == PAT_PID) {
+        uint8_t section[PSI_MAX_SIZE + PSI_HEADER_SIZE];
+        assert(ts_get_unitstart(buffer));
+        assert(!buffer[TS_HEADER_SIZE]);
+        memcpy(section, buffer + TS_HEADER_SIZE + 1,
+               TS_SIZE - TS_HEADER_SIZE - 1);
+        assert(pat_validate(section));
+        assert(psi_check_crc(section));
+        assert(pat_get_tsid(section) == 42);
+        uint8_t *program = pat_get_program(section, 0);
+        assert(program != NULL);
+        assert(patn_get_program(program) == test->program);
+        assert(patn_get_pid(program) == test->program * 100);
+        assert(pat_get_program(section, 1) == NULL);
+        assert(ts_get_cc(buffer) == (test->nb_pats & 0xf));
+        test->nb_pats++;
+    } else
+        assert(pid / 100 == test->program);
+    uref_block_unmap(uref, 0);
+    uref_free(uref);
+    test->nb_packets++;
+}
+
+/** helper phony pipe */
+static int test_control(struct upipe *upipe, int command, va_list args)
+{
+    switch (command) {
+        case UPIPE_SET_FLOW_DEF:
+            return UBASE_ERR_NONE;
+        default:
+            assert(0);
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** helper phony pipe */
+static void test_free(struct upipe *upipe)
+{
+    struct test *test = container_of(upipe, struct test, upipe);
+    upipe_clean(upipe);
+    free(test);
+}
+
+/** helper phony pipe */
+static struct upipe_mgr test_mgr = {
+    .refcount = NULL,
+    .upipe_alloc = test_alloc,
+    .upipe_input = test_input,
+    .upipe_control = test_control
+};
+
+/** helper to prepare a TS packet */
+static uint8_t *test_packet(uint8_t *buffer, uint16_t pid)
+{
+    ts_pad(buffer);
+    ts_set_pid(buffer, pid);
+    ts_set_cc(buffer, cc[pid]);
+    cc[pid] = (cc[pid] + 1) & 0xf;
+    return buffer;
+}
+
+/** helper to send TS packets */
+static void test_send(const uint16_t *pids, unsigned int nb_pids)
+{
+    struct uref *uref = uref_block_alloc(uref_mgr, ubuf_mgr,
+                                         nb_pids * TS_SIZE);
+    assert(uref != NULL);
+    uint8_t *buffer;
+    int size = -1;
+    ubase_assert(uref_block_write(uref, 0, &size, &buffer));
+    assert(size == nb_pids * TS_SIZE);
+    for (unsigned int i = 0; i < nb_pids; i++)
+        test_packet(buffer + i * TS_SIZE, pids[i]);
+    uref_block_unmap(uref, 0);
+    upipe_input(upipe_ts_spts_split, uref, NULL);
+}
+
+/** helper to send a PSI section */
+static void test_send_section(uint16_t pid, uint8_t *section)
+{
+    struct uref *uref = uref_block_alloc(uref_mgr, ubuf_mgr, TS_SIZE);
+    assert(uref != NULL);
+    uint8_t *buffer;
+    int size = -1;
+    ubase_assert(uref_block_write(uref, 0, &size, &buffer));
+    assert(size == TS_SIZE);
+    test_packet(buffer, pid);
+    ts_set_unitstart(buffer);
+    buffer[TS_HEADER_SIZE] = 0;
+    psi_set_crc(section);
+    memcpy(buffer + TS_HEADER_SIZE + 1, section,
+           psi_get_length(section) + PSI_HEADER_SIZE);
+    uref_block_unmap(uref, 0);
+    upipe_input(upipe_ts_spts_split, uref, NULL);
+}
+
+/** helper to send a PAT */
+static void test_send_pat(void)
+{
+    uint8_t section[PSI_MAX_SIZE + PSI_HEADER_SIZE];
+    pat_init(section);
+    pat_set_length(section, 3 * PAT_PROGRAM_SIZE);
+    pat_set_tsid(section, 42);
+    psi_set_version(section, 0);
+    psi_set_current(section);
+    psi_set_section(section, 0);
+    psi_set_lastsection(section, 0);
+    for (uint16_t i = 0; i < 3; i++) {
+        uint8_t *program = pat_get_program(section, i);
+        patn_init(program);
+        /* program 0 is the NIT */
+        patn_set_program(program, i);
+        patn_set_pid(program, i ? i * 100 : 16);
+    }
+    test_send_section(PAT_PID, section);
+}
+
+/** helper to send a PMT */
+static void test_send_pmt(uint16_t program, unsigned int nb_es)
+{
+    uint8_t section[PSI_MAX_SIZE + PSI_HEADER_SIZE];
+    pmt_init(section);
+    pmt_set_length(section, nb_es * PMT_ES_SIZE);
+    pmt_set_program(section, program);
+    psi_set_version(section, 0);
+    psi_set_current(section);
+    pmt_set_pcrpid(section, program * 100 + 1);
+    pmt_set_desclength(section, 0);
+    for (uint8_t i = 0; i < nb_es; i++) {
+        uint8_t *es = pmt_get_es(section, i);
+        pmtn_init(es);
+        pmtn_set_streamtype(es, 0x2);
+        pmtn_set_pid(es, program * 100 + 1 + i);
+        pmtn_set_desclength(es, 0);
+    }
+    test_send_section(program * 100, section);
+}
+
+int main(int argc, char *argv[])
+{
+    struct umem_mgr *umem_mgr = umem_alloc_mgr_alloc();
+    assert(umem_mgr != NULL);
+    struct udict_mgr *udict_mgr = udict_inline_mgr_alloc(UDICT_POOL_DEPTH,
+                                                         umem_mgr, -1, -1);
+    assert(udict_mgr != NULL);
+    uref_mgr = uref_std_mgr_alloc(UREF_POOL_DEPTH, udict_mgr, 0);
+    assert(uref_mgr != NULL);
+    ubuf_mgr = ubuf_block_mem_mgr_alloc(UBUF_POOL_DEPTH, UBUF_POOL_DEPTH,
+                                        umem_mgr, 0, 0, -1, 0);
+    assert(ubuf_mgr != NULL);
+    struct uprobe uprobe;
+    uprobe_init(&uprobe, catch, NULL);
+    struct uprobe *uprobe_stdio = uprobe_stdio_alloc(&uprobe, stdout,
+                                                     UPROBE_LOG_LEVEL);
+    assert(uprobe_stdio != NULL);
+
+    struct uref *uref;
+    uref = uref_block_flow_alloc_def(uref_mgr, "mpegts.");
+    assert(uref != NULL);
+
+    struct upipe_mgr *upipe_ts_spts_split_mgr =
+        upipe_ts_spts_split_mgr_alloc();
+    assert(upipe_ts_spts_split_mgr != NULL);
+    upipe_ts_spts_split = upipe_void_alloc(upipe_ts_spts_split_mgr,
+            uprobe_pfx_alloc(uprobe_use(uprobe_stdio), UPROBE_LOG_LEVEL,
+                             "ts spts split"));
+    assert(upipe_ts_spts_split != NULL);
+    ubase_assert(upipe_set_flow_def(upipe_ts_spts_split, uref));
+
+    struct upipe *sinks[2], *outputs[2];
+    for (int i = 0; i < 2; i++) {
+        ubase_assert(uref_flow_set_id(uref, i + 1));
+        sinks[i] = upipe_flow_alloc(&test_mgr, uprobe_use(uprobe_stdio),
+                                    uref);
+        assert(sinks[i] != NULL);
+        outputs[i] = upipe_flow_alloc_sub(upipe_ts_spts_split,
+                uprobe_pfx_alloc_va(uprobe_use(uprobe_stdio),
+                                    UPROBE_LOG_LEVEL,
+                                    "ts spts split output %d", i + 1), uref);
+        assert(outputs[i] != NULL);
+        ubase_assert(upipe_set_output(outputs[i], sinks[i]));
+    }
+    uref_free(uref);
+    struct test *test1 = container_of(sinks[0], struct test, upipe);
+    struct test *test2 = container_of(sinks[1], struct test, upipe);
+
+    /* elementary streams are dropped until the PMT is known */
+    static const uint16_t es_pids[] = { 101, 102, 201, 300, 16 };
+    test_send(es_pids, 5);
+    assert(test1->nb_packets == 0);
+    assert(test2->nb_packets == 0);
+
+    test_send_pat();
+    assert(test1->nb_pats == 1);
+    assert(test2->nb_pats == 1);
+    test_send_pmt(1, 2);
+    test_send_pmt(2, 1);
+    assert(test1->nb_packets == 2);
+    assert(test2->nb_packets == 2);
+
+    /* a datagram, then single packets */
+    test_send(es_pids, 5);
+    assert(test1->nb_packets == 4);
+    assert(test2->nb_packets == 3);
+    for (int i = 0; i < 5; i++)
+        test_send(es_pids + i, 1);
+    assert(test1->nb_packets == 6);
+    assert(test2->nb_packets == 4);
+
+    /* the PAT is rewritten on each repetition */
+    test_send_pat();
+    test_send_pmt(1, 2);
+    assert(test1->nb_pats == 2);
+    assert(test2->nb_pats == 2);
+    assert(test1->nb_packets == 8);
+    assert(test2->nb_packets == 5);
+
+    /* the second elementary stream goes away from program 1 */
+    test_send_pmt(1, 1);
+    test_send(es_pids, 5);
+    assert(test1->nb_packets == 10);
+    assert(test2->nb_packets == 6);
+
+    upipe_release(outputs[0]);
+    test_send_pat();
+    test_send(es_pids, 5);
+    assert(test1->nb_packets == 10);
+    assert(test2->nb_packets == 8);
+
+    upipe_release(outputs[1]);
+    upipe_release(upipe_ts_spts_split);
+    upipe_mgr_release(upipe_ts_spts_split_mgr); // nop
+
+    test_free(sinks[0]);
+    test_free(sinks[1]);
+
+    uref_mgr_release(uref_mgr);
+    ubuf_mgr_release(ubuf_mgr);
+    udict_mgr_release(udict_mgr);
+    umem_mgr_release(umem_mgr);
+    uprobe_release(uprobe_stdio);
+
+    return 0;
+}
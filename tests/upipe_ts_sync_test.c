@@ -62,6 +62,7 @@
 #define UPROBE_LOG_LEVEL UPROBE_LOG_DEBUG
 
 static unsigned int nb_packets = 0;
+static unsigned int last_batch = 0;
 static int expect_loss = -1;
 
 /** definition of our uprobe */
@@ -101,16 +102,20 @@ static void test_input(struct upipe *upipe, struct uref *uref,
     assert(uref != NULL);
     size_t size;
     ubase_assert(uref_block_size(uref, &size));
-    assert(size == TS_SIZE);
+    assert(size && size % TS_SIZE == 0);
 
-    const uint8_t *buffer;
-    int rsize = 1;
-    ubase_assert(uref_block_read(uref, 0, &rsize, &buffer));
-    assert(rsize == 1);
-    assert(ts_validate(buffer));
-    uref_block_unmap(uref, 0);
+    last_batch = size / TS_SIZE;
+    for (int offset = 0; offset < size; offset += TS_SIZE) {
+        const uint8_t *buffer;
+        int rsize = 1;
+        ubase_assert(uref_block_read(uref, offset, &rsize, &buffer));
+        assert(rsize == 1);
+        assert(ts_validate(buffer));
+        uref_block_unmap(uref, offset);
+        assert(nb_packets);
+        nb_packets--;
+    }
     uref_free(uref);
-    nb_packets--;
 }
 
 /** helper phony pipe */
@@ -233,6 +238,60 @@ int main(int argc, char *argv[])
     nb_packets++;
     upipe_release(upipe_ts_sync);
     assert(!nb_packets);
+
+    /* batch mode */
+    uref = uref_block_flow_alloc_def(uref_mgr, NULL);
+    assert(uref != NULL);
+    upipe_ts_sync = upipe_void_alloc(upipe_ts_sync_mgr,
+            uprobe_pfx_alloc(uprobe_use(uprobe_stdio), UPROBE_LOG_LEVEL,
+                             "ts sync batch"));
+    assert(upipe_ts_sync != NULL);
+    ubase_assert(upipe_set_flow_def(upipe_ts_sync, uref));
+    ubase_assert(upipe_set_output(upipe_ts_sync, upipe_sink));
+    ubase_assert(upipe_ts_sync_set_sync(upipe_ts_sync, 3));
+    ubase_assert(upipe_ts_sync_set_batch(upipe_ts_sync, 7));
+    unsigned int batch;
+    ubase_assert(upipe_ts_sync_get_batch(upipe_ts_sync, &batch));
+    assert(batch == 7);
+    uref_free(uref);
+
+    expect_loss = -1;
+    uref = uref_block_alloc(uref_mgr, ubuf_mgr, 7 * TS_SIZE + 37);
+    assert(uref != NULL);
+    size = -1;
+    ubase_assert(uref_block_write(uref, 0, &size, &buffer));
+    assert(size == 7 * TS_SIZE + 37);
+    memset(buffer, 0, 37);
+    for (int i = 0; i < 7; i++)
+        ts_pad(buffer + 37 + i * TS_SIZE);
+    /* false positive with two sync words */
+    buffer[5] = 0x47;
+    buffer[5 + TS_SIZE] = 0x47;
+    uref_block_unmap(uref, 0);
+    /* the last two packets wait for the next sync words */
+    nb_packets += 5;
+    expect_loss = 5;
+    upipe_input(upipe_ts_sync, uref, NULL);
+    assert(!nb_packets);
+    assert(last_batch == 5);
+
+    uref = uref_block_alloc(uref_mgr, ubuf_mgr, 7 * TS_SIZE);
+    assert(uref != NULL);
+    size = -1;
+    ubase_assert(uref_block_write(uref, 0, &size, &buffer));
+    assert(size == 7 * TS_SIZE);
+    for (int i = 0; i < 7; i++)
+        ts_pad(buffer + i * TS_SIZE);
+    uref_block_unmap(uref, 0);
+    /* two packets from the first uref, then five from the second one */
+    nb_packets += 7;
+    upipe_input(upipe_ts_sync, uref, NULL);
+    assert(!nb_packets);
+    assert(last_batch == 5);
+
+    nb_packets += 2;
+    upipe_release(upipe_ts_sync);
+    assert(!nb_packets);
     upipe_mgr_release(upipe_ts_sync_mgr); // nop
 
     test_free(upipe_sink);
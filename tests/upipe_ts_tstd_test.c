@@ -64,6 +64,8 @@
 #define UPROBE_LOG_LEVEL UPROBE_LOG_VERBOSE
 
 static uint64_t cr_dts_delay = UINT64_MAX;
+static unsigned int nb_reports = 0;
+static struct upipe_ts_tstd_stats report;
 
 /** definition of our uprobe */
 static int catch(struct uprobe *uprobe, struct upipe *upipe,
@@ -79,6 +81,13 @@ static int catch(struct uprobe *uprobe, struct upipe *upipe,
         case UPROBE_SYNC_LOST:
         case UPROBE_NEW_FLOW_DEF:
             break;
+        case UPROBE_TS_TSTD_REPORT: {
+            uint32_t signature = va_arg(args, uint32_t);
+            assert(signature == UPIPE_TS_TSTD_SIGNATURE);
+            report = *va_arg(args, const struct upipe_ts_tstd_stats *);
+            nb_reports++;
+            break;
+        }
     }
     return UBASE_ERR_NONE;
 }
@@ -177,6 +186,7 @@ int main(int argc, char *argv[])
     ubase_assert(upipe_set_flow_def(upipe_ts_tstd, uref));
     ubase_assert(upipe_set_output(upipe_ts_tstd, upipe_sink));
     uref_free(uref);
+    ubase_assert(upipe_ts_tstd_set_monitor(upipe_ts_tstd, UCLOCK_FREQ / 2));
 
     uref = uref_block_alloc(uref_mgr, ubuf_mgr, 10);
     assert(uref != NULL);
@@ -218,6 +228,13 @@ int main(int argc, char *argv[])
     cr_dts_delay = UINT64_MAX;
     upipe_input(upipe_ts_tstd, uref, NULL);
     assert(cr_dts_delay == UCLOCK_FREQ / 10 + UCLOCK_FREQ / 20);
+    assert(nb_reports == 1);
+    assert(report.duration == UCLOCK_FREQ / 2);
+    assert(report.urefs == 5);
+    assert(report.octets == 130);
+    assert(!report.underflows && !report.overflows);
+    assert(report.min_fullness == 10);
+    assert(report.max_fullness == 90);
 
     uref = uref_block_alloc(uref_mgr, ubuf_mgr, 5);
     assert(uref != NULL);
@@ -226,6 +243,24 @@ int main(int argc, char *argv[])
     upipe_input(upipe_ts_tstd, uref, NULL);
     assert(cr_dts_delay == UCLOCK_FREQ / 5);
 
+    uref = uref_block_alloc(uref_mgr, ubuf_mgr, 100);
+    assert(uref != NULL);
+    uref_clock_set_dts_prog(uref, 7 * UCLOCK_FREQ / 10);
+    cr_dts_delay = UINT64_MAX;
+    upipe_input(upipe_ts_tstd, uref, NULL);
+    assert(cr_dts_delay == 0);
+
+    uref = uref_block_alloc(uref_mgr, ubuf_mgr, 5);
+    assert(uref != NULL);
+    uref_clock_set_dts_prog(uref, UCLOCK_FREQ);
+    upipe_input(upipe_ts_tstd, uref, NULL);
+    assert(nb_reports == 2);
+    assert(report.urefs == 3);
+    assert(report.octets == 110);
+    assert(report.underflows == 1);
+    assert(report.underflow_octets == 70);
+    assert(report.min_fullness == 0);
+
     upipe_release(upipe_ts_tstd);
     upipe_mgr_release(upipe_ts_tstd_mgr);
 
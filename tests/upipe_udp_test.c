@@ -50,10 +50,12 @@
 #include <upipe/uref.h>
 #include <upipe/uref_block.h>
 #include <upipe/uref_flow.h>
+#include <upipe/uref_clock.h>
 #include <upipe/uref_block_flow.h>
 #include <upipe/uref_std.h>
 #include <upipe/upump.h>
 #include <upump-ev/upump_ev.h>
+#include <upipe/config.h>
 #include <upipe/upipe.h>
 #include <upipe-modules/upipe_udp_source.h>
 #include <upipe-modules/upipe_udp_sink.h>
@@ -152,6 +154,8 @@ static void test_input(struct upipe *upipe, struct uref *uref,
     const uint8_t *rbuf;
     struct udpsrc_test *udpsrc_test = udpsrc_test_from_upipe(upipe);
     assert(uref != NULL);
+    uint64_t systime;
+    ubase_assert(uref_clock_get_cr_sys(uref, &systime));
 
     if ((rbuf = uref_block_peek(uref, 0, -1, buf))) {
         upipe_dbg_va(upipe, "Received string: %s", rbuf);
@@ -301,14 +305,37 @@ int main(int argc, char *argv[])
     ubase_assert(upipe_set_output(upipe_udpsrc, udpsrc_test));
     ubase_assert(upipe_set_output_size(upipe_udpsrc, READ_SIZE));
     ubase_assert(upipe_attach_uclock(upipe_udpsrc));
+    int timestamp;
+    ubase_assert(upipe_udpsrc_get_timestamp(upipe_udpsrc, &timestamp));
+    assert(timestamp == UPIPE_UDPSRC_TIMESTAMP_SOFTWARE);
+    ubase_nassert(upipe_udpsrc_set_timestamp(upipe_udpsrc,
+                UPIPE_UDPSRC_TIMESTAMP_HARDWARE + 1));
     srand(42);
 
     upipe_set_uri(upipe_udpsrc, "@127.0.0.1:42125");
     upipe_set_uri(upipe_udpsrc, NULL);
 
+#if defined(SO_ATTACH_REUSEPORT_CBPF) && defined(UPIPE_HAVE_LINUX_FILTER_H)
+    /* steer by RTP SSRC in a SO_REUSEPORT group of one socket */
+    int steering;
+    unsigned int nb_sockets;
+    ubase_assert(upipe_udpsrc_get_steering(upipe_udpsrc, &steering,
+                                           &nb_sockets));
+    assert(steering == UPIPE_UDPSRC_STEERING_NONE);
+    assert(nb_sockets == 1);
+    ubase_nassert(upipe_udpsrc_set_steering(upipe_udpsrc,
+                UPIPE_UDPSRC_STEERING_SSRC, 0));
+    ubase_assert(upipe_udpsrc_set_steering(upipe_udpsrc,
+                UPIPE_UDPSRC_STEERING_SSRC, 1));
+    const char *udp_options = "/reuseport";
+#else
+    const char *udp_options = "";
+#endif
+
     for (i=0; i < 10; i++) {
         port = ((rand() % 40000) + 1024);
-        snprintf(udp_uri, sizeof(udp_uri), "@127.0.0.1:%d", port);
+        snprintf(udp_uri, sizeof(udp_uri), "@127.0.0.1:%d%s", port,
+                 udp_options);
         printf("Trying uri: %s ...\n", udp_uri);
         if (( ret = ubase_check(upipe_set_uri(upipe_udpsrc, udp_uri)) )) {
             break;
@@ -352,7 +379,41 @@ int main(int argc, char *argv[])
     ubase_assert(upipe_set_flow_def(upipe_udpsink, flow_def));
     uref_free(flow_def);
 
+    /* pacing with timers by default */
+    uint64_t txtime_lead;
+    ubase_assert(upipe_udpsink_get_txtime(upipe_udpsink, &txtime_lead));
+    assert(txtime_lead == 0);
+    ubase_assert(upipe_udpsink_set_txtime(upipe_udpsink, 0));
+
+#ifdef UPIPE_HAVE_RECVMMSG
+    /* receive in batches */
+    unsigned int batch;
+    ubase_assert(upipe_udpsrc_get_batch(upipe_udpsrc, &batch));
+    assert(batch == 1);
+    ubase_nassert(upipe_udpsrc_set_batch(upipe_udpsrc, 0));
+    ubase_assert(upipe_udpsrc_set_batch(upipe_udpsrc, 8));
+    ubase_assert(upipe_udpsrc_get_batch(upipe_udpsrc, &batch));
+    assert(batch == 8);
+#endif
+
+#ifdef UPIPE_HAVE_SENDMMSG
+    /* send in batches */
+    unsigned int sink_batch;
+    uint64_t window;
+    ubase_assert(upipe_udpsink_get_batch(upipe_udpsink, &sink_batch, &window));
+    assert(sink_batch == 1);
+    ubase_nassert(upipe_udpsink_set_batch(upipe_udpsink,
+                                          UPIPE_UDPSINK_BATCH_MAX + 1, window));
+    ubase_assert(upipe_udpsink_set_batch(upipe_udpsink, 8, UCLOCK_FREQ / 1000));
+    ubase_assert(upipe_udpsink_get_batch(upipe_udpsink, &sink_batch, &window));
+    assert(sink_batch == 8);
+    assert(window == UCLOCK_FREQ / 1000);
+#endif
+
     /* reset source uri */
+    ubase_assert(upipe_udpsrc_set_steering(upipe_udpsrc,
+                UPIPE_UDPSRC_STEERING_NONE, 1));
+
     for (i=0; i < 10; i++) {
         port = ((rand() % 40000) + 1024);
         snprintf(udp_uri, sizeof(udp_uri), "@127.0.0.1:%d", port);
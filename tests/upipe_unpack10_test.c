@@ -198,9 +198,17 @@ int main(int argc, char *argv[])
     assert(end == &buffer[size]);
 
     uref_block_unmap(uref, 0);
+    struct uref *dup = uref_dup(uref);
+    assert(dup != NULL);
     upipe_input(upipe_unpack10, uref, NULL);
     assert(received_block);
 
+    /* again, with ranges of samples processed by several threads */
+    received_block = false;
+    ubase_assert(upipe_unpack10bit_set_threads(upipe_unpack10, 3));
+    upipe_input(upipe_unpack10, dup, NULL);
+    assert(received_block);
+
     upipe_release(upipe_unpack10);
     upipe_mgr_release(upipe_unpack10bit_mgr); // nop
 
@@ -316,6 +316,14 @@ int main(int argc, char **argv)
     struct uref *pic = uref_dup(input_uref);
     assert(pic);
     upipe_input(v210dec, pic, 0);
+    assert(test_sucessful);
+
+    /* send it again, processed by several threads */
+    test_sucessful = false;
+    ubase_assert(upipe_v210dec_set_threads(v210dec, 4));
+    pic = uref_dup(input_uref);
+    assert(pic);
+    upipe_input(v210dec, pic, 0);
 
     uref_free(in_flow_def);
     uref_free(out_flow_8);
@@ -297,6 +297,14 @@ int main(int argc, char **argv)
     struct uref *pic = uref_dup(input_uref);
     assert(pic);
     upipe_input(v210enc, pic, 0);
+    assert(test_sucessful);
+
+    /* send it again, processed by several threads */
+    test_sucessful = false;
+    ubase_assert(upipe_v210enc_set_threads(v210enc, 4));
+    pic = uref_dup(input_uref);
+    assert(pic);
+    upipe_input(v210enc, pic, 0);
 
     uref_free(in_flow_def);
     /* release v210enc pipe */
@@ -34,6 +34,7 @@
 #include <upipe/uref_std.h>
 #include <upipe/uref_void_flow.h>
 #include <upipe/uref_pic_flow.h>
+#include <upipe/uref_pic.h>
 #include <upipe/uref_clock.h>
 #include <upipe/uref_dump.h>
 #include <upipe/umem.h>
@@ -65,6 +66,8 @@ struct sink {
     struct upipe upipe;
     struct urefcount urefcount;
     uint64_t count;
+    /** first blank picture */
+    struct uref *first;
 };
 
 UPIPE_HELPER_UPIPE(sink, upipe, 0);
@@ -76,6 +79,7 @@ static void sink_free(struct upipe *upipe)
     struct sink *sink = sink_from_upipe(upipe);
 
     assert(sink->count == LIMIT);
+    uref_free(sink->first);
 
     upipe_throw_dead(upipe);
 
@@ -95,6 +99,7 @@ static struct upipe *sink_alloc(struct upipe_mgr *mgr,
 
     struct sink *sink = sink_from_upipe(upipe);
     sink->count = 0;
+    sink->first = NULL;
 
     upipe_throw_ready(upipe);
 
@@ -110,6 +115,23 @@ static void sink_input(struct upipe *upipe, struct uref *uref,
     assert(sink->count <= LIMIT);
     uref_dump(uref, upipe->uprobe);
     assert(uref->ubuf);
+
+    /* blank pictures are shared and read-only */
+    const uint8_t *r;
+    uint8_t *w;
+    ubase_assert(uref_pic_plane_read(uref, "y8", 0, 0, -1, -1, &r));
+    assert(r[0] == 0);
+    ubase_nassert(uref_pic_plane_write(uref, "y8", 0, 0, -1, -1, &w));
+    if (sink->first == NULL) {
+        uref_pic_plane_unmap(uref, "y8", 0, 0, -1, -1);
+        sink->first = uref;
+        return;
+    }
+    const uint8_t *r0;
+    ubase_assert(uref_pic_plane_read(sink->first, "y8", 0, 0, -1, -1, &r0));
+    assert(r == r0);
+    uref_pic_plane_unmap(sink->first, "y8", 0, 0, -1, -1);
+    uref_pic_plane_unmap(uref, "y8", 0, 0, -1, -1);
     uref_free(uref);
 }
 
@@ -191,7 +213,10 @@ int main(int argc, char *argv[])
     struct uref *flow_def = uref_pic_flow_alloc_def(uref_mgr, 1);
     ubase_assert(uref_pic_flow_set_hsize(flow_def, 10));
     ubase_assert(uref_pic_flow_set_vsize(flow_def, 10));
+    ubase_assert(uref_pic_flow_add_plane(flow_def, 1, 1, 1, "y8"));
     assert(flow_def);
+    struct uref *flow_def2 = uref_dup(flow_def);
+    assert(flow_def2);
 
     struct upipe *source = upipe_flow_alloc(upipe_vblk_mgr,
                               uprobe_pfx_alloc(uprobe_use(logger),
@@ -215,7 +240,11 @@ int main(int argc, char *argv[])
     for (unsigned i = 0; i < LIMIT; i++) {
         struct uref *uref = uref_alloc_control(uref_mgr);
         upipe_input(source, uref, NULL);
+        if (i == LIMIT / 2)
+            /* same format, the blank picture is kept */
+            ubase_assert(upipe_set_flow_def(source, flow_def2));
     }
+    uref_free(flow_def2);
 
     upipe_release(source);
     upipe_release(sink);
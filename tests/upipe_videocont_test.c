@@ -173,6 +173,21 @@ int main(int argc, char **argv)
         upipe_input(videocont, uref, NULL);
     }
 
+    struct upipe_videocont_stats stats;
+    ubase_assert(upipe_videocont_get_stats(videocont, &stats));
+    assert(stats.output == ITERATIONS);
+    assert(stats.blank == 0);
+    assert(stats.repeated == 0);
+    assert(stats.dropped == ITERATIONS);
+
+    /* repeat the last reference date: the same picture is reused */
+    struct uref *uref = uref_alloc(uref_mgr);
+    uref_clock_set_pts_sys(uref, UCLOCK_FREQ + (ITERATIONS - 1) * TOLERANCE * 10);
+    upipe_input(videocont, uref, NULL);
+    ubase_assert(upipe_videocont_get_stats(videocont, &stats));
+    assert(stats.output == ITERATIONS + 1);
+    assert(stats.repeated == 1);
+
     for (i=0; i < INPUT_NUM; i++) {
         upipe_release(subpipe[i]);
     }
@@ -0,0 +1,338 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/** @file
+ * @short unit tests for wpar pipes
+ */
+
+#undef NDEBUG
+
+#include <upipe/ulist.h>
+#include <upipe/uprobe.h>
+#include <upipe/uprobe_stdio.h>
+#include <upipe/uprobe_prefix.h>
+#include <upipe/umem.h>
+#include <upipe/umem_alloc.h>
+#include <upipe/udict.h>
+#include <upipe/udict_inline.h>
+#include <upipe/uref.h>
+#include <upipe/uref_std.h>
+#include <upipe/uref_flow.h>
+#include <upipe/uref_block_flow.h>
+#include <upipe/uref_pic.h>
+#include <upipe/upipe.h>
+#include <upipe-modules/upipe_worker_parallel.h>
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <assert.h>
+
+#define UDICT_POOL_DEPTH 0
+#define UREF_POOL_DEPTH 0
+#define UPROBE_LOG_LEVEL UPROBE_LOG_DEBUG
+#define NB_LANES 2
+
+/** number of the next uref expected by the sink */
+static uint64_t expected = 0;
+/** number of urefs received by the sink */
+static unsigned int nb_urefs = 0;
+/** number of flow definitions received by the sink */
+static int nb_flow_defs = 0;
+
+/** definition of our uprobe */
+static int catch(struct uprobe *uprobe, struct upipe *upipe,
+                 int event, va_list args)
+{
+    switch (event) {
+        default:
+            assert(0);
+            break;
+        case UPROBE_READY:
+        case UPROBE_DEAD:
+        case UPROBE_LOG:
+        case UPROBE_NEW_FLOW_DEF:
+            break;
+    }
+    return UBASE_ERR_NONE;
+}
+
+/** phony inner pipe holding the urefs until released */
+struct test_inner {
+    struct upipe *output;
+    struct uchain held;
+    unsigned int nb_held;
+    unsigned int nb_options;
+    struct upipe upipe;
+};
+
+/** inner pipes, in allocation order */
+static struct test_inner *inners[NB_LANES];
+static unsigned int nb_inners = 0;
+
+/** helper phony pipe */
+static struct upipe *test_inner_alloc(struct upipe_mgr *mgr,
+                                      struct uprobe *uprobe,
+                                      uint32_t signature, va_list args)
+{
+    assert(signature == UPIPE_VOID_SIGNATURE);
+    assert(nb_inners < NB_LANES);
+    struct test_inner *inner = malloc(sizeof(struct test_inner));
+    assert(inner != NULL);
+    upipe_init(&inner->upipe, mgr, uprobe);
+    inner->output = NULL;
+    ulist_init(&inner->held);
+    inner->nb_held = 0;
+    inner->nb_options = 0;
+    inners[nb_inners++] = inner;
+    return &inner->upipe;
+}
+
+/** helper phony pipe */
+static void test_inner_input(struct upipe *upipe, struct uref *uref,
+                             struct upump **upump_p)
+{
+    struct test_inner *inner = container_of(upipe, struct test_inner, upipe);
+    ulist_add(&inner->held, uref_to_uchain(uref));
+    inner->nb_held++;
+}
+
+/** helper phony pipe */
+static int test_inner_control(struct upipe *upipe, int command, va_list args)
+{
+    struct test_inner *inner = container_of(upipe, struct test_inner, upipe);
+    switch (command) {
+        case UPIPE_SET_OUTPUT:
+            inner->output = va_arg(args, struct upipe *);
+            return UBASE_ERR_NONE;
+        case UPIPE_SET_FLOW_DEF: {
+            struct uref *flow_def = va_arg(args, struct uref *);
+            assert(inner->output != NULL);
+            return upipe_set_flow_def(inner->output, flow_def);
+        }
+        case UPIPE_SET_OPTION:
+            inner->nb_options++;
+            return UBASE_ERR_NONE;
+        default:
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** outputs (or drops) the urefs held by an inner pipe */
+static void test_inner_release(unsigned int index, bool drop)
+{
+    struct test_inner *inner = inners[index];
+    struct uchain *uchain;
+    while ((uchain = ulist_pop(&inner->held)) != NULL) {
+        inner->nb_held--;
+        if (drop)
+            uref_free(uref_from_uchain(uchain));
+        else
+            upipe_input(inner->output, uref_from_uchain(uchain), NULL);
+    }
+}
+
+/** helper phony pipe */
+static void test_inner_free(struct upipe *upipe)
+{
+    struct test_inner *inner = container_of(upipe, struct test_inner, upipe);
+    assert(inner->nb_held == 0);
+    upipe_clean(upipe);
+    free(inner);
+}
+
+/** helper phony pipe */
+static struct upipe_mgr test_inner_mgr = {
+    .refcount = NULL,
+    .upipe_alloc = test_inner_alloc,
+    .upipe_input = test_inner_input,
+    .upipe_control = test_inner_control
+};
+
+/** helper phony pipe */
+static struct upipe *test_alloc(struct upipe_mgr *mgr, struct uprobe *uprobe,
+                                uint32_t signature, va_list args)
+{
+    struct upipe *upipe = malloc(sizeof(struct upipe));
+    assert(upipe != NULL);
+    upipe_init(upipe, mgr, uprobe);
+    return upipe;
+}
+
+/** helper phony pipe */
+static void test_input(struct upipe *upipe, struct uref *uref,
+                       struct upump **upump_p)
+{
+    uint64_t number;
+    ubase_assert(uref_pic_get_number(uref, &number));
+    assert(number >= expected);
+    expected = number + 1;
+    nb_urefs++;
+    uref_free(uref);
+}
+
+/** helper phony pipe */
+static int test_control(struct upipe *upipe, int command, va_list args)
+{
+    switch (command) {
+        case UPIPE_SET_FLOW_DEF: {
+            struct uref *flow_def = va_arg(args, struct uref *);
+            ubase_assert(uref_flow_match_def(flow_def, "block.foo."));
+            nb_flow_defs++;
+            return UBASE_ERR_NONE;
+        }
+        case UPIPE_REGISTER_REQUEST:
+        case UPIPE_UNREGISTER_REQUEST:
+            return UBASE_ERR_NONE;
+        default:
+            assert(0);
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** helper phony pipe */
+static void test_free(struct upipe *upipe)
+{
+    upipe_clean(upipe);
+    free(upipe);
+}
+
+/** helper phony pipe */
+static struct upipe_mgr wpar_test_mgr = {
+    .refcount = NULL,
+    .upipe_alloc = test_alloc,
+    .upipe_input = test_input,
+    .upipe_control = test_control
+};
+
+/** sends a numbered uref to the pipe */
+static void test_send(struct upipe *upipe, struct uref_mgr *uref_mgr,
+                      uint64_t number)
+{
+    struct uref *uref = uref_alloc(uref_mgr);
+    assert(uref != NULL);
+    ubase_assert(uref_pic_set_number(uref, number));
+    upipe_input(upipe, uref, NULL);
+}
+
+int main(int argc, char *argv[])
+{
+    struct umem_mgr *umem_mgr = umem_alloc_mgr_alloc();
+    assert(umem_mgr != NULL);
+    struct udict_mgr *udict_mgr = udict_inline_mgr_alloc(UDICT_POOL_DEPTH,
+                                                         umem_mgr, -1, -1);
+    assert(udict_mgr != NULL);
+    struct uref_mgr *uref_mgr = uref_std_mgr_alloc(UREF_POOL_DEPTH, udict_mgr,
+                                                   0);
+    assert(uref_mgr != NULL);
+    struct uprobe uprobe;
+    uprobe_init(&uprobe, catch, NULL);
+    struct uprobe *logger = uprobe_stdio_alloc(&uprobe, stdout,
+                                               UPROBE_LOG_LEVEL);
+    assert(logger != NULL);
+
+    struct upipe *upipe_sink = upipe_void_alloc(&wpar_test_mgr,
+                                                uprobe_use(logger));
+    assert(upipe_sink != NULL);
+
+    struct upipe_mgr *upipe_wpar_mgr = upipe_wpar_mgr_alloc();
+    assert(upipe_wpar_mgr != NULL);
+    struct upipe *upipe_wpar = upipe_wpar_alloc(upipe_wpar_mgr,
+            uprobe_pfx_alloc(uprobe_use(logger), UPROBE_LOG_LEVEL, "wpar"),
+            &test_inner_mgr, uprobe_use(logger), NULL, NB_LANES, 1, 1);
+    assert(upipe_wpar != NULL);
+    assert(nb_inners == NB_LANES);
+    ubase_assert(upipe_set_output(upipe_wpar, upipe_sink));
+
+    struct uref *uref = uref_block_flow_alloc_def(uref_mgr, "foo.");
+    assert(uref != NULL);
+    ubase_assert(upipe_set_flow_def(upipe_wpar, uref));
+    uref_free(uref);
+
+    ubase_assert(upipe_set_option(upipe_wpar, "foo", "bar"));
+    assert(inners[0]->nb_options == 1);
+    assert(inners[1]->nb_options == 1);
+
+    /* round robin, second lane finishes first */
+    ubase_assert(upipe_wpar_set_dispatch(upipe_wpar,
+                                         UPIPE_WPAR_DISPATCH_ROUND_ROBIN));
+    for (uint64_t i = 0; i < 4; i++)
+        test_send(upipe_wpar, uref_mgr, i);
+    assert(inners[0]->nb_held == 2);
+    assert(inners[1]->nb_held == 2);
+    test_inner_release(1, false);
+    assert(expected == 0);
+    test_inner_release(0, false);
+    assert(expected == 4);
+    assert(nb_flow_defs == 1);
+
+    /* lost uref */
+    ubase_assert(upipe_wpar_set_reorder_depth(upipe_wpar, 1));
+    test_send(upipe_wpar, uref_mgr, 4);
+    test_send(upipe_wpar, uref_mgr, 5);
+    test_inner_release(0, true);
+    test_inner_release(1, false);
+    assert(expected == 4);
+    test_send(upipe_wpar, uref_mgr, 6);
+    test_send(upipe_wpar, uref_mgr, 7);
+    test_inner_release(1, false);
+    assert(expected == 6);
+    test_inner_release(0, false);
+    assert(expected == 8);
+    assert(nb_urefs == 7);
+
+    /* load balancing */
+    ubase_assert(upipe_wpar_set_dispatch(upipe_wpar,
+                                         UPIPE_WPAR_DISPATCH_LOAD));
+    test_send(upipe_wpar, uref_mgr, 8);
+    test_send(upipe_wpar, uref_mgr, 9);
+    test_send(upipe_wpar, uref_mgr, 10);
+    assert(inners[0]->nb_held == 2);
+    assert(inners[1]->nb_held == 1);
+    test_inner_release(0, false);
+    assert(expected == 9);
+    /* round robin would pick the second lane, which is still busy */
+    test_send(upipe_wpar, uref_mgr, 11);
+    assert(inners[0]->nb_held == 1);
+    assert(inners[1]->nb_held == 1);
+    test_inner_release(1, false);
+    test_inner_release(0, false);
+    assert(expected == 12);
+    assert(nb_urefs == 11);
+
+    upipe_release(upipe_wpar);
+    upipe_mgr_release(upipe_wpar_mgr);
+
+    test_free(upipe_sink);
+
+    uref_mgr_release(uref_mgr);
+    udict_mgr_release(udict_mgr);
+    umem_mgr_release(umem_mgr);
+
+    uprobe_release(logger);
+    uprobe_clean(&uprobe);
+    return 0;
+}
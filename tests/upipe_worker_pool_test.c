@@ -0,0 +1,258 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short unit tests for worker pipes multiplexed onto a pool of threads
+ * (using upump_ev)
+ */
+
+#undef NDEBUG
+
+#include <upipe/ubase.h>
+#include <upipe/urefcount.h>
+#include <upipe/uprobe.h>
+#include <upipe/uprobe_stdio.h>
+#include <upipe/uprobe_prefix.h>
+#include <upipe-pthread/uprobe_pthread_upump_mgr.h>
+#include <upipe/upump.h>
+#include <upump-ev/upump_ev.h>
+#include <upipe/upipe.h>
+#include <upipe-modules/upipe_worker_source.h>
+#include <upipe-modules/upipe_transfer.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <assert.h>
+
+#define UPUMP_POOL 0
+#define UPUMP_BLOCKER_POOL 0
+#define XFER_QUEUE 255
+#define XFER_POOL 1
+#define WSRC_QUEUE 1
+#define NB_THREADS 3
+#define NB_WORKERS 6
+
+static struct uprobe *logger;
+/** threads of the pool */
+static pthread_t thread_ids[NB_THREADS];
+/** thread in which the remote pipe of each worker was released */
+static pthread_t freed_ids[NB_WORKERS];
+/** number of remote pipes allocated so far */
+static unsigned int nb_tests = 0;
+
+/** helper phony pipe */
+struct test_pipe {
+    struct urefcount urefcount;
+    unsigned int num;
+    struct upipe *output;
+    struct upipe upipe;
+};
+
+/** helper phony pipe */
+static void test_free(struct urefcount *urefcount)
+{
+    struct test_pipe *test_pipe =
+        container_of(urefcount, struct test_pipe, urefcount);
+    upipe_dbg(&test_pipe->upipe, "dead");
+    freed_ids[test_pipe->num] = pthread_self();
+    upipe_release(test_pipe->output);
+    urefcount_clean(&test_pipe->urefcount);
+    upipe_clean(&test_pipe->upipe);
+    free(test_pipe);
+}
+
+/** helper phony pipe */
+static struct upipe *test_alloc(struct upipe_mgr *mgr,
+                                struct uprobe *uprobe, uint32_t signature,
+                                va_list args)
+{
+    struct test_pipe *test_pipe = malloc(sizeof(struct test_pipe));
+    assert(test_pipe != NULL);
+    upipe_init(&test_pipe->upipe, mgr, uprobe);
+    urefcount_init(&test_pipe->urefcount, test_free);
+    test_pipe->upipe.refcount = &test_pipe->urefcount;
+    assert(nb_tests < NB_WORKERS);
+    test_pipe->num = nb_tests++;
+    test_pipe->output = NULL;
+    return &test_pipe->upipe;
+}
+
+/** helper phony pipe */
+static int test_control(struct upipe *upipe, int command, va_list args)
+{
+    struct test_pipe *test_pipe = container_of(upipe, struct test_pipe, upipe);
+    switch (command) {
+        case UPIPE_ATTACH_UPUMP_MGR:
+            return UBASE_ERR_NONE;
+        case UPIPE_GET_OUTPUT: {
+            struct upipe **p = va_arg(args, struct upipe **);
+            *p = test_pipe->output;
+            return UBASE_ERR_NONE;
+        }
+        case UPIPE_SET_OUTPUT: {
+            struct upipe *output = va_arg(args, struct upipe *);
+            upipe_release(test_pipe->output);
+            test_pipe->output = upipe_use(output);
+            return UBASE_ERR_NONE;
+        }
+        default:
+            assert(0);
+            return UBASE_ERR_UNHANDLED;
+    }
+}
+
+/** helper phony pipe */
+static struct upipe_mgr test_mgr = {
+    .refcount = NULL,
+    .upipe_alloc = test_alloc,
+    .upipe_input = NULL,
+    .upipe_control = test_control
+};
+
+static void *thread(void *_upipe_xfer_mgr)
+{
+    struct upipe_mgr *upipe_xfer_mgr = (struct upipe_mgr *)_upipe_xfer_mgr;
+
+    struct upump_mgr *upump_mgr = upump_ev_mgr_alloc_loop(UPUMP_POOL,
+                                                          UPUMP_BLOCKER_POOL);
+    assert(upump_mgr != NULL);
+    uprobe_pthread_upump_mgr_set(logger, upump_mgr);
+
+    ubase_assert(upipe_xfer_mgr_attach(upipe_xfer_mgr, upump_mgr));
+    upipe_mgr_release(upipe_xfer_mgr);
+
+    upump_mgr_run(upump_mgr, NULL);
+
+    upump_mgr_release(upump_mgr);
+
+    return NULL;
+}
+
+/** definition of our uprobe */
+static int catch(struct uprobe *uprobe, struct upipe *upipe, int event, va_list args)
+{
+    switch (event) {
+        case UPROBE_READY:
+        case UPROBE_DEAD:
+        case UPROBE_NEW_FLOW_DEF:
+        case UPROBE_NEED_UPUMP_MGR:
+        case UPROBE_STALLED:
+            break;
+        default:
+            assert(0);
+            break;
+    }
+    return UBASE_ERR_NONE;
+}
+
+/** @This allocates a worker source pipe around a new phony pipe.
+ *
+ * @param upipe_wsrc_mgr worker source manager
+ * @return pointer to the worker pipe
+ */
+static struct upipe *test_wsrc_alloc(struct upipe_mgr *upipe_wsrc_mgr)
+{
+    struct upipe *upipe_test = upipe_void_alloc(&test_mgr,
+            uprobe_pfx_alloc(uprobe_use(logger), UPROBE_LOG_VERBOSE,
+                             "test"));
+    assert(upipe_test != NULL);
+
+    struct upipe *upipe_handle = upipe_wsrc_alloc(upipe_wsrc_mgr,
+            uprobe_pfx_alloc(uprobe_use(logger), UPROBE_LOG_VERBOSE,
+                             "wsrc"),
+            upipe_test,
+            uprobe_pfx_alloc(uprobe_use(logger), UPROBE_LOG_VERBOSE,
+                             "wsrc_x"),
+            WSRC_QUEUE);
+    assert(upipe_handle != NULL);
+    return upipe_handle;
+}
+
+int main(int argc, char **argv)
+{
+    struct upump_mgr *upump_mgr =
+        upump_ev_mgr_alloc_default(UPUMP_POOL, UPUMP_BLOCKER_POOL);
+    assert(upump_mgr != NULL);
+
+    struct uprobe uprobe;
+    uprobe_init(&uprobe, catch, NULL);
+    logger = uprobe_stdio_alloc(&uprobe, stdout, UPROBE_LOG_VERBOSE);
+    assert(logger != NULL);
+    logger = uprobe_pthread_upump_mgr_alloc(logger);
+    assert(logger != NULL);
+    uprobe_pthread_upump_mgr_set(logger, upump_mgr);
+
+    struct upipe_mgr *upipe_xfer_mgrs[NB_THREADS];
+    for (unsigned int i = 0; i < NB_THREADS; i++) {
+        upipe_xfer_mgrs[i] = upipe_xfer_mgr_alloc(XFER_QUEUE, XFER_POOL, NULL);
+        assert(upipe_xfer_mgrs[i] != NULL);
+        upipe_mgr_use(upipe_xfer_mgrs[i]);
+        assert(pthread_create(&thread_ids[i], NULL, thread,
+                              upipe_xfer_mgrs[i]) == 0);
+    }
+
+    struct upipe_mgr *upipe_wsrc_mgr =
+        upipe_wsrc_pool_mgr_alloc(upipe_xfer_mgrs, NB_THREADS);
+    assert(upipe_wsrc_mgr != NULL);
+    for (unsigned int i = 0; i < NB_THREADS; i++)
+        upipe_mgr_release(upipe_xfer_mgrs[i]);
+
+    /* workers are spread onto the least loaded threads, that is 0, 1, 2,
+     * 0 and 1 */
+    struct upipe *upipe_handles[NB_WORKERS];
+    for (unsigned int i = 0; i < NB_WORKERS - 1; i++)
+        upipe_handles[i] = test_wsrc_alloc(upipe_wsrc_mgr);
+
+    /* releasing both workers of thread 1 makes it the least loaded one */
+    upipe_release(upipe_handles[1]);
+    upipe_release(upipe_handles[4]);
+    upipe_handles[5] = test_wsrc_alloc(upipe_wsrc_mgr);
+
+    upipe_mgr_release(upipe_wsrc_mgr);
+    for (unsigned int i = 0; i < NB_WORKERS; i++)
+        if (i != 1 && i != 4)
+            upipe_release(upipe_handles[i]);
+
+    upump_mgr_run(upump_mgr, NULL);
+
+    uprobe_err(logger, NULL, "joining");
+    for (unsigned int i = 0; i < NB_THREADS; i++)
+        assert(!pthread_join(thread_ids[i], NULL));
+    uprobe_err(logger, NULL, "joined");
+
+    static const unsigned int expected[NB_WORKERS] = { 0, 1, 2, 0, 1, 1 };
+    assert(nb_tests == NB_WORKERS);
+    for (unsigned int i = 0; i < NB_WORKERS; i++)
+        assert(pthread_equal(freed_ids[i], thread_ids[expected[i]]));
+
+    upump_mgr_release(upump_mgr);
+    uprobe_release(logger);
+    uprobe_clean(&uprobe);
+
+    return 0;
+}
@@ -263,6 +263,10 @@ int main(int argc, char **argv)
     ubase_assert(upipe_x264_set_default_preset(x264, "faster", NULL));
     ubase_assert(upipe_x264_set_profile(x264, "high"));
     ubase_assert(upipe_x264_set_default(x264));
+    ubase_nassert(upipe_x264_set_lookahead(x264, -1));
+    ubase_assert(upipe_x264_set_lookahead(x264, 10));
+    ubase_assert(upipe_x264_set_threads(x264, 2));
+    ubase_assert(upipe_x264_set_load_control(x264, true));
 
     /* encoding test */
     for (counter = 0; counter < LIMIT; counter ++) {
@@ -264,6 +264,11 @@ int main(int argc, char **argv)
     ubase_assert(upipe_x265_set_default_preset(x265, "faster", NULL));
     ubase_assert(upipe_x265_set_profile(x265, "mainstillpicture"));
     ubase_assert(upipe_x265_set_default(x265, 0));
+    ubase_assert(upipe_x265_set_load_control(x265, true));
+    ubase_assert(upipe_x265_set_pools(x265, "+"));
+    ubase_assert(upipe_x265_set_pools_local(x265, true));
+    ubase_assert(upipe_x265_set_frame_threads(x265, 2));
+    ubase_assert(upipe_x265_set_wpp(x265, true));
     ubase_assert(upipe_x265_set_default_preset(x265, "ultrafast", NULL));
 
     /* disable assembly (not valgrind safe) */
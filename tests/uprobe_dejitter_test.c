@@ -87,6 +87,11 @@ int main(int argc, char **argv)
                                                            true, 1);
     assert(uprobe_dejitter != NULL);
 
+    ubase_nassert(uprobe_dejitter_get_stats(uprobe_dejitter,
+                                            &(struct uprobe_dejitter_stats){}));
+    ubase_assert(uprobe_dejitter_set_stats(uprobe_dejitter,
+                                           UINT32_MAX));
+
     struct upipe test_pipe;
     test_pipe.uprobe = uprobe_dejitter;
     struct upipe *upipe = &test_pipe;
@@ -115,6 +120,19 @@ int main(int argc, char **argv)
     ubase_assert(uref_clock_get_pts_sys(uref, &pts));
     assert(pts == systime + 2002);
 
+    /* the first reference is a discontinuity and is not accounted for */
+    struct uprobe_dejitter_stats stats;
+    ubase_assert(uprobe_dejitter_get_stats(uprobe_dejitter, &stats));
+    assert(stats.count == 1);
+    assert(stats.duration == 0);
+    assert(stats.jitter.min == stats.jitter.max);
+    assert(stats.jitter.p50 == stats.jitter.max);
+    assert(stats.error.p999 == stats.error.max);
+    assert(stats.deviation.min > 0);
+
+    ubase_assert(uprobe_dejitter_set_stats(uprobe_dejitter, 0));
+    ubase_nassert(uprobe_dejitter_get_stats(uprobe_dejitter, &stats));
+
     uref_free(uref);
     uprobe_release(uprobe_dejitter);
     uprobe_release(logger);
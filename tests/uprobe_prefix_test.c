@@ -37,6 +37,17 @@
 #include <string.h>
 #include <assert.h>
 
+static unsigned int nb_events = 0;
+
+/** definition of our uprobe */
+static int catch(struct uprobe *uprobe, struct upipe *upipe,
+                 int event, va_list args)
+{
+    assert(event == UPROBE_READY);
+    nb_events++;
+    return UBASE_ERR_NONE;
+}
+
 int main(int argc, char **argv)
 {
     struct uprobe *uprobe2 = uprobe_stdio_alloc(NULL, stdout, UPROBE_LOG_DEBUG);
@@ -61,5 +72,25 @@ int main(int argc, char **argv)
     uprobe_release(uprobe1);
 
     uprobe_release(uprobe2);
+
+    /* events not handled by the stdio and prefix probes skip them */
+    struct uprobe uprobe;
+    uprobe_init(&uprobe, catch, NULL);
+    uprobe_set_event_mask(&uprobe, UPROBE_EVENT_MASK(UPROBE_READY));
+    assert(!uprobe_log_enabled(&uprobe, UPROBE_LOG_ERROR));
+    uprobe2 = uprobe_stdio_alloc(&uprobe, stdout, UPROBE_LOG_NOTICE);
+    assert(uprobe2 != NULL);
+    uprobe1 = uprobe_pfx_alloc(uprobe2, UPROBE_LOG_WARNING, "pfx");
+    assert(uprobe1 != NULL);
+    assert(uprobe_log_enabled(uprobe2, UPROBE_LOG_NOTICE));
+    assert(!uprobe_log_enabled(uprobe2, UPROBE_LOG_DEBUG));
+    assert(uprobe_log_enabled(uprobe1, UPROBE_LOG_WARNING));
+    assert(!uprobe_log_enabled(uprobe1, UPROBE_LOG_NOTICE));
+    ubase_assert(uprobe_throw(uprobe1, NULL, UPROBE_READY));
+    ubase_nassert(uprobe_throw(uprobe1, NULL, UPROBE_DEAD));
+    assert(nb_events == 1);
+    uprobe_notice(uprobe1, NULL, "This is a notice that you shouldn't see");
+    uprobe_release(uprobe1);
+    uprobe_clean(&uprobe);
     return 0;
 }
@@ -0,0 +1,134 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short unit tests for uprobe_pthread_log implementation
+ */
+
+#undef NDEBUG
+
+#include <upipe/ulist.h>
+#include <upipe/uclock.h>
+#include <upipe/uprobe.h>
+#include <upipe/uprobe_prefix.h>
+#include <upipe-pthread/uprobe_pthread_log.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <assert.h>
+#include <pthread.h>
+
+#define QUEUE_LENGTH 16
+#define NB_THREADS 4
+#define NB_MSGS 1000
+#define NB_LIMITED 50
+#define BURST 5
+
+static struct uprobe *uprobe;
+static pthread_t main_thread;
+static unsigned int nb_logged = 0;
+static unsigned int nb_reports = 0;
+
+/** definition of our uprobe */
+static int catch(struct uprobe *uprobe, struct upipe *upipe,
+                 int event, va_list args)
+{
+    assert(event == UPROBE_LOG);
+    assert(upipe == NULL);
+    assert(!pthread_equal(pthread_self(), main_thread));
+
+    struct ulog *ulog = va_arg(args, struct ulog *);
+    if (strstr(ulog->msg, "log messages dropped") != NULL) {
+        nb_reports++;
+        return UBASE_ERR_NONE;
+    }
+    assert(ulog->level == UPROBE_LOG_NOTICE);
+    assert(!strncmp(ulog->msg, "message ", strlen("message ")));
+
+    struct uchain *uchain = ulist_peek(&ulog->prefixes);
+    assert(uchain != NULL);
+    struct ulog_pfx *ulog_pfx = ulog_pfx_from_uchain(uchain);
+    assert(!strcmp(ulog_pfx->tag, "thread"));
+    nb_logged++;
+    return UBASE_ERR_NONE;
+}
+
+static void *thread(void *unused)
+{
+    struct uprobe *uprobe_pfx =
+        uprobe_pfx_alloc(uprobe_use(uprobe), UPROBE_LOG_DEBUG, "thread");
+    assert(uprobe_pfx != NULL);
+    for (unsigned int i = 0; i < NB_MSGS; i++)
+        uprobe_notice_va(uprobe_pfx, NULL, "message %u", i);
+    uprobe_release(uprobe_pfx);
+    return NULL;
+}
+
+int main(int argc, char **argv)
+{
+    struct uprobe uprobe_catch;
+    uprobe_init(&uprobe_catch, catch, NULL);
+    uprobe_set_event_mask(&uprobe_catch, UPROBE_EVENT_MASK(UPROBE_LOG));
+    uprobe_set_log_level(&uprobe_catch, UPROBE_LOG_DEBUG);
+    main_thread = pthread_self();
+
+    uprobe = uprobe_pthread_log_alloc(uprobe_use(&uprobe_catch),
+                                      QUEUE_LENGTH);
+    assert(uprobe != NULL);
+    assert(!uprobe_log_enabled(uprobe, UPROBE_LOG_VERBOSE));
+    assert(uprobe_log_enabled(uprobe, UPROBE_LOG_DEBUG));
+    uprobe_pthread_log_set_rate_limit(uprobe, 0, 0);
+
+    unsigned int i;
+    pthread_t ids[NB_THREADS];
+    for (i = 0; i < NB_THREADS; i++)
+        assert(pthread_create(&ids[i], NULL, thread, NULL) == 0);
+    for (i = 0; i < NB_THREADS; i++)
+        assert(pthread_join(ids[i], NULL) == 0);
+
+    /* the same site, with different numbers, is rate-limited */
+    uprobe_pthread_log_set_rate_limit(uprobe, BURST, UCLOCK_FREQ * 60);
+    struct uprobe *uprobe_pfx =
+        uprobe_pfx_alloc(uprobe_use(uprobe), UPROBE_LOG_DEBUG, "thread");
+    assert(uprobe_pfx != NULL);
+    for (i = 0; i < NB_LIMITED; i++)
+        uprobe_notice_va(uprobe_pfx, NULL, "message %u", i);
+    uprobe_release(uprobe_pfx);
+
+    uint64_t dropped, limited;
+    uprobe_pthread_log_get_dropped(uprobe, &dropped, &limited);
+    assert(limited == NB_LIMITED - BURST);
+
+    /* the pending messages are logged before the thread stops */
+    uprobe_release(uprobe);
+    printf("logged %u, dropped %"PRIu64"\n", nb_logged, dropped);
+    assert(nb_logged + dropped + limited == NB_THREADS * NB_MSGS + NB_LIMITED);
+    assert(nb_reports > 0);
+
+    uprobe_clean(&uprobe_catch);
+    return 0;
+}
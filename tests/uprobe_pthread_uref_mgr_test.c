@@ -0,0 +1,188 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+
+/** @file
+ * @short unit tests for uprobe_pthread_uref_mgr implementation
+ */
+
+#undef NDEBUG
+
+#include <upipe/uprobe.h>
+#include <upipe-pthread/uprobe_pthread_uref_mgr.h>
+#include <upipe/umem.h>
+#include <upipe/umem_alloc.h>
+#include <upipe/uref.h>
+#include <upipe/uref_block_flow.h>
+#include <upipe/ubuf.h>
+#include <upipe/urequest.h>
+#include <upipe/upipe.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <pthread.h>
+
+#define UDICT_POOL_DEPTH 5
+#define UREF_POOL_DEPTH 5
+#define UBUF_POOL_DEPTH 5
+#define UBUF_SHARED_POOL_DEPTH 1
+#define NB_THREADS 10
+
+static struct uprobe *uprobe;
+static struct uref_mgr *uref_mgrs[NB_THREADS];
+
+/** helper phony pipe to test uprobe_pthread_uref_mgr */
+static struct upipe *uprobe_test_alloc(struct upipe_mgr *mgr,
+                                       struct uprobe *uprobe,
+                                       uint32_t signature, va_list args)
+{
+    struct upipe *upipe = malloc(sizeof(struct upipe));
+    assert(upipe != NULL);
+    upipe_init(upipe, mgr, uprobe);
+    return upipe;
+}
+
+/** helper phony pipe to test uprobe_pthread_uref_mgr */
+static void uprobe_test_free(struct upipe *upipe)
+{
+    upipe_clean(upipe);
+    free(upipe);
+}
+
+/** helper phony pipe to test uprobe_pthread_uref_mgr */
+static struct upipe_mgr uprobe_test_mgr = {
+    .refcount = NULL,
+    .upipe_alloc = uprobe_test_alloc,
+    .upipe_input = NULL,
+    .upipe_control = NULL
+};
+
+/** provides a uref manager */
+static int provide_uref_mgr(struct urequest *urequest, va_list args)
+{
+    struct uref_mgr **uref_mgr_p = urequest_get_opaque(urequest,
+                                                       struct uref_mgr **);
+    *uref_mgr_p = va_arg(args, struct uref_mgr *);
+    return UBASE_ERR_NONE;
+}
+
+/** provides a ubuf manager */
+static int provide_ubuf_mgr(struct urequest *urequest, va_list args)
+{
+    struct ubuf_mgr **ubuf_mgr_p = urequest_get_opaque(urequest,
+                                                       struct ubuf_mgr **);
+    *ubuf_mgr_p = va_arg(args, struct ubuf_mgr *);
+    struct uref *flow_def = va_arg(args, struct uref *);
+    uref_free(flow_def);
+    return UBASE_ERR_NONE;
+}
+
+static struct uref_mgr *get_uref_mgr(struct upipe *upipe)
+{
+    struct uref_mgr *uref_mgr = NULL;
+    struct urequest request;
+    urequest_init_uref_mgr(&request, provide_uref_mgr, NULL);
+    urequest_set_opaque(&request, &uref_mgr);
+    ubase_assert(upipe_throw_provide_request(upipe, &request));
+    urequest_clean(&request);
+    assert(uref_mgr != NULL);
+    return uref_mgr;
+}
+
+static struct ubuf_mgr *get_ubuf_mgr(struct upipe *upipe,
+                                     struct uref *flow_def)
+{
+    struct ubuf_mgr *ubuf_mgr = NULL;
+    struct urequest request;
+    urequest_init_ubuf_mgr(&request, uref_dup(flow_def), provide_ubuf_mgr,
+                           NULL);
+    urequest_set_opaque(&request, &ubuf_mgr);
+    ubase_assert(upipe_throw_provide_request(upipe, &request));
+    urequest_clean(&request);
+    assert(ubuf_mgr != NULL);
+    return ubuf_mgr;
+}
+
+static void *thread(void *_i)
+{
+    unsigned int i = (uintptr_t)_i;
+    struct upipe *upipe = upipe_void_alloc(&uprobe_test_mgr,
+                                           uprobe_use(uprobe));
+    assert(upipe != NULL);
+
+    struct uref_mgr *uref_mgr = get_uref_mgr(upipe);
+    struct uref_mgr *uref_mgr2 = get_uref_mgr(upipe);
+    assert(uref_mgr == uref_mgr2);
+    uref_mgr_release(uref_mgr2);
+    uref_mgrs[i] = uref_mgr;
+
+    struct uref *flow_def = uref_block_flow_alloc_def(uref_mgr, NULL);
+    assert(flow_def != NULL);
+    struct ubuf_mgr *ubuf_mgr = get_ubuf_mgr(upipe, flow_def);
+    struct ubuf_mgr *ubuf_mgr2 = get_ubuf_mgr(upipe, flow_def);
+    assert(ubuf_mgr == ubuf_mgr2);
+    ubuf_mgr_release(ubuf_mgr2);
+    ubuf_mgr_release(ubuf_mgr);
+
+    ubase_assert(uprobe_pthread_uref_mgr_set_depths(uprobe, 0, 0, 0, 0));
+    uref_mgr2 = get_uref_mgr(upipe);
+    assert(uref_mgr2 != uref_mgr);
+    uref_mgr_release(uref_mgr2);
+
+    uref_free(flow_def);
+    uprobe_test_free(upipe);
+    return NULL;
+}
+
+int main(int argc, char **argv)
+{
+    struct umem_mgr *umem_mgr = umem_alloc_mgr_alloc();
+    assert(umem_mgr != NULL);
+    uprobe = uprobe_pthread_uref_mgr_alloc(NULL, umem_mgr, UDICT_POOL_DEPTH,
+                                           UREF_POOL_DEPTH, UBUF_POOL_DEPTH,
+                                           UBUF_SHARED_POOL_DEPTH);
+    assert(uprobe != NULL);
+
+    unsigned int i, j;
+    pthread_t ids[NB_THREADS];
+    for (i = 0; i < NB_THREADS; i++)
+        assert(pthread_create(&ids[i], NULL, thread,
+                              (void *)(uintptr_t)i) == 0);
+    for (i = 0; i < NB_THREADS; i++)
+        assert(pthread_join(ids[i], NULL) == 0);
+
+    /* each thread got its own manager */
+    for (i = 0; i < NB_THREADS; i++)
+        for (j = i + 1; j < NB_THREADS; j++)
+            assert(uref_mgrs[i] != uref_mgrs[j]);
+    for (i = 0; i < NB_THREADS; i++)
+        uref_mgr_release(uref_mgrs[i]);
+
+    uprobe_release(uprobe);
+    umem_mgr_release(umem_mgr);
+    return 0;
+}
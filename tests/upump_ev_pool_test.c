@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short unit tests for pools of ev event loops
+ */
+
+#undef NDEBUG
+
+#include <upipe/upump.h>
+#include <upump-ev/upump_ev.h>
+
+#include <stdio.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <assert.h>
+
+#define UPUMP_POOL 1
+#define UPUMP_BLOCKER_POOL 1
+#define NB_LOOPS 2
+
+static struct upump_mgr *mgr;
+static struct upump *timer1;
+static struct upump *timer2;
+static struct upump *idler;
+static pthread_t thread1, thread2, thread_idler;
+static sem_t sem;
+
+static void idler_cb(struct upump *upump)
+{
+    thread_idler = pthread_self();
+    upump_stop(upump);
+    sem_post(&sem);
+}
+
+static void timer1_cb(struct upump *upump)
+{
+    thread1 = pthread_self();
+    /* allocated from the loop, so it stays in the same thread */
+    idler = upump_alloc_idler(mgr, idler_cb, NULL, NULL);
+    assert(idler != NULL);
+    upump_start(idler);
+    sem_post(&sem);
+}
+
+static void timer2_cb(struct upump *upump)
+{
+    thread2 = pthread_self();
+    sem_post(&sem);
+}
+
+int main(int argc, char **argv)
+{
+    assert(sem_init(&sem, 0, 0) == 0);
+    mgr = upump_ev_pool_mgr_alloc(NB_LOOPS, UPUMP_POOL, UPUMP_BLOCKER_POOL);
+    assert(mgr != NULL);
+
+    timer1 = upump_alloc_timer(mgr, timer1_cb, NULL, NULL, 1, 0);
+    assert(timer1 != NULL);
+    ubase_assert(upump_ev_pool_mgr_rebalance(mgr));
+    timer2 = upump_alloc_timer(mgr, timer2_cb, NULL, NULL, 1, 0);
+    assert(timer2 != NULL);
+    upump_start(timer1);
+    upump_start(timer2);
+
+    for (int i = 0; i < 3; i++)
+        sem_wait(&sem);
+    assert(!pthread_equal(thread1, pthread_self()));
+    assert(!pthread_equal(thread2, pthread_self()));
+    assert(!pthread_equal(thread1, thread2));
+    assert(pthread_equal(thread1, thread_idler));
+
+    upump_free(timer1);
+    upump_free(timer2);
+    upump_free(idler);
+    upump_mgr_release(mgr);
+    sem_destroy(&sem);
+    return 0;
+}
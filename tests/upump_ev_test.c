@@ -29,6 +29,7 @@
 
 #undef NDEBUG
 
+#include <upipe/uclock.h>
 #include <upipe/upump.h>
 #include <upipe/upump_blocker.h>
 #include <upump-ev/upump_ev.h>
@@ -136,6 +137,14 @@ int main(int argc, char **argv)
     assert(bytes_read);
     assert(bytes_read == bytes_written);
 
+    /* Same in busy-poll mode */
+    ubase_assert(upump_ev_mgr_set_busy_poll(mgr, UCLOCK_FREQ / 1000));
+    bytes_read = bytes_written = 0;
+    upump_start(write_idler);
+    upump_mgr_run(mgr, NULL);
+    assert(bytes_read);
+    assert(bytes_read == bytes_written);
+
     /* Clean up */
     upump_free(write_idler);
     upump_free(write_watcher);
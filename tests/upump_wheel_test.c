@@ -0,0 +1,147 @@
+/*
+ * Copyright (C) 2026 agent
+ *
+ * Authors: agent <agent@local>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining
+ * a copy of this software and associated documentation files (the
+ * "Software"), to deal in the Software without restriction, including
+ * without limitation the rights to use, copy, modify, merge, publish,
+ * distribute, sublicense, and/or sell copies of the Software, and to
+ * permit persons to whom the Software is furnished to do so, subject
+ * to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+ * CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+ * TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+ * SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/** @file
+ * @short unit tests for the timer wheel upump manager
+ */
+
+#undef NDEBUG
+
+#include <upipe/uclock.h>
+#include <upipe/uclock_std.h>
+#include <upipe/upump.h>
+#include <upipe/upump_wheel.h>
+#include <upump-ev/upump_ev.h>
+
+#include <stdio.h>
+#include <assert.h>
+
+#define UPUMP_POOL 4
+#define UPUMP_BLOCKER_POOL 1
+#define NB_TIMERS 8
+/** duration of a slot (1 ms) */
+#define GRANULARITY (UCLOCK_FREQ / 1000)
+
+static struct uclock *uclock;
+static struct upump_mgr *mgr;
+static struct upump *timers[NB_TIMERS];
+static struct upump *repeat_timer;
+static struct upump *rearm_timer;
+static unsigned int nb_fired = 0;
+static unsigned int nb_repeats = 0;
+static unsigned int nb_rearms = 0;
+static int last = NB_TIMERS;
+static uint64_t start;
+
+static void timer_cb(struct upump *upump)
+{
+    int i = upump_get_opaque(upump, intptr_t);
+    uint64_t now = uclock_now(uclock);
+    /* timers fire in the order of their deadlines, never early */
+    assert(i < last);
+    assert(now - start >= (i ? (uint64_t)(NB_TIMERS - i) * 10 : 300) *
+                          GRANULARITY);
+    last = i;
+    nb_fired++;
+}
+
+static void repeat_cb(struct upump *upump)
+{
+    if (++nb_repeats == 5)
+        upump_stop(upump);
+}
+
+static void rearm_cb(struct upump *upump)
+{
+    /* a one-shot timer may be started again from its callback */
+    if (++nb_rearms < 3)
+        upump_start(upump);
+}
+
+int main(int argc, char **argv)
+{
+    struct upump_mgr *ev_mgr =
+        upump_ev_mgr_alloc_default(UPUMP_POOL, UPUMP_BLOCKER_POOL);
+    assert(ev_mgr != NULL);
+    uclock = uclock_std_alloc(0);
+    assert(uclock != NULL);
+    assert(upump_wheel_mgr_alloc(NULL, uclock, GRANULARITY,
+                                 UPUMP_POOL, UPUMP_BLOCKER_POOL) == NULL);
+    assert(upump_wheel_mgr_alloc(ev_mgr, uclock, 0,
+                                 UPUMP_POOL, UPUMP_BLOCKER_POOL) == NULL);
+    mgr = upump_wheel_mgr_alloc(ev_mgr, uclock, GRANULARITY,
+                                UPUMP_POOL, UPUMP_BLOCKER_POOL);
+    assert(mgr != NULL);
+    upump_mgr_release(ev_mgr);
+
+    /* timers are started in the reverse order of their deadlines, the last
+     * one beyond the first level of the wheel */
+    start = uclock_now(uclock);
+    for (int i = 0; i < NB_TIMERS; i++) {
+        uint64_t after = (uint64_t)(NB_TIMERS - i) * 10 * GRANULARITY;
+        if (!i)
+            after = 300 * GRANULARITY;
+        timers[i] = upump_alloc_timer(mgr, timer_cb, (void *)(intptr_t)i,
+                                      NULL, after, 0);
+        assert(timers[i] != NULL);
+        upump_start(timers[i]);
+    }
+    /* timers that are stopped never fire */
+    upump_stop(timers[0]);
+    upump_start(timers[0]);
+    upump_stop(timers[0]);
+
+    repeat_timer = upump_alloc_timer(mgr, repeat_cb, NULL, NULL,
+                                     GRANULARITY, 2 * GRANULARITY);
+    assert(repeat_timer != NULL);
+    upump_start(repeat_timer);
+    rearm_timer = upump_alloc_timer(mgr, rearm_cb, NULL, NULL,
+                                    5 * GRANULARITY, 0);
+    assert(rearm_timer != NULL);
+    upump_start(rearm_timer);
+
+    upump_mgr_run(mgr, NULL);
+    assert(nb_fired == NB_TIMERS - 1);
+    assert(last == 1);
+    assert(nb_repeats == 5);
+    assert(nb_rearms == 3);
+
+    /* a timer beyond the first level is cascaded and fires */
+    last = NB_TIMERS;
+    nb_fired = 0;
+    start = uclock_now(uclock);
+    upump_start(timers[0]);
+    upump_mgr_run(mgr, NULL);
+    assert(nb_fired == 1);
+    assert(last == 0);
+
+    for (int i = 0; i < NB_TIMERS; i++)
+        upump_free(timers[i]);
+    upump_free(repeat_timer);
+    upump_free(rearm_timer);
+    upump_mgr_release(mgr);
+    uclock_release(uclock);
+    return 0;
+}
@@ -31,10 +31,12 @@
 
 #include <upipe/umem.h>
 #include <upipe/umem_alloc.h>
+#include <upipe/upool.h>
 #include <upipe/udict.h>
 #include <upipe/udict_inline.h>
 #include <upipe/uref.h>
 #include <upipe/uref_std.h>
+#include <upipe/uref_clock.h>
 
 #include <stdio.h>
 #include <string.h>
@@ -52,13 +54,22 @@ int main(int argc, char **argv)
     assert(udict_mgr != NULL);
     struct uref_mgr *mgr = uref_std_mgr_alloc(UREF_POOL_DEPTH, udict_mgr, 0);
     assert(mgr != NULL);
+    ubase_assert(uref_mgr_set_stats(mgr, true));
+    ubase_assert(uref_mgr_prefill(mgr, 4));
 
     struct uref *uref1 = uref_alloc(mgr);
     assert(uref1 != NULL);
+    uint64_t duration;
+    ubase_nassert(uref_clock_get_duration(uref1, &duration));
+    ubase_assert(uref_clock_set_duration(uref1, 42));
 
     struct uref *uref2 = uref_dup(uref1);
     assert(uref2 != NULL);
     assert(uref2 != uref1);
+    ubase_assert(uref_clock_get_duration(uref2, &duration));
+    assert(duration == 42);
+    ubase_assert(uref_clock_delete_duration(uref2));
+    ubase_nassert(uref_clock_get_duration(uref2, &duration));
     uref_free(uref1);
     uref_free(uref2);
 
@@ -71,6 +82,13 @@ int main(int argc, char **argv)
     assert(uref1 != NULL);
     uref_free(uref1);
 
+    struct upool_stats pool_stats;
+    ubase_assert(uref_mgr_get_stats(mgr, &pool_stats));
+    assert(pool_stats.hits == 3);
+    assert(pool_stats.misses == 1);
+    assert(pool_stats.high_water == 2);
+    assert(pool_stats.vacuums == 0);
+
     uref_mgr_release(mgr);
     udict_mgr_release(udict_mgr);
     umem_mgr_release(umem_mgr);